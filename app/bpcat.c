@@ -22,12 +22,17 @@
  * Includes
  *************************************************************************/
 
+/* recvmmsg() and sendmmsg() are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
-#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
@@ -59,6 +64,9 @@
 #define BPCAT_ADU_MAX_SIZE        (BPCAT_BUNDLE_BUFFER_SIZE - BPCAT_HEADER_RESERVE_SIZE)
 #define BPCAT_RECV_WINDOW_SZ      32
 
+/* the most datagrams the CLA threads move with each recvmmsg()/sendmmsg() call */
+#define BPCAT_CLA_BATCH_SIZE 32
+
 #define BPCAT_DEFAULT_INTER_BUNDLE_DELAY 20
 #define BPCAT_MAX_INTER_BUNDLE_DELAY     1000
 
@@ -67,6 +75,20 @@
 #define BPCAT_DEFAULT_SERVICENUM     1
 #define BPCAT_DEFAULT_UDP_PORT_BASE  36400
 
+#define BPCAT_MAX_FORWARD_WORKERS 16
+
+#define BPCAT_MAX_PLACEMENTS      8
+#define BPCAT_MAX_PLACEMENT_CPUS  16
+#define BPCAT_THREAD_NAME_MAX_LEN 32
+
+/* In benchmark mode each socket pair uses the next service number up from the local/remote address */
+#define BPCAT_MAX_BENCH_SOCKETS     8
+#define BPCAT_BENCH_MAGIC           0x42504254 /* "BPBT" */
+#define BPCAT_BENCH_DRAIN_MSEC      2000
+#define BPCAT_BENCH_LATENCY_BUCKETS 496
+
+#define BPCAT_STORAGE_SERVICENUM 10
+
 /*************************************************************************
  * File Data
  *************************************************************************/
@@ -94,8 +116,52 @@ typedef struct bpcat_msg_recv
     bpcat_msg_content_t msg;
 } bpcat_msg_recv_t;
 
+/* where a thread, by its name, should run: from the -p/--placement option */
+typedef struct bpcat_placement
+{
+    char     thread_name[BPCAT_THREAD_NAME_MAX_LEN];
+    uint32_t cpus[BPCAT_MAX_PLACEMENT_CPUS];
+    uint32_t num_cpus;
+    uint32_t rt_priority;
+} bpcat_placement_t;
+
+/* the start of every ADU generated in benchmark mode, all in network byte order */
+typedef struct bpcat_bench_header
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t send_time_hi; /* CLOCK_REALTIME in ns, so it still works between hosts that are in sync */
+    uint32_t send_time_lo;
+} bpcat_bench_header_t;
+
+typedef struct bpcat_bench_stats
+{
+    uint64_t first_time_ns;
+    uint64_t last_time_ns;
+    uint64_t bundles;
+    uint64_t bytes;
+    uint64_t timeouts;  /* sender: bplib_send() had to be retried */
+    uint64_t lost;      /* receiver: gaps in the sequence */
+    uint64_t reordered; /* receiver: came in after a later one */
+    uint64_t max_latency_us;
+    uint64_t latency_hist[BPCAT_BENCH_LATENCY_BUCKETS];
+} bpcat_bench_stats_t;
+
+typedef struct bpcat_bench_socket
+{
+    bp_socket_t        *desc;
+    uint32_t            random_seed;
+    uint32_t            next_sequence;
+    bpcat_bench_stats_t sent;
+    bpcat_bench_stats_t received;
+} bpcat_bench_socket_t;
+
 static bpcat_msg_recv_t recv_window[BPCAT_RECV_WINDOW_SZ];
 
+/* one of each for every datagram in a batch, these are too large for the stacks of the CLA threads */
+static uint8_t cla_rx_buffers[BPCAT_CLA_BATCH_SIZE][BPCAT_BUNDLE_BUFFER_SIZE];
+static uint8_t cla_tx_buffers[BPCAT_CLA_BATCH_SIZE][BPCAT_BUNDLE_BUFFER_SIZE];
+
 static volatile sig_atomic_t app_running;
 
 static const char IPN_ADDRESS_PREFIX[] = "ipn://";
@@ -110,11 +176,31 @@ static char remote_ipaddr_string[ADDR_MAX_SIZE];
 
 static long     inter_bundle_delay = BPCAT_DEFAULT_INTER_BUNDLE_DELAY;
 static uint32_t bundle_adu_size    = BPCAT_ADU_MAX_SIZE;
-
-pthread_t cla_in_task;
-pthread_t cla_out_task;
-pthread_t app_out_task;
-pthread_t app_in_task;
+static uint32_t num_forward_workers;
+
+static bpcat_placement_t placements[BPCAT_MAX_PLACEMENTS];
+static uint32_t          num_placements;
+
+/* per-bundle logging, which is turned off in benchmark mode */
+static bool verbose_log = true;
+
+static bool                  bench_mode;
+static bool                  delay_given;
+static volatile sig_atomic_t bench_sending;
+static uint32_t              bench_duration_sec;
+static uint32_t              bench_rate;
+static uint32_t              bench_min_size;
+static uint32_t              bench_max_size;
+static uint32_t              num_bench_sockets = 1;
+static bpcat_bench_socket_t  bench_sockets[BPCAT_MAX_BENCH_SOCKETS];
+
+bplib_os_thread_t *cla_in_task;
+bplib_os_thread_t *cla_out_task;
+bplib_os_thread_t *app_out_task;
+bplib_os_thread_t *app_in_task;
+bplib_os_thread_t *forward_worker_task[BPCAT_MAX_FORWARD_WORKERS];
+bplib_os_thread_t *bench_in_task[BPCAT_MAX_BENCH_SOCKETS];
+bplib_os_thread_t *bench_out_task[BPCAT_MAX_BENCH_SOCKETS];
 
 bp_handle_t storage_intf_id;
 
@@ -151,6 +237,18 @@ static void display_banner(const char *prog_name)
     fprintf(stderr, "   -d/--delay=<msec> forced inter bundle send delay (20ms default)\n");
     fprintf(stderr, "   -s/--adu-size=stream chunk (ADU) size to pass to bplib (default and max=%u bytes)\n",
             BPCAT_ADU_MAX_SIZE);
+    fprintf(stderr, "   -w/--workers=<n> extra threads forwarding bundles between flows (default 0, max %u)\n",
+            BPCAT_MAX_FORWARD_WORKERS);
+    fprintf(stderr, "   -p/--placement=<thread>[=<cpu>[,<cpu>...]][@<priority>] run a thread on the given CPUs,\n");
+    fprintf(stderr, "      and at the given realtime priority (1-99), may be repeated.  The threads are cla_in,\n");
+    fprintf(stderr, "      cla_out, app_in, app_out, forward_worker (all of them) and maintenance\n");
+    fprintf(stderr, "   -b/--benchmark=<sec> generate ADUs for the given time (0 until CTRL+C) in place of stdin,\n");
+    fprintf(stderr, "      and report the throughput and latency of what is sent and received at the end\n");
+    fprintf(stderr, "      --bench-rate=<n> bundles per second to generate (default 0, as fast as possible)\n");
+    fprintf(stderr, "      --bench-size=<min>[-<max>] ADU sizes to generate (default the -s size)\n");
+    fprintf(stderr, "      --bench-sockets=<n> BP sockets to spread the load over (default 1, max %u), each\n",
+            BPCAT_MAX_BENCH_SOCKETS);
+    fprintf(stderr, "      one using the next service number up from the local and remote addresses\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "   Creates a local BP agent with local IPN address as specified.  All data\n");
     fprintf(stderr, "   received from standard input is forwarded over BP bundles, and all data\n");
@@ -311,12 +409,88 @@ void redirect_file(int fileno, const char *filename)
     close(rfd);
 }
 
+/*
+ * parse_placement - parses one -p/--placement option, <thread>[=<cpu>[,<cpu>...]][@<priority>]
+ */
+static bool parse_placement(const char *arg)
+{
+    bpcat_placement_t *place;
+    const char        *name_end;
+    char              *end;
+    size_t             name_len;
+
+    if (num_placements >= BPCAT_MAX_PLACEMENTS)
+    {
+        return false;
+    }
+
+    place    = &placements[num_placements];
+    name_end = arg + strcspn(arg, "=@");
+    name_len = name_end - arg;
+    if (name_len == 0 || name_len >= sizeof(place->thread_name))
+    {
+        return false;
+    }
+
+    memset(place, 0, sizeof(*place));
+    memcpy(place->thread_name, arg, name_len);
+
+    end = (char *)name_end;
+    if (*end == '=')
+    {
+        do
+        {
+            if (place->num_cpus >= BPCAT_MAX_PLACEMENT_CPUS || !isdigit((unsigned char)end[1]))
+            {
+                return false;
+            }
+            place->cpus[place->num_cpus] = strtoul(end + 1, &end, 0);
+            ++place->num_cpus;
+        } while (*end == ',');
+    }
+
+    if (*end == '@')
+    {
+        if (!isdigit((unsigned char)end[1]))
+        {
+            return false;
+        }
+        place->rt_priority = strtoul(end + 1, &end, 0);
+    }
+
+    if (*end != 0)
+    {
+        return false;
+    }
+
+    ++num_placements;
+    return true;
+}
+
+/*
+ * parse_bench_size - parses the --bench-size option, <min>[-<max>]
+ */
+static bool parse_bench_size(const char *arg)
+{
+    char *end;
+
+    bench_min_size = strtoul(arg, &end, 0);
+    bench_max_size = bench_min_size;
+    if (*end == '-')
+    {
+        bench_max_size = strtoul(end + 1, &end, 0);
+    }
+
+    return (*end == 0 && bench_min_size >= sizeof(bpcat_bench_header_t) && bench_min_size <= bench_max_size &&
+            bench_max_size <= BPCAT_ADU_MAX_SIZE);
+}
+
 static void parse_options(int argc, char *argv[])
 {
     /*
      * getopts parameter passing options string
      */
-    static const char *opt_string = "l:r:i:o:12d:s:?";
+    static const char *opt_string = "l:r:i:o:12d:s:w:p:b:?";
 
     /*
      * getopts_long long form argument table
@@ -329,6 +503,12 @@ static void parse_options(int argc, char *argv[])
                                               {"remote-cla-uri", required_argument, NULL, 1001},
                                               {"delay", required_argument, NULL, 'd'},
                                               {"adu-size", required_argument, NULL, 's'},
+                                              {"workers", required_argument, NULL, 'w'},
+                                              {"placement", required_argument, NULL, 'p'},
+                                              {"benchmark", required_argument, NULL, 'b'},
+                                              {"bench-rate", required_argument, NULL, 1002},
+                                              {"bench-size", required_argument, NULL, 1003},
+                                              {"bench-sockets", required_argument, NULL, 1004},
                                               {"help", no_argument, NULL, '?'},
                                               {NULL, no_argument, NULL, 0}};
 
@@ -381,6 +561,7 @@ static void parse_options(int argc, char *argv[])
 
             case 'd':
                 inter_bundle_delay = strtoul(optarg, NULL, 0);
+                delay_given        = true;
                 if (inter_bundle_delay >= BPCAT_MAX_INTER_BUNDLE_DELAY)
                 {
                     display_banner(argv[0]);
@@ -395,6 +576,45 @@ static void parse_options(int argc, char *argv[])
                 }
                 break;
 
+            case 'w':
+                num_forward_workers = strtoul(optarg, NULL, 0);
+                if (num_forward_workers > BPCAT_MAX_FORWARD_WORKERS)
+                {
+                    display_banner(argv[0]);
+                }
+                break;
+
+            case 'p':
+                if (!parse_placement(optarg))
+                {
+                    display_banner(argv[0]);
+                }
+                break;
+
+            case 'b':
+                bench_mode         = true;
+                bench_duration_sec = strtoul(optarg, NULL, 0);
+                break;
+
+            case 1002:
+                bench_rate = strtoul(optarg, NULL, 0);
+                break;
+
+            case 1003:
+                if (!parse_bench_size(optarg))
+                {
+                    display_banner(argv[0]);
+                }
+                break;
+
+            case 1004:
+                num_bench_sockets = strtoul(optarg, NULL, 0);
+                if (num_bench_sockets == 0 || num_bench_sockets > BPCAT_MAX_BENCH_SOCKETS)
+                {
+                    display_banner(argv[0]);
+                }
+                break;
+
             case 1000:
                 strncpy(local_ipaddr_string, optarg, sizeof(local_ipaddr_string) - 1);
                 local_ipaddr_string[sizeof(local_ipaddr_string) - 1] = 0;
@@ -410,52 +630,113 @@ static void parse_options(int argc, char *argv[])
                 break;
         }
     } while (true);
+
+    if (bench_mode)
+    {
+        /* the sizes default to the -s size, which has to have room for the header */
+        if (bench_max_size == 0)
+        {
+            bench_min_size = bundle_adu_size;
+            bench_max_size = bundle_adu_size;
+        }
+        if (bench_min_size < sizeof(bpcat_bench_header_t))
+        {
+            display_banner(argv[0]);
+        }
+
+        /* the default delay limits it to 50 bundles per second, which is far from a benchmark */
+        if (!delay_given)
+        {
+            inter_bundle_delay = 0;
+        }
+
+        verbose_log = false;
+    }
 }
 
-#define join_thread(tsk) do_join_thread(#tsk, tsk##_task)
-static void do_join_thread(const char *name, pthread_t task)
+/*
+ * apply_placement - places a thread as given by the -p/--placement options, NULL for the calling thread
+ */
+static void apply_placement(const char *name, bplib_os_thread_t *task)
 {
-    int status;
+    const bpcat_placement_t *place;
+    uint32_t                 i;
 
-    status = pthread_join(task, NULL);
-    if (status < 0)
+    for (i = 0; i < num_placements; ++i)
     {
-        fprintf(stderr, "Failed to join %s: %d\n", name, status);
+        place = &placements[i];
+        if (strcmp(place->thread_name, name) != 0)
+        {
+            continue;
+        }
+
+        if (place->num_cpus != 0 && bplib_os_thread_set_affinity(task, place->cpus, place->num_cpus) != BP_SUCCESS)
+        {
+            fprintf(stderr, "Failed to set CPU affinity of %s\n", name);
+        }
+
+        if (place->rt_priority != 0 && bplib_os_thread_set_priority(task, place->rt_priority) != BP_SUCCESS)
+        {
+            fprintf(stderr, "Failed to set realtime priority of %s\n", name);
+        }
     }
 }
 
-#define start_thread(tsk, obj) do_start_thread(#tsk, &tsk##_task, tsk##_entry, obj)
-static void do_start_thread(const char *name, pthread_t *task, void *(*entry)(void *), void *arg)
+#define join_thread(tsk) do_join_thread(#tsk, tsk##_task)
+static void do_join_thread(const char *name, bplib_os_thread_t *task)
 {
-    int status;
+    if (bplib_os_thread_join(task) != BP_SUCCESS)
+    {
+        fprintf(stderr, "Failed to join %s\n", name);
+    }
+}
 
-    status = pthread_create(task, NULL, entry, arg);
-    if (status < 0)
+#define start_thread(tsk, obj) do_start_thread(#tsk, &tsk##_task, tsk##_entry, obj)
+static void do_start_thread(const char *name, bplib_os_thread_t **task, bplib_os_thread_entry_t entry, void *arg)
+{
+    *task = bplib_os_thread_create(name, entry, arg);
+    if (*task == NULL)
     {
-        fprintf(stderr, "pthread_create(%s): %d, %s\n", name, status, strerror(status));
+        fprintf(stderr, "bplib_os_thread_create(%s) failed\n", name);
         abort();
     }
 
+    apply_placement(name, *task);
+
     fprintf(stderr, "started %s\n", name);
 }
 
-static void *cla_in_entry(void *arg)
+static void cla_in_entry(void *arg)
 {
-    bplib_cla_intf_id_t *cla;
-    ssize_t              status;
-    size_t               data_fill_sz;
-    uint8_t              bundle_buffer[BPCAT_BUNDLE_BUFFER_SIZE];
-    struct pollfd        pfd;
-    int                  error;
-    socklen_t            errlen;
-
-    cla          = arg;
-    data_fill_sz = 0;
-    error        = 0;
+    bplib_cla_intf_id_t   *cla;
+    ssize_t                status;
+    struct mmsghdr         msgs[BPCAT_CLA_BATCH_SIZE];
+    struct iovec           iov[BPCAT_CLA_BATCH_SIZE];
+    bplib_cla_bundle_buf_t bundles[BPCAT_CLA_BATCH_SIZE];
+    int                    status_list[BPCAT_CLA_BATCH_SIZE];
+    uint32_t               num_pending;
+    uint32_t               num_retry;
+    uint32_t               i;
+    struct pollfd          pfd;
+    int                    error;
+    socklen_t              errlen;
+
+    cla         = arg;
+    num_pending = 0;
+    error       = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < BPCAT_CLA_BATCH_SIZE; ++i)
+    {
+        iov[i].iov_base            = cla_rx_buffers[i];
+        iov[i].iov_len             = sizeof(cla_rx_buffers[i]);
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
     while (app_running)
     {
-        if (data_fill_sz == 0)
+        if (num_pending == 0)
         {
             pfd.fd      = cla->sys_fd;
             pfd.events  = POLLIN;
@@ -486,14 +767,21 @@ static void *cla_in_entry(void *arg)
 
             if ((pfd.revents & POLLIN) != 0)
             {
-                status = recv(cla->sys_fd, bundle_buffer, sizeof(bundle_buffer), MSG_DONTWAIT);
+                /* everything that is already waiting comes in with one call */
+                status = recvmmsg(cla->sys_fd, msgs, BPCAT_CLA_BATCH_SIZE, MSG_DONTWAIT, NULL);
                 if (status < 0)
                 {
-                    perror("recv()");
+                    perror("recvmmsg()");
                     break;
                 }
 
-                data_fill_sz = status;
+                for (i = 0; i < status; ++i)
+                {
+                    bundles[i].bundle = cla_rx_buffers[i];
+                    bundles[i].size   = msgs[i].msg_len;
+                }
+
+                num_pending = status;
                 pfd.revents &= ~POLLIN;
             }
 
@@ -505,58 +793,110 @@ static void *cla_in_entry(void *arg)
         }
         else
         {
-            fprintf(stderr, "Call system bplib_cla_ingress()... size=%zu\n", data_fill_sz);
-            status = bplib_cla_ingress(cla->rtbl, cla->intf_id, bundle_buffer, data_fill_sz, BPCAT_MAX_WAIT_MSEC);
-            if (status == BP_SUCCESS)
+            if (verbose_log)
             {
-                data_fill_sz = 0;
+                fprintf(stderr, "Call system bplib_cla_ingress_batch()... count=%lu\n", (unsigned long)num_pending);
             }
-            else if (status != BP_TIMEOUT)
+            bplib_cla_ingress_batch(cla->rtbl, cla->intf_id, bundles, num_pending, status_list, BPCAT_MAX_WAIT_MSEC);
+
+            /* the ones that timed out are tried again, in the same order */
+            status    = BP_SUCCESS;
+            num_retry = 0;
+            for (i = 0; i < num_pending; ++i)
+            {
+                if (status_list[i] == BP_TIMEOUT)
+                {
+                    bundles[num_retry] = bundles[i];
+                    ++num_retry;
+                }
+                else if (status_list[i] != BP_SUCCESS)
+                {
+                    status = status_list[i];
+                }
+            }
+
+            if (status != BP_SUCCESS)
             {
-                fprintf(stderr, "Failed bplib_cla_ingress() code=%zd... exiting\n", status);
+                fprintf(stderr, "Failed bplib_cla_ingress_batch() code=%zd... exiting\n", status);
                 break;
             }
+
+            num_pending = num_retry;
         }
     }
-
-    return NULL;
 }
 
-static void *cla_out_entry(void *arg)
+static void cla_out_entry(void *arg)
 {
-    bplib_cla_intf_id_t *cla;
-    size_t               data_fill_sz;
-    size_t               cla_bundle_sz;
-    ssize_t              status;
-    uint8_t              bundle_buffer[BPCAT_BUNDLE_BUFFER_SIZE];
-    struct timespec      tm;
-
-    cla          = arg;
-    data_fill_sz = 0;
+    bplib_cla_intf_id_t   *cla;
+    struct mmsghdr         msgs[BPCAT_CLA_BATCH_SIZE];
+    struct iovec           iov[BPCAT_CLA_BATCH_SIZE];
+    bplib_cla_egress_buf_t buffers[BPCAT_CLA_BATCH_SIZE];
+    uint32_t               num_filled;
+    uint32_t               num_sent;
+    uint32_t               send_count;
+    uint32_t               i;
+    int                    status;
+    struct timespec        tm;
+
+    cla        = arg;
+    num_filled = 0;
+    num_sent   = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < BPCAT_CLA_BATCH_SIZE; ++i)
+    {
+        msgs[i].msg_hdr.msg_name    = (void *)cla->remote_addr;
+        msgs[i].msg_hdr.msg_namelen = cla->remote_addr_len;
+        msgs[i].msg_hdr.msg_iov     = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen  = 1;
+    }
 
     while (app_running)
     {
-        if (data_fill_sz == 0)
+        if (num_sent == num_filled)
         {
-            cla_bundle_sz = sizeof(bundle_buffer);
-            status = bplib_cla_egress(cla->rtbl, cla->intf_id, bundle_buffer, &cla_bundle_sz, BPCAT_MAX_WAIT_MSEC);
+            for (i = 0; i < BPCAT_CLA_BATCH_SIZE; ++i)
+            {
+                buffers[i].bundle = cla_tx_buffers[i];
+                buffers[i].size   = sizeof(cla_tx_buffers[i]);
+            }
+
+            num_filled = 0;
+            num_sent   = 0;
+            status     = bplib_cla_egress_batch(cla->rtbl, cla->intf_id, buffers, BPCAT_CLA_BATCH_SIZE, &num_filled,
+                                                BPCAT_MAX_WAIT_MSEC);
             if (status == BP_SUCCESS)
             {
-                data_fill_sz = cla_bundle_sz;
+                for (i = 0; i < num_filled; ++i)
+                {
+                    iov[i].iov_base = buffers[i].bundle;
+                    iov[i].iov_len  = buffers[i].size;
+                }
             }
             else if (status != BP_TIMEOUT)
             {
-                fprintf(stderr, "Failed bplib_cla_egress() code=%zd... exiting\n", status);
+                fprintf(stderr, "Failed bplib_cla_egress_batch() code=%d... exiting\n", status);
                 break;
             }
         }
         else
         {
-            fprintf(stderr, "Call system send()... size=%zu\n", data_fill_sz);
-            status = sendto(cla->sys_fd, bundle_buffer, data_fill_sz, 0, cla->remote_addr, cla->remote_addr_len);
-            if (status == data_fill_sz)
+            /* a forced delay is between each bundle, so then they go one at a time */
+            send_count = num_filled - num_sent;
+            if (inter_bundle_delay != 0)
             {
-                data_fill_sz = 0;
+                send_count = 1;
+            }
+
+            if (verbose_log)
+            {
+                fprintf(stderr, "Call system sendmmsg()... count=%lu\n", (unsigned long)send_count);
+            }
+            status = sendmmsg(cla->sys_fd, &msgs[num_sent], send_count, 0);
+            if (status > 0)
+            {
+                num_sent += status;
             }
             else if (errno == ECONNREFUSED)
             {
@@ -564,23 +904,24 @@ static void *cla_out_entry(void *arg)
             }
             else if (errno != EWOULDBLOCK && errno != EAGAIN)
             {
-                fprintf(stderr, "Failed send() errno=%d (%s)\n", errno, strerror(errno));
+                fprintf(stderr, "Failed sendmmsg() errno=%d (%s)\n", errno, strerror(errno));
                 break;
             }
 
-            tm.tv_sec  = 0;
-            tm.tv_nsec = inter_bundle_delay * 1000000;
-            clock_nanosleep(CLOCK_MONOTONIC, 0, &tm, NULL);
+            if (inter_bundle_delay != 0)
+            {
+                tm.tv_sec  = 0;
+                tm.tv_nsec = inter_bundle_delay * 1000000;
+                clock_nanosleep(CLOCK_MONOTONIC, 0, &tm, NULL);
+            }
         }
     }
-
-    return NULL;
 }
 
 static int setup_cla(bplib_routetbl_t *rtbl, const struct sockaddr_in *local_cla_addr,
                      const struct sockaddr_in *remote_cla_addr)
 {
-    static bplib_cla_intf_id_t cla_intf_id; /* static because its passed to pthread_create() */
+    static bplib_cla_intf_id_t cla_intf_id; /* static because its passed to bplib_os_thread_create() */
 
     /* Create bplib CLA and default route */
     cla_intf_id.rtbl    = rtbl;
@@ -661,7 +1002,7 @@ static int setup_storage(bplib_routetbl_t *rtbl, const bp_ipn_addr_t *storage_ad
     return 0;
 }
 
-static void *app_in_entry(void *arg)
+static void app_in_entry(void *arg)
 {
     bp_socket_t        *desc;
     uint64_t            send_deadline;
@@ -785,11 +1126,9 @@ static void *app_in_entry(void *arg)
             break;
         }
     }
-
-    return NULL;
 }
 
-static void *app_out_entry(void *arg)
+static void app_out_entry(void *arg)
 {
     bp_socket_t      *desc;
     size_t            recv_sz;
@@ -915,8 +1254,6 @@ static void *app_out_entry(void *arg)
             }
         }
     }
-
-    return NULL;
 }
 
 static int setup_connection(bplib_routetbl_t *rtbl, const bp_ipn_addr_t *local_addr, const bp_ipn_addr_t *remote_addr)
@@ -952,6 +1289,383 @@ static int setup_connection(bplib_routetbl_t *rtbl, const bp_ipn_addr_t *local_a
     return 0;
 }
 
+static void forward_worker_entry(void *arg)
+{
+    bplib_routetbl_t *rtbl;
+
+    rtbl = arg;
+
+    /* shares the active flows with the maintenance loop in main() */
+    while (app_running)
+    {
+        bplib_route_worker_process_flows(rtbl, BPCAT_MAX_WAIT_MSEC);
+    }
+}
+
+static uint64_t bench_get_time_ns(clockid_t clock_id)
+{
+    struct timespec ts;
+
+    clock_gettime(clock_id, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/*
+ * bench_latency_bucket - 8 buckets per power of two, so each one is within 12.5% of the value
+ */
+static uint32_t bench_latency_bucket(uint64_t latency_us)
+{
+    uint32_t exponent;
+
+    if (latency_us < 8)
+    {
+        return latency_us;
+    }
+
+    exponent = 63 - __builtin_clzll(latency_us);
+    return (8 * (exponent - 2)) + ((latency_us >> (exponent - 3)) & 0x7);
+}
+
+static uint64_t bench_latency_bucket_value(uint32_t bucket)
+{
+    if (bucket < 8)
+    {
+        return bucket;
+    }
+
+    return (uint64_t)(8 + (bucket & 0x7)) << ((bucket / 8) - 1);
+}
+
+static void bench_in_entry(void *arg)
+{
+    bpcat_bench_socket_t *bsock;
+    bpcat_msg_content_t   msg_buffer;
+    bpcat_bench_header_t  header;
+    struct timespec       next_ts;
+    uint64_t              next_time;
+    uint64_t              period_ns;
+    uint64_t              send_time;
+    uint32_t              stream_pos;
+    uint32_t              adu_size;
+    uint32_t              i;
+    ssize_t               status;
+
+    bsock      = arg;
+    stream_pos = 0;
+
+    /* the content after the header is never looked at, but is not all zero either */
+    for (i = 0; i < sizeof(msg_buffer.content); ++i)
+    {
+        msg_buffer.content[i] = (uint8_t)i;
+    }
+
+    /* the rate is shared between the sockets */
+    if (bench_rate != 0)
+    {
+        period_ns = (1000000000ULL * num_bench_sockets) / bench_rate;
+    }
+    else
+    {
+        period_ns = 0;
+    }
+
+    next_time = bench_get_time_ns(CLOCK_MONOTONIC);
+
+    while (app_running && bench_sending)
+    {
+        if (period_ns != 0)
+        {
+            /* this keeps to the schedule, if a bundle is late the next one is not delayed for it */
+            next_time += period_ns;
+            next_ts.tv_sec  = next_time / 1000000000;
+            next_ts.tv_nsec = next_time % 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_ts, NULL);
+        }
+
+        adu_size = bench_min_size;
+        if (bench_max_size > bench_min_size)
+        {
+            bsock->random_seed = (bsock->random_seed * 1103515245) + 12345;
+            adu_size += (bsock->random_seed >> 8) % (1 + bench_max_size - bench_min_size);
+        }
+
+        msg_buffer.segment_len = htonl(adu_size);
+        msg_buffer.stream_pos  = htonl(stream_pos);
+
+        do
+        {
+            send_time           = bench_get_time_ns(CLOCK_REALTIME);
+            header.magic        = htonl(BPCAT_BENCH_MAGIC);
+            header.sequence     = htonl(bsock->sent.bundles);
+            header.send_time_hi = htonl(send_time >> 32);
+            header.send_time_lo = htonl(send_time & 0xFFFFFFFF);
+            memcpy(msg_buffer.content, &header, sizeof(header));
+
+            status = bplib_send(bsock->desc, &msg_buffer, offsetof(bpcat_msg_content_t, content[adu_size]),
+                                BPCAT_MAX_WAIT_MSEC);
+            if (status == BP_TIMEOUT)
+            {
+                ++bsock->sent.timeouts;
+            }
+        } while (status == BP_TIMEOUT && app_running && bench_sending);
+
+        if (status != BP_SUCCESS)
+        {
+            if (status != BP_TIMEOUT)
+            {
+                fprintf(stderr, "Failed bplib_send() code=%zd... exiting\n", status);
+            }
+            break;
+        }
+
+        if (bsock->sent.bundles == 0)
+        {
+            bsock->sent.first_time_ns = send_time;
+        }
+        bsock->sent.last_time_ns = send_time;
+        ++bsock->sent.bundles;
+        bsock->sent.bytes += adu_size;
+        stream_pos += adu_size;
+    }
+}
+
+static void bench_out_entry(void *arg)
+{
+    bpcat_bench_socket_t *bsock;
+    bpcat_msg_content_t   msg_buffer;
+    bpcat_bench_header_t  header;
+    size_t                recv_sz;
+    uint64_t              recv_time;
+    uint64_t              send_time;
+    uint64_t              latency_us;
+    uint32_t              sequence;
+    ssize_t               status;
+
+    bsock = arg;
+
+    while (app_running)
+    {
+        recv_sz = sizeof(msg_buffer);
+        status  = bplib_recv(bsock->desc, &msg_buffer, &recv_sz, BPCAT_MAX_WAIT_MSEC);
+        if (status == BP_TIMEOUT)
+        {
+            continue;
+        }
+        if (status != BP_SUCCESS)
+        {
+            fprintf(stderr, "Failed bplib_recv() code=%zd... exiting\n", status);
+            break;
+        }
+
+        recv_time = bench_get_time_ns(CLOCK_REALTIME);
+
+        /* anything else that comes in, such as from a bpcat that is not benchmarking, is left out */
+        if (recv_sz < offsetof(bpcat_msg_content_t, content[sizeof(header)]))
+        {
+            continue;
+        }
+        memcpy(&header, msg_buffer.content, sizeof(header));
+        if (ntohl(header.magic) != BPCAT_BENCH_MAGIC)
+        {
+            continue;
+        }
+
+        sequence  = ntohl(header.sequence);
+        send_time = ((uint64_t)ntohl(header.send_time_hi) << 32) | ntohl(header.send_time_lo);
+
+        if (sequence >= bsock->next_sequence)
+        {
+            bsock->received.lost += sequence - bsock->next_sequence;
+            bsock->next_sequence = sequence + 1;
+        }
+        else
+        {
+            /* this one was counted as lost when the later one came in, unless it is a duplicate */
+            ++bsock->received.reordered;
+            if (bsock->received.lost > 0)
+            {
+                --bsock->received.lost;
+            }
+        }
+
+        /* with the clocks of two hosts out of sync this could be negative, which counts as 0 */
+        if (recv_time > send_time)
+        {
+            latency_us = (recv_time - send_time) / 1000;
+        }
+        else
+        {
+            latency_us = 0;
+        }
+
+        ++bsock->received.latency_hist[bench_latency_bucket(latency_us)];
+        if (latency_us > bsock->received.max_latency_us)
+        {
+            bsock->received.max_latency_us = latency_us;
+        }
+
+        if (bsock->received.bundles == 0)
+        {
+            bsock->received.first_time_ns = recv_time;
+        }
+        bsock->received.last_time_ns = recv_time;
+        ++bsock->received.bundles;
+        bsock->received.bytes += recv_sz - offsetof(bpcat_msg_content_t, content);
+    }
+}
+
+static int setup_bench_connections(bplib_routetbl_t *rtbl, const bp_ipn_addr_t *local_addr,
+                                   const bp_ipn_addr_t *remote_addr)
+{
+    bpcat_bench_socket_t *bsock;
+    bp_ipn_addr_t         sock_local_addr;
+    bp_ipn_addr_t         sock_remote_addr;
+    uint32_t              i;
+
+    bench_sending = 1;
+
+    for (i = 0; i < num_bench_sockets; ++i)
+    {
+        bsock            = &bench_sockets[i];
+        sock_local_addr  = (bp_ipn_addr_t) {local_addr->node_number, local_addr->service_number + i};
+        sock_remote_addr = (bp_ipn_addr_t) {remote_addr->node_number, remote_addr->service_number + i};
+
+        if (sock_local_addr.service_number == BPCAT_STORAGE_SERVICENUM)
+        {
+            fprintf(stderr, "Service number %lu is used for storage... exiting\n",
+                    (unsigned long)sock_local_addr.service_number);
+            return -1;
+        }
+
+        bsock->random_seed = 0x2545F491 + i;
+        bsock->desc        = bplib_create_socket(rtbl);
+        if (bsock->desc == NULL)
+        {
+            fprintf(stderr, "Failed bplib_open()... exiting\n");
+            return -1;
+        }
+
+        if (bplib_bind_socket(bsock->desc, &sock_local_addr) < 0 ||
+            bplib_connect_socket(bsock->desc, &sock_remote_addr) < 0)
+        {
+            fprintf(stderr, "Failed to bind/connect socket %lu... exiting\n", (unsigned long)i);
+            bplib_close_socket(bsock->desc);
+            return -1;
+        }
+
+        do_start_thread("bench_in", &bench_in_task[i], bench_in_entry, bsock);
+        do_start_thread("bench_out", &bench_out_task[i], bench_out_entry, bsock);
+    }
+
+    return 0;
+}
+
+static void bench_merge_stats(bpcat_bench_stats_t *total, const bpcat_bench_stats_t *stats)
+{
+    uint32_t i;
+
+    if (stats->bundles == 0)
+    {
+        return;
+    }
+
+    if (total->bundles == 0 || stats->first_time_ns < total->first_time_ns)
+    {
+        total->first_time_ns = stats->first_time_ns;
+    }
+    if (stats->last_time_ns > total->last_time_ns)
+    {
+        total->last_time_ns = stats->last_time_ns;
+    }
+    if (stats->max_latency_us > total->max_latency_us)
+    {
+        total->max_latency_us = stats->max_latency_us;
+    }
+
+    total->bundles += stats->bundles;
+    total->bytes += stats->bytes;
+    total->timeouts += stats->timeouts;
+    total->lost += stats->lost;
+    total->reordered += stats->reordered;
+
+    for (i = 0; i < BPCAT_BENCH_LATENCY_BUCKETS; ++i)
+    {
+        total->latency_hist[i] += stats->latency_hist[i];
+    }
+}
+
+static void bench_print_rate(const char *direction, const bpcat_bench_stats_t *stats)
+{
+    double elapsed_sec;
+
+    elapsed_sec = (double)(stats->last_time_ns - stats->first_time_ns) / 1e9;
+    if (elapsed_sec <= 0)
+    {
+        elapsed_sec = 1e-9;
+    }
+
+    printf("%-8s %10llu bundles %12llu bytes over %8.3f s: %10.1f bundles/s %9.3f MB/s\n", direction,
+           (unsigned long long)stats->bundles, (unsigned long long)stats->bytes, elapsed_sec,
+           (double)stats->bundles / elapsed_sec, (double)stats->bytes / (elapsed_sec * 1e6));
+}
+
+static void bench_print_latency(const bpcat_bench_stats_t *stats)
+{
+    static const double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+
+    uint64_t target;
+    uint64_t count;
+    uint32_t bucket;
+    uint32_t p;
+
+    printf("latency ");
+
+    bucket = 0;
+    count  = 0;
+    for (p = 0; p < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); ++p)
+    {
+        target = (uint64_t)((PERCENTILES[p] * stats->bundles) / 100.0);
+        while (bucket < BPCAT_BENCH_LATENCY_BUCKETS && count + stats->latency_hist[bucket] <= target)
+        {
+            count += stats->latency_hist[bucket];
+            ++bucket;
+        }
+
+        printf(" p%g=%lluus", PERCENTILES[p], (unsigned long long)bench_latency_bucket_value(bucket));
+    }
+
+    printf(" max=%lluus\n", (unsigned long long)stats->max_latency_us);
+}
+
+static void bench_report(void)
+{
+    bpcat_bench_stats_t sent;
+    bpcat_bench_stats_t received;
+    uint32_t            i;
+
+    memset(&sent, 0, sizeof(sent));
+    memset(&received, 0, sizeof(received));
+
+    for (i = 0; i < num_bench_sockets; ++i)
+    {
+        bench_merge_stats(&sent, &bench_sockets[i].sent);
+        bench_merge_stats(&received, &bench_sockets[i].received);
+    }
+
+    printf("Benchmark results over %lu socket(s), ADU size %lu-%lu:\n", (unsigned long)num_bench_sockets,
+           (unsigned long)bench_min_size, (unsigned long)bench_max_size);
+    bench_print_rate("sent", &sent);
+    printf("         %10llu send timeouts\n", (unsigned long long)sent.timeouts);
+    bench_print_rate("received", &received);
+    printf("         %10llu lost %llu reordered\n", (unsigned long long)received.lost,
+           (unsigned long long)received.reordered);
+    if (received.bundles != 0)
+    {
+        bench_print_latency(&received);
+    }
+    fflush(stdout);
+}
+
 /******************************************************************************
  * Main
  ******************************************************************************/
@@ -965,6 +1679,8 @@ int main(int argc, char *argv[])
     struct sockaddr_in remote_cla_addr;
     uint64_t           stats_time;
     uint64_t           curr_time;
+    uint64_t           bench_end_time;
+    uint32_t           i;
 
     app_running = 1;
     signal(SIGINT, app_quick_exit);
@@ -976,10 +1692,15 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    bplib_os_enable_log_flags(0xFFFFFFFF);
-
     /* Process Command Line */
     parse_options(argc, argv);
+
+    /* a benchmark only keeps the default logging, which does not happen for every bundle */
+    if (!bench_mode)
+    {
+        bplib_os_enable_log_flags(0xFFFFFFFF);
+    }
+
     parse_ipn_address(local_dtnaddr_string, sizeof(local_dtnaddr_string), &local_ipn_addr, BPCAT_DEFAULT_LOCAL_NODENUM,
                       BPCAT_DEFAULT_SERVICENUM);
     fprintf(stderr, "Local DTN address: %s\n", local_dtnaddr_string);
@@ -993,8 +1714,8 @@ int main(int argc, char *argv[])
                      remote_ipn_addr.node_number + BPCAT_DEFAULT_UDP_PORT_BASE);
     fprintf(stderr, "Remote CLA URI: %s\n", remote_ipaddr_string);
 
-    /* Test route table with 1MB of cache */
-    rtbl = bplib_route_alloc_table(10, 1 << 20);
+    /* Test route table with 1MB of cache, and an interface for each benchmark socket */
+    rtbl = bplib_route_alloc_table(10 + num_bench_sockets, 1 << 20);
     if (rtbl == NULL)
     {
         fprintf(stderr, "%s(): bplib_route_alloc_table failed\n", __func__);
@@ -1002,7 +1723,7 @@ int main(int argc, char *argv[])
     }
 
     /* this currently assumes service number 10 for storage, should be configurable */
-    storage_ipn_addr = (bp_ipn_addr_t) {local_ipn_addr.node_number, 10};
+    storage_ipn_addr = (bp_ipn_addr_t) {local_ipn_addr.node_number, BPCAT_STORAGE_SERVICENUM};
     if (setup_storage(rtbl, &storage_ipn_addr) < 0)
     {
         fprintf(stderr, "Failed setup_storage()... exiting\n");
@@ -1015,14 +1736,38 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    if (setup_connection(rtbl, &local_ipn_addr, &remote_ipn_addr) < 0)
+    if (bench_mode)
+    {
+        if (setup_bench_connections(rtbl, &local_ipn_addr, &remote_ipn_addr) < 0)
+        {
+            fprintf(stderr, "Failed setup_bench_connections()... exiting\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if (setup_connection(rtbl, &local_ipn_addr, &remote_ipn_addr) < 0)
     {
         fprintf(stderr, "Failed setup_connection()... exiting\n");
         return EXIT_FAILURE;
     }
 
+    for (i = 0; i < num_forward_workers; ++i)
+    {
+        do_start_thread("forward_worker", &forward_worker_task[i], forward_worker_entry, rtbl);
+    }
+
+    /* the maintenance loop runs on this thread */
+    apply_placement("maintenance", NULL);
+
     /* Run management Loop */
     stats_time = bplib_os_get_dtntime_ms() + 10000;
+    if (bench_mode && bench_duration_sec != 0)
+    {
+        bench_end_time = bplib_os_get_dtntime_ms() + (1000 * (uint64_t)bench_duration_sec);
+    }
+    else
+    {
+        bench_end_time = BP_DTNTIME_INFINITE;
+    }
     while (app_running)
     {
         bplib_route_maintenance_request_wait(rtbl);
@@ -1039,13 +1784,47 @@ int main(int argc, char *argv[])
             bplib_cache_debug_scan(rtbl, storage_intf_id);
             stats_time += 10000;
         }
+
+        /* when the time is up the sending stops, the rest of what is on the way still gets in */
+        if (curr_time >= bench_end_time)
+        {
+            if (bench_sending)
+            {
+                bench_sending  = 0;
+                bench_end_time = curr_time + BPCAT_BENCH_DRAIN_MSEC;
+            }
+            else
+            {
+                app_running = 0;
+            }
+        }
     }
 
     /* Join Threads */
-    join_thread(app_in);
-    join_thread(app_out);
+    if (bench_mode)
+    {
+        for (i = 0; i < num_bench_sockets; ++i)
+        {
+            do_join_thread("bench_in", bench_in_task[i]);
+            do_join_thread("bench_out", bench_out_task[i]);
+        }
+    }
+    else
+    {
+        join_thread(app_in);
+        join_thread(app_out);
+    }
     join_thread(cla_in);
     join_thread(cla_out);
+    for (i = 0; i < num_forward_workers; ++i)
+    {
+        do_join_thread("forward_worker", forward_worker_task[i]);
+    }
+
+    if (bench_mode)
+    {
+        bench_report();
+    }
 
     return 0;
 }
@@ -0,0 +1,684 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+/* clock_gettime() and clock_nanosleep() are POSIX */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+
+/*
+ * A capture file is a sequence of records, each a 4 byte length in network byte order followed
+ * by the encoded bundle.  That is the same as the TCP CLA framing, so one direction of a TCP CLA
+ * connection can be saved and replayed as it is.  With -t each record also starts with the time
+ * it was captured, as 8 bytes of microseconds in network byte order, before the length.
+ */
+#define BPREPLAY_LENGTH_SIZE    4
+#define BPREPLAY_TIMESTAMP_SIZE 8
+#define BPREPLAY_MAX_BUNDLE     (16 * 1024 * 1024)
+
+#define BPREPLAY_DEFAULT_MEMORY_MB 32
+#define BPREPLAY_MAX_BATCH         1024
+
+/* the storage entity gets this service number on the -s node, as in bpcat */
+#define BPREPLAY_STORAGE_SERVICENUM 10
+
+/* timed work (the storage timers) is run this often, outside of the measured stages */
+#define BPREPLAY_MAINT_INTERVAL_MSEC 100
+
+/* after the last record, how long to keep going while bundles are still coming out */
+#define BPREPLAY_DRAIN_MSEC 1000
+
+typedef struct bpreplay_record
+{
+    const uint8_t *bundle;
+    size_t         size;
+    uint64_t       capture_time_us;
+} bpreplay_record_t;
+
+typedef enum bpreplay_stage
+{
+    bpreplay_stage_decode, /* bplib_cla_ingress(), which decodes the bundle into the pool */
+    bpreplay_stage_route,  /* running the active flows, which routes the bundles and runs the cache */
+    bpreplay_stage_egress, /* bplib_cla_egress(), which encodes each bundle out of the pool */
+    bpreplay_stage_max
+} bpreplay_stage_t;
+
+typedef struct bpreplay_samples
+{
+    uint64_t *ns; /* per bundle */
+    uint64_t  count;
+    uint64_t  max_count;
+    uint64_t  total_ns;
+} bpreplay_samples_t;
+
+static const char *const BPREPLAY_STAGE_NAMES[bpreplay_stage_max] = {"decode", "route", "egress"};
+
+static const char *capture_filename;
+static bool        has_timestamps;
+static bool        original_timing;
+static double      timing_speed = 1.0;
+static uint32_t    batch_size   = 1;
+static uint32_t    repeat_count = 1;
+static uint32_t    memory_mb    = BPREPLAY_DEFAULT_MEMORY_MB;
+static bp_ipn_t    storage_node;
+
+static uint8_t           *capture_data;
+static bpreplay_record_t *records;
+static uint32_t           num_records;
+static size_t             max_record_size;
+
+static bplib_routetbl_t *rtbl;
+static bp_handle_t       cla_in_intf;
+static bp_handle_t       cla_out_intf;
+static uint8_t          *egress_buffer;
+static size_t            egress_buffer_size;
+
+static bpreplay_samples_t samples[bpreplay_stage_max];
+static uint64_t           num_ingressed;
+static uint64_t           num_rejected;
+static uint64_t           num_egressed;
+static uint64_t           bytes_ingressed;
+static uint64_t           bytes_egressed;
+static uint64_t           next_maint_time;
+
+/*************************************************************************
+ * Options and input
+ *************************************************************************/
+
+static void display_usage(const char *prog_name)
+{
+    fprintf(stderr, "Usage: %s [options] <capture file>\n", prog_name);
+    fprintf(stderr, "   -t/--timestamps each record starts with an 8 byte capture time in microseconds\n");
+    fprintf(stderr, "   -o/--original-timing put each bundle in at the time it was captured (needs -t),\n");
+    fprintf(stderr, "      rather than as fast as possible\n");
+    fprintf(stderr, "      --speed=<factor> with -o, replay this many times faster than captured (default 1)\n");
+    fprintf(stderr, "   -b/--batch=<n> bundles put in before the flows are run (default 1, max %u)\n",
+            BPREPLAY_MAX_BATCH);
+    fprintf(stderr, "   -n/--repeat=<n> times to go through the file (default 1)\n");
+    fprintf(stderr, "   -s/--storage=<node> route the bundles through a RAM storage entity of the given node,\n");
+    fprintf(stderr, "      so the bundles that ask for custody go through the cache\n");
+    fprintf(stderr, "   -m/--memory=<MB> memory pool size (default %u)\n", BPREPLAY_DEFAULT_MEMORY_MB);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "   Puts each bundle in the capture file in through a CLA interface, with a default\n");
+    fprintf(stderr, "   route out through another one.  All the work is done on one thread, one stage at\n");
+    fprintf(stderr, "   a time, so the time of each stage is measured on its own.  At the end the time\n");
+    fprintf(stderr, "   per bundle of each stage is printed, along with what the library counted.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "   A capture file is a sequence of records, each a 4 byte length in network byte\n");
+    fprintf(stderr, "   order followed by the encoded bundle, the same as the TCP CLA framing.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Example:\n");
+    fprintf(stderr, "   %s -n 10 -s 100 bundles.cap\n\n", prog_name);
+
+    exit(-1);
+}
+
+static void parse_options(int argc, char *argv[])
+{
+    static const struct option long_opts[] = {{"timestamps", no_argument, NULL, 't'},
+                                              {"original-timing", no_argument, NULL, 'o'},
+                                              {"speed", required_argument, NULL, 1001},
+                                              {"batch", required_argument, NULL, 'b'},
+                                              {"repeat", required_argument, NULL, 'n'},
+                                              {"storage", required_argument, NULL, 's'},
+                                              {"memory", required_argument, NULL, 'm'},
+                                              {"help", no_argument, NULL, 'h'},
+                                              {NULL}};
+    int                        opt;
+
+    while ((opt = getopt_long(argc, argv, "tob:n:s:m:h", long_opts, NULL)) >= 0)
+    {
+        switch (opt)
+        {
+            case 't':
+                has_timestamps = true;
+                break;
+            case 'o':
+                original_timing = true;
+                break;
+            case 1001:
+                timing_speed = strtod(optarg, NULL);
+                if (timing_speed <= 0.0)
+                {
+                    display_usage(argv[0]);
+                }
+                break;
+            case 'b':
+                batch_size = strtoul(optarg, NULL, 0);
+                if (batch_size < 1 || batch_size > BPREPLAY_MAX_BATCH)
+                {
+                    display_usage(argv[0]);
+                }
+                break;
+            case 'n':
+                repeat_count = strtoul(optarg, NULL, 0);
+                if (repeat_count < 1)
+                {
+                    display_usage(argv[0]);
+                }
+                break;
+            case 's':
+                storage_node = strtoul(optarg, NULL, 0);
+                if (storage_node == 0)
+                {
+                    display_usage(argv[0]);
+                }
+                break;
+            case 'm':
+                memory_mb = strtoul(optarg, NULL, 0);
+                if (memory_mb < 1)
+                {
+                    display_usage(argv[0]);
+                }
+                break;
+            default:
+                display_usage(argv[0]);
+                break;
+        }
+    }
+
+    if (optind != argc - 1 || (original_timing && !has_timestamps))
+    {
+        display_usage(argv[0]);
+    }
+
+    capture_filename = argv[optind];
+}
+
+static uint64_t get_be_value(const uint8_t *ptr, uint32_t size)
+{
+    uint64_t value;
+    uint32_t i;
+
+    value = 0;
+    for (i = 0; i < size; ++i)
+    {
+        value = (value << 8) | ptr[i];
+    }
+
+    return value;
+}
+
+/* Reads the whole capture file into memory and finds the records in it, so the file is not part of the timing */
+static int load_capture(const char *filename)
+{
+    FILE    *fp;
+    long     file_size;
+    size_t   pos;
+    size_t   header_size;
+    size_t   bundle_size;
+    uint32_t max_records;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    file_size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0)
+    {
+        file_size = ftell(fp);
+        rewind(fp);
+    }
+
+    if (file_size <= 0)
+    {
+        fprintf(stderr, "%s: empty or not a regular file\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    capture_data = malloc(file_size);
+    if (capture_data == NULL || fread(capture_data, 1, file_size, fp) != (size_t)file_size)
+    {
+        fprintf(stderr, "%s: could not read %ld bytes\n", filename, file_size);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    header_size = BPREPLAY_LENGTH_SIZE;
+    if (has_timestamps)
+    {
+        header_size += BPREPLAY_TIMESTAMP_SIZE;
+    }
+
+    /* every record is at least a header and one byte */
+    max_records = file_size / (header_size + 1);
+    records     = calloc(max_records + 1, sizeof(*records));
+    if (records == NULL)
+    {
+        return -1;
+    }
+
+    pos = 0;
+    while ((pos + header_size) <= (size_t)file_size)
+    {
+        if (has_timestamps)
+        {
+            records[num_records].capture_time_us = get_be_value(&capture_data[pos], BPREPLAY_TIMESTAMP_SIZE);
+            pos += BPREPLAY_TIMESTAMP_SIZE;
+        }
+
+        bundle_size = get_be_value(&capture_data[pos], BPREPLAY_LENGTH_SIZE);
+        pos += BPREPLAY_LENGTH_SIZE;
+        if (bundle_size == 0 || bundle_size > BPREPLAY_MAX_BUNDLE || bundle_size > ((size_t)file_size - pos))
+        {
+            fprintf(stderr, "%s: bad record length %lu at offset %lu\n", filename, (unsigned long)bundle_size,
+                    (unsigned long)(pos - BPREPLAY_LENGTH_SIZE));
+            return -1;
+        }
+
+        records[num_records].bundle = &capture_data[pos];
+        records[num_records].size   = bundle_size;
+        if (bundle_size > max_record_size)
+        {
+            max_record_size = bundle_size;
+        }
+
+        ++num_records;
+        pos += bundle_size;
+    }
+
+    if (pos != (size_t)file_size)
+    {
+        fprintf(stderr, "%s: %lu bytes left over after the last record\n", filename,
+                (unsigned long)((size_t)file_size - pos));
+    }
+
+    if (num_records == 0)
+    {
+        fprintf(stderr, "%s: no records\n", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*************************************************************************
+ * Measurement
+ *************************************************************************/
+
+static uint64_t get_time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static void add_sample(bpreplay_stage_t stage, uint64_t elapsed_ns, uint32_t num_bundles)
+{
+    bpreplay_samples_t *s;
+    uint64_t            per_bundle;
+    uint32_t            i;
+
+    s = &samples[stage];
+    s->total_ns += elapsed_ns;
+
+    /* a call that did several bundles counts as that many of the average time */
+    per_bundle = elapsed_ns / num_bundles;
+    for (i = 0; i < num_bundles && s->count < s->max_count; ++i)
+    {
+        s->ns[s->count] = per_bundle;
+        ++s->count;
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t va = *((const uint64_t *)a);
+    uint64_t vb = *((const uint64_t *)b);
+
+    return (va > vb) - (va < vb);
+}
+
+static void print_stage(bpreplay_stage_t stage)
+{
+    bpreplay_samples_t *s;
+
+    s = &samples[stage];
+    if (s->count == 0)
+    {
+        printf("%-7s no bundles\n", BPREPLAY_STAGE_NAMES[stage]);
+        return;
+    }
+
+    qsort(s->ns, s->count, sizeof(*s->ns), compare_u64);
+    printf("%-7s %9lu bundles  mean %9.2f us  p50 %9.2f us  p99 %9.2f us  max %9.2f us  total %8.3f s\n",
+           BPREPLAY_STAGE_NAMES[stage], (unsigned long)s->count, ((double)s->total_ns / (double)s->count) / 1000.0,
+           (double)s->ns[s->count / 2] / 1000.0, (double)s->ns[(s->count * 99) / 100] / 1000.0,
+           (double)s->ns[s->count - 1] / 1000.0, (double)s->total_ns / 1e9);
+}
+
+static bp_sval_t query_value(bp_handle_t intf_id, bplib_variable_t var_id)
+{
+    bp_sval_t value;
+
+    value = 0;
+    bplib_query_integer(rtbl, intf_id, var_id, &value);
+    return value;
+}
+
+static void print_job_times(const char *name, bplib_variable_t first_var)
+{
+    printf("%-8s jobs run <100us %lu  <1ms %lu  <10ms %lu  longer %lu\n", name,
+           (unsigned long)query_value(cla_in_intf, first_var), (unsigned long)query_value(cla_in_intf, first_var + 1),
+           (unsigned long)query_value(cla_in_intf, first_var + 2),
+           (unsigned long)query_value(cla_in_intf, first_var + 3));
+}
+
+static void print_report(uint64_t elapsed_ns)
+{
+    bpreplay_stage_t stage;
+    double           elapsed_sec;
+
+    elapsed_sec = (double)elapsed_ns / 1e9;
+
+    printf("\n%lu records, %lu times: %lu bundles in (%lu refused), %lu out, in %.3f s\n",
+           (unsigned long)num_records, (unsigned long)repeat_count, (unsigned long)num_ingressed,
+           (unsigned long)num_rejected, (unsigned long)num_egressed, elapsed_sec);
+    printf("in  %10.0f bundles/s %9.2f MB/s\n", (double)num_ingressed / elapsed_sec,
+           (double)bytes_ingressed / (elapsed_sec * 1e6));
+    printf("out %10.0f bundles/s %9.2f MB/s\n\n", (double)num_egressed / elapsed_sec,
+           (double)bytes_egressed / (elapsed_sec * 1e6));
+
+    for (stage = 0; stage < bpreplay_stage_max; ++stage)
+    {
+        print_stage(stage);
+    }
+
+    /* the route stage is split up by what the library counts for each kind of job */
+    printf("\n");
+    print_job_times("CLA", bplib_variable_cla_run_100us);
+    print_job_times("cache", bplib_variable_cache_run_100us);
+    print_job_times("service", bplib_variable_service_run_100us);
+
+    printf("\ndropped: %lu did not decode, %lu no route, %lu queue full, %lu expired\n",
+           (unsigned long)query_value(cla_in_intf, bplib_variable_cla_drop_decode),
+           (unsigned long)query_value(cla_in_intf, bplib_variable_cla_drop_no_route),
+           (unsigned long)(query_value(cla_in_intf, bplib_variable_cla_drop_queue_full) +
+                           query_value(cla_out_intf, bplib_variable_cla_drop_queue_full)),
+           (unsigned long)query_value(cla_out_intf, bplib_variable_cla_drop_expired));
+}
+
+/*************************************************************************
+ * Replay
+ *************************************************************************/
+
+static int setup_route_table(void)
+{
+    bp_ipn_addr_t storage_addr;
+    bp_handle_t   node_intf;
+    bp_handle_t   storage_intf;
+
+    rtbl = bplib_route_alloc_table(16, (size_t)memory_mb << 20);
+    if (rtbl == NULL)
+    {
+        fprintf(stderr, "%s(): bplib_route_alloc_table failed\n", __func__);
+        return -1;
+    }
+
+    cla_in_intf  = bplib_create_cla_intf(rtbl);
+    cla_out_intf = bplib_create_cla_intf(rtbl);
+    if (!bp_handle_is_valid(cla_in_intf) || !bp_handle_is_valid(cla_out_intf))
+    {
+        fprintf(stderr, "%s(): bplib_create_cla_intf failed\n", __func__);
+        return -1;
+    }
+
+    /* everything goes out, whatever it is addressed to */
+    if (bplib_route_add(rtbl, 0, 0, cla_out_intf) < 0 ||
+        bplib_route_intf_set_flags(rtbl, cla_in_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP) < 0 ||
+        bplib_route_intf_set_flags(rtbl, cla_out_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP) < 0)
+    {
+        fprintf(stderr, "%s(): setting up the CLA interfaces failed\n", __func__);
+        return -1;
+    }
+
+    if (storage_node != 0)
+    {
+        /* the CLA route comes first, so only the bundles that have to be stored go to the storage */
+        storage_addr = (bp_ipn_addr_t) {storage_node, BPREPLAY_STORAGE_SERVICENUM};
+        node_intf    = bplib_create_node_intf(rtbl, storage_node);
+        storage_intf = BP_INVALID_HANDLE;
+        if (bp_handle_is_valid(node_intf))
+        {
+            storage_intf = bplib_create_ram_storage(rtbl, &storage_addr);
+        }
+        if (!bp_handle_is_valid(storage_intf) || bplib_route_add(rtbl, 0, 0, storage_intf) < 0 ||
+            bplib_route_intf_set_flags(rtbl, node_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP) < 0 ||
+            bplib_route_intf_set_flags(rtbl, storage_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP) < 0)
+        {
+            fprintf(stderr, "%s(): setting up the storage failed\n", __func__);
+            return -1;
+        }
+    }
+
+    /* the interfaces come up in the first maintenance cycle */
+    bplib_route_periodic_maintenance(rtbl);
+    next_maint_time = bplib_os_get_dtntime_ms() + BPREPLAY_MAINT_INTERVAL_MSEC;
+
+    return 0;
+}
+
+/* Runs the flows, then takes out whatever bundles are ready, timing each stage, returns the number taken out */
+static uint32_t run_stages(uint32_t num_in)
+{
+    uint64_t start_time;
+    uint64_t end_time;
+    uint32_t num_out;
+    size_t   size;
+    int      status;
+
+    if (bplib_os_get_dtntime_ms() >= next_maint_time)
+    {
+        bplib_route_periodic_maintenance(rtbl);
+        next_maint_time = bplib_os_get_dtntime_ms() + BPREPLAY_MAINT_INTERVAL_MSEC;
+    }
+
+    start_time = get_time_ns();
+    bplib_route_process_active_flows(rtbl);
+    end_time = get_time_ns();
+    if (num_in > 0)
+    {
+        add_sample(bpreplay_stage_route, end_time - start_time, num_in);
+    }
+
+    num_out = 0;
+    while (true)
+    {
+        size       = egress_buffer_size;
+        start_time = get_time_ns();
+        status     = bplib_cla_egress(rtbl, cla_out_intf, egress_buffer, &size, 0);
+        end_time   = get_time_ns();
+        if (status != BP_SUCCESS)
+        {
+            break;
+        }
+
+        add_sample(bpreplay_stage_egress, end_time - start_time, 1);
+        ++num_out;
+        ++num_egressed;
+        bytes_egressed += size;
+    }
+
+    return num_out;
+}
+
+/* With original timing, waits until the capture time of the record, relative to the first */
+static void wait_for_record(const bpreplay_record_t *rec, uint64_t replay_start_ns)
+{
+    struct timespec tm;
+    uint64_t        due_ns;
+
+    due_ns = replay_start_ns + (uint64_t)((double)(rec->capture_time_us - records[0].capture_time_us) * 1000.0 /
+                                          timing_speed);
+    if (rec->capture_time_us < records[0].capture_time_us || due_ns <= get_time_ns())
+    {
+        return;
+    }
+
+    tm.tv_sec  = due_ns / 1000000000;
+    tm.tv_nsec = due_ns % 1000000000;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tm, NULL);
+}
+
+static void replay(void)
+{
+    const bpreplay_record_t *rec;
+    uint64_t                 replay_start_ns;
+    uint64_t                 start_time;
+    uint64_t                 end_time;
+    uint64_t                 drain_limit;
+    uint32_t                 num_in;
+    uint32_t                 r;
+    uint32_t                 i;
+    int                      status;
+
+    for (r = 0; r < repeat_count; ++r)
+    {
+        replay_start_ns = get_time_ns();
+        num_in          = 0;
+        for (i = 0; i < num_records; ++i)
+        {
+            rec = &records[i];
+            if (original_timing)
+            {
+                wait_for_record(rec, replay_start_ns);
+            }
+
+            start_time = get_time_ns();
+            status     = bplib_cla_ingress(rtbl, cla_in_intf, rec->bundle, rec->size, 0);
+            end_time   = get_time_ns();
+            if (status == BP_SUCCESS)
+            {
+                add_sample(bpreplay_stage_decode, end_time - start_time, 1);
+                ++num_ingressed;
+                ++num_in;
+                bytes_ingressed += rec->size;
+            }
+            else
+            {
+                ++num_rejected;
+            }
+
+            /* with original timing the bundles go on as they come, there is no point in holding them */
+            if (num_in >= batch_size || original_timing)
+            {
+                run_stages(num_in);
+                num_in = 0;
+            }
+        }
+
+        if (num_in > 0)
+        {
+            run_stages(num_in);
+        }
+    }
+
+    /* whatever the storage or a queue still has is let out, so nothing is missed from the counts */
+    drain_limit = bplib_os_get_dtntime_ms() + BPREPLAY_DRAIN_MSEC;
+    while (bplib_os_get_dtntime_ms() < drain_limit)
+    {
+        bplib_route_periodic_maintenance(rtbl);
+        if (run_stages(0) > 0)
+        {
+            drain_limit = bplib_os_get_dtntime_ms() + BPREPLAY_DRAIN_MSEC;
+        }
+        else
+        {
+            bplib_route_wait_until(rtbl, bplib_os_get_dtntime_ms() + 10);
+        }
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    bpreplay_stage_t stage;
+    uint64_t         start_time;
+    uint64_t         max_bundles;
+
+    if (bplib_init() != 0)
+    {
+        fprintf(stderr, "Failed bplib_init()... exiting\n");
+        return EXIT_FAILURE;
+    }
+
+    parse_options(argc, argv);
+
+    if (load_capture(capture_filename) < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* a bundle can come out bigger than it went in, with extension blocks added on the way */
+    egress_buffer_size = max_record_size + 1024;
+    egress_buffer      = malloc(egress_buffer_size);
+
+    /* the storage can make more bundles than went in, in custody signals, those are not all kept */
+    max_bundles = (uint64_t)num_records * repeat_count;
+    for (stage = 0; stage < bpreplay_stage_max; ++stage)
+    {
+        samples[stage].max_count = max_bundles;
+        samples[stage].ns        = malloc(max_bundles * sizeof(uint64_t));
+        if (samples[stage].ns == NULL)
+        {
+            fprintf(stderr, "Could not allocate memory for %lu samples\n", (unsigned long)max_bundles);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (egress_buffer == NULL || setup_route_table() < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "Replaying %lu records from %s\n", (unsigned long)num_records, capture_filename);
+
+    start_time = get_time_ns();
+    replay();
+    print_report(get_time_ns() - start_time);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,740 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+/* clock_gettime() and clock_nanosleep() are POSIX */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+#include "v7_mpool.h"
+
+/*
+ * This is the missed contact scenario of binding/lua/analysis/pf_missed_contact.lua, for the
+ * v7 routing and cache stack.  A spacecraft node stores an orbit of bundles, then has a contact
+ * with a ground node in which the ground never gets anything (so nothing is acknowledged), then
+ * two more orbits each followed by a contact in which bundles and custody signals go both ways.
+ *
+ * Both nodes are in this process, each with its own route table, and this program is the link
+ * between their CLA interfaces.  Everything runs on one thread in ticks of BPSCENARIO_TICK_MSEC,
+ * and the link lets through only as many bundles per tick as the link rate allows.
+ */
+#define BPSCENARIO_TICK_MSEC 10
+
+#define BPSCENARIO_SPACE_NODE  100
+#define BPSCENARIO_GROUND_NODE 200
+#define BPSCENARIO_SERVICE     1
+#define BPSCENARIO_STORAGE_SVC 10
+
+/* the bundle sequence number goes at the start of each payload */
+#define BPSCENARIO_SEQ_SIZE 8
+#define BPSCENARIO_MAX_SIZE 65536
+
+/* sockets resend a bundle which was not acknowledged after this long */
+#define BPSCENARIO_SOCKET_RETX_MSEC 30000
+
+#define BPSCENARIO_MAX_PHASES 8
+
+typedef enum bpscenario_link
+{
+    bpscenario_link_none, /* no contact, the CLAs are down */
+    bpscenario_link_lost, /* the spacecraft sends, but nothing reaches the ground */
+    bpscenario_link_bidir /* bundles go down and custody signals come back */
+} bpscenario_link_t;
+
+typedef struct bpscenario_node
+{
+    bplib_routetbl_t *rtbl;
+    bp_handle_t       cla_intf;
+    bp_socket_t      *sock;
+} bpscenario_node_t;
+
+typedef struct bpscenario_phase
+{
+    const char       *name;
+    bpscenario_link_t link;
+    uint64_t          start_us;
+    uint64_t          duration_us;
+    uint64_t          sent;
+    uint64_t          send_failed;
+    uint64_t          downlinked; /* bundles the spacecraft CLA sent */
+    uint64_t          lost;       /* of those, the ones that never got to the ground */
+    uint64_t          delivered;  /* bundles the ground application received, not counting duplicates */
+    uint64_t          duplicates;
+    uint64_t          delivered_bytes;
+    uint64_t          custody_signals;
+    size_t            space_mem_max_use;
+    size_t            ground_mem_max_use;
+    size_t            space_mem_current_use;
+    size_t            ground_mem_current_use;
+} bpscenario_phase_t;
+
+typedef struct bpscenario_latency
+{
+    uint64_t *us;
+    uint64_t  count;
+    uint64_t  max_count;
+    uint64_t  total_us;
+} bpscenario_latency_t;
+
+static uint32_t    orbit_bundles = 2650;
+static uint32_t    link_rate     = 1000; /* bundles per second */
+static uint32_t    contact_msec  = 5000;
+static uint32_t    gap_msec      = BPSCENARIO_SOCKET_RETX_MSEC + 1000;
+static uint32_t    payload_size  = 64;
+static uint32_t    memory_mb     = 64;
+static const char *output_name;
+
+static bpscenario_node_t space;
+static bpscenario_node_t ground;
+
+static bpscenario_phase_t phases[BPSCENARIO_MAX_PHASES];
+static uint32_t           num_phases;
+static uint64_t           scenario_start_us;
+
+/* indexed by sequence number */
+static uint64_t *send_time_us;
+static bool     *is_delivered;
+static uint64_t  next_seq;
+
+/* sequence numbers delivered on the ground since the last custody signal came up */
+static uint64_t *unacked_seq;
+static uint64_t  num_unacked;
+
+static bpscenario_latency_t delivery_latency;
+static bpscenario_latency_t custody_latency;
+
+static uint8_t payload_buffer[BPSCENARIO_MAX_SIZE];
+static uint8_t bundle_buffer[BPSCENARIO_MAX_SIZE];
+
+/*************************************************************************
+ * Options
+ *************************************************************************/
+
+static void display_usage(const char *prog_name)
+{
+    fprintf(stderr, "Usage: %s [options]\n", prog_name);
+    fprintf(stderr, "   -b/--orbit-bundles=<n> bundles stored in each orbit (default 2650)\n");
+    fprintf(stderr, "   -r/--rate=<n> link rate in bundles per second during a contact (default 1000)\n");
+    fprintf(stderr, "   -c/--contact=<ms> length of each contact (default 5000)\n");
+    fprintf(stderr, "   -g/--gap=<ms> wait before the second and third contacts (default %u, one second more\n",
+            BPSCENARIO_SOCKET_RETX_MSEC + 1000);
+    fprintf(stderr, "      than sockets wait to resend, so the bundles lost in the first contact are resent)\n");
+    fprintf(stderr, "   -s/--size=<bytes> payload size (default 64, min %u)\n", BPSCENARIO_SEQ_SIZE);
+    fprintf(stderr, "   -m/--memory=<MB> memory pool size of each node (default 64)\n");
+    fprintf(stderr, "   -o/--output=<file> write the JSON results to a file instead of stdout\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "   Runs the missed contact scenario between a spacecraft node and a ground node in\n");
+    fprintf(stderr, "   this process, and writes the results as one JSON object: per phase bundle counts\n");
+    fprintf(stderr, "   and throughput, memory pool high water marks, and delivery and custody latency.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Example:\n");
+    fprintf(stderr, "   %s -b 10000 -r 5000 -o results.json\n\n", prog_name);
+
+    exit(-1);
+}
+
+static void parse_options(int argc, char *argv[])
+{
+    static const struct option long_opts[] = {{"orbit-bundles", required_argument, NULL, 'b'},
+                                              {"rate", required_argument, NULL, 'r'},
+                                              {"contact", required_argument, NULL, 'c'},
+                                              {"gap", required_argument, NULL, 'g'},
+                                              {"size", required_argument, NULL, 's'},
+                                              {"memory", required_argument, NULL, 'm'},
+                                              {"output", required_argument, NULL, 'o'},
+                                              {"help", no_argument, NULL, 'h'},
+                                              {NULL}};
+    int                        opt;
+
+    while ((opt = getopt_long(argc, argv, "b:r:c:g:s:m:o:h", long_opts, NULL)) >= 0)
+    {
+        switch (opt)
+        {
+            case 'b':
+                orbit_bundles = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                link_rate = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                contact_msec = strtoul(optarg, NULL, 0);
+                break;
+            case 'g':
+                gap_msec = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                payload_size = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                memory_mb = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                output_name = optarg;
+                break;
+            default:
+                display_usage(argv[0]);
+                break;
+        }
+    }
+
+    if (optind != argc || orbit_bundles < 1 || link_rate < 1 || memory_mb < 1 || payload_size < BPSCENARIO_SEQ_SIZE ||
+        payload_size > BPSCENARIO_MAX_SIZE / 2)
+    {
+        display_usage(argv[0]);
+    }
+}
+
+/*************************************************************************
+ * Measurement
+ *************************************************************************/
+
+static uint64_t get_time_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000);
+}
+
+static void put_seq(uint8_t *ptr, uint64_t seq)
+{
+    uint32_t i;
+
+    for (i = 0; i < BPSCENARIO_SEQ_SIZE; ++i)
+    {
+        ptr[BPSCENARIO_SEQ_SIZE - 1 - i] = (uint8_t)(seq >> (8 * i));
+    }
+}
+
+static uint64_t get_seq(const uint8_t *ptr)
+{
+    uint64_t seq;
+    uint32_t i;
+
+    seq = 0;
+    for (i = 0; i < BPSCENARIO_SEQ_SIZE; ++i)
+    {
+        seq = (seq << 8) | ptr[i];
+    }
+
+    return seq;
+}
+
+static void add_latency(bpscenario_latency_t *lat, uint64_t us)
+{
+    lat->total_us += us;
+    if (lat->count < lat->max_count)
+    {
+        lat->us[lat->count] = us;
+        ++lat->count;
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t va = *((const uint64_t *)a);
+    uint64_t vb = *((const uint64_t *)b);
+
+    return (va > vb) - (va < vb);
+}
+
+static void record_memory(bpscenario_phase_t *phase)
+{
+    bplib_mpool_t *pool;
+
+    pool                          = bplib_route_get_mpool(space.rtbl);
+    phase->space_mem_max_use      = bplib_mpool_query_mem_max_use(pool);
+    phase->space_mem_current_use  = bplib_mpool_query_mem_current_use(pool);
+    pool                          = bplib_route_get_mpool(ground.rtbl);
+    phase->ground_mem_max_use     = bplib_mpool_query_mem_max_use(pool);
+    phase->ground_mem_current_use = bplib_mpool_query_mem_current_use(pool);
+}
+
+/*************************************************************************
+ * Nodes
+ *************************************************************************/
+
+static int setup_node(bpscenario_node_t *node, bp_ipn_t node_num, bp_ipn_t peer_num)
+{
+    bp_ipn_addr_t storage_addr;
+    bp_ipn_addr_t addr;
+    bp_handle_t   node_intf;
+    bp_handle_t   storage_intf;
+
+    node->rtbl = bplib_route_alloc_table(16, (size_t)memory_mb << 20);
+    if (node->rtbl == NULL)
+    {
+        fprintf(stderr, "%s(): bplib_route_alloc_table failed\n", __func__);
+        return -1;
+    }
+
+    /* as in the sanity test, everything is stored, and bundles for the peer go out the CLA */
+    storage_addr   = (bp_ipn_addr_t) {node_num, BPSCENARIO_STORAGE_SVC};
+    node_intf      = bplib_create_node_intf(node->rtbl, node_num);
+    storage_intf   = bplib_create_ram_storage(node->rtbl, &storage_addr);
+    node->cla_intf = bplib_create_cla_intf(node->rtbl);
+    if (!bp_handle_is_valid(node_intf) || !bp_handle_is_valid(storage_intf) || !bp_handle_is_valid(node->cla_intf))
+    {
+        fprintf(stderr, "%s(): creating the interfaces of node %lu failed\n", __func__, (unsigned long)node_num);
+        return -1;
+    }
+
+    if (bplib_route_add(node->rtbl, 0, 0, storage_intf) < 0 ||
+        bplib_route_add(node->rtbl, peer_num, ~(bp_ipn_t)0, node->cla_intf) < 0 ||
+        bplib_route_intf_set_flags(node->rtbl, node_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP) < 0 ||
+        bplib_route_intf_set_flags(node->rtbl, storage_intf,
+                                   BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP) < 0 ||
+        bplib_route_intf_set_flags(node->rtbl, node->cla_intf, BPLIB_INTF_STATE_ADMIN_UP) < 0)
+    {
+        fprintf(stderr, "%s(): setting up the routes of node %lu failed\n", __func__, (unsigned long)node_num);
+        return -1;
+    }
+
+    node->sock = bplib_create_socket(node->rtbl);
+    if (node->sock == NULL)
+    {
+        fprintf(stderr, "%s(): bplib_create_socket failed\n", __func__);
+        return -1;
+    }
+
+    addr = (bp_ipn_addr_t) {node_num, BPSCENARIO_SERVICE};
+    if (bplib_bind_socket(node->sock, &addr) < 0)
+    {
+        return -1;
+    }
+
+    addr = (bp_ipn_addr_t) {peer_num, BPSCENARIO_SERVICE};
+    if (bplib_connect_socket(node->sock, &addr) < 0)
+    {
+        return -1;
+    }
+
+    bplib_route_periodic_maintenance(node->rtbl);
+
+    return 0;
+}
+
+static void set_link(bpscenario_link_t link)
+{
+    if (link == bpscenario_link_none)
+    {
+        bplib_route_intf_unset_flags(space.rtbl, space.cla_intf, BPLIB_INTF_STATE_OPER_UP);
+        bplib_route_intf_unset_flags(ground.rtbl, ground.cla_intf, BPLIB_INTF_STATE_OPER_UP);
+    }
+    else
+    {
+        bplib_route_intf_set_flags(space.rtbl, space.cla_intf, BPLIB_INTF_STATE_OPER_UP);
+        bplib_route_intf_set_flags(ground.rtbl, ground.cla_intf, BPLIB_INTF_STATE_OPER_UP);
+    }
+}
+
+static void run_flows(void)
+{
+    bplib_route_process_active_flows(space.rtbl);
+    bplib_route_process_active_flows(ground.rtbl);
+}
+
+/*************************************************************************
+ * Phases
+ *************************************************************************/
+
+static bpscenario_phase_t *begin_phase(const char *name, bpscenario_link_t link)
+{
+    bpscenario_phase_t *phase;
+
+    fprintf(stderr, "%s\n", name);
+
+    phase           = &phases[num_phases];
+    phase->name     = name;
+    phase->link     = link;
+    phase->start_us = get_time_us();
+    ++num_phases;
+
+    set_link(link);
+
+    return phase;
+}
+
+static void end_phase(bpscenario_phase_t *phase)
+{
+    phase->duration_us = get_time_us() - phase->start_us;
+    record_memory(phase);
+}
+
+/* Stores an orbit of bundles on the spacecraft, with the link down */
+static void run_orbit(const char *name)
+{
+    bpscenario_phase_t *phase;
+    uint32_t            i;
+    int                 status;
+
+    phase = begin_phase(name, bpscenario_link_none);
+
+    memset(payload_buffer, 0, payload_size);
+    for (i = 0; i < orbit_bundles; ++i)
+    {
+        put_seq(payload_buffer, next_seq);
+
+        /* one thread does everything, so the socket queue has to be drained here when it is full */
+        status = bplib_send(space.sock, payload_buffer, payload_size, 0);
+        if (status != BP_SUCCESS)
+        {
+            run_flows();
+            status = bplib_send(space.sock, payload_buffer, payload_size, 0);
+        }
+
+        if (status != BP_SUCCESS)
+        {
+            ++phase->send_failed;
+            continue;
+        }
+
+        send_time_us[next_seq] = get_time_us();
+        ++next_seq;
+        ++phase->sent;
+
+        run_flows();
+    }
+
+    bplib_route_periodic_maintenance(space.rtbl);
+    run_flows();
+
+    end_phase(phase);
+}
+
+/* Takes in what the ground application received, returns when nothing more is waiting */
+static void receive_ground(bpscenario_phase_t *phase)
+{
+    size_t   size;
+    uint64_t seq;
+    uint64_t now;
+
+    while (true)
+    {
+        size = sizeof(payload_buffer);
+        if (bplib_recv(ground.sock, payload_buffer, &size, 0) != BP_SUCCESS)
+        {
+            break;
+        }
+
+        if (size < BPSCENARIO_SEQ_SIZE)
+        {
+            continue;
+        }
+
+        seq = get_seq(payload_buffer);
+        if (seq >= next_seq)
+        {
+            continue;
+        }
+
+        if (is_delivered[seq])
+        {
+            ++phase->duplicates;
+            continue;
+        }
+
+        now               = get_time_us();
+        is_delivered[seq] = true;
+        ++phase->delivered;
+        phase->delivered_bytes += size;
+        add_latency(&delivery_latency, now - send_time_us[seq]);
+
+        unacked_seq[num_unacked] = seq;
+        ++num_unacked;
+    }
+}
+
+/*
+ * The ground application sends nothing, so every bundle that comes up is a custody signal.
+ * The custody latency of a bundle is counted from when it was sent to when the first custody
+ * signal after its delivery gets to the spacecraft.
+ */
+static void custody_signal_arrived(void)
+{
+    uint64_t now;
+    uint64_t i;
+
+    now = get_time_us();
+    for (i = 0; i < num_unacked; ++i)
+    {
+        add_latency(&custody_latency, now - send_time_us[unacked_seq[i]]);
+    }
+    num_unacked = 0;
+}
+
+/* Runs in ticks for the given time, moving bundles over the link as it allows */
+static void run_ticks(bpscenario_phase_t *phase, uint32_t duration_msec)
+{
+    struct timespec next_tick;
+    uint64_t        end_us;
+    uint64_t        tick_us;
+    uint64_t        credit_milli;
+    size_t          size;
+
+    end_us       = phase->start_us + ((uint64_t)duration_msec * 1000);
+    tick_us      = phase->start_us;
+    credit_milli = 0;
+
+    while (get_time_us() < end_us)
+    {
+        bplib_route_periodic_maintenance(space.rtbl);
+        bplib_route_periodic_maintenance(ground.rtbl);
+        run_flows();
+
+        if (phase->link != bpscenario_link_none)
+        {
+            /* the link rate is in bundles per second, kept in thousandths so low rates still move */
+            credit_milli += (uint64_t)link_rate * BPSCENARIO_TICK_MSEC;
+            while (credit_milli >= 1000)
+            {
+                size = sizeof(bundle_buffer);
+                if (bplib_cla_egress(space.rtbl, space.cla_intf, bundle_buffer, &size, 0) != BP_SUCCESS)
+                {
+                    /* an idle link does not save up its rate */
+                    credit_milli = 0;
+                    break;
+                }
+
+                credit_milli -= 1000;
+                ++phase->downlinked;
+                if (phase->link == bpscenario_link_bidir)
+                {
+                    bplib_cla_ingress(ground.rtbl, ground.cla_intf, bundle_buffer, size, 0);
+                }
+                else
+                {
+                    ++phase->lost;
+                }
+            }
+
+            run_flows();
+            receive_ground(phase);
+
+            /* custody signals are few and small, they are not held to the link rate */
+            while (true)
+            {
+                size = sizeof(bundle_buffer);
+                if (bplib_cla_egress(ground.rtbl, ground.cla_intf, bundle_buffer, &size, 0) != BP_SUCCESS)
+                {
+                    break;
+                }
+
+                if (phase->link == bpscenario_link_bidir)
+                {
+                    bplib_cla_ingress(space.rtbl, space.cla_intf, bundle_buffer, size, 0);
+                    ++phase->custody_signals;
+                    custody_signal_arrived();
+                }
+            }
+
+            run_flows();
+        }
+
+        tick_us += BPSCENARIO_TICK_MSEC * 1000;
+        next_tick.tv_sec  = tick_us / 1000000;
+        next_tick.tv_nsec = (tick_us % 1000000) * 1000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_tick, NULL);
+    }
+}
+
+static void run_contact(const char *name, bpscenario_link_t link)
+{
+    bpscenario_phase_t *phase;
+
+    phase = begin_phase(name, link);
+    run_ticks(phase, contact_msec);
+    end_phase(phase);
+}
+
+static void run_gap(const char *name)
+{
+    bpscenario_phase_t *phase;
+
+    if (gap_msec == 0)
+    {
+        return;
+    }
+
+    phase = begin_phase(name, bpscenario_link_none);
+    run_ticks(phase, gap_msec);
+    end_phase(phase);
+}
+
+/*************************************************************************
+ * Output
+ *************************************************************************/
+
+static void write_latency(FILE *fp, const char *name, bpscenario_latency_t *lat, bool last)
+{
+    fprintf(fp, "  \"%s\": {", name);
+    if (lat->count == 0)
+    {
+        fprintf(fp, "\"count\": 0}%s\n", last ? "" : ",");
+        return;
+    }
+
+    qsort(lat->us, lat->count, sizeof(*lat->us), compare_u64);
+    fprintf(fp, "\"count\": %lu, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f}%s\n",
+            (unsigned long)lat->count, ((double)lat->total_us / (double)lat->count) / 1000.0,
+            (double)lat->us[lat->count / 2] / 1000.0, (double)lat->us[(lat->count * 99) / 100] / 1000.0,
+            (double)lat->us[lat->count - 1] / 1000.0, last ? "" : ",");
+}
+
+static void write_results(FILE *fp)
+{
+    static const char *const LINK_NAMES[] = {"none", "lost", "bidirectional"};
+
+    const bpscenario_phase_t *phase;
+    uint64_t                  total_us;
+    uint64_t                  total_delivered;
+    uint32_t                  i;
+    double                    sec;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"scenario\": \"missed_contact\",\n");
+    fprintf(fp,
+            "  \"parameters\": {\"orbit_bundles\": %lu, \"link_rate\": %lu, \"contact_ms\": %lu, \"gap_ms\": %lu, "
+            "\"payload_size\": %lu, \"pool_size\": %lu},\n",
+            (unsigned long)orbit_bundles, (unsigned long)link_rate, (unsigned long)contact_msec,
+            (unsigned long)gap_msec, (unsigned long)payload_size, (unsigned long)memory_mb << 20);
+
+    fprintf(fp, "  \"phases\": [\n");
+    total_delivered = 0;
+    for (i = 0; i < num_phases; ++i)
+    {
+        phase = &phases[i];
+        sec   = (double)phase->duration_us / 1e6;
+        total_delivered += phase->delivered;
+
+        fprintf(fp,
+                "    {\"name\": \"%s\", \"link\": \"%s\", \"start_ms\": %.1f, \"duration_ms\": %.1f, \"sent\": %lu, "
+                "\"send_failed\": %lu, \"downlinked\": %lu, \"lost\": %lu, \"delivered\": %lu, \"duplicates\": %lu, "
+                "\"custody_signals\": %lu, \"delivered_per_sec\": %.1f, \"delivered_bytes_per_sec\": %.1f, "
+                "\"space_mem_max_use\": %lu, \"space_mem_current_use\": %lu, \"ground_mem_max_use\": %lu, "
+                "\"ground_mem_current_use\": %lu}%s\n",
+                phase->name, LINK_NAMES[phase->link], (double)(phase->start_us - scenario_start_us) / 1000.0,
+                (double)phase->duration_us / 1000.0, (unsigned long)phase->sent, (unsigned long)phase->send_failed,
+                (unsigned long)phase->downlinked, (unsigned long)phase->lost, (unsigned long)phase->delivered,
+                (unsigned long)phase->duplicates, (unsigned long)phase->custody_signals,
+                (double)phase->delivered / sec, (double)phase->delivered_bytes / sec,
+                (unsigned long)phase->space_mem_max_use, (unsigned long)phase->space_mem_current_use,
+                (unsigned long)phase->ground_mem_max_use, (unsigned long)phase->ground_mem_current_use,
+                (i + 1 < num_phases) ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+
+    total_us = get_time_us() - scenario_start_us;
+    fprintf(fp,
+            "  \"totals\": {\"duration_ms\": %.1f, \"sent\": %lu, \"delivered\": %lu, \"delivered_per_sec\": %.1f, "
+            "\"space_mem_max_use\": %lu, \"ground_mem_max_use\": %lu},\n",
+            (double)total_us / 1000.0, (unsigned long)next_seq, (unsigned long)total_delivered,
+            (double)total_delivered / ((double)total_us / 1e6),
+            (unsigned long)bplib_mpool_query_mem_max_use(bplib_route_get_mpool(space.rtbl)),
+            (unsigned long)bplib_mpool_query_mem_max_use(bplib_route_get_mpool(ground.rtbl)));
+
+    write_latency(fp, "delivery_latency", &delivery_latency, false);
+    write_latency(fp, "custody_latency", &custody_latency, true);
+    fprintf(fp, "}\n");
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    FILE    *fp;
+    uint64_t max_bundles;
+
+    if (bplib_init() != 0)
+    {
+        fprintf(stderr, "Failed bplib_init()... exiting\n");
+        return EXIT_FAILURE;
+    }
+
+    parse_options(argc, argv);
+
+    max_bundles                = (uint64_t)orbit_bundles * 3;
+    send_time_us               = calloc(max_bundles, sizeof(*send_time_us));
+    is_delivered               = calloc(max_bundles, sizeof(*is_delivered));
+    unacked_seq                = calloc(max_bundles, sizeof(*unacked_seq));
+    delivery_latency.us        = calloc(max_bundles, sizeof(uint64_t));
+    delivery_latency.max_count = max_bundles;
+    custody_latency.us         = calloc(max_bundles, sizeof(uint64_t));
+    custody_latency.max_count  = max_bundles;
+    if (send_time_us == NULL || is_delivered == NULL || unacked_seq == NULL || delivery_latency.us == NULL ||
+        custody_latency.us == NULL)
+    {
+        fprintf(stderr, "Could not allocate memory for %lu bundles\n", (unsigned long)max_bundles);
+        return EXIT_FAILURE;
+    }
+
+    if (setup_node(&space, BPSCENARIO_SPACE_NODE, BPSCENARIO_GROUND_NODE) < 0 ||
+        setup_node(&ground, BPSCENARIO_GROUND_NODE, BPSCENARIO_SPACE_NODE) < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    scenario_start_us = get_time_us();
+
+    run_orbit("orbit 1");
+    run_contact("missed contact 1", bpscenario_link_lost);
+    run_orbit("orbit 2");
+    run_gap("wait for retransmit 2");
+    run_contact("contact 2", bpscenario_link_bidir);
+    run_orbit("orbit 3");
+    run_gap("wait for retransmit 3");
+    run_contact("contact 3", bpscenario_link_bidir);
+
+    fp = stdout;
+    if (output_name != NULL)
+    {
+        fp = fopen(output_name, "w");
+        if (fp == NULL)
+        {
+            perror(output_name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    write_results(fp);
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -59,34 +59,35 @@ perf:write('time,bidir,new,retran,ack,bundles,bid\n')
 
 bundle_id = 0
 
+-- bundles are loaded into reusable buffers, and passed on from them --
+local bundle_buffer_size = 4096
+local bundles = {}
+for j=1,bundle_tx_rate do
+	bundles[j] = bplib.buffer(bundle_buffer_size)
+end
+local payloads = {}
+
 local function simulate_back_orbit() 
+	local orbit_payloads = {}
 	for i=1,bundles_per_orbit do
-		payload = string.format('%d', bundle_id)
-		rc, flags = sender:store(payload, 0)
+		orbit_payloads[i] = string.format('%d', bundle_id)
 		bundle_id = bundle_id + 1
 	end
+	count, flags = sender:store_batch(orbit_payloads, 0)
 end
 
 local function simulate_contact(bidirectional)
 	now = os.time()
 	for i=1,contact_time do
         smallest_bundle_id = bundle_id
-		for j=1,bundle_tx_rate do
-			rc, bundle, flags = sender:load(0)
-			if bundle then
-				if bidirectional then
-					rc, flags = receiver:process(bundle, 0)
-					rc, payload, flags = receiver:accept(0)
-				else
-					rc, flags = bitbucket:process(bundle, 0)
-					rc, payload, flags = bitbucket:accept(0)
-				end
-				if payload then
-					payload_bundle_id = tonumber(payload)
-					if payload_bundle_id < smallest_bundle_id then 
-						smallest_bundle_id = payload_bundle_id
-					end
-				end
+		num_loaded, flags = sender:load_batch(bundles, bundle_tx_rate, 0)
+		local target = bidirectional and receiver or bitbucket
+		num_processed, flags = target:process_batch(bundles, 0, num_loaded)
+		num_accepted, flags = target:accept_batch(payloads, num_processed, 0)
+		for j=1,num_accepted do
+			payload_bundle_id = tonumber(payloads[j])
+			if payload_bundle_id < smallest_bundle_id then 
+				smallest_bundle_id = payload_bundle_id
 			end
 		end
 
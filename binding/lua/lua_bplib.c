@@ -46,6 +46,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <string.h>
 #include <errno.h>
 #include <ctype.h>
 #include <assert.h>
@@ -66,6 +67,14 @@ typedef struct
     bp_desc_t *desc;
 } lbplib_user_data_t;
 
+/* reusable bundle/payload buffer, so that data can be passed without making a Lua string each time */
+typedef struct
+{
+    size_t size;   /* capacity of data */
+    size_t length; /* number of bytes of data currently held */
+    char   data[];
+} lbplib_buffer_t;
+
 typedef struct
 {
     const char *name;
@@ -90,6 +99,7 @@ int lbplib_sleep(lua_State *L);
 int lbplib_flashsim(lua_State *L);
 int lbplib_memstat(lua_State *L);
 int lbplib_shutdown(lua_State *L);
+int lbplib_buffer(lua_State *L);
 
 /* Bundle Protocol Meta Functions */
 int lbplib_delete(lua_State *L);
@@ -101,6 +111,16 @@ int lbplib_load(lua_State *L);
 int lbplib_process(lua_State *L);
 int lbplib_accept(lua_State *L);
 int lbplib_flush(lua_State *L);
+int lbplib_store_batch(lua_State *L);
+int lbplib_load_batch(lua_State *L);
+int lbplib_process_batch(lua_State *L);
+int lbplib_accept_batch(lua_State *L);
+
+/* Bundle Protocol Buffer Meta Functions */
+int lbplib_buffer_len(lua_State *L);
+int lbplib_buffer_size(lua_State *L);
+int lbplib_buffer_tostring(lua_State *L);
+int lbplib_buffer_set(lua_State *L);
 
 /* Storage Service Initialization Functions */
 static void local_store_ram_init(void);
@@ -114,6 +134,7 @@ static void local_store_flash_deinit(void);
 
 /* Lua Environment Variables */
 static const char *LUA_BPLIBMETANAME = "Lua.bplib";
+static const char *LUA_BUFFERMETANAME = "Lua.bplib.buffer";
 static const char *LUA_ERRNO         = "errno";
 
 /* Lua Bplib Library Functions */
@@ -127,6 +148,7 @@ static const struct luaL_Reg lbplib_functions[] = {{"open", lbplib_open},
                                                    {"flashsim", lbplib_flashsim},
                                                    {"memstat", lbplib_memstat},
                                                    {"shutdown", lbplib_shutdown},
+                                                   {"buffer", lbplib_buffer},
                                                    {NULL, NULL}};
 
 /* Lua Bplib Channel Meta Data */
@@ -138,10 +160,23 @@ static const struct luaL_Reg lbplib_metadata[] = {{"getopt", lbplib_getopt},
                                                   {"process", lbplib_process},
                                                   {"accept", lbplib_accept},
                                                   {"flush", lbplib_flush},
+                                                  {"store_batch", lbplib_store_batch},
+                                                  {"load_batch", lbplib_load_batch},
+                                                  {"process_batch", lbplib_process_batch},
+                                                  {"accept_batch", lbplib_accept_batch},
                                                   {"close", lbplib_delete},
                                                   {"__gc", lbplib_delete},
                                                   {NULL, NULL}};
 
+/* Lua Bplib Buffer Meta Data */
+static const struct luaL_Reg lbplib_buffer_metadata[] = {{"len", lbplib_buffer_len},
+                                                         {"size", lbplib_buffer_size},
+                                                         {"tostring", lbplib_buffer_tostring},
+                                                         {"set", lbplib_buffer_set},
+                                                         {"__len", lbplib_buffer_len},
+                                                         {"__tostring", lbplib_buffer_tostring},
+                                                         {NULL, NULL}};
+
 /* Lua Bplib Storage Services */
 static lbplib_store_t lbplib_stores[] = {{.name        = "RAM",
                                           .initialized = false,
@@ -371,6 +406,217 @@ static void local_store_flash_deinit(void)
     bplib_store_flash_uninit();
 }
 
+/*----------------------------------------------------------------------------
+ * check_data - returns the bytes of the string or buffer at index, or NULL if it is neither
+ *----------------------------------------------------------------------------*/
+static const char *check_data(lua_State *L, int index, size_t *size)
+{
+    lbplib_buffer_t *buffer;
+
+    if (lua_isstring(L, index))
+    {
+        return lua_tolstring(L, index, size);
+    }
+
+    buffer = (lbplib_buffer_t *)luaL_testudata(L, index, LUA_BUFFERMETANAME);
+    if (buffer != NULL)
+    {
+        *size = buffer->length;
+        return buffer->data;
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * put_data - sets entry i of the table at index to the data
+ *
+ *  A buffer already in that entry is filled in place, otherwise (or if the
+ *  buffer is too small) the entry is set to a new string holding the data
+ *----------------------------------------------------------------------------*/
+static void put_data(lua_State *L, int index, int i, const char *data, size_t size)
+{
+    lua_rawgeti(L, index, i);
+    lbplib_buffer_t *buffer = (lbplib_buffer_t *)luaL_testudata(L, -1, LUA_BUFFERMETANAME);
+    lua_pop(L, 1);
+
+    if (buffer != NULL && buffer->size >= size)
+    {
+        memcpy(buffer->data, data, size);
+        buffer->length = size;
+    }
+    else
+    {
+        lua_pushlstring(L, data, size);
+        lua_rawseti(L, index, i);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * batch_submit - body of channel:store_batch() and channel:process_batch()
+ *
+ *  Each entry is passed on in turn, stopping at the first one which fails.
+ *  The flags of all of them are combined into one table.
+ *----------------------------------------------------------------------------*/
+static int batch_submit(lua_State *L, bool process)
+{
+    /* Get User Data */
+    lbplib_user_data_t *bplib_data = (lbplib_user_data_t *)luaL_checkudata(L, 1, LUA_BPLIBMETANAME);
+    if (!bplib_data)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_BPLIBMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Check Number of Parameters */
+    int numargs = lua_gettop(L);
+    if (numargs < 3 || numargs > 4)
+    {
+        lualog("incorrect number of parameters - expected 3 or 4\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Type Check Parameters */
+    if (!lua_istable(L, 2) || !lua_isnumber(L, 3) || (numargs == 4 && !lua_isnumber(L, 4)))
+    {
+        lualog("incorrect parameter types\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Submit Each Entry */
+    uint32_t batchflags = 0;
+    int      timeout    = (int)lua_tonumber(L, 3);
+    int      count      = (numargs == 4) ? (int)lua_tonumber(L, 4) : (int)lua_rawlen(L, 2);
+    int      num_done   = 0;
+    int      status     = BP_SUCCESS;
+    int      i;
+    for (i = 1; i <= count && status == BP_SUCCESS; i++)
+    {
+        uint32_t    flags = 0;
+        size_t      size  = 0;
+        const char *data;
+
+        lua_rawgeti(L, 2, i);
+        data = check_data(L, -1, &size);
+        if (data == NULL)
+        {
+            lualog("entry %d is not a string or buffer\n", i);
+            status = BP_ERROR;
+        }
+        else if (process)
+        {
+            status = bplib_process(bplib_data->desc, (void *)data, (int)size, timeout, &flags);
+        }
+        else
+        {
+            status = bplib_store(bplib_data->desc, (void *)data, (int)size, timeout, &flags);
+        }
+        lua_pop(L, 1);
+
+        batchflags |= flags;
+        if (status == BP_SUCCESS)
+        {
+            num_done++;
+        }
+    }
+    set_errno(L, status);
+
+    /* Return Count and Flags */
+    lua_pushnumber(L, num_done);
+    push_flag_table(L, batchflags);
+    return 2;
+}
+
+/*----------------------------------------------------------------------------
+ * batch_receive - body of channel:load_batch() and channel:accept_batch()
+ *
+ *  Up to count entries are filled in, stopping at the first one which fails
+ *  (which is normally a timeout once nothing is left).  The flags of all of
+ *  them are combined into one table.
+ *----------------------------------------------------------------------------*/
+static int batch_receive(lua_State *L, bool accept)
+{
+    /* Get User Data */
+    lbplib_user_data_t *bplib_data = (lbplib_user_data_t *)luaL_checkudata(L, 1, LUA_BPLIBMETANAME);
+    if (!bplib_data)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_BPLIBMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Check Number of Parameters */
+    int minargs = 4;
+    if (lua_gettop(L) != minargs)
+    {
+        lualog("incorrect number of parameters - expected %d\n", minargs);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Type Check Parameters */
+    if (!lua_istable(L, 2) || !lua_isnumber(L, 3) || !lua_isnumber(L, 4))
+    {
+        lualog("incorrect parameter types\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Receive Each Entry */
+    uint32_t batchflags = 0;
+    int      count      = (int)lua_tonumber(L, 3);
+    int      timeout    = (int)lua_tonumber(L, 4);
+    int      num_done   = 0;
+    int      status     = BP_SUCCESS;
+    while (num_done < count)
+    {
+        uint32_t flags = 0;
+        char    *data  = NULL;
+        int      size  = 0;
+
+        if (accept)
+        {
+            status = bplib_accept(bplib_data->desc, (void **)&data, &size, timeout, &flags);
+        }
+        else
+        {
+            status = bplib_load(bplib_data->desc, (void **)&data, &size, timeout, &flags);
+        }
+
+        batchflags |= flags;
+        if (status != BP_SUCCESS)
+        {
+            break;
+        }
+
+        num_done++;
+        put_data(L, 2, num_done, data, size);
+        if (accept)
+        {
+            bplib_ackpayload(bplib_data->desc, data);
+        }
+        else
+        {
+            bplib_ackbundle(bplib_data->desc, data);
+        }
+    }
+
+    /* Running out is not an error when something was received */
+    if (num_done > 0 && status == BP_TIMEOUT)
+    {
+        status = BP_SUCCESS;
+    }
+    set_errno(L, status);
+
+    /* Return Count and Flags */
+    lua_pushnumber(L, num_done);
+    push_flag_table(L, batchflags);
+    return 2;
+}
+
 /******************************************************************************
  LIBRARY FUNCTIONS
  ******************************************************************************/
@@ -394,6 +640,13 @@ int luaopen_bplib(lua_State *L)
     /* Associate Meta Data */
     luaL_setfuncs(L, lbplib_metadata, 0);
 
+    /* Create Buffer Meta Data */
+    luaL_newmetatable(L, LUA_BUFFERMETANAME);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+    luaL_setfuncs(L, lbplib_buffer_metadata, 0);
+    lua_pop(L, 1);
+
     /* Create Functions */
     luaL_newlib(L, lbplib_functions);
 
@@ -921,6 +1174,35 @@ int lbplib_shutdown(lua_State *L)
     return 0;
 }
 
+/*----------------------------------------------------------------------------
+ * lbplib_buffer - bplib.buffer(<size>) --> buffer
+ *
+ *  The buffer can be passed in place of a string to store, process and the
+ *  batch functions, and placed in the table given to load_batch and
+ *  accept_batch to be filled in without making a new string each time
+ *----------------------------------------------------------------------------*/
+int lbplib_buffer(lua_State *L)
+{
+    /* Type Check Parameters */
+    if (!lua_isnumber(L, 1) || lua_tonumber(L, 1) < 0)
+    {
+        lualog("incorrect parameter type\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    /* Create Buffer */
+    size_t           size   = (size_t)lua_tonumber(L, 1);
+    lbplib_buffer_t *buffer = (lbplib_buffer_t *)lua_newuserdata(L, sizeof(lbplib_buffer_t) + size);
+    buffer->size            = size;
+    buffer->length          = 0;
+
+    luaL_getmetatable(L, LUA_BUFFERMETANAME);
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
 /******************************************************************************
  BUNDLE PROTOCOL META FUNCTIONS
  ******************************************************************************/
@@ -1279,7 +1561,7 @@ int lbplib_stats(lua_State *L)
 }
 
 /*----------------------------------------------------------------------------
- * lbplib_store - channel:store(<data>, <timeout>) --> return code, flags
+ * lbplib_store - channel:store(<data or buffer>, <timeout>) --> return code, flags
  *----------------------------------------------------------------------------*/
 int lbplib_store(lua_State *L)
 {
@@ -1302,7 +1584,9 @@ int lbplib_store(lua_State *L)
     }
 
     /* Type Check Parameters */
-    if (!lua_isstring(L, 2) || !lua_isnumber(L, 3))
+    size_t      size    = 0;
+    const char *payload = check_data(L, 2, &size);
+    if (payload == NULL || !lua_isnumber(L, 3))
     {
         lualog("incorrect parameter types\n");
         lua_pushboolean(L, false); /* push result as fail */
@@ -1311,8 +1595,6 @@ int lbplib_store(lua_State *L)
 
     /* Store Data */
     uint32_t    storflags = 0;
-    size_t      size      = 0;
-    const char *payload   = lua_tolstring(L, 2, &size);
     int         timeout   = (int)lua_tonumber(L, 3);
     int         status    = bplib_store(bplib_data->desc, (void *)payload, (int)size, timeout, &storflags);
     set_errno(L, status);
@@ -1384,7 +1666,7 @@ int lbplib_load(lua_State *L)
 }
 
 /*----------------------------------------------------------------------------
- * lbplib_process - channel:process(<bundle>, <timeout>) --> return code, flags
+ * lbplib_process - channel:process(<bundle or buffer>, <timeout>) --> return code, flags
  *----------------------------------------------------------------------------*/
 int lbplib_process(lua_State *L)
 {
@@ -1407,8 +1689,10 @@ int lbplib_process(lua_State *L)
     }
 
     /* Type Check Parameters */
-    if (!lua_isstring(L, 2) || /* bundle */
-        !lua_isnumber(L, 3))   /* timeout */
+    size_t      size   = 0;
+    const char *bundle = check_data(L, 2, &size);
+    if (bundle == NULL ||    /* bundle */
+        !lua_isnumber(L, 3)) /* timeout */
     {
         lualog("incorrect parameter types\n");
         lua_pushboolean(L, false); /* push result as fail */
@@ -1417,8 +1701,6 @@ int lbplib_process(lua_State *L)
 
     /* Store Data */
     uint32_t    procflags = 0;
-    size_t      size      = 0;
-    const char *bundle    = lua_tolstring(L, 2, &size);
     int         timeout   = (int)lua_tonumber(L, 3);
     int         status    = bplib_process(bplib_data->desc, (void *)bundle, (int)size, timeout, &procflags);
     set_errno(L, status);
@@ -1508,3 +1790,93 @@ int lbplib_flush(lua_State *L)
 
     return 0;
 }
+
+/*----------------------------------------------------------------------------
+ * lbplib_store_batch - channel:store_batch(<table of data>, <timeout>[, <count>]) --> number stored, flags
+ *----------------------------------------------------------------------------*/
+int lbplib_store_batch(lua_State *L)
+{
+    return batch_submit(L, false);
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_load_batch - channel:load_batch(<table>, <count>, <timeout>) --> number loaded, flags
+ *----------------------------------------------------------------------------*/
+int lbplib_load_batch(lua_State *L)
+{
+    return batch_receive(L, false);
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_process_batch - channel:process_batch(<table of bundles>, <timeout>[, <count>]) --> number processed, flags
+ *----------------------------------------------------------------------------*/
+int lbplib_process_batch(lua_State *L)
+{
+    return batch_submit(L, true);
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_accept_batch - channel:accept_batch(<table>, <count>, <timeout>) --> number accepted, flags
+ *----------------------------------------------------------------------------*/
+int lbplib_accept_batch(lua_State *L)
+{
+    return batch_receive(L, true);
+}
+
+/******************************************************************************
+ BUFFER META FUNCTIONS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * lbplib_buffer_len - buffer:len() --> number of bytes held
+ *----------------------------------------------------------------------------*/
+int lbplib_buffer_len(lua_State *L)
+{
+    lbplib_buffer_t *buffer = (lbplib_buffer_t *)luaL_checkudata(L, 1, LUA_BUFFERMETANAME);
+    lua_pushnumber(L, buffer->length);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_buffer_size - buffer:size() --> number of bytes the buffer can hold
+ *----------------------------------------------------------------------------*/
+int lbplib_buffer_size(lua_State *L)
+{
+    lbplib_buffer_t *buffer = (lbplib_buffer_t *)luaL_checkudata(L, 1, LUA_BUFFERMETANAME);
+    lua_pushnumber(L, buffer->size);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_buffer_tostring - buffer:tostring() --> string copy of the bytes held
+ *----------------------------------------------------------------------------*/
+int lbplib_buffer_tostring(lua_State *L)
+{
+    lbplib_buffer_t *buffer = (lbplib_buffer_t *)luaL_checkudata(L, 1, LUA_BUFFERMETANAME);
+    lua_pushlstring(L, buffer->data, buffer->length);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_buffer_set - buffer:set(<data>) --> return code
+ *----------------------------------------------------------------------------*/
+int lbplib_buffer_set(lua_State *L)
+{
+    lbplib_buffer_t *buffer = (lbplib_buffer_t *)luaL_checkudata(L, 1, LUA_BUFFERMETANAME);
+
+    /* Type Check Parameters */
+    size_t      size = 0;
+    const char *data = lua_isstring(L, 2) ? lua_tolstring(L, 2, &size) : NULL;
+    if (data == NULL || size > buffer->size)
+    {
+        lualog("data is not a string or does not fit in buffer\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    memcpy(buffer->data, data, size);
+    buffer->length = size;
+
+    lua_pushboolean(L, true);
+    return 1;
+}
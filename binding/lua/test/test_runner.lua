@@ -15,6 +15,7 @@ runner.script(rd .. "ut_attributes.lua")
 runner.script(rd .. "ut_getset_opt.lua")
 runner.script(rd .. "ut_eid2ipn.lua")
 runner.script(rd .. "ut_ipn2eid.lua")
+runner.script(rd .. "ut_eid_bench.lua")
 runner.script(rd .. "ut_route.lua")
 runner.script(rd .. "ut_expiration.lua")
 runner.script(rd .. "ut_expiration.lua", {"FLASH"})
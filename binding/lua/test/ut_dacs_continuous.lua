@@ -52,13 +52,15 @@ end
 rc, stats = receiver:stats()
 runner.check(bp.check_stats(stats, {stored_payloads=num_bundles}))
 
-for i=1,num_bundles do
-    payload = string.format('HELLO WORLD %d', i)
+-- accept payloads --
+local app_payloads = {}
+count, flags = receiver:accept_batch(app_payloads, num_bundles, 1000)
+runner.check(count == num_bundles)
+runner.check(bp.check_flags(flags, {}))
 
-    -- accept bundle --
-    rc, app_payload, flags = receiver:accept(1000)
-    runner.check(rc)
-    runner.check(bp.check_flags(flags, {}))
+for i=1,count do
+    payload = string.format('HELLO WORLD %d', i)
+    app_payload = app_payloads[i]
     runner.check(bp.match_payload(app_payload, payload), string.format('Error - payload %s did not match: %s', app_payload, payload))
 end
 
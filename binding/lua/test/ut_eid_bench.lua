@@ -0,0 +1,55 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local src = runner.srcscript()
+
+-- Setup --
+
+runner.setup(bplib, "RAM")
+
+local iterations = 100000
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s: Test 1 - round trip', src))
+failures = 0
+for i=1,1000,1 do
+    node = (i * 7919) % 4294967296
+    serv = i % 64
+    rc1, eid = bplib.ipn2eid(node, serv)
+    rc2, n, s = bplib.eid2ipn(eid)
+    if not rc1 or not rc2 or n ~= node or s ~= serv then failures = failures + 1 end
+end
+runner.check('failures == 0')
+
+-----------------------------------------------------------------------
+print(string.format('%s: Test 2 - eid2ipn rate', src))
+start = os.clock()
+for i=1,iterations,1 do
+    rc, node, serv = bplib.eid2ipn("ipn:4294967295.65535")
+end
+elapsed = os.clock() - start
+print(string.format('%s: %d eid2ipn calls in %.3f seconds', src, iterations, elapsed))
+runner.check('rc == true')
+runner.check('node == 4294967295')
+runner.check('serv == 65535')
+
+-----------------------------------------------------------------------
+print(string.format('%s: Test 3 - ipn2eid rate', src))
+start = os.clock()
+for i=1,iterations,1 do
+    rc, eid = bplib.ipn2eid(4294967295, 65535)
+end
+elapsed = os.clock() - start
+print(string.format('%s: %d ipn2eid calls in %.3f seconds', src, iterations, elapsed))
+runner.check('rc == true')
+runner.check('eid == "ipn:4294967295.65535"')
+
+-- Clean Up --
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
+
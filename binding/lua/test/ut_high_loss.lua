@@ -33,30 +33,30 @@ local stored_payloads = 0
 
 -----------------------------------------------------------------------
 print(string.format('%s/%s: Test 1 - higher input rate', store, src))
+local payloads = {}
+local bundles = {}
 for k=1,num_bundles do
 	for i=1,k do
-		payload = string.format('HELLO WORLD %d.%d', k, i)
-
-		-- store payload --
-		rc, flags = sender:store(payload, 1000)
-		runner.check(rc)
-		runner.check(bp.check_flags(flags, {}))
-		stored_bundles = stored_bundles + 1
+		payloads[i] = string.format('HELLO WORLD %d.%d', k, i)
 	end
 
-	for j=1,k/2 do
-		-- load bundle --
-		rc, bundle, flags = sender:load(1000)
-		runner.check(rc)
-		runner.check(bundle ~= nil)
-		runner.check(bp.check_flags(flags, {}))
-
-		-- process bundle --
-		rc, flags = receiver:process(bundle, 1000)
-		runner.check(rc)
-		runner.check(bp.check_flags(flags, {}))
-		stored_payloads = stored_payloads + 1
-	end
+	-- store payloads --
+	count, flags = sender:store_batch(payloads, 1000, k)
+	runner.check(count == k)
+	runner.check(bp.check_flags(flags, {}))
+	stored_bundles = stored_bundles + count
+
+	-- load bundles --
+	local half = math.floor(k/2)
+	count, flags = sender:load_batch(bundles, half, 1000)
+	runner.check(count == half)
+	runner.check(bp.check_flags(flags, {}))
+
+	-- process bundles --
+	count, flags = receiver:process_batch(bundles, 1000, half)
+	runner.check(count == half)
+	runner.check(bp.check_flags(flags, {}))
+	stored_payloads = stored_payloads + count
 
 	if k % 64 == 0 then
         bplib.sleep(timeout)
@@ -47,10 +47,103 @@ typedef enum bplib_cache_module_valtype
     bplib_cache_module_valtype_string
 } bplib_cache_module_valtype_t;
 
+/*
+ * The DACS, resident budget, prefetch, flush limit, transmit order, shed policy and memory custody keys are
+ * handled by the cache itself, and their values are integers, passed as a pointer to an int.  All other keys
+ * are passed to the offload module.
+ * The commit keys are integers too, for a module which can share one flush over many bundles, and
+ * so are the RAM budget of a tiered module and the compress switch of the file and segment modules.
+ *
+ * The stat keys are also handled by the cache, but can only be queried.  They are counted as things
+ * happen, so they are cheap to read at any time, and for a sharded cache they are the total over all
+ * of the shards.  The value returned is only good until the next query of the same cache.  Counts of
+ * things that have happened go back to 0 after INT_MAX, so rates should be taken modulo that.
+ */
+/*
+ * The order in which the bundles that become ready to send in the same run of the cache job are
+ * queued, one of these is the value of bplib_cache_confkey_transmit_order.  By deadline, the bundle
+ * that expires first goes first, and by priority the highest class of service goes first, with the
+ * deadline between bundles of the same class.  Each destination gets its bundles in this order.
+ */
+#define BP_CACHE_TRANSMIT_ORDER_FIFO     0 /* in the order evaluated, the default */
+#define BP_CACHE_TRANSMIT_ORDER_DEADLINE 1
+#define BP_CACHE_TRANSMIT_ORDER_PRIORITY 2
+
+/*
+ * What the cache does when the pool is down to its bundle threshold, one of these is the value of
+ * bplib_cache_confkey_shed_policy.  By default nothing, and the pool refuses new bundles until some
+ * of the stored ones are done with.  Otherwise each run of the cache job makes room by evicting some
+ * of the stored bundles that are in memory and not queued: by priority the lowest class of service
+ * goes first with the soonest to expire first within a class, and by deadline the soonest to expire
+ * goes first.  A bundle that the offload module holds, or can be given to right then, only has its
+ * content released from memory and is kept, anything else is dropped.
+ */
+#define BP_CACHE_SHED_POLICY_NONE     0 /* the default */
+#define BP_CACHE_SHED_POLICY_PRIORITY 1
+#define BP_CACHE_SHED_POLICY_DEADLINE 2
+
+/*
+ * The footprint of a stored bundle is all of the pool memory it keeps in use: the primary and
+ * canonical blocks, their CBOR data and any buffer that data is sliced from, the cache entry,
+ * and the blockref the bundle is queued with once it has been.  Each block counts for the whole
+ * of its size class.  It is measured while the bundle is in memory, so it is what the bundle
+ * takes before any offload releases it.  The stats are by class of service, of the class set
+ * by bplib_cache_confkey_footprint_class, and the averages are over the bundles stored now.
+ */
+
+/*
+ * A bundle that asks for custody transfer is taken into custody by a cache that can keep it, which
+ * by default means one with an offload module, once the bundle is written out.  The cache then puts
+ * itself in the custody tracking block, acknowledges the previous custodian with a DACS, and keeps
+ * sending the bundle until the next custodian acknowledges it, so that a loss is only made good on
+ * the hop it happened on.  With bplib_cache_confkey_memory_custody set, custody of a bundle that is
+ * only kept in memory is taken as well, as soon as it is stored, though it does not last a restart.
+ * A cache that does not take custody passes the custody tracking block on as it came, so that the
+ * next custodian acknowledges the previous one directly, and only keeps the bundle until it is sent.
+ */
+
 typedef enum bplib_cache_confkey
 {
     bplib_cache_confkey_none,
     bplib_cache_confkey_offload_base_dir,
+    bplib_cache_confkey_offload_commit_delay, /**< ms an offloaded bundle may wait for a shared flush, 0 for none */
+    bplib_cache_confkey_offload_commit_bytes, /**< bytes offloaded that start a shared flush, 0 for no limit */
+    bplib_cache_confkey_offload_ram_budget,   /**< bytes of bundles a tiered module keeps in memory, 0 for none */
+    bplib_cache_confkey_offload_compress,     /**< nonzero to compress stored payloads that look compressible */
+    bplib_cache_confkey_offload_delete_batch, /**< released bundles deleted together in the background, 0 for at once */
+    bplib_cache_confkey_offload_delete_wait,  /**< ms a partial batch of released bundles waits to be deleted */
+    bplib_cache_confkey_dacs_open_time,       /**< ms a DACS collects sequence numbers before it is sent */
+    bplib_cache_confkey_dacs_lifetime,        /**< ms lifetime of a DACS bundle */
+    bplib_cache_confkey_dacs_max_entries,     /**< ranges of sequence numbers in one DACS */
+    bplib_cache_confkey_dacs_max_bytes,       /**< encoded size of the ranges in one DACS, 0 for no limit */
+    bplib_cache_confkey_dacs_ack_threshold,   /**< sequence numbers that send a DACS right away, 0 to always wait */
+    bplib_cache_confkey_resident_budget,      /**< bytes of offloaded bundles kept in memory, 0 to always release */
+    bplib_cache_confkey_prefetch_depth,       /**< pending bundles restored ahead of being sent, within the budget */
+    bplib_cache_confkey_flush_limit,          /**< pending entries evaluated per run of the cache job, 0 for no limit */
+    bplib_cache_confkey_transmit_order,       /**< one of the BP_CACHE_TRANSMIT_ORDER_* values */
+    bplib_cache_confkey_shed_policy,          /**< one of the BP_CACHE_SHED_POLICY_* values */
+    bplib_cache_confkey_memory_custody,       /**< nonzero to take custody of bundles without an offload module */
+    bplib_cache_confkey_footprint_class,      /**< BP_COS_* value the footprint stats are of, -1 for all bundles */
+
+    /* only for bplib_cache_query() */
+    bplib_cache_confkey_stat_entries_idle,         /**< entries waiting on a route, an ack or a timer */
+    bplib_cache_confkey_stat_entries_queue,        /**< entries whose bundle is queued to be sent */
+    bplib_cache_confkey_stat_entries_delete,       /**< entries done with, waiting to age out */
+    bplib_cache_confkey_stat_fsm_transitions,      /**< changes of entry state, ever */
+    bplib_cache_confkey_stat_discards,             /**< bundles that could not be stored, ever */
+    bplib_cache_confkey_stat_stored_bytes,         /**< encoded size of the bundles stored */
+    bplib_cache_confkey_stat_entries_offloaded,    /**< entries whose bundle is held by the offload module */
+    bplib_cache_confkey_stat_entries_resident,     /**< entries whose bundle is in memory */
+    bplib_cache_confkey_stat_pending,              /**< entries on the pending list, to be evaluated */
+    bplib_cache_confkey_stat_dacs_open,            /**< DACS still collecting sequence numbers */
+    bplib_cache_confkey_stat_dacs_closed,          /**< DACS finished and sent, ever */
+    bplib_cache_confkey_stat_custody_hold_time,    /**< average ms from storing a bundle until a DACS for it */
+    bplib_cache_confkey_stat_evictions,            /**< bundles dropped by the shed policy, ever */
+    bplib_cache_confkey_stat_evict_releases,       /**< bundles released to offload by the shed policy, ever */
+    bplib_cache_confkey_stat_footprint_bytes,      /**< average pool bytes taken by a stored bundle, see above */
+    bplib_cache_confkey_stat_footprint_blocks,     /**< average pool blocks taken by a stored bundle */
+    bplib_cache_confkey_stat_footprint_bytes_max,  /**< most pool bytes taken by any bundle stored, ever */
+    bplib_cache_confkey_stat_footprint_blocks_max, /**< most pool blocks taken by any bundle stored, ever */
 } bplib_cache_confkey_t;
 
 struct bplib_cache_module_api
@@ -63,12 +156,50 @@ struct bplib_cache_module_api
     int (*stop)(bplib_mpool_block_t *svc);
 };
 
+/*
+ * What an offload module keeps about each bundle it holds, so that after a restart the cache can
+ * take its entries back without restoring the bundles themselves.  The module fills this in from
+ * the bundle it is given to offload.
+ */
+typedef struct bplib_cache_offload_index
+{
+    bp_sid_t      sid;
+    bp_ipn_addr_t flow_id;            /**< source EID of the bundle */
+    bp_val_t      sequence_num;       /**< creation timestamp sequence number of the bundle */
+    bp_ipn_t      final_dest_node;    /**< node number of the destination EID */
+    uint64_t      expire_time;        /**< DTN time, 0 if it has no lifetime */
+    size_t        bundle_encode_size; /**< encoded size of the bundle, as the cache counts it */
+} bplib_cache_offload_index_t;
+
+typedef void (*bplib_cache_offload_recover_func_t)(void *arg, const bplib_cache_offload_index_t *index);
+
 typedef struct bplib_cache_offload_api
 {
     bplib_cache_module_api_t std;
     int (*offload)(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
     int (*restore)(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk);
     int (*release)(bplib_mpool_block_t *svc, bp_sid_t sid);
+
+    /*
+     * Optional.  A module which has this does not need to make each bundle durable before offload()
+     * returns, but everything offloaded so far must be durable once this returns success.  The cache
+     * calls it before a DACS is sent, so custody of a bundle is never acknowledged before that.
+     */
+    int (*flush)(bplib_mpool_block_t *svc);
+
+    /*
+     * Optional.  A module which has this keeps an index of the bundles it holds across a restart.
+     * The cache calls it once the module is started, and it calls func with each bundle it still
+     * holds from before, which the cache then tracks as if it had just been offloaded.
+     */
+    int (*recover)(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg);
+
+    /*
+     * Set by a module which keeps what is offloaded in memory, in a smaller form.  Bundles are then not
+     * made durable by being offloaded, so the cache takes custody of them the same as it does without a
+     * module, and only offloads a bundle when it would otherwise shed it, to keep it in less of the pool.
+     */
+    bool in_memory;
 } bplib_cache_offload_api_t;
 
 /******************************************************************************
@@ -77,6 +208,15 @@ typedef struct bplib_cache_offload_api
 
 /* Service API */
 bp_handle_t bplib_cache_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr);
+
+/*
+ * The same as bplib_cache_attach(), but with the bundles split by flow over num_shards states, each
+ * with its own indices, pending list and jobs.  The route table still sees one storage service at
+ * service_addr, the shards other than the first are sub-interfaces of it, so their jobs can run in
+ * parallel on different threads.  An offload module registered afterwards is used by every shard.
+ */
+bp_handle_t bplib_cache_attach_sharded(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr,
+                                       uint32_t num_shards);
 int         bplib_cache_detach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr);
 
 bp_handle_t bplib_cache_register_module_service(bplib_routetbl_t *tbl, bp_handle_t cache_intf_id,
@@ -26,16 +26,27 @@
 
 bplib_cache_state_t *bplib_cache_get_state(bplib_mpool_block_t *intf_block)
 {
-    bplib_cache_state_t *state;
+    bplib_cache_intf_t *intf;
 
-    state = bplib_mpool_generic_data_cast(intf_block, BPLIB_STORE_SIGNATURE_STATE);
-    if (state == NULL)
+    intf = bplib_mpool_generic_data_cast(intf_block, BPLIB_STORE_SIGNATURE_INTF);
+    if (intf == NULL || intf->state == NULL)
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): storage_block incorrect for bplib_cache_state_t\n", __func__);
         return NULL;
     }
 
-    return state;
+    return intf->state;
+}
+
+bplib_cache_state_t *bplib_cache_get_shard(bplib_cache_state_t *state, uint32_t index)
+{
+    /* index 0 is the storage service itself */
+    if (index == 0)
+    {
+        return state;
+    }
+
+    return bplib_cache_get_state(bplib_mpool_dereference(state->shards[index - 1]));
 }
 
 int bplib_cache_entry_tree_insert_unsorted(const bplib_rbt_link_t *node, void *arg)
@@ -58,9 +69,152 @@ void bplib_cache_entry_make_pending(bplib_cache_entry_t *store_entry, uint32_t s
     sblk = bplib_mpool_generic_data_uncast(store_entry, bplib_mpool_blocktype_generic, BPLIB_STORE_SIGNATURE_ENTRY);
     assert(sblk != NULL);
 
+    /* entries are only ever on the pending list, so if this is attached it is already counted */
+    if (bplib_mpool_is_link_unattached(sblk))
+    {
+        ++store_entry->parent->pending_count;
+    }
+
     bplib_mpool_extract_node(sblk);
     bplib_mpool_insert_before(&store_entry->parent->pending_list, sblk);
-    bplib_mpool_job_mark_active(&store_entry->parent->pending_job);
+    bplib_mpool_job_mark_active(store_entry->parent->pending_job);
+}
+
+void bplib_cache_entry_retain_content(bplib_cache_entry_t *store_entry)
+{
+    bplib_cache_state_t          *state;
+    bplib_mpool_bblock_primary_t *pri_block;
+
+    state = store_entry->parent;
+    if (store_entry->refptr == NULL || store_entry->resident_size != 0)
+    {
+        /* nothing to keep, or already counted */
+        return;
+    }
+
+    if (state->resident_budget == 0)
+    {
+        bplib_cache_entry_release_content(store_entry);
+        return;
+    }
+
+    /* the primary block itself plus the encoded bundle, this is always nonzero */
+    store_entry->resident_size = sizeof(bplib_mpool_bblock_primary_t);
+    pri_block                  = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(store_entry->refptr));
+    if (pri_block != NULL)
+    {
+        store_entry->resident_size += pri_block->bundle_encode_size_cache;
+    }
+
+    state->resident_bytes += store_entry->resident_size;
+}
+
+void bplib_cache_entry_release_content(bplib_cache_entry_t *store_entry)
+{
+    if (store_entry->refptr != NULL)
+    {
+        bplib_mpool_ref_release(store_entry->refptr);
+        store_entry->refptr = NULL;
+        --store_entry->parent->resident_count;
+    }
+
+    store_entry->parent->resident_bytes -= store_entry->resident_size;
+    store_entry->resident_size = 0;
+}
+
+bool bplib_cache_entry_restore_content(bplib_cache_entry_t *store_entry)
+{
+    bplib_mpool_block_t *pblk;
+
+    if (store_entry->refptr == NULL && store_entry->offload_sid != 0)
+    {
+        /* if this fails the content stays offloaded, the caller decides when to try again */
+        if (store_entry->parent->offload_api->restore(store_entry->parent->offload_blk, store_entry->offload_sid,
+                                                      &pblk) == BP_SUCCESS)
+        {
+            store_entry->refptr = bplib_mpool_ref_create(pblk);
+            if (store_entry->refptr != NULL)
+            {
+                ++store_entry->parent->resident_count;
+            }
+            BPLIB_TRACEPOINT(cache_restore,
+                             BPLIB_TRACEPOINT_FLOW(store_entry->flow_id_copy.node_number,
+                                                   store_entry->flow_id_copy.service_number),
+                             store_entry->flow_seq_copy, store_entry->offload_sid);
+        }
+    }
+
+    return (store_entry->refptr != NULL);
+}
+
+static bool bplib_cache_evict_content(void *arg, bplib_cache_entry_t *store_entry)
+{
+    bplib_cache_state_t *state;
+    bplib_mpool_block_t *sblk;
+
+    state = arg;
+    sblk  = bplib_mpool_generic_data_uncast(store_entry, bplib_mpool_blocktype_generic, BPLIB_STORE_SIGNATURE_ENTRY);
+    assert(sblk != NULL);
+
+    /* anything not idle may be queued, and anything on the pending list is about to be looked at,
+     * in either case its content is about to be used */
+    if (store_entry->resident_size != 0 && store_entry->state == bplib_cache_entry_state_idle &&
+        bplib_mpool_is_link_unattached(sblk))
+    {
+        bplib_cache_entry_release_content(store_entry);
+    }
+
+    return (state->resident_bytes > (size_t)state->resident_budget);
+}
+
+void bplib_cache_enforce_resident_budget(bplib_cache_state_t *state)
+{
+    /* the content needed furthest in the future is released first, it will be restored when it is due */
+    if (state->resident_bytes > (size_t)state->resident_budget)
+    {
+        bplib_cache_timer_foreach_latest(state->timer_wheel, bplib_cache_evict_content, state);
+    }
+}
+
+bool bplib_cache_dispatch_shard(bplib_cache_state_t *state, bplib_mpool_block_t *qblk)
+{
+    bplib_mpool_flow_t *shard_flow;
+    uint32_t            index;
+
+    /* the storage service itself is the first one, the rest are the shards */
+    index = bplib_cache_custody_flow_hash(qblk) % (state->num_shards + 1);
+    if (index == 0)
+    {
+        return false;
+    }
+
+    /*
+     * The flow belongs to that shard, no other may store it or its DACS.  If the shard cannot
+     * take it right now, it is dropped, the same as when the egress queue of the storage service
+     * itself is full.
+     */
+    shard_flow = bplib_mpool_flow_cast(bplib_mpool_dereference(state->shards[index - 1]));
+    if (shard_flow == NULL || !bplib_mpool_flow_try_push(&shard_flow->egress, qblk, 0))
+    {
+        ++state->discard_count;
+        bplib_mpool_recycle_block(qblk);
+    }
+
+    return true;
+}
+
+void bplib_cache_recover_entry(void *arg, const bplib_cache_offload_index_t *index)
+{
+    bplib_cache_state_t *state;
+    bplib_cache_state_t *shard;
+
+    /* it goes back to the shard its flow would be dispatched to now */
+    state = arg;
+    shard = bplib_cache_get_shard(state, bplib_cache_custody_flow_id_hash(&index->flow_id) % (state->num_shards + 1));
+    if (shard != NULL)
+    {
+        bplib_cache_custody_recover_entry(shard, index);
+    }
 }
 
 int bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src)
@@ -69,7 +223,9 @@ int bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src)
     bplib_mpool_block_t *qblk;
     bplib_mpool_block_t *intf_block;
     bplib_cache_state_t *state;
+    bplib_mpool_job_t   *job;
     int                  forward_count;
+    bool                 share_spent;
 
     intf_block = bplib_mpool_get_block_from_link(subq_src);
     state      = bplib_cache_get_state(intf_block);
@@ -84,9 +240,11 @@ int bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src)
         return -1;
     }
 
+    job                = bplib_mpool_job_cast(subq_src);
     state->action_time = bplib_os_get_dtntime_ms();
     forward_count      = 0;
-    while (true)
+    share_spent        = false;
+    while (!share_spent)
     {
         qblk = bplib_mpool_flow_try_pull(&flow->egress, 0);
         if (qblk == NULL)
@@ -96,6 +254,16 @@ int bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src)
         }
 
         ++forward_count;
+        if (job != NULL && bplib_mpool_job_spend_share(job, qblk))
+        {
+            share_spent = true;
+        }
+
+        /* with shards, the bundles of other flows are passed on without being looked at further */
+        if (state->num_shards != 0 && bplib_cache_dispatch_shard(state, qblk))
+        {
+            continue;
+        }
 
         /* Is this a data bundle that needs to be stored, or is this a custody ack? */
         if (!bplib_cache_custody_check_dacs(state, qblk))
@@ -114,48 +282,475 @@ int bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src)
         }
     }
 
+    /* bundles which were stored and could be sent right away were only put in the batch */
+    bplib_cache_push_queue_batch(state);
+
+    /* with a quantum, the other active jobs get a turn before the rest of this queue */
+    if (share_spent)
+    {
+        bplib_mpool_job_mark_active(job);
+    }
+
     return forward_count;
 }
 
+/*
+ * The same as bplib_mpool_subq_workitem_may_push(), but also counting what is already in the batch
+ */
+static bool bplib_cache_ingress_may_push(const bplib_cache_state_t *state, const bplib_mpool_subq_workitem_t *subq)
+{
+    return ((bplib_mpool_subq_get_depth(&subq->base_subq) + state->queue_batch_count) <
+            (subq->current_depth_limit / 2));
+}
+
+/*
+ * Whether the first entry goes ahead of the second one, under the transmit order of the state
+ */
+static bool bplib_cache_transmit_before(const bplib_cache_state_t *state, const bplib_cache_entry_t *store_entry,
+                                        const bplib_cache_entry_t *other_entry)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    bplib_mpool_bblock_primary_t *other_pri;
+
+    if (state->transmit_order == BP_CACHE_TRANSMIT_ORDER_PRIORITY)
+    {
+        pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(store_entry->refptr));
+        other_pri = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(other_entry->refptr));
+        if (pri_block != NULL && other_pri != NULL &&
+            pri_block->data.delivery.class_of_service != other_pri->data.delivery.class_of_service)
+        {
+            return (pri_block->data.delivery.class_of_service > other_pri->data.delivery.class_of_service);
+        }
+    }
+
+    return (store_entry->expire_time < other_entry->expire_time);
+}
+
+void bplib_cache_queue_batch_insert(bplib_cache_state_t *state, bplib_mpool_block_t *rblk,
+                                    bplib_cache_entry_t *store_entry)
+{
+    bplib_mpool_block_t    *pos;
+    bplib_mpool_block_t    *prev;
+    bplib_cache_blockref_t *block_ref;
+    uint32_t                depth;
+
+    /*
+     * The new ref goes at the tail, unless ordered, then it is moved back past the refs already in the
+     * batch that it goes ahead of.  Equal ones stay in the order evaluated.
+     */
+    pos = &state->queue_batch;
+    if (state->transmit_order != BP_CACHE_TRANSMIT_ORDER_FIFO)
+    {
+        for (depth = 0; depth < BP_CACHE_TRANSMIT_ORDER_DEPTH; ++depth)
+        {
+            prev = bplib_mpool_get_prev_block(pos);
+            if (prev == NULL || prev == &state->queue_batch)
+            {
+                break;
+            }
+
+            block_ref = bplib_mpool_generic_data_cast(prev, BPLIB_STORE_SIGNATURE_BLOCKREF);
+            if (block_ref == NULL || !bplib_cache_transmit_before(state, store_entry, block_ref->storage_entry))
+            {
+                break;
+            }
+
+            pos = prev;
+        }
+    }
+
+    bplib_mpool_insert_before(pos, rblk);
+    ++state->queue_batch_count;
+}
+
+void bplib_cache_push_queue_batch(bplib_cache_state_t *state)
+{
+    bplib_mpool_flow_t *self_flow;
+
+    if (state->queue_batch_count == 0)
+    {
+        return;
+    }
+
+    /* the whole batch goes into the ingress queue under one lock, rather than one per bundle */
+    self_flow = bplib_cache_get_flow(state);
+    bplib_mpool_flow_try_push_n(&self_flow->ingress, &state->queue_batch, state->queue_batch_count, 0);
+    state->queue_batch_count = 0;
+
+    /* Anything that did not fit is recycled, and when the destructor of the ref runs the
+     * queued flag is cleared as normal, so the entry goes back to idle and is tried again */
+    if (bplib_mpool_is_nonempty_list_head(&state->queue_batch))
+    {
+        bplib_mpool_recycle_all_blocks_in_list(NULL, &state->queue_batch);
+    }
+}
+
 void bplib_cache_flush_pending(bplib_cache_state_t *state)
 {
     bplib_mpool_list_iter_t list_it;
     int                     status;
     bplib_mpool_flow_t     *self_flow;
+    uint32_t                count;
 
     self_flow = bplib_cache_get_flow(state);
 
     /* Attempt to re-route all bundles in the pending list */
     /* In some cases the bundle can get re-added to the pending list, so this is done in a loop */
+    count  = 0;
     status = bplib_mpool_list_iter_goto_first(&state->pending_list, &list_it);
-    while (status == BP_SUCCESS && bplib_mpool_subq_workitem_may_push(&self_flow->ingress))
+    while (status == BP_SUCCESS && bplib_cache_ingress_may_push(state, &self_flow->ingress))
     {
+        if (state->flush_limit > 0 && count >= (uint32_t)state->flush_limit)
+        {
+            /* the rest is done on the next run, after the jobs of other flows have had a turn */
+            bplib_mpool_job_mark_active(state->pending_job);
+            break;
+        }
+
         /* removal of an iterator node is allowed */
         bplib_mpool_extract_node(list_it.position);
+        --state->pending_count;
         bplib_cache_fsm_execute(list_it.position);
+        ++count;
         status = bplib_mpool_list_iter_forward(&list_it);
     }
+
+    bplib_cache_push_queue_batch(state);
+
+    /* if the pool is too full for new bundles, some of these may have to make room */
+    bplib_cache_shed_load(state);
+
+    /* content kept since the last transmit may now be more than the budget allows */
+    bplib_cache_enforce_resident_budget(state);
+
+    /* if it stopped with entries left over, what is next can be read in while the queue drains */
+    if (status == BP_SUCCESS && state->offload_api != NULL && state->prefetch_depth > 0 &&
+        state->resident_bytes < (size_t)state->resident_budget)
+    {
+        bplib_mpool_job_mark_active(state->prefetch_job);
+    }
+
+    /* the FSM may have changed the action times of entries, so the poll deadline may need to move */
+    bplib_cache_update_poll_time(state);
 }
 
-int bplib_cache_do_poll(bplib_cache_state_t *state)
+bool bplib_cache_offload_enqueue(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+{
+    bplib_cache_offload_queue_t *queue;
+
+    queue = state->offload_queue;
+    if (queue == NULL || queue->count >= BP_CACHE_OFFLOAD_QUEUE_DEPTH)
+    {
+        /* the caller offloads it now instead */
+        return false;
+    }
+
+    store_entry->flags |= BPLIB_STORE_FLAG_OFFLOAD_WAIT;
+    queue->entries[queue->count] = store_entry;
+    ++queue->count;
+    bplib_mpool_job_mark_active(&queue->job);
+
+    return true;
+}
+
+void bplib_cache_offload_cancel(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+{
+    uint32_t i;
+
+    if ((store_entry->flags & BPLIB_STORE_FLAG_OFFLOAD_WAIT) == 0)
+    {
+        return;
+    }
+
+    /* the slot stays in the queue, it is just passed over */
+    store_entry->flags &= ~BPLIB_STORE_FLAG_OFFLOAD_WAIT;
+    for (i = 0; i < state->offload_queue->count; ++i)
+    {
+        if (state->offload_queue->entries[i] == store_entry)
+        {
+            state->offload_queue->entries[i] = NULL;
+            break;
+        }
+    }
+}
+
+static void bplib_cache_entry_remove_from_indices(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+{
+    /* an entry going away cannot be written out any more */
+    bplib_cache_offload_cancel(state, store_entry);
+
+    /* need to make sure this is removed from all indices, these do nothing if it is not in them */
+    bplib_cache_hash_remove(&state->dacs_index, store_entry);
+    bplib_cache_hash_remove(&state->bundle_index, store_entry);
+
+    /* this does nothing if the entry is not in the timer wheel */
+    bplib_cache_timer_cancel(state->timer_wheel, store_entry);
+
+    /* for the destination index, 0 is an invalid key value and means it was never added.
+     * This is a faster/easier way to check than bplib_rbt_node_is_member(), but can
+     * only be used if it the link is only associated with a single tree */
+    if (bplib_rbt_get_key_value(&store_entry->dest_eid_rbt_link) != 0)
+    {
+        bplib_rbt_extract_node(&state->dest_eid_jphfix_index, &store_entry->dest_eid_rbt_link);
+    }
+
+    /* the same goes for the expire index, extracting the node resets its key to 0 */
+    if (bplib_rbt_get_key_value(&store_entry->expire_rbt_link) != 0)
+    {
+        bplib_rbt_extract_node(&state->expire_index, &store_entry->expire_rbt_link);
+    }
+}
+
+/*
+ * Takes an idle entry out of everything and puts it on the list given, for it to be recycled.  This
+ * may be done while its node of the expire index is the current one of a scan, which allows for it.
+ */
+static void bplib_cache_entry_discard_idle(bplib_cache_entry_t *store_entry, bplib_mpool_block_t *discard_list)
+{
+    bplib_cache_state_t *state;
+    bplib_mpool_block_t *sblk;
+
+    state = store_entry->parent;
+    sblk  = bplib_mpool_generic_data_uncast(store_entry, bplib_mpool_blocktype_generic, BPLIB_STORE_SIGNATURE_ENTRY);
+    assert(sblk != NULL);
+
+    /* entries are only ever on the pending list, this one is not going to be evaluated now */
+    if (bplib_mpool_is_link_attached(sblk))
+    {
+        --state->pending_count;
+    }
+    bplib_mpool_extract_node(sblk);
+
+    /* this takes it out of the expire index too, which the scan allows for the current node */
+    bplib_cache_entry_remove_from_indices(state, store_entry);
+
+    if (store_entry->offload_sid != 0)
+    {
+        state->offload_api->release(state->offload_blk, store_entry->offload_sid);
+        store_entry->offload_sid = 0;
+        --state->offloaded_count;
+    }
+
+    /* counted the same as if the FSM had discarded it */
+    ++state->fsm_state_exit_count[store_entry->state];
+    store_entry->state = bplib_cache_entry_state_undefined;
+    ++state->fsm_state_enter_count[store_entry->state];
+
+    bplib_mpool_insert_before(discard_list, sblk);
+}
+
+static bplib_rbt_scan_action_t bplib_cache_expire_entry(bplib_rbt_link_t *link, void *arg)
 {
-    bplib_rbt_iter_t     rbt_it;
     bplib_cache_entry_t *store_entry;
-    int                  rbt_status;
 
-    rbt_status = bplib_rbt_iter_goto_max(bplib_os_get_dtntime_ms(), &state->time_jphfix_index, &rbt_it);
-    while (rbt_status == BP_SUCCESS)
+    /*
+     * Only idle entries are taken, the same as bplib_cache_fsm_state_idle_eval() would discard.  One
+     * that is queued still has a ref out, and the FSM gets to it once that comes back.
+     */
+    store_entry = bplib_cache_entry_from_link(link, expire_rbt_link);
+    if (store_entry->state != bplib_cache_entry_state_idle)
     {
-        store_entry = bplib_cache_entry_from_link(rbt_it.position, time_rbt_link);
+        return bplib_rbt_scan_continue;
+    }
 
-        /* preemptively move the iterator - the current entry will be removed,
-         * and if that was done first, it would invalidate the iterator */
-        rbt_status = bplib_rbt_iter_prev(&rbt_it);
+    bplib_cache_entry_discard_idle(store_entry, arg);
+    ++store_entry->parent->discard_count;
 
-        bplib_cache_entry_make_pending(store_entry, 0, 0);
+    return bplib_rbt_scan_continue;
+}
+
+void bplib_cache_expire_sweep(bplib_cache_state_t *state)
+{
+    bplib_mpool_block_t expired_list;
+
+    bplib_mpool_init_list_head(NULL, &expired_list);
+
+    /*
+     * The index is in order of expire time, so everything that has expired is at the start of it,
+     * and each one is dealt with in the same pass that finds it.
+     */
+    bplib_rbt_scan_range(0, state->action_time, &state->expire_index, bplib_cache_expire_entry, &expired_list);
+
+    /* the rest is done by the destructor of each one, once the pool gets to them */
+    bplib_mpool_recycle_all_blocks_in_list(bplib_cache_parent_pool(state), &expired_list);
+}
+
+/*
+ * The state of one pass of the shed policy over the expire index
+ */
+typedef struct bplib_cache_evict_scan
+{
+    bplib_mpool_block_t evict_list;
+    uint32_t            class_of_service; /**< only bundles of this class are evicted, by priority */
+    bool                any_class;        /**< the bundles of every class are evicted, by deadline */
+    uint32_t            count;
+} bplib_cache_evict_scan_t;
+
+static bplib_rbt_scan_action_t bplib_cache_evict_entry(bplib_rbt_link_t *link, void *arg)
+{
+    bplib_cache_evict_scan_t     *scan = arg;
+    bplib_cache_entry_t          *store_entry;
+    bplib_cache_state_t          *state;
+    bplib_mpool_block_t          *sblk;
+    bplib_mpool_bblock_primary_t *pri_block;
+    uint32_t                      class_of_service;
+
+    if (scan->count >= BP_CACHE_EVICT_LIMIT)
+    {
+        return bplib_rbt_scan_stop;
+    }
+
+    /*
+     * Only the entries that hold their bundle in memory are of any use here, and like for the resident
+     * budget, one that is queued or on the pending list is about to be used.
+     */
+    store_entry = bplib_cache_entry_from_link(link, expire_rbt_link);
+    sblk = bplib_mpool_generic_data_uncast(store_entry, bplib_mpool_blocktype_generic, BPLIB_STORE_SIGNATURE_ENTRY);
+    assert(sblk != NULL);
+
+    pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(store_entry->refptr));
+    if (pri_block == NULL || store_entry->state != bplib_cache_entry_state_idle || bplib_mpool_is_link_attached(sblk))
+    {
+        return bplib_rbt_scan_continue;
+    }
+
+    class_of_service = pri_block->data.delivery.class_of_service;
+    if (class_of_service > BP_COS_EXTENDED)
+    {
+        class_of_service = BP_COS_EXTENDED;
+    }
+    if (!scan->any_class && class_of_service != scan->class_of_service)
+    {
+        return bplib_rbt_scan_continue;
+    }
+
+    /* offload first, if that can be done now, then it is only the memory that goes */
+    state = store_entry->parent;
+    if (state->offload_api != NULL)
+    {
+        bplib_cache_offload_cancel(state, store_entry);
+        if (store_entry->offload_sid != 0 || bplib_cache_custody_offload_entry(state, store_entry))
+        {
+            bplib_cache_entry_release_content(store_entry);
+            ++state->evict_release_count;
+            ++scan->count;
+            return bplib_rbt_scan_continue;
+        }
+    }
+
+    bplib_cache_entry_discard_idle(store_entry, &scan->evict_list);
+    ++state->evict_count;
+    ++scan->count;
+
+    return bplib_rbt_scan_continue;
+}
+
+void bplib_cache_shed_load(bplib_cache_state_t *state)
+{
+    bplib_cache_evict_scan_t scan;
 
-        /* done with this entry in the time index (will be re-added when pending_list is processed) */
-        bplib_rbt_extract_node(&state->time_jphfix_index, &store_entry->time_rbt_link);
+    if (state->shed_policy == BP_CACHE_SHED_POLICY_NONE ||
+        !bplib_mpool_is_at_bundle_threshold(bplib_cache_parent_pool(state)))
+    {
+        return;
+    }
+
+    memset(&scan, 0, sizeof(scan));
+    bplib_mpool_init_list_head(NULL, &scan.evict_list);
+
+    /* the expire index is in order of deadline, so by priority it takes one pass for each class */
+    if (state->shed_policy == BP_CACHE_SHED_POLICY_PRIORITY)
+    {
+        for (scan.class_of_service = BP_COS_BULK;
+             scan.class_of_service <= BP_COS_EXTENDED && scan.count < BP_CACHE_EVICT_LIMIT; ++scan.class_of_service)
+        {
+            bplib_rbt_scan_range(0, BP_CACHE_TIME_INFINITE, &state->expire_index, bplib_cache_evict_entry, &scan);
+        }
+    }
+    else
+    {
+        scan.any_class = true;
+        bplib_rbt_scan_range(0, BP_CACHE_TIME_INFINITE, &state->expire_index, bplib_cache_evict_entry, &scan);
+    }
+
+    /* the same as for expired entries, the rest is done by the destructor */
+    bplib_mpool_recycle_all_blocks_in_list(bplib_cache_parent_pool(state), &scan.evict_list);
+}
+
+void bplib_cache_update_poll_time(bplib_cache_state_t *state)
+{
+    bplib_rbt_iter_t rbt_it;
+    uint64_t         poll_time;
+    uint64_t         expire_time;
+    uint64_t         contact_time;
+
+    /* the earliest slot in use in the timer wheel is the next time this cache needs to be polled */
+    poll_time = bplib_cache_timer_next_deadline(state->timer_wheel);
+
+    /* a bundle expiring before then needs a poll of its own, ones that already have are left to the FSM */
+    if (bplib_rbt_iter_goto_min(state->action_time + 1, &state->expire_index, &rbt_it) == BP_SUCCESS)
+    {
+        expire_time = bplib_rbt_get_key_value(rbt_it.position);
+        if (expire_time < poll_time)
+        {
+            poll_time = expire_time;
+        }
+    }
+
+    /* as is the next announcement or start of a contact that has not been looked at yet */
+    if (state->parent_rtbl != NULL)
+    {
+        contact_time = state->contact_time;
+        contact_time = bplib_route_contact_scan(state->parent_rtbl, contact_time, contact_time, NULL, NULL);
+        if (contact_time < poll_time)
+        {
+            poll_time = contact_time;
+        }
+    }
+
+    /* only tell the route table when it actually changes, this is called after every flush */
+    if (state->parent_rtbl != NULL && poll_time != state->poll_time)
+    {
+        if (bplib_route_intf_set_poll_time(state->parent_rtbl, bplib_mpool_get_external_id(state->intf_block),
+                                           poll_time) == 0)
+        {
+            state->poll_time = poll_time;
+        }
+    }
+}
+
+static void bplib_cache_contact_event(void *arg, const bplib_route_contact_t *contact, bool is_start)
+{
+    bplib_cache_state_t *state = arg;
+
+    if (is_start)
+    {
+        bplib_cache_do_route_up(state, contact->dest & contact->mask, contact->mask);
+    }
+    else
+    {
+        bplib_cache_do_route_prestage(state, contact->dest & contact->mask, contact->mask);
+    }
+}
+
+int bplib_cache_do_poll(bplib_cache_state_t *state)
+{
+    uint64_t now;
+
+    now = bplib_os_get_dtntime_coarse_ms();
+
+    /* expired entries are dropped first, so they are not made pending only to be discarded */
+    bplib_cache_expire_sweep(state);
+
+    /* every entry whose time has come is made pending, and removed from the timer wheel
+     * (it will be scheduled again when pending_list is processed) */
+    bplib_cache_timer_expire(state->timer_wheel, now);
+
+    /* contacts announced or started since the last look, each one is only seen once */
+    if (state->parent_rtbl != NULL && now > state->contact_time)
+    {
+        bplib_route_contact_scan(state->parent_rtbl, state->contact_time, now, bplib_cache_contact_event, state);
+        state->contact_time = now;
     }
 
     return BP_SUCCESS;
@@ -178,17 +773,73 @@ int bplib_cache_do_route_up(bplib_cache_state_t *state, bp_ipn_t dest, bp_ipn_t
             break;
         }
 
+        store_entry = bplib_cache_entry_from_link(rbt_it.position, dest_eid_rbt_link);
         rbt_status  = bplib_rbt_iter_next(&rbt_it);
-        store_entry = bplib_cache_entry_from_link(rbt_it.position, time_rbt_link);
         bplib_cache_entry_make_pending(store_entry, 0, 0);
     }
 
     return BP_SUCCESS;
 }
 
+int bplib_cache_do_route_prestage(bplib_cache_state_t *state, bp_ipn_t dest, bp_ipn_t mask)
+{
+    bplib_rbt_iter_t     rbt_it;
+    bplib_cache_entry_t *store_entry;
+    int                  rbt_status;
+    bp_ipn_t             curr_ipn;
+
+    /* without offload everything is in memory already, so there is nothing to get ready */
+    if (state->offload_api == NULL)
+    {
+        return BP_SUCCESS;
+    }
+
+    /* the same as bplib_cache_prefetch_pending(), for the entries going over the contact, so they are
+     * in memory when it starts, and the same budget applies */
+    rbt_status = bplib_rbt_iter_goto_min(dest, &state->dest_eid_jphfix_index, &rbt_it);
+    while (rbt_status == BP_SUCCESS && state->resident_bytes < (size_t)state->resident_budget)
+    {
+        curr_ipn = bplib_rbt_get_key_value(rbt_it.position);
+        if ((curr_ipn & mask) != dest)
+        {
+            /* no longer a route match, all done */
+            break;
+        }
+
+        store_entry = bplib_cache_entry_from_link(rbt_it.position, dest_eid_rbt_link);
+        rbt_status  = bplib_rbt_iter_next(&rbt_it);
+        if (store_entry->state == bplib_cache_entry_state_idle &&
+            (store_entry->flags & BPLIB_STORE_FLAG_LOCAL_CUSTODY) != 0 && store_entry->refptr == NULL &&
+            bplib_cache_entry_restore_content(store_entry))
+        {
+            bplib_cache_entry_retain_content(store_entry);
+        }
+    }
+
+    return BP_SUCCESS;
+}
+
 int bplib_cache_do_intf_statechange(bplib_cache_state_t *state, bool is_up)
 {
     bplib_mpool_flow_t *self_flow;
+    bp_handle_t         shard_intf_id;
+    uint32_t            i;
+
+    /* the shards are only known to the route table as sub-interfaces, so they follow this one */
+    for (i = 0; i < state->num_shards; ++i)
+    {
+        shard_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(state->shards[i]));
+        if (is_up)
+        {
+            bplib_route_intf_set_flags(state->parent_rtbl, shard_intf_id,
+                                       BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+        }
+        else
+        {
+            bplib_route_intf_unset_flags(state->parent_rtbl, shard_intf_id,
+                                         BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+        }
+    }
 
     self_flow = bplib_cache_get_flow(state);
     if (!is_up)
@@ -226,29 +877,165 @@ int bplib_cache_event_impl(void *event_arg, bplib_mpool_block_t *intf_block)
     state->action_time = bplib_os_get_dtntime_ms();
     if (event->event_type == bplib_mpool_flow_event_poll)
     {
+        /* the route table clears the deadline of a flow once it polls it */
+        state->poll_time = BP_DTNTIME_INFINITE;
         bplib_cache_do_poll(state);
     }
     else if ((event->event_type == bplib_mpool_flow_event_up || event->event_type == bplib_mpool_flow_event_down) &&
              bp_handle_equal(self_intf_id, event->intf_state.intf_id))
     {
-        bplib_cache_do_intf_statechange(state, event->event_type == bplib_mpool_flow_event_up);
+        bplib_cache_do_intf_statechange(state, event->event_type == bplib_mpool_flow_event_up);
+    }
+    else if (event->event_type == bplib_mpool_flow_event_route_change)
+    {
+        /* the whole route set was replaced, so any entry might have a route now */
+        bplib_cache_do_route_up(state, 0, 0);
+    }
+
+    /* any sort of action may have put bundles in the pending queue, so flush it now */
+    bplib_cache_flush_pending(state);
+
+    return BP_SUCCESS;
+}
+
+int bplib_cache_process_pending(void *arg, bplib_mpool_block_t *job)
+{
+    bplib_cache_flush_pending(bplib_cache_get_state(bplib_mpool_get_block_from_link(job)));
+    return BP_SUCCESS;
+}
+
+void bplib_cache_prefetch_pending(bplib_cache_state_t *state)
+{
+    bplib_mpool_list_iter_t list_it;
+    bplib_cache_entry_t    *store_entry;
+    int                     status;
+    int                     count;
+
+    if (state->offload_api == NULL)
+    {
+        return;
+    }
+
+    /* only the head of the list is looked at, the rest is far enough out to be read in later */
+    count  = 0;
+    status = bplib_mpool_list_iter_goto_first(&state->pending_list, &list_it);
+    while (status == BP_SUCCESS && count < state->prefetch_depth &&
+           state->resident_bytes < (size_t)state->resident_budget)
+    {
+        store_entry = bplib_mpool_generic_data_cast(list_it.position, BPLIB_STORE_SIGNATURE_ENTRY);
+        if (store_entry != NULL && store_entry->state == bplib_cache_entry_state_idle &&
+            (store_entry->flags & BPLIB_STORE_FLAG_LOCAL_CUSTODY) != 0 && store_entry->refptr == NULL &&
+            bplib_cache_entry_restore_content(store_entry))
+        {
+            /* counted the same as content kept after a transmit, so it is bounded by the same budget */
+            bplib_cache_entry_retain_content(store_entry);
+        }
+
+        ++count;
+        status = bplib_mpool_list_iter_forward(&list_it);
+    }
+}
+
+int bplib_cache_process_prefetch(void *arg, bplib_mpool_block_t *job)
+{
+    bplib_cache_prefetch_pending(bplib_cache_get_state(bplib_mpool_get_block_from_link(job)));
+    return BP_SUCCESS;
+}
+
+void bplib_cache_offload_waiting(bplib_cache_state_t *state)
+{
+    bplib_cache_offload_queue_t *queue;
+    bplib_cache_entry_t         *store_entry;
+    uint32_t                     i;
+
+    queue = state->offload_queue;
+    if (queue == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < queue->count; ++i)
+    {
+        store_entry       = queue->entries[i];
+        queue->entries[i] = NULL;
+        if (store_entry != NULL)
+        {
+            store_entry->flags &= ~BPLIB_STORE_FLAG_OFFLOAD_WAIT;
+            if (bplib_cache_custody_offload_entry(state, store_entry) &&
+                store_entry->state == bplib_cache_entry_state_idle)
+            {
+                /* it may have been sent already, so from here it is kept in memory the same as after a transmit */
+                bplib_cache_entry_retain_content(store_entry);
+            }
+        }
+    }
+
+    queue->count = 0;
+
+    bplib_cache_enforce_resident_budget(state);
+}
+
+int bplib_cache_process_offload(void *arg, bplib_mpool_block_t *job)
+{
+    bplib_cache_offload_waiting(bplib_cache_get_state(bplib_mpool_get_block_from_link(job)));
+    return BP_SUCCESS;
+}
+
+int bplib_cache_construct_intf(void *arg, bplib_mpool_block_t *sblk)
+{
+    bplib_cache_intf_t *intf;
+
+    intf = bplib_mpool_generic_data_cast(sblk, BPLIB_STORE_SIGNATURE_INTF);
+    if (intf == NULL)
+    {
+        return BP_ERROR;
     }
 
-    /* any sort of action may have put bundles in the pending queue, so flush it now */
-    bplib_cache_flush_pending(state);
+    bplib_mpool_job_init(sblk, &intf->pending_job);
+    intf->pending_job.handler = bplib_cache_process_pending;
+    intf->pending_job.jobtype = bplib_mpool_jobtype_cache_fsm;
+
+    bplib_mpool_job_init(sblk, &intf->prefetch_job);
+    intf->prefetch_job.handler = bplib_cache_process_prefetch;
+    intf->prefetch_job.jobtype = bplib_mpool_jobtype_cache_fsm;
+
+    bplib_mpool_job_init(sblk, &intf->offload_queue.job);
+    intf->offload_queue.job.handler = bplib_cache_process_offload;
+    intf->offload_queue.job.jobtype = bplib_mpool_jobtype_cache_fsm;
 
     return BP_SUCCESS;
 }
 
-int bplib_cache_process_pending(void *arg, bplib_mpool_block_t *job)
+int bplib_cache_destruct_intf(void *arg, bplib_mpool_block_t *sblk)
 {
-    bplib_cache_flush_pending(bplib_cache_get_state(bplib_mpool_get_block_from_link(job)));
+    bplib_cache_intf_t *intf;
+
+    intf = bplib_mpool_generic_data_cast(sblk, BPLIB_STORE_SIGNATURE_INTF);
+    if (intf == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* the state and timer blocks are owned by the flow block, so they go back to the pool along with it */
+    if (intf->state_block != NULL)
+    {
+        bplib_mpool_recycle_block(intf->state_block);
+        intf->state_block = NULL;
+        intf->state       = NULL;
+    }
+    if (intf->timer_block != NULL)
+    {
+        bplib_mpool_recycle_block(intf->timer_block);
+        intf->timer_block = NULL;
+    }
+
     return BP_SUCCESS;
 }
 
 int bplib_cache_construct_state(void *arg, bplib_mpool_block_t *sblk)
 {
     bplib_cache_state_t *state;
+    bplib_cache_intf_t  *intf;
 
     state = bplib_mpool_generic_data_cast(sblk, BPLIB_STORE_SIGNATURE_STATE);
     if (state == NULL)
@@ -256,16 +1043,36 @@ int bplib_cache_construct_state(void *arg, bplib_mpool_block_t *sblk)
         return BP_ERROR;
     }
 
-    bplib_mpool_job_init(sblk, &state->pending_job);
-    state->pending_job.handler = bplib_cache_process_pending;
+    /* the init arg is the storage flow block, which holds the pending job */
+    intf = bplib_mpool_generic_data_cast(arg, BPLIB_STORE_SIGNATURE_INTF);
+    if (intf == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    state->intf_block     = arg;
+    state->pending_job    = &intf->pending_job;
+    state->prefetch_job   = &intf->prefetch_job;
+    state->offload_queue  = &intf->offload_queue;
+    state->poll_time      = BP_DTNTIME_INFINITE;
+    state->prefetch_depth = BP_CACHE_PREFETCH_DEPTH;
+    state->flush_limit    = BP_CACHE_FLUSH_LIMIT;
+
+    state->footprint_class = -1;
 
     bplib_mpool_init_list_head(sblk, &state->pending_list);
-    bplib_mpool_init_list_head(sblk, &state->idle_list);
+    bplib_mpool_init_list_head(sblk, &state->queue_batch);
 
-    bplib_rbt_init_root(&state->bundle_index);
-    bplib_rbt_init_root(&state->dacs_index);
+    bplib_cache_hash_init(&state->bundle_index);
+    bplib_cache_hash_init(&state->dacs_index);
     bplib_rbt_init_root(&state->dest_eid_jphfix_index);
-    bplib_rbt_init_root(&state->time_jphfix_index);
+    bplib_rbt_init_root(&state->expire_index);
+    bplib_rbt_bulk_init(&state->recover_dest_eid);
+    bplib_rbt_bulk_init(&state->recover_expire);
+    bplib_mpool_init_list_head(sblk, &state->recover_list);
+
+    bplib_cache_custody_init_dacs_config(&state->dacs_config);
+    state->generated_dacs_seq_step = 1;
 
     return BP_SUCCESS;
 }
@@ -284,12 +1091,20 @@ int bplib_cache_destruct_state(void *arg, bplib_mpool_block_t *sblk)
      * should have made this so before attempting to delete the intf.
      * If not so, they cannot be cleaned up now, because the state object is no longer valid,
      * the desctructors for these objects will not work correctly */
-    assert(bplib_rbt_tree_is_empty(&state->time_jphfix_index));
-    assert(bplib_rbt_tree_is_empty(&state->dest_eid_jphfix_index));
-    assert(bplib_rbt_tree_is_empty(&state->bundle_index));
-    assert(bplib_rbt_tree_is_empty(&state->dacs_index));
-    assert(bplib_mpool_is_link_unattached(&state->idle_list));
+    assert(state->timer_wheel == NULL || state->timer_wheel->num_entries == 0);
+    assert(state->bundle_index.num_entries == 0);
+    assert(state->dacs_index.num_entries == 0);
     assert(bplib_mpool_is_link_unattached(&state->pending_list));
+    assert(state->queue_batch_count == 0);
+
+    /* Every entry in the trees is in the bundle index as well, so these should be empty too, but
+     * a tree can be taken apart in one pass without rebalancing it for each node on the way out */
+    bplib_rbt_clear(&state->dest_eid_jphfix_index);
+    bplib_rbt_clear(&state->expire_index);
+
+    /* the slots of the hash tables are the only part of the state not in a block */
+    bplib_cache_hash_release(&state->bundle_index);
+    bplib_cache_hash_release(&state->dacs_index);
 
     return BP_SUCCESS;
 }
@@ -305,10 +1120,43 @@ int bplib_cache_construct_entry(void *arg, bplib_mpool_block_t *sblk)
     }
 
     store_entry->parent = arg;
+    bplib_mpool_init_secondary_link(sblk, &store_entry->timer_link, bplib_mpool_blocktype_secondary_generic);
 
     return BP_SUCCESS;
 }
 
+/*
+ * Counts more pool memory for the entry, in the class it is counted in.  The first of it makes
+ * the entry one of those the averages are taken over, until the entry is gone.
+ */
+void bplib_cache_entry_add_footprint(bplib_cache_entry_t *store_entry, size_t bytes, uint32_t blocks)
+{
+    bplib_cache_state_t *state;
+    uint8_t              fp_class;
+
+    state    = store_entry->parent;
+    fp_class = store_entry->footprint_class;
+
+    if (store_entry->footprint_blocks == 0)
+    {
+        ++state->footprint_count[fp_class];
+    }
+
+    store_entry->footprint_bytes += bytes;
+    store_entry->footprint_blocks += blocks;
+    state->footprint_bytes[fp_class] += bytes;
+    state->footprint_blocks[fp_class] += blocks;
+
+    if (store_entry->footprint_bytes > state->footprint_bytes_max[fp_class])
+    {
+        state->footprint_bytes_max[fp_class] = store_entry->footprint_bytes;
+    }
+    if (store_entry->footprint_blocks > state->footprint_blocks_max[fp_class])
+    {
+        state->footprint_blocks_max[fp_class] = store_entry->footprint_blocks;
+    }
+}
+
 int bplib_cache_destruct_entry(void *arg, bplib_mpool_block_t *sblk)
 {
     bplib_cache_entry_t *store_entry;
@@ -322,32 +1170,27 @@ int bplib_cache_destruct_entry(void *arg, bplib_mpool_block_t *sblk)
 
     state = store_entry->parent;
 
-    /* need to make sure this is removed from all index trees */
-    if (bplib_rbt_node_is_member(&state->dacs_index, &store_entry->hash_rbt_link))
-    {
-        bplib_rbt_extract_node(&state->dacs_index, &store_entry->hash_rbt_link);
-    }
-    if (bplib_rbt_node_is_member(&state->bundle_index, &store_entry->hash_rbt_link))
-    {
-        bplib_rbt_extract_node(&state->bundle_index, &store_entry->hash_rbt_link);
-    }
+    bplib_cache_entry_remove_from_indices(state, store_entry);
 
-    /* for the time index, 0 is an invalid key value and means it was never added.
-     * This is a faster/easier way to check than bplib_rbt_node_is_member(), but can
-     * only be used if it the link is only associated with a single tree */
-    if (bplib_rbt_get_key_value(&store_entry->time_rbt_link) != 0)
+    /* release the refptr */
+    bplib_cache_entry_release_content(store_entry);
+    bplib_mpool_ref_release(store_entry->completion_ref);
+    store_entry->completion_ref = NULL;
+
+    if (store_entry->offload_sid != 0)
     {
-        bplib_rbt_extract_node(&state->time_jphfix_index, &store_entry->time_rbt_link);
+        --state->offloaded_count;
     }
-    if (bplib_rbt_get_key_value(&store_entry->dest_eid_rbt_link) != 0)
+
+    state->stored_bytes -= store_entry->stored_size;
+
+    if (store_entry->footprint_blocks != 0)
     {
-        bplib_rbt_extract_node(&state->dest_eid_jphfix_index, &store_entry->dest_eid_rbt_link);
+        --state->footprint_count[store_entry->footprint_class];
+        state->footprint_bytes[store_entry->footprint_class] -= store_entry->footprint_bytes;
+        state->footprint_blocks[store_entry->footprint_class] -= store_entry->footprint_blocks;
     }
 
-    /* release the refptr */
-    bplib_mpool_ref_release(store_entry->refptr);
-    store_entry->refptr = NULL;
-
     return BP_SUCCESS;
 }
 
@@ -394,6 +1237,11 @@ int bplib_cache_destruct_blockref(void *arg, bplib_mpool_block_t *rblk)
 
 void bplib_cache_init(bplib_mpool_t *pool)
 {
+    const bplib_mpool_blocktype_api_t intf_api = (bplib_mpool_blocktype_api_t) {
+        .construct = bplib_cache_construct_intf,
+        .destruct  = bplib_cache_destruct_intf,
+    };
+
     const bplib_mpool_blocktype_api_t state_api = (bplib_mpool_blocktype_api_t) {
         .construct = bplib_cache_construct_state,
         .destruct  = bplib_cache_destruct_state,
@@ -409,35 +1257,153 @@ void bplib_cache_init(bplib_mpool_t *pool)
         .destruct  = bplib_cache_destruct_blockref,
     };
 
+    /* the timer wheel starts out all zero, which is empty, so it needs no constructor */
+    const bplib_mpool_blocktype_api_t timer_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = NULL,
+    };
+
+    bplib_mpool_register_blocktype(pool, BPLIB_STORE_SIGNATURE_INTF, &intf_api, sizeof(bplib_cache_intf_t));
     bplib_mpool_register_blocktype(pool, BPLIB_STORE_SIGNATURE_STATE, &state_api, sizeof(bplib_cache_state_t));
     bplib_mpool_register_blocktype(pool, BPLIB_STORE_SIGNATURE_ENTRY, &entry_api, sizeof(bplib_cache_entry_t));
     bplib_mpool_register_blocktype(pool, BPLIB_STORE_SIGNATURE_BLOCKREF, &blockref_api, sizeof(bplib_cache_blockref_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_STORE_SIGNATURE_TIMER, &timer_api, sizeof(bplib_cache_timer_wheel_t));
 }
 
-bp_handle_t bplib_cache_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr)
+/*
+ * Allocates a storage flow block along with its state and timer blocks.  On success the
+ * state is returned and flow_block_ref holds a ref to the flow block, otherwise it is released.
+ */
+static bplib_cache_state_t *bplib_cache_alloc_intf(bplib_mpool_t *pool, bplib_mpool_ref_t *flow_block_ref)
 {
     bplib_cache_state_t *state;
+    bplib_cache_intf_t  *intf;
     bplib_mpool_block_t *sblk;
+
+    *flow_block_ref = NULL;
+
+    sblk = bplib_mpool_flow_alloc(pool, BPLIB_STORE_SIGNATURE_INTF, pool);
+    if (sblk == NULL)
+    {
+        return NULL;
+    }
+
+    /* this must always work, it was just created above */
+    *flow_block_ref = bplib_mpool_ref_create(sblk);
+    intf            = bplib_mpool_generic_data_cast(sblk, BPLIB_STORE_SIGNATURE_INTF);
+    state           = NULL;
+
+    /* the bulk of the state goes in a block of its own, which is recycled along with the flow */
+    if (intf != NULL)
+    {
+        intf->state_block = bplib_mpool_generic_data_alloc(pool, BPLIB_STORE_SIGNATURE_STATE, sblk);
+        intf->state       = bplib_mpool_generic_data_cast(intf->state_block, BPLIB_STORE_SIGNATURE_STATE);
+        intf->timer_block = bplib_mpool_generic_data_alloc(pool, BPLIB_STORE_SIGNATURE_TIMER, sblk);
+        state             = intf->state;
+    }
+
+    if (state != NULL)
+    {
+        state->timer_wheel = bplib_mpool_generic_data_cast(intf->timer_block, BPLIB_STORE_SIGNATURE_TIMER);
+        if (state->timer_wheel == NULL)
+        {
+            state = NULL;
+        }
+    }
+
+    if (state == NULL)
+    {
+        bplib_mpool_ref_release(*flow_block_ref);
+        *flow_block_ref = NULL;
+    }
+
+    return state;
+}
+
+static void bplib_cache_attach_shards(bplib_routetbl_t *tbl, bplib_cache_state_t *state, bp_handle_t storage_intf_id,
+                                      uint32_t num_shards)
+{
+    bplib_cache_state_t *shard;
+    bplib_mpool_ref_t    shard_ref;
+    bp_handle_t          shard_intf_id;
+    uint32_t             i;
+
+    while (state->num_shards < num_shards)
+    {
+        shard = bplib_cache_alloc_intf(bplib_route_get_mpool(tbl), &shard_ref);
+        if (shard == NULL)
+        {
+            break;
+        }
+
+        /* As a sub-interface the route table polls it on its own, and its ingress goes through
+         * the storage service, but nothing is routed to it, it only gets bundles from that */
+        shard_intf_id = bplib_route_register_generic_intf(tbl, storage_intf_id, bplib_mpool_dereference(shard_ref));
+        if (!bp_handle_is_valid(shard_intf_id))
+        {
+            bplib_mpool_ref_release(shard_ref);
+            break;
+        }
+
+        bplib_route_register_forward_egress_handler(tbl, shard_intf_id, bplib_cache_egress_impl);
+        bplib_route_register_forward_ingress_handler(tbl, shard_intf_id, bplib_route_ingress_to_parent);
+        bplib_route_register_event_handler(tbl, shard_intf_id, bplib_cache_event_impl);
+        bplib_route_intf_set_flags(tbl, shard_intf_id, BPLIB_MPOOL_FLOW_FLAGS_CONTACTS);
+
+        shard->self_addr          = state->self_addr;
+        shard->parent_rtbl        = tbl;
+        shard->generated_dacs_seq = state->num_shards + 1;
+
+        state->shards[state->num_shards] = shard_ref;
+        ++state->num_shards;
+    }
+
+    if (state->num_shards < num_shards)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): Insufficient memory, only %lu of %lu shards created\n", __func__,
+              (unsigned long)state->num_shards + 1, (unsigned long)num_shards + 1);
+    }
+
+    /* the DACS of every shard have the same source EID, so each one uses every Nth sequence number */
+    state->generated_dacs_seq_step = state->num_shards + 1;
+    for (i = 0; i < state->num_shards; ++i)
+    {
+        bplib_cache_get_state(bplib_mpool_dereference(state->shards[i]))->generated_dacs_seq_step =
+            state->generated_dacs_seq_step;
+    }
+}
+
+bp_handle_t bplib_cache_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr)
+{
+    return bplib_cache_attach_sharded(tbl, service_addr, 1);
+}
+
+bp_handle_t bplib_cache_attach_sharded(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr, uint32_t num_shards)
+{
+    bplib_cache_state_t *state;
     bplib_mpool_t       *pool;
     bplib_mpool_ref_t    flow_block_ref;
     bp_handle_t          storage_intf_id;
 
+    if (num_shards == 0 || num_shards > BP_CACHE_MAX_SHARDS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): cannot attach - %lu shards not supported\n", __func__,
+              (unsigned long)num_shards);
+        return BP_INVALID_HANDLE;
+    }
+
     pool = bplib_route_get_mpool(tbl);
 
     /* register Mem Cache storage module */
     bplib_cache_init(pool);
 
-    sblk = bplib_mpool_flow_alloc(pool, BPLIB_STORE_SIGNATURE_STATE, pool);
-    if (sblk == NULL)
+    state = bplib_cache_alloc_intf(pool, &flow_block_ref);
+    if (state == NULL)
     {
         bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): Insufficient memory to create file storage\n", __func__);
         return BP_INVALID_HANDLE;
     }
 
-    /* this must always work, it was just created above */
-    flow_block_ref = bplib_mpool_ref_create(sblk);
-    state          = bplib_mpool_generic_data_cast(sblk, BPLIB_STORE_SIGNATURE_STATE);
-
     storage_intf_id = bplib_dataservice_attach(tbl, service_addr, bplib_dataservice_type_storage, flow_block_ref);
     if (!bp_handle_is_valid(storage_intf_id))
     {
@@ -451,10 +1417,17 @@ bp_handle_t bplib_cache_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *servi
         bplib_route_register_forward_ingress_handler(tbl, storage_intf_id, bplib_route_ingress_to_parent);
         bplib_route_register_event_handler(tbl, storage_intf_id, bplib_cache_event_impl);
 
+        /* it is told ahead of each contact in the contact plan, to get the bundles for it ready */
+        bplib_route_intf_set_flags(tbl, storage_intf_id, BPLIB_MPOOL_FLOW_FLAGS_CONTACTS);
+
         /* This will keep the ref to itself inside of the state struct, this
          * creates a circular reference and prevents the refcount from ever becoming 0
          */
-        state->self_addr = *service_addr;
+        state->self_addr   = *service_addr;
+        state->parent_rtbl = tbl;
+
+        /* the storage service itself counts as one of the shards */
+        bplib_cache_attach_shards(tbl, state, storage_intf_id, num_shards - 1);
     }
 
     return storage_intf_id;
@@ -464,12 +1437,13 @@ int bplib_cache_detach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr)
 {
     bplib_cache_state_t *state;
     bplib_mpool_ref_t    flow_block_ref;
+    bplib_mpool_ref_t    shard_ref;
     int                  status;
 
     flow_block_ref = bplib_dataservice_detach(tbl, service_addr);
     if (flow_block_ref != NULL)
     {
-        state = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_block_ref), BPLIB_STORE_SIGNATURE_STATE);
+        state = bplib_cache_get_state(bplib_mpool_dereference(flow_block_ref));
     }
     else
     {
@@ -483,6 +1457,17 @@ int bplib_cache_detach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr)
     }
     else
     {
+        /* the shards are sub-interfaces, so they have to be taken out of the route table as well */
+        while (state->num_shards > 0)
+        {
+            --state->num_shards;
+            shard_ref                        = state->shards[state->num_shards];
+            state->shards[state->num_shards] = NULL;
+
+            bplib_route_del_intf(tbl, bplib_mpool_get_external_id(bplib_mpool_dereference(shard_ref)));
+            bplib_mpool_ref_release(shard_ref);
+        }
+
         /* Release the local ref - this should cause the refcount to become 0 */
         bplib_mpool_ref_release(flow_block_ref);
         status = BP_SUCCESS;
@@ -495,16 +1480,18 @@ bp_handle_t bplib_cache_register_module_service(bplib_routetbl_t *tbl, bp_handle
                                                 const bplib_cache_module_api_t *api, void *init_arg)
 {
     bplib_cache_state_t *state;
+    bplib_cache_state_t *shard;
     bplib_mpool_block_t *cblk;
     bplib_mpool_block_t *svc;
     bplib_mpool_ref_t    parent_ref;
     int                  status;
     bp_handle_t          handle;
+    uint32_t             i;
 
     svc    = NULL;
     handle = BP_INVALID_HANDLE;
     cblk   = bplib_mpool_block_from_external_id(bplib_route_get_mpool(tbl), cache_intf_id);
-    state  = bplib_mpool_generic_data_cast(cblk, BPLIB_STORE_SIGNATURE_STATE);
+    state  = bplib_cache_get_state(cblk);
     if (state != NULL)
     {
         parent_ref = bplib_mpool_ref_create(cblk);
@@ -524,9 +1511,14 @@ bp_handle_t bplib_cache_register_module_service(bplib_routetbl_t *tbl, bp_handle
         switch (api->module_type)
         {
             case bplib_cache_module_type_offload:
-                state->offload_api = (const bplib_cache_offload_api_t *)api;
-                state->offload_blk = svc;
-                status             = BP_SUCCESS;
+                /* one instance of the module serves every shard */
+                for (i = 0; i <= state->num_shards; ++i)
+                {
+                    shard              = bplib_cache_get_shard(state, i);
+                    shard->offload_api = (const bplib_cache_offload_api_t *)api;
+                    shard->offload_blk = svc;
+                }
+                status = BP_SUCCESS;
                 break;
             default:
                 status = BP_ERROR;
@@ -542,27 +1534,342 @@ bp_handle_t bplib_cache_register_module_service(bplib_routetbl_t *tbl, bp_handle
     return handle;
 }
 
+static int bplib_cache_configure_state(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+                                       const void *val)
+{
+    int result;
+
+    result = BP_ERROR;
+    switch (key)
+    {
+        case bplib_cache_confkey_dacs_open_time:
+        case bplib_cache_confkey_dacs_lifetime:
+        case bplib_cache_confkey_dacs_max_entries:
+        case bplib_cache_confkey_dacs_max_bytes:
+        case bplib_cache_confkey_dacs_ack_threshold:
+            result = bplib_cache_custody_configure_dacs(state, key, vt, val);
+            break;
+
+        case bplib_cache_confkey_resident_budget:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL && *((const int *)val) >= 0)
+            {
+                state->resident_budget = *((const int *)val);
+                result                 = BP_SUCCESS;
+            }
+            break;
+
+        case bplib_cache_confkey_prefetch_depth:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL && *((const int *)val) >= 0)
+            {
+                state->prefetch_depth = *((const int *)val);
+                result                = BP_SUCCESS;
+            }
+            break;
+
+        case bplib_cache_confkey_flush_limit:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL && *((const int *)val) >= 0)
+            {
+                state->flush_limit = *((const int *)val);
+                result             = BP_SUCCESS;
+            }
+            break;
+
+        case bplib_cache_confkey_transmit_order:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL &&
+                *((const int *)val) >= BP_CACHE_TRANSMIT_ORDER_FIFO &&
+                *((const int *)val) <= BP_CACHE_TRANSMIT_ORDER_PRIORITY)
+            {
+                state->transmit_order = *((const int *)val);
+                result                = BP_SUCCESS;
+            }
+            break;
+
+        case bplib_cache_confkey_shed_policy:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL &&
+                *((const int *)val) >= BP_CACHE_SHED_POLICY_NONE &&
+                *((const int *)val) <= BP_CACHE_SHED_POLICY_DEADLINE)
+            {
+                state->shed_policy = *((const int *)val);
+                result             = BP_SUCCESS;
+            }
+            break;
+
+        case bplib_cache_confkey_memory_custody:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL)
+            {
+                state->memory_custody = (*((const int *)val) != 0);
+                result                = BP_SUCCESS;
+            }
+            break;
+
+        case bplib_cache_confkey_footprint_class:
+            if (vt == bplib_cache_module_valtype_integer && val != NULL && *((const int *)val) >= -1 &&
+                *((const int *)val) < BP_CACHE_FOOTPRINT_CLASSES)
+            {
+                state->footprint_class = *((const int *)val);
+                result                 = BP_SUCCESS;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
 int bplib_cache_configure(bplib_routetbl_t *tbl, bp_handle_t module_intf_id, int key, bplib_cache_module_valtype_t vt,
                           const void *val)
 {
     bplib_mpool_block_t *cblk;
     bplib_cache_state_t *state;
     int                  result;
+    uint32_t             i;
 
     result = BP_ERROR;
     cblk   = bplib_mpool_block_from_external_id(bplib_route_get_mpool(tbl), module_intf_id);
-    state  = bplib_mpool_generic_data_cast(cblk, BPLIB_STORE_SIGNATURE_STATE);
+    state  = bplib_cache_get_state(cblk);
     if (state != NULL)
     {
-        /* currently the only module is offload, so all keys are passed here */
-        if (state->offload_blk != NULL)
+        switch (key)
         {
-            result = state->offload_api->std.configure(state->offload_blk, key, vt, val);
+            case bplib_cache_confkey_dacs_open_time:
+            case bplib_cache_confkey_dacs_lifetime:
+            case bplib_cache_confkey_dacs_max_entries:
+            case bplib_cache_confkey_dacs_max_bytes:
+            case bplib_cache_confkey_dacs_ack_threshold:
+            case bplib_cache_confkey_resident_budget:
+            case bplib_cache_confkey_prefetch_depth:
+            case bplib_cache_confkey_flush_limit:
+            case bplib_cache_confkey_transmit_order:
+            case bplib_cache_confkey_shed_policy:
+            case bplib_cache_confkey_memory_custody:
+            case bplib_cache_confkey_footprint_class:
+                /* every shard is configured the same, so these all apply to each one */
+                for (i = 0; i <= state->num_shards; ++i)
+                {
+                    result = bplib_cache_configure_state(bplib_cache_get_shard(state, i), key, vt, val);
+                    if (result != BP_SUCCESS)
+                    {
+                        break;
+                    }
+                }
+                break;
+
+            case bplib_cache_confkey_stat_entries_idle:
+            case bplib_cache_confkey_stat_entries_queue:
+            case bplib_cache_confkey_stat_entries_delete:
+            case bplib_cache_confkey_stat_fsm_transitions:
+            case bplib_cache_confkey_stat_discards:
+            case bplib_cache_confkey_stat_stored_bytes:
+            case bplib_cache_confkey_stat_entries_offloaded:
+            case bplib_cache_confkey_stat_entries_resident:
+            case bplib_cache_confkey_stat_pending:
+            case bplib_cache_confkey_stat_dacs_open:
+            case bplib_cache_confkey_stat_dacs_closed:
+            case bplib_cache_confkey_stat_custody_hold_time:
+            case bplib_cache_confkey_stat_evictions:
+            case bplib_cache_confkey_stat_evict_releases:
+            case bplib_cache_confkey_stat_footprint_bytes:
+            case bplib_cache_confkey_stat_footprint_blocks:
+            case bplib_cache_confkey_stat_footprint_bytes_max:
+            case bplib_cache_confkey_stat_footprint_blocks_max:
+                /* these are counted by the cache, they cannot be set */
+                break;
+
+            default:
+                /* currently the only module is offload, so all other keys are passed here */
+                if (state->offload_blk != NULL)
+                {
+                    result = state->offload_api->std.configure(state->offload_blk, key, vt, val);
+                }
+                break;
         }
     }
 
     return result;
 }
+
+/*
+ * The value of a stat key for a single shard, keys not known give 0
+ */
+static uint64_t bplib_cache_stat_value(const bplib_cache_state_t *shard, int key)
+{
+    uint64_t                  value;
+    bplib_cache_entry_state_t fsm_state;
+
+    value = 0;
+    switch (key)
+    {
+        case bplib_cache_confkey_stat_entries_idle:
+            value = (uint32_t)(shard->fsm_state_enter_count[bplib_cache_entry_state_idle] -
+                               shard->fsm_state_exit_count[bplib_cache_entry_state_idle]);
+            break;
+        case bplib_cache_confkey_stat_entries_queue:
+            value = (uint32_t)(shard->fsm_state_enter_count[bplib_cache_entry_state_queue] -
+                               shard->fsm_state_exit_count[bplib_cache_entry_state_queue]);
+            break;
+        case bplib_cache_confkey_stat_entries_delete:
+            value = (uint32_t)(shard->fsm_state_enter_count[bplib_cache_entry_state_delete] -
+                               shard->fsm_state_exit_count[bplib_cache_entry_state_delete]);
+            break;
+        case bplib_cache_confkey_stat_dacs_open:
+            value = (uint32_t)(shard->fsm_state_enter_count[bplib_cache_entry_state_generate_dacs] -
+                               shard->fsm_state_exit_count[bplib_cache_entry_state_generate_dacs]);
+            break;
+        case bplib_cache_confkey_stat_fsm_transitions:
+            for (fsm_state = 0; fsm_state < bplib_cache_entry_state_max; ++fsm_state)
+            {
+                value += shard->fsm_state_exit_count[fsm_state];
+            }
+            break;
+        case bplib_cache_confkey_stat_discards:
+            value = shard->discard_count;
+            break;
+        case bplib_cache_confkey_stat_stored_bytes:
+            value = shard->stored_bytes;
+            break;
+        case bplib_cache_confkey_stat_entries_offloaded:
+            value = shard->offloaded_count;
+            break;
+        case bplib_cache_confkey_stat_entries_resident:
+            value = shard->resident_count;
+            break;
+        case bplib_cache_confkey_stat_pending:
+            value = shard->pending_count;
+            break;
+        case bplib_cache_confkey_stat_dacs_closed:
+            value = shard->dacs_closed_count;
+            break;
+        case bplib_cache_confkey_stat_evictions:
+            value = shard->evict_count;
+            break;
+        case bplib_cache_confkey_stat_evict_releases:
+            value = shard->evict_release_count;
+            break;
+        default:
+            break;
+    }
+
+    return value;
+}
+
+/*
+ * The average or the largest footprint over all of the shards, of the class set by
+ * bplib_cache_confkey_footprint_class or of every class, 0 until a bundle is stored
+ */
+static uint64_t bplib_cache_query_footprint(bplib_cache_state_t *state, int key)
+{
+    const bplib_cache_state_t *shard;
+    uint64_t                   total;
+    uint64_t                   count;
+    uint32_t                   i;
+    int                        fp_class;
+
+    total = 0;
+    count = 0;
+    for (i = 0; i <= state->num_shards; ++i)
+    {
+        shard = bplib_cache_get_shard(state, i);
+        for (fp_class = 0; fp_class < BP_CACHE_FOOTPRINT_CLASSES; ++fp_class)
+        {
+            if (state->footprint_class >= 0 && fp_class != state->footprint_class)
+            {
+                continue;
+            }
+
+            switch (key)
+            {
+                case bplib_cache_confkey_stat_footprint_bytes:
+                    total += shard->footprint_bytes[fp_class];
+                    count += shard->footprint_count[fp_class];
+                    break;
+                case bplib_cache_confkey_stat_footprint_blocks:
+                    total += shard->footprint_blocks[fp_class];
+                    count += shard->footprint_count[fp_class];
+                    break;
+                case bplib_cache_confkey_stat_footprint_bytes_max:
+                    if (shard->footprint_bytes_max[fp_class] > total)
+                    {
+                        total = shard->footprint_bytes_max[fp_class];
+                    }
+                    break;
+                case bplib_cache_confkey_stat_footprint_blocks_max:
+                    if (shard->footprint_blocks_max[fp_class] > total)
+                    {
+                        total = shard->footprint_blocks_max[fp_class];
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    /* only the averages have a count */
+    if (count != 0)
+    {
+        total /= count;
+    }
+
+    return total;
+}
+
+/*
+ * Totals a stat key over all of the shards into the value returned by the query
+ */
+static void bplib_cache_query_stat(bplib_cache_state_t *state, int key)
+{
+    bplib_cache_state_t *shard;
+    uint64_t             total;
+    uint64_t             hold_time;
+    uint64_t             release_count;
+    uint32_t             i;
+
+    total         = 0;
+    hold_time     = 0;
+    release_count = 0;
+    for (i = 0; i <= state->num_shards; ++i)
+    {
+        shard = bplib_cache_get_shard(state, i);
+        total += bplib_cache_stat_value(shard, key);
+        hold_time += shard->custody_hold_time;
+        release_count += shard->custody_release_count;
+    }
+
+    /* the average over every bundle released in any shard, 0 until there are some */
+    if (key == bplib_cache_confkey_stat_custody_hold_time && release_count != 0)
+    {
+        total = hold_time / release_count;
+    }
+
+    if (key >= bplib_cache_confkey_stat_footprint_bytes && key <= bplib_cache_confkey_stat_footprint_blocks_max)
+    {
+        total = bplib_cache_query_footprint(state, key);
+    }
+
+    switch (key)
+    {
+        case bplib_cache_confkey_stat_fsm_transitions:
+        case bplib_cache_confkey_stat_discards:
+        case bplib_cache_confkey_stat_dacs_closed:
+        case bplib_cache_confkey_stat_evictions:
+        case bplib_cache_confkey_stat_evict_releases:
+            /* counts of things that have happened, these wrap */
+            state->query_value = (int)(total & INT_MAX);
+            break;
+
+        default:
+            /* amounts held right now, these can only get as high as the largest int */
+            if (total > INT_MAX)
+            {
+                total = INT_MAX;
+            }
+            state->query_value = (int)total;
+            break;
+    }
+}
+
 int bplib_cache_query(bplib_routetbl_t *tbl, bp_handle_t module_intf_id, int key, bplib_cache_module_valtype_t vt,
                       const void **val)
 {
@@ -572,13 +1879,92 @@ int bplib_cache_query(bplib_routetbl_t *tbl, bp_handle_t module_intf_id, int key
 
     result = BP_ERROR;
     cblk   = bplib_mpool_block_from_external_id(bplib_route_get_mpool(tbl), module_intf_id);
-    state  = bplib_mpool_generic_data_cast(cblk, BPLIB_STORE_SIGNATURE_STATE);
+    state  = bplib_cache_get_state(cblk);
     if (state != NULL)
     {
-        /* currently the only module is offload, so all keys are passed here */
-        if (state->offload_blk != NULL)
+        switch (key)
         {
-            result = state->offload_api->std.query(state->offload_blk, key, vt, val);
+            case bplib_cache_confkey_dacs_open_time:
+            case bplib_cache_confkey_dacs_lifetime:
+            case bplib_cache_confkey_dacs_max_entries:
+            case bplib_cache_confkey_dacs_max_bytes:
+            case bplib_cache_confkey_dacs_ack_threshold:
+                result = bplib_cache_custody_query_dacs(state, key, vt, val);
+                break;
+
+            case bplib_cache_confkey_stat_entries_idle:
+            case bplib_cache_confkey_stat_entries_queue:
+            case bplib_cache_confkey_stat_entries_delete:
+            case bplib_cache_confkey_stat_fsm_transitions:
+            case bplib_cache_confkey_stat_discards:
+            case bplib_cache_confkey_stat_stored_bytes:
+            case bplib_cache_confkey_stat_entries_offloaded:
+            case bplib_cache_confkey_stat_entries_resident:
+            case bplib_cache_confkey_stat_pending:
+            case bplib_cache_confkey_stat_dacs_open:
+            case bplib_cache_confkey_stat_dacs_closed:
+            case bplib_cache_confkey_stat_custody_hold_time:
+            case bplib_cache_confkey_stat_evictions:
+            case bplib_cache_confkey_stat_evict_releases:
+            case bplib_cache_confkey_stat_footprint_bytes:
+            case bplib_cache_confkey_stat_footprint_blocks:
+            case bplib_cache_confkey_stat_footprint_bytes_max:
+            case bplib_cache_confkey_stat_footprint_blocks_max:
+                if (vt == bplib_cache_module_valtype_integer && val != NULL)
+                {
+                    bplib_cache_query_stat(state, key);
+                    *val   = &state->query_value;
+                    result = BP_SUCCESS;
+                }
+                break;
+
+            case bplib_cache_confkey_resident_budget:
+                if (vt == bplib_cache_module_valtype_integer && val != NULL)
+                {
+                    *val   = &state->resident_budget;
+                    result = BP_SUCCESS;
+                }
+                break;
+
+            case bplib_cache_confkey_prefetch_depth:
+                if (vt == bplib_cache_module_valtype_integer && val != NULL)
+                {
+                    *val   = &state->prefetch_depth;
+                    result = BP_SUCCESS;
+                }
+                break;
+
+            case bplib_cache_confkey_flush_limit:
+                if (vt == bplib_cache_module_valtype_integer && val != NULL)
+                {
+                    *val   = &state->flush_limit;
+                    result = BP_SUCCESS;
+                }
+                break;
+
+            case bplib_cache_confkey_memory_custody:
+                if (vt == bplib_cache_module_valtype_integer && val != NULL)
+                {
+                    *val   = &state->memory_custody;
+                    result = BP_SUCCESS;
+                }
+                break;
+
+            case bplib_cache_confkey_footprint_class:
+                if (vt == bplib_cache_module_valtype_integer && val != NULL)
+                {
+                    *val   = &state->footprint_class;
+                    result = BP_SUCCESS;
+                }
+                break;
+
+            default:
+                /* currently the only module is offload, so all other keys are passed here */
+                if (state->offload_blk != NULL)
+                {
+                    result = state->offload_api->std.query(state->offload_blk, key, vt, val);
+                }
+                break;
         }
     }
 
@@ -590,10 +1976,11 @@ int bplib_cache_start(bplib_routetbl_t *tbl, bp_handle_t module_intf_id)
     bplib_mpool_block_t *cblk;
     bplib_cache_state_t *state;
     int                  result;
+    uint32_t             i;
 
     result = BP_ERROR;
     cblk   = bplib_mpool_block_from_external_id(bplib_route_get_mpool(tbl), module_intf_id);
-    state  = bplib_mpool_generic_data_cast(cblk, BPLIB_STORE_SIGNATURE_STATE);
+    state  = bplib_cache_get_state(cblk);
     if (state != NULL)
     {
         /* currently the only module is offload, so all keys are passed here */
@@ -601,6 +1988,18 @@ int bplib_cache_start(bplib_routetbl_t *tbl, bp_handle_t module_intf_id)
         {
             result = state->offload_api->std.start(state->offload_blk);
         }
+
+        /* whatever the module still holds from before a restart is tracked again, left where it is */
+        if (result == BP_SUCCESS && state->offload_api->recover != NULL)
+        {
+            result = state->offload_api->recover(state->offload_blk, bplib_cache_recover_entry, state);
+
+            /* whatever was recovered is indexed even if the module stopped partway */
+            for (i = 0; i <= state->num_shards; ++i)
+            {
+                bplib_cache_custody_finish_recovery(bplib_cache_get_shard(state, i));
+            }
+        }
     }
 
     return result;
@@ -611,15 +2010,22 @@ int bplib_cache_stop(bplib_routetbl_t *tbl, bp_handle_t module_intf_id)
     bplib_mpool_block_t *cblk;
     bplib_cache_state_t *state;
     int                  result;
+    uint32_t             i;
 
     result = BP_ERROR;
     cblk   = bplib_mpool_block_from_external_id(bplib_route_get_mpool(tbl), module_intf_id);
-    state  = bplib_mpool_generic_data_cast(cblk, BPLIB_STORE_SIGNATURE_STATE);
+    state  = bplib_cache_get_state(cblk);
     if (state != NULL)
     {
         /* currently the only module is offload, so all keys are passed here */
         if (state->offload_blk != NULL)
         {
+            /* anything still waiting to be written out goes before the module stops */
+            for (i = 0; i <= state->num_shards; ++i)
+            {
+                bplib_cache_offload_waiting(bplib_cache_get_shard(state, i));
+            }
+
             result = state->offload_api->std.stop(state->offload_blk);
         }
     }
@@ -641,10 +2047,27 @@ void bplib_cache_debug_fsm_state_print_impl(bplib_cache_state_t *state, bplib_ca
             (unsigned long)exitcount, (unsigned long)(entercount - exitcount));
 }
 
+static void bplib_cache_debug_rtt_print(const bplib_cache_state_t *state)
+{
+    uint32_t i;
+
+    for (i = 0; i < BP_CACHE_RTT_MAX_INTF; ++i)
+    {
+        if (bp_handle_is_valid(state->rtt_estimates[i].egress_intf_id))
+        {
+            fprintf(stderr, " RTT ESTIMATE: egress_intf_id=%d srtt=%lu rttvar=%lu\n",
+                    bp_handle_printable(state->rtt_estimates[i].egress_intf_id),
+                    (unsigned long)state->rtt_estimates[i].srtt, (unsigned long)state->rtt_estimates[i].rttvar);
+        }
+    }
+}
+
 void bplib_cache_debug_scan(bplib_routetbl_t *tbl, bp_handle_t intf_id)
 {
     bplib_mpool_ref_t    intf_block_ref;
     bplib_cache_state_t *state;
+    bplib_cache_state_t *shard;
+    uint32_t             i;
 
     intf_block_ref = bplib_route_get_intf_controlblock(tbl, intf_id);
     if (intf_block_ref == NULL)
@@ -662,12 +2085,22 @@ void bplib_cache_debug_scan(bplib_routetbl_t *tbl, bp_handle_t intf_id)
 
     fprintf(stderr, "DEBUG: %s() intf_id=%d\n", __func__, bp_handle_printable(intf_id));
 
-    bplib_cache_debug_fsm_state_print(state, bplib_cache_entry_state_undefined);
-    bplib_cache_debug_fsm_state_print(state, bplib_cache_entry_state_idle);
-    bplib_cache_debug_fsm_state_print(state, bplib_cache_entry_state_queue);
-    bplib_cache_debug_fsm_state_print(state, bplib_cache_entry_state_delete);
-    bplib_cache_debug_fsm_state_print(state, bplib_cache_entry_state_generate_dacs);
-    fprintf(stderr, " DISCARDED BUNDLES: %lu\n\n", (unsigned long)state->discard_count);
+    for (i = 0; i <= state->num_shards; ++i)
+    {
+        shard = bplib_cache_get_shard(state, i);
+        if (state->num_shards != 0)
+        {
+            fprintf(stderr, " SHARD %lu:\n", (unsigned long)i);
+        }
+
+        bplib_cache_debug_fsm_state_print(shard, bplib_cache_entry_state_undefined);
+        bplib_cache_debug_fsm_state_print(shard, bplib_cache_entry_state_idle);
+        bplib_cache_debug_fsm_state_print(shard, bplib_cache_entry_state_queue);
+        bplib_cache_debug_fsm_state_print(shard, bplib_cache_entry_state_delete);
+        bplib_cache_debug_fsm_state_print(shard, bplib_cache_entry_state_generate_dacs);
+        bplib_cache_debug_rtt_print(shard);
+        fprintf(stderr, " DISCARDED BUNDLES: %lu\n\n", (unsigned long)shard->discard_count);
+    }
 
     bplib_route_release_intf_controlblock(tbl, intf_block_ref);
 }
@@ -25,6 +25,7 @@ static const bplib_crc_parameters_t *const BPLIB_CACHE_CUSTODY_HASH_ALGORITHM =
 
 static const uint32_t BPLIB_CACHE_CUSTODY_HASH_SALT_DACS   = 0x3126c0cf;
 static const uint32_t BPLIB_CACHE_CUSTODY_HASH_SALT_BUNDLE = 0x7739ae76;
+static const uint32_t BPLIB_CACHE_CUSTODY_HASH_SALT_FLOW   = 0x5a1c83e9;
 
 void bplib_cache_custody_insert_tracking_block(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
                                                bplib_cache_custodian_info_t *custody_info)
@@ -46,17 +47,14 @@ void bplib_cache_custody_insert_tracking_block(bplib_cache_state_t *state, bplib
     }
 }
 
-int bplib_cache_custody_find_dacs_match(const bplib_rbt_link_t *node, void *arg)
+int bplib_cache_custody_find_dacs_match(const bplib_cache_entry_t *store_entry, void *arg)
 {
-    bplib_cache_entry_t          *store_entry;
-    bplib_cache_dacs_pending_t   *dacs_pending;
-    bplib_cache_custodian_info_t *custody_info;
-    int                           result;
+    const bplib_cache_dacs_pending_t *dacs_pending;
+    bplib_cache_custodian_info_t     *custody_info;
+    int                               result;
 
     custody_info = arg;
 
-    store_entry = bplib_cache_entry_from_link(node, hash_rbt_link);
-
     /* everything in here should be a DACS, assert on it for now */
     assert(store_entry->state == bplib_cache_entry_state_generate_dacs);
 
@@ -77,8 +75,7 @@ int bplib_cache_custody_find_dacs_match(const bplib_rbt_link_t *node, void *arg)
 
 bool bplib_cache_custody_find_pending_dacs(bplib_cache_state_t *state, bplib_cache_custodian_info_t *dacs_info)
 {
-    bplib_rbt_link_t *custody_rbt_link;
-    bp_crcval_t       hash;
+    bp_crcval_t hash;
 
     /* use a CRC as a hash function */
     /* when searching for DACS this includes flow and custodian but NOT sequence number (which has multiple values) */
@@ -90,15 +87,11 @@ bool bplib_cache_custody_find_pending_dacs(bplib_cache_state_t *state, bplib_cac
                             sizeof(BPLIB_CACHE_CUSTODY_HASH_SALT_DACS));
     dacs_info->eid_hash = bplib_crc_finalize(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash);
 
-    custody_rbt_link = bplib_rbt_search_generic(dacs_info->eid_hash, &state->dacs_index,
-                                                bplib_cache_custody_find_dacs_match, dacs_info);
-    if (custody_rbt_link != NULL)
-    {
-        /* its a complete match */
-        dacs_info->store_entry = bplib_cache_entry_from_link(custody_rbt_link, hash_rbt_link);
-    }
+    /* if found, its a complete match */
+    dacs_info->store_entry = bplib_cache_hash_search(&state->dacs_index, dacs_info->eid_hash,
+                                                     bplib_cache_custody_find_dacs_match, dacs_info);
 
-    return (custody_rbt_link != NULL);
+    return (dacs_info->store_entry != NULL);
 }
 
 void bplib_cache_custody_init_info_from_pblock(bplib_cache_custodian_info_t *custody_info,
@@ -119,13 +112,17 @@ void bplib_cache_custody_init_info_from_pblock(bplib_cache_custodian_info_t *cus
     if (custody_info->prev_cblk != NULL)
     {
         custody_block = bplib_mpool_bblock_canonical_cast(custody_info->prev_cblk);
-        if (custody_block != NULL)
+        if (custody_block != NULL && v7_block_decode_canonical_data(custody_block) != 0)
+        {
+            /* without the previous custodian there is nobody to acknowledge, so treat it as absent */
+            bplog(NULL, BP_FLAG_INCOMPLETE, "Custody tracking block did not decode\n");
+            custody_info->prev_cblk = NULL;
+        }
+        else if (custody_block != NULL)
         {
             /* need to generate a DACS back to the previous custodian indicated in the custody block */
             v7_get_eid(&custody_info->custodian_id,
                        &custody_block->canonical_logical_data.data.custody_tracking_block.current_custodian);
-
-            custody_block->canonical_logical_data.canonical_block.blockType = bp_blocktype_previousCustodianBlock;
         }
     }
 }
@@ -170,10 +167,10 @@ bplib_mpool_ref_t bplib_cache_custody_create_dacs(bplib_cache_state_t
         v7_set_eid(&pri->reportEID, &state->self_addr);
 
         pri->creationTimeStamp.sequence_num = state->generated_dacs_seq;
-        ++state->generated_dacs_seq;
+        state->generated_dacs_seq += state->generated_dacs_seq_step;
         pri->creationTimeStamp.time = v7_get_current_time();
 
-        pri->lifetime                     = BP_CACHE_DACS_LIFETIME;
+        pri->lifetime                     = state->dacs_config.lifetime;
         pri->controlFlags.isAdminRecord   = true;
         pri->controlFlags.mustNotFragment = true;
         pri->crctype                      = bp_crctype_CRC16;
@@ -244,14 +241,21 @@ void bplib_cache_custody_open_dacs(bplib_cache_state_t *state, bplib_cache_custo
 
         store_entry->state = bplib_cache_entry_state_generate_dacs;
         ++state->fsm_state_enter_count[store_entry->state];
+        BPLIB_TRACEPOINT(dacs_generate,
+                         BPLIB_TRACEPOINT_FLOW(custody_info->flow_id.node_number, custody_info->flow_id.service_number),
+                         custody_info->sequence_num, custody_info->custodian_id.node_number);
 
         /* the "action_time" reflects when this bundle will be finalized and sent, until
          * then it is open for appending with additional sequence numbers. */
-        store_entry->action_time   = pri_block->data.delivery.ingress_time + BP_CACHE_DACS_OPEN_TIME;
-        store_entry->expire_time   = pri_block->data.delivery.ingress_time + BP_CACHE_DACS_LIFETIME;
+        store_entry->action_time   = pri_block->data.delivery.ingress_time + state->dacs_config.open_time;
+        store_entry->expire_time   = pri_block->data.delivery.ingress_time + state->dacs_config.lifetime;
         store_entry->flow_id_copy  = state->self_addr;
         store_entry->flow_seq_copy = pri_block->data.logical.creationTimeStamp.sequence_num;
         store_entry->refptr        = bplib_mpool_ref_duplicate(pending_bundle);
+        if (store_entry->refptr != NULL)
+        {
+            ++state->resident_count;
+        }
 
         /* the ack will be sent to the previous custodian of record */
         v7_set_eid(&pri_block->data.logical.destinationEID, &custody_info->custodian_id);
@@ -261,10 +265,18 @@ void bplib_cache_custody_open_dacs(bplib_cache_state_t *state, bplib_cache_custo
          * so these don't need to be re-found when they are needed again later */
         dacs_pending              = &store_entry->data.dacs;
         dacs_pending->payload_ref = ack_content;
+        dacs_pending->window_runs = 0;
+        dacs_pending->seq_count   = 0;
+        memset(dacs_pending->window, 0, sizeof(dacs_pending->window));
         v7_get_eid(&dacs_pending->prev_custodian_id, &pri_block->data.logical.destinationEID);
 
-        bplib_rbt_insert_value_generic(custody_info->eid_hash, &state->dacs_index, &store_entry->hash_rbt_link,
-                                       bplib_cache_custody_find_dacs_match, custody_info);
+        if (bplib_cache_hash_insert(&state->dacs_index, custody_info->eid_hash, store_entry) != BP_SUCCESS)
+        {
+            /* the DACS still goes out, but nothing more can be appended to it */
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to index new DACS\n");
+        }
+        bplib_rbt_insert_value_generic(custody_info->custodian_id.node_number, &state->dest_eid_jphfix_index,
+                                       &store_entry->dest_eid_rbt_link, bplib_cache_entry_tree_insert_unsorted, NULL);
         bplib_cache_entry_make_pending(
             store_entry, BPLIB_STORE_FLAG_ACTIVITY | BPLIB_STORE_FLAG_LOCAL_CUSTODY | BPLIB_STORE_FLAG_ACTION_TIME_WAIT,
             0);
@@ -285,32 +297,269 @@ void bplib_cache_custody_open_dacs(bplib_cache_state_t *state, bplib_cache_custo
     bplib_mpool_ref_release(pending_bundle);
 }
 
-void bplib_cache_custody_append_dacs(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info)
+/*
+ * The encoded size of a CBOR unsigned integer
+ */
+static size_t bplib_cache_custody_cbor_uint_size(bp_integer_t value)
+{
+    if (value < 24)
+    {
+        return 1;
+    }
+    if (value <= UINT8_MAX)
+    {
+        return 2;
+    }
+    if (value <= UINT16_MAX)
+    {
+        return 3;
+    }
+    if (value <= UINT32_MAX)
+    {
+        return 5;
+    }
+    return 9;
+}
+
+/*
+ * The number of ranges an open DACS may have, as configured.  A byte limit is turned into a number
+ * of ranges by assuming every range is as big as a range near this sequence number can be.
+ */
+static bp_integer_t bplib_cache_custody_dacs_range_limit(const bplib_cache_state_t *state, bp_sequencenumber_t seq)
+{
+    bp_integer_t limit;
+    bp_integer_t size_limit;
+
+    limit = state->dacs_config.max_entries;
+    if (state->dacs_config.max_bytes > 0)
+    {
+        /* an array head, the first sequence number, and a count, which is never more than 3 bytes */
+        size_limit = state->dacs_config.max_bytes / (1 + bplib_cache_custody_cbor_uint_size(seq) + 3);
+        if (size_limit < limit)
+        {
+            limit = size_limit;
+        }
+    }
+
+    /* there is always room for one, otherwise nothing could be acknowledged at all */
+    if (limit == 0)
+    {
+        limit = 1;
+    }
+
+    return limit;
+}
+
+/*
+ * Adds a sequence number to the ranges in a DACS payload.  Returns false if it needs a new range
+ * and there is no room for one, allowing for the runs in the window that will become ranges.
+ */
+static bool bplib_cache_custody_add_dacs_range_seq(bplib_cache_dacs_pending_t *dacs, bp_sequencenumber_t seq,
+                                                   bp_integer_t limit)
 {
     bp_custody_accept_payload_block_t *payload;
+    bp_custody_seq_range_t            *range;
     bp_integer_t                       i;
 
-    if (custody_info->store_entry != NULL)
+    payload = dacs->payload_ref;
+
+    /* check if this seq is already in the payload, this can happen if a duplicate is recvd */
+    for (i = 0; i < payload->num_entries; ++i)
     {
-        payload = custody_info->store_entry->data.dacs.payload_ref;
+        range = &payload->ranges[i];
+        if (seq >= range->first_seq && (seq - range->first_seq) < range->count)
+        {
+            return true;
+        }
+    }
 
-        /* check if this seq is already in the payload, this can happen if a duplicate is recvd */
-        for (i = 0; i < payload->num_entries; ++i)
+    for (i = 0; i < payload->num_entries; ++i)
+    {
+        range = &payload->ranges[i];
+        if (range->count < BP_DACS_MAX_SEQ_PER_RANGE)
         {
-            if (payload->sequence_nums[i] == custody_info->sequence_num)
+            if (seq == (range->first_seq + range->count))
+            {
+                ++range->count;
+                ++dacs->seq_count;
+                return true;
+            }
+
+            if ((seq + 1) == range->first_seq)
             {
-                break;
+                --range->first_seq;
+                ++range->count;
+                ++dacs->seq_count;
+                return true;
             }
         }
+    }
+
+    if ((payload->num_entries + dacs->window_runs) >= limit)
+    {
+        return false;
+    }
+
+    range            = &payload->ranges[payload->num_entries];
+    range->first_seq = seq;
+    range->count     = 1;
+    ++payload->num_entries;
+    ++dacs->seq_count;
+
+    return true;
+}
+
+static inline bool bplib_cache_custody_test_dacs_window(const bplib_cache_dacs_pending_t *dacs, uint32_t bit)
+{
+    return (dacs->window[bit / 32] >> (bit % 32)) & 1;
+}
+
+/*
+ * Turns the runs of set bits in the window into ranges in the DACS payload, and empties the window.
+ * There is always room, as every run is counted against the payload when its first bit is set.
+ */
+static void bplib_cache_custody_flush_dacs_window(bplib_cache_dacs_pending_t *dacs)
+{
+    bp_custody_accept_payload_block_t *payload;
+    bp_custody_seq_range_t            *range;
+    bp_integer_t                       first_seq;
+    uint32_t                           start;
+    uint32_t                           bit;
+
+    payload = dacs->payload_ref;
+    bit     = 0;
+    while (dacs->window_runs > 0 && bit < BP_CACHE_DACS_WINDOW_BITS)
+    {
+        if (dacs->window[bit / 32] == 0)
+        {
+            /* a whole word of nothing, which is common at the end of the window */
+            bit = (bit | 31) + 1;
+            continue;
+        }
 
-        if (i == payload->num_entries && i < BP_DACS_MAX_SEQ_PER_PAYLOAD)
+        if (!bplib_cache_custody_test_dacs_window(dacs, bit))
+        {
+            ++bit;
+            continue;
+        }
+
+        start = bit;
+        while (bit < BP_CACHE_DACS_WINDOW_BITS && bplib_cache_custody_test_dacs_window(dacs, bit))
+        {
+            ++bit;
+        }
+
+        first_seq = dacs->window_base + start;
+        range     = NULL;
+        if (payload->num_entries > 0)
+        {
+            range = &payload->ranges[payload->num_entries - 1];
+        }
+
+        /* in steady state this run carries on from the last one flushed */
+        if (range != NULL && (range->first_seq + range->count) == first_seq &&
+            (range->count + (bit - start)) <= BP_DACS_MAX_SEQ_PER_RANGE)
+        {
+            range->count += bit - start;
+        }
+        else if (payload->num_entries < BP_DACS_MAX_SEQ_PER_PAYLOAD)
         {
-            payload->sequence_nums[i] = custody_info->sequence_num;
+            range            = &payload->ranges[payload->num_entries];
+            range->first_seq = first_seq;
+            range->count     = bit - start;
             ++payload->num_entries;
         }
 
-        /* if DACS bundle is full now, mark it as "done" */
-        if (payload->num_entries == BP_DACS_MAX_SEQ_PER_PAYLOAD)
+        --dacs->window_runs;
+    }
+
+    memset(dacs->window, 0, sizeof(dacs->window));
+    dacs->window_runs = 0;
+}
+
+/*
+ * Adds a sequence number to an open DACS, which may have up to limit ranges.  Returns false if there
+ * is no room for it.
+ */
+static bool bplib_cache_custody_add_dacs_seq(bplib_cache_dacs_pending_t *dacs, bp_sequencenumber_t seq,
+                                             bp_integer_t limit)
+{
+    uint32_t bit;
+    uint32_t runs;
+
+    if (dacs->window_runs == 0)
+    {
+        dacs->window_base = seq;
+    }
+    else if (seq >= dacs->window_base && (seq - dacs->window_base) >= BP_CACHE_DACS_WINDOW_BITS)
+    {
+        /* too far ahead, so the window moves up to it */
+        bplib_cache_custody_flush_dacs_window(dacs);
+        dacs->window_base = seq;
+    }
+
+    if (seq < dacs->window_base)
+    {
+        /* older than anything in the window, which is only when bundles arrive out of order */
+        return bplib_cache_custody_add_dacs_range_seq(dacs, seq, limit);
+    }
+
+    bit = seq - dacs->window_base;
+    if (bplib_cache_custody_test_dacs_window(dacs, bit))
+    {
+        /* duplicate */
+        return true;
+    }
+
+    /* a new bit is a run of its own, unless it joins up with the bits either side of it */
+    runs = dacs->window_runs + 1;
+    if (bit > 0 && bplib_cache_custody_test_dacs_window(dacs, bit - 1))
+    {
+        --runs;
+    }
+    if ((bit + 1) < BP_CACHE_DACS_WINDOW_BITS && bplib_cache_custody_test_dacs_window(dacs, bit + 1))
+    {
+        --runs;
+    }
+
+    if ((dacs->payload_ref->num_entries + runs) > limit)
+    {
+        return false;
+    }
+
+    dacs->window[bit / 32] |= (uint32_t)1 << (bit % 32);
+    dacs->window_runs = runs;
+    ++dacs->seq_count;
+
+    return true;
+}
+
+void bplib_cache_custody_append_dacs(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info)
+{
+    bp_integer_t limit;
+
+    if (custody_info->store_entry != NULL)
+    {
+        limit = bplib_cache_custody_dacs_range_limit(state, custody_info->sequence_num);
+        if (!bplib_cache_custody_add_dacs_seq(&custody_info->store_entry->data.dacs, custody_info->sequence_num,
+                                              limit))
+        {
+            /* no room for another range, so this DACS bundle is "done" and the seq goes in a new one */
+            bplib_cache_custody_finalize_dacs(state, custody_info->store_entry);
+            bplib_cache_entry_make_pending(custody_info->store_entry, 0, BPLIB_STORE_FLAG_ACTION_TIME_WAIT);
+
+            custody_info->store_entry = NULL;
+            bplib_cache_custody_open_dacs(state, custody_info);
+            if (custody_info->store_entry != NULL)
+            {
+                bplib_cache_custody_add_dacs_seq(&custody_info->store_entry->data.dacs, custody_info->sequence_num,
+                                                 limit);
+            }
+        }
+
+        /* with enough waiting on it, the DACS goes now rather than at the end of the open time */
+        if (custody_info->store_entry != NULL && state->dacs_config.ack_threshold > 0 &&
+            custody_info->store_entry->data.dacs.seq_count >= (uint32_t)state->dacs_config.ack_threshold)
         {
             bplib_cache_custody_finalize_dacs(state, custody_info->store_entry);
             bplib_cache_entry_make_pending(custody_info->store_entry, 0, BPLIB_STORE_FLAG_ACTION_TIME_WAIT);
@@ -318,6 +567,103 @@ void bplib_cache_custody_append_dacs(bplib_cache_state_t *state, bplib_cache_cus
     }
 }
 
+void bplib_cache_custody_init_dacs_config(bplib_cache_dacs_config_t *config)
+{
+    config->open_time     = BP_CACHE_DACS_OPEN_TIME;
+    config->lifetime      = BP_CACHE_DACS_LIFETIME;
+    config->max_entries   = BP_DACS_MAX_SEQ_PER_PAYLOAD;
+    config->max_bytes     = 0;
+    config->ack_threshold = 0;
+}
+
+int bplib_cache_custody_configure_dacs(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+                                       const void *val)
+{
+    bplib_cache_dacs_config_t config;
+    int                       value;
+
+    if (vt != bplib_cache_module_valtype_integer || val == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    value  = *((const int *)val);
+    config = state->dacs_config;
+    switch (key)
+    {
+        case bplib_cache_confkey_dacs_open_time:
+            config.open_time = value;
+            break;
+        case bplib_cache_confkey_dacs_lifetime:
+            config.lifetime = value;
+            break;
+        case bplib_cache_confkey_dacs_max_entries:
+            config.max_entries = value;
+            break;
+        case bplib_cache_confkey_dacs_max_bytes:
+            config.max_bytes = value;
+            break;
+        case bplib_cache_confkey_dacs_ack_threshold:
+            config.ack_threshold = value;
+            break;
+        default:
+            return BP_ERROR;
+    }
+
+    /* a DACS has to be open for a while and then live long enough to be sent */
+    if (config.open_time < 0 || config.lifetime <= config.open_time || config.max_entries < 1 ||
+        config.max_entries > BP_DACS_MAX_SEQ_PER_PAYLOAD || config.max_bytes < 0 || config.ack_threshold < 0)
+    {
+        return BP_ERROR;
+    }
+
+    state->dacs_config = config;
+    return BP_SUCCESS;
+}
+
+int bplib_cache_custody_query_dacs(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+                                   const void **val)
+{
+    if (vt != bplib_cache_module_valtype_integer || val == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    switch (key)
+    {
+        case bplib_cache_confkey_dacs_open_time:
+            *val = &state->dacs_config.open_time;
+            break;
+        case bplib_cache_confkey_dacs_lifetime:
+            *val = &state->dacs_config.lifetime;
+            break;
+        case bplib_cache_confkey_dacs_max_entries:
+            *val = &state->dacs_config.max_entries;
+            break;
+        case bplib_cache_confkey_dacs_max_bytes:
+            *val = &state->dacs_config.max_bytes;
+            break;
+        case bplib_cache_confkey_dacs_ack_threshold:
+            *val = &state->dacs_config.ack_threshold;
+            break;
+        default:
+            return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+static void bplib_cache_custody_ack_custodian(bplib_cache_state_t *state, bplib_cache_custodian_info_t *dacs_info)
+{
+    if (!bplib_cache_custody_find_pending_dacs(state, dacs_info))
+    {
+        /* open DACS bundle did not exist - make an empty one now */
+        bplib_cache_custody_open_dacs(state, dacs_info);
+    }
+
+    bplib_cache_custody_append_dacs(state, dacs_info);
+}
+
 void bplib_cache_custody_ack_tracking_block(bplib_cache_state_t                *state,
                                             const bplib_cache_custodian_info_t *custody_info)
 {
@@ -338,14 +684,57 @@ void bplib_cache_custody_ack_tracking_block(bplib_cache_state_t                *
         dacs_info.sequence_num    = custody_info->sequence_num;
         dacs_info.final_dest_node = custody_info->final_dest_node;
 
-        if (!bplib_cache_custody_find_pending_dacs(state, &dacs_info))
-        {
-            /* open DACS bundle did not exist - make an empty one now */
-            bplib_cache_custody_open_dacs(state, &dacs_info);
-        }
+        bplib_cache_custody_ack_custodian(state, &dacs_info);
+    }
+}
+
+bool bplib_cache_custody_offload_entry(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+{
+    bplib_cache_custodian_info_t  dacs_info;
+    bplib_mpool_bblock_primary_t *pri_block;
+    bplib_mpool_block_t          *qblk;
+    bp_sid_t                      sid;
+
+    qblk      = bplib_mpool_dereference(store_entry->refptr);
+    pri_block = bplib_mpool_bblock_primary_cast(qblk);
+    if (pri_block == NULL || store_entry->offload_sid != 0)
+    {
+        return false;
+    }
+
+    sid = 0;
+    if (state->offload_api->offload(state->offload_blk, &sid, qblk) != BP_SUCCESS)
+    {
+        /* it is still forwarded from memory, but custody of it is never acknowledged */
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unable to offload stored bundle\n");
+        return false;
+    }
+
+    store_entry->offload_sid                      = sid;
+    pri_block->data.delivery.committed_storage_id = sid;
+    ++state->offloaded_count;
 
-        bplib_cache_custody_append_dacs(state, &dacs_info);
+    /* kept in memory, custody is the same as it was before */
+    if (!bplib_cache_offload_is_durable(state))
+    {
+        return true;
+    }
+
+    bplib_dataservice_complete(store_entry->completion_ref, bplib_completion_custody_taken);
+
+    if (store_entry->data.bundle.ack_pending)
+    {
+        memset(&dacs_info, 0, sizeof(dacs_info));
+        dacs_info.custodian_id    = store_entry->data.bundle.prev_custodian_id;
+        dacs_info.flow_id         = store_entry->flow_id_copy;
+        dacs_info.sequence_num    = store_entry->flow_seq_copy;
+        dacs_info.final_dest_node = bplib_rbt_get_key_value(&store_entry->dest_eid_rbt_link);
+
+        store_entry->data.bundle.ack_pending = false;
+        bplib_cache_custody_ack_custodian(state, &dacs_info);
     }
+
+    return true;
 }
 
 void bplib_cache_custody_update_tracking_block(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info)
@@ -364,7 +753,15 @@ void bplib_cache_custody_update_tracking_block(bplib_cache_state_t *state, bplib
 void bplib_cache_custody_process_bundle(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
                                         bplib_cache_custodian_info_t *custody_info)
 {
-    bool is_local;
+    bplib_mpool_bblock_canonical_t *custody_block;
+    bool                            is_local;
+
+    /* this node takes over from the previous custodian, whose block is kept only as a record of it */
+    custody_block = bplib_mpool_bblock_canonical_cast(custody_info->prev_cblk);
+    if (custody_block != NULL)
+    {
+        custody_block->canonical_logical_data.canonical_block.blockType = bp_blocktype_previousCustodianBlock;
+    }
 
     /* check if this is the last stop on the custody train */
     is_local = (custody_info->final_dest_node == state->self_addr.node_number);
@@ -390,15 +787,13 @@ void bplib_cache_custody_process_bundle(bplib_cache_state_t *state, bplib_mpool_
     }
 }
 
-int bplib_cache_custody_find_bundle_match(const bplib_rbt_link_t *node, void *arg)
+int bplib_cache_custody_find_bundle_match(const bplib_cache_entry_t *store_entry, void *arg)
 {
-    bplib_cache_entry_t          *store_entry;
     bplib_cache_custodian_info_t *custody_info;
     int                           result;
 
     /* possible match, but need to verify */
     custody_info = arg;
-    store_entry  = bplib_cache_entry_from_link(node, hash_rbt_link);
 
     result = v7_compare_numeric(custody_info->sequence_num, store_entry->flow_seq_copy);
     if (result == 0)
@@ -411,40 +806,47 @@ int bplib_cache_custody_find_bundle_match(const bplib_rbt_link_t *node, void *ar
 
 bool bplib_cache_custody_find_existing_bundle(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info)
 {
-    bplib_rbt_link_t *custody_rbt_link;
-    bp_crcval_t       hash;
+    bp_crcval_t hash;
 
     /* use a CRC as a hash function */
     /* when searching for bundles this includes flow and sequence number but NOT custodian (which would always be us) */
-    hash = bplib_crc_initial_value(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM);
-    hash = bplib_crc_update(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash, &custody_info->flow_id,
-                            sizeof(custody_info->flow_id));
+    /* the flow part is the same for every sequence number of a DACS, so that is only done once per flow ID */
+    if (!custody_info->flow_hash_seeded)
+    {
+        hash = bplib_crc_initial_value(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM);
+        hash = bplib_crc_update(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash, &custody_info->flow_id,
+                                sizeof(custody_info->flow_id));
+        custody_info->flow_hash_seed   = hash;
+        custody_info->flow_hash_seeded = true;
+    }
+
+    hash = custody_info->flow_hash_seed;
     hash = bplib_crc_update(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash, &custody_info->sequence_num,
                             sizeof(custody_info->sequence_num));
     hash = bplib_crc_update(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash, &BPLIB_CACHE_CUSTODY_HASH_SALT_BUNDLE,
                             sizeof(BPLIB_CACHE_CUSTODY_HASH_SALT_BUNDLE));
     custody_info->eid_hash = bplib_crc_finalize(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash);
 
-    custody_rbt_link = bplib_rbt_search_generic(custody_info->eid_hash, &state->bundle_index,
-                                                bplib_cache_custody_find_bundle_match, custody_info);
-    if (custody_rbt_link != NULL)
+    custody_info->store_entry = bplib_cache_hash_search(&state->bundle_index, custody_info->eid_hash,
+                                                        bplib_cache_custody_find_bundle_match, custody_info);
+    if (custody_info->store_entry != NULL)
     {
-        custody_info->store_entry = bplib_cache_entry_from_link(custody_rbt_link, hash_rbt_link);
-
         /* set the activity flag which tracks that this entry was used for some purpose.
          * this is part of the deletion age-out process, and indicates this should _not_
          * be fully discarded just yet, it still appears to be relevant */
         custody_info->store_entry->flags |= BPLIB_STORE_FLAG_ACTIVITY;
     }
 
-    return (custody_rbt_link != NULL);
+    return (custody_info->store_entry != NULL);
 }
 
 void bplib_cache_custody_process_remote_dacs_bundle(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
                                                     const bp_custody_accept_payload_block_t *ack_payload)
 {
-    bp_integer_t                 i;
-    bplib_cache_custodian_info_t custody_info;
+    bp_integer_t                  i;
+    bp_integer_t                  n;
+    const bp_custody_seq_range_t *range;
+    bplib_cache_custodian_info_t  custody_info;
 
     memset(&custody_info, 0, sizeof(custody_info));
 
@@ -453,27 +855,106 @@ void bplib_cache_custody_process_remote_dacs_bundle(bplib_cache_state_t *state,
 
     for (i = 0; i < ack_payload->num_entries; ++i)
     {
-        custody_info.sequence_num = ack_payload->sequence_nums[i];
-        if (bplib_cache_custody_find_existing_bundle(state, &custody_info))
+        range = &ack_payload->ranges[i];
+        for (n = 0; n < range->count; ++n)
         {
-            /* found it ! */
-            printf("%s(): Got custody ACK for seq %lu\n", __func__, (unsigned long)custody_info.sequence_num);
-
-            /* confirmed that another custodian has the bundle -
-             * can clear the flag that says we are the active custodian, and reevaluate */
-            bplib_cache_entry_make_pending(custody_info.store_entry, 0, BPLIB_STORE_FLAG_LOCAL_CUSTODY);
+            custody_info.sequence_num = range->first_seq + n;
+            if (bplib_cache_custody_find_existing_bundle(state, &custody_info))
+            {
+                /*
+                 * The first ack for a bundle that was only sent once gives the round trip time of
+                 * the interface it went out on.  After a retransmit, there is no telling which of
+                 * the transmits this is the ack for, so those are not used.
+                 */
+                if ((custody_info.store_entry->flags & BPLIB_STORE_FLAG_LOCAL_CUSTODY) != 0 &&
+                    custody_info.store_entry->transmit_count == 1 &&
+                    state->action_time >= custody_info.store_entry->egress_time)
+                {
+                    bplib_cache_rtt_sample(state, custody_info.store_entry->egress_intf_id,
+                                           state->action_time - custody_info.store_entry->egress_time);
+                }
+
+                /* only the first ack ends the time this node held custody, later ones are duplicates */
+                if ((custody_info.store_entry->flags & BPLIB_STORE_FLAG_LOCAL_CUSTODY) != 0)
+                {
+                    state->custody_hold_time += state->action_time - custody_info.store_entry->store_time;
+                    ++state->custody_release_count;
+                    bplib_dataservice_complete(custody_info.store_entry->completion_ref,
+                                               bplib_completion_custody_acked);
+                }
+
+                /* confirmed that another custodian has the bundle -
+                 * can clear the flag that says we are the active custodian, and reevaluate */
+                bplib_cache_entry_make_pending(custody_info.store_entry, 0, BPLIB_STORE_FLAG_LOCAL_CUSTODY);
+            }
         }
     }
 }
 
 void bplib_cache_custody_finalize_dacs(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
 {
+    /* everything acknowledged so far has to be in the payload before it is encoded */
+    if (store_entry->data.dacs.payload_ref != NULL)
+    {
+        bplib_cache_custody_flush_dacs_window(&store_entry->data.dacs);
+    }
+
+    /* the bundles this acknowledges have to be durable before it goes, for a module that batches that up */
+    if (state->offload_api != NULL && state->offload_api->flush != NULL &&
+        state->offload_api->flush(state->offload_blk) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Offloaded bundles could not be flushed before sending DACS\n");
+    }
+
     /* after this point, the entry becomes a normal bundle, it is removed from EID hash
      * so future appends are also prevented */
-    if (bplib_rbt_node_is_member(&state->dacs_index, &store_entry->hash_rbt_link))
+    bplib_cache_hash_remove(&state->dacs_index, store_entry);
+    ++state->dacs_closed_count;
+}
+
+bp_crcval_t bplib_cache_custody_flow_id_hash(const bp_ipn_addr_t *flow_id)
+{
+    bp_crcval_t hash;
+
+    hash = bplib_crc_initial_value(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM);
+    hash = bplib_crc_update(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash, flow_id, sizeof(*flow_id));
+    hash = bplib_crc_update(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash, &BPLIB_CACHE_CUSTODY_HASH_SALT_FLOW,
+                            sizeof(BPLIB_CACHE_CUSTODY_HASH_SALT_FLOW));
+
+    return bplib_crc_finalize(BPLIB_CACHE_CUSTODY_HASH_ALGORITHM, hash);
+}
+
+bp_crcval_t bplib_cache_custody_flow_hash(bplib_mpool_block_t *qblk)
+{
+    bplib_mpool_bblock_primary_t   *pri_block;
+    bplib_mpool_bblock_canonical_t *c_block;
+    bp_ipn_addr_t                   flow_id;
+
+    pri_block = bplib_mpool_bblock_primary_cast(qblk);
+    if (pri_block == NULL)
+    {
+        return 0;
+    }
+
+    /* a DACS goes with the flow it acknowledges, everything else with the flow it is part of */
+    c_block = NULL;
+    if (pri_block->data.logical.controlFlags.isAdminRecord)
+    {
+        c_block = bplib_mpool_bblock_canonical_cast(
+            bplib_mpool_bblock_primary_locate_canonical(pri_block, bp_blocktype_custodyAcceptPayloadBlock));
+    }
+
+    memset(&flow_id, 0, sizeof(flow_id));
+    if (c_block != NULL)
+    {
+        v7_get_eid(&flow_id, &c_block->canonical_logical_data.data.custody_accept_payload_block.flow_source_eid);
+    }
+    else
     {
-        bplib_rbt_extract_node(&state->dacs_index, &store_entry->hash_rbt_link);
+        v7_get_eid(&flow_id, &pri_block->data.logical.sourceEID);
     }
+
+    return bplib_cache_custody_flow_id_hash(&flow_id);
 }
 
 bool bplib_cache_custody_check_dacs(bplib_cache_state_t *state, bplib_mpool_block_t *qblk)
@@ -501,9 +982,13 @@ bool bplib_cache_custody_check_dacs(bplib_cache_state_t *state, bplib_mpool_bloc
 
 void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_block_t *qblk)
 {
-    bplib_mpool_block_t          *sblk;
-    bplib_mpool_bblock_primary_t *pri_block;
-    bplib_cache_custodian_info_t  custody_info;
+    bplib_mpool_block_t            *sblk;
+    bplib_mpool_bblock_primary_t   *pri_block;
+    bplib_mpool_bblock_canonical_t *custody_block;
+    bplib_cache_custodian_info_t    custody_info;
+    bool                            is_custodian;
+    size_t                          footprint_bytes;
+    uint32_t                        footprint_blocks;
 
     memset(&custody_info, 0, sizeof(custody_info));
     sblk      = NULL;
@@ -516,12 +1001,26 @@ void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_bl
 
     bplib_cache_custody_init_info_from_pblock(&custody_info, pri_block);
 
+    /*
+     * Without somewhere durable to keep it, custody is not taken, and the bundle goes on with the custody block
+     * it came with.  The previous custodian is then acknowledged by the next one, and this node only
+     * holds on to the bundle until it is sent, as nothing would ever acknowledge it here.
+     */
+    is_custodian = (bplib_cache_offload_is_durable(state) || state->memory_custody);
+    if (!is_custodian && pri_block->data.delivery.delivery_policy == bplib_policy_delivery_custody_tracking)
+    {
+        pri_block->data.delivery.delivery_policy = bplib_policy_delivery_local_ack;
+    }
+
     if (bplib_cache_custody_find_existing_bundle(state, &custody_info))
     {
         /* found it - do not store again.  This is not necessarily an error, as retransmits/lost ACKs can
          * easily cause duplicate bundles to be seen here. */
         fprintf(stderr, "DEBUG: %s(): Got duplicate for seq %lu\n", __func__, (unsigned long)custody_info.sequence_num);
-        bplib_cache_custody_ack_tracking_block(state, &custody_info);
+        if (is_custodian)
+        {
+            bplib_cache_custody_ack_tracking_block(state, &custody_info);
+        }
         return;
     }
 
@@ -537,6 +1036,24 @@ void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_bl
 
         /* this keeps a copy of the ref here, after qblk is recycled */
         custody_info.store_entry->refptr = bplib_mpool_ref_from_block(qblk);
+        if (custody_info.store_entry->refptr != NULL)
+        {
+            ++state->resident_count;
+        }
+
+        /* this counts for the stored bytes until the entry is gone, whether in memory or offloaded */
+        custody_info.store_entry->stored_size =
+            sizeof(bplib_mpool_bblock_primary_t) + pri_block->bundle_encode_size_cache;
+        custody_info.store_entry->store_time = state->action_time;
+        state->stored_bytes += custody_info.store_entry->stored_size;
+
+        /* the bundle itself may be offloaded and recycled, which must not end the op it was sent by.
+         * Only bundles sent by a data service op have one, not those that came in from a CLA. */
+        if (pri_block->data.delivery.completion_ref != NULL)
+        {
+            custody_info.store_entry->completion_ref =
+                bplib_mpool_ref_duplicate(pri_block->data.delivery.completion_ref);
+        }
 
         bplib_rbt_insert_value_generic(custody_info.final_dest_node, &state->dest_eid_jphfix_index,
                                        &custody_info.store_entry->dest_eid_rbt_link,
@@ -544,9 +1061,12 @@ void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_bl
 
         /* when the custody ACK for this block comes in, this block needs to be found again,
          * so make an entry in the hash index for it */
-        bplib_rbt_insert_value_generic(custody_info.eid_hash, &state->bundle_index,
-                                       &custody_info.store_entry->hash_rbt_link, bplib_cache_custody_find_bundle_match,
-                                       &custody_info);
+        if (bplib_cache_hash_insert(&state->bundle_index, custody_info.eid_hash, custody_info.store_entry) !=
+            BP_SUCCESS)
+        {
+            /* the bundle is still forwarded, but will be retransmitted until it expires */
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to index stored bundle\n");
+        }
 
         custody_info.store_entry->flags |= BPLIB_STORE_FLAG_LOCAL_CUSTODY | BPLIB_STORE_FLAG_ACTIVITY;
         custody_info.store_entry->flow_seq_copy = pri_block->data.logical.creationTimeStamp.sequence_num;
@@ -554,11 +1074,30 @@ void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_bl
         custody_info.store_entry->expire_time =
             pri_block->data.logical.creationTimeStamp.time + pri_block->data.logical.lifetime;
 
+        /* a key of 0 means it is not in the index, which is fine for a time nothing is ever before */
+        if (custody_info.store_entry->expire_time != 0)
+        {
+            bplib_rbt_insert_value_generic(custody_info.store_entry->expire_time, &state->expire_index,
+                                           &custody_info.store_entry->expire_rbt_link,
+                                           bplib_cache_entry_tree_insert_unsorted, NULL);
+        }
+
         pri_block->data.delivery.storage_intf_id = bplib_mpool_get_external_id(bplib_cache_state_self_block(state));
+        pri_block->data.delivery.stage_time[bplib_trace_stage_cache_store] = state->action_time;
+        BPLIB_TRACEPOINT_BUNDLE(cache_store, pri_block, bp_handle_printable(pri_block->data.delivery.storage_intf_id));
 
-        if (state->offload_api == NULL)
+        if (!bplib_cache_offload_is_durable(state))
         {
+            /* a module that keeps bundles in memory is only used for the ones that would be shed */
             pri_block->data.delivery.committed_storage_id = (bp_sid_t)sblk;
+
+            /* with memory custody, the bundle is in custody as soon as it is stored */
+            if (pri_block->data.delivery.delivery_policy == bplib_policy_delivery_custody_tracking)
+            {
+                bplib_cache_custody_process_bundle(state, pri_block, &custody_info);
+                bplib_dataservice_complete(custody_info.store_entry->completion_ref, bplib_completion_custody_taken);
+                bplib_cache_custody_ack_tracking_block(state, &custody_info);
+            }
         }
         else
         {
@@ -571,16 +1110,46 @@ void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_bl
                 bplib_cache_custody_process_bundle(state, pri_block, &custody_info);
             }
 
-            if (state->offload_api->offload(state->offload_blk, &custody_info.store_entry->offload_sid, qblk) ==
-                BP_SUCCESS)
+            /* the previous custodian is kept in the entry, so custody can be acknowledged once written out */
+            custody_block = bplib_mpool_bblock_canonical_cast(custody_info.prev_cblk);
+            if (custody_block != NULL)
+            {
+                v7_get_eid(&custody_info.store_entry->data.bundle.prev_custodian_id,
+                           &custody_block->canonical_logical_data.data.custody_tracking_block.current_custodian);
+                custody_info.store_entry->data.bundle.ack_pending = true;
+            }
+
+            if (bplib_cache_offload_enqueue(state, custody_info.store_entry))
+            {
+                /* written out by the offload job, until then it is only in memory */
+                pri_block->data.delivery.committed_storage_id = (bp_sid_t)sblk;
+            }
+            else if (state->offload_api->offload(state->offload_blk, &custody_info.store_entry->offload_sid,
+                                                 qblk) == BP_SUCCESS)
             {
                 pri_block->data.delivery.committed_storage_id = custody_info.store_entry->offload_sid;
+                ++state->offloaded_count;
+                bplib_dataservice_complete(custody_info.store_entry->completion_ref, bplib_completion_custody_taken);
 
                 /* Acknowledge the block in the bundle */
+                custody_info.store_entry->data.bundle.ack_pending = false;
                 bplib_cache_custody_ack_tracking_block(state, &custody_info);
             }
         }
 
+        /* measured last, as taking custody above may have encoded the custody block again */
+        if (pri_block->data.delivery.class_of_service < BP_CACHE_FOOTPRINT_CLASSES)
+        {
+            custody_info.store_entry->footprint_class = pri_block->data.delivery.class_of_service;
+        }
+        else
+        {
+            custody_info.store_entry->footprint_class = BP_CACHE_FOOTPRINT_CLASSES - 1;
+        }
+        footprint_bytes = bplib_mpool_bblock_primary_get_footprint(pri_block, &footprint_blocks);
+        footprint_bytes += bplib_mpool_get_block_footprint(sblk);
+        bplib_cache_entry_add_footprint(custody_info.store_entry, footprint_bytes, footprint_blocks + 1);
+
         /*
          * the storage ID should only be set if it was successfully stored.  This
          * also sets the state to "idle" which begins normal FSM processing.  If
@@ -606,3 +1175,103 @@ void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_bl
         sblk = NULL;
     }
 }
+
+void bplib_cache_custody_recover_entry(bplib_cache_state_t *state, const bplib_cache_offload_index_t *index)
+{
+    bplib_cache_custodian_info_t custody_info;
+    bplib_mpool_block_t         *sblk;
+    bplib_cache_entry_t         *store_entry;
+
+    memset(&custody_info, 0, sizeof(custody_info));
+    custody_info.flow_id         = index->flow_id;
+    custody_info.sequence_num    = index->sequence_num;
+    custody_info.final_dest_node = index->final_dest_node;
+
+    if (bplib_cache_custody_find_existing_bundle(state, &custody_info))
+    {
+        /* the module held two copies, only one is needed */
+        state->offload_api->release(state->offload_blk, index->sid);
+        return;
+    }
+
+    sblk        = bplib_mpool_generic_data_alloc(bplib_cache_parent_pool(state), BPLIB_STORE_SIGNATURE_ENTRY, state);
+    store_entry = bplib_mpool_generic_data_cast(sblk, BPLIB_STORE_SIGNATURE_ENTRY);
+    if (store_entry == NULL)
+    {
+        /* the module still holds it, so it can be picked up on the next restart */
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to recover stored bundle\n");
+        return;
+    }
+
+    /* the same as a bundle just stored and offloaded, only nothing is in memory yet */
+    store_entry->parent      = state;
+    store_entry->state       = bplib_cache_entry_state_idle;
+    store_entry->offload_sid = index->sid;
+    store_entry->stored_size = sizeof(bplib_mpool_bblock_primary_t) + index->bundle_encode_size;
+    store_entry->store_time  = state->action_time;
+    state->stored_bytes += store_entry->stored_size;
+    ++state->offloaded_count;
+
+    /* the trees are only built at the end when nothing was in them before, see finish_recovery() */
+    if (bplib_rbt_tree_is_empty(&state->dest_eid_jphfix_index))
+    {
+        bplib_rbt_bulk_append(&state->recover_dest_eid, custody_info.final_dest_node, &store_entry->dest_eid_rbt_link);
+    }
+    else
+    {
+        bplib_rbt_insert_value_generic(custody_info.final_dest_node, &state->dest_eid_jphfix_index,
+                                       &store_entry->dest_eid_rbt_link, bplib_cache_entry_tree_insert_unsorted, NULL);
+    }
+
+    /* find_existing_bundle() left the hash in custody_info */
+    if (bplib_cache_hash_insert(&state->bundle_index, custody_info.eid_hash, store_entry) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to index stored bundle\n");
+    }
+
+    store_entry->flags |= BPLIB_STORE_FLAG_LOCAL_CUSTODY | BPLIB_STORE_FLAG_ACTIVITY;
+    store_entry->flow_seq_copy = index->sequence_num;
+    store_entry->flow_id_copy  = index->flow_id;
+    store_entry->expire_time   = index->expire_time;
+
+    if (store_entry->expire_time == 0)
+    {
+        /* not in the expire index */
+    }
+    else if (bplib_rbt_tree_is_empty(&state->expire_index))
+    {
+        bplib_rbt_bulk_append(&state->recover_expire, store_entry->expire_time, &store_entry->expire_rbt_link);
+    }
+    else
+    {
+        bplib_rbt_insert_value_generic(store_entry->expire_time, &state->expire_index, &store_entry->expire_rbt_link,
+                                       bplib_cache_entry_tree_insert_unsorted, NULL);
+    }
+
+    ++state->fsm_state_enter_count[store_entry->state];
+
+    /* the FSM may need the entry to be in the indices, so it waits until they are complete */
+    bplib_mpool_insert_before(&state->recover_list, sblk);
+}
+
+void bplib_cache_custody_finish_recovery(bplib_cache_state_t *state)
+{
+    bplib_mpool_list_iter_t list_it;
+    bplib_mpool_block_t    *sblk;
+    int                     status;
+
+    /* these only fail if the tree was not empty, and then nothing was appended */
+    bplib_rbt_bulk_load(&state->dest_eid_jphfix_index, &state->recover_dest_eid);
+    bplib_rbt_bulk_load(&state->expire_index, &state->recover_expire);
+
+    /* This puts each one into the right spot for future holding */
+    status = bplib_mpool_list_iter_goto_first(&state->recover_list, &list_it);
+    while (status == BP_SUCCESS)
+    {
+        sblk   = list_it.position;
+        status = bplib_mpool_list_iter_forward(&list_it);
+
+        bplib_mpool_extract_node(sblk);
+        bplib_cache_fsm_execute(sblk);
+    }
+}
@@ -29,8 +29,6 @@ typedef void (*bplib_cache_fsm_state_change_func_t)(bplib_cache_entry_t *);
 
 bplib_cache_entry_state_t bplib_cache_fsm_state_idle_eval(bplib_cache_entry_t *store_entry)
 {
-    bplib_mpool_block_t *pblk;
-
     if (store_entry->parent->action_time >= store_entry->expire_time)
     {
         /* bundle has reached the end of its useful life, so it can be discarded */
@@ -48,14 +46,8 @@ bplib_cache_entry_state_t bplib_cache_fsm_state_idle_eval(bplib_cache_entry_t *s
     if ((store_entry->flags & BPLIB_STORE_FLAGS_ACTION_WAIT_STATE) == 0)
     {
         /* bundle is due for [re]transmit */
-        if (store_entry->refptr == NULL && store_entry->offload_sid != 0)
-        {
-            store_entry->parent->offload_api->restore(store_entry->parent->offload_blk, store_entry->offload_sid,
-                                                      &pblk);
-            store_entry->refptr = bplib_mpool_ref_create(pblk);
-        }
-
-        if (store_entry->refptr != NULL)
+        /* if this fails the entry stays idle, and it will be tried again after it is rescheduled */
+        if (bplib_cache_entry_restore_content(store_entry))
         {
             return bplib_cache_entry_state_queue;
         }
@@ -81,34 +73,40 @@ bplib_cache_entry_state_t bplib_cache_fsm_state_queue_eval(bplib_cache_entry_t *
 void bplib_cache_fsm_state_queue_enter(bplib_cache_entry_t *store_entry)
 {
     bplib_mpool_block_t *rblk;
-    bplib_mpool_flow_t  *self_flow;
+    bplib_cache_state_t *state;
 
     store_entry->flags |= BPLIB_STORE_FLAG_PENDING_FORWARD;
 
     rblk = bplib_mpool_ref_make_block(store_entry->refptr, BPLIB_STORE_SIGNATURE_BLOCKREF, store_entry);
     if (rblk != NULL)
     {
-        self_flow = bplib_cache_get_flow(store_entry->parent);
+        state = store_entry->parent;
 
         /*
          * note - the flag is always set here, even if it does not actually make it into the queue.
          *
-         * If it fails to push to the queue, it is immediately recycled, and when the destructor runs
-         * the flag will be cleared as normal.  This keeps things synchronized in that it won't transition
-         * back to idle until the referring block is actually removed, even though it was never really
-         * queued.
+         * The ref only goes into the batch here, and if it does not fit when the batch is pushed, it is
+         * recycled, and when the destructor runs the flag will be cleared as normal.  This keeps things
+         * synchronized in that it won't transition back to idle until the referring block is actually
+         * removed, even though it was never really queued.
          */
         store_entry->flags |= BPLIB_STORE_FLAG_LOCALLY_QUEUED;
-        if (!bplib_mpool_flow_try_push(&self_flow->ingress, rblk, 0))
+
+        /* every time it is queued takes one of these, so it only counts for the footprint once */
+        if (!store_entry->footprint_queued && store_entry->footprint_blocks != 0)
         {
-            bplib_mpool_recycle_block(rblk);
+            store_entry->footprint_queued = true;
+            bplib_cache_entry_add_footprint(store_entry, bplib_mpool_get_block_footprint(rblk), 1);
         }
+
+        bplib_cache_queue_batch_insert(state, rblk, store_entry);
     }
 }
 
 void bplib_cache_fsm_state_queue_exit(bplib_cache_entry_t *store_entry)
 {
     bplib_mpool_bblock_primary_t *pri_block;
+    uint64_t                      retx_interval;
 
     pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(store_entry->refptr));
 
@@ -123,18 +121,24 @@ void bplib_cache_fsm_state_queue_exit(bplib_cache_entry_t *store_entry)
         }
         else
         {
-            /* reschedule the next retransmit time based on the anticipted round-trip time of the egress intf */
-            /* JPHFIX: this is fixed for now, but should be configurable/specific to the egress intf */
-            store_entry->action_time =
-                pri_block->data.delivery.egress_time + pri_block->data.delivery.local_retx_interval;
+            /* reschedule the next retransmit time based on the measured round-trip time of the egress intf */
+            store_entry->egress_intf_id = pri_block->data.delivery.egress_intf_id;
+            store_entry->egress_time    = pri_block->data.delivery.egress_time;
+            ++store_entry->transmit_count;
+
+            retx_interval = bplib_cache_rtt_retx_interval(store_entry->parent, store_entry->egress_intf_id,
+                                                          pri_block->data.delivery.local_retx_interval,
+                                                          store_entry->transmit_count);
+
+            store_entry->action_time = store_entry->egress_time + retx_interval;
             store_entry->flags |= BPLIB_STORE_FLAG_ACTION_TIME_WAIT;
         }
     }
 
     if (store_entry->offload_sid != 0)
     {
-        bplib_mpool_ref_release(store_entry->refptr);
-        store_entry->refptr = NULL;
+        /* the content can be restored when it is needed again, until then it is only kept within the budget */
+        bplib_cache_entry_retain_content(store_entry);
     }
 }
 
@@ -161,15 +165,24 @@ bplib_cache_entry_state_t bplib_cache_fsm_state_delete_eval(bplib_cache_entry_t
 
 void bplib_cache_fsm_state_delete_enter(bplib_cache_entry_t *store_entry)
 {
-    if (store_entry->refptr != NULL)
+    /* once done with, it does not need to be written out */
+    bplib_cache_offload_cancel(store_entry->parent, store_entry);
+
+    bplib_cache_entry_release_content(store_entry);
+    bplib_mpool_ref_release(store_entry->completion_ref);
+    store_entry->completion_ref = NULL;
+
+    /* only the metadata is left, which ages out on its own, so there is nothing more to expire */
+    if (bplib_rbt_get_key_value(&store_entry->expire_rbt_link) != 0)
     {
-        bplib_mpool_ref_release(store_entry->refptr);
-        store_entry->refptr = NULL;
+        bplib_rbt_extract_node(&store_entry->parent->expire_index, &store_entry->expire_rbt_link);
     }
 
     if (store_entry->offload_sid != 0)
     {
         store_entry->parent->offload_api->release(store_entry->parent->offload_blk, store_entry->offload_sid);
+        store_entry->offload_sid = 0;
+        --store_entry->parent->offloaded_count;
     }
 
     store_entry->flags |= BPLIB_STORE_FLAG_ACTION_TIME_WAIT;
@@ -195,7 +208,6 @@ void bplib_cache_fsm_state_generate_dacs_exit(bplib_cache_entry_t *store_entry)
 void bplib_cache_fsm_reschedule(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
 {
     uint64_t ref_time;
-    uint64_t prev_key;
 
     ref_time = state->action_time;
 
@@ -218,21 +230,13 @@ void bplib_cache_fsm_reschedule(bplib_cache_state_t *state, bplib_cache_entry_t
     }
 
     /*
-     * determine the batch/bucket that this should go into
+     * If this was already in the timer wheel for a different time, it needs to be
+     * taken out first, then it can be put into the slot for the new time
      */
-    prev_key = bplib_rbt_get_key_value(&store_entry->time_rbt_link);
-    if (ref_time != prev_key)
+    if (store_entry->timer_slot == NULL || ref_time != store_entry->timer_deadline)
     {
-        /*
-         * If this was in the time index, the old entry needs to be removed first,
-         * then it needs to be added in the new spot
-         */
-        if (prev_key != 0)
-        {
-            bplib_rbt_extract_node(&state->time_jphfix_index, &store_entry->time_rbt_link);
-        }
-        bplib_rbt_insert_value_generic(ref_time, &state->time_jphfix_index, &store_entry->time_rbt_link,
-                                       bplib_cache_entry_tree_insert_unsorted, NULL);
+        bplib_cache_timer_cancel(state->timer_wheel, store_entry);
+        bplib_cache_timer_insert(state->timer_wheel, store_entry, ref_time, state->action_time);
     }
 }
 
@@ -333,6 +337,7 @@ void bplib_cache_fsm_execute(bplib_mpool_block_t *sblk)
 {
     bplib_cache_state_t      *state;
     bplib_cache_entry_t      *store_entry;
+    bplib_cache_entry_state_t prev_state;
     bplib_cache_entry_state_t next_state;
 
     /* This cast should always work, unless there is a bug */
@@ -364,13 +369,23 @@ void bplib_cache_fsm_execute(bplib_mpool_block_t *sblk)
             store_entry->action_time = BP_CACHE_TIME_INFINITE;
         }
 
-        next_state = bplib_cache_fsm_get_next_state(store_entry);
-        if (next_state != store_entry->state)
+        /*
+         * An entry acked while it was queued is evaluated again as soon as it is back in idle, so it goes
+         * on to delete now rather than when it is next revisited.  Anything else waits to be rescheduled,
+         * so a bundle that could not be sent is not offered again right away.
+         */
+        do
         {
-            ++state->fsm_state_exit_count[store_entry->state];
-            bplib_cache_fsm_transition_state(store_entry, next_state);
-            ++state->fsm_state_enter_count[next_state];
-        }
+            prev_state = store_entry->state;
+            next_state = bplib_cache_fsm_get_next_state(store_entry);
+            if (next_state != prev_state)
+            {
+                ++state->fsm_state_exit_count[prev_state];
+                bplib_cache_fsm_transition_state(store_entry, next_state);
+                ++state->fsm_state_enter_count[next_state];
+            }
+        } while (prev_state == bplib_cache_entry_state_queue && next_state == bplib_cache_entry_state_idle &&
+                 (store_entry->flags & BPLIB_STORE_FLAG_LOCAL_CUSTODY) == 0);
 
         /* entries get set into the "undefined" state once the FSM determines it is no longer useful at all */
         if (next_state == bplib_cache_entry_state_undefined)
@@ -382,12 +397,12 @@ void bplib_cache_fsm_execute(bplib_mpool_block_t *sblk)
         else
         {
             /*
-             * The main objective here is to always periodically revisit items in the
-             * idle list at some point, don't let them linger indefinitely without
-             * at least looking at them.
+             * The main objective here is to always periodically revisit items that
+             * are not pending at some point, don't let them linger indefinitely without
+             * at least looking at them.  Until then, the entry is not on any list, it is
+             * only in the destination index and the timer wheel.
              */
             bplib_cache_fsm_reschedule(state, store_entry);
-            bplib_mpool_insert_before(&state->idle_list, sblk);
         }
     }
 }
@@ -0,0 +1,221 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "v7_cache_internal.h"
+
+/*
+ * -----------------------------------------------------------------------------------
+ * IMPLEMENTATION
+ * Helpers for the slots of the table
+ * -----------------------------------------------------------------------------------
+ */
+
+static uint32_t bplib_cache_hash_home_slot(const bplib_cache_hash_table_t *table, bp_val_t hash)
+{
+    return (uint32_t)hash & (table->capacity - 1);
+}
+
+/*
+ * Puts an entry in the first free slot of its probe sequence, the table must not be full
+ */
+static void bplib_cache_hash_place(bplib_cache_hash_table_t *table, bp_val_t hash, bplib_cache_entry_t *store_entry)
+{
+    uint32_t pos;
+
+    pos = bplib_cache_hash_home_slot(table, hash);
+    while (table->slots[pos].store_entry != NULL)
+    {
+        pos = (pos + 1) & (table->capacity - 1);
+    }
+
+    table->slots[pos].hash        = hash;
+    table->slots[pos].store_entry = store_entry;
+}
+
+/*
+ * Moves everything into a new set of slots of the given size
+ */
+static int bplib_cache_hash_resize(bplib_cache_hash_table_t *table, uint32_t new_capacity)
+{
+    bplib_cache_hash_slot_t *old_slots;
+    uint32_t                 old_capacity;
+    uint32_t                 pos;
+
+    old_slots    = table->slots;
+    old_capacity = table->capacity;
+
+    table->slots = bplib_os_calloc(sizeof(bplib_cache_hash_slot_t) * new_capacity);
+    if (table->slots == NULL)
+    {
+        table->slots = old_slots;
+        return BP_ERROR;
+    }
+
+    /* everything in the old slots gets placed again, as the home slots all change with the size */
+    table->capacity = new_capacity;
+    for (pos = 0; pos < old_capacity; ++pos)
+    {
+        if (old_slots[pos].store_entry != NULL)
+        {
+            bplib_cache_hash_place(table, old_slots[pos].hash, old_slots[pos].store_entry);
+        }
+    }
+
+    if (old_slots != NULL)
+    {
+        bplib_os_free(old_slots);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*
+ * -----------------------------------------------------------------------------------
+ * EXPORTED FUNCTIONS
+ * -----------------------------------------------------------------------------------
+ */
+
+void bplib_cache_hash_init(bplib_cache_hash_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+void bplib_cache_hash_release(bplib_cache_hash_table_t *table)
+{
+    if (table->slots != NULL)
+    {
+        bplib_os_free(table->slots);
+    }
+
+    memset(table, 0, sizeof(*table));
+}
+
+int bplib_cache_hash_insert(bplib_cache_hash_table_t *table, bp_val_t hash, bplib_cache_entry_t *store_entry)
+{
+    uint32_t new_capacity;
+
+    /* grow once more than 3/4 full, as the probe sequences get long quickly past that */
+    if (((table->num_entries + 1) * 4) > (table->capacity * 3))
+    {
+        if (table->capacity == 0)
+        {
+            new_capacity = BP_CACHE_HASH_INITIAL_CAPACITY;
+        }
+        else
+        {
+            new_capacity = table->capacity * 2;
+        }
+
+        /* if this fails, a table with free slots can still be used, just getting slower, but
+         * at least one slot is always left free so that every probe sequence has an end */
+        if (bplib_cache_hash_resize(table, new_capacity) != BP_SUCCESS &&
+            (table->num_entries + 1) >= table->capacity)
+        {
+            return BP_ERROR;
+        }
+    }
+
+    store_entry->hash_key = hash;
+    bplib_cache_hash_place(table, hash, store_entry);
+    ++table->num_entries;
+
+    return BP_SUCCESS;
+}
+
+bplib_cache_entry_t *bplib_cache_hash_search(const bplib_cache_hash_table_t *table, bp_val_t hash,
+                                             bplib_cache_hash_match_func_t match_func, void *arg)
+{
+    const bplib_cache_hash_slot_t *slot;
+    uint32_t                       pos;
+
+    if (table->num_entries == 0)
+    {
+        return NULL;
+    }
+
+    /* there is always a free slot, so this always ends */
+    pos = bplib_cache_hash_home_slot(table, hash);
+    while (table->slots[pos].store_entry != NULL)
+    {
+        slot = &table->slots[pos];
+        if (slot->hash == hash && match_func(slot->store_entry, arg) == 0)
+        {
+            return slot->store_entry;
+        }
+
+        pos = (pos + 1) & (table->capacity - 1);
+    }
+
+    return NULL;
+}
+
+bool bplib_cache_hash_remove(bplib_cache_hash_table_t *table, bplib_cache_entry_t *store_entry)
+{
+    uint32_t mask;
+    uint32_t hole;
+    uint32_t pos;
+    uint32_t home;
+
+    if (table->num_entries == 0)
+    {
+        return false;
+    }
+
+    mask = table->capacity - 1;
+    hole = bplib_cache_hash_home_slot(table, store_entry->hash_key);
+    while (table->slots[hole].store_entry != store_entry)
+    {
+        if (table->slots[hole].store_entry == NULL)
+        {
+            /* not in this table */
+            return false;
+        }
+
+        hole = (hole + 1) & mask;
+    }
+
+    table->slots[hole].store_entry = NULL;
+    --table->num_entries;
+
+    /*
+     * Anything after the hole in the same run of used slots may no longer be reachable from its
+     * home slot.  Each one whose home slot is not between the hole and its current position moves
+     * back into the hole, leaving a new hole where it was.
+     */
+    pos = (hole + 1) & mask;
+    while (table->slots[pos].store_entry != NULL)
+    {
+        home = bplib_cache_hash_home_slot(table, table->slots[pos].hash);
+        if (((pos - home) & mask) >= ((pos - hole) & mask))
+        {
+            table->slots[hole]            = table->slots[pos];
+            table->slots[pos].store_entry = NULL;
+            hole                          = pos;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    return true;
+}
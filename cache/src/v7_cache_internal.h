@@ -39,15 +39,18 @@
  * Randomly-chosen 32-bit static values that can be put into
  * data structures to help positively identify those structs later.
  */
+#define BPLIB_STORE_SIGNATURE_INTF     0x3c1d8e52
 #define BPLIB_STORE_SIGNATURE_STATE    0x683359a7
 #define BPLIB_STORE_SIGNATURE_ENTRY    0xf223fff9
 #define BPLIB_STORE_SIGNATURE_BLOCKREF 0x77e96b11
+#define BPLIB_STORE_SIGNATURE_TIMER    0x5ab2c40d
 
 #define BPLIB_STORE_FLAG_ACTIVITY         0x01
 #define BPLIB_STORE_FLAG_LOCAL_CUSTODY    0x02
 #define BPLIB_STORE_FLAG_ACTION_TIME_WAIT 0x04
 #define BPLIB_STORE_FLAG_LOCALLY_QUEUED   0x08
 #define BPLIB_STORE_FLAG_PENDING_FORWARD  0x10
+#define BPLIB_STORE_FLAG_OFFLOAD_WAIT     0x20
 
 /* the set of flags for which retention is required - all are typically set for valid entries
  * if any of these becomes UN-set, retention of the entry is NOT required */
@@ -61,6 +64,78 @@
 
 #define BP_CACHE_TIME_INFINITE BP_DTNTIME_INFINITE
 
+/*
+ * The deadlines of cache entries are kept in a hierarchical timing wheel.  The slots of the lowest
+ * level are one tick wide, and each slot of a higher level spans as much time as the whole level
+ * below it.  An entry is made pending once the tick containing its deadline has passed, so it may
+ * be up to one tick late.  With these values the wheel spans about 70 minutes, anything further
+ * out waits in the last slot of the highest level and is placed again when that slot comes due.
+ */
+#define BP_CACHE_TIMER_TICK_SHIFT 7 /* 128 ms */
+#define BP_CACHE_TIMER_SLOT_SHIFT 3
+#define BP_CACHE_TIMER_SLOTS      (1 << BP_CACHE_TIMER_SLOT_SHIFT)
+#define BP_CACHE_TIMER_LEVELS     5
+
+/*
+ * The custody indices are open addressing hash tables, which start at this many slots on
+ * the first insert and double whenever they become more than 3/4 full.  Must be a power of 2.
+ */
+#define BP_CACHE_HASH_INITIAL_CAPACITY 64
+
+/*
+ * Default number of entries at the head of the pending list whose offloaded content is
+ * restored ahead of time, while the ingress queue of the storage flow is full
+ */
+#define BP_CACHE_PREFETCH_DEPTH 4
+
+/*
+ * Default number of pending entries evaluated per run of the pending job, so that a large
+ * backlog becoming actionable at once does not hold off the jobs of the other flows
+ */
+#define BP_CACHE_FLUSH_LIMIT 256
+
+/*
+ * Most entries already in the queue batch that a new one is moved ahead of, when it is ordered by
+ * bplib_cache_queue_batch_insert().  Bundles stored later tend to expire later, so this is usually
+ * only a step or two, but it bounds the cost per entry when they do not.  Past it the batch is only
+ * partly in order.
+ */
+#define BP_CACHE_TRANSMIT_ORDER_DEPTH 32
+
+/*
+ * Most stored bundles evicted by the shed policy per run of the cache job.  Their blocks only come
+ * back once the pool gets to them, and the pool is looked at again on the next run.
+ */
+#define BP_CACHE_EVICT_LIMIT 16
+
+/*
+ * Stored bundles waiting for the offload job of their cache state to write them out, see
+ * bplib_cache_offload_enqueue().  When this many are waiting, the next one is written right away.
+ */
+#define BP_CACHE_OFFLOAD_QUEUE_DEPTH 32
+
+/*
+ * Classes of service the footprint of stored bundles is kept for, see bplib_cache_confkey_footprint_class.
+ * Anything above the last one is counted with it.
+ */
+#define BP_CACHE_FOOTPRINT_CLASSES (BP_COS_EXTENDED + 1)
+
+/*
+ * Most shards one storage service can be split into, see bplib_cache_attach_sharded()
+ */
+#define BP_CACHE_MAX_SHARDS 8
+
+/*
+ * The retransmit time of custody bundles comes from the round trip times measured on their
+ * egress interface, from the transmit until the DACS for it comes back.  This many interfaces
+ * are tracked per cache state, beyond that the slots are reused in turn.  The time is never
+ * less than the minimum, and doubles for each retransmit of the same bundle up to the maximum.
+ */
+#define BP_CACHE_RTT_MAX_INTF       4
+#define BP_CACHE_RTT_MIN_RETX_TIME  1000                     /* 1 sec */
+#define BP_CACHE_RTT_MAX_RETX_TIME  BP_CACHE_IDLE_RETRY_TIME /* 1 hour */
+#define BP_CACHE_RTT_MAX_BACKOFF    6
+
 typedef enum bplib_cache_entry_state
 {
     bplib_cache_entry_state_undefined,
@@ -71,11 +146,82 @@ typedef enum bplib_cache_entry_state
     bplib_cache_entry_state_max
 } bplib_cache_entry_state_t;
 
+/*
+ * How the DACS generated by a cache are put together, set by the bplib_cache_confkey_dacs_xxx keys
+ */
+typedef struct bplib_cache_dacs_config
+{
+    int open_time;
+    int lifetime;
+    int max_entries;
+    int max_bytes;
+    int ack_threshold;
+} bplib_cache_dacs_config_t;
+
+/*
+ * Each slot refers to one of its entries, and the rest are linked in a ring with it.  This is
+ * kept in a block of its own, as it does not fit in the same block as the cache state.
+ */
+typedef struct bplib_cache_timer_wheel
+{
+    uint64_t             base_tick;   /**< the next tick to expire, every tick before this has been done */
+    uint32_t             num_entries; /**< entries in all slots of the wheel */
+    uint8_t              occupied[BP_CACHE_TIMER_LEVELS]; /**< bitmask of the slots in each level which are in use */
+    bplib_mpool_block_t *slots[BP_CACHE_TIMER_LEVELS][BP_CACHE_TIMER_SLOTS];
+
+} bplib_cache_timer_wheel_t;
+
+/*
+ * Smoothed round trip time and its mean deviation, in ms, updated the same way as in RFC 6298
+ */
+typedef struct bplib_cache_rtt_estimate
+{
+    bp_handle_t egress_intf_id; /**< invalid if the slot is not in use */
+    uint32_t    srtt;
+    uint32_t    rttvar;
+} bplib_cache_rtt_estimate_t;
+
+typedef struct bplib_cache_hash_slot
+{
+    bp_val_t                  hash;
+    struct bplib_cache_entry *store_entry; /**< NULL if the slot is empty */
+} bplib_cache_hash_slot_t;
+
+/*
+ * Linear probing with the hash value kept in the slot, so that most of the slots visited
+ * during a search can be passed over without looking at the entry itself.  Entries are
+ * removed by shifting the rest of the probe sequence back, so there are no tombstones.
+ */
+typedef struct bplib_cache_hash_table
+{
+    bplib_cache_hash_slot_t *slots;       /**< allocated on the first insert */
+    uint32_t                 capacity;    /**< number of slots, zero or a power of 2 */
+    uint32_t                 num_entries; /**< slots which are in use */
+} bplib_cache_hash_table_t;
+
+/*
+ * Bundles stored while an offload module is registered stay in memory and are forwarded right
+ * away, and are written out by a job of their own, so the disk is not in the way of forwarding.
+ * Custody is only acknowledged once that is done.  This is in the flow block with the other jobs.
+ */
+typedef struct bplib_cache_offload_queue
+{
+    bplib_mpool_job_t         job; /**< runs bplib_cache_offload_waiting() */
+    uint32_t                  count;
+    struct bplib_cache_entry *entries[BP_CACHE_OFFLOAD_QUEUE_DEPTH]; /**< in the order stored, NULL once not waiting */
+
+} bplib_cache_offload_queue_t;
+
 typedef struct bplib_cache_state
 {
     bp_ipn_addr_t self_addr;
 
-    bplib_mpool_job_t pending_job;
+    bplib_routetbl_t    *parent_rtbl;
+    bplib_mpool_block_t *intf_block;  /**< the storage flow block that this state belongs to */
+    bplib_mpool_job_t   *pending_job;  /**< job in the storage flow block that runs bplib_cache_flush_pending() */
+    bplib_mpool_job_t   *prefetch_job; /**< job in the storage flow block that runs bplib_cache_prefetch_pending() */
+
+    bplib_cache_offload_queue_t *offload_queue; /**< in the storage flow block, NULL to always offload right away */
 
     /*
      * pending_list holds bundle refs that are currently actionable in some way,
@@ -85,61 +231,206 @@ typedef struct bplib_cache_state
      */
     bplib_mpool_block_t pending_list;
 
-    uint64_t action_time; /**< DTN time when the pending_list was last checked */
+    /*
+     * Refs made by entries entering the queue state are collected here while the pending list is
+     * worked through, and then pushed into the ingress queue together by bplib_cache_push_queue_batch()
+     */
+    bplib_mpool_block_t queue_batch;
+    uint32_t            queue_batch_count;
+    int                 flush_limit;    /**< set by bplib_cache_confkey_flush_limit, 0 for no limit */
+    int                 transmit_order; /**< set by bplib_cache_confkey_transmit_order, the order of the batch */
+    int                 shed_policy;    /**< set by bplib_cache_confkey_shed_policy, see bplib_cache_shed_load() */
+    int                 memory_custody; /**< set by bplib_cache_confkey_memory_custody */
+
+    uint64_t action_time;  /**< DTN time when the pending_list was last checked */
+    uint64_t poll_time;    /**< DTN time of the next poll event, as registered with the route table */
+    uint64_t contact_time; /**< DTN time up to which the contact plan has been looked at, see bplib_cache_do_poll() */
+
+    bplib_cache_hash_table_t bundle_index; /**< stored bundles, by flow source EID and sequence number */
+    bplib_cache_hash_table_t dacs_index;   /**< open DACS, by flow source EID and previous custodian */
 
     /*
-     * idle_list holds the items which do not fit into the other two lists.
-     * They are not currently actionable, and placed here for holding.
+     * Every entry is kept in this index by the node it is going to, for bundles that is
+     * the final destination, and for a DACS it is the custodian being acknowledged.
      *
-     * NOTE: this is just a sequential flat list for simplicity.  It can be
-     * iterated, but that does not scale well.  One of the secondary indices
-     * may be used for more efficient lookup.
+     * Entries which are not currently actionable are not on any list, they are only found
+     * through this index (or the timer wheel), so that a route to a node becoming available
+     * only needs to look at the entries going to that node.
      */
-    bplib_mpool_block_t idle_list;
-
-    bplib_rbt_root_t bundle_index;
-    bplib_rbt_root_t dacs_index;
     bplib_rbt_root_t dest_eid_jphfix_index;
-    bplib_rbt_root_t time_jphfix_index;
+
+    /*
+     * Stored bundles are also kept in this index by expire_time until they are done with, so that
+     * everything that has expired can be dropped in one sweep by bplib_cache_expire_sweep(), rather
+     * than each entry going through the FSM on its own when its timer comes up.
+     */
+    bplib_rbt_root_t expire_index;
+
+    /*
+     * While bplib_cache_start() recovers what the offload module held from before, the entries are
+     * collected here and only put in the indices above once it is done, by building each tree in
+     * one pass rather than rebalancing it for every entry.  They go through the FSM after that.
+     */
+    bplib_rbt_bulk_t    recover_dest_eid;
+    bplib_rbt_bulk_t    recover_expire;
+    bplib_mpool_block_t recover_list;
+
+    bplib_cache_timer_wheel_t *timer_wheel; /**< the next action time of every entry that has one */
 
     const bplib_cache_offload_api_t *offload_api;
     bplib_mpool_block_t             *offload_blk;
 
-    uint32_t generated_dacs_seq;
+    /*
+     * Bundles which have been offloaded can be restored whenever they are needed again, so their
+     * content only needs to stay in memory between transmits while it fits in this budget.  When
+     * it does not, the entries with the most time until their next action are released first.
+     */
+    int    resident_budget; /**< set by bplib_cache_confkey_resident_budget, 0 to release after every transmit */
+    size_t resident_bytes;  /**< the content of offloaded bundles currently kept in memory */
+
+    /*
+     * When the pending list is not emptied because the flow is backed up, the next entries on it
+     * have their content restored by a separate job, so the reads are done while the bundles ahead
+     * of them are being sent rather than when they get to the head.  This is within the same budget.
+     */
+    int prefetch_depth; /**< set by bplib_cache_confkey_prefetch_depth, 0 to only restore when due */
+
+    /*
+     * A sharded cache splits its bundles by flow over this state and the states of the shards,
+     * each of which is in a flow of its own so their jobs can run at the same time.  The bundles
+     * of a flow, and the DACS for that flow, always go to the same one.  This is only set in the
+     * state of the storage service itself, the shards do not have shards of their own.
+     */
+    uint32_t          num_shards; /**< shards besides this state, 0 if not sharded */
+    bplib_mpool_ref_t shards[BP_CACHE_MAX_SHARDS - 1];
+
+    bplib_cache_rtt_estimate_t rtt_estimates[BP_CACHE_RTT_MAX_INTF];
+    uint32_t                   rtt_next_slot; /**< the slot reused next, once every slot is in use */
+
+    uint32_t                  generated_dacs_seq;
+    uint32_t                  generated_dacs_seq_step; /**< shards share a source EID, so they take turns */
+    bplib_cache_dacs_config_t dacs_config;
 
     uint32_t fsm_state_enter_count[bplib_cache_entry_state_max];
     uint32_t fsm_state_exit_count[bplib_cache_entry_state_max];
     uint32_t discard_count;
 
+    /*
+     * Kept up to date as entries change, for the stat keys of bplib_cache_query().  The entries in
+     * each FSM state come from the counts above, and the stored bytes include those not in memory.
+     */
+    uint32_t pending_count;         /**< entries on the pending_list */
+    uint32_t resident_count;        /**< entries with a refptr */
+    uint32_t offloaded_count;       /**< entries with an offload_sid */
+    uint32_t dacs_closed_count;     /**< DACS finalized */
+    uint32_t custody_release_count; /**< bundles acknowledged by a DACS */
+    uint32_t evict_count;           /**< bundles dropped by the shed policy */
+    uint32_t evict_release_count;   /**< bundles whose content was released by the shed policy */
+    uint64_t custody_hold_time;     /**< ms from being stored until acknowledged, over all of those bundles */
+    size_t   stored_bytes;          /**< the stored_size of every entry */
+    int      query_value;           /**< the value computed for the last stat key queried */
+
+    /*
+     * The footprint of the stored bundles in each class of service, see bplib_cache_entry_add_footprint().
+     * The totals are of the entries there are now, the largest are of any entry since the cache was made.
+     */
+    int      footprint_class; /**< set by bplib_cache_confkey_footprint_class, -1 for all classes */
+
+    uint32_t footprint_count[BP_CACHE_FOOTPRINT_CLASSES];      /**< entries with a footprint */
+    uint64_t footprint_bytes[BP_CACHE_FOOTPRINT_CLASSES];      /**< the footprint_bytes of those entries */
+    uint64_t footprint_blocks[BP_CACHE_FOOTPRINT_CLASSES];     /**< the footprint_blocks of those entries */
+    uint32_t footprint_bytes_max[BP_CACHE_FOOTPRINT_CLASSES];  /**< the most footprint_bytes of any entry */
+    uint32_t footprint_blocks_max[BP_CACHE_FOOTPRINT_CLASSES]; /**< the most footprint_blocks of any entry */
+
 } bplib_cache_state_t;
 
+/*
+ * This is the user data of the storage flow block itself.  Only the jobs
+ * are kept here, so they run as jobs of the storage flow and are serialized with the
+ * other jobs of that flow.  Everything else lives in a separate block, as the flow
+ * header leaves too little room in the same block for the complete cache state.
+ */
+typedef struct bplib_cache_intf
+{
+    bplib_mpool_job_t           pending_job;
+    bplib_mpool_job_t           prefetch_job;
+    bplib_cache_offload_queue_t offload_queue;
+    bplib_mpool_block_t        *state_block; /**< generic block holding the bplib_cache_state_t */
+    bplib_mpool_block_t        *timer_block; /**< generic block holding the bplib_cache_timer_wheel_t */
+    bplib_cache_state_t        *state;
+
+} bplib_cache_intf_t;
+
+/*
+ * The sequence numbers acknowledged by an open DACS are first marked in a bitmap, starting
+ * from the oldest one.  The bitmap is turned into ranges in the DACS payload when the DACS
+ * is finalized, or when a sequence number is too far ahead of it.
+ */
+#define BP_CACHE_DACS_WINDOW_BITS 256
+
 typedef struct bplib_cache_dacs_pending
 {
     bp_ipn_addr_t                      prev_custodian_id;
     bp_custody_accept_payload_block_t *payload_ref;
+    bp_sequencenumber_t                window_base; /**< the sequence number of the first bit in the window */
+    uint32_t                           window_runs; /**< runs of set bits in the window, each will be a range */
+    uint32_t                           seq_count;   /**< sequence numbers acknowledged, in the window or not */
+    uint32_t                           window[BP_CACHE_DACS_WINDOW_BITS / 32];
 
 } bplib_cache_dacs_pending_t;
 
+/*
+ * What a stored bundle needs to acknowledge custody of it, which is not done until it is offloaded
+ */
+typedef struct bplib_cache_bundle_custody
+{
+    bp_ipn_addr_t prev_custodian_id;
+    bool          ack_pending; /**< if there is a previous custodian to acknowledge at all */
+
+} bplib_cache_bundle_custody_t;
+
 typedef union bplib_cache_entry_data
 {
-    bplib_cache_dacs_pending_t dacs;
+    bplib_cache_dacs_pending_t   dacs;
+    bplib_cache_bundle_custody_t bundle;
 } bplib_cache_entry_data_t;
 
 typedef struct bplib_cache_entry
 {
+    /*
+     * The fields used by the timer wheel, the FSM and the eviction scan come first, so that the
+     * passes over many entries at once only touch the start of each entry block.  The index
+     * links follow, then whatever is only needed when the entry itself is acted on.
+     */
     bplib_cache_state_t      *parent;
     bplib_cache_entry_state_t state;
     uint32_t                  flags;
-    bp_ipn_addr_t             flow_id_copy;
-    bp_sequencenumber_t       flow_seq_copy;
-    bplib_mpool_ref_t         refptr;
-    bp_sid_t                  offload_sid;
     uint64_t                  action_time; /**< DTN time when entity is due to have some action (e.g. transmit) */
     uint64_t                  expire_time; /**< DTN time when entity is due to have some action (e.g. transmit) */
-    bplib_rbt_link_t          hash_rbt_link;
-    bplib_rbt_link_t          time_rbt_link;
-    bplib_rbt_link_t          dest_eid_rbt_link;
-    bplib_cache_entry_data_t  data;
+    uint64_t                  timer_deadline; /**< DTN time the entry is scheduled in the timer wheel for */
+    bplib_mpool_block_t     **timer_slot;     /**< the timer wheel slot holding the entry, NULL if not scheduled */
+    bplib_mpool_ref_t         refptr;
+    size_t                    resident_size; /**< what this counts for in resident_bytes, 0 if not counted */
+
+    bplib_mpool_block_t timer_link;
+    bp_val_t            hash_key; /**< the value the entry was put in a custody index under */
+    bplib_rbt_link_t    dest_eid_rbt_link;
+    bplib_rbt_link_t    expire_rbt_link;
+
+    bp_ipn_addr_t            flow_id_copy;
+    bp_sequencenumber_t      flow_seq_copy;
+    bp_sid_t                 offload_sid;
+    bp_handle_t              egress_intf_id;   /**< where the bundle was last sent, for the round trip time */
+    uint32_t                 transmit_count;   /**< times the bundle was sent while waiting for custody */
+    uint64_t                 egress_time;      /**< DTN time the bundle was last sent */
+    uint64_t                 store_time;       /**< DTN time the bundle was stored */
+    size_t                   stored_size;      /**< what this counts for in stored_bytes */
+    uint32_t                 footprint_bytes;  /**< pool memory taken by the entry and its bundle, 0 if not counted */
+    uint16_t                 footprint_blocks; /**< pool blocks taken by the entry and its bundle */
+    uint8_t                  footprint_class;  /**< the class of service it is counted in */
+    bool                     footprint_queued; /**< its blockref is counted, once the bundle has been queued */
+    bplib_mpool_ref_t        completion_ref;   /**< the bplib_send_async() op of the bundle, kept while offloaded */
+    bplib_cache_entry_data_t data;
 } bplib_cache_entry_t;
 
 typedef struct bplib_cache_blockref
@@ -155,16 +446,17 @@ typedef struct bplib_cache_custodian_info
     bplib_mpool_block_t *this_cblk;
     bplib_mpool_block_t *prev_cblk;
     bp_val_t             eid_hash;
+    bp_crcval_t          flow_hash_seed;   /* the bundle hash so far, over flow_id only, if flow_hash_seeded */
+    bool                 flow_hash_seeded; /* must be cleared if flow_id changes */
     bp_sequencenumber_t  sequence_num;
     bp_ipn_t             final_dest_node;
     bplib_cache_entry_t *store_entry;
 } bplib_cache_custodian_info_t;
 
-/* Allows reconstitution of the base block from a cache state pointer */
+/* Allows reconstitution of the storage flow block from a cache state pointer */
 static inline bplib_mpool_block_t *bplib_cache_state_self_block(bplib_cache_state_t *state)
 {
-    /* any of the sub-lists can be used here, they should all trace back to the same parent */
-    return bplib_mpool_get_block_from_link(&state->pending_list);
+    return state->intf_block;
 }
 
 /* Allows reconstitution of the parent pool from a cache state pointer */
@@ -179,6 +471,12 @@ static inline bplib_mpool_flow_t *bplib_cache_get_flow(bplib_cache_state_t *stat
     return bplib_mpool_flow_cast(bplib_cache_state_self_block(state));
 }
 
+/* Whether bundles offloaded here are durable, so the cache can take custody of them by offloading them */
+static inline bool bplib_cache_offload_is_durable(const bplib_cache_state_t *state)
+{
+    return (state->offload_api != NULL && !state->offload_api->in_memory);
+}
+
 /* Allows reconstitution of the queue struct from an RBT link pointer */
 #define bplib_cache_entry_from_link(ptr, member) \
     bplib_cache_entry_get_container(ptr, offsetof(bplib_cache_entry_t, member))
@@ -187,23 +485,87 @@ static inline bplib_cache_entry_t *bplib_cache_entry_get_container(const bplib_r
     return (bplib_cache_entry_t *)(void *)((uint8_t *)link - offset);
 }
 
-void bplib_cache_custody_finalize_dacs(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry);
-void bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_block_t *qblk);
-bool bplib_cache_custody_check_dacs(bplib_cache_state_t *state, bplib_mpool_block_t *qblk);
+/* Allows reconstitution of the queue struct from its timer wheel link */
+static inline bplib_cache_entry_t *bplib_cache_entry_from_timer_link(const bplib_mpool_block_t *link)
+{
+    return (bplib_cache_entry_t *)(void *)((uint8_t *)link - offsetof(bplib_cache_entry_t, timer_link));
+}
+
+void bplib_cache_timer_insert(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry, uint64_t deadline,
+                              uint64_t now);
+void bplib_cache_timer_cancel(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry);
+void bplib_cache_timer_expire(bplib_cache_timer_wheel_t *wheel, uint64_t now);
+uint64_t bplib_cache_timer_next_deadline(const bplib_cache_timer_wheel_t *wheel);
+
+/* returns true to go on to the next entry */
+typedef bool (*bplib_cache_timer_visit_func_t)(void *arg, bplib_cache_entry_t *store_entry);
+
+void bplib_cache_timer_foreach_latest(const bplib_cache_timer_wheel_t *wheel, bplib_cache_timer_visit_func_t visit_func,
+                                      void *arg);
+
+/* returns 0 if the entry is the one being searched for */
+typedef int (*bplib_cache_hash_match_func_t)(const bplib_cache_entry_t *store_entry, void *arg);
+
+void                 bplib_cache_hash_init(bplib_cache_hash_table_t *table);
+void                 bplib_cache_hash_release(bplib_cache_hash_table_t *table);
+int                  bplib_cache_hash_insert(bplib_cache_hash_table_t *table, bp_val_t hash,
+                                             bplib_cache_entry_t *store_entry);
+bplib_cache_entry_t *bplib_cache_hash_search(const bplib_cache_hash_table_t *table, bp_val_t hash,
+                                             bplib_cache_hash_match_func_t match_func, void *arg);
+bool                 bplib_cache_hash_remove(bplib_cache_hash_table_t *table, bplib_cache_entry_t *store_entry);
+
+void     bplib_cache_rtt_sample(bplib_cache_state_t *state, bp_handle_t egress_intf_id, uint64_t rtt);
+uint64_t bplib_cache_rtt_retx_interval(const bplib_cache_state_t *state, bp_handle_t egress_intf_id,
+                                       uint64_t default_interval, uint32_t transmit_count);
+
+bp_crcval_t bplib_cache_custody_flow_id_hash(const bp_ipn_addr_t *flow_id);
+bp_crcval_t bplib_cache_custody_flow_hash(bplib_mpool_block_t *qblk);
+void        bplib_cache_custody_finalize_dacs(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry);
+void        bplib_cache_custody_store_bundle(bplib_cache_state_t *state, bplib_mpool_block_t *qblk);
+void        bplib_cache_custody_recover_entry(bplib_cache_state_t *state, const bplib_cache_offload_index_t *index);
+void        bplib_cache_custody_finish_recovery(bplib_cache_state_t *state);
+bool        bplib_cache_custody_check_dacs(bplib_cache_state_t *state, bplib_mpool_block_t *qblk);
+bool        bplib_cache_custody_offload_entry(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry);
 
 void bplib_cache_fsm_execute(bplib_mpool_block_t *sblk);
 
+void bplib_cache_entry_add_footprint(bplib_cache_entry_t *store_entry, size_t bytes, uint32_t blocks);
+
+bplib_cache_state_t *bplib_cache_get_state(bplib_mpool_block_t *intf_block);
+bplib_cache_state_t *bplib_cache_get_shard(bplib_cache_state_t *state, uint32_t index);
+
 int bplib_cache_entry_tree_insert_unsorted(const bplib_rbt_link_t *node, void *arg);
 
 void bplib_cache_entry_make_pending(bplib_cache_entry_t *store_entry, uint32_t set_flags, uint32_t clear_flags);
+void bplib_cache_entry_retain_content(bplib_cache_entry_t *store_entry);
+void bplib_cache_entry_release_content(bplib_cache_entry_t *store_entry);
+bool bplib_cache_entry_restore_content(bplib_cache_entry_t *store_entry);
+void bplib_cache_enforce_resident_budget(bplib_cache_state_t *state);
 
+bool bplib_cache_dispatch_shard(bplib_cache_state_t *state, bplib_mpool_block_t *qblk);
+void bplib_cache_recover_entry(void *arg, const bplib_cache_offload_index_t *index);
 int  bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src);
+void bplib_cache_queue_batch_insert(bplib_cache_state_t *state, bplib_mpool_block_t *rblk,
+                                    bplib_cache_entry_t *store_entry);
+void bplib_cache_push_queue_batch(bplib_cache_state_t *state);
 void bplib_cache_flush_pending(bplib_cache_state_t *state);
+void bplib_cache_prefetch_pending(bplib_cache_state_t *state);
+bool bplib_cache_offload_enqueue(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry);
+void bplib_cache_offload_cancel(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry);
+void bplib_cache_offload_waiting(bplib_cache_state_t *state);
+void bplib_cache_expire_sweep(bplib_cache_state_t *state);
+void bplib_cache_shed_load(bplib_cache_state_t *state);
+void bplib_cache_update_poll_time(bplib_cache_state_t *state);
 int  bplib_cache_do_poll(bplib_cache_state_t *state);
 int  bplib_cache_do_route_up(bplib_cache_state_t *state, bp_ipn_t dest, bp_ipn_t mask);
+int  bplib_cache_do_route_prestage(bplib_cache_state_t *state, bp_ipn_t dest, bp_ipn_t mask);
 int  bplib_cache_do_intf_statechange(bplib_cache_state_t *state, bool is_up);
 int  bplib_cache_event_impl(void *event_arg, bplib_mpool_block_t *intf_block);
 int  bplib_cache_process_pending(void *arg, bplib_mpool_block_t *job);
+int  bplib_cache_process_prefetch(void *arg, bplib_mpool_block_t *job);
+int  bplib_cache_process_offload(void *arg, bplib_mpool_block_t *job);
+int  bplib_cache_construct_intf(void *arg, bplib_mpool_block_t *sblk);
+int  bplib_cache_destruct_intf(void *arg, bplib_mpool_block_t *sblk);
 int  bplib_cache_destruct_state(void *arg, bplib_mpool_block_t *sblk);
 int  bplib_cache_construct_entry(void *arg, bplib_mpool_block_t *sblk);
 int  bplib_cache_destruct_entry(void *arg, bplib_mpool_block_t *sblk);
@@ -213,15 +575,20 @@ int  bplib_cache_construct_state(void *arg, bplib_mpool_block_t *sblk);
 
 void bplib_cache_custody_insert_tracking_block(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
                                                bplib_cache_custodian_info_t *custody_info);
-int  bplib_cache_custody_find_dacs_match(const bplib_rbt_link_t *node, void *arg);
+int  bplib_cache_custody_find_dacs_match(const bplib_cache_entry_t *store_entry, void *arg);
 bool bplib_cache_custody_find_pending_dacs(bplib_cache_state_t *state, bplib_cache_custodian_info_t *dacs_info);
 bplib_mpool_ref_t bplib_cache_custody_create_dacs(bplib_cache_state_t                *state,
                                                   bplib_mpool_bblock_primary_t      **pri_block_out,
                                                   bp_custody_accept_payload_block_t **pay_out);
 void              bplib_cache_custody_open_dacs(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info);
 void bplib_cache_custody_append_dacs(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info);
+void bplib_cache_custody_init_dacs_config(bplib_cache_dacs_config_t *config);
+int  bplib_cache_custody_configure_dacs(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+                                        const void *val);
+int  bplib_cache_custody_query_dacs(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+                                    const void **val);
 void bplib_cache_custody_update_tracking_block(bplib_cache_state_t *state, bplib_cache_custodian_info_t *custody_info);
-int  bplib_cache_custody_find_bundle_match(const bplib_rbt_link_t *node, void *arg);
+int  bplib_cache_custody_find_bundle_match(const bplib_cache_entry_t *store_entry, void *arg);
 void bplib_cache_custody_process_bundle(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
                                         bplib_cache_custodian_info_t *custody_info);
 void bplib_cache_custody_process_remote_dacs_bundle(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
@@ -0,0 +1,177 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "v7_cache_internal.h"
+
+/*
+ * -----------------------------------------------------------------------------------
+ * IMPLEMENTATION
+ * Helpers for the estimates of each interface
+ * -----------------------------------------------------------------------------------
+ */
+
+/*
+ * Returns the slot holding the interface, or BP_CACHE_RTT_MAX_INTF if none does
+ */
+static uint32_t bplib_cache_rtt_find(const bplib_cache_state_t *state, bp_handle_t egress_intf_id)
+{
+    uint32_t i;
+
+    for (i = 0; i < BP_CACHE_RTT_MAX_INTF; ++i)
+    {
+        if (bp_handle_equal(state->rtt_estimates[i].egress_intf_id, egress_intf_id))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*
+ * Gets a slot for an interface that has no estimate yet, the first free one if there is
+ * one, or otherwise the next one in turn.  The slot is cleared for the new interface.
+ */
+static bplib_cache_rtt_estimate_t *bplib_cache_rtt_new_slot(bplib_cache_state_t *state, bp_handle_t egress_intf_id)
+{
+    bplib_cache_rtt_estimate_t *estimate;
+    uint32_t                    i;
+
+    i = bplib_cache_rtt_find(state, BP_INVALID_HANDLE);
+    if (i == BP_CACHE_RTT_MAX_INTF)
+    {
+        i                    = state->rtt_next_slot;
+        state->rtt_next_slot = (state->rtt_next_slot + 1) % BP_CACHE_RTT_MAX_INTF;
+    }
+
+    estimate = &state->rtt_estimates[i];
+
+    estimate->egress_intf_id = egress_intf_id;
+    estimate->srtt           = 0;
+    estimate->rttvar         = 0;
+
+    return estimate;
+}
+
+/*
+ * -----------------------------------------------------------------------------------
+ * EXPORTED FUNCTIONS
+ * -----------------------------------------------------------------------------------
+ */
+
+void bplib_cache_rtt_sample(bplib_cache_state_t *state, bp_handle_t egress_intf_id, uint64_t rtt)
+{
+    bplib_cache_rtt_estimate_t *estimate;
+    uint32_t                    sample;
+    uint32_t                    delta;
+    uint32_t                    i;
+
+    if (!bp_handle_is_valid(egress_intf_id))
+    {
+        return;
+    }
+
+    /* anything longer than this would not change the retransmit time anyway */
+    if (rtt > BP_CACHE_RTT_MAX_RETX_TIME)
+    {
+        rtt = BP_CACHE_RTT_MAX_RETX_TIME;
+    }
+
+    sample = (uint32_t)rtt;
+
+    i = bplib_cache_rtt_find(state, egress_intf_id);
+    if (i == BP_CACHE_RTT_MAX_INTF)
+    {
+        /* the first sample is all there is to go on */
+        estimate         = bplib_cache_rtt_new_slot(state, egress_intf_id);
+        estimate->srtt   = sample;
+        estimate->rttvar = sample / 2;
+    }
+    else
+    {
+        estimate = &state->rtt_estimates[i];
+
+        /* the deviation is updated first, as it is from the smoothed time before this sample */
+        if (sample > estimate->srtt)
+        {
+            delta = sample - estimate->srtt;
+        }
+        else
+        {
+            delta = estimate->srtt - sample;
+        }
+
+        estimate->rttvar = (uint32_t)(((uint64_t)estimate->rttvar * 3 + delta) / 4);
+        estimate->srtt   = (uint32_t)(((uint64_t)estimate->srtt * 7 + sample) / 8);
+    }
+}
+
+uint64_t bplib_cache_rtt_retx_interval(const bplib_cache_state_t *state, bp_handle_t egress_intf_id,
+                                       uint64_t default_interval, uint32_t transmit_count)
+{
+    const bplib_cache_rtt_estimate_t *estimate;
+    uint64_t                          interval;
+    uint32_t                          backoff;
+    uint32_t                          i;
+
+    /* until something was measured on this interface, the interval set on the socket is used */
+    i = BP_CACHE_RTT_MAX_INTF;
+    if (bp_handle_is_valid(egress_intf_id))
+    {
+        i = bplib_cache_rtt_find(state, egress_intf_id);
+    }
+
+    if (i == BP_CACHE_RTT_MAX_INTF)
+    {
+        return default_interval;
+    }
+
+    estimate = &state->rtt_estimates[i];
+
+    interval = (uint64_t)estimate->srtt + ((uint64_t)estimate->rttvar * 4);
+    if (interval < BP_CACHE_RTT_MIN_RETX_TIME)
+    {
+        interval = BP_CACHE_RTT_MIN_RETX_TIME;
+    }
+
+    /* every time it had to be sent again, the wait for the ack is doubled */
+    backoff = 0;
+    if (transmit_count > 1)
+    {
+        backoff = transmit_count - 1;
+    }
+
+    if (backoff > BP_CACHE_RTT_MAX_BACKOFF)
+    {
+        backoff = BP_CACHE_RTT_MAX_BACKOFF;
+    }
+
+    interval <<= backoff;
+    if (interval > BP_CACHE_RTT_MAX_RETX_TIME)
+    {
+        interval = BP_CACHE_RTT_MAX_RETX_TIME;
+    }
+
+    return interval;
+}
@@ -0,0 +1,357 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "v7_cache_internal.h"
+
+/* the number of ticks spanned by one slot of the given level */
+#define BP_CACHE_TIMER_LEVEL_SHIFT(level) ((level) * BP_CACHE_TIMER_SLOT_SHIFT)
+
+/* the number of ticks spanned by the whole wheel */
+#define BP_CACHE_TIMER_SPAN ((uint64_t)1 << BP_CACHE_TIMER_LEVEL_SHIFT(BP_CACHE_TIMER_LEVELS))
+
+/*
+ * -----------------------------------------------------------------------------------
+ * IMPLEMENTATION
+ * Helpers for the slots of the wheel
+ * -----------------------------------------------------------------------------------
+ */
+
+static void bplib_cache_timer_place(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry)
+{
+    bplib_mpool_block_t **slot;
+    uint64_t              tick;
+    uint32_t              level;
+    uint32_t              index;
+
+    /* a deadline already passed goes in the slot that is expired first */
+    tick = store_entry->timer_deadline >> BP_CACHE_TIMER_TICK_SHIFT;
+    if (tick < wheel->base_tick)
+    {
+        tick = wheel->base_tick;
+    }
+
+    /* beyond the span of the wheel, this waits in the last slot, then gets placed again */
+    if ((tick - wheel->base_tick) >= BP_CACHE_TIMER_SPAN)
+    {
+        tick = wheel->base_tick + BP_CACHE_TIMER_SPAN - 1;
+    }
+
+    /* the lowest level where the tick is within one turn of the current position */
+    level = 0;
+    while ((tick - wheel->base_tick) >= ((uint64_t)1 << BP_CACHE_TIMER_LEVEL_SHIFT(level + 1)))
+    {
+        ++level;
+    }
+
+    index = (tick >> BP_CACHE_TIMER_LEVEL_SHIFT(level)) & (BP_CACHE_TIMER_SLOTS - 1);
+    slot  = &wheel->slots[level][index];
+
+    if (*slot == NULL)
+    {
+        *slot = &store_entry->timer_link;
+        wheel->occupied[level] |= (uint8_t)(1U << index);
+    }
+    else
+    {
+        bplib_mpool_insert_before(*slot, &store_entry->timer_link);
+    }
+
+    store_entry->timer_slot = slot;
+}
+
+/*
+ * Empties a slot, returning the ring of entries that were in it (or NULL if it was empty)
+ */
+static bplib_mpool_block_t *bplib_cache_timer_take_slot(bplib_cache_timer_wheel_t *wheel, uint32_t level,
+                                                        uint32_t index)
+{
+    bplib_mpool_block_t *ring;
+
+    ring                       = wheel->slots[level][index];
+    wheel->slots[level][index] = NULL;
+
+    wheel->occupied[level] &= (uint8_t)~(1U << index);
+
+    return ring;
+}
+
+/*
+ * Removes the first entry from a ring taken from a slot, and moves the ring to the next one
+ */
+static bplib_cache_entry_t *bplib_cache_timer_next_from_ring(bplib_mpool_block_t **ring)
+{
+    bplib_mpool_block_t *link;
+
+    link = *ring;
+    if (bplib_mpool_is_link_unattached(link))
+    {
+        *ring = NULL;
+    }
+    else
+    {
+        *ring = link->next;
+    }
+
+    bplib_mpool_extract_node(link);
+
+    return bplib_cache_entry_from_timer_link(link);
+}
+
+/*
+ * Spreads the entries of a slot out into the levels below, once the wheel reaches the time it covers
+ */
+static void bplib_cache_timer_cascade(bplib_cache_timer_wheel_t *wheel, uint32_t level)
+{
+    bplib_mpool_block_t *ring;
+    uint32_t             index;
+
+    index = (wheel->base_tick >> BP_CACHE_TIMER_LEVEL_SHIFT(level)) & (BP_CACHE_TIMER_SLOTS - 1);
+    ring  = bplib_cache_timer_take_slot(wheel, level, index);
+    while (ring != NULL)
+    {
+        bplib_cache_timer_place(wheel, bplib_cache_timer_next_from_ring(&ring));
+    }
+}
+
+/*
+ * The first tick where something in the given level is due, either to expire or to cascade
+ */
+static uint64_t bplib_cache_timer_level_due_tick(const bplib_cache_timer_wheel_t *wheel, uint32_t level)
+{
+    uint64_t position;
+    uint32_t shift;
+    uint32_t offset;
+    uint32_t first_offset;
+
+    shift    = BP_CACHE_TIMER_LEVEL_SHIFT(level);
+    position = wheel->base_tick >> shift;
+
+    /* the slot at the current position was already cascaded, unless the wheel is exactly at its start */
+    if ((wheel->base_tick & (((uint64_t)1 << shift) - 1)) == 0)
+    {
+        first_offset = 0;
+    }
+    else
+    {
+        first_offset = 1;
+    }
+
+    for (offset = first_offset; offset <= BP_CACHE_TIMER_SLOTS; ++offset)
+    {
+        if ((wheel->occupied[level] & (1U << ((position + offset) & (BP_CACHE_TIMER_SLOTS - 1)))) != 0)
+        {
+            break;
+        }
+    }
+
+    return (position + offset) << shift;
+}
+
+/*
+ * -----------------------------------------------------------------------------------
+ * EXPORTED FUNCTIONS
+ * -----------------------------------------------------------------------------------
+ */
+
+void bplib_cache_timer_insert(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry, uint64_t deadline,
+                              uint64_t now)
+{
+    /* nothing needs to be caught up in an empty wheel, it can just start over from now */
+    if (wheel->num_entries == 0)
+    {
+        wheel->base_tick = now >> BP_CACHE_TIMER_TICK_SHIFT;
+    }
+
+    store_entry->timer_deadline = deadline;
+    bplib_cache_timer_place(wheel, store_entry);
+    ++wheel->num_entries;
+}
+
+void bplib_cache_timer_cancel(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry)
+{
+    bplib_mpool_block_t **slot;
+    size_t                position;
+
+    slot = store_entry->timer_slot;
+    if (slot == NULL)
+    {
+        /* not scheduled */
+        return;
+    }
+
+    /* if the slot refers to this entry, it needs to refer to the next one (if there is one) */
+    if (*slot == &store_entry->timer_link)
+    {
+        if (bplib_mpool_is_link_unattached(&store_entry->timer_link))
+        {
+            position = slot - &wheel->slots[0][0];
+            bplib_cache_timer_take_slot(wheel, position / BP_CACHE_TIMER_SLOTS, position % BP_CACHE_TIMER_SLOTS);
+        }
+        else
+        {
+            *slot = store_entry->timer_link.next;
+        }
+    }
+
+    bplib_mpool_extract_node(&store_entry->timer_link);
+    store_entry->timer_slot = NULL;
+    --wheel->num_entries;
+}
+
+void bplib_cache_timer_expire(bplib_cache_timer_wheel_t *wheel, uint64_t now)
+{
+    bplib_mpool_block_t *ring;
+    bplib_cache_entry_t *store_entry;
+    uint64_t             now_tick;
+    uint64_t             next_tick;
+    uint64_t             mask;
+    uint32_t             level;
+
+    now_tick = now >> BP_CACHE_TIMER_TICK_SHIFT;
+    while (wheel->base_tick < now_tick)
+    {
+        if (wheel->num_entries == 0)
+        {
+            wheel->base_tick = now_tick;
+            break;
+        }
+
+        /* nothing can happen before the next slot of the lowest level in use, so skip ahead to it */
+        level = 0;
+        while (level < (BP_CACHE_TIMER_LEVELS - 1) && wheel->occupied[level] == 0)
+        {
+            ++level;
+        }
+
+        mask      = ((uint64_t)1 << BP_CACHE_TIMER_LEVEL_SHIFT(level)) - 1;
+        next_tick = (wheel->base_tick + mask) & ~mask;
+        if (next_tick >= now_tick)
+        {
+            wheel->base_tick = now_tick;
+            break;
+        }
+
+        wheel->base_tick = next_tick;
+
+        /* at the start of each turn of a level, the next slot of the level above comes due */
+        level = 1;
+        while (level < BP_CACHE_TIMER_LEVELS &&
+               (wheel->base_tick & (((uint64_t)1 << BP_CACHE_TIMER_LEVEL_SHIFT(level)) - 1)) == 0)
+        {
+            bplib_cache_timer_cascade(wheel, level);
+            ++level;
+        }
+
+        /* every entry in the slot for this tick is due, they all get expired together */
+        ring = bplib_cache_timer_take_slot(wheel, 0, wheel->base_tick & (BP_CACHE_TIMER_SLOTS - 1));
+        while (ring != NULL)
+        {
+            store_entry             = bplib_cache_timer_next_from_ring(&ring);
+            store_entry->timer_slot = NULL;
+            --wheel->num_entries;
+
+            bplib_cache_entry_make_pending(store_entry, 0, 0);
+        }
+
+        ++wheel->base_tick;
+    }
+}
+
+uint64_t bplib_cache_timer_next_deadline(const bplib_cache_timer_wheel_t *wheel)
+{
+    uint64_t due_tick;
+    uint64_t tick;
+    uint32_t level;
+
+    if (wheel->num_entries == 0)
+    {
+        return BP_CACHE_TIME_INFINITE;
+    }
+
+    due_tick = UINT64_MAX;
+    for (level = 0; level < BP_CACHE_TIMER_LEVELS; ++level)
+    {
+        if (wheel->occupied[level] != 0)
+        {
+            tick = bplib_cache_timer_level_due_tick(wheel, level);
+            if (tick < due_tick)
+            {
+                due_tick = tick;
+            }
+        }
+    }
+
+    /* a tick is handled once it has passed, that is, at the start of the tick after it */
+    return (due_tick + 1) << BP_CACHE_TIMER_TICK_SHIFT;
+}
+
+void bplib_cache_timer_foreach_latest(const bplib_cache_timer_wheel_t *wheel, bplib_cache_timer_visit_func_t visit_func,
+                                      void *arg)
+{
+    bplib_mpool_block_t *first;
+    bplib_mpool_block_t *link;
+    uint32_t             level;
+    uint32_t             step;
+    uint32_t             offset;
+    uint32_t             index;
+
+    /*
+     * The highest levels are furthest out, and within a level the slots furthest from the current
+     * position.  Above the lowest level, the slot at the current position has already cascaded, so
+     * anything in it is a full turn ahead.  Levels overlap a little, so this is only roughly in order.
+     */
+    level = BP_CACHE_TIMER_LEVELS;
+    while (level > 0)
+    {
+        --level;
+        for (step = 0; step < BP_CACHE_TIMER_SLOTS; ++step)
+        {
+            if (level == 0)
+            {
+                offset = BP_CACHE_TIMER_SLOTS - 1 - step;
+            }
+            else
+            {
+                offset = (BP_CACHE_TIMER_SLOTS - step) & (BP_CACHE_TIMER_SLOTS - 1);
+            }
+
+            index = ((wheel->base_tick >> BP_CACHE_TIMER_LEVEL_SHIFT(level)) + offset) & (BP_CACHE_TIMER_SLOTS - 1);
+            first = wheel->slots[level][index];
+            link  = first;
+            while (link != NULL)
+            {
+                if (!visit_func(arg, bplib_cache_entry_from_timer_link(link)))
+                {
+                    return;
+                }
+
+                link = link->next;
+                if (link == first)
+                {
+                    link = NULL;
+                }
+            }
+        }
+    }
+}
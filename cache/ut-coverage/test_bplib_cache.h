@@ -26,17 +26,25 @@
 #include "v7_cache_internal.h"
 
 void test_setup_cache_state(bplib_mpool_block_t *sblk);
+void test_setup_cache_hash_entry(bplib_cache_hash_table_t *table, bplib_cache_hash_slot_t slots[2],
+                                 bplib_cache_entry_t *store_entry);
 void UT_cache_sizet_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_uint64_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
+void UT_cache_intf_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_egress_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
+void UT_cache_rbt_iter_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
+void UT_cache_rbt_scan_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_valid_bphandle_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_bool_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_GetTime_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void UT_cache_int8_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context);
 void TestBplibCacheCustody_Register(void);
 void TestBplibCacheFsm_Register(void);
+void TestBplibCacheHash_Register(void);
+void TestBplibCacheRtt_Register(void);
 void TestBplibCache_Register(void);
+void TestBplibCacheTimer_Register(void);
 bplib_mpool_block_t *test_bplib_cache_instantiate_stub(bplib_mpool_ref_t parent_ref, void *init_arg);
 int                  test_bplib_cache_configure_stub(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
                                                      const void *val);
@@ -45,5 +53,7 @@ int test_bplib_cache_startstop_stub(bplib_mpool_block_t *svc);
 int test_bplib_cache_offload_stub(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
 int test_bplib_cache_restore_stub(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk);
 int test_bplib_cache_release_stub(bplib_mpool_block_t *svc, bp_sid_t sid);
+int test_bplib_cache_flush_stub(bplib_mpool_block_t *svc);
+int test_bplib_cache_recover_stub(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg);
 
 #endif
@@ -32,6 +32,19 @@ void test_setup_cache_state(bplib_mpool_block_t *sblk)
     bplib_mpool_list_iter_goto_first(&pending_list, &list_it);
 }
 
+void test_setup_cache_hash_entry(bplib_cache_hash_table_t *table, bplib_cache_hash_slot_t slots[2],
+                                 bplib_cache_entry_t *store_entry)
+{
+    /* the CRC stubs make every hash 0, so an entry in the first slot matches every search */
+    memset(slots, 0, sizeof(bplib_cache_hash_slot_t) * 2);
+    slots[0].store_entry = store_entry;
+    store_entry->hash_key = 0;
+
+    table->slots       = slots;
+    table->capacity    = 2;
+    table->num_entries = 1;
+}
+
 void UT_cache_sizet_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
 {
     size_t retval = 0;
@@ -50,6 +63,39 @@ void UT_cache_uint64_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_Stub
     UT_Stub_SetReturnValue(FuncKey, Result);
 }
 
+void UT_cache_rbt_scan_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_rbt_scan_func_t scan_func = UT_Hook_GetArgValueByName(Context, "scan_func", bplib_rbt_scan_func_t);
+    void                 *scan_arg  = UT_Hook_GetArgValueByName(Context, "scan_arg", void *);
+    uint32_t              count     = 0;
+
+    /* the scan visits just the given link, if there is one */
+    if (UserObj != NULL)
+    {
+        scan_func(UserObj, scan_arg);
+        ++count;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, count);
+}
+
+void UT_cache_rbt_iter_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_rbt_iter_t *iter = UT_Hook_GetArgValueByName(Context, "iter", bplib_rbt_iter_t *);
+    int32             StatusCode;
+    int               retval;
+
+    /* on success the iterator is left at the given link */
+    UT_Stub_GetInt32StatusCode(Context, &StatusCode);
+    if (StatusCode == BP_SUCCESS)
+    {
+        iter->position = UserObj;
+    }
+
+    retval = StatusCode;
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
 void UT_cache_valid_bphandle_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
 {
     bp_handle_t retval = BPLIB_HANDLE_RAM_STORE_BASE;
@@ -61,6 +107,33 @@ void UT_cache_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, con
     UT_Stub_SetReturnValue(FuncKey, UserObj);
 }
 
+void UT_cache_intf_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_cache_intf_t *intf           = UserObj;
+    uint32_t            required_magic = UT_Hook_GetArgValueByName(Context, "required_magic", uint32_t);
+    void               *retval;
+
+    /* the storage flow block casts to the intf, and the state block to the state it refers to */
+    if (required_magic == BPLIB_STORE_SIGNATURE_INTF)
+    {
+        retval = intf;
+    }
+    else if (required_magic == BPLIB_STORE_SIGNATURE_STATE)
+    {
+        retval = intf->state;
+    }
+    else if (required_magic == BPLIB_STORE_SIGNATURE_TIMER)
+    {
+        retval = intf->state->timer_wheel;
+    }
+    else
+    {
+        retval = NULL;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
 void UT_cache_egress_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
 {
     void *retval = NULL;
@@ -129,9 +202,22 @@ int test_bplib_cache_release_stub(bplib_mpool_block_t *svc, bp_sid_t sid)
     return UT_DEFAULT_IMPL(test_bplib_cache_release_stub);
 }
 
+int test_bplib_cache_flush_stub(bplib_mpool_block_t *svc)
+{
+    return UT_DEFAULT_IMPL(test_bplib_cache_flush_stub);
+}
+
+int test_bplib_cache_recover_stub(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg)
+{
+    return UT_DEFAULT_IMPL(test_bplib_cache_recover_stub);
+}
+
 void UtTest_Setup(void)
 {
     TestBplibCacheCustody_Register();
     TestBplibCacheFsm_Register();
+    TestBplibCacheHash_Register();
+    TestBplibCacheRtt_Register();
     TestBplibCache_Register();
+    TestBplibCacheTimer_Register();
 }
@@ -30,12 +30,196 @@ void test_bplib_cache_entry_make_pending(void)
     uint32_t            set_flags   = 1;
     uint32_t            clear_flags = 0;
     bplib_mpool_block_t sblk;
+    bplib_cache_state_t state;
 
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    store_entry.parent = &state;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &sblk);
     UtAssert_VOIDCALL(bplib_cache_entry_make_pending(&store_entry, set_flags, clear_flags));
+    UtAssert_ZERO(state.pending_count);
+
+    /* only counted when it was not already on the list */
+    sblk.next = &sblk;
+    UtAssert_VOIDCALL(bplib_cache_entry_make_pending(&store_entry, set_flags, clear_flags));
+    UtAssert_UINT32_EQ(state.pending_count, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_entry_retain_content(void)
+{
+    /* Test function for:
+     * void bplib_cache_entry_retain_content(bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_entry_t          store_entry;
+    bplib_cache_state_t          state;
+    bplib_mpool_block_t          blk;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    store_entry.parent = &state;
+
+    /* nothing to keep */
+    UtAssert_VOIDCALL(bplib_cache_entry_retain_content(&store_entry));
+    UtAssert_ZERO(store_entry.resident_size);
+
+    /* without a budget, the content is released right away */
+    store_entry.refptr = (bplib_mpool_ref_t)&blk;
+    UtAssert_VOIDCALL(bplib_cache_entry_retain_content(&store_entry));
+    UtAssert_NULL(store_entry.refptr);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    /* with a budget, it is kept and counted */
+    state.resident_budget              = 10000;
+    store_entry.refptr                 = (bplib_mpool_ref_t)&blk;
+    pri_block.bundle_encode_size_cache = 100;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UtAssert_VOIDCALL(bplib_cache_entry_retain_content(&store_entry));
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &blk);
+    UtAssert_UINT32_EQ(store_entry.resident_size, sizeof(bplib_mpool_bblock_primary_t) + 100);
+    UtAssert_UINT32_EQ(state.resident_bytes, store_entry.resident_size);
+
+    /* only counted once */
+    UtAssert_VOIDCALL(bplib_cache_entry_retain_content(&store_entry));
+    UtAssert_UINT32_EQ(state.resident_bytes, store_entry.resident_size);
+
+    /* a block that is not a bundle only counts the primary block */
+    store_entry.resident_size = 0;
+    state.resident_bytes      = 0;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UtAssert_VOIDCALL(bplib_cache_entry_retain_content(&store_entry));
+    UtAssert_UINT32_EQ(state.resident_bytes, sizeof(bplib_mpool_bblock_primary_t));
+}
+
+void test_bplib_cache_entry_release_content(void)
+{
+    /* Test function for:
+     * void bplib_cache_entry_release_content(bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_entry_t store_entry;
+    bplib_cache_state_t state;
+    bplib_mpool_block_t blk;
+
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    store_entry.parent = &state;
+
+    UtAssert_VOIDCALL(bplib_cache_entry_release_content(&store_entry));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 0);
+
+    store_entry.refptr        = (bplib_mpool_ref_t)&blk;
+    store_entry.resident_size = 200;
+    state.resident_bytes      = 300;
+    state.resident_count      = 2;
+    UtAssert_VOIDCALL(bplib_cache_entry_release_content(&store_entry));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+    UtAssert_NULL(store_entry.refptr);
+    UtAssert_UINT32_EQ(state.resident_count, 1);
+    UtAssert_ZERO(store_entry.resident_size);
+    UtAssert_UINT32_EQ(state.resident_bytes, 100);
+}
+
+void test_bplib_cache_entry_restore_content(void)
+{
+    /* Test function for:
+     * bool bplib_cache_entry_restore_content(bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_state_t       state;
+    bplib_cache_offload_api_t offload_api;
+    bplib_mpool_block_t       blk;
+
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    store_entry.parent  = &state;
+    state.offload_api   = &offload_api;
+    offload_api.restore = test_bplib_cache_restore_stub;
+
+    /* never offloaded */
+    UtAssert_BOOL_FALSE(bplib_cache_entry_restore_content(&store_entry));
+
+    /* already in memory */
+    store_entry.refptr = (bplib_mpool_ref_t)&blk;
+    UtAssert_BOOL_TRUE(bplib_cache_entry_restore_content(&store_entry));
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 0);
+
+    /* the read fails */
+    store_entry.refptr      = NULL;
+    store_entry.offload_sid = (bp_sid_t)1;
+    UT_SetDeferredRetcode(UT_KEY(test_bplib_cache_restore_stub), 1, BP_ERROR);
+    UtAssert_BOOL_FALSE(bplib_cache_entry_restore_content(&store_entry));
+    UtAssert_NULL(store_entry.refptr);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, &blk);
+    UtAssert_BOOL_TRUE(bplib_cache_entry_restore_content(&store_entry));
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &blk);
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 2);
+    UtAssert_UINT32_EQ(state.resident_count, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_enforce_resident_budget(void)
+{
+    /* Test function for:
+     * void bplib_cache_enforce_resident_budget(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t       state;
+    bplib_cache_timer_wheel_t timer_wheel;
+    bplib_cache_entry_t       entries[3];
+    bplib_mpool_block_t       blk;
+    bplib_mpool_block_t       sblk;
+    uint32_t                  i;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    memset(entries, 0, sizeof(entries));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    state.timer_wheel = &timer_wheel;
+    sblk.next         = &sblk;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &sblk);
+
+    /* within the budget, nothing is looked at */
+    UtAssert_VOIDCALL(bplib_cache_enforce_resident_budget(&state));
+
+    /* the entry due last is in the highest level, the one due soonest is in the lowest */
+    for (i = 0; i < 3; ++i)
+    {
+        entries[i].parent          = &state;
+        entries[i].state           = bplib_cache_entry_state_idle;
+        entries[i].refptr          = (bplib_mpool_ref_t)&blk;
+        entries[i].resident_size   = 100;
+        entries[i].timer_link.next = &entries[i].timer_link;
+        timer_wheel.slots[i][1]    = &entries[i].timer_link;
+    }
+
+    /* one that is queued cannot give up its content */
+    entries[2].state = bplib_cache_entry_state_queue;
+
+    state.resident_bytes  = 300;
+    state.resident_budget = 250;
+    UtAssert_VOIDCALL(bplib_cache_enforce_resident_budget(&state));
+    UtAssert_UINT32_EQ(state.resident_bytes, 200);
+    UtAssert_NOT_NULL(entries[0].refptr);
+    UtAssert_NULL(entries[1].refptr);
+    UtAssert_NOT_NULL(entries[2].refptr);
+
+    /* one on the pending list is about to be sent, so it keeps its content too */
+    sblk.next            = &blk;
+    state.resident_bytes = 300;
+    UtAssert_VOIDCALL(bplib_cache_enforce_resident_budget(&state));
+    UtAssert_UINT32_EQ(state.resident_bytes, 300);
+    UtAssert_NOT_NULL(entries[0].refptr);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -46,12 +230,17 @@ void test_bplib_cache_attach(void)
      */
     bplib_routetbl_t   *tbl = NULL;
     bp_ipn_addr_t       service_addr;
-    bplib_mpool_block_t sblk;
-    bplib_cache_state_t state;
+    bplib_mpool_block_t       sblk;
+    bplib_cache_state_t       state;
+    bplib_cache_intf_t        intf;
+    bplib_cache_timer_wheel_t timer_wheel;
 
     memset(&service_addr, 0, sizeof(bp_ipn_addr_t));
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    intf.state = &state;
 
     UT_SetHandlerFunction(UT_KEY(bplib_route_get_mpool), UT_cache_sizet_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_cache_sizet_Handler, NULL);
@@ -62,9 +251,62 @@ void test_bplib_cache_attach(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_cache_AltHandler_PointerReturn, &sblk);
     UtAssert_UINT32_EQ(bplib_cache_attach(tbl, &service_addr).hdl, 0);
 
+    /* no memory for the timer wheel */
     UT_SetHandlerFunction(UT_KEY(bplib_dataservice_attach), UT_cache_valid_bphandle_Handler, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_attach(tbl, &service_addr).hdl, 0);
+
+    state.timer_wheel = &timer_wheel;
     UtAssert_UINT32_NEQ(bplib_cache_attach(tbl, &service_addr).hdl, 0);
+    UtAssert_ADDRESS_EQ(state.timer_wheel, &timer_wheel);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_attach_sharded(void)
+{
+    /* Test function for:
+     * bp_handle_t bplib_cache_attach_sharded(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr,
+     * uint32_t num_shards)
+     */
+    bplib_routetbl_t         *tbl = NULL;
+    bp_ipn_addr_t             service_addr;
+    bplib_mpool_block_t       sblk;
+    bplib_cache_state_t       state;
+    bplib_cache_intf_t        intf;
+    bplib_cache_timer_wheel_t timer_wheel;
+
+    memset(&service_addr, 0, sizeof(bp_ipn_addr_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    intf.state        = &state;
+    state.timer_wheel = &timer_wheel;
+
+    UtAssert_UINT32_EQ(bplib_cache_attach_sharded(tbl, &service_addr, 0).hdl, 0);
+    UtAssert_UINT32_EQ(bplib_cache_attach_sharded(tbl, &service_addr, BP_CACHE_MAX_SHARDS + 1).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_alloc, 0);
+
+    /* every shard gets the same state here, which is enough to see it counted */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_cache_AltHandler_PointerReturn, &sblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UT_SetHandlerFunction(UT_KEY(bplib_dataservice_attach), UT_cache_valid_bphandle_Handler, NULL);
+
+    /* the route table does not take the sub-interface */
+    UtAssert_UINT32_NEQ(bplib_cache_attach_sharded(tbl, &service_addr, 2).hdl, 0);
+    UtAssert_ZERO(state.num_shards);
+    UtAssert_UINT32_EQ(state.generated_dacs_seq_step, 1);
+    UtAssert_STUB_COUNT(bplib_route_register_generic_intf, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_route_register_generic_intf), UT_cache_valid_bphandle_Handler, NULL);
+    UtAssert_UINT32_NEQ(bplib_cache_attach_sharded(tbl, &service_addr, 2).hdl, 0);
+    UtAssert_UINT32_EQ(state.num_shards, 1);
+    UtAssert_UINT32_EQ(state.generated_dacs_seq_step, 2);
+    UtAssert_STUB_COUNT(bplib_route_register_generic_intf, 2);
+    UtAssert_STUB_COUNT(bplib_route_register_event_handler, 3);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
@@ -79,19 +321,33 @@ void test_bplib_cache_detach(void)
     bp_ipn_addr_t       service_addr;
     bplib_mpool_ref_t   flow_block_ref;
     bplib_cache_state_t state;
+    bplib_cache_intf_t  intf;
+    bplib_mpool_block_t shard_blk;
 
     memset(&service_addr, 0, sizeof(bp_ipn_addr_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
     service_addr.node_number    = 100;
     service_addr.service_number = 101;
     memset(&flow_block_ref, 0, sizeof(bplib_mpool_ref_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
 
     UT_SetHandlerFunction(UT_KEY(bplib_dataservice_detach), UT_cache_sizet_Handler, NULL);
     UtAssert_UINT32_GT(bplib_cache_detach(tbl, &service_addr), 0);
 
     UT_SetHandlerFunction(UT_KEY(bplib_dataservice_detach), UT_cache_AltHandler_PointerReturn, &flow_block_ref);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_detach(tbl, &service_addr), 0);
+    UtAssert_STUB_COUNT(bplib_route_del_intf, 0);
+
+    /* the shards go along with it */
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
     UtAssert_UINT32_EQ(bplib_cache_detach(tbl, &service_addr), 0);
+    UtAssert_STUB_COUNT(bplib_route_del_intf, 1);
+    UtAssert_ZERO(state.num_shards);
+    UtAssert_NULL(state.shards[0]);
 
     UT_SetHandlerFunction(UT_KEY(bplib_dataservice_detach), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
@@ -108,18 +364,21 @@ void test_bplib_cache_register_module_service(void)
     bplib_cache_module_api_t api;
     void                    *init_arg = NULL;
     bplib_cache_state_t      state;
+    bplib_cache_intf_t       intf;
     bplib_mpool_ref_t        parent_ref;
     bplib_mpool_block_t      cblk;
 
     memset(&api, 0, sizeof(bplib_cache_module_api_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&parent_ref, 0, sizeof(bplib_mpool_ref_t));
     memset(&cblk, 0, sizeof(bplib_mpool_block_t));
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_block_from_external_id), UT_cache_sizet_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_cache_register_module_service(tbl, cache_intf_id, NULL, init_arg).hdl, 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, &parent_ref);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_block_from_external_id), UT_cache_AltHandler_PointerReturn, &cblk);
     api.instantiate = test_bplib_cache_instantiate_stub;
@@ -127,6 +386,13 @@ void test_bplib_cache_register_module_service(void)
     api.module_type = bplib_cache_module_type_offload;
     UtAssert_UINT32_GT(bplib_cache_register_module_service(tbl, cache_intf_id, &api, init_arg).hdl, 0);
 
+    /* one module serves all the shards */
+    state.num_shards = 1;
+    state.shards[0]   = (bplib_mpool_ref_t)&cblk;
+    state.offload_api = NULL;
+    UtAssert_UINT32_GT(bplib_cache_register_module_service(tbl, cache_intf_id, &api, init_arg).hdl, 0);
+    UtAssert_ADDRESS_EQ(state.offload_api, &api);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_block_from_external_id), UT_cache_AltHandler_PointerReturn, NULL);
@@ -144,21 +410,145 @@ void test_bplib_cache_configure(void)
     bplib_cache_module_valtype_t vt             = bplib_cache_module_valtype_integer;
     void                        *val            = NULL;
     bplib_cache_state_t          state;
+    bplib_cache_intf_t           intf;
     bplib_mpool_block_t          blk;
     bplib_cache_offload_api_t    api;
+    int                          value;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
     memset(&api, 0, sizeof(bplib_cache_offload_api_t));
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_block_from_external_id), UT_cache_sizet_Handler, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     state.offload_blk = &blk;
     state.offload_api = &api;
     api.std.configure = test_bplib_cache_configure_stub;
 
     UtAssert_UINT32_EQ(bplib_cache_configure(tbl, module_intf_id, key, vt, val), 0);
 
+    /* the DACS keys are handled by the cache itself */
+    value = 1000;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_dacs_open_time, vt, &value),
+                      BP_ERROR);
+    bplib_cache_custody_init_dacs_config(&state.dacs_config);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_dacs_open_time, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.dacs_config.open_time, 1000);
+
+    /* so is the resident budget, which cannot be negative */
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_resident_budget, vt, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_resident_budget,
+                                            bplib_cache_module_valtype_string, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_resident_budget, vt, NULL),
+                      BP_ERROR);
+    value = 100000;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_resident_budget, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.resident_budget, 100000);
+
+    /* and the prefetch depth */
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_prefetch_depth, vt, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_prefetch_depth,
+                                            bplib_cache_module_valtype_string, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_prefetch_depth, vt, NULL),
+                      BP_ERROR);
+    value = 8;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_prefetch_depth, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.prefetch_depth, 8);
+
+    /* and the limit on entries per run */
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_flush_limit, vt, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_flush_limit,
+                                            bplib_cache_module_valtype_string, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_flush_limit, vt, NULL),
+                      BP_ERROR);
+    value = 0;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_flush_limit, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_ZERO(state.flush_limit);
+
+    /* and the transmit order, only the known ones */
+    value = BP_CACHE_TRANSMIT_ORDER_PRIORITY + 1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_transmit_order, vt, &value),
+                      BP_ERROR);
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_transmit_order, vt, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_transmit_order, vt, NULL),
+                      BP_ERROR);
+    value = BP_CACHE_TRANSMIT_ORDER_DEADLINE;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_transmit_order, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.transmit_order, BP_CACHE_TRANSMIT_ORDER_DEADLINE);
+
+    /* and the shed policy */
+    value = BP_CACHE_SHED_POLICY_DEADLINE + 1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_shed_policy, vt, &value),
+                      BP_ERROR);
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_shed_policy, vt, &value),
+                      BP_ERROR);
+    value = BP_CACHE_SHED_POLICY_PRIORITY;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_shed_policy, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.shed_policy, BP_CACHE_SHED_POLICY_PRIORITY);
+
+    /* and memory custody, which is only on or off */
+    value = 2;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_memory_custody, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.memory_custody, 1);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_memory_custody, vt, NULL),
+                      BP_ERROR);
+
+    /* the footprint class is a class of service, or -1 for all of them */
+    value = BP_COS_EXPEDITED;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_footprint_class, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.footprint_class, BP_COS_EXPEDITED);
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_footprint_class, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.footprint_class, -1);
+    value = BP_CACHE_FOOTPRINT_CLASSES;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_footprint_class, vt, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(state.footprint_class, -1);
+
+    /* with shards, the cache keys go to each of them */
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&blk;
+    value            = 16;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_flush_limit, vt, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.flush_limit, 16);
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_flush_limit, vt, &value),
+                      BP_ERROR);
+
+    /* the stat keys can only be queried, and are not passed to the offload module */
+    value = 0;
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_stat_pending, vt, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(
+        bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_stat_custody_hold_time, vt, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_configure(tbl, module_intf_id, bplib_cache_confkey_stat_evictions, vt, &value),
+                      BP_ERROR);
+    UtAssert_STUB_COUNT(test_bplib_cache_configure_stub, 1);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -174,19 +564,191 @@ void test_bplib_cache_query(void)
     bplib_cache_module_valtype_t vt             = bplib_cache_module_valtype_integer;
     void                        *val            = NULL;
     bplib_cache_state_t          state;
+    bplib_cache_intf_t           intf;
     bplib_mpool_block_t          blk;
     bplib_cache_offload_api_t    api;
+    const void                  *qval;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
     memset(&api, 0, sizeof(bplib_cache_offload_api_t));
 
     state.offload_blk = &blk;
     state.offload_api = &api;
     api.std.query     = test_bplib_cache_query_stub;
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    qval              = NULL;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     UtAssert_UINT32_EQ(bplib_cache_query(tbl, module_intf_id, key, vt, val), 0);
 
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_dacs_max_entries, vt, &qval),
+                      BP_SUCCESS);
+
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_resident_budget, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(qval, &state.resident_budget);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_resident_budget,
+                                        bplib_cache_module_valtype_string, &qval),
+                      BP_ERROR);
+
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_prefetch_depth, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(qval, &state.prefetch_depth);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_prefetch_depth,
+                                        bplib_cache_module_valtype_string, &qval),
+                      BP_ERROR);
+
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_flush_limit, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(qval, &state.flush_limit);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_flush_limit,
+                                        bplib_cache_module_valtype_string, &qval),
+                      BP_ERROR);
+
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_memory_custody, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(qval, &state.memory_custody);
+
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_footprint_class, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(qval, &state.footprint_class);
+
+    /* the stat keys are computed from the counts in the state */
+    state.fsm_state_enter_count[bplib_cache_entry_state_idle]          = 7;
+    state.fsm_state_exit_count[bplib_cache_entry_state_idle]           = 4;
+    state.fsm_state_enter_count[bplib_cache_entry_state_queue]         = 4;
+    state.fsm_state_exit_count[bplib_cache_entry_state_queue]          = 3;
+    state.fsm_state_enter_count[bplib_cache_entry_state_delete]        = 2;
+    state.fsm_state_exit_count[bplib_cache_entry_state_delete]         = 0;
+    state.fsm_state_enter_count[bplib_cache_entry_state_generate_dacs] = 5;
+    state.fsm_state_exit_count[bplib_cache_entry_state_generate_dacs]  = 3;
+    state.discard_count                                                = 9;
+    state.stored_bytes                                                 = 12345;
+    state.offloaded_count                                              = 2;
+    state.resident_count                                               = 3;
+    state.pending_count                                                = 1;
+    state.dacs_closed_count                                            = 3;
+    state.evict_count                                                  = 6;
+    state.evict_release_count                                          = 8;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_entries_idle, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(qval, &state.query_value);
+    UtAssert_INT32_EQ(state.query_value, 3);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_entries_queue, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 1);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_entries_delete, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 2);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_dacs_open, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 2);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_fsm_transitions, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 10);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_discards, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 9);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_stored_bytes, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 12345);
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_entries_offloaded, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 2);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_entries_resident, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 3);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_pending, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 1);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_dacs_closed, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 3);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_evictions, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 6);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_evict_releases, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 8);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_pending,
+                                        bplib_cache_module_valtype_string, &qval),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_pending, vt, NULL), BP_ERROR);
+
+    /* the hold time is an average, 0 until anything has been released */
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_custody_hold_time, vt, &qval), BP_SUCCESS);
+    UtAssert_ZERO(state.query_value);
+    state.custody_hold_time     = 3000;
+    state.custody_release_count = 4;
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_custody_hold_time, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 750);
+
+    /* counts of events wrap, amounts held are limited */
+    state.discard_count = 0x80000005;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_discards, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 5);
+    state.resident_count = 0x80000005;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_entries_resident, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, INT_MAX);
+
+    /* the footprint is an average over the entries of every class, or only of the one set */
+    state.footprint_class                        = -1;
+    state.footprint_count[BP_COS_BULK]           = 2;
+    state.footprint_bytes[BP_COS_BULK]           = 1000;
+    state.footprint_blocks[BP_COS_BULK]          = 8;
+    state.footprint_bytes_max[BP_COS_BULK]       = 600;
+    state.footprint_blocks_max[BP_COS_BULK]      = 5;
+    state.footprint_count[BP_COS_EXPEDITED]      = 1;
+    state.footprint_bytes[BP_COS_EXPEDITED]      = 2000;
+    state.footprint_blocks[BP_COS_EXPEDITED]     = 10;
+    state.footprint_bytes_max[BP_COS_EXPEDITED]  = 2000;
+    state.footprint_blocks_max[BP_COS_EXPEDITED] = 10;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 1000);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_blocks, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 6);
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes_max, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 2000);
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_blocks_max, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 10);
+    state.footprint_class = BP_COS_BULK;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 500);
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes_max, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 600);
+    state.footprint_class = BP_COS_NORMAL;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_ZERO(state.query_value);
+    state.footprint_class = -1;
+
+    /* with shards, the total over all of them, here the shard is the same state so it counts twice */
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&blk;
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_stored_bytes, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 24690);
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_custody_hold_time, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 750);
+    UtAssert_INT32_EQ(bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes, vt, &qval),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 1000);
+    UtAssert_INT32_EQ(
+        bplib_cache_query(tbl, module_intf_id, bplib_cache_confkey_stat_footprint_bytes_max, vt, &qval), BP_SUCCESS);
+    UtAssert_INT32_EQ(state.query_value, 2000);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -198,18 +760,33 @@ void test_bplib_cache_start(void)
     bplib_routetbl_t         *tbl = NULL;
     bp_handle_t               module_intf_id;
     bplib_cache_state_t       state;
+    bplib_cache_intf_t        intf;
     bplib_mpool_block_t       blk;
     bplib_cache_offload_api_t api;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
     memset(&api, 0, sizeof(bplib_cache_offload_api_t));
     state.offload_blk = &blk;
     state.offload_api = &api;
     api.std.start     = test_bplib_cache_startstop_stub;
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_start(tbl, module_intf_id), 0);
+
+    /* a module that keeps an index is asked for what it held from before, which is then indexed */
+    api.recover = test_bplib_cache_recover_stub;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_goto_first), BP_ERROR);
     UtAssert_UINT32_EQ(bplib_cache_start(tbl, module_intf_id), 0);
+    UtAssert_STUB_COUNT(test_bplib_cache_recover_stub, 1);
+    UtAssert_STUB_COUNT(bplib_rbt_bulk_load, 2);
+
+    /* not if it did not start */
+    UT_SetDefaultReturnValue(UT_KEY(test_bplib_cache_startstop_stub), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_start(tbl, module_intf_id), BP_ERROR);
+    UtAssert_STUB_COUNT(test_bplib_cache_recover_stub, 1);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
@@ -222,19 +799,28 @@ void test_bplib_cache_stop(void)
     bplib_routetbl_t         *tbl = NULL;
     bp_handle_t               module_intf_id;
     bplib_cache_state_t       state;
+    bplib_cache_intf_t        intf;
     bplib_mpool_block_t       blk;
     bplib_cache_offload_api_t api;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
     memset(&api, 0, sizeof(bplib_cache_offload_api_t));
     state.offload_blk = &blk;
     state.offload_api = &api;
     api.std.stop      = test_bplib_cache_startstop_stub;
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     UtAssert_UINT32_EQ(bplib_cache_stop(tbl, module_intf_id), 0);
 
+    /* whatever is waiting to be written out is done first */
+    state.offload_queue      = &intf.offload_queue;
+    intf.offload_queue.count = 1;
+    UtAssert_UINT32_EQ(bplib_cache_stop(tbl, module_intf_id), 0);
+    UtAssert_ZERO(intf.offload_queue.count);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -246,10 +832,15 @@ void test_bplib_cache_debug_scan(void)
     bplib_routetbl_t   *tbl = NULL;
     bp_handle_t         intf_id;
     bplib_cache_state_t state;
+    bplib_cache_intf_t  intf;
     bplib_mpool_ref_t   flow_block_ref;
+    bplib_mpool_block_t shard_blk;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&flow_block_ref, 0, sizeof(bplib_mpool_ref_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
 
     UT_SetHandlerFunction(UT_KEY(bplib_route_get_intf_controlblock), UT_cache_sizet_Handler, NULL);
     UtAssert_VOIDCALL(bplib_cache_debug_scan(tbl, intf_id));
@@ -258,30 +849,141 @@ void test_bplib_cache_debug_scan(void)
                           &flow_block_ref);
     UtAssert_VOIDCALL(bplib_cache_debug_scan(tbl, intf_id));
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_VOIDCALL(bplib_cache_debug_scan(tbl, intf_id));
+
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
     UtAssert_VOIDCALL(bplib_cache_debug_scan(tbl, intf_id));
 
     UT_SetHandlerFunction(UT_KEY(bplib_route_get_intf_controlblock), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_cache_get_shard(void)
+{
+    /* Test function for:
+     * bplib_cache_state_t *bplib_cache_get_shard(bplib_cache_state_t *state, uint32_t index)
+     */
+    bplib_cache_state_t state;
+    bplib_cache_state_t shard;
+    bplib_cache_intf_t  intf;
+    bplib_mpool_block_t shard_blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&shard, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
+    intf.state       = &shard;
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
+
+    UtAssert_ADDRESS_EQ(bplib_cache_get_shard(&state, 0), &state);
+    UtAssert_NULL(bplib_cache_get_shard(&state, 1));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_ADDRESS_EQ(bplib_cache_get_shard(&state, 1), &shard);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_dispatch_shard(void)
+{
+    /* Test function for:
+     * bool bplib_cache_dispatch_shard(bplib_cache_state_t *state, bplib_mpool_block_t *qblk)
+     */
+    bplib_cache_state_t          state;
+    bplib_mpool_block_t          qblk;
+    bplib_mpool_block_t          shard_blk;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&qblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
+
+    /* the flow belongs to the storage service itself */
+    UtAssert_BOOL_FALSE(bplib_cache_dispatch_shard(&state, &qblk));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 0);
+
+    /* the flow belongs to the shard, which is not a flow */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 1);
+    UtAssert_BOOL_TRUE(bplib_cache_dispatch_shard(&state, &qblk));
+    UtAssert_UINT32_EQ(state.discard_count, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    /* the shard queue is full */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
+    UtAssert_BOOL_TRUE(bplib_cache_dispatch_shard(&state, &qblk));
+    UtAssert_UINT32_EQ(state.discard_count, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 1);
+
+    /* the shard takes it */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_cache_bool_Handler, NULL);
+    UtAssert_BOOL_TRUE(bplib_cache_dispatch_shard(&state, &qblk));
+    UtAssert_UINT32_EQ(state.discard_count, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_recover_entry(void)
+{
+    /* Test function for:
+     * void bplib_cache_recover_entry(void *arg, const bplib_cache_offload_index_t *index)
+     */
+    bplib_cache_state_t         state;
+    bplib_cache_offload_index_t index;
+    bplib_mpool_block_t         shard_blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&index, 0, sizeof(bplib_cache_offload_index_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
+
+    /* the flow goes to the storage service itself, which cannot track it with no memory */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UtAssert_VOIDCALL(bplib_cache_recover_entry(&state, &index));
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 1);
+
+    /* the flow goes to the shard, which is not a cache */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 1);
+    UtAssert_VOIDCALL(bplib_cache_recover_entry(&state, &index));
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 1);
+}
+
 void test_bplib_cache_egress_impl(void)
 {
     /* Test function for:
      * int bplib_cache_egress_impl(void *arg, bplib_mpool_block_t *subq_src)
      */
-    void               *arg = NULL;
-    bplib_mpool_block_t subq_src;
-    bplib_cache_state_t state;
-    bplib_mpool_flow_t  flow;
+    void                        *arg = NULL;
+    bplib_mpool_block_t          subq_src;
+    bplib_cache_state_t          state;
+    bplib_cache_intf_t           intf;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          shard_blk;
+    bplib_mpool_bblock_primary_t pri_block;
 
     memset(&subq_src, 0, sizeof(bplib_mpool_block_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
 
     UtAssert_UINT32_NEQ(bplib_cache_egress_impl(arg, &subq_src), 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     UtAssert_UINT32_NEQ(bplib_cache_egress_impl(arg, &subq_src), 0);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
@@ -289,44 +991,431 @@ void test_bplib_cache_egress_impl(void)
     subq_src.type = bplib_mpool_blocktype_ref;
     UtAssert_UINT32_NEQ(bplib_cache_egress_impl(arg, &subq_src), 0);
 
+    /* bundles of flows that belong to a shard are passed on to it, not checked here */
+    UT_ResetState(UT_KEY(bplib_mpool_flow_try_pull));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_cache_egress_AltHandler_PointerReturn, &subq_src);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_cache_bool_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 1);
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
+    UtAssert_UINT32_NEQ(bplib_cache_egress_impl(arg, &subq_src), 0);
+    UtAssert_ZERO(state.discard_count);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_cache_sizet_Handler, NULL);
 }
 
-void test_bplib_cache_flush_pending(void)
+static void UT_cache_InsertBefore_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t **pos = UserObj;
+
+    *pos = UT_Hook_GetArgValueByName(Context, "list", bplib_mpool_block_t *);
+}
+
+void test_bplib_cache_queue_batch_insert(void)
 {
     /* Test function for:
-     * void bplib_cache_flush_pending(bplib_cache_state_t *state)
+     * void bplib_cache_queue_batch_insert(bplib_cache_state_t *state, bplib_mpool_block_t *rblk,
+     *                                     bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_state_t          state;
+    bplib_cache_entry_t          store_entry;
+    bplib_cache_entry_t          queued_entry;
+    bplib_cache_blockref_t       block_ref;
+    bplib_mpool_block_t          queued_blk;
+    bplib_mpool_block_t          rblk;
+    bplib_mpool_block_t         *pos;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&queued_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&queued_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&rblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+
+    /* one ref already in the batch, expiring later than the new one */
+    state.queue_batch.type   = bplib_mpool_blocktype_list_head;
+    state.queue_batch.prev   = &queued_blk;
+    queued_blk.prev          = &state.queue_batch;
+    block_ref.storage_entry  = &queued_entry;
+    queued_entry.expire_time = 2000;
+    store_entry.expire_time  = 1000;
+    state.queue_batch_count  = 1;
+    pos                      = NULL;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_insert_before), UT_cache_InsertBefore_Handler, &pos);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &block_ref);
+
+    /* in the order evaluated, it goes at the tail */
+    UtAssert_VOIDCALL(bplib_cache_queue_batch_insert(&state, &rblk, &store_entry));
+    UtAssert_ADDRESS_EQ(pos, &state.queue_batch);
+    UtAssert_UINT32_EQ(state.queue_batch_count, 2);
+
+    /* by deadline, it goes ahead of the one expiring later */
+    state.transmit_order = BP_CACHE_TRANSMIT_ORDER_DEADLINE;
+    UtAssert_VOIDCALL(bplib_cache_queue_batch_insert(&state, &rblk, &store_entry));
+    UtAssert_ADDRESS_EQ(pos, &queued_blk);
+
+    /* but not one expiring at the same time */
+    queued_entry.expire_time = 1000;
+    UtAssert_VOIDCALL(bplib_cache_queue_batch_insert(&state, &rblk, &store_entry));
+    UtAssert_ADDRESS_EQ(pos, &state.queue_batch);
+
+    /* by priority, the same class of service goes by deadline */
+    state.transmit_order = BP_CACHE_TRANSMIT_ORDER_PRIORITY;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UtAssert_VOIDCALL(bplib_cache_queue_batch_insert(&state, &rblk, &store_entry));
+    UtAssert_ADDRESS_EQ(pos, &state.queue_batch);
+    queued_entry.expire_time = 2000;
+    UtAssert_VOIDCALL(bplib_cache_queue_batch_insert(&state, &rblk, &store_entry));
+    UtAssert_ADDRESS_EQ(pos, &queued_blk);
+
+    /* a ref that cannot be looked at is not moved past */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UtAssert_VOIDCALL(bplib_cache_queue_batch_insert(&state, &rblk, &store_entry));
+    UtAssert_ADDRESS_EQ(pos, &state.queue_batch);
+    UtAssert_UINT32_EQ(state.queue_batch_count, 7);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_insert_before), NULL, NULL);
+}
+
+void test_bplib_cache_push_queue_batch(void)
+{
+    /* Test function for:
+     * void bplib_cache_push_queue_batch(bplib_cache_state_t *state)
      */
     bplib_cache_state_t state;
     bplib_mpool_flow_t  flow;
+    bplib_mpool_block_t blk;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    state.queue_batch.type = bplib_mpool_blocktype_list_head;
+    state.queue_batch.next = &state.queue_batch;
+
+    /* nothing to push */
+    UtAssert_VOIDCALL(bplib_cache_push_queue_batch(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 0);
+
+    /* everything fits */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
+    state.queue_batch_count = 2;
+    UtAssert_VOIDCALL(bplib_cache_push_queue_batch(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 0);
+    UtAssert_ZERO(state.queue_batch_count);
+
+    /* some are left over */
+    state.queue_batch_count = 2;
+    state.queue_batch.next  = &blk;
+    UtAssert_VOIDCALL(bplib_cache_push_queue_batch(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 1);
+    UtAssert_ZERO(state.queue_batch_count);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_flush_pending(void)
+{
+    /* Test function for:
+     * void bplib_cache_flush_pending(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t       state;
+    bplib_mpool_flow_t        flow;
+    bplib_cache_timer_wheel_t timer_wheel;
+    bplib_cache_offload_api_t offload_api;
+    bplib_mpool_job_t         prefetch_job;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&prefetch_job, 0, sizeof(bplib_mpool_job_t));
     flow.ingress.current_depth_limit = 2;
+    state.timer_wheel                = &timer_wheel;
+    state.pending_count              = 2;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
     UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
     UtAssert_VOIDCALL(bplib_cache_flush_pending(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 0);
+
+    /* stopping with entries left over starts the prefetch, but only when there is room for it */
+    flow.ingress.current_depth_limit = 0;
+    state.offload_api                = &offload_api;
+    state.prefetch_job               = &prefetch_job;
+    state.prefetch_depth             = 1;
+    UtAssert_VOIDCALL(bplib_cache_flush_pending(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 0);
+
+    state.resident_budget = 1000;
+    UtAssert_VOIDCALL(bplib_cache_flush_pending(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 1);
+
+    /* hitting the limit on entries per run puts the job back in line */
+    flow.ingress.current_depth_limit = 2;
+    state.flush_limit                = 1;
+    state.prefetch_depth             = 0;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_SUCCESS);
+    UtAssert_VOIDCALL(bplib_cache_flush_pending(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 2);
+
+    /* each entry taken off the list is no longer counted as pending */
+    UtAssert_ZERO(state.pending_count);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_cache_expire_sweep(void)
+{
+    /* Test function for:
+     * void bplib_cache_expire_sweep(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t       state;
+    bplib_cache_entry_t       store_entry;
+    bplib_mpool_block_t       sblk;
+    bplib_mpool_block_t       offload_blk;
+    bplib_cache_offload_api_t offload_api;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&offload_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    offload_api.release = test_bplib_cache_release_stub;
+    state.offload_api   = &offload_api;
+    state.offload_blk   = &offload_blk;
+    state.action_time   = 1000;
+    store_entry.parent  = &state;
+
+    /* nothing in the index, the empty list is still recycled */
+    UtAssert_VOIDCALL(bplib_cache_expire_sweep(&state));
+    UtAssert_STUB_COUNT(bplib_rbt_scan_range, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 1);
+    UtAssert_ZERO(state.discard_count);
+
+    /* an expired entry that is queued is left for the FSM */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_scan_range), UT_cache_rbt_scan_Handler, &store_entry.expire_rbt_link);
+    store_entry.state = bplib_cache_entry_state_queue;
+    UtAssert_VOIDCALL(bplib_cache_expire_sweep(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 0);
+    UtAssert_ZERO(state.discard_count);
+
+    /* an idle one on the pending list is taken off it, released, and recycled with the rest */
+    store_entry.state       = bplib_cache_entry_state_idle;
+    store_entry.offload_sid = (bp_sid_t)1;
+    state.offloaded_count   = 1;
+    state.pending_count     = 1;
+    sblk.next               = &offload_blk;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_get_key_value), 500);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_get_key_value), UT_cache_uint64_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &sblk);
+    UtAssert_VOIDCALL(bplib_cache_expire_sweep(&state));
+    UtAssert_ZERO(state.pending_count);
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 1);
+    UtAssert_STUB_COUNT(test_bplib_cache_release_stub, 1);
+    UtAssert_ZERO(store_entry.offload_sid);
+    UtAssert_ZERO(state.offloaded_count);
+    UtAssert_UINT32_EQ(store_entry.state, bplib_cache_entry_state_undefined);
+    UtAssert_UINT32_EQ(state.fsm_state_exit_count[bplib_cache_entry_state_idle], 1);
+    UtAssert_UINT32_EQ(state.fsm_state_enter_count[bplib_cache_entry_state_undefined], 1);
+    UtAssert_UINT32_EQ(state.discard_count, 1);
+    UtAssert_STUB_COUNT(bplib_rbt_extract_node, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 3);
+
+    /* one that is not on the pending list, and has no offloaded copy */
+    store_entry.state = bplib_cache_entry_state_idle;
+    sblk.next         = &sblk;
+    UtAssert_VOIDCALL(bplib_cache_expire_sweep(&state));
+    UtAssert_ZERO(state.pending_count);
+    UtAssert_STUB_COUNT(test_bplib_cache_release_stub, 1);
+    UtAssert_UINT32_EQ(state.discard_count, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_shed_load(void)
+{
+    /* Test function for:
+     * void bplib_cache_shed_load(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t          state;
+    bplib_cache_entry_t          store_entry;
+    bplib_mpool_block_t          sblk;
+    bplib_mpool_block_t          offload_blk;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_cache_offload_api_t    offload_api;
+    bplib_mpool_block_t          blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&offload_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    store_entry.parent = &state;
+    store_entry.state  = bplib_cache_entry_state_idle;
+    store_entry.refptr = (bplib_mpool_ref_t)&blk;
+    sblk.next          = &sblk;
+
+    /* nothing is done with the policy off, or while the pool still has room */
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    state.shed_policy = BP_CACHE_SHED_POLICY_DEADLINE;
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_is_at_bundle_threshold, 1);
+    UtAssert_STUB_COUNT(bplib_rbt_scan_range, 0);
+
+    /* an idle entry in memory is dropped when there is nowhere to offload it */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_is_at_bundle_threshold), true);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_scan_range), UT_cache_rbt_scan_Handler, &store_entry.expire_rbt_link);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &sblk);
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    UtAssert_STUB_COUNT(bplib_rbt_scan_range, 1);
+    UtAssert_ZERO(state.evict_count);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    UtAssert_UINT32_EQ(state.evict_count, 1);
+    UtAssert_UINT32_EQ(store_entry.state, bplib_cache_entry_state_undefined);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 2);
+
+    /* one that is not idle is about to be used, and stays */
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    UtAssert_UINT32_EQ(state.evict_count, 1);
+
+    /* with an offloaded copy only the memory goes */
+    store_entry.state       = bplib_cache_entry_state_idle;
+    store_entry.offload_sid = (bp_sid_t)1;
+    state.offload_api       = &offload_api;
+    state.offload_blk       = &offload_blk;
+    state.resident_count    = 1;
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    UtAssert_UINT32_EQ(state.evict_count, 1);
+    UtAssert_UINT32_EQ(state.evict_release_count, 1);
+    UtAssert_NULL(store_entry.refptr);
+    UtAssert_ZERO(state.resident_count);
+    UtAssert_UINT32_EQ(store_entry.state, bplib_cache_entry_state_idle);
+
+    /* by priority, there is a pass for each class, and only the lowest one matches here */
+    store_entry.refptr                       = (bplib_mpool_ref_t)&blk;
+    state.resident_count                     = 1;
+    state.shed_policy                        = BP_CACHE_SHED_POLICY_PRIORITY;
+    pri_block.data.delivery.class_of_service = BP_COS_EXTENDED + 1;
+    UtAssert_VOIDCALL(bplib_cache_shed_load(&state));
+    UtAssert_STUB_COUNT(bplib_rbt_scan_range, 8);
+    UtAssert_UINT32_EQ(state.evict_release_count, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_update_poll_time(void)
+{
+    /* Test function for:
+     * void bplib_cache_update_poll_time(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t       state;
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_timer_wheel_t timer_wheel;
+    bplib_mpool_block_t       blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    state.timer_wheel = &timer_wheel;
+    state.parent_rtbl = (bplib_routetbl_t *)&blk;
+    state.intf_block  = &blk;
+
+    /* nothing at all to wait for */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_route_contact_scan), -1);
+    UT_SetHandlerFunction(UT_KEY(bplib_route_contact_scan), UT_cache_uint64_Handler, NULL);
+    UtAssert_VOIDCALL(bplib_cache_update_poll_time(&state));
+    UtAssert_UINT32_EQ(state.poll_time, BP_CACHE_TIME_INFINITE);
+
+    /* the next bundle to expire is before anything in the timer wheel */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_SUCCESS);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_iter_goto_min), UT_cache_rbt_iter_Handler, &store_entry.expire_rbt_link);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_get_key_value), 5000);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_get_key_value), UT_cache_uint64_Handler, NULL);
+    UtAssert_VOIDCALL(bplib_cache_update_poll_time(&state));
+    UtAssert_UINT32_EQ(state.poll_time, 5000);
+    UtAssert_STUB_COUNT(bplib_route_intf_set_poll_time, 2);
+
+    /* not changed, so the route table is not told again */
+    UtAssert_VOIDCALL(bplib_cache_update_poll_time(&state));
+    UtAssert_STUB_COUNT(bplib_route_intf_set_poll_time, 2);
+
+    /* a contact announced before that */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_route_contact_scan), 3000);
+    UtAssert_VOIDCALL(bplib_cache_update_poll_time(&state));
+    UtAssert_UINT32_EQ(state.poll_time, 3000);
+    UtAssert_STUB_COUNT(bplib_route_intf_set_poll_time, 3);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_route_contact_scan), NULL, NULL);
+}
+
+static void UT_cache_ContactScan_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_route_contact_func_t func = UT_Hook_GetArgValueByName(Context, "func", bplib_route_contact_func_t);
+    void                      *arg  = UT_Hook_GetArgValueByName(Context, "arg", void *);
+    bplib_route_contact_t      contact;
+    uint64_t                   retval = BP_CACHE_TIME_INFINITE;
+
+    /* one contact that is both announced and started */
+    memset(&contact, 0, sizeof(contact));
+    contact.dest = 1;
+    func(arg, &contact, false);
+    func(arg, &contact, true);
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
 void test_bplib_cache_do_poll(void)
 {
     /* Test function for:
      * int bplib_cache_do_poll(bplib_cache_state_t *state)
      */
-    bplib_cache_state_t state;
-    bplib_mpool_block_t sblk;
+    bplib_cache_state_t       state;
+    bplib_mpool_block_t       sblk;
+    bplib_cache_timer_wheel_t timer_wheel;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    state.timer_wheel = &timer_wheel;
 
+    /* nothing in the expire index */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_goto_first), BP_ERROR);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &sblk);
-    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_max), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_cache_GetTime_Handler, NULL);
+    UtAssert_UINT32_EQ(bplib_cache_do_poll(&state), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 1);
+    UtAssert_UINT32_EQ(timer_wheel.base_tick, 1000 >> BP_CACHE_TIMER_TICK_SHIFT);
+    UtAssert_STUB_COUNT(bplib_route_contact_scan, 0);
+
+    /* the contact plan is looked at up to now, and only once for the same time */
+    state.parent_rtbl = (bplib_routetbl_t *)&sblk;
+    UT_SetHandlerFunction(UT_KEY(bplib_route_contact_scan), UT_cache_ContactScan_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_cache_do_poll(&state), 0);
+    UtAssert_STUB_COUNT(bplib_route_contact_scan, 1);
+    UtAssert_UINT32_EQ(state.contact_time, 1000);
+    UtAssert_UINT32_EQ(bplib_cache_do_poll(&state), 0);
+    UtAssert_STUB_COUNT(bplib_route_contact_scan, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_route_contact_scan), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), NULL, NULL);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
 }
@@ -352,6 +1441,57 @@ void test_bplib_cache_do_route_up(void)
     UtAssert_UINT32_EQ(bplib_cache_do_route_up(&state, dest, mask), 0);
 }
 
+void test_bplib_cache_do_route_prestage(void)
+{
+    /* Test function for:
+     * int bplib_cache_do_route_prestage(bplib_cache_state_t *state, bp_ipn_t dest, bp_ipn_t mask)
+     */
+    bplib_cache_state_t       state;
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_offload_api_t offload_api;
+    bplib_mpool_block_t       blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    offload_api.restore = test_bplib_cache_restore_stub;
+
+    /* nothing is ever offloaded without an offload module */
+    UtAssert_INT32_EQ(bplib_cache_do_route_prestage(&state, 0x100, ~(bp_ipn_t)0xFF), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_rbt_iter_goto_min, 0);
+
+    /* no room in the budget */
+    state.offload_api = &offload_api;
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_iter_goto_min), UT_cache_rbt_iter_Handler, &store_entry.dest_eid_rbt_link);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_get_key_value), 0x123);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_get_key_value), UT_cache_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_next), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_do_route_prestage(&state, 0x100, ~(bp_ipn_t)0xFF), BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 0);
+
+    /* an entry going over the contact is read back in, the same as for a prefetch */
+    store_entry.parent      = &state;
+    store_entry.state       = bplib_cache_entry_state_idle;
+    store_entry.flags       = BPLIB_STORE_FLAG_LOCAL_CUSTODY;
+    store_entry.offload_sid = (bp_sid_t)1;
+    state.resident_budget   = 1000;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, &blk);
+    UtAssert_INT32_EQ(bplib_cache_do_route_prestage(&state, 0x100, ~(bp_ipn_t)0xFF), BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 1);
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &blk);
+
+    /* already in memory, or not going over the contact */
+    UtAssert_INT32_EQ(bplib_cache_do_route_prestage(&state, 0x100, ~(bp_ipn_t)0xFF), BP_SUCCESS);
+    store_entry.refptr   = NULL;
+    state.resident_bytes = 0;
+    UtAssert_INT32_EQ(bplib_cache_do_route_prestage(&state, 0x200, ~(bp_ipn_t)0xFF), BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_iter_goto_min), NULL, NULL);
+}
+
 void test_bplib_cache_do_intf_statechange(void)
 {
     /* Test function for:
@@ -359,9 +1499,11 @@ void test_bplib_cache_do_intf_statechange(void)
      */
     bplib_cache_state_t state;
     bplib_mpool_flow_t  flow;
+    bplib_mpool_block_t shard_blk;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&shard_blk, 0, sizeof(bplib_mpool_block_t));
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
     UtAssert_UINT32_EQ(bplib_cache_do_intf_statechange(&state, false), 0);
@@ -370,6 +1512,15 @@ void test_bplib_cache_do_intf_statechange(void)
 
     flow.current_state_flags = 8;
     UtAssert_UINT32_EQ(bplib_cache_do_intf_statechange(&state, true), 0);
+    UtAssert_STUB_COUNT(bplib_route_intf_set_flags, 0);
+
+    /* the shards follow the storage service up and down */
+    state.num_shards = 1;
+    state.shards[0]  = (bplib_mpool_ref_t)&shard_blk;
+    UtAssert_UINT32_EQ(bplib_cache_do_intf_statechange(&state, true), 0);
+    UtAssert_STUB_COUNT(bplib_route_intf_set_flags, 1);
+    UtAssert_UINT32_EQ(bplib_cache_do_intf_statechange(&state, false), 0);
+    UtAssert_STUB_COUNT(bplib_route_intf_unset_flags, 1);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
@@ -382,18 +1533,24 @@ void test_bplib_cache_event_impl(void)
     bplib_mpool_flow_generic_event_t event_arg;
     bplib_mpool_block_t              intf_block;
     bplib_cache_state_t              state;
+    bplib_cache_intf_t               intf;
     bplib_mpool_flow_t               flow;
+    bplib_cache_timer_wheel_t        timer_wheel;
 
     memset(&event_arg, 0, sizeof(bplib_mpool_flow_generic_event_t));
     memset(&intf_block, 0, sizeof(bplib_mpool_block_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    intf.state        = &state;
+    state.timer_wheel = &timer_wheel;
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
 
     UtAssert_UINT32_NEQ(bplib_cache_event_impl(&event_arg, &intf_block), 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     event_arg.event_type = bplib_mpool_flow_event_poll;
-    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_max), BP_ERROR);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
     UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
     UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_goto_first), BP_ERROR);
     UtAssert_UINT32_EQ(bplib_cache_event_impl(&event_arg, &intf_block), 0);
@@ -403,6 +1560,16 @@ void test_bplib_cache_event_impl(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
     UtAssert_UINT32_EQ(bplib_cache_event_impl(&event_arg, &intf_block), 0);
 
+    /* a new route set looks at every entry, from the lowest dest */
+    UT_ResetState(UT_KEY(bplib_rbt_iter_goto_min));
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
+    event_arg.event_type = bplib_mpool_flow_event_undefined;
+    UtAssert_UINT32_EQ(bplib_cache_event_impl(&event_arg, &intf_block), 0);
+    UtAssert_STUB_COUNT(bplib_rbt_iter_goto_min, 1);
+    event_arg.event_type = bplib_mpool_flow_event_route_change;
+    UtAssert_UINT32_EQ(bplib_cache_event_impl(&event_arg, &intf_block), 0);
+    UtAssert_STUB_COUNT(bplib_rbt_iter_goto_min, 3);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
@@ -412,19 +1579,244 @@ void test_bplib_cache_process_pending(void)
     /* Test function for:
      * int bplib_cache_process_pending(void *arg, bplib_mpool_block_t *job)
      */
-    bplib_mpool_block_t job;
-    bplib_mpool_flow_t  flow;
+    bplib_mpool_block_t       job;
+    bplib_mpool_flow_t        flow;
+    bplib_cache_state_t       state;
+    bplib_cache_intf_t        intf;
+    bplib_cache_timer_wheel_t timer_wheel;
 
     memset(&job, 0, sizeof(bplib_mpool_block_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    intf.state        = &state;
+    state.timer_wheel = &timer_wheel;
 
     flow.ingress.current_depth_limit = 2;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
     UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
 
     UtAssert_UINT32_EQ(bplib_cache_process_pending(NULL, &job), 0);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_prefetch_pending(void)
+{
+    /* Test function for:
+     * void bplib_cache_prefetch_pending(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t       state;
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_offload_api_t offload_api;
+    bplib_mpool_block_t       blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    offload_api.restore = test_bplib_cache_restore_stub;
+
+    /* nothing is ever offloaded without an offload module */
+    UtAssert_VOIDCALL(bplib_cache_prefetch_pending(&state));
+    UtAssert_STUB_COUNT(bplib_mpool_list_iter_goto_first, 0);
+
+    /* no room in the budget */
+    state.offload_api    = &offload_api;
+    state.prefetch_depth = 2;
+    UtAssert_VOIDCALL(bplib_cache_prefetch_pending(&state));
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 0);
+
+    /* the same entry is at every position here, it is only restored the first time */
+    store_entry.parent      = &state;
+    store_entry.state       = bplib_cache_entry_state_idle;
+    store_entry.flags       = BPLIB_STORE_FLAG_LOCAL_CUSTODY;
+    store_entry.offload_sid = (bp_sid_t)1;
+    state.resident_budget   = 1000;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &store_entry);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, &blk);
+    UtAssert_VOIDCALL(bplib_cache_prefetch_pending(&state));
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_list_iter_forward, 2);
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &blk);
+    UtAssert_UINT32_EQ(state.resident_bytes, sizeof(bplib_mpool_bblock_primary_t));
+
+    /* one that is being deleted is not going to be sent */
+    store_entry.refptr        = NULL;
+    store_entry.resident_size = 0;
+    state.resident_bytes      = 0;
+    store_entry.flags         = 0;
+    UtAssert_VOIDCALL(bplib_cache_prefetch_pending(&state));
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 1);
+    store_entry.flags = BPLIB_STORE_FLAG_LOCAL_CUSTODY;
+    store_entry.state = bplib_cache_entry_state_delete;
+    UtAssert_VOIDCALL(bplib_cache_prefetch_pending(&state));
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 1);
+
+    /* the end of the list */
+    store_entry.state = bplib_cache_entry_state_idle;
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_list_iter_goto_first), 1, BP_ERROR);
+    UtAssert_VOIDCALL(bplib_cache_prefetch_pending(&state));
+    UtAssert_STUB_COUNT(test_bplib_cache_restore_stub, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_process_prefetch(void)
+{
+    /* Test function for:
+     * int bplib_cache_process_prefetch(void *arg, bplib_mpool_block_t *job)
+     */
+    bplib_mpool_block_t job;
+    bplib_cache_state_t state;
+    bplib_cache_intf_t  intf;
+
+    memset(&job, 0, sizeof(bplib_mpool_block_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_process_prefetch(NULL, &job), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_offload_enqueue(void)
+{
+    /* Test function for:
+     * bool bplib_cache_offload_enqueue(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_state_t         state;
+    bplib_cache_entry_t         store_entry;
+    bplib_cache_offload_queue_t queue;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&queue, 0, sizeof(bplib_cache_offload_queue_t));
+
+    /* no queue, it is offloaded right away */
+    UtAssert_BOOL_FALSE(bplib_cache_offload_enqueue(&state, &store_entry));
+
+    state.offload_queue = &queue;
+    UtAssert_BOOL_TRUE(bplib_cache_offload_enqueue(&state, &store_entry));
+    UtAssert_UINT32_EQ(queue.count, 1);
+    UtAssert_ADDRESS_EQ(queue.entries[0], &store_entry);
+    UtAssert_BOOL_TRUE((store_entry.flags & BPLIB_STORE_FLAG_OFFLOAD_WAIT) != 0);
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 1);
+
+    /* full */
+    store_entry.flags = 0;
+    queue.count       = BP_CACHE_OFFLOAD_QUEUE_DEPTH;
+    UtAssert_BOOL_FALSE(bplib_cache_offload_enqueue(&state, &store_entry));
+    UtAssert_ZERO(store_entry.flags);
+}
+
+void test_bplib_cache_offload_cancel(void)
+{
+    /* Test function for:
+     * void bplib_cache_offload_cancel(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_state_t         state;
+    bplib_cache_entry_t         store_entry[2];
+    bplib_cache_offload_queue_t queue;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(store_entry, 0, sizeof(store_entry));
+    memset(&queue, 0, sizeof(bplib_cache_offload_queue_t));
+
+    /* not waiting, there may not even be a queue */
+    UtAssert_VOIDCALL(bplib_cache_offload_cancel(&state, &store_entry[0]));
+
+    state.offload_queue  = &queue;
+    queue.entries[0]     = &store_entry[0];
+    queue.entries[1]     = &store_entry[1];
+    queue.count          = 2;
+    store_entry[1].flags = BPLIB_STORE_FLAG_OFFLOAD_WAIT;
+    UtAssert_VOIDCALL(bplib_cache_offload_cancel(&state, &store_entry[1]));
+    UtAssert_ADDRESS_EQ(queue.entries[0], &store_entry[0]);
+    UtAssert_NULL(queue.entries[1]);
+    UtAssert_UINT32_EQ(queue.count, 2);
+    UtAssert_ZERO(store_entry[1].flags);
+}
+
+void test_bplib_cache_offload_waiting(void)
+{
+    /* Test function for:
+     * void bplib_cache_offload_waiting(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t          state;
+    bplib_cache_entry_t          store_entry;
+    bplib_cache_offload_queue_t  queue;
+    bplib_cache_offload_api_t    offload_api;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_mpool_block_t          blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&queue, 0, sizeof(bplib_cache_offload_queue_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    offload_api.offload = test_bplib_cache_offload_stub;
+    state.offload_api   = &offload_api;
+    store_entry.parent  = &state;
+
+    /* no queue */
+    UtAssert_VOIDCALL(bplib_cache_offload_waiting(&state));
+
+    /* a cancelled slot is passed over, and one that cannot be written out stays in memory */
+    state.offload_queue = &queue;
+    queue.entries[1]    = &store_entry;
+    queue.count         = 2;
+    store_entry.refptr  = (bplib_mpool_ref_t)&blk;
+    store_entry.state   = bplib_cache_entry_state_idle;
+    store_entry.flags   = BPLIB_STORE_FLAG_OFFLOAD_WAIT;
+    UtAssert_VOIDCALL(bplib_cache_offload_waiting(&state));
+    UtAssert_ZERO(queue.count);
+    UtAssert_NULL(queue.entries[1]);
+    UtAssert_ZERO(store_entry.flags);
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &blk);
+
+    /* once written out, with no budget to keep it, it is released */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    queue.entries[0] = &store_entry;
+    queue.count      = 1;
+    state.resident_count = 1;
+    UtAssert_VOIDCALL(bplib_cache_offload_waiting(&state));
+    UtAssert_STUB_COUNT(test_bplib_cache_offload_stub, 1);
+    UtAssert_UINT32_EQ(state.offloaded_count, 1);
+    UtAssert_NULL(store_entry.refptr);
+    UtAssert_ZERO(state.resident_count);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_process_offload(void)
+{
+    /* Test function for:
+     * int bplib_cache_process_offload(void *arg, bplib_mpool_block_t *job)
+     */
+    bplib_mpool_block_t job;
+    bplib_cache_state_t state;
+    bplib_cache_intf_t  intf;
+
+    memset(&job, 0, sizeof(bplib_mpool_block_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state          = &state;
+    state.offload_queue = &intf.offload_queue;
+    intf.offload_queue.count = 1;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_process_offload(NULL, &job), 0);
+    UtAssert_ZERO(intf.offload_queue.count);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
 void test_bplib_cache_destruct_state(void)
@@ -432,21 +1824,21 @@ void test_bplib_cache_destruct_state(void)
     /* Test function for:
      * int bplib_cache_destruct_state(void *arg, bplib_mpool_block_t *sblk)
      */
-    bplib_mpool_block_t sblk;
-    bplib_mpool_block_t sblk1;
-    bplib_cache_state_t state;
-    bplib_rbt_root_t    index;
-    bplib_rbt_link_t    rlink;
+    bplib_mpool_block_t     sblk;
+    bplib_mpool_block_t     sblk1;
+    bplib_cache_state_t     state;
+    bplib_rbt_root_t        index;
+    bplib_rbt_link_t        rlink;
+    bplib_cache_hash_slot_t slots[2];
 
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
     memset(&sblk1, 0, sizeof(bplib_mpool_block_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(slots, 0, sizeof(slots));
     memset(&index, 0, sizeof(bplib_rbt_root_t));
     memset(&rlink, 0, sizeof(bplib_rbt_link_t));
     index.root              = &rlink;
-    state.idle_list         = sblk1;
     state.pending_list      = sblk1;
-    state.idle_list.next    = &state.idle_list;
     state.pending_list.next = &state.pending_list;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
@@ -456,6 +1848,13 @@ void test_bplib_cache_destruct_state(void)
     UT_SetHandlerFunction(UT_KEY(bplib_rbt_tree_is_empty), UT_cache_bool_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_cache_destruct_state(NULL, &sblk), 0);
 
+    /* the slots of the hash indices are freed along with the state */
+    state.bundle_index.slots    = slots;
+    state.bundle_index.capacity = 2;
+    UtAssert_UINT32_EQ(bplib_cache_destruct_state(NULL, &sblk), 0);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UtAssert_NULL(state.bundle_index.slots);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -478,6 +1877,42 @@ void test_bplib_cache_construct_entry(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_cache_entry_add_footprint(void)
+{
+    /* Test function for:
+     * void bplib_cache_entry_add_footprint(bplib_cache_entry_t *store_entry, size_t bytes, uint32_t blocks)
+     */
+    bplib_cache_entry_t store_entry;
+    bplib_cache_state_t state;
+
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    store_entry.parent          = &state;
+    store_entry.footprint_class = BP_COS_EXPEDITED;
+
+    /* the entry is only counted once, however many times it adds to its footprint */
+    UtAssert_VOIDCALL(bplib_cache_entry_add_footprint(&store_entry, 500, 4));
+    UtAssert_VOIDCALL(bplib_cache_entry_add_footprint(&store_entry, 64, 1));
+    UtAssert_UINT32_EQ(store_entry.footprint_bytes, 564);
+    UtAssert_UINT32_EQ(store_entry.footprint_blocks, 5);
+    UtAssert_UINT32_EQ(state.footprint_count[BP_COS_EXPEDITED], 1);
+    UtAssert_UINT32_EQ(state.footprint_bytes[BP_COS_EXPEDITED], 564);
+    UtAssert_UINT32_EQ(state.footprint_blocks[BP_COS_EXPEDITED], 5);
+    UtAssert_UINT32_EQ(state.footprint_bytes_max[BP_COS_EXPEDITED], 564);
+    UtAssert_UINT32_EQ(state.footprint_blocks_max[BP_COS_EXPEDITED], 5);
+
+    /* a smaller one does not change the largest */
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    store_entry.parent          = &state;
+    store_entry.footprint_class = BP_COS_EXPEDITED;
+    UtAssert_VOIDCALL(bplib_cache_entry_add_footprint(&store_entry, 100, 2));
+    UtAssert_UINT32_EQ(state.footprint_count[BP_COS_EXPEDITED], 2);
+    UtAssert_UINT32_EQ(state.footprint_bytes[BP_COS_EXPEDITED], 664);
+    UtAssert_UINT32_EQ(state.footprint_bytes_max[BP_COS_EXPEDITED], 564);
+    UtAssert_UINT32_EQ(state.footprint_blocks_max[BP_COS_EXPEDITED], 5);
+    UtAssert_ZERO(state.footprint_count[BP_COS_BULK]);
+}
+
 void test_bplib_cache_destruct_entry(void)
 {
     /* Test function for:
@@ -499,6 +1934,27 @@ void test_bplib_cache_destruct_entry(void)
     UT_SetHandlerFunction(UT_KEY(bplib_rbt_get_key_value), UT_cache_uint64_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_cache_destruct_entry(NULL, &sblk), 0);
 
+    /* what it stored is no longer counted */
+    store_entry.offload_sid = (bp_sid_t)1;
+    store_entry.stored_size = 100;
+    state.offloaded_count   = 1;
+    state.stored_bytes      = 150;
+    UtAssert_UINT32_EQ(bplib_cache_destruct_entry(NULL, &sblk), 0);
+    UtAssert_ZERO(state.offloaded_count);
+    UtAssert_UINT32_EQ(state.stored_bytes, 50);
+
+    /* and neither is its footprint */
+    store_entry.footprint_class           = BP_COS_NORMAL;
+    store_entry.footprint_bytes           = 300;
+    store_entry.footprint_blocks          = 3;
+    state.footprint_count[BP_COS_NORMAL]  = 2;
+    state.footprint_bytes[BP_COS_NORMAL]  = 700;
+    state.footprint_blocks[BP_COS_NORMAL] = 7;
+    UtAssert_UINT32_EQ(bplib_cache_destruct_entry(NULL, &sblk), 0);
+    UtAssert_UINT32_EQ(state.footprint_count[BP_COS_NORMAL], 1);
+    UtAssert_UINT32_EQ(state.footprint_bytes[BP_COS_NORMAL], 400);
+    UtAssert_UINT32_EQ(state.footprint_blocks[BP_COS_NORMAL], 4);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -530,15 +1986,18 @@ void test_bplib_cache_destruct_blockref(void)
     bplib_mpool_block_t    sblk1;
     bplib_cache_blockref_t blockref;
     bplib_cache_entry_t    store_entry;
+    bplib_cache_state_t    state;
 
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
     memset(&sblk1, 0, sizeof(bplib_mpool_block_t));
     memset(&blockref, 0, sizeof(bplib_cache_blockref_t));
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
 
     UtAssert_UINT32_NEQ(bplib_cache_destruct_blockref(NULL, &sblk), 0);
 
     blockref.storage_entry = &store_entry;
+    store_entry.parent     = &state;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &blockref);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &sblk1);
 
@@ -554,15 +2013,85 @@ void test_bplib_cache_construct_state(void)
      * int bplib_cache_construct_state(void *arg, bplib_mpool_block_t *sblk)
      */
     bplib_mpool_block_t sblk;
+    bplib_mpool_block_t fblk;
     bplib_cache_state_t state;
+    bplib_cache_intf_t  intf;
 
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&fblk, 0, sizeof(bplib_mpool_block_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+    intf.state = &state;
 
-    UtAssert_UINT32_NEQ(bplib_cache_construct_state(NULL, &sblk), 0);
+    UtAssert_UINT32_NEQ(bplib_cache_construct_state(&fblk, &sblk), 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &state);
-    UtAssert_UINT32_EQ(bplib_cache_construct_state(NULL, &sblk), 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_intf_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_construct_state(&fblk, &sblk), 0);
+    UtAssert_ADDRESS_EQ(state.intf_block, &fblk);
+    UtAssert_ADDRESS_EQ(state.pending_job, &intf.pending_job);
+    UtAssert_ADDRESS_EQ(state.prefetch_job, &intf.prefetch_job);
+    UtAssert_INT32_EQ(state.prefetch_depth, BP_CACHE_PREFETCH_DEPTH);
+    UtAssert_INT32_EQ(state.flush_limit, BP_CACHE_FLUSH_LIMIT);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_construct_intf(void)
+{
+    /* Test function for:
+     * int bplib_cache_construct_intf(void *arg, bplib_mpool_block_t *sblk)
+     */
+    bplib_mpool_block_t sblk;
+    bplib_cache_intf_t  intf;
+
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+
+    UtAssert_UINT32_NEQ(bplib_cache_construct_intf(NULL, &sblk), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_construct_intf(NULL, &sblk), 0);
+    UtAssert_True(intf.pending_job.handler == bplib_cache_process_pending, "pending job handler set");
+    UtAssert_UINT32_EQ(intf.pending_job.jobtype, bplib_mpool_jobtype_cache_fsm);
+    UtAssert_True(intf.prefetch_job.handler == bplib_cache_process_prefetch, "prefetch job handler set");
+    UtAssert_UINT32_EQ(intf.prefetch_job.jobtype, bplib_mpool_jobtype_cache_fsm);
+    UtAssert_NULL(intf.state);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_destruct_intf(void)
+{
+    /* Test function for:
+     * int bplib_cache_destruct_intf(void *arg, bplib_mpool_block_t *sblk)
+     */
+    bplib_mpool_block_t sblk;
+    bplib_mpool_block_t stblk;
+    bplib_cache_state_t state;
+    bplib_cache_intf_t  intf;
+
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&stblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&intf, 0, sizeof(bplib_cache_intf_t));
+
+    UtAssert_UINT32_NEQ(bplib_cache_destruct_intf(NULL, &sblk), 0);
+
+    /* a flow whose state was never allocated has nothing to recycle */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &intf);
+    UtAssert_UINT32_EQ(bplib_cache_destruct_intf(NULL, &sblk), 0);
+
+    intf.state_block = &stblk;
+    intf.state       = &state;
+    UtAssert_UINT32_EQ(bplib_cache_destruct_intf(NULL, &sblk), 0);
+    UtAssert_NULL(intf.state_block);
+    UtAssert_NULL(intf.state);
+
+    intf.timer_block = &stblk;
+    UtAssert_UINT32_EQ(bplib_cache_destruct_intf(NULL, &sblk), 0);
+    UtAssert_NULL(intf.timer_block);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
 void test_bplib_cache_entry_tree_insert_unsorted(void)
@@ -580,7 +2109,12 @@ void test_bplib_cache_entry_tree_insert_unsorted(void)
 void TestBplibCache_Register(void)
 {
     UtTest_Add(test_bplib_cache_entry_make_pending, NULL, NULL, "Test bplib_cache_entry_make_pending");
+    UtTest_Add(test_bplib_cache_entry_retain_content, NULL, NULL, "Test bplib_cache_entry_retain_content");
+    UtTest_Add(test_bplib_cache_entry_release_content, NULL, NULL, "Test bplib_cache_entry_release_content");
+    UtTest_Add(test_bplib_cache_entry_restore_content, NULL, NULL, "Test bplib_cache_entry_restore_content");
+    UtTest_Add(test_bplib_cache_enforce_resident_budget, NULL, NULL, "Test bplib_cache_enforce_resident_budget");
     UtTest_Add(test_bplib_cache_attach, NULL, NULL, "Test bplib_cache_attach");
+    UtTest_Add(test_bplib_cache_attach_sharded, NULL, NULL, "Test bplib_cache_attach_sharded");
     UtTest_Add(test_bplib_cache_detach, NULL, NULL, "Test bplib_cache_detach");
     UtTest_Add(test_bplib_cache_register_module_service, NULL, NULL, "Test bplib_cache_register_module_service");
     UtTest_Add(test_bplib_cache_configure, NULL, NULL, "Test bplib_cache_configure");
@@ -588,18 +2122,36 @@ void TestBplibCache_Register(void)
     UtTest_Add(test_bplib_cache_start, NULL, NULL, "Test bplib_cache_start");
     UtTest_Add(test_bplib_cache_stop, NULL, NULL, "Test bplib_cache_stop");
     UtTest_Add(test_bplib_cache_debug_scan, NULL, NULL, "Test bplib_cache_debug_scan");
+    UtTest_Add(test_bplib_cache_get_shard, NULL, NULL, "Test bplib_cache_get_shard");
+    UtTest_Add(test_bplib_cache_dispatch_shard, NULL, NULL, "Test bplib_cache_dispatch_shard");
+    UtTest_Add(test_bplib_cache_recover_entry, NULL, NULL, "Test bplib_cache_recover_entry");
     UtTest_Add(test_bplib_cache_egress_impl, NULL, NULL, "Test bplib_cache_egress_impl");
+    UtTest_Add(test_bplib_cache_queue_batch_insert, NULL, NULL, "Test bplib_cache_queue_batch_insert");
+    UtTest_Add(test_bplib_cache_push_queue_batch, NULL, NULL, "Test bplib_cache_push_queue_batch");
     UtTest_Add(test_bplib_cache_flush_pending, NULL, NULL, "Test bplib_cache_flush_pending");
+    UtTest_Add(test_bplib_cache_expire_sweep, NULL, NULL, "Test bplib_cache_expire_sweep");
+    UtTest_Add(test_bplib_cache_shed_load, NULL, NULL, "Test bplib_cache_shed_load");
+    UtTest_Add(test_bplib_cache_update_poll_time, NULL, NULL, "Test bplib_cache_update_poll_time");
     UtTest_Add(test_bplib_cache_do_poll, NULL, NULL, "Test bplib_cache_do_poll");
     UtTest_Add(test_bplib_cache_do_route_up, NULL, NULL, "Test bplib_cache_do_route_up");
+    UtTest_Add(test_bplib_cache_do_route_prestage, NULL, NULL, "Test bplib_cache_do_route_prestage");
     UtTest_Add(test_bplib_cache_do_intf_statechange, NULL, NULL, "Test bplib_cache_do_intf_statechange");
     UtTest_Add(test_bplib_cache_event_impl, NULL, NULL, "Test bplib_cache_event_impl");
     UtTest_Add(test_bplib_cache_process_pending, NULL, NULL, "Test bplib_cache_process_pending");
+    UtTest_Add(test_bplib_cache_prefetch_pending, NULL, NULL, "Test bplib_cache_prefetch_pending");
+    UtTest_Add(test_bplib_cache_process_prefetch, NULL, NULL, "Test bplib_cache_process_prefetch");
+    UtTest_Add(test_bplib_cache_offload_enqueue, NULL, NULL, "Test bplib_cache_offload_enqueue");
+    UtTest_Add(test_bplib_cache_offload_cancel, NULL, NULL, "Test bplib_cache_offload_cancel");
+    UtTest_Add(test_bplib_cache_offload_waiting, NULL, NULL, "Test bplib_cache_offload_waiting");
+    UtTest_Add(test_bplib_cache_process_offload, NULL, NULL, "Test bplib_cache_process_offload");
     UtTest_Add(test_bplib_cache_destruct_state, NULL, NULL, "Test bplib_cache_destruct_state");
     UtTest_Add(test_bplib_cache_construct_entry, NULL, NULL, "Test bplib_cache_construct_entry");
+    UtTest_Add(test_bplib_cache_entry_add_footprint, NULL, NULL, "Test bplib_cache_entry_add_footprint");
     UtTest_Add(test_bplib_cache_destruct_entry, NULL, NULL, "Test bplib_cache_destruct_entry");
     UtTest_Add(test_bplib_cache_construct_blockref, NULL, NULL, "Test bplib_cache_construct_blockref");
     UtTest_Add(test_bplib_cache_destruct_blockref, NULL, NULL, "Test bplib_cache_destruct_blockref");
     UtTest_Add(test_bplib_cache_construct_state, NULL, NULL, "Test bplib_cache_construct_state");
+    UtTest_Add(test_bplib_cache_construct_intf, NULL, NULL, "Test bplib_cache_construct_intf");
+    UtTest_Add(test_bplib_cache_destruct_intf, NULL, NULL, "Test bplib_cache_destruct_intf");
     UtTest_Add(test_bplib_cache_entry_tree_insert_unsorted, NULL, NULL, "Test bplib_cache_entry_tree_insert_unsorted");
 }
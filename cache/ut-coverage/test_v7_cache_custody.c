@@ -26,14 +26,35 @@ void test_bplib_cache_custody_finalize_dacs(void)
     /* Test function for:
      * void bplib_cache_custody_finalize_dacs(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
      */
-    bplib_cache_state_t state;
-    bplib_cache_entry_t store_entry;
+    bplib_cache_state_t       state;
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_hash_slot_t   slots[2];
+    bplib_cache_offload_api_t offload_api;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+
+    /* Not in the DACS index */
+    UtAssert_VOIDCALL(bplib_cache_custody_finalize_dacs(&state, &store_entry));
+
+    /* an open DACS is removed from the index, so nothing more gets appended to it */
+    test_setup_cache_hash_entry(&state.dacs_index, slots, &store_entry);
+    UtAssert_VOIDCALL(bplib_cache_custody_finalize_dacs(&state, &store_entry));
+    UtAssert_UINT32_EQ(state.dacs_index.num_entries, 0);
+    UtAssert_UINT32_EQ(state.dacs_closed_count, 2);
+
+    /* a module without a flush is not asked for one */
+    state.offload_api = &offload_api;
+    UtAssert_VOIDCALL(bplib_cache_custody_finalize_dacs(&state, &store_entry));
 
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_node_is_member), UT_cache_bool_Handler, NULL);
+    /* one with a flush makes what was offloaded durable first, even if that fails it is only logged */
+    offload_api.flush = test_bplib_cache_flush_stub;
     UtAssert_VOIDCALL(bplib_cache_custody_finalize_dacs(&state, &store_entry));
+    UT_SetDeferredRetcode(UT_KEY(test_bplib_cache_flush_stub), 1, BP_ERROR);
+    UtAssert_VOIDCALL(bplib_cache_custody_finalize_dacs(&state, &store_entry));
+    UtAssert_STUB_COUNT(test_bplib_cache_flush_stub, 2);
+    UtAssert_UINT32_EQ(state.dacs_closed_count, 5);
 }
 
 void test_bplib_cache_custody_check_dacs(void)
@@ -45,29 +66,30 @@ void test_bplib_cache_custody_check_dacs(void)
     bplib_mpool_block_t            qblk;
     bplib_mpool_bblock_primary_t   pri_block;
     bplib_mpool_bblock_canonical_t c_block;
-    bplib_rbt_link_t               custody_rbt_link;
+    bplib_cache_entry_t            store_entry;
     bplib_mpool_block_t            blk;
+    bplib_cache_hash_slot_t        slots[2];
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&qblk, 0, sizeof(bplib_mpool_block_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
     memset(&c_block, 0, sizeof(bplib_mpool_bblock_canonical_t));
-    memset(&custody_rbt_link, 0, sizeof(bplib_rbt_link_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    store_entry.parent = &state;
+    test_setup_cache_hash_entry(&state.bundle_index, slots, &store_entry);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_sizet_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_locate_canonical), UT_cache_sizet_Handler, NULL);
     pri_block.data.logical.controlFlags.isAdminRecord = true;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, &c_block);
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_cache_AltHandler_PointerReturn, &custody_rbt_link);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &blk);
     c_block.canonical_logical_data.data.custody_accept_payload_block.num_entries = 1;
     UtAssert_BOOL_TRUE(bplib_cache_custody_check_dacs(&state, &qblk));
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -80,17 +102,21 @@ void test_bplib_cache_custody_store_bundle(void)
     bplib_mpool_block_t            qblk;
     bplib_mpool_block_t            qblk1;
     bplib_mpool_bblock_primary_t   pri_block;
-    bplib_rbt_link_t               custody_rbt_link;
+    bplib_cache_entry_t            dup_entry;
     bplib_cache_entry_t            store_entry;
     bplib_mpool_bblock_canonical_t custody_block;
     bplib_cache_offload_api_t      offload_api;
     bplib_mpool_block_t            sblk;
+    bplib_cache_hash_slot_t        slots[BP_CACHE_HASH_INITIAL_CAPACITY];
+    bplib_cache_offload_queue_t    queue;
+    uint32_t                       alloc_count;
+    uint32_t                       complete_count;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&qblk, 0, sizeof(bplib_mpool_block_t));
     memset(&qblk1, 0, sizeof(bplib_mpool_block_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
-    memset(&custody_rbt_link, 0, sizeof(bplib_rbt_link_t));
+    memset(&dup_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&custody_block, 0, sizeof(bplib_mpool_bblock_canonical_t));
     memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
@@ -104,22 +130,81 @@ void test_bplib_cache_custody_store_bundle(void)
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_cache_sizet_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_cache_AltHandler_PointerReturn, &custody_rbt_link);
+    test_setup_cache_hash_entry(&state.bundle_index, slots, &dup_entry);
     UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
 
     pri_block.data.delivery.committed_storage_id = 1;
+    pri_block.bundle_encode_size_cache           = 100;
+    state.action_time                            = 1234;
 
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_cache_AltHandler_PointerReturn, NULL);
+    /* the hash index cannot be allocated, the bundle is still stored */
+    memset(&state.bundle_index, 0, sizeof(state.bundle_index));
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &store_entry);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_cache_AltHandler_PointerReturn, &qblk1);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, &sblk);
+    state.intf_block = &qblk1;
+    UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(state.bundle_index.num_entries, 0);
+    UtAssert_UINT32_EQ(store_entry.stored_size, sizeof(bplib_mpool_bblock_primary_t) + 100);
+    UtAssert_UINT32_EQ(state.stored_bytes, store_entry.stored_size);
+    UtAssert_UINT32_EQ(store_entry.store_time, 1234);
+    UtAssert_ZERO(state.resident_count);
+
+    memset(slots, 0, sizeof(slots));
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_AltHandler_PointerReturn, slots);
+    UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(state.bundle_index.num_entries, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_AltHandler_PointerReturn, NULL);
+    memset(&state.bundle_index, 0, sizeof(state.bundle_index));
+
+    /* without an offload module custody is not taken, and the bundle is only kept until it is sent */
+    state.self_addr.node_number             = 1;
+    pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
+    alloc_count                             = UT_GetStubCount(UT_KEY(bplib_mpool_bblock_canonical_alloc));
+    complete_count                          = UT_GetStubCount(UT_KEY(bplib_dataservice_complete));
     UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(pri_block.data.delivery.delivery_policy, bplib_policy_delivery_local_ack);
+    UtAssert_UINT32_EQ(UT_GetStubCount(UT_KEY(bplib_mpool_bblock_canonical_alloc)), alloc_count);
+    UtAssert_UINT32_EQ(UT_GetStubCount(UT_KEY(bplib_dataservice_complete)), complete_count);
+
+    /* with memory custody it is taken as soon as it is stored, and a custody block is added for this node */
+    state.memory_custody                    = 1;
+    pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
+    UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(pri_block.data.delivery.delivery_policy, bplib_policy_delivery_custody_tracking);
+    UtAssert_UINT32_EQ(UT_GetStubCount(UT_KEY(bplib_mpool_bblock_canonical_alloc)), alloc_count + 1);
+    UtAssert_UINT32_EQ(UT_GetStubCount(UT_KEY(bplib_dataservice_complete)), complete_count + 1);
+    state.memory_custody = 0;
 
     offload_api.offload                     = test_bplib_cache_offload_stub;
     state.offload_api                       = &offload_api;
     pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_cache_sizet_Handler, NULL);
     UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(state.offloaded_count, 1);
+
+    /* with an offload queue the bundle is written out later, until then it is stored in memory */
+    memset(&queue, 0, sizeof(bplib_cache_offload_queue_t));
+    state.offload_queue = &queue;
+    UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(queue.count, 1);
+    UtAssert_ADDRESS_EQ(queue.entries[0], &store_entry);
+    UtAssert_ADDRESS_EQ((void *)pri_block.data.delivery.committed_storage_id, &sblk);
+    UtAssert_UINT32_EQ(state.offloaded_count, 1);
+    UtAssert_STUB_COUNT(test_bplib_cache_offload_stub, 1);
+    state.offload_queue = NULL;
+
+    /* a module that keeps bundles in memory is not used to take custody, nor are bundles offloaded to it here */
+    offload_api.in_memory                   = true;
+    pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
+    complete_count                          = UT_GetStubCount(UT_KEY(bplib_dataservice_complete));
+    UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
+    UtAssert_UINT32_EQ(pri_block.data.delivery.delivery_policy, bplib_policy_delivery_local_ack);
+    UtAssert_ADDRESS_EQ((void *)pri_block.data.delivery.committed_storage_id, &sblk);
+    UtAssert_UINT32_EQ(UT_GetStubCount(UT_KEY(bplib_dataservice_complete)), complete_count);
+    UtAssert_UINT32_EQ(state.offloaded_count, 1);
+    UtAssert_STUB_COUNT(test_bplib_cache_offload_stub, 1);
+    offload_api.in_memory = false;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UtAssert_VOIDCALL(bplib_cache_custody_store_bundle(&state, &qblk));
@@ -129,6 +214,113 @@ void test_bplib_cache_custody_store_bundle(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_cache_custody_recover_entry(void)
+{
+    /* Test function for:
+     * void bplib_cache_custody_recover_entry(bplib_cache_state_t *state, const bplib_cache_offload_index_t *index)
+     */
+    bplib_cache_state_t         state;
+    bplib_cache_offload_index_t index;
+    bplib_cache_entry_t         dup_entry;
+    bplib_cache_entry_t         store_entry;
+    bplib_cache_offload_api_t   offload_api;
+    bplib_mpool_block_t         sblk;
+    bplib_cache_hash_slot_t     slots[BP_CACHE_HASH_INITIAL_CAPACITY];
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&index, 0, sizeof(bplib_cache_offload_index_t));
+    memset(&dup_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    offload_api.release = test_bplib_cache_release_stub;
+    state.offload_api   = &offload_api;
+
+    /* the same bundle is already tracked, the second copy is let go */
+    test_setup_cache_hash_entry(&state.bundle_index, slots, &dup_entry);
+    index.sid = 5;
+    UtAssert_VOIDCALL(bplib_cache_custody_recover_entry(&state, &index));
+    UtAssert_STUB_COUNT(test_bplib_cache_release_stub, 1);
+    UtAssert_ZERO(state.stored_bytes);
+
+    /* no entry can be allocated */
+    memset(&state.bundle_index, 0, sizeof(state.bundle_index));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UtAssert_VOIDCALL(bplib_cache_custody_recover_entry(&state, &index));
+    UtAssert_ZERO(state.stored_bytes);
+    UtAssert_ZERO(state.offloaded_count);
+
+    /* tracked again, still offloaded */
+    index.flow_id.node_number = 2;
+    index.sequence_num        = 3;
+    index.final_dest_node     = 4;
+    index.expire_time         = 1000;
+    index.bundle_encode_size  = 100;
+    state.action_time         = 1234;
+    memset(slots, 0, sizeof(slots));
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_AltHandler_PointerReturn, slots);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, &sblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, &store_entry);
+    UtAssert_VOIDCALL(bplib_cache_custody_recover_entry(&state, &index));
+    UtAssert_UINT32_EQ(store_entry.offload_sid, 5);
+    UtAssert_NULL(store_entry.refptr);
+    UtAssert_UINT32_EQ(store_entry.stored_size, sizeof(bplib_mpool_bblock_primary_t) + 100);
+    UtAssert_UINT32_EQ(state.stored_bytes, store_entry.stored_size);
+    UtAssert_UINT32_EQ(store_entry.store_time, 1234);
+    UtAssert_UINT32_EQ(store_entry.flow_id_copy.node_number, 2);
+    UtAssert_UINT32_EQ(store_entry.flow_seq_copy, 3);
+    UtAssert_UINT32_EQ(store_entry.expire_time, 1000);
+    UtAssert_UINT32_EQ(state.offloaded_count, 1);
+    UtAssert_UINT32_EQ(state.bundle_index.num_entries, 1);
+    UtAssert_ZERO(state.resident_count);
+    UtAssert_STUB_COUNT(bplib_rbt_insert_value_generic, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 1);
+
+    /* when the indices were empty to begin with, they are built at the end */
+    memset(&state.bundle_index, 0, sizeof(state.bundle_index));
+    memset(slots, 0, sizeof(slots));
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_tree_is_empty), true);
+    UtAssert_VOIDCALL(bplib_cache_custody_recover_entry(&state, &index));
+    UtAssert_STUB_COUNT(bplib_rbt_insert_value_generic, 2);
+    UtAssert_STUB_COUNT(bplib_rbt_bulk_append, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 2);
+
+    /* nor is it in the expire index if it does not expire */
+    memset(&state.bundle_index, 0, sizeof(state.bundle_index));
+    memset(slots, 0, sizeof(slots));
+    index.expire_time = 0;
+    UtAssert_VOIDCALL(bplib_cache_custody_recover_entry(&state, &index));
+    UtAssert_STUB_COUNT(bplib_rbt_bulk_append, 3);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_custody_finish_recovery(void)
+{
+    /* Test function for:
+     * void bplib_cache_custody_finish_recovery(bplib_cache_state_t *state)
+     */
+    bplib_cache_state_t state;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+
+    /* nothing was recovered */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_goto_first), BP_ERROR);
+    UtAssert_VOIDCALL(bplib_cache_custody_finish_recovery(&state));
+    UtAssert_STUB_COUNT(bplib_rbt_bulk_load, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 0);
+
+    /* the entries are taken off the list before going through the FSM */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_goto_first), BP_SUCCESS);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
+    UtAssert_VOIDCALL(bplib_cache_custody_finish_recovery(&state));
+    UtAssert_STUB_COUNT(bplib_rbt_bulk_load, 4);
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 1);
+}
+
 void test_bplib_cache_custody_insert_tracking_block(void)
 {
     /* Test function for:
@@ -158,7 +350,7 @@ void test_bplib_cache_custody_insert_tracking_block(void)
 void test_bplib_cache_custody_find_dacs_match(void)
 {
     /* Test function for:
-     * int bplib_cache_custody_find_dacs_match(const bplib_rbt_link_t *node, void *arg)
+     * int bplib_cache_custody_find_dacs_match(const bplib_cache_entry_t *store_entry, void *arg)
      */
     bplib_cache_custodian_info_t custody_info;
     bplib_cache_entry_t          store_entry;
@@ -168,7 +360,7 @@ void test_bplib_cache_custody_find_dacs_match(void)
 
     store_entry.state = bplib_cache_entry_state_generate_dacs;
 
-    UtAssert_UINT32_EQ(bplib_cache_custody_find_dacs_match(&store_entry.hash_rbt_link, &custody_info), 0);
+    UtAssert_UINT32_EQ(bplib_cache_custody_find_dacs_match(&store_entry, &custody_info), 0);
 }
 
 void test_bplib_cache_custody_find_pending_dacs(void)
@@ -178,16 +370,20 @@ void test_bplib_cache_custody_find_pending_dacs(void)
      */
     bplib_cache_state_t          state;
     bplib_cache_custodian_info_t dacs_info;
-    bplib_rbt_link_t             custody_rbt_link;
+    bplib_cache_entry_t          store_entry;
+    bplib_cache_hash_slot_t      slots[2];
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&dacs_info, 0, sizeof(bplib_cache_custodian_info_t));
-    memset(&custody_rbt_link, 0, sizeof(bplib_rbt_link_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
 
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_cache_AltHandler_PointerReturn, &custody_rbt_link);
-    UtAssert_VOIDCALL(bplib_cache_custody_find_pending_dacs(&state, &dacs_info));
+    UtAssert_BOOL_FALSE(bplib_cache_custody_find_pending_dacs(&state, &dacs_info));
+    UtAssert_NULL(dacs_info.store_entry);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_cache_AltHandler_PointerReturn, NULL);
+    store_entry.state = bplib_cache_entry_state_generate_dacs;
+    test_setup_cache_hash_entry(&state.dacs_index, slots, &store_entry);
+    UtAssert_BOOL_TRUE(bplib_cache_custody_find_pending_dacs(&state, &dacs_info));
+    UtAssert_ADDRESS_EQ(dacs_info.store_entry, &store_entry);
 }
 
 void test_bplib_cache_custody_create_dacs(void)
@@ -213,6 +409,7 @@ void test_bplib_cache_custody_create_dacs(void)
     memset(&c_block, 0, sizeof(bplib_mpool_bblock_canonical_t));
     memset(&pri_block1, 0, sizeof(bplib_mpool_bblock_primary_t));
     memset(&pri_block2, 0, sizeof(bplib_mpool_bblock_primary_t));
+    state.generated_dacs_seq_step = 3;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_sizet_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_cache_AltHandler_PointerReturn, &pri_block1);
@@ -226,6 +423,9 @@ void test_bplib_cache_custody_create_dacs(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, &c_block);
     UtAssert_NULL(bplib_cache_custody_create_dacs(&state, &pri_block_out, &pay_out));
 
+    /* every DACS that got a primary block used up a sequence number, one step apart */
+    UtAssert_UINT32_EQ(state.generated_dacs_seq, 6);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
@@ -266,8 +466,16 @@ void test_bplib_cache_custody_open_dacs(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, &c_block);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &blk);
+    state.intf_block = &blk;
+    store_entry.parent = &state;
     UtAssert_VOIDCALL(bplib_cache_custody_open_dacs(&state, &custody_info));
 
+    /* the new DACS goes in both the DACS index and the destination index, here the
+     * DACS index has no slots and cannot get any, but the DACS is still made */
+    UtAssert_STUB_COUNT(bplib_os_calloc, 1);
+    UtAssert_STUB_COUNT(bplib_rbt_insert_value_generic, 1);
+    UtAssert_UINT32_EQ(state.dacs_index.num_entries, 0);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, NULL);
@@ -293,20 +501,216 @@ void test_bplib_cache_custody_append_dacs(void)
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&payload_ref, 0, sizeof(bp_custody_accept_payload_block_t));
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    bplib_cache_custody_init_dacs_config(&state.dacs_config);
     payload_ref.num_entries           = BP_DACS_MAX_SEQ_PER_PAYLOAD;
     store_entry.data.dacs.payload_ref = &payload_ref;
+    store_entry.parent                = &state;
     custody_info.store_entry          = &store_entry;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &blk);
     UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
 
-    custody_info.sequence_num = 1;
-    payload_ref.num_entries   = 2;
+    /* with no room for another range, this DACS was finalized and another one opened */
+    UtAssert_NULL(custody_info.store_entry);
+
+    /* contiguous sequence numbers are marked in the window, and a duplicate changes nothing */
+    memset(&payload_ref, 0, sizeof(bp_custody_accept_payload_block_t));
+    custody_info.store_entry  = &store_entry;
+    custody_info.sequence_num = 10;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    custody_info.sequence_num = 11;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    custody_info.sequence_num = 12;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    custody_info.sequence_num = 11;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_base, 10);
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 1);
+    UtAssert_UINT32_EQ(payload_ref.num_entries, 0);
+
+    /* a gap is another run, until it is filled in */
+    custody_info.sequence_num = 14;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 2);
+    custody_info.sequence_num = 13;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 1);
+
+    /* one older than the window goes straight into the ranges */
+    custody_info.sequence_num = 9;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(payload_ref.num_entries, 1);
+    UtAssert_UINT32_EQ(payload_ref.ranges[0].first_seq, 9);
+    UtAssert_UINT32_EQ(payload_ref.ranges[0].count, 1);
+
+    /* one too far ahead moves the window, and what was in it carries on from that range */
+    custody_info.sequence_num = 10 + BP_CACHE_DACS_WINDOW_BITS + 5;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_base, 10 + BP_CACHE_DACS_WINDOW_BITS + 5);
+    UtAssert_UINT32_EQ(payload_ref.num_entries, 1);
+    UtAssert_UINT32_EQ(payload_ref.ranges[0].count, 6);
+
+    /* finalizing puts the rest of the window in the payload */
+    UtAssert_VOIDCALL(bplib_cache_custody_finalize_dacs(&state, &store_entry));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 0);
+    UtAssert_UINT32_EQ(payload_ref.num_entries, 2);
+    UtAssert_UINT32_EQ(payload_ref.ranges[1].first_seq, 10 + BP_CACHE_DACS_WINDOW_BITS + 5);
+    UtAssert_UINT32_EQ(payload_ref.ranges[1].count, 1);
+
+    /* a new run when every range is taken does not fit either */
+    payload_ref.num_entries   = BP_DACS_MAX_SEQ_PER_PAYLOAD - 1;
+    custody_info.sequence_num = 5000;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 1);
+    custody_info.sequence_num = 5002;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_NULL(custody_info.store_entry);
+
+    /* a byte limit allows fewer ranges, each taking at most 5 bytes with small sequence numbers */
+    memset(&payload_ref, 0, sizeof(bp_custody_accept_payload_block_t));
+    memset(&store_entry.data.dacs.window, 0, sizeof(store_entry.data.dacs.window));
+    store_entry.data.dacs.window_runs = 0;
+    state.dacs_config.max_bytes       = 10;
+    custody_info.store_entry          = &store_entry;
+    custody_info.sequence_num         = 1;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    custody_info.sequence_num = 3;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 2);
+    custody_info.sequence_num = 5;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_NULL(custody_info.store_entry);
+
+    /* with an ack threshold, the DACS is finalized as soon as it has that many */
+    memset(&payload_ref, 0, sizeof(bp_custody_accept_payload_block_t));
+    memset(&store_entry.data.dacs.window, 0, sizeof(store_entry.data.dacs.window));
+    store_entry.data.dacs.window_runs = 0;
+    store_entry.data.dacs.seq_count   = 0;
+    store_entry.flags                 = BPLIB_STORE_FLAG_ACTION_TIME_WAIT;
+    state.dacs_config.max_bytes       = 0;
+    state.dacs_config.ack_threshold   = 2;
+    custody_info.store_entry          = &store_entry;
+    custody_info.sequence_num         = 1;
     UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 1);
+    custody_info.sequence_num = 2;
+    UtAssert_VOIDCALL(bplib_cache_custody_append_dacs(&state, &custody_info));
+    UtAssert_UINT32_EQ(store_entry.data.dacs.seq_count, 2);
+    UtAssert_UINT32_EQ(store_entry.data.dacs.window_runs, 0);
+    UtAssert_UINT32_EQ(payload_ref.num_entries, 1);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_cache_custody_configure_dacs(void)
+{
+    /* Test function for:
+     * int bplib_cache_custody_configure_dacs(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+     *                                        const void *val)
+     */
+    bplib_cache_state_t state;
+    int                 value;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    bplib_cache_custody_init_dacs_config(&state.dacs_config);
+
+    value = 2000;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_open_time,
+                                                         bplib_cache_module_valtype_string, &value),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_open_time,
+                                                         bplib_cache_module_valtype_integer, NULL),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_offload_base_dir,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_ERROR);
+
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_open_time,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.dacs_config.open_time, 2000);
+
+    /* the lifetime has to be longer than the open time */
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_lifetime,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_ERROR);
+    value = 60000;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_lifetime,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.dacs_config.lifetime, 60000);
+
+    value = BP_DACS_MAX_SEQ_PER_PAYLOAD + 1;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_max_entries,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_ERROR);
+    value = 4;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_max_entries,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.dacs_config.max_entries, 4);
+
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_max_bytes,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_ERROR);
+    value = 100;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_max_bytes,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.dacs_config.max_bytes, 100);
+
+    value = 50;
+    UtAssert_INT32_EQ(bplib_cache_custody_configure_dacs(&state, bplib_cache_confkey_dacs_ack_threshold,
+                                                         bplib_cache_module_valtype_integer, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(state.dacs_config.ack_threshold, 50);
+}
+
+void test_bplib_cache_custody_query_dacs(void)
+{
+    /* Test function for:
+     * int bplib_cache_custody_query_dacs(bplib_cache_state_t *state, int key, bplib_cache_module_valtype_t vt,
+     *                                    const void **val)
+     */
+    bplib_cache_state_t state;
+    const void         *val;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    bplib_cache_custody_init_dacs_config(&state.dacs_config);
+
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_open_time,
+                                                     bplib_cache_module_valtype_string, &val),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_open_time,
+                                                     bplib_cache_module_valtype_integer, NULL),
+                      BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_none,
+                                                     bplib_cache_module_valtype_integer, &val),
+                      BP_ERROR);
+
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_open_time,
+                                                     bplib_cache_module_valtype_integer, &val),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(*(const int *)val, BP_CACHE_DACS_OPEN_TIME);
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_lifetime,
+                                                     bplib_cache_module_valtype_integer, &val),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(*(const int *)val, BP_CACHE_DACS_LIFETIME);
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_max_entries,
+                                                     bplib_cache_module_valtype_integer, &val),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(*(const int *)val, BP_DACS_MAX_SEQ_PER_PAYLOAD);
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_max_bytes,
+                                                     bplib_cache_module_valtype_integer, &val),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(*(const int *)val, 0);
+    UtAssert_INT32_EQ(bplib_cache_custody_query_dacs(&state, bplib_cache_confkey_dacs_ack_threshold,
+                                                     bplib_cache_module_valtype_integer, &val),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(*(const int *)val, 0);
+}
+
 void test_bplib_cache_custody_update_tracking_block(void)
 {
     /* Test function for:
@@ -330,7 +734,7 @@ void test_bplib_cache_custody_update_tracking_block(void)
 void test_bplib_cache_custody_find_bundle_match(void)
 {
     /* Test function for:
-     * int bplib_cache_custody_find_bundle_match(const bplib_rbt_link_t *node, void *arg)
+     * int bplib_cache_custody_find_bundle_match(const bplib_cache_entry_t *store_entry, void *arg)
      */
     bplib_cache_custodian_info_t custody_info;
     bplib_cache_entry_t          store_entry;
@@ -339,7 +743,7 @@ void test_bplib_cache_custody_find_bundle_match(void)
     custody_info.sequence_num  = 1;
     store_entry.flow_seq_copy = 1;
 
-    UtAssert_VOIDCALL(bplib_cache_custody_find_bundle_match(&store_entry.hash_rbt_link, &custody_info));
+    UtAssert_VOIDCALL(bplib_cache_custody_find_bundle_match(&store_entry, &custody_info));
 }
 
 void test_bplib_cache_custody_process_bundle(void)
@@ -348,10 +752,11 @@ void test_bplib_cache_custody_process_bundle(void)
      * void bplib_cache_custody_process_bundle(bplib_cache_state_t *state, bplib_mpool_bblock_primary_t *pri_block,
      * bplib_cache_custodian_info_t *custody_info)
      */
-    bplib_cache_state_t          state;
-    bplib_mpool_bblock_primary_t pri_block;
-    bplib_cache_custodian_info_t custody_info;
-    bplib_mpool_block_t          blk;
+    bplib_cache_state_t            state;
+    bplib_mpool_bblock_primary_t   pri_block;
+    bplib_cache_custodian_info_t   custody_info;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_bblock_canonical_t cblk;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
@@ -363,6 +768,15 @@ void test_bplib_cache_custody_process_bundle(void)
 
     custody_info.final_dest_node = 1;
     UtAssert_VOIDCALL(bplib_cache_custody_process_bundle(&state, &pri_block, &custody_info));
+
+    /* the block of the previous custodian is kept, as a record of who that was */
+    memset(&cblk, 0, sizeof(cblk));
+    cblk.canonical_logical_data.canonical_block.blockType = bp_blocktype_custodyTrackingBlock;
+    custody_info.prev_cblk                                = &blk;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, &cblk);
+    UtAssert_VOIDCALL(bplib_cache_custody_process_bundle(&state, &pri_block, &custody_info));
+    UtAssert_UINT32_EQ(cblk.canonical_logical_data.canonical_block.blockType, bp_blocktype_previousCustodianBlock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
 void test_bplib_cache_custody_process_remote_dacs_bundle(void)
@@ -375,16 +789,51 @@ void test_bplib_cache_custody_process_remote_dacs_bundle(void)
     bplib_mpool_bblock_primary_t      pri_block;
     bp_custody_accept_payload_block_t ack_payload;
     bplib_mpool_block_t               blk;
+    bplib_cache_entry_t               store_entry;
+    bplib_cache_hash_slot_t           slots[2];
+    uint32_t                          crc_count;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
     memset(&ack_payload, 0, sizeof(bp_custody_accept_payload_block_t));
-    ack_payload.num_entries = 1;
+    ack_payload.num_entries         = 1;
+    ack_payload.ranges[0].first_seq = 5;
+    ack_payload.ranges[0].count     = 3;
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, &blk);
 
+    /* the flow ID is only hashed once for all the sequence numbers, each of which adds the number and salt */
+    crc_count = UT_GetStubCount(UT_KEY(bplib_crc_update));
+    UtAssert_VOIDCALL(bplib_cache_custody_process_remote_dacs_bundle(&state, &pri_block, &ack_payload));
+    UtAssert_UINT32_EQ(UT_GetStubCount(UT_KEY(bplib_crc_update)) - crc_count, 1 + (3 * 2));
+
+    /* the ack for a bundle sent once is a round trip time sample, only the first one counts */
+    test_setup_cache_hash_entry(&state.bundle_index, slots, &store_entry);
+    store_entry.parent         = &state;
+    store_entry.flags          = BPLIB_STORE_FLAG_LOCAL_CUSTODY;
+    store_entry.flow_seq_copy  = 5;
+    store_entry.transmit_count = 1;
+    store_entry.egress_intf_id = BPLIB_HANDLE_RAM_STORE_BASE;
+    store_entry.egress_time    = 1000;
+    store_entry.store_time     = 900;
+    state.action_time          = 1500;
     UtAssert_VOIDCALL(bplib_cache_custody_process_remote_dacs_bundle(&state, &pri_block, &ack_payload));
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].egress_intf_id.hdl, BPLIB_HANDLE_RAM_STORE_BASE.hdl);
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].srtt, 500);
+    UtAssert_ZERO(store_entry.flags & BPLIB_STORE_FLAG_LOCAL_CUSTODY);
+
+    /* custody was held from when it was stored, and the repeated acks did not count again */
+    UtAssert_UINT32_EQ(state.custody_hold_time, 600);
+    UtAssert_UINT32_EQ(state.custody_release_count, 1);
+
+    /* after a retransmit, it cannot be told which transmit was acked */
+    memset(&state.rtt_estimates, 0, sizeof(state.rtt_estimates));
+    store_entry.flags          = BPLIB_STORE_FLAG_LOCAL_CUSTODY;
+    store_entry.transmit_count = 2;
+    UtAssert_VOIDCALL(bplib_cache_custody_process_remote_dacs_bundle(&state, &pri_block, &ack_payload));
+    UtAssert_ZERO(state.rtt_estimates[0].srtt);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
 }
@@ -407,7 +856,18 @@ void test_bplib_cache_custody_init_info_from_pblock(void)
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_locate_canonical), UT_cache_AltHandler_PointerReturn, &blk);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, &cblk);
+    /* the block is left as it is, it only becomes a previous custodian block if custody is taken here */
+    cblk.canonical_logical_data.canonical_block.blockType = bp_blocktype_custodyTrackingBlock;
     UtAssert_VOIDCALL(bplib_cache_custody_init_info_from_pblock(&custody_info, &pri_block));
+    UtAssert_ADDRESS_EQ(custody_info.prev_cblk, &blk);
+    UtAssert_UINT32_EQ(cblk.canonical_logical_data.canonical_block.blockType, bp_blocktype_custodyTrackingBlock);
+
+    /* a lazily decoded custody block which does not decode is not acknowledged */
+    cblk.canonical_logical_data.canonical_block.blockType = bp_blocktype_custodyTrackingBlock;
+    UT_SetDefaultReturnValue(UT_KEY(v7_block_decode_canonical_data), -1);
+    UtAssert_VOIDCALL(bplib_cache_custody_init_info_from_pblock(&custody_info, &pri_block));
+    UtAssert_NULL(custody_info.prev_cblk);
+    UtAssert_UINT32_EQ(cblk.canonical_logical_data.canonical_block.blockType, bp_blocktype_custodyTrackingBlock);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_locate_canonical), UT_cache_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, NULL);
@@ -436,6 +896,109 @@ void test_bplib_cache_custody_ack_tracking_block(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_cache_custody_offload_entry(void)
+{
+    /* Test function for:
+     * bool bplib_cache_custody_offload_entry(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_state_t          state;
+    bplib_cache_entry_t          store_entry;
+    bplib_cache_offload_api_t    offload_api;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_mpool_block_t          blk;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&offload_api, 0, sizeof(bplib_cache_offload_api_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    offload_api.offload = test_bplib_cache_offload_stub;
+    state.offload_api   = &offload_api;
+    store_entry.parent  = &state;
+
+    /* nothing in memory to write out */
+    UtAssert_BOOL_FALSE(bplib_cache_custody_offload_entry(&state, &store_entry));
+
+    /* already written out */
+    store_entry.refptr      = (bplib_mpool_ref_t)&blk;
+    store_entry.offload_sid = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UtAssert_BOOL_FALSE(bplib_cache_custody_offload_entry(&state, &store_entry));
+    UtAssert_STUB_COUNT(test_bplib_cache_offload_stub, 0);
+
+    /* the write fails, custody is not acknowledged */
+    store_entry.offload_sid             = 0;
+    store_entry.data.bundle.ack_pending = true;
+    UT_SetDeferredRetcode(UT_KEY(test_bplib_cache_offload_stub), 1, BP_ERROR);
+    UtAssert_BOOL_FALSE(bplib_cache_custody_offload_entry(&state, &store_entry));
+    UtAssert_ZERO(state.offloaded_count);
+    UtAssert_BOOL_TRUE(store_entry.data.bundle.ack_pending);
+    UtAssert_STUB_COUNT(bplib_dataservice_complete, 0);
+
+    /* written out, and the previous custodian is acknowledged, as is the sender */
+    UtAssert_BOOL_TRUE(bplib_cache_custody_offload_entry(&state, &store_entry));
+    UtAssert_UINT32_EQ(state.offloaded_count, 1);
+    UtAssert_BOOL_FALSE(store_entry.data.bundle.ack_pending);
+    UtAssert_STUB_COUNT(bplib_crc_finalize, 1);
+    UtAssert_STUB_COUNT(bplib_dataservice_complete, 1);
+
+    /* with nobody to acknowledge */
+    UtAssert_BOOL_TRUE(bplib_cache_custody_offload_entry(&state, &store_entry));
+    UtAssert_UINT32_EQ(state.offloaded_count, 2);
+    UtAssert_STUB_COUNT(bplib_crc_finalize, 1);
+
+    /* kept in memory, so neither the sender nor the previous custodian is acknowledged */
+    offload_api.in_memory               = true;
+    store_entry.offload_sid             = 0;
+    store_entry.data.bundle.ack_pending = true;
+    UtAssert_BOOL_TRUE(bplib_cache_custody_offload_entry(&state, &store_entry));
+    UtAssert_UINT32_EQ(state.offloaded_count, 3);
+    UtAssert_BOOL_TRUE(store_entry.data.bundle.ack_pending);
+    UtAssert_STUB_COUNT(bplib_crc_finalize, 1);
+    UtAssert_STUB_COUNT(bplib_dataservice_complete, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_custody_flow_hash(void)
+{
+    /* Test function for:
+     * bp_crcval_t bplib_cache_custody_flow_hash(bplib_mpool_block_t *qblk)
+     */
+    bplib_mpool_block_t            qblk;
+    bplib_mpool_bblock_primary_t   pri_block;
+    bplib_mpool_bblock_canonical_t c_block;
+
+    memset(&qblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&c_block, 0, sizeof(bplib_mpool_bblock_canonical_t));
+
+    /* not a bundle */
+    UtAssert_ZERO(bplib_cache_custody_flow_hash(&qblk));
+    UtAssert_STUB_COUNT(bplib_crc_finalize, 0);
+
+    /* a data bundle goes by its source */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 7);
+    UtAssert_UINT32_EQ(bplib_cache_custody_flow_hash(&qblk), 7);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_cast, 0);
+    UtAssert_STUB_COUNT(v7_get_eid, 1);
+
+    /* an admin record without a DACS payload goes the same way */
+    pri_block.data.logical.controlFlags.isAdminRecord = true;
+    UtAssert_UINT32_EQ(bplib_cache_custody_flow_hash(&qblk), 7);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_cast, 1);
+    UtAssert_STUB_COUNT(v7_get_eid, 2);
+
+    /* and a DACS by the flow it acknowledges */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, &c_block);
+    UtAssert_UINT32_EQ(bplib_cache_custody_flow_hash(&qblk), 7);
+    UtAssert_STUB_COUNT(v7_get_eid, 3);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
 void TestBplibCacheCustody_Register(void)
 {
     UtTest_Add(test_bplib_cache_custody_finalize_dacs, NULL, NULL, "Test bplib_cache_custody_finalize_dacs");
@@ -448,6 +1011,8 @@ void TestBplibCacheCustody_Register(void)
     UtTest_Add(test_bplib_cache_custody_create_dacs, NULL, NULL, "Test bplib_cache_custody_create_dacs");
     UtTest_Add(test_bplib_cache_custody_open_dacs, NULL, NULL, "Test bplib_cache_custody_open_dacs");
     UtTest_Add(test_bplib_cache_custody_append_dacs, NULL, NULL, "Test bplib_cache_custody_append_dacs");
+    UtTest_Add(test_bplib_cache_custody_configure_dacs, NULL, NULL, "Test bplib_cache_custody_configure_dacs");
+    UtTest_Add(test_bplib_cache_custody_query_dacs, NULL, NULL, "Test bplib_cache_custody_query_dacs");
     UtTest_Add(test_bplib_cache_custody_update_tracking_block, NULL, NULL,
                "Test bplib_cache_custody_update_tracking_block");
     UtTest_Add(test_bplib_cache_custody_find_bundle_match, NULL, NULL, "Test bplib_cache_custody_find_bundle_match");
@@ -457,4 +1022,8 @@ void TestBplibCacheCustody_Register(void)
     UtTest_Add(test_bplib_cache_custody_init_info_from_pblock, NULL, NULL,
                "Test bplib_cache_custody_init_info_from_pblock");
     UtTest_Add(test_bplib_cache_custody_ack_tracking_block, NULL, NULL, "Test bplib_cache_custody_ack_tracking_block");
+    UtTest_Add(test_bplib_cache_custody_offload_entry, NULL, NULL, "Test bplib_cache_custody_offload_entry");
+    UtTest_Add(test_bplib_cache_custody_flow_hash, NULL, NULL, "Test bplib_cache_custody_flow_hash");
+    UtTest_Add(test_bplib_cache_custody_recover_entry, NULL, NULL, "Test bplib_cache_custody_recover_entry");
+    UtTest_Add(test_bplib_cache_custody_finish_recovery, NULL, NULL, "Test bplib_cache_custody_finish_recovery");
 }
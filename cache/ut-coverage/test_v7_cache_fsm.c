@@ -48,7 +48,16 @@ void test_bplib_cache_fsm_state_idle_eval(void)
     store_entry.flags       = BPLIB_STORE_FLAG_LOCAL_CUSTODY;
     store_entry.offload_sid = 1;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, &refptr);
-    UtAssert_UINT32_GT(bplib_cache_fsm_state_idle_eval(&store_entry), 0);
+
+    /* the content cannot be restored, so it has to stay idle */
+    UT_SetDeferredRetcode(UT_KEY(test_bplib_cache_restore_stub), 1, BP_ERROR);
+    UtAssert_UINT32_EQ(bplib_cache_fsm_state_idle_eval(&store_entry), bplib_cache_entry_state_idle);
+    UtAssert_NULL(store_entry.refptr);
+
+    UtAssert_UINT32_EQ(bplib_cache_fsm_state_idle_eval(&store_entry), bplib_cache_entry_state_queue);
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &refptr);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
 void test_bplib_cache_fsm_state_queue_eval(void)
@@ -73,15 +82,24 @@ void test_bplib_cache_fsm_state_queue_enter(void)
      */
     bplib_cache_entry_t store_entry;
     bplib_mpool_block_t blk;
+    bplib_cache_state_t state;
 
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    store_entry.parent = &state;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_cache_sizet_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_cache_int8_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_cache_AltHandler_PointerReturn, &blk);
     UtAssert_VOIDCALL(bplib_cache_fsm_state_queue_enter(&store_entry));
 
+    /* the ref only goes into the batch, it is pushed later */
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 1);
+    UtAssert_UINT32_EQ(state.queue_batch_count, 1);
+    UtAssert_BOOL_TRUE((store_entry.flags & BPLIB_STORE_FLAG_LOCALLY_QUEUED) != 0);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_cache_AltHandler_PointerReturn, NULL);
 }
 
@@ -90,15 +108,18 @@ void test_bplib_cache_fsm_execute(void)
     /* Test function for:
      * void bplib_cache_fsm_execute(bplib_mpool_block_t *sblk)
      */
-    bplib_mpool_block_t sblk;
-    bplib_mpool_block_t sblk1;
-    bplib_cache_entry_t store_entry;
-    bplib_cache_state_t state;
+    bplib_mpool_block_t       sblk;
+    bplib_mpool_block_t       sblk1;
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_state_t       state;
+    bplib_cache_timer_wheel_t timer_wheel;
 
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
     memset(&sblk1, 0, sizeof(bplib_mpool_block_t));
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    state.timer_wheel = &timer_wheel;
     sblk.type          = bplib_mpool_blocktype_generic;
     sblk.parent_offset = sizeof(bplib_mpool_block_t);
     sblk.next          = &sblk1;
@@ -125,18 +146,49 @@ void test_bplib_cache_fsm_state_queue_exit(void)
      * void bplib_cache_fsm_state_queue_exit(bplib_cache_entry_t *store_entry)
      */
     bplib_cache_entry_t          store_entry;
+    bplib_cache_state_t          state;
+    bplib_mpool_block_t          blk;
     bplib_mpool_bblock_primary_t pri_block;
 
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
-    pri_block.data.delivery.egress_intf_id = BPLIB_HANDLE_RAM_STORE_BASE;
-    store_entry.offload_sid                = 1;
+    pri_block.data.delivery.egress_intf_id      = BPLIB_HANDLE_RAM_STORE_BASE;
+    pri_block.data.delivery.egress_time         = 1000;
+    pri_block.data.delivery.local_retx_interval = 30000;
+    store_entry.offload_sid                     = 1;
+    store_entry.parent                          = &state;
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, &pri_block);
     UtAssert_VOIDCALL(bplib_cache_fsm_state_queue_exit(&store_entry));
+    UtAssert_ZERO(store_entry.transmit_count);
 
+    /* nothing measured on the egress intf yet, so the socket interval is used */
     pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
     UtAssert_VOIDCALL(bplib_cache_fsm_state_queue_exit(&store_entry));
+    UtAssert_UINT32_EQ(store_entry.transmit_count, 1);
+    UtAssert_UINT32_EQ(store_entry.egress_time, 1000);
+    UtAssert_UINT32_EQ(store_entry.egress_intf_id.hdl, BPLIB_HANDLE_RAM_STORE_BASE.hdl);
+    UtAssert_UINT32_EQ(store_entry.action_time, 31000);
+
+    /* once it has been, the retransmit goes by that, doubled for the second transmit */
+    bplib_cache_rtt_sample(&state, BPLIB_HANDLE_RAM_STORE_BASE, 2000);
+    UtAssert_VOIDCALL(bplib_cache_fsm_state_queue_exit(&store_entry));
+    UtAssert_UINT32_EQ(store_entry.transmit_count, 2);
+    UtAssert_UINT32_EQ(store_entry.action_time, 1000 + (2000 + 4 * 1000) * 2);
+
+    /* offloaded content is released after the transmit, unless there is a budget for keeping it */
+    store_entry.refptr = (bplib_mpool_ref_t)&blk;
+    UtAssert_VOIDCALL(bplib_cache_fsm_state_queue_exit(&store_entry));
+    UtAssert_NULL(store_entry.refptr);
+
+    state.resident_budget = 10000;
+    store_entry.refptr    = (bplib_mpool_ref_t)&blk;
+    UtAssert_VOIDCALL(bplib_cache_fsm_state_queue_exit(&store_entry));
+    UtAssert_ADDRESS_EQ(store_entry.refptr, &blk);
+    UtAssert_UINT32_EQ(state.resident_bytes, store_entry.resident_size);
+    UtAssert_NONZERO(store_entry.resident_size);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_cache_AltHandler_PointerReturn, NULL);
 }
@@ -164,10 +216,11 @@ void test_bplib_cache_fsm_state_delete_enter(void)
     /* Test function for:
      * void bplib_cache_fsm_state_delete_enter(bplib_cache_entry_t *store_entry)
      */
-    bplib_cache_entry_t       store_entry;
-    bplib_cache_state_t       state;
-    bplib_mpool_block_t       refptr;
-    bplib_cache_offload_api_t offload_api;
+    bplib_cache_entry_t         store_entry;
+    bplib_cache_state_t         state;
+    bplib_mpool_block_t         refptr;
+    bplib_cache_offload_api_t   offload_api;
+    bplib_cache_offload_queue_t queue;
 
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
     memset(&state, 0, sizeof(bplib_cache_state_t));
@@ -178,8 +231,30 @@ void test_bplib_cache_fsm_state_delete_enter(void)
     store_entry.refptr              = (bplib_mpool_ref_t)&refptr;
     store_entry.offload_sid         = 1;
     store_entry.parent->offload_api = &offload_api;
+    state.offloaded_count           = 1;
+
+    UtAssert_VOIDCALL(bplib_cache_fsm_state_delete_enter(&store_entry));
+    UtAssert_STUB_COUNT(test_bplib_cache_release_stub, 1);
+    UtAssert_ZERO(store_entry.offload_sid);
+    UtAssert_ZERO(state.offloaded_count);
+    UtAssert_STUB_COUNT(bplib_rbt_extract_node, 0);
 
+    /* it no longer needs to be in the expire index */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_get_key_value), 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_get_key_value), UT_cache_uint64_Handler, NULL);
     UtAssert_VOIDCALL(bplib_cache_fsm_state_delete_enter(&store_entry));
+    UtAssert_STUB_COUNT(bplib_rbt_extract_node, 1);
+    UtAssert_STUB_COUNT(test_bplib_cache_release_stub, 1);
+
+    /* one not written out yet is taken out of the offload queue */
+    memset(&queue, 0, sizeof(bplib_cache_offload_queue_t));
+    state.offload_queue = &queue;
+    queue.entries[0]    = &store_entry;
+    queue.count         = 1;
+    store_entry.flags   = BPLIB_STORE_FLAG_OFFLOAD_WAIT;
+    UtAssert_VOIDCALL(bplib_cache_fsm_state_delete_enter(&store_entry));
+    UtAssert_NULL(queue.entries[0]);
+    UtAssert_ZERO(store_entry.flags & BPLIB_STORE_FLAG_OFFLOAD_WAIT);
 }
 
 void test_bplib_cache_fsm_reschedule(void)
@@ -187,18 +262,34 @@ void test_bplib_cache_fsm_reschedule(void)
     /* Test function for:
      * void bplib_cache_fsm_reschedule(bplib_cache_state_t *state, bplib_cache_entry_t *store_entry)
      */
-    bplib_cache_state_t state;
-    bplib_cache_entry_t store_entry;
+    bplib_cache_state_t       state;
+    bplib_cache_entry_t       store_entry;
+    bplib_cache_timer_wheel_t timer_wheel;
 
     memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
+    memset(&timer_wheel, 0, sizeof(bplib_cache_timer_wheel_t));
+    state.timer_wheel           = &timer_wheel;
+    state.action_time           = 1000;
+    store_entry.timer_link.next = &store_entry.timer_link;
+    store_entry.timer_link.prev = &store_entry.timer_link;
 
-    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_get_key_value), 1);
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_get_key_value), UT_cache_uint64_Handler, NULL);
+    /* not in a wait state, so it is retried soon */
     UtAssert_VOIDCALL(bplib_cache_fsm_reschedule(&state, &store_entry));
+    UtAssert_NOT_NULL(store_entry.timer_slot);
+    UtAssert_UINT32_EQ(store_entry.timer_deadline, 1000 + BP_CACHE_FAST_RETRY_TIME);
+    UtAssert_UINT32_EQ(timer_wheel.num_entries, 1);
 
-    store_entry.flags = 4;
+    /* the same time again leaves it where it is */
     UtAssert_VOIDCALL(bplib_cache_fsm_reschedule(&state, &store_entry));
+    UtAssert_UINT32_EQ(timer_wheel.num_entries, 1);
+
+    /* waiting for its action time, which is before the idle retry */
+    store_entry.flags       = BPLIB_STORE_FLAG_ACTION_TIME_WAIT;
+    store_entry.action_time = 2000;
+    UtAssert_VOIDCALL(bplib_cache_fsm_reschedule(&state, &store_entry));
+    UtAssert_UINT32_EQ(store_entry.timer_deadline, 2000);
+    UtAssert_UINT32_EQ(timer_wheel.num_entries, 1);
 }
 
 void test_bplib_cache_fsm_state_generate_dacs_eval(void)
@@ -221,11 +312,12 @@ void test_bplib_cache_fsm_state_generate_dacs_exit(void)
     /* Test function for:
      * void bplib_cache_fsm_state_generate_dacs_exit(bplib_cache_entry_t *store_entry)
      */
+    bplib_cache_state_t state;
     bplib_cache_entry_t store_entry;
 
+    memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&store_entry, 0, sizeof(bplib_cache_entry_t));
-
-    UT_SetHandlerFunction(UT_KEY(bplib_rbt_node_is_member), UT_cache_bool_Handler, NULL);
+    store_entry.parent = &state;
 
     UtAssert_VOIDCALL(bplib_cache_fsm_state_generate_dacs_exit(&store_entry));
 }
@@ -235,9 +327,12 @@ void test_bplib_cache_fsm_transition_state(void)
     /* Test function for:
      * void bplib_cache_fsm_transition_state(bplib_cache_entry_t *entry, bplib_cache_entry_state_t next_state)
      */
+    bplib_cache_state_t state;
     bplib_cache_entry_t entry;
 
+    memset(&state, 0, sizeof(bplib_cache_state_t));
     memset(&entry, 0, sizeof(bplib_cache_entry_t));
+    entry.parent                         = &state;
     entry.state                          = 10;
     bplib_cache_entry_state_t next_state = 10;
 
@@ -0,0 +1,234 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "test_bplib_cache.h"
+
+/* enough to make the table grow once from its initial size */
+#define TEST_HASH_NUM_ENTRIES ((BP_CACHE_HASH_INITIAL_CAPACITY * 3) / 4 + 1)
+
+typedef struct test_hash_setup
+{
+    bplib_cache_hash_table_t table;
+    bplib_cache_hash_slot_t  small_slots[BP_CACHE_HASH_INITIAL_CAPACITY];
+    bplib_cache_hash_slot_t  large_slots[BP_CACHE_HASH_INITIAL_CAPACITY * 2];
+    uint32_t                 num_allocs;
+    bplib_cache_entry_t      entries[TEST_HASH_NUM_ENTRIES];
+} test_hash_setup_t;
+
+static test_hash_setup_t test_hash;
+
+/* hands out the small set of slots first, then the large one, as the table grows */
+static void UT_cache_hash_calloc_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    void *retval;
+
+    if (test_hash.num_allocs == 0)
+    {
+        retval = test_hash.small_slots;
+    }
+    else
+    {
+        retval = test_hash.large_slots;
+    }
+
+    ++test_hash.num_allocs;
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+/* matches only the entry that is passed as the arg */
+static int test_hash_match(const bplib_cache_entry_t *store_entry, void *arg)
+{
+    return (store_entry != arg);
+}
+
+void test_bplib_cache_hash_setup(void)
+{
+    memset(&test_hash, 0, sizeof(test_hash));
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_hash_calloc_Handler, NULL);
+}
+
+void test_bplib_cache_hash_teardown(void)
+{
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+}
+
+void test_bplib_cache_hash_init(void)
+{
+    /* Test function for:
+     * void bplib_cache_hash_init(bplib_cache_hash_table_t *table)
+     */
+    memset(&test_hash.table, 0xFF, sizeof(test_hash.table));
+    UtAssert_VOIDCALL(bplib_cache_hash_init(&test_hash.table));
+    UtAssert_NULL(test_hash.table.slots);
+    UtAssert_ZERO(test_hash.table.capacity);
+    UtAssert_ZERO(test_hash.table.num_entries);
+}
+
+void test_bplib_cache_hash_release(void)
+{
+    /* Test function for:
+     * void bplib_cache_hash_release(bplib_cache_hash_table_t *table)
+     */
+
+    /* nothing was ever allocated */
+    UtAssert_VOIDCALL(bplib_cache_hash_release(&test_hash.table));
+    UtAssert_STUB_COUNT(bplib_os_free, 0);
+
+    UtAssert_INT32_EQ(bplib_cache_hash_insert(&test_hash.table, 1, &test_hash.entries[0]), BP_SUCCESS);
+    UtAssert_VOIDCALL(bplib_cache_hash_release(&test_hash.table));
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UtAssert_NULL(test_hash.table.slots);
+    UtAssert_ZERO(test_hash.table.capacity);
+}
+
+void test_bplib_cache_hash_insert(void)
+{
+    /* Test function for:
+     * int bplib_cache_hash_insert(bplib_cache_hash_table_t *table, bp_val_t hash, bplib_cache_entry_t *store_entry)
+     */
+    uint32_t i;
+
+    /* the first insert allocates the slots, which can fail */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+    UtAssert_INT32_EQ(bplib_cache_hash_insert(&test_hash.table, 1, &test_hash.entries[0]), BP_ERROR);
+    UtAssert_ZERO(test_hash.table.num_entries);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_hash_calloc_Handler, NULL);
+    for (i = 0; i < (TEST_HASH_NUM_ENTRIES - 1); ++i)
+    {
+        UtAssert_INT32_EQ(bplib_cache_hash_insert(&test_hash.table, i * 3, &test_hash.entries[i]), BP_SUCCESS);
+    }
+    UtAssert_ADDRESS_EQ(test_hash.table.slots, test_hash.small_slots);
+    UtAssert_UINT32_EQ(test_hash.table.capacity, BP_CACHE_HASH_INITIAL_CAPACITY);
+    UtAssert_UINT32_EQ(test_hash.table.num_entries, TEST_HASH_NUM_ENTRIES - 1);
+    UtAssert_UINT32_EQ(test_hash.entries[1].hash_key, 3);
+
+    /* growing can fail while there is still room, the entry goes in anyway */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+    UtAssert_INT32_EQ(bplib_cache_hash_insert(&test_hash.table, 0, &test_hash.entries[i]), BP_SUCCESS);
+    UtAssert_UINT32_EQ(test_hash.table.capacity, BP_CACHE_HASH_INITIAL_CAPACITY);
+    UtAssert_BOOL_TRUE(bplib_cache_hash_remove(&test_hash.table, &test_hash.entries[i]));
+
+    /* past 3/4 full, everything moves to twice as many slots */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_cache_hash_calloc_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_cache_hash_insert(&test_hash.table, 0, &test_hash.entries[i]), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(test_hash.table.slots, test_hash.large_slots);
+    UtAssert_UINT32_EQ(test_hash.table.capacity, BP_CACHE_HASH_INITIAL_CAPACITY * 2);
+    UtAssert_UINT32_EQ(test_hash.table.num_entries, TEST_HASH_NUM_ENTRIES);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+
+    for (i = 0; i < TEST_HASH_NUM_ENTRIES; ++i)
+    {
+        UtAssert_ADDRESS_EQ(
+            bplib_cache_hash_search(&test_hash.table, test_hash.entries[i].hash_key, test_hash_match,
+                                    &test_hash.entries[i]),
+            &test_hash.entries[i]);
+    }
+
+    /* once there is only one free slot left, nothing more can go in if it cannot grow */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+    test_hash.table.num_entries = test_hash.table.capacity - 1;
+    UtAssert_INT32_EQ(bplib_cache_hash_insert(&test_hash.table, 0, &test_hash.entries[0]), BP_ERROR);
+}
+
+void test_bplib_cache_hash_search(void)
+{
+    /* Test function for:
+     * bplib_cache_entry_t *bplib_cache_hash_search(const bplib_cache_hash_table_t *table, bp_val_t hash,
+     *                                              bplib_cache_hash_match_func_t match_func, void *arg)
+     */
+
+    /* nothing in the table yet */
+    UtAssert_NULL(bplib_cache_hash_search(&test_hash.table, 5, test_hash_match, &test_hash.entries[0]));
+
+    /* the same hash, and a different hash with the same home slot */
+    bplib_cache_hash_insert(&test_hash.table, 5, &test_hash.entries[0]);
+    bplib_cache_hash_insert(&test_hash.table, 5, &test_hash.entries[1]);
+    bplib_cache_hash_insert(&test_hash.table, 5 + BP_CACHE_HASH_INITIAL_CAPACITY, &test_hash.entries[2]);
+
+    UtAssert_ADDRESS_EQ(bplib_cache_hash_search(&test_hash.table, 5, test_hash_match, &test_hash.entries[0]),
+                        &test_hash.entries[0]);
+    UtAssert_ADDRESS_EQ(bplib_cache_hash_search(&test_hash.table, 5, test_hash_match, &test_hash.entries[1]),
+                        &test_hash.entries[1]);
+    UtAssert_ADDRESS_EQ(bplib_cache_hash_search(&test_hash.table, 5 + BP_CACHE_HASH_INITIAL_CAPACITY,
+                                                test_hash_match, &test_hash.entries[2]),
+                        &test_hash.entries[2]);
+
+    /* the entry is in the table, but not under this hash */
+    UtAssert_NULL(bplib_cache_hash_search(&test_hash.table, 5, test_hash_match, &test_hash.entries[2]));
+
+    /* same hash, but not a match */
+    UtAssert_NULL(bplib_cache_hash_search(&test_hash.table, 5, test_hash_match, &test_hash.entries[3]));
+}
+
+void test_bplib_cache_hash_remove(void)
+{
+    /* Test function for:
+     * bool bplib_cache_hash_remove(bplib_cache_hash_table_t *table, bplib_cache_entry_t *store_entry)
+     */
+    const bp_val_t last = BP_CACHE_HASH_INITIAL_CAPACITY - 1;
+
+    UtAssert_BOOL_FALSE(bplib_cache_hash_remove(&test_hash.table, &test_hash.entries[0]));
+
+    /* the run of used slots wraps around the end of the table */
+    bplib_cache_hash_insert(&test_hash.table, last, &test_hash.entries[0]);
+    bplib_cache_hash_insert(&test_hash.table, last, &test_hash.entries[1]);
+    bplib_cache_hash_insert(&test_hash.table, 0, &test_hash.entries[2]);
+    bplib_cache_hash_insert(&test_hash.table, 2, &test_hash.entries[3]);
+    UtAssert_ADDRESS_EQ(test_hash.small_slots[0].store_entry, &test_hash.entries[1]);
+    UtAssert_ADDRESS_EQ(test_hash.small_slots[1].store_entry, &test_hash.entries[2]);
+    UtAssert_ADDRESS_EQ(test_hash.small_slots[2].store_entry, &test_hash.entries[3]);
+
+    /* not in the table, but has the same hash */
+    test_hash.entries[4].hash_key = last;
+    UtAssert_BOOL_FALSE(bplib_cache_hash_remove(&test_hash.table, &test_hash.entries[4]));
+    UtAssert_UINT32_EQ(test_hash.table.num_entries, 4);
+
+    /* everything after it moves back, except the entry which is already in its home slot */
+    UtAssert_BOOL_TRUE(bplib_cache_hash_remove(&test_hash.table, &test_hash.entries[0]));
+    UtAssert_UINT32_EQ(test_hash.table.num_entries, 3);
+    UtAssert_ADDRESS_EQ(test_hash.small_slots[last].store_entry, &test_hash.entries[1]);
+    UtAssert_ADDRESS_EQ(test_hash.small_slots[0].store_entry, &test_hash.entries[2]);
+    UtAssert_NULL(test_hash.small_slots[1].store_entry);
+    UtAssert_ADDRESS_EQ(test_hash.small_slots[2].store_entry, &test_hash.entries[3]);
+
+    UtAssert_ADDRESS_EQ(bplib_cache_hash_search(&test_hash.table, 0, test_hash_match, &test_hash.entries[2]),
+                        &test_hash.entries[2]);
+    UtAssert_ADDRESS_EQ(bplib_cache_hash_search(&test_hash.table, 2, test_hash_match, &test_hash.entries[3]),
+                        &test_hash.entries[3]);
+
+    /* already removed */
+    UtAssert_BOOL_FALSE(bplib_cache_hash_remove(&test_hash.table, &test_hash.entries[0]));
+}
+
+void TestBplibCacheHash_Register(void)
+{
+    UtTest_Add(test_bplib_cache_hash_init, test_bplib_cache_hash_setup, test_bplib_cache_hash_teardown,
+               "Test bplib_cache_hash_init");
+    UtTest_Add(test_bplib_cache_hash_release, test_bplib_cache_hash_setup, test_bplib_cache_hash_teardown,
+               "Test bplib_cache_hash_release");
+    UtTest_Add(test_bplib_cache_hash_insert, test_bplib_cache_hash_setup, test_bplib_cache_hash_teardown,
+               "Test bplib_cache_hash_insert");
+    UtTest_Add(test_bplib_cache_hash_search, test_bplib_cache_hash_setup, test_bplib_cache_hash_teardown,
+               "Test bplib_cache_hash_search");
+    UtTest_Add(test_bplib_cache_hash_remove, test_bplib_cache_hash_setup, test_bplib_cache_hash_teardown,
+               "Test bplib_cache_hash_remove");
+}
@@ -0,0 +1,118 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "test_bplib_cache.h"
+
+void test_bplib_cache_rtt_sample(void)
+{
+    /* Test function for:
+     * void bplib_cache_rtt_sample(bplib_cache_state_t *state, bp_handle_t egress_intf_id, uint64_t rtt)
+     */
+    bplib_cache_state_t state;
+    bp_handle_t         intf_id;
+    uint32_t            i;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+
+    /* no interface, nothing to keep */
+    UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, BP_INVALID_HANDLE, 1000));
+    UtAssert_ZERO(state.rtt_estimates[0].srtt);
+
+    /* the first sample sets the time directly */
+    intf_id = bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE);
+    UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, intf_id, 800));
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].egress_intf_id.hdl, intf_id.hdl);
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].srtt, 800);
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].rttvar, 400);
+
+    /* later ones are smoothed, going up and down */
+    UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, intf_id, 1600));
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].rttvar, (400 * 3 + 800) / 4);
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].srtt, (800 * 7 + 1600) / 8);
+    UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, intf_id, 0));
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].rttvar, (500 * 3 + 900) / 4);
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].srtt, (900 * 7) / 8);
+
+    /* and anything past the longest retransmit time counts as that */
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, intf_id, (uint64_t)BP_CACHE_RTT_MAX_RETX_TIME * 1000));
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].srtt, BP_CACHE_RTT_MAX_RETX_TIME);
+
+    /* each interface gets its own slot, until they are all used */
+    for (i = 1; i < BP_CACHE_RTT_MAX_INTF; ++i)
+    {
+        UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, bp_handle_from_serial(1 + i, BPLIB_HANDLE_MPOOL_BASE), i));
+        UtAssert_UINT32_EQ(state.rtt_estimates[i].srtt, i);
+    }
+
+    UtAssert_ZERO(state.rtt_next_slot);
+
+    /* then they are reused in turn */
+    intf_id = bp_handle_from_serial(1 + BP_CACHE_RTT_MAX_INTF, BPLIB_HANDLE_MPOOL_BASE);
+    UtAssert_VOIDCALL(bplib_cache_rtt_sample(&state, intf_id, 100));
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].egress_intf_id.hdl, intf_id.hdl);
+    UtAssert_UINT32_EQ(state.rtt_estimates[0].srtt, 100);
+    UtAssert_UINT32_EQ(state.rtt_next_slot, 1);
+}
+
+void test_bplib_cache_rtt_retx_interval(void)
+{
+    /* Test function for:
+     * uint64_t bplib_cache_rtt_retx_interval(const bplib_cache_state_t *state, bp_handle_t egress_intf_id,
+     * uint64_t default_interval, uint32_t transmit_count)
+     */
+    bplib_cache_state_t state;
+    bp_handle_t         intf_id;
+
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    intf_id = bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE);
+
+    /* nothing measured yet */
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, BP_INVALID_HANDLE, 30000, 1), 30000);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 1), 30000);
+
+    /* a short link still waits the minimum time */
+    bplib_cache_rtt_sample(&state, intf_id, 10);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 0), BP_CACHE_RTT_MIN_RETX_TIME);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 1), BP_CACHE_RTT_MIN_RETX_TIME);
+
+    /* otherwise it is the smoothed time plus four times the deviation, doubled for each retransmit */
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    bplib_cache_rtt_sample(&state, intf_id, 2000);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 1), 6000);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 2), 12000);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 3), 24000);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, BP_CACHE_RTT_MAX_BACKOFF + 1),
+                       6000 << BP_CACHE_RTT_MAX_BACKOFF);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, BP_CACHE_RTT_MAX_BACKOFF + 10),
+                       6000 << BP_CACHE_RTT_MAX_BACKOFF);
+
+    /* up to the longest retransmit time */
+    memset(&state, 0, sizeof(bplib_cache_state_t));
+    bplib_cache_rtt_sample(&state, intf_id, BP_CACHE_RTT_MAX_RETX_TIME / 2);
+    UtAssert_UINT32_EQ(bplib_cache_rtt_retx_interval(&state, intf_id, 30000, 1), BP_CACHE_RTT_MAX_RETX_TIME);
+}
+
+void TestBplibCacheRtt_Register(void)
+{
+    UtTest_Add(test_bplib_cache_rtt_sample, NULL, NULL, "Test bplib_cache_rtt_sample");
+    UtTest_Add(test_bplib_cache_rtt_retx_interval, NULL, NULL, "Test bplib_cache_rtt_retx_interval");
+}
@@ -0,0 +1,301 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "test_bplib_cache.h"
+
+/* the DTN time at the start of the given tick */
+#define TEST_TIMER_TICK_TIME(tick) ((uint64_t)(tick) << BP_CACHE_TIMER_TICK_SHIFT)
+
+#define TEST_TIMER_NUM_ENTRIES 3
+
+typedef struct test_timer_setup
+{
+    bplib_cache_state_t       state;
+    bplib_cache_timer_wheel_t wheel;
+    bplib_mpool_block_t       sblk;
+    bplib_cache_entry_t       entries[TEST_TIMER_NUM_ENTRIES];
+} test_timer_setup_t;
+
+static test_timer_setup_t test_timer;
+
+/* the list operations need to actually link the entries for the rings in the slots to work */
+static void UT_cache_insert_before_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *list = UT_Hook_GetArgValueByName(Context, "list", bplib_mpool_block_t *);
+    bplib_mpool_block_t *node = UT_Hook_GetArgValueByName(Context, "node", bplib_mpool_block_t *);
+
+    node->prev       = list->prev;
+    node->next       = list;
+    list->prev       = node;
+    node->prev->next = node;
+}
+
+static void UT_cache_extract_node_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *node = UT_Hook_GetArgValueByName(Context, "node", bplib_mpool_block_t *);
+
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next       = node;
+    node->prev       = node;
+}
+
+static void test_timer_init_link(bplib_mpool_block_t *link)
+{
+    link->next = link;
+    link->prev = link;
+}
+
+void test_bplib_cache_timer_setup(void)
+{
+    size_t i;
+
+    memset(&test_timer, 0, sizeof(test_timer));
+    test_timer.state.timer_wheel = &test_timer.wheel;
+    test_timer_init_link(&test_timer.state.pending_list);
+    test_timer_init_link(&test_timer.sblk);
+
+    for (i = 0; i < TEST_TIMER_NUM_ENTRIES; ++i)
+    {
+        test_timer.entries[i].parent = &test_timer.state;
+        test_timer_init_link(&test_timer.entries[i].timer_link);
+    }
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_insert_before), UT_cache_insert_before_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_extract_node), UT_cache_extract_node_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn,
+                          &test_timer.sblk);
+}
+
+void test_bplib_cache_timer_teardown(void)
+{
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_insert_before), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_extract_node), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_uncast), UT_cache_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cache_timer_insert(void)
+{
+    /* Test function for:
+     * void bplib_cache_timer_insert(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry,
+     *                               uint64_t deadline, uint64_t now)
+     */
+    bplib_cache_timer_wheel_t *wheel = &test_timer.wheel;
+
+    /* an empty wheel starts from the current time, and a near deadline goes in the lowest level */
+    UtAssert_VOIDCALL(bplib_cache_timer_insert(wheel, &test_timer.entries[0], TEST_TIMER_TICK_TIME(103) + 5,
+                                               TEST_TIMER_TICK_TIME(100)));
+    UtAssert_UINT32_EQ(wheel->base_tick, 100);
+    UtAssert_UINT32_EQ(wheel->num_entries, 1);
+    UtAssert_ADDRESS_EQ(test_timer.entries[0].timer_slot, &wheel->slots[0][103 & (BP_CACHE_TIMER_SLOTS - 1)]);
+    UtAssert_UINT32_EQ(wheel->occupied[0], 1 << (103 & (BP_CACHE_TIMER_SLOTS - 1)));
+
+    /* the same tick shares the slot, and a wheel that is not empty keeps its position */
+    UtAssert_VOIDCALL(bplib_cache_timer_insert(wheel, &test_timer.entries[1], TEST_TIMER_TICK_TIME(103),
+                                               TEST_TIMER_TICK_TIME(200)));
+    UtAssert_UINT32_EQ(wheel->base_tick, 100);
+    UtAssert_UINT32_EQ(wheel->num_entries, 2);
+    UtAssert_ADDRESS_EQ(test_timer.entries[1].timer_slot, test_timer.entries[0].timer_slot);
+    UtAssert_ADDRESS_EQ(test_timer.entries[0].timer_link.next, &test_timer.entries[1].timer_link);
+
+    /* a deadline beyond the whole wheel waits in the highest level */
+    UtAssert_VOIDCALL(bplib_cache_timer_insert(wheel, &test_timer.entries[2], BP_CACHE_TIME_INFINITE, 0));
+    UtAssert_UINT32_EQ(wheel->num_entries, 3);
+    UtAssert_NONZERO(wheel->occupied[BP_CACHE_TIMER_LEVELS - 1]);
+    UtAssert_UINT32_EQ(test_timer.entries[2].timer_deadline, BP_CACHE_TIME_INFINITE);
+}
+
+void test_bplib_cache_timer_cancel(void)
+{
+    /* Test function for:
+     * void bplib_cache_timer_cancel(bplib_cache_timer_wheel_t *wheel, bplib_cache_entry_t *store_entry)
+     */
+    bplib_cache_timer_wheel_t *wheel = &test_timer.wheel;
+    bplib_mpool_block_t      **slot;
+
+    /* not scheduled */
+    UtAssert_VOIDCALL(bplib_cache_timer_cancel(wheel, &test_timer.entries[0]));
+    UtAssert_UINT32_EQ(wheel->num_entries, 0);
+
+    bplib_cache_timer_insert(wheel, &test_timer.entries[0], TEST_TIMER_TICK_TIME(50), TEST_TIMER_TICK_TIME(10));
+    bplib_cache_timer_insert(wheel, &test_timer.entries[1], TEST_TIMER_TICK_TIME(50), TEST_TIMER_TICK_TIME(10));
+    bplib_cache_timer_insert(wheel, &test_timer.entries[2], TEST_TIMER_TICK_TIME(50), TEST_TIMER_TICK_TIME(10));
+    slot = test_timer.entries[0].timer_slot;
+    UtAssert_ADDRESS_EQ(*slot, &test_timer.entries[0].timer_link);
+
+    /* one that the slot does not refer to */
+    UtAssert_VOIDCALL(bplib_cache_timer_cancel(wheel, &test_timer.entries[1]));
+    UtAssert_NULL(test_timer.entries[1].timer_slot);
+    UtAssert_ADDRESS_EQ(*slot, &test_timer.entries[0].timer_link);
+
+    /* the one that the slot refers to, so it moves on to the next */
+    UtAssert_VOIDCALL(bplib_cache_timer_cancel(wheel, &test_timer.entries[0]));
+    UtAssert_ADDRESS_EQ(*slot, &test_timer.entries[2].timer_link);
+    UtAssert_UINT32_EQ(wheel->num_entries, 1);
+
+    /* the last one empties the slot */
+    UtAssert_VOIDCALL(bplib_cache_timer_cancel(wheel, &test_timer.entries[2]));
+    UtAssert_NULL(*slot);
+    UtAssert_UINT32_EQ(wheel->num_entries, 0);
+    UtAssert_ZERO(wheel->occupied[1]);
+}
+
+void test_bplib_cache_timer_expire(void)
+{
+    /* Test function for:
+     * void bplib_cache_timer_expire(bplib_cache_timer_wheel_t *wheel, uint64_t now)
+     */
+    bplib_cache_timer_wheel_t *wheel = &test_timer.wheel;
+
+    /* an empty wheel just moves to the current time */
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1000)));
+    UtAssert_UINT32_EQ(wheel->base_tick, 1000);
+
+    /* a deadline already passed, one in the next level up, and one beyond the whole wheel */
+    bplib_cache_timer_insert(wheel, &test_timer.entries[0], TEST_TIMER_TICK_TIME(10), TEST_TIMER_TICK_TIME(1000));
+    bplib_cache_timer_insert(wheel, &test_timer.entries[1], TEST_TIMER_TICK_TIME(1020), TEST_TIMER_TICK_TIME(1000));
+    bplib_cache_timer_insert(wheel, &test_timer.entries[2], TEST_TIMER_TICK_TIME(1000 + 40000),
+                             TEST_TIMER_TICK_TIME(1000));
+
+    /* going backwards does nothing */
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(900)));
+    UtAssert_UINT32_EQ(wheel->num_entries, 3);
+
+    /* entries are not expired until the tick has passed */
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1000) + 100));
+    UtAssert_UINT32_EQ(wheel->num_entries, 3);
+
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1001)));
+    UtAssert_UINT32_EQ(wheel->num_entries, 2);
+    UtAssert_NULL(test_timer.entries[0].timer_slot);
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 1);
+
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1020)));
+    UtAssert_UINT32_EQ(wheel->num_entries, 2);
+    UtAssert_ADDRESS_EQ(test_timer.entries[1].timer_slot, &wheel->slots[0][1020 & (BP_CACHE_TIMER_SLOTS - 1)]);
+
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1021)));
+    UtAssert_UINT32_EQ(wheel->num_entries, 1);
+    UtAssert_NULL(test_timer.entries[1].timer_slot);
+
+    /* the far one is placed again when the highest level comes around, and then expired at its own time */
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1000 + 40000)));
+    UtAssert_UINT32_EQ(wheel->num_entries, 1);
+    UtAssert_NOT_NULL(test_timer.entries[2].timer_slot);
+
+    UtAssert_VOIDCALL(bplib_cache_timer_expire(wheel, TEST_TIMER_TICK_TIME(1000 + 40001)));
+    UtAssert_UINT32_EQ(wheel->num_entries, 0);
+    UtAssert_NULL(test_timer.entries[2].timer_slot);
+    UtAssert_UINT32_EQ(wheel->base_tick, 1000 + 40001);
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 3);
+}
+
+void test_bplib_cache_timer_next_deadline(void)
+{
+    /* Test function for:
+     * uint64_t bplib_cache_timer_next_deadline(const bplib_cache_timer_wheel_t *wheel)
+     */
+    bplib_cache_timer_wheel_t *wheel = &test_timer.wheel;
+
+    UtAssert_True(bplib_cache_timer_next_deadline(wheel) == BP_CACHE_TIME_INFINITE, "empty wheel");
+
+    /* in the next level up, it is due once the level below comes around to its slot */
+    bplib_cache_timer_insert(wheel, &test_timer.entries[0], TEST_TIMER_TICK_TIME(130), TEST_TIMER_TICK_TIME(101));
+    UtAssert_True(bplib_cache_timer_next_deadline(wheel) == TEST_TIMER_TICK_TIME(129), "cascade of level 1");
+
+    /* in the lowest level, it is due once its own tick passes */
+    bplib_cache_timer_insert(wheel, &test_timer.entries[1], TEST_TIMER_TICK_TIME(105), TEST_TIMER_TICK_TIME(101));
+    UtAssert_True(bplib_cache_timer_next_deadline(wheel) == TEST_TIMER_TICK_TIME(106), "expiry in level 0");
+
+    /* the slot at the current position of a level is only due on the next turn of it */
+    bplib_cache_timer_cancel(wheel, &test_timer.entries[0]);
+    bplib_cache_timer_cancel(wheel, &test_timer.entries[1]);
+    bplib_cache_timer_insert(wheel, &test_timer.entries[0], TEST_TIMER_TICK_TIME(64 * 2 + 16),
+                             TEST_TIMER_TICK_TIME(64 + 1));
+    wheel->base_tick = 64 * 2 + 1;
+    UtAssert_True(bplib_cache_timer_next_deadline(wheel) == TEST_TIMER_TICK_TIME(64 * 10 + 1), "next turn");
+    wheel->base_tick = 64 * 2;
+    UtAssert_True(bplib_cache_timer_next_deadline(wheel) == TEST_TIMER_TICK_TIME(64 * 2 + 1), "same turn");
+}
+
+static bplib_cache_entry_t *test_timer_visited[TEST_TIMER_NUM_ENTRIES];
+static uint32_t             test_timer_num_visited;
+
+/* the arg is how many entries to visit before stopping */
+static bool test_timer_visit_func(void *arg, bplib_cache_entry_t *store_entry)
+{
+    test_timer_visited[test_timer_num_visited] = store_entry;
+    ++test_timer_num_visited;
+
+    return (test_timer_num_visited < *((uint32_t *)arg));
+}
+
+void test_bplib_cache_timer_foreach_latest(void)
+{
+    /* Test function for:
+     * void bplib_cache_timer_foreach_latest(const bplib_cache_timer_wheel_t *wheel,
+     *                                       bplib_cache_timer_visit_func_t visit_func, void *arg)
+     */
+    bplib_cache_timer_wheel_t *wheel = &test_timer.wheel;
+    uint32_t                   limit;
+
+    memset(test_timer_visited, 0, sizeof(test_timer_visited));
+    test_timer_num_visited = 0;
+    limit                  = TEST_TIMER_NUM_ENTRIES;
+
+    /* nothing in the wheel */
+    UtAssert_VOIDCALL(bplib_cache_timer_foreach_latest(wheel, test_timer_visit_func, &limit));
+    UtAssert_ZERO(test_timer_num_visited);
+
+    /* one in each of the lowest three levels, which are visited from the latest */
+    bplib_cache_timer_insert(wheel, &test_timer.entries[0], TEST_TIMER_TICK_TIME(103), TEST_TIMER_TICK_TIME(100));
+    bplib_cache_timer_insert(wheel, &test_timer.entries[1], TEST_TIMER_TICK_TIME(300), TEST_TIMER_TICK_TIME(100));
+    bplib_cache_timer_insert(wheel, &test_timer.entries[2], TEST_TIMER_TICK_TIME(120), TEST_TIMER_TICK_TIME(100));
+    UtAssert_VOIDCALL(bplib_cache_timer_foreach_latest(wheel, test_timer_visit_func, &limit));
+    UtAssert_UINT32_EQ(test_timer_num_visited, 3);
+    UtAssert_ADDRESS_EQ(test_timer_visited[0], &test_timer.entries[1]);
+    UtAssert_ADDRESS_EQ(test_timer_visited[1], &test_timer.entries[2]);
+    UtAssert_ADDRESS_EQ(test_timer_visited[2], &test_timer.entries[0]);
+
+    /* the same slot, then stopping early */
+    bplib_cache_timer_cancel(wheel, &test_timer.entries[2]);
+    bplib_cache_timer_insert(wheel, &test_timer.entries[2], TEST_TIMER_TICK_TIME(300), TEST_TIMER_TICK_TIME(100));
+    test_timer_num_visited = 0;
+    limit                  = 2;
+    UtAssert_VOIDCALL(bplib_cache_timer_foreach_latest(wheel, test_timer_visit_func, &limit));
+    UtAssert_UINT32_EQ(test_timer_num_visited, 2);
+    UtAssert_ADDRESS_EQ(test_timer_visited[0], &test_timer.entries[1]);
+    UtAssert_ADDRESS_EQ(test_timer_visited[1], &test_timer.entries[2]);
+}
+
+void TestBplibCacheTimer_Register(void)
+{
+    UtTest_Add(test_bplib_cache_timer_insert, test_bplib_cache_timer_setup, test_bplib_cache_timer_teardown,
+               "Test bplib_cache_timer_insert");
+    UtTest_Add(test_bplib_cache_timer_cancel, test_bplib_cache_timer_setup, test_bplib_cache_timer_teardown,
+               "Test bplib_cache_timer_cancel");
+    UtTest_Add(test_bplib_cache_timer_expire, test_bplib_cache_timer_setup, test_bplib_cache_timer_teardown,
+               "Test bplib_cache_timer_expire");
+    UtTest_Add(test_bplib_cache_timer_next_deadline, test_bplib_cache_timer_setup, test_bplib_cache_timer_teardown,
+               "Test bplib_cache_timer_next_deadline");
+    UtTest_Add(test_bplib_cache_timer_foreach_latest, test_bplib_cache_timer_setup, test_bplib_cache_timer_teardown,
+               "Test bplib_cache_timer_foreach_latest");
+}
@@ -0,0 +1,778 @@
+/************************************************************************
+ *
+ *  Benchmark of the cache as the number of stored bundles grows
+ *
+ *  A cache is attached to its own route table for every number of
+ *  bundles from a list, once without an offload module, where it takes
+ *  custody of the bundles in memory, and once with each offload module
+ *  asked for.  The bundles all go from node 100 to node 200, which has
+ *  no route until a contact to it starts.  Each run goes through the
+ *  life of the bundles in order:
+ *
+ *    store    the bundles are given to the cache as the route table
+ *             would, and are timed until every one is stored, and
+ *             written out by the offload module if there is one, then
+ *             the pool memory each one takes is printed
+ *    poll     bplib_cache_do_poll() with every bundle waiting for a
+ *             route, and again with every bundle waiting for its DACS
+ *    contact  a contact to node 200 is added that starts right away,
+ *             and the time to the first and the last bundle coming out
+ *             of its interface is printed
+ *    dacs     custody of every bundle is acknowledged by DACS bundles
+ *             from the next custodian, and timed until the cache is done
+ *             with every one of them
+ *
+ *  The interface of the contact is a generic flow which is emptied by
+ *  the benchmark, marking each bundle as sent the way a CLA would.  All
+ *  of the flows are run by calling bplib_route_periodic_maintenance()
+ *  from the one thread, and the bundles are made before each timing, so
+ *  the numbers are of the cache and the route table only.  Every bundle
+ *  has to come out of the interface, and every one has to be released
+ *  by a DACS, for the run to pass.
+ *
+ *  It is set up from the environment, which the defaults are shown for:
+ *
+ *    CACHE_BENCH_BUNDLES  1000,10000,100000   numbers of bundles stored
+ *    CACHE_BENCH_OFFLOAD  file                offload modules to run, file or segment, or none
+ *    CACHE_BENCH_SIZE     256                 payload size of every bundle
+ *    CACHE_BENCH_POLLS    1000                polls timed each time
+ *    CACHE_BENCH_RANGE    64                  bundles in each range of a DACS
+ *    CACHE_BENCH_DIR      cache_bench         removed again after the run
+ *
+ *  The memory of each route table is sized for the number of bundles,
+ *  at 4 KiB each, as all of them are in memory at once without offload.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_routing.h"
+#include "bplib_file_offload.h"
+#include "bplib_segment_offload.h"
+#include "v7_cache_internal.h"
+#include "benchutil.h"
+
+/* limits of what can be asked for */
+#define CACHE_BENCH_MAX_BUNDLES 10000000
+#define CACHE_BENCH_MAX_VALUES  8
+#define CACHE_BENCH_MAX_PAYLOAD 65536
+#define CACHE_BENCH_PATH_SIZE   128
+
+/* bundles made and given to the cache at once */
+#define CACHE_BENCH_BATCH 256
+
+/* the memory of the route table, see above */
+#define CACHE_BENCH_BASE_MEM   (16 * 1024 * 1024)
+#define CACHE_BENCH_BUNDLE_MEM 4096
+
+/* how long the cache gets to finish each step before the run is failed */
+#define CACHE_BENCH_STEP_LIMIT_MSEC 600000
+
+/* the magic number of the contact interface flow */
+#define CACHE_BENCH_FLOW_MAGIC 0x7a0bec4e
+
+/* Bundles are handed over as refs, as a CLA or data service does, so the cache can keep them */
+#define CACHE_BENCH_BUNDLE_MAGIC 0x7a0bec4f
+
+typedef struct cache_bench_module
+{
+    const char                            *name;
+    const bplib_cache_module_api_t *const *api; /* NULL for none */
+} cache_bench_module_t;
+
+typedef struct cache_bench_config
+{
+    char          modules[CACHE_BENCH_PATH_SIZE];
+    char          dir[CACHE_BENCH_PATH_SIZE];
+    unsigned long bundles[CACHE_BENCH_MAX_VALUES];
+    uint32_t      num_bundles;
+    size_t        payload_size;
+    uint32_t      polls;
+    uint32_t      range;
+} cache_bench_config_t;
+
+/* what one run is done with, all of it goes with the route table at the end */
+typedef struct cache_bench_run
+{
+    const cache_bench_module_t *module;
+    uint32_t                    bundles;
+    bplib_routetbl_t           *rtbl;
+    bplib_mpool_t              *pool;
+    bp_handle_t                 node_intf_id;
+    bp_handle_t                 storage_intf_id;
+    bp_handle_t                 contact_intf_id;
+    bplib_mpool_flow_t         *contact_flow;
+    bplib_cache_state_t        *state;
+} cache_bench_run_t;
+
+static const cache_bench_module_t CACHE_BENCH_MODULES[] = {
+    {"none", NULL}, {"file", &BPLIB_FILE_OFFLOAD_API}, {"segment", &BPLIB_SEGMENT_OFFLOAD_API}};
+
+#define CACHE_BENCH_NUM_MODULES (sizeof(CACHE_BENCH_MODULES) / sizeof(CACHE_BENCH_MODULES[0]))
+
+static const bp_ipn_addr_t CACHE_BENCH_SRC_ADDR       = {100, 1};
+static const bp_ipn_addr_t CACHE_BENCH_STORAGE_ADDR   = {100, 10};
+static const bp_ipn_addr_t CACHE_BENCH_DST_ADDR       = {200, 1};
+static const bp_ipn_addr_t CACHE_BENCH_CUSTODIAN_ADDR = {200, 10};
+
+static cache_bench_config_t cache_bench_config;
+static uint8_t              cache_bench_payload[CACHE_BENCH_MAX_PAYLOAD];
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static int cache_bench_remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftwbuf)
+{
+    return remove(path);
+}
+
+static int cache_bench_query(const cache_bench_run_t *run, int key)
+{
+    const void *val;
+
+    if (bplib_cache_query(run->rtbl, run->storage_intf_id, key, bplib_cache_module_valtype_integer, &val) !=
+        BP_SUCCESS)
+    {
+        return -1;
+    }
+
+    return *(const int *)val;
+}
+
+static void cache_bench_report_rate(const cache_bench_run_t *run, const char *test, uint64_t count,
+                                    uint64_t elapsed_ns)
+{
+    if (elapsed_ns == 0)
+    {
+        elapsed_ns = 1;
+    }
+
+    UtPrintf("%-8s %-14s bundles %7lu: %12.1f /s %10.1f ns each", run->module->name, test,
+             (unsigned long)run->bundles, ((double)count * 1e9) / (double)elapsed_ns,
+             (double)elapsed_ns / (double)count);
+}
+
+/* The contact interface has nothing to do when it goes up or down */
+static int cache_bench_event(void *arg, bplib_mpool_block_t *jblk)
+{
+    return BP_SUCCESS;
+}
+
+/* Turns the bundle into a ref block, on failure the bundle is recycled and this returns NULL */
+static bplib_mpool_block_t *cache_bench_make_ref_block(bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_ref_t    refptr;
+    bplib_mpool_block_t *rblk;
+
+    refptr = bplib_mpool_ref_create(pblk);
+    if (refptr == NULL)
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    /* the block holds its own ref, so this one is not needed after */
+    rblk = bplib_mpool_ref_make_block(refptr, CACHE_BENCH_BUNDLE_MAGIC, NULL);
+    bplib_mpool_ref_release(refptr);
+
+    return rblk;
+}
+
+/* Makes a bundle that asks for custody transfer, with its own sequence number */
+static bplib_mpool_block_t *cache_bench_build_bundle(cache_bench_run_t *run, uint32_t seq)
+{
+    bplib_mpool_block_t            *pblk;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bp_primary_block_t             *pri;
+    bp_canonical_block_buffer_t    *pay;
+
+    pblk = bplib_mpool_bblock_primary_alloc(run->pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    cblk = bplib_mpool_bblock_canonical_alloc(run->pool, 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (cpb == NULL || ccb == NULL)
+    {
+        if (pblk != NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+        if (cblk != NULL)
+        {
+            bplib_mpool_recycle_block(cblk);
+        }
+        return NULL;
+    }
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    pri->version = 7;
+
+    v7_set_eid(&pri->destinationEID, &CACHE_BENCH_DST_ADDR);
+    v7_set_eid(&pri->sourceEID, &CACHE_BENCH_SRC_ADDR);
+    v7_set_eid(&pri->reportEID, &CACHE_BENCH_SRC_ADDR);
+
+    pri->creationTimeStamp.time         = v7_get_current_time();
+    pri->creationTimeStamp.sequence_num = seq;
+
+    pri->lifetime                     = 3600000;
+    pri->controlFlags.mustNotFragment = true;
+    pri->crctype                      = bp_crctype_CRC32C;
+
+    cpb->data.delivery.delivery_policy     = bplib_policy_delivery_custody_tracking;
+    cpb->data.delivery.local_retx_interval = 3600000;
+
+    pay = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    pay->canonical_block.blockNum  = 1;
+    pay->canonical_block.crctype   = bp_crctype_CRC32C;
+    pay->canonical_block.blockType = bp_blocktype_payloadBlock;
+
+    if (v7_block_encode_pri(cpb) != 0 ||
+        v7_block_encode_pay(ccb, cache_bench_payload, cache_bench_config.payload_size) != 0)
+    {
+        bplib_mpool_recycle_block(pblk);
+        bplib_mpool_recycle_block(cblk);
+        return NULL;
+    }
+
+    bplib_mpool_bblock_primary_append(cpb, cblk);
+    v7_compute_full_bundle_size(cpb);
+
+    return cache_bench_make_ref_block(pblk);
+}
+
+/*
+ * Makes a DACS from the next custodian, for as many ranges of the given length as fit, starting at
+ * first_seq and going no further than end_seq.  Returns how many sequence numbers it covers.
+ */
+static uint32_t cache_bench_build_dacs(cache_bench_run_t *run, uint32_t first_seq, uint32_t end_seq,
+                                       bplib_mpool_block_t **pblk_out)
+{
+    bplib_mpool_block_t               *pblk;
+    bplib_mpool_block_t               *cblk;
+    bplib_mpool_bblock_primary_t      *cpb;
+    bplib_mpool_bblock_canonical_t    *ccb;
+    bp_primary_block_t                *pri;
+    bp_canonical_block_buffer_t       *pay;
+    bp_custody_accept_payload_block_t *ack;
+    uint32_t                           seq;
+    uint32_t                           count;
+
+    *pblk_out = NULL;
+    pblk      = bplib_mpool_bblock_primary_alloc(run->pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+    cpb       = bplib_mpool_bblock_primary_cast(pblk);
+    cblk      = bplib_mpool_bblock_canonical_alloc(run->pool, 0, NULL);
+    ccb       = bplib_mpool_bblock_canonical_cast(cblk);
+    if (cpb == NULL || ccb == NULL)
+    {
+        if (pblk != NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+        if (cblk != NULL)
+        {
+            bplib_mpool_recycle_block(cblk);
+        }
+        return 0;
+    }
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    pri->version = 7;
+
+    v7_set_eid(&pri->destinationEID, &CACHE_BENCH_STORAGE_ADDR);
+    v7_set_eid(&pri->sourceEID, &CACHE_BENCH_CUSTODIAN_ADDR);
+    v7_set_eid(&pri->reportEID, &CACHE_BENCH_CUSTODIAN_ADDR);
+
+    pri->creationTimeStamp.time       = v7_get_current_time();
+    pri->lifetime                     = 3600000;
+    pri->controlFlags.isAdminRecord   = true;
+    pri->controlFlags.mustNotFragment = true;
+    pri->crctype                      = bp_crctype_CRC16;
+
+    /* the cache only looks at the decoded ranges, so this does not need to be encoded */
+    pay = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    pay->canonical_block.blockNum  = bp_blocktype_payloadBlock;
+    pay->canonical_block.blockType = bp_blocktype_custodyAcceptPayloadBlock;
+    pay->canonical_block.crctype   = bp_crctype_CRC16;
+
+    ack = &pay->data.custody_accept_payload_block;
+    v7_set_eid(&ack->flow_source_eid, &CACHE_BENCH_SRC_ADDR);
+
+    seq = first_seq;
+    while (ack->num_entries < BP_DACS_MAX_SEQ_PER_PAYLOAD && seq < end_seq)
+    {
+        count = end_seq - seq;
+        if (count > cache_bench_config.range)
+        {
+            count = cache_bench_config.range;
+        }
+
+        ack->ranges[ack->num_entries].first_seq = seq;
+        ack->ranges[ack->num_entries].count     = count;
+        ++ack->num_entries;
+        seq += count;
+    }
+
+    bplib_mpool_bblock_primary_append(cpb, cblk);
+
+    *pblk_out = cache_bench_make_ref_block(pblk);
+    return seq - first_seq;
+}
+
+/* Runs the flows until the cache stat reaches the value, or the step takes too long, returns whether it did */
+static bool cache_bench_wait_stat(cache_bench_run_t *run, int key, int value)
+{
+    uint64_t limit;
+
+    limit = bplib_os_get_dtntime_ms() + CACHE_BENCH_STEP_LIMIT_MSEC;
+    while (cache_bench_query(run, key) != value)
+    {
+        if (bplib_os_get_dtntime_ms() > limit)
+        {
+            return false;
+        }
+        bplib_route_periodic_maintenance(run->rtbl);
+    }
+
+    return true;
+}
+
+/* Takes everything off the contact interface, marking it sent as a CLA would, returns how many there were */
+static uint32_t cache_bench_drain(cache_bench_run_t *run)
+{
+    bplib_mpool_block_t          *qblk;
+    bplib_mpool_bblock_primary_t *cpb;
+    uint64_t                      now;
+    uint32_t                      count;
+
+    count = 0;
+    now   = bplib_os_get_dtntime_ms();
+    while ((qblk = bplib_mpool_flow_try_pull(&run->contact_flow->egress, 0)) != NULL)
+    {
+        cpb = bplib_mpool_bblock_primary_cast(qblk);
+        if (cpb != NULL)
+        {
+            cpb->data.delivery.egress_intf_id = run->contact_intf_id;
+            cpb->data.delivery.egress_time    = now;
+        }
+        bplib_mpool_recycle_block(qblk);
+        ++count;
+    }
+
+    return count;
+}
+
+static bool cache_bench_setup_run(cache_bench_run_t *run)
+{
+    static const bplib_mpool_blocktype_api_t flow_api = {.construct = NULL, .destruct = NULL};
+
+    bplib_mpool_block_t *fblk;
+    char                 base_dir[CACHE_BENCH_PATH_SIZE + 32];
+    int                  val;
+
+    run->rtbl = bplib_route_alloc_table(8, CACHE_BENCH_BASE_MEM + ((size_t)run->bundles * CACHE_BENCH_BUNDLE_MEM));
+    if (run->rtbl == NULL)
+    {
+        UtAssert_Failed("Could not make a route table for %lu bundles", (unsigned long)run->bundles);
+        return false;
+    }
+    run->pool = bplib_route_get_mpool(run->rtbl);
+    bplib_mpool_register_blocktype(run->pool, CACHE_BENCH_BUNDLE_MAGIC, NULL, 0);
+
+    run->node_intf_id = bplib_create_node_intf(run->rtbl, CACHE_BENCH_SRC_ADDR.node_number);
+    run->storage_intf_id = bplib_cache_attach(run->rtbl, &CACHE_BENCH_STORAGE_ADDR);
+    if (!UtAssert_BOOL_TRUE(bp_handle_is_valid(run->node_intf_id) && bp_handle_is_valid(run->storage_intf_id)))
+    {
+        return false;
+    }
+
+    run->state = bplib_cache_get_state(bplib_mpool_block_from_external_id(run->pool, run->storage_intf_id));
+    if (!UtAssert_NOT_NULL(run->state))
+    {
+        return false;
+    }
+
+    /* without offload, custody is only taken when asked for */
+    if (run->module->api == NULL)
+    {
+        val = 1;
+        bplib_cache_configure(run->rtbl, run->storage_intf_id, bplib_cache_confkey_memory_custody,
+                              bplib_cache_module_valtype_integer, &val);
+    }
+    else
+    {
+        snprintf(base_dir, sizeof(base_dir), "%s/%s.%lu", cache_bench_config.dir, run->module->name,
+                 (unsigned long)run->bundles);
+        if (!UtAssert_BOOL_TRUE(bp_handle_is_valid(bplib_cache_register_module_service(
+                run->rtbl, run->storage_intf_id, *run->module->api, NULL))) ||
+            !UtAssert_INT32_EQ(bplib_cache_configure(run->rtbl, run->storage_intf_id,
+                                                     bplib_cache_confkey_offload_base_dir,
+                                                     bplib_cache_module_valtype_string, base_dir),
+                               BP_SUCCESS) ||
+            !UtAssert_INT32_EQ(bplib_cache_start(run->rtbl, run->storage_intf_id), BP_SUCCESS))
+        {
+            return false;
+        }
+    }
+
+    /* the interface the contact goes over, which has no route until the contact starts */
+    bplib_mpool_register_blocktype(run->pool, CACHE_BENCH_FLOW_MAGIC, &flow_api, 0);
+    fblk                 = bplib_mpool_flow_alloc(run->pool, CACHE_BENCH_FLOW_MAGIC, NULL);
+    run->contact_flow    = bplib_mpool_flow_cast(fblk);
+    run->contact_intf_id = bplib_route_register_generic_intf(run->rtbl, BP_INVALID_HANDLE, fblk);
+    if (!UtAssert_BOOL_TRUE(bp_handle_is_valid(run->contact_intf_id)))
+    {
+        return false;
+    }
+    bplib_route_register_event_handler(run->rtbl, run->contact_intf_id, cache_bench_event);
+    bplib_mpool_flow_enable(&run->contact_flow->egress, BP_MPOOL_MAX_SUBQ_DEPTH);
+
+    bplib_route_intf_set_flags(run->rtbl, run->node_intf_id, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+    bplib_route_intf_set_flags(run->rtbl, run->storage_intf_id,
+                               BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+    bplib_route_intf_set_flags(run->rtbl, run->contact_intf_id,
+                               BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+    bplib_route_periodic_maintenance(run->rtbl);
+
+    return true;
+}
+
+static void cache_bench_teardown_run(cache_bench_run_t *run)
+{
+    if (run->rtbl == NULL)
+    {
+        return;
+    }
+
+    if (run->module->api != NULL && run->state != NULL)
+    {
+        bplib_cache_stop(run->rtbl, run->storage_intf_id);
+    }
+
+    /* all of the memory of the table is in the one allocation */
+    bplib_os_free(run->rtbl);
+    run->rtbl = NULL;
+}
+
+/*************************************************************************
+ * Steps of a run
+ *************************************************************************/
+
+static bool cache_bench_store(cache_bench_run_t *run)
+{
+    bplib_mpool_block_t *batch[CACHE_BENCH_BATCH];
+    uint64_t             elapsed_ns;
+    uint64_t             start_time;
+    uint32_t             done;
+    uint32_t             count;
+    uint32_t             i;
+
+    elapsed_ns = 0;
+    for (done = 0; done < run->bundles; done += count)
+    {
+        count = run->bundles - done;
+        if (count > CACHE_BENCH_BATCH)
+        {
+            count = CACHE_BENCH_BATCH;
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            batch[i] = cache_bench_build_bundle(run, done + i + 1);
+            if (batch[i] == NULL)
+            {
+                UtAssert_Failed("Could not make bundle %lu", (unsigned long)(done + i));
+                while (i > 0)
+                {
+                    --i;
+                    bplib_mpool_recycle_block(batch[i]);
+                }
+                return false;
+            }
+        }
+
+        /* as the route table does with a bundle that is not stored yet, which only the cache can take */
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_route_push_egress_bundle(run->rtbl, run->storage_intf_id, batch[i]) != 0)
+            {
+                bplib_mpool_recycle_block(batch[i]);
+            }
+        }
+        bplib_route_periodic_maintenance(run->rtbl);
+        elapsed_ns += bench_get_time_ns() - start_time;
+    }
+
+    /*
+     * the last of them may still be waiting to be written out, and with no route yet each one is
+     * offered once and comes back, after which it waits for a route
+     */
+    start_time = bench_get_time_ns();
+    if (run->module->api != NULL)
+    {
+        cache_bench_wait_stat(run, bplib_cache_confkey_stat_entries_offloaded, run->bundles);
+    }
+    cache_bench_wait_stat(run, bplib_cache_confkey_stat_entries_idle, run->bundles);
+    elapsed_ns += bench_get_time_ns() - start_time;
+
+    if (!UtAssert_INT32_EQ(cache_bench_query(run, bplib_cache_confkey_stat_entries_idle), run->bundles))
+    {
+        return false;
+    }
+
+    cache_bench_report_rate(run, "store", run->bundles, elapsed_ns);
+
+    /* what each bundle takes from the pool, while it is still in memory */
+    UtPrintf("%-8s %-14s bundles %7lu: %8d bytes %4d blocks each, at most %8d bytes %4d blocks", run->module->name,
+             "footprint", (unsigned long)run->bundles, cache_bench_query(run, bplib_cache_confkey_stat_footprint_bytes),
+             cache_bench_query(run, bplib_cache_confkey_stat_footprint_blocks),
+             cache_bench_query(run, bplib_cache_confkey_stat_footprint_bytes_max),
+             cache_bench_query(run, bplib_cache_confkey_stat_footprint_blocks_max));
+    return true;
+}
+
+static void cache_bench_poll(cache_bench_run_t *run, const char *test)
+{
+    uint64_t start_time;
+    uint32_t i;
+
+    start_time = bench_get_time_ns();
+    for (i = 0; i < cache_bench_config.polls; ++i)
+    {
+        bplib_cache_do_poll(run->state);
+    }
+    cache_bench_report_rate(run, test, cache_bench_config.polls, bench_get_time_ns() - start_time);
+}
+
+static bool cache_bench_contact(cache_bench_run_t *run)
+{
+    bplib_route_contact_t contact;
+    uint64_t              limit;
+    uint64_t              start_time;
+    uint64_t              first_ns;
+    uint64_t              last_ns;
+    uint32_t              count;
+    uint32_t              sent;
+
+    memset(&contact, 0, sizeof(contact));
+    contact.dest       = CACHE_BENCH_DST_ADDR.node_number;
+    contact.mask       = ~(bp_ipn_t)0;
+    contact.intf_id    = run->contact_intf_id;
+    contact.start_time = bplib_os_get_dtntime_ms();
+    contact.end_time   = contact.start_time + 3600000;
+
+    first_ns = 0;
+    last_ns  = 0;
+    sent     = 0;
+    limit    = contact.start_time + CACHE_BENCH_STEP_LIMIT_MSEC;
+
+    start_time = bench_get_time_ns();
+    if (!UtAssert_INT32_EQ(bplib_route_contact_add(run->rtbl, &contact), BP_SUCCESS))
+    {
+        return false;
+    }
+
+    while (sent < run->bundles && bplib_os_get_dtntime_ms() < limit)
+    {
+        bplib_route_periodic_maintenance(run->rtbl);
+        count = cache_bench_drain(run);
+        if (count != 0)
+        {
+            last_ns = bench_get_time_ns() - start_time;
+            if (sent == 0)
+            {
+                first_ns = last_ns;
+            }
+            sent += count;
+        }
+    }
+
+    if (!UtAssert_UINT32_EQ(sent, run->bundles))
+    {
+        return false;
+    }
+
+    /* the refs that were taken off the interface have to be done with, so the entries wait for the DACS */
+    bplib_route_periodic_maintenance(run->rtbl);
+
+    UtPrintf("%-8s %-14s bundles %7lu: %12.3f ms to first %10.3f ms to last", run->module->name, "contact",
+             (unsigned long)run->bundles, (double)first_ns / 1e6, (double)last_ns / 1e6);
+    cache_bench_report_rate(run, "contact/send", run->bundles, last_ns);
+    return true;
+}
+
+static bool cache_bench_dacs(cache_bench_run_t *run)
+{
+    bplib_mpool_block_t *batch[CACHE_BENCH_BATCH];
+    uint64_t             elapsed_ns;
+    uint64_t             start_time;
+    uint32_t             seq;
+    uint32_t             count;
+    uint32_t             i;
+    bool                 done;
+
+    elapsed_ns = 0;
+    seq        = 1;
+    while (seq <= run->bundles)
+    {
+        for (count = 0; count < CACHE_BENCH_BATCH && seq <= run->bundles; ++count)
+        {
+            seq += cache_bench_build_dacs(run, seq, run->bundles + 1, &batch[count]);
+            if (batch[count] == NULL)
+            {
+                UtAssert_Failed("Could not make a DACS for %lu", (unsigned long)seq);
+                break;
+            }
+        }
+
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_route_push_egress_bundle(run->rtbl, run->storage_intf_id, batch[i]) != 0)
+            {
+                bplib_mpool_recycle_block(batch[i]);
+            }
+        }
+        bplib_route_periodic_maintenance(run->rtbl);
+        elapsed_ns += bench_get_time_ns() - start_time;
+
+        if (count < CACHE_BENCH_BATCH && seq <= run->bundles)
+        {
+            return false;
+        }
+    }
+
+    /* every entry is done with once it goes to the delete state */
+    start_time = bench_get_time_ns();
+    done       = cache_bench_wait_stat(run, bplib_cache_confkey_stat_entries_delete, run->bundles);
+    elapsed_ns += bench_get_time_ns() - start_time;
+
+    if (!UtAssert_BOOL_TRUE(done))
+    {
+        return false;
+    }
+
+    cache_bench_report_rate(run, "dacs", run->bundles, elapsed_ns);
+    return true;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void cache_bench_setup(void)
+{
+    uint32_t seed;
+    uint32_t i;
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+
+    strncpy(cache_bench_config.modules, bench_getenv("CACHE_BENCH_OFFLOAD", "file"),
+            sizeof(cache_bench_config.modules) - 1);
+    strncpy(cache_bench_config.dir, bench_getenv("CACHE_BENCH_DIR", "cache_bench"),
+            sizeof(cache_bench_config.dir) - 1);
+
+    cache_bench_config.num_bundles =
+        bench_parse_list(bench_getenv("CACHE_BENCH_BUNDLES", "1000,10000,100000"), cache_bench_config.bundles,
+                         CACHE_BENCH_MAX_VALUES, 1, CACHE_BENCH_MAX_BUNDLES);
+    UtAssert_True(cache_bench_config.num_bundles > 0, "numbers of bundles given");
+
+    cache_bench_config.payload_size = bench_getenv_num("CACHE_BENCH_SIZE", 256);
+    cache_bench_config.polls        = bench_getenv_num("CACHE_BENCH_POLLS", 1000);
+    cache_bench_config.range        = bench_getenv_num("CACHE_BENCH_RANGE", 64);
+    if (cache_bench_config.payload_size > CACHE_BENCH_MAX_PAYLOAD)
+    {
+        cache_bench_config.payload_size = CACHE_BENCH_MAX_PAYLOAD;
+    }
+    if (cache_bench_config.range < 1)
+    {
+        cache_bench_config.range = 1;
+    }
+
+    seed = 0x2545F491;
+    for (i = 0; i < sizeof(cache_bench_payload); ++i)
+    {
+        seed                   = (seed * 1103515245) + 12345;
+        cache_bench_payload[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+void cache_bench_teardown(void)
+{
+    nftw(cache_bench_config.dir, cache_bench_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void cache_bench_run(void)
+{
+    cache_bench_run_t run;
+    uint32_t          m;
+    uint32_t          n;
+
+    if (mkdir(cache_bench_config.dir, 0700) != 0 && errno != EEXIST)
+    {
+        UtAssert_Failed("mkdir(%s): %s", cache_bench_config.dir, strerror(errno));
+        return;
+    }
+
+    for (m = 0; m < CACHE_BENCH_NUM_MODULES; ++m)
+    {
+        /* the cache without offload is always run, as what the modules are compared with */
+        if (m != 0 && strstr(cache_bench_config.modules, CACHE_BENCH_MODULES[m].name) == NULL)
+        {
+            continue;
+        }
+
+        for (n = 0; n < cache_bench_config.num_bundles; ++n)
+        {
+            memset(&run, 0, sizeof(run));
+            run.module  = &CACHE_BENCH_MODULES[m];
+            run.bundles = cache_bench_config.bundles[n];
+
+            if (cache_bench_setup_run(&run) && cache_bench_store(&run))
+            {
+                cache_bench_poll(&run, "poll/stored");
+                if (cache_bench_contact(&run))
+                {
+                    cache_bench_poll(&run, "poll/sent");
+                    cache_bench_dacs(&run);
+                }
+            }
+
+            cache_bench_teardown_run(&run);
+        }
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(cache_bench_run, cache_bench_setup, cache_bench_teardown, "cache");
+}
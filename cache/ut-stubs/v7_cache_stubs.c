@@ -44,6 +44,24 @@ bp_handle_t bplib_cache_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *servi
     return UT_GenStub_GetReturnValue(bplib_cache_attach, bp_handle_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cache_attach_sharded()
+ * ----------------------------------------------------
+ */
+bp_handle_t bplib_cache_attach_sharded(bplib_routetbl_t *tbl, const bp_ipn_addr_t *service_addr, uint32_t num_shards)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cache_attach_sharded, bp_handle_t);
+
+    UT_GenStub_AddParam(bplib_cache_attach_sharded, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_cache_attach_sharded, const bp_ipn_addr_t *, service_addr);
+    UT_GenStub_AddParam(bplib_cache_attach_sharded, uint32_t, num_shards);
+
+    UT_GenStub_Execute(bplib_cache_attach_sharded, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cache_attach_sharded, bp_handle_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_cache_configure()
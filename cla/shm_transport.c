@@ -0,0 +1,1019 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+#include "bplib_shm_transport.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define BPLIB_SHM_MAGIC   0x62707368 /* "bpsh" */
+#define BPLIB_SHM_VERSION 1
+
+/* the indices of a ring are each on their own cache line, so the two sides do not share one */
+#define BPLIB_SHM_CACHE_LINE 64
+
+#define BPLIB_SHM_DEFAULT_SLOTS       256
+#define BPLIB_SHM_DEFAULT_MAX_PAYLOAD 4096
+#define BPLIB_SHM_MAX_SLOTS           65536
+
+/* the most entries passed to the library in one call */
+#define BPLIB_SHM_BATCH 32
+
+/* the thread waits this long at a time, so it sees a destroy in good time */
+#define BPLIB_SHM_WAIT_MSEC 250
+
+/* kinds of ring entry */
+#define BPLIB_SHM_ENTRY_ADU    1
+#define BPLIB_SHM_ENTRY_BUNDLE 2
+#define BPLIB_SHM_ENTRY_DONE   3 /* already passed on, by a batch that stopped short of it */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef struct bplib_shm_index
+{
+    uint32_t value;
+    uint8_t  pad[BPLIB_SHM_CACHE_LINE - sizeof(uint32_t)];
+} bplib_shm_index_t;
+
+/*
+ * Head is only written by the producer and tail only by the consumer, each a free running
+ * count of entries.  The consumer sets sleeping before it waits on the doorbell, and the
+ * producer only rings the doorbell if it sees that.
+ */
+typedef struct bplib_shm_ring
+{
+    bplib_shm_index_t head;
+    bplib_shm_index_t tail;
+    bplib_shm_index_t sleeping;
+} bplib_shm_ring_t;
+
+/* the start of the file, followed by the entries of the submit ring and then of the delivery ring */
+typedef struct bplib_shm_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t running; /**< cleared when the node side is destroyed */
+    uint8_t  pad[BPLIB_SHM_CACHE_LINE - (5 * sizeof(uint32_t))];
+
+    bplib_shm_ring_t submit;  /**< application to node */
+    bplib_shm_ring_t deliver; /**< node to application */
+} bplib_shm_header_t;
+
+typedef struct bplib_shm_entry
+{
+    uint32_t size;
+    uint32_t kind;
+} bplib_shm_entry_t;
+
+/* what each side has mapped */
+typedef struct bplib_shm_map
+{
+    bplib_shm_header_t *hdr;
+    size_t              map_size;
+    size_t              max_payload_size;
+    uint32_t            mask;
+    uint8_t            *submit_slots;
+    uint8_t            *deliver_slots;
+    int                 submit_bell;  /**< rung by the application, waited on by the node */
+    int                 deliver_bell; /**< rung by the node, waited on by the application */
+} bplib_shm_map_t;
+
+struct bplib_shm_transport
+{
+    bplib_shm_map_t map;
+    char           *path;
+
+    bplib_routetbl_t *rtbl;
+    bp_socket_t      *desc;
+    bp_handle_t       intf_id;
+    int               notify_fd; /**< from bplib_socket_get_notify_fd(), owned by the socket */
+    uint32_t          flags;
+
+    /*
+     * Set when the pool did not take the next entry, or the delivery ring is full.  Until that
+     * changes the thread only waits a ms at a time, so it neither spins nor sleeps too long.
+     */
+    bool submit_held;
+    bool deliver_full;
+
+    bplib_send_buf_t       adus[BPLIB_SHM_BATCH];
+    bplib_cla_bundle_buf_t bundles[BPLIB_SHM_BATCH];
+    bplib_recv_buf_t       rx[BPLIB_SHM_BATCH];
+    int                    status_list[BPLIB_SHM_BATCH];
+
+    volatile bool      running;
+    bplib_os_thread_t *thread;
+};
+
+struct bplib_shm_client
+{
+    bplib_shm_map_t map;
+};
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_entry_at - gets entry idx of a ring, idx being the free running count
+ *-------------------------------------------------------------------------------------*/
+static inline bplib_shm_entry_t *bplib_shm_entry_at(const bplib_shm_map_t *map, uint8_t *slots, uint32_t idx)
+{
+    return (bplib_shm_entry_t *)(void *)(slots + ((size_t)(idx & map->mask) * map->hdr->slot_size));
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_knock - wakes whoever is waiting on a doorbell
+ *-------------------------------------------------------------------------------------*/
+static void bplib_shm_knock(int bell)
+{
+    static const uint8_t TOKEN = 1;
+
+    /* if the FIFO is full the consumer has plenty to wake it already */
+    if (write(bell, &TOKEN, sizeof(TOKEN)) < 0)
+    {
+        return;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_ring_bell - called by the producer after moving the head
+ *-------------------------------------------------------------------------------------*/
+static void bplib_shm_ring_bell(bplib_shm_ring_t *ring, int bell)
+{
+    /* pairs with the fence in bplib_shm_prepare_sleep(), so one side or the other sees the change */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->sleeping.value, __ATOMIC_RELAXED) != 0)
+    {
+        bplib_shm_knock(bell);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_prepare_sleep - called by the consumer, returns true if the ring is still empty
+ *
+ * Once this has returned true the doorbell will be rung for the next entry, so the
+ * consumer can wait on it.  bplib_shm_end_sleep() has to be called after either way.
+ *-------------------------------------------------------------------------------------*/
+static bool bplib_shm_prepare_sleep(bplib_shm_ring_t *ring, uint32_t tail)
+{
+    __atomic_store_n(&ring->sleeping.value, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return (__atomic_load_n(&ring->head.value, __ATOMIC_ACQUIRE) == tail);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_end_sleep - called by the consumer once it has something to do again
+ *-------------------------------------------------------------------------------------*/
+static void bplib_shm_end_sleep(bplib_shm_ring_t *ring, int bell)
+{
+    uint8_t buf[64];
+
+    if (__atomic_load_n(&ring->sleeping.value, __ATOMIC_RELAXED) == 0)
+    {
+        return;
+    }
+
+    __atomic_store_n(&ring->sleeping.value, 0, __ATOMIC_RELAXED);
+    while (read(bell, buf, sizeof(buf)) > 0)
+    {
+        /* the rings left over */
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_bell_path - the path of a doorbell FIFO, next to the ring file
+ *-------------------------------------------------------------------------------------*/
+static int bplib_shm_bell_path(char *buf, size_t size, const char *path, const char *suffix)
+{
+    int len;
+
+    len = snprintf(buf, size, "%s%s", path, suffix);
+    if (len < 0 || (size_t)len >= size)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_map_close - undoes bplib_shm_map_open(), or as much of it as was done
+ *-------------------------------------------------------------------------------------*/
+static void bplib_shm_map_close(bplib_shm_map_t *map)
+{
+    if (map->hdr != NULL)
+    {
+        munmap(map->hdr, map->map_size);
+        map->hdr = NULL;
+    }
+    if (map->submit_bell >= 0)
+    {
+        close(map->submit_bell);
+        map->submit_bell = -1;
+    }
+    if (map->deliver_bell >= 0)
+    {
+        close(map->deliver_bell);
+        map->deliver_bell = -1;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_map_open - maps the ring file and opens the doorbells
+ *
+ * The node passes a nonzero size, which makes the file that size.  The application
+ * passes 0 and gets the size the file already has.
+ *-------------------------------------------------------------------------------------*/
+static int bplib_shm_map_open(bplib_shm_map_t *map, const char *path, size_t size)
+{
+    char        bell[PATH_MAX];
+    struct stat st;
+    int         fd;
+
+    map->hdr          = NULL;
+    map->submit_bell  = -1;
+    map->deliver_bell = -1;
+
+    if (size != 0)
+    {
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0660);
+        if (fd >= 0 && ftruncate(fd, size) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    else
+    {
+        fd = open(path, O_RDWR);
+        if (fd >= 0 && fstat(fd, &st) == 0)
+        {
+            size = st.st_size;
+        }
+    }
+
+    if (fd < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to open %s: %s\n", path, strerror(errno));
+        return BP_ERROR;
+    }
+
+    if (size >= sizeof(bplib_shm_header_t))
+    {
+        map->hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map->hdr == MAP_FAILED)
+        {
+            map->hdr = NULL;
+        }
+    }
+    close(fd);
+
+    if (map->hdr == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to map %s\n", path);
+        return BP_ERROR;
+    }
+    map->map_size = size;
+
+    /* opened for writing as well, so this never waits for the other side to open them */
+    if (bplib_shm_bell_path(bell, sizeof(bell), path, ".sq") == BP_SUCCESS)
+    {
+        map->submit_bell = open(bell, O_RDWR | O_NONBLOCK);
+    }
+    if (bplib_shm_bell_path(bell, sizeof(bell), path, ".dq") == BP_SUCCESS)
+    {
+        map->deliver_bell = open(bell, O_RDWR | O_NONBLOCK);
+    }
+    if (map->submit_bell < 0 || map->deliver_bell < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to open the doorbells of %s\n", path);
+        bplib_shm_map_close(map);
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_map_setup - finds the entries, once the header is filled in
+ *-------------------------------------------------------------------------------------*/
+static void bplib_shm_map_setup(bplib_shm_map_t *map)
+{
+    map->mask             = map->hdr->slot_count - 1;
+    map->max_payload_size = map->hdr->slot_size - sizeof(bplib_shm_entry_t);
+    map->submit_slots     = (uint8_t *)(map->hdr + 1);
+    map->deliver_slots    = map->submit_slots + ((size_t)map->hdr->slot_count * map->hdr->slot_size);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_transport_submit - passes on the entries from the application, in batches
+ *
+ * Returns true if any were taken out of the ring
+ *-------------------------------------------------------------------------------------*/
+static bool bplib_shm_transport_submit(bplib_shm_transport_t *shm)
+{
+    bplib_shm_ring_t  *ring;
+    bplib_shm_entry_t *entry;
+    uint32_t           head;
+    uint32_t           tail;
+    uint32_t           kind;
+    uint32_t           count;
+    uint32_t           taken;
+    uint32_t           i;
+    bool               stalled;
+    bool               progress;
+
+    ring     = &shm->map.hdr->submit;
+    tail     = ring->tail.value;
+    head     = __atomic_load_n(&ring->head.value, __ATOMIC_ACQUIRE);
+    progress = false;
+    stalled  = false;
+
+    while (tail != head && !stalled)
+    {
+        entry = bplib_shm_entry_at(&shm->map, shm->map.submit_slots, tail);
+        kind  = entry->kind;
+        if ((kind != BPLIB_SHM_ENTRY_ADU && kind != BPLIB_SHM_ENTRY_BUNDLE) || entry->size > shm->map.max_payload_size)
+        {
+            /* a DONE entry, or one the application should not have put there */
+            ++tail;
+            progress = true;
+            continue;
+        }
+
+        /* a run of the same kind goes in one call */
+        count = 0;
+        while ((tail + count) != head && count < BPLIB_SHM_BATCH)
+        {
+            entry = bplib_shm_entry_at(&shm->map, shm->map.submit_slots, tail + count);
+            if (entry->kind != kind || entry->size > shm->map.max_payload_size)
+            {
+                break;
+            }
+
+            shm->adus[count].payload   = entry + 1;
+            shm->adus[count].size      = entry->size;
+            shm->bundles[count].bundle = entry + 1;
+            shm->bundles[count].size   = entry->size;
+            ++count;
+        }
+
+        if (kind == BPLIB_SHM_ENTRY_ADU)
+        {
+            bplib_send_many(shm->desc, shm->adus, count, shm->status_list, 0);
+        }
+        else
+        {
+            bplib_cla_ingress_batch(shm->rtbl, shm->intf_id, shm->bundles, count, shm->status_list, 0);
+        }
+
+        /*
+         * Those that could not be taken now stay in the ring for next time, and any after them
+         * that were taken anyway are marked so they are not passed on twice.  Any other error
+         * means the entry is dropped, the library has already said why.
+         */
+        taken = 0;
+        for (i = 0; i < count; ++i)
+        {
+            if (shm->status_list[i] == BP_TIMEOUT)
+            {
+                stalled = true;
+            }
+            else if (stalled)
+            {
+                bplib_shm_entry_at(&shm->map, shm->map.submit_slots, tail + i)->kind = BPLIB_SHM_ENTRY_DONE;
+            }
+            else
+            {
+                ++taken;
+            }
+        }
+
+        tail += taken;
+        if (taken != 0)
+        {
+            progress = true;
+        }
+    }
+
+    __atomic_store_n(&ring->tail.value, tail, __ATOMIC_RELEASE);
+    shm->submit_held = stalled;
+
+    return progress;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_transport_deliver - receives ADUs straight into the free entries of the delivery ring
+ *
+ * Returns true if any were put in the ring
+ *-------------------------------------------------------------------------------------*/
+static bool bplib_shm_transport_deliver(bplib_shm_transport_t *shm)
+{
+    bplib_shm_ring_t  *ring;
+    bplib_shm_entry_t *entry;
+    uint32_t           head;
+    uint32_t           count;
+    uint32_t           num_filled;
+    uint32_t           i;
+
+    ring  = &shm->map.hdr->deliver;
+    head  = ring->head.value;
+    count = shm->map.hdr->slot_count - (head - __atomic_load_n(&ring->tail.value, __ATOMIC_ACQUIRE));
+
+    shm->deliver_full = (count == 0);
+    if (count == 0)
+    {
+        return false;
+    }
+    if (count > BPLIB_SHM_BATCH)
+    {
+        count = BPLIB_SHM_BATCH;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        entry              = bplib_shm_entry_at(&shm->map, shm->map.deliver_slots, head + i);
+        shm->rx[i].payload = entry + 1;
+        shm->rx[i].size    = shm->map.max_payload_size;
+    }
+
+    num_filled = 0;
+    if (bplib_recv_many(shm->desc, shm->rx, count, &num_filled, 0) != BP_SUCCESS || num_filled == 0)
+    {
+        return false;
+    }
+
+    for (i = 0; i < num_filled; ++i)
+    {
+        entry       = bplib_shm_entry_at(&shm->map, shm->map.deliver_slots, head + i);
+        entry->size = shm->rx[i].size;
+        entry->kind = BPLIB_SHM_ENTRY_ADU;
+    }
+
+    __atomic_store_n(&ring->head.value, head + num_filled, __ATOMIC_RELEASE);
+    bplib_shm_ring_bell(ring, shm->map.deliver_bell);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_transport_entry - the thread of a transport
+ *-------------------------------------------------------------------------------------*/
+static void bplib_shm_transport_entry(void *arg)
+{
+    bplib_shm_transport_t *shm = arg;
+
+    while (shm->running)
+    {
+        bplib_shm_transport_process(shm, BPLIB_SHM_WAIT_MSEC);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_transport_process
+ *----------------------------------------------------------------------------*/
+int bplib_shm_transport_process(bplib_shm_transport_t *shm, uint32_t timeout)
+{
+    struct pollfd pfd[2];
+    bool          progress;
+
+    progress = bplib_shm_transport_submit(shm);
+    progress = bplib_shm_transport_deliver(shm) || progress;
+    if (progress)
+    {
+        return BP_SUCCESS;
+    }
+
+    if ((shm->submit_held || shm->deliver_full || shm->notify_fd < 0) && timeout > 1)
+    {
+        timeout = 1;
+    }
+
+    pfd[0].fd      = -1;
+    pfd[0].events  = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd      = -1;
+    pfd[1].events  = POLLIN;
+    pfd[1].revents = 0;
+    if (!shm->submit_held)
+    {
+        if (bplib_shm_prepare_sleep(&shm->map.hdr->submit, shm->map.hdr->submit.tail.value))
+        {
+            pfd[0].fd = shm->map.submit_bell;
+        }
+        else
+        {
+            /* something came in just now */
+            timeout = 0;
+        }
+    }
+    if (!shm->deliver_full)
+    {
+        pfd[1].fd = shm->notify_fd;
+    }
+
+    if (timeout > 0)
+    {
+        poll(pfd, 2, timeout);
+    }
+    bplib_shm_end_sleep(&shm->map.hdr->submit, shm->map.submit_bell);
+
+    progress = bplib_shm_transport_submit(shm);
+    progress = bplib_shm_transport_deliver(shm) || progress;
+    if (!progress)
+    {
+        return BP_TIMEOUT;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_transport_destroy
+ *----------------------------------------------------------------------------*/
+void bplib_shm_transport_destroy(bplib_shm_transport_t *shm)
+{
+    char bell[PATH_MAX];
+
+    if (shm == NULL)
+    {
+        return;
+    }
+
+    shm->running = false;
+    if (shm->thread != NULL)
+    {
+        bplib_os_thread_join(shm->thread);
+    }
+
+    if (shm->map.hdr != NULL)
+    {
+        /* an application waiting for a delivery is woken to find out */
+        __atomic_store_n(&shm->map.hdr->running, 0, __ATOMIC_SEQ_CST);
+        bplib_shm_knock(shm->map.deliver_bell);
+    }
+    bplib_shm_map_close(&shm->map);
+
+    if (shm->desc != NULL)
+    {
+        bplib_close_socket(shm->desc);
+    }
+    if (bp_handle_is_valid(shm->intf_id))
+    {
+        bplib_route_del_intf(shm->rtbl, shm->intf_id);
+    }
+
+    if (shm->path != NULL)
+    {
+        unlink(shm->path);
+        if (bplib_shm_bell_path(bell, sizeof(bell), shm->path, ".sq") == BP_SUCCESS)
+        {
+            unlink(bell);
+        }
+        if (bplib_shm_bell_path(bell, sizeof(bell), shm->path, ".dq") == BP_SUCCESS)
+        {
+            unlink(bell);
+        }
+        bplib_os_free(shm->path);
+    }
+
+    bplib_os_free(shm);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_transport_create
+ *----------------------------------------------------------------------------*/
+bplib_shm_transport_t *bplib_shm_transport_create(bplib_routetbl_t *rtbl, const bplib_shm_transport_config_t *config)
+{
+    bplib_shm_transport_t *shm;
+    bplib_shm_header_t    *hdr;
+    char                   bell[PATH_MAX];
+    uint32_t               slot_count;
+    size_t                 max_payload_size;
+    size_t                 slot_size;
+    size_t                 path_len;
+
+    slot_count = config->slot_count;
+    if (slot_count == 0)
+    {
+        slot_count = BPLIB_SHM_DEFAULT_SLOTS;
+    }
+
+    max_payload_size = config->max_payload_size;
+    if (max_payload_size == 0)
+    {
+        max_payload_size = BPLIB_SHM_DEFAULT_MAX_PAYLOAD;
+    }
+
+    if (config->path == NULL || slot_count > BPLIB_SHM_MAX_SLOTS || (slot_count & (slot_count - 1)) != 0 ||
+        max_payload_size > UINT32_MAX / 2)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Invalid shared memory transport config\n");
+        return NULL;
+    }
+
+    /* a whole number of cache lines per entry, so neighbouring entries do not share one either */
+    slot_size = sizeof(bplib_shm_entry_t) + max_payload_size;
+    slot_size = (slot_size + BPLIB_SHM_CACHE_LINE - 1) & ~(size_t)(BPLIB_SHM_CACHE_LINE - 1);
+
+    shm = bplib_os_calloc(sizeof(*shm));
+    if (shm == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate shared memory transport\n");
+        return NULL;
+    }
+
+    shm->rtbl      = rtbl;
+    shm->flags     = config->flags;
+    shm->intf_id   = BP_INVALID_HANDLE;
+    shm->notify_fd = -1;
+
+    path_len  = strlen(config->path);
+    shm->path = bplib_os_calloc(path_len + 1);
+    if (shm->path == NULL)
+    {
+        bplib_os_free(shm);
+        return NULL;
+    }
+    memcpy(shm->path, config->path, path_len);
+
+    /* whatever an earlier node left behind is replaced, including any application still using it */
+    if (bplib_shm_bell_path(bell, sizeof(bell), shm->path, ".sq") != BP_SUCCESS ||
+        (unlink(bell) < 0 && errno != ENOENT) || mkfifo(bell, 0660) < 0 ||
+        bplib_shm_bell_path(bell, sizeof(bell), shm->path, ".dq") != BP_SUCCESS ||
+        (unlink(bell) < 0 && errno != ENOENT) || mkfifo(bell, 0660) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to make the doorbells of %s\n", shm->path);
+        bplib_shm_transport_destroy(shm);
+        return NULL;
+    }
+
+    unlink(shm->path);
+    if (bplib_shm_map_open(&shm->map, shm->path, sizeof(*hdr) + (2 * (size_t)slot_count * slot_size)) != BP_SUCCESS)
+    {
+        bplib_shm_transport_destroy(shm);
+        return NULL;
+    }
+
+    hdr             = shm->map.hdr;
+    hdr->version    = BPLIB_SHM_VERSION;
+    hdr->slot_count = slot_count;
+    hdr->slot_size  = slot_size;
+    hdr->running    = 1;
+    bplib_shm_map_setup(&shm->map);
+
+    shm->desc = bplib_create_socket(rtbl);
+    if (shm->desc == NULL || bplib_bind_socket(shm->desc, &config->local_addr) != BP_SUCCESS ||
+        bplib_connect_socket(shm->desc, &config->remote_addr) != BP_SUCCESS ||
+        bplib_socket_set_nonblocking(shm->desc, true) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to set up the socket of %s\n", shm->path);
+        bplib_shm_transport_destroy(shm);
+        return NULL;
+    }
+
+    /* without it the socket is checked every ms instead */
+    shm->notify_fd = bplib_socket_get_notify_fd(shm->desc);
+
+    shm->intf_id = bplib_create_cla_intf(rtbl);
+    if (!bp_handle_is_valid(shm->intf_id))
+    {
+        bplib_shm_transport_destroy(shm);
+        return NULL;
+    }
+    bplib_route_intf_set_flags(rtbl, shm->intf_id, BPLIB_INTF_STATE_ADMIN_UP);
+
+    /* the application does not use the rings until it sees this */
+    __atomic_store_n(&hdr->magic, BPLIB_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    shm->running = true;
+    if ((shm->flags & BPLIB_SHM_TRANSPORT_NO_THREAD) == 0)
+    {
+        shm->thread = bplib_os_thread_create("bp-shm", bplib_shm_transport_entry, shm);
+        if (shm->thread == NULL)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to start the thread of %s\n", shm->path);
+            shm->running = false;
+            bplib_shm_transport_destroy(shm);
+            return NULL;
+        }
+    }
+
+    return shm;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_transport_get_intf
+ *----------------------------------------------------------------------------*/
+bp_handle_t bplib_shm_transport_get_intf(const bplib_shm_transport_t *shm)
+{
+    return shm->intf_id;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_open
+ *----------------------------------------------------------------------------*/
+bplib_shm_client_t *bplib_shm_client_open(const char *path)
+{
+    bplib_shm_client_t *client;
+    bplib_shm_header_t *hdr;
+
+    client = bplib_os_calloc(sizeof(*client));
+    if (client == NULL)
+    {
+        return NULL;
+    }
+
+    if (bplib_shm_map_open(&client->map, path, 0) != BP_SUCCESS)
+    {
+        bplib_os_free(client);
+        return NULL;
+    }
+
+    hdr = client->map.hdr;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != BPLIB_SHM_MAGIC || hdr->version != BPLIB_SHM_VERSION ||
+        hdr->slot_count == 0 || (hdr->slot_count & (hdr->slot_count - 1)) != 0 ||
+        hdr->slot_size <= sizeof(bplib_shm_entry_t) ||
+        client->map.map_size < sizeof(*hdr) + (2 * (size_t)hdr->slot_count * hdr->slot_size))
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s does not hold the rings of a running node\n", path);
+        bplib_shm_map_close(&client->map);
+        bplib_os_free(client);
+        return NULL;
+    }
+
+    bplib_shm_map_setup(&client->map);
+
+    return client;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_close
+ *----------------------------------------------------------------------------*/
+void bplib_shm_client_close(bplib_shm_client_t *client)
+{
+    if (client == NULL)
+    {
+        return;
+    }
+
+    bplib_shm_map_close(&client->map);
+    bplib_os_free(client);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_reserve
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_reserve(bplib_shm_client_t *client, void **buffer, size_t *size, uint32_t timeout)
+{
+    bplib_shm_ring_t *ring;
+    uint32_t          head;
+
+    ring = &client->map.hdr->submit;
+    head = ring->head.value;
+
+    /* the node does not ring a doorbell for room, as it is rarely full, so this checks each ms */
+    while ((head - __atomic_load_n(&ring->tail.value, __ATOMIC_ACQUIRE)) >= client->map.hdr->slot_count)
+    {
+        if (__atomic_load_n(&client->map.hdr->running, __ATOMIC_ACQUIRE) == 0)
+        {
+            return BP_ERROR;
+        }
+        if (timeout == 0)
+        {
+            return BP_TIMEOUT;
+        }
+        poll(NULL, 0, 1);
+        --timeout;
+    }
+
+    if (__atomic_load_n(&client->map.hdr->running, __ATOMIC_ACQUIRE) == 0)
+    {
+        return BP_ERROR;
+    }
+
+    *buffer = bplib_shm_entry_at(&client->map, client->map.submit_slots, head) + 1;
+    *size   = client->map.max_payload_size;
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_commit
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_commit(bplib_shm_client_t *client, size_t size, bool is_bundle)
+{
+    bplib_shm_ring_t  *ring;
+    bplib_shm_entry_t *entry;
+    uint32_t           head;
+
+    if (size > client->map.max_payload_size)
+    {
+        return BP_ERROR;
+    }
+
+    ring  = &client->map.hdr->submit;
+    head  = ring->head.value;
+    entry = bplib_shm_entry_at(&client->map, client->map.submit_slots, head);
+
+    entry->size = size;
+    if (is_bundle)
+    {
+        entry->kind = BPLIB_SHM_ENTRY_BUNDLE;
+    }
+    else
+    {
+        entry->kind = BPLIB_SHM_ENTRY_ADU;
+    }
+
+    __atomic_store_n(&ring->head.value, head + 1, __ATOMIC_RELEASE);
+    bplib_shm_ring_bell(ring, client->map.submit_bell);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_shm_client_copy_in - the common part of sending an ADU and a bundle
+ *-------------------------------------------------------------------------------------*/
+static int bplib_shm_client_copy_in(bplib_shm_client_t *client, const void *data, size_t size, bool is_bundle,
+                                    uint32_t timeout)
+{
+    void  *buffer;
+    size_t buffer_size;
+    int    status;
+
+    if (size > client->map.max_payload_size)
+    {
+        return BP_ERROR;
+    }
+
+    status = bplib_shm_client_reserve(client, &buffer, &buffer_size, timeout);
+    if (status != BP_SUCCESS)
+    {
+        return status;
+    }
+
+    memcpy(buffer, data, size);
+
+    return bplib_shm_client_commit(client, size, is_bundle);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_send
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_send(bplib_shm_client_t *client, const void *payload, size_t size, uint32_t timeout)
+{
+    return bplib_shm_client_copy_in(client, payload, size, false, timeout);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_send_bundle
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_send_bundle(bplib_shm_client_t *client, const void *bundle, size_t size, uint32_t timeout)
+{
+    return bplib_shm_client_copy_in(client, bundle, size, true, timeout);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_recv_view
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_recv_view(bplib_shm_client_t *client, const void **payload, size_t *size, uint32_t timeout)
+{
+    bplib_shm_ring_t  *ring;
+    bplib_shm_entry_t *entry;
+    struct pollfd      pfd;
+    uint32_t           tail;
+
+    ring = &client->map.hdr->deliver;
+    tail = ring->tail.value;
+
+    if (__atomic_load_n(&ring->head.value, __ATOMIC_ACQUIRE) == tail)
+    {
+        if (__atomic_load_n(&client->map.hdr->running, __ATOMIC_ACQUIRE) == 0)
+        {
+            return BP_ERROR;
+        }
+
+        /* with a timeout of 0 the doorbell is left armed, for bplib_shm_client_get_fd() */
+        if (bplib_shm_prepare_sleep(ring, tail))
+        {
+            if (timeout == 0)
+            {
+                return BP_TIMEOUT;
+            }
+
+            pfd.fd      = client->map.deliver_bell;
+            pfd.events  = POLLIN;
+            pfd.revents = 0;
+            poll(&pfd, 1, timeout);
+        }
+
+        bplib_shm_end_sleep(ring, client->map.deliver_bell);
+        if (__atomic_load_n(&ring->head.value, __ATOMIC_ACQUIRE) == tail)
+        {
+            if (__atomic_load_n(&client->map.hdr->running, __ATOMIC_ACQUIRE) == 0)
+            {
+                return BP_ERROR;
+            }
+            return BP_TIMEOUT;
+        }
+    }
+    else
+    {
+        bplib_shm_end_sleep(ring, client->map.deliver_bell);
+    }
+
+    entry    = bplib_shm_entry_at(&client->map, client->map.deliver_slots, tail);
+    *payload = entry + 1;
+    *size    = entry->size;
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_recv_release
+ *----------------------------------------------------------------------------*/
+void bplib_shm_client_recv_release(bplib_shm_client_t *client)
+{
+    bplib_shm_ring_t *ring;
+
+    ring = &client->map.hdr->deliver;
+    if (__atomic_load_n(&ring->head.value, __ATOMIC_ACQUIRE) != ring->tail.value)
+    {
+        __atomic_store_n(&ring->tail.value, ring->tail.value + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_recv
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_recv(bplib_shm_client_t *client, void *payload, size_t *size, uint32_t timeout)
+{
+    const void *data;
+    size_t      data_size;
+    int         status;
+
+    status = bplib_shm_client_recv_view(client, &data, &data_size, timeout);
+    if (status != BP_SUCCESS)
+    {
+        return status;
+    }
+
+    if (data_size <= *size)
+    {
+        memcpy(payload, data, data_size);
+        *size = data_size;
+    }
+    else
+    {
+        status = BP_ERROR;
+    }
+
+    bplib_shm_client_recv_release(client);
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_shm_client_get_fd
+ *----------------------------------------------------------------------------*/
+int bplib_shm_client_get_fd(const bplib_shm_client_t *client)
+{
+    return client->map.deliver_bell;
+}
@@ -0,0 +1,280 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "socket_cla_internal.h"
+
+#include <string.h>
+#include <poll.h>
+
+/*--------------------------------------------------------------------------------------
+ * bplib_socket_cla_entry - the I/O thread of a CLA
+ *-------------------------------------------------------------------------------------*/
+static void bplib_socket_cla_entry(void *arg)
+{
+    bplib_socket_cla_t *cla = arg;
+
+    while (cla->running)
+    {
+        cla->ops->process(cla, BPLIB_SOCKET_CLA_WAIT_MSEC);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_socket_cla_alloc - the part of creating a CLA that is the same for each transport
+ *
+ * This creates the interface, but the transport still has to open its socket and set
+ * up its buffers before calling bplib_socket_cla_start().
+ *-------------------------------------------------------------------------------------*/
+bplib_socket_cla_t *bplib_socket_cla_alloc(bplib_routetbl_t *rtbl, const bplib_socket_cla_config_t *config,
+                                           const bplib_socket_cla_ops_t *ops, const char *name)
+{
+    bplib_socket_cla_t *cla;
+
+    if (config->local_addr_len > sizeof(cla->local_addr) || config->remote_addr_len > sizeof(cla->remote_addr) ||
+        (config->local_addr == NULL && config->remote_addr == NULL))
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Invalid socket CLA addresses\n");
+        return NULL;
+    }
+
+    cla = bplib_os_calloc(sizeof(*cla));
+    if (cla == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate socket CLA\n");
+        return NULL;
+    }
+
+    cla->ops       = ops;
+    cla->name      = name;
+    cla->rtbl      = rtbl;
+    cla->sys_fd    = -1;
+    cla->listen_fd = -1;
+    cla->flags     = config->flags;
+
+    if (config->local_addr != NULL)
+    {
+        memcpy(&cla->local_addr, config->local_addr, config->local_addr_len);
+        cla->local_addr_len = config->local_addr_len;
+    }
+    if (config->remote_addr != NULL)
+    {
+        memcpy(&cla->remote_addr, config->remote_addr, config->remote_addr_len);
+        cla->remote_addr_len = config->remote_addr_len;
+    }
+
+    cla->batch_size = config->batch_size;
+    if (cla->batch_size == 0)
+    {
+        cla->batch_size = BPLIB_SOCKET_CLA_DEFAULT_BATCH;
+    }
+    else if (cla->batch_size > BPLIB_SOCKET_CLA_MAX_BATCH)
+    {
+        cla->batch_size = BPLIB_SOCKET_CLA_MAX_BATCH;
+    }
+
+    cla->max_bundle_size = config->max_bundle_size;
+    if (cla->max_bundle_size == 0)
+    {
+        cla->max_bundle_size = BPLIB_SOCKET_CLA_DEFAULT_MAX_BUNDLE;
+    }
+
+    cla->intf_id = bplib_create_cla_intf_ext(rtbl, config->intf_flags);
+    if (!bp_handle_is_valid(cla->intf_id))
+    {
+        bplib_os_free(cla);
+        return NULL;
+    }
+
+    /* without it the egress side is polled at the wait interval instead */
+    cla->notify_fd = bplib_cla_get_notify_fd(rtbl, cla->intf_id);
+
+    bplib_route_intf_set_flags(rtbl, cla->intf_id, BPLIB_INTF_STATE_ADMIN_UP);
+
+    return cla;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_socket_cla_start -
+ *-------------------------------------------------------------------------------------*/
+int bplib_socket_cla_start(bplib_socket_cla_t *cla)
+{
+    cla->running = true;
+
+    if ((cla->flags & BPLIB_SOCKET_CLA_NO_THREAD) == 0)
+    {
+        cla->thread = bplib_os_thread_create(cla->name, bplib_socket_cla_entry, cla);
+        if (cla->thread == NULL)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to start %s thread\n", cla->name);
+            cla->running = false;
+            return BP_ERROR;
+        }
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_socket_cla_wait - waits for the socket, and for bundles to send if egress_ready is not NULL
+ *
+ * Returns BP_SUCCESS if either one is ready, BP_TIMEOUT if neither is
+ *-------------------------------------------------------------------------------------*/
+int bplib_socket_cla_wait(bplib_socket_cla_t *cla, int fd, short events, uint32_t timeout, short *revents,
+                          bool *egress_ready)
+{
+    struct pollfd pfd[2];
+    bool          egress_held;
+
+    /* without the fd, the egress call is tried after every wait, and while held back every ms */
+    egress_held = (egress_ready != NULL && (cla->egress_held || cla->notify_fd < 0));
+    if (egress_ready != NULL && cla->egress_held && timeout > 1)
+    {
+        timeout = 1;
+    }
+
+    pfd[0].fd      = fd;
+    pfd[0].events  = events;
+    pfd[0].revents = 0;
+    pfd[1].fd      = -1;
+    pfd[1].events  = POLLIN;
+    pfd[1].revents = 0;
+    if (egress_ready != NULL && !egress_held)
+    {
+        pfd[1].fd = cla->notify_fd;
+    }
+
+    if (poll(pfd, 2, timeout) < 0)
+    {
+        pfd[0].revents = 0;
+        pfd[1].revents = 0;
+    }
+
+    *revents = pfd[0].revents;
+    if (egress_ready != NULL)
+    {
+        *egress_ready = (egress_held || (pfd[1].revents & POLLIN) != 0);
+    }
+
+    if (pfd[0].revents == 0 && (egress_ready == NULL || !*egress_ready))
+    {
+        return BP_TIMEOUT;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_socket_cla_ingress - passes on the first count bundles in cla->bundles
+ *
+ * Those that do not fit in the ingress queue within the wait time are dropped, unless retry
+ * is set, in which case it keeps trying them in order for as long as the CLA is running.
+ *-------------------------------------------------------------------------------------*/
+void bplib_socket_cla_ingress(bplib_socket_cla_t *cla, uint32_t count, bool retry)
+{
+    uint32_t num_retry;
+    uint32_t i;
+
+    while (count > 0)
+    {
+        bplib_cla_ingress_batch(cla->rtbl, cla->intf_id, cla->bundles, count, cla->status_list,
+                                BPLIB_SOCKET_CLA_WAIT_MSEC);
+        if (!retry || !cla->running)
+        {
+            break;
+        }
+
+        num_retry = 0;
+        for (i = 0; i < count; ++i)
+        {
+            if (cla->status_list[i] == BP_TIMEOUT)
+            {
+                cla->bundles[num_retry] = cla->bundles[i];
+                ++num_retry;
+            }
+        }
+
+        count = num_retry;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_socket_cla_destroy
+ *----------------------------------------------------------------------------*/
+void bplib_socket_cla_destroy(bplib_socket_cla_t *cla)
+{
+    if (cla == NULL)
+    {
+        return;
+    }
+
+    cla->running = false;
+    if (cla->thread != NULL)
+    {
+        bplib_os_thread_join(cla->thread);
+    }
+
+    cla->ops->close(cla);
+    bplib_route_del_intf(cla->rtbl, cla->intf_id);
+
+    bplib_os_free(cla->rx_buffer);
+    bplib_os_free(cla->tx_buffer);
+    bplib_os_free(cla->msgs);
+    bplib_os_free(cla->iov);
+    bplib_os_free(cla->control);
+    bplib_os_free(cla->bundles);
+    bplib_os_free(cla->egress_bufs);
+    bplib_os_free(cla->status_list);
+    bplib_os_free(cla->tx_refs);
+    bplib_os_free(cla->tx_headers);
+    bplib_os_free(cla);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_socket_cla_get_intf
+ *----------------------------------------------------------------------------*/
+bp_handle_t bplib_socket_cla_get_intf(const bplib_socket_cla_t *cla)
+{
+    return cla->intf_id;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_socket_cla_get_fd
+ *----------------------------------------------------------------------------*/
+int bplib_socket_cla_get_fd(const bplib_socket_cla_t *cla)
+{
+    if (cla->sys_fd < 0)
+    {
+        return cla->listen_fd;
+    }
+
+    return cla->sys_fd;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_socket_cla_process
+ *----------------------------------------------------------------------------*/
+int bplib_socket_cla_process(bplib_socket_cla_t *cla, uint32_t timeout)
+{
+    return cla->ops->process(cla, timeout);
+}
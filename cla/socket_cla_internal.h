@@ -0,0 +1,136 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef SOCKET_CLA_INTERNAL_H
+#define SOCKET_CLA_INTERNAL_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+#include "bplib_socket_cla.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* the I/O thread waits this long at a time, so it sees a destroy in good time */
+#define BPLIB_SOCKET_CLA_WAIT_MSEC 250
+
+/* how long before trying a TCP connection again */
+#define BPLIB_SOCKET_CLA_RECONNECT_MSEC 1000
+
+#define BPLIB_SOCKET_CLA_DEFAULT_BATCH      32
+#define BPLIB_SOCKET_CLA_MAX_BATCH          1024 /* the most that sendmmsg() takes */
+#define BPLIB_SOCKET_CLA_DEFAULT_MAX_BUNDLE 65507
+#define BPLIB_SOCKET_CLA_MAX_DATAGRAM       65535
+
+/* the pieces of all the bundles in one writev(), a bundle is only started with at least half left */
+#define BPLIB_SOCKET_CLA_TCP_MAX_IOV 1024
+
+/* the kernel limit on the segments in one UDP GSO send or GRO receive */
+#define BPLIB_SOCKET_CLA_UDP_MAX_SEGMENTS 64
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef struct bplib_socket_cla_ops
+{
+    int (*process)(bplib_socket_cla_t *cla, uint32_t timeout);
+    void (*close)(bplib_socket_cla_t *cla);
+} bplib_socket_cla_ops_t;
+
+struct bplib_socket_cla
+{
+    const bplib_socket_cla_ops_t *ops;
+    const char                   *name;
+
+    bplib_routetbl_t *rtbl;
+    bp_handle_t       intf_id;
+    int               notify_fd; /**< from bplib_cla_get_notify_fd(), owned by the interface */
+
+    int sys_fd;    /**< the UDP socket, or the TCP connection (-1 while there is none) */
+    int listen_fd; /**< TCP only, when waiting for connections rather than making one */
+
+    struct sockaddr_storage local_addr;
+    socklen_t               local_addr_len;
+    struct sockaddr_storage remote_addr;
+    socklen_t               remote_addr_len;
+
+    uint32_t flags;
+    uint32_t batch_size;
+    size_t   max_bundle_size;
+
+    /*
+     * Set when the notify fd was readable but the egress call gave nothing, which is what happens
+     * while an egress rate holds the bundles back.  The fd is then left out of the poll for a short
+     * time so this does not spin.
+     */
+    bool egress_held;
+
+    /* TCP connection state */
+    bool     connected;
+    bool     connecting;
+    uint64_t next_connect_time;
+
+    /* receive buffers: one per datagram for UDP, one stream buffer for TCP */
+    uint8_t *rx_buffer;
+    size_t   rx_buffer_size; /**< per datagram for UDP, the whole buffer for TCP */
+    size_t   rx_fill;        /**< TCP only, bytes in the stream buffer not yet passed on */
+
+    /* transmit buffers: one per datagram for UDP, unused for TCP */
+    uint8_t *tx_buffer;
+
+    /* TCP only, the pool references and length headers of the bundles in one writev() */
+    bplib_mpool_ref_t *tx_refs;
+    uint32_t          *tx_headers;
+
+    /* per batch, sized by the transport */
+    struct mmsghdr         *msgs;
+    struct iovec           *iov;
+    uint8_t                *control;
+    bplib_cla_bundle_buf_t *bundles;
+    bplib_cla_egress_buf_t *egress_bufs;
+    int                    *status_list;
+    uint32_t                max_bundles;
+
+    volatile bool      running;
+    bplib_os_thread_t *thread;
+};
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+bplib_socket_cla_t *bplib_socket_cla_alloc(bplib_routetbl_t *rtbl, const bplib_socket_cla_config_t *config,
+                                           const bplib_socket_cla_ops_t *ops, const char *name);
+int                 bplib_socket_cla_start(bplib_socket_cla_t *cla);
+int  bplib_socket_cla_wait(bplib_socket_cla_t *cla, int fd, short events, uint32_t timeout, short *revents,
+                           bool *egress_ready);
+void bplib_socket_cla_ingress(bplib_socket_cla_t *cla, uint32_t count, bool retry);
+
+#endif /* SOCKET_CLA_INTERNAL_H */
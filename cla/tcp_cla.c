@@ -0,0 +1,471 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+/* accept4() and SOCK_CLOEXEC are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "socket_cla_internal.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/* the length in front of each bundle */
+#define BPLIB_TCP_CLA_HEADER_SIZE 4
+
+static int  bplib_tcp_cla_process(bplib_socket_cla_t *cla, uint32_t timeout);
+static void bplib_tcp_cla_close(bplib_socket_cla_t *cla);
+
+static const bplib_socket_cla_ops_t BPLIB_TCP_CLA_OPS = {.process = bplib_tcp_cla_process,
+                                                         .close   = bplib_tcp_cla_close};
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_connected - the connection is up, so bundles can go to the interface
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_connected(bplib_socket_cla_t *cla)
+{
+    int enable;
+    int fl;
+
+    /* the sends are whole batches already, waiting for more would only add latency */
+    enable = 1;
+    setsockopt(cla->sys_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    /* poll() does the waiting, but a blocking socket keeps writev() simple */
+    fl = fcntl(cla->sys_fd, F_GETFL);
+    if (fl >= 0)
+    {
+        fcntl(cla->sys_fd, F_SETFL, fl & ~O_NONBLOCK);
+    }
+
+    cla->connected  = true;
+    cla->connecting = false;
+    cla->rx_fill    = 0;
+    bplib_route_intf_set_flags(cla->rtbl, cla->intf_id, BPLIB_INTF_STATE_OPER_UP);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_disconnect - drops the connection, a new one is made or accepted later
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_disconnect(bplib_socket_cla_t *cla)
+{
+    if (cla->connected)
+    {
+        bplib_route_intf_unset_flags(cla->rtbl, cla->intf_id, BPLIB_INTF_STATE_OPER_UP);
+    }
+
+    if (cla->sys_fd >= 0)
+    {
+        close(cla->sys_fd);
+        cla->sys_fd = -1;
+    }
+
+    cla->connected         = false;
+    cla->connecting        = false;
+    cla->rx_fill           = 0;
+    cla->next_connect_time = bplib_os_get_dtntime_ms() + BPLIB_SOCKET_CLA_RECONNECT_MSEC;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_connect - starts a connection to the remote address, without blocking
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_connect(bplib_socket_cla_t *cla)
+{
+    cla->sys_fd = socket(cla->remote_addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, IPPROTO_TCP);
+    if (cla->sys_fd < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "socket() failed: %s\n", strerror(errno));
+        bplib_tcp_cla_disconnect(cla);
+        return;
+    }
+
+    if (cla->local_addr_len != 0 &&
+        bind(cla->sys_fd, (const struct sockaddr *)&cla->local_addr, cla->local_addr_len) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "bind() failed: %s\n", strerror(errno));
+        bplib_tcp_cla_disconnect(cla);
+        return;
+    }
+
+    if (connect(cla->sys_fd, (const struct sockaddr *)&cla->remote_addr, cla->remote_addr_len) == 0)
+    {
+        bplib_tcp_cla_connected(cla);
+    }
+    else if (errno == EINPROGRESS)
+    {
+        cla->connecting = true;
+    }
+    else
+    {
+        bplib_tcp_cla_disconnect(cla);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_finish_connect - the socket became writable while connecting
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_finish_connect(bplib_socket_cla_t *cla)
+{
+    socklen_t len;
+    int       err;
+
+    len = sizeof(err);
+    if (getsockopt(cla->sys_fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0)
+    {
+        bplib_tcp_cla_disconnect(cla);
+        return;
+    }
+
+    bplib_tcp_cla_connected(cla);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_accept - takes the next connection at the local address
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_accept(bplib_socket_cla_t *cla)
+{
+    cla->sys_fd = accept4(cla->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (cla->sys_fd >= 0)
+    {
+        bplib_tcp_cla_connected(cla);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_receive - reads what is there and passes on every whole bundle in it
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_receive(bplib_socket_cla_t *cla)
+{
+    uint32_t length;
+    uint32_t count;
+    size_t   pos;
+    ssize_t  status;
+
+    status = recv(cla->sys_fd, &cla->rx_buffer[cla->rx_fill], cla->rx_buffer_size - cla->rx_fill, MSG_DONTWAIT);
+    if (status < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return;
+    }
+    if (status <= 0)
+    {
+        /* closed at the other end, or failed */
+        bplib_tcp_cla_disconnect(cla);
+        return;
+    }
+
+    cla->rx_fill += status;
+
+    pos = 0;
+    while (cla->running)
+    {
+        count = 0;
+        while (count < cla->max_bundles && (cla->rx_fill - pos) >= BPLIB_TCP_CLA_HEADER_SIZE)
+        {
+            memcpy(&length, &cla->rx_buffer[pos], sizeof(length));
+            length = ntohl(length);
+            if (length == 0 || length > cla->max_bundle_size)
+            {
+                bplog(NULL, BP_FLAG_DIAGNOSTIC, "Bad bundle length %lu from TCP peer\n", (unsigned long)length);
+                bplib_socket_cla_ingress(cla, count, true);
+                bplib_tcp_cla_disconnect(cla);
+                return;
+            }
+
+            if ((cla->rx_fill - pos - BPLIB_TCP_CLA_HEADER_SIZE) < length)
+            {
+                break;
+            }
+
+            cla->bundles[count].bundle = &cla->rx_buffer[pos + BPLIB_TCP_CLA_HEADER_SIZE];
+            cla->bundles[count].size   = length;
+            pos += BPLIB_TCP_CLA_HEADER_SIZE + length;
+            ++count;
+        }
+
+        if (count == 0)
+        {
+            break;
+        }
+
+        /* the stream is flow controlled, so rather than drop bundles this holds up the reading */
+        bplib_socket_cla_ingress(cla, count, true);
+    }
+
+    /* keep the start of the next bundle for the next read */
+    if (pos > 0)
+    {
+        cla->rx_fill -= pos;
+        memmove(cla->rx_buffer, &cla->rx_buffer[pos], cla->rx_fill);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_send - writes whatever bundles are ready, in one writev()
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_send(bplib_socket_cla_t *cla)
+{
+    bplib_iovec_t piece_iov[BPLIB_SOCKET_CLA_TCP_MAX_IOV];
+    uint32_t      num_refs;
+    uint32_t      num_iov;
+    uint32_t      piece_count;
+    uint32_t      iov_pos;
+    uint32_t      i;
+    size_t        bundle_size;
+    ssize_t       status;
+
+    num_refs = 0;
+    num_iov  = 0;
+    while (num_refs < cla->batch_size && (BPLIB_SOCKET_CLA_TCP_MAX_IOV - num_iov) >= (BPLIB_SOCKET_CLA_TCP_MAX_IOV / 2))
+    {
+        piece_count = (BPLIB_SOCKET_CLA_TCP_MAX_IOV - num_iov) - 1;
+        if (bplib_cla_egress_iov(cla->rtbl, cla->intf_id, piece_iov, &piece_count, &cla->tx_refs[num_refs], 0) !=
+            BP_SUCCESS)
+        {
+            break;
+        }
+
+        bundle_size = 0;
+        for (i = 0; i < piece_count; ++i)
+        {
+            cla->iov[num_iov + 1 + i].iov_base = (void *)piece_iov[i].base;
+            cla->iov[num_iov + 1 + i].iov_len  = piece_iov[i].len;
+            bundle_size += piece_iov[i].len;
+        }
+
+        cla->tx_headers[num_refs]  = htonl(bundle_size);
+        cla->iov[num_iov].iov_base = &cla->tx_headers[num_refs];
+        cla->iov[num_iov].iov_len  = BPLIB_TCP_CLA_HEADER_SIZE;
+        num_iov += 1 + piece_count;
+        ++num_refs;
+    }
+
+    cla->egress_held = (num_refs == 0);
+
+    /* keep writing until all of it is gone, writev() can stop part way through any piece */
+    iov_pos = 0;
+    while (iov_pos < num_iov && cla->connected)
+    {
+        status = writev(cla->sys_fd, &cla->iov[iov_pos], num_iov - iov_pos);
+        if (status < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            bplib_tcp_cla_disconnect(cla);
+            break;
+        }
+
+        while (iov_pos < num_iov && (size_t)status >= cla->iov[iov_pos].iov_len)
+        {
+            status -= cla->iov[iov_pos].iov_len;
+            ++iov_pos;
+        }
+        if (iov_pos < num_iov)
+        {
+            cla->iov[iov_pos].iov_base = (uint8_t *)cla->iov[iov_pos].iov_base + status;
+            cla->iov[iov_pos].iov_len -= status;
+        }
+    }
+
+    for (i = 0; i < num_refs; ++i)
+    {
+        bplib_cla_egress_iov_release(cla->rtbl, cla->tx_refs[i]);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_process -
+ *-------------------------------------------------------------------------------------*/
+static int bplib_tcp_cla_process(bplib_socket_cla_t *cla, uint32_t timeout)
+{
+    uint64_t now;
+    short    revents;
+    bool     egress_ready;
+    int      status;
+
+    if (cla->connected)
+    {
+        status = bplib_socket_cla_wait(cla, cla->sys_fd, POLLIN, timeout, &revents, &egress_ready);
+        if (status != BP_SUCCESS)
+        {
+            return status;
+        }
+
+        if ((revents & (POLLIN | POLLERR | POLLHUP)) != 0)
+        {
+            bplib_tcp_cla_receive(cla);
+        }
+
+        if (egress_ready && cla->connected)
+        {
+            bplib_tcp_cla_send(cla);
+        }
+
+        return BP_SUCCESS;
+    }
+
+    if (cla->connecting)
+    {
+        status = bplib_socket_cla_wait(cla, cla->sys_fd, POLLOUT, timeout, &revents, NULL);
+        if (status == BP_SUCCESS)
+        {
+            bplib_tcp_cla_finish_connect(cla);
+        }
+        return status;
+    }
+
+    if (cla->listen_fd >= 0)
+    {
+        status = bplib_socket_cla_wait(cla, cla->listen_fd, POLLIN, timeout, &revents, NULL);
+        if (status == BP_SUCCESS)
+        {
+            bplib_tcp_cla_accept(cla);
+        }
+        return status;
+    }
+
+    /* waiting to try the connection again */
+    now = bplib_os_get_dtntime_ms();
+    if (now < cla->next_connect_time)
+    {
+        if ((cla->next_connect_time - now) < timeout)
+        {
+            timeout = cla->next_connect_time - now;
+        }
+        poll(NULL, 0, timeout);
+        if (bplib_os_get_dtntime_ms() < cla->next_connect_time)
+        {
+            return BP_TIMEOUT;
+        }
+    }
+
+    bplib_tcp_cla_connect(cla);
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_close -
+ *-------------------------------------------------------------------------------------*/
+static void bplib_tcp_cla_close(bplib_socket_cla_t *cla)
+{
+    if (cla->sys_fd >= 0)
+    {
+        close(cla->sys_fd);
+        cla->sys_fd = -1;
+    }
+    if (cla->listen_fd >= 0)
+    {
+        close(cla->listen_fd);
+        cla->listen_fd = -1;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_tcp_cla_listen - opens the socket that connections are accepted on
+ *-------------------------------------------------------------------------------------*/
+static int bplib_tcp_cla_listen(bplib_socket_cla_t *cla)
+{
+    int enable;
+
+    cla->listen_fd = socket(cla->local_addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (cla->listen_fd < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "socket() failed: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    enable = 1;
+    setsockopt(cla->listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    if (bind(cla->listen_fd, (const struct sockaddr *)&cla->local_addr, cla->local_addr_len) < 0 ||
+        listen(cla->listen_fd, 1) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "bind()/listen() failed: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_tcp_cla_create
+ *----------------------------------------------------------------------------*/
+bplib_socket_cla_t *bplib_tcp_cla_create(bplib_routetbl_t *rtbl, const bplib_socket_cla_config_t *config)
+{
+    bplib_socket_cla_t *cla;
+
+    cla = bplib_socket_cla_alloc(rtbl, config, &BPLIB_TCP_CLA_OPS, "cla_tcp");
+    if (cla == NULL)
+    {
+        return NULL;
+    }
+
+    /* the length field is 32 bits */
+    if (cla->max_bundle_size > UINT32_MAX)
+    {
+        cla->max_bundle_size = UINT32_MAX;
+    }
+
+    /* a batch on the receive side is as many whole bundles as are in the stream buffer */
+    cla->rx_buffer_size = BPLIB_TCP_CLA_HEADER_SIZE + cla->max_bundle_size;
+    cla->max_bundles    = cla->batch_size;
+
+    cla->rx_buffer   = bplib_os_calloc(cla->rx_buffer_size);
+    cla->iov         = bplib_os_calloc(BPLIB_SOCKET_CLA_TCP_MAX_IOV * sizeof(*cla->iov));
+    cla->bundles     = bplib_os_calloc(cla->max_bundles * sizeof(*cla->bundles));
+    cla->status_list = bplib_os_calloc(cla->max_bundles * sizeof(*cla->status_list));
+    cla->tx_refs     = bplib_os_calloc(cla->batch_size * sizeof(*cla->tx_refs));
+    cla->tx_headers  = bplib_os_calloc(cla->batch_size * sizeof(*cla->tx_headers));
+    if (cla->rx_buffer == NULL || cla->iov == NULL || cla->bundles == NULL || cla->status_list == NULL ||
+        cla->tx_refs == NULL || cla->tx_headers == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate TCP CLA buffers\n");
+        bplib_socket_cla_destroy(cla);
+        return NULL;
+    }
+
+    /* with a remote address it connects, otherwise it listens */
+    if (cla->remote_addr_len == 0 && bplib_tcp_cla_listen(cla) != BP_SUCCESS)
+    {
+        bplib_socket_cla_destroy(cla);
+        return NULL;
+    }
+
+    if (bplib_socket_cla_start(cla) != BP_SUCCESS)
+    {
+        bplib_socket_cla_destroy(cla);
+        return NULL;
+    }
+
+    return cla;
+}
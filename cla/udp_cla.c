@@ -0,0 +1,432 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+/* recvmmsg() and sendmmsg() are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "socket_cla_internal.h"
+
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+/* the room for one UDP_SEGMENT or UDP_GRO control message */
+#define BPLIB_UDP_CLA_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+
+static int  bplib_udp_cla_process(bplib_socket_cla_t *cla, uint32_t timeout);
+static void bplib_udp_cla_close(bplib_socket_cla_t *cla);
+
+static const bplib_socket_cla_ops_t BPLIB_UDP_CLA_OPS = {.process = bplib_udp_cla_process,
+                                                         .close   = bplib_udp_cla_close};
+
+/*--------------------------------------------------------------------------------------
+ * bplib_udp_cla_receive - takes in every datagram that is waiting, up to the batch size
+ *-------------------------------------------------------------------------------------*/
+static void bplib_udp_cla_receive(bplib_socket_cla_t *cla)
+{
+    struct cmsghdr *cmsg;
+    uint8_t        *data;
+    int             gso_size;
+    size_t          seg_size;
+    size_t          offset;
+    uint32_t        count;
+    int             num_msgs;
+    int             i;
+
+    /* the headers are shared with the send side, so they are set up again each time */
+    for (i = 0; i < cla->batch_size; ++i)
+    {
+        memset(&cla->msgs[i].msg_hdr, 0, sizeof(cla->msgs[i].msg_hdr));
+        cla->msgs[i].msg_hdr.msg_iov        = &cla->iov[cla->batch_size + i];
+        cla->msgs[i].msg_hdr.msg_iovlen     = 1;
+        cla->msgs[i].msg_hdr.msg_control    = &cla->control[i * BPLIB_UDP_CLA_CONTROL_SIZE];
+        cla->msgs[i].msg_hdr.msg_controllen = BPLIB_UDP_CLA_CONTROL_SIZE;
+    }
+
+    num_msgs = recvmmsg(cla->sys_fd, cla->msgs, cla->batch_size, MSG_DONTWAIT, NULL);
+    if (num_msgs <= 0)
+    {
+        /* an ICMP error for something sent earlier also shows up here, there is nothing to do for it */
+        return;
+    }
+
+    count = 0;
+    for (i = 0; i < num_msgs; ++i)
+    {
+        data     = &cla->rx_buffer[i * cla->rx_buffer_size];
+        seg_size = cla->msgs[i].msg_len;
+
+#ifdef UDP_GRO
+        /* datagrams coalesced by GRO are all the segment size, except perhaps the last one */
+        for (cmsg = CMSG_FIRSTHDR(&cla->msgs[i].msg_hdr); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&cla->msgs[i].msg_hdr, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                seg_size = gso_size;
+            }
+        }
+#else
+        (void)cmsg;
+        (void)gso_size;
+#endif
+
+        if (seg_size == 0)
+        {
+            continue;
+        }
+
+        for (offset = 0; offset < cla->msgs[i].msg_len && count < cla->max_bundles; offset += seg_size)
+        {
+            cla->bundles[count].bundle = &data[offset];
+            cla->bundles[count].size   = cla->msgs[i].msg_len - offset;
+            if (cla->bundles[count].size > seg_size)
+            {
+                cla->bundles[count].size = seg_size;
+            }
+            ++count;
+        }
+    }
+
+    /* a datagram that does not get in is dropped, the same as one the socket had no room for */
+    bplib_socket_cla_ingress(cla, count, false);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_udp_cla_build_msgs - puts the filled egress buffers into messages for sendmmsg()
+ *
+ * With GSO a run of bundles of the same size, where the last may be smaller, goes as one
+ * message with the segment size set.  Returns the number of messages.
+ *-------------------------------------------------------------------------------------*/
+static uint32_t bplib_udp_cla_build_msgs(bplib_socket_cla_t *cla, uint32_t num_filled)
+{
+    struct msghdr  *hdr;
+    struct cmsghdr *cmsg;
+    uint16_t        seg_len;
+    size_t          seg_size;
+    size_t          total_size;
+    uint32_t        num_msgs;
+    uint32_t        start;
+    uint32_t        i;
+
+    for (i = 0; i < num_filled; ++i)
+    {
+        cla->iov[i].iov_base = cla->egress_bufs[i].bundle;
+        cla->iov[i].iov_len  = cla->egress_bufs[i].size;
+    }
+
+    num_msgs = 0;
+    i        = 0;
+    while (i < num_filled)
+    {
+        start = i;
+        ++i;
+
+        if ((cla->flags & BPLIB_SOCKET_CLA_UDP_GSO) != 0)
+        {
+            seg_size   = cla->iov[start].iov_len;
+            total_size = seg_size;
+            while (i < num_filled && (i - start) < BPLIB_SOCKET_CLA_UDP_MAX_SEGMENTS &&
+                   cla->iov[i].iov_len <= seg_size &&
+                   (total_size + cla->iov[i].iov_len) <= BPLIB_SOCKET_CLA_MAX_DATAGRAM)
+            {
+                total_size += cla->iov[i].iov_len;
+                ++i;
+
+                /* only the last one can be short */
+                if (cla->iov[i - 1].iov_len < seg_size)
+                {
+                    break;
+                }
+            }
+        }
+
+        hdr = &cla->msgs[num_msgs].msg_hdr;
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->msg_name    = &cla->remote_addr;
+        hdr->msg_namelen = cla->remote_addr_len;
+        hdr->msg_iov     = &cla->iov[start];
+        hdr->msg_iovlen  = i - start;
+
+#ifdef UDP_SEGMENT
+        if (hdr->msg_iovlen > 1)
+        {
+            hdr->msg_control    = &cla->control[num_msgs * BPLIB_UDP_CLA_CONTROL_SIZE];
+            hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            cmsg                = CMSG_FIRSTHDR(hdr);
+            cmsg->cmsg_level    = SOL_UDP;
+            cmsg->cmsg_type     = UDP_SEGMENT;
+            cmsg->cmsg_len      = CMSG_LEN(sizeof(uint16_t));
+            seg_len             = cla->iov[start].iov_len;
+            memcpy(CMSG_DATA(cmsg), &seg_len, sizeof(seg_len));
+        }
+#else
+        (void)cmsg;
+        (void)seg_len;
+#endif
+
+        ++num_msgs;
+    }
+
+    return num_msgs;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_udp_cla_send - sends whatever bundles are ready, up to the batch size
+ *-------------------------------------------------------------------------------------*/
+static void bplib_udp_cla_send(bplib_socket_cla_t *cla)
+{
+    uint32_t num_filled;
+    uint32_t num_msgs;
+    uint32_t num_sent;
+    uint32_t i;
+    int      status;
+
+    for (i = 0; i < cla->batch_size; ++i)
+    {
+        cla->egress_bufs[i].bundle = &cla->tx_buffer[i * cla->max_bundle_size];
+        cla->egress_bufs[i].size   = cla->max_bundle_size;
+    }
+
+    num_filled = 0;
+    status     = bplib_cla_egress_batch(cla->rtbl, cla->intf_id, cla->egress_bufs, cla->batch_size, &num_filled, 0);
+    cla->egress_held = (status != BP_SUCCESS);
+    if (status != BP_SUCCESS)
+    {
+        return;
+    }
+
+    num_msgs = bplib_udp_cla_build_msgs(cla, num_filled);
+    num_sent = 0;
+    while (num_sent < num_msgs)
+    {
+        status = sendmmsg(cla->sys_fd, &cla->msgs[num_sent], num_msgs - num_sent, 0);
+        if (status > 0)
+        {
+            num_sent += status;
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else if (errno == EIO && (cla->flags & BPLIB_SOCKET_CLA_UDP_GSO) != 0)
+        {
+            /* the device cannot do the checksums that GSO needs, what is left of this batch is lost */
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "UDP GSO not supported here, turning it off\n");
+            cla->flags &= ~BPLIB_SOCKET_CLA_UDP_GSO;
+            break;
+        }
+        else if (errno == ECONNREFUSED || errno == EMSGSIZE)
+        {
+            /* nothing is listening at the other end, or the bundle is too big for a datagram */
+            ++num_sent;
+        }
+        else
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "sendmmsg() failed: %s\n", strerror(errno));
+            break;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_udp_cla_process -
+ *-------------------------------------------------------------------------------------*/
+static int bplib_udp_cla_process(bplib_socket_cla_t *cla, uint32_t timeout)
+{
+    short revents;
+    bool  egress_ready;
+    int   status;
+
+    /* with nowhere to send to, it only receives */
+    egress_ready = false;
+    if (cla->remote_addr_len == 0)
+    {
+        status = bplib_socket_cla_wait(cla, cla->sys_fd, POLLIN, timeout, &revents, NULL);
+    }
+    else
+    {
+        status = bplib_socket_cla_wait(cla, cla->sys_fd, POLLIN, timeout, &revents, &egress_ready);
+    }
+    if (status != BP_SUCCESS)
+    {
+        return status;
+    }
+
+    if ((revents & (POLLIN | POLLERR)) != 0)
+    {
+        bplib_udp_cla_receive(cla);
+    }
+
+    if (egress_ready)
+    {
+        bplib_udp_cla_send(cla);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_udp_cla_close -
+ *-------------------------------------------------------------------------------------*/
+static void bplib_udp_cla_close(bplib_socket_cla_t *cla)
+{
+    if (cla->sys_fd >= 0)
+    {
+        close(cla->sys_fd);
+        cla->sys_fd = -1;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_udp_cla_open - opens the socket and turns on the offloads that were asked for
+ *-------------------------------------------------------------------------------------*/
+static int bplib_udp_cla_open(bplib_socket_cla_t *cla)
+{
+    int family;
+    int enable;
+
+    if (cla->local_addr_len != 0)
+    {
+        family = cla->local_addr.ss_family;
+    }
+    else
+    {
+        family = cla->remote_addr.ss_family;
+    }
+
+    cla->sys_fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (cla->sys_fd < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "socket() failed: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    if (cla->local_addr_len != 0 &&
+        bind(cla->sys_fd, (const struct sockaddr *)&cla->local_addr, cla->local_addr_len) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "bind() failed: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    enable = 1;
+
+#ifdef UDP_GRO
+    if ((cla->flags & BPLIB_SOCKET_CLA_UDP_GRO) != 0 &&
+        setsockopt(cla->sys_fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) < 0)
+    {
+        cla->flags &= ~BPLIB_SOCKET_CLA_UDP_GRO;
+    }
+#else
+    cla->flags &= ~BPLIB_SOCKET_CLA_UDP_GRO;
+#endif
+
+#ifndef UDP_SEGMENT
+    cla->flags &= ~BPLIB_SOCKET_CLA_UDP_GSO;
+#endif
+
+    (void)enable;
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_udp_cla_create
+ *----------------------------------------------------------------------------*/
+bplib_socket_cla_t *bplib_udp_cla_create(bplib_routetbl_t *rtbl, const bplib_socket_cla_config_t *config)
+{
+    bplib_socket_cla_t *cla;
+    uint32_t            i;
+
+    cla = bplib_socket_cla_alloc(rtbl, config, &BPLIB_UDP_CLA_OPS, "cla_udp");
+    if (cla == NULL)
+    {
+        return NULL;
+    }
+
+    if (cla->max_bundle_size > BPLIB_SOCKET_CLA_DEFAULT_MAX_BUNDLE)
+    {
+        cla->max_bundle_size = BPLIB_SOCKET_CLA_DEFAULT_MAX_BUNDLE;
+    }
+
+    if (bplib_udp_cla_open(cla) != BP_SUCCESS)
+    {
+        bplib_socket_cla_destroy(cla);
+        return NULL;
+    }
+
+    /* with GRO one receive can hold a whole run of datagrams */
+    if ((cla->flags & BPLIB_SOCKET_CLA_UDP_GRO) != 0)
+    {
+        cla->rx_buffer_size = BPLIB_SOCKET_CLA_MAX_DATAGRAM;
+        cla->max_bundles    = cla->batch_size * BPLIB_SOCKET_CLA_UDP_MAX_SEGMENTS;
+    }
+    else
+    {
+        cla->rx_buffer_size = cla->max_bundle_size;
+        cla->max_bundles    = cla->batch_size;
+    }
+
+    cla->rx_buffer   = bplib_os_calloc(cla->batch_size * cla->rx_buffer_size);
+    cla->tx_buffer   = bplib_os_calloc(cla->batch_size * cla->max_bundle_size);
+    cla->msgs        = bplib_os_calloc(cla->batch_size * sizeof(*cla->msgs));
+    cla->iov         = bplib_os_calloc(cla->batch_size * sizeof(*cla->iov) * 2);
+    cla->control     = bplib_os_calloc(cla->batch_size * BPLIB_UDP_CLA_CONTROL_SIZE);
+    cla->bundles     = bplib_os_calloc(cla->max_bundles * sizeof(*cla->bundles));
+    cla->egress_bufs = bplib_os_calloc(cla->batch_size * sizeof(*cla->egress_bufs));
+    cla->status_list = bplib_os_calloc(cla->max_bundles * sizeof(*cla->status_list));
+    if (cla->rx_buffer == NULL || cla->tx_buffer == NULL || cla->msgs == NULL || cla->iov == NULL ||
+        cla->control == NULL || cla->bundles == NULL || cla->egress_bufs == NULL || cla->status_list == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate UDP CLA buffers\n");
+        bplib_socket_cla_destroy(cla);
+        return NULL;
+    }
+
+    /*
+     * The receive side uses the second half of the iov array, so that it stays set up between calls.
+     * The first half is for sending, where each message can point to several entries.
+     */
+    for (i = 0; i < cla->batch_size; ++i)
+    {
+        cla->iov[cla->batch_size + i].iov_base = &cla->rx_buffer[i * cla->rx_buffer_size];
+        cla->iov[cla->batch_size + i].iov_len  = cla->rx_buffer_size;
+    }
+
+    bplib_route_intf_set_flags(rtbl, cla->intf_id, BPLIB_INTF_STATE_OPER_UP);
+
+    if (bplib_socket_cla_start(cla) != BP_SUCCESS)
+    {
+        bplib_socket_cla_destroy(cla);
+        return NULL;
+    }
+
+    return cla;
+}
@@ -0,0 +1,447 @@
+/************************************************************************
+ *
+ *  Behavior test of the shared memory transport
+ *
+ *  The node side and the application side of one transport are both run
+ *  in this process, with no thread in the transport, so the test decides
+ *  when the node side moves entries.  The socket of the transport is
+ *  bound and connected to the same address, so every ADU put in the
+ *  submit ring comes back through the node into the delivery ring, and
+ *  bundles put in the submit ring are to a remote node, so they come out
+ *  of the CLA interface which has the route to it.
+ *
+ *  Both rings are kept small, so the tests fill them and go around them
+ *  several times, and check that nothing is lost or reordered when the
+ *  application or the node has to wait for the other side.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_routing.h"
+#include "bplib_shm_transport.h"
+#include "benchutil.h"
+
+#define SHM_TEST_LOCAL_NODE  100
+#define SHM_TEST_REMOTE_NODE 200
+
+/* entries in each ring, and the largest ADU or bundle in one */
+#define SHM_TEST_SLOTS       8
+#define SHM_TEST_MAX_PAYLOAD 512
+
+/* ADUs put through in the wraparound test, several times around each ring */
+#define SHM_TEST_CYCLES (5 * SHM_TEST_SLOTS + 3)
+
+/* times the node side and the routing table are run while waiting for something to come out */
+#define SHM_TEST_TRIES 1000
+
+#define SHM_TEST_PATH_SIZE 128
+#define SHM_TEST_WIRE_SIZE 2048
+
+static const bp_ipn_addr_t SHM_TEST_APP_ADDR    = {SHM_TEST_LOCAL_NODE, 1};
+static const bp_ipn_addr_t SHM_TEST_SENDER_ADDR = {SHM_TEST_LOCAL_NODE, 2};
+static const bp_ipn_addr_t SHM_TEST_REMOTE_ADDR = {SHM_TEST_REMOTE_NODE, 1};
+
+static char                   shm_test_path[SHM_TEST_PATH_SIZE];
+static bplib_routetbl_t      *shm_test_rtbl;
+static bp_handle_t            shm_test_cla_intf;
+static bplib_shm_transport_t *shm_test_shm;
+static bplib_shm_client_t    *shm_test_client;
+static uint8_t                shm_test_payload[SHM_TEST_MAX_PAYLOAD];
+static uint8_t                shm_test_expect[SHM_TEST_WIRE_SIZE];
+static uint8_t                shm_test_actual[SHM_TEST_WIRE_SIZE];
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* Fills the payload of ADU number n, which is its number in the first byte and a size that changes with it */
+static size_t shm_test_fill(uint32_t n)
+{
+    size_t size;
+    size_t i;
+
+    size = 1 + ((n * 37) % SHM_TEST_MAX_PAYLOAD);
+    for (i = 0; i < size; ++i)
+    {
+        shm_test_payload[i] = (uint8_t)(n + (i * 3));
+    }
+
+    return size;
+}
+
+/* Runs the node side once, and the routing table after it */
+static void shm_test_pump(void)
+{
+    bplib_shm_transport_process(shm_test_shm, 0);
+    bplib_route_periodic_maintenance(shm_test_rtbl);
+}
+
+/* Receives ADU number n from the delivery ring, running the node side until it comes */
+static bool shm_test_recv_check(uint32_t n)
+{
+    size_t   expect_size;
+    size_t   size;
+    uint32_t tries;
+    int      status;
+
+    status = BP_TIMEOUT;
+    size   = 0;
+    for (tries = 0; tries < SHM_TEST_TRIES && status == BP_TIMEOUT; ++tries)
+    {
+        shm_test_pump();
+        size   = sizeof(shm_test_actual);
+        status = bplib_shm_client_recv(shm_test_client, shm_test_actual, &size, 0);
+    }
+
+    expect_size = shm_test_fill(n);
+    if (status != BP_SUCCESS || size != expect_size || memcmp(shm_test_actual, shm_test_payload, size) != 0)
+    {
+        UtAssert_Failed("ADU %lu: status %d, %lu bytes where %lu were sent", (unsigned long)n, status,
+                        (unsigned long)size, (unsigned long)expect_size);
+        return false;
+    }
+
+    return true;
+}
+
+/* Takes the next bundle that the node routed to the remote node off its CLA interface */
+static int shm_test_egress(void *buffer, size_t *size)
+{
+    size_t   buffer_size;
+    uint32_t tries;
+    int      status;
+
+    buffer_size = *size;
+    status      = BP_TIMEOUT;
+    for (tries = 0; tries < SHM_TEST_TRIES && status == BP_TIMEOUT; ++tries)
+    {
+        shm_test_pump();
+        *size  = buffer_size;
+        status = bplib_cla_egress(shm_test_rtbl, shm_test_cla_intf, buffer, size, 0);
+    }
+
+    return status;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void shm_test_setup(void)
+{
+    bplib_shm_transport_config_t config;
+    bp_handle_t                  node_intf;
+
+    if (shm_test_rtbl != NULL)
+    {
+        return;
+    }
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+
+    UtAssert_NOT_NULL(shm_test_rtbl = bplib_route_alloc_table(16, 1 << 22));
+    if (shm_test_rtbl == NULL)
+    {
+        return;
+    }
+
+    node_intf         = bplib_create_node_intf(shm_test_rtbl, SHM_TEST_LOCAL_NODE);
+    shm_test_cla_intf = bplib_create_cla_intf(shm_test_rtbl);
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(node_intf));
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(shm_test_cla_intf));
+    UtAssert_INT32_EQ(bplib_route_add(shm_test_rtbl, SHM_TEST_REMOTE_NODE, ~(bp_ipn_t)0, shm_test_cla_intf),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(
+        bplib_route_intf_set_flags(shm_test_rtbl, node_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP),
+        BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_route_intf_set_flags(shm_test_rtbl, shm_test_cla_intf,
+                                                 BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP),
+                      BP_SUCCESS);
+
+    /* the rings would normally be on a tmpfs, but any directory works for a test */
+    snprintf(shm_test_path, sizeof(shm_test_path), "%s/bplib-shmtest.%lu", bench_getenv("TMPDIR", "/tmp"),
+             (unsigned long)getpid());
+
+    memset(&config, 0, sizeof(config));
+    config.path             = shm_test_path;
+    config.local_addr       = SHM_TEST_APP_ADDR;
+    config.remote_addr      = SHM_TEST_APP_ADDR;
+    config.flags            = BPLIB_SHM_TRANSPORT_NO_THREAD;
+    config.slot_count       = SHM_TEST_SLOTS;
+    config.max_payload_size = SHM_TEST_MAX_PAYLOAD;
+
+    UtAssert_NOT_NULL(shm_test_shm = bplib_shm_transport_create(shm_test_rtbl, &config));
+    UtAssert_NOT_NULL(shm_test_client = bplib_shm_client_open(shm_test_path));
+    bplib_route_periodic_maintenance(shm_test_rtbl);
+}
+
+void shm_test_config(void)
+{
+    bplib_shm_transport_config_t config;
+
+    /* the rings are indexed by masking, so their size has to be a power of two */
+    memset(&config, 0, sizeof(config));
+    config.path       = shm_test_path;
+    config.flags      = BPLIB_SHM_TRANSPORT_NO_THREAD;
+    config.slot_count = SHM_TEST_SLOTS + 1;
+    UtAssert_NULL(bplib_shm_transport_create(shm_test_rtbl, &config));
+
+    config.slot_count = SHM_TEST_SLOTS;
+    config.path       = NULL;
+    UtAssert_NULL(bplib_shm_transport_create(shm_test_rtbl, &config));
+
+    /* and there is nothing for an application to open where no node made the rings */
+    UtAssert_NULL(bplib_shm_client_open("/nonexistent/bplib-shmtest"));
+}
+
+void shm_test_reserve_commit(void)
+{
+    const void *view;
+    const void *again;
+    void       *buffer;
+    void       *same;
+    size_t      entry_size;
+    size_t      size;
+    size_t      view_size;
+    uint32_t    tries;
+    int         status;
+
+    if (shm_test_client == NULL)
+    {
+        return;
+    }
+
+    /* entries are rounded up to whole cache lines, so there can be a little more room than asked for */
+    UtAssert_INT32_EQ(bplib_shm_client_reserve(shm_test_client, &buffer, &entry_size, 0), BP_SUCCESS);
+    UtAssert_UINT32_GTEQ(entry_size, SHM_TEST_MAX_PAYLOAD);
+
+    /* until it is committed, the same entry is handed out again */
+    UtAssert_INT32_EQ(bplib_shm_client_reserve(shm_test_client, &same, &size, 0), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(same, buffer);
+    UtAssert_UINT32_EQ(size, entry_size);
+
+    /* an ADU bigger than the entry is refused, and the entry is still there to use */
+    UtAssert_INT32_EQ(bplib_shm_client_commit(shm_test_client, entry_size + 1, false), BP_ERROR);
+
+    size = shm_test_fill(1);
+    memcpy(buffer, shm_test_payload, size);
+    UtAssert_INT32_EQ(bplib_shm_client_commit(shm_test_client, size, false), BP_SUCCESS);
+
+    /* it is looked at where it is in the delivery ring, and stays there until it is released */
+    status = BP_TIMEOUT;
+    for (tries = 0; tries < SHM_TEST_TRIES && status == BP_TIMEOUT; ++tries)
+    {
+        shm_test_pump();
+        status = bplib_shm_client_recv_view(shm_test_client, &view, &view_size, 0);
+    }
+    UtAssert_INT32_EQ(status, BP_SUCCESS);
+    if (status != BP_SUCCESS)
+    {
+        return;
+    }
+
+    UtAssert_UINT32_EQ(view_size, size);
+    UtAssert_MemCmp(view, shm_test_payload, size, "ADU in the delivery ring");
+
+    UtAssert_INT32_EQ(bplib_shm_client_recv_view(shm_test_client, &again, &view_size, 0), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(again, view);
+
+    bplib_shm_client_recv_release(shm_test_client);
+    UtAssert_INT32_EQ(bplib_shm_client_recv_view(shm_test_client, &view, &view_size, 0), BP_TIMEOUT);
+}
+
+void shm_test_full_ring(void)
+{
+    void    *buffer;
+    size_t   size;
+    uint32_t i;
+
+    if (shm_test_client == NULL)
+    {
+        return;
+    }
+
+    /* nothing is taken out of the submit ring while the node side is not run */
+    for (i = 0; i < SHM_TEST_SLOTS; ++i)
+    {
+        size = shm_test_fill(100 + i);
+        UtAssert_INT32_EQ(bplib_shm_client_send(shm_test_client, shm_test_payload, size, 0), BP_SUCCESS);
+    }
+
+    size = shm_test_fill(100 + SHM_TEST_SLOTS);
+    UtAssert_INT32_EQ(bplib_shm_client_send(shm_test_client, shm_test_payload, size, 0), BP_TIMEOUT);
+    UtAssert_INT32_EQ(bplib_shm_client_reserve(shm_test_client, &buffer, &size, 2), BP_TIMEOUT);
+
+    /* once the node has run there is room again, and the ADUs come back in order */
+    for (i = 0; i < SHM_TEST_SLOTS; ++i)
+    {
+        UtAssert_True(shm_test_recv_check(100 + i), "ADU %lu of a full ring", (unsigned long)i);
+    }
+    UtAssert_INT32_EQ(bplib_shm_client_reserve(shm_test_client, &buffer, &size, 0), BP_SUCCESS);
+}
+
+void shm_test_delivery_full(void)
+{
+    size_t   size;
+    uint32_t i;
+
+    if (shm_test_client == NULL)
+    {
+        return;
+    }
+
+    /* twice what the delivery ring holds, with nothing received until all of it is sent */
+    for (i = 0; i < 2 * SHM_TEST_SLOTS; ++i)
+    {
+        size = shm_test_fill(200 + i);
+        UtAssert_INT32_EQ(bplib_shm_client_send(shm_test_client, shm_test_payload, size, 0), BP_SUCCESS);
+        shm_test_pump();
+        shm_test_pump();
+    }
+
+    /* the ones that did not fit waited in the node, and come after the rest */
+    for (i = 0; i < 2 * SHM_TEST_SLOTS; ++i)
+    {
+        UtAssert_True(shm_test_recv_check(200 + i), "ADU %lu past a full delivery ring", (unsigned long)i);
+    }
+}
+
+void shm_test_wraparound(void)
+{
+    size_t   size;
+    uint32_t sent;
+    uint32_t received;
+    uint32_t failed;
+
+    if (shm_test_client == NULL)
+    {
+        return;
+    }
+
+    /* a few are kept outstanding at a time, so the two rings wrap at different points */
+    sent     = 0;
+    received = 0;
+    failed   = 0;
+    while (received < SHM_TEST_CYCLES)
+    {
+        while (sent < SHM_TEST_CYCLES && (sent - received) < 3)
+        {
+            size = shm_test_fill(1000 + sent);
+            if (bplib_shm_client_send(shm_test_client, shm_test_payload, size, 0) != BP_SUCCESS)
+            {
+                ++failed;
+            }
+            ++sent;
+        }
+
+        if (!shm_test_recv_check(1000 + received))
+        {
+            ++failed;
+        }
+        ++received;
+    }
+
+    UtAssert_ZERO(failed);
+}
+
+void shm_test_bundle(void)
+{
+    bp_socket_t *desc;
+    void        *buffer;
+    size_t       entry_size;
+    size_t       expect_size;
+    size_t       actual_size;
+
+    if (shm_test_client == NULL)
+    {
+        return;
+    }
+
+    /* a bundle to the remote node, as a peer would have put together, from the node itself */
+    desc = bplib_create_socket(shm_test_rtbl);
+    UtAssert_NOT_NULL(desc);
+    if (desc == NULL)
+    {
+        return;
+    }
+
+    UtAssert_INT32_EQ(bplib_bind_socket(desc, &SHM_TEST_SENDER_ADDR), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_connect_socket(desc, &SHM_TEST_REMOTE_ADDR), BP_SUCCESS);
+    bplib_route_periodic_maintenance(shm_test_rtbl);
+
+    expect_size = shm_test_fill(7);
+    UtAssert_INT32_EQ(bplib_send(desc, shm_test_payload, expect_size, BP_CHECK), BP_SUCCESS);
+    expect_size = sizeof(shm_test_expect);
+    UtAssert_INT32_EQ(shm_test_egress(shm_test_expect, &expect_size), BP_SUCCESS);
+    bplib_close_socket(desc);
+
+    /* put in the submit ring as a bundle, the node routes it out the same way */
+    UtAssert_True(expect_size <= SHM_TEST_MAX_PAYLOAD, "bundle of %lu bytes fits in an entry",
+                  (unsigned long)expect_size);
+    UtAssert_INT32_EQ(bplib_shm_client_send_bundle(shm_test_client, shm_test_expect, expect_size, 0), BP_SUCCESS);
+
+    actual_size = sizeof(shm_test_actual);
+    UtAssert_INT32_EQ(shm_test_egress(shm_test_actual, &actual_size), BP_SUCCESS);
+    UtAssert_UINT32_EQ(actual_size, expect_size);
+
+    /* one that does not fit in an entry is refused before anything is put in the ring */
+    UtAssert_INT32_EQ(bplib_shm_client_reserve(shm_test_client, &buffer, &entry_size, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_shm_client_send_bundle(shm_test_client, shm_test_expect, entry_size + 1, 0), BP_ERROR);
+
+    /* and nothing of it was delivered to the application */
+    actual_size = sizeof(shm_test_actual);
+    UtAssert_INT32_EQ(bplib_shm_client_recv(shm_test_client, shm_test_actual, &actual_size, 0), BP_TIMEOUT);
+}
+
+void shm_test_destroy(void)
+{
+    const void *view;
+    void       *buffer;
+    size_t      size;
+
+    if (shm_test_client == NULL)
+    {
+        return;
+    }
+
+    /* the application finds out from its next call, and the files are gone */
+    bplib_shm_transport_destroy(shm_test_shm);
+    shm_test_shm = NULL;
+
+    UtAssert_INT32_EQ(bplib_shm_client_reserve(shm_test_client, &buffer, &size, 0), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_shm_client_recv_view(shm_test_client, &view, &size, 0), BP_ERROR);
+    UtAssert_INT32_NEQ(access(shm_test_path, F_OK), 0);
+
+    bplib_shm_client_close(shm_test_client);
+    shm_test_client = NULL;
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(shm_test_config, shm_test_setup, NULL, "config");
+    UtTest_Add(shm_test_reserve_commit, shm_test_setup, NULL, "reserve/commit");
+    UtTest_Add(shm_test_full_ring, shm_test_setup, NULL, "full ring");
+    UtTest_Add(shm_test_delivery_full, shm_test_setup, NULL, "full delivery ring");
+    UtTest_Add(shm_test_wraparound, shm_test_setup, NULL, "wraparound");
+    UtTest_Add(shm_test_bundle, shm_test_setup, NULL, "bundle");
+    UtTest_Add(shm_test_destroy, shm_test_setup, NULL, "destroy");
+}
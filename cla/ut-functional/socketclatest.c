@@ -0,0 +1,518 @@
+/************************************************************************
+ *
+ *  Behavior test of the UDP and TCP convergence layer adapters
+ *
+ *  Two nodes are run in this process, each with its own routing table,
+ *  and they are joined by a pair of socket CLAs over the loopback
+ *  address.  The CLAs have no thread of their own, so the test runs
+ *  both of them and both routing tables while it waits for something
+ *  to come out at the other end.
+ *
+ *  ADUs are sent both ways in bursts of different sizes, and have to
+ *  come out whole and in order.  Over TCP the bursts also put several
+ *  bundles in one read, so the length that frames each bundle has to
+ *  be followed through the stream.  A peer that is not a CLA then sends
+ *  a length the listener cannot take, and is disconnected for it.
+ *
+ *************************************************************************/
+
+#define _GNU_SOURCE
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_routing.h"
+#include "bplib_socket_cla.h"
+#include "benchutil.h"
+
+#define SOCKET_CLA_TEST_NODE_A 100
+#define SOCKET_CLA_TEST_NODE_B 200
+
+/* ADUs in each burst, and the largest of them */
+#define SOCKET_CLA_TEST_BURST       16
+#define SOCKET_CLA_TEST_MAX_PAYLOAD 1400
+
+/* the largest bundle the listener in the framing test takes */
+#define SOCKET_CLA_TEST_SMALL_BUNDLE 4096
+
+/* times the CLAs and the routing tables are run while waiting for something to come out */
+#define SOCKET_CLA_TEST_TRIES 2000
+
+#define SOCKET_CLA_TEST_BUFFER_SIZE 2048
+
+static const bp_ipn_addr_t SOCKET_CLA_TEST_ADDR_A = {SOCKET_CLA_TEST_NODE_A, 1};
+static const bp_ipn_addr_t SOCKET_CLA_TEST_ADDR_B = {SOCKET_CLA_TEST_NODE_B, 1};
+
+static bplib_routetbl_t   *socket_cla_test_rtbl_a;
+static bplib_routetbl_t   *socket_cla_test_rtbl_b;
+static bp_socket_t        *socket_cla_test_desc_a;
+static bp_socket_t        *socket_cla_test_desc_b;
+static bplib_socket_cla_t *socket_cla_test_cla_a;
+static bplib_socket_cla_t *socket_cla_test_cla_b;
+static uint8_t             socket_cla_test_payload[SOCKET_CLA_TEST_MAX_PAYLOAD];
+static uint8_t             socket_cla_test_actual[SOCKET_CLA_TEST_BUFFER_SIZE];
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* Fills the payload of ADU number n, which is its number in the first byte and a size that changes with it */
+static size_t socket_cla_test_fill(uint32_t n)
+{
+    size_t size;
+    size_t i;
+
+    size = 1 + ((n * 211) % SOCKET_CLA_TEST_MAX_PAYLOAD);
+    for (i = 0; i < size; ++i)
+    {
+        socket_cla_test_payload[i] = (uint8_t)(n + (i * 7));
+    }
+
+    return size;
+}
+
+/* Sets addr to the loopback address at a port that nothing is using right now */
+static bool socket_cla_test_free_port(int type, struct sockaddr_in *addr)
+{
+    socklen_t len;
+    int       fd;
+    bool      found;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family      = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    fd = socket(AF_INET, type, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    len   = sizeof(*addr);
+    found = (bind(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0 &&
+             getsockname(fd, (struct sockaddr *)addr, &len) == 0);
+    close(fd);
+
+    return found;
+}
+
+/* Runs each CLA that is there once, and both routing tables after them */
+static void socket_cla_test_pump(void)
+{
+    if (socket_cla_test_cla_a != NULL)
+    {
+        bplib_socket_cla_process(socket_cla_test_cla_a, 0);
+    }
+    if (socket_cla_test_cla_b != NULL)
+    {
+        bplib_socket_cla_process(socket_cla_test_cla_b, 0);
+    }
+    bplib_route_periodic_maintenance(socket_cla_test_rtbl_a);
+    bplib_route_periodic_maintenance(socket_cla_test_rtbl_b);
+}
+
+/* Checks if the routing table has an interface to dest that is up, which is where bundles to it can go */
+static bool socket_cla_test_is_up(bplib_routetbl_t *rtbl, bp_ipn_t dest)
+{
+    const uint32_t up_flags = BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP;
+
+    return bp_handle_is_valid(bplib_route_get_next_intf_with_flags(rtbl, dest, up_flags, up_flags));
+}
+
+/* Runs everything until the routing table has an interface to dest that is up */
+static bool socket_cla_test_wait_up(bplib_routetbl_t *rtbl, bp_ipn_t dest)
+{
+    uint32_t tries;
+
+    for (tries = 0; tries < SOCKET_CLA_TEST_TRIES && !socket_cla_test_is_up(rtbl, dest); ++tries)
+    {
+        socket_cla_test_pump();
+        poll(NULL, 0, 1);
+    }
+
+    return socket_cla_test_is_up(rtbl, dest);
+}
+
+/* Runs everything until the CLA has dropped its connection and is waiting on the listening socket again */
+static bool socket_cla_test_wait_listening(bplib_socket_cla_t *cla, int listen_fd)
+{
+    uint32_t tries;
+
+    for (tries = 0; tries < SOCKET_CLA_TEST_TRIES && bplib_socket_cla_get_fd(cla) != listen_fd; ++tries)
+    {
+        socket_cla_test_pump();
+        poll(NULL, 0, 1);
+    }
+
+    return (bplib_socket_cla_get_fd(cla) == listen_fd);
+}
+
+/* Receives ADU number n on desc, running everything until it comes */
+static bool socket_cla_test_recv_check(bp_socket_t *desc, uint32_t n)
+{
+    size_t   expect_size;
+    size_t   size;
+    uint32_t tries;
+    int      status;
+
+    status = BP_TIMEOUT;
+    size   = 0;
+    for (tries = 0; tries < SOCKET_CLA_TEST_TRIES && status == BP_TIMEOUT; ++tries)
+    {
+        socket_cla_test_pump();
+        size   = sizeof(socket_cla_test_actual);
+        status = bplib_recv(desc, socket_cla_test_actual, &size, 0);
+    }
+
+    expect_size = socket_cla_test_fill(n);
+    if (status != BP_SUCCESS || size != expect_size ||
+        memcmp(socket_cla_test_actual, socket_cla_test_payload, size) != 0)
+    {
+        UtAssert_Failed("ADU %lu: status %d, %lu bytes where %lu were sent", (unsigned long)n, status,
+                        (unsigned long)size, (unsigned long)expect_size);
+        return false;
+    }
+
+    return true;
+}
+
+/* Sends a burst of ADUs starting at number first from one socket, and checks that they all get to the other */
+static void socket_cla_test_burst(bp_socket_t *from, bp_socket_t *to, uint32_t first, const char *what)
+{
+    size_t   size;
+    uint32_t failed;
+    uint32_t i;
+
+    failed = 0;
+    for (i = 0; i < SOCKET_CLA_TEST_BURST; ++i)
+    {
+        size = socket_cla_test_fill(first + i);
+        if (bplib_send(from, socket_cla_test_payload, size, BP_CHECK) != BP_SUCCESS)
+        {
+            ++failed;
+        }
+    }
+
+    for (i = 0; i < SOCKET_CLA_TEST_BURST; ++i)
+    {
+        if (!socket_cla_test_recv_check(to, first + i))
+        {
+            ++failed;
+        }
+    }
+
+    UtAssert_True(failed == 0, "%s: %lu of %lu ADUs lost or out of order", what, (unsigned long)failed,
+                  (unsigned long)SOCKET_CLA_TEST_BURST);
+}
+
+/* Adds a route to dest through the interface of the CLA, unless there is no CLA */
+static void socket_cla_test_route(bplib_routetbl_t *rtbl, bp_ipn_t dest, bplib_socket_cla_t *cla)
+{
+    UtAssert_NOT_NULL(cla);
+    if (cla != NULL)
+    {
+        UtAssert_INT32_EQ(bplib_route_add(rtbl, dest, ~(bp_ipn_t)0, bplib_socket_cla_get_intf(cla)), BP_SUCCESS);
+    }
+}
+
+/* Destroys both CLAs, which also takes their interfaces and the routes through them out of the tables */
+static void socket_cla_test_destroy_clas(void)
+{
+    if (socket_cla_test_cla_a != NULL)
+    {
+        bplib_socket_cla_destroy(socket_cla_test_cla_a);
+        socket_cla_test_cla_a = NULL;
+    }
+    if (socket_cla_test_cla_b != NULL)
+    {
+        bplib_socket_cla_destroy(socket_cla_test_cla_b);
+        socket_cla_test_cla_b = NULL;
+    }
+    bplib_route_periodic_maintenance(socket_cla_test_rtbl_a);
+    bplib_route_periodic_maintenance(socket_cla_test_rtbl_b);
+}
+
+/* Makes a routing table for a node, with its node interface up */
+static bplib_routetbl_t *socket_cla_test_node(bp_ipn_t node_num)
+{
+    bplib_routetbl_t *rtbl;
+    bp_handle_t       node_intf;
+
+    rtbl = bplib_route_alloc_table(16, 1 << 22);
+    UtAssert_NOT_NULL(rtbl);
+    if (rtbl == NULL)
+    {
+        return NULL;
+    }
+
+    node_intf = bplib_create_node_intf(rtbl, node_num);
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(node_intf));
+    UtAssert_INT32_EQ(
+        bplib_route_intf_set_flags(rtbl, node_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP),
+        BP_SUCCESS);
+
+    return rtbl;
+}
+
+/* Makes a socket bound to local and connected to remote in the node of the routing table */
+static bp_socket_t *socket_cla_test_socket(bplib_routetbl_t *rtbl, const bp_ipn_addr_t *local,
+                                           const bp_ipn_addr_t *remote)
+{
+    bp_socket_t *desc;
+
+    desc = bplib_create_socket(rtbl);
+    UtAssert_NOT_NULL(desc);
+    if (desc != NULL)
+    {
+        UtAssert_INT32_EQ(bplib_bind_socket(desc, local), BP_SUCCESS);
+        UtAssert_INT32_EQ(bplib_connect_socket(desc, remote), BP_SUCCESS);
+    }
+
+    return desc;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void socket_cla_test_setup(void)
+{
+    if (socket_cla_test_rtbl_a != NULL)
+    {
+        return;
+    }
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+
+    socket_cla_test_rtbl_a = socket_cla_test_node(SOCKET_CLA_TEST_NODE_A);
+    socket_cla_test_rtbl_b = socket_cla_test_node(SOCKET_CLA_TEST_NODE_B);
+    if (socket_cla_test_rtbl_a == NULL || socket_cla_test_rtbl_b == NULL)
+    {
+        return;
+    }
+
+    socket_cla_test_desc_a = socket_cla_test_socket(socket_cla_test_rtbl_a, &SOCKET_CLA_TEST_ADDR_A,
+                                                    &SOCKET_CLA_TEST_ADDR_B);
+    socket_cla_test_desc_b = socket_cla_test_socket(socket_cla_test_rtbl_b, &SOCKET_CLA_TEST_ADDR_B,
+                                                    &SOCKET_CLA_TEST_ADDR_A);
+    bplib_route_periodic_maintenance(socket_cla_test_rtbl_a);
+    bplib_route_periodic_maintenance(socket_cla_test_rtbl_b);
+}
+
+void socket_cla_test_config(void)
+{
+    bplib_socket_cla_config_t config;
+
+    if (socket_cla_test_rtbl_a == NULL)
+    {
+        return;
+    }
+
+    /* with neither address there is nothing to bind to, listen at or connect to */
+    memset(&config, 0, sizeof(config));
+    config.flags = BPLIB_SOCKET_CLA_NO_THREAD;
+    UtAssert_NULL(bplib_udp_cla_create(socket_cla_test_rtbl_a, &config));
+    UtAssert_NULL(bplib_tcp_cla_create(socket_cla_test_rtbl_a, &config));
+
+    /* and nothing was left behind to route to */
+    UtAssert_BOOL_FALSE(socket_cla_test_is_up(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B));
+}
+
+void socket_cla_test_udp(void)
+{
+    bplib_socket_cla_config_t config;
+    struct sockaddr_in        addr_a;
+    struct sockaddr_in        addr_b;
+
+    if (socket_cla_test_desc_a == NULL || socket_cla_test_desc_b == NULL)
+    {
+        return;
+    }
+
+    UtAssert_BOOL_TRUE(socket_cla_test_free_port(SOCK_DGRAM, &addr_a));
+    UtAssert_BOOL_TRUE(socket_cla_test_free_port(SOCK_DGRAM, &addr_b));
+
+    /* each side is bound to its own port and sends to the port of the other */
+    memset(&config, 0, sizeof(config));
+    config.flags           = BPLIB_SOCKET_CLA_NO_THREAD;
+    config.local_addr      = (const struct sockaddr *)&addr_a;
+    config.local_addr_len  = sizeof(addr_a);
+    config.remote_addr     = (const struct sockaddr *)&addr_b;
+    config.remote_addr_len = sizeof(addr_b);
+    socket_cla_test_cla_a = bplib_udp_cla_create(socket_cla_test_rtbl_a, &config);
+    socket_cla_test_route(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B, socket_cla_test_cla_a);
+
+    config.local_addr  = (const struct sockaddr *)&addr_b;
+    config.remote_addr = (const struct sockaddr *)&addr_a;
+    socket_cla_test_cla_b = bplib_udp_cla_create(socket_cla_test_rtbl_b, &config);
+    socket_cla_test_route(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A, socket_cla_test_cla_b);
+
+    if (socket_cla_test_cla_a != NULL && socket_cla_test_cla_b != NULL)
+    {
+        /* there is no connection to wait for, so the interfaces are up as soon as they are made */
+        UtAssert_BOOL_TRUE(socket_cla_test_is_up(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B));
+        UtAssert_BOOL_TRUE(socket_cla_test_is_up(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A));
+
+        socket_cla_test_burst(socket_cla_test_desc_a, socket_cla_test_desc_b, 0, "UDP from A to B");
+        socket_cla_test_burst(socket_cla_test_desc_b, socket_cla_test_desc_a, 100, "UDP from B to A");
+    }
+
+    socket_cla_test_destroy_clas();
+    UtAssert_BOOL_FALSE(socket_cla_test_is_up(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B));
+}
+
+void socket_cla_test_tcp(void)
+{
+    bplib_socket_cla_config_t config;
+    struct sockaddr_in        addr_b;
+    int                       listen_fd;
+
+    if (socket_cla_test_desc_a == NULL || socket_cla_test_desc_b == NULL)
+    {
+        return;
+    }
+
+    UtAssert_BOOL_TRUE(socket_cla_test_free_port(SOCK_STREAM, &addr_b));
+
+    /* B listens, and A connects to it */
+    memset(&config, 0, sizeof(config));
+    config.flags          = BPLIB_SOCKET_CLA_NO_THREAD;
+    config.local_addr     = (const struct sockaddr *)&addr_b;
+    config.local_addr_len = sizeof(addr_b);
+    socket_cla_test_cla_b = bplib_tcp_cla_create(socket_cla_test_rtbl_b, &config);
+    socket_cla_test_route(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A, socket_cla_test_cla_b);
+
+    memset(&config, 0, sizeof(config));
+    config.flags           = BPLIB_SOCKET_CLA_NO_THREAD;
+    config.remote_addr     = (const struct sockaddr *)&addr_b;
+    config.remote_addr_len = sizeof(addr_b);
+    socket_cla_test_cla_a = bplib_tcp_cla_create(socket_cla_test_rtbl_a, &config);
+    socket_cla_test_route(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B, socket_cla_test_cla_a);
+
+    if (socket_cla_test_cla_a != NULL && socket_cla_test_cla_b != NULL)
+    {
+        /* neither side is up until the connection is made */
+        listen_fd = bplib_socket_cla_get_fd(socket_cla_test_cla_b);
+        UtAssert_BOOL_FALSE(socket_cla_test_is_up(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B));
+        UtAssert_BOOL_FALSE(socket_cla_test_is_up(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A));
+
+        UtAssert_BOOL_TRUE(socket_cla_test_wait_up(socket_cla_test_rtbl_a, SOCKET_CLA_TEST_NODE_B));
+        UtAssert_BOOL_TRUE(socket_cla_test_wait_up(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A));
+
+        /* once it has accepted, what B waits on is the connection rather than the listening socket */
+        UtAssert_INT32_NEQ(bplib_socket_cla_get_fd(socket_cla_test_cla_b), listen_fd);
+
+        socket_cla_test_burst(socket_cla_test_desc_a, socket_cla_test_desc_b, 200, "TCP from A to B");
+        socket_cla_test_burst(socket_cla_test_desc_b, socket_cla_test_desc_a, 300, "TCP from B to A");
+
+        /* when A goes away, B is down until a new connection comes in, and listens for one */
+        bplib_socket_cla_destroy(socket_cla_test_cla_a);
+        socket_cla_test_cla_a = NULL;
+        UtAssert_BOOL_TRUE(socket_cla_test_wait_listening(socket_cla_test_cla_b, listen_fd));
+        UtAssert_BOOL_FALSE(socket_cla_test_is_up(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A));
+    }
+
+    socket_cla_test_destroy_clas();
+}
+
+void socket_cla_test_tcp_bad_length(void)
+{
+    static const uint32_t bad_lengths[] = {SOCKET_CLA_TEST_SMALL_BUNDLE + 1, 0};
+
+    bplib_socket_cla_config_t config;
+    struct sockaddr_in        addr_b;
+    uint32_t                  header;
+    uint32_t                  tries;
+    uint32_t                  i;
+    ssize_t                   status;
+    uint8_t                   byte;
+    int                       listen_fd;
+    int                       fd;
+
+    if (socket_cla_test_rtbl_b == NULL)
+    {
+        return;
+    }
+
+    UtAssert_BOOL_TRUE(socket_cla_test_free_port(SOCK_STREAM, &addr_b));
+
+    memset(&config, 0, sizeof(config));
+    config.flags           = BPLIB_SOCKET_CLA_NO_THREAD;
+    config.max_bundle_size = SOCKET_CLA_TEST_SMALL_BUNDLE;
+    config.local_addr      = (const struct sockaddr *)&addr_b;
+    config.local_addr_len  = sizeof(addr_b);
+    socket_cla_test_cla_b = bplib_tcp_cla_create(socket_cla_test_rtbl_b, &config);
+    socket_cla_test_route(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A, socket_cla_test_cla_b);
+    if (socket_cla_test_cla_b == NULL)
+    {
+        return;
+    }
+
+    listen_fd = bplib_socket_cla_get_fd(socket_cla_test_cla_b);
+
+    /* a length bigger than the CLA takes, or one with no bundle at all, can only be a peer gone wrong */
+    for (i = 0; i < sizeof(bad_lengths) / sizeof(bad_lengths[0]); ++i)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        UtAssert_True(fd >= 0, "peer socket for length %lu", (unsigned long)bad_lengths[i]);
+        if (fd < 0)
+        {
+            break;
+        }
+
+        UtAssert_INT32_EQ(connect(fd, (const struct sockaddr *)&addr_b, sizeof(addr_b)), 0);
+        UtAssert_BOOL_TRUE(socket_cla_test_wait_up(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A));
+
+        header = htonl(bad_lengths[i]);
+        UtAssert_INT32_EQ(send(fd, &header, sizeof(header), 0), sizeof(header));
+
+        /* the CLA closes its end, which the peer sees as the end of the stream */
+        status = -1;
+        for (tries = 0; tries < SOCKET_CLA_TEST_TRIES && status < 0; ++tries)
+        {
+            socket_cla_test_pump();
+            status = recv(fd, &byte, sizeof(byte), MSG_DONTWAIT);
+            if (status < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                break;
+            }
+            poll(NULL, 0, 1);
+        }
+        UtAssert_True(status == 0, "connection closed after length %lu", (unsigned long)bad_lengths[i]);
+        close(fd);
+
+        /* and goes back to listening, with the interface down */
+        UtAssert_BOOL_TRUE(socket_cla_test_wait_listening(socket_cla_test_cla_b, listen_fd));
+        UtAssert_BOOL_FALSE(socket_cla_test_is_up(socket_cla_test_rtbl_b, SOCKET_CLA_TEST_NODE_A));
+    }
+
+    socket_cla_test_destroy_clas();
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(socket_cla_test_config, socket_cla_test_setup, NULL, "config");
+    UtTest_Add(socket_cla_test_udp, socket_cla_test_setup, NULL, "UDP");
+    UtTest_Add(socket_cla_test_tcp, socket_cla_test_setup, NULL, "TCP");
+    UtTest_Add(socket_cla_test_tcp_bad_length, socket_cla_test_setup, NULL, "TCP bad length");
+}
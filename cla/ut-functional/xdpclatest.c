@@ -0,0 +1,348 @@
+/************************************************************************
+ *
+ *  Behavior test of the framing in the AF_XDP CLA
+ *
+ *  An AF_XDP socket needs a network interface, an XDP program and the
+ *  privileges to load one, none of which a test can count on.  What the
+ *  CLA adds on top of the socket is the Ethernet, IPv4 and UDP headers it
+ *  writes in front of each bundle it sends, and the checks it makes on
+ *  each frame it receives, so those are tested here on frames in memory.
+ *
+ *  Frames built for one end are parsed at the other, and have to give
+ *  back the bundle as it was.  Frames that the XDP program could pass on
+ *  but that are not for this CLA, such as ones to another address or
+ *  port, IP fragments, other protocols and truncated frames, have to be
+ *  left out.  The checks on the configuration are also run, which fail
+ *  before anything is asked of the kernel.
+ *
+ *************************************************************************/
+
+#define _GNU_SOURCE
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_routing.h"
+#include "xdp_cla_internal.h"
+#include "benchutil.h"
+
+#define XDP_CLA_TEST_PORT_A 4556
+#define XDP_CLA_TEST_PORT_B 4557
+
+#define XDP_CLA_TEST_BUNDLE_SIZE 100
+#define XDP_CLA_TEST_IP_ID       0xfffe
+
+/* Ethernet frames shorter than this are padded out, which is not part of the datagram */
+#define XDP_CLA_TEST_MIN_FRAME 60
+
+#define XDP_CLA_TEST_FRAME_SIZE 2048
+
+static const uint8_t XDP_CLA_TEST_MAC_A[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x0a};
+static const uint8_t XDP_CLA_TEST_MAC_B[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x0b};
+
+static bplib_routetbl_t *xdp_cla_test_rtbl;
+
+/* the two ends, A sends to B */
+static bplib_xdp_cla_t xdp_cla_test_end_a;
+static bplib_xdp_cla_t xdp_cla_test_end_b;
+
+static uint8_t xdp_cla_test_frame[XDP_CLA_TEST_FRAME_SIZE];
+static uint8_t xdp_cla_test_copy[XDP_CLA_TEST_FRAME_SIZE];
+static size_t  xdp_cla_test_frame_len;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static uint16_t xdp_cla_test_get16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void xdp_cla_test_put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static void xdp_cla_test_set_addr(struct sockaddr_in *addr, const char *ip, uint16_t port)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port   = htons(port);
+    inet_pton(AF_INET, ip, &addr->sin_addr);
+}
+
+/* Sets up the two ends, as bplib_xdp_cla_create() would from their configs */
+static void xdp_cla_test_ends(void)
+{
+    memset(&xdp_cla_test_end_a, 0, sizeof(xdp_cla_test_end_a));
+    xdp_cla_test_set_addr(&xdp_cla_test_end_a.local_addr, "10.1.0.1", XDP_CLA_TEST_PORT_A);
+    xdp_cla_test_set_addr(&xdp_cla_test_end_a.remote_addr, "10.1.0.2", XDP_CLA_TEST_PORT_B);
+    memcpy(xdp_cla_test_end_a.local_mac, XDP_CLA_TEST_MAC_A, sizeof(XDP_CLA_TEST_MAC_A));
+    memcpy(xdp_cla_test_end_a.remote_mac, XDP_CLA_TEST_MAC_B, sizeof(XDP_CLA_TEST_MAC_B));
+    xdp_cla_test_end_a.ip_id    = XDP_CLA_TEST_IP_ID;
+    xdp_cla_test_end_a.can_send = true;
+
+    memset(&xdp_cla_test_end_b, 0, sizeof(xdp_cla_test_end_b));
+    xdp_cla_test_set_addr(&xdp_cla_test_end_b.local_addr, "10.1.0.2", XDP_CLA_TEST_PORT_B);
+    memcpy(xdp_cla_test_end_b.local_mac, XDP_CLA_TEST_MAC_B, sizeof(XDP_CLA_TEST_MAC_B));
+}
+
+/* Builds the frame that A sends with a bundle of the given size in it, which is its size in each byte */
+static void xdp_cla_test_build(size_t size)
+{
+    memset(xdp_cla_test_frame, 0xee, sizeof(xdp_cla_test_frame));
+    memset(&xdp_cla_test_frame[BPLIB_XDP_CLA_HDR_SIZE], (int)size, size);
+    bplib_xdp_cla_build_headers(&xdp_cla_test_end_a, xdp_cla_test_frame, size);
+    xdp_cla_test_frame_len = BPLIB_XDP_CLA_HDR_SIZE + size;
+}
+
+/* The ones complement sum of the IPv4 header, which is all ones if the checksum in it is right */
+static uint16_t xdp_cla_test_ip_sum(const uint8_t *ip, size_t hlen)
+{
+    uint32_t sum;
+    size_t   i;
+
+    sum = 0;
+    for (i = 0; i < hlen; i += 2)
+    {
+        sum += xdp_cla_test_get16(&ip[i]);
+    }
+    while (sum > 0xffff)
+    {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+
+    return (uint16_t)sum;
+}
+
+/* Checks that B leaves out the frame after one byte of it is changed */
+static void xdp_cla_test_reject_byte(const char *what, size_t offset, uint8_t value)
+{
+    bplib_cla_bundle_buf_t bundle;
+
+    memcpy(xdp_cla_test_copy, xdp_cla_test_frame, xdp_cla_test_frame_len);
+    xdp_cla_test_copy[offset] = value;
+    UtAssert_True(!bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_copy, xdp_cla_test_frame_len, &bundle),
+                  "frame with %s is left out", what);
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void xdp_cla_test_setup(void)
+{
+    if (xdp_cla_test_rtbl == NULL)
+    {
+        UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+        UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+        UtAssert_NOT_NULL(xdp_cla_test_rtbl = bplib_route_alloc_table(16, 1 << 20));
+    }
+
+    xdp_cla_test_ends();
+}
+
+void xdp_cla_test_config(void)
+{
+    bplib_xdp_cla_config_t good;
+    bplib_xdp_cla_config_t config;
+
+    if (xdp_cla_test_rtbl == NULL)
+    {
+        return;
+    }
+
+    memset(&good, 0, sizeof(good));
+    good.ifname     = "bplib-xdptest0";
+    good.flags      = BPLIB_XDP_CLA_NO_THREAD;
+    good.xsk_map_fd = -1;
+    xdp_cla_test_set_addr(&good.local_addr, "10.1.0.1", XDP_CLA_TEST_PORT_A);
+
+    config        = good;
+    config.ifname = NULL;
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &config));
+
+    /* only IPv4 is carried */
+    config                       = good;
+    config.local_addr.sin_family = AF_INET6;
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &config));
+
+    config                        = good;
+    config.remote_addr.sin_family = AF_INET6;
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &config));
+
+    /* the frames are split in two halves for the rings, which are indexed by masking */
+    config             = good;
+    config.frame_count = 3 * BPLIB_XDP_CLA_MIN_FRAMES;
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &config));
+
+    config             = good;
+    config.frame_count = BPLIB_XDP_CLA_MIN_FRAMES / 2;
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &config));
+
+    config            = good;
+    config.frame_size = 1024;
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &config));
+
+    /* and a config that is right still needs the interface to be there */
+    UtAssert_NULL(bplib_xdp_cla_create(xdp_cla_test_rtbl, &good));
+}
+
+void xdp_cla_test_build_headers(void)
+{
+    const uint8_t *ip;
+    const uint8_t *udp;
+    uint8_t        expect[XDP_CLA_TEST_BUNDLE_SIZE];
+
+    xdp_cla_test_build(XDP_CLA_TEST_BUNDLE_SIZE);
+
+    /* Ethernet, to the next hop and with the IPv4 type */
+    UtAssert_MemCmp(&xdp_cla_test_frame[0], XDP_CLA_TEST_MAC_B, 6, "destination MAC");
+    UtAssert_MemCmp(&xdp_cla_test_frame[6], XDP_CLA_TEST_MAC_A, 6, "source MAC");
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&xdp_cla_test_frame[12]), BPLIB_XDP_CLA_ETHERTYPE_IPV4);
+
+    /* IPv4 with no options, not to be fragmented, and a checksum that adds up */
+    ip = &xdp_cla_test_frame[BPLIB_XDP_CLA_ETH_HLEN];
+    UtAssert_UINT32_EQ(ip[0], 0x45);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&ip[2]),
+                       BPLIB_XDP_CLA_IP_HLEN + BPLIB_XDP_CLA_UDP_HLEN + XDP_CLA_TEST_BUNDLE_SIZE);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&ip[4]), XDP_CLA_TEST_IP_ID);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&ip[6]), BPLIB_XDP_CLA_IP_DF);
+    UtAssert_UINT32_EQ(ip[8], BPLIB_XDP_CLA_IP_TTL);
+    UtAssert_UINT32_EQ(ip[9], IPPROTO_UDP);
+    UtAssert_MemCmp(&ip[12], &xdp_cla_test_end_a.local_addr.sin_addr, 4, "source address");
+    UtAssert_MemCmp(&ip[16], &xdp_cla_test_end_a.remote_addr.sin_addr, 4, "destination address");
+    UtAssert_UINT32_EQ(xdp_cla_test_ip_sum(ip, BPLIB_XDP_CLA_IP_HLEN), 0xffff);
+
+    /* UDP between the two ports, with no checksum */
+    udp = &ip[BPLIB_XDP_CLA_IP_HLEN];
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&udp[0]), XDP_CLA_TEST_PORT_A);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&udp[2]), XDP_CLA_TEST_PORT_B);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&udp[4]), BPLIB_XDP_CLA_UDP_HLEN + XDP_CLA_TEST_BUNDLE_SIZE);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&udp[6]), 0);
+
+    /* the bundle that was already there is left as it was */
+    memset(expect, XDP_CLA_TEST_BUNDLE_SIZE, sizeof(expect));
+    UtAssert_MemCmp(&udp[BPLIB_XDP_CLA_UDP_HLEN], expect, sizeof(expect), "bundle after the headers");
+
+    /* each datagram has its own IP id, which wraps around, and the checksum follows it */
+    xdp_cla_test_build(XDP_CLA_TEST_BUNDLE_SIZE);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&ip[4]), XDP_CLA_TEST_IP_ID + 1);
+    UtAssert_UINT32_EQ(xdp_cla_test_ip_sum(ip, BPLIB_XDP_CLA_IP_HLEN), 0xffff);
+    xdp_cla_test_build(XDP_CLA_TEST_BUNDLE_SIZE);
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&ip[4]), 0);
+    UtAssert_UINT32_EQ(xdp_cla_test_ip_sum(ip, BPLIB_XDP_CLA_IP_HLEN), 0xffff);
+}
+
+void xdp_cla_test_parse(void)
+{
+    bplib_cla_bundle_buf_t bundle;
+    uint8_t               *ip;
+    size_t                 size;
+
+    /* a range of sizes, from one that gets padded on the wire to one that fills a frame */
+    for (size = 1; size <= (XDP_CLA_TEST_FRAME_SIZE - BPLIB_XDP_CLA_HDR_SIZE); size = (size * 3) + 1)
+    {
+        xdp_cla_test_build(size);
+        if (xdp_cla_test_frame_len < XDP_CLA_TEST_MIN_FRAME)
+        {
+            xdp_cla_test_frame_len = XDP_CLA_TEST_MIN_FRAME;
+        }
+
+        memset(&bundle, 0, sizeof(bundle));
+        UtAssert_True(bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, xdp_cla_test_frame_len, &bundle),
+                      "frame with a bundle of %lu bytes is taken in", (unsigned long)size);
+        UtAssert_ADDRESS_EQ(bundle.bundle, &xdp_cla_test_frame[BPLIB_XDP_CLA_HDR_SIZE]);
+        UtAssert_UINT32_EQ(bundle.size, size);
+    }
+
+    /* bound to any address, only the port has to match */
+    xdp_cla_test_build(XDP_CLA_TEST_BUNDLE_SIZE);
+    xdp_cla_test_end_b.local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    UtAssert_BOOL_TRUE(bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, xdp_cla_test_frame_len, &bundle));
+
+    /* the bundle comes after any IP options */
+    ip = &xdp_cla_test_frame[BPLIB_XDP_CLA_ETH_HLEN];
+    memmove(&ip[BPLIB_XDP_CLA_IP_HLEN + 4], &ip[BPLIB_XDP_CLA_IP_HLEN],
+            BPLIB_XDP_CLA_UDP_HLEN + XDP_CLA_TEST_BUNDLE_SIZE);
+    memset(&ip[BPLIB_XDP_CLA_IP_HLEN], 1, 4); /* NOP options */
+    ip[0] = 0x46;
+    xdp_cla_test_put16(&ip[2], BPLIB_XDP_CLA_IP_HLEN + 4 + BPLIB_XDP_CLA_UDP_HLEN + XDP_CLA_TEST_BUNDLE_SIZE);
+    xdp_cla_test_frame_len += 4;
+
+    memset(&bundle, 0, sizeof(bundle));
+    UtAssert_BOOL_TRUE(bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, xdp_cla_test_frame_len, &bundle));
+    UtAssert_ADDRESS_EQ(bundle.bundle, &xdp_cla_test_frame[BPLIB_XDP_CLA_HDR_SIZE + 4]);
+    UtAssert_UINT32_EQ(bundle.size, XDP_CLA_TEST_BUNDLE_SIZE);
+}
+
+void xdp_cla_test_reject(void)
+{
+    bplib_cla_bundle_buf_t bundle;
+    uint8_t               *ip;
+    size_t                 ip_pos;
+    size_t                 udp_pos;
+
+    ip_pos  = BPLIB_XDP_CLA_ETH_HLEN;
+    udp_pos = ip_pos + BPLIB_XDP_CLA_IP_HLEN;
+
+    xdp_cla_test_build(XDP_CLA_TEST_BUNDLE_SIZE);
+    UtAssert_BOOL_TRUE(bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, xdp_cla_test_frame_len, &bundle));
+
+    /* not IPv4 over Ethernet, or not a header that can be followed */
+    xdp_cla_test_reject_byte("an IPv6 ethertype", 12, 0x86);
+    xdp_cla_test_reject_byte("IP version 6", ip_pos, 0x65);
+    xdp_cla_test_reject_byte("an IP header length of 16", ip_pos, 0x44);
+    xdp_cla_test_reject_byte("TCP rather than UDP", ip_pos + 9, IPPROTO_TCP);
+
+    /* fragments, which cannot be put back together here */
+    xdp_cla_test_reject_byte("more fragments set", ip_pos + 6, 0x20);
+    xdp_cla_test_reject_byte("a fragment offset", ip_pos + 7, 0x01);
+
+    /* not to this end */
+    xdp_cla_test_reject_byte("another destination address", ip_pos + 19, 0x03);
+    xdp_cla_test_reject_byte("another destination port", udp_pos + 3, (uint8_t)(XDP_CLA_TEST_PORT_A & 0xff));
+
+    /* lengths that do not fit together */
+    xdp_cla_test_reject_byte("an IP length longer than the frame", ip_pos + 2, 0x01);
+    xdp_cla_test_reject_byte("an IP length too short for the UDP header", ip_pos + 3, BPLIB_XDP_CLA_IP_HLEN + 4);
+    xdp_cla_test_reject_byte("a UDP length longer than the IP payload", udp_pos + 4, 0x01);
+    xdp_cla_test_reject_byte("an empty UDP datagram", udp_pos + 5, BPLIB_XDP_CLA_UDP_HLEN);
+
+    /* and frames cut short, down to ones without room for the headers */
+    ip = &xdp_cla_test_frame[ip_pos];
+    UtAssert_UINT32_EQ(xdp_cla_test_get16(&ip[2]), xdp_cla_test_frame_len - BPLIB_XDP_CLA_ETH_HLEN);
+    UtAssert_BOOL_FALSE(
+        bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, xdp_cla_test_frame_len - 1, &bundle));
+    UtAssert_BOOL_FALSE(
+        bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, BPLIB_XDP_CLA_HDR_SIZE - 1, &bundle));
+    UtAssert_BOOL_FALSE(bplib_xdp_cla_parse(&xdp_cla_test_end_b, xdp_cla_test_frame, 0, &bundle));
+
+    /* and A does not take in what it sent itself */
+    UtAssert_BOOL_FALSE(bplib_xdp_cla_parse(&xdp_cla_test_end_a, xdp_cla_test_frame, xdp_cla_test_frame_len, &bundle));
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(xdp_cla_test_config, xdp_cla_test_setup, NULL, "config");
+    UtTest_Add(xdp_cla_test_build_headers, xdp_cla_test_setup, NULL, "build headers");
+    UtTest_Add(xdp_cla_test_parse, xdp_cla_test_setup, NULL, "parse");
+    UtTest_Add(xdp_cla_test_reject, xdp_cla_test_setup, NULL, "reject");
+}
@@ -0,0 +1,717 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+/* MAP_POPULATE and syscall() are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "xdp_cla_internal.h"
+
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_get16 - reads a field in network byte order
+ *-------------------------------------------------------------------------------------*/
+static inline uint16_t bplib_xdp_cla_get16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_put16 - writes a field in network byte order
+ *-------------------------------------------------------------------------------------*/
+static inline void bplib_xdp_cla_put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_kick - tells the kernel that there is something in the TX ring
+ *
+ * Only needed while the ring has XDP_RING_NEED_WAKEUP set.  EAGAIN and ENOBUFS only mean
+ * that the kernel is still busy with the ring, and it is asked again next time.
+ *-------------------------------------------------------------------------------------*/
+static void bplib_xdp_cla_kick(bplib_xdp_cla_t *cla)
+{
+    (void)sendto(cla->sys_fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_parse - finds the bundle in a received frame
+ *
+ * Returns false for anything other than an unfragmented UDP datagram to the local address
+ * and port, which the XDP program may also have passed on.
+ *-------------------------------------------------------------------------------------*/
+bool bplib_xdp_cla_parse(const bplib_xdp_cla_t *cla, const uint8_t *frame, uint32_t len,
+                         bplib_cla_bundle_buf_t *bundle)
+{
+    const uint8_t *ip;
+    const uint8_t *udp;
+    size_t         ip_hlen;
+    size_t         ip_len;
+    size_t         udp_len;
+
+    if (len < BPLIB_XDP_CLA_HDR_SIZE || bplib_xdp_cla_get16(&frame[12]) != BPLIB_XDP_CLA_ETHERTYPE_IPV4)
+    {
+        return false;
+    }
+
+    ip      = &frame[BPLIB_XDP_CLA_ETH_HLEN];
+    ip_hlen = (ip[0] & 0x0f) * 4;
+    ip_len  = bplib_xdp_cla_get16(&ip[2]);
+    if ((ip[0] >> 4) != 4 || ip_hlen < BPLIB_XDP_CLA_IP_HLEN || ip_len < (ip_hlen + BPLIB_XDP_CLA_UDP_HLEN) ||
+        ip_len > (len - BPLIB_XDP_CLA_ETH_HLEN) || ip[9] != IPPROTO_UDP ||
+        (bplib_xdp_cla_get16(&ip[6]) & BPLIB_XDP_CLA_IP_FRAG_MASK) != 0)
+    {
+        return false;
+    }
+
+    if (cla->local_addr.sin_addr.s_addr != htonl(INADDR_ANY) &&
+        memcmp(&ip[16], &cla->local_addr.sin_addr, sizeof(cla->local_addr.sin_addr)) != 0)
+    {
+        return false;
+    }
+
+    udp     = &ip[ip_hlen];
+    udp_len = bplib_xdp_cla_get16(&udp[4]);
+    if (memcmp(&udp[2], &cla->local_addr.sin_port, sizeof(cla->local_addr.sin_port)) != 0 ||
+        udp_len <= BPLIB_XDP_CLA_UDP_HLEN || udp_len > (ip_len - ip_hlen))
+    {
+        return false;
+    }
+
+    bundle->bundle = &udp[BPLIB_XDP_CLA_UDP_HLEN];
+    bundle->size   = udp_len - BPLIB_XDP_CLA_UDP_HLEN;
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_build_headers - writes the Ethernet, IPv4 and UDP headers in front of a bundle
+ *-------------------------------------------------------------------------------------*/
+void bplib_xdp_cla_build_headers(bplib_xdp_cla_t *cla, uint8_t *frame, size_t size)
+{
+    uint8_t *ip;
+    uint8_t *udp;
+    uint32_t sum;
+    uint32_t i;
+
+    memcpy(&frame[0], cla->remote_mac, sizeof(cla->remote_mac));
+    memcpy(&frame[6], cla->local_mac, sizeof(cla->local_mac));
+    bplib_xdp_cla_put16(&frame[12], BPLIB_XDP_CLA_ETHERTYPE_IPV4);
+
+    ip    = &frame[BPLIB_XDP_CLA_ETH_HLEN];
+    ip[0] = 0x45; /* version 4, no options */
+    ip[1] = 0;
+    bplib_xdp_cla_put16(&ip[2], BPLIB_XDP_CLA_IP_HLEN + BPLIB_XDP_CLA_UDP_HLEN + size);
+    bplib_xdp_cla_put16(&ip[4], cla->ip_id);
+    bplib_xdp_cla_put16(&ip[6], BPLIB_XDP_CLA_IP_DF);
+    ip[8] = BPLIB_XDP_CLA_IP_TTL;
+    ip[9] = IPPROTO_UDP;
+    bplib_xdp_cla_put16(&ip[10], 0);
+    memcpy(&ip[12], &cla->local_addr.sin_addr, sizeof(cla->local_addr.sin_addr));
+    memcpy(&ip[16], &cla->remote_addr.sin_addr, sizeof(cla->remote_addr.sin_addr));
+    ++cla->ip_id;
+
+    sum = 0;
+    for (i = 0; i < BPLIB_XDP_CLA_IP_HLEN; i += 2)
+    {
+        sum += bplib_xdp_cla_get16(&ip[i]);
+    }
+    while (sum > 0xffff)
+    {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    bplib_xdp_cla_put16(&ip[10], (uint16_t)~sum);
+
+    /* no UDP checksum, which IPv4 allows */
+    udp = &ip[BPLIB_XDP_CLA_IP_HLEN];
+    memcpy(&udp[0], &cla->local_addr.sin_port, sizeof(cla->local_addr.sin_port));
+    memcpy(&udp[2], &cla->remote_addr.sin_port, sizeof(cla->remote_addr.sin_port));
+    bplib_xdp_cla_put16(&udp[4], BPLIB_XDP_CLA_UDP_HLEN + size);
+    bplib_xdp_cla_put16(&udp[6], 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_receive - takes in what is in the RX ring, up to the batch size
+ *
+ * Returns true if there was anything
+ *-------------------------------------------------------------------------------------*/
+static bool bplib_xdp_cla_receive(bplib_xdp_cla_t *cla)
+{
+    const struct xdp_desc *descs;
+    uint64_t              *fill_addrs;
+    uint32_t               cons;
+    uint32_t               prod;
+    uint32_t               avail;
+    uint32_t               count;
+    uint32_t               idx;
+    uint32_t               i;
+
+    descs = cla->rx.desc;
+    cons  = *cla->rx.consumer;
+    avail = __atomic_load_n(cla->rx.producer, __ATOMIC_ACQUIRE) - cons;
+    if (avail == 0)
+    {
+        return false;
+    }
+    if (avail > cla->batch_size)
+    {
+        avail = cla->batch_size;
+    }
+
+    count = 0;
+    for (i = 0; i < avail; ++i)
+    {
+        idx = (cons + i) & cla->rx.mask;
+        if (bplib_xdp_cla_parse(cla, &cla->umem[descs[idx].addr], descs[idx].len, &cla->bundles[count]))
+        {
+            ++count;
+        }
+    }
+
+    /* the bundles are copied into the pool here, so a datagram that does not get in is dropped */
+    if (count > 0)
+    {
+        bplib_cla_ingress_batch(cla->rtbl, cla->intf_id, cla->bundles, count, cla->status_list,
+                                BPLIB_XDP_CLA_WAIT_MSEC);
+    }
+
+    /* so the frames go straight back to the fill ring, at the start of the frame */
+    fill_addrs = cla->fill.desc;
+    prod       = *cla->fill.producer;
+    for (i = 0; i < avail; ++i)
+    {
+        idx                                     = (cons + i) & cla->rx.mask;
+        fill_addrs[(prod + i) & cla->fill.mask] = descs[idx].addr & ~(uint64_t)(cla->frame_size - 1);
+    }
+    __atomic_store_n(cla->rx.consumer, cons + avail, __ATOMIC_RELEASE);
+    __atomic_store_n(cla->fill.producer, prod + avail, __ATOMIC_RELEASE);
+
+    if ((*cla->fill.flags & XDP_RING_NEED_WAKEUP) != 0)
+    {
+        (void)recvfrom(cla->sys_fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_send - sends whatever bundles are ready, up to the batch size
+ *
+ * Returns true if anything was sent
+ *-------------------------------------------------------------------------------------*/
+static bool bplib_xdp_cla_send(bplib_xdp_cla_t *cla)
+{
+    struct xdp_desc *descs;
+    const uint64_t  *comp_addrs;
+    uint64_t         addr;
+    uint32_t         cons;
+    uint32_t         prod;
+    uint32_t         avail;
+    uint32_t         count;
+    uint32_t         num_filled;
+    uint32_t         idx;
+    uint32_t         i;
+    int              status;
+
+    /* frames that the kernel is done with are free again */
+    comp_addrs = cla->comp.desc;
+    cons       = *cla->comp.consumer;
+    avail      = __atomic_load_n(cla->comp.producer, __ATOMIC_ACQUIRE) - cons;
+    for (i = 0; i < avail; ++i)
+    {
+        cla->tx_free[cla->tx_free_count] = comp_addrs[(cons + i) & cla->comp.mask];
+        ++cla->tx_free_count;
+    }
+    __atomic_store_n(cla->comp.consumer, cons + avail, __ATOMIC_RELEASE);
+
+    count = cla->tx_free_count;
+    if (count > cla->batch_size)
+    {
+        count = cla->batch_size;
+    }
+    if (count == 0)
+    {
+        /* they are all still in the TX ring, which the kernel may need to be asked to get on with */
+        bplib_xdp_cla_kick(cla);
+        cla->egress_held = true;
+        return false;
+    }
+
+    /* the bundles are encoded straight into the frames, after the room for the headers */
+    for (i = 0; i < count; ++i)
+    {
+        addr                       = cla->tx_free[cla->tx_free_count - 1 - i];
+        cla->egress_bufs[i].bundle = &cla->umem[addr + BPLIB_XDP_CLA_HDR_SIZE];
+        cla->egress_bufs[i].size   = cla->frame_size - BPLIB_XDP_CLA_HDR_SIZE;
+    }
+
+    num_filled = 0;
+    status     = bplib_cla_egress_batch(cla->rtbl, cla->intf_id, cla->egress_bufs, count, &num_filled, 0);
+    cla->egress_held = (status != BP_SUCCESS);
+    if (status != BP_SUCCESS)
+    {
+        return false;
+    }
+
+    descs = cla->tx.desc;
+    prod  = *cla->tx.producer;
+    for (i = 0; i < num_filled; ++i)
+    {
+        addr = cla->tx_free[cla->tx_free_count - 1 - i];
+        bplib_xdp_cla_build_headers(cla, &cla->umem[addr], cla->egress_bufs[i].size);
+
+        idx                = (prod + i) & cla->tx.mask;
+        descs[idx].addr    = addr;
+        descs[idx].len     = BPLIB_XDP_CLA_HDR_SIZE + cla->egress_bufs[i].size;
+        descs[idx].options = 0;
+    }
+    cla->tx_free_count -= num_filled;
+    __atomic_store_n(cla->tx.producer, prod + num_filled, __ATOMIC_RELEASE);
+
+    if ((*cla->tx.flags & XDP_RING_NEED_WAKEUP) != 0)
+    {
+        bplib_xdp_cla_kick(cla);
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_map_ring - maps one of the rings of the socket
+ *-------------------------------------------------------------------------------------*/
+static int bplib_xdp_cla_map_ring(bplib_xdp_cla_t *cla, bplib_xdp_cla_ring_t *ring, const struct xdp_ring_offset *off,
+                                  size_t entry_size, off_t pgoff)
+{
+    uint8_t *base;
+    uint32_t ring_size;
+
+    ring_size      = cla->frame_count / 2;
+    ring->map_size = off->desc + (ring_size * entry_size);
+    ring->map      = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, cla->sys_fd, pgoff);
+    if (ring->map == MAP_FAILED)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to map AF_XDP ring: %s\n", strerror(errno));
+        ring->map = NULL;
+        return BP_ERROR;
+    }
+
+    base           = ring->map;
+    ring->producer = (uint32_t *)&base[off->producer];
+    ring->consumer = (uint32_t *)&base[off->consumer];
+    ring->flags    = (uint32_t *)&base[off->flags];
+    ring->desc     = &base[off->desc];
+    ring->mask     = ring_size - 1;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_open - sets up the UMEM and the rings and binds the socket to the queue
+ *-------------------------------------------------------------------------------------*/
+static int bplib_xdp_cla_open(bplib_xdp_cla_t *cla, const char *ifname, uint32_t queue_id)
+{
+    struct xdp_umem_reg     umem_reg;
+    struct xdp_mmap_offsets off;
+    struct sockaddr_xdp     sxdp;
+    socklen_t               optlen;
+    unsigned int            ifindex;
+    uint64_t               *fill_addrs;
+    int                     ring_size;
+    uint32_t                i;
+
+    ifindex = if_nametoindex(ifname);
+    if (ifindex == 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unknown network interface %s\n", ifname);
+        return BP_ERROR;
+    }
+
+    cla->sys_fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (cla->sys_fd < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "socket(AF_XDP) failed: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    cla->umem_size = (size_t)cla->frame_count * cla->frame_size;
+    cla->umem      = mmap(NULL, cla->umem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (cla->umem == MAP_FAILED)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate AF_XDP UMEM\n");
+        cla->umem = NULL;
+        return BP_ERROR;
+    }
+
+    memset(&umem_reg, 0, sizeof(umem_reg));
+    umem_reg.addr       = (uintptr_t)cla->umem;
+    umem_reg.len        = cla->umem_size;
+    umem_reg.chunk_size = cla->frame_size;
+
+    ring_size = cla->frame_count / 2;
+    if (setsockopt(cla->sys_fd, SOL_XDP, XDP_UMEM_REG, &umem_reg, sizeof(umem_reg)) < 0 ||
+        setsockopt(cla->sys_fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(cla->sys_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(cla->sys_fd, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) < 0 ||
+        setsockopt(cla->sys_fd, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to set up AF_XDP UMEM and rings: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    optlen = sizeof(off);
+    if (getsockopt(cla->sys_fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to get AF_XDP ring offsets: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    if (bplib_xdp_cla_map_ring(cla, &cla->rx, &off.rx, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) != BP_SUCCESS ||
+        bplib_xdp_cla_map_ring(cla, &cla->tx, &off.tx, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING) != BP_SUCCESS ||
+        bplib_xdp_cla_map_ring(cla, &cla->fill, &off.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) != BP_SUCCESS ||
+        bplib_xdp_cla_map_ring(cla, &cla->comp, &off.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) !=
+            BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family   = AF_XDP;
+    sxdp.sxdp_ifindex  = ifindex;
+    sxdp.sxdp_queue_id = queue_id;
+    sxdp.sxdp_flags    = XDP_USE_NEED_WAKEUP;
+    if ((cla->flags & BPLIB_XDP_CLA_ZEROCOPY) != 0)
+    {
+        sxdp.sxdp_flags |= XDP_ZEROCOPY;
+    }
+
+    if (bind(cla->sys_fd, (const struct sockaddr *)&sxdp, sizeof(sxdp)) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "bind() to %s queue %lu failed: %s\n", ifname, (unsigned long)queue_id,
+              strerror(errno));
+        return BP_ERROR;
+    }
+
+    /* the receive half of the frames all start out with the kernel */
+    fill_addrs = cla->fill.desc;
+    for (i = 0; i < ring_size; ++i)
+    {
+        fill_addrs[i] = (uint64_t)i * cla->frame_size;
+    }
+    __atomic_store_n(cla->fill.producer, ring_size, __ATOMIC_RELEASE);
+
+    for (i = 0; i < ring_size; ++i)
+    {
+        cla->tx_free[i] = (uint64_t)(ring_size + i) * cla->frame_size;
+    }
+    cla->tx_free_count = ring_size;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_map_insert - puts the socket in the XSKMAP of the XDP program
+ *
+ * It comes back out of the map by itself when the socket is closed.
+ *-------------------------------------------------------------------------------------*/
+static int bplib_xdp_cla_map_insert(bplib_xdp_cla_t *cla, int map_fd, uint32_t queue_id)
+{
+    union bpf_attr attr;
+    uint32_t       key;
+    uint32_t       value;
+
+    key   = queue_id;
+    value = cla->sys_fd;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key    = (uintptr_t)&key;
+    attr.value  = (uintptr_t)&value;
+    attr.flags  = BPF_ANY;
+
+    if (syscall(__NR_bpf, BPF_MAP_UPDATE_ELEM, &attr, sizeof(attr)) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to put the AF_XDP socket in the XSKMAP: %s\n", strerror(errno));
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_xdp_cla_entry - the I/O thread of a CLA
+ *-------------------------------------------------------------------------------------*/
+static void bplib_xdp_cla_entry(void *arg)
+{
+    bplib_xdp_cla_t *cla = arg;
+
+    while (cla->running)
+    {
+        bplib_xdp_cla_process(cla, BPLIB_XDP_CLA_WAIT_MSEC);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_xdp_cla_process
+ *----------------------------------------------------------------------------*/
+int bplib_xdp_cla_process(bplib_xdp_cla_t *cla, uint32_t timeout)
+{
+    struct pollfd pfd[2];
+    bool          egress_held;
+    bool          progress;
+
+    /* without the fd, the egress call is tried after every wait, and while held back every ms */
+    egress_held = (cla->can_send && (cla->egress_held || cla->notify_fd < 0));
+    if (cla->can_send && cla->egress_held && timeout > 1)
+    {
+        timeout = 1;
+    }
+
+    /* a poll of the socket also wakes the driver up for the fill ring, if it needs that */
+    pfd[0].fd      = cla->sys_fd;
+    pfd[0].events  = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd      = -1;
+    pfd[1].events  = POLLIN;
+    pfd[1].revents = 0;
+    if (cla->can_send && !egress_held)
+    {
+        pfd[1].fd = cla->notify_fd;
+    }
+
+    if (poll(pfd, 2, timeout) < 0)
+    {
+        pfd[0].revents = 0;
+        pfd[1].revents = 0;
+    }
+
+    progress = false;
+    if ((pfd[0].revents & POLLIN) != 0)
+    {
+        progress = bplib_xdp_cla_receive(cla);
+    }
+    if (egress_held || (pfd[1].revents & POLLIN) != 0)
+    {
+        progress = bplib_xdp_cla_send(cla) || progress;
+    }
+
+    if (!progress)
+    {
+        return BP_TIMEOUT;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_xdp_cla_destroy
+ *----------------------------------------------------------------------------*/
+void bplib_xdp_cla_destroy(bplib_xdp_cla_t *cla)
+{
+    bplib_xdp_cla_ring_t *rings[4];
+    uint32_t              i;
+
+    if (cla == NULL)
+    {
+        return;
+    }
+
+    cla->running = false;
+    if (cla->thread != NULL)
+    {
+        bplib_os_thread_join(cla->thread);
+    }
+
+    if (bp_handle_is_valid(cla->intf_id))
+    {
+        bplib_route_del_intf(cla->rtbl, cla->intf_id);
+    }
+
+    rings[0] = &cla->rx;
+    rings[1] = &cla->tx;
+    rings[2] = &cla->fill;
+    rings[3] = &cla->comp;
+    for (i = 0; i < 4; ++i)
+    {
+        if (rings[i]->map != NULL)
+        {
+            munmap(rings[i]->map, rings[i]->map_size);
+        }
+    }
+
+    /* the UMEM stays with the kernel until the socket is closed */
+    if (cla->sys_fd >= 0)
+    {
+        close(cla->sys_fd);
+    }
+    if (cla->umem != NULL)
+    {
+        munmap(cla->umem, cla->umem_size);
+    }
+
+    bplib_os_free(cla->tx_free);
+    bplib_os_free(cla->bundles);
+    bplib_os_free(cla->status_list);
+    bplib_os_free(cla->egress_bufs);
+    bplib_os_free(cla);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_xdp_cla_create
+ *----------------------------------------------------------------------------*/
+bplib_xdp_cla_t *bplib_xdp_cla_create(bplib_routetbl_t *rtbl, const bplib_xdp_cla_config_t *config)
+{
+    bplib_xdp_cla_t *cla;
+    uint32_t         frame_count;
+    uint32_t         frame_size;
+
+    frame_count = config->frame_count;
+    if (frame_count == 0)
+    {
+        frame_count = BPLIB_XDP_CLA_DEFAULT_FRAMES;
+    }
+
+    frame_size = config->frame_size;
+    if (frame_size == 0)
+    {
+        frame_size = BPLIB_XDP_CLA_DEFAULT_FRAME_SIZE;
+    }
+
+    if (config->ifname == NULL || config->local_addr.sin_family != AF_INET ||
+        (config->remote_addr.sin_family != AF_INET && config->remote_addr.sin_family != 0) ||
+        frame_count < BPLIB_XDP_CLA_MIN_FRAMES || (frame_count & (frame_count - 1)) != 0 ||
+        (frame_size != 2048 && frame_size != 4096))
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Invalid AF_XDP CLA config\n");
+        return NULL;
+    }
+
+    cla = bplib_os_calloc(sizeof(*cla));
+    if (cla == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate AF_XDP CLA\n");
+        return NULL;
+    }
+
+    cla->rtbl        = rtbl;
+    cla->intf_id     = BP_INVALID_HANDLE;
+    cla->notify_fd   = -1;
+    cla->sys_fd      = -1;
+    cla->flags       = config->flags;
+    cla->frame_count = frame_count;
+    cla->frame_size  = frame_size;
+    cla->local_addr  = config->local_addr;
+    cla->remote_addr = config->remote_addr;
+    cla->can_send    = (config->remote_addr.sin_family == AF_INET);
+    memcpy(cla->local_mac, config->local_mac, sizeof(cla->local_mac));
+    memcpy(cla->remote_mac, config->remote_mac, sizeof(cla->remote_mac));
+
+    cla->batch_size = config->batch_size;
+    if (cla->batch_size == 0)
+    {
+        cla->batch_size = BPLIB_XDP_CLA_DEFAULT_BATCH;
+    }
+    if (cla->batch_size > (frame_count / 2))
+    {
+        cla->batch_size = frame_count / 2;
+    }
+
+    cla->tx_free     = bplib_os_calloc((frame_count / 2) * sizeof(*cla->tx_free));
+    cla->bundles     = bplib_os_calloc(cla->batch_size * sizeof(*cla->bundles));
+    cla->status_list = bplib_os_calloc(cla->batch_size * sizeof(*cla->status_list));
+    cla->egress_bufs = bplib_os_calloc(cla->batch_size * sizeof(*cla->egress_bufs));
+    if (cla->tx_free == NULL || cla->bundles == NULL || cla->status_list == NULL || cla->egress_bufs == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate AF_XDP CLA buffers\n");
+        bplib_xdp_cla_destroy(cla);
+        return NULL;
+    }
+
+    if (bplib_xdp_cla_open(cla, config->ifname, config->queue_id) != BP_SUCCESS ||
+        (config->xsk_map_fd >= 0 && bplib_xdp_cla_map_insert(cla, config->xsk_map_fd, config->queue_id) != BP_SUCCESS))
+    {
+        bplib_xdp_cla_destroy(cla);
+        return NULL;
+    }
+
+    cla->intf_id = bplib_create_cla_intf_ext(rtbl, config->intf_flags);
+    if (!bp_handle_is_valid(cla->intf_id))
+    {
+        bplib_xdp_cla_destroy(cla);
+        return NULL;
+    }
+
+    /* without it the egress side is polled at the wait interval instead */
+    cla->notify_fd = bplib_cla_get_notify_fd(rtbl, cla->intf_id);
+
+    /* a bundle has to fit in one frame, anything larger is fragmented to fit */
+    if (cla->can_send)
+    {
+        bplib_config_integer(rtbl, cla->intf_id, bplib_variable_cla_fragment_mtu,
+                             frame_size - BPLIB_XDP_CLA_HDR_SIZE);
+    }
+
+    bplib_route_intf_set_flags(rtbl, cla->intf_id, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+
+    cla->running = true;
+    if ((cla->flags & BPLIB_XDP_CLA_NO_THREAD) == 0)
+    {
+        cla->thread = bplib_os_thread_create("bp-xdp", bplib_xdp_cla_entry, cla);
+        if (cla->thread == NULL)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to start AF_XDP CLA thread\n");
+            cla->running = false;
+            bplib_xdp_cla_destroy(cla);
+            return NULL;
+        }
+    }
+
+    return cla;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_xdp_cla_get_intf
+ *----------------------------------------------------------------------------*/
+bp_handle_t bplib_xdp_cla_get_intf(const bplib_xdp_cla_t *cla)
+{
+    return cla->intf_id;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_xdp_cla_get_fd
+ *----------------------------------------------------------------------------*/
+int bplib_xdp_cla_get_fd(const bplib_xdp_cla_t *cla)
+{
+    return cla->sys_fd;
+}
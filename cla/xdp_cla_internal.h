@@ -0,0 +1,133 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef XDP_CLA_INTERNAL_H
+#define XDP_CLA_INTERNAL_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+#include "bplib_xdp_cla.h"
+
+#include <linux/if_xdp.h>
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* the I/O thread waits this long at a time, so it sees a destroy in good time */
+#define BPLIB_XDP_CLA_WAIT_MSEC 250
+
+#define BPLIB_XDP_CLA_DEFAULT_BATCH      64
+#define BPLIB_XDP_CLA_DEFAULT_FRAMES     4096
+#define BPLIB_XDP_CLA_MIN_FRAMES         64
+#define BPLIB_XDP_CLA_DEFAULT_FRAME_SIZE 4096
+
+/* the headers in front of each bundle, without VLAN tags or IP options */
+#define BPLIB_XDP_CLA_ETH_HLEN 14
+#define BPLIB_XDP_CLA_IP_HLEN  20
+#define BPLIB_XDP_CLA_UDP_HLEN 8
+#define BPLIB_XDP_CLA_HDR_SIZE (BPLIB_XDP_CLA_ETH_HLEN + BPLIB_XDP_CLA_IP_HLEN + BPLIB_XDP_CLA_UDP_HLEN)
+
+#define BPLIB_XDP_CLA_ETHERTYPE_IPV4 0x0800
+#define BPLIB_XDP_CLA_IP_TTL         64
+#define BPLIB_XDP_CLA_IP_DF          0x4000
+#define BPLIB_XDP_CLA_IP_FRAG_MASK   0x3fff /* more fragments, and the fragment offset */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * One of the four rings shared with the kernel.  Each has one producer and one consumer, and
+ * the side that owns an index is the only one that writes it, so that side reads it plainly.
+ */
+typedef struct bplib_xdp_cla_ring
+{
+    uint32_t *producer;
+    uint32_t *consumer;
+    uint32_t *flags;
+    void     *desc; /**< struct xdp_desc for RX and TX, UMEM addresses for fill and completion */
+    void     *map;
+    size_t    map_size;
+    uint32_t  mask;
+} bplib_xdp_cla_ring_t;
+
+struct bplib_xdp_cla
+{
+    bplib_routetbl_t *rtbl;
+    bp_handle_t       intf_id;
+    int               notify_fd; /**< from bplib_cla_get_notify_fd(), owned by the interface */
+    int               sys_fd;
+
+    uint32_t flags;
+    uint32_t batch_size;
+    uint32_t frame_count;
+    uint32_t frame_size;
+    bool     can_send; /**< false if there is no remote address */
+
+    struct sockaddr_in local_addr;
+    struct sockaddr_in remote_addr;
+    uint8_t            local_mac[6];
+    uint8_t            remote_mac[6];
+    uint16_t           ip_id;
+
+    /*
+     * The first half of the frames are for receiving, and are always either in the fill ring or
+     * the RX ring.  The second half are for sending, and are either free here or in the TX ring or
+     * the completion ring, so none of the rings can overflow.
+     */
+    uint8_t             *umem;
+    size_t               umem_size;
+    bplib_xdp_cla_ring_t rx;
+    bplib_xdp_cla_ring_t tx;
+    bplib_xdp_cla_ring_t fill;
+    bplib_xdp_cla_ring_t comp;
+    uint64_t            *tx_free;
+    uint32_t             tx_free_count;
+
+    /*
+     * Set when the notify fd was readable but the egress call gave nothing, or there were no
+     * free frames to send in.  The fd is then left out of the poll for a short time so this
+     * does not spin.
+     */
+    bool egress_held;
+
+    /* per batch */
+    bplib_cla_bundle_buf_t *bundles;
+    int                    *status_list;
+    bplib_cla_egress_buf_t *egress_bufs;
+
+    volatile bool      running;
+    bplib_os_thread_t *thread;
+};
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+bool bplib_xdp_cla_parse(const bplib_xdp_cla_t *cla, const uint8_t *frame, uint32_t len,
+                         bplib_cla_bundle_buf_t *bundle);
+void bplib_xdp_cla_build_headers(bplib_xdp_cla_t *cla, uint8_t *frame, size_t size);
+
+#endif /* XDP_CLA_INTERNAL_H */
@@ -57,8 +57,11 @@ const char *bplib_crc_get_name(bplib_crc_parameters_t *params);
 uint8_t     bplib_crc_get_width(bplib_crc_parameters_t *params);
 bp_crcval_t bplib_crc_initial_value(bplib_crc_parameters_t *params);
 bp_crcval_t bplib_crc_update(bplib_crc_parameters_t *params, bp_crcval_t crc, const void *data, size_t size);
+bp_crcval_t bplib_crc_update_list(bplib_crc_parameters_t *params, bp_crcval_t crc, const bplib_iovec_t *iov,
+                                  size_t iov_count);
 bp_crcval_t bplib_crc_finalize(bplib_crc_parameters_t *params, bp_crcval_t crc);
+bool        bplib_crc_is_hw_accelerated(bplib_crc_parameters_t *params);
 
-bp_crcval_t bplib_crc_get(const void *data, const uint32_t length, bplib_crc_parameters_t *params);
+bp_crcval_t bplib_crc_get(const void *data, size_t length, bplib_crc_parameters_t *params);
 
 #endif /* CRC_H */
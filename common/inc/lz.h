@@ -0,0 +1,50 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * A small LZ77 codec, for data that is stored rather than sent.  The compressed form is the
+ * LZ4 block format, so it can be checked with the LZ4 tools, but this does not use the library.
+ * It favours speed over ratio, a compressed block is typically written faster than the raw one.
+ *
+ * Compress and decompress return the size written to dst, or 0 if it does not fit in dst_size
+ * (or for decompress, if src is not valid).  Compress needs dst_size smaller than src_size to
+ * be worth calling, so a 0 from it means the data should be stored raw.
+ *
+ * bplib_lz_is_compressible samples the data and returns false if its bytes are spread out enough
+ * that it is most likely already compressed or encrypted, without compressing anything.
+ */
+size_t bplib_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_size);
+size_t bplib_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size);
+bool   bplib_lz_is_compressible(const void *src, size_t src_size);
+
+#endif /* LZ_H */
@@ -0,0 +1,200 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef V7_BTREE_H
+#define V7_BTREE_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * B+ tree for ordered indices with a large number of entries
+ *
+ * This has the same keys and duplicate handling as the R-B tree in v7_rbtree.h, but keeps
+ * up to BP_BTREE_FANOUT entries per node where the R-B tree has one node per entry, so a
+ * search visits a few nodes of contiguous keys rather than a chain of pointers.  The entries
+ * are not intrusive, the tree holds a pointer to each one and allocates its own nodes.
+ */
+typedef struct bplib_btree_node bplib_btree_node_t;
+
+typedef struct bplib_btree
+{
+    bplib_btree_node_t *root;        /* NULL until the first insert */
+    uint32_t            height;      /* levels including the leaves, 0 if empty */
+    size_t              num_entries; /* entries over all of the leaves */
+} bplib_btree_t;
+
+/*
+ * Position of an entry in the tree, which is only valid until the tree is changed
+ */
+typedef struct bplib_btree_iter
+{
+    const bplib_btree_node_t *leaf;
+    uint32_t                  position;
+} bplib_btree_iter_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Initializes a new tree object
+ *
+ * The tree will be empty after this call.  This must only be invoked
+ * on new tree objects, or else memory may be leaked.
+ *
+ * @param tree The tree object to initialize
+ */
+void bplib_btree_init(bplib_btree_t *tree);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Releases every node of the tree
+ *
+ * The entries themselves belong to the caller and are not touched.  The tree is empty
+ * afterwards and may be used again.
+ *
+ * @param tree The tree object to release
+ */
+void bplib_btree_destroy(bplib_btree_t *tree);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Checks if the given tree has any entries
+ *
+ * @param[in] tree   The tree to check
+ * @return true if the tree is currently empty
+ */
+bool bplib_btree_is_empty(const bplib_btree_t *tree);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Inserts an entry into the tree
+ *
+ * When duplicates are allowed, an entry with the same key as others goes after all of them,
+ * the same as bplib_rbt_insert_value_generic() does with a compare function that always
+ * returns 1.
+ *
+ * @param[in]    key_value       Key of the entry
+ * @param[inout] tree            Tree to insert into
+ * @param[in]    entry           The entry, which must not be NULL
+ * @param[in]    allow_duplicate If false, the key must not already be in the tree
+ * @retval BP_SUCCESS if the entry was inserted
+ * @retval BP_DUPLICATE if the key is already in the tree and duplicates are not allowed
+ * @retval BP_ERROR if a node could not be allocated, the tree is unchanged in that case
+ */
+int bplib_btree_insert(bp_val_t key_value, bplib_btree_t *tree, void *entry, bool allow_duplicate);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Removes an entry from the tree
+ *
+ * Where there are duplicate keys, only the one which refers to the given entry is removed.
+ * Nodes are released once they are empty, but nodes which are only partly empty are not
+ * merged with their neighbors.
+ *
+ * @param[in]    key_value  Key the entry was inserted with
+ * @param[inout] tree       Tree to remove from
+ * @param[in]    entry      The entry to remove
+ * @retval BP_SUCCESS if the entry was removed
+ * @retval BP_ERROR if the tree did not contain the entry with that key
+ */
+int bplib_btree_remove(bp_val_t key_value, bplib_btree_t *tree, const void *entry);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Searches the tree for an entry with the given key
+ *
+ * If there are duplicates, this is the first one that was inserted.
+ *
+ * @param[in] key_value The key to search for
+ * @param[in] tree      The tree to search in
+ * @return The entry
+ * @retval NULL if no entry has that key
+ */
+void *bplib_btree_search(bp_val_t key_value, const bplib_btree_t *tree);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Position an iterator at the first entry with a key greater than or equal to a minimum bound
+ *
+ * @param minimum_value The minimum key value
+ * @param tree          The tree to search in
+ * @param iter          The iterator to position
+ * @retval BP_SUCCESS if the iterator is valid
+ */
+int bplib_btree_iter_goto_min(bp_val_t minimum_value, const bplib_btree_t *tree, bplib_btree_iter_t *iter);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Position an iterator at the last entry with a key less than or equal to a maximum bound
+ *
+ * @param maximum_value The maximum key value
+ * @param tree          The tree to search in
+ * @param iter          The iterator to position
+ * @retval BP_SUCCESS if the iterator is valid
+ */
+int bplib_btree_iter_goto_max(bp_val_t maximum_value, const bplib_btree_t *tree, bplib_btree_iter_t *iter);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Move an iterator forward by one entry, in ascending key order
+ *
+ * @param iter The iterator object to move
+ * @retval BP_SUCCESS if iterator is valid
+ */
+int bplib_btree_iter_next(bplib_btree_iter_t *iter);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Move an iterator backward by one entry, in descending key order
+ *
+ * @param iter The iterator object to move
+ * @retval BP_SUCCESS if iterator is valid
+ */
+int bplib_btree_iter_prev(bplib_btree_iter_t *iter);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Gets the key of the entry at the iterator position
+ *
+ * @param iter A valid iterator
+ * @return The key value
+ */
+bp_val_t bplib_btree_iter_get_key(const bplib_btree_iter_t *iter);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Gets the entry at the iterator position
+ *
+ * @param iter A valid iterator
+ * @return The entry
+ */
+void *bplib_btree_iter_get_entry(const bplib_btree_iter_t *iter);
+
+#endif /* V7_BTREE_H */
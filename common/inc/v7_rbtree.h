@@ -74,6 +74,38 @@ typedef struct bplib_rbt_iter
     const bplib_rbt_link_t *position;
 } bplib_rbt_iter_t;
 
+/**
+ * @brief What a range scan does after visiting a node
+ */
+typedef enum bplib_rbt_scan_action
+{
+    bplib_rbt_scan_continue, /**< go on to the next node */
+    bplib_rbt_scan_remove,   /**< extract this node from the tree, and go on to the next node */
+    bplib_rbt_scan_stop      /**< end the scan here */
+} bplib_rbt_scan_action_t;
+
+/**
+ * @brief Function called on each node of a range scan
+ *
+ * The function may extract the node it is called on from the tree itself, but not any other node
+ * of the same tree.  Nodes may be freely added to or removed from any other tree.
+ */
+typedef bplib_rbt_scan_action_t (*bplib_rbt_scan_func_t)(bplib_rbt_link_t *node, void *arg);
+
+/**
+ * @brief Nodes collected for loading into a tree in one operation
+ *
+ * The nodes are chained through their own link blocks until bplib_rbt_bulk_load() puts
+ * them in the tree, so nothing else may be done with them in the meantime.
+ */
+typedef struct bplib_rbt_bulk
+{
+    bplib_rbt_link_t *first;
+    bplib_rbt_link_t *last;
+    size_t            count;
+    bool              is_sorted; /* false once a key was appended below the previous one */
+} bplib_rbt_bulk_t;
+
 /******************************************************************************
  PROTOTYPES
  ******************************************************************************/
@@ -239,6 +271,62 @@ static inline int bplib_rbt_insert_value_unique(bp_val_t insert_key_value, bplib
  */
 int bplib_rbt_extract_node(bplib_rbt_root_t *tree, bplib_rbt_link_t *link_block);
 
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Removes every node from the Red-Black tree at once
+ *
+ * Each link block is reset the same way as bplib_rbt_extract_node() does it, so its key reads
+ * as 0 afterwards, but the tree is not rebalanced along the way.  This is for tearing down a
+ * whole index, where nodes one at a time would only rebalance a tree that is going away.
+ *
+ * @param[inout] tree  Tree to clear, which will be empty after this call
+ */
+void bplib_rbt_clear(bplib_rbt_root_t *tree);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Initializes a set of nodes to be bulk loaded into a tree
+ *
+ * @param bulk The object to initialize
+ */
+void bplib_rbt_bulk_init(bplib_rbt_bulk_t *bulk);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Adds a node to a set to be bulk loaded into a tree
+ *
+ * This sets the key value in the link block the same way as bplib_rbt_insert_value_generic(),
+ * but the node does not go into a tree until bplib_rbt_bulk_load() is called.
+ *
+ * Nodes with the same key are kept in the order they were appended.  There is no check for
+ * duplicates here, so where the tree must have unique keys the caller must not append a key
+ * more than once.
+ *
+ * @param[inout] bulk        The set of nodes to add to
+ * @param[in]    key_value   Value which is saved into into the node
+ * @param[inout] link_block  Memory block to store the value, which must not be in a tree
+ * @retval BP_SUCCESS if node was added
+ * @retval BP_ERROR if the link block is already in use
+ */
+int bplib_rbt_bulk_append(bplib_rbt_bulk_t *bulk, bp_val_t key_value, bplib_rbt_link_t *link_block);
+
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Builds a balanced tree from a set of nodes
+ *
+ * Keys appended in ascending order are built into the tree directly in O(n) with no
+ * rebalancing at all; otherwise the set is merge sorted first.  Either way this is much less
+ * work than inserting the same nodes one at a time.
+ *
+ * The set is empty afterwards and may be used again.
+ *
+ * @param[inout] tree  Tree to build, which must be empty
+ * @param[inout] bulk  The set of nodes to put in the tree
+ * @retval BP_SUCCESS if the tree was built
+ * @retval BP_ERROR if the tree was not empty, in which case the set is unchanged
+ */
+int bplib_rbt_bulk_load(bplib_rbt_root_t *tree, bplib_rbt_bulk_t *bulk);
+
 /*--------------------------------------------------------------------------------------*/
 /**
  * @brief Position an iterator at the first key value in the tree that is greater than or equal to a minimum bound
@@ -263,6 +351,24 @@ int bplib_rbt_iter_goto_min(bp_val_t minimum_value, const bplib_rbt_root_t *tree
  */
 int bplib_rbt_iter_goto_max(bp_val_t maximum_value, const bplib_rbt_root_t *tree, bplib_rbt_iter_t *iter);
 
+/*--------------------------------------------------------------------------------------*/
+/**
+ * @brief Visits every node with a key in the range [minimum_value, maximum_value], in order
+ *
+ * Each node is passed to the scan function, which may take it out of the tree as it goes.  This
+ * way a sweep over a range can remove what it finds in one pass, instead of collecting the nodes
+ * first or starting an iteration over after each one is removed.
+ *
+ * @param minimum_value The lowest key to visit
+ * @param maximum_value The highest key to visit
+ * @param tree          The tree to scan
+ * @param scan_func     Function to call on each node
+ * @param scan_arg      Opaque argument passed through to scan function
+ * @return The number of nodes the scan function was called on
+ */
+uint32_t bplib_rbt_scan_range(bp_val_t minimum_value, bp_val_t maximum_value, bplib_rbt_root_t *tree,
+                              bplib_rbt_scan_func_t scan_func, void *scan_arg);
+
 /*--------------------------------------------------------------------------------------*/
 /**
  * @brief Move an iterator forward by one step in the tree
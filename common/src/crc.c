@@ -22,9 +22,27 @@
  INCLUDES
  ******************************************************************************/
 
+#include <string.h>
+
 #include "bplib.h"
 #include "crc_private.h"
 
+/*
+ * CRC-32 Castagnoli is what the CRC instructions of x86-64 (SSE4.2) and ARMv8 compute.  Using
+ * them from a function that only runs when the CPU has them needs a compiler extension, and
+ * the table implementation is always kept as the fallback.
+ */
+#if !defined(BPLIB_CRC_NO_HW_CRC32C) && (defined(__GNUC__) || defined(__clang__))
+#if defined(__x86_64__)
+#define BPLIB_CRC_HW_CRC32C_X86
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__linux__) && !defined(__AARCH64EB__)
+#define BPLIB_CRC_HW_CRC32C_ARM
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
 /******************************************************************************
  FILE DATA
  ******************************************************************************/
@@ -39,27 +57,52 @@ uint8_t BPLIB_CRC_REFLECT_TABLE[256];
 static uint16_t BPLIB_CRC16_X25_TABLE[256];
 static uint32_t BPLIB_CRC32_C_TABLE[256];
 
+#ifndef BPLIB_CRC_NO_SLICING
+/*
+ * Tables for slicing-by-8.  These are for the reflected CRC value, so the input bytes are used
+ * as they are.  Entry [k][i] is the CRC of byte i followed by k zero bytes.
+ */
+static uint16_t BPLIB_CRC16_X25_SLICE_TABLE[8][256];
+static uint32_t BPLIB_CRC32_C_SLICE_TABLE[8][256];
+#endif
+
+/*
+ * The implementations in use, selected by bplib_crc_init()
+ */
+static bplib_crc_digest_func_t BPLIB_CRC16_X25_DIGEST  = bplib_crc_digest_CRC16_X25_TABLE;
+static bplib_crc_digest_func_t BPLIB_CRC32_C_DIGEST    = bplib_crc_digest_CRC32_C_TABLE;
+static bplib_crc_digest_func_t BPLIB_CRC32_C_HW_DIGEST = NULL; /* if this CPU has CRC instructions */
+
+static bplib_crc_digest_list_func_t BPLIB_CRC16_X25_DIGEST_LIST  = bplib_crc_digest_list_CRC16_X25_TABLE;
+static bplib_crc_digest_list_func_t BPLIB_CRC32_C_DIGEST_LIST    = bplib_crc_digest_list_CRC32_C_TABLE;
+static bplib_crc_digest_list_func_t BPLIB_CRC32_C_HW_DIGEST_LIST = NULL;
+
 /*
  * Digest function/wrapper that does nothing
  */
 static bp_crcval_t bplib_crc_digest_NOOP(bp_crcval_t crc, const void *ptr, size_t size);
+static bp_crcval_t bplib_crc_digest_list_NOOP(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count);
 
 /*
  * Digest function/wrapper specific for CRC16 X.25 algorithm
  */
 static bp_crcval_t bplib_crc_digest_CRC16_X25(bp_crcval_t crc, const void *ptr, size_t size);
+static bp_crcval_t bplib_crc_digest_list_CRC16_X25(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count);
 
 /*
  * Digest function/wrapper specific for CRC32 Castagnoli algorithm
  */
 static bp_crcval_t bplib_crc_digest_CRC32_CASTAGNOLI(bp_crcval_t crc, const void *ptr, size_t size);
+static bp_crcval_t bplib_crc_digest_list_CRC32_CASTAGNOLI(bp_crcval_t crc, const bplib_iovec_t *iov,
+                                                          size_t iov_count);
 
 /*
  * Global definition of "No CRC" algorithm
  * This is a placeholder that can be used when no CRC is desired, it provides a digest
  * function that does nothing.  It will always generate a CRC of "0".
  */
-bplib_crc_parameters_t BPLIB_CRC_NONE = {.name = "No CRC", .digest = bplib_crc_digest_NOOP};
+bplib_crc_parameters_t BPLIB_CRC_NONE = {
+    .name = "No CRC", .digest = bplib_crc_digest_NOOP, .digest_list = bplib_crc_digest_list_NOOP};
 
 /*
  * Global definition of CRC16 X.25 algorithm
@@ -68,6 +111,7 @@ bplib_crc_parameters_t BPLIB_CRC16_X25 = {.name                  = "CRC-16 X25",
                                           .length                = 16,
                                           .should_reflect_output = true,
                                           .digest                = bplib_crc_digest_CRC16_X25,
+                                          .digest_list           = bplib_crc_digest_list_CRC16_X25,
                                           .initial_value         = 0xFFFF,
                                           .final_xor             = 0xFFFF};
 
@@ -78,6 +122,7 @@ bplib_crc_parameters_t BPLIB_CRC32_CASTAGNOLI = {.name                  = "CRC-3
                                                  .length                = 32,
                                                  .should_reflect_output = true,
                                                  .digest                = bplib_crc_digest_CRC32_CASTAGNOLI,
+                                                 .digest_list           = bplib_crc_digest_list_CRC32_CASTAGNOLI,
                                                  .initial_value         = 0xFFFFFFFF,
                                                  .final_xor             = 0xFFFFFFFF};
 
@@ -111,21 +156,328 @@ static uint32_t bplib_crc_generic32_impl(const uint8_t *input_table, const uint3
     return crc;
 }
 
+#if !defined(BPLIB_CRC_NO_SLICING) || defined(BPLIB_CRC_HW_CRC32C_X86) || defined(BPLIB_CRC_HW_CRC32C_ARM)
+
+/*
+ * The CRC instructions and the slicing tables work on the reflected CRC value, where the CRC
+ * here is kept normalized
+ */
+static uint32_t bplib_crc_reflect32(uint32_t crc)
+{
+    return ((uint32_t)BPLIB_CRC_REFLECT_TABLE[crc & 0xFF] << 24) |
+           ((uint32_t)BPLIB_CRC_REFLECT_TABLE[(crc >> 8) & 0xFF] << 16) |
+           ((uint32_t)BPLIB_CRC_REFLECT_TABLE[(crc >> 16) & 0xFF] << 8) | BPLIB_CRC_REFLECT_TABLE[crc >> 24];
+}
+
+#endif
+
+#ifndef BPLIB_CRC_NO_SLICING
+
+static uint16_t bplib_crc_reflect16(uint16_t crc)
+{
+    return (uint16_t)(((uint16_t)BPLIB_CRC_REFLECT_TABLE[crc & 0xFF] << 8) | BPLIB_CRC_REFLECT_TABLE[crc >> 8]);
+}
+
+/*
+ * Fills in the slicing tables from the byte-wise table of the same CRC
+ */
+static void bplib_crc_precompute_slices(void)
+{
+    uint32_t i;
+    uint32_t k;
+
+    for (i = 0; i < 256; ++i)
+    {
+        BPLIB_CRC16_X25_SLICE_TABLE[0][i] = bplib_crc_reflect16(BPLIB_CRC16_X25_TABLE[BPLIB_CRC_REFLECT_TABLE[i]]);
+        BPLIB_CRC32_C_SLICE_TABLE[0][i]   = bplib_crc_reflect32(BPLIB_CRC32_C_TABLE[BPLIB_CRC_REFLECT_TABLE[i]]);
+    }
+
+    for (k = 1; k < 8; ++k)
+    {
+        for (i = 0; i < 256; ++i)
+        {
+            BPLIB_CRC16_X25_SLICE_TABLE[k][i] =
+                (BPLIB_CRC16_X25_SLICE_TABLE[k - 1][i] >> 8) ^
+                BPLIB_CRC16_X25_SLICE_TABLE[0][BPLIB_CRC16_X25_SLICE_TABLE[k - 1][i] & 0xFF];
+            BPLIB_CRC32_C_SLICE_TABLE[k][i] = (BPLIB_CRC32_C_SLICE_TABLE[k - 1][i] >> 8) ^
+                                              BPLIB_CRC32_C_SLICE_TABLE[0][BPLIB_CRC32_C_SLICE_TABLE[k - 1][i] & 0xFF];
+        }
+    }
+}
+
+static uint16_t bplib_crc_slice8_16_impl(uint16_t rcrc, const uint8_t *byte, size_t size)
+{
+    uint16_t(*table)[256];
+
+    table = BPLIB_CRC16_X25_SLICE_TABLE;
+    while (size >= 8)
+    {
+        rcrc ^= (uint16_t)(byte[0] | (byte[1] << 8));
+        rcrc = table[7][rcrc & 0xFF] ^ table[6][rcrc >> 8] ^ table[5][byte[2]] ^ table[4][byte[3]] ^
+               table[3][byte[4]] ^ table[2][byte[5]] ^ table[1][byte[6]] ^ table[0][byte[7]];
+        byte += 8;
+        size -= 8;
+    }
+
+    while (size > 0)
+    {
+        rcrc = table[0][(rcrc ^ *byte) & 0xFF] ^ (rcrc >> 8);
+        ++byte;
+        --size;
+    }
+
+    return rcrc;
+}
+
+static bp_crcval_t bplib_crc_digest_CRC16_X25_SLICE8(bp_crcval_t crc, const void *ptr, size_t size)
+{
+    return bplib_crc_reflect16(bplib_crc_slice8_16_impl(bplib_crc_reflect16(crc), ptr, size));
+}
+
+static bp_crcval_t bplib_crc_digest_list_CRC16_X25_SLICE8(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    uint16_t rcrc;
+
+    rcrc = bplib_crc_reflect16(crc);
+    while (iov_count > 0)
+    {
+        rcrc = bplib_crc_slice8_16_impl(rcrc, iov->base, iov->len);
+        ++iov;
+        --iov_count;
+    }
+
+    return bplib_crc_reflect16(rcrc);
+}
+
+static uint32_t bplib_crc_slice8_32_impl(uint32_t rcrc, const uint8_t *byte, size_t size)
+{
+    uint32_t(*table)[256];
+
+    /* the bytes are put together one by one, so this does not depend on the CPU byte order */
+    table = BPLIB_CRC32_C_SLICE_TABLE;
+    while (size >= 8)
+    {
+        rcrc ^= (uint32_t)byte[0] | ((uint32_t)byte[1] << 8) | ((uint32_t)byte[2] << 16) | ((uint32_t)byte[3] << 24);
+        rcrc = table[7][rcrc & 0xFF] ^ table[6][(rcrc >> 8) & 0xFF] ^ table[5][(rcrc >> 16) & 0xFF] ^
+               table[4][rcrc >> 24] ^ table[3][byte[4]] ^ table[2][byte[5]] ^ table[1][byte[6]] ^ table[0][byte[7]];
+        byte += 8;
+        size -= 8;
+    }
+
+    while (size > 0)
+    {
+        rcrc = table[0][(rcrc ^ *byte) & 0xFF] ^ (rcrc >> 8);
+        ++byte;
+        --size;
+    }
+
+    return rcrc;
+}
+
+static bp_crcval_t bplib_crc_digest_CRC32_C_SLICE8(bp_crcval_t crc, const void *ptr, size_t size)
+{
+    return bplib_crc_reflect32(bplib_crc_slice8_32_impl(bplib_crc_reflect32(crc), ptr, size));
+}
+
+static bp_crcval_t bplib_crc_digest_list_CRC32_C_SLICE8(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    uint32_t rcrc;
+
+    rcrc = bplib_crc_reflect32(crc);
+    while (iov_count > 0)
+    {
+        rcrc = bplib_crc_slice8_32_impl(rcrc, iov->base, iov->len);
+        ++iov;
+        --iov_count;
+    }
+
+    return bplib_crc_reflect32(rcrc);
+}
+
+#endif
+
+#ifdef BPLIB_CRC_HW_CRC32C_X86
+
+__attribute__((target("sse4.2"))) static uint32_t bplib_crc_sse42_impl(uint32_t rcrc, const uint8_t *byte, size_t size)
+{
+    uint64_t crc64;
+    uint64_t word;
+
+    /* a byte at a time until aligned, then 8 bytes at a time */
+    while (size > 0 && ((uintptr_t)byte & 7) != 0)
+    {
+        rcrc = _mm_crc32_u8(rcrc, *byte);
+        ++byte;
+        --size;
+    }
+
+    crc64 = rcrc;
+    while (size >= sizeof(word))
+    {
+        memcpy(&word, byte, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        byte += sizeof(word);
+        size -= sizeof(word);
+    }
+
+    rcrc = (uint32_t)crc64;
+    while (size > 0)
+    {
+        rcrc = _mm_crc32_u8(rcrc, *byte);
+        ++byte;
+        --size;
+    }
+
+    return rcrc;
+}
+
+__attribute__((target("sse4.2"))) static bp_crcval_t bplib_crc_digest_CRC32_C_SSE42(bp_crcval_t crc, const void *ptr,
+                                                                                     size_t size)
+{
+    return bplib_crc_reflect32(bplib_crc_sse42_impl(bplib_crc_reflect32(crc), ptr, size));
+}
+
+__attribute__((target("sse4.2"))) static bp_crcval_t
+bplib_crc_digest_list_CRC32_C_SSE42(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    uint32_t rcrc;
+
+    rcrc = bplib_crc_reflect32(crc);
+    while (iov_count > 0)
+    {
+        rcrc = bplib_crc_sse42_impl(rcrc, iov->base, iov->len);
+        ++iov;
+        --iov_count;
+    }
+
+    return bplib_crc_reflect32(rcrc);
+}
+
+#endif
+
+#ifdef BPLIB_CRC_HW_CRC32C_ARM
+
+__attribute__((target("+crc"))) static uint32_t bplib_crc_armv8_impl(uint32_t rcrc, const uint8_t *byte, size_t size)
+{
+    uint64_t word;
+
+    /* a byte at a time until aligned, then 8 bytes at a time */
+    while (size > 0 && ((uintptr_t)byte & 7) != 0)
+    {
+        rcrc = __crc32cb(rcrc, *byte);
+        ++byte;
+        --size;
+    }
+
+    while (size >= sizeof(word))
+    {
+        memcpy(&word, byte, sizeof(word));
+        rcrc = __crc32cd(rcrc, word);
+        byte += sizeof(word);
+        size -= sizeof(word);
+    }
+
+    while (size > 0)
+    {
+        rcrc = __crc32cb(rcrc, *byte);
+        ++byte;
+        --size;
+    }
+
+    return rcrc;
+}
+
+__attribute__((target("+crc"))) static bp_crcval_t bplib_crc_digest_CRC32_C_ARMV8(bp_crcval_t crc, const void *ptr,
+                                                                                  size_t size)
+{
+    return bplib_crc_reflect32(bplib_crc_armv8_impl(bplib_crc_reflect32(crc), ptr, size));
+}
+
+__attribute__((target("+crc"))) static bp_crcval_t
+bplib_crc_digest_list_CRC32_C_ARMV8(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    uint32_t rcrc;
+
+    rcrc = bplib_crc_reflect32(crc);
+    while (iov_count > 0)
+    {
+        rcrc = bplib_crc_armv8_impl(rcrc, iov->base, iov->len);
+        ++iov;
+        --iov_count;
+    }
+
+    return bplib_crc_reflect32(rcrc);
+}
+
+#endif
+
 bp_crcval_t bplib_crc_digest_NOOP(bp_crcval_t crc, const void *ptr, size_t size)
 {
     return crc;
 }
 
+bp_crcval_t bplib_crc_digest_list_NOOP(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    return crc;
+}
+
 bp_crcval_t bplib_crc_digest_CRC16_X25(bp_crcval_t crc, const void *ptr, size_t size)
+{
+    return BPLIB_CRC16_X25_DIGEST(crc, ptr, size);
+}
+
+bp_crcval_t bplib_crc_digest_list_CRC16_X25(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    return BPLIB_CRC16_X25_DIGEST_LIST(crc, iov, iov_count);
+}
+
+bp_crcval_t bplib_crc_digest_CRC16_X25_TABLE(bp_crcval_t crc, const void *ptr, size_t size)
 {
     return bplib_crc_generic16_impl(BPLIB_CRC_REFLECT_TABLE, BPLIB_CRC16_X25_TABLE, crc, ptr, size);
 }
 
+bp_crcval_t bplib_crc_digest_list_CRC16_X25_TABLE(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    uint16_t crc16;
+
+    crc16 = crc;
+    while (iov_count > 0)
+    {
+        crc16 = bplib_crc_generic16_impl(BPLIB_CRC_REFLECT_TABLE, BPLIB_CRC16_X25_TABLE, crc16, iov->base, iov->len);
+        ++iov;
+        --iov_count;
+    }
+
+    return crc16;
+}
+
 bp_crcval_t bplib_crc_digest_CRC32_CASTAGNOLI(bp_crcval_t crc, const void *ptr, size_t size)
+{
+    return BPLIB_CRC32_C_DIGEST(crc, ptr, size);
+}
+
+bp_crcval_t bplib_crc_digest_list_CRC32_CASTAGNOLI(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    return BPLIB_CRC32_C_DIGEST_LIST(crc, iov, iov_count);
+}
+
+bp_crcval_t bplib_crc_digest_CRC32_C_TABLE(bp_crcval_t crc, const void *ptr, size_t size)
 {
     return bplib_crc_generic32_impl(BPLIB_CRC_REFLECT_TABLE, BPLIB_CRC32_C_TABLE, crc, ptr, size);
 }
 
+bp_crcval_t bplib_crc_digest_list_CRC32_C_TABLE(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count)
+{
+    while (iov_count > 0)
+    {
+        crc = bplib_crc_generic32_impl(BPLIB_CRC_REFLECT_TABLE, BPLIB_CRC32_C_TABLE, crc, iov->base, iov->len);
+        ++iov;
+        --iov_count;
+    }
+
+    return crc;
+}
+
 bp_crcval_t bplib_precompute_crc_byte(uint8_t width, uint8_t byte, bp_crcval_t polynomial)
 {
     uint8_t     mask;
@@ -215,6 +567,91 @@ void bplib_crc_init(void)
         ++byte;
     }
     while (byte != 0);
+
+    /* slicing-by-8 does 8 bytes for about the cost of 2 in the byte-wise loop */
+#ifndef BPLIB_CRC_NO_SLICING
+    bplib_crc_precompute_slices();
+    BPLIB_CRC16_X25_DIGEST      = bplib_crc_digest_CRC16_X25_SLICE8;
+    BPLIB_CRC32_C_DIGEST        = bplib_crc_digest_CRC32_C_SLICE8;
+    BPLIB_CRC16_X25_DIGEST_LIST = bplib_crc_digest_list_CRC16_X25_SLICE8;
+    BPLIB_CRC32_C_DIGEST_LIST   = bplib_crc_digest_list_CRC32_C_SLICE8;
+#else
+    BPLIB_CRC16_X25_DIGEST      = bplib_crc_digest_CRC16_X25_TABLE;
+    BPLIB_CRC32_C_DIGEST        = bplib_crc_digest_CRC32_C_TABLE;
+    BPLIB_CRC16_X25_DIGEST_LIST = bplib_crc_digest_list_CRC16_X25_TABLE;
+    BPLIB_CRC32_C_DIGEST_LIST   = bplib_crc_digest_list_CRC32_C_TABLE;
+#endif
+
+    /* the CRC instructions for CRC32 Castagnoli are faster still, if this CPU has them */
+    BPLIB_CRC32_C_HW_DIGEST      = NULL;
+    BPLIB_CRC32_C_HW_DIGEST_LIST = NULL;
+#if defined(BPLIB_CRC_HW_CRC32C_X86)
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        BPLIB_CRC32_C_HW_DIGEST      = bplib_crc_digest_CRC32_C_SSE42;
+        BPLIB_CRC32_C_HW_DIGEST_LIST = bplib_crc_digest_list_CRC32_C_SSE42;
+    }
+#elif defined(BPLIB_CRC_HW_CRC32C_ARM)
+    if ((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0)
+    {
+        BPLIB_CRC32_C_HW_DIGEST      = bplib_crc_digest_CRC32_C_ARMV8;
+        BPLIB_CRC32_C_HW_DIGEST_LIST = bplib_crc_digest_list_CRC32_C_ARMV8;
+    }
+#endif
+    if (BPLIB_CRC32_C_HW_DIGEST != NULL)
+    {
+        BPLIB_CRC32_C_DIGEST      = BPLIB_CRC32_C_HW_DIGEST;
+        BPLIB_CRC32_C_DIGEST_LIST = BPLIB_CRC32_C_HW_DIGEST_LIST;
+    }
+}
+
+bool bplib_crc_is_hw_accelerated(bplib_crc_parameters_t *params)
+{
+    return (params == &BPLIB_CRC32_CASTAGNOLI && BPLIB_CRC32_C_HW_DIGEST != NULL);
+}
+
+bplib_crc_digest_func_t bplib_crc_get_kernel(bplib_crc_parameters_t *params, bplib_crc_kernel_t kernel)
+{
+    bplib_crc_digest_func_t digest;
+
+    digest = NULL;
+    if (params == &BPLIB_CRC16_X25)
+    {
+        switch (kernel)
+        {
+            case bplib_crc_kernel_table:
+                digest = bplib_crc_digest_CRC16_X25_TABLE;
+                break;
+#ifndef BPLIB_CRC_NO_SLICING
+            case bplib_crc_kernel_slice8:
+                digest = bplib_crc_digest_CRC16_X25_SLICE8;
+                break;
+#endif
+            default:
+                break;
+        }
+    }
+    else if (params == &BPLIB_CRC32_CASTAGNOLI)
+    {
+        switch (kernel)
+        {
+            case bplib_crc_kernel_table:
+                digest = bplib_crc_digest_CRC32_C_TABLE;
+                break;
+#ifndef BPLIB_CRC_NO_SLICING
+            case bplib_crc_kernel_slice8:
+                digest = bplib_crc_digest_CRC32_C_SLICE8;
+                break;
+#endif
+            case bplib_crc_kernel_hw:
+                digest = BPLIB_CRC32_C_HW_DIGEST;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return digest;
 }
 
 const char *bplib_crc_get_name(bplib_crc_parameters_t *params)
@@ -237,6 +674,30 @@ bp_crcval_t bplib_crc_update(bplib_crc_parameters_t *params, bp_crcval_t crc, co
     return params->digest(crc, data, size);
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_crc_update_list - Updates the CRC with the data of each entry of iov in turn, the same
+ *      as bplib_crc_update() on each one but the kernel keeps its working state from one entry
+ *      to the next.  Entries with a len of 0 are skipped, their base is not used.
+ *-------------------------------------------------------------------------------------*/
+bp_crcval_t bplib_crc_update_list(bplib_crc_parameters_t *params, bp_crcval_t crc, const bplib_iovec_t *iov,
+                                  size_t iov_count)
+{
+    if (params->digest_list == NULL)
+    {
+        /* an algorithm that only has the plain digest */
+        while (iov_count > 0)
+        {
+            crc = params->digest(crc, iov->base, iov->len);
+            ++iov;
+            --iov_count;
+        }
+
+        return crc;
+    }
+
+    return params->digest_list(crc, iov, iov_count);
+}
+
 bp_crcval_t bplib_crc_finalize(bplib_crc_parameters_t *params, bp_crcval_t crc)
 {
     bp_crcval_t crc_final;
@@ -292,7 +753,7 @@ bp_crcval_t bplib_crc_finalize(bplib_crc_parameters_t *params, bp_crcval_t crc)
  * returns: A crc remainder of the provided data. If a crc length is used that is less
  *      than the returned data type size than expect it to be cast.
  *-------------------------------------------------------------------------------------*/
-bp_crcval_t bplib_crc_get(const void *data, const uint32_t length, bplib_crc_parameters_t *params)
+bp_crcval_t bplib_crc_get(const void *data, size_t length, bplib_crc_parameters_t *params)
 {
     return bplib_crc_finalize(params, params->digest(params->initial_value, data, length));
 }
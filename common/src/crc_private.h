@@ -45,6 +45,22 @@
  */
 typedef bp_crcval_t (*bplib_crc_digest_func_t)(bp_crcval_t crc, const void *data, size_t size);
 
+/*
+ * The same over a list of buffers, as if they were one, see bplib_crc_update_list()
+ */
+typedef bp_crcval_t (*bplib_crc_digest_list_func_t)(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count);
+
+/*
+ * The ways a CRC digest may be implemented, not all are built in or available for each CRC
+ */
+typedef enum bplib_crc_kernel
+{
+    bplib_crc_kernel_table,  /* byte-wise table, always available */
+    bplib_crc_kernel_slice8, /* slicing-by-8 tables, unless built with BPLIB_CRC_NO_SLICING */
+    bplib_crc_kernel_hw,     /* CPU CRC instructions, CRC32 Castagnoli only */
+    bplib_crc_kernel_max
+} bplib_crc_kernel_t;
+
 /*
  * Actual definition of CRC parameters
  */
@@ -57,12 +73,28 @@ struct bplib_crc_parameters
     const uint8_t *input_table; /* A ptr to a table for input translation (reflect or direct) */
     const void    *xor_table;   /* A ptr to a table with the precomputed XOR values. */
 
-    bplib_crc_digest_func_t digest; /* externally-callable "digest" routine to update CRC with new data */
+    bplib_crc_digest_func_t      digest;      /* externally-callable "digest" routine to update CRC with new data */
+    bplib_crc_digest_list_func_t digest_list; /* same over a list of buffers, may be NULL to use digest on each */
 
     bp_crcval_t initial_value; /* The value used to initialize a CRC (normalized). */
     bp_crcval_t final_xor;     /* The final value to xor with the crc before returning (normalized). */
 };
 
+/*
+ * The byte-wise table implementations, used when nothing faster was built in
+ */
+bp_crcval_t bplib_crc_digest_CRC16_X25_TABLE(bp_crcval_t crc, const void *ptr, size_t size);
+bp_crcval_t bplib_crc_digest_CRC32_C_TABLE(bp_crcval_t crc, const void *ptr, size_t size);
+bp_crcval_t bplib_crc_digest_list_CRC16_X25_TABLE(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count);
+bp_crcval_t bplib_crc_digest_list_CRC32_C_TABLE(bp_crcval_t crc, const bplib_iovec_t *iov, size_t iov_count);
+
+/*
+ * Gets one specific implementation of the digest of a CRC, for testing and benchmarks.
+ * Returns NULL if that one is not built in or not supported by this CPU.
+ * bplib_crc_init() must have been called first.
+ */
+bplib_crc_digest_func_t bplib_crc_get_kernel(bplib_crc_parameters_t *params, bplib_crc_kernel_t kernel);
+
 bp_crcval_t bplib_precompute_crc_byte(uint8_t width, uint8_t byte, bp_crcval_t polynomial);
 uint8_t     bplib_precompute_reflection(uint8_t byte);
 
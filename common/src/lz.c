@@ -0,0 +1,359 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "bplib.h"
+#include "lz.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* limits of the LZ4 block format, the last 5 bytes are always literals */
+#define BPLIB_LZ_MIN_MATCH     4
+#define BPLIB_LZ_LAST_LITERALS 5
+#define BPLIB_LZ_MATCH_LIMIT   12
+#define BPLIB_LZ_MAX_OFFSET    65535
+
+/* 4 KiB of table on the stack, which finds most of the matches in a bundle payload */
+#define BPLIB_LZ_HASH_BITS 10
+
+/*
+ * The sample is judged by its collision entropy, -log2 of the sum of the squared byte frequencies,
+ * which only needs a histogram.  Above 7.5 bits per byte (2^7.5 is about 181) there is nothing
+ * for a byte oriented codec to find.
+ */
+#define BPLIB_LZ_SAMPLE_RUN     256
+#define BPLIB_LZ_SAMPLE_RUNS    16
+#define BPLIB_LZ_ENTROPY_FACTOR 181
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+static inline uint32_t bplib_lz_read32(const uint8_t *ptr)
+{
+    uint32_t val;
+
+    memcpy(&val, ptr, sizeof(val));
+    return val;
+}
+
+static inline uint32_t bplib_lz_hash(uint32_t val)
+{
+    return (val * 2654435761U) >> (32 - BPLIB_LZ_HASH_BITS);
+}
+
+static uint8_t *bplib_lz_put_length(uint8_t *op, size_t len)
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+
+    return op;
+}
+
+/* puts one sequence, the literals followed by the match if there is one, NULL if it does not fit */
+static uint8_t *bplib_lz_put_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *lit, size_t lit_len,
+                                      size_t offset, size_t match_len)
+{
+    uint8_t *token;
+
+    /* the worst case, each length takes one more byte per 255 */
+    if ((size_t)(oend - op) < (lit_len + (lit_len / 255) + (match_len / 255) + 6))
+    {
+        return NULL;
+    }
+
+    token = op++;
+    if (lit_len >= 15)
+    {
+        *token = 15 << 4;
+        op     = bplib_lz_put_length(op, lit_len - 15);
+    }
+    else
+    {
+        *token = (uint8_t)(lit_len << 4);
+    }
+
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len != 0)
+    {
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+
+        match_len -= BPLIB_LZ_MIN_MATCH;
+        if (match_len >= 15)
+        {
+            *token |= 15;
+            op = bplib_lz_put_length(op, match_len - 15);
+        }
+        else
+        {
+            *token |= (uint8_t)match_len;
+        }
+    }
+
+    return op;
+}
+
+/* adds the extra bytes of a length to len, false if they run past the end */
+static bool bplib_lz_get_length(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+    uint8_t b;
+
+    do
+    {
+        if (*ip >= iend)
+        {
+            return false;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+
+    return true;
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_lz_compress
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_size)
+{
+    uint32_t       table[1 << BPLIB_LZ_HASH_BITS]; /* position + 1 of the last 4 bytes with each hash */
+    const uint8_t *base;
+    const uint8_t *ip;
+    const uint8_t *anchor;
+    const uint8_t *ref;
+    const uint8_t *ilimit;
+    const uint8_t *mlimit;
+    uint8_t       *op;
+    const uint8_t *oend;
+    size_t         match_len;
+    uint32_t       pos;
+    uint32_t       h;
+
+    base   = src;
+    ip     = base;
+    anchor = base;
+    op     = dst;
+    oend   = op + dst_size;
+
+    memset(table, 0, sizeof(table));
+
+    if (src_size > BPLIB_LZ_MATCH_LIMIT)
+    {
+        ilimit = base + src_size - BPLIB_LZ_MATCH_LIMIT;
+        mlimit = base + src_size - BPLIB_LZ_LAST_LITERALS;
+
+        while (ip < ilimit)
+        {
+            h        = bplib_lz_hash(bplib_lz_read32(ip));
+            pos      = table[h];
+            table[h] = (uint32_t)(ip - base) + 1;
+
+            ref = (pos != 0) ? (base + pos - 1) : NULL;
+            if (ref != NULL && (size_t)(ip - ref) <= BPLIB_LZ_MAX_OFFSET && bplib_lz_read32(ref) == bplib_lz_read32(ip))
+            {
+                match_len = BPLIB_LZ_MIN_MATCH;
+                while ((ip + match_len) < mlimit && ref[match_len] == ip[match_len])
+                {
+                    ++match_len;
+                }
+
+                op = bplib_lz_put_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), match_len);
+                if (op == NULL)
+                {
+                    return 0;
+                }
+
+                ip += match_len;
+                anchor = ip;
+            }
+            else
+            {
+                /* the longer it goes without a match the further it steps, so incompressible data is quick */
+                ip += 1 + ((size_t)(ip - anchor) >> 6);
+            }
+        }
+    }
+
+    op = bplib_lz_put_sequence(op, oend, anchor, (size_t)(base + src_size - anchor), 0, 0);
+    if (op == NULL)
+    {
+        return 0;
+    }
+
+    return (size_t)(op - (uint8_t *)dst);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_lz_decompress
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size)
+{
+    const uint8_t *ip;
+    const uint8_t *iend;
+    uint8_t       *op;
+    uint8_t       *oend;
+    const uint8_t *ref;
+    size_t         len;
+    size_t         offset;
+    uint8_t        token;
+
+    ip   = src;
+    iend = ip + src_size;
+    op   = dst;
+    oend = op + dst_size;
+
+    while (ip < iend)
+    {
+        token = *ip++;
+
+        len = token >> 4;
+        if (len == 15 && !bplib_lz_get_length(&ip, iend, &len))
+        {
+            return 0;
+        }
+        if ((size_t)(iend - ip) < len || (size_t)(oend - op) < len)
+        {
+            return 0;
+        }
+
+        memcpy(op, ip, len);
+        op += len;
+        ip += len;
+
+        /* only the last sequence has no match, so this also catches one cut off after its literals */
+        if (ip == iend)
+        {
+            if ((token & 15) != 0)
+            {
+                return 0;
+            }
+            break;
+        }
+
+        if ((iend - ip) < 2)
+        {
+            return 0;
+        }
+        offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - (uint8_t *)dst))
+        {
+            return 0;
+        }
+
+        len = token & 15;
+        if (len == 15 && !bplib_lz_get_length(&ip, iend, &len))
+        {
+            return 0;
+        }
+        len += BPLIB_LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < len)
+        {
+            return 0;
+        }
+
+        /* a match can overlap what it copies, which repeats the last offset bytes */
+        ref = op - offset;
+        if (offset >= len)
+        {
+            memcpy(op, ref, len);
+            op += len;
+        }
+        else
+        {
+            while (len > 0)
+            {
+                *op++ = *ref++;
+                --len;
+            }
+        }
+    }
+
+    return (size_t)(op - (uint8_t *)dst);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_lz_is_compressible
+ *
+ *-----------------------------------------------------------------*/
+bool bplib_lz_is_compressible(const void *src, size_t src_size)
+{
+    uint32_t       counts[256];
+    const uint8_t *ptr;
+    size_t         run_size;
+    size_t         stride;
+    size_t         total;
+    uint64_t       sum_sq;
+    size_t         i;
+    size_t         j;
+
+    memset(counts, 0, sizeof(counts));
+
+    /* runs spread across the data, or all of it if it is small enough */
+    run_size = BPLIB_LZ_SAMPLE_RUN;
+    stride   = src_size / BPLIB_LZ_SAMPLE_RUNS;
+    if (stride < run_size)
+    {
+        run_size = src_size;
+        stride   = src_size;
+    }
+
+    total = 0;
+    ptr   = src;
+    for (i = 0; (i + run_size) <= src_size && run_size != 0; i += stride)
+    {
+        for (j = 0; j < run_size; ++j)
+        {
+            ++counts[ptr[i + j]];
+        }
+        total += run_size;
+    }
+
+    sum_sq = 0;
+    for (i = 0; i < 256; ++i)
+    {
+        sum_sq += (uint64_t)counts[i] * counts[i];
+    }
+
+    return (sum_sq * BPLIB_LZ_ENTROPY_FACTOR) > ((uint64_t)total * total);
+}
@@ -0,0 +1,728 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <assert.h>
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "v7_btree.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/*
+ * Entries per leaf, and children per branch.  With 64-bit keys and pointers a node is a
+ * little over 512 bytes, of which the keys searched on are 4 cache lines together.
+ */
+#define BP_BTREE_FANOUT 32
+
+/*
+ * No tree of this fanout which fits in memory is taller than this, so it bounds the
+ * number of nodes that a single insert may need to split
+ */
+#define BP_BTREE_MAX_HEIGHT 16
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+struct bplib_btree_node
+{
+    struct bplib_btree_node *parent;
+    uint32_t                 count; /* entries in a leaf, children in a branch */
+    bool                     is_leaf;
+
+    /*
+     * In a leaf these are the keys of the entries, in order.  In a branch keys[i] is the
+     * lowest key that child i had when it was split off, so every key under the children
+     * before i is <= keys[i] and every key under the rest is >= keys[i].  Removing entries
+     * does not change that, so these are never updated.  keys[0] is not used in searches.
+     */
+    bp_val_t keys[BP_BTREE_FANOUT];
+
+    union
+    {
+        struct
+        {
+            void                    *entries[BP_BTREE_FANOUT];
+            struct bplib_btree_node *prev;
+            struct bplib_btree_node *next;
+        } leaf;
+        struct bplib_btree_node *children[BP_BTREE_FANOUT];
+    } u;
+};
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * do_alloc_node - gets a zeroed node
+ *
+ * returns: the new node, or NULL if out of memory
+ *-------------------------------------------------------------------------------------*/
+static bplib_btree_node_t *do_alloc_node(bool is_leaf)
+{
+    bplib_btree_node_t *node;
+
+    node = bplib_os_calloc(sizeof(*node));
+    if (node != NULL)
+    {
+        node->is_leaf = is_leaf;
+    }
+
+    return node;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_release_subtree - frees a node and everything under it
+ *-------------------------------------------------------------------------------------*/
+static void do_release_subtree(bplib_btree_node_t *node)
+{
+    uint32_t i;
+
+    if (!node->is_leaf)
+    {
+        for (i = 0; i < node->count; ++i)
+        {
+            do_release_subtree(node->u.children[i]);
+        }
+    }
+
+    bplib_os_free(node);
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_leaf_position - finds where a key goes in a leaf
+ *
+ * upper: if true, the position after any entries with the same key, otherwise before them
+ * returns: position of the first entry with a greater (or equal, if not upper) key
+ *-------------------------------------------------------------------------------------*/
+static uint32_t do_leaf_position(const bplib_btree_node_t *leaf, bp_val_t key_value, bool upper)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    lo = 0;
+    hi = leaf->count;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (leaf->keys[mid] < key_value || (upper && leaf->keys[mid] == key_value))
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_find_leaf - descends to the leaf that a key would be in
+ *
+ * With upper set this is the leaf where an entry would go after any with the same key,
+ * otherwise the one where the first entry with that key (or the next greater key) would be,
+ * though that may turn out to be the first entry of the next leaf.
+ *-------------------------------------------------------------------------------------*/
+static bplib_btree_node_t *do_find_leaf(bplib_btree_node_t *node, bp_val_t key_value, bool upper)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    while (!node->is_leaf)
+    {
+        /* the same search as in a leaf, but over keys[1] onward */
+        lo = 1;
+        hi = node->count;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (node->keys[mid] < key_value || (upper && node->keys[mid] == key_value))
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        node = node->u.children[lo - 1];
+    }
+
+    return node;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_child_index - finds the slot of a node in its parent
+ *-------------------------------------------------------------------------------------*/
+static uint32_t do_child_index(const bplib_btree_node_t *parent, const bplib_btree_node_t *child)
+{
+    uint32_t i;
+
+    for (i = 0; i < parent->count; ++i)
+    {
+        if (parent->u.children[i] == child)
+        {
+            break;
+        }
+    }
+
+    assert(i < parent->count);
+    return i;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_branch_insert - puts a child into a branch which is not full
+ *-------------------------------------------------------------------------------------*/
+static void do_branch_insert(bplib_btree_node_t *branch, uint32_t idx, bp_val_t key_value, bplib_btree_node_t *child)
+{
+    assert(branch->count < BP_BTREE_FANOUT);
+
+    memmove(&branch->keys[idx + 1], &branch->keys[idx], sizeof(branch->keys[0]) * (branch->count - idx));
+    memmove(&branch->u.children[idx + 1], &branch->u.children[idx],
+            sizeof(branch->u.children[0]) * (branch->count - idx));
+
+    branch->keys[idx]       = key_value;
+    branch->u.children[idx] = child;
+    child->parent           = branch;
+    ++branch->count;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_split_node - moves the nodes or entries of a full node from split onward to a new node
+ *
+ * For a leaf, the new node goes after it in the chain of leaves.
+ *-------------------------------------------------------------------------------------*/
+static void do_split_node(bplib_btree_node_t *left, bplib_btree_node_t *right, uint32_t split)
+{
+    uint32_t i;
+
+    right->is_leaf = left->is_leaf;
+    right->count   = left->count - split;
+    memcpy(right->keys, &left->keys[split], sizeof(left->keys[0]) * right->count);
+
+    if (left->is_leaf)
+    {
+        memcpy(right->u.leaf.entries, &left->u.leaf.entries[split], sizeof(left->u.leaf.entries[0]) * right->count);
+
+        right->u.leaf.prev = left;
+        right->u.leaf.next = left->u.leaf.next;
+        if (right->u.leaf.next != NULL)
+        {
+            right->u.leaf.next->u.leaf.prev = right;
+        }
+        left->u.leaf.next = right;
+    }
+    else
+    {
+        memcpy(right->u.children, &left->u.children[split], sizeof(left->u.children[0]) * right->count);
+        for (i = 0; i < right->count; ++i)
+        {
+            right->u.children[i]->parent = right;
+        }
+    }
+
+    left->count = split;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_insert_in_parent - links a node split off from left into the tree, after left
+ *
+ * Branches which are full are split on the way up, using nodes that were already allocated.
+ *
+ * key_value: the lowest key that can be under right
+ * is_append: right was split off from the end of the last leaf, see bplib_btree_insert()
+ * spare: the allocated nodes, taken from the end [INPUT/OUTPUT]
+ *-------------------------------------------------------------------------------------*/
+static void do_insert_in_parent(bplib_btree_t *tree, bplib_btree_node_t *left, bp_val_t key_value,
+                                bplib_btree_node_t *right, bool is_append, bplib_btree_node_t **spare,
+                                uint32_t *num_spare)
+{
+    bplib_btree_node_t *parent;
+    bplib_btree_node_t *sibling;
+    uint32_t            idx;
+
+    while (true)
+    {
+        parent = left->parent;
+        if (parent == NULL)
+        {
+            /* the root was split, so the tree gets taller */
+            assert(*num_spare > 0);
+            parent = spare[--(*num_spare)];
+
+            parent->is_leaf       = false;
+            parent->count         = 1;
+            parent->u.children[0] = left;
+            left->parent          = parent;
+            tree->root            = parent;
+            ++tree->height;
+
+            do_branch_insert(parent, 1, key_value, right);
+            break;
+        }
+
+        idx = do_child_index(parent, left) + 1;
+        if (parent->count < BP_BTREE_FANOUT)
+        {
+            do_branch_insert(parent, idx, key_value, right);
+            break;
+        }
+
+        /* the same as for the leaf, an append after the last child leaves this one full */
+        is_append = is_append && (idx == BP_BTREE_FANOUT);
+
+        assert(*num_spare > 0);
+        sibling = spare[--(*num_spare)];
+        do_split_node(parent, sibling, is_append ? BP_BTREE_FANOUT : (BP_BTREE_FANOUT / 2));
+
+        /* the lowest key under the sibling is the one kept for its first child */
+        if (idx > parent->count || parent->count == BP_BTREE_FANOUT)
+        {
+            do_branch_insert(sibling, idx - parent->count, key_value, right);
+        }
+        else
+        {
+            do_branch_insert(parent, idx, key_value, right);
+        }
+
+        left      = parent;
+        key_value = sibling->keys[0];
+        right     = sibling;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_remove_empty - takes an empty node out of the tree, and any parents that become empty
+ *-------------------------------------------------------------------------------------*/
+static void do_remove_empty(bplib_btree_t *tree, bplib_btree_node_t *node)
+{
+    bplib_btree_node_t *parent;
+    uint32_t            idx;
+
+    if (node->is_leaf)
+    {
+        if (node->u.leaf.prev != NULL)
+        {
+            node->u.leaf.prev->u.leaf.next = node->u.leaf.next;
+        }
+        if (node->u.leaf.next != NULL)
+        {
+            node->u.leaf.next->u.leaf.prev = node->u.leaf.prev;
+        }
+    }
+
+    while (node->count == 0)
+    {
+        parent = node->parent;
+        bplib_os_free(node);
+
+        if (parent == NULL)
+        {
+            /* that was the root */
+            bplib_btree_init(tree);
+            return;
+        }
+
+        idx = do_child_index(parent, node);
+        --parent->count;
+        memmove(&parent->keys[idx], &parent->keys[idx + 1], sizeof(parent->keys[0]) * (parent->count - idx));
+        memmove(&parent->u.children[idx], &parent->u.children[idx + 1],
+                sizeof(parent->u.children[0]) * (parent->count - idx));
+
+        node = parent;
+    }
+
+    /* a root with only one child is not needed */
+    node = tree->root;
+    while (!node->is_leaf && node->count == 1)
+    {
+        tree->root         = node->u.children[0];
+        tree->root->parent = NULL;
+        --tree->height;
+        bplib_os_free(node);
+        node = tree->root;
+    }
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_init - Initializes an empty tree
+ *--------------------------------------------------------------------------------------*/
+void bplib_btree_init(bplib_btree_t *tree)
+{
+    memset(tree, 0, sizeof(*tree));
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_destroy - Releases every node of the tree
+ *--------------------------------------------------------------------------------------*/
+void bplib_btree_destroy(bplib_btree_t *tree)
+{
+    if (tree->root != NULL)
+    {
+        do_release_subtree(tree->root);
+    }
+
+    bplib_btree_init(tree);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_is_empty - Checks if the given tree is empty
+ *--------------------------------------------------------------------------------------*/
+bool bplib_btree_is_empty(const bplib_btree_t *tree)
+{
+    return (tree->num_entries == 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_insert - Inserts an entry into the tree, splitting nodes as needed
+ *
+ * returns: Status code indicating the result of the insertion.
+ *--------------------------------------------------------------------------------------*/
+int bplib_btree_insert(bp_val_t key_value, bplib_btree_t *tree, void *entry, bool allow_duplicate)
+{
+    bplib_btree_node_t *spare[BP_BTREE_MAX_HEIGHT];
+    bplib_btree_node_t *leaf;
+    bplib_btree_node_t *node;
+    uint32_t            num_spare;
+    uint32_t            needed;
+    uint32_t            pos;
+    uint32_t            split;
+
+    if (tree->root == NULL)
+    {
+        tree->root = do_alloc_node(true);
+        if (tree->root == NULL)
+        {
+            return BP_ERROR;
+        }
+        tree->height = 1;
+    }
+
+    leaf = do_find_leaf(tree->root, key_value, true);
+    pos  = do_leaf_position(leaf, key_value, true);
+
+    if (!allow_duplicate)
+    {
+        /* the entry before the insert position is the only one that could have the same key */
+        node = leaf;
+        if (pos == 0)
+        {
+            node = leaf->u.leaf.prev;
+        }
+        if (node != NULL && node->count > 0 && node->keys[((pos == 0) ? node->count : pos) - 1] == key_value)
+        {
+            return BP_DUPLICATE;
+        }
+    }
+
+    /*
+     * Every full node from the leaf up gets split, and a new root is needed if that goes all
+     * the way up.  These are all allocated first so that running out leaves the tree as it was.
+     */
+    needed = 0;
+    node   = leaf;
+    while (node != NULL && node->count == BP_BTREE_FANOUT)
+    {
+        ++needed;
+        node = node->parent;
+    }
+    if (node == NULL && needed > 0)
+    {
+        ++needed;
+    }
+
+    assert(needed <= BP_BTREE_MAX_HEIGHT);
+    for (num_spare = 0; num_spare < needed; ++num_spare)
+    {
+        spare[num_spare] = do_alloc_node(false);
+        if (spare[num_spare] == NULL)
+        {
+            while (num_spare > 0)
+            {
+                bplib_os_free(spare[--num_spare]);
+            }
+            return BP_ERROR;
+        }
+    }
+
+    if (leaf->count == BP_BTREE_FANOUT)
+    {
+        /*
+         * Keys often arrive in ascending order, such as sequence numbers and times, so adding to the
+         * end of the last leaf leaves that one full and starts a new one, rather than leaving a
+         * trail of half full leaves behind.  Otherwise the leaf is split in half.
+         */
+        if (pos == BP_BTREE_FANOUT && leaf->u.leaf.next == NULL)
+        {
+            split = BP_BTREE_FANOUT;
+        }
+        else
+        {
+            split = BP_BTREE_FANOUT / 2;
+        }
+
+        node = spare[--num_spare];
+        do_split_node(leaf, node, split);
+        do_insert_in_parent(tree, leaf, (node->count > 0) ? node->keys[0] : key_value, node,
+                            (split == BP_BTREE_FANOUT), spare, &num_spare);
+
+        if (pos > leaf->count || leaf->count == BP_BTREE_FANOUT)
+        {
+            pos -= leaf->count;
+            leaf = node;
+        }
+    }
+
+    assert(num_spare == 0);
+
+    memmove(&leaf->keys[pos + 1], &leaf->keys[pos], sizeof(leaf->keys[0]) * (leaf->count - pos));
+    memmove(&leaf->u.leaf.entries[pos + 1], &leaf->u.leaf.entries[pos],
+            sizeof(leaf->u.leaf.entries[0]) * (leaf->count - pos));
+
+    leaf->keys[pos]           = key_value;
+    leaf->u.leaf.entries[pos] = entry;
+    ++leaf->count;
+    ++tree->num_entries;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_remove - Removes an entry from the tree
+ *
+ * returns: Status code indicating the result of the removal.
+ *--------------------------------------------------------------------------------------*/
+int bplib_btree_remove(bp_val_t key_value, bplib_btree_t *tree, const void *entry)
+{
+    bplib_btree_node_t *leaf;
+    uint32_t            pos;
+
+    if (tree->root == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* go through the entries with this key until the one referring to this entry */
+    leaf = do_find_leaf(tree->root, key_value, false);
+    pos  = do_leaf_position(leaf, key_value, false);
+    while (true)
+    {
+        if (pos == leaf->count)
+        {
+            leaf = leaf->u.leaf.next;
+            pos  = 0;
+            if (leaf == NULL)
+            {
+                return BP_ERROR;
+            }
+        }
+
+        if (leaf->keys[pos] != key_value)
+        {
+            return BP_ERROR;
+        }
+
+        if (leaf->u.leaf.entries[pos] == entry)
+        {
+            break;
+        }
+
+        ++pos;
+    }
+
+    --leaf->count;
+    --tree->num_entries;
+    memmove(&leaf->keys[pos], &leaf->keys[pos + 1], sizeof(leaf->keys[0]) * (leaf->count - pos));
+    memmove(&leaf->u.leaf.entries[pos], &leaf->u.leaf.entries[pos + 1],
+            sizeof(leaf->u.leaf.entries[0]) * (leaf->count - pos));
+
+    if (leaf->count == 0)
+    {
+        do_remove_empty(tree, leaf);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_search - Searches the tree for an entry with the given key
+ *--------------------------------------------------------------------------------------*/
+void *bplib_btree_search(bp_val_t key_value, const bplib_btree_t *tree)
+{
+    bplib_btree_iter_t iter;
+
+    if (bplib_btree_iter_goto_min(key_value, tree, &iter) != BP_SUCCESS || iter.leaf->keys[iter.position] != key_value)
+    {
+        return NULL;
+    }
+
+    return iter.leaf->u.leaf.entries[iter.position];
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_iter_goto_min
+ *--------------------------------------------------------------------------------------*/
+int bplib_btree_iter_goto_min(bp_val_t minimum_value, const bplib_btree_t *tree, bplib_btree_iter_t *iter)
+{
+    iter->leaf     = NULL;
+    iter->position = 0;
+
+    if (tree->root == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    iter->leaf     = do_find_leaf(tree->root, minimum_value, false);
+    iter->position = do_leaf_position(iter->leaf, minimum_value, false);
+
+    /* all of this leaf was less, so it is the first entry of the next */
+    if (iter->position == iter->leaf->count)
+    {
+        iter->leaf     = iter->leaf->u.leaf.next;
+        iter->position = 0;
+    }
+
+    if (iter->leaf == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_iter_goto_max
+ *--------------------------------------------------------------------------------------*/
+int bplib_btree_iter_goto_max(bp_val_t maximum_value, const bplib_btree_t *tree, bplib_btree_iter_t *iter)
+{
+    iter->leaf     = NULL;
+    iter->position = 0;
+
+    if (tree->root == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    iter->leaf     = do_find_leaf(tree->root, maximum_value, true);
+    iter->position = do_leaf_position(iter->leaf, maximum_value, true);
+
+    /* the one before the upper bound, which may be the last entry of the previous leaf */
+    if (iter->position == 0)
+    {
+        iter->leaf = iter->leaf->u.leaf.prev;
+        if (iter->leaf == NULL)
+        {
+            return BP_ERROR;
+        }
+        iter->position = iter->leaf->count;
+    }
+
+    --iter->position;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_iter_next
+ *
+ * Move to the next entry in an iterator
+ *--------------------------------------------------------------------------------------*/
+int bplib_btree_iter_next(bplib_btree_iter_t *iter)
+{
+    if (iter->leaf == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    ++iter->position;
+    if (iter->position == iter->leaf->count)
+    {
+        iter->leaf     = iter->leaf->u.leaf.next;
+        iter->position = 0;
+        if (iter->leaf == NULL)
+        {
+            /* reached end of tree */
+            return BP_ERROR;
+        }
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_iter_prev
+ *
+ * Move to the previous entry in an iterator
+ *--------------------------------------------------------------------------------------*/
+int bplib_btree_iter_prev(bplib_btree_iter_t *iter)
+{
+    if (iter->leaf == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (iter->position == 0)
+    {
+        iter->leaf = iter->leaf->u.leaf.prev;
+        if (iter->leaf == NULL)
+        {
+            /* reached start of tree */
+            return BP_ERROR;
+        }
+        iter->position = iter->leaf->count;
+    }
+
+    --iter->position;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_iter_get_key
+ *--------------------------------------------------------------------------------------*/
+bp_val_t bplib_btree_iter_get_key(const bplib_btree_iter_t *iter)
+{
+    return iter->leaf->keys[iter->position];
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_btree_iter_get_entry
+ *--------------------------------------------------------------------------------------*/
+void *bplib_btree_iter_get_entry(const bplib_btree_iter_t *iter)
+{
+    return iter->leaf->u.leaf.entries[iter->position];
+}
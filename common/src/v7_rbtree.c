@@ -1012,6 +1012,114 @@ BP_LOCAL_SCOPE void do_delete_rebalance(bplib_rbt_root_t *tree, bplib_rbt_link_t
     }
 }
 
+/*--------------------------------------------------------------------------------------
+ * do_bulk_sort - merge sorts a chain of nodes linked through their right pointers
+ *
+ * This is stable, nodes with the same key stay in the order they were chained.
+ *
+ * head: the first node of the chain
+ * count: number of nodes in the chain
+ * returns: the first node of the sorted chain
+ *-------------------------------------------------------------------------------------*/
+static bplib_rbt_link_t *do_bulk_sort(bplib_rbt_link_t *head, size_t count)
+{
+    bplib_rbt_link_t  *second;
+    bplib_rbt_link_t  *result;
+    bplib_rbt_link_t **tail;
+    size_t             i;
+
+    if (count < 2)
+    {
+        return head;
+    }
+
+    /* split the chain in half and sort each half */
+    second = head;
+    for (i = 1; i < (count / 2); ++i)
+    {
+        second = second->right;
+    }
+    result        = second;
+    second        = second->right;
+    result->right = NULL;
+
+    head   = do_bulk_sort(head, count / 2);
+    second = do_bulk_sort(second, count - (count / 2));
+
+    /* merge, on equal keys the first half goes first */
+    result = NULL;
+    tail   = &result;
+    while (head != NULL && second != NULL)
+    {
+        if (get_key_value(second) < get_key_value(head))
+        {
+            *tail  = second;
+            second = second->right;
+        }
+        else
+        {
+            *tail = head;
+            head  = head->right;
+        }
+        tail = &(*tail)->right;
+    }
+
+    if (head != NULL)
+    {
+        *tail = head;
+    }
+    else
+    {
+        *tail = second;
+    }
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------
+ * do_bulk_build - builds a subtree from the next count nodes of a sorted chain
+ *
+ * The middle node becomes the subtree root each time, so every level is full except the
+ * last one.  Only the nodes in that last level are painted red, which gives every path
+ * the same number of black nodes and never puts one red node under another.
+ *
+ * chain: the next node in the chain, advanced past the nodes used here [INPUT/OUTPUT]
+ * count: number of nodes in the subtree
+ * depth: depth of the subtree root in the whole tree
+ * red_depth: depth of the last level, which is not full
+ * returns: the root of the subtree
+ *-------------------------------------------------------------------------------------*/
+static bplib_rbt_link_t *do_bulk_build(bplib_rbt_link_t **chain, size_t count, uint32_t depth, uint32_t red_depth)
+{
+    bplib_rbt_link_t *left;
+    bplib_rbt_link_t *node;
+
+    if (count == 0)
+    {
+        return NULL;
+    }
+
+    left = do_bulk_build(chain, count / 2, depth + 1, red_depth);
+
+    node   = *chain;
+    *chain = node->right;
+
+    node->parent = NULL;
+    connect_left_child_maybe_null(node, left);
+    connect_right_child_maybe_null(node, do_bulk_build(chain, count - (count / 2) - 1, depth + 1, red_depth));
+
+    if (depth == red_depth)
+    {
+        set_red(node);
+    }
+    else
+    {
+        set_black(node);
+    }
+
+    return node;
+}
+
 /******************************************************************************
  EXPORTED FUNCTIONS
  ******************************************************************************/
@@ -1186,6 +1294,127 @@ int bplib_rbt_extract_node(bplib_rbt_root_t *tree, bplib_rbt_link_t *link_block)
     return BP_SUCCESS;
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_rbt_clear - Removes every node from the tree without rebalancing
+ *
+ * tree: A ptr to a bplib_rbt_root_t to clear. [OUTPUT]
+ *--------------------------------------------------------------------------------------*/
+void bplib_rbt_clear(bplib_rbt_root_t *tree)
+{
+    bplib_rbt_link_t *node;
+    bplib_rbt_link_t *parent;
+
+    /* post-order walk, each node is reset once both of its children are gone */
+    node = tree->root;
+    while (node != NULL)
+    {
+        if (node->left != NULL)
+        {
+            node = node->left;
+        }
+        else if (node->right != NULL)
+        {
+            node = node->right;
+        }
+        else
+        {
+            parent = node->parent;
+            if (parent != NULL)
+            {
+                *(find_parent_ref(tree, node)) = NULL;
+            }
+
+            /* same as extract, this clears the node value and resets it to 0 */
+            memset(node, 0, sizeof(*node));
+            node = parent;
+        }
+    }
+
+    bplib_rbt_init_root(tree);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_rbt_bulk_init - Initializes an empty set of nodes for bulk loading
+ *--------------------------------------------------------------------------------------*/
+void bplib_rbt_bulk_init(bplib_rbt_bulk_t *bulk)
+{
+    memset(bulk, 0, sizeof(*bulk));
+    bulk->is_sorted = true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_rbt_bulk_append - Sets the key of a node and adds it to a set for bulk loading
+ *
+ * returns: Status code indicating the result of the append.
+ *--------------------------------------------------------------------------------------*/
+int bplib_rbt_bulk_append(bplib_rbt_bulk_t *bulk, bp_val_t key_value, bplib_rbt_link_t *link_block)
+{
+    if (bulk->first == link_block || node_is_attached(link_block))
+    {
+        return BP_ERROR;
+    }
+
+    initialize_node_value(link_block, key_value);
+
+    /* the set is chained through the right pointers until it is loaded */
+    if (bulk->last == NULL)
+    {
+        bulk->first = link_block;
+    }
+    else
+    {
+        if (key_value < get_key_value(bulk->last))
+        {
+            bulk->is_sorted = false;
+        }
+        bulk->last->right = link_block;
+    }
+
+    bulk->last = link_block;
+    ++bulk->count;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_rbt_bulk_load - Builds a balanced tree from a set of nodes
+ *
+ * returns: Status code indicating the result of the load.
+ *--------------------------------------------------------------------------------------*/
+int bplib_rbt_bulk_load(bplib_rbt_root_t *tree, bplib_rbt_bulk_t *bulk)
+{
+    bplib_rbt_link_t *chain;
+    uint32_t          red_depth;
+    size_t            full_count;
+
+    if (tree->root != NULL)
+    {
+        return BP_ERROR;
+    }
+
+    chain = bulk->first;
+    if (!bulk->is_sorted)
+    {
+        chain = do_bulk_sort(chain, bulk->count);
+    }
+
+    /* the last level is the first one that the count does not fill */
+    red_depth  = 0;
+    full_count = 1;
+    while (full_count <= bulk->count)
+    {
+        ++red_depth;
+        full_count = (full_count << 1) | 1;
+    }
+
+    tree->root         = do_bulk_build(&chain, bulk->count, 0, red_depth);
+    tree->black_height = red_depth;
+
+    bplib_rbt_bulk_init(bulk);
+
+    return BP_SUCCESS;
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_rbt_get_key_value
  *
@@ -1423,3 +1652,44 @@ int bplib_rbt_iter_goto_max(bp_val_t maximum_value, const bplib_rbt_root_t *tree
 
     return status;
 }
+
+/*--------------------------------------------------------------------------------------
+ * bplib_rbt_scan_range
+ *
+ * Visit each node in a range, where the scan function may remove the node
+ *--------------------------------------------------------------------------------------*/
+uint32_t bplib_rbt_scan_range(bp_val_t minimum_value, bp_val_t maximum_value, bplib_rbt_root_t *tree,
+                              bplib_rbt_scan_func_t scan_func, void *scan_arg)
+{
+    bplib_rbt_iter_t        iter;
+    bplib_rbt_link_t       *node;
+    bplib_rbt_scan_action_t action;
+    uint32_t                count;
+    int                     status;
+
+    count  = 0;
+    status = bplib_rbt_iter_goto_min(minimum_value, tree, &iter);
+    while (status == BP_SUCCESS && get_key_value(iter.position) <= maximum_value)
+    {
+        /*
+         * The iterator moves on before the node is visited.  Taking the node out may swap
+         * the positions of others, but not their order, so the next one is still the next.
+         */
+        node   = (bplib_rbt_link_t *)iter.position;
+        status = bplib_rbt_iter_next(&iter);
+        action = scan_func(node, scan_arg);
+        ++count;
+
+        /* this does nothing if the scan function already took it out */
+        if (action == bplib_rbt_scan_remove)
+        {
+            bplib_rbt_extract_node(tree, node);
+        }
+        else if (action == bplib_rbt_scan_stop)
+        {
+            break;
+        }
+    }
+
+    return count;
+}
@@ -24,6 +24,7 @@
 void UtTest_Setup(void)
 {
     UtTest_Add(TestBplibCommon_CRC_Execute, TestBplibCommon_CRC_Setup, NULL, "CRC");
+    UtTest_Add(TestBplibCommon_LZ_Execute, NULL, NULL, "LZ");
 
     /* The RBT setup is only needed once, and serves for all RBT tests */
     UtTest_Add(NULL, TestBplibCommon_RBT_Setup, NULL, "RB Tree Setup");
@@ -33,4 +34,10 @@ void UtTest_Setup(void)
     UtTest_Add(TestBplibCommon_RBT_Unique, NULL, NULL, "RB Tree Unique Indices");
     UtTest_Add(TestBplibCommon_RBT_NonUnique, NULL, NULL, "RB Tree NonUnique Indices");
     UtTest_Add(TestBplibCommon_RBT_Iterator, NULL, NULL, "RB Tree Iterator");
+    UtTest_Add(TestBplibCommon_RBT_Bulk, NULL, NULL, "RB Tree Bulk Load/Clear");
+    UtTest_Add(TestBplibCommon_RBT_ScanRange, NULL, NULL, "RB Tree Range Scan");
+
+    UtTest_Add(TestBplibCommon_BTree_Unique, NULL, NULL, "B+ Tree Unique Indices");
+    UtTest_Add(TestBplibCommon_BTree_NonUnique, NULL, NULL, "B+ Tree NonUnique Indices");
+    UtTest_Add(TestBplibCommon_BTree_Sequential, NULL, NULL, "B+ Tree Sequential Keys");
 }
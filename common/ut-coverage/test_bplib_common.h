@@ -26,6 +26,8 @@
 void TestBplibCommon_CRC_Setup(void);
 void TestBplibCommon_CRC_Execute(void);
 
+void TestBplibCommon_LZ_Execute(void);
+
 void TestBplibCommon_RBT_Setup(void);
 void TestBplibCommon_RBT_LeafNodeInsertDelete(void);
 void TestBplibCommon_RBT_NonLeafDelete(void);
@@ -33,5 +35,11 @@ void TestBplibCommon_RBT_Basics(void);
 void TestBplibCommon_RBT_Unique(void);
 void TestBplibCommon_RBT_NonUnique(void);
 void TestBplibCommon_RBT_Iterator(void);
+void TestBplibCommon_RBT_Bulk(void);
+void TestBplibCommon_RBT_ScanRange(void);
+
+void TestBplibCommon_BTree_Unique(void);
+void TestBplibCommon_BTree_NonUnique(void);
+void TestBplibCommon_BTree_Sequential(void);
 
 #endif
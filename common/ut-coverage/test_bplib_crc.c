@@ -117,6 +117,76 @@ void Test_bplib_crc_update(void)
     UtAssert_UINT32_EQ(bplib_crc_update(&UT_BPLIB_CRC6, 0x23, "dd", 2), 0x02);
 }
 
+void Test_bplib_crc_update_list(void)
+{
+    /* Test function for:
+     * bp_crcval_t bplib_crc_update_list(bplib_crc_parameters_t *params, bp_crcval_t crc, const bplib_iovec_t *iov,
+     *                                   size_t iov_count);
+     */
+    uint8_t       buf[100];
+    bplib_iovec_t iov[4];
+    size_t        split;
+    size_t        i;
+
+    for (i = 0; i < sizeof(buf); ++i)
+    {
+        buf[i] = (uint8_t)((i * 53) + 7);
+    }
+
+    /* no entries, and an entry of no size which is not looked at */
+    UtAssert_UINT32_EQ(bplib_crc_update_list(&BPLIB_CRC32_CASTAGNOLI, 0x12345678, iov, 0), 0x12345678);
+    iov[0].base = NULL;
+    iov[0].len  = 0;
+    UtAssert_UINT32_EQ(bplib_crc_update_list(&BPLIB_CRC16_X25, 0x1234, iov, 1), 0x1234);
+    UtAssert_UINT32_EQ(bplib_crc_update_list(&BPLIB_CRC_NONE, 0x12345678, iov, 1), 0x12345678);
+
+    /* same as one update over the whole buffer, wherever it is split, with an empty entry in the middle */
+    for (split = 0; split <= 40; ++split)
+    {
+        iov[0].base = buf;
+        iov[0].len  = split;
+        iov[1].base = NULL;
+        iov[1].len  = 0;
+        iov[2].base = &buf[split];
+        iov[2].len  = 60 - split;
+        iov[3].base = &buf[60];
+        iov[3].len  = sizeof(buf) - 60;
+
+        if (bplib_crc_update_list(&BPLIB_CRC32_CASTAGNOLI, 0x12345678, iov, 4) !=
+                bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, 0x12345678, buf, sizeof(buf)) ||
+            bplib_crc_digest_list_CRC32_C_TABLE(0x12345678, iov, 4) !=
+                bplib_crc_digest_CRC32_C_TABLE(0x12345678, buf, sizeof(buf)))
+        {
+            UtAssert_Failed("CRC-32 list mismatch at split %lu", (unsigned long)split);
+        }
+
+        if (bplib_crc_update_list(&BPLIB_CRC16_X25, 0x1234, iov, 4) !=
+                bplib_crc_update(&BPLIB_CRC16_X25, 0x1234, buf, sizeof(buf)) ||
+            bplib_crc_digest_list_CRC16_X25_TABLE(0x1234, iov, 4) !=
+                bplib_crc_digest_CRC16_X25_TABLE(0x1234, buf, sizeof(buf)))
+        {
+            UtAssert_Failed("CRC-16 list mismatch at split %lu", (unsigned long)split);
+        }
+
+        /* an algorithm without a list digest does each entry in turn */
+        if (bplib_crc_update_list(&UT_BPLIB_CRC6, 0x23, iov, 4) !=
+            bplib_crc_update(&UT_BPLIB_CRC6, 0x23, buf, sizeof(buf)))
+        {
+            UtAssert_Failed("CRC-6 list mismatch at split %lu", (unsigned long)split);
+        }
+    }
+
+    iov[0].base = "123456789";
+    iov[0].len  = 4;
+    iov[1].base = "56789";
+    iov[1].len  = 5;
+    UtAssert_UINT32_EQ(bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI,
+                                          bplib_crc_update_list(&BPLIB_CRC32_CASTAGNOLI,
+                                                                bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI),
+                                                                iov, 2)),
+                       0xe3069283);
+}
+
 void Test_bplib_crc_finalize(void)
 {
     /* Test function for:
@@ -133,7 +203,7 @@ void Test_bplib_crc_finalize(void)
 void Test_bplib_crc_get(void)
 {
     /* Test function for:
-     * bp_crcval_t bplib_crc_get(const void *data, const uint32_t length, bplib_crc_parameters_t *params);
+     * bp_crcval_t bplib_crc_get(const void *data, size_t length, bplib_crc_parameters_t *params);
      */
 
     /*
@@ -149,6 +219,67 @@ void Test_bplib_crc_get(void)
     UtAssert_UINT32_EQ(bplib_crc_get("123456789", 9, &UT_BPLIB_CRC6), 0x06);
 }
 
+void Test_bplib_crc_is_hw_accelerated(void)
+{
+    /* Test function for:
+     * bool bplib_crc_is_hw_accelerated(bplib_crc_parameters_t *params);
+     */
+    uint8_t     buf[80];
+    bp_crcval_t crc;
+    size_t      offset;
+    size_t      size;
+
+    UtAssert_BOOL_FALSE(bplib_crc_is_hw_accelerated(&BPLIB_CRC16_X25));
+    UtAssert_BOOL_FALSE(bplib_crc_is_hw_accelerated(&BPLIB_CRC_NONE));
+    UtPrintf("CRC-32 Castagnoli uses CRC instructions: %s",
+             bplib_crc_is_hw_accelerated(&BPLIB_CRC32_CASTAGNOLI) ? "yes" : "no");
+
+    for (size = 0; size < sizeof(buf); ++size)
+    {
+        buf[size] = (uint8_t)((size * 37) + 11);
+    }
+
+    /* whichever implementations are in use must agree with the tables at any alignment and length */
+    for (offset = 0; offset < 8; ++offset)
+    {
+        for (size = 0; size <= (sizeof(buf) - offset); ++size)
+        {
+            crc = bplib_crc_digest_CRC32_C_TABLE(0x12345678, &buf[offset], size);
+            if (bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, 0x12345678, &buf[offset], size) != crc)
+            {
+                UtAssert_Failed("CRC-32 mismatch at offset %lu size %lu", (unsigned long)offset, (unsigned long)size);
+            }
+
+            crc = bplib_crc_digest_CRC16_X25_TABLE(0x1234, &buf[offset], size);
+            if (bplib_crc_update(&BPLIB_CRC16_X25, 0x1234, &buf[offset], size) != crc)
+            {
+                UtAssert_Failed("CRC-16 mismatch at offset %lu size %lu", (unsigned long)offset, (unsigned long)size);
+            }
+        }
+    }
+}
+
+void Test_bplib_crc_get_kernel(void)
+{
+    /* Test function for:
+     * bplib_crc_digest_func_t bplib_crc_get_kernel(bplib_crc_parameters_t *params, bplib_crc_kernel_t kernel);
+     */
+    bool has_hw;
+
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC16_X25, bplib_crc_kernel_table) ==
+                       bplib_crc_digest_CRC16_X25_TABLE);
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC32_CASTAGNOLI, bplib_crc_kernel_table) ==
+                       bplib_crc_digest_CRC32_C_TABLE);
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC16_X25, bplib_crc_kernel_slice8) != NULL);
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC32_CASTAGNOLI, bplib_crc_kernel_slice8) != NULL);
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC16_X25, bplib_crc_kernel_hw) == NULL);
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC32_CASTAGNOLI, bplib_crc_kernel_max) == NULL);
+    UtAssert_BOOL_TRUE(bplib_crc_get_kernel(&BPLIB_CRC_NONE, bplib_crc_kernel_table) == NULL);
+
+    has_hw = (bplib_crc_get_kernel(&BPLIB_CRC32_CASTAGNOLI, bplib_crc_kernel_hw) != NULL);
+    UtAssert_BOOL_TRUE(has_hw == bplib_crc_is_hw_accelerated(&BPLIB_CRC32_CASTAGNOLI));
+}
+
 void TestBplibCommon_CRC_Setup(void)
 {
     UtAssert_VOIDCALL(bplib_crc_init());
@@ -171,6 +302,9 @@ void TestBplibCommon_CRC_Execute(void)
     Test_bplib_crc_get_width();
     Test_bplib_crc_initial_value();
     Test_bplib_crc_update();
+    Test_bplib_crc_update_list();
     Test_bplib_crc_finalize();
     Test_bplib_crc_get();
+    Test_bplib_crc_is_hw_accelerated();
+    Test_bplib_crc_get_kernel();
 }
@@ -0,0 +1,152 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "test_bplib_common.h"
+#include "lz.h"
+
+#include <string.h>
+
+#define UT_BPLIB_LZ_DATA_SIZE 3000
+
+static uint8_t UT_BPLIB_LZ_DATA[UT_BPLIB_LZ_DATA_SIZE];
+static uint8_t UT_BPLIB_LZ_COMPRESSED[UT_BPLIB_LZ_DATA_SIZE + 64];
+static uint8_t UT_BPLIB_LZ_OUTPUT[UT_BPLIB_LZ_DATA_SIZE];
+
+/* a simple generator so the "random" data is the same on every run */
+static void UT_bplib_lz_fill_random(uint8_t *ptr, size_t size)
+{
+    uint32_t state = 0x12345678;
+
+    while (size > 0)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        *ptr++ = (uint8_t)state;
+        --size;
+    }
+}
+
+void Test_bplib_lz_compress(void)
+{
+    /* Test function for:
+     * size_t bplib_lz_compress(const void *src, size_t src_size, void *dst, size_t dst_size);
+     */
+    static const uint8_t RUN_OF_A[] = {0x1F, 'a', 0x01, 0x00, 0x07, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    size_t               i;
+
+    /* one literal, a match of the next 26 at offset 1, and the last 5 as literals, as LZ4 would do it */
+    memset(UT_BPLIB_LZ_DATA, 'a', 32);
+    UtAssert_UINT32_EQ(bplib_lz_compress(UT_BPLIB_LZ_DATA, 32, UT_BPLIB_LZ_COMPRESSED, 32), sizeof(RUN_OF_A));
+    UtAssert_MemCmp(UT_BPLIB_LZ_COMPRESSED, RUN_OF_A, sizeof(RUN_OF_A), "Compressed run");
+
+    /* too short to have a match, it is all literals */
+    UtAssert_UINT32_EQ(bplib_lz_compress("abc", 3, UT_BPLIB_LZ_COMPRESSED, 32), 4);
+    UtAssert_UINT32_EQ(UT_BPLIB_LZ_COMPRESSED[0], 0x30);
+    UtAssert_UINT32_EQ(bplib_lz_compress("abc", 0, UT_BPLIB_LZ_COMPRESSED, 32), 1);
+
+    /* does not fit */
+    UtAssert_ZERO(bplib_lz_compress(UT_BPLIB_LZ_DATA, 32, UT_BPLIB_LZ_COMPRESSED, 10));
+    UtAssert_ZERO(bplib_lz_compress("abc", 3, UT_BPLIB_LZ_COMPRESSED, 3));
+
+    /* random data does not get smaller */
+    UT_bplib_lz_fill_random(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA));
+    UtAssert_ZERO(bplib_lz_compress(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA), UT_BPLIB_LZ_COMPRESSED,
+                                    sizeof(UT_BPLIB_LZ_DATA)));
+
+    /* long literal and match lengths, which take extra bytes */
+    for (i = 0; i < sizeof(UT_BPLIB_LZ_DATA); ++i)
+    {
+        if (i >= 600)
+        {
+            UT_BPLIB_LZ_DATA[i] = UT_BPLIB_LZ_DATA[i % 600];
+        }
+    }
+    UtAssert_NONZERO(bplib_lz_compress(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA), UT_BPLIB_LZ_COMPRESSED,
+                                       sizeof(UT_BPLIB_LZ_DATA) / 2));
+}
+
+void Test_bplib_lz_decompress(void)
+{
+    /* Test function for:
+     * size_t bplib_lz_decompress(const void *src, size_t src_size, void *dst, size_t dst_size);
+     */
+    static const uint8_t RUN_OF_A[]    = {0x1F, 'a', 0x01, 0x00, 0x07, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    static const uint8_t BAD_OFFSET[]  = {0x14, 'a', 0x02, 0x00, 0x00};
+    static const uint8_t SHORT_MATCH[] = {0x14, 'a', 0x01};
+    static const uint8_t SHORT_LEN[]   = {0xF0, 0xFF};
+    size_t               size;
+    size_t               i;
+
+    UtAssert_UINT32_EQ(bplib_lz_decompress(RUN_OF_A, sizeof(RUN_OF_A), UT_BPLIB_LZ_OUTPUT, 32), 32);
+    for (i = 0; i < 32 && UT_BPLIB_LZ_OUTPUT[i] == 'a'; ++i)
+        ;
+    UtAssert_UINT32_EQ(i, 32);
+
+    /* each of these is not valid, and nothing is written past the end */
+    UtAssert_ZERO(bplib_lz_decompress(RUN_OF_A, sizeof(RUN_OF_A), UT_BPLIB_LZ_OUTPUT, 31));
+    UtAssert_ZERO(bplib_lz_decompress(RUN_OF_A, 4, UT_BPLIB_LZ_OUTPUT, 32));
+    UtAssert_ZERO(bplib_lz_decompress(RUN_OF_A, 2, UT_BPLIB_LZ_OUTPUT, 32));
+    UtAssert_ZERO(bplib_lz_decompress(BAD_OFFSET, sizeof(BAD_OFFSET), UT_BPLIB_LZ_OUTPUT, 32));
+    UtAssert_ZERO(bplib_lz_decompress(SHORT_MATCH, sizeof(SHORT_MATCH), UT_BPLIB_LZ_OUTPUT, 32));
+    UtAssert_ZERO(bplib_lz_decompress(SHORT_LEN, sizeof(SHORT_LEN), UT_BPLIB_LZ_OUTPUT, 32));
+
+    /* round trip through both, with long lengths */
+    UT_bplib_lz_fill_random(UT_BPLIB_LZ_DATA, 600);
+    for (i = 600; i < sizeof(UT_BPLIB_LZ_DATA); ++i)
+    {
+        UT_BPLIB_LZ_DATA[i] = UT_BPLIB_LZ_DATA[i % 600];
+    }
+    size = bplib_lz_compress(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA), UT_BPLIB_LZ_COMPRESSED,
+                             sizeof(UT_BPLIB_LZ_COMPRESSED));
+    UtAssert_NONZERO(size);
+    UtAssert_UINT32_EQ(
+        bplib_lz_decompress(UT_BPLIB_LZ_COMPRESSED, size, UT_BPLIB_LZ_OUTPUT, sizeof(UT_BPLIB_LZ_OUTPUT)),
+        sizeof(UT_BPLIB_LZ_DATA));
+    UtAssert_MemCmp(UT_BPLIB_LZ_OUTPUT, UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA), "Round trip");
+}
+
+void Test_bplib_lz_is_compressible(void)
+{
+    /* Test function for:
+     * bool bplib_lz_is_compressible(const void *src, size_t src_size);
+     */
+    size_t i;
+
+    UT_bplib_lz_fill_random(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA));
+    UtAssert_BOOL_FALSE(bplib_lz_is_compressible(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA)));
+    UtAssert_BOOL_FALSE(bplib_lz_is_compressible(UT_BPLIB_LZ_DATA, 0));
+
+    /* few byte values, sampled in runs and in full */
+    for (i = 0; i < sizeof(UT_BPLIB_LZ_DATA); ++i)
+    {
+        UT_BPLIB_LZ_DATA[i] &= 0x0F;
+    }
+    UtAssert_BOOL_TRUE(bplib_lz_is_compressible(UT_BPLIB_LZ_DATA, sizeof(UT_BPLIB_LZ_DATA)));
+    UtAssert_BOOL_TRUE(bplib_lz_is_compressible(UT_BPLIB_LZ_DATA, 100));
+}
+
+void TestBplibCommon_LZ_Execute(void)
+{
+    Test_bplib_lz_compress();
+    Test_bplib_lz_decompress();
+    Test_bplib_lz_is_compressible();
+}
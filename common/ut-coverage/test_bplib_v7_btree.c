@@ -0,0 +1,315 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+#include <stdlib.h>
+
+#include "test_bplib_common.h"
+#include "bplib_os.h"
+#include "v7_btree.h"
+
+/************************************************************************
+ *
+ *  Test program for the B+ tree implementation
+ *
+ *  The node layout is private to the implementation, so the trees are
+ *  checked through the API alone: every entry must be found by search,
+ *  and iterating must visit them in key order.
+ *
+ *************************************************************************/
+
+#define BTEST_SIZE 3072
+
+static int btest_entries[BTEST_SIZE];
+static int btest_nodes_allocated;
+static int btest_alloc_limit;
+
+static void UT_btest_calloc_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    size_t size = UT_Hook_GetArgValueByName(Context, "size", size_t);
+    void  *retval;
+
+    /* a limit below 0 means none */
+    retval = NULL;
+    if (btest_alloc_limit != 0)
+    {
+        retval = calloc(1, size);
+        ++btest_nodes_allocated;
+        if (btest_alloc_limit > 0)
+        {
+            --btest_alloc_limit;
+        }
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_btest_free_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    void *ptr = UT_Hook_GetArgValueByName(Context, "ptr", void *);
+
+    --btest_nodes_allocated;
+    free(ptr);
+}
+
+static void Test_BTree_Setup(void)
+{
+    btest_nodes_allocated = 0;
+    btest_alloc_limit     = -1;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_btest_calloc_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_free), UT_btest_free_Handler, NULL);
+}
+
+/* a permutation of 0..BTEST_SIZE-1, so every key is visited once */
+static int Test_BTree_Shuffle(int i)
+{
+    return (i * 1237) % BTEST_SIZE;
+}
+
+/* walks the whole tree in both directions, checking the order and the count */
+static void Test_BTree_CheckOrder(const bplib_btree_t *tree)
+{
+    bplib_btree_iter_t it;
+    bp_val_t           last_val;
+    size_t             count;
+    int                status;
+
+    count    = 0;
+    last_val = 0;
+    status   = bplib_btree_iter_goto_min(0, tree, &it);
+    while (status == BP_SUCCESS)
+    {
+        if (bplib_btree_iter_get_key(&it) < last_val)
+        {
+            UtAssert_Failed("Key %lu after %lu", (unsigned long)bplib_btree_iter_get_key(&it),
+                            (unsigned long)last_val);
+        }
+        last_val = bplib_btree_iter_get_key(&it);
+        ++count;
+        status = bplib_btree_iter_next(&it);
+    }
+    UtAssert_UINT32_EQ(count, tree->num_entries);
+
+    count  = 0;
+    status = bplib_btree_iter_goto_max(~(bp_val_t)0, tree, &it);
+    while (status == BP_SUCCESS)
+    {
+        if (bplib_btree_iter_get_key(&it) > last_val)
+        {
+            UtAssert_Failed("Key %lu before %lu", (unsigned long)bplib_btree_iter_get_key(&it),
+                            (unsigned long)last_val);
+        }
+        last_val = bplib_btree_iter_get_key(&it);
+        ++count;
+        status = bplib_btree_iter_prev(&it);
+    }
+    UtAssert_UINT32_EQ(count, tree->num_entries);
+}
+
+void TestBplibCommon_BTree_Unique(void)
+{
+    bplib_btree_t      tree;
+    bplib_btree_iter_t it;
+    int                i;
+    int                k;
+
+    Test_BTree_Setup();
+
+    memset(&tree, 0xEE, sizeof(tree));
+    UtAssert_VOIDCALL(bplib_btree_init(&tree));
+    UtAssert_BOOL_TRUE(bplib_btree_is_empty(&tree));
+    UtAssert_NULL(bplib_btree_search(1, &tree));
+    UtAssert_INT32_EQ(bplib_btree_remove(1, &tree, &btest_entries[1]), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_min(0, &tree, &it), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_max(0, &tree, &it), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_next(&it), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_prev(&it), BP_ERROR);
+
+    /* no memory for the first node */
+    btest_alloc_limit = 0;
+    UtAssert_INT32_EQ(bplib_btree_insert(10, &tree, &btest_entries[10], false), BP_ERROR);
+    UtAssert_BOOL_TRUE(bplib_btree_is_empty(&tree));
+    btest_alloc_limit = -1;
+
+    /* in a scattered order, keys are 1 and up so that 0 is never in the tree */
+    for (i = 0; i < BTEST_SIZE; ++i)
+    {
+        k = Test_BTree_Shuffle(i);
+        UtAssert_INT32_EQ(bplib_btree_insert(1 + k, &tree, &btest_entries[k], false), BP_SUCCESS);
+    }
+    UtAssert_UINT32_EQ(tree.num_entries, BTEST_SIZE);
+    UtAssert_UINT32_GT(tree.height, 2);
+    Test_BTree_CheckOrder(&tree);
+
+    for (k = 0; k < BTEST_SIZE; ++k)
+    {
+        if (bplib_btree_search(1 + k, &tree) != &btest_entries[k])
+        {
+            UtAssert_Failed("Key %d not found", 1 + k);
+        }
+        if (bplib_btree_insert(1 + k, &tree, &btest_entries[0], false) != BP_DUPLICATE)
+        {
+            UtAssert_Failed("Key %d was added twice", 1 + k);
+        }
+    }
+    UtAssert_NULL(bplib_btree_search(0, &tree));
+    UtAssert_NULL(bplib_btree_search(BTEST_SIZE + 1, &tree));
+
+    /* bounds which are between, before and after the keys */
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_min(0, &tree, &it), BP_SUCCESS);
+    UtAssert_UINT32_EQ(bplib_btree_iter_get_key(&it), 1);
+    UtAssert_ADDRESS_EQ(bplib_btree_iter_get_entry(&it), &btest_entries[0]);
+    UtAssert_INT32_EQ(bplib_btree_iter_prev(&it), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_max(BTEST_SIZE + 10, &tree, &it), BP_SUCCESS);
+    UtAssert_UINT32_EQ(bplib_btree_iter_get_key(&it), BTEST_SIZE);
+    UtAssert_INT32_EQ(bplib_btree_iter_next(&it), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_min(BTEST_SIZE + 1, &tree, &it), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_max(0, &tree, &it), BP_ERROR);
+
+    /* every other one, so that there are gaps to search into */
+    for (k = 1; k < BTEST_SIZE; k += 2)
+    {
+        UtAssert_INT32_EQ(bplib_btree_remove(1 + k, &tree, &btest_entries[k]), BP_SUCCESS);
+    }
+    UtAssert_INT32_EQ(bplib_btree_remove(2, &tree, &btest_entries[1]), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_remove(1, &tree, &btest_entries[1]), BP_ERROR);
+    UtAssert_UINT32_EQ(tree.num_entries, BTEST_SIZE / 2);
+    Test_BTree_CheckOrder(&tree);
+
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_min(100, &tree, &it), BP_SUCCESS);
+    UtAssert_UINT32_EQ(bplib_btree_iter_get_key(&it), 101);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_max(100, &tree, &it), BP_SUCCESS);
+    UtAssert_UINT32_EQ(bplib_btree_iter_get_key(&it), 99);
+
+    /* the rest, in the scattered order again, which releases every node */
+    for (i = 0; i < BTEST_SIZE; ++i)
+    {
+        k = Test_BTree_Shuffle(i);
+        if ((k & 1) == 0 && bplib_btree_remove(1 + k, &tree, &btest_entries[k]) != BP_SUCCESS)
+        {
+            UtAssert_Failed("Key %d not removed", 1 + k);
+        }
+    }
+    UtAssert_BOOL_TRUE(bplib_btree_is_empty(&tree));
+    UtAssert_NULL(tree.root);
+    UtAssert_ZERO(tree.height);
+    UtAssert_ZERO(btest_nodes_allocated);
+}
+
+void TestBplibCommon_BTree_NonUnique(void)
+{
+    bplib_btree_t      tree;
+    bplib_btree_iter_t it;
+    int                i;
+    int                count;
+
+    Test_BTree_Setup();
+    bplib_btree_init(&tree);
+
+    /* enough of the same key to span several leaves, between others on either side */
+    UtAssert_INT32_EQ(bplib_btree_insert(5, &tree, &btest_entries[0], true), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_btree_insert(300, &tree, &btest_entries[1], true), BP_SUCCESS);
+    for (i = 10; i < 200; ++i)
+    {
+        UtAssert_INT32_EQ(bplib_btree_insert(100, &tree, &btest_entries[i], true), BP_SUCCESS);
+    }
+    UtAssert_INT32_EQ(bplib_btree_insert(100, &tree, &btest_entries[2], false), BP_DUPLICATE);
+    Test_BTree_CheckOrder(&tree);
+
+    /* same keys stay in the order they were inserted */
+    UtAssert_ADDRESS_EQ(bplib_btree_search(100, &tree), &btest_entries[10]);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_min(100, &tree, &it), BP_SUCCESS);
+    count = 0;
+    for (i = 10; i < 200; ++i)
+    {
+        if (bplib_btree_iter_get_entry(&it) == &btest_entries[i])
+        {
+            ++count;
+        }
+        bplib_btree_iter_next(&it);
+    }
+    UtAssert_INT32_EQ(count, 190);
+    UtAssert_UINT32_EQ(bplib_btree_iter_get_key(&it), 300);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_max(100, &tree, &it), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bplib_btree_iter_get_entry(&it), &btest_entries[199]);
+
+    /* only the given entry is removed */
+    UtAssert_INT32_EQ(bplib_btree_remove(100, &tree, &btest_entries[2]), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_remove(100, &tree, &btest_entries[150]), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_btree_remove(100, &tree, &btest_entries[150]), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_btree_remove(100, &tree, &btest_entries[10]), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bplib_btree_search(100, &tree), &btest_entries[11]);
+    UtAssert_UINT32_EQ(tree.num_entries, 190);
+    Test_BTree_CheckOrder(&tree);
+
+    UtAssert_VOIDCALL(bplib_btree_destroy(&tree));
+    UtAssert_BOOL_TRUE(bplib_btree_is_empty(&tree));
+    UtAssert_ZERO(btest_nodes_allocated);
+    UtAssert_VOIDCALL(bplib_btree_destroy(&tree));
+}
+
+void TestBplibCommon_BTree_Sequential(void)
+{
+    bplib_btree_t      tree;
+    bplib_btree_iter_t it;
+    int                i;
+    int                nodes;
+
+    Test_BTree_Setup();
+    bplib_btree_init(&tree);
+
+    /* keys in ascending order fill each node before starting the next, so these are all full */
+    for (i = 0; i < BTEST_SIZE; ++i)
+    {
+        UtAssert_INT32_EQ(bplib_btree_insert(1 + i, &tree, &btest_entries[i], false), BP_SUCCESS);
+    }
+    Test_BTree_CheckOrder(&tree);
+    UtAssert_INT32_EQ(btest_nodes_allocated, (BTEST_SIZE / 32) + (BTEST_SIZE / 1024) + 1);
+
+    /* running out part way through a split leaves the tree as it was */
+    nodes = btest_nodes_allocated;
+    for (i = 0; i < 20; ++i)
+    {
+        btest_alloc_limit = i;
+        if (bplib_btree_insert(6000 + i, &tree, &btest_entries[0], false) == BP_SUCCESS)
+        {
+            break;
+        }
+        UtAssert_INT32_EQ(btest_nodes_allocated, nodes);
+    }
+    btest_alloc_limit = -1;
+    UtAssert_UINT32_EQ(tree.num_entries, BTEST_SIZE + 1);
+    Test_BTree_CheckOrder(&tree);
+
+    /* the first key of the second leaf is gone, so the one before is at the end of the first */
+    UtAssert_INT32_EQ(bplib_btree_remove(33, &tree, &btest_entries[32]), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_btree_iter_goto_max(33, &tree, &it), BP_SUCCESS);
+    UtAssert_UINT32_EQ(bplib_btree_iter_get_key(&it), 32);
+    UtAssert_INT32_EQ(bplib_btree_insert(33, &tree, &btest_entries[32], false), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_btree_remove(7000, &tree, &btest_entries[0]), BP_ERROR);
+
+    /* and in descending order */
+    for (i = 0; i < BTEST_SIZE; ++i)
+    {
+        UtAssert_INT32_EQ(bplib_btree_remove(BTEST_SIZE - i, &tree, &btest_entries[BTEST_SIZE - i - 1]), BP_SUCCESS);
+    }
+    UtAssert_UINT32_EQ(tree.num_entries, 1);
+    Test_BTree_CheckOrder(&tree);
+
+    bplib_btree_destroy(&tree);
+    UtAssert_ZERO(btest_nodes_allocated);
+}
@@ -720,3 +720,144 @@ void TestBplibCommon_RBT_Iterator(void)
     UtAssert_INT32_NEQ(bplib_rbt_iter_goto_min(50, &rbtree, &it), BP_SUCCESS);
     UtAssert_INT32_NEQ(bplib_rbt_iter_goto_max(50, &rbtree, &it), BP_SUCCESS);
 }
+
+void TestBplibCommon_RBT_Bulk(void)
+{
+    int               i;
+    int               count;
+    bp_val_t          last_val;
+    bplib_rbt_bulk_t  bulk;
+    bplib_rbt_iter_t  it;
+    bplib_rbt_link_t *node_ptr;
+
+    /* a set with nothing in it makes an empty tree */
+    UtAssert_VOIDCALL(bplib_rbt_bulk_init(&bulk));
+    UtAssert_INT32_EQ(bplib_rbt_bulk_load(&rbtree, &bulk), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(bplib_rbt_tree_is_empty(&rbtree));
+
+    /* every size up to a few full levels should come out as a valid R-B tree */
+    for (count = 1; count < 40; ++count)
+    {
+        for (i = 10; i < (10 + count); ++i)
+        {
+            UtAssert_INT32_EQ(bplib_rbt_bulk_append(&bulk, i, &node_array[i].link), BP_SUCCESS);
+        }
+        UtAssert_BOOL_TRUE(bulk.is_sorted);
+        UtAssert_INT32_EQ(bplib_rbt_bulk_load(&rbtree, &bulk), BP_SUCCESS);
+        UtAssert_ZERO(bulk.count);
+        Test_RBT_CheckTree(&rbtree);
+
+        UtAssert_NOT_NULL(node_ptr = bplib_rbt_search_unique(10 + count - 1, &rbtree));
+        UtAssert_ADDRESS_EQ(node_ptr, &node_array[10 + count - 1].link);
+        UtAssert_VOIDCALL(bplib_rbt_clear(&rbtree));
+        UtAssert_BOOL_TRUE(bplib_rbt_tree_is_empty(&rbtree));
+        UtAssert_ZERO(bplib_rbt_get_key_value(node_ptr));
+    }
+
+    /* a node already in a set or tree cannot be appended */
+    UtAssert_INT32_EQ(bplib_rbt_bulk_append(&bulk, 5, &node_array[5].link), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_rbt_bulk_append(&bulk, 5, &node_array[5].link), BP_ERROR);
+
+    /* out of order, with duplicates, which get sorted first */
+    for (i = 100; i > 20; i -= 3)
+    {
+        UtAssert_INT32_EQ(bplib_rbt_bulk_append(&bulk, i / 2, &node_array[i].link), BP_SUCCESS);
+    }
+    UtAssert_BOOL_FALSE(bulk.is_sorted);
+
+    /* the tree must be empty */
+    UtAssert_INT32_EQ(bplib_rbt_insert_value_unique(199, &rbtree, &node_array[199].link), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_rbt_bulk_load(&rbtree, &bulk), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_rbt_extract_node(&rbtree, &node_array[199].link), BP_SUCCESS);
+
+    UtAssert_INT32_EQ(bplib_rbt_bulk_load(&rbtree, &bulk), BP_SUCCESS);
+    Test_RBT_CheckTree(&rbtree);
+
+    last_val = 0;
+    count    = 0;
+    UtAssert_INT32_EQ(bplib_rbt_iter_goto_min(last_val, &rbtree, &it), BP_SUCCESS);
+    do
+    {
+        ++count;
+        UtAssert_UINT32_GTEQ(bplib_rbt_get_key_value(it.position), last_val);
+        last_val = bplib_rbt_get_key_value(it.position);
+    }
+    while (bplib_rbt_iter_next(&it) == BP_SUCCESS);
+
+    UtAssert_INT32_EQ(count, 28);
+
+    /* nodes loaded this way can still be taken out one at a time */
+    UtAssert_INT32_EQ(bplib_rbt_extract_node(&rbtree, &node_array[5].link), BP_SUCCESS);
+    Test_RBT_CheckTree(&rbtree);
+    UtAssert_VOIDCALL(bplib_rbt_clear(&rbtree));
+    UtAssert_BOOL_TRUE(bplib_rbt_tree_is_empty(&rbtree));
+    UtAssert_ZERO(bplib_rbt_get_key_value(&node_array[100].link));
+    UtAssert_NULL(node_array[100].link.parent);
+}
+
+typedef struct rbtest_scan_state
+{
+    bp_val_t                last_val;
+    int                     count;
+    bool                    self_extract;
+    bplib_rbt_scan_action_t action;
+} rbtest_scan_state_t;
+
+static bplib_rbt_scan_action_t rbtest_scan_func(bplib_rbt_link_t *link, void *arg)
+{
+    rbtest_scan_state_t *scan = arg;
+
+    UtAssert_UINT32_GT(bplib_rbt_get_key_value(link), scan->last_val);
+    scan->last_val = bplib_rbt_get_key_value(link);
+    ++scan->count;
+
+    /* every third node takes itself out */
+    if (scan->self_extract && (scan->count % 3) == 0)
+    {
+        UtAssert_INT32_EQ(bplib_rbt_extract_node(&rbtree, link), BP_SUCCESS);
+    }
+
+    return scan->action;
+}
+
+void TestBplibCommon_RBT_ScanRange(void)
+{
+    rbtest_scan_state_t scan;
+    int                 i;
+
+    /* an empty tree has nothing to visit */
+    memset(&scan, 0, sizeof(scan));
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(0, 100, &rbtree, rbtest_scan_func, &scan), 0);
+
+    for (i = 10; i < 90; i += 2)
+    {
+        UtAssert_INT32_EQ(bplib_rbt_insert_value_unique(i, &rbtree, &node_array[i].link), BP_SUCCESS);
+    }
+
+    /* the bounds are inclusive */
+    memset(&scan, 0, sizeof(scan));
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(20, 40, &rbtree, rbtest_scan_func, &scan), 11);
+    UtAssert_UINT32_EQ(scan.last_val, 40);
+    memset(&scan, 0, sizeof(scan));
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(21, 21, &rbtree, rbtest_scan_func, &scan), 0);
+
+    /* stop after the first one */
+    memset(&scan, 0, sizeof(scan));
+    scan.action = bplib_rbt_scan_stop;
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(0, 100, &rbtree, rbtest_scan_func, &scan), 1);
+    UtAssert_UINT32_EQ(scan.last_val, 10);
+
+    /* removing as it goes, some of them by the scan function itself, still visits every node */
+    memset(&scan, 0, sizeof(scan));
+    scan.self_extract = true;
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(0, 100, &rbtree, rbtest_scan_func, &scan), 40);
+    Test_RBT_CheckTree(&rbtree);
+    memset(&scan, 0, sizeof(scan));
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(0, 100, &rbtree, rbtest_scan_func, &scan), 27);
+
+    memset(&scan, 0, sizeof(scan));
+    scan.self_extract = true;
+    scan.action       = bplib_rbt_scan_remove;
+    UtAssert_UINT32_EQ(bplib_rbt_scan_range(0, 100, &rbtree, rbtest_scan_func, &scan), 27);
+    UtAssert_BOOL_TRUE(bplib_rbt_tree_is_empty(&rbtree));
+}
@@ -0,0 +1,237 @@
+/************************************************************************
+ *
+ *  Benchmark and cross-check of the CRC implementations
+ *
+ *  Every digest implementation that is built in and supported by this
+ *  CPU is first checked against the byte-wise table implementation, at
+ *  every alignment and many lengths.  Then each one is timed over a range
+ *  of buffer sizes and alignments, and the throughput is printed, so that
+ *  CRC changes can be validated and compared between builds.
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "crc_private.h"
+#include "benchutil.h"
+
+/* every length up to this is cross-checked, at each alignment */
+#define CRC_BENCH_CHECK_SIZE 300
+
+/* the largest buffer that is timed */
+#define CRC_BENCH_MAX_SIZE 65536
+
+/* the amount of data each measurement digests, whatever the buffer size */
+#define CRC_BENCH_BYTES_PER_RUN (8 * 1024 * 1024)
+
+typedef struct crc_bench_algo
+{
+    bplib_crc_parameters_t *params;
+    bp_crcval_t             seed;        /* a non-initial value to start cross-checks with */
+    bp_crcval_t             check_value; /* the published CRC of "123456789" */
+} crc_bench_algo_t;
+
+static const crc_bench_algo_t CRC_BENCH_ALGOS[] = {{&BPLIB_CRC16_X25, 0x1234, 0x906e},
+                                                   {&BPLIB_CRC32_CASTAGNOLI, 0x12345678, 0xe3069283}};
+
+static const char *const CRC_BENCH_KERNEL_NAMES[bplib_crc_kernel_max] = {"table", "slice8", "hw"};
+
+static const size_t CRC_BENCH_SIZES[]  = {16, 64, 256, 1024, 4096, 16384, CRC_BENCH_MAX_SIZE};
+static const size_t CRC_BENCH_ALIGNS[] = {0, 1, 3};
+
+/* room for the largest buffer at any alignment */
+static uint8_t crc_bench_buf[CRC_BENCH_MAX_SIZE + 8];
+
+/* the benchmark loop stores its result here so it cannot be optimized away */
+volatile bp_crcval_t crc_bench_sink;
+
+#define CRC_BENCH_NUM_ALGOS  (sizeof(CRC_BENCH_ALGOS) / sizeof(CRC_BENCH_ALGOS[0]))
+#define CRC_BENCH_NUM_SIZES  (sizeof(CRC_BENCH_SIZES) / sizeof(CRC_BENCH_SIZES[0]))
+#define CRC_BENCH_NUM_ALIGNS (sizeof(CRC_BENCH_ALIGNS) / sizeof(CRC_BENCH_ALIGNS[0]))
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* Counts the lengths and alignments where the kernel does not agree with the table */
+static uint32_t crc_bench_cross_check(const crc_bench_algo_t *algo, bplib_crc_digest_func_t kernel)
+{
+    bplib_crc_digest_func_t reference;
+    bp_crcval_t             expected;
+    bp_crcval_t             crc;
+    uint32_t                mismatches;
+    size_t                  offset;
+    size_t                  size;
+    size_t                  i;
+
+    reference  = bplib_crc_get_kernel(algo->params, bplib_crc_kernel_table);
+    mismatches = 0;
+
+    for (offset = 0; offset < 8; ++offset)
+    {
+        for (size = 0; size <= CRC_BENCH_CHECK_SIZE; ++size)
+        {
+            if (kernel(algo->seed, &crc_bench_buf[offset], size) !=
+                reference(algo->seed, &crc_bench_buf[offset], size))
+            {
+                ++mismatches;
+            }
+        }
+
+        for (i = 0; i < CRC_BENCH_NUM_SIZES; ++i)
+        {
+            size     = CRC_BENCH_SIZES[i];
+            expected = reference(algo->seed, &crc_bench_buf[offset], size);
+            if (kernel(algo->seed, &crc_bench_buf[offset], size) != expected)
+            {
+                ++mismatches;
+            }
+
+            /* a digest continued from an odd split point must come out the same */
+            crc = kernel(algo->seed, &crc_bench_buf[offset], size / 3);
+            crc = kernel(crc, &crc_bench_buf[offset + (size / 3)], size - (size / 3));
+            if (crc != expected)
+            {
+                ++mismatches;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+/* Returns the throughput of the kernel in GB/s */
+static double crc_bench_measure(const crc_bench_algo_t *algo, bplib_crc_digest_func_t kernel, size_t size,
+                                size_t align)
+{
+    bp_crcval_t crc;
+    uint64_t    start_time;
+    uint64_t    elapsed;
+    uint32_t    iterations;
+    uint32_t    i;
+
+    iterations = CRC_BENCH_BYTES_PER_RUN / size;
+    crc        = bplib_crc_initial_value(algo->params);
+
+    start_time = bench_get_time_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        crc = kernel(crc, &crc_bench_buf[align], size);
+    }
+    elapsed = bench_get_time_ns() - start_time;
+
+    crc_bench_sink = crc;
+
+    if (elapsed == 0)
+    {
+        elapsed = 1;
+    }
+
+    /* bytes per nanosecond is GB/s */
+    return ((double)iterations * (double)size) / (double)elapsed;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void crc_bench_setup(void)
+{
+    uint32_t seed;
+    size_t   i;
+
+    bplib_crc_init();
+
+    /* fixed pseudo-random content, so runs are comparable */
+    seed = 0x2545F491;
+    for (i = 0; i < sizeof(crc_bench_buf); ++i)
+    {
+        seed             = (seed * 1103515245) + 12345;
+        crc_bench_buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+void crc_bench_verify(void)
+{
+    const crc_bench_algo_t *algo;
+    bplib_crc_digest_func_t kernel;
+    bp_crcval_t             crc;
+    size_t                  a;
+    bplib_crc_kernel_t      k;
+
+    for (a = 0; a < CRC_BENCH_NUM_ALGOS; ++a)
+    {
+        algo = &CRC_BENCH_ALGOS[a];
+        for (k = 0; k < bplib_crc_kernel_max; ++k)
+        {
+            kernel = bplib_crc_get_kernel(algo->params, k);
+            if (kernel == NULL)
+            {
+                UtPrintf("%s: %s not available", bplib_crc_get_name(algo->params), CRC_BENCH_KERNEL_NAMES[k]);
+                continue;
+            }
+
+            crc = kernel(bplib_crc_initial_value(algo->params), "123456789", 9);
+            UtAssert_True(bplib_crc_finalize(algo->params, crc) == algo->check_value, "%s: %s check value",
+                          bplib_crc_get_name(algo->params), CRC_BENCH_KERNEL_NAMES[k]);
+
+            UtAssert_True(crc_bench_cross_check(algo, kernel) == 0, "%s: %s agrees with table",
+                          bplib_crc_get_name(algo->params), CRC_BENCH_KERNEL_NAMES[k]);
+        }
+    }
+}
+
+void crc_bench_throughput(void)
+{
+    const crc_bench_algo_t *algo;
+    bplib_crc_digest_func_t kernel;
+    size_t                  a;
+    size_t                  s;
+    size_t                  n;
+    bplib_crc_kernel_t      k;
+
+    for (a = 0; a < CRC_BENCH_NUM_ALGOS; ++a)
+    {
+        algo = &CRC_BENCH_ALGOS[a];
+        for (k = 0; k < bplib_crc_kernel_max; ++k)
+        {
+            kernel = bplib_crc_get_kernel(algo->params, k);
+            if (kernel == NULL)
+            {
+                continue;
+            }
+
+            for (s = 0; s < CRC_BENCH_NUM_SIZES; ++s)
+            {
+                for (n = 0; n < CRC_BENCH_NUM_ALIGNS; ++n)
+                {
+                    UtPrintf("%-17s %-6s size %5lu align %lu: %7.3f GB/s", bplib_crc_get_name(algo->params),
+                             CRC_BENCH_KERNEL_NAMES[k], (unsigned long)CRC_BENCH_SIZES[s],
+                             (unsigned long)CRC_BENCH_ALIGNS[n],
+                             crc_bench_measure(algo, kernel, CRC_BENCH_SIZES[s], CRC_BENCH_ALIGNS[n]));
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(crc_bench_verify, crc_bench_setup, NULL, "verify");
+    UtTest_Add(crc_bench_throughput, crc_bench_setup, NULL, "throughput");
+}
@@ -0,0 +1,441 @@
+/************************************************************************
+ *
+ *  Benchmark and stress test of the ordered indices
+ *
+ *  The Red-Black tree is filled and emptied at sizes from a thousand
+ *  nodes up to RB_BENCH_MAX_NODES, with keys drawn from the kinds of
+ *  values the cache actually indexes: bundle sequence numbers, hashed
+ *  endpoint IDs and clustered timestamps.  The throughput of insert,
+ *  search, iterate and delete is printed for each, and the B+ tree is
+ *  run through the same loads so that index changes can be compared
+ *  between builds.  Every ordering and lookup is checked as it goes.
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib_api_types.h"
+#include "v7_rbtree.h"
+#include "v7_btree.h"
+#include "benchutil.h"
+
+/*
+ * The largest index that is timed.  Ten million nodes needs close to a gigabyte,
+ * so the default stops at a million; define this as 10000000 to go all the way.
+ */
+#ifndef RB_BENCH_MAX_NODES
+#define RB_BENCH_MAX_NODES 1000000
+#endif
+
+/* at small sizes each measurement is repeated until it covers at least this many operations */
+#define RB_BENCH_OPS_PER_RUN 1000000
+
+/* timestamps come in bursts of this many, and arrive this far out of order */
+#define RB_BENCH_BURST_SIZE      64
+#define RB_BENCH_REORDER_WINDOW  16
+
+typedef struct rb_bench_node
+{
+    bplib_rbt_link_t link;
+    bp_val_t         key;
+} rb_bench_node_t;
+
+typedef enum rb_bench_keys
+{
+    rb_bench_keys_sequential, /* bundle sequence numbers, in the order they were made */
+    rb_bench_keys_hashed,     /* hashed endpoint IDs, effectively random */
+    rb_bench_keys_clustered,  /* timestamps that come in bursts, slightly out of order */
+    rb_bench_keys_max
+} rb_bench_keys_t;
+
+typedef enum rb_bench_op
+{
+    rb_bench_op_insert,
+    rb_bench_op_search,
+    rb_bench_op_iterate,
+    rb_bench_op_delete,
+    rb_bench_op_max
+} rb_bench_op_t;
+
+static const char *const RB_BENCH_KEY_NAMES[rb_bench_keys_max] = {"sequential", "hashed", "clustered"};
+static const char *const RB_BENCH_OP_NAMES[rb_bench_op_max]    = {"insert", "search", "iterate", "delete"};
+
+static rb_bench_node_t *rb_bench_nodes;
+
+/* the order in which nodes are looked up and deleted, which is random for every key type */
+static uint32_t *rb_bench_lookup_order;
+
+static uint32_t rb_bench_seed;
+
+/* the benchmark loops store their result here so they cannot be optimized away */
+volatile bp_val_t rb_bench_sink;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* fixed pseudo-random numbers, so runs are comparable */
+static uint32_t rb_bench_random(void)
+{
+    rb_bench_seed = (rb_bench_seed * 1103515245) + 12345;
+    return (rb_bench_seed >> 8) & 0xFFFFFF;
+}
+
+static uint32_t rb_bench_random_below(uint32_t limit)
+{
+    return (uint32_t)((((uint64_t)rb_bench_random() << 24) | rb_bench_random()) % limit);
+}
+
+static void rb_bench_shuffle(uint32_t *order, uint32_t count)
+{
+    uint32_t i;
+    uint32_t j;
+    uint32_t temp;
+
+    for (i = count - 1; i > 0; --i)
+    {
+        j        = rb_bench_random_below(i + 1);
+        temp     = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+    }
+}
+
+/* the 64-bit finalizer from MurmurHash3, which never maps two values to the same one */
+static bp_val_t rb_bench_hash(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+
+    /* the tree keeps one bit of the key for itself */
+    return (bp_val_t)(value >> 1);
+}
+
+/* Fills in the keys in insertion order, none of them 0 and all of them different */
+static void rb_bench_make_keys(rb_bench_keys_t key_type, uint32_t count)
+{
+    bp_val_t timestamp;
+    bp_val_t temp;
+    uint32_t i;
+    uint32_t j;
+
+    rb_bench_seed = 0x2545F491;
+    timestamp     = 700000000000;
+
+    for (i = 0; i < count; ++i)
+    {
+        switch (key_type)
+        {
+            case rb_bench_keys_sequential:
+                rb_bench_nodes[i].key = 1 + i;
+                break;
+
+            case rb_bench_keys_hashed:
+                rb_bench_nodes[i].key = rb_bench_hash(1 + i);
+                break;
+
+            default:
+                /* a gap before every burst, then close together, with the low bits keeping them apart */
+                if ((i % RB_BENCH_BURST_SIZE) == 0)
+                {
+                    timestamp += 1000 + rb_bench_random_below(100000);
+                }
+                timestamp += rb_bench_random_below(4);
+                rb_bench_nodes[i].key = (timestamp << 8) | (i & 0xFF);
+                break;
+        }
+    }
+
+    if (key_type == rb_bench_keys_clustered)
+    {
+        for (i = 0; i < count; ++i)
+        {
+            j = i - (i % RB_BENCH_REORDER_WINDOW) + rb_bench_random_below(RB_BENCH_REORDER_WINDOW);
+            if (j < count)
+            {
+                temp                  = rb_bench_nodes[i].key;
+                rb_bench_nodes[i].key = rb_bench_nodes[j].key;
+                rb_bench_nodes[j].key = temp;
+            }
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        rb_bench_lookup_order[i] = i;
+    }
+    rb_bench_shuffle(rb_bench_lookup_order, count);
+}
+
+static uint32_t rb_bench_repeat_count(uint32_t count)
+{
+    if (count >= RB_BENCH_OPS_PER_RUN)
+    {
+        return 1;
+    }
+
+    return RB_BENCH_OPS_PER_RUN / count;
+}
+
+/* Throughput in millions of operations per second */
+static double rb_bench_mops(uint64_t ops, uint64_t elapsed)
+{
+    if (elapsed == 0)
+    {
+        elapsed = 1;
+    }
+
+    return ((double)ops * 1000.0) / (double)elapsed;
+}
+
+static void rb_bench_report(const char *index_name, rb_bench_keys_t key_type, uint32_t count, const uint64_t *elapsed,
+                            uint32_t repeat)
+{
+    rb_bench_op_t op;
+    char          line[160];
+    size_t        len;
+
+    len = (size_t)snprintf(line, sizeof(line), "%-6s %-10s %8lu:", index_name, RB_BENCH_KEY_NAMES[key_type],
+                           (unsigned long)count);
+    for (op = 0; op < rb_bench_op_max && len < sizeof(line); ++op)
+    {
+        len += (size_t)snprintf(&line[len], sizeof(line) - len, " %s %7.3f", RB_BENCH_OP_NAMES[op],
+                                rb_bench_mops((uint64_t)count * repeat, elapsed[op]));
+    }
+
+    UtPrintf("%s Mops/s", line);
+}
+
+/*************************************************************************
+ * Benchmarks
+ *************************************************************************/
+
+static void rb_bench_run_rbtree(rb_bench_keys_t key_type, uint32_t count)
+{
+    bplib_rbt_root_t  tree;
+    bplib_rbt_iter_t  iter;
+    bplib_rbt_link_t *link;
+    uint64_t          elapsed[rb_bench_op_max];
+    uint64_t          start_time;
+    uint32_t          repeat;
+    uint32_t          failures;
+    uint32_t          visited;
+    uint32_t          r;
+    uint32_t          i;
+    bp_val_t          last_key;
+    int               status;
+
+    memset(elapsed, 0, sizeof(elapsed));
+    repeat   = rb_bench_repeat_count(count);
+    failures = 0;
+
+    bplib_rbt_init_root(&tree);
+
+    for (r = 0; r < repeat; ++r)
+    {
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_rbt_insert_value_unique(rb_bench_nodes[i].key, &tree, &rb_bench_nodes[i].link) != BP_SUCCESS)
+            {
+                ++failures;
+            }
+        }
+        elapsed[rb_bench_op_insert] += bench_get_time_ns() - start_time;
+
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            link = bplib_rbt_search_unique(rb_bench_nodes[rb_bench_lookup_order[i]].key, &tree);
+            if (link != &rb_bench_nodes[rb_bench_lookup_order[i]].link)
+            {
+                ++failures;
+            }
+        }
+        elapsed[rb_bench_op_search] += bench_get_time_ns() - start_time;
+
+        start_time = bench_get_time_ns();
+        visited    = 0;
+        last_key   = 0;
+        status     = bplib_rbt_iter_goto_min(0, &tree, &iter);
+        while (status == BP_SUCCESS)
+        {
+            if (bplib_rbt_get_key_value(iter.position) <= last_key)
+            {
+                ++failures;
+            }
+            last_key = bplib_rbt_get_key_value(iter.position);
+            ++visited;
+            status = bplib_rbt_iter_next(&iter);
+        }
+        elapsed[rb_bench_op_iterate] += bench_get_time_ns() - start_time;
+        rb_bench_sink = last_key;
+
+        if (visited != count)
+        {
+            ++failures;
+        }
+
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_rbt_extract_node(&tree, &rb_bench_nodes[rb_bench_lookup_order[i]].link) != BP_SUCCESS)
+            {
+                ++failures;
+            }
+        }
+        elapsed[rb_bench_op_delete] += bench_get_time_ns() - start_time;
+    }
+
+    UtAssert_True(failures == 0 && bplib_rbt_tree_is_empty(&tree), "rbtree %s %lu: %lu failures",
+                  RB_BENCH_KEY_NAMES[key_type], (unsigned long)count, (unsigned long)failures);
+
+    rb_bench_report("rbtree", key_type, count, elapsed, repeat);
+}
+
+static void rb_bench_run_btree(rb_bench_keys_t key_type, uint32_t count)
+{
+    bplib_btree_t      tree;
+    bplib_btree_iter_t iter;
+    uint64_t           elapsed[rb_bench_op_max];
+    uint64_t           start_time;
+    uint32_t           repeat;
+    uint32_t           failures;
+    uint32_t           visited;
+    uint32_t           r;
+    uint32_t           i;
+    bp_val_t           last_key;
+    int                status;
+
+    memset(elapsed, 0, sizeof(elapsed));
+    repeat   = rb_bench_repeat_count(count);
+    failures = 0;
+
+    bplib_btree_init(&tree);
+
+    for (r = 0; r < repeat; ++r)
+    {
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_btree_insert(rb_bench_nodes[i].key, &tree, &rb_bench_nodes[i], false) != BP_SUCCESS)
+            {
+                ++failures;
+            }
+        }
+        elapsed[rb_bench_op_insert] += bench_get_time_ns() - start_time;
+
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_btree_search(rb_bench_nodes[rb_bench_lookup_order[i]].key, &tree) !=
+                &rb_bench_nodes[rb_bench_lookup_order[i]])
+            {
+                ++failures;
+            }
+        }
+        elapsed[rb_bench_op_search] += bench_get_time_ns() - start_time;
+
+        start_time = bench_get_time_ns();
+        visited    = 0;
+        last_key   = 0;
+        status     = bplib_btree_iter_goto_min(0, &tree, &iter);
+        while (status == BP_SUCCESS)
+        {
+            if (bplib_btree_iter_get_key(&iter) <= last_key)
+            {
+                ++failures;
+            }
+            last_key = bplib_btree_iter_get_key(&iter);
+            ++visited;
+            status = bplib_btree_iter_next(&iter);
+        }
+        elapsed[rb_bench_op_iterate] += bench_get_time_ns() - start_time;
+        rb_bench_sink = last_key;
+
+        if (visited != count)
+        {
+            ++failures;
+        }
+
+        start_time = bench_get_time_ns();
+        for (i = 0; i < count; ++i)
+        {
+            if (bplib_btree_remove(rb_bench_nodes[rb_bench_lookup_order[i]].key, &tree,
+                                   &rb_bench_nodes[rb_bench_lookup_order[i]]) != BP_SUCCESS)
+            {
+                ++failures;
+            }
+        }
+        elapsed[rb_bench_op_delete] += bench_get_time_ns() - start_time;
+    }
+
+    UtAssert_True(failures == 0 && bplib_btree_is_empty(&tree), "btree %s %lu: %lu failures",
+                  RB_BENCH_KEY_NAMES[key_type], (unsigned long)count, (unsigned long)failures);
+
+    bplib_btree_destroy(&tree);
+
+    rb_bench_report("btree", key_type, count, elapsed, repeat);
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void rb_bench_setup(void)
+{
+    rb_bench_nodes        = calloc(RB_BENCH_MAX_NODES, sizeof(*rb_bench_nodes));
+    rb_bench_lookup_order = calloc(RB_BENCH_MAX_NODES, sizeof(*rb_bench_lookup_order));
+    if (!UtAssert_NOT_NULL(rb_bench_nodes) || !UtAssert_NOT_NULL(rb_bench_lookup_order))
+    {
+        UtAssert_Abort("calloc() failed");
+    }
+}
+
+void rb_bench_teardown(void)
+{
+    free(rb_bench_nodes);
+    free(rb_bench_lookup_order);
+    rb_bench_nodes        = NULL;
+    rb_bench_lookup_order = NULL;
+}
+
+void rb_bench_throughput(void)
+{
+    rb_bench_keys_t key_type;
+    uint32_t        count;
+
+    for (key_type = 0; key_type < rb_bench_keys_max; ++key_type)
+    {
+        for (count = 1000; count <= RB_BENCH_MAX_NODES; count *= 10)
+        {
+            rb_bench_make_keys(key_type, count);
+            rb_bench_run_rbtree(key_type, count);
+            rb_bench_run_btree(key_type, count);
+        }
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(rb_bench_throughput, rb_bench_setup, rb_bench_teardown, "throughput");
+}
@@ -49,12 +49,12 @@ bp_crcval_t bplib_crc_finalize(bplib_crc_parameters_t *params, bp_crcval_t crc)
  * Generated stub function for bplib_crc_get()
  * ----------------------------------------------------
  */
-bp_crcval_t bplib_crc_get(const void *data, const uint32_t length, bplib_crc_parameters_t *params)
+bp_crcval_t bplib_crc_get(const void *data, size_t length, bplib_crc_parameters_t *params)
 {
     UT_GenStub_SetupReturnBuffer(bplib_crc_get, bp_crcval_t);
 
     UT_GenStub_AddParam(bplib_crc_get, const void *, data);
-    UT_GenStub_AddParam(bplib_crc_get, const uint32_t, length);
+    UT_GenStub_AddParam(bplib_crc_get, size_t, length);
     UT_GenStub_AddParam(bplib_crc_get, bplib_crc_parameters_t *, params);
 
     UT_GenStub_Execute(bplib_crc_get, Basic, NULL);
@@ -121,6 +121,22 @@ bp_crcval_t bplib_crc_initial_value(bplib_crc_parameters_t *params)
     return UT_GenStub_GetReturnValue(bplib_crc_initial_value, bp_crcval_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_crc_is_hw_accelerated()
+ * ----------------------------------------------------
+ */
+bool bplib_crc_is_hw_accelerated(bplib_crc_parameters_t *params)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_crc_is_hw_accelerated, bool);
+
+    UT_GenStub_AddParam(bplib_crc_is_hw_accelerated, bplib_crc_parameters_t *, params);
+
+    UT_GenStub_Execute(bplib_crc_is_hw_accelerated, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_crc_is_hw_accelerated, bool);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_crc_update()
@@ -139,3 +155,23 @@ bp_crcval_t bplib_crc_update(bplib_crc_parameters_t *params, bp_crcval_t crc, co
 
     return UT_GenStub_GetReturnValue(bplib_crc_update, bp_crcval_t);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_crc_update_list()
+ * ----------------------------------------------------
+ */
+bp_crcval_t bplib_crc_update_list(bplib_crc_parameters_t *params, bp_crcval_t crc, const bplib_iovec_t *iov,
+                                  size_t iov_count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_crc_update_list, bp_crcval_t);
+
+    UT_GenStub_AddParam(bplib_crc_update_list, bplib_crc_parameters_t *, params);
+    UT_GenStub_AddParam(bplib_crc_update_list, bp_crcval_t, crc);
+    UT_GenStub_AddParam(bplib_crc_update_list, const bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(bplib_crc_update_list, size_t, iov_count);
+
+    UT_GenStub_Execute(bplib_crc_update_list, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_crc_update_list, bp_crcval_t);
+}
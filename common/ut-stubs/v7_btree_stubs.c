@@ -0,0 +1,222 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * @file
+ *
+ * Auto-Generated stub implementations for functions defined in v7_btree header
+ */
+
+#include "v7_btree.h"
+#include "utgenstub.h"
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_destroy()
+ * ----------------------------------------------------
+ */
+void bplib_btree_destroy(bplib_btree_t *tree)
+{
+    UT_GenStub_AddParam(bplib_btree_destroy, bplib_btree_t *, tree);
+
+    UT_GenStub_Execute(bplib_btree_destroy, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_init()
+ * ----------------------------------------------------
+ */
+void bplib_btree_init(bplib_btree_t *tree)
+{
+    UT_GenStub_AddParam(bplib_btree_init, bplib_btree_t *, tree);
+
+    UT_GenStub_Execute(bplib_btree_init, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_insert()
+ * ----------------------------------------------------
+ */
+int bplib_btree_insert(bp_val_t key_value, bplib_btree_t *tree, void *entry, bool allow_duplicate)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_insert, int);
+
+    UT_GenStub_AddParam(bplib_btree_insert, bp_val_t, key_value);
+    UT_GenStub_AddParam(bplib_btree_insert, bplib_btree_t *, tree);
+    UT_GenStub_AddParam(bplib_btree_insert, void *, entry);
+    UT_GenStub_AddParam(bplib_btree_insert, bool, allow_duplicate);
+
+    UT_GenStub_Execute(bplib_btree_insert, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_insert, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_is_empty()
+ * ----------------------------------------------------
+ */
+bool bplib_btree_is_empty(const bplib_btree_t *tree)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_is_empty, bool);
+
+    UT_GenStub_AddParam(bplib_btree_is_empty, const bplib_btree_t *, tree);
+
+    UT_GenStub_Execute(bplib_btree_is_empty, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_is_empty, bool);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_iter_get_entry()
+ * ----------------------------------------------------
+ */
+void *bplib_btree_iter_get_entry(const bplib_btree_iter_t *iter)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_iter_get_entry, void *);
+
+    UT_GenStub_AddParam(bplib_btree_iter_get_entry, const bplib_btree_iter_t *, iter);
+
+    UT_GenStub_Execute(bplib_btree_iter_get_entry, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_iter_get_entry, void *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_iter_get_key()
+ * ----------------------------------------------------
+ */
+bp_val_t bplib_btree_iter_get_key(const bplib_btree_iter_t *iter)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_iter_get_key, bp_val_t);
+
+    UT_GenStub_AddParam(bplib_btree_iter_get_key, const bplib_btree_iter_t *, iter);
+
+    UT_GenStub_Execute(bplib_btree_iter_get_key, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_iter_get_key, bp_val_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_iter_goto_max()
+ * ----------------------------------------------------
+ */
+int bplib_btree_iter_goto_max(bp_val_t maximum_value, const bplib_btree_t *tree, bplib_btree_iter_t *iter)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_iter_goto_max, int);
+
+    UT_GenStub_AddParam(bplib_btree_iter_goto_max, bp_val_t, maximum_value);
+    UT_GenStub_AddParam(bplib_btree_iter_goto_max, const bplib_btree_t *, tree);
+    UT_GenStub_AddParam(bplib_btree_iter_goto_max, bplib_btree_iter_t *, iter);
+
+    UT_GenStub_Execute(bplib_btree_iter_goto_max, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_iter_goto_max, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_iter_goto_min()
+ * ----------------------------------------------------
+ */
+int bplib_btree_iter_goto_min(bp_val_t minimum_value, const bplib_btree_t *tree, bplib_btree_iter_t *iter)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_iter_goto_min, int);
+
+    UT_GenStub_AddParam(bplib_btree_iter_goto_min, bp_val_t, minimum_value);
+    UT_GenStub_AddParam(bplib_btree_iter_goto_min, const bplib_btree_t *, tree);
+    UT_GenStub_AddParam(bplib_btree_iter_goto_min, bplib_btree_iter_t *, iter);
+
+    UT_GenStub_Execute(bplib_btree_iter_goto_min, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_iter_goto_min, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_iter_next()
+ * ----------------------------------------------------
+ */
+int bplib_btree_iter_next(bplib_btree_iter_t *iter)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_iter_next, int);
+
+    UT_GenStub_AddParam(bplib_btree_iter_next, bplib_btree_iter_t *, iter);
+
+    UT_GenStub_Execute(bplib_btree_iter_next, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_iter_next, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_iter_prev()
+ * ----------------------------------------------------
+ */
+int bplib_btree_iter_prev(bplib_btree_iter_t *iter)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_iter_prev, int);
+
+    UT_GenStub_AddParam(bplib_btree_iter_prev, bplib_btree_iter_t *, iter);
+
+    UT_GenStub_Execute(bplib_btree_iter_prev, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_iter_prev, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_remove()
+ * ----------------------------------------------------
+ */
+int bplib_btree_remove(bp_val_t key_value, bplib_btree_t *tree, const void *entry)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_remove, int);
+
+    UT_GenStub_AddParam(bplib_btree_remove, bp_val_t, key_value);
+    UT_GenStub_AddParam(bplib_btree_remove, bplib_btree_t *, tree);
+    UT_GenStub_AddParam(bplib_btree_remove, const void *, entry);
+
+    UT_GenStub_Execute(bplib_btree_remove, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_remove, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_btree_search()
+ * ----------------------------------------------------
+ */
+void *bplib_btree_search(bp_val_t key_value, const bplib_btree_t *tree)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_btree_search, void *);
+
+    UT_GenStub_AddParam(bplib_btree_search, bp_val_t, key_value);
+    UT_GenStub_AddParam(bplib_btree_search, const bplib_btree_t *, tree);
+
+    UT_GenStub_Execute(bplib_btree_search, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_btree_search, void *);
+}
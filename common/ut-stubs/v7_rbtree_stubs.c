@@ -27,6 +27,65 @@
 #include "v7_rbtree.h"
 #include "utgenstub.h"
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_rbt_bulk_append()
+ * ----------------------------------------------------
+ */
+int bplib_rbt_bulk_append(bplib_rbt_bulk_t *bulk, bp_val_t key_value, bplib_rbt_link_t *link_block)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_rbt_bulk_append, int);
+
+    UT_GenStub_AddParam(bplib_rbt_bulk_append, bplib_rbt_bulk_t *, bulk);
+    UT_GenStub_AddParam(bplib_rbt_bulk_append, bp_val_t, key_value);
+    UT_GenStub_AddParam(bplib_rbt_bulk_append, bplib_rbt_link_t *, link_block);
+
+    UT_GenStub_Execute(bplib_rbt_bulk_append, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_rbt_bulk_append, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_rbt_bulk_init()
+ * ----------------------------------------------------
+ */
+void bplib_rbt_bulk_init(bplib_rbt_bulk_t *bulk)
+{
+    UT_GenStub_AddParam(bplib_rbt_bulk_init, bplib_rbt_bulk_t *, bulk);
+
+    UT_GenStub_Execute(bplib_rbt_bulk_init, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_rbt_bulk_load()
+ * ----------------------------------------------------
+ */
+int bplib_rbt_bulk_load(bplib_rbt_root_t *tree, bplib_rbt_bulk_t *bulk)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_rbt_bulk_load, int);
+
+    UT_GenStub_AddParam(bplib_rbt_bulk_load, bplib_rbt_root_t *, tree);
+    UT_GenStub_AddParam(bplib_rbt_bulk_load, bplib_rbt_bulk_t *, bulk);
+
+    UT_GenStub_Execute(bplib_rbt_bulk_load, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_rbt_bulk_load, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_rbt_clear()
+ * ----------------------------------------------------
+ */
+void bplib_rbt_clear(bplib_rbt_root_t *tree)
+{
+    UT_GenStub_AddParam(bplib_rbt_clear, bplib_rbt_root_t *, tree);
+
+    UT_GenStub_Execute(bplib_rbt_clear, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_rbt_extract_node()
@@ -194,6 +253,27 @@ bool bplib_rbt_node_is_red(const bplib_rbt_link_t *node)
     return UT_GenStub_GetReturnValue(bplib_rbt_node_is_red, bool);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_rbt_scan_range()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_rbt_scan_range(bp_val_t minimum_value, bp_val_t maximum_value, bplib_rbt_root_t *tree,
+                              bplib_rbt_scan_func_t scan_func, void *scan_arg)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_rbt_scan_range, uint32_t);
+
+    UT_GenStub_AddParam(bplib_rbt_scan_range, bp_val_t, minimum_value);
+    UT_GenStub_AddParam(bplib_rbt_scan_range, bp_val_t, maximum_value);
+    UT_GenStub_AddParam(bplib_rbt_scan_range, bplib_rbt_root_t *, tree);
+    UT_GenStub_AddParam(bplib_rbt_scan_range, bplib_rbt_scan_func_t, scan_func);
+    UT_GenStub_AddParam(bplib_rbt_scan_range, void *, scan_arg);
+
+    UT_GenStub_Execute(bplib_rbt_scan_range, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_rbt_scan_range, uint32_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_rbt_search_generic()
@@ -76,6 +76,14 @@ extern "C" {
 #define BP_COS_EXPEDITED 2
 #define BP_COS_EXTENDED  3
 
+/* CLA Interface Options */
+#define BPLIB_CLA_INTF_SPSC_RINGS       0x01 /* lock-free ingress/egress queues, single thread on each side */
+#define BPLIB_CLA_INTF_PRIORITY_EGRESS  0x02 /* egress queue sends by class of service (BP_COS_*) first */
+#define BPLIB_CLA_INTF_LAZY_DECODE      0x04 /* extension blocks of received bundles are decoded when used */
+#define BPLIB_CLA_INTF_DEFER_CRC        0x08 /* block CRCs of received bundles are checked by the flow workers */
+#define BPLIB_CLA_INTF_DEDUP            0x10 /* received bundles which were received here recently are dropped */
+#define BPLIB_CLA_INTF_DEFER_DECODE     0x20 /* received bundles are decoded by the flow workers */
+
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
@@ -91,6 +99,10 @@ int bplib_display(const void *bundle, size_t size, uint32_t *flags);
 int bplib_eid2ipn(const char *eid, size_t len, bp_ipn_t *node, bp_ipn_t *service);
 int bplib_ipn2eid(char *eid, size_t len, bp_ipn_t node, bp_ipn_t service);
 
+/* The following convert many EIDs in one call, for tools that go through logs of them */
+size_t bplib_eid2ipn_n(const char *const *eids, bp_ipn_t *nodes, bp_ipn_t *services, size_t count);
+size_t bplib_ipn2eid_n(char *eids, size_t eid_size, const bp_ipn_t *nodes, const bp_ipn_t *services, size_t count);
+
 /* The following calls are specific to the new (BPv7) implementation */
 
 /**
@@ -157,6 +169,10 @@ int bplib_connect_socket(bp_socket_t *desc, const bp_ipn_addr_t *destination_ipn
  * relay nodes, but an entity like this can also be created in endpoint nodes
  * as well for testing and debug purposes.
  *
+ * The RAM storage keeps its bundles in the memory pool.  When the pool runs
+ * short and a shed policy is configured, idle bundles are packed into their
+ * encoded form rather than dropped, and decoded again when they are due.
+ *
  * @param rtbl Routing table instance
  * @param storage_addr IPN address of this entity
  * @return bp_handle_t value referring to this entity
@@ -173,11 +189,64 @@ bp_handle_t bplib_create_file_storage(bplib_routetbl_t *rtbl, const bp_ipn_addr_
  *
  * This entity does not have a separate IPN address/node number.
  *
+ * With a fragment MTU set through bplib_config_integer() (bplib_variable_cla_fragment_mtu), a bundle routed to
+ * the interface which is bigger than that is sent as RFC 9171 fragments which each fit, unless the bundle must
+ * not be fragmented.  With a reassembly memory limit (bplib_variable_cla_reassembly_mem), fragments received
+ * on the interface are held until the whole bundle is in, which is then passed on in their place.  A bundle is
+ * given up on if its fragments do not all come within bplib_variable_cla_reassembly_wait ms, or when the
+ * memory is needed for newer bundles, oldest first.
+ *
  * @param rtbl Routing table instance
  * @return bp_handle_t value referring to this entity
  */
 bp_handle_t bplib_create_cla_intf(bplib_routetbl_t *rtbl);
 
+/**
+ * @brief Creates a CLA (bundle data unit) logical entity, with options
+ *
+ * This is the same as bplib_create_cla_intf(), but with a set of BPLIB_CLA_INTF_* flags.
+ *
+ * With BPLIB_CLA_INTF_SPSC_RINGS, the ingress and egress queues are kept in lock-free rings.
+ * The application must then only call bplib_cla_ingress() from one thread at a time, and
+ * likewise bplib_cla_egress() from one thread at a time (which may be a different thread).
+ * If the rings cannot be set up, the interface is still created with the normal queues.
+ *
+ * With BPLIB_CLA_INTF_PRIORITY_EGRESS, bundles waiting in the egress queue are sent according to
+ * their class of service, with a weighted share for each class so bulk traffic still moves.
+ * This takes precedence over BPLIB_CLA_INTF_SPSC_RINGS for the egress queue, which then stays locked.
+ *
+ * With BPLIB_CLA_INTF_LAZY_DECODE, only the primary block and the framing of the other blocks of a
+ * received bundle are decoded up front.  The content of an extension block is decoded the first time
+ * something needs it, which saves the work for transit bundles that are only passed on.  A block that
+ * turns out not to decode is then found later, rather than the bundle being dropped at ingress.
+ *
+ * With BPLIB_CLA_INTF_DEFER_CRC, the CRCs of the canonical blocks of a received bundle are not checked
+ * in bplib_cla_ingress(), but when the bundle is taken from the ingress queue to be routed, before it
+ * goes anywhere else.  That is done by whichever thread runs the flows, so with several threads in
+ * bplib_route_worker_process_flows() the receiving thread only has to frame the bundles.  The primary
+ * block CRC is still checked on receipt, and a bundle that fails later is counted as not decoded.
+ *
+ * With BPLIB_CLA_INTF_DEFER_DECODE, bplib_cla_ingress() only copies a received bundle into pool memory and
+ * puts it in the ingress queue.  All of the decoding and CRC checks are done when it is taken from the queue
+ * by the thread that runs the flows of the interface, so a slow decode does not hold up the thread that
+ * receives.  The workers of bplib_route_worker_process_flows() are then the decode workers, and as each
+ * interface is run by one of them at a time, the bundles of an interface are still decoded in the order they
+ * came in.  A bundle that does not decode is counted in bplib_variable_cla_drop_decode as it would be on
+ * receipt, but the CLA is not told.  Frames (bplib_variable_cla_frame_mtu) and bundles too big for one block of
+ * the pool are still decoded on receipt.
+ *
+ * With BPLIB_CLA_INTF_DEDUP, the source, creation timestamp and fragment offset of the bundles received
+ * here are remembered, for roughly the last few thousand bundles.  A bundle that was already received is
+ * dropped right after it is decoded, so the retransmits after an outage are not routed and stored again.
+ * This is counted in bplib_variable_cla_drop_duplicate.  The filter takes about 200 KB of heap for each
+ * interface.  A duplicate that has been forgotten is still passed on, as it would be without this.
+ *
+ * @param rtbl Routing table instance
+ * @param flags BPLIB_CLA_INTF_* option flags
+ * @return bp_handle_t value referring to this entity
+ */
+bp_handle_t bplib_create_cla_intf_ext(bplib_routetbl_t *rtbl, uint32_t flags);
+
 /**
  * @brief Creates a basic data-passing logical entity
  *
@@ -203,6 +272,9 @@ bp_handle_t bplib_create_node_intf(bplib_routetbl_t *rtbl, bp_ipn_t node_num);
  * @note the socket-like object must be bound and connected before this API
  * can be used.
  *
+ * The socket may have a memory quota the same as a CLA interface, see bplib_cla_ingress(), which
+ * is set with the intf ID of the socket.
+ *
  * @param desc Socket-like object from bplib_create_socket()
  * @param payload Pointer to buffer containing application PDU/datagram
  * @param size Size of application PDU/datagram
@@ -211,6 +283,111 @@ bp_handle_t bplib_create_node_intf(bplib_routetbl_t *rtbl, bp_ipn_t node_num);
  */
 int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t timeout);
 
+/**
+ * @brief Send a batch of application PDUs/datagrams over the socket-like interface
+ *
+ * This is the same as calling bplib_send() for each of the payloads in turn, but the payloads are all
+ * bundled first and then pushed to the socket queue together, so the queue is locked and the routing
+ * task woken only once for the whole batch.  Payloads are accepted in order; if the queue fills up,
+ * the remaining ones are not accepted.  All the bundles of a batch are held in memory until the batch
+ * is pushed, so very large batches may run short of blocks.
+ *
+ * @param desc Socket-like object from bplib_create_socket()
+ * @param payloads Array of payload buffers
+ * @param count Number of entries in payloads
+ * @param[out] status_list Array of count entries, set to the status of each payload
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if all the payloads were accepted
+ * @returns otherwise the status of the first payload that was not accepted
+ */
+int bplib_send_many(bp_socket_t *desc, const bplib_send_buf_t *payloads, uint32_t count, int *status_list,
+                    uint32_t timeout);
+
+/**
+ * @brief Send an application PDU/datagram over the socket-like interface, without copying it
+ *
+ * This is the same as bplib_send(), but the payload stays in the caller's buffer and the bundle only
+ * refers to it, so it is never copied into the pool.  The buffer must not be changed or freed until
+ * the library gives it back by calling the release function, which happens once nothing refers to it
+ * anymore: after the bundle has been delivered, acknowledged, or discarded.  The release function is
+ * called exactly once for every call to this function, even if the send fails, and may be called from
+ * a different task, or before this returns.
+ *
+ * @param desc Socket-like object from bplib_create_socket()
+ * @param payload Pointer to the application PDU/datagram
+ * @param size Size of the application PDU/datagram
+ * @param release_func Called when the library is done with the buffer, may be NULL
+ * @param release_arg Opaque argument for release_func
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_send_extern(bp_socket_t *desc, const void *payload, size_t size, bplib_payload_release_func_t release_func,
+                      void *release_arg, uint32_t timeout);
+
+/**
+ * @brief Set up the completion queue of the socket, for bplib_send_async()
+ *
+ * The queue is made the first time this is called, with room for the completions of max_in_flight
+ * bundles (or BPLIB_COMPLETION_IN_FLIGHT_DEFAULT if 0), and kept until the socket is closed.  Calling
+ * it again does nothing.
+ *
+ * @param desc Socket descriptor
+ * @param max_in_flight the most bundles sent with bplib_send_async() whose final completion has not been taken
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_completions(bp_socket_t *desc, uint32_t max_in_flight);
+
+/**
+ * @brief Send an application PDU/datagram, and report what happens to it in the completion queue
+ *
+ * This makes the bundle the same as bplib_send() does, but never waits: if the socket queue is full, or
+ * max_in_flight bundles are already waiting for their final completion, this returns BP_TIMEOUT at once.
+ * Once it has returned BP_SUCCESS, the progress of the bundle shows up in bplib_get_completions() with the
+ * user_tag, ending with either bplib_completion_done or bplib_completion_failed.  A bundle held for
+ * custody only gets its final completion once the custody is released, so this also tells when that
+ * happens.  If it returns anything else there are no completions for it.
+ *
+ * This cannot be used while the socket is coalescing, see bplib_socket_set_coalescing(), as then the
+ * ADUs do not each have a bundle of their own.
+ *
+ * @param desc Socket descriptor, with bplib_socket_set_completions() called on it
+ * @param payload Pointer to the application PDU/datagram
+ * @param size Size of the application PDU/datagram
+ * @param user_tag Any value, passed back in the completions
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_send_async(bp_socket_t *desc, const void *payload, size_t size, uint64_t user_tag);
+
+/**
+ * @brief Take completions from the queue of the socket, oldest first
+ *
+ * This waits up to the timeout for the first one, and then takes whatever others are there.  Completions
+ * may come in from any task, including after the socket is closed, but then they are no longer seen.
+ *
+ * @param desc Socket descriptor
+ * @param[out] completions where to put them
+ * @param max_completions how many fit in completions
+ * @param[out] num_completions set to the number put there
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if at least one was taken
+ * @retval BP_TIMEOUT if there were none
+ */
+int bplib_get_completions(bp_socket_t *desc, bplib_completion_t *completions, uint32_t max_completions,
+                          uint32_t *num_completions, uint32_t timeout);
+
+/**
+ * @brief Get a file descriptor which is readable while the completion queue of the socket has entries
+ *
+ * This is the same kind of descriptor as bplib_socket_get_notify_fd(), for the completion queue made by
+ * bplib_socket_set_completions().  It stays readable until bplib_get_completions() has taken them all.
+ * A producer can wait on it for bplib_completion_custody_taken or bplib_completion_custody_acked, to free
+ * its own copy of the data as soon as the node, or another custodian, holds the bundle.
+ *
+ * @param desc Socket descriptor, with bplib_socket_set_completions() called on it
+ * @returns file descriptor (not negative) if successful, or BP_ERROR
+ */
+int bplib_socket_get_completion_fd(bp_socket_t *desc);
+
 /**
  * @brief Receive a single application PDU/datagram over the socket-like interface
  *
@@ -229,6 +406,216 @@ int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t tim
  */
 int bplib_recv(bp_socket_t *desc, void *payload, size_t *size, uint32_t timeout);
 
+/**
+ * @brief Receive a batch of application PDUs/datagrams over the socket-like interface
+ *
+ * This is the same as bplib_recv(), but this waits only for the first bundle and then also takes
+ * whatever other bundles are ready, filling the buffers in order with one PDU each.  The queue is
+ * locked only once for the whole batch.  As with bplib_recv(), a PDU that does not fit in its buffer
+ * is dropped; the buffer is then used for the next one.
+ *
+ * @param desc Socket-like object from bplib_create_socket()
+ * @param[inout] buffers Array of buffers, see bplib_recv_buf_t
+ * @param count Number of entries in buffers
+ * @param[out] num_filled Number of buffers that were filled, from the start of the array
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if at least one buffer was filled
+ */
+int bplib_recv_many(bp_socket_t *desc, bplib_recv_buf_t *buffers, uint32_t count, uint32_t *num_filled,
+                    uint32_t timeout);
+
+/**
+ * @brief Receive a single application PDU/datagram, without copying it
+ *
+ * This is the same as bplib_recv(), but instead of copying the payload into a buffer this fills in
+ * iov with pointers to the pieces of it in pool memory, in order.  The memory is read-only, and is held
+ * until bplib_recv_view_release() is called with the payload_ref that was returned; it must not be used
+ * after that.  Holding many payloads this way holds their bundles in the pool as well.
+ *
+ * If there are not enough entries the bundle is dropped, as for a buffer that is too small, and
+ * iov_count is set to the number that would have been needed.
+ *
+ * @param desc Socket descriptor
+ * @param[out] iov Array of entries to fill in
+ * @param[inout] iov_count Number of entries in iov on input, number of entries used (or needed) on output
+ * @param[out] size Set to the total size of the payload
+ * @param[out] payload_ref Set to the reference to pass to bplib_recv_view_release(), or NULL
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_recv_view(bp_socket_t *desc, bplib_iovec_t *iov, uint32_t *iov_count, size_t *size,
+                    bplib_mpool_ref_t *payload_ref, uint32_t timeout);
+
+/**
+ * @brief Release a payload that was received with bplib_recv_view()
+ *
+ * @param desc Socket descriptor
+ * @param payload_ref The payload_ref from bplib_recv_view()
+ */
+void bplib_recv_view_release(bp_socket_t *desc, bplib_mpool_ref_t payload_ref);
+
+/**
+ * @brief Get a file descriptor which is readable while the socket has data to receive
+ *
+ * This can be added to a poll()/epoll() set, so that one event loop can serve many sockets rather
+ * than a thread per socket waiting in bplib_recv().  It is level triggered: it stays readable until
+ * the queue of the socket has been drained by bplib_recv() (or the other receive calls) with a timeout
+ * of 0, so the loop should receive until that returns BP_TIMEOUT.  The descriptor belongs to the socket
+ * and must not be read or closed by the application; it is closed along with the socket, so it should be
+ * taken out of the poll set before bplib_close_socket().  Calling this again returns the same descriptor.
+ *
+ * @note This needs OS support, currently an eventfd on Linux, otherwise it always fails.
+ *
+ * @param desc Socket descriptor
+ * @returns file descriptor (not negative) if successful, or BP_ERROR
+ */
+int bplib_socket_get_notify_fd(bp_socket_t *desc);
+
+/**
+ * @brief Set or clear non-blocking mode on the socket
+ *
+ * In non-blocking mode the timeout passed to bplib_send(), bplib_recv() and the other send and receive
+ * calls is ignored, and they never wait.  If the socket queue is full (sending) or empty (receiving) they
+ * return BP_TIMEOUT at once, without making a bundle or taking the queue lock.  bplib_send_many() makes
+ * and sends only as many bundles as the queue has room for; the status of the rest is BP_TIMEOUT, so
+ * they can be sent again later.  Together with bplib_socket_get_notify_fd() this allows an event loop
+ * to serve many sockets without retrying in a busy loop.
+ *
+ * @param desc Socket descriptor
+ * @param enable true for non-blocking mode, false for the default of waiting up to the timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_nonblocking(bp_socket_t *desc, bool enable);
+
+/**
+ * @brief Set whether bundles delivered directly to a socket on this node skip the primary block encoding
+ *
+ * A best effort bundle (bplib_policy_delivery_none) sent to another service on the same node is put
+ * straight into the queue of the receiving socket by bplib_send() and the other send calls, without
+ * going through the routing table or the service interface.  If the receiving socket is not bound at
+ * the time, the bundle is routed as usual.  With this set, such a bundle does not get its primary block
+ * encoded either, as only the payload is ever read from it.  The payload is still copied into the pool.
+ *
+ * @param desc Socket descriptor
+ * @param enable true to skip the encoding, false for the default of encoding every bundle
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_local_skip_encode(bp_socket_t *desc, bool enable);
+
+/**
+ * @brief Set whether best effort bundles from a socket are encoded when a CLA takes them
+ *
+ * Normally the primary block of every bundle is encoded into the pool by bplib_send() and the other
+ * send calls, and copied from there into the buffer of bplib_cla_egress().  With this set, a best
+ * effort bundle (bplib_policy_delivery_none) from the socket is not encoded then, and bplib_cla_egress()
+ * encodes the primary block straight into its buffer instead, which saves the pool chunks and a copy.
+ * Anything else that needs the encoded bundle on the way, such as fragmentation or bplib_cla_egress_iov(),
+ * still encodes it into the pool when it does.  Bundles that are stored are always encoded.
+ *
+ * @param desc Socket descriptor
+ * @param enable true to encode on egress, false for the default of encoding every bundle when it is sent
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_egress_encode(bp_socket_t *desc, bool enable);
+
+/**
+ * @brief Set whether small ADUs sent on the socket are packed together into one bundle
+ *
+ * With max_size set, bplib_send() and the other send calls do not make a bundle for each ADU.  The ADU
+ * is instead added to a buffer, after its length as 4 bytes big endian, and the buffer is sent as the
+ * payload of one bundle once another ADU would not fit in max_size bytes, or once the first ADU in it has
+ * waited max_delay ms (0 to only send it when full, or when bplib_socket_flush() is called).  An ADU too
+ * big to share a bundle is sent in one of its own, still with its length in front.  A send only returns
+ * BP_TIMEOUT if the ADUs pending could not be sent to make room, and the ADU was then not taken.
+ * bplib_send_extern() copies the ADU into the buffer too, and gives the caller its buffer back at once.
+ *
+ * On receive, bplib_recv() and bplib_recv_many() split each payload back into the ADUs in the order they
+ * were sent, so the socket at the other end must have this set as well (with any max_size).  An ADU too
+ * big for the buffer it is received into is dropped, as a bundle would be.  A bundle that is partly split
+ * is not counted by the notify fd, so keep receiving until BP_TIMEOUT.  bplib_recv_view() is not changed,
+ * it gives the whole payload with the lengths in it.  Receiving from more than one task at a time is
+ * allowed, but they take turns.
+ *
+ * The buffer is made the first time this is called with a nonzero max_size, and kept until the socket is
+ * closed, so a later call may not ask for a bigger one.  A max_size of 0 turns it off, once the ADUs
+ * pending have been sent; if they cannot be sent now this returns BP_TIMEOUT and it stays on.  Closing the
+ * socket sends any ADUs pending, if that can be done without waiting.
+ *
+ * @param desc Socket descriptor
+ * @param max_size the most bytes of ADUs and their lengths in one bundle, 0 to turn it off
+ * @param max_delay the most ms an ADU waits for others, 0 for no limit
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_coalescing(bp_socket_t *desc, size_t max_size, uint32_t max_delay);
+
+/**
+ * @brief Send the ADUs waiting to be packed into a bundle, see bplib_socket_set_coalescing()
+ *
+ * @param desc Socket descriptor
+ * @param timeout how long to wait for room for the bundle
+ * @retval BP_SUCCESS if nothing is left pending, BP_TIMEOUT if the bundle could not be sent in time
+ */
+int bplib_socket_flush(bp_socket_t *desc, uint32_t timeout);
+
+/**
+ * @brief Turn the latency histograms of the socket on or off
+ *
+ * While tracing is on, each bundle the socket sends or receives is counted with the time it spent in
+ * each bplib_trace_stage_t it went through, see bplib_socket_query_latency().  A bundle sent is counted
+ * when a CLA sends it (for the stages up to that), and a bundle received when the application gets it
+ * (for every stage it went through on this node).  The cla_ingress stage of a bundle from another node
+ * is timed from its creation time there, so it is only meaningful if the clocks of the nodes agree.
+ * The histograms are made the first time tracing is turned on, and are kept until the socket is closed.
+ *
+ * @param desc Socket descriptor
+ * @param enable true to count bundles, false to stop
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_tracing(bp_socket_t *desc, bool enable);
+
+/**
+ * @brief Read the latency histogram of one stage for the socket
+ *
+ * The histogram is all zero if tracing was never turned on, see bplib_socket_set_tracing().
+ *
+ * @param desc Socket descriptor
+ * @param stage The stage to read
+ * @param[out] histogram Filled with BPLIB_TRACE_LATENCY_BINS counts of bundles, shortest time first
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_query_latency(bp_socket_t *desc, bplib_trace_stage_t stage, uint32_t *histogram);
+
+/**
+ * @brief Sample the bundles sent and received on the socket
+ *
+ * One in every interval bundles the socket sends is tagged when it is made, and when a CLA sends it
+ * the times it ended each bplib_trace_stage_t are kept in a ring of samples.  The same is done for one
+ * in every interval bundles the application receives, when it gets them.  This is much cheaper than
+ * tracing every bundle, so it can be left on to see where the time goes on a running node.
+ *
+ * The ring is made the first time sampling is turned on, with ring_size samples (or
+ * BPLIB_TRACE_SAMPLE_RING_DEFAULT if 0), and kept until the socket is closed.  Once it is full,
+ * each new sample replaces the oldest.
+ *
+ * @param desc Socket descriptor
+ * @param interval sample one bundle in this many, 0 to stop
+ * @param ring_size the most samples kept, only used when the ring is made
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_set_sampling(bp_socket_t *desc, uint32_t interval, uint32_t ring_size);
+
+/**
+ * @brief Take the oldest samples from the ring of the socket
+ *
+ * @param desc Socket descriptor
+ * @param[out] samples where to put them, oldest first
+ * @param max_samples how many fit in samples
+ * @param[out] num_samples set to the number put there, 0 if there were none
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_socket_read_samples(bp_socket_t *desc, bplib_trace_sample_t *samples, uint32_t max_samples,
+                              uint32_t *num_samples);
+
 /* CLA I/O (bundle data units) */
 
 /**
@@ -239,6 +626,14 @@ int bplib_recv(bp_socket_t *desc, void *payload, size_t *size, uint32_t timeout)
  * be forwarded internally through the routing table to either its destination (if local) or via a relay
  * storage (if configured) or to another CLA.
  *
+ * If the interface has a frame MTU set with bplib_config_integer() (bplib_variable_cla_frame_mtu), the buffer
+ * is a frame which may hold several bundles back to back, as packed by bplib_cla_egress() on the peer.  Each is
+ * passed on in turn.  If one fails to decode, the bundles before it have been accepted and the rest are dropped.
+ *
+ * If the interface has a memory quota (bplib_variable_mem_quota_limit) and the bundles which came in through it
+ * already hold that much of the pool, the bundle is not accepted.  This returns BP_TIMEOUT if the quota is set to
+ * refuse (bplib_variable_mem_quota_refuse), so the CLA can hold on to it and try again, or BP_ERROR if not.
+ *
  * @param rtbl Routing table instance
  * @param intf_id bp_handle_t value from bplib_create_cla_intf()
  * @param bundle Pointer to bundle buffer
@@ -248,6 +643,111 @@ int bplib_recv(bp_socket_t *desc, void *payload, size_t *size, uint32_t timeout)
  */
 int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *bundle, size_t size, uint32_t timeout);
 
+/**
+ * @brief Receive a batch of complete bundles from a remote system
+ *
+ * This is the same as calling bplib_cla_ingress() for each of the bundles in turn, but the bundles
+ * are all decoded first and then pushed to the interface queue together, so the queue is locked and
+ * the routing task woken only once for the whole batch.  Bundles are accepted in order; if the queue
+ * fills up, the remaining ones are not accepted.
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @param bundles Array of bundle buffers
+ * @param count Number of entries in bundles
+ * @param[out] status_list Array of count entries, set to the status of each bundle
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if all the bundles were accepted
+ * @returns otherwise the status of the first bundle that was not accepted
+ */
+int bplib_cla_ingress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const bplib_cla_bundle_buf_t *bundles,
+                            uint32_t count, int *status_list, uint32_t timeout);
+
+/**
+ * @brief Get a buffer in pool memory to receive a bundle into
+ *
+ * A bundle that is received into this buffer can be passed to bplib_cla_ingress_adopt(), which
+ * decodes it where it is instead of copying it.  The buffer is a single block in the pool, so
+ * the size is limited to the largest block size that the pool has.
+ *
+ * @param rtbl Routing table instance
+ * @param[inout] size Size needed on input, actual size of the buffer on output
+ * @param[out] buffer Set to the start of the buffer
+ * @param[out] buffer_ref Set to the reference to pass to bplib_cla_ingress_adopt() or bplib_cla_rxbuf_release()
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_rxbuf_get(bplib_routetbl_t *rtbl, size_t *size, void **buffer, bplib_mpool_ref_t *buffer_ref);
+
+/**
+ * @brief Return a buffer from bplib_cla_rxbuf_get() that was not used
+ *
+ * @param rtbl Routing table instance
+ * @param buffer_ref The buffer_ref from bplib_cla_rxbuf_get()
+ */
+void bplib_cla_rxbuf_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t buffer_ref);
+
+/**
+ * @brief Receive complete bundle from a remote system, without copying it
+ *
+ * This is the same as bplib_cla_ingress(), but the bundle was received into a buffer from
+ * bplib_cla_rxbuf_get().  The blocks of the bundle refer to the data in the buffer, so it is
+ * not copied again.  This always takes over the buffer_ref, whether successful or not, and the
+ * buffer must not be used after this.
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @param buffer_ref The buffer_ref from bplib_cla_rxbuf_get()
+ * @param size Size of encoded bundle in the buffer
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_ingress_adopt(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t buffer_ref, size_t size,
+                            uint32_t timeout);
+
+/**
+ * @brief Start receiving a bundle that arrives in pieces
+ *
+ * This is for bundles that are larger than any one buffer of the convergence layer, such as a
+ * large payload that comes in over several frames.  The pieces are passed to bplib_cla_ingress_feed()
+ * as they arrive, and written to pool memory as they go, so the whole bundle never needs to be
+ * held in one contiguous buffer.  Blocks other than the payload must each fit in the staging buffer
+ * of the stream, which is about 4KiB.
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @param[out] stream_ref Set to the reference to pass to bplib_cla_ingress_feed() and bplib_cla_ingress_end()
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_ingress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref);
+
+/**
+ * @brief Pass the next piece of a bundle started with bplib_cla_ingress_begin()
+ *
+ * The pieces can be any size, and do not need to line up with the blocks of the bundle.
+ * Once this fails, the rest of the bundle is ignored and bplib_cla_ingress_end() will drop it.
+ *
+ * @param rtbl Routing table instance
+ * @param stream_ref The stream_ref from bplib_cla_ingress_begin()
+ * @param data Pointer to the next bytes of the bundle
+ * @param size Number of bytes at data
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_ingress_feed(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, const void *data, size_t size);
+
+/**
+ * @brief Finish receiving a bundle started with bplib_cla_ingress_begin()
+ *
+ * If the whole bundle was fed in, it is passed on the same as it would be from bplib_cla_ingress().
+ * This always takes over the stream_ref, whether successful or not, so it is also the way to abandon
+ * a bundle that was only partly received.
+ *
+ * @param rtbl Routing table instance
+ * @param stream_ref The stream_ref from bplib_cla_ingress_begin()
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_ingress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, uint32_t timeout);
+
 /**
  * @brief Send complete bundle to remote system
  *
@@ -255,6 +755,18 @@ int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *b
  * specified CLA interface.  This data may then be forwarded to the CLA implementation for actual transmission to
  * a remote node.
  *
+ * If the interface has an egress rate set with bplib_config_integer() (bplib_variable_cla_egress_rate), bundles
+ * are paced out at that rate, with bursts of up to bplib_variable_cla_egress_burst bytes.  This call then waits
+ * until the link can take another bundle, or returns BP_TIMEOUT if that is not within the timeout.  The same
+ * pacing applies to bplib_cla_egress_batch(), bplib_cla_egress_iov() and bplib_cla_egress_begin().
+ *
+ * If the interface has a frame MTU set (bplib_variable_cla_frame_mtu), more bundles which are ready are packed
+ * into the buffer after the first, up to the MTU, for which this waits up to bplib_variable_cla_frame_wait ms
+ * after the first.  A bundle which does not fit is held for the next call.  The bundles are back to back with
+ * nothing between them, and bplib_cla_ingress() on the peer splits them again.  Framing is only done by this
+ * call, so bplib_cla_egress_batch(), bplib_cla_egress_iov() and bplib_cla_egress_begin() should not be used
+ * on the same interface.
+ *
  * @param rtbl Routing table instance
  * @param intf_id bp_handle_t value from bplib_create_cla_intf()
  * @param bundle Pointer to bundle buffer
@@ -264,6 +776,110 @@ int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *b
  */
 int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle, size_t *size, uint32_t timeout);
 
+/**
+ * @brief Send a batch of complete bundles to remote system
+ *
+ * This is the same as bplib_cla_egress(), but this waits only for the first bundle and then also takes
+ * whatever other bundles are ready, filling the buffers in order with one bundle each.  The queue is
+ * locked only once for the whole batch.  As with bplib_cla_egress(), a bundle that does not fit in
+ * its buffer is dropped; the buffer is then used for the next bundle.
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @param[inout] buffers Array of buffers, see bplib_cla_egress_buf_t
+ * @param count Number of entries in buffers
+ * @param[out] num_filled Number of buffers that were filled, from the start of the array
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if at least one buffer was filled
+ */
+int bplib_cla_egress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_egress_buf_t *buffers,
+                           uint32_t count, uint32_t *num_filled, uint32_t timeout);
+
+/**
+ * @brief Send complete bundle to remote system, without copying it
+ *
+ * This is the same as bplib_cla_egress(), but instead of copying the encoded bundle into a buffer this
+ * fills in iov with pointers to the pieces of it in pool memory, in order, which can be passed on to
+ * writev() or sendmsg() directly.  The bundle is held until bplib_cla_egress_iov_release() is called
+ * with the bundle_ref that was returned, and the memory must not be used after that.
+ *
+ * If there are not enough entries the bundle is dropped, as for a buffer that is too small.
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @param[out] iov Array of entries to fill in
+ * @param[inout] iov_count Number of entries in iov on input, number of entries used (or needed) on output
+ * @param[out] bundle_ref Set to the reference to pass to bplib_cla_egress_iov_release(), or NULL
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_egress_iov(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_iovec_t *iov, uint32_t *iov_count,
+                         bplib_mpool_ref_t *bundle_ref, uint32_t timeout);
+
+/**
+ * @brief Release a bundle that was sent with bplib_cla_egress_iov()
+ *
+ * @param rtbl Routing table instance
+ * @param bundle_ref The bundle_ref from bplib_cla_egress_iov()
+ */
+void bplib_cla_egress_iov_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t bundle_ref);
+
+/**
+ * @brief Start sending a bundle that may be larger than one transmit buffer
+ *
+ * This is the same as bplib_cla_egress(), but the encoded bundle is not copied out all at once.  Instead
+ * it is read out in pieces of any size with bplib_cla_egress_read(), straight from pool memory, so a large
+ * bundle can go out through small fixed-size buffers.  The bundle is held until bplib_cla_egress_end().
+ * It is counted as sent from when this returns, the same as with bplib_cla_egress_iov().
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @param[out] stream_ref Set to the reference to pass to bplib_cla_egress_read() and bplib_cla_egress_end(), or NULL
+ * @param[out] size Set to the size of the whole encoded bundle
+ * @param timeout Timeout
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_egress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref, size_t *size,
+                           uint32_t timeout);
+
+/**
+ * @brief Get the next piece of a bundle started with bplib_cla_egress_begin()
+ *
+ * The buffer is filled as far as the bundle goes, so the size is only less than the buffer at the end
+ * of the bundle, and 0 once all of it has been read.
+ *
+ * @param rtbl Routing table instance
+ * @param stream_ref The stream_ref from bplib_cla_egress_begin()
+ * @param buffer Buffer for the next bytes of the bundle
+ * @param[inout] size Size of buffer on input, number of bytes put in it on output
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_cla_egress_read(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, void *buffer, size_t *size);
+
+/**
+ * @brief Release a bundle that was sent with bplib_cla_egress_begin()
+ *
+ * This can be called before the whole bundle has been read, to give up on sending the rest of it.
+ *
+ * @param rtbl Routing table instance
+ * @param stream_ref The stream_ref from bplib_cla_egress_begin()
+ */
+void bplib_cla_egress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref);
+
+/**
+ * @brief Get a file descriptor which is readable while the CLA interface has bundles to send
+ *
+ * This is the same as bplib_socket_get_notify_fd(), but for the bundles which bplib_cla_egress() (or the
+ * other egress calls) would return.  If an egress rate is set the egress call may still return BP_TIMEOUT
+ * while the descriptor is readable, as the bundle is held back by the pacing.  The descriptor is closed
+ * when the interface is deleted.
+ *
+ * @param rtbl Routing table instance
+ * @param intf_id bp_handle_t value from bplib_create_cla_intf()
+ * @returns file descriptor (not negative) if successful, or BP_ERROR
+ */
+int bplib_cla_get_notify_fd(bplib_routetbl_t *rtbl, bp_handle_t intf_id);
+
 /**
  * @brief Get an operational value
  *
@@ -295,6 +911,24 @@ int bplib_query_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_varia
  */
 int bplib_config_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t value);
 
+/**
+ * @brief Read all the metrics at once
+ *
+ * Fills in every metric of the table, followed by those of each CLA, socket and storage intf
+ * that currently exists, in one pass which takes no lock for longer than walking the intf list.
+ * The descriptions are static, so an exporter can keep the pointers between snapshots.
+ *
+ * @param rtbl Routing table instance
+ * @param[out] metrics where to put the metrics
+ * @param max_metrics how many fit in metrics
+ * @param[out] num_metrics set to the number there are, which may be more than max_metrics
+ *
+ * @retval BP_SUCCESS if all of them were filled in
+ * @retval BP_ERROR if there were more than max_metrics, in which case the first max_metrics are filled in
+ */
+int bplib_metrics_snapshot(bplib_routetbl_t *rtbl, bplib_metric_t *metrics, uint32_t max_metrics,
+                           uint32_t *num_metrics);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -26,6 +26,8 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "bplib_config.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -73,8 +75,9 @@ struct bp_desc;
 typedef struct bp_desc   bp_desc_t;
 typedef struct bp_socket bp_socket_t;
 
-typedef struct bplib_mpool_block bplib_mpool_block_t;
-typedef struct bplib_mpool       bplib_mpool_t;
+typedef struct bplib_mpool_block      bplib_mpool_block_t;
+typedef struct bplib_mpool            bplib_mpool_t;
+typedef struct bplib_mpool_inspection bplib_mpool_inspection_t;
 
 typedef struct bplib_cache_module_api bplib_cache_module_api_t;
 
@@ -149,8 +152,8 @@ typedef enum
                                  */
     bplib_policy_delivery_local_ack, /**< use local storage of bundle, locally acknowledge but no node-to-node custody
                                         transfer */
-    bplib_policy_delivery_custody_tracking /**< enable full custody transfer signals and acknowledgement (not yet
-                                              implemented) */
+    bplib_policy_delivery_custody_tracking /**< enable full custody transfer signals and acknowledgement, hop by hop
+                                              between the nodes whose storage takes custody */
 } bplib_policy_delivery_t;
 
 typedef struct bplib_connection
@@ -169,10 +172,187 @@ typedef struct bplib_connection
 
     bplib_policy_delivery_t local_delivery_policy;
 
+    uint32_t class_of_service; /* BP_COS_* value, for flows that queue by priority */
+
 } bplib_connection_t;
 
 typedef struct bplib_routetbl bplib_routetbl_t;
 
+/**
+ * @brief Callback to give a payload buffer back to the application, see bplib_send_extern()
+ *
+ * @param release_arg The opaque argument that was passed with the buffer
+ * @param payload Pointer to the buffer
+ * @param size Size of the buffer
+ */
+typedef void (*bplib_payload_release_func_t)(void *release_arg, const void *payload, size_t size);
+
+/**
+ * @brief One payload in a batch passed to bplib_send_many()
+ */
+typedef struct bplib_send_buf
+{
+    const void *payload; /**< pointer to the application PDU/datagram */
+    size_t      size;    /**< size of the application PDU/datagram */
+} bplib_send_buf_t;
+
+/**
+ * @brief One buffer in a batch passed to bplib_recv_many()
+ */
+typedef struct bplib_recv_buf
+{
+    void  *payload; /**< pointer to the buffer */
+    size_t size;    /**< size of the buffer on input, size of the PDU/datagram in it on output */
+} bplib_recv_buf_t;
+
+/**
+ * @brief One encoded bundle in a batch passed to bplib_cla_ingress_batch()
+ */
+typedef struct bplib_cla_bundle_buf
+{
+    const void *bundle; /**< pointer to the encoded bundle */
+    size_t      size;   /**< size of the encoded bundle */
+} bplib_cla_bundle_buf_t;
+
+/**
+ * @brief One buffer in a batch passed to bplib_cla_egress_batch()
+ */
+typedef struct bplib_cla_egress_buf
+{
+    void  *bundle; /**< pointer to the buffer */
+    size_t size;   /**< size of the buffer on input, size of the bundle in it on output */
+} bplib_cla_egress_buf_t;
+
+/**
+ * @brief One piece of a bundle that is exported without copying, see bplib_cla_egress_iov()
+ *
+ * This has the same members as a POSIX struct iovec, but the memory is read-only,
+ * as it is still part of the bundle in the pool.
+ */
+typedef struct bplib_iovec
+{
+    const void *base; /**< start of the data */
+    size_t      len;  /**< size of the data */
+} bplib_iovec_t;
+
+/**
+ * @brief Stages of a bundle which are timed for the latency histograms, see bplib_socket_query_latency()
+ *
+ * Each stage is timed from the end of the one before it that the bundle went through.
+ */
+typedef enum bplib_trace_stage
+{
+    bplib_trace_stage_bundleize,   /**< from the send call until the bundle is made */
+    bplib_trace_stage_route,       /**< until it is taken from the socket queue to be routed */
+    bplib_trace_stage_cache_store, /**< until it is put in storage, if it goes through a cache */
+    bplib_trace_stage_cla_egress,  /**< until a CLA sends it */
+    bplib_trace_stage_cla_ingress, /**< from its creation on the sending node until a CLA here receives it */
+    bplib_trace_stage_delivery,    /**< until it is put in the queue of the socket it is for */
+    bplib_trace_stage_recv,        /**< until the application receives it */
+    bplib_trace_stage_max          /**< reserved value, keep last */
+} bplib_trace_stage_t;
+
+/*
+ * Number of bins in a latency histogram: under 1ms, under 10ms, under 100ms, under 1s, and longer
+ */
+#define BPLIB_TRACE_LATENCY_BINS 5
+
+/*
+ * Number of samples kept for a socket if bplib_socket_set_sampling() is not given a size
+ */
+#define BPLIB_TRACE_SAMPLE_RING_DEFAULT 256
+
+/**
+ * @brief The stage times of one sampled bundle, see bplib_socket_set_sampling()
+ *
+ * The times are DTN times in ms.  The start is the send call for a bundle made here, or its creation
+ * time for one from another node, which is 0 if that node had no clock.
+ */
+typedef struct bplib_trace_sample
+{
+    bp_ipn_addr_t source;
+    uint64_t      sequence; /**< creation sequence number, which with the source identifies the bundle */
+    uint64_t      start_time;
+    uint64_t      stage_time[bplib_trace_stage_max]; /**< when each stage ended, 0 for those it did not go through */
+} bplib_trace_sample_t;
+
+/**
+ * @brief What a completion reports about a bundle sent with bplib_send_async()
+ *
+ * Each bundle gets each of the first four at most once, as they happen, and then exactly one of the
+ * last two once the node holds nothing more of it.
+ */
+typedef enum bplib_completion_event
+{
+    bplib_completion_sent,          /**< a CLA sent it, the first time if it was sent more than once */
+    bplib_completion_delivered,     /**< a socket on this node received it */
+    bplib_completion_custody_acked, /**< another custodian took custody of it */
+    bplib_completion_custody_taken, /**< this node wrote it to storage, so the sender need not keep it */
+    bplib_completion_done,          /**< released after it was delivered, custody acked, or sent when best effort */
+    bplib_completion_failed,        /**< released without that, e.g. expired, dropped, or never acked */
+    bplib_completion_max            /**< reserved value, keep last */
+} bplib_completion_event_t;
+
+/**
+ * @brief One entry taken from the completion queue of a socket, see bplib_get_completions()
+ */
+typedef struct bplib_completion
+{
+    uint64_t                 user_tag; /**< as passed to bplib_send_async() */
+    bplib_completion_event_t event;
+} bplib_completion_t;
+
+/*
+ * Number of bundles a socket can have in flight with bplib_send_async() if bplib_socket_set_completions()
+ * is not given a number
+ */
+#define BPLIB_COMPLETION_IN_FLIGHT_DEFAULT 1024
+
+/**
+ * @brief Kinds of value in a metrics snapshot, see bplib_metrics_snapshot()
+ */
+typedef enum bplib_metric_type
+{
+    bplib_metric_type_counter,  /**< only goes up, until the intf or table is recreated */
+    bplib_metric_type_gauge,    /**< a current level, which may go either way */
+    bplib_metric_type_histogram /**< a set of counters, one per bin of a time range */
+} bplib_metric_type_t;
+
+/*
+ * Most bins any histogram metric has
+ */
+#define BPLIB_METRIC_MAX_BINS 5
+
+/**
+ * @brief Describes a metric, the same for every scope it is reported for
+ *
+ * The names are unique and made of lower case letters, digits and underscores, so they can be
+ * exported as they are.  For a histogram, bin_limit_us holds the upper limit of each bin but the
+ * last, which has none.
+ */
+typedef struct bplib_metric_desc
+{
+    const char         *name;
+    const char         *help;
+    bplib_metric_type_t type;
+    uint32_t            num_bins; /**< 0 unless it is a histogram */
+    const uint32_t     *bin_limit_us;
+} bplib_metric_desc_t;
+
+/**
+ * @brief One value in a metrics snapshot
+ *
+ * The bins of a histogram are not cumulative, each counts only what fell in its own range,
+ * and the value is the sum of them.
+ */
+typedef struct bplib_metric
+{
+    const bplib_metric_desc_t *desc;
+    bp_handle_t                intf_id; /**< the intf it is for, BP_INVALID_HANDLE for the whole table */
+    bp_sval_t                  value;
+    bp_sval_t                  bins[BPLIB_METRIC_MAX_BINS];
+} bplib_metric_t;
+
 /* Storage service - reserved for future use */
 typedef struct bp_store
 {
@@ -205,10 +385,90 @@ typedef struct
 
 typedef enum
 {
-    bplib_variable_none,            /**< reserved value, keep first */
-    bplib_variable_mem_current_use, /**< replaces bplib_os_memused() for external API use */
-    bplib_variable_mem_high_use,    /**< replaces bplib_os_memhigh() for external API use */
-    bplib_variable_max              /**< reserved value, keep last */
+    bplib_variable_none,                /**< reserved value, keep first */
+    bplib_variable_mem_current_use,     /**< replaces bplib_os_memused() for external API use */
+    bplib_variable_mem_high_use,        /**< replaces bplib_os_memhigh() for external API use */
+    bplib_variable_mem_collect_backlog, /**< number of blocks waiting for garbage collection */
+    bplib_variable_mem_alloc_refused,   /**< bundle allocations refused because memory was low */
+    bplib_variable_mem_free_depth_min,  /**< lowest number of free blocks over recent maintenance cycles */
+    bplib_variable_mem_free_depth_max,  /**< highest number of free blocks over recent maintenance cycles */
+    bplib_variable_mem_alloc_generic,   /**< generic data blocks allocated */
+    bplib_variable_mem_alloc_primary,   /**< primary bundle blocks allocated */
+    bplib_variable_mem_alloc_canonical, /**< canonical bundle blocks allocated */
+    bplib_variable_mem_alloc_flow,      /**< flow blocks allocated */
+    bplib_variable_mem_alloc_ref,       /**< reference blocks allocated */
+    bplib_variable_mem_free_generic,    /**< generic data blocks freed */
+    bplib_variable_mem_free_primary,    /**< primary bundle blocks freed */
+    bplib_variable_mem_free_canonical,  /**< canonical bundle blocks freed */
+    bplib_variable_mem_free_flow,       /**< flow blocks freed */
+    bplib_variable_mem_free_ref,        /**< reference blocks freed */
+    bplib_variable_mem_alloc_pri_lo,    /**< blocks allocated at priority 0 to 63 */
+    bplib_variable_mem_alloc_pri_med,   /**< blocks allocated at priority 64 to 127 */
+    bplib_variable_mem_alloc_pri_mhi,   /**< blocks allocated at priority 128 to 191 */
+    bplib_variable_mem_alloc_pri_hi,    /**< blocks allocated at priority 192 to 255 */
+    bplib_variable_lock_wait_none,      /**< memory pool locks acquired without waiting */
+    bplib_variable_lock_wait_10us,      /**< memory pool locks acquired after waiting less than 10us */
+    bplib_variable_lock_wait_100us,     /**< memory pool locks acquired after waiting less than 100us */
+    bplib_variable_lock_wait_1ms,       /**< memory pool locks acquired after waiting less than 1ms */
+    bplib_variable_lock_wait_long,      /**< memory pool locks acquired after waiting 1ms or more */
+    bplib_variable_cache_wait_100us,    /**< cache state machine jobs run after waiting less than 100us */
+    bplib_variable_cache_wait_1ms,      /**< cache state machine jobs run after waiting less than 1ms */
+    bplib_variable_cache_wait_10ms,     /**< cache state machine jobs run after waiting less than 10ms */
+    bplib_variable_cache_wait_long,     /**< cache state machine jobs run after waiting 10ms or more */
+    bplib_variable_cache_run_100us,     /**< cache state machine jobs which ran for less than 100us */
+    bplib_variable_cache_run_1ms,       /**< cache state machine jobs which ran for less than 1ms */
+    bplib_variable_cache_run_10ms,      /**< cache state machine jobs which ran for less than 10ms */
+    bplib_variable_cache_run_long,      /**< cache state machine jobs which ran for 10ms or more */
+    bplib_variable_cla_wait_100us,      /**< CLA forwarding jobs run after waiting less than 100us */
+    bplib_variable_cla_wait_1ms,        /**< CLA forwarding jobs run after waiting less than 1ms */
+    bplib_variable_cla_wait_10ms,       /**< CLA forwarding jobs run after waiting less than 10ms */
+    bplib_variable_cla_wait_long,       /**< CLA forwarding jobs run after waiting 10ms or more */
+    bplib_variable_cla_run_100us,       /**< CLA forwarding jobs which ran for less than 100us */
+    bplib_variable_cla_run_1ms,         /**< CLA forwarding jobs which ran for less than 1ms */
+    bplib_variable_cla_run_10ms,        /**< CLA forwarding jobs which ran for less than 10ms */
+    bplib_variable_cla_run_long,        /**< CLA forwarding jobs which ran for 10ms or more */
+    bplib_variable_service_wait_100us,  /**< data service jobs run after waiting less than 100us */
+    bplib_variable_service_wait_1ms,    /**< data service jobs run after waiting less than 1ms */
+    bplib_variable_service_wait_10ms,   /**< data service jobs run after waiting less than 10ms */
+    bplib_variable_service_wait_long,   /**< data service jobs run after waiting 10ms or more */
+    bplib_variable_service_run_100us,   /**< data service jobs which ran for less than 100us */
+    bplib_variable_service_run_1ms,     /**< data service jobs which ran for less than 1ms */
+    bplib_variable_service_run_10ms,    /**< data service jobs which ran for less than 10ms */
+    bplib_variable_service_run_long,    /**< data service jobs which ran for 10ms or more */
+    bplib_variable_cla_egress_rate,     /**< CLA egress pacing rate in bytes per second, 0 for none (per intf) */
+    bplib_variable_cla_egress_burst,    /**< CLA egress pacing burst in bytes, 0 for one second of rate (per intf) */
+    bplib_variable_cla_frame_mtu,       /**< CLA frame size to pack bundles into, 0 for one per frame (per intf) */
+    bplib_variable_cla_frame_wait,      /**< ms to wait for more bundles to pack in a CLA frame (per intf) */
+    bplib_variable_cla_ingress_bytes,   /**< bytes received by a CLA (per intf) */
+    bplib_variable_cla_egress_bytes,    /**< bytes sent by a CLA (per intf) */
+    bplib_variable_cla_ingress_bundles, /**< bundles received by a CLA (per intf) */
+    bplib_variable_cla_egress_bundles,  /**< bundles sent by a CLA (per intf) */
+    bplib_variable_cla_drop_no_route,   /**< bundles received by a CLA with no route onward (per intf) */
+    bplib_variable_cla_drop_queue_full, /**< bundles dropped because a CLA queue was full (per intf) */
+    bplib_variable_cla_drop_decode,     /**< bundles received by a CLA which did not decode (per intf) */
+    bplib_variable_cla_drop_expired,    /**< bundles which expired before a CLA could send them (per intf) */
+    bplib_variable_cla_queue_10ms,      /**< bundles sent by a CLA within 10ms of arrival (per intf) */
+    bplib_variable_cla_queue_100ms,     /**< bundles sent by a CLA within 100ms of arrival (per intf) */
+    bplib_variable_cla_queue_1s,        /**< bundles sent by a CLA within 1s of arrival (per intf) */
+    bplib_variable_cla_queue_long,      /**< bundles sent by a CLA 1s or more after arrival (per intf) */
+    bplib_variable_cla_ingress_bps,     /**< moving average of CLA bytes received per second (per intf) */
+    bplib_variable_cla_egress_bps,      /**< moving average of CLA bytes sent per second (per intf) */
+    bplib_variable_cla_fragment_mtu,    /**< largest bundle a CLA sends whole, 0 to never fragment (per intf) */
+    bplib_variable_cla_reassembly_mem,  /**< payload bytes a CLA holds for reassembly, 0 for none (per intf) */
+    bplib_variable_cla_reassembly_wait, /**< ms a CLA waits for all fragments, 0 for the lifetime (per intf) */
+    bplib_variable_cla_fragmented,      /**< bundles sent by a CLA as fragments (per intf) */
+    bplib_variable_cla_reassembled,     /**< bundles put back together from fragments received by a CLA (per intf) */
+    bplib_variable_cla_drop_reassembly, /**< fragmented bundles a CLA gave up on, out of time or memory (per intf) */
+    bplib_variable_cla_drop_duplicate,  /**< bundles a CLA dropped as received recently already (per intf) */
+    bplib_variable_mem_quota_limit,     /**< bytes of bundles that may come in through an intf, 0 for none (per intf) */
+    bplib_variable_mem_quota_refuse,    /**< nonzero to refuse bundles over the quota rather than drop (per intf) */
+    bplib_variable_mem_quota_used,      /**< bytes of bundles charged to the quota of an intf (per intf) */
+    bplib_variable_mem_quota_over,      /**< bundles dropped or refused as over the quota of an intf (per intf) */
+    bplib_variable_sched_quantum,       /**< bundles an intf may forward per job run, 0 for no limit (per intf) */
+    bplib_variable_sched_quantum_bytes, /**< nonzero if the sched quantum is in bytes rather than bundles (per intf) */
+    bplib_variable_mem_reserve_blocks,  /**< pool blocks set aside for the bundles of an intf, 0 for none (per intf) */
+    bplib_variable_mem_reserve_used,    /**< allocations served from the blocks set aside for an intf (per intf) */
+    bplib_variable_max                  /**< reserved value, keep last */
 } bplib_variable_t;
 
 /**
@@ -324,6 +584,12 @@ static inline bp_handle_t bp_handle_from_serial(int hv, bp_handle_t base)
         0x6000000               \
     }
 
+#define BPLIB_HANDLE_OS_NOTIFIER_BASE \
+    (bp_handle_t)                     \
+    {                                 \
+        0x7000000                     \
+    }
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,167 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_CONFIG_H
+#define BPLIB_CONFIG_H
+
+/*
+ * The compile-time limits of the library, all in one place.  Each of these can be set from
+ * the build (e.g. -DBPLIB_ROUTE_MAX_CONTACTS=64), and everything that depends on one of them
+ * is sized from the value here, so changing it needs a rebuild of the whole library.
+ */
+
+/******************************************************************************
+ STATIC PROFILE
+ ******************************************************************************/
+
+/*
+ * With BPLIB_STATIC_CONFIG defined (the BPLIB_ENABLE_STATIC_CONFIG option in CMake),
+ * nothing is taken from the C library heap: the route table and its pool are one static
+ * object of a size fixed here, and bplib_os_calloc() hands out memory from a static arena
+ * until an allocator is set with bplib_os_set_allocator().  All memory the library uses is
+ * then in .bss, so the map file of the link shows the total.
+ *
+ * Only one route table can be made in this profile, and bplib_route_alloc_table() fails if
+ * it asks for more than BPLIB_STATIC_MAX_ROUTES routes or BPLIB_STATIC_POOL_SIZE bytes.
+ */
+#ifdef BPLIB_STATIC_CONFIG
+
+/* Most routes that the one route table can have */
+#ifndef BPLIB_STATIC_MAX_ROUTES
+#define BPLIB_STATIC_MAX_ROUTES 32
+#endif
+
+/* Bytes of pool (cache_mem_size) that the one route table can have */
+#ifndef BPLIB_STATIC_POOL_SIZE
+#define BPLIB_STATIC_POOL_SIZE (4 * 1024 * 1024)
+#endif
+
+/* Bytes in the arena behind bplib_os_calloc(), for locks, sockets, CLAs and other small objects */
+#ifndef BPLIB_STATIC_HEAP_SIZE
+#define BPLIB_STATIC_HEAP_SIZE (256 * 1024)
+#endif
+
+#endif /* BPLIB_STATIC_CONFIG */
+
+/******************************************************************************
+ OS LAYER
+ ******************************************************************************/
+
+/* Locks for the handle based calls, bplib_os_mutex_create() is not limited */
+#ifndef BP_MAX_LOCKS
+#define BP_MAX_LOCKS 128
+#endif
+
+/******************************************************************************
+ MEMORY POOL
+ ******************************************************************************/
+
+/*
+ * Minimum size of a generic data block.  The admin block of a pool needs all of this, so it
+ * can be made bigger but not smaller, and the layout signature of the pool depends on it.
+ */
+#ifndef BP_MPOOL_MIN_USER_BLOCK_SIZE
+#define BP_MPOOL_MIN_USER_BLOCK_SIZE 480
+#endif
+
+/*
+ * Number of registered blocktypes that can be found directly via the registry_index
+ * in the block, rather than searching the blocktype_registry.  Any blocktype registered
+ * after this is full still works, it just uses the slower lookup.
+ */
+#ifndef BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES
+#define BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES 64
+#endif
+
+/*
+ * Maximum number of partitions in a pool created by bplib_mpool_create_partitioned()
+ */
+#ifndef BPLIB_MPOOL_MAX_PARTITIONS
+#define BPLIB_MPOOL_MAX_PARTITIONS 16
+#endif
+
+/*
+ * Blocks looked at by the pool inspection in each maintenance cycle, see bplib_route_set_pool_inspect_budget()
+ */
+#ifndef BPLIB_MPOOL_INSPECT_BUDGET
+#define BPLIB_MPOOL_INSPECT_BUDGET 256
+#endif
+
+/******************************************************************************
+ ROUTING
+ ******************************************************************************/
+
+/*
+ * Number of entries in the per-destination route cache, must be a power of two
+ */
+#ifndef BPLIB_ROUTE_CACHE_SIZE
+#define BPLIB_ROUTE_CACHE_SIZE 64
+#endif
+
+/*
+ * Number of entries in the interface slot table, as a power of two
+ */
+#ifndef BPLIB_ROUTE_INTF_SLOT_BITS
+#define BPLIB_ROUTE_INTF_SLOT_BITS 6
+#endif
+
+/*
+ * Number of contacts the contact plan of a route table can hold
+ */
+#ifndef BPLIB_ROUTE_MAX_CONTACTS
+#define BPLIB_ROUTE_MAX_CONTACTS 32
+#endif
+
+/******************************************************************************
+ CUSTODY
+ ******************************************************************************/
+
+/*
+ * Number of sequence ranges in one DACS, both when one is built and when one is decoded
+ */
+#ifndef BP_DACS_MAX_SEQ_PER_PAYLOAD
+#define BP_DACS_MAX_SEQ_PER_PAYLOAD 16
+#endif
+
+/******************************************************************************
+ CHECKS
+ ******************************************************************************/
+
+#if BP_MPOOL_MIN_USER_BLOCK_SIZE < 480
+#error "BP_MPOOL_MIN_USER_BLOCK_SIZE cannot be less than 480, the pool admin block needs it"
+#endif
+
+#if BPLIB_ROUTE_CACHE_SIZE <= 0 || (BPLIB_ROUTE_CACHE_SIZE & (BPLIB_ROUTE_CACHE_SIZE - 1)) != 0
+#error "BPLIB_ROUTE_CACHE_SIZE must be a power of two"
+#endif
+
+#if BPLIB_ROUTE_INTF_SLOT_BITS < 1 || BPLIB_ROUTE_INTF_SLOT_BITS > 16
+#error "BPLIB_ROUTE_INTF_SLOT_BITS must be from 1 to 16"
+#endif
+
+#if BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES > 255
+#error "BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES cannot be more than 255, the registry_index is one byte"
+#endif
+
+#if defined(BPLIB_STATIC_CONFIG) && BPLIB_STATIC_MAX_ROUTES < 1
+#error "BPLIB_STATIC_MAX_ROUTES must be at least 1"
+#endif
+
+#endif /* BPLIB_CONFIG_H */
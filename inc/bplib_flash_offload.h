@@ -0,0 +1,81 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_FLASH_OFFLOAD_H
+#define BPLIB_FLASH_OFFLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * The flash device under the module, which is passed as the init_arg when it is registered
+ * and copied, so it need not outlive the call.  Pages are always read and programmed whole,
+ * each page is programmed at most once between erases of its block, and the pages of a block
+ * are programmed in order, so this can sit directly on a NAND part.
+ *
+ * Each function returns BP_SUCCESS or BP_ERROR and is given arg as it is here.  A block that
+ * fails to erase or program is not used again until the next start, and isbad (which may be
+ * NULL) is asked about each block at start so that factory marked ones are never touched.
+ */
+typedef struct bplib_flash_driver
+{
+    uint32_t num_blocks;      /**< erase blocks on the device, at least 3 */
+    uint32_t pages_per_block; /**< pages in each erase block */
+    uint32_t page_size;       /**< bytes in each page, a multiple of 8 */
+    void    *arg;
+
+    int (*read)(void *arg, uint32_t block, uint32_t page, void *buf);
+    int (*program)(void *arg, uint32_t block, uint32_t page, const void *buf);
+    int (*erase)(void *arg, uint32_t block);
+    bool (*isbad)(void *arg, uint32_t block);
+
+} bplib_flash_driver_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * Stores bundles as a log on raw flash.  Records are appended across the pages of one erase
+ * block at a time, and a released bundle is marked by appending a small entry rather than by
+ * writing over it.  The space of released bundles is taken back by copying what is still held
+ * out of the block with the least of it and erasing that block.  The index of what is where
+ * is kept in memory, and built again at start by reading every block.
+ */
+extern const bplib_cache_module_api_t *BPLIB_FLASH_OFFLOAD_API;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_FLASH_OFFLOAD_H */
@@ -0,0 +1,61 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_PACKED_OFFLOAD_H
+#define BPLIB_PACKED_OFFLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * Keeps offloaded bundles in memory, but only as their encoded form plus the tracking data of
+ * the primary block, in as few CBOR data blocks as that fits in.  The primary and canonical
+ * blocks are returned to the pool, and are decoded again from the encoded form when the bundle
+ * is restored, the extension blocks only when they are used.  For a bundle with a few blocks
+ * this is a fraction of the pool blocks it takes when kept as it is.
+ *
+ * Nothing is written out, so this does not make bundles durable, and there is nothing to recover.
+ * The cache does not take custody of a bundle by offloading it here, it only offloads the idle
+ * bundles it would otherwise shed when the pool runs short, see bplib_create_ram_storage().
+ */
+extern const bplib_cache_module_api_t *BPLIB_PACKED_OFFLOAD_API;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_PACKED_OFFLOAD_H */
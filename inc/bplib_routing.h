@@ -32,12 +32,55 @@
 #define BPLIB_INTF_STATE_ADMIN_UP 0x01
 #define BPLIB_INTF_STATE_OPER_UP  0x02
 
+/* Options for the memory backing the route table, for bplib_route_alloc_table_ext() */
+#define BPLIB_ROUTE_MEM_HUGEPAGE  0x01 /* use huge pages, if the OS supports it */
+#define BPLIB_ROUTE_MEM_LOCKED    0x02 /* lock the memory into RAM, for deterministic latency */
+#define BPLIB_ROUTE_MEM_LAZY_INIT 0x04 /* set up pool blocks on first use, rather than all at startup */
+
+/* Options for a route, for bplib_route_add_ext() */
+#define BPLIB_ROUTE_FLAG_MULTIPATH  0x01 /* spread flows over all up routes with the same dest and mask */
+#define BPLIB_ROUTE_FLAG_LOAD_AWARE 0x02 /* for multipath, pass over paths whose egress queue is above high watermark */
+
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
 
 typedef int (*bplib_route_action_func_t)(bplib_routetbl_t *tbl, bplib_mpool_ref_t ref, void *arg);
 
+/**
+ * @brief One route of a whole route set, for bplib_route_replace_all()
+ */
+typedef struct bplib_route_spec
+{
+    bp_ipn_t    dest;
+    bp_ipn_t    mask;
+    bp_handle_t intf_id;
+    uint32_t    flags; /**< BPLIB_ROUTE_FLAG_xxx, as for bplib_route_add_ext() */
+} bplib_route_spec_t;
+
+/**
+ * @brief One scheduled contact of the contact plan, for bplib_route_contact_add()
+ *
+ * The route from dest/mask to intf_id is put in the table at start_time and taken out again at
+ * end_time, both DTN times in ms.  Interfaces with the BPLIB_MPOOL_FLOW_FLAGS_CONTACTS flag get
+ * a poll event lead_time ms before the start and again at the start, see bplib_route_contact_scan().
+ */
+typedef struct bplib_route_contact
+{
+    bp_ipn_t    dest;
+    bp_ipn_t    mask;
+    bp_handle_t intf_id; /**< the next hop */
+    uint64_t    start_time;
+    uint64_t    end_time;
+    uint32_t    rate;      /**< expected rate of the link in bytes per second, 0 if not known */
+    uint32_t    lead_time; /**< how long before start_time the contact is announced, in ms */
+} bplib_route_contact_t;
+
+/**
+ * @brief Called by bplib_route_contact_scan() once when a contact is announced, and once when it starts
+ */
+typedef void (*bplib_route_contact_func_t)(void *arg, const bplib_route_contact_t *contact, bool is_start);
+
 /******************************************************************************
  LOCAL FUNCTIONS
  ******************************************************************************/
@@ -47,12 +90,16 @@ typedef int (*bplib_route_action_func_t)(bplib_routetbl_t *tbl, bplib_mpool_ref_
  ******************************************************************************/
 
 bplib_routetbl_t *bplib_route_alloc_table(uint32_t max_routes, size_t cache_mem_size);
+bplib_routetbl_t *bplib_route_alloc_table_ext(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags);
+bplib_routetbl_t *bplib_route_alloc_table_partitioned(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags,
+                                                      uint32_t num_partitions);
 bplib_mpool_t    *bplib_route_get_mpool(const bplib_routetbl_t *tbl);
 
 bp_handle_t bplib_route_register_generic_intf(bplib_routetbl_t *tbl, bp_handle_t parent_intf_id,
                                               bplib_mpool_block_t *flow_block);
 
 void bplib_route_ingress_route_single_bundle(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk);
+bool bplib_route_ingress_cut_through(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk);
 int  bplib_route_ingress_baseintf_forwarder(void *arg, bplib_mpool_block_t *subq_src);
 int  bplib_route_ingress_to_parent(void *arg, bplib_mpool_block_t *subq_src);
 
@@ -69,12 +116,27 @@ int bplib_route_register_event_handler(bplib_routetbl_t *tbl, bp_handle_t intf_i
 int         bplib_route_del_intf(bplib_routetbl_t *tbl, bp_handle_t intf_id);
 bp_handle_t bplib_route_get_next_intf_with_flags(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t req_flags,
                                                  uint32_t flag_mask);
+bp_handle_t bplib_route_get_next_intf_for_flow(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t flow_hash,
+                                               uint32_t req_flags, uint32_t flag_mask);
 bp_handle_t bplib_route_get_next_avail_intf(const bplib_routetbl_t *tbl, bp_ipn_t dest);
 int         bplib_route_add(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id);
+int         bplib_route_add_ext(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id,
+                                uint32_t route_flags);
 int         bplib_route_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id);
+int         bplib_route_replace_all(bplib_routetbl_t *tbl, const bplib_route_spec_t *routes, uint32_t route_count);
 
 int bplib_route_intf_set_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint32_t flags);
 int bplib_route_intf_unset_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint32_t flags);
+int bplib_route_intf_set_poll_time(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint64_t poll_time);
+
+int      bplib_route_contact_add(bplib_routetbl_t *tbl, const bplib_route_contact_t *contact);
+int      bplib_route_contact_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id,
+                                 uint64_t start_time);
+int      bplib_route_contact_lookup(bplib_routetbl_t *tbl, bp_ipn_t dest, uint64_t dtntime,
+                                    bplib_route_contact_t *contact);
+uint64_t bplib_route_contact_scan(bplib_routetbl_t *tbl, uint64_t after_time, uint64_t until_time,
+                                  bplib_route_contact_func_t func, void *arg);
+void     bplib_route_do_contact_plan(bplib_routetbl_t *tbl);
 
 int bplib_route_push_ingress_bundle(const bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *cb);
 int bplib_route_push_egress_bundle(const bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *cb);
@@ -84,8 +146,17 @@ int bplib_route_forward_baseintf_bundle(bplib_mpool_block_t *flow_block, void *f
 void bplib_route_set_maintenance_request(bplib_routetbl_t *tbl);
 void bplib_route_maintenance_request_wait(bplib_routetbl_t *tbl);
 void bplib_route_maintenance_complete_wait(bplib_routetbl_t *tbl);
+void bplib_route_wait_until(bplib_routetbl_t *tbl, uint64_t until_dtntime);
 
 void bplib_route_process_active_flows(bplib_routetbl_t *tbl);
+void bplib_route_worker_process_flows(bplib_routetbl_t *tbl, uint32_t timeout_ms);
 void bplib_route_periodic_maintenance(bplib_routetbl_t *tbl);
 
+/*
+ * Each periodic maintenance inspects this many blocks of the pool, 0 stops the inspection.  The result
+ * is from the last complete pass, see bplib_mpool_inspect_step().
+ */
+void bplib_route_set_pool_inspect_budget(bplib_routetbl_t *tbl, uint32_t blocks_per_cycle);
+void bplib_route_get_pool_inspection(bplib_routetbl_t *tbl, bplib_mpool_inspection_t *result);
+
 #endif
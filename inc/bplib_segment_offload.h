@@ -0,0 +1,55 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_SEGMENT_OFFLOAD_H
+#define BPLIB_SEGMENT_OFFLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * Stores bundles as records appended to a small number of large, preallocated segment files
+ * under the base directory, rather than one file per bundle.  A segment is reused once every
+ * bundle in it has been released.
+ */
+extern const bplib_cache_module_api_t *BPLIB_SEGMENT_OFFLOAD_API;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_SEGMENT_OFFLOAD_H */
@@ -0,0 +1,247 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_SHM_TRANSPORT_H
+#define BPLIB_SHM_TRANSPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* Options for bplib_shm_transport_config_t.flags */
+#define BPLIB_SHM_TRANSPORT_NO_THREAD 0x01 /* no thread, the node calls bplib_shm_transport_process() */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef struct bplib_shm_transport bplib_shm_transport_t; /* the node side */
+typedef struct bplib_shm_client    bplib_shm_client_t;    /* the application side */
+
+typedef struct bplib_shm_transport_config
+{
+    /*
+     * The rings are kept in the file at path, which should be on a tmpfs such as /dev/shm, and
+     * the doorbells are the FIFOs at path with ".sq" and ".dq" added.  All three are made by
+     * bplib_shm_transport_create(), replacing any that are there, and removed again when it is
+     * destroyed.  There is one set for each application process.
+     */
+    const char *path;
+
+    bp_ipn_addr_t local_addr;  /**< the service that the application sends from and receives at */
+    bp_ipn_addr_t remote_addr; /**< where the ADUs from the application are sent */
+
+    uint32_t flags;            /**< BPLIB_SHM_TRANSPORT_* flags */
+    uint32_t slot_count;       /**< entries in each ring, a power of two, 0 for the default of 256 */
+    size_t   max_payload_size; /**< largest ADU or bundle in one entry, 0 for the default of 4096 */
+
+} bplib_shm_transport_config_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * @brief Creates the node side of a shared memory transport for one application process
+ *
+ * A pair of rings is made in a shared file: one that the application puts ADUs and complete
+ * bundles into, and one that the node puts the ADUs delivered to local_addr into.  Each ring
+ * has room for slot_count entries of up to max_payload_size bytes, and has a single producer
+ * and a single consumer, so neither side takes a lock.  The doorbell of a ring is only rung
+ * when its consumer has said it is about to sleep, so while both sides are busy nothing is
+ * passed through the kernel at all.
+ *
+ * ADUs are sent with bplib_send_many() on a socket bound to local_addr and connected to
+ * remote_addr, which is when they are copied into the pool.  Bundles are passed to
+ * bplib_cla_ingress_batch() on a CLA interface of their own, see bplib_shm_transport_get_intf();
+ * that interface is only for ingress, nothing should be routed to it.  Delivered ADUs are
+ * received with bplib_recv_many() straight into the entries of the delivery ring.  When
+ * either the pool or the delivery ring is full, the entries wait where they are.
+ *
+ * @param rtbl Routing table instance
+ * @param config Paths, addresses and options
+ * @returns the new transport, or NULL if it could not be created
+ */
+bplib_shm_transport_t *bplib_shm_transport_create(bplib_routetbl_t *rtbl, const bplib_shm_transport_config_t *config);
+
+/**
+ * @brief Stops a transport, closes its socket and interface, and removes its files
+ *
+ * An application that still has the rings open sees this as BP_ERROR from its next call.
+ *
+ * @param shm The transport from bplib_shm_transport_create()
+ */
+void bplib_shm_transport_destroy(bplib_shm_transport_t *shm);
+
+/**
+ * @brief Gets the CLA interface which the bundles from the application come in through
+ *
+ * @param shm The transport from bplib_shm_transport_create()
+ * @returns the bp_handle_t of the interface
+ */
+bp_handle_t bplib_shm_transport_get_intf(const bplib_shm_transport_t *shm);
+
+/**
+ * @brief Moves whatever is ready, in both directions
+ *
+ * This is what the thread of the transport calls over and over, so it is only for use with
+ * BPLIB_SHM_TRANSPORT_NO_THREAD.  It waits up to the timeout for there to be something to do.
+ *
+ * @param shm The transport from bplib_shm_transport_create()
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if something was done
+ * @retval BP_TIMEOUT if there was nothing to do
+ */
+int bplib_shm_transport_process(bplib_shm_transport_t *shm, uint32_t timeout);
+
+/**
+ * @brief Opens the rings of a transport from the application process
+ *
+ * This does not need the library to be initialized, only the file made by
+ * bplib_shm_transport_create() in the node process.  The calls on one client are not
+ * safe to make from more than one thread at a time, as each ring has a single producer
+ * and a single consumer.
+ *
+ * @param path The path that the transport was created with
+ * @returns the client, or NULL if the rings could not be opened
+ */
+bplib_shm_client_t *bplib_shm_client_open(const char *path);
+
+/**
+ * @brief Closes the rings, anything still in them stays there for the node
+ *
+ * @param client The client from bplib_shm_client_open()
+ */
+void bplib_shm_client_close(bplib_shm_client_t *client);
+
+/**
+ * @brief Gets the next free entry of the submit ring, to build an ADU or bundle in place
+ *
+ * The entry is not passed on until bplib_shm_client_commit() is called.  Calling this again
+ * before that gives the same entry.  If the ring is full this checks again every ms until
+ * the timeout.
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @param[out] buffer Set to the start of the entry
+ * @param[out] size Set to the size of the entry, which is the max_payload_size of the transport
+ *                  rounded up so that each entry is a whole number of cache lines
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if successful
+ * @retval BP_TIMEOUT if the ring stayed full
+ * @retval BP_ERROR if the transport has been destroyed
+ */
+int bplib_shm_client_reserve(bplib_shm_client_t *client, void **buffer, size_t *size, uint32_t timeout);
+
+/**
+ * @brief Passes on the entry from bplib_shm_client_reserve()
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @param size Size of the ADU or bundle in the entry
+ * @param is_bundle true if the entry holds a complete encoded bundle rather than an ADU
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_shm_client_commit(bplib_shm_client_t *client, size_t size, bool is_bundle);
+
+/**
+ * @brief Copies an ADU into the submit ring, the same as reserve, copy and commit
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @param payload Pointer to the ADU
+ * @param size Size of the ADU
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_shm_client_send(bplib_shm_client_t *client, const void *payload, size_t size, uint32_t timeout);
+
+/**
+ * @brief Copies a complete encoded bundle into the submit ring
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @param bundle Pointer to the bundle
+ * @param size Size of the bundle
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_shm_client_send_bundle(bplib_shm_client_t *client, const void *bundle, size_t size, uint32_t timeout);
+
+/**
+ * @brief Gets the next delivered ADU where it is in the delivery ring
+ *
+ * The entry is held until bplib_shm_client_recv_release() is called.  Calling this again
+ * before that gives the same entry.
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @param[out] payload Set to the start of the ADU
+ * @param[out] size Set to the size of the ADU
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if successful
+ * @retval BP_TIMEOUT if nothing was delivered in time
+ * @retval BP_ERROR if the transport has been destroyed
+ */
+int bplib_shm_client_recv_view(bplib_shm_client_t *client, const void **payload, size_t *size, uint32_t timeout);
+
+/**
+ * @brief Gives the entry from bplib_shm_client_recv_view() back to the node
+ *
+ * @param client The client from bplib_shm_client_open()
+ */
+void bplib_shm_client_recv_release(bplib_shm_client_t *client);
+
+/**
+ * @brief Copies the next delivered ADU out of the delivery ring
+ *
+ * As with bplib_recv(), an ADU that does not fit in the buffer is dropped.
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @param payload Pointer to the buffer
+ * @param[inout] size Size of the buffer on input, size of the ADU on output
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if successful
+ */
+int bplib_shm_client_recv(bplib_shm_client_t *client, void *payload, size_t *size, uint32_t timeout);
+
+/**
+ * @brief Gets a file descriptor which is readable when the delivery doorbell has been rung
+ *
+ * For an application with its own event loop.  The doorbell is only rung after a call to
+ * bplib_shm_client_recv_view() or bplib_shm_client_recv() found the ring empty, so keep
+ * receiving until one of them returns BP_TIMEOUT (a timeout of 0 is fine) before waiting.
+ *
+ * @param client The client from bplib_shm_client_open()
+ * @returns file descriptor
+ */
+int bplib_shm_client_get_fd(const bplib_shm_client_t *client);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_SHM_TRANSPORT_H */
@@ -0,0 +1,152 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_SOCKET_CLA_H
+#define BPLIB_SOCKET_CLA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <sys/socket.h>
+
+#include "bplib.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* Options for bplib_socket_cla_config_t.flags */
+#define BPLIB_SOCKET_CLA_NO_THREAD 0x01 /* no I/O thread, the application calls bplib_socket_cla_process() */
+#define BPLIB_SOCKET_CLA_UDP_GSO   0x02 /* send runs of equal size bundles as one UDP segmentation offload */
+#define BPLIB_SOCKET_CLA_UDP_GRO   0x04 /* receive datagrams coalesced by UDP generic receive offload */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef struct bplib_socket_cla bplib_socket_cla_t;
+
+typedef struct bplib_socket_cla_config
+{
+    /*
+     * For UDP the local address is bound and bundles are sent to the remote address.  For TCP the
+     * connection is made to the remote address if there is one, and kept up; otherwise one is
+     * accepted at the local address, one at a time.  Either address can be IPv4 or IPv6.
+     */
+    const struct sockaddr *local_addr;
+    socklen_t              local_addr_len;
+    const struct sockaddr *remote_addr;
+    socklen_t              remote_addr_len;
+
+    uint32_t intf_flags;      /**< BPLIB_CLA_INTF_* flags, passed to bplib_create_cla_intf_ext() */
+    uint32_t flags;           /**< BPLIB_SOCKET_CLA_* flags */
+    uint32_t batch_size;      /**< most bundles moved each way in one system call, 0 for the default of 32 */
+    size_t   max_bundle_size; /**< largest bundle sent or received, 0 for the default of 65507 */
+
+} bplib_socket_cla_config_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * @brief Creates a CLA interface which carries each bundle in a UDP datagram
+ *
+ * Datagrams are received with recvmmsg() and passed to bplib_cla_ingress_batch(), and bundles
+ * from bplib_cla_egress_batch() go out with sendmmsg().  With BPLIB_SOCKET_CLA_UDP_GSO a run of
+ * bundles of the same size goes to the kernel as one large send, and with BPLIB_SOCKET_CLA_UDP_GRO
+ * datagrams may come in coalesced the same way.  Either one is quietly left off where the system
+ * does not have it.  A bundle that does not fit in a datagram is dropped.
+ *
+ * The interface is set up and running once this returns, but the application still has to
+ * add the routes that go to it with bplib_route_add().
+ *
+ * @param rtbl Routing table instance
+ * @param config Addresses and options
+ * @returns the new CLA, or NULL if it could not be created
+ */
+bplib_socket_cla_t *bplib_udp_cla_create(bplib_routetbl_t *rtbl, const bplib_socket_cla_config_t *config);
+
+/**
+ * @brief Creates a CLA interface which carries bundles over a TCP connection
+ *
+ * Each bundle is sent as a 4 byte length in network byte order followed by the bundle, written
+ * straight from pool memory with bplib_cla_egress_iov() and writev().  The interface is only
+ * operationally up while connected, so bundles for it wait in the queue in the meantime.  A
+ * connection that sends a length larger than max_bundle_size is closed.
+ *
+ * @param rtbl Routing table instance
+ * @param config Addresses and options
+ * @returns the new CLA, or NULL if it could not be created
+ */
+bplib_socket_cla_t *bplib_tcp_cla_create(bplib_routetbl_t *rtbl, const bplib_socket_cla_config_t *config);
+
+/**
+ * @brief Stops a CLA and deletes its interface
+ *
+ * @param cla The CLA from bplib_udp_cla_create() or bplib_tcp_cla_create()
+ */
+void bplib_socket_cla_destroy(bplib_socket_cla_t *cla);
+
+/**
+ * @brief Gets the interface of a CLA, to add routes to
+ *
+ * @param cla The CLA from bplib_udp_cla_create() or bplib_tcp_cla_create()
+ * @returns the bp_handle_t of the CLA interface
+ */
+bp_handle_t bplib_socket_cla_get_intf(const bplib_socket_cla_t *cla);
+
+/**
+ * @brief Gets the socket which the CLA is waiting on
+ *
+ * For an application that has its own event loop, with BPLIB_SOCKET_CLA_NO_THREAD.  When either
+ * this or the bplib_cla_get_notify_fd() of the interface is readable, or when this is writable
+ * while a TCP connection is being made, bplib_socket_cla_process() has something to do.  For TCP
+ * the socket changes as connections come and go, so this should be checked again after each call.
+ *
+ * @param cla The CLA from bplib_udp_cla_create() or bplib_tcp_cla_create()
+ * @returns file descriptor, or -1 if there is none at the moment
+ */
+int bplib_socket_cla_get_fd(const bplib_socket_cla_t *cla);
+
+/**
+ * @brief Moves whatever bundles are ready, in both directions
+ *
+ * This is what the I/O thread of the CLA calls over and over, so it is only for use with
+ * BPLIB_SOCKET_CLA_NO_THREAD.  It waits up to the timeout for there to be something to do.
+ *
+ * @param cla The CLA from bplib_udp_cla_create() or bplib_tcp_cla_create()
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if something was done
+ * @retval BP_TIMEOUT if there was nothing to do
+ */
+int bplib_socket_cla_process(bplib_socket_cla_t *cla, uint32_t timeout);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_SOCKET_CLA_H */
@@ -0,0 +1,59 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_TIERED_OFFLOAD_H
+#define BPLIB_TIERED_OFFLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * Keeps the most recently offloaded or restored bundles in memory, up to the budget set by
+ * bplib_cache_confkey_offload_ram_budget, in front of another offload module which holds the
+ * rest.  The init_arg when registering this module is the API of that other module, such as
+ * BPLIB_SEGMENT_OFFLOAD_API, and every other key is passed on to it.
+ *
+ * A bundle is only written to the other module when it no longer fits in memory or when the
+ * cache needs it to be durable, so one released before then never goes there at all.
+ */
+extern const bplib_cache_module_api_t *BPLIB_TIERED_OFFLOAD_API;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_TIERED_OFFLOAD_H */
@@ -0,0 +1,152 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef BPLIB_XDP_CLA_H
+#define BPLIB_XDP_CLA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <netinet/in.h>
+
+#include "bplib.h"
+#include "bplib_api_types.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* Options for bplib_xdp_cla_config_t.flags */
+#define BPLIB_XDP_CLA_NO_THREAD 0x01 /* no I/O thread, the application calls bplib_xdp_cla_process() */
+#define BPLIB_XDP_CLA_ZEROCOPY  0x02 /* fail rather than fall back to copy mode if the driver cannot do zero copy */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef struct bplib_xdp_cla bplib_xdp_cla_t;
+
+typedef struct bplib_xdp_cla_config
+{
+    const char *ifname;   /**< the network interface */
+    uint32_t    queue_id; /**< the receive queue of the interface that the socket is bound to */
+
+    /*
+     * Bundles are carried in UDP over IPv4.  Datagrams to the local address and port are taken in,
+     * others are not looked at.  Bundles are sent from the local address to the remote one, which
+     * can be left zero for an interface that only receives.  There is no ARP, so remote_mac is the
+     * next hop as it is on the wire.
+     */
+    struct sockaddr_in local_addr;
+    struct sockaddr_in remote_addr;
+    uint8_t            local_mac[6];
+    uint8_t            remote_mac[6];
+
+    /*
+     * The XSKMAP of the XDP program that redirects the datagrams to the socket, which the socket is
+     * put in at queue_id.  The application loads and attaches the program itself, and with -1 here
+     * it also puts the socket in the map itself, see bplib_xdp_cla_get_fd().
+     */
+    int xsk_map_fd;
+
+    uint32_t intf_flags;  /**< BPLIB_CLA_INTF_* flags, passed to bplib_create_cla_intf_ext() */
+    uint32_t flags;       /**< BPLIB_XDP_CLA_* flags */
+    uint32_t batch_size;  /**< most frames moved each way at a time, 0 for the default of 64 */
+    uint32_t frame_count; /**< frames in the UMEM, a power of two, 0 for the default of 4096 */
+    uint32_t frame_size;  /**< bytes per frame, 2048 or 4096, 0 for the default of 4096 */
+
+} bplib_xdp_cla_config_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * @brief Creates a CLA interface which carries each bundle in a UDP datagram over an AF_XDP socket
+ *
+ * This bypasses the network stack of the kernel: frames are taken straight from the receive ring
+ * of the socket and passed to bplib_cla_ingress_batch(), and bplib_cla_egress_batch() encodes the
+ * bundles straight into the frames of the transmit ring, behind Ethernet, IPv4 and UDP headers
+ * made here.  The UDP checksum is not set, and IP fragments are not taken in.
+ *
+ * Half of the UMEM frames are for receiving and half for sending.  A received bundle is copied
+ * into the pool once, so that the frame can go back to the fill ring at once, rather than being
+ * held for as long as the bundle is stored.  A bundle has to fit in one frame after the 42 bytes
+ * of headers, so the fragment MTU of the interface (bplib_variable_cla_fragment_mtu) is set to
+ * that, and larger bundles are fragmented on the way out.
+ *
+ * The interface is set up and running once this returns, but the application still has to
+ * add the routes that go to it with bplib_route_add().
+ *
+ * @param rtbl Routing table instance
+ * @param config Interface, addresses and options
+ * @returns the new CLA, or NULL if it could not be created
+ */
+bplib_xdp_cla_t *bplib_xdp_cla_create(bplib_routetbl_t *rtbl, const bplib_xdp_cla_config_t *config);
+
+/**
+ * @brief Stops a CLA and deletes its interface
+ *
+ * @param cla The CLA from bplib_xdp_cla_create()
+ */
+void bplib_xdp_cla_destroy(bplib_xdp_cla_t *cla);
+
+/**
+ * @brief Gets the interface of a CLA, to add routes to
+ *
+ * @param cla The CLA from bplib_xdp_cla_create()
+ * @returns the bp_handle_t of the CLA interface
+ */
+bp_handle_t bplib_xdp_cla_get_intf(const bplib_xdp_cla_t *cla);
+
+/**
+ * @brief Gets the AF_XDP socket of a CLA
+ *
+ * This is what goes in the XSKMAP of the XDP program, if the application puts it there itself.
+ * With BPLIB_XDP_CLA_NO_THREAD, when either this or the bplib_cla_get_notify_fd() of the
+ * interface is readable, bplib_xdp_cla_process() has something to do.
+ *
+ * @param cla The CLA from bplib_xdp_cla_create()
+ * @returns file descriptor
+ */
+int bplib_xdp_cla_get_fd(const bplib_xdp_cla_t *cla);
+
+/**
+ * @brief Moves whatever bundles are ready, in both directions
+ *
+ * This is what the I/O thread of the CLA calls over and over, so it is only for use with
+ * BPLIB_XDP_CLA_NO_THREAD.  It waits up to the timeout for there to be something to do.
+ *
+ * @param cla The CLA from bplib_xdp_cla_create()
+ * @param timeout Timeout in ms
+ * @retval BP_SUCCESS if something was done
+ * @retval BP_TIMEOUT if there was nothing to do
+ */
+int bplib_xdp_cla_process(bplib_xdp_cla_t *cla, uint32_t timeout);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* BPLIB_XDP_CLA_H */
@@ -41,4 +41,10 @@ bp_handle_t bplib_dataservice_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t
                                      bplib_mpool_ref_t blkref);
 bplib_mpool_ref_t bplib_dataservice_detach(bplib_routetbl_t *tbl, const bp_ipn_addr_t *ipn);
 
+/*
+ * Reports an event for the bplib_send_async() op that op_ref refers to, if any.  Each event
+ * is only reported the first time, so this is safe to call every time it happens.
+ */
+void bplib_dataservice_complete(bplib_mpool_ref_t op_ref, bplib_completion_event_t event);
+
 #endif /* BPLIB_DATASERVICE_H */
@@ -22,29 +22,207 @@
 #define V7_BASE_INTERNAL_H
 
 #include "bplib_api_types.h"
+#include "bplib_os.h"
 #include "v7_rbtree.h"
 #include "v7_types.h"
 #include "v7_mpool.h"
+#include "v7_codec.h"
+#include "bplib_dataservice.h"
 
 struct bp_socket
 {
     bplib_mpool_block_t fblk;
 };
 
-typedef struct bplib_cla_stats
+/*
+ * Token bucket for pacing CLA egress, the tokens are bytes.  A bundle can go out whenever there
+ * are tokens left, and takes its full size even if that leaves the bucket in debt.
+ */
+typedef struct bplib_cla_pacing
 {
-    uintmax_t ingress_byte_count;
-    uintmax_t egress_byte_count;
+    uint64_t rate;      /**< bytes per second, 0 if egress is not paced */
+    uint64_t burst;     /**< most tokens the bucket can hold, 0 to use one second of rate */
+    int64_t  tokens;    /**< current tokens, negative if the last bundle is still going out */
+    uint64_t update_ms; /**< DTN time the tokens were last brought up to date */
 
-} bplib_cla_stats_t;
+} bplib_cla_pacing_t;
 
-typedef struct bplib_route_serviceintf_info
+/*
+ * Packing of small bundles into larger CLA frames.  A frame is just the bundles back to back, which
+ * can be split again because every encoded bundle is a self-delimiting CBOR array.
+ */
+typedef struct bplib_cla_framing
 {
-    bp_ipn_t          node_number;
-    bplib_rbt_root_t  service_index;
-    bplib_mpool_ref_t storage_service;
+    uint64_t             mtu;      /**< largest frame to build on egress, 0 for one bundle per frame */
+    uint64_t             max_wait; /**< ms a frame is held open for more bundles after the first */
+    bplib_mpool_block_t *holdover; /**< bundle pulled for the last frame that did not fit, goes first in the next */
 
-} bplib_route_serviceintf_info_t;
+} bplib_cla_framing_t;
+
+/*
+ * Fragmentation of bundles too big for the CLA on egress, and reassembly of fragments on ingress.
+ * This is a separate generic block, made the first time any of it is configured, because the flow
+ * block does not have room for it.  The reassembly state is used by both the ingress forwarder and
+ * the poll event, so it has a lock.
+ */
+typedef struct bplib_cla_fragmentation
+{
+    bplib_mpool_block_t *self_ptr;
+    bplib_routetbl_t    *parent_rtbl;
+    uint64_t             mtu;        /**< largest bundle to send whole on egress, 0 to never fragment */
+    uint64_t             mem_limit;  /**< most payload bytes to hold for reassembly, 0 to pass fragments on */
+    uint64_t             max_wait;   /**< ms from the first fragment to give up on a bundle, 0 for its lifetime */
+    bp_handle_t          lock;       /**< protects the reassembly state, and the settings as they change */
+    size_t               held_bytes; /**< payload bytes in all the fragments held */
+    uint64_t             poll_time;  /**< deadline registered with the route table */
+    bplib_rbt_root_t     adu_index;  /**< bplib_cla_reassembly_t by a hash of the bundle id */
+    bplib_rbt_root_t     time_index; /**< bplib_cla_reassembly_t by the time to give up on it */
+
+    uint32_t fragmented;      /**< bundles which went out here as fragments */
+    uint32_t reassembled;     /**< bundles put back together from fragments which came in here */
+    uint32_t drop_reassembly; /**< fragmented bundles given up on, for lack of time or memory */
+
+} bplib_cla_fragmentation_t;
+
+/*
+ * Size of the duplicate filter of a CLA, see BPLIB_CLA_INTF_DEDUP.  The filter bits are kept in two
+ * generations, each cleared before it is reused, so a bundle is remembered for between one and two
+ * generations of BPLIB_CLA_DEDUP_GENERATION bundles.  The exact keys are direct mapped.
+ */
+#define BPLIB_CLA_DEDUP_GENERATION  2048
+#define BPLIB_CLA_DEDUP_FILTER_BITS 32768 /* in each generation, 16 for every bundle */
+#define BPLIB_CLA_DEDUP_PROBES      3
+#define BPLIB_CLA_DEDUP_EXACT_SLOTS 4096
+
+/*
+ * What makes a received bundle the same as another, the fragment offset only counts for fragments
+ */
+typedef struct bplib_cla_dedup_key
+{
+    bool                    valid;
+    bool                    is_fragment;
+    bp_ipn_addr_t           source;
+    bp_creation_timestamp_t creation;
+    bp_adu_length_t         fragment_offset;
+
+} bplib_cla_dedup_key_t;
+
+/*
+ * Recently received bundles, so a duplicate can be dropped as soon as it is decoded.  A match in the
+ * filter bits is only taken as a duplicate if the exact key is still there, so a false positive in
+ * the filter, or a key that was overwritten, lets the bundle through.  This is allocated from the heap
+ * as it is too big for a pool block, and has a lock because bplib_cla_ingress() may be called from
+ * more than one thread.
+ */
+typedef struct bplib_cla_dedup
+{
+    bp_handle_t           lock;
+    uint32_t              current;          /**< generation of filter bits that bundles are put in */
+    uint32_t              generation_count; /**< bundles put in the current generation so far */
+    uint64_t              filter[2][BPLIB_CLA_DEDUP_FILTER_BITS / 64];
+    bplib_cla_dedup_key_t exact[BPLIB_CLA_DEDUP_EXACT_SLOTS];
+
+} bplib_cla_dedup_t;
+
+/*
+ * One bundle being put back together on ingress.  The fragments are indexed by their offset in the
+ * ADU, so finding the place of each one and checking for the whole ADU do not need a list scan.
+ */
+typedef struct bplib_cla_reassembly
+{
+    bplib_rbt_link_t        hash_rbt_link; /**< in adu_index, must be first */
+    bplib_rbt_link_t        time_rbt_link; /**< in time_index */
+    bplib_rbt_root_t        fragment_index;
+    bplib_mpool_block_t    *self_ptr;
+    bp_ipn_addr_t           source;
+    bp_creation_timestamp_t creation;
+    bp_adu_length_t         total_length;
+    size_t                  held_bytes; /**< payload bytes in the fragments of this bundle, overlaps count twice */
+
+} bplib_cla_reassembly_t;
+
+typedef struct bplib_cla_fragment
+{
+    bplib_rbt_link_t     rbt_link; /**< in fragment_index of the bundle, by offset, must be first */
+    bplib_mpool_block_t *self_ptr;
+    bplib_mpool_ref_t    bundle_ref;
+    size_t               length; /**< payload bytes in this fragment */
+
+} bplib_cla_fragment_t;
+
+/*
+ * A bundle being received a piece at a time, see bplib_cla_ingress_begin()
+ */
+typedef struct bplib_cla_ingress_stream
+{
+    bp_handle_t          intf_id;
+    bplib_mpool_block_t *pblk;      /**< the bundle being decoded, until bplib_cla_ingress_end() takes it */
+    bplib_mpool_block_t *stage_blk; /**< CBOR data block that each block is collected in */
+    v7_stream_import_t   import;
+
+} bplib_cla_ingress_stream_t;
+
+/*
+ * A bundle being sent a piece at a time, see bplib_cla_egress_begin()
+ */
+typedef struct bplib_cla_egress_stream
+{
+    bplib_mpool_ref_t  bundle_ref; /**< keeps the bundle until the stream is ended */
+    v7_stream_export_t export;
+
+} bplib_cla_egress_stream_t;
+
+/*
+ * Event counters kept for each CLA interface.  These are only ever changed with relaxed atomic adds,
+ * so they can be updated from any thread without a lock, and read through bplib_query_integer().
+ */
+typedef enum bplib_cla_counter
+{
+    bplib_cla_counter_ingress_bundles,  /**< bundles which came in here */
+    bplib_cla_counter_egress_bundles,   /**< bundles which went out here */
+    bplib_cla_counter_drop_no_route,    /**< came in here, but there was nowhere to send it */
+    bplib_cla_counter_drop_queue_full,  /**< the ingress or egress queue of this intf did not take it */
+    bplib_cla_counter_drop_decode,      /**< came in here, but did not decode */
+    bplib_cla_counter_drop_expired,     /**< its lifetime was over before it could go out here */
+    bplib_cla_counter_queue_time_10ms,  /**< went out here less than 10ms after arriving at this node */
+    bplib_cla_counter_queue_time_100ms, /**< went out here less than 100ms after arriving at this node */
+    bplib_cla_counter_queue_time_1s,    /**< went out here less than 1s after arriving at this node */
+    bplib_cla_counter_queue_time_long,  /**< went out here 1s or more after arriving at this node */
+    bplib_cla_counter_drop_duplicate,   /**< came in here, but was received here recently already */
+    bplib_cla_counter_max               /**< reserved value, keep last */
+} bplib_cla_counter_t;
+
+/*
+ * Moving average of the byte rates.  It is brought up to date about once a BPLIB_CLA_RATE_SAMPLE_MS,
+ * by whichever thread manages to move sample_ms on, so only one thread ever writes the rest.
+ */
+typedef struct bplib_cla_rate_ewma
+{
+    uint64_t  sample_ms;      /**< DTN time of the last sample */
+    uintmax_t ingress_sample; /**< ingress_byte_count at the last sample */
+    uintmax_t egress_sample;  /**< egress_byte_count at the last sample */
+    uint32_t  ingress_rate;   /**< bytes per second */
+    uint32_t  egress_rate;    /**< bytes per second */
+
+} bplib_cla_rate_ewma_t;
+
+typedef struct bplib_cla_stats
+{
+    uintmax_t             ingress_byte_count;
+    uintmax_t             egress_byte_count;
+    uint32_t              counters[bplib_cla_counter_max];
+    bplib_cla_rate_ewma_t rate_ewma;
+    bplib_cla_pacing_t    egress_pacing;
+    bplib_cla_framing_t   framing;
+
+    bplib_cla_fragmentation_t *fragmentation; /**< NULL until configured, then kept until the intf goes away */
+    bplib_cla_dedup_t         *dedup;         /**< NULL unless made with BPLIB_CLA_INTF_DEDUP */
+
+    bool lazy_decode;  /**< extension blocks of bundles received here are decoded on first use */
+    bool defer_crc;    /**< block CRCs of bundles received here are checked when they are routed */
+    bool defer_decode; /**< bundles received here are decoded when they are routed */
+
+} bplib_cla_stats_t;
 
 typedef struct bplib_service_endpt bplib_service_endpt_t;
 
@@ -53,17 +231,144 @@ struct bplib_service_endpt
     bplib_rbt_link_t     rbt_link; /* for storage in RB tree, must be first */
     bplib_mpool_block_t *self_ptr;
     bplib_mpool_ref_t    subflow_ref;
+    bp_val_t             service_number; /* same as the RB tree key, for the hash lookup */
 };
 
+/*
+ * Number of entries in the service hash table, as a power of two
+ */
+#define BPLIB_SERVICE_HASH_BITS  5
+#define BPLIB_SERVICE_HASH_SLOTS (1U << BPLIB_SERVICE_HASH_BITS)
+
+/*
+ * Maximum number of endpoints kept in the hash table, so probe sequences stay short
+ */
+#define BPLIB_SERVICE_HASH_LIMIT ((3 * BPLIB_SERVICE_HASH_SLOTS) / 4)
+
+/**
+ * @brief Open addressing (linear probe) index of the endpoints on a base interface
+ *
+ * This is kept alongside the RB tree, which is still the authoritative index.  Endpoints
+ * that are added once the table is at its limit are only in the RB tree, and as long as
+ * there are any of those, a lookup that misses here goes on to search the RB tree.
+ */
+typedef struct bplib_service_hash
+{
+    bplib_mpool_block_t   *self_ptr;
+    uint32_t               count;    /**< number of endpoints in the slots */
+    uint32_t               overflow; /**< number of endpoints only in the RB tree */
+    bplib_service_endpt_t *slots[BPLIB_SERVICE_HASH_SLOTS];
+} bplib_service_hash_t;
+
+typedef struct bplib_route_serviceintf_info
+{
+    bp_ipn_t              node_number;
+    bplib_rbt_root_t      service_index;
+    bplib_mpool_ref_t     storage_service;
+    bplib_service_hash_t *service_hash; /**< NULL if it could not be allocated, then only the RB tree is used */
+
+} bplib_route_serviceintf_info_t;
+
+/*
+ * Latency histograms of a socket, see bplib_socket_set_tracing().  This is a separate block so the
+ * bundles sent from the socket can hold a ref to it, and keep counting in it after the socket is gone.
+ * The counts are only ever changed with relaxed atomic adds, like the CLA counters.
+ */
+typedef struct bplib_socket_trace
+{
+    uint32_t latency[bplib_trace_stage_max][BPLIB_TRACE_LATENCY_BINS];
+
+    /* the sample ring, see bplib_socket_set_sampling(), NULL until sampling is first turned on */
+    bplib_os_mutex_t     *sample_lock;
+    bplib_trace_sample_t *samples;
+    uint32_t              sample_ring_size;
+    uint32_t              sample_next; /**< where the next one goes */
+    uint32_t              sample_held; /**< how many there are, ending just before sample_next */
+
+} bplib_socket_trace_t;
+
+/*
+ * The most completions one bundle sent with bplib_send_async() can have: sent, delivered, custody
+ * acked and taken, then the final one.  The queue is made with this many per bundle in flight, so it
+ * never fills.
+ */
+#define BPLIB_COMPLETIONS_PER_BUNDLE 5
+
+/*
+ * The completion queue of a socket, see bplib_socket_set_completions().  Like the trace block this is a
+ * separate block, held by each op in flight, so the completions can still be posted after the socket is gone.
+ */
+typedef struct bplib_socket_completions
+{
+    bplib_os_mutex_t   *lock;
+    bplib_completion_t *ring;
+    uint32_t            ring_size;
+    uint32_t            next;          /**< the oldest one not taken */
+    uint32_t            held;          /**< how many there are, from next on */
+    uint32_t            max_in_flight;
+    uint32_t            in_flight;     /**< ops sent whose final completion has not been taken */
+    bp_handle_t         notifier;      /**< made by bplib_socket_get_completion_fd(), set while any are held */
+
+} bplib_socket_completions_t;
+
+/*
+ * One bundle sent with bplib_send_async().  The bundle holds a ref to this, and so does the cache entry
+ * while the bundle is in custody, so the final completion is posted when the last of them lets go.
+ */
+typedef struct bplib_socket_async_op
+{
+    bplib_mpool_ref_t       cq_ref;   /**< bplib_socket_completions_t of the socket */
+    uint64_t                user_tag;
+    bplib_policy_delivery_t policy;   /**< of the socket when sent, which decides what counts as done */
+    uint32_t                events;   /**< bit for each bplib_completion_event_t posted so far */
+
+} bplib_socket_async_op_t;
+
+/*
+ * Each ADU packed into a bundle by a socket with coalescing on is this many bytes of length, big
+ * endian, and then the data.
+ */
+#define BPLIB_SOCKET_COALESCE_HDR_SIZE 4
+
+/*
+ * The ADUs of a socket waiting to be sent together, and the bundle being split back into ADUs on
+ * receive, see bplib_socket_set_coalescing().  This is allocated in one piece with the buffer after it.
+ */
+typedef struct bplib_socket_coalesce
+{
+    bplib_os_mutex_t *tx_lock;    /**< held while buf is changed or sent, by an app task or the poll */
+    bplib_os_mutex_t *rx_lock;    /**< held by bplib_recv() while splitting, including the wait for a bundle */
+    size_t            buf_size;   /**< as allocated, the most max_size can be */
+    size_t            max_size;   /**< 0 if coalescing is off */
+    uint32_t          max_delay;  /**< ms the first ADU may wait for others, 0 for no limit */
+    size_t            used;       /**< bytes in buf, 0 if nothing is pending */
+    uint64_t          first_time; /**< when the first ADU in buf was added */
+    bplib_mpool_ref_t rx_ref;     /**< the bundle being split, NULL for none */
+    size_t            rx_offset;  /**< where the next ADU in rx_ref starts, within the payload */
+    uint8_t          *buf;
+
+} bplib_socket_coalesce_t;
+
 typedef struct bplib_socket_info bplib_socket_info_t;
 struct bplib_socket_info
 {
-    bplib_routetbl_t   *parent_rtbl;
-    bp_handle_t         socket_intf_id;
-    bplib_connection_t  params;
-    uintmax_t           ingress_byte_count;
-    uintmax_t           egress_byte_count;
-    bp_sequencenumber_t last_bundle_seq;
+    bplib_routetbl_t        *parent_rtbl;
+    bp_handle_t              socket_intf_id;
+    bool                     nonblocking;       /**< set by bplib_socket_set_nonblocking() */
+    bool                     tracing;           /**< set by bplib_socket_set_tracing() */
+    bool                     local_skip_encode; /**< set by bplib_socket_set_local_skip_encode() */
+    bool                     egress_encode;     /**< set by bplib_socket_set_egress_encode() */
+    uint32_t                 sample_interval;   /**< set by bplib_socket_set_sampling(), 0 for none */
+    uint32_t                 sample_count;      /**< bundles sent and received, to pick the ones sampled */
+    bplib_connection_t       params;
+    uintmax_t                ingress_byte_count;
+    uintmax_t                egress_byte_count;
+    bp_sequencenumber_t      last_bundle_seq;
+    bplib_mpool_block_t     *pri_template_blk; /**< holds the template, kept until the socket is recycled */
+    bp_pri_template_t       *pri_template;     /**< made when connected, NULL for none, see bplib_connect_socket() */
+    bplib_mpool_ref_t        trace_ref;        /**< bplib_socket_trace_t, made when tracing or sampling is turned on */
+    bplib_mpool_ref_t        completions_ref;  /**< bplib_socket_completions_t, see bplib_socket_set_completions() */
+    bplib_socket_coalesce_t *coalesce;         /**< made by bplib_socket_set_coalescing(), NULL for none */
 };
 
 typedef struct bplib_routeentry
@@ -71,30 +376,187 @@ typedef struct bplib_routeentry
     bp_ipn_t    dest;
     bp_ipn_t    mask;
     bp_handle_t intf_id;
+    uint32_t    flags; /**< BPLIB_ROUTE_FLAG_xxx, from bplib_route_add_ext() */
 } bplib_routeentry_t;
 
-struct bplib_routetbl
+/**
+ * @brief A remembered result of bplib_route_get_next_intf_with_flags()
+ *
+ * The entry is only valid while its generation matches route_generation in the table,
+ * which changes whenever a route or an interface state flag is changed.
+ */
+typedef struct bplib_routecache_entry
+{
+    bp_ipn_t    dest;
+    uint32_t    flow_hash;
+    uint32_t    req_flags;
+    uint32_t    flag_mask;
+    uint32_t    generation;
+    bp_handle_t intf_id;
+} bplib_routecache_entry_t;
+
+/* Number of entries in the interface slot table, see BPLIB_ROUTE_INTF_SLOT_BITS in bplib_config.h */
+#define BPLIB_ROUTE_INTF_SLOTS (1U << BPLIB_ROUTE_INTF_SLOT_BITS)
+
+/**
+ * @brief Direct lookup of a registered interface by its handle
+ *
+ * The slot is selected by a hash of the handle serial number and is only a match if
+ * intf_id is the complete handle, so a slot reused by a later interface can never be mistaken
+ * for the one that was there before.  Interfaces that map to a slot already in use are found
+ * through the pool instead, as before.
+ */
+typedef struct bplib_route_intfslot
+{
+    bp_handle_t          intf_id;
+    bplib_mpool_block_t *flow_block;
+    bplib_mpool_flow_t  *flow;
+} bplib_route_intfslot_t;
+
+/**
+ * @brief One entry of the contact plan, see bplib_route_contact_add()
+ *
+ * A slot is freed once its contact has ended, so the plan only holds the contacts still to come.
+ */
+typedef struct bplib_route_contactslot
 {
-    uint32_t            max_routes;
+    bplib_route_contact_t contact;
+    bool                  in_use;
+    bool                  active; /**< the route of the contact is in the table */
+} bplib_route_contactslot_t;
+
+/*
+ * Maximum number of distinct masks in the route table.  Masks must be contiguous
+ * from the MSB, so there is one possible mask per prefix length, including zero.
+ */
+#define BPLIB_ROUTE_MAX_LEVELS (1 + (8 * sizeof(bp_ipn_t)))
+
+/**
+ * @brief A group of routes in route_tbl that all use the same mask
+ *
+ * Levels are ordered from most to least specific mask, and within a level the routes are
+ * sorted by their masked dest, so a lookup is a binary search per distinct mask.
+ */
+typedef struct bplib_routelevel
+{
+    bp_ipn_t mask;
+    uint32_t start_pos;
+    uint32_t end_pos;
+} bplib_routelevel_t;
+
+/**
+ * @brief One published version of the routes in the table
+ *
+ * The table keeps two of these.  Lookups use whichever one is current without taking a lock,
+ * while a change is made in the other one, which then becomes current as a whole.
+ */
+typedef struct bplib_routeset
+{
+    uint32_t            reader_count; /**< lookups currently using this set */
     uint32_t            registered_routes;
-    bp_handle_t         activity_lock;
-    volatile bool       maint_request_flag;
-    volatile bool       maint_active_flag;
-    uint8_t             poll_count;
-    uint64_t            last_intf_poll;
-    uintmax_t           routing_success_count;
-    uintmax_t           routing_error_count;
-    bplib_mpool_t      *pool;
-    bplib_mpool_block_t flow_list;
-    bplib_routeentry_t *route_tbl;
+    uint32_t            num_levels;
+    bplib_routeentry_t *route_tbl; /**< max_routes entries */
+    bplib_routelevel_t  levels[BPLIB_ROUTE_MAX_LEVELS];
+} bplib_routeset_t;
+
+struct bplib_routetbl
+{
+    uint32_t                   max_routes;
+    bp_handle_t                activity_lock;
+    bp_handle_t                route_update_lock; /**< serializes changes to route_sets */
+    bp_handle_t                route_cache_lock; /**< only protects route_cache, never held while taking another lock */
+    bp_handle_t                contact_lock; /**< protects contacts, taken before any other lock, never after one */
+#ifdef BPLIB_LOCK_PROFILE
+    bplib_mpool_lock_hold_t    activity_hold;
+#endif
+    volatile uint32_t          route_generation; /**< changes on every route or intf flag change, see route_cache */
+    volatile bool              maint_request_flag;
+    volatile bool              maint_active_flag;
+    volatile uint32_t          maint_request_count; /**< changes on every request, for the flow workers */
+    uint64_t                   next_poll_time; /**< earliest poll_time of the flows in poll_list */
+    uint64_t                   next_contact_time; /**< earliest start or end in contacts */
+    uintmax_t                  routing_success_count;
+    uintmax_t                  routing_error_count;
+    bplib_mpool_t             *pool;
+    bplib_mpool_block_t        flow_list;
+    bplib_mpool_block_t        poll_list; /**< the flows with a poll_time, by their poll_link */
+    uint32_t                   route_set_idx; /**< which of route_sets is current */
+    bplib_routeset_t          *route_sets; /**< two sets, see bplib_routeset_t */
+    bplib_routecache_entry_t  *route_cache; /**< BPLIB_ROUTE_CACHE_SIZE entries, direct mapped by dest */
+    bplib_route_intfslot_t    *intf_slots; /**< BPLIB_ROUTE_INTF_SLOTS entries, direct mapped by handle */
+    bplib_route_contactslot_t *contacts; /**< BPLIB_ROUTE_MAX_CONTACTS entries, in no particular order */
+
+    /* only used by bplib_route_periodic_maintenance(), so it is out of the way at the end */
+    uint32_t                pool_inspect_budget; /**< blocks per maintenance cycle, 0 if the inspection is stopped */
+    bplib_mpool_inspector_t pool_inspector;
 };
 
+/*
+ * The metrics one subsystem reports, see bplib_metrics_snapshot().  Those of the table as a whole
+ * have no match function, the others are reported once for each intf in the flow_list it matches.
+ * The read function is called with the activity lock held for intf metrics, so it must not take it.
+ */
+typedef struct bplib_metric_group
+{
+    const bplib_metric_desc_t *descs;
+    uint32_t                   num_descs;
+    bool (*match)(bplib_mpool_block_t *flow_block);
+    void (*read)(bplib_routetbl_t *rtbl, bplib_mpool_block_t *flow_block, uint32_t idx, bplib_metric_t *metric);
+} bplib_metric_group_t;
+
+extern const bplib_metric_group_t BPLIB_MPOOL_METRICS;
+extern const bplib_metric_group_t BPLIB_ROUTE_METRICS;
+extern const bplib_metric_group_t BPLIB_CLA_METRICS;
+extern const bplib_metric_group_t BPLIB_SOCKET_METRICS;
+extern const bplib_metric_group_t BPLIB_STORAGE_METRICS;
+
+uint32_t bplib_route_collect_metrics(bplib_routetbl_t *tbl, const bplib_metric_group_t *const *groups,
+                                     uint32_t num_groups, bplib_metric_t *metrics, uint32_t max_metrics);
+
 int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src);
 int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src);
+int bplib_serviceflow_add_to_base(bplib_mpool_block_t *base_intf_blk, bp_val_t svc_num, bplib_dataservice_type_t type,
+                                  bplib_mpool_ref_t endpoint_intf_ref);
+bplib_mpool_ref_t bplib_serviceflow_remove_from_base(bplib_mpool_block_t *base_intf_blk, bp_val_t svc_num);
 int bplib_dataservice_event_impl(void *arg, bplib_mpool_block_t *intf_block);
 int bplib_dataservice_base_construct(void *arg, bplib_mpool_block_t *blk);
+int bplib_dataservice_base_destruct(void *arg, bplib_mpool_block_t *blk);
+int bplib_dataservice_socket_destruct(void *arg, bplib_mpool_block_t *sblk);
+int bplib_dataservice_trace_destruct(void *arg, bplib_mpool_block_t *tblk);
+int bplib_dataservice_cq_destruct(void *arg, bplib_mpool_block_t *cblk);
+int bplib_dataservice_async_op_destruct(void *arg, bplib_mpool_block_t *oblk);
+void bplib_serviceflow_trace_egress(bplib_mpool_bblock_primary_t *pri_block, uint64_t now);
+void bplib_serviceflow_coalesce_poll(bplib_mpool_block_t *intf_block);
+bool bplib_serviceflow_push_custody_ack(bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *pblk);
 int bplib_cla_event_impl(void *arg, bplib_mpool_block_t *intf_block);
+int bplib_cla_destruct_intf(void *arg, bplib_mpool_block_t *sblk);
+int bplib_cla_destruct_ingress_stream(void *arg, bplib_mpool_block_t *sblk);
+int bplib_cla_destruct_egress_stream(void *arg, bplib_mpool_block_t *sblk);
+void bplib_cla_count_drop(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_counter_t counter);
+int bplib_cla_query_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t *value);
+int bplib_cla_config_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t value);
+bool bplib_cla_is_intf(bplib_mpool_block_t *intf_block);
+int bplib_cla_push_egress_bundle(bplib_mpool_flow_t *flow, bplib_mpool_block_t *cb);
+bplib_mpool_block_t *bplib_cla_decode_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk);
+bplib_mpool_block_t *bplib_cla_verify_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk);
+bplib_mpool_block_t *bplib_cla_reassemble_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk);
 int bplib_generic_bundle_ingress(bplib_mpool_ref_t flow_ref, const void *content, size_t size, uint64_t time_limit);
+int bplib_generic_bundle_ingress_adopt(bplib_mpool_ref_t flow_ref, bplib_mpool_ref_t buffer_ref, size_t size,
+                                       uint64_t time_limit);
+int bplib_generic_bundle_ingress_stream(bplib_mpool_ref_t flow_ref, bplib_cla_ingress_stream_t *stream,
+                                        uint64_t time_limit);
+int bplib_generic_bundle_ingress_batch(bplib_mpool_ref_t flow_ref, const bplib_cla_bundle_buf_t *bundles,
+                                       uint32_t count, int *status_list, uint64_t time_limit);
+int bplib_generic_bundle_ingress_frame(bplib_mpool_ref_t flow_ref, const void *content, size_t size,
+                                       uint64_t time_limit);
 int bplib_generic_bundle_egress(bplib_mpool_ref_t flow_ref, void *content, size_t *size, uint64_t time_limit);
+int bplib_generic_bundle_egress_frame(bplib_mpool_ref_t flow_ref, bplib_cla_framing_t *framing, void *content,
+                                      size_t *size, uint64_t time_limit);
+int bplib_generic_bundle_egress_batch(bplib_mpool_ref_t flow_ref, bplib_cla_egress_buf_t *buffers, uint32_t count,
+                                      uint32_t *num_filled, uint64_t time_limit);
+int bplib_generic_bundle_egress_iov(bplib_mpool_ref_t flow_ref, bplib_iovec_t *iov, uint32_t *iov_count,
+                                    bplib_mpool_ref_t *bundle_ref, size_t *size, uint64_t time_limit);
+int bplib_generic_bundle_egress_stream(bplib_mpool_ref_t flow_ref, bplib_cla_egress_stream_t *stream, size_t *size,
+                                       uint64_t time_limit);
 
 #endif /* V7_BASE_INTERNAL_H*/
\ No newline at end of file
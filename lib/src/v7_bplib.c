@@ -27,11 +27,15 @@
 #include "crc.h"
 #include "v7.h"
 #include "v7_mpool.h"
+#include "v7_mpool_flows.h"
+#include "v7_mpool_ref.h"
 #include "v7_codec.h"
 #include "v7_cache.h"
 #include "bplib_routing.h"
 #include "bplib_dataservice.h"
 #include "bplib_file_offload.h"
+#include "bplib_packed_offload.h"
+#include "v7_base_internal.h"
 
 /******************************************************************************
  TYPEDEFS
@@ -43,10 +47,366 @@
  * are hidden from external entities.
  */
 
+/*
+ * Maps a bplib_variable_t to the memory pool statistic that holds its value
+ */
+typedef struct bplib_mpool_stat_variable
+{
+    bplib_variable_t   var_id;
+    bplib_mpool_stat_t stat;
+    uint32_t           index;
+} bplib_mpool_stat_variable_t;
+
+/* the largest node or service number */
+#define BPLIB_EID_NUMBER_MAX ((bp_ipn_t)-1)
+
+/* "ipn:" followed by two numbers of up to 20 digits, with a dot in between */
+#define BPLIB_EID_IPN_FORMAT_MAX 45
+
+/*
+ * The two digit decimal strings for 0 through 99, so numbers are formatted two digits at a time
+ */
+static const char BPLIB_EID_DIGIT_PAIRS[200] = "0001020304050607080910111213141516171819"
+                                                 "2021222324252627282930313233343536373839"
+                                                 "4041424344454647484950515253545556575859"
+                                                 "6061626364656667686970717273747576777879"
+                                                 "8081828384858687888990919293949596979899";
+
+/* upper limits of the bins of the memory pool time histograms */
+static const uint32_t BPLIB_LOCK_WAIT_BIN_LIMITS[] = {0, 10, 100, 1000};
+static const uint32_t BPLIB_JOB_TIME_BIN_LIMITS[]  = {100, 1000, 10000};
+
+static void bplib_read_mpool_metric(bplib_routetbl_t *rtbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                    bplib_metric_t *metric);
+
+/*
+ * The memory pool metrics, and in the same order the variable each is read from.  The bins
+ * of a histogram are read from that many variables in a row, starting with the one given.
+ */
+static const bplib_metric_desc_t BPLIB_MPOOL_METRIC_DESCS[] = {
+    {"mem_current_use", "bytes of the pool in use", bplib_metric_type_gauge, 0, NULL},
+    {"mem_high_use", "most bytes of the pool ever in use", bplib_metric_type_gauge, 0, NULL},
+    {"mem_collect_backlog", "blocks waiting for garbage collection", bplib_metric_type_gauge, 0, NULL},
+    {"mem_alloc_refused", "bundle allocations refused because memory was low", bplib_metric_type_counter, 0, NULL},
+    {"mem_free_depth_min", "lowest number of free blocks recently", bplib_metric_type_gauge, 0, NULL},
+    {"mem_free_depth_max", "highest number of free blocks recently", bplib_metric_type_gauge, 0, NULL},
+    {"mem_alloc_generic", "generic data blocks allocated", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_primary", "primary bundle blocks allocated", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_canonical", "canonical bundle blocks allocated", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_flow", "flow blocks allocated", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_ref", "reference blocks allocated", bplib_metric_type_counter, 0, NULL},
+    {"mem_free_generic", "generic data blocks freed", bplib_metric_type_counter, 0, NULL},
+    {"mem_free_primary", "primary bundle blocks freed", bplib_metric_type_counter, 0, NULL},
+    {"mem_free_canonical", "canonical bundle blocks freed", bplib_metric_type_counter, 0, NULL},
+    {"mem_free_flow", "flow blocks freed", bplib_metric_type_counter, 0, NULL},
+    {"mem_free_ref", "reference blocks freed", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_pri_lo", "blocks allocated at priority 0 to 63", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_pri_med", "blocks allocated at priority 64 to 127", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_pri_mhi", "blocks allocated at priority 128 to 191", bplib_metric_type_counter, 0, NULL},
+    {"mem_alloc_pri_hi", "blocks allocated at priority 192 to 255", bplib_metric_type_counter, 0, NULL},
+    {"lock_wait", "memory pool locks by time waited", bplib_metric_type_histogram, 5, BPLIB_LOCK_WAIT_BIN_LIMITS},
+    {"cache_wait", "cache jobs by time waited to run", bplib_metric_type_histogram, 4, BPLIB_JOB_TIME_BIN_LIMITS},
+    {"cache_run", "cache jobs by time run", bplib_metric_type_histogram, 4, BPLIB_JOB_TIME_BIN_LIMITS},
+    {"cla_wait", "CLA jobs by time waited to run", bplib_metric_type_histogram, 4, BPLIB_JOB_TIME_BIN_LIMITS},
+    {"cla_run", "CLA jobs by time run", bplib_metric_type_histogram, 4, BPLIB_JOB_TIME_BIN_LIMITS},
+    {"service_wait", "data service jobs by time waited to run", bplib_metric_type_histogram, 4,
+     BPLIB_JOB_TIME_BIN_LIMITS},
+    {"service_run", "data service jobs by time run", bplib_metric_type_histogram, 4, BPLIB_JOB_TIME_BIN_LIMITS}};
+
+static const bplib_variable_t BPLIB_MPOOL_METRIC_VARIABLES[] = {
+    bplib_variable_mem_current_use,    bplib_variable_mem_high_use,        bplib_variable_mem_collect_backlog,
+    bplib_variable_mem_alloc_refused,  bplib_variable_mem_free_depth_min,  bplib_variable_mem_free_depth_max,
+    bplib_variable_mem_alloc_generic,  bplib_variable_mem_alloc_primary,   bplib_variable_mem_alloc_canonical,
+    bplib_variable_mem_alloc_flow,     bplib_variable_mem_alloc_ref,       bplib_variable_mem_free_generic,
+    bplib_variable_mem_free_primary,   bplib_variable_mem_free_canonical,  bplib_variable_mem_free_flow,
+    bplib_variable_mem_free_ref,       bplib_variable_mem_alloc_pri_lo,    bplib_variable_mem_alloc_pri_med,
+    bplib_variable_mem_alloc_pri_mhi,  bplib_variable_mem_alloc_pri_hi,    bplib_variable_lock_wait_none,
+    bplib_variable_cache_wait_100us,   bplib_variable_cache_run_100us,     bplib_variable_cla_wait_100us,
+    bplib_variable_cla_run_100us,      bplib_variable_service_wait_100us,  bplib_variable_service_run_100us};
+
+const bplib_metric_group_t BPLIB_MPOOL_METRICS = {BPLIB_MPOOL_METRIC_DESCS,
+                                                  sizeof(BPLIB_MPOOL_METRIC_DESCS) /
+                                                      sizeof(BPLIB_MPOOL_METRIC_DESCS[0]),
+                                                  NULL, bplib_read_mpool_metric};
+
+/* every subsystem that reports metrics, in the order they appear in a snapshot */
+static const bplib_metric_group_t *const BPLIB_METRIC_GROUPS[] = {
+    &BPLIB_MPOOL_METRICS, &BPLIB_ROUTE_METRICS, &BPLIB_CLA_METRICS, &BPLIB_SOCKET_METRICS, &BPLIB_STORAGE_METRICS};
+
 /******************************************************************************
  LOCAL FUNCTIONS
  ******************************************************************************/
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_query_mpool_stat
+ *
+ * Reads a variable which is one of the memory pool statistics
+ *
+ *-----------------------------------------------------------------*/
+static int bplib_query_mpool_stat(bplib_mpool_t *pool, bplib_variable_t var_id, bp_sval_t *value)
+{
+    static const bplib_mpool_stat_variable_t STAT_VARIABLES[] = {
+        {bplib_variable_mem_alloc_refused, bplib_mpool_stat_alloc_refused, 0},
+        {bplib_variable_mem_free_depth_min, bplib_mpool_stat_free_depth_min, 0},
+        {bplib_variable_mem_free_depth_max, bplib_mpool_stat_free_depth_max, 0},
+        {bplib_variable_mem_alloc_generic, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_generic},
+        {bplib_variable_mem_alloc_primary, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_primary},
+        {bplib_variable_mem_alloc_canonical, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_canonical},
+        {bplib_variable_mem_alloc_flow, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_flow},
+        {bplib_variable_mem_alloc_ref, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_ref},
+        {bplib_variable_mem_free_generic, bplib_mpool_stat_free_count, bplib_mpool_blocktype_generic},
+        {bplib_variable_mem_free_primary, bplib_mpool_stat_free_count, bplib_mpool_blocktype_primary},
+        {bplib_variable_mem_free_canonical, bplib_mpool_stat_free_count, bplib_mpool_blocktype_canonical},
+        {bplib_variable_mem_free_flow, bplib_mpool_stat_free_count, bplib_mpool_blocktype_flow},
+        {bplib_variable_mem_free_ref, bplib_mpool_stat_free_count, bplib_mpool_blocktype_ref},
+        {bplib_variable_mem_alloc_pri_lo, bplib_mpool_stat_alloc_priority, 0},
+        {bplib_variable_mem_alloc_pri_med, bplib_mpool_stat_alloc_priority, 1},
+        {bplib_variable_mem_alloc_pri_mhi, bplib_mpool_stat_alloc_priority, 2},
+        {bplib_variable_mem_alloc_pri_hi, bplib_mpool_stat_alloc_priority, 3},
+        {bplib_variable_lock_wait_none, bplib_mpool_stat_lock_wait_count, 0},
+        {bplib_variable_lock_wait_10us, bplib_mpool_stat_lock_wait_count, 1},
+        {bplib_variable_lock_wait_100us, bplib_mpool_stat_lock_wait_count, 2},
+        {bplib_variable_lock_wait_1ms, bplib_mpool_stat_lock_wait_count, 3},
+        {bplib_variable_lock_wait_long, bplib_mpool_stat_lock_wait_count, 4},
+        {bplib_variable_cache_wait_100us, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 0)},
+        {bplib_variable_cache_wait_1ms, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 1)},
+        {bplib_variable_cache_wait_10ms, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 2)},
+        {bplib_variable_cache_wait_long, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 3)},
+        {bplib_variable_cache_run_100us, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 0)},
+        {bplib_variable_cache_run_1ms, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 1)},
+        {bplib_variable_cache_run_10ms, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 2)},
+        {bplib_variable_cache_run_long, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 3)},
+        {bplib_variable_cla_wait_100us, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 0)},
+        {bplib_variable_cla_wait_1ms, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 1)},
+        {bplib_variable_cla_wait_10ms, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 2)},
+        {bplib_variable_cla_wait_long, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 3)},
+        {bplib_variable_cla_run_100us, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 0)},
+        {bplib_variable_cla_run_1ms, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 1)},
+        {bplib_variable_cla_run_10ms, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 2)},
+        {bplib_variable_cla_run_long, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 3)},
+        {bplib_variable_service_wait_100us, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 0)},
+        {bplib_variable_service_wait_1ms, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 1)},
+        {bplib_variable_service_wait_10ms, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 2)},
+        {bplib_variable_service_wait_long, bplib_mpool_stat_job_wait_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 3)},
+        {bplib_variable_service_run_100us, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 0)},
+        {bplib_variable_service_run_1ms, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 1)},
+        {bplib_variable_service_run_10ms, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 2)},
+        {bplib_variable_service_run_long, bplib_mpool_stat_job_run_time,
+         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_dataservice, 3)}};
+
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(STAT_VARIABLES) / sizeof(STAT_VARIABLES[0])); ++i)
+    {
+        if (STAT_VARIABLES[i].var_id == var_id)
+        {
+            *value = bplib_mpool_query_stat(pool, STAT_VARIABLES[i].stat, STAT_VARIABLES[i].index);
+            return BP_SUCCESS;
+        }
+    }
+
+    /* non-readable variable */
+    *value = 0;
+    return BP_ERROR;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_read_mpool_metric
+ *
+ * Reads one of BPLIB_MPOOL_METRIC_DESCS, see bplib_route_collect_metrics()
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_read_mpool_metric(bplib_routetbl_t *rtbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                    bplib_metric_t *metric)
+{
+    bplib_variable_t var_id;
+    uint32_t         i;
+
+    var_id = BPLIB_MPOOL_METRIC_VARIABLES[idx];
+    if (metric->desc->num_bins == 0)
+    {
+        bplib_query_integer(rtbl, BP_INVALID_HANDLE, var_id, &metric->value);
+        return;
+    }
+
+    for (i = 0; i < metric->desc->num_bins; ++i)
+    {
+        bplib_query_integer(rtbl, BP_INVALID_HANDLE, (bplib_variable_t)(var_id + i), &metric->bins[i]);
+        metric->value += metric->bins[i];
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_eid_parse_number
+ *
+ * Reads a base 10 number at the start of str, up to end.
+ * Returns the number of digits read, which is 0 if there were none
+ * or the number does not fit in a bp_ipn_t.
+ *
+ *-----------------------------------------------------------------*/
+static size_t bplib_eid_parse_number(const char *str, const char *end, bp_ipn_t *value)
+{
+    const char *ptr;
+    bp_ipn_t    result;
+    unsigned    digit;
+
+    result = 0;
+    for (ptr = str; ptr < end; ++ptr)
+    {
+        digit = (unsigned)(*ptr - '0');
+        if (digit > 9)
+        {
+            break;
+        }
+        if (result > ((BPLIB_EID_NUMBER_MAX - digit) / 10))
+        {
+            return 0;
+        }
+        result = (result * 10) + digit;
+    }
+
+    *value = result;
+    return ptr - str;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_eid_parse_ipn
+ *
+ * Reads an EID in the "ipn:<node>.<service>" form.  The string ends at
+ * len bytes or at a null char, whichever is first.  Nothing is logged here,
+ * it returns NULL if successful or a description of what is wrong.
+ *
+ *-----------------------------------------------------------------*/
+static const char *bplib_eid_parse_ipn(const char *eid, size_t len, bp_ipn_t *node, bp_ipn_t *service)
+{
+    const char *ptr;
+    const char *end;
+    size_t      digits;
+
+    if (len < 4 || eid[0] != 'i' || eid[1] != 'p' || eid[2] != 'n' || eid[3] != ':')
+    {
+        return "must start with 'ipn:'";
+    }
+
+    /* a null char stops each of the steps below, as it is not a digit or a dot */
+    end    = eid + len;
+    ptr    = eid + 4;
+    digits = bplib_eid_parse_number(ptr, end, node);
+    if (digits == 0)
+    {
+        return "unable to parse node number";
+    }
+
+    ptr += digits;
+    if (ptr >= end || *ptr != '.')
+    {
+        return "unable to find dotted notation";
+    }
+
+    ++ptr;
+    digits = bplib_eid_parse_number(ptr, end, service);
+    ptr += digits;
+    if (digits == 0 || (ptr < end && *ptr != 0))
+    {
+        return "unable to parse service number";
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_eid_format_number
+ *
+ * Writes value in base 10 into the chars just before end, two digits at a time.
+ * Returns a pointer to the first digit.
+ *
+ *-----------------------------------------------------------------*/
+static char *bplib_eid_format_number(char *end, bp_ipn_t value)
+{
+    unsigned pair;
+
+    while (value >= 100)
+    {
+        pair   = (unsigned)(value % 100) * 2;
+        value  = value / 100;
+        end    = end - 2;
+        end[0] = BPLIB_EID_DIGIT_PAIRS[pair];
+        end[1] = BPLIB_EID_DIGIT_PAIRS[pair + 1];
+    }
+
+    if (value >= 10)
+    {
+        pair   = (unsigned)value * 2;
+        end    = end - 2;
+        end[0] = BPLIB_EID_DIGIT_PAIRS[pair];
+        end[1] = BPLIB_EID_DIGIT_PAIRS[pair + 1];
+    }
+    else
+    {
+        *--end = (char)('0' + value);
+    }
+
+    return end;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_eid_format_ipn
+ *
+ * Writes "ipn:<node>.<service>" into buf, up to len bytes, always with a null char.
+ * Like snprintf, an EID that does not fit is cut short.
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_eid_format_ipn(char *buf, size_t len, bp_ipn_t node, bp_ipn_t service)
+{
+    char   text[BPLIB_EID_IPN_FORMAT_MAX];
+    char  *ptr;
+    size_t text_len;
+
+    /* this is filled from the end */
+    ptr    = bplib_eid_format_number(&text[sizeof(text)], service);
+    *--ptr = '.';
+    ptr    = bplib_eid_format_number(ptr, node) - 4;
+    memcpy(ptr, "ipn:", 4);
+
+    text_len = &text[sizeof(text)] - ptr;
+    if (text_len >= len)
+    {
+        text_len = len - 1;
+    }
+
+    memcpy(buf, ptr, text_len);
+    buf[text_len] = 0;
+}
+
 /******************************************************************************
  EXPORTED FUNCTIONS
  ******************************************************************************/
@@ -74,8 +434,19 @@ void bplib_deinit(void) {}
 bp_handle_t bplib_create_ram_storage(bplib_routetbl_t *rtbl, const bp_ipn_addr_t *storage_addr)
 {
     bp_handle_t intf_id;
+    bp_handle_t svc_id;
 
     intf_id = bplib_cache_attach(rtbl, storage_addr);
+    if (bp_handle_is_valid(intf_id))
+    {
+        /* bundles that would be shed are packed instead, it does not change what custody is taken */
+        svc_id = bplib_cache_register_module_service(rtbl, intf_id, BPLIB_PACKED_OFFLOAD_API, NULL);
+
+        if (bp_handle_is_valid(svc_id))
+        {
+            bplib_cache_start(rtbl, intf_id);
+        }
+    }
 
     return intf_id;
 }
@@ -147,13 +518,9 @@ int bplib_display(const void *bundle, size_t size, uint32_t *flags)
  *-------------------------------------------------------------------------------------*/
 int bplib_eid2ipn(const char *eid, size_t len, bp_ipn_t *node, bp_ipn_t *service)
 {
-    char          eidtmp[BP_MAX_EID_STRING];
-    int           tmplen;
-    char         *node_ptr;
-    char         *service_ptr;
-    char         *endptr;
-    unsigned long node_result;
-    unsigned long service_result;
+    const char *parse_error;
+    bp_ipn_t    node_result;
+    bp_ipn_t    service_result;
 
     /* Sanity Check EID Pointer */
     if (eid == NULL)
@@ -172,48 +539,16 @@ int bplib_eid2ipn(const char *eid, size_t len, bp_ipn_t *node, bp_ipn_t *service
                      len);
     }
 
-    /* Check IPN Scheme */
-    if (eid[0] != 'i' || eid[1] != 'p' || eid[2] != 'n' || eid[3] != ':')
+    /* Parse the node and service numbers, which are always written in base 10 */
+    parse_error = bplib_eid_parse_ipn(eid, len, &node_result, &service_result);
+    if (parse_error != NULL)
     {
-        return bplog(NULL, BP_FLAG_API_ERROR, "EID (%s) must start with 'ipn:'\n", eid);
-    }
-
-    /* Copy EID to Temporary Buffer and Set Pointers */
-    tmplen = len - 4;
-    memcpy(eidtmp, &eid[4], tmplen);
-    eidtmp[tmplen] = '\0';
-    node_ptr       = eidtmp;
-    service_ptr    = strchr(node_ptr, '.');
-    if (service_ptr)
-    {
-        *service_ptr = '\0';
-        service_ptr++;
-    }
-    else
-    {
-        return bplog(NULL, BP_FLAG_API_ERROR, "Unable to find dotted notation in EID (%s)\n", eid);
-    }
-
-    /* Parse Node Number */
-    errno       = 0;
-    node_result = strtoul(node_ptr, &endptr, 10); /* assume IPN node and service numbers always written in base 10 */
-    if ((endptr == node_ptr) || ((node_result == ULONG_MAX || node_result == 0) && errno == ERANGE))
-    {
-        return bplog(NULL, BP_FLAG_API_ERROR, "Unable to parse EID (%s) node number\n", eid);
-    }
-
-    /* Parse Service Number */
-    errno = 0;
-    service_result =
-        strtoul(service_ptr, &endptr, 10); /* assume IPN node and service numbers always written in base 10 */
-    if ((endptr == service_ptr) || ((service_result == ULONG_MAX || service_result == 0) && errno == ERANGE))
-    {
-        return bplog(NULL, BP_FLAG_API_ERROR, "Unable to parse EID (%s) service number\n", eid);
+        return bplog(NULL, BP_FLAG_API_ERROR, "EID (%.*s) %s\n", (int)len, eid, parse_error);
     }
 
     /* Set Outputs */
-    *node    = (bp_ipn_t)node_result;
-    *service = (bp_ipn_t)service_result;
+    *node    = node_result;
+    *service = service_result;
     return BP_SUCCESS;
 }
 
@@ -246,11 +581,208 @@ int bplib_ipn2eid(char *eid, size_t len, bp_ipn_t node, bp_ipn_t service)
     }
 
     /* Write EID */
-    snprintf(eid, len, "ipn:%lu.%lu", (unsigned long)node, (unsigned long)service);
+    bplib_eid_format_ipn(eid, len, node, service);
 
     return BP_SUCCESS;
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_eid2ipn_n -
+ *
+ *  eids -                  null-terminated string representations of End Point IDs [INPUT]
+ *  nodes -                 node numbers as read from each eid [OUTPUT]
+ *  services -              service numbers as read from each eid [OUTPUT]
+ *  count -                 number of entries in each of the above arrays [INPUT]
+ *  Returns:                number of EIDs converted, which stops at the first that is not valid
+ *-------------------------------------------------------------------------------------*/
+size_t bplib_eid2ipn_n(const char *const *eids, bp_ipn_t *nodes, bp_ipn_t *services, size_t count)
+{
+    const char *parse_error;
+    size_t      i;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (eids[i] == NULL)
+        {
+            bplog(NULL, BP_FLAG_API_ERROR, "EID %lu is null\n", (unsigned long)i);
+            break;
+        }
+
+        parse_error = bplib_eid_parse_ipn(eids[i], BP_MAX_EID_STRING, &nodes[i], &services[i]);
+        if (parse_error != NULL)
+        {
+            bplog(NULL, BP_FLAG_API_ERROR, "EID %lu (%.*s) %s\n", (unsigned long)i, BP_MAX_EID_STRING, eids[i],
+                  parse_error);
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_ipn2eid_n -
+ *
+ *  eids -                  buffer that will hold count null-terminated strings, one every eid_size bytes [OUTPUT]
+ *  eid_size -              size in bytes of each string in the above buffer [INPUT]
+ *  nodes -                 node numbers to be written into each eid [INPUT]
+ *  services -              service numbers to be written into each eid [INPUT]
+ *  count -                 number of entries in each of the above arrays [INPUT]
+ *  Returns:                number of EIDs written, which is 0 if eid_size is not valid
+ *-------------------------------------------------------------------------------------*/
+size_t bplib_ipn2eid_n(char *eids, size_t eid_size, const bp_ipn_t *nodes, const bp_ipn_t *services, size_t count)
+{
+    size_t i;
+
+    /* Sanity Check Length of EID Buffers */
+    if (eid_size < 7 || eid_size > BP_MAX_EID_STRING)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "EID buffer size must be from 7 to %d bytes, act: %lu\n", BP_MAX_EID_STRING,
+              (unsigned long)eid_size);
+        return 0;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        bplib_eid_format_ipn(&eids[i * eid_size], eid_size, nodes[i], services[i]);
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_query_flow_variable
+ *
+ * Reads a memory quota, reserve or scheduling variable, these apply to any intf,
+ * see bplib_mpool_flow_set_quota(), bplib_mpool_reserve_set_target() and
+ * bplib_mpool_job_set_quantum()
+ *
+ *-----------------------------------------------------------------*/
+static int bplib_query_flow_variable(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id,
+                                     bp_sval_t *value)
+{
+    bplib_mpool_ref_t   flow_ref;
+    bplib_mpool_flow_t *flow;
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    flow     = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        bplib_route_release_intf_controlblock(rtbl, flow_ref);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    switch (var_id)
+    {
+        case bplib_variable_mem_quota_limit:
+            *value = __atomic_load_n(&flow->quota.limit, __ATOMIC_RELAXED);
+            break;
+        case bplib_variable_mem_quota_refuse:
+            *value = __atomic_load_n(&flow->quota.backpressure, __ATOMIC_RELAXED);
+            break;
+        case bplib_variable_mem_quota_used:
+            *value = __atomic_load_n(&flow->quota.used, __ATOMIC_RELAXED);
+            break;
+        case bplib_variable_sched_quantum:
+            *value = flow->ingress.job_header.quantum;
+            break;
+        case bplib_variable_sched_quantum_bytes:
+            *value = flow->ingress.job_header.quantum_bytes;
+            break;
+        case bplib_variable_mem_reserve_blocks:
+            *value = flow->reserve.target_count;
+            break;
+        case bplib_variable_mem_reserve_used:
+            *value = flow->reserve.use_count;
+            break;
+        default:
+            *value = __atomic_load_n(&flow->quota.over_count, __ATOMIC_RELAXED);
+            break;
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_config_flow_variable
+ *
+ * Writes the memory quota, the block reserve or the scheduling quantum of
+ * any intf, the quantum applies the same to the jobs of both of its queues
+ *
+ *-----------------------------------------------------------------*/
+static int bplib_config_flow_variable(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id,
+                                      bp_sval_t value)
+{
+    bplib_mpool_ref_t   flow_ref;
+    bplib_mpool_flow_t *flow;
+    bplib_mpool_job_t  *job;
+    uint32_t            quantum;
+    uint32_t            block_count;
+    bool                in_bytes;
+    int                 status;
+
+    if (value < 0)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Intf value cannot be negative\n");
+        return BP_ERROR;
+    }
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    flow     = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        bplib_route_release_intf_controlblock(rtbl, flow_ref);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    status = BP_SUCCESS;
+    if (var_id == bplib_variable_mem_quota_limit)
+    {
+        bplib_mpool_flow_set_quota(flow, value, __atomic_load_n(&flow->quota.backpressure, __ATOMIC_RELAXED));
+    }
+    else if (var_id == bplib_variable_mem_quota_refuse)
+    {
+        bplib_mpool_flow_set_quota(flow, __atomic_load_n(&flow->quota.limit, __ATOMIC_RELAXED), value != 0);
+    }
+    else if (var_id == bplib_variable_mem_reserve_blocks)
+    {
+        block_count = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+        status      = bplib_mpool_reserve_set_target(bplib_route_get_mpool(rtbl), &flow->reserve, block_count);
+        if (status != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Pool cannot set aside %u blocks for intf\n",
+                  (unsigned int)block_count);
+        }
+    }
+    else
+    {
+        job      = &flow->ingress.job_header;
+        quantum  = job->quantum;
+        in_bytes = job->quantum_bytes;
+        if (var_id == bplib_variable_sched_quantum)
+        {
+            quantum = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+        }
+        else
+        {
+            in_bytes = (value != 0);
+        }
+
+        bplib_mpool_job_set_quantum(job, quantum, in_bytes);
+        bplib_mpool_job_set_quantum(&flow->egress.job_header, quantum, in_bytes);
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_query_integer
@@ -277,15 +809,81 @@ int bplib_query_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_varia
             retval = BP_SUCCESS;
             break;
 
+        case bplib_variable_mem_collect_backlog:
+            *value = bplib_mpool_query_collect_backlog(bplib_route_get_mpool(rtbl));
+            retval = BP_SUCCESS;
+            break;
+
+        case bplib_variable_cla_egress_rate:
+        case bplib_variable_cla_egress_burst:
+        case bplib_variable_cla_frame_mtu:
+        case bplib_variable_cla_frame_wait:
+        case bplib_variable_cla_ingress_bytes:
+        case bplib_variable_cla_egress_bytes:
+        case bplib_variable_cla_ingress_bundles:
+        case bplib_variable_cla_egress_bundles:
+        case bplib_variable_cla_drop_no_route:
+        case bplib_variable_cla_drop_queue_full:
+        case bplib_variable_cla_drop_decode:
+        case bplib_variable_cla_drop_expired:
+        case bplib_variable_cla_queue_10ms:
+        case bplib_variable_cla_queue_100ms:
+        case bplib_variable_cla_queue_1s:
+        case bplib_variable_cla_queue_long:
+        case bplib_variable_cla_ingress_bps:
+        case bplib_variable_cla_egress_bps:
+        case bplib_variable_cla_fragment_mtu:
+        case bplib_variable_cla_reassembly_mem:
+        case bplib_variable_cla_reassembly_wait:
+        case bplib_variable_cla_fragmented:
+        case bplib_variable_cla_reassembled:
+        case bplib_variable_cla_drop_reassembly:
+        case bplib_variable_cla_drop_duplicate:
+            retval = bplib_cla_query_integer(rtbl, intf_id, var_id, value);
+            break;
+
+        case bplib_variable_mem_quota_limit:
+        case bplib_variable_mem_quota_refuse:
+        case bplib_variable_mem_quota_used:
+        case bplib_variable_mem_quota_over:
+        case bplib_variable_sched_quantum:
+        case bplib_variable_sched_quantum_bytes:
+        case bplib_variable_mem_reserve_blocks:
+        case bplib_variable_mem_reserve_used:
+            retval = bplib_query_flow_variable(rtbl, intf_id, var_id, value);
+            break;
+
         default:
-            /* non-readable variable */
-            *value = 0;
+            /* the rest are memory pool statistics, if anything */
+            retval = bplib_query_mpool_stat(bplib_route_get_mpool(rtbl), var_id, value);
             break;
     }
 
     return retval;
 }
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_metrics_snapshot
+ *
+ * Public API function
+ * See description in header for argument/return detail
+ *
+ *-----------------------------------------------------------------*/
+int bplib_metrics_snapshot(bplib_routetbl_t *rtbl, bplib_metric_t *metrics, uint32_t max_metrics,
+                           uint32_t *num_metrics)
+{
+    *num_metrics = bplib_route_collect_metrics(rtbl, BPLIB_METRIC_GROUPS,
+                                               sizeof(BPLIB_METRIC_GROUPS) / sizeof(BPLIB_METRIC_GROUPS[0]), metrics,
+                                               max_metrics);
+    if (*num_metrics > max_metrics)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_config_integer
@@ -302,6 +900,24 @@ int bplib_config_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_vari
 
     switch (var_id)
     {
+        case bplib_variable_cla_egress_rate:
+        case bplib_variable_cla_egress_burst:
+        case bplib_variable_cla_frame_mtu:
+        case bplib_variable_cla_frame_wait:
+        case bplib_variable_cla_fragment_mtu:
+        case bplib_variable_cla_reassembly_mem:
+        case bplib_variable_cla_reassembly_wait:
+            retval = bplib_cla_config_integer(rtbl, intf_id, var_id, value);
+            break;
+
+        case bplib_variable_mem_quota_limit:
+        case bplib_variable_mem_quota_refuse:
+        case bplib_variable_sched_quantum:
+        case bplib_variable_sched_quantum_bytes:
+        case bplib_variable_mem_reserve_blocks:
+            retval = bplib_config_flow_variable(rtbl, intf_id, var_id, value);
+            break;
+
         default:
             /* non-writable variable */
             break;
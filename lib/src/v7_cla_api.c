@@ -30,12 +30,42 @@
 #include "v7_mpool_flows.h"
 #include "v7_mpool_ref.h"
 #include "v7_codec.h"
+#include "v7_encode.h"
 #include "v7_cache.h"
 #include "bplib_routing.h"
 #include "v7_base_internal.h"
 
-#define BPLIB_BLOCKTYPE_CLA_INTF          0x7b643c85
-#define BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK 0x9580be4a
+#define BPLIB_BLOCKTYPE_CLA_INTF           0x7b643c85
+#define BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK  0x9580be4a
+#define BPLIB_BLOCKTYPE_CLA_FRAGMENT_BLOCK 0x2c9e17d3
+#define BPLIB_BLOCKTYPE_CLA_REASSEMBLY     0x5a13f6b8
+#define BPLIB_BLOCKTYPE_CLA_FRAGMENT       0xe4d0827f
+#define BPLIB_BLOCKTYPE_CLA_FRAGMENTATION  0x3b71c0e2
+#define BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM 0x6f2d91a4
+#define BPLIB_BLOCKTYPE_CLA_EGRESS_STREAM  0x1c8e5b37
+#define BPLIB_BLOCKTYPE_CLA_INGRESS_RAW    0xd8316a5c
+
+/*
+ * The stage of a bundle received with bplib_cla_ingress_begin() has to hold every block but the payload,
+ * so this asks for a block from the large size class of the pool.
+ */
+#define BPLIB_CLA_INGRESS_STAGE_SIZE 4000
+
+/*
+ * The byte rates are sampled about this often, and each sample is mixed in as 1/8 of the average.
+ * After a quiet period the same sample is mixed in once per window it covers, up to a limit.
+ */
+#define BPLIB_CLA_RATE_SAMPLE_MS   1000
+#define BPLIB_CLA_RATE_MAX_WINDOWS 16
+
+/*
+ * The primary block of a fragment has the fragment offset and the total ADU length, which
+ * the bundle may not have had.  Each is a CBOR unsigned integer of at most 9 bytes.
+ */
+#define BPLIB_CLA_FRAGMENT_PRI_EXTRA 18
+
+/* a 64-bit odd constant (golden ratio), so every part of the bundle id affects the key */
+#define BPLIB_CLA_REASSEMBLY_HASH_MULT 0x9E3779B97F4A7C15ULL
 
 /******************************************************************************
  TYPEDEFS
@@ -44,285 +74,3502 @@
 /******************************************************************************
  LOCAL FUNCTIONS
  ******************************************************************************/
-int bplib_cla_event_impl(void *arg, bplib_mpool_block_t *intf_block)
+/*
+ * Adds the tokens earned since the last update.  The update time is only moved on by the time that
+ * was actually turned into tokens, so frequent calls do not lose the fractions of a token.
+ */
+static void bplib_cla_pacing_refill(bplib_cla_pacing_t *pacing, uint64_t now)
 {
-    bplib_mpool_flow_generic_event_t *event;
-    bplib_mpool_flow_t               *flow;
+    int64_t  limit;
+    uint64_t elapsed;
+    uint64_t earned;
 
-    event = arg;
+    if (now <= pacing->update_ms)
+    {
+        return;
+    }
 
-    /* only care about state change events for now */
-    if (event->event_type != bplib_mpool_flow_event_up && event->event_type != bplib_mpool_flow_event_down)
+    limit   = (pacing->burst != 0) ? pacing->burst : pacing->rate;
+    elapsed = now - pacing->update_ms;
+
+    /* checking against the time to fill the bucket first also keeps the multiply from overflowing */
+    if (pacing->tokens >= limit || elapsed > ((uint64_t)(limit - pacing->tokens) * 1000) / pacing->rate)
     {
-        return BP_SUCCESS;
+        pacing->tokens    = limit;
+        pacing->update_ms = now;
+    }
+    else
+    {
+        earned = (elapsed * pacing->rate) / 1000;
+        pacing->tokens += earned;
+        pacing->update_ms += (earned * 1000) / pacing->rate;
     }
+}
 
-    /* only care about state change events for the local i/f */
-    flow = bplib_mpool_flow_cast(intf_block);
-    if (flow == NULL || !bp_handle_equal(event->intf_state.intf_id, bplib_mpool_get_external_id(intf_block)))
+/*
+ * Starts the bucket again full, after a change to the rate or burst
+ */
+static void bplib_cla_pacing_reset(bplib_cla_pacing_t *pacing)
+{
+    pacing->tokens    = (pacing->burst != 0) ? pacing->burst : pacing->rate;
+    pacing->update_ms = bplib_os_get_dtntime_ms();
+}
+
+/*
+ * Gets the time that the next bundle may go out, which is now unless the bucket is in debt
+ */
+static uint64_t bplib_cla_pacing_ready_time(bplib_cla_pacing_t *pacing, uint64_t now)
+{
+    if (pacing->rate == 0)
+    {
+        return now;
+    }
+
+    bplib_cla_pacing_refill(pacing, now);
+    if (pacing->tokens > 0)
+    {
+        return now;
+    }
+
+    /* this has to round up, or the bucket would still be empty at that time */
+    return now + ((1 - pacing->tokens) * 1000 + pacing->rate - 1) / pacing->rate;
+}
+
+/*
+ * Takes the tokens for a bundle that is going out, and gets the time it will have been
+ * sent at the paced rate.  This is what the retransmit time should be counted from.
+ */
+static uint64_t bplib_cla_pacing_charge(bplib_cla_pacing_t *pacing, size_t size, uint64_t now)
+{
+    if (pacing->rate == 0)
+    {
+        return now;
+    }
+
+    bplib_cla_pacing_refill(pacing, now);
+    pacing->tokens -= size;
+    if (pacing->tokens >= 0)
+    {
+        /* it fit within the burst */
+        return now;
+    }
+
+    return now + ((uint64_t)(-pacing->tokens) * 1000) / pacing->rate;
+}
+
+/*
+ * Waits until the pacing of the interface allows another bundle out, if that is before the time limit
+ */
+static int bplib_cla_egress_pace(bplib_routetbl_t *rtbl, bplib_cla_stats_t *stats, uint64_t time_limit)
+{
+    uint64_t now;
+    uint64_t ready_time;
+
+    now        = bplib_os_get_dtntime_ms();
+    ready_time = bplib_cla_pacing_ready_time(&stats->egress_pacing, now);
+    if (ready_time <= now)
     {
         return BP_SUCCESS;
     }
 
-    if (event->event_type == bplib_mpool_flow_event_up)
+    if (ready_time > time_limit)
     {
-        /* Allows bundles to be pushed to flow queues */
-        bplib_mpool_flow_enable(&flow->ingress, BP_MPOOL_MAX_SUBQ_DEPTH);
-        bplib_mpool_flow_enable(&flow->egress, BP_MPOOL_MAX_SUBQ_DEPTH);
+        /* as if the queue had stayed empty */
+        return BP_TIMEOUT;
     }
-    else if (event->event_type == bplib_mpool_flow_event_down)
+
+    bplib_route_wait_until(rtbl, ready_time);
+    return BP_SUCCESS;
+}
+
+/*
+ * Gets the egress time for a bundle of the given size going out the interface
+ */
+static uint64_t bplib_cla_egress_time(bplib_mpool_ref_t flow_ref, size_t size)
+{
+    bplib_cla_stats_t *stats;
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
     {
-        /* drop anything already in the egress queue.  Note that
-         * ingress is usually empty, as bundles really should not wait there,
-         * so that probably has no effect. */
-        bplib_mpool_flow_disable(&flow->ingress);
-        bplib_mpool_flow_disable(&flow->egress);
+        return bplib_os_get_dtntime_ms();
+    }
+
+    return bplib_cla_pacing_charge(&stats->egress_pacing, size, bplib_os_get_dtntime_ms());
+}
+
+/*
+ * Counts events on the interface.  These are only statistics and nothing is ordered by them,
+ * so relaxed atomics are enough, and no lock is needed to keep them.
+ */
+static void bplib_cla_count(bplib_mpool_ref_t flow_ref, bplib_cla_counter_t counter, uint32_t n)
+{
+    bplib_cla_stats_t *stats;
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats != NULL && n != 0)
+    {
+        __atomic_fetch_add(&stats->counters[counter], n, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Mixes the rate seen over the last sample into the average, once per sample window it covered
+ */
+static uint32_t bplib_cla_rate_mix(uint32_t rate, uintmax_t sample_rate, uint64_t windows)
+{
+    if (sample_rate > UINT32_MAX)
+    {
+        sample_rate = UINT32_MAX;
+    }
+    if (windows > BPLIB_CLA_RATE_MAX_WINDOWS)
+    {
+        windows = BPLIB_CLA_RATE_MAX_WINDOWS;
+    }
+
+    while (windows > 0)
+    {
+        rate = (((uint64_t)rate * 7) + sample_rate) / 8;
+        --windows;
+    }
+
+    return rate;
+}
+
+/*
+ * Brings the byte rates up to date, if a sample window has gone by.  Only the thread that
+ * moves the sample time on does the rest, so the averages themselves need no atomics.
+ */
+static void bplib_cla_rate_update(bplib_cla_stats_t *stats, uint64_t now)
+{
+    bplib_cla_rate_ewma_t *ewma;
+    uint64_t               sample_ms;
+    uint64_t               elapsed;
+    uintmax_t              ingress_total;
+    uintmax_t              egress_total;
+
+    ewma      = &stats->rate_ewma;
+    sample_ms = __atomic_load_n(&ewma->sample_ms, __ATOMIC_RELAXED);
+    if (sample_ms != 0 && now < (sample_ms + BPLIB_CLA_RATE_SAMPLE_MS))
+    {
+        return;
+    }
+
+    if (!__atomic_compare_exchange_n(&ewma->sample_ms, &sample_ms, now, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        /* another thread is doing it */
+        return;
+    }
+
+    ingress_total = __atomic_load_n(&stats->ingress_byte_count, __ATOMIC_RELAXED);
+    egress_total  = __atomic_load_n(&stats->egress_byte_count, __ATOMIC_RELAXED);
+
+    /* the first sample only sets the starting point */
+    if (sample_ms != 0 && now > sample_ms)
+    {
+        elapsed = now - sample_ms;
+        ewma->ingress_rate =
+            bplib_cla_rate_mix(ewma->ingress_rate, ((ingress_total - ewma->ingress_sample) * 1000) / elapsed,
+                               elapsed / BPLIB_CLA_RATE_SAMPLE_MS);
+        ewma->egress_rate =
+            bplib_cla_rate_mix(ewma->egress_rate, ((egress_total - ewma->egress_sample) * 1000) / elapsed,
+                               elapsed / BPLIB_CLA_RATE_SAMPLE_MS);
+    }
+
+    ewma->ingress_sample = ingress_total;
+    ewma->egress_sample  = egress_total;
+}
+
+/*
+ * Adds to one of the byte counts of the interface
+ */
+static void bplib_cla_count_bytes(bplib_cla_stats_t *stats, uintmax_t *byte_count, size_t size)
+{
+    __atomic_fetch_add(byte_count, size, __ATOMIC_RELAXED);
+    bplib_cla_rate_update(stats, bplib_os_get_dtntime_ms());
+}
+
+/*
+ * Checks if a bundle outlived its lifetime while it waited to go out.  A creation time of 0
+ * means the source had no clock, in which case the lifetime cannot be checked against it.
+ */
+static bool bplib_cla_bundle_expired(bplib_mpool_bblock_primary_t *cpb, uint64_t now)
+{
+    const bp_primary_block_t *pri;
+
+    pri = &cpb->data.logical;
+    return (pri->creationTimeStamp.time != 0 && (pri->creationTimeStamp.time + pri->lifetime) <= now);
+}
+
+/*
+ * Counts a bundle that went out the interface, by how long it was in this node
+ */
+static void bplib_cla_count_egress(bplib_mpool_ref_t flow_ref, bplib_mpool_bblock_primary_t *cpb, uint64_t now)
+{
+    uint64_t            queue_time;
+    bplib_cla_counter_t counter;
+
+    queue_time = 0;
+    if (now > cpb->data.delivery.ingress_time)
+    {
+        queue_time = now - cpb->data.delivery.ingress_time;
+    }
+
+    if (queue_time < 10)
+    {
+        counter = bplib_cla_counter_queue_time_10ms;
+    }
+    else if (queue_time < 100)
+    {
+        counter = bplib_cla_counter_queue_time_100ms;
+    }
+    else if (queue_time < 1000)
+    {
+        counter = bplib_cla_counter_queue_time_1s;
+    }
+    else
+    {
+        counter = bplib_cla_counter_queue_time_long;
+    }
+
+    bplib_cla_count(flow_ref, bplib_cla_counter_egress_bundles, 1);
+    bplib_cla_count(flow_ref, counter, 1);
+    bplib_serviceflow_trace_egress(cpb, now);
+    BPLIB_TRACEPOINT_BUNDLE(cla_egress, cpb, bp_handle_printable(cpb->data.delivery.egress_intf_id));
+}
+
+/*
+ * Gets the V7_IMPORT_* options for decoding a bundle received on the interface
+ */
+static uint32_t bplib_cla_import_flags(bplib_mpool_ref_t flow_ref)
+{
+    bplib_cla_stats_t *stats;
+    uint32_t           import_flags;
+
+    stats        = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    import_flags = 0;
+    if (stats != NULL && stats->lazy_decode)
+    {
+        import_flags |= V7_IMPORT_LAZY_DECODE;
+    }
+    if (stats != NULL && stats->defer_crc)
+    {
+        import_flags |= V7_IMPORT_DEFER_CRC;
+    }
+
+    return import_flags;
+}
+
+/*
+ * Allocates the duplicate filter for an intf made with BPLIB_CLA_INTF_DEDUP, which starts empty
+ */
+static bplib_cla_dedup_t *bplib_cla_dedup_alloc(void)
+{
+    bplib_cla_dedup_t *dedup;
+
+    dedup = bplib_os_calloc(sizeof(bplib_cla_dedup_t));
+    if (dedup != NULL)
+    {
+        dedup->lock = bplib_os_createlock();
+        if (!bp_handle_is_valid(dedup->lock))
+        {
+            bplib_os_free(dedup);
+            dedup = NULL;
+        }
+    }
+
+    return dedup;
+}
+
+static void bplib_cla_dedup_free(bplib_cla_dedup_t *dedup)
+{
+    bplib_os_destroylock(dedup->lock);
+    bplib_os_free(dedup);
+}
+
+/*
+ * Checks whether a bundle that was just decoded was received already, and if not, remembers it.
+ * Returns true if it is a duplicate, which is only so if its exact key is found.
+ */
+static bool bplib_cla_dedup_check(bplib_cla_dedup_t *dedup, const bp_primary_block_t *pri)
+{
+    bplib_cla_dedup_key_t  key;
+    bplib_cla_dedup_key_t *slot;
+    uint64_t               hash;
+    uint32_t               probe[BPLIB_CLA_DEDUP_PROBES];
+    uint32_t               step;
+    uint32_t               i;
+    uint32_t               gen;
+    bool                   maybe_seen[2];
+    bool                   duplicate;
+
+    memset(&key, 0, sizeof(key));
+    key.valid       = true;
+    key.is_fragment = pri->controlFlags.isFragment;
+    v7_get_eid(&key.source, &pri->sourceEID);
+    key.creation = pri->creationTimeStamp;
+    if (key.is_fragment)
+    {
+        key.fragment_offset = pri->fragmentOffset;
+    }
+
+    hash = key.source.node_number;
+    hash = (hash * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ key.source.service_number;
+    hash = (hash * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ key.creation.time;
+    hash = (hash * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ key.creation.sequence_num;
+    hash = (hash * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ key.fragment_offset;
+    hash = hash * BPLIB_CLA_REASSEMBLY_HASH_MULT;
+
+    /* the probes are spread by double hashing, with an odd step so they differ */
+    step = (uint32_t)(hash >> 32) | 1;
+    for (i = 0; i < BPLIB_CLA_DEDUP_PROBES; ++i)
+    {
+        probe[i] = ((uint32_t)hash + (i * step)) & (BPLIB_CLA_DEDUP_FILTER_BITS - 1);
+    }
+    slot = &dedup->exact[(hash >> 40) & (BPLIB_CLA_DEDUP_EXACT_SLOTS - 1)];
+
+    bplib_os_lock(dedup->lock);
+
+    for (gen = 0; gen < 2; ++gen)
+    {
+        maybe_seen[gen] = true;
+        for (i = 0; i < BPLIB_CLA_DEDUP_PROBES && maybe_seen[gen]; ++i)
+        {
+            maybe_seen[gen] = ((dedup->filter[gen][probe[i] / 64] >> (probe[i] % 64)) & 1) != 0;
+        }
+    }
+
+    duplicate = (maybe_seen[0] || maybe_seen[1]) && memcmp(slot, &key, sizeof(key)) == 0;
+    if (!duplicate)
+    {
+        if (dedup->generation_count >= BPLIB_CLA_DEDUP_GENERATION)
+        {
+            /* the older generation is forgotten, and becomes the current one */
+            dedup->current ^= 1;
+            memset(dedup->filter[dedup->current], 0, sizeof(dedup->filter[dedup->current]));
+            dedup->generation_count = 0;
+        }
+
+        for (i = 0; i < BPLIB_CLA_DEDUP_PROBES; ++i)
+        {
+            dedup->filter[dedup->current][probe[i] / 64] |= (uint64_t)1 << (probe[i] % 64);
+        }
+        ++dedup->generation_count;
+        *slot = key;
+    }
+
+    bplib_os_unlock(dedup->lock);
+
+    return duplicate;
+}
+
+/*
+ * Makes the block that goes in the ingress queue of the interface, for a bundle that has been decoded
+ * into pblk.  If it was not decoded (or there was no memory), pblk is recycled and this returns NULL.
+ */
+static bplib_mpool_block_t *bplib_generic_bundle_make_ingress(bplib_mpool_ref_t flow_ref, bplib_mpool_block_t *pblk,
+                                                              bool decoded)
+{
+    bplib_mpool_block_t          *rblk;
+    bplib_mpool_ref_t             refptr;
+    bplib_mpool_bblock_primary_t *pri_block;
+    bplib_cla_stats_t            *stats;
+    bool                          duplicate;
+
+    /* convert the bundle to a dynamically-managed ref */
+    refptr = bplib_mpool_ref_create(pblk);
+    if (refptr != NULL)
+    {
+        /* after conversion, should not use the original */
+        pblk = NULL;
+    }
+
+    pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
+
+    /* a bundle received again is dropped before anything else is done with it */
+    stats     = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    duplicate = (pri_block != NULL && decoded && stats != NULL && stats->dedup != NULL &&
+                 bplib_cla_dedup_check(stats->dedup, &pri_block->data.logical));
+
+    if (pri_block != NULL && decoded && !duplicate)
+    {
+        rblk = bplib_mpool_ref_make_block(refptr, BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK, NULL);
+    }
+    else
+    {
+        rblk = NULL;
+    }
+
+    if (rblk != NULL)
+    {
+        pri_block->data.delivery.ingress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(flow_ref));
+        pri_block->data.delivery.ingress_time    = bplib_os_get_dtntime_ms();
+        pri_block->data.delivery.stage_time[bplib_trace_stage_cla_ingress] = pri_block->data.delivery.ingress_time;
+        bplib_mpool_bblock_primary_quota_charge(pri_block, flow_ref, pri_block->bundle_encode_size_cache);
+        BPLIB_TRACEPOINT_BUNDLE(bundle_ingress, pri_block,
+                                bp_handle_printable(pri_block->data.delivery.ingress_intf_id));
+    }
+    else if (duplicate)
+    {
+        /* not an error, retransmits after an outage are expected to do this */
+        bplib_cla_count(flow_ref, bplib_cla_counter_drop_duplicate, 1);
+    }
+    else
+    {
+        /* without a primary block it was no memory, not a bad bundle */
+        if (pri_block != NULL)
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_drop_decode, 1);
+        }
+        bplog(NULL, BP_FLAG_INCOMPLETE, "Bundle did not decode correctly\n");
+    }
+
+    if (refptr != NULL)
+    {
+        /*
+         * The rblk holds its own ref, so the count remains nonzero after this if it was made, and the
+         * bundle itself continues on its way.  If something failed, the refcount will become zero,
+         * and the bundle memory gets freed.
+         */
+        bplib_mpool_ref_release(refptr);
+    }
+
+    if (pblk != NULL)
+    {
+        /* This really shouldn't happen... it means the pblk was allocated but wasn't convertible to a ref.
+         * something broke, but recycle it anyway */
+        bplib_mpool_recycle_block(pblk);
+    }
+
+    return rblk;
+}
+
+/*
+ * Copies an encoded bundle into a new bundle block, ready to be pushed to the ingress queue
+ * of the interface.  Returns NULL if the bundle could not be decoded or there was no memory.
+ *
+ * If buffer_ref is not NULL, the content is the data of that CBOR block, and the bundle block
+ * refers to it rather than getting a copy.
+ *
+ * If consumed is NULL the bundle must take up the whole content.  Otherwise it is the first
+ * bundle in a frame, and its size is output so the caller can find the next one.
+ */
+static bplib_mpool_block_t *bplib_generic_bundle_import(bplib_mpool_ref_t flow_ref, const void *content, size_t size,
+                                                        bplib_mpool_ref_t buffer_ref, size_t *consumed)
+{
+    bplib_mpool_block_t   *pblk;
+    bplib_mpool_block_t   *rblk;
+    bplib_mpool_flow_t    *flow;
+    bplib_mpool_reserve_t *prev_reserve;
+    size_t                 imported_sz;
+    uint32_t               import_flags;
+
+    import_flags = bplib_cla_import_flags(flow_ref);
+
+    /* the bundles of an intf can use the blocks it has set aside, if the pool is too full */
+    flow         = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    prev_reserve = bplib_mpool_reserve_enter((flow != NULL) ? &flow->reserve : NULL);
+
+    /*
+     * Note - it is not yet known whether this might be a regular data bundle or a DACS.  If under memory pressure,
+     * then it is critical to allow DACS in, because that should free more blocks, relieving the pressure.
+     * Therefore, the block allocation is done with a high-ish priority here, but if it ends up to be a regular
+     * bundle and there isn't a lot of memory available, this might get discarded later.
+     */
+    pblk = bplib_mpool_bblock_primary_alloc(bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(flow_ref)),
+                                            0, NULL, BPLIB_MPOOL_ALLOC_PRI_MHI, 0);
+    if (pblk != NULL && buffer_ref != NULL)
+    {
+        imported_sz = v7_adopt_full_bundle_in(bplib_mpool_bblock_primary_cast(pblk), buffer_ref, size, import_flags);
+    }
+    else if (pblk != NULL)
+    {
+        imported_sz = v7_copy_full_bundle_in(bplib_mpool_bblock_primary_cast(pblk), content, size, import_flags);
+    }
+    else
+    {
+        imported_sz = 0;
+    }
+
+    /*
+     * normally the size from the CLA and the size computed from CBOR decoding should agree.
+     * For now considering it an error if they do not.  In a frame more bundles may follow this
+     * one, so then it only has to fit.
+     */
+    if (consumed != NULL)
+    {
+        if (imported_sz != 0 && imported_sz < size)
+        {
+            size = imported_sz;
+        }
+        *consumed = size;
+    }
+
+    rblk = bplib_generic_bundle_make_ingress(flow_ref, pblk, imported_sz == size);
+    bplib_mpool_reserve_leave(prev_reserve);
+
+    return rblk;
+}
+
+/*
+ * Same as bplib_generic_bundle_ingress(), but if rtbl is not NULL a bundle which qualifies is sent
+ * straight to the egress of its next hop by bplib_route_ingress_cut_through().  If queued is not
+ * NULL, it is set false in that case, as then there is nothing for the maintenance thread to do.
+ */
+static int bplib_generic_bundle_ingress_direct(bplib_routetbl_t *rtbl, bplib_mpool_ref_t flow_ref, const void *content,
+                                               size_t size, uint64_t time_limit, bool *queued)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *rblk;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+    else
+    {
+        /* a bundle over the memory quota of the intf is turned away before anything is allocated for it */
+        status = bplib_mpool_flow_quota_admit(flow, size);
+    }
+
+    if (flow != NULL && status == BP_SUCCESS)
+    {
+        rblk = bplib_generic_bundle_import(flow_ref, content, size, NULL, NULL);
+        if (rblk == NULL)
+        {
+            status = BP_ERROR;
+        }
+        else if (rtbl != NULL && bplib_route_ingress_cut_through(rtbl, rblk))
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, 1);
+            if (queued != NULL)
+            {
+                *queued = false;
+            }
+            status = BP_SUCCESS;
+        }
+        else if (bplib_mpool_flow_try_push(&flow->ingress, rblk, time_limit))
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, 1);
+            status = BP_SUCCESS;
+        }
+        else
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_drop_queue_full, 1);
+            bplib_mpool_recycle_block(rblk);
+            status = BP_TIMEOUT;
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Same as bplib_generic_bundle_ingress(), but the bundle is only copied into a CBOR block here, and that goes
+ * in the ingress queue as it is.  It is decoded by bplib_cla_decode_ingress() when it is taken from the queue.
+ * A bundle that does not fit in one block is decoded here as usual.
+ */
+static int bplib_generic_bundle_ingress_raw(bplib_mpool_ref_t flow_ref, const void *content, size_t size,
+                                            uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *cblk;
+    bplib_mpool_block_t *rblk;
+    bplib_mpool_ref_t    refptr;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+
+    /* the quota is charged when it is decoded, but a bundle over it now is not let in at all */
+    status = bplib_mpool_flow_quota_admit(flow, size);
+    if (status != BP_SUCCESS)
+    {
+        return status;
+    }
+
+    cblk = bplib_mpool_bblock_cbor_alloc_sized(
+        bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(flow_ref)), size);
+    if (cblk != NULL && bplib_mpool_get_generic_data_capacity(cblk) < size)
+    {
+        bplib_mpool_recycle_block(cblk);
+        cblk = NULL;
+    }
+
+    if (cblk == NULL)
+    {
+        return bplib_generic_bundle_ingress(flow_ref, content, size, time_limit);
+    }
+
+    memcpy(bplib_mpool_bblock_cbor_cast(cblk), content, size);
+    bplib_mpool_bblock_cbor_set_size(cblk, size);
+
+    rblk   = NULL;
+    refptr = bplib_mpool_ref_create(cblk);
+    if (refptr == NULL)
+    {
+        bplib_mpool_recycle_block(cblk);
+    }
+    else
+    {
+        /* the queue entry holds its own ref, so the block stays until it is decoded */
+        rblk = bplib_mpool_ref_make_block(refptr, BPLIB_BLOCKTYPE_CLA_INGRESS_RAW, NULL);
+        bplib_mpool_ref_release(refptr);
+    }
+
+    if (rblk == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate raw ingress block\n");
+    }
+    else if (bplib_mpool_flow_try_push(&flow->ingress, rblk, time_limit))
+    {
+        bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, 1);
+        status = BP_SUCCESS;
+    }
+    else
+    {
+        bplib_cla_count(flow_ref, bplib_cla_counter_drop_queue_full, 1);
+        bplib_mpool_recycle_block(rblk);
+        status = BP_TIMEOUT;
+    }
+
+    return status;
+}
+
+bplib_mpool_block_t *bplib_cla_decode_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk)
+{
+    bplib_mpool_ref_t    flow_ref;
+    bplib_mpool_ref_t    buffer_ref;
+    bplib_mpool_block_t *rblk;
+
+    /* only bundles from an intf with BPLIB_CLA_INTF_DEFER_DECODE are still in the form they came in */
+    if (bplib_mpool_generic_data_cast(qblk, BPLIB_BLOCKTYPE_CLA_INGRESS_RAW) == NULL)
+    {
+        return qblk;
+    }
+
+    /* the bundle is adopted as for bplib_cla_ingress_adopt(), its blocks refer to the data where it is */
+    buffer_ref = bplib_mpool_ref_from_block(qblk);
+    bplib_mpool_recycle_block(qblk);
+
+    rblk     = NULL;
+    flow_ref = bplib_mpool_ref_create(intf_block);
+    if (flow_ref != NULL && buffer_ref != NULL)
+    {
+        rblk = bplib_generic_bundle_import(flow_ref, NULL,
+                                           bplib_mpool_get_user_content_size(bplib_mpool_dereference(buffer_ref)),
+                                           buffer_ref, NULL);
+    }
+
+    bplib_mpool_ref_release(buffer_ref);
+    bplib_mpool_ref_release(flow_ref);
+
+    return rblk;
+}
+
+int bplib_generic_bundle_ingress(bplib_mpool_ref_t flow_ref, const void *content, size_t size, uint64_t time_limit)
+{
+    return bplib_generic_bundle_ingress_direct(NULL, flow_ref, content, size, time_limit, NULL);
+}
+
+int bplib_generic_bundle_ingress_frame(bplib_mpool_ref_t flow_ref, const void *content, size_t size,
+                                       uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *rblk;
+    const uint8_t       *in_p;
+    size_t               consumed;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+
+    /* the frame as a whole has to be under the memory quota of the intf */
+    status = bplib_mpool_flow_quota_admit(flow, size);
+    if (status != BP_SUCCESS)
+    {
+        return status;
+    }
+
+    /*
+     * Each bundle is pushed as soon as it is decoded.  If one fails, the bundles before it have
+     * already gone on, and the rest of the frame cannot be found so it is dropped.
+     */
+    in_p = content;
+    do
+    {
+        consumed = 0;
+        rblk     = bplib_generic_bundle_import(flow_ref, in_p, size, NULL, &consumed);
+        if (rblk == NULL)
+        {
+            status = BP_ERROR;
+        }
+        else if (bplib_mpool_flow_try_push(&flow->ingress, rblk, time_limit))
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, 1);
+            status = BP_SUCCESS;
+        }
+        else
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_drop_queue_full, 1);
+            bplib_mpool_recycle_block(rblk);
+            status = BP_TIMEOUT;
+        }
+
+        in_p += consumed;
+        size -= consumed;
+    } while (status == BP_SUCCESS && size > 0);
+
+    return status;
+}
+
+int bplib_generic_bundle_ingress_adopt(bplib_mpool_ref_t flow_ref, bplib_mpool_ref_t buffer_ref, size_t size,
+                                       uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *rblk;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+    else
+    {
+        /* same as bplib_generic_bundle_ingress_direct() */
+        status = bplib_mpool_flow_quota_admit(flow, size);
+    }
+
+    if (flow != NULL && status == BP_SUCCESS)
+    {
+        rblk = bplib_generic_bundle_import(flow_ref, NULL, size, buffer_ref, NULL);
+        if (rblk == NULL)
+        {
+            status = BP_ERROR;
+        }
+        else if (bplib_mpool_flow_try_push(&flow->ingress, rblk, time_limit))
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, 1);
+            status = BP_SUCCESS;
+        }
+        else
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_drop_queue_full, 1);
+            bplib_mpool_recycle_block(rblk);
+            status = BP_TIMEOUT;
+        }
+    }
+
+    return status;
+}
+
+int bplib_generic_bundle_ingress_stream(bplib_mpool_ref_t flow_ref, bplib_cla_ingress_stream_t *stream,
+                                        uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *rblk;
+    bplib_mpool_block_t *pblk;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+    else
+    {
+        /* the bundle is taken from the stream here, whatever happens to it */
+        pblk         = stream->pblk;
+        stream->pblk = NULL;
+
+        rblk = bplib_generic_bundle_make_ingress(flow_ref, pblk, v7_stream_import_end(&stream->import) != 0);
+        if (rblk == NULL)
+        {
+            status = BP_ERROR;
+        }
+        else if (bplib_mpool_flow_try_push(&flow->ingress, rblk, time_limit))
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, 1);
+            status = BP_SUCCESS;
+        }
+        else
+        {
+            bplib_cla_count(flow_ref, bplib_cla_counter_drop_queue_full, 1);
+            bplib_mpool_recycle_block(rblk);
+            status = BP_TIMEOUT;
+        }
+    }
+
+    return status;
+}
+
+int bplib_generic_bundle_ingress_batch(bplib_mpool_ref_t flow_ref, const bplib_cla_bundle_buf_t *bundles,
+                                       uint32_t count, int *status_list, uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *rblk;
+    bplib_mpool_block_t  pending_list;
+    uint32_t             i;
+    uint32_t             num_imported;
+    uint32_t             num_pushed;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+        for (i = 0; i < count; ++i)
+        {
+            status_list[i] = status;
+        }
+        return status;
+    }
+
+    /*
+     * All the decoding is done before touching the queue, so it only needs to be locked once.  Each bundle
+     * that is imported is marked BP_SUCCESS for now, and those which do not fit in the queue are changed
+     * to BP_TIMEOUT after.  Those over the memory quota of the intf get the status from the quota.
+     */
+    bplib_mpool_init_list_head(NULL, &pending_list);
+    num_imported = 0;
+    for (i = 0; i < count; ++i)
+    {
+        status_list[i] = bplib_mpool_flow_quota_admit(flow, bundles[i].size);
+        if (status_list[i] != BP_SUCCESS)
+        {
+            continue;
+        }
+
+        rblk = bplib_generic_bundle_import(flow_ref, bundles[i].bundle, bundles[i].size, NULL, NULL);
+        if (rblk == NULL)
+        {
+            status_list[i] = BP_ERROR;
+        }
+        else
+        {
+            bplib_mpool_insert_before(&pending_list, rblk);
+            ++num_imported;
+        }
+    }
+
+    if (num_imported != 0)
+    {
+        num_pushed = bplib_mpool_flow_try_push_n(&flow->ingress, &pending_list, num_imported, time_limit);
+    }
+    else
+    {
+        num_pushed = 0;
+    }
+
+    bplib_cla_count(flow_ref, bplib_cla_counter_ingress_bundles, num_pushed);
+    bplib_cla_count(flow_ref, bplib_cla_counter_drop_queue_full, num_imported - num_pushed);
+
+    /* the queue takes blocks from the head of the list, so the ones pushed are the first ones imported */
+    status = BP_SUCCESS;
+    for (i = 0; i < count; ++i)
+    {
+        if (status_list[i] == BP_SUCCESS)
+        {
+            if (num_pushed != 0)
+            {
+                --num_pushed;
+            }
+            else
+            {
+                status_list[i] = BP_TIMEOUT;
+            }
+        }
+
+        if (status == BP_SUCCESS)
+        {
+            status = status_list[i];
+        }
+    }
+
+    /* anything left over did not fit in the queue in time */
+    bplib_mpool_recycle_all_blocks_in_list(bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(flow_ref)),
+                                           &pending_list);
+
+    return status;
+}
+
+/*
+ * Indicates that a bundle of the given encoded size has been sent out the intf
+ */
+static void bplib_cla_mark_egress(bplib_mpool_ref_t flow_ref, bplib_mpool_bblock_primary_t *cpb, size_t size,
+                                  uint64_t now)
+{
+    cpb->data.delivery.egress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(flow_ref));
+    cpb->data.delivery.egress_time    = bplib_cla_egress_time(flow_ref, size);
+    bplib_cla_count_egress(flow_ref, cpb, now);
+}
+
+/*
+ * Takes over a bundle that was pulled from the egress queue, for when it has to be kept after the call
+ * that pulled it.  Bundles in the egress queue are normally ref blocks, in which case this takes another
+ * ref to the bundle and the ref block can go.  Otherwise the block itself becomes managed by the ref.
+ * Either way the block is not used after this, and this returns NULL if there is no ref.
+ */
+static bplib_mpool_ref_t bplib_cla_egress_take_ref(bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_ref_t refptr;
+
+    refptr = bplib_mpool_ref_from_block(pblk);
+    if (refptr != NULL)
+    {
+        bplib_mpool_recycle_block(pblk);
+    }
+    else
+    {
+        refptr = bplib_mpool_ref_create(pblk);
+        if (refptr == NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+    }
+
+    return refptr;
+}
+
+/*
+ * Encodes a bundle that was pulled from the egress queue of the interface into the buffer.
+ * The block itself is left to the caller.
+ */
+static int bplib_generic_bundle_export(bplib_mpool_ref_t flow_ref, bplib_mpool_block_t *pblk, void *content,
+                                       size_t *size)
+{
+    bplib_mpool_bblock_primary_t *cpb;
+    size_t                        export_sz;
+    size_t                        copied_sz;
+    uint64_t                      now;
+    int                           status;
+
+    now = bplib_os_get_dtntime_ms();
+    cpb = bplib_mpool_bblock_primary_cast(pblk);
+    if (cpb == NULL)
+    {
+        /* entry wasn't a bundle? */
+        status = BP_ERROR;
+    }
+    else if (bplib_cla_bundle_expired(cpb, now))
+    {
+        /* no use sending it, the next hop would only drop it */
+        bplib_cla_count(flow_ref, bplib_cla_counter_drop_expired, 1);
+        status = BP_ERROR;
+    }
+    else if (cpb->block_encode_size_cache == 0)
+    {
+        /* the primary block was left to be encoded here, see bplib_socket_set_egress_encode() */
+        copied_sz = v7_encode_full_bundle_out(cpb, content, *size);
+        if (copied_sz == 0)
+        {
+            /* buffer too small */
+            status = BP_ERROR;
+        }
+        else
+        {
+            bplib_cla_mark_egress(flow_ref, cpb, copied_sz, now);
+            status = BP_SUCCESS;
+            *size  = copied_sz;
+        }
+    }
+    else
+    {
+        export_sz = v7_compute_full_bundle_size(cpb);
+
+        if (export_sz > *size)
+        {
+            /* buffer too small */
+            status = BP_ERROR;
+        }
+        else
+        {
+            copied_sz = v7_copy_full_bundle_out(cpb, content, *size);
+
+            if (export_sz != copied_sz)
+            {
+                /* something went wrong during copy */
+                status = BP_ERROR;
+            }
+            else
+            {
+                bplib_cla_mark_egress(flow_ref, cpb, copied_sz, now);
+                status = BP_SUCCESS;
+            }
+
+            *size = copied_sz;
+        }
+    }
+
+    return status;
+}
+
+int bplib_generic_bundle_egress(bplib_mpool_ref_t flow_ref, void *content, size_t *size, uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *pblk;
+    int                  status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+    else
+    {
+        /* this removes it from the list */
+        /* NOTE: after this point a valid bundle has to be put somewhere (either onto another queue or recycled) */
+        pblk = bplib_mpool_flow_try_pull(&flow->egress, time_limit);
+        if (pblk == NULL)
+        {
+            /* queue is empty */
+            status = BP_TIMEOUT;
+        }
+        else
+        {
+            status = bplib_generic_bundle_export(flow_ref, pblk, content, size);
+            bplib_mpool_recycle_block(pblk);
+        }
+    }
+
+    return status;
+}
+
+int bplib_generic_bundle_egress_frame(bplib_mpool_ref_t flow_ref, bplib_cla_framing_t *framing, void *content,
+                                      size_t *size, uint64_t time_limit)
+{
+    bplib_mpool_flow_t           *flow;
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *cpb;
+    uint8_t                      *out_p;
+    size_t                        frame_limit;
+    size_t                        used_sz;
+    size_t                        chunk_sz;
+    int                           status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+
+    /* the first bundle can use the whole buffer, as if it were not framed, the rest have to fit in the mtu */
+    frame_limit = *size;
+    if (framing->mtu < frame_limit)
+    {
+        frame_limit = framing->mtu;
+    }
+
+    out_p   = content;
+    used_sz = 0;
+    status  = BP_TIMEOUT;
+    while (true)
+    {
+        /* NOTE: after this point a valid bundle has to be put somewhere (either held over or recycled) */
+        pblk = framing->holdover;
+        if (pblk != NULL)
+        {
+            framing->holdover = NULL;
+        }
+        else
+        {
+            pblk = bplib_mpool_flow_try_pull(&flow->egress, time_limit);
+            if (pblk == NULL)
+            {
+                /* queue is empty, or nothing more came within the frame wait */
+                break;
+            }
+        }
+
+        if (used_sz == 0)
+        {
+            chunk_sz = *size;
+        }
+        else
+        {
+            cpb = bplib_mpool_bblock_primary_cast(pblk);
+            if (cpb != NULL && (used_sz + v7_compute_full_bundle_size(cpb)) > frame_limit)
+            {
+                /* this goes at the start of the next frame */
+                framing->holdover = pblk;
+                break;
+            }
+            chunk_sz = frame_limit - used_sz;
+        }
+
+        /* a bundle that cannot be sent is dropped, as in bplib_generic_bundle_egress() */
+        status = bplib_generic_bundle_export(flow_ref, pblk, out_p + used_sz, &chunk_sz);
+        bplib_mpool_recycle_block(pblk);
+
+        if (status == BP_SUCCESS)
+        {
+            if (used_sz == 0)
+            {
+                /* the frame is open from now, for no longer than the frame wait */
+                time_limit = bplib_os_get_dtntime_coarse_ms() + framing->max_wait;
+            }
+            used_sz += chunk_sz;
+        }
+        else if (used_sz == 0)
+        {
+            break;
+        }
+
+        status = BP_SUCCESS;
+        if (used_sz >= frame_limit)
+        {
+            /* full, or not packing at all and only the held over bundle was sent */
+            break;
+        }
+    }
+
+    *size = used_sz;
+    return status;
+}
+
+int bplib_generic_bundle_egress_batch(bplib_mpool_ref_t flow_ref, bplib_cla_egress_buf_t *buffers, uint32_t count,
+                                      uint32_t *num_filled, uint64_t time_limit)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_block_t *pblk;
+    bplib_mpool_block_t  batch;
+    uint32_t             pulled;
+    uint32_t             filled;
+    size_t               size;
+    int                  status;
+
+    filled = 0;
+    flow   = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+    else
+    {
+        /* This waits for the first bundle, then takes whatever else is ready, up to one per buffer */
+        bplib_mpool_init_list_head(NULL, &batch);
+        pulled = bplib_mpool_flow_try_pull_n(&flow->egress, &batch, count, time_limit);
+        if (pulled == 0)
+        {
+            /* queue is empty */
+            status = BP_TIMEOUT;
+        }
+        else
+        {
+            /* the bundles sent are all recycled together after the last one */
+            bplib_mpool_release_defer_begin(
+                bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(flow_ref)));
+            while (pulled > 0)
+            {
+                pblk = bplib_mpool_get_next_block(&batch);
+                bplib_mpool_extract_node(pblk);
+                --pulled;
+
+                /* a bundle that cannot be sent is dropped, as in bplib_generic_bundle_egress(),
+                 * and the buffer is used for the next one instead */
+                size = buffers[filled].size;
+                if (bplib_generic_bundle_export(flow_ref, pblk, buffers[filled].bundle, &size) == BP_SUCCESS)
+                {
+                    buffers[filled].size = size;
+                    ++filled;
+                }
+
+                bplib_mpool_recycle_block(pblk);
+            }
+            bplib_mpool_release_defer_end();
+
+            if (filled != 0)
+            {
+                status = BP_SUCCESS;
+            }
+            else
+            {
+                status = BP_ERROR;
+            }
+        }
+    }
+
+    *num_filled = filled;
+    return status;
+}
+
+int bplib_generic_bundle_egress_iov(bplib_mpool_ref_t flow_ref, bplib_iovec_t *iov, uint32_t *iov_count,
+                                    bplib_mpool_ref_t *bundle_ref, size_t *size, uint64_t time_limit)
+{
+    bplib_mpool_flow_t           *flow;
+    bplib_mpool_bblock_primary_t *cpb;
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_ref_t             refptr;
+    size_t                        iov_needed;
+    uint64_t                      now;
+    int                           status;
+
+    *bundle_ref = NULL;
+    flow        = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+
+    pblk = bplib_mpool_flow_try_pull(&flow->egress, time_limit);
+    if (pblk == NULL)
+    {
+        /* queue is empty */
+        return BP_TIMEOUT;
+    }
+
+    /* The iov entries point into the bundle, so it has to be kept until the caller is done with them */
+    refptr = bplib_cla_egress_take_ref(pblk);
+
+    now = bplib_os_get_dtntime_ms();
+    cpb = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
+    if (cpb == NULL)
+    {
+        /* entry wasn't a bundle? */
+        status = BP_ERROR;
+    }
+    else if (bplib_cla_bundle_expired(cpb, now))
+    {
+        bplib_cla_count(flow_ref, bplib_cla_counter_drop_expired, 1);
+        status = BP_ERROR;
+    }
+    else
+    {
+        /* this also makes sure every block is encoded, which the iov export needs */
+        *size      = v7_compute_full_bundle_size(cpb);
+        iov_needed = v7_export_full_bundle_iov(cpb, iov, *iov_count);
+
+        if (iov_needed > *iov_count)
+        {
+            /* not enough entries, as with a buffer that is too small this drops the bundle */
+            status = BP_ERROR;
+        }
+        else
+        {
+            bplib_cla_mark_egress(flow_ref, cpb, *size, now);
+            status = BP_SUCCESS;
+        }
+
+        *iov_count = iov_needed;
+    }
+
+    if (status == BP_SUCCESS)
+    {
+        *bundle_ref = refptr;
+    }
+    else if (refptr != NULL)
+    {
+        bplib_mpool_ref_release(refptr);
+    }
+
+    return status;
+}
+
+int bplib_generic_bundle_egress_stream(bplib_mpool_ref_t flow_ref, bplib_cla_egress_stream_t *stream, size_t *size,
+                                       uint64_t time_limit)
+{
+    bplib_mpool_flow_t           *flow;
+    bplib_mpool_bblock_primary_t *cpb;
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_ref_t             refptr;
+    uint64_t                      now;
+    int                           status;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+    }
+
+    pblk = bplib_mpool_flow_try_pull(&flow->egress, time_limit);
+    if (pblk == NULL)
+    {
+        /* queue is empty */
+        return BP_TIMEOUT;
+    }
+
+    /* The bundle is read out of the pool a piece at a time, so it has to be kept until the stream is done */
+    refptr = bplib_cla_egress_take_ref(pblk);
+
+    now = bplib_os_get_dtntime_ms();
+    cpb = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
+    if (cpb == NULL)
+    {
+        /* entry wasn't a bundle? */
+        status = BP_ERROR;
+    }
+    else if (bplib_cla_bundle_expired(cpb, now))
+    {
+        bplib_cla_count(flow_ref, bplib_cla_counter_drop_expired, 1);
+        status = BP_ERROR;
+    }
+    else
+    {
+        *size = v7_stream_export_begin(&stream->export, cpb);
+        if (*size == 0)
+        {
+            /* it could not be encoded, so there is nothing to send */
+            status = BP_ERROR;
+        }
+        else
+        {
+            bplib_cla_mark_egress(flow_ref, cpb, *size, now);
+            status = BP_SUCCESS;
+        }
+    }
+
+    if (status == BP_SUCCESS)
+    {
+        stream->bundle_ref = refptr;
+    }
+    else if (refptr != NULL)
+    {
+        bplib_mpool_ref_release(refptr);
+    }
+
+    return status;
+}
+
+/*
+ * Copies the logical data of the extension blocks of one bundle into another.  Only the blocks that
+ * must be replicated are copied unless all_blocks is set, and the copies are encoded when the size
+ * of the bundle is computed, the same as for any block which is not yet encoded.
+ */
+static int bplib_cla_copy_extension_blocks(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t *dst,
+                                           bplib_mpool_bblock_primary_t *src, bool all_blocks)
+{
+    bplib_mpool_block_t            *blk;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *src_ccb;
+    bplib_mpool_bblock_canonical_t *dst_ccb;
+    bp_canonical_block_buffer_t    *logical;
+
+    /* appending puts every block but the payload first, so going backwards keeps the order */
+    blk = bplib_mpool_bblock_primary_get_canonical_list(src);
+    while (true)
+    {
+        blk = bplib_mpool_get_prev_block(blk);
+        if (bplib_mpool_is_list_head(blk))
+        {
+            break;
+        }
+
+        src_ccb = bplib_mpool_bblock_canonical_cast(blk);
+        if (src_ccb == NULL)
+        {
+            continue;
+        }
+
+        logical = bplib_mpool_bblock_canonical_get_logical(src_ccb);
+        if (logical->canonical_block.blockType == bp_blocktype_payloadBlock ||
+            (!all_blocks && !logical->canonical_block.processingControlFlags.must_replicate))
+        {
+            continue;
+        }
+
+        /* the copy is encoded from its logical data, so that has to be decoded */
+        if (v7_block_decode_canonical_data(src_ccb) != 0)
+        {
+            return BP_ERROR;
+        }
+
+        cblk    = bplib_mpool_bblock_canonical_alloc(pool, 0, NULL);
+        dst_ccb = bplib_mpool_bblock_canonical_cast(cblk);
+        if (dst_ccb == NULL)
+        {
+            return BP_ERROR;
+        }
+
+        *bplib_mpool_bblock_canonical_get_logical(dst_ccb) = *logical;
+        bplib_mpool_bblock_primary_append(dst, cblk);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Adds a payload block to a bundle, with the same block information as the payload block of another one
+ */
+static int bplib_cla_add_payload(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t *dst,
+                                 bplib_mpool_bblock_canonical_t *src_pay, const void *content, size_t size)
+{
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+
+    cblk = bplib_mpool_bblock_canonical_alloc(pool, 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (ccb == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    *bplib_mpool_bblock_canonical_get_logical(ccb) = *bplib_mpool_bblock_canonical_get_logical(src_pay);
+    if (v7_block_encode_pay(ccb, content, size) < 0)
+    {
+        bplib_mpool_recycle_block(cblk);
+        return BP_ERROR;
+    }
+
+    bplib_mpool_bblock_primary_append(dst, cblk);
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Copies part of the content of a payload block out, the seek position is relative to the content
+ */
+static size_t bplib_cla_export_payload(bplib_mpool_bblock_canonical_t *pay, void *out, size_t seek, size_t length)
+{
+    return bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_canonical_get_encoded_chunks(pay), out, length,
+                                          bplib_mpool_bblock_canonical_get_content_offset(pay) + seek, length);
+}
+
+/*
+ * Turns a new bundle into a dynamically-managed ref, and gets a block for it that can go in a queue.
+ * The bundle is recycled if that does not work.
+ */
+static bplib_mpool_block_t *bplib_cla_make_bundle_ref_block(bplib_mpool_block_t *pblk, uint32_t magic_number)
+{
+    bplib_mpool_ref_t    refptr;
+    bplib_mpool_block_t *rblk;
+
+    refptr = bplib_mpool_ref_create(pblk);
+    if (refptr == NULL)
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    /* the block holds its own ref, so if it was not made the bundle goes away here */
+    rblk = bplib_mpool_ref_make_block(refptr, magic_number, NULL);
+    bplib_mpool_ref_release(refptr);
+
+    return rblk;
+}
+
+/*
+ * Makes one fragment of a bundle.  The content is just working space, as big as the fragment payload.
+ * The offset is relative to the payload of the bundle, which may itself already be a fragment.
+ */
+static bplib_mpool_block_t *bplib_cla_fragment_make(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t *cpb,
+                                                    bplib_mpool_bblock_canonical_t *pay, void *content, size_t offset,
+                                                    size_t length)
+{
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *frag;
+    bp_primary_block_t           *pri;
+
+    pblk = bplib_mpool_bblock_primary_alloc(pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MLO, 0);
+    frag = bplib_mpool_bblock_primary_cast(pblk);
+    if (frag == NULL)
+    {
+        return NULL;
+    }
+
+    /* the fragments go on as the same bundle, as far as this node is concerned */
+    frag->data = cpb->data;
+    pri        = bplib_mpool_bblock_primary_get_logical(frag);
+
+    /* the refs are not duplicated, the original bundle is the one counted when it goes */
+    frag->data.delivery.trace_ref      = NULL;
+    frag->data.delivery.completion_ref = NULL;
+    frag->data.delivery.quota_ref      = NULL;
+    frag->data.delivery.quota_charge   = 0;
+    if (pri->controlFlags.isFragment)
+    {
+        pri->fragmentOffset += offset;
+    }
+    else
+    {
+        pri->controlFlags.isFragment = true;
+        pri->fragmentOffset          = offset;
+        pri->totalADUlength          = bplib_mpool_bblock_canonical_get_content_length(pay);
+    }
+
+    /* blocks which are not replicated only go in the first fragment */
+    if (bplib_cla_copy_extension_blocks(pool, frag, cpb, (offset == 0)) != BP_SUCCESS ||
+        bplib_cla_export_payload(pay, content, offset, length) != length ||
+        bplib_cla_add_payload(pool, frag, pay, content, length) != BP_SUCCESS || v7_compute_full_bundle_size(frag) == 0)
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    return bplib_cla_make_bundle_ref_block(pblk, BPLIB_BLOCKTYPE_CLA_FRAGMENT_BLOCK);
+}
+
+/*
+ * Sends a bundle which is bigger than the fragment MTU as fragments.  Each fragment has what is left of
+ * the MTU after the primary block, the extension blocks it carries and the payload block header, so the
+ * sizes of those in the original bundle are used, with room for the fragment fields in the primary block.
+ *
+ * If all the fragments were pushed to the egress queue the original bundle is recycled.  Otherwise it is
+ * left to the caller, as not sent, because the next hop cannot do anything with only some of them.
+ */
+static int bplib_cla_fragment_egress(bplib_cla_fragmentation_t *frag, bplib_mpool_block_t *intf_block,
+                                     bplib_mpool_flow_t *flow, bplib_mpool_bblock_primary_t *cpb,
+                                     bplib_mpool_block_t *cb)
+{
+    bplib_mpool_t                  *pool;
+    bplib_mpool_block_t            *blk;
+    bplib_mpool_block_t            *fblk;
+    bplib_mpool_block_t             frag_list;
+    bplib_mpool_bblock_canonical_t *pay;
+    bplib_mpool_bblock_canonical_t *ccb;
+    void                           *content;
+    size_t                          content_length;
+    size_t                          overhead;
+    size_t                          first_extra;
+    size_t                          rest_extra;
+    size_t                          offset;
+    size_t                          length;
+    uint32_t                        count;
+    int                             status;
+
+    pool = bplib_mpool_get_parent_pool_from_link(intf_block);
+    pay  = bplib_mpool_bblock_canonical_cast(
+        bplib_mpool_bblock_primary_locate_canonical(cpb, bp_blocktype_payloadBlock));
+    if (pay == NULL || bplib_mpool_bblock_canonical_get_content_length(pay) == 0)
+    {
+        /* nothing that can be split up, so it goes whole */
+        return bplib_mpool_flow_try_push(&flow->egress, cb, 0) ? BP_SUCCESS : BP_ERROR;
+    }
+
+    content_length = bplib_mpool_bblock_canonical_get_content_length(pay);
+    overhead       = 2 + cpb->block_encode_size_cache + BPLIB_CLA_FRAGMENT_PRI_EXTRA + pay->block_encode_size_cache -
+               content_length;
+
+    /* the first fragment has every extension block, which is all of the bundle besides these two */
+    first_extra = v7_compute_full_bundle_size(cpb) - 2 - cpb->block_encode_size_cache - pay->block_encode_size_cache;
+
+    /* the rest only have the blocks which must be replicated */
+    rest_extra = 0;
+    blk        = bplib_mpool_bblock_primary_get_canonical_list(cpb);
+    while (true)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        ccb = bplib_mpool_bblock_canonical_cast(blk);
+        if (ccb == NULL)
+        {
+            break;
+        }
+
+        if (ccb != pay &&
+            bplib_mpool_bblock_canonical_get_logical(ccb)->canonical_block.processingControlFlags.must_replicate)
+        {
+            rest_extra += ccb->block_encode_size_cache;
+        }
+    }
+
+    if (frag->mtu <= (overhead + first_extra))
+    {
+        /* the MTU does not even fit the blocks, so splitting up the payload cannot help */
+        return bplib_mpool_flow_try_push(&flow->egress, cb, 0) ? BP_SUCCESS : BP_ERROR;
+    }
+
+    /* the later fragments carry fewer blocks, so they have the most room */
+    length = frag->mtu - overhead - rest_extra;
+    if (length > content_length)
+    {
+        length = content_length;
+    }
+
+    content = bplib_os_calloc(length);
+    if (content == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate fragment buffer\n");
+        return BP_ERROR;
+    }
+
+    bplib_mpool_init_list_head(NULL, &frag_list);
+    count = 0;
+    for (offset = 0; offset < content_length; offset += length)
+    {
+        length = frag->mtu - overhead - ((offset == 0) ? first_extra : rest_extra);
+        if (length > (content_length - offset))
+        {
+            length = content_length - offset;
+        }
+
+        fblk = bplib_cla_fragment_make(pool, cpb, pay, content, offset, length);
+        if (fblk == NULL)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to make bundle fragment\n");
+            break;
+        }
+
+        bplib_mpool_insert_before(&frag_list, fblk);
+        ++count;
+    }
+
+    bplib_os_free(content);
+
+    status = BP_ERROR;
+    if (offset >= content_length && bplib_mpool_flow_try_push_n(&flow->egress, &frag_list, count, 0) == count)
+    {
+        /* whatever is tracking the bundle sees it go out here, rather than the fragments */
+        cpb->data.delivery.egress_intf_id = bplib_mpool_get_external_id(intf_block);
+        cpb->data.delivery.egress_time    = bplib_os_get_dtntime_ms();
+        bplib_serviceflow_trace_egress(cpb, cpb->data.delivery.egress_time);
+        BPLIB_TRACEPOINT_BUNDLE(cla_egress, cpb, bp_handle_printable(cpb->data.delivery.egress_intf_id));
+        __atomic_fetch_add(&frag->fragmented, 1, __ATOMIC_RELAXED);
+
+        bplib_mpool_recycle_block(cb);
+        status = BP_SUCCESS;
+    }
+
+    /* anything still here was not pushed */
+    bplib_mpool_recycle_all_blocks_in_list(pool, &frag_list);
+
+    return status;
+}
+
+bool bplib_cla_is_intf(bplib_mpool_block_t *intf_block)
+{
+    return (bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_CLA_INTF) != NULL);
+}
+
+int bplib_cla_push_egress_bundle(bplib_mpool_flow_t *flow, bplib_mpool_block_t *cb)
+{
+    bplib_mpool_block_t          *intf_block;
+    bplib_mpool_bblock_primary_t *cpb;
+    bplib_cla_stats_t            *stats;
+    bplib_cla_fragmentation_t    *frag;
+
+    /* the intf may not be a CLA, in which case this is just a push */
+    intf_block = bplib_mpool_get_block_from_link(&flow->egress.job_header.link);
+    stats      = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_CLA_INTF);
+    frag       = NULL;
+    if (stats != NULL)
+    {
+        frag = __atomic_load_n(&stats->fragmentation, __ATOMIC_ACQUIRE);
+    }
+
+    /* a bundle which must not be fragmented is sent whole, and the CLA has to cope with it */
+    cpb = bplib_mpool_bblock_primary_cast(cb);
+    if (frag != NULL && frag->mtu != 0 && cpb != NULL && !cpb->data.logical.controlFlags.mustNotFragment &&
+        v7_compute_full_bundle_size(cpb) > frag->mtu)
+    {
+        return bplib_cla_fragment_egress(frag, intf_block, flow, cpb, cb);
+    }
+
+    return bplib_mpool_flow_try_push(&flow->egress, cb, 0) ? BP_SUCCESS : BP_ERROR;
+}
+
+/*
+ * Gets the reassembly entry from its link in the time index
+ */
+static inline bplib_cla_reassembly_t *bplib_cla_reassembly_from_time_link(const bplib_rbt_link_t *link)
+{
+    return (bplib_cla_reassembly_t *)(void *)((uint8_t *)link - offsetof(bplib_cla_reassembly_t, time_rbt_link));
+}
+
+/*
+ * Key of a bundle in the reassembly index, fragments of the same bundle have the same source,
+ * creation timestamp and total ADU length.  Different bundles with the same key are told apart
+ * by bplib_cla_reassembly_match().
+ */
+static bp_val_t bplib_cla_reassembly_key(const bp_primary_block_t *pri)
+{
+    bp_ipn_addr_t source;
+    bp_val_t      key;
+
+    v7_get_eid(&source, &pri->sourceEID);
+
+    key = source.node_number;
+    key = (key * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ source.service_number;
+    key = (key * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ pri->creationTimeStamp.time;
+    key = (key * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ pri->creationTimeStamp.sequence_num;
+    key = (key * BPLIB_CLA_REASSEMBLY_HASH_MULT) ^ pri->totalADUlength;
+
+    return key;
+}
+
+static int bplib_cla_reassembly_match(const bplib_rbt_link_t *node, void *arg)
+{
+    const bplib_cla_reassembly_t *entry;
+    const bp_primary_block_t     *pri;
+    int                           result;
+
+    /* because hash_rbt_link is the first element */
+    entry = (const bplib_cla_reassembly_t *)node;
+    pri   = arg;
+
+    result = v7_compare_numeric(pri->creationTimeStamp.sequence_num, entry->creation.sequence_num);
+    if (result == 0)
+    {
+        result = v7_compare_numeric(pri->creationTimeStamp.time, entry->creation.time);
+    }
+    if (result == 0)
+    {
+        result = v7_compare_numeric(pri->totalADUlength, entry->total_length);
+    }
+    if (result == 0)
+    {
+        result = v7_compare_ipn2eid(&entry->source, &pri->sourceEID);
+    }
+
+    return result;
+}
+
+static int bplib_cla_reassembly_insert_unsorted(const bplib_rbt_link_t *node, void *arg)
+{
+    /* entries with the same time can be in any order, see bplib_cache_entry_tree_insert_unsorted() */
+    return 1;
+}
+
+/*
+ * Gives up on a bundle, or is done with it, and releases all its fragments.  The entry must be in
+ * both indices.  Must be called with the reassembly lock held.
+ */
+static void bplib_cla_reassembly_drop(bplib_cla_fragmentation_t *frag, bplib_cla_reassembly_t *entry)
+{
+    bplib_rbt_iter_t      iter;
+    bplib_cla_fragment_t *fragment;
+
+    while (bplib_rbt_iter_goto_min(0, &entry->fragment_index, &iter) == BP_SUCCESS)
+    {
+        /* because rbt_link is the first element */
+        fragment = (bplib_cla_fragment_t *)(void *)iter.position;
+        bplib_rbt_extract_node(&entry->fragment_index, &fragment->rbt_link);
+        bplib_mpool_ref_release(fragment->bundle_ref);
+        bplib_mpool_recycle_block(fragment->self_ptr);
+    }
+
+    bplib_rbt_extract_node(&frag->adu_index, &entry->hash_rbt_link);
+    bplib_rbt_extract_node(&frag->time_index, &entry->time_rbt_link);
+    frag->held_bytes -= entry->held_bytes;
+    bplib_mpool_recycle_block(entry->self_ptr);
+}
+
+/*
+ * Gives up on the bundles which waited too long, oldest first, then on more of the oldest until there
+ * is room for the given number of bytes.  Must be called with the reassembly lock held.
+ * Returns the number of bundles given up on.
+ */
+static uint32_t bplib_cla_reassembly_expire(bplib_cla_fragmentation_t *frag, uint64_t now, size_t room_needed)
+{
+    bplib_rbt_iter_t iter;
+    uint32_t         count;
+
+    count = 0;
+    while (bplib_rbt_iter_goto_min(0, &frag->time_index, &iter) == BP_SUCCESS)
+    {
+        if (bplib_rbt_get_key_value(iter.position) > now && (frag->held_bytes + room_needed) <= frag->mem_limit)
+        {
+            break;
+        }
+
+        bplib_cla_reassembly_drop(frag, bplib_cla_reassembly_from_time_link(iter.position));
+        ++count;
+    }
+
+    return count;
+}
+
+/*
+ * Checks if the fragments held for a bundle cover all of its ADU, in order of offset
+ */
+static bool bplib_cla_reassembly_is_complete(const bplib_cla_reassembly_t *entry)
+{
+    bplib_rbt_iter_t            iter;
+    const bplib_cla_fragment_t *fragment;
+    bp_val_t                    offset;
+    bp_val_t                    covered;
+    int                         status;
+
+    /* the fragments only add up to the whole ADU if they overlap, so it is not worth a look before */
+    if (entry->held_bytes < entry->total_length)
+    {
+        return false;
+    }
+
+    covered = 0;
+    status  = bplib_rbt_iter_goto_min(0, &entry->fragment_index, &iter);
+    while (status == BP_SUCCESS && covered < entry->total_length)
+    {
+        fragment = (const bplib_cla_fragment_t *)(const void *)iter.position;
+        offset   = bplib_rbt_get_key_value(iter.position);
+        if (offset > covered)
+        {
+            /* there is a gap */
+            break;
+        }
+
+        if ((offset + fragment->length) > covered)
+        {
+            covered = offset + fragment->length;
+        }
+
+        status = bplib_rbt_iter_next(&iter);
+    }
+
+    return (covered >= entry->total_length);
+}
+
+/*
+ * Puts a bundle back together from its fragments, which must cover all of the ADU.  The primary block and
+ * the extension blocks are those of the fragment at offset 0, which has all of them.  Returns a block for
+ * the new bundle which can go in a queue, or NULL if there was no memory.
+ */
+static bplib_mpool_block_t *bplib_cla_reassembly_build(bplib_mpool_t *pool, const bplib_cla_reassembly_t *entry)
+{
+    bplib_rbt_iter_t                iter;
+    const bplib_cla_fragment_t     *fragment;
+    bplib_mpool_block_t            *pblk;
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_primary_t   *frag_cpb;
+    bplib_mpool_bblock_primary_t   *first_cpb;
+    bplib_mpool_bblock_canonical_t *pay;
+    bplib_mpool_bblock_canonical_t *first_pay;
+    bp_primary_block_t             *pri;
+    uint8_t                        *content;
+    bp_val_t                        offset;
+    bp_val_t                        covered;
+    size_t                          length;
+    int                             status;
+
+    content = bplib_os_calloc(entry->total_length);
+    pblk    = bplib_mpool_bblock_primary_alloc(pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MHI, 0);
+    cpb     = bplib_mpool_bblock_primary_cast(pblk);
+
+    first_cpb = NULL;
+    first_pay = NULL;
+    covered   = 0;
+    status    = bplib_rbt_iter_goto_min(0, &entry->fragment_index, &iter);
+    while (status == BP_SUCCESS && content != NULL && covered < entry->total_length)
+    {
+        /* fill in the part of the ADU that the fragments so far did not */
+        fragment = (const bplib_cla_fragment_t *)(const void *)iter.position;
+        offset   = bplib_rbt_get_key_value(iter.position);
+        frag_cpb = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(fragment->bundle_ref));
+        pay      = bplib_mpool_bblock_canonical_cast(
+            bplib_mpool_bblock_primary_locate_canonical(frag_cpb, bp_blocktype_payloadBlock));
+        if (first_cpb == NULL)
+        {
+            first_cpb = frag_cpb;
+            first_pay = pay;
+        }
+
+        if ((offset + fragment->length) > covered)
+        {
+            length = offset + fragment->length - covered;
+            if (pay == NULL || bplib_cla_export_payload(pay, &content[covered], covered - offset, length) != length)
+            {
+                break;
+            }
+            covered += length;
+        }
+
+        status = bplib_rbt_iter_next(&iter);
+    }
+
+    status = BP_ERROR;
+    if (cpb != NULL && first_cpb != NULL && covered >= entry->total_length)
+    {
+        cpb->data = first_cpb->data;
+        pri       = bplib_mpool_bblock_primary_get_logical(cpb);
+
+        pri->controlFlags.isFragment = false;
+        pri->fragmentOffset          = 0;
+        pri->totalADUlength          = 0;
+
+        if (bplib_cla_copy_extension_blocks(pool, cpb, first_cpb, true) == BP_SUCCESS &&
+            bplib_cla_add_payload(pool, cpb, first_pay, content, entry->total_length) == BP_SUCCESS &&
+            v7_compute_full_bundle_size(cpb) != 0)
+        {
+            status = BP_SUCCESS;
+        }
+    }
+
+    if (content != NULL)
+    {
+        bplib_os_free(content);
+    }
+
+    if (status != BP_SUCCESS)
+    {
+        if (pblk != NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+        return NULL;
+    }
+
+    return bplib_cla_make_bundle_ref_block(pblk, BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK);
+}
+
+/*
+ * Finds the entry for the bundle that a fragment is part of, or makes a new one.
+ * Must be called with the reassembly lock held.
+ */
+static bplib_cla_reassembly_t *bplib_cla_reassembly_get_entry(bplib_mpool_t *pool, bplib_cla_fragmentation_t *frag,
+                                                              const bplib_mpool_bblock_primary_t *cpb, uint64_t now)
+{
+    const bp_primary_block_t *pri;
+    bplib_rbt_link_t         *link;
+    bplib_mpool_block_t      *eblk;
+    bplib_cla_reassembly_t   *entry;
+    bp_val_t                  key;
+    uint64_t                  expire_time;
+
+    pri  = &cpb->data.logical;
+    key  = bplib_cla_reassembly_key(pri);
+    link = bplib_rbt_search_generic(key, &frag->adu_index, bplib_cla_reassembly_match, (void *)pri);
+    if (link != NULL)
+    {
+        /* because hash_rbt_link is the first element */
+        return (bplib_cla_reassembly_t *)link;
+    }
+
+    eblk  = bplib_mpool_generic_data_alloc(pool, BPLIB_BLOCKTYPE_CLA_REASSEMBLY, NULL);
+    entry = bplib_mpool_generic_data_cast(eblk, BPLIB_BLOCKTYPE_CLA_REASSEMBLY);
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    entry->self_ptr     = eblk;
+    entry->creation     = pri->creationTimeStamp;
+    entry->total_length = pri->totalADUlength;
+    v7_get_eid(&entry->source, &pri->sourceEID);
+    bplib_rbt_init_root(&entry->fragment_index);
+
+    /* without a wait time, it is only given up when the bundle expires, if it has a time */
+    if (frag->max_wait != 0)
+    {
+        expire_time = now + frag->max_wait;
+    }
+    else if (pri->creationTimeStamp.time != 0)
+    {
+        expire_time = pri->creationTimeStamp.time + pri->lifetime;
+    }
+    else
+    {
+        expire_time = BP_DTNTIME_INFINITE;
+    }
+
+    bplib_rbt_insert_value_generic(key, &frag->adu_index, &entry->hash_rbt_link, bplib_cla_reassembly_match,
+                                   (void *)pri);
+    bplib_rbt_insert_value_generic(expire_time, &frag->time_index, &entry->time_rbt_link,
+                                   bplib_cla_reassembly_insert_unsorted, NULL);
+
+    return entry;
+}
+
+/*
+ * Updates the poll time of the intf to the next time a bundle would be given up, if that changed.
+ * Must be called with the reassembly lock held, and returns the poll time to register, or 0 if
+ * it does not need to be registered again.
+ */
+static uint64_t bplib_cla_reassembly_next_poll(bplib_cla_fragmentation_t *frag)
+{
+    bplib_rbt_iter_t iter;
+    uint64_t         poll_time;
+
+    if (bplib_rbt_iter_goto_min(0, &frag->time_index, &iter) == BP_SUCCESS)
+    {
+        poll_time = bplib_rbt_get_key_value(iter.position);
+    }
+    else
+    {
+        poll_time = BP_DTNTIME_INFINITE;
+    }
+
+    if (poll_time == frag->poll_time)
+    {
+        return 0;
+    }
+
+    frag->poll_time = poll_time;
+    return poll_time;
+}
+
+/*
+ * Registers the poll time from bplib_cla_reassembly_next_poll(), outside the reassembly lock
+ */
+static void bplib_cla_reassembly_set_poll(bplib_cla_fragmentation_t *frag, bplib_mpool_block_t *intf_block,
+                                          uint64_t poll_time)
+{
+    if (poll_time != 0)
+    {
+        bplib_route_intf_set_poll_time(frag->parent_rtbl, bplib_mpool_get_external_id(intf_block), poll_time);
+    }
+}
+
+bplib_mpool_block_t *bplib_cla_verify_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk)
+{
+    bplib_cla_stats_t            *stats;
+    bplib_mpool_bblock_primary_t *cpb;
+
+    /* only bundles from an intf with BPLIB_CLA_INTF_DEFER_CRC have anything left to check */
+    cpb = bplib_mpool_bblock_primary_cast(qblk);
+    if (cpb == NULL || v7_verify_deferred_crcs(cpb))
+    {
+        return qblk;
+    }
+
+    stats = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats != NULL)
+    {
+        __atomic_fetch_add(&stats->counters[bplib_cla_counter_drop_decode], 1, __ATOMIC_RELAXED);
+    }
+
+    bplog(NULL, BP_FLAG_INCOMPLETE, "Bundle block CRC did not verify\n");
+    bplib_mpool_recycle_block(qblk);
+    return NULL;
+}
+
+bplib_mpool_block_t *bplib_cla_reassemble_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk)
+{
+    bplib_cla_stats_t              *stats;
+    bplib_cla_fragmentation_t      *frag;
+    bplib_cla_reassembly_t         *entry;
+    bplib_cla_fragment_t           *fragment;
+    bplib_mpool_block_t            *sblk;
+    bplib_mpool_block_t            *rblk;
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_canonical_t *pay;
+    const bp_primary_block_t       *pri;
+    bplib_mpool_t                  *pool;
+    size_t                          length;
+    uint64_t                        now;
+    uint64_t                        poll_time;
+    uint32_t                        dropped;
+    uint32_t                        reassembled;
+
+    stats = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_CLA_INTF);
+    cpb   = bplib_mpool_bblock_primary_cast(qblk);
+    frag  = NULL;
+    if (stats != NULL)
+    {
+        frag = __atomic_load_n(&stats->fragmentation, __ATOMIC_ACQUIRE);
+    }
+
+    /* it may be turned off at any time, but not freed while the intf exists */
+    if (frag == NULL || __atomic_load_n(&frag->mem_limit, __ATOMIC_RELAXED) == 0 || cpb == NULL ||
+        !cpb->data.logical.controlFlags.isFragment)
+    {
+        /* not something to hold on to */
+        return qblk;
+    }
+
+    pri  = &cpb->data.logical;
+    pay  = bplib_mpool_bblock_canonical_cast(
+        bplib_mpool_bblock_primary_locate_canonical(cpb, bp_blocktype_payloadBlock));
+    pool = bplib_mpool_get_parent_pool_from_link(intf_block);
+
+    length = 0;
+    if (pay != NULL)
+    {
+        length = bplib_mpool_bblock_canonical_get_content_length(pay);
+    }
+
+    if (length == 0 || pri->fragmentOffset >= pri->totalADUlength ||
+        length > (pri->totalADUlength - pri->fragmentOffset))
+    {
+        /* it could never be put back together */
+        __atomic_fetch_add(&stats->counters[bplib_cla_counter_drop_decode], 1, __ATOMIC_RELAXED);
+        bplib_mpool_recycle_block(qblk);
+        return NULL;
+    }
+
+    now         = bplib_os_get_dtntime_ms();
+    rblk        = NULL;
+    reassembled = 0;
+
+    bplib_os_lock(frag->lock);
+
+    if (length > frag->mem_limit)
+    {
+        /* this alone is too big, so there is no use making room for it */
+        dropped = 1 + bplib_cla_reassembly_expire(frag, now, 0);
+        entry   = NULL;
+    }
+    else
+    {
+        dropped = bplib_cla_reassembly_expire(frag, now, length);
+        entry   = bplib_cla_reassembly_get_entry(pool, frag, cpb, now);
+        if (entry == NULL)
+        {
+            ++dropped;
+        }
+    }
+
+    if (entry != NULL)
+    {
+        sblk     = bplib_mpool_generic_data_alloc(pool, BPLIB_BLOCKTYPE_CLA_FRAGMENT, NULL);
+        fragment = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_FRAGMENT);
+        if (fragment != NULL)
+        {
+            fragment->self_ptr = sblk;
+            fragment->length   = length;
+
+            /* the same part again is a duplicate, nothing new in it */
+            if (bplib_rbt_insert_value_unique(pri->fragmentOffset, &entry->fragment_index, &fragment->rbt_link) ==
+                BP_SUCCESS)
+            {
+                fragment->bundle_ref = bplib_mpool_ref_from_block(qblk);
+                entry->held_bytes += length;
+                frag->held_bytes += length;
+            }
+            else
+            {
+                bplib_mpool_recycle_block(sblk);
+            }
+        }
+        else if (bplib_rbt_tree_is_empty(&entry->fragment_index))
+        {
+            /* no memory, and nothing else was held for it yet */
+            bplib_cla_reassembly_drop(frag, entry);
+            ++dropped;
+            entry = NULL;
+        }
+
+        if (entry != NULL && bplib_cla_reassembly_is_complete(entry))
+        {
+            rblk = bplib_cla_reassembly_build(pool, entry);
+            bplib_cla_reassembly_drop(frag, entry);
+            if (rblk != NULL)
+            {
+                ++reassembled;
+            }
+            else
+            {
+                bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to reassemble bundle\n");
+                ++dropped;
+            }
+        }
+    }
+
+    poll_time = bplib_cla_reassembly_next_poll(frag);
+
+    bplib_os_unlock(frag->lock);
+
+    /* the fragment is held by its ref now, if it was kept at all */
+    bplib_mpool_recycle_block(qblk);
+
+    if (reassembled != 0)
+    {
+        __atomic_fetch_add(&frag->reassembled, reassembled, __ATOMIC_RELAXED);
+    }
+    if (dropped != 0)
+    {
+        __atomic_fetch_add(&frag->drop_reassembly, dropped, __ATOMIC_RELAXED);
+    }
+
+    bplib_cla_reassembly_set_poll(frag, intf_block, poll_time);
+
+    return rblk;
+}
+
+/*
+ * Gives up on the bundles which waited too long for their fragments, on a poll of the intf
+ */
+static void bplib_cla_reassembly_poll(bplib_mpool_block_t *intf_block)
+{
+    bplib_cla_stats_t         *stats;
+    bplib_cla_fragmentation_t *frag;
+    uint64_t                   poll_time;
+    uint32_t                   dropped;
+
+    stats = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    frag = __atomic_load_n(&stats->fragmentation, __ATOMIC_ACQUIRE);
+    if (frag == NULL)
+    {
+        return;
+    }
+
+    bplib_os_lock(frag->lock);
+    dropped = bplib_cla_reassembly_expire(frag, bplib_os_get_dtntime_ms(), 0);
+
+    /* the route table does not keep a poll time once it is reached */
+    frag->poll_time = BP_DTNTIME_INFINITE;
+    poll_time       = bplib_cla_reassembly_next_poll(frag);
+    bplib_os_unlock(frag->lock);
+
+    if (dropped != 0)
+    {
+        __atomic_fetch_add(&frag->drop_reassembly, dropped, __ATOMIC_RELAXED);
+    }
+
+    bplib_cla_reassembly_set_poll(frag, intf_block, poll_time);
+}
+
+/*
+ * Drops all the fragments held for reassembly, when the intf goes down or away
+ */
+static void bplib_cla_reassembly_flush(bplib_cla_stats_t *stats)
+{
+    bplib_cla_fragmentation_t *frag;
+    bplib_rbt_iter_t           iter;
+
+    frag = stats->fragmentation;
+    if (frag == NULL)
+    {
+        return;
+    }
+
+    bplib_os_lock(frag->lock);
+    while (bplib_rbt_iter_goto_min(0, &frag->time_index, &iter) == BP_SUCCESS)
+    {
+        bplib_cla_reassembly_drop(frag, bplib_cla_reassembly_from_time_link(iter.position));
+    }
+    bplib_os_unlock(frag->lock);
+}
+
+/*
+ * Gets the fragmentation state of an intf, making it the first time it is configured.  Once made, it is
+ * kept until the intf goes away, so the route task can use it without holding a ref to it.
+ */
+static bplib_cla_fragmentation_t *bplib_cla_fragmentation_get(bplib_routetbl_t *rtbl, bplib_cla_stats_t *stats)
+{
+    bplib_mpool_block_t       *fblk;
+    bplib_cla_fragmentation_t *frag;
+
+    if (stats->fragmentation != NULL)
+    {
+        return stats->fragmentation;
+    }
+
+    fblk = bplib_mpool_generic_data_alloc(bplib_route_get_mpool(rtbl), BPLIB_BLOCKTYPE_CLA_FRAGMENTATION, NULL);
+    frag = bplib_mpool_generic_data_cast(fblk, BPLIB_BLOCKTYPE_CLA_FRAGMENTATION);
+    if (frag == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate fragmentation state\n");
+        return NULL;
+    }
+
+    frag->lock = bplib_os_createlock();
+    if (!bp_handle_is_valid(frag->lock))
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to create reassembly lock\n");
+        bplib_mpool_recycle_block(fblk);
+        return NULL;
+    }
+
+    frag->self_ptr    = fblk;
+    frag->parent_rtbl = rtbl;
+    frag->poll_time   = BP_DTNTIME_INFINITE;
+    bplib_rbt_init_root(&frag->adu_index);
+    bplib_rbt_init_root(&frag->time_index);
+
+    /* the route task may look at it as soon as it is set */
+    __atomic_store_n(&stats->fragmentation, frag, __ATOMIC_RELEASE);
+
+    return frag;
+}
+
+/*
+ * Drops the bundles that the intf holds itself, outside of its queues
+ */
+static int bplib_cla_drop_held(bplib_mpool_block_t *sblk)
+{
+    bplib_cla_stats_t *stats;
+
+    stats = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* a bundle held over for the next frame is owned by the intf, so it goes too */
+    if (stats->framing.holdover != NULL)
+    {
+        bplib_mpool_recycle_block(stats->framing.holdover);
+        stats->framing.holdover = NULL;
+    }
+
+    /* as do the fragments of bundles not yet put back together */
+    bplib_cla_reassembly_flush(stats);
+
+    return BP_SUCCESS;
+}
+
+int bplib_cla_destruct_intf(void *arg, bplib_mpool_block_t *sblk)
+{
+    bplib_cla_stats_t *stats;
+
+    if (bplib_cla_drop_held(sblk) != BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    stats = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats->fragmentation != NULL)
+    {
+        bplib_os_destroylock(stats->fragmentation->lock);
+        bplib_mpool_recycle_block(stats->fragmentation->self_ptr);
+        stats->fragmentation = NULL;
+    }
+    if (stats->dedup != NULL)
+    {
+        bplib_cla_dedup_free(stats->dedup);
+        stats->dedup = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_cla_destruct_ingress_stream(void *arg, bplib_mpool_block_t *sblk)
+{
+    bplib_cla_ingress_stream_t *stream;
+
+    stream = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM);
+    if (stream == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* a bundle that was never ended, this also drops whatever part of it was written to the pool */
+    if (stream->pblk != NULL)
+    {
+        v7_stream_import_end(&stream->import);
+        bplib_mpool_recycle_block(stream->pblk);
+        stream->pblk = NULL;
+    }
+
+    if (stream->stage_blk != NULL)
+    {
+        bplib_mpool_recycle_block(stream->stage_blk);
+        stream->stage_blk = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_cla_destruct_egress_stream(void *arg, bplib_mpool_block_t *sblk)
+{
+    bplib_cla_egress_stream_t *stream;
+
+    stream = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_EGRESS_STREAM);
+    if (stream == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* the bundle was already counted as sent when the stream started, whether or not it was all read */
+    if (stream->bundle_ref != NULL)
+    {
+        bplib_mpool_ref_release(stream->bundle_ref);
+        stream->bundle_ref = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_cla_event_impl(void *arg, bplib_mpool_block_t *intf_block)
+{
+    bplib_mpool_flow_generic_event_t *event;
+    bplib_mpool_flow_t               *flow;
+
+    event = arg;
+
+    /* the only timed work of a CLA is giving up on bundles which are not all in */
+    if (event->event_type == bplib_mpool_flow_event_poll)
+    {
+        bplib_cla_reassembly_poll(intf_block);
+        return BP_SUCCESS;
+    }
+
+    /* otherwise only care about state change events for now */
+    if (event->event_type != bplib_mpool_flow_event_up && event->event_type != bplib_mpool_flow_event_down)
+    {
+        return BP_SUCCESS;
+    }
+
+    /* only care about state change events for the local i/f */
+    flow = bplib_mpool_flow_cast(intf_block);
+    if (flow == NULL || !bp_handle_equal(event->intf_state.intf_id, bplib_mpool_get_external_id(intf_block)))
+    {
+        return BP_SUCCESS;
+    }
+
+    if (event->event_type == bplib_mpool_flow_event_up)
+    {
+        /* Allows bundles to be pushed to flow queues */
+        bplib_mpool_flow_enable(&flow->ingress, BP_MPOOL_MAX_SUBQ_DEPTH);
+        bplib_mpool_flow_enable(&flow->egress, BP_MPOOL_MAX_SUBQ_DEPTH);
+    }
+    else if (event->event_type == bplib_mpool_flow_event_down)
+    {
+        /* drop anything already in the egress queue.  Note that
+         * ingress is usually empty, as bundles really should not wait there,
+         * so that probably has no effect. */
+        bplib_mpool_flow_disable(&flow->ingress);
+        bplib_mpool_flow_disable(&flow->egress);
+
+        /* a bundle held over for the next frame was already out of the egress queue */
+        bplib_cla_drop_held(intf_block);
+    }
+
+    return BP_SUCCESS;
+}
+
+void bplib_cla_init(bplib_mpool_t *pool)
+{
+    const bplib_mpool_blocktype_api_t intf_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_cla_destruct_intf,
+    };
+    const bplib_mpool_blocktype_api_t ingress_stream_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_cla_destruct_ingress_stream,
+    };
+    const bplib_mpool_blocktype_api_t egress_stream_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_cla_destruct_egress_stream,
+    };
+
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_INTF, &intf_api, sizeof(bplib_cla_stats_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK, NULL, 0);
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_INGRESS_RAW, NULL, 0);
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_FRAGMENT_BLOCK, NULL, 0);
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_REASSEMBLY, NULL, sizeof(bplib_cla_reassembly_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_FRAGMENT, NULL, sizeof(bplib_cla_fragment_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_FRAGMENTATION, NULL, sizeof(bplib_cla_fragmentation_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM, &ingress_stream_api,
+                                   sizeof(bplib_cla_ingress_stream_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_EGRESS_STREAM, &egress_stream_api,
+                                   sizeof(bplib_cla_egress_stream_t));
+
+    /* for bundles received directly into pool memory, see bplib_cla_ingress_adopt() */
+    bplib_mpool_bblock_cbor_slice_init(pool);
+}
+
+/*
+ * Gets the counter that a variable reads, or bplib_cla_counter_max if it is not a counter
+ */
+static bplib_cla_counter_t bplib_cla_counter_for_variable(bplib_variable_t var_id)
+{
+    switch (var_id)
+    {
+        case bplib_variable_cla_ingress_bundles:
+            return bplib_cla_counter_ingress_bundles;
+        case bplib_variable_cla_egress_bundles:
+            return bplib_cla_counter_egress_bundles;
+        case bplib_variable_cla_drop_no_route:
+            return bplib_cla_counter_drop_no_route;
+        case bplib_variable_cla_drop_queue_full:
+            return bplib_cla_counter_drop_queue_full;
+        case bplib_variable_cla_drop_decode:
+            return bplib_cla_counter_drop_decode;
+        case bplib_variable_cla_drop_expired:
+            return bplib_cla_counter_drop_expired;
+        case bplib_variable_cla_queue_10ms:
+            return bplib_cla_counter_queue_time_10ms;
+        case bplib_variable_cla_queue_100ms:
+            return bplib_cla_counter_queue_time_100ms;
+        case bplib_variable_cla_queue_1s:
+            return bplib_cla_counter_queue_time_1s;
+        case bplib_variable_cla_queue_long:
+            return bplib_cla_counter_queue_time_long;
+        case bplib_variable_cla_drop_duplicate:
+            return bplib_cla_counter_drop_duplicate;
+        default:
+            return bplib_cla_counter_max;
+    }
+}
+
+/*
+ * Gets a fragmentation setting or counter, which are all 0 when none of it was configured
+ */
+static bp_sval_t bplib_cla_fragmentation_query(const bplib_cla_fragmentation_t *frag, bplib_variable_t var_id)
+{
+    if (frag == NULL)
+    {
+        return 0;
+    }
+
+    switch (var_id)
+    {
+        case bplib_variable_cla_fragment_mtu:
+            return frag->mtu;
+        case bplib_variable_cla_reassembly_mem:
+            return frag->mem_limit;
+        case bplib_variable_cla_reassembly_wait:
+            return frag->max_wait;
+        case bplib_variable_cla_fragmented:
+            return __atomic_load_n(&frag->fragmented, __ATOMIC_RELAXED);
+        case bplib_variable_cla_reassembled:
+            return __atomic_load_n(&frag->reassembled, __ATOMIC_RELAXED);
+        case bplib_variable_cla_drop_reassembly:
+            return __atomic_load_n(&frag->drop_reassembly, __ATOMIC_RELAXED);
+        default:
+            return 0;
+    }
+}
+
+void bplib_cla_count_drop(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_counter_t counter)
+{
+    bplib_mpool_ref_t flow_ref;
+
+    /* the intf may not be a CLA, in which case this just does nothing */
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref != NULL)
+    {
+        bplib_cla_count(flow_ref, counter, 1);
+        bplib_route_release_intf_controlblock(rtbl, flow_ref);
+    }
+}
+
+static bool bplib_cla_match_metric_intf(bplib_mpool_block_t *flow_block)
+{
+    return (bplib_mpool_generic_data_cast(flow_block, BPLIB_BLOCKTYPE_CLA_INTF) != NULL);
+}
+
+/*
+ * Reads one of BPLIB_CLA_METRIC_DESCS straight from the intf block, as the counters are atomic
+ * and the route table already holds the lock that keeps the intf from going away
+ */
+static void bplib_cla_read_metric(bplib_routetbl_t *rtbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                  bplib_metric_t *metric)
+{
+    bplib_cla_stats_t *stats;
+    uint32_t           i;
+
+    stats = bplib_mpool_generic_data_cast(flow_block, BPLIB_BLOCKTYPE_CLA_INTF);
+    switch (idx)
+    {
+        case 0:
+            metric->value = __atomic_load_n(&stats->ingress_byte_count, __ATOMIC_RELAXED);
+            break;
+        case 1:
+            metric->value = __atomic_load_n(&stats->egress_byte_count, __ATOMIC_RELAXED);
+            break;
+        case 8:
+            for (i = 0; i < metric->desc->num_bins; ++i)
+            {
+                metric->bins[i] =
+                    __atomic_load_n(&stats->counters[bplib_cla_counter_queue_time_10ms + i], __ATOMIC_RELAXED);
+                metric->value += metric->bins[i];
+            }
+            break;
+        case 9:
+            metric->value = __atomic_load_n(&stats->counters[bplib_cla_counter_drop_duplicate], __ATOMIC_RELAXED);
+            break;
+        default:
+            /* these are in the same order as the counters */
+            metric->value = __atomic_load_n(&stats->counters[idx - 2], __ATOMIC_RELAXED);
+            break;
+    }
+}
+
+/* upper limits of the bins of the queue time histogram */
+static const uint32_t BPLIB_CLA_QUEUE_TIME_BIN_LIMITS[] = {10000, 100000, 1000000};
+
+static const bplib_metric_desc_t BPLIB_CLA_METRIC_DESCS[] = {
+    {"cla_ingress_bytes", "bytes received by the CLA", bplib_metric_type_counter, 0, NULL},
+    {"cla_egress_bytes", "bytes sent by the CLA", bplib_metric_type_counter, 0, NULL},
+    {"cla_ingress_bundles", "bundles received by the CLA", bplib_metric_type_counter, 0, NULL},
+    {"cla_egress_bundles", "bundles sent by the CLA", bplib_metric_type_counter, 0, NULL},
+    {"cla_drop_no_route", "bundles received with no route onward", bplib_metric_type_counter, 0, NULL},
+    {"cla_drop_queue_full", "bundles dropped because a queue was full", bplib_metric_type_counter, 0, NULL},
+    {"cla_drop_decode", "bundles received which did not decode", bplib_metric_type_counter, 0, NULL},
+    {"cla_drop_expired", "bundles which expired before they could be sent", bplib_metric_type_counter, 0, NULL},
+    {"cla_queue_time", "bundles sent by time since arrival at this node", bplib_metric_type_histogram, 4,
+     BPLIB_CLA_QUEUE_TIME_BIN_LIMITS},
+    {"cla_drop_duplicate", "bundles received which were received recently already", bplib_metric_type_counter, 0,
+     NULL}};
+
+const bplib_metric_group_t BPLIB_CLA_METRICS = {BPLIB_CLA_METRIC_DESCS,
+                                                sizeof(BPLIB_CLA_METRIC_DESCS) / sizeof(BPLIB_CLA_METRIC_DESCS[0]),
+                                                bplib_cla_match_metric_intf, bplib_cla_read_metric};
+
+int bplib_cla_query_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t *value)
+{
+    bplib_mpool_ref_t   flow_ref;
+    bplib_cla_stats_t  *stats;
+    bplib_cla_counter_t counter;
+    int                 status;
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    status = BP_ERROR;
+    stats  = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+    }
+    else
+    {
+        switch (var_id)
+        {
+            case bplib_variable_cla_egress_rate:
+                *value = stats->egress_pacing.rate;
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_egress_burst:
+                *value = stats->egress_pacing.burst;
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_frame_mtu:
+                *value = stats->framing.mtu;
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_frame_wait:
+                *value = stats->framing.max_wait;
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_fragment_mtu:
+            case bplib_variable_cla_reassembly_mem:
+            case bplib_variable_cla_reassembly_wait:
+            case bplib_variable_cla_fragmented:
+            case bplib_variable_cla_reassembled:
+            case bplib_variable_cla_drop_reassembly:
+                *value = bplib_cla_fragmentation_query(stats->fragmentation, var_id);
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_ingress_bytes:
+                *value = __atomic_load_n(&stats->ingress_byte_count, __ATOMIC_RELAXED);
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_egress_bytes:
+                *value = __atomic_load_n(&stats->egress_byte_count, __ATOMIC_RELAXED);
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_ingress_bps:
+                /* so the rate still comes down when nothing is moving */
+                bplib_cla_rate_update(stats, bplib_os_get_dtntime_ms());
+                *value = stats->rate_ewma.ingress_rate;
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_egress_bps:
+                bplib_cla_rate_update(stats, bplib_os_get_dtntime_ms());
+                *value = stats->rate_ewma.egress_rate;
+                status = BP_SUCCESS;
+                break;
+
+            default:
+                counter = bplib_cla_counter_for_variable(var_id);
+                if (counter < bplib_cla_counter_max)
+                {
+                    *value = __atomic_load_n(&stats->counters[counter], __ATOMIC_RELAXED);
+                    status = BP_SUCCESS;
+                }
+                break;
+        }
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
+int bplib_cla_config_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t value)
+{
+    bplib_mpool_ref_t          flow_ref;
+    bplib_cla_stats_t         *stats;
+    bplib_cla_pacing_t        *pacing;
+    bplib_cla_fragmentation_t *frag;
+    int                        status;
+
+    if (value < 0)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Pacing value cannot be negative\n");
+        return BP_ERROR;
+    }
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    status = BP_ERROR;
+    stats  = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+    }
+    else
+    {
+        pacing = &stats->egress_pacing;
+        switch (var_id)
+        {
+            case bplib_variable_cla_egress_rate:
+                pacing->rate = value;
+                bplib_cla_pacing_reset(pacing);
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_egress_burst:
+                pacing->burst = value;
+                bplib_cla_pacing_reset(pacing);
+                status = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_frame_mtu:
+                stats->framing.mtu = value;
+                status             = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_frame_wait:
+                stats->framing.max_wait = value;
+                status                  = BP_SUCCESS;
+                break;
+
+            case bplib_variable_cla_fragment_mtu:
+            case bplib_variable_cla_reassembly_mem:
+            case bplib_variable_cla_reassembly_wait:
+                frag = bplib_cla_fragmentation_get(rtbl, stats);
+                if (frag != NULL)
+                {
+                    bplib_os_lock(frag->lock);
+                    if (var_id == bplib_variable_cla_fragment_mtu)
+                    {
+                        frag->mtu = value;
+                    }
+                    else if (var_id == bplib_variable_cla_reassembly_mem)
+                    {
+                        frag->mem_limit = value;
+                    }
+                    else
+                    {
+                        frag->max_wait = value;
+                    }
+                    bplib_os_unlock(frag->lock);
+                    status = BP_SUCCESS;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+bp_handle_t bplib_create_cla_intf(bplib_routetbl_t *rtbl)
+{
+    return bplib_create_cla_intf_ext(rtbl, 0);
+}
+
+bp_handle_t bplib_create_cla_intf_ext(bplib_routetbl_t *rtbl, uint32_t flags)
+{
+    bplib_mpool_block_t *sblk;
+    bplib_mpool_flow_t  *flow;
+    bplib_cla_stats_t   *stats;
+    bp_handle_t          self_intf_id;
+    bplib_mpool_t       *pool;
+
+    pool = bplib_route_get_mpool(rtbl);
+
+    /* register CLA API module */
+    bplib_cla_init(pool);
+
+    /* Allocate Blocks */
+    sblk = bplib_mpool_flow_alloc(pool, BPLIB_BLOCKTYPE_CLA_INTF, NULL);
+    if (sblk == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate intf block\n");
+        return BP_INVALID_HANDLE;
+    }
+
+    self_intf_id = bplib_route_register_generic_intf(rtbl, BP_INVALID_HANDLE, sblk);
+    if (bp_handle_is_valid(self_intf_id))
+    {
+        bplib_route_register_forward_ingress_handler(rtbl, self_intf_id, bplib_route_ingress_baseintf_forwarder);
+        bplib_route_register_event_handler(rtbl, self_intf_id, bplib_cla_event_impl);
+
+        flow = bplib_mpool_flow_cast(sblk);
+        if (flow != NULL)
+        {
+            bplib_mpool_flow_set_jobtype(flow, bplib_mpool_jobtype_cla_forward);
+        }
+
+        stats = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_INTF);
+        if (stats != NULL)
+        {
+            stats->lazy_decode  = ((flags & BPLIB_CLA_INTF_LAZY_DECODE) != 0);
+            stats->defer_crc    = ((flags & BPLIB_CLA_INTF_DEFER_CRC) != 0);
+            stats->defer_decode = ((flags & BPLIB_CLA_INTF_DEFER_DECODE) != 0);
+            if ((flags & BPLIB_CLA_INTF_DEDUP) != 0)
+            {
+                stats->dedup = bplib_cla_dedup_alloc();
+                if (stats->dedup == NULL)
+                {
+                    bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to set up CLA duplicate filter\n");
+                }
+            }
+        }
+
+        if ((flags & BPLIB_CLA_INTF_PRIORITY_EGRESS) != 0 && flow != NULL &&
+            bplib_mpool_flow_attach_bands(&flow->egress, BPLIB_MPOOL_BANDS_DEQUEUE_WEIGHTED,
+                                          BPLIB_MPOOL_SUBQ_MAX_BANDS, NULL) != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to set up CLA egress priority bands\n");
+        }
+
+        /* the application is the only producer of ingress and the only consumer of egress */
+        if ((flags & BPLIB_CLA_INTF_SPSC_RINGS) != 0 && flow != NULL &&
+            (bplib_mpool_flow_attach_ring(&flow->ingress, BPLIB_MPOOL_RING_SINGLE_PRODUCER) != BP_SUCCESS ||
+             (flow->egress.bands == NULL &&
+              bplib_mpool_flow_attach_ring(&flow->egress, BPLIB_MPOOL_RING_SINGLE_CONSUMER) != BP_SUCCESS)))
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to set up CLA rings, using locked queues\n");
+        }
+    }
+    else
+    {
+        bplib_mpool_recycle_block(sblk);
+    }
+
+    return self_intf_id;
+}
+
+int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle, size_t *size, uint32_t timeout)
+{
+    bplib_mpool_ref_t  flow_ref;
+    int                status;
+    bplib_cla_stats_t *stats;
+    uint64_t           egress_time_limit;
+
+    /* preemptively trigger the maintenance task to run */
+    /* this may help in the event that the queue is currently empty but
+     * there is data somewhere else in the pool that is headed here (assuming
+     * timeout is nonzero). */
+    bplib_route_set_maintenance_request(rtbl);
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
+    }
+    else
+    {
+        /* with pacing, nothing is pulled from the queue until the link can take it */
+        status = bplib_cla_egress_pace(rtbl, stats, egress_time_limit);
+        if (status == BP_SUCCESS && (stats->framing.mtu != 0 || stats->framing.holdover != NULL))
+        {
+            status = bplib_generic_bundle_egress_frame(flow_ref, &stats->framing, bundle, size, egress_time_limit);
+        }
+        else if (status == BP_SUCCESS)
+        {
+            status = bplib_generic_bundle_egress(flow_ref, bundle, size, egress_time_limit);
+        }
+        if (status == BP_SUCCESS)
+        {
+            bplib_cla_count_bytes(stats, &stats->egress_byte_count, *size);
+        }
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
+int bplib_cla_egress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_egress_buf_t *buffers,
+                           uint32_t count, uint32_t *num_filled, uint32_t timeout)
+{
+    bplib_mpool_ref_t  flow_ref;
+    int                status;
+    bplib_cla_stats_t *stats;
+    uint64_t           egress_time_limit;
+    uint32_t           i;
+
+    *num_filled = 0;
+
+    /* preemptively trigger the maintenance task to run, same as bplib_cla_egress() */
+    bplib_route_set_maintenance_request(rtbl);
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
+    }
+    else
+    {
+        /* a batch starts when the link can take a bundle, and each one in it is paced after the one before */
+        status = bplib_cla_egress_pace(rtbl, stats, egress_time_limit);
+        if (status == BP_SUCCESS)
+        {
+            status = bplib_generic_bundle_egress_batch(flow_ref, buffers, count, num_filled, egress_time_limit);
+        }
+        for (i = 0; i < *num_filled; ++i)
+        {
+            bplib_cla_count_bytes(stats, &stats->egress_byte_count, buffers[i].size);
+        }
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
+int bplib_cla_egress_iov(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_iovec_t *iov, uint32_t *iov_count,
+                         bplib_mpool_ref_t *bundle_ref, uint32_t timeout)
+{
+    bplib_mpool_ref_t  flow_ref;
+    int                status;
+    bplib_cla_stats_t *stats;
+    uint64_t           egress_time_limit;
+    size_t             size;
+
+    *bundle_ref = NULL;
+
+    /* preemptively trigger the maintenance task to run, same as bplib_cla_egress() */
+    bplib_route_set_maintenance_request(rtbl);
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
+    }
+    else
+    {
+        size   = 0;
+        status = bplib_cla_egress_pace(rtbl, stats, egress_time_limit);
+        if (status == BP_SUCCESS)
+        {
+            status = bplib_generic_bundle_egress_iov(flow_ref, iov, iov_count, bundle_ref, &size, egress_time_limit);
+        }
+        if (status == BP_SUCCESS)
+        {
+            bplib_cla_count_bytes(stats, &stats->egress_byte_count, size);
+        }
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
+void bplib_cla_egress_iov_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t bundle_ref)
+{
+    bplib_mpool_ref_release(bundle_ref);
+}
+
+int bplib_cla_egress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref, size_t *size,
+                           uint32_t timeout)
+{
+    bplib_mpool_ref_t          flow_ref;
+    bplib_mpool_block_t       *sblk;
+    bplib_cla_egress_stream_t *stream;
+    bplib_cla_stats_t         *stats;
+    uint64_t                   egress_time_limit;
+    int                        status;
+
+    *stream_ref = NULL;
+    *size       = 0;
+
+    /* preemptively trigger the maintenance task to run, same as bplib_cla_egress() */
+    bplib_route_set_maintenance_request(rtbl);
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    sblk  = NULL;
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
+    }
+    else
+    {
+        status = bplib_cla_egress_pace(rtbl, stats, egress_time_limit);
+        if (status == BP_SUCCESS)
+        {
+            /* this is allocated before the bundle is pulled, so a bundle is never lost for the lack of it */
+            sblk = bplib_mpool_generic_data_alloc(bplib_route_get_mpool(rtbl), BPLIB_BLOCKTYPE_CLA_EGRESS_STREAM,
+                                                  NULL);
+            stream = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_EGRESS_STREAM);
+            if (stream == NULL)
+            {
+                bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate egress stream\n");
+                status = BP_ERROR;
+            }
+            else
+            {
+                status = bplib_generic_bundle_egress_stream(flow_ref, stream, size, egress_time_limit);
+            }
+        }
+        if (status == BP_SUCCESS)
+        {
+            bplib_cla_count_bytes(stats, &stats->egress_byte_count, *size);
+
+            *stream_ref = bplib_mpool_ref_create(sblk);
+            if (*stream_ref != NULL)
+            {
+                /* the ref owns it now */
+                sblk = NULL;
+            }
+            else
+            {
+                status = BP_ERROR;
+            }
+        }
+    }
+
+    if (sblk != NULL)
+    {
+        /* the destructor releases the bundle, if there was one */
+        bplib_mpool_recycle_block(sblk);
+    }
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
+}
+
+int bplib_cla_egress_read(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, void *buffer, size_t *size)
+{
+    bplib_cla_egress_stream_t *stream;
+
+    stream = bplib_mpool_generic_data_cast(bplib_mpool_dereference(stream_ref), BPLIB_BLOCKTYPE_CLA_EGRESS_STREAM);
+    if (stream == NULL)
+    {
+        *size = 0;
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not an egress stream\n");
+        return BP_ERROR;
+    }
+
+    *size = v7_stream_export_next(&stream->export, buffer, *size);
+
+    return BP_SUCCESS;
+}
+
+void bplib_cla_egress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref)
+{
+    bplib_mpool_ref_release(stream_ref);
+}
+
+int bplib_cla_get_notify_fd(bplib_routetbl_t *rtbl, bp_handle_t intf_id)
+{
+    bplib_mpool_ref_t   flow_ref;
+    bplib_mpool_flow_t *flow;
+    int                 fd;
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF) == NULL ||
+        flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        fd = BP_ERROR;
+    }
+    else if (bplib_mpool_flow_attach_notifier(&flow->egress) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Notifier not available on this intf\n");
+        fd = BP_ERROR;
+    }
+    else
+    {
+        fd = bplib_os_notifier_get_fd(flow->egress.notifier);
     }
 
-    return BP_SUCCESS;
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return fd;
 }
 
-int bplib_generic_bundle_ingress(bplib_mpool_ref_t flow_ref, const void *content, size_t size, uint64_t time_limit)
+int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *bundle, size_t size, uint32_t timeout)
 {
-    bplib_mpool_flow_t           *flow;
-    bplib_mpool_block_t          *pblk;
-    bplib_mpool_block_t          *rblk;
-    bplib_mpool_ref_t             refptr;
-    bplib_mpool_bblock_primary_t *pri_block;
-    size_t                        imported_sz;
-    int                           status;
+    bplib_mpool_ref_t  flow_ref;
+    int                status;
+    bplib_cla_stats_t *stats;
+    uint64_t           ingress_time_limit;
+    bool               queued;
 
-    pblk = NULL;
-    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
-    if (flow == NULL)
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
     {
-        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    queued = true;
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
     }
     else
     {
-        /*
-         * Note - it is not yet known whether this might be a regular data bundle or a DACS.  If under memory pressure,
-         * then it is critical to allow DACS in, because that should free more blocks, relieving the pressure.
-         * Therefore, the block allocation is done with a high-ish priority here, but if it ends up to be a regular
-         * bundle and there isn't a lot of memory available, this might get discarded later.
-         */
-        pblk =
-            bplib_mpool_bblock_primary_alloc(bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(flow_ref)),
-                                             0, NULL, BPLIB_MPOOL_ALLOC_PRI_MHI, 0);
-        if (pblk != NULL)
+        if (timeout == 0)
         {
-            imported_sz = v7_copy_full_bundle_in(bplib_mpool_bblock_primary_cast(pblk), content, size);
+            ingress_time_limit = 0;
         }
         else
         {
-            imported_sz = 0;
-        }
-
-        /* convert the bundle to a dynamically-managed ref */
-        refptr = bplib_mpool_ref_create(pblk);
-        if (refptr != NULL)
-        {
-            /* after conversion, should not use the original */
-            pblk = NULL;
+            ingress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
         }
 
-        pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
-
-        /*
-         * normally the size from the CLA and the size computed from CBOR decoding should agree.
-         * For now considering it an error if they do not.
-         */
-        if (pri_block != NULL && imported_sz == size)
+        /* the peer packs frames the same way, when this end is set up to */
+        if (stats->framing.mtu != 0)
         {
-            rblk = bplib_mpool_ref_make_block(refptr, BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK, NULL);
+            status = bplib_generic_bundle_ingress_frame(flow_ref, bundle, size, ingress_time_limit);
         }
-        else
+        else if (stats->defer_decode)
         {
-            rblk = NULL;
+            /* all of the decoding is done off this thread, by whichever one runs the flow */
+            status = bplib_generic_bundle_ingress_raw(flow_ref, bundle, size, ingress_time_limit);
         }
-
-        if (rblk != NULL)
+        else if (stats->lazy_decode || stats->defer_crc)
         {
-            pri_block->data.delivery.ingress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(flow_ref));
-            pri_block->data.delivery.ingress_time    = bplib_os_get_dtntime_ms();
-
-            if (bplib_mpool_flow_try_push(&flow->ingress, rblk, time_limit))
-            {
-                status = BP_SUCCESS;
-            }
-            else
-            {
-                bplib_mpool_recycle_block(rblk);
-                status = BP_TIMEOUT;
-            }
+            /* the intf asked for the rest of the decoding to be done off this thread */
+            status = bplib_generic_bundle_ingress(flow_ref, bundle, size, ingress_time_limit);
         }
         else
         {
-            bplog(NULL, BP_FLAG_INCOMPLETE, "Bundle did not decode correctly\n");
-            status = BP_ERROR;
+            /* a transit bundle can skip the ingress queue and the maintenance thread entirely */
+            status = bplib_generic_bundle_ingress_direct(rtbl, flow_ref, bundle, size, ingress_time_limit, &queued);
         }
 
-        if (refptr != NULL)
+        if (status == BP_SUCCESS)
         {
-            /*
-             * If successfully sent, the ref will have been duplicated, so the count remains nonzero after this,
-             * and the bundle itself continues on its way.  If something failed, the refcount will become zero,
-             * and the bundle memory gets freed.
-             */
-            bplib_mpool_ref_release(refptr);
-            refptr = NULL;
+            bplib_cla_count_bytes(stats, &stats->ingress_byte_count, size);
         }
+    }
 
-        if (pblk != NULL)
-        {
-            /* This really shouldn't happen... it means the pblk was allocated but wasn't convertible to a ref.
-             * something broke, but recycle it anyway */
-            bplib_mpool_recycle_block(pblk);
-            pblk = NULL;
-        }
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    /* trigger the maintenance task to run, if it has something to do */
+    if (queued)
+    {
+        bplib_route_set_maintenance_request(rtbl);
     }
 
     return status;
 }
 
-int bplib_generic_bundle_egress(bplib_mpool_ref_t flow_ref, void *content, size_t *size, uint64_t time_limit)
+int bplib_cla_rxbuf_get(bplib_routetbl_t *rtbl, size_t *size, void **buffer, bplib_mpool_ref_t *buffer_ref)
 {
-    bplib_mpool_flow_t           *flow;
-    bplib_mpool_bblock_primary_t *cpb;
-    bplib_mpool_block_t          *pblk;
-    size_t                        export_sz;
-    int                           status;
+    bplib_mpool_block_t *blk;
+    bplib_mpool_ref_t    refptr;
 
-    pblk = NULL;
-    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
-    if (flow == NULL)
+    *buffer     = NULL;
+    *buffer_ref = NULL;
+
+    blk = bplib_mpool_bblock_cbor_alloc_sized(bplib_route_get_mpool(rtbl), *size);
+    if (blk == NULL)
     {
-        status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "intf_block invalid\n");
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate rx buffer\n");
+        return BP_ERROR;
+    }
+
+    /* the whole bundle has to fit in the one block, it cannot be spread out */
+    if (bplib_mpool_get_generic_data_capacity(blk) < *size)
+    {
+        bplib_mpool_recycle_block(blk);
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "No rx buffer of size %lu\n", (unsigned long)*size);
+        return BP_ERROR;
+    }
+
+    refptr = bplib_mpool_ref_create(blk);
+    if (refptr == NULL)
+    {
+        bplib_mpool_recycle_block(blk);
+        return BP_ERROR;
+    }
+
+    *size       = bplib_mpool_get_generic_data_capacity(bplib_mpool_dereference(refptr));
+    *buffer     = bplib_mpool_bblock_cbor_cast(bplib_mpool_dereference(refptr));
+    *buffer_ref = refptr;
+
+    return BP_SUCCESS;
+}
+
+void bplib_cla_rxbuf_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t buffer_ref)
+{
+    bplib_mpool_ref_release(buffer_ref);
+}
+
+int bplib_cla_ingress_adopt(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t buffer_ref, size_t size,
+                            uint32_t timeout)
+{
+    bplib_mpool_ref_t  flow_ref;
+    int                status;
+    bplib_cla_stats_t *stats;
+    uint64_t           ingress_time_limit;
+
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplib_mpool_ref_release(buffer_ref);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
+
+    stats = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF);
+    if (stats == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
+    }
+    else if (size > bplib_mpool_get_generic_data_capacity(bplib_mpool_dereference(buffer_ref)))
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Bundle size exceeds rx buffer\n");
+        status = BP_ERROR;
     }
     else
     {
-        /* this removes it from the list */
-        /* NOTE: after this point a valid bundle has to be put somewhere (either onto another queue or recycled) */
-        pblk = bplib_mpool_flow_try_pull(&flow->egress, time_limit);
-        if (pblk == NULL)
+        if (timeout == 0)
         {
-            /* queue is empty */
-            status = BP_TIMEOUT;
+            ingress_time_limit = 0;
         }
         else
         {
-            cpb = bplib_mpool_bblock_primary_cast(pblk);
-            if (cpb == NULL)
-            {
-                /* entry wasn't a bundle? */
-                status = BP_ERROR;
-            }
-            else
-            {
-                export_sz = v7_compute_full_bundle_size(cpb);
-
-                if (export_sz > *size)
-                {
-                    /* buffer too small */
-                    status = BP_ERROR;
-                }
-                else
-                {
-
-                    *size = v7_copy_full_bundle_out(cpb, content, *size);
+            ingress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+        }
 
-                    if (export_sz != *size)
-                    {
-                        /* something went wrong during copy */
-                        status = BP_ERROR;
-                    }
-                    else
-                    {
-                        /* indicate that this has been sent out the intf */
-                        cpb->data.delivery.egress_intf_id =
-                            bplib_mpool_get_external_id(bplib_mpool_dereference(flow_ref));
-                        cpb->data.delivery.egress_time = bplib_os_get_dtntime_ms();
+        /* this marks how much of the buffer is valid, the decoded blocks cannot refer beyond it */
+        bplib_mpool_bblock_cbor_set_size(bplib_mpool_dereference(buffer_ref), size);
 
-                        status = BP_SUCCESS;
-                    }
-                }
-            }
+        status = bplib_generic_bundle_ingress_adopt(flow_ref, buffer_ref, size, ingress_time_limit);
 
-            bplib_mpool_recycle_block(pblk);
+        if (status == BP_SUCCESS)
+        {
+            bplib_cla_count_bytes(stats, &stats->ingress_byte_count, size);
         }
     }
 
+    /* if the bundle was accepted its blocks hold their own refs to the buffer, so it stays */
+    bplib_mpool_ref_release(buffer_ref);
+
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    /* trigger the maintenance task to run */
+    bplib_route_set_maintenance_request(rtbl);
+
     return status;
 }
 
-void bplib_cla_init(bplib_mpool_t *pool)
+int bplib_cla_ingress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref)
 {
-    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_INTF, NULL, sizeof(bplib_cla_stats_t));
-    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_CLA_INGRESS_BLOCK, NULL, 0);
-}
+    bplib_mpool_ref_t           flow_ref;
+    bplib_mpool_t              *pool;
+    bplib_mpool_block_t        *sblk;
+    bplib_cla_ingress_stream_t *stream;
+    uint8_t                    *stage;
+    int                         status;
 
-/******************************************************************************
- EXPORTED FUNCTIONS
- ******************************************************************************/
+    *stream_ref = NULL;
 
-bp_handle_t bplib_create_cla_intf(bplib_routetbl_t *rtbl)
-{
-    bplib_mpool_block_t *sblk;
-    bp_handle_t          self_intf_id;
-    bplib_mpool_t       *pool;
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    if (flow_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        return BP_ERROR;
+    }
 
     pool = bplib_route_get_mpool(rtbl);
+    sblk = NULL;
 
-    /* register CLA API module */
-    bplib_cla_init(pool);
-
-    /* Allocate Blocks */
-    sblk = bplib_mpool_flow_alloc(pool, BPLIB_BLOCKTYPE_CLA_INTF, NULL);
-    if (sblk == NULL)
+    if (bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow_ref), BPLIB_BLOCKTYPE_CLA_INTF) == NULL)
     {
-        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate intf block\n");
-        return BP_INVALID_HANDLE;
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        status = BP_ERROR;
+    }
+    else
+    {
+        /* the size is not known yet, so this only stops a stream if the quota is already used up */
+        status = bplib_mpool_flow_quota_admit(bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref)), 0);
     }
 
-    self_intf_id = bplib_route_register_generic_intf(rtbl, BP_INVALID_HANDLE, sblk);
-    if (bp_handle_is_valid(self_intf_id))
+    if (status == BP_SUCCESS)
     {
-        bplib_route_register_forward_ingress_handler(rtbl, self_intf_id, bplib_route_ingress_baseintf_forwarder);
-        bplib_route_register_event_handler(rtbl, self_intf_id, bplib_cla_event_impl);
+        sblk   = bplib_mpool_generic_data_alloc(pool, BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM, NULL);
+        stream = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM);
+        stage  = NULL;
+
+        if (stream != NULL)
+        {
+            stream->intf_id   = intf_id;
+            stream->stage_blk = bplib_mpool_bblock_cbor_alloc_sized(pool, BPLIB_CLA_INGRESS_STAGE_SIZE);
+            stage             = bplib_mpool_bblock_cbor_cast(stream->stage_blk);
+        }
+
+        /* see the note in bplib_generic_bundle_import() regarding the priority */
+        if (stage != NULL)
+        {
+            stream->pblk = bplib_mpool_bblock_primary_alloc(pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MHI, 0);
+        }
+
+        if (stage == NULL || stream->pblk == NULL)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to allocate ingress stream\n");
+            status = BP_ERROR;
+        }
+        else
+        {
+            v7_stream_import_begin(&stream->import, bplib_mpool_bblock_primary_cast(stream->pblk), stage,
+                                   bplib_mpool_get_generic_data_capacity(stream->stage_blk),
+                                   bplib_cla_import_flags(flow_ref));
+
+            *stream_ref = bplib_mpool_ref_create(sblk);
+            if (*stream_ref != NULL)
+            {
+                /* the ref owns it now */
+                sblk   = NULL;
+                status = BP_SUCCESS;
+            }
+            else
+            {
+                status = BP_ERROR;
+            }
+        }
     }
-    else
+
+    if (sblk != NULL)
     {
+        /* the destructor returns anything that was allocated for it */
         bplib_mpool_recycle_block(sblk);
     }
 
-    return self_intf_id;
+    bplib_route_release_intf_controlblock(rtbl, flow_ref);
+
+    return status;
 }
 
-int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle, size_t *size, uint32_t timeout)
+int bplib_cla_ingress_feed(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, const void *data, size_t size)
 {
-    bplib_mpool_ref_t  flow_ref;
-    int                status;
-    bplib_cla_stats_t *stats;
-    uint64_t           egress_time_limit;
+    bplib_cla_ingress_stream_t *stream;
 
-    /* preemptively trigger the maintenance task to run */
-    /* this may help in the event that the queue is currently empty but
-     * there is data somewhere else in the pool that is headed here (assuming
-     * timeout is nonzero). */
-    bplib_route_set_maintenance_request(rtbl);
+    stream = bplib_mpool_generic_data_cast(bplib_mpool_dereference(stream_ref), BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM);
+    if (stream == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not an ingress stream\n");
+        return BP_ERROR;
+    }
 
-    if (timeout == 0)
+    /* a bad bundle is counted when it is ended, there is no need to say anything more here */
+    if (!v7_stream_import_feed(&stream->import, data, size))
     {
-        egress_time_limit = 0;
+        return BP_ERROR;
     }
-    else
+
+    return BP_SUCCESS;
+}
+
+int bplib_cla_ingress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, uint32_t timeout)
+{
+    bplib_mpool_ref_t           flow_ref;
+    bplib_cla_ingress_stream_t *stream;
+    bplib_cla_stats_t          *stats;
+    uint64_t                    ingress_time_limit;
+    int                         status;
+
+    stream = bplib_mpool_generic_data_cast(bplib_mpool_dereference(stream_ref), BPLIB_BLOCKTYPE_CLA_INGRESS_STREAM);
+    if (stream == NULL)
     {
-        egress_time_limit = bplib_os_get_dtntime_ms() + timeout;
+        bplib_mpool_ref_release(stream_ref);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not an ingress stream\n");
+        return BP_ERROR;
     }
 
-    flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
+    flow_ref = bplib_route_get_intf_controlblock(rtbl, stream->intf_id);
     if (flow_ref == NULL)
     {
+        bplib_mpool_ref_release(stream_ref);
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
         return BP_ERROR;
     }
@@ -335,29 +3582,51 @@ int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle,
     }
     else
     {
-        status = bplib_generic_bundle_egress(flow_ref, bundle, size, egress_time_limit);
+        if (timeout == 0)
+        {
+            ingress_time_limit = 0;
+        }
+        else
+        {
+            ingress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+        }
+
+        status = bplib_generic_bundle_ingress_stream(flow_ref, stream, ingress_time_limit);
+
         if (status == BP_SUCCESS)
         {
-            stats->egress_byte_count += *size;
+            bplib_cla_count_bytes(stats, &stats->ingress_byte_count, stream->import.total_in);
         }
     }
 
+    /* the bundle has gone on (or been dropped), so this only has the stage left to free */
+    bplib_mpool_ref_release(stream_ref);
+
     bplib_route_release_intf_controlblock(rtbl, flow_ref);
 
+    /* trigger the maintenance task to run */
+    bplib_route_set_maintenance_request(rtbl);
+
     return status;
 }
 
-int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *bundle, size_t size, uint32_t timeout)
+int bplib_cla_ingress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const bplib_cla_bundle_buf_t *bundles,
+                            uint32_t count, int *status_list, uint32_t timeout)
 {
     bplib_mpool_ref_t  flow_ref;
     int                status;
     bplib_cla_stats_t *stats;
     uint64_t           ingress_time_limit;
+    uint32_t           i;
 
     flow_ref = bplib_route_get_intf_controlblock(rtbl, intf_id);
     if (flow_ref == NULL)
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID invalid\n");
+        for (i = 0; i < count; ++i)
+        {
+            status_list[i] = BP_ERROR;
+        }
         return BP_ERROR;
     }
 
@@ -365,6 +3634,10 @@ int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *b
     if (stats == NULL)
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "Intf ID is not a CLA\n");
+        for (i = 0; i < count; ++i)
+        {
+            status_list[i] = BP_ERROR;
+        }
         status = BP_ERROR;
     }
     else
@@ -375,20 +3648,23 @@ int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *b
         }
         else
         {
-            ingress_time_limit = bplib_os_get_dtntime_ms() + timeout;
+            ingress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
         }
 
-        status = bplib_generic_bundle_ingress(flow_ref, bundle, size, ingress_time_limit);
+        status = bplib_generic_bundle_ingress_batch(flow_ref, bundles, count, status_list, ingress_time_limit);
 
-        if (status == BP_SUCCESS)
+        for (i = 0; i < count; ++i)
         {
-            stats->ingress_byte_count += size;
+            if (status_list[i] == BP_SUCCESS)
+            {
+                bplib_cla_count_bytes(stats, &stats->ingress_byte_count, bundles[i].size);
+            }
         }
     }
 
     bplib_route_release_intf_controlblock(rtbl, flow_ref);
 
-    /* trigger the maintenance task to run */
+    /* trigger the maintenance task to run, once for the whole batch */
     bplib_route_set_maintenance_request(rtbl);
 
     return status;
@@ -44,13 +44,153 @@
 #define BPLIB_BLOCKTYPE_SERVICE_ENDPOINT 0x770c4839
 #define BPLIB_BLOCKTYPE_SERVICE_SOCKET   0xc21bb332
 #define BPLIB_BLOCKTYPE_SERVICE_BLOCK    0xbd35ac62
+#define BPLIB_BLOCKTYPE_SERVICE_HASH     0x4e0a7d15
+#define BPLIB_BLOCKTYPE_SERVICE_TEMPLATE 0x91c5e2a7
+#define BPLIB_BLOCKTYPE_SERVICE_TRACE    0x3b8f60d4
+#define BPLIB_BLOCKTYPE_SERVICE_CQ       0x5d2e81c3
+#define BPLIB_BLOCKTYPE_SERVICE_ASYNC_OP 0xa47f0b69
+
+/* a 64-bit odd constant (golden ratio), to spread service numbers over the hash slots */
+#define BPLIB_SERVICE_HASH_MULT 0x9E3779B97F4A7C15ULL
 
 /******************************************************************************
  LOCAL FUNCTIONS
  ******************************************************************************/
 
-int bplib_serviceflow_bundleize_payload(bplib_socket_info_t *sock_inf, bplib_mpool_block_t *pblk, const void *content,
-                                        size_t size)
+/*
+ * Service numbers are usually small and sequential, so the upper bits of the product are used
+ */
+static inline uint32_t bplib_serviceflow_hash_home(bp_val_t svc_num)
+{
+    return (uint32_t)(((uint64_t)svc_num * BPLIB_SERVICE_HASH_MULT) >> (64 - BPLIB_SERVICE_HASH_BITS));
+}
+
+/*
+ * Adds an endpoint to the hash table, or counts it as overflow if the table is at its limit
+ */
+static void bplib_serviceflow_hash_insert(bplib_service_hash_t *hash, bplib_service_endpt_t *endpoint_intf)
+{
+    uint32_t idx;
+
+    if (hash->count >= BPLIB_SERVICE_HASH_LIMIT)
+    {
+        ++hash->overflow;
+        return;
+    }
+
+    idx = bplib_serviceflow_hash_home(endpoint_intf->service_number);
+    while (hash->slots[idx] != NULL)
+    {
+        idx = (idx + 1) & (BPLIB_SERVICE_HASH_SLOTS - 1);
+    }
+
+    hash->slots[idx] = endpoint_intf;
+    ++hash->count;
+}
+
+/*
+ * Removes an endpoint from the hash table.  The entries after it in the same probe
+ * sequence are moved back so that a lookup never stops early at the emptied slot.
+ */
+static void bplib_serviceflow_hash_remove(bplib_service_hash_t *hash, bplib_service_endpt_t *endpoint_intf)
+{
+    uint32_t idx;
+    uint32_t next;
+    uint32_t home;
+
+    idx = bplib_serviceflow_hash_home(endpoint_intf->service_number);
+    while (hash->slots[idx] != endpoint_intf)
+    {
+        if (hash->slots[idx] == NULL)
+        {
+            /* was not in the table, so it must have been one of the overflow entries */
+            if (hash->overflow > 0)
+            {
+                --hash->overflow;
+            }
+            return;
+        }
+        idx = (idx + 1) & (BPLIB_SERVICE_HASH_SLOTS - 1);
+    }
+
+    next = idx;
+    while (true)
+    {
+        next = (next + 1) & (BPLIB_SERVICE_HASH_SLOTS - 1);
+        if (hash->slots[next] == NULL)
+        {
+            break;
+        }
+
+        /* the entry can fill the gap at idx only if its home slot is not between idx and next */
+        home = bplib_serviceflow_hash_home(hash->slots[next]->service_number);
+        if (((next - home) & (BPLIB_SERVICE_HASH_SLOTS - 1)) >= ((next - idx) & (BPLIB_SERVICE_HASH_SLOTS - 1)))
+        {
+            hash->slots[idx] = hash->slots[next];
+            idx              = next;
+        }
+    }
+
+    hash->slots[idx] = NULL;
+    --hash->count;
+}
+
+/*
+ * Finds the endpoint for a service number on the base interface, if there is one
+ */
+static bplib_service_endpt_t *bplib_serviceflow_lookup(bplib_route_serviceintf_info_t *base_intf, bp_val_t svc_num)
+{
+    bplib_service_hash_t *hash;
+    uint32_t              idx;
+
+    hash = base_intf->service_hash;
+    if (hash != NULL)
+    {
+        idx = bplib_serviceflow_hash_home(svc_num);
+        while (hash->slots[idx] != NULL)
+        {
+            if (hash->slots[idx]->service_number == svc_num)
+            {
+                return hash->slots[idx];
+            }
+            idx = (idx + 1) & (BPLIB_SERVICE_HASH_SLOTS - 1);
+        }
+
+        if (hash->overflow == 0)
+        {
+            return NULL;
+        }
+    }
+
+    /* because rbt_link is first element */
+    return (bplib_service_endpt_t *)bplib_rbt_search_unique(svc_num, &base_intf->service_index);
+}
+
+/*
+ * Sets the fields of a primary block which are the same for every bundle from the socket
+ */
+static void bplib_serviceflow_init_primary(const bplib_socket_info_t *sock_inf, bp_primary_block_t *pri)
+{
+    pri->version = 7;
+
+    v7_set_eid(&pri->destinationEID, &sock_inf->params.remote_ipn);
+    v7_set_eid(&pri->sourceEID, &sock_inf->params.local_ipn);
+    v7_set_eid(&pri->reportEID, &sock_inf->params.report_ipn);
+
+    pri->lifetime                     = sock_inf->params.lifetime;
+    pri->controlFlags.isAdminRecord   = sock_inf->params.is_admin_service;
+    pri->controlFlags.mustNotFragment = !sock_inf->params.allow_fragmentation;
+    pri->crctype                      = sock_inf->params.crctype;
+}
+
+/*
+ * Fills in a bundle from the socket with the payload.  If skip_pri_encode is set the primary block is
+ * only filled in and not encoded, this is only for a bundle which will never leave the node, or one
+ * which is encoded as it goes out (see bplib_socket_set_egress_encode()).
+ */
+int bplib_serviceflow_bundleize_payload(bplib_socket_info_t *sock_inf, bplib_mpool_block_t *pblk,
+                                        bplib_mpool_ref_t content_ref, const void *content, size_t size,
+                                        bool skip_pri_encode)
 {
     bplib_mpool_block_t            *cblk;
     bplib_mpool_bblock_primary_t   *pri_block;
@@ -74,28 +214,33 @@ int bplib_serviceflow_bundleize_payload(bplib_socket_info_t *sock_inf, bplib_mpo
         pri = bplib_mpool_bblock_primary_get_logical(pri_block);
 
         /* Initialize Primary Block */
-        pri->version = 7;
-
-        v7_set_eid(&pri->destinationEID, &sock_inf->params.remote_ipn);
-        v7_set_eid(&pri->sourceEID, &sock_inf->params.local_ipn);
-        v7_set_eid(&pri->reportEID, &sock_inf->params.report_ipn);
+        bplib_serviceflow_init_primary(sock_inf, pri);
 
         pri->creationTimeStamp.sequence_num = sock_inf->last_bundle_seq;
         ++sock_inf->last_bundle_seq;
 
         pri->creationTimeStamp.time = v7_get_current_time();
 
-        pri->lifetime                     = sock_inf->params.lifetime;
-        pri->controlFlags.isAdminRecord   = sock_inf->params.is_admin_service;
-        pri->controlFlags.mustNotFragment = !sock_inf->params.allow_fragmentation;
-        pri->crctype                      = sock_inf->params.crctype;
-
         pri_block->data.delivery.delivery_policy     = sock_inf->params.local_delivery_policy;
         pri_block->data.delivery.local_retx_interval = sock_inf->params.local_retx_interval;
+        pri_block->data.delivery.class_of_service    = sock_inf->params.class_of_service;
 
-        /* Pre-Encode Primary Block */
-        if (v7_block_encode_pri(pri_block) < 0)
+        /* Pre-Encode Primary Block, only the timestamp changes from the template */
+        if (skip_pri_encode)
+        {
+            result = BP_SUCCESS;
+        }
+        else if (sock_inf->pri_template != NULL)
+        {
+            result = v7_block_encode_pri_from_template(pri_block, sock_inf->pri_template);
+        }
+        else
+        {
+            result = v7_block_encode_pri(pri_block);
+        }
+        if (result < 0)
         {
+            result = BP_ERROR;
             bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed encoding pri block\n");
             break;
         }
@@ -115,9 +260,19 @@ int bplib_serviceflow_bundleize_payload(bplib_socket_info_t *sock_inf, bplib_mpo
         pay->canonical_block.blockType = bp_blocktype_payloadBlock;
         pay->canonical_block.crctype   = sock_inf->params.crctype;
 
-        /* Encode Payload Block */
-        if (v7_block_encode_pay(ccb_pay, content, size) < 0)
+        /* Encode Payload Block, which only refers to the content if it is in an external buffer */
+        if (content_ref != NULL)
+        {
+            result = v7_block_encode_pay_extern(ccb_pay, content_ref, content, size);
+        }
+        else
+        {
+            result = v7_block_encode_pay(ccb_pay, content, size);
+        }
+
+        if (result < 0)
         {
+            result = BP_ERROR;
             bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed encoding pay block\n");
             break;
         }
@@ -205,6 +360,232 @@ int bplib_serviceflow_unbundleize_payload(bplib_socket_info_t *sock_inf, bplib_m
     return status;
 }
 
+/*
+ * Counts one stage of a bundle in its latency histogram, by how long it took
+ */
+static void bplib_serviceflow_trace_count(uint32_t *histogram, uint64_t start_time, uint64_t end_time)
+{
+    uint64_t elapsed_ms;
+    uint64_t bin_limit_ms;
+    uint32_t bin;
+
+    elapsed_ms = 0;
+    if (end_time > start_time)
+    {
+        elapsed_ms = end_time - start_time;
+    }
+
+    /* bins are by powers of 10 from 1ms, the last is for anything longer */
+    bin          = 0;
+    bin_limit_ms = 1;
+    while (bin < (BPLIB_TRACE_LATENCY_BINS - 1) && elapsed_ms >= bin_limit_ms)
+    {
+        ++bin;
+        bin_limit_ms *= 10;
+    }
+
+    __atomic_fetch_add(&histogram[bin], 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Bundles made here are timed from the send call, ones from another node from their creation there
+ */
+static uint64_t bplib_serviceflow_trace_start_time(const bplib_mpool_bblock_primary_t *pri_block)
+{
+    if (pri_block->data.delivery.stage_time[bplib_trace_stage_bundleize] != 0)
+    {
+        return pri_block->data.delivery.ingress_time;
+    }
+
+    return pri_block->data.logical.creationTimeStamp.time;
+}
+
+/*
+ * Picks one in every sample_interval bundles the socket sends or receives, see bplib_socket_set_sampling()
+ */
+static bool bplib_serviceflow_trace_pick(bplib_socket_info_t *sock)
+{
+    uint32_t interval;
+
+    interval = sock->sample_interval;
+    if (interval == 0)
+    {
+        return false;
+    }
+
+    return ((__atomic_add_fetch(&sock->sample_count, 1, __ATOMIC_RELAXED) % interval) == 0);
+}
+
+/*
+ * Puts the times of every stage the bundle went through, up to and including last_stage, in the sample ring
+ */
+static void bplib_serviceflow_trace_sample(bplib_mpool_ref_t trace_ref, const bplib_mpool_bblock_primary_t *pri_block,
+                                           bplib_trace_stage_t last_stage)
+{
+    bplib_socket_trace_t *trace;
+    bplib_trace_sample_t  sample;
+
+    trace = bplib_mpool_generic_data_cast(bplib_mpool_dereference(trace_ref), BPLIB_BLOCKTYPE_SERVICE_TRACE);
+    if (trace == NULL || trace->samples == NULL)
+    {
+        return;
+    }
+
+    memset(&sample, 0, sizeof(sample));
+    v7_get_eid(&sample.source, &pri_block->data.logical.sourceEID);
+    sample.sequence   = pri_block->data.logical.creationTimeStamp.sequence_num;
+    sample.start_time = bplib_serviceflow_trace_start_time(pri_block);
+    memcpy(sample.stage_time, pri_block->data.delivery.stage_time, sizeof(sample.stage_time[0]) * (last_stage + 1));
+
+    /* only the sampled bundles get here, so this lock is not taken often */
+    bplib_os_mutex_lock(trace->sample_lock);
+    trace->samples[trace->sample_next] = sample;
+    ++trace->sample_next;
+    if (trace->sample_next >= trace->sample_ring_size)
+    {
+        trace->sample_next = 0;
+    }
+    if (trace->sample_held < trace->sample_ring_size)
+    {
+        ++trace->sample_held;
+    }
+    bplib_os_mutex_unlock(trace->sample_lock);
+}
+
+/*
+ * Counts every stage the bundle went through, up to and including last_stage, in the histograms
+ */
+static void bplib_serviceflow_trace_record(bplib_mpool_ref_t trace_ref, const bplib_mpool_bblock_primary_t *pri_block,
+                                           bplib_trace_stage_t last_stage)
+{
+    bplib_socket_trace_t                *trace;
+    const bplib_mpool_bblock_tracking_t *delivery;
+    uint64_t                             start_time;
+    uint32_t                             stage;
+
+    trace = bplib_mpool_generic_data_cast(bplib_mpool_dereference(trace_ref), BPLIB_BLOCKTYPE_SERVICE_TRACE);
+    if (trace == NULL)
+    {
+        return;
+    }
+
+    delivery   = &pri_block->data.delivery;
+    start_time = bplib_serviceflow_trace_start_time(pri_block);
+
+    for (stage = 0; stage <= last_stage; ++stage)
+    {
+        if (delivery->stage_time[stage] != 0)
+        {
+            /* a creation time of 0 means the source had no clock, then the first stage cannot be timed */
+            if (start_time != 0)
+            {
+                bplib_serviceflow_trace_count(trace->latency[stage], start_time, delivery->stage_time[stage]);
+            }
+            start_time = delivery->stage_time[stage];
+        }
+    }
+}
+
+/*
+ * Puts one event in the completion queue of a socket.  The queue always has room, as each op in
+ * flight has BPLIB_COMPLETIONS_PER_BUNDLE entries kept for it, see bplib_socket_set_completions().
+ */
+static void bplib_serviceflow_completion_post(bplib_mpool_ref_t cq_ref, uint64_t user_tag,
+                                              bplib_completion_event_t event)
+{
+    bplib_socket_completions_t *cq;
+    uint32_t                    pos;
+
+    cq = bplib_mpool_generic_data_cast(bplib_mpool_dereference(cq_ref), BPLIB_BLOCKTYPE_SERVICE_CQ);
+    if (cq == NULL || cq->ring == NULL)
+    {
+        return;
+    }
+
+    bplib_os_mutex_lock(cq->lock);
+    if (cq->held < cq->ring_size)
+    {
+        pos = cq->next + cq->held;
+        if (pos >= cq->ring_size)
+        {
+            pos -= cq->ring_size;
+        }
+
+        cq->ring[pos].user_tag = user_tag;
+        cq->ring[pos].event    = event;
+        ++cq->held;
+
+        if (cq->held == 1 && bp_handle_is_valid(cq->notifier))
+        {
+            bplib_os_notifier_set(cq->notifier);
+        }
+    }
+    bplib_os_mutex_broadcast_and_unlock(cq->lock);
+}
+
+void bplib_dataservice_complete(bplib_mpool_ref_t op_ref, bplib_completion_event_t event)
+{
+    bplib_socket_async_op_t *op;
+    uint32_t                 bit;
+
+    if (op_ref == NULL)
+    {
+        return;
+    }
+
+    op = bplib_mpool_generic_data_cast(bplib_mpool_dereference(op_ref), BPLIB_BLOCKTYPE_SERVICE_ASYNC_OP);
+    if (op == NULL)
+    {
+        return;
+    }
+
+    /* each event is only reported once, a bundle may well be sent again while waiting for custody */
+    bit = 1U << event;
+    if ((__atomic_fetch_or(&op->events, bit, __ATOMIC_RELAXED) & bit) != 0)
+    {
+        return;
+    }
+
+    bplib_serviceflow_completion_post(op->cq_ref, op->user_tag, event);
+}
+
+/*
+ * Marks the end of the last stage, when the application gets the bundle, and counts it if the socket is tracing
+ */
+static void bplib_serviceflow_trace_recv(bplib_socket_info_t *sock, bplib_mpool_bblock_primary_t *pri_block,
+                                         uint64_t now)
+{
+    pri_block->data.delivery.stage_time[bplib_trace_stage_recv] = now;
+    bplib_dataservice_complete(pri_block->data.delivery.completion_ref, bplib_completion_delivered);
+    if (sock->tracing)
+    {
+        bplib_serviceflow_trace_record(sock->trace_ref, pri_block, bplib_trace_stage_recv);
+    }
+    if (bplib_serviceflow_trace_pick(sock))
+    {
+        bplib_serviceflow_trace_sample(sock->trace_ref, pri_block, bplib_trace_stage_recv);
+    }
+}
+
+void bplib_serviceflow_trace_egress(bplib_mpool_bblock_primary_t *pri_block, uint64_t now)
+{
+    bplib_mpool_bblock_tracking_t *delivery;
+
+    /* this is as far as the socket it was sent from sees it, so it is counted there now */
+    delivery                                           = &pri_block->data.delivery;
+    delivery->stage_time[bplib_trace_stage_cla_egress] = now;
+    if (delivery->trace_ref != NULL && !delivery->trace_sample_only)
+    {
+        bplib_serviceflow_trace_record(delivery->trace_ref, pri_block, bplib_trace_stage_cla_egress);
+    }
+    if (delivery->trace_ref != NULL && delivery->trace_sampled)
+    {
+        bplib_serviceflow_trace_sample(delivery->trace_ref, pri_block, bplib_trace_stage_cla_egress);
+    }
+
+    bplib_dataservice_complete(delivery->completion_ref, bplib_completion_sent);
+}
+
 int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
 {
     bplib_route_serviceintf_info_t *base_intf;
@@ -213,7 +594,10 @@ int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
     bplib_mpool_block_t            *intf_block;
     bplib_mpool_flow_t             *curr_flow;
     bplib_mpool_flow_t             *storage_flow;
+    bplib_mpool_job_t              *job;
     int                             forward_count;
+    uint64_t                        now;
+    bool                            share_spent;
 
     intf_block = bplib_mpool_get_block_from_link(subq_src);
     base_intf  = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_SERVICE_BASE);
@@ -228,8 +612,11 @@ int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
         return -1;
     }
 
+    job           = bplib_mpool_job_cast(subq_src);
+    now           = bplib_os_get_dtntime_ms();
     forward_count = 0;
-    while (true)
+    share_spent   = false;
+    while (!share_spent)
     {
         qblk = bplib_mpool_flow_try_pull(&curr_flow->ingress, 0);
         if (qblk == NULL)
@@ -242,12 +629,23 @@ int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
          * even if it gets dropped after this (hopefully not) it still counts
          * as something moved/changed by this action */
         ++forward_count;
+        if (job != NULL && bplib_mpool_job_spend_share(job, qblk))
+        {
+            share_spent = true;
+        }
 
         /* Check if it needs to be delivered to local storage.  If so, then
          * this function will also put it there. Otherwise, route it normally.
          * If this dataservice is storage-capable, and the bundle has NOT gone
          * to the storage service yet, send it there now */
         pri_block = bplib_mpool_bblock_primary_cast(qblk);
+
+        /* bundles coming back from storage are routed again, but only the first time is a stage */
+        if (pri_block != NULL && pri_block->data.delivery.stage_time[bplib_trace_stage_route] == 0)
+        {
+            pri_block->data.delivery.stage_time[bplib_trace_stage_route] = now;
+        }
+
         if (pri_block != NULL && base_intf->storage_service != NULL &&
             !bp_handle_is_valid(pri_block->data.delivery.storage_intf_id))
         {
@@ -268,6 +666,12 @@ int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
         }
     }
 
+    /* with a quantum, the other active jobs get a turn before the rest of this queue */
+    if (share_spent)
+    {
+        bplib_mpool_job_mark_active(job);
+    }
+
     /* This should return 0 if it did no work and no errors.
      * Should return >0 if some work was done */
     return forward_count;
@@ -276,7 +680,7 @@ int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
 int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
 {
     bplib_route_serviceintf_info_t *base_intf;
-    bplib_rbt_link_t               *tgt_subintf;
+    bplib_service_endpt_t          *tgt_subintf;
     bplib_mpool_flow_t             *curr_flow;
     bplib_mpool_flow_t             *next_flow;
     bplib_mpool_ref_t               next_flow_ref;
@@ -285,7 +689,10 @@ int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
     bplib_mpool_bblock_primary_t   *pri_block;
     bp_ipn_addr_t                   bundle_src;
     bp_ipn_addr_t                   bundle_dest;
+    bplib_mpool_job_t              *job;
     int                             forward_count;
+    uint64_t                        now;
+    bool                            share_spent;
 
     intf_block = bplib_mpool_get_block_from_link(subq_src);
     base_intf  = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_SERVICE_BASE);
@@ -300,8 +707,11 @@ int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
         return -1;
     }
 
+    job           = bplib_mpool_job_cast(subq_src);
+    now           = bplib_os_get_dtntime_ms();
     forward_count = 0;
-    while (true)
+    share_spent   = false;
+    while (!share_spent)
     {
         pblk = bplib_mpool_flow_try_pull(&curr_flow->egress, 0);
         if (pblk == NULL)
@@ -311,6 +721,10 @@ int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
         }
 
         ++forward_count;
+        if (job != NULL && bplib_mpool_job_spend_share(job, pblk))
+        {
+            share_spent = true;
+        }
 
         next_flow_ref = NULL;
         pri_block     = bplib_mpool_bblock_primary_cast(pblk);
@@ -329,12 +743,14 @@ int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
                 v7_get_eid(&bundle_dest, &bplib_mpool_bblock_primary_get_logical(pri_block)->destinationEID);
 
                 /* Find a dataservice that matches this src/dest combo */
-                tgt_subintf = bplib_rbt_search_unique(bundle_dest.service_number, &base_intf->service_index);
+                tgt_subintf = bplib_serviceflow_lookup(base_intf, bundle_dest.service_number);
                 if (tgt_subintf != NULL)
                 {
                     /* borrows the ref */
-                    /* because rbt_link is first element */
-                    next_flow_ref = ((bplib_service_endpt_t *)tgt_subintf)->subflow_ref;
+                    next_flow_ref = tgt_subintf->subflow_ref;
+
+                    /* must be set before the push, the socket may take it right away */
+                    pri_block->data.delivery.stage_time[bplib_trace_stage_delivery] = now;
                 }
             }
 
@@ -355,9 +771,48 @@ int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
         }
     }
 
+    /* with a quantum, the other active jobs get a turn before the rest of this queue */
+    if (share_spent)
+    {
+        bplib_mpool_job_mark_active(job);
+    }
+
     return forward_count;
 }
 
+/*
+ * Fast path for custody acknowledgements arriving from a CLA.  If intf_id is a service base
+ * interface with storage, the bundle is put directly on the egress of the storage service,
+ * which is where bplib_serviceflow_forward_egress() would have sent it anyway.  Returns false
+ * if this does not apply, the caller still owns the bundle then.
+ */
+bool bplib_serviceflow_push_custody_ack(bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *pblk)
+{
+    bplib_route_serviceintf_info_t *base_intf;
+    bplib_mpool_flow_t             *storage_flow;
+    bplib_mpool_ref_t               intf_ref;
+    bool                            pushed;
+
+    pushed    = false;
+    intf_ref  = bplib_route_get_intf_controlblock(tbl, intf_id);
+    base_intf = bplib_mpool_generic_data_cast(bplib_mpool_dereference(intf_ref), BPLIB_BLOCKTYPE_SERVICE_BASE);
+    if (base_intf != NULL && base_intf->storage_service != NULL)
+    {
+        storage_flow = bplib_mpool_flow_cast(bplib_mpool_dereference(base_intf->storage_service));
+        if (storage_flow != NULL)
+        {
+            pushed = bplib_mpool_flow_try_push(&storage_flow->egress, pblk, 0);
+        }
+    }
+
+    if (intf_ref != NULL)
+    {
+        bplib_route_release_intf_controlblock(tbl, intf_ref);
+    }
+
+    return pushed;
+}
+
 /**
  * @brief Append a sub-flow (data service) to the base interface block
  *
@@ -385,8 +840,9 @@ int bplib_serviceflow_add_to_base(bplib_mpool_block_t *base_intf_blk, bp_val_t s
             return BP_ERROR;
         }
 
-        endpoint_intf           = bplib_mpool_generic_data_cast(temp_block, BPLIB_BLOCKTYPE_SERVICE_ENDPOINT);
-        endpoint_intf->self_ptr = temp_block;
+        endpoint_intf                 = bplib_mpool_generic_data_cast(temp_block, BPLIB_BLOCKTYPE_SERVICE_ENDPOINT);
+        endpoint_intf->self_ptr       = temp_block;
+        endpoint_intf->service_number = svc_num;
 
         /* This can fail in the event the service number is duplicated */
         status = bplib_rbt_insert_value_unique(svc_num, &base_intf->service_index, &endpoint_intf->rbt_link);
@@ -394,6 +850,10 @@ int bplib_serviceflow_add_to_base(bplib_mpool_block_t *base_intf_blk, bp_val_t s
         {
             /* success */
             endpoint_intf->subflow_ref = bplib_mpool_ref_duplicate(endpoint_intf_ref);
+            if (base_intf->service_hash != NULL)
+            {
+                bplib_serviceflow_hash_insert(base_intf->service_hash, endpoint_intf);
+            }
             if (type == bplib_dataservice_type_storage)
             {
                 if (base_intf->storage_service != NULL)
@@ -449,6 +909,11 @@ bplib_mpool_ref_t bplib_serviceflow_remove_from_base(bplib_mpool_block_t *base_i
             endpoint_intf     = (bplib_service_endpt_t *)rbt_link; /* because its the first item */
             endpoint_intf_ref = endpoint_intf->subflow_ref;
 
+            if (base_intf->service_hash != NULL)
+            {
+                bplib_serviceflow_hash_remove(base_intf->service_hash, endpoint_intf);
+            }
+
             if (endpoint_intf_ref == base_intf->storage_service)
             {
                 bplib_mpool_ref_release(base_intf->storage_service);
@@ -469,7 +934,14 @@ int bplib_dataservice_event_impl(void *arg, bplib_mpool_block_t *intf_block)
 
     event = arg;
 
-    /* only care about state change events for now */
+    /* the only timed work of a socket is sending ADUs that waited long enough for others */
+    if (event->event_type == bplib_mpool_flow_event_poll)
+    {
+        bplib_serviceflow_coalesce_poll(intf_block);
+        return BP_SUCCESS;
+    }
+
+    /* otherwise only care about state change events for now */
     if (event->event_type != bplib_mpool_flow_event_up && event->event_type != bplib_mpool_flow_event_down)
     {
         return BP_SUCCESS;
@@ -521,37 +993,222 @@ int bplib_dataservice_base_construct(void *arg, bplib_mpool_block_t *blk)
     return BP_SUCCESS;
 }
 
-int bplib_dataservice_block_recycle(void *arg, bplib_mpool_block_t *rblk)
+int bplib_dataservice_base_destruct(void *arg, bplib_mpool_block_t *blk)
 {
-    /* this should check if the block made it to storage or not, and if the calling
-     * task in bplib_send() is blocked waiting for the block to be sent, this should
-     * release that task. In is a no-op for now until timeouts are implemented. */
+    bplib_route_serviceintf_info_t *base_intf;
+
+    base_intf = bplib_mpool_generic_data_cast(blk, BPLIB_BLOCKTYPE_SERVICE_BASE);
+    if (base_intf == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (base_intf->service_hash != NULL)
+    {
+        bplib_mpool_recycle_block(base_intf->service_hash->self_ptr);
+        base_intf->service_hash = NULL;
+    }
+
     return BP_SUCCESS;
 }
 
-void bplib_dataservice_init(bplib_mpool_t *pool)
+static void bplib_serviceflow_coalesce_free(bplib_socket_coalesce_t *co)
 {
-    const bplib_mpool_blocktype_api_t svc_base_api = (bplib_mpool_blocktype_api_t) {
-        .construct = bplib_dataservice_base_construct,
-        .destruct  = NULL,
-    };
+    /* what is left of a bundle being split is dropped */
+    bplib_mpool_ref_release(co->rx_ref);
+    bplib_os_mutex_destroy(co->rx_lock);
+    bplib_os_mutex_destroy(co->tx_lock);
+    bplib_os_free(co);
+}
+
+int bplib_dataservice_socket_destruct(void *arg, bplib_mpool_block_t *sblk)
+{
+    bplib_socket_info_t *sock;
+
+    sock = bplib_mpool_generic_data_cast(sblk, BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (sock->pri_template_blk != NULL)
+    {
+        bplib_mpool_recycle_block(sock->pri_template_blk);
+        sock->pri_template_blk = NULL;
+        sock->pri_template     = NULL;
+    }
+
+    /* bundles still on their way out may hold their own refs to this */
+    bplib_mpool_ref_release(sock->trace_ref);
+    sock->trace_ref = NULL;
+    sock->tracing   = false;
+    bplib_mpool_ref_release(sock->completions_ref);
+    sock->completions_ref = NULL;
+
+    /* anything still pending was sent on close, if it could be */
+    if (sock->coalesce != NULL)
+    {
+        bplib_serviceflow_coalesce_free(sock->coalesce);
+        sock->coalesce = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_dataservice_trace_destruct(void *arg, bplib_mpool_block_t *tblk)
+{
+    bplib_socket_trace_t *trace;
+
+    trace = bplib_mpool_generic_data_cast(tblk, BPLIB_BLOCKTYPE_SERVICE_TRACE);
+    if (trace == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* the sample ring is the only part not in the block itself */
+    if (trace->samples != NULL)
+    {
+        bplib_os_free(trace->samples);
+        trace->samples = NULL;
+    }
+    if (trace->sample_lock != NULL)
+    {
+        bplib_os_mutex_destroy(trace->sample_lock);
+        trace->sample_lock = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_dataservice_cq_destruct(void *arg, bplib_mpool_block_t *cblk)
+{
+    bplib_socket_completions_t *cq;
+
+    cq = bplib_mpool_generic_data_cast(cblk, BPLIB_BLOCKTYPE_SERVICE_CQ);
+    if (cq == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (cq->ring != NULL)
+    {
+        bplib_os_free(cq->ring);
+        cq->ring = NULL;
+    }
+    if (cq->lock != NULL)
+    {
+        bplib_os_mutex_destroy(cq->lock);
+        cq->lock = NULL;
+    }
+    if (bp_handle_is_valid(cq->notifier))
+    {
+        bplib_os_destroy_notifier(cq->notifier);
+        cq->notifier = BP_INVALID_HANDLE;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_dataservice_async_op_destruct(void *arg, bplib_mpool_block_t *oblk)
+{
+    bplib_socket_async_op_t *op;
+    bplib_completion_event_t final_event;
+    uint32_t                 events;
+
+    op = bplib_mpool_generic_data_cast(oblk, BPLIB_BLOCKTYPE_SERVICE_ASYNC_OP);
+    if (op == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /*
+     * Nothing refers to the op any more, so the node is done with the bundle and all its copies.
+     * It went where it had to if it was delivered or another custodian took it.  For a bundle
+     * which is not custody tracked, being sent or stored here is enough.
+     */
+    events = __atomic_load_n(&op->events, __ATOMIC_RELAXED);
+    if ((events & ((1U << bplib_completion_delivered) | (1U << bplib_completion_custody_acked))) != 0 ||
+        (op->policy != bplib_policy_delivery_custody_tracking &&
+         (events & ((1U << bplib_completion_sent) | (1U << bplib_completion_custody_taken))) != 0))
+    {
+        final_event = bplib_completion_done;
+    }
+    else
+    {
+        final_event = bplib_completion_failed;
+    }
+
+    /* an op which never got as far as a bundle has no queue, see bplib_send_async() */
+    bplib_serviceflow_completion_post(op->cq_ref, op->user_tag, final_event);
+    bplib_mpool_ref_release(op->cq_ref);
+    op->cq_ref = NULL;
+
+    return BP_SUCCESS;
+}
+
+int bplib_dataservice_block_recycle(void *arg, bplib_mpool_block_t *rblk)
+{
+    /* this should check if the block made it to storage or not, and if the calling
+     * task in bplib_send() is blocked waiting for the block to be sent, this should
+     * release that task. In is a no-op for now until timeouts are implemented. */
+    return BP_SUCCESS;
+}
+
+void bplib_dataservice_init(bplib_mpool_t *pool)
+{
+    const bplib_mpool_blocktype_api_t svc_base_api = (bplib_mpool_blocktype_api_t) {
+        .construct = bplib_dataservice_base_construct,
+        .destruct  = bplib_dataservice_base_destruct,
+    };
+
+    const bplib_mpool_blocktype_api_t svc_socket_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_dataservice_socket_destruct,
+    };
 
     const bplib_mpool_blocktype_api_t svc_block_api = (bplib_mpool_blocktype_api_t) {
         .construct = NULL,
         .destruct  = bplib_dataservice_block_recycle,
     };
 
+    const bplib_mpool_blocktype_api_t svc_trace_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_dataservice_trace_destruct,
+    };
+
+    const bplib_mpool_blocktype_api_t svc_cq_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_dataservice_cq_destruct,
+    };
+
+    const bplib_mpool_blocktype_api_t svc_async_op_api = (bplib_mpool_blocktype_api_t) {
+        .construct = NULL,
+        .destruct  = bplib_dataservice_async_op_destruct,
+    };
+
     bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_BASE, &svc_base_api,
                                    sizeof(bplib_route_serviceintf_info_t));
     bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_ENDPOINT, NULL, sizeof(bplib_service_endpt_t));
-    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_SOCKET, NULL, sizeof(bplib_socket_info_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_SOCKET, &svc_socket_api, sizeof(bplib_socket_info_t));
     bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_BLOCK, &svc_block_api, 0);
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_HASH, NULL, sizeof(bplib_service_hash_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_TEMPLATE, NULL, sizeof(bp_pri_template_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_TRACE, &svc_trace_api, sizeof(bplib_socket_trace_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_CQ, &svc_cq_api, sizeof(bplib_socket_completions_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_BLOCKTYPE_SERVICE_ASYNC_OP, &svc_async_op_api,
+                                   sizeof(bplib_socket_async_op_t));
+
+    /* for payloads sent directly from application buffers, see bplib_send_extern() */
+    bplib_mpool_bblock_cbor_slice_init(pool);
+    bplib_mpool_bblock_cbor_extern_init(pool);
 }
 
 bp_handle_t bplib_dataservice_add_base_intf(bplib_routetbl_t *rtbl, bp_ipn_t node_number)
 {
     bplib_mpool_block_t            *sblk;
     bplib_route_serviceintf_info_t *base_intf;
+    bplib_mpool_flow_t             *flow;
+    bplib_mpool_block_t            *hblk;
     bp_handle_t                     self_intf_id;
     bplib_mpool_t                  *pool;
 
@@ -578,6 +1235,14 @@ bp_handle_t bplib_dataservice_add_base_intf(bplib_routetbl_t *rtbl, bp_ipn_t nod
     {
         self_intf_id           = bplib_route_register_generic_intf(rtbl, BP_INVALID_HANDLE, sblk);
         base_intf->node_number = node_number;
+
+        /* without the hash table, every lookup goes to the RB tree */
+        hblk                    = bplib_mpool_generic_data_alloc(pool, BPLIB_BLOCKTYPE_SERVICE_HASH, NULL);
+        base_intf->service_hash = bplib_mpool_generic_data_cast(hblk, BPLIB_BLOCKTYPE_SERVICE_HASH);
+        if (base_intf->service_hash != NULL)
+        {
+            base_intf->service_hash->self_ptr = hblk;
+        }
     }
 
     if (bp_handle_is_valid(self_intf_id))
@@ -585,6 +1250,12 @@ bp_handle_t bplib_dataservice_add_base_intf(bplib_routetbl_t *rtbl, bp_ipn_t nod
         bplib_route_register_forward_ingress_handler(rtbl, self_intf_id, bplib_serviceflow_forward_ingress);
         bplib_route_register_forward_egress_handler(rtbl, self_intf_id, bplib_serviceflow_forward_egress);
         bplib_route_register_event_handler(rtbl, self_intf_id, bplib_dataservice_event_impl);
+
+        flow = bplib_mpool_flow_cast(sblk);
+        if (flow != NULL)
+        {
+            bplib_mpool_flow_set_jobtype(flow, bplib_mpool_jobtype_dataservice);
+        }
     }
     else
     {
@@ -640,6 +1311,11 @@ bp_handle_t bplib_dataservice_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t
         {
             /* success; mark this as a storage-capable intf */
             bplib_route_intf_set_flags(tbl, parent_intf_id, BPLIB_MPOOL_FLOW_FLAGS_STORAGE);
+            bplib_mpool_flow_set_jobtype(flow, bplib_mpool_jobtype_cache_fsm);
+        }
+        else
+        {
+            bplib_mpool_flow_set_jobtype(flow, bplib_mpool_jobtype_dataservice);
         }
     }
 
@@ -710,6 +1386,7 @@ bp_socket_t *bplib_create_socket(bplib_routetbl_t *rtbl)
         sock->params.local_delivery_policy = bplib_policy_delivery_custody_tracking;
         sock->params.local_retx_interval   = 30000;
         sock->params.lifetime              = 3600000;
+        sock->params.class_of_service      = BP_COS_NORMAL;
 
         sock_ref = bplib_mpool_ref_create(sblk);
     }
@@ -770,6 +1447,8 @@ int bplib_connect_socket(bp_socket_t *desc, const bp_ipn_addr_t *destination_ipn
 {
     bplib_socket_info_t *sock;
     bplib_mpool_ref_t    sock_ref;
+    bp_primary_block_t   pri;
+    bp_pri_template_t   *tmpl;
 
     sock_ref = (bplib_mpool_ref_t)desc;
 
@@ -801,6 +1480,33 @@ int bplib_connect_socket(bp_socket_t *desc, const bp_ipn_addr_t *destination_ipn
 
     sock->params.remote_ipn = *destination_ipn;
 
+    /*
+     * Nothing else in the primary block changes from here on, so it can be encoded now.  If that
+     * does not fit in a template, each bundle just gets its primary block encoded in full.
+     */
+    if (sock->pri_template_blk == NULL)
+    {
+        sock->pri_template_blk = bplib_mpool_generic_data_alloc(bplib_route_get_mpool(sock->parent_rtbl),
+                                                                BPLIB_BLOCKTYPE_SERVICE_TEMPLATE, NULL);
+    }
+
+    memset(&pri, 0, sizeof(pri));
+    bplib_serviceflow_init_primary(sock, &pri);
+    tmpl               = bplib_mpool_generic_data_cast(sock->pri_template_blk, BPLIB_BLOCKTYPE_SERVICE_TEMPLATE);
+    sock->pri_template = NULL;
+    if (tmpl == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): no memory for a primary block template\n", __func__);
+    }
+    else if (v7_block_encode_pri_template(tmpl, &pri) < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): primary block does not fit a template\n", __func__);
+    }
+    else
+    {
+        sock->pri_template = tmpl;
+    }
+
     bplib_route_intf_set_flags(sock->parent_rtbl, sock->socket_intf_id,
                                BPLIB_MPOOL_FLOW_FLAGS_ENDPOINT | BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
 
@@ -822,6 +1528,12 @@ void bplib_close_socket(bp_socket_t *desc)
         return;
     }
 
+    /* ADUs still waiting for others are sent now if there is room, while the socket is still bound */
+    if (sock->coalesce != NULL)
+    {
+        bplib_socket_flush(desc, 0);
+    }
+
     if (sock->params.local_ipn.node_number != 0)
     {
         detached_ref = bplib_dataservice_detach(sock->parent_rtbl, &sock->params.local_ipn);
@@ -839,35 +1551,60 @@ void bplib_close_socket(bp_socket_t *desc)
     bplib_mpool_ref_release(sock_ref);
 }
 
-int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t timeout)
+/*
+ * Finds the socket that a bundle from this socket can be delivered to directly, which is when it is
+ * best effort and the destination is another service on the same node.  Storage would not keep such
+ * a bundle, so going straight to the socket gets it where the service interface would have sent it.
+ * Returns a ref to the flow of that socket, or NULL if the bundle has to go through the router.
+ */
+static bplib_mpool_ref_t bplib_serviceflow_local_target(bplib_socket_info_t *sock, bplib_mpool_flow_t *flow)
 {
-    int                           status;
-    bplib_mpool_block_t          *rblk;
-    bplib_mpool_flow_t           *flow;
-    bplib_mpool_ref_t             refptr;
-    bplib_mpool_block_t          *pblk;
-    bplib_mpool_bblock_primary_t *pri_block;
-    bplib_mpool_ref_t             sock_ref;
-    bplib_socket_info_t          *sock;
-    uint64_t                      ingress_time;
-    uint64_t                      ingress_limit;
+    bplib_route_serviceintf_info_t *base_intf;
+    bplib_service_endpt_t          *tgt_subintf;
 
-    sock_ref      = (bplib_mpool_ref_t)desc;
-    ingress_time  = bplib_os_get_dtntime_ms();
-    ingress_limit = ingress_time + timeout;
+    if (sock->params.local_delivery_policy != bplib_policy_delivery_none || sock->params.remote_ipn.node_number == 0 ||
+        sock->params.remote_ipn.node_number != sock->params.local_ipn.node_number)
+    {
+        return NULL;
+    }
 
-    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
-    if (sock == NULL)
+    /* the node of the base interface is the local node, the socket is bound under it */
+    base_intf = bplib_mpool_generic_data_cast(bplib_mpool_dereference(flow->parent), BPLIB_BLOCKTYPE_SERVICE_BASE);
+    if (base_intf == NULL || base_intf->node_number != sock->params.remote_ipn.node_number)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
-        return BP_ERROR;
+        return NULL;
     }
 
-    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
-    if (flow == NULL)
+    tgt_subintf = bplib_serviceflow_lookup(base_intf, sock->params.remote_ipn.service_number);
+    if (tgt_subintf == NULL || tgt_subintf->subflow_ref == base_intf->storage_service ||
+        bplib_mpool_flow_cast(bplib_mpool_dereference(tgt_subintf->subflow_ref)) == NULL)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad flow ref - is socket connected?\n", __func__);
-        return BP_ERROR;
+        return NULL;
+    }
+
+    return bplib_mpool_ref_duplicate(tgt_subintf->subflow_ref);
+}
+
+/*
+ * Bundles one payload and wraps it in a ref block, see bplib_serviceflow_make_bundle()
+ */
+static bplib_mpool_block_t *bplib_serviceflow_build_bundle(bplib_socket_info_t *sock, bplib_mpool_ref_t sock_ref,
+                                                           bplib_mpool_ref_t content_ref, bplib_mpool_ref_t op_ref,
+                                                           const void *payload, size_t size, uint64_t ingress_time,
+                                                           uint64_t ingress_limit, bool local_delivery, int *status)
+{
+    bplib_mpool_block_t          *rblk;
+    bplib_mpool_ref_t             refptr;
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *pri_block;
+    bool                          sampled;
+    bool                          skip_encode;
+
+    /* a payload over the memory quota of the socket is turned away before anything is allocated for it */
+    *status = bplib_mpool_flow_quota_admit(bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref)), size);
+    if (*status != BP_SUCCESS)
+    {
+        return NULL;
     }
 
     /* If no pri block is available, this should block and wait for one (up to ingress_limit) */
@@ -876,14 +1613,20 @@ int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t tim
     if (pblk == NULL)
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): unable to alloc pri block\n", __func__);
-        return BP_TIMEOUT;
+        *status = BP_TIMEOUT;
+        return NULL;
     }
 
-    status = bplib_serviceflow_bundleize_payload(sock, pblk, payload, size);
-    if (status != BP_SUCCESS)
+    /* the primary block of a best effort bundle can wait until it is known that it is going out */
+    skip_encode = (local_delivery && sock->local_skip_encode) ||
+                  (sock->egress_encode && sock->params.local_delivery_policy == bplib_policy_delivery_none);
+
+    *status = bplib_serviceflow_bundleize_payload(sock, pblk, content_ref, payload, size, skip_encode);
+    if (*status != BP_SUCCESS)
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): cannot bundleize payload, out of memory?\n", __func__);
-        return status;
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
     }
 
     /* convert to a dynamically-managed ref for passing in queues */
@@ -893,7 +1636,8 @@ int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t tim
         /* not expected... */
         bplib_mpool_recycle_block(pblk);
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "Cannot convert payload to ref\n");
-        return BP_ERROR;
+        *status = BP_ERROR;
+        return NULL;
     }
     pblk = NULL; /* only the ref should be used from here */
 
@@ -905,116 +1649,1868 @@ int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t tim
         {
             pri_block->data.delivery.ingress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(sock_ref));
             pri_block->data.delivery.ingress_time    = ingress_time;
-        }
-
-        if (bplib_mpool_flow_try_push(&flow->ingress, rblk, ingress_limit))
-        {
-            sock->ingress_byte_count += size;
-            status = BP_SUCCESS;
-        }
-        else
-        {
-            status = BP_TIMEOUT;
+            pri_block->data.delivery.stage_time[bplib_trace_stage_bundleize] = bplib_os_get_dtntime_ms();
+            bplib_mpool_bblock_primary_quota_charge(pri_block, sock_ref, size);
+            if (local_delivery)
+            {
+                /* it skips the routing, so these stages take no time */
+                pri_block->data.delivery.stage_time[bplib_trace_stage_route] =
+                    pri_block->data.delivery.stage_time[bplib_trace_stage_bundleize];
+                pri_block->data.delivery.stage_time[bplib_trace_stage_delivery] =
+                    pri_block->data.delivery.stage_time[bplib_trace_stage_bundleize];
+            }
+            sampled = bplib_serviceflow_trace_pick(sock);
+            if (sock->tracing || sampled)
+            {
+                pri_block->data.delivery.trace_ref         = bplib_mpool_ref_duplicate(sock->trace_ref);
+                pri_block->data.delivery.trace_sampled     = sampled;
+                pri_block->data.delivery.trace_sample_only = !sock->tracing;
+            }
+            if (op_ref != NULL)
+            {
+                pri_block->data.delivery.completion_ref = bplib_mpool_ref_duplicate(op_ref);
+            }
         }
     }
     else
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): failed to create block ref, out of memory?\n", __func__);
-        status = BP_ERROR;
+        *status = BP_ERROR;
     }
 
-    /*
-     * JPHFIX - to implement a timeout, this should wait/confirm here that the bundle either
-     * reached a storage (for custody-tracked) or made it to the next hop CLA (for best-effort svc level)
-     */
-
+    /* the ref block holds its own reference, if it was made */
     bplib_mpool_ref_release(refptr);
 
-    bplib_route_set_maintenance_request(sock->parent_rtbl);
+    return rblk;
+}
 
-    return status;
+/*
+ * Bundles one payload and wraps it in a ref block, ready to be pushed to the socket ingress queue.
+ * Returns NULL if that was not possible, with the reason in status.
+ *
+ * If the pool is too full, the blocks that the socket has set aside are used, so this does not wait.
+ */
+static bplib_mpool_block_t *bplib_serviceflow_make_bundle(bplib_socket_info_t *sock, bplib_mpool_ref_t sock_ref,
+                                                          bplib_mpool_ref_t content_ref, bplib_mpool_ref_t op_ref,
+                                                          const void *payload, size_t size, uint64_t ingress_time,
+                                                          uint64_t ingress_limit, bool local_delivery, int *status)
+{
+    bplib_mpool_block_t   *rblk;
+    bplib_mpool_flow_t    *flow;
+    bplib_mpool_reserve_t *prev_reserve;
+
+    flow         = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    prev_reserve = bplib_mpool_reserve_enter((flow != NULL) ? &flow->reserve : NULL);
+    rblk = bplib_serviceflow_build_bundle(sock, sock_ref, content_ref, op_ref, payload, size, ingress_time,
+                                          ingress_limit, local_delivery, status);
+    bplib_mpool_reserve_leave(prev_reserve);
+
+    return rblk;
 }
 
-int bplib_recv(bp_socket_t *desc, void *payload, size_t *size, uint32_t timeout)
+/*
+ * Copies the payload of a block pulled from the socket egress queue into the buffer.
+ * The block itself is left for the caller to recycle.
+ */
+static int bplib_serviceflow_deliver_bundle(bplib_socket_info_t *sock, bplib_mpool_ref_t sock_ref,
+                                            bplib_mpool_block_t *pblk, void *payload, size_t *size)
 {
     int                           status;
-    bplib_socket_info_t          *sock;
     bplib_mpool_bblock_primary_t *pri_block;
-    bplib_mpool_block_t          *pblk;
     bplib_mpool_ref_t             refptr;
-    bplib_mpool_ref_t             sock_ref;
-    bplib_mpool_flow_t           *flow;
-    uint64_t                      egress_time_limit;
+    uint64_t                      now;
 
-    sock_ref = (bplib_mpool_ref_t)desc;
+    refptr = bplib_mpool_ref_from_block(pblk);
 
-    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
-    if (sock == NULL)
+    if (refptr != NULL)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
-        return BP_ERROR;
+        /* note, the unbundleize always consumes the refptr */
+        status = bplib_serviceflow_unbundleize_payload(sock, refptr, payload, size);
+    }
+    else
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): unable to create ref from pblk\n", __func__);
+        status = BP_ERROR;
     }
 
-    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
-    if (flow == NULL)
+    if (status == BP_SUCCESS)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad flow_ref\n", __func__);
-        return BP_ERROR;
+        sock->egress_byte_count += *size;
+
+        pri_block = bplib_mpool_bblock_primary_cast(pblk);
+        if (pri_block != NULL)
+        {
+            now                                     = bplib_os_get_dtntime_ms();
+            pri_block->data.delivery.egress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(sock_ref));
+            pri_block->data.delivery.egress_time    = now;
+            bplib_serviceflow_trace_recv(sock, pri_block, now);
+        }
     }
 
-    /* preemptively trigger the maintenance task to run */
-    /* this may help in the event that the queue is currently empty but
-     * there is data somewhere else in the pool that is headed here (assuming
-     * timeout is nonzero). */
-    bplib_route_set_maintenance_request(sock->parent_rtbl);
+    return status;
+}
 
-    if (timeout == 0)
+/*
+ * Fills in iov with pointers to the payload of a bundle in pool memory, see bplib_recv_view()
+ * Unlike bplib_serviceflow_unbundleize_payload() this does not consume the refptr.
+ */
+static int bplib_serviceflow_view_payload(bplib_mpool_ref_t refptr, bplib_iovec_t *iov, uint32_t *iov_count,
+                                          size_t *size)
+{
+    bplib_mpool_bblock_primary_t   *pri;
+    bplib_mpool_bblock_canonical_t *ccb_pay;
+    size_t                          content_size;
+    size_t                          content_offset;
+    size_t                          iov_needed;
+
+    pri = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
+    if (pri == NULL)
     {
-        egress_time_limit = 0;
+        bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): Not a primary block\n", __func__);
+        return BP_ERROR;
     }
-    else
+
+    ccb_pay = bplib_mpool_bblock_canonical_cast(
+        bplib_mpool_bblock_primary_locate_canonical(pri, bp_blocktype_payloadBlock));
+    if (ccb_pay == NULL)
     {
-        egress_time_limit = bplib_os_get_dtntime_ms() + timeout;
+        bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): No payload\n", __func__);
+        return BP_ERROR;
     }
 
-    pblk = bplib_mpool_flow_try_pull(&flow->egress, egress_time_limit);
+    content_size   = bplib_mpool_bblock_canonical_get_content_length(ccb_pay);
+    content_offset = bplib_mpool_bblock_canonical_get_content_offset(ccb_pay);
 
-    if (pblk == NULL)
+    /* as in bplib_serviceflow_unbundleize_payload(), the offset is never zero in a decoded bundle */
+    if (content_offset == 0)
     {
-        status = BP_TIMEOUT;
+        bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): Incorrectly sized bundle\n", __func__);
+        return BP_ERROR;
     }
-    else
+
+    iov_needed = bplib_mpool_bblock_cbor_export_iov_range(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb_pay),
+                                                          iov, *iov_count, content_offset, content_size);
+    if (iov_needed > *iov_count)
     {
-        refptr = bplib_mpool_ref_from_block(pblk);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): Not enough iov entries for payload\n", __func__);
+        *iov_count = iov_needed;
+        return BP_ERROR;
+    }
 
-        if (refptr != NULL)
-        {
-            /* note, the unbundleize always consumes the refptr */
-            status = bplib_serviceflow_unbundleize_payload(sock, refptr, payload, size);
-        }
+    *iov_count = iov_needed;
+    *size      = content_size;
+    return BP_SUCCESS;
+}
+
+/*
+ * Bundles one payload and pushes it to the socket ingress queue, see bplib_send()
+ */
+static int bplib_serviceflow_send_bundle(bplib_socket_info_t *sock, bplib_mpool_flow_t *flow,
+                                         bplib_mpool_ref_t sock_ref, bplib_mpool_ref_t content_ref,
+                                         bplib_mpool_ref_t op_ref, const void *payload, size_t size, uint32_t timeout)
+{
+    int                          status;
+    bplib_mpool_block_t         *rblk;
+    bplib_mpool_ref_t            target_ref;
+    bplib_mpool_subq_workitem_t *queue;
+    uint64_t                     ingress_time;
+    uint64_t                     ingress_limit;
+    uint64_t                     push_limit;
+
+    ingress_time  = bplib_os_get_dtntime_ms();
+    ingress_limit = ingress_time + timeout;
+    push_limit    = ingress_limit;
+
+    /* a bundle for another socket on this node can go straight to its queue */
+    target_ref = bplib_serviceflow_local_target(sock, flow);
+    if (target_ref != NULL)
+    {
+        queue = &bplib_mpool_flow_cast(bplib_mpool_dereference(target_ref))->egress;
+    }
+    else
+    {
+        queue = &flow->ingress;
+    }
+
+    rblk = NULL;
+    if (sock->nonblocking && bplib_mpool_subq_workitem_get_space(queue) == 0)
+    {
+        /* no point making a bundle that cannot be pushed, and this does not need the lock to tell */
+        status = BP_TIMEOUT;
+    }
+    else
+    {
+        if (sock->nonblocking)
+        {
+            push_limit = 0;
+        }
+
+        rblk = bplib_serviceflow_make_bundle(sock, sock_ref, content_ref, op_ref, payload, size, ingress_time,
+                                             ingress_limit, target_ref != NULL, &status);
+    }
+
+    if (rblk != NULL)
+    {
+        if (bplib_mpool_flow_try_push(queue, rblk, push_limit))
+        {
+            sock->ingress_byte_count += size;
+            status = BP_SUCCESS;
+        }
         else
         {
-            bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): unable to create ref from pblk\n", __func__);
-            status = BP_ERROR;
+            bplib_mpool_recycle_block(rblk);
+            status = BP_TIMEOUT;
         }
 
-        /* if a block was pulled from the queue, that needs to be recycled */
-        /* this should always be the case */
-        if (status == BP_SUCCESS)
+        /*
+         * JPHFIX - to implement a timeout, this should wait/confirm here that the bundle either
+         * reached a storage (for custody-tracked) or made it to the next hop CLA (for best-effort svc level)
+         */
+
+        /* a bundle delivered directly leaves nothing for the maintenance task to do */
+        if (target_ref == NULL)
         {
-            sock->egress_byte_count += *size;
+            bplib_route_set_maintenance_request(sock->parent_rtbl);
+        }
+    }
+
+    if (target_ref != NULL)
+    {
+        bplib_mpool_ref_release(target_ref);
+    }
+
+    return status;
+}
+
+static inline bool bplib_serviceflow_coalesce_on(const bplib_socket_info_t *sock)
+{
+    return sock->coalesce != NULL && sock->coalesce->max_size != 0;
+}
+
+/*
+ * Sends whatever ADUs are waiting in the buffer of the socket as one bundle, with tx_lock held.
+ * If it could not be sent, they stay in the buffer for the next try.
+ */
+static int bplib_serviceflow_coalesce_flush(bplib_socket_info_t *sock, bplib_mpool_flow_t *flow,
+                                            bplib_mpool_ref_t sock_ref, uint32_t timeout)
+{
+    bplib_socket_coalesce_t *co;
+    int                      status;
+
+    co = sock->coalesce;
+    if (co->used == 0)
+    {
+        return BP_SUCCESS;
+    }
+
+    status = bplib_serviceflow_send_bundle(sock, flow, sock_ref, NULL, NULL, co->buf, co->used, timeout);
+    if (status == BP_SUCCESS)
+    {
+        co->used = 0;
+    }
+
+    return status;
+}
+
+static void bplib_serviceflow_coalesce_put_header(uint8_t *hdr, size_t size)
+{
+    hdr[0] = (uint8_t)(size >> 24);
+    hdr[1] = (uint8_t)(size >> 16);
+    hdr[2] = (uint8_t)(size >> 8);
+    hdr[3] = (uint8_t)size;
+}
+
+/*
+ * Sends an ADU too big to share a bundle, in a bundle of its own.  It still has its length in front,
+ * so it goes through a copy that has room for that.
+ */
+static int bplib_serviceflow_coalesce_send_alone(bplib_socket_info_t *sock, bplib_mpool_flow_t *flow,
+                                                 bplib_mpool_ref_t sock_ref, const void *payload, size_t size,
+                                                 uint32_t timeout)
+{
+    uint8_t *framed;
+    int      status;
+
+    framed = bplib_os_calloc(BPLIB_SOCKET_COALESCE_HDR_SIZE + size);
+    if (framed == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): no memory to frame ADU\n", __func__);
+        return BP_ERROR;
+    }
+
+    bplib_serviceflow_coalesce_put_header(framed, size);
+    memcpy(&framed[BPLIB_SOCKET_COALESCE_HDR_SIZE], payload, size);
+    status = bplib_serviceflow_send_bundle(sock, flow, sock_ref, NULL, NULL, framed,
+                                           BPLIB_SOCKET_COALESCE_HDR_SIZE + size, timeout);
+    bplib_os_free(framed);
+
+    return status;
+}
 
-            pri_block = bplib_mpool_bblock_primary_cast(pblk);
-            if (pri_block != NULL)
+/*
+ * Adds one ADU to the buffer of a socket with coalescing on, see bplib_socket_set_coalescing().
+ * If what is already pending has to go first to make room and cannot, the ADU is not taken.
+ */
+static int bplib_serviceflow_coalesce_send(bplib_socket_info_t *sock, bplib_mpool_flow_t *flow,
+                                           bplib_mpool_ref_t sock_ref, const void *payload, size_t size,
+                                           uint32_t timeout)
+{
+    bplib_socket_coalesce_t *co;
+    size_t                   record_size;
+    uint64_t                 now;
+    int                      status;
+
+    co          = sock->coalesce;
+    record_size = BPLIB_SOCKET_COALESCE_HDR_SIZE + size;
+    now         = bplib_os_get_dtntime_coarse_ms();
+
+    bplib_os_mutex_lock(co->tx_lock);
+
+    status = BP_SUCCESS;
+    if (co->used != 0 && (co->used + record_size) > co->max_size)
+    {
+        status = bplib_serviceflow_coalesce_flush(sock, flow, sock_ref, timeout);
+    }
+
+    if (status != BP_SUCCESS)
+    {
+        /* nothing was taken, the caller can try again */
+    }
+    else if (record_size > co->max_size)
+    {
+        status = bplib_serviceflow_coalesce_send_alone(sock, flow, sock_ref, payload, size, timeout);
+    }
+    else
+    {
+        if (co->used == 0)
+        {
+            co->first_time = now;
+            if (co->max_delay != 0)
             {
-                pri_block->data.delivery.egress_intf_id =
-                    bplib_mpool_get_external_id(bplib_mpool_dereference(sock_ref));
-                pri_block->data.delivery.egress_time = bplib_os_get_dtntime_ms();
+                bplib_route_intf_set_poll_time(sock->parent_rtbl, sock->socket_intf_id, now + co->max_delay);
             }
         }
 
-        bplib_mpool_recycle_block(pblk);
+        bplib_serviceflow_coalesce_put_header(&co->buf[co->used], size);
+        memcpy(&co->buf[co->used + BPLIB_SOCKET_COALESCE_HDR_SIZE], payload, size);
+        co->used += record_size;
+
+        /*
+         * The ADU is taken either way, so if the bundle cannot be sent now it is left for the next
+         * send or the poll, and this still returns success.
+         */
+        if ((co->used + BPLIB_SOCKET_COALESCE_HDR_SIZE) >= co->max_size ||
+            (co->max_delay != 0 && now >= (co->first_time + co->max_delay)))
+        {
+            bplib_serviceflow_coalesce_flush(sock, flow, sock_ref, timeout);
+        }
+    }
+
+    bplib_os_mutex_unlock(co->tx_lock);
+
+    return status;
+}
+
+void bplib_serviceflow_coalesce_poll(bplib_mpool_block_t *intf_block)
+{
+    bplib_socket_info_t     *sock;
+    bplib_socket_coalesce_t *co;
+    bplib_mpool_flow_t      *flow;
+    bplib_mpool_ref_t        sock_ref;
+    uint64_t                 now;
+
+    sock = bplib_mpool_generic_data_cast(intf_block, BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(intf_block);
+    if (sock == NULL || flow == NULL || sock->coalesce == NULL || sock->coalesce->max_delay == 0)
+    {
+        return;
+    }
+
+    co  = sock->coalesce;
+    now = bplib_os_get_dtntime_coarse_ms();
+
+    /* if an app task has the buffer, try again later rather than wait for it here */
+    if (bplib_os_mutex_trylock(co->tx_lock) != BP_SUCCESS)
+    {
+        bplib_route_intf_set_poll_time(sock->parent_rtbl, sock->socket_intf_id, now + co->max_delay);
+        return;
+    }
+
+    if (co->used != 0 && now >= (co->first_time + co->max_delay))
+    {
+        sock_ref = bplib_mpool_ref_create(intf_block);
+        if (sock_ref != NULL)
+        {
+            bplib_serviceflow_coalesce_flush(sock, flow, sock_ref, 0);
+            bplib_mpool_ref_release(sock_ref);
+        }
+    }
+
+    /* still pending, either it was not due yet or it could not be sent */
+    if (co->used != 0)
+    {
+        if (now < (co->first_time + co->max_delay))
+        {
+            now = co->first_time;
+        }
+        bplib_route_intf_set_poll_time(sock->parent_rtbl, sock->socket_intf_id, now + co->max_delay);
+    }
+
+    bplib_os_mutex_unlock(co->tx_lock);
+}
+
+int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t timeout)
+{
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_ref_t    sock_ref;
+    bplib_socket_info_t *sock;
+
+    sock_ref = (bplib_mpool_ref_t)desc;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad flow ref - is socket connected?\n", __func__);
+        return BP_ERROR;
+    }
+
+    if (bplib_serviceflow_coalesce_on(sock))
+    {
+        return bplib_serviceflow_coalesce_send(sock, flow, sock_ref, payload, size, timeout);
+    }
+
+    return bplib_serviceflow_send_bundle(sock, flow, sock_ref, NULL, NULL, payload, size, timeout);
+}
+
+int bplib_send_extern(bp_socket_t *desc, const void *payload, size_t size, bplib_payload_release_func_t release_func,
+                      void *release_arg, uint32_t timeout)
+{
+    int                  status;
+    bplib_mpool_block_t *eblk;
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_ref_t    sock_ref;
+    bplib_mpool_ref_t    content_ref;
+    bplib_socket_info_t *sock;
+
+    sock_ref    = (bplib_mpool_ref_t)desc;
+    eblk        = NULL;
+    content_ref = NULL;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (sock == NULL || flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor - is socket connected?\n", __func__);
+    }
+    else if (bplib_serviceflow_coalesce_on(sock))
+    {
+        /* the ADU is copied into the buffer, so the caller gets its own back at once */
+        status = bplib_serviceflow_coalesce_send(sock, flow, sock_ref, payload, size, timeout);
+        if (release_func != NULL)
+        {
+            release_func(release_arg, payload, size);
+        }
+        return status;
+    }
+    else
+    {
+        eblk = bplib_mpool_bblock_cbor_extern_alloc(bplib_route_get_mpool(sock->parent_rtbl), payload, size,
+                                                    release_func, release_arg);
+        if (eblk != NULL)
+        {
+            content_ref = bplib_mpool_ref_create(eblk);
+        }
+    }
+
+    if (content_ref == NULL)
+    {
+        /* the buffer goes back to the caller either way, from here or when the block is recycled */
+        if (eblk != NULL)
+        {
+            bplib_mpool_recycle_block(eblk);
+        }
+        else if (release_func != NULL)
+        {
+            release_func(release_arg, payload, size);
+        }
+
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): unable to use the payload buffer\n", __func__);
+        return BP_ERROR;
+    }
+
+    status = bplib_serviceflow_send_bundle(sock, flow, sock_ref, content_ref, NULL, payload, size, timeout);
+
+    /* the slices in the bundle hold their own refs, so when it is gone, so is the buffer */
+    bplib_mpool_ref_release(content_ref);
+
+    return status;
+}
+
+int bplib_send_async(bp_socket_t *desc, const void *payload, size_t size, uint64_t user_tag)
+{
+    int                         status;
+    bplib_mpool_block_t        *oblk;
+    bplib_mpool_flow_t         *flow;
+    bplib_mpool_ref_t           sock_ref;
+    bplib_mpool_ref_t           op_ref;
+    bplib_mpool_ref_t           cq_ref;
+    bplib_socket_info_t        *sock;
+    bplib_socket_completions_t *cq;
+    bplib_socket_async_op_t    *op;
+
+    sock_ref = (bplib_mpool_ref_t)desc;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (sock == NULL || flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor - is socket connected?\n", __func__);
+        return BP_ERROR;
+    }
+
+    cq = NULL;
+    if (sock->completions_ref != NULL)
+    {
+        cq = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock->completions_ref), BPLIB_BLOCKTYPE_SERVICE_CQ);
+    }
+    if (cq == NULL || bplib_serviceflow_coalesce_on(sock))
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): no completion queue, or socket is coalescing\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* the op is counted before its bundle is made, so the queue can never have more posted than it has room for */
+    bplib_os_mutex_lock(cq->lock);
+    if (cq->in_flight < cq->max_in_flight)
+    {
+        ++cq->in_flight;
+        status = BP_SUCCESS;
+    }
+    else
+    {
+        status = BP_TIMEOUT;
+    }
+    bplib_os_mutex_unlock(cq->lock);
+
+    if (status != BP_SUCCESS)
+    {
+        return status;
+    }
+
+    op_ref = NULL;
+    op     = NULL;
+    oblk   = bplib_mpool_generic_data_alloc(bplib_route_get_mpool(sock->parent_rtbl), BPLIB_BLOCKTYPE_SERVICE_ASYNC_OP,
+                                            NULL);
+    if (oblk != NULL)
+    {
+        op           = bplib_mpool_generic_data_cast(oblk, BPLIB_BLOCKTYPE_SERVICE_ASYNC_OP);
+        op->cq_ref   = bplib_mpool_ref_duplicate(sock->completions_ref);
+        op->user_tag = user_tag;
+        op->policy   = sock->params.local_delivery_policy;
+        op_ref       = bplib_mpool_ref_create(oblk);
+    }
+
+    if (op_ref == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): no memory for the op\n", __func__);
+        status = BP_ERROR;
+    }
+    else
+    {
+        /* a timeout of 0 means the pool and queue are only checked, not waited on */
+        status = bplib_serviceflow_send_bundle(sock, flow, sock_ref, NULL, op_ref, payload, size, 0);
+    }
+
+    if (status != BP_SUCCESS)
+    {
+        /*
+         * The caller is told there are no completions for this, so the op must not post any.  If a
+         * bundle was made it was never pushed, so nothing else can have seen the op yet.
+         */
+        if (op != NULL)
+        {
+            cq_ref     = op->cq_ref;
+            op->cq_ref = NULL;
+            bplib_mpool_ref_release(cq_ref);
+        }
+        if (op_ref == NULL && oblk != NULL)
+        {
+            bplib_mpool_recycle_block(oblk);
+        }
+
+        bplib_os_mutex_lock(cq->lock);
+        --cq->in_flight;
+        bplib_os_mutex_unlock(cq->lock);
     }
 
+    /* from here the op is held by the bundle, and its copies in storage */
+    bplib_mpool_ref_release(op_ref);
+
     return status;
 }
+
+int bplib_send_many(bp_socket_t *desc, const bplib_send_buf_t *payloads, uint32_t count, int *status_list,
+                    uint32_t timeout)
+{
+    int                          status;
+    bplib_mpool_block_t         *rblk;
+    bplib_mpool_block_t          pending_list;
+    bplib_mpool_flow_t          *flow;
+    bplib_mpool_ref_t            sock_ref;
+    bplib_mpool_ref_t            target_ref;
+    bplib_mpool_subq_workitem_t *queue;
+    bplib_socket_info_t         *sock;
+    uint64_t                     ingress_time;
+    uint64_t                     ingress_limit;
+    uint64_t                     push_limit;
+    uint32_t                     i;
+    uint32_t                     num_made;
+    uint32_t                     num_pushed;
+    uint32_t                     max_made;
+
+    sock_ref      = (bplib_mpool_ref_t)desc;
+    ingress_time  = bplib_os_get_dtntime_ms();
+    ingress_limit = ingress_time + timeout;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (sock == NULL || flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor - is socket connected?\n", __func__);
+        for (i = 0; i < count; ++i)
+        {
+            status_list[i] = BP_ERROR;
+        }
+        return BP_ERROR;
+    }
+
+    if (bplib_serviceflow_coalesce_on(sock))
+    {
+        /* the ADUs are packed into bundles anyway, so each just goes in the buffer as with bplib_send() */
+        status = BP_SUCCESS;
+        for (i = 0; i < count; ++i)
+        {
+            status_list[i] = bplib_serviceflow_coalesce_send(sock, flow, sock_ref, payloads[i].payload,
+                                                             payloads[i].size, timeout);
+            if (status == BP_SUCCESS)
+            {
+                status = status_list[i];
+            }
+        }
+        return status;
+    }
+
+    /* as in bplib_send(), a bundle for another socket on this node can go straight to its queue */
+    target_ref = bplib_serviceflow_local_target(sock, flow);
+    if (target_ref != NULL)
+    {
+        queue = &bplib_mpool_flow_cast(bplib_mpool_dereference(target_ref))->egress;
+    }
+    else
+    {
+        queue = &flow->ingress;
+    }
+
+    /* in non-blocking mode, only as many are made as there is room for now, the rest are left for later */
+    push_limit = ingress_limit;
+    max_made   = count;
+    if (sock->nonblocking)
+    {
+        push_limit = 0;
+        max_made   = bplib_mpool_subq_workitem_get_space(queue);
+    }
+
+    /* all the bundles are made before touching the queue, so it only needs to be locked once */
+    bplib_mpool_init_list_head(NULL, &pending_list);
+    num_made = 0;
+    for (i = 0; i < count; ++i)
+    {
+        if (num_made >= max_made)
+        {
+            status_list[i] = BP_TIMEOUT;
+            continue;
+        }
+
+        rblk = bplib_serviceflow_make_bundle(sock, sock_ref, NULL, NULL, payloads[i].payload, payloads[i].size,
+                                             ingress_time, ingress_limit, target_ref != NULL, &status_list[i]);
+        if (rblk != NULL)
+        {
+            bplib_mpool_insert_before(&pending_list, rblk);
+            status_list[i] = BP_TIMEOUT;
+            ++num_made;
+        }
+    }
+
+    if (num_made != 0)
+    {
+        num_pushed = bplib_mpool_flow_try_push_n(queue, &pending_list, num_made, push_limit);
+    }
+    else
+    {
+        num_pushed = 0;
+    }
+
+    /* the queue takes blocks from the head of the list, so the ones pushed are the first ones made */
+    status = BP_SUCCESS;
+    for (i = 0; i < count; ++i)
+    {
+        if (status_list[i] == BP_TIMEOUT && num_pushed != 0)
+        {
+            sock->ingress_byte_count += payloads[i].size;
+            status_list[i] = BP_SUCCESS;
+            --num_pushed;
+        }
+        else if (status == BP_SUCCESS)
+        {
+            status = status_list[i];
+        }
+    }
+
+    /* anything left over did not fit in the queue in time */
+    bplib_mpool_recycle_all_blocks_in_list(bplib_route_get_mpool(sock->parent_rtbl), &pending_list);
+
+    if (target_ref != NULL)
+    {
+        bplib_mpool_ref_release(target_ref);
+    }
+    else
+    {
+        bplib_route_set_maintenance_request(sock->parent_rtbl);
+    }
+
+    return status;
+}
+
+/*
+ * Takes the bundle in a block pulled from the socket egress queue, to be split into ADUs.  Returns a
+ * ref to it, or NULL if it has no payload.  The block itself is left for the caller to recycle.
+ */
+static bplib_mpool_ref_t bplib_serviceflow_coalesce_take(bplib_socket_info_t *sock, bplib_mpool_ref_t sock_ref,
+                                                         bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_bblock_primary_t   *pri_block;
+    bplib_mpool_bblock_canonical_t *ccb_pay;
+    bplib_mpool_ref_t               refptr;
+    uint64_t                        now;
+
+    refptr    = bplib_mpool_ref_from_block(pblk);
+    pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
+    if (pri_block != NULL)
+    {
+        ccb_pay = bplib_mpool_bblock_canonical_cast(
+            bplib_mpool_bblock_primary_locate_canonical(pri_block, bp_blocktype_payloadBlock));
+    }
+    else
+    {
+        ccb_pay = NULL;
+    }
+
+    /* as in bplib_serviceflow_unbundleize_payload(), the offset is never zero in a decoded bundle */
+    if (ccb_pay == NULL || bplib_mpool_bblock_canonical_get_content_offset(ccb_pay) == 0)
+    {
+        bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): No payload\n", __func__);
+        bplib_mpool_ref_release(refptr);
+        return NULL;
+    }
+
+    pri_block = bplib_mpool_bblock_primary_cast(pblk);
+    if (pri_block != NULL)
+    {
+        now                                     = bplib_os_get_dtntime_ms();
+        pri_block->data.delivery.egress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(sock_ref));
+        pri_block->data.delivery.egress_time    = now;
+        bplib_serviceflow_trace_recv(sock, pri_block, now);
+    }
+
+    return refptr;
+}
+
+/*
+ * Copies the next ADU of the bundle being split into the buffer, with rx_lock held.  Returns BP_TIMEOUT
+ * if there is no such bundle, and the bundle is released as soon as nothing is left in it.  An ADU that
+ * is too big for the buffer is dropped, as bplib_recv() would drop a bundle that is too big.
+ */
+static int bplib_serviceflow_coalesce_next(bplib_socket_info_t *sock, void *payload, size_t *size)
+{
+    bplib_socket_coalesce_t        *co;
+    bplib_mpool_bblock_canonical_t *ccb_pay;
+    bplib_mpool_block_t            *chunks;
+    uint8_t                         hdr[BPLIB_SOCKET_COALESCE_HDR_SIZE];
+    size_t                          content_size;
+    size_t                          content_offset;
+    size_t                          record_size;
+    int                             status;
+
+    co = sock->coalesce;
+    if (co->rx_ref == NULL)
+    {
+        return BP_TIMEOUT;
+    }
+
+    /* this was checked when the bundle was taken */
+    ccb_pay = bplib_mpool_bblock_canonical_cast(bplib_mpool_bblock_primary_locate_canonical(
+        bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(co->rx_ref)), bp_blocktype_payloadBlock));
+
+    content_size   = bplib_mpool_bblock_canonical_get_content_length(ccb_pay);
+    content_offset = bplib_mpool_bblock_canonical_get_content_offset(ccb_pay);
+    chunks         = bplib_mpool_bblock_canonical_get_encoded_chunks(ccb_pay);
+
+    status = BP_TIMEOUT;
+    if ((content_size - co->rx_offset) >= BPLIB_SOCKET_COALESCE_HDR_SIZE)
+    {
+        bplib_mpool_bblock_cbor_export(chunks, hdr, sizeof(hdr), content_offset + co->rx_offset, sizeof(hdr));
+        record_size = ((size_t)hdr[0] << 24) | ((size_t)hdr[1] << 16) | ((size_t)hdr[2] << 8) | (size_t)hdr[3];
+        co->rx_offset += BPLIB_SOCKET_COALESCE_HDR_SIZE;
+
+        if (record_size > (content_size - co->rx_offset))
+        {
+            bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): ADU runs past the end of the payload\n", __func__);
+            co->rx_offset = content_size;
+            status        = BP_ERROR;
+        }
+        else if (record_size > *size)
+        {
+            bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): ADU too big for the buffer\n", __func__);
+            co->rx_offset += record_size;
+            status = BP_ERROR;
+        }
+        else
+        {
+            bplib_mpool_bblock_cbor_export(chunks, payload, *size, content_offset + co->rx_offset, record_size);
+            co->rx_offset += record_size;
+            sock->egress_byte_count += record_size;
+            *size  = record_size;
+            status = BP_SUCCESS;
+        }
+    }
+    else if (co->rx_offset != content_size)
+    {
+        bplog(NULL, BP_FLAG_INCOMPLETE, "%s(): payload ends in part of an ADU length\n", __func__);
+        co->rx_offset = content_size;
+        status        = BP_ERROR;
+    }
+
+    if (co->rx_offset == content_size)
+    {
+        bplib_mpool_ref_release(co->rx_ref);
+        co->rx_ref = NULL;
+    }
+
+    return status;
+}
+
+/*
+ * Receives one ADU on a socket with coalescing on, from the bundle being split if there is one, or
+ * else from the next bundle in the socket egress queue, see bplib_socket_set_coalescing().
+ */
+static int bplib_serviceflow_coalesce_recv(bplib_socket_info_t *sock, bplib_mpool_ref_t sock_ref,
+                                           bplib_mpool_flow_t *flow, void *payload, size_t *size,
+                                           uint64_t egress_time_limit)
+{
+    bplib_socket_coalesce_t *co;
+    bplib_mpool_block_t     *pblk;
+    int                      status;
+
+    co = sock->coalesce;
+
+    /* this is held while waiting, so ADUs from the same bundle go to one task at a time and in order */
+    bplib_os_mutex_lock(co->rx_lock);
+
+    status = bplib_serviceflow_coalesce_next(sock, payload, size);
+    while (status == BP_TIMEOUT)
+    {
+        pblk = bplib_mpool_flow_try_pull(&flow->egress, egress_time_limit);
+        if (pblk == NULL)
+        {
+            break;
+        }
+
+        co->rx_ref    = bplib_serviceflow_coalesce_take(sock, sock_ref, pblk);
+        co->rx_offset = 0;
+        bplib_mpool_recycle_block(pblk);
+
+        if (co->rx_ref == NULL)
+        {
+            status = BP_ERROR;
+        }
+        else
+        {
+            status = bplib_serviceflow_coalesce_next(sock, payload, size);
+        }
+    }
+
+    bplib_os_mutex_unlock(co->rx_lock);
+
+    return status;
+}
+
+int bplib_recv(bp_socket_t *desc, void *payload, size_t *size, uint32_t timeout)
+{
+    int                  status;
+    bplib_socket_info_t *sock;
+    bplib_mpool_block_t *pblk;
+    bplib_mpool_ref_t    sock_ref;
+    bplib_mpool_flow_t  *flow;
+    uint64_t             egress_time_limit;
+
+    sock_ref = (bplib_mpool_ref_t)desc;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad flow_ref\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* preemptively trigger the maintenance task to run */
+    /* this may help in the event that the queue is currently empty but
+     * there is data somewhere else in the pool that is headed here (assuming
+     * timeout is nonzero). */
+    bplib_route_set_maintenance_request(sock->parent_rtbl);
+
+    if (sock->nonblocking)
+    {
+        /* the lock is not needed to see that there is nothing to receive, nor anything left to split */
+        if (!bplib_mpool_subq_workitem_may_pull(&flow->egress) &&
+            (sock->coalesce == NULL || sock->coalesce->rx_ref == NULL))
+        {
+            return BP_TIMEOUT;
+        }
+        timeout = 0;
+    }
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    if (bplib_serviceflow_coalesce_on(sock))
+    {
+        return bplib_serviceflow_coalesce_recv(sock, sock_ref, flow, payload, size, egress_time_limit);
+    }
+
+    pblk = bplib_mpool_flow_try_pull(&flow->egress, egress_time_limit);
+
+    if (pblk == NULL)
+    {
+        status = BP_TIMEOUT;
+    }
+    else
+    {
+        status = bplib_serviceflow_deliver_bundle(sock, sock_ref, pblk, payload, size);
+
+        /* if a block was pulled from the queue, that needs to be recycled */
+        /* this should always be the case */
+        bplib_mpool_recycle_block(pblk);
+    }
+
+    return status;
+}
+
+int bplib_recv_many(bp_socket_t *desc, bplib_recv_buf_t *buffers, uint32_t count, uint32_t *num_filled,
+                    uint32_t timeout)
+{
+    int                  status;
+    bplib_socket_info_t *sock;
+    bplib_mpool_block_t *pblk;
+    bplib_mpool_block_t  batch;
+    bplib_mpool_ref_t    sock_ref;
+    bplib_mpool_flow_t  *flow;
+    uint64_t             egress_time_limit;
+    uint32_t             pulled;
+    uint32_t             filled;
+    size_t               size;
+
+    *num_filled = 0;
+    sock_ref    = (bplib_mpool_ref_t)desc;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (sock == NULL || flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor - is socket connected?\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* as in bplib_recv(), this may help if there is data elsewhere in the pool headed here */
+    bplib_route_set_maintenance_request(sock->parent_rtbl);
+
+    if (sock->nonblocking)
+    {
+        /* the lock is not needed to see that there is nothing to receive, nor anything left to split */
+        if (!bplib_mpool_subq_workitem_may_pull(&flow->egress) &&
+            (sock->coalesce == NULL || sock->coalesce->rx_ref == NULL))
+        {
+            return BP_TIMEOUT;
+        }
+        timeout = 0;
+    }
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    if (bplib_serviceflow_coalesce_on(sock))
+    {
+        /* as with bundles, this waits for the first ADU, then takes whatever else is ready */
+        filled = 0;
+        status = BP_TIMEOUT;
+        while (filled < count)
+        {
+            size   = buffers[filled].size;
+            status = bplib_serviceflow_coalesce_recv(sock, sock_ref, flow, buffers[filled].payload, &size,
+                                                     egress_time_limit);
+            if (status == BP_TIMEOUT)
+            {
+                break;
+            }
+            if (status == BP_SUCCESS)
+            {
+                buffers[filled].size = size;
+                ++filled;
+            }
+            egress_time_limit = 0;
+        }
+
+        *num_filled = filled;
+        if (filled != 0)
+        {
+            status = BP_SUCCESS;
+        }
+        return status;
+    }
+
+    /* This waits for the first bundle, then takes whatever else is ready, up to one per buffer */
+    bplib_mpool_init_list_head(NULL, &batch);
+    pulled = bplib_mpool_flow_try_pull_n(&flow->egress, &batch, count, egress_time_limit);
+    if (pulled == 0)
+    {
+        return BP_TIMEOUT;
+    }
+
+    filled = 0;
+    while (pulled > 0)
+    {
+        pblk = bplib_mpool_get_next_block(&batch);
+        bplib_mpool_extract_node(pblk);
+        --pulled;
+
+        /* a bundle that cannot be delivered is dropped, and the buffer is used for the next one instead */
+        size = buffers[filled].size;
+        if (bplib_serviceflow_deliver_bundle(sock, sock_ref, pblk, buffers[filled].payload, &size) == BP_SUCCESS)
+        {
+            buffers[filled].size = size;
+            ++filled;
+        }
+
+        bplib_mpool_recycle_block(pblk);
+    }
+
+    if (filled != 0)
+    {
+        status = BP_SUCCESS;
+    }
+    else
+    {
+        status = BP_ERROR;
+    }
+
+    *num_filled = filled;
+    return status;
+}
+
+int bplib_recv_view(bp_socket_t *desc, bplib_iovec_t *iov, uint32_t *iov_count, size_t *size,
+                    bplib_mpool_ref_t *payload_ref, uint32_t timeout)
+{
+    int                           status;
+    bplib_socket_info_t          *sock;
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_ref_t             sock_ref;
+    bplib_mpool_ref_t             refptr;
+    bplib_mpool_flow_t           *flow;
+    bplib_mpool_bblock_primary_t *pri_block;
+    uint64_t                      egress_time_limit;
+    uint64_t                      now;
+
+    *payload_ref = NULL;
+    sock_ref     = (bplib_mpool_ref_t)desc;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad flow_ref\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* preemptively trigger the maintenance task to run, same as bplib_recv() */
+    bplib_route_set_maintenance_request(sock->parent_rtbl);
+
+    if (sock->nonblocking)
+    {
+        /* the lock is not needed to see that there is nothing to receive */
+        if (!bplib_mpool_subq_workitem_may_pull(&flow->egress))
+        {
+            return BP_TIMEOUT;
+        }
+        timeout = 0;
+    }
+
+    if (timeout == 0)
+    {
+        egress_time_limit = 0;
+    }
+    else
+    {
+        egress_time_limit = bplib_os_get_dtntime_coarse_ms() + timeout;
+    }
+
+    pblk = bplib_mpool_flow_try_pull(&flow->egress, egress_time_limit);
+    if (pblk == NULL)
+    {
+        return BP_TIMEOUT;
+    }
+
+    /*
+     * The iov entries point into the bundle, so it has to be kept until the application is
+     * done with them, the same as in bplib_cla_egress_iov().
+     */
+    refptr = bplib_mpool_ref_from_block(pblk);
+    if (refptr != NULL)
+    {
+        bplib_mpool_recycle_block(pblk);
+    }
+    else
+    {
+        refptr = bplib_mpool_ref_create(pblk);
+        if (refptr == NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+    }
+
+    if (refptr == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): unable to create ref from pblk\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* not enough entries drops the bundle, as with a buffer that is too small in bplib_recv() */
+    status = bplib_serviceflow_view_payload(refptr, iov, iov_count, size);
+    if (status == BP_SUCCESS)
+    {
+        sock->egress_byte_count += *size;
+
+        pri_block = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(refptr));
+        if (pri_block != NULL)
+        {
+            now                                     = bplib_os_get_dtntime_ms();
+            pri_block->data.delivery.egress_intf_id = bplib_mpool_get_external_id(bplib_mpool_dereference(sock_ref));
+            pri_block->data.delivery.egress_time    = now;
+            bplib_serviceflow_trace_recv(sock, pri_block, now);
+        }
+
+        *payload_ref = refptr;
+    }
+    else
+    {
+        bplib_mpool_ref_release(refptr);
+    }
+
+    return status;
+}
+
+void bplib_recv_view_release(bp_socket_t *desc, bplib_mpool_ref_t payload_ref)
+{
+    bplib_mpool_ref_release(payload_ref);
+}
+
+int bplib_socket_set_nonblocking(bp_socket_t *desc, bool enable)
+{
+    bplib_socket_info_t *sock;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    sock->nonblocking = enable;
+    return BP_SUCCESS;
+}
+
+int bplib_socket_set_local_skip_encode(bp_socket_t *desc, bool enable)
+{
+    bplib_socket_info_t *sock;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    sock->local_skip_encode = enable;
+    return BP_SUCCESS;
+}
+
+int bplib_socket_set_egress_encode(bp_socket_t *desc, bool enable)
+{
+    bplib_socket_info_t *sock;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    sock->egress_encode = enable;
+    return BP_SUCCESS;
+}
+
+int bplib_socket_set_coalescing(bp_socket_t *desc, size_t max_size, uint32_t max_delay)
+{
+    bplib_socket_info_t     *sock;
+    bplib_socket_coalesce_t *co;
+    bplib_mpool_flow_t      *flow;
+    int                      status;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc));
+    if (sock == NULL || flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    co = sock->coalesce;
+    if (max_size == 0)
+    {
+        if (co == NULL)
+        {
+            return BP_SUCCESS;
+        }
+
+        /* it stays on if what is pending cannot be sent now, so nothing is lost */
+        bplib_os_mutex_lock(co->tx_lock);
+        status = bplib_serviceflow_coalesce_flush(sock, flow, (bplib_mpool_ref_t)desc, 0);
+        if (status == BP_SUCCESS)
+        {
+            co->max_size = 0;
+        }
+        bplib_os_mutex_unlock(co->tx_lock);
+
+        if (status == BP_SUCCESS)
+        {
+            bplib_os_mutex_lock(co->rx_lock);
+            bplib_mpool_ref_release(co->rx_ref);
+            co->rx_ref = NULL;
+            bplib_os_mutex_unlock(co->rx_lock);
+        }
+
+        return status;
+    }
+
+    if (co == NULL)
+    {
+        /* the buffer is made along with the rest, and kept until the socket is recycled */
+        co = bplib_os_calloc(sizeof(bplib_socket_coalesce_t) + max_size);
+        if (co != NULL)
+        {
+            co->tx_lock = bplib_os_mutex_create(0);
+            co->rx_lock = bplib_os_mutex_create(0);
+            if (co->tx_lock == NULL || co->rx_lock == NULL)
+            {
+                if (co->tx_lock != NULL)
+                {
+                    bplib_os_mutex_destroy(co->tx_lock);
+                }
+                if (co->rx_lock != NULL)
+                {
+                    bplib_os_mutex_destroy(co->rx_lock);
+                }
+                bplib_os_free(co);
+                co = NULL;
+            }
+        }
+
+        if (co == NULL)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): no memory for coalescing buffer\n", __func__);
+            return BP_ERROR;
+        }
+
+        co->buf        = (uint8_t *)(co + 1);
+        co->buf_size   = max_size;
+        sock->coalesce = co;
+    }
+    else if (max_size > co->buf_size)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): buffer is only %lu bytes\n", __func__, (unsigned long)co->buf_size);
+        return BP_ERROR;
+    }
+
+    bplib_os_mutex_lock(co->tx_lock);
+    co->max_size  = max_size;
+    co->max_delay = max_delay;
+    bplib_os_mutex_unlock(co->tx_lock);
+
+    return BP_SUCCESS;
+}
+
+int bplib_socket_flush(bp_socket_t *desc, uint32_t timeout)
+{
+    bplib_socket_info_t *sock;
+    bplib_mpool_flow_t  *flow;
+    int                  status;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc));
+    if (sock == NULL || flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    if (sock->coalesce == NULL)
+    {
+        return BP_SUCCESS;
+    }
+
+    bplib_os_mutex_lock(sock->coalesce->tx_lock);
+    status = bplib_serviceflow_coalesce_flush(sock, flow, (bplib_mpool_ref_t)desc, timeout);
+    bplib_os_mutex_unlock(sock->coalesce->tx_lock);
+
+    return status;
+}
+
+/*
+ * Makes the block with the histograms and sample ring of the socket, if it does not have one yet.
+ * Once made, it is kept until the socket is recycled.
+ */
+static int bplib_serviceflow_trace_alloc(bplib_socket_info_t *sock)
+{
+    bplib_mpool_block_t *tblk;
+
+    if (sock->trace_ref == NULL)
+    {
+        tblk = bplib_mpool_generic_data_alloc(bplib_route_get_mpool(sock->parent_rtbl), BPLIB_BLOCKTYPE_SERVICE_TRACE,
+                                              NULL);
+        if (tblk != NULL)
+        {
+            sock->trace_ref = bplib_mpool_ref_create(tblk);
+            if (sock->trace_ref == NULL)
+            {
+                bplib_mpool_recycle_block(tblk);
+            }
+        }
+
+        if (sock->trace_ref == NULL)
+        {
+            return BP_ERROR;
+        }
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_socket_set_tracing(bp_socket_t *desc, bool enable)
+{
+    bplib_socket_info_t *sock;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* turning it off just stops counting, the histograms are kept */
+    if (enable && bplib_serviceflow_trace_alloc(sock) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): no memory for latency histograms\n", __func__);
+        return BP_ERROR;
+    }
+
+    sock->tracing = enable;
+    return BP_SUCCESS;
+}
+
+int bplib_socket_set_sampling(bp_socket_t *desc, uint32_t interval, uint32_t ring_size)
+{
+    bplib_socket_info_t  *sock;
+    bplib_socket_trace_t *trace;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    if (interval != 0)
+    {
+        if (bplib_serviceflow_trace_alloc(sock) != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): no memory for latency samples\n", __func__);
+            return BP_ERROR;
+        }
+
+        /* the ring is made before any bundle can be picked, and kept as long as the block */
+        trace = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock->trace_ref), BPLIB_BLOCKTYPE_SERVICE_TRACE);
+        if (trace != NULL && trace->samples == NULL)
+        {
+            if (ring_size == 0)
+            {
+                ring_size = BPLIB_TRACE_SAMPLE_RING_DEFAULT;
+            }
+
+            trace->sample_lock = bplib_os_mutex_create(0);
+            if (trace->sample_lock != NULL)
+            {
+                trace->samples = bplib_os_calloc(sizeof(bplib_trace_sample_t) * ring_size);
+                if (trace->samples == NULL)
+                {
+                    bplib_os_mutex_destroy(trace->sample_lock);
+                    trace->sample_lock = NULL;
+                }
+            }
+            trace->sample_ring_size = ring_size;
+        }
+
+        if (trace == NULL || trace->samples == NULL)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): no memory for latency samples\n", __func__);
+            return BP_ERROR;
+        }
+    }
+
+    sock->sample_interval = interval;
+    return BP_SUCCESS;
+}
+
+int bplib_socket_read_samples(bp_socket_t *desc, bplib_trace_sample_t *samples, uint32_t max_samples,
+                              uint32_t *num_samples)
+{
+    bplib_socket_info_t  *sock;
+    bplib_socket_trace_t *trace;
+    uint32_t              pos;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    *num_samples = 0;
+
+    /* if sampling was never turned on, there are none */
+    trace = NULL;
+    if (sock->trace_ref != NULL)
+    {
+        trace = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock->trace_ref), BPLIB_BLOCKTYPE_SERVICE_TRACE);
+    }
+    if (trace == NULL || trace->samples == NULL)
+    {
+        return BP_SUCCESS;
+    }
+
+    bplib_os_mutex_lock(trace->sample_lock);
+    while (*num_samples < max_samples && trace->sample_held > 0)
+    {
+        /* the oldest is sample_held before the next one to be written */
+        pos = trace->sample_next + trace->sample_ring_size - trace->sample_held;
+        if (pos >= trace->sample_ring_size)
+        {
+            pos -= trace->sample_ring_size;
+        }
+
+        samples[*num_samples] = trace->samples[pos];
+        --trace->sample_held;
+        ++(*num_samples);
+    }
+    bplib_os_mutex_unlock(trace->sample_lock);
+
+    return BP_SUCCESS;
+}
+
+int bplib_socket_query_latency(bp_socket_t *desc, bplib_trace_stage_t stage, uint32_t *histogram)
+{
+    bplib_socket_info_t  *sock;
+    bplib_socket_trace_t *trace;
+    uint32_t              bin;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL || stage >= bplib_trace_stage_max)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor or stage\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* if tracing was never turned on, nothing has been counted */
+    trace = NULL;
+    if (sock->trace_ref != NULL)
+    {
+        trace = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock->trace_ref), BPLIB_BLOCKTYPE_SERVICE_TRACE);
+    }
+
+    for (bin = 0; bin < BPLIB_TRACE_LATENCY_BINS; ++bin)
+    {
+        if (trace != NULL)
+        {
+            histogram[bin] = __atomic_load_n(&trace->latency[stage][bin], __ATOMIC_RELAXED);
+        }
+        else
+        {
+            histogram[bin] = 0;
+        }
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_socket_set_completions(bp_socket_t *desc, uint32_t max_in_flight)
+{
+    bplib_socket_info_t        *sock;
+    bplib_socket_completions_t *cq;
+    bplib_mpool_block_t        *cblk;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* once made, the queue is kept as long as the socket, ops still in flight hold their own refs */
+    if (sock->completions_ref != NULL)
+    {
+        return BP_SUCCESS;
+    }
+
+    if (max_in_flight == 0)
+    {
+        max_in_flight = BPLIB_COMPLETION_IN_FLIGHT_DEFAULT;
+    }
+
+    cblk = bplib_mpool_generic_data_alloc(bplib_route_get_mpool(sock->parent_rtbl), BPLIB_BLOCKTYPE_SERVICE_CQ, NULL);
+    cq   = bplib_mpool_generic_data_cast(cblk, BPLIB_BLOCKTYPE_SERVICE_CQ);
+    if (cq != NULL)
+    {
+        cq->lock = bplib_os_mutex_create(0);
+        if (cq->lock != NULL)
+        {
+            cq->ring = bplib_os_calloc(sizeof(bplib_completion_t) * max_in_flight * BPLIB_COMPLETIONS_PER_BUNDLE);
+        }
+        cq->ring_size     = max_in_flight * BPLIB_COMPLETIONS_PER_BUNDLE;
+        cq->max_in_flight = max_in_flight;
+
+        if (cq->ring != NULL)
+        {
+            sock->completions_ref = bplib_mpool_ref_create(cblk);
+        }
+    }
+
+    if (sock->completions_ref == NULL)
+    {
+        /* the destructor frees whatever part of it was made */
+        if (cblk != NULL)
+        {
+            bplib_mpool_recycle_block(cblk);
+        }
+
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "%s(): no memory for completion queue\n", __func__);
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_get_completions(bp_socket_t *desc, bplib_completion_t *completions, uint32_t max_completions,
+                          uint32_t *num_completions, uint32_t timeout)
+{
+    bplib_socket_info_t        *sock;
+    bplib_socket_completions_t *cq;
+    bplib_completion_t         *entry;
+    uint64_t                    time_limit;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (sock == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    *num_completions = 0;
+
+    cq = NULL;
+    if (sock->completions_ref != NULL)
+    {
+        cq = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock->completions_ref), BPLIB_BLOCKTYPE_SERVICE_CQ);
+    }
+    if (cq == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): no completion queue\n", __func__);
+        return BP_ERROR;
+    }
+
+    if (sock->nonblocking)
+    {
+        timeout = 0;
+    }
+
+    /* the final completions are often posted by the maintenance task, as bundles are recycled */
+    bplib_route_set_maintenance_request(sock->parent_rtbl);
+
+    time_limit = bplib_os_get_dtntime_ms() + timeout;
+
+    bplib_os_mutex_lock(cq->lock);
+    while (cq->held == 0 && timeout != 0)
+    {
+        if (bplib_os_mutex_wait_until_ms(cq->lock, time_limit) != BP_SUCCESS)
+        {
+            break;
+        }
+    }
+
+    while (*num_completions < max_completions && cq->held > 0)
+    {
+        entry = &cq->ring[cq->next];
+        ++cq->next;
+        if (cq->next >= cq->ring_size)
+        {
+            cq->next = 0;
+        }
+        --cq->held;
+
+        /* once its final completion is taken, the op no longer counts against max_in_flight */
+        if (entry->event == bplib_completion_done || entry->event == bplib_completion_failed)
+        {
+            --cq->in_flight;
+        }
+
+        completions[*num_completions] = *entry;
+        ++(*num_completions);
+    }
+
+    if (cq->held == 0 && bp_handle_is_valid(cq->notifier))
+    {
+        bplib_os_notifier_clear(cq->notifier);
+    }
+    bplib_os_mutex_unlock(cq->lock);
+
+    if (*num_completions == 0)
+    {
+        return BP_TIMEOUT;
+    }
+
+    return BP_SUCCESS;
+}
+
+int bplib_socket_get_completion_fd(bp_socket_t *desc)
+{
+    bplib_socket_info_t        *sock;
+    bplib_socket_completions_t *cq;
+    int                         fd;
+
+    sock = bplib_mpool_generic_data_cast(bplib_mpool_dereference((bplib_mpool_ref_t)desc),
+                                         BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    cq   = NULL;
+    if (sock != NULL && sock->completions_ref != NULL)
+    {
+        cq = bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock->completions_ref), BPLIB_BLOCKTYPE_SERVICE_CQ);
+    }
+    if (cq == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor, or no completion queue\n", __func__);
+        return BP_ERROR;
+    }
+
+    bplib_os_mutex_lock(cq->lock);
+    if (!bp_handle_is_valid(cq->notifier))
+    {
+        cq->notifier = bplib_os_create_notifier();
+
+        /* there may already be some waiting */
+        if (cq->held > 0 && bp_handle_is_valid(cq->notifier))
+        {
+            bplib_os_notifier_set(cq->notifier);
+        }
+    }
+    fd = bplib_os_notifier_get_fd(cq->notifier);
+    bplib_os_mutex_unlock(cq->lock);
+
+    if (fd < 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): notifier not available\n", __func__);
+        return BP_ERROR;
+    }
+
+    return fd;
+}
+
+int bplib_socket_get_notify_fd(bp_socket_t *desc)
+{
+    bplib_mpool_ref_t   sock_ref;
+    bplib_mpool_flow_t *flow;
+
+    sock_ref = (bplib_mpool_ref_t)desc;
+
+    if (bplib_mpool_generic_data_cast(bplib_mpool_dereference(sock_ref), BPLIB_BLOCKTYPE_SERVICE_SOCKET) == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad descriptor\n", __func__);
+        return BP_ERROR;
+    }
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(sock_ref));
+    if (flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): bad flow_ref\n", __func__);
+        return BP_ERROR;
+    }
+
+    /* bplib_recv() pulls from the egress queue of the socket, so that is what the app waits on */
+    if (bplib_mpool_flow_attach_notifier(&flow->egress) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): notifier not available\n", __func__);
+        return BP_ERROR;
+    }
+
+    return bplib_os_notifier_get_fd(flow->egress.notifier);
+}
+
+static bool bplib_socket_match_metric_intf(bplib_mpool_block_t *flow_block)
+{
+    return (bplib_mpool_generic_data_cast(flow_block, BPLIB_BLOCKTYPE_SERVICE_SOCKET) != NULL);
+}
+
+static void bplib_socket_read_metric(bplib_routetbl_t *rtbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                     bplib_metric_t *metric)
+{
+    bplib_socket_info_t *sock;
+
+    sock = bplib_mpool_generic_data_cast(flow_block, BPLIB_BLOCKTYPE_SERVICE_SOCKET);
+    if (idx == 0)
+    {
+        metric->value = sock->ingress_byte_count;
+    }
+    else
+    {
+        metric->value = sock->egress_byte_count;
+    }
+}
+
+static const bplib_metric_desc_t BPLIB_SOCKET_METRIC_DESCS[] = {
+    {"socket_send_bytes", "payload bytes sent on the socket", bplib_metric_type_counter, 0, NULL},
+    {"socket_recv_bytes", "payload bytes received on the socket", bplib_metric_type_counter, 0, NULL}};
+
+const bplib_metric_group_t BPLIB_SOCKET_METRICS = {BPLIB_SOCKET_METRIC_DESCS,
+                                                   sizeof(BPLIB_SOCKET_METRIC_DESCS) /
+                                                       sizeof(BPLIB_SOCKET_METRIC_DESCS[0]),
+                                                   bplib_socket_match_metric_intf, bplib_socket_read_metric};
+
+/*
+ * Only the storage service itself has this job type, not the shards of it, which it already
+ * adds up when it is queried
+ */
+static bool bplib_storage_match_metric_intf(bplib_mpool_block_t *flow_block)
+{
+    bplib_mpool_flow_t *flow;
+
+    flow = bplib_mpool_flow_cast(flow_block);
+    return (flow != NULL && flow->ingress.job_header.jobtype == bplib_mpool_jobtype_cache_fsm);
+}
+
+static void bplib_storage_read_metric(bplib_routetbl_t *rtbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                      bplib_metric_t *metric)
+{
+    static const bplib_cache_confkey_t STORAGE_KEYS[] = {
+        bplib_cache_confkey_stat_entries_idle,        bplib_cache_confkey_stat_entries_queue,
+        bplib_cache_confkey_stat_entries_delete,      bplib_cache_confkey_stat_fsm_transitions,
+        bplib_cache_confkey_stat_discards,            bplib_cache_confkey_stat_stored_bytes,
+        bplib_cache_confkey_stat_entries_offloaded,   bplib_cache_confkey_stat_entries_resident,
+        bplib_cache_confkey_stat_pending,             bplib_cache_confkey_stat_dacs_open,
+        bplib_cache_confkey_stat_dacs_closed,         bplib_cache_confkey_stat_custody_hold_time,
+        bplib_cache_confkey_stat_evictions,           bplib_cache_confkey_stat_evict_releases,
+        bplib_cache_confkey_stat_footprint_bytes,     bplib_cache_confkey_stat_footprint_blocks,
+        bplib_cache_confkey_stat_footprint_bytes_max, bplib_cache_confkey_stat_footprint_blocks_max};
+
+    const int *val;
+
+    if (bplib_cache_query(rtbl, metric->intf_id, STORAGE_KEYS[idx], bplib_cache_module_valtype_integer,
+                          (const void **)&val) == BP_SUCCESS)
+    {
+        metric->value = *val;
+    }
+}
+
+static const bplib_metric_desc_t BPLIB_STORAGE_METRIC_DESCS[] = {
+    {"storage_entries_idle", "entries waiting on a route, an ack or a timer", bplib_metric_type_gauge, 0, NULL},
+    {"storage_entries_queue", "entries whose bundle is queued to be sent", bplib_metric_type_gauge, 0, NULL},
+    {"storage_entries_delete", "entries done with, waiting to age out", bplib_metric_type_gauge, 0, NULL},
+    {"storage_fsm_transitions", "changes of entry state", bplib_metric_type_counter, 0, NULL},
+    {"storage_discards", "bundles that could not be stored", bplib_metric_type_counter, 0, NULL},
+    {"storage_stored_bytes", "encoded size of the bundles stored", bplib_metric_type_gauge, 0, NULL},
+    {"storage_entries_offloaded", "entries whose bundle is offloaded", bplib_metric_type_gauge, 0, NULL},
+    {"storage_entries_resident", "entries whose bundle is in memory", bplib_metric_type_gauge, 0, NULL},
+    {"storage_pending", "entries waiting to be evaluated", bplib_metric_type_gauge, 0, NULL},
+    {"storage_dacs_open", "DACS still collecting sequence numbers", bplib_metric_type_gauge, 0, NULL},
+    {"storage_dacs_closed", "DACS finished and sent", bplib_metric_type_counter, 0, NULL},
+    {"storage_custody_hold_ms", "average ms from storing a bundle until a DACS for it", bplib_metric_type_gauge, 0,
+     NULL},
+    {"storage_evictions", "bundles dropped to make room in the pool", bplib_metric_type_counter, 0, NULL},
+    {"storage_evict_releases", "bundles released to offload to make room in the pool", bplib_metric_type_counter, 0,
+     NULL},
+    {"storage_footprint_bytes", "average pool bytes taken by a stored bundle", bplib_metric_type_gauge, 0, NULL},
+    {"storage_footprint_blocks", "average pool blocks taken by a stored bundle", bplib_metric_type_gauge, 0, NULL},
+    {"storage_footprint_bytes_max", "most pool bytes taken by any bundle stored", bplib_metric_type_gauge, 0, NULL},
+    {"storage_footprint_blocks_max", "most pool blocks taken by any bundle stored", bplib_metric_type_gauge, 0,
+     NULL}};
+
+const bplib_metric_group_t BPLIB_STORAGE_METRICS = {BPLIB_STORAGE_METRIC_DESCS,
+                                                    sizeof(BPLIB_STORAGE_METRIC_DESCS) /
+                                                        sizeof(BPLIB_STORAGE_METRIC_DESCS[0]),
+                                                    bplib_storage_match_metric_intf, bplib_storage_read_metric};
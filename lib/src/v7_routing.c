@@ -33,20 +33,276 @@
 #include "v7_base_internal.h"
 
 /**
- * @brief Minimum time between interface poll cycles
+ * @brief Longest time the maintenance task sleeps without any request or poll deadline
  *
- * Most timers in DTN are on the longer side (i.e. minutes/hours, not milliseconds)
- * so it is generally not necessary to be aggressive with polling.
+ * Interfaces that need timed service register their own deadline via bplib_route_intf_set_poll_time(),
+ * so this only bounds how long general pool maintenance can be deferred on an idle system.
  */
-#define BPLIB_INTF_MIN_POLL_INTERVAL 500
+#define BPLIB_ROUTE_IDLE_MAINT_INTERVAL 1000
 
 #define BPLIB_INTF_AVAILABLE_FLAGS (BPLIB_INTF_STATE_OPER_UP | BPLIB_INTF_STATE_ADMIN_UP)
 
+/**
+ * @brief Maximum number of bundles taken from an ingress queue per lock acquisition
+ *
+ * The forwarder pulls bundles in batches so the flow lock is taken once per batch
+ * rather than once per bundle.  The routing decision itself is made outside the lock.
+ */
+#define BPLIB_ROUTE_FORWARD_BATCH_SIZE 32
+
+/**
+ * @brief Maximum number of interfaces in a multipath group that bundles are spread over
+ *
+ * Any further routes with the same dest and mask are not used while this many are up.
+ */
+#define BPLIB_ROUTE_MAX_PATHS 8
+
+/* a 64-bit odd constant (golden ratio), so every input bit affects the upper bits of the hash */
+#define BPLIB_ROUTE_FLOW_HASH_MULT 0x9E3779B97F4A7C15ULL
+
+/*
+ * Atomic operations are a compiler extension in C99.  If available, route lookups use the
+ * current route set without any lock, otherwise they take the route update lock instead.
+ */
+#if !defined(BPLIB_ROUTE_NO_ATOMIC_SNAPSHOT) && (defined(__GNUC__) || defined(__clang__))
+#define BPLIB_ROUTE_ATOMIC_SNAPSHOT
+#endif
+
+/* a 32-bit odd constant (golden ratio), to spread handle serial numbers over the slots */
+#define BPLIB_ROUTE_INTF_SLOT_HASH_MULT 0x9E3779B9U
+
+#ifdef BPLIB_STATIC_CONFIG
+/*
+ * The memory of the one route table of the static profile.  The sections are in the same
+ * order as bplib_route_alloc_table_partitioned() puts them, and the two extra units of pool
+ * cover the rounding of cache_mem_size and of the pool offset.  The pool is in long doubles
+ * as those are the most aligned of what the pool puts in its blocks.
+ */
+typedef struct bplib_route_static_layout
+{
+    bplib_routetbl_t          tbl;
+    bplib_routeset_t          sets[2];
+    bplib_routeentry_t        routes[BPLIB_STATIC_MAX_ROUTES * 2];
+    bplib_routecache_entry_t  cache[BPLIB_ROUTE_CACHE_SIZE];
+    bplib_route_intfslot_t    slots[BPLIB_ROUTE_INTF_SLOTS];
+    bplib_route_contactslot_t contacts[BPLIB_ROUTE_MAX_CONTACTS];
+    long double               pool[(BPLIB_STATIC_POOL_SIZE / sizeof(long double)) + 2];
+} bplib_route_static_layout_t;
+
+static union
+{
+    bplib_route_static_layout_t layout;
+    uintmax_t                   align_val;
+    void                       *align_ptr;
+    long double                 align_float;
+} bplib_route_static_mem;
+
+static bool bplib_route_static_mem_taken;
+#endif
+
+/*
+ * The activity lock is taken by every flow worker and every intf state change, so in
+ * the lock profile build it is counted by call site along with the pool locks.
+ */
+#ifdef BPLIB_LOCK_PROFILE
+#define bplib_route_activity_lock(tbl) bplib_route_activity_lock_at(tbl, __func__, __LINE__)
+
+static void bplib_route_activity_lock_at(bplib_routetbl_t *tbl, const char *func, uint32_t line)
+{
+    uint64_t start_us;
+
+    if (bplib_os_trylock(tbl->activity_lock) == BP_SUCCESS)
+    {
+        bplib_mpool_lock_profile_acquired(&tbl->activity_hold, func, line, false, 0);
+    }
+    else
+    {
+        start_us = bplib_os_get_monotonic_us();
+        bplib_os_lock(tbl->activity_lock);
+        bplib_mpool_lock_profile_acquired(&tbl->activity_hold, func, line, true,
+                                          bplib_os_get_monotonic_us() - start_us);
+    }
+}
+
+static void bplib_route_activity_unlock(bplib_routetbl_t *tbl)
+{
+    bplib_mpool_lock_profile_released(&tbl->activity_hold);
+    bplib_os_unlock(tbl->activity_lock);
+}
+
+static void bplib_route_activity_signal_and_unlock(bplib_routetbl_t *tbl)
+{
+    bplib_mpool_lock_profile_released(&tbl->activity_hold);
+    bplib_os_broadcast_signal_and_unlock(tbl->activity_lock);
+}
+
+static int bplib_route_activity_wait(bplib_routetbl_t *tbl, uint64_t abs_dtntime_ms)
+{
+    int status;
+
+    bplib_mpool_lock_profile_suspend(&tbl->activity_hold);
+    status = bplib_os_wait_until_ms(tbl->activity_lock, abs_dtntime_ms);
+    bplib_mpool_lock_profile_resume(&tbl->activity_hold);
+
+    return status;
+}
+#else
+#define bplib_route_activity_lock(tbl)              bplib_os_lock((tbl)->activity_lock)
+#define bplib_route_activity_unlock(tbl)            bplib_os_unlock((tbl)->activity_lock)
+#define bplib_route_activity_signal_and_unlock(tbl) bplib_os_broadcast_signal_and_unlock((tbl)->activity_lock)
+#define bplib_route_activity_wait(tbl, until)       bplib_os_wait_until_ms((tbl)->activity_lock, until)
+#endif
+
+static void bplib_route_read_metric(bplib_routetbl_t *tbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                    bplib_metric_t *metric);
+
+static const bplib_metric_desc_t BPLIB_ROUTE_METRIC_DESCS[] = {
+    {"route_success", "bundles forwarded to an intf", bplib_metric_type_counter, 0, NULL},
+    {"route_error", "bundles with no intf to forward to", bplib_metric_type_counter, 0, NULL},
+    {"route_entries", "routes in the table", bplib_metric_type_gauge, 0, NULL}};
+
+const bplib_metric_group_t BPLIB_ROUTE_METRICS = {BPLIB_ROUTE_METRIC_DESCS,
+                                                  sizeof(BPLIB_ROUTE_METRIC_DESCS) /
+                                                      sizeof(BPLIB_ROUTE_METRIC_DESCS[0]),
+                                                  NULL, bplib_route_read_metric};
+
+/*
+ * Block serial numbers go up in steps of the block size, so the low bits are mostly the same.
+ * Taking the upper bits of the product uses all of them.
+ */
+static inline bplib_route_intfslot_t *bplib_route_intf_slot(const bplib_routetbl_t *tbl, bp_handle_t intf_id)
+{
+    uint32_t idx;
+
+    idx = (intf_id.hdl * BPLIB_ROUTE_INTF_SLOT_HASH_MULT) >> (32 - BPLIB_ROUTE_INTF_SLOT_BITS);
+    return &tbl->intf_slots[idx];
+}
+
+/*
+ * Finds the slot holding intf_id, if it has one.  This does not take any lock, the
+ * handle is checked again after reading the slot in case it was changed in between.
+ */
+static const bplib_route_intfslot_t *bplib_route_intf_slot_lookup(const bplib_routetbl_t *tbl, bp_handle_t intf_id,
+                                                                  bplib_route_intfslot_t *result)
+{
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    const bplib_route_intfslot_t *slot;
+
+    /* tables that were not created by bplib_route_alloc_table() have no slots */
+    if (tbl->intf_slots == NULL || !bp_handle_is_valid(intf_id))
+    {
+        return NULL;
+    }
+
+    slot = bplib_route_intf_slot(tbl, intf_id);
+    if (__atomic_load_n(&slot->intf_id.hdl, __ATOMIC_ACQUIRE) != intf_id.hdl)
+    {
+        return NULL;
+    }
+
+    result->flow_block = __atomic_load_n(&slot->flow_block, __ATOMIC_RELAXED);
+    result->flow       = __atomic_load_n(&slot->flow, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->intf_id.hdl, __ATOMIC_RELAXED) != intf_id.hdl || result->flow == NULL)
+    {
+        return NULL;
+    }
+
+    result->intf_id = intf_id;
+    return result;
+#else
+    /* without atomics, the pool lookup is as good as anything */
+    return NULL;
+#endif
+}
+
+/*
+ * Puts a newly registered interface into its slot, if the slot is free.
+ * Must be called with the activity lock held.
+ */
+static void bplib_route_intf_slot_set(bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *flow_block,
+                                      bplib_mpool_flow_t *flow)
+{
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    bplib_route_intfslot_t *slot;
+
+    if (tbl->intf_slots == NULL)
+    {
+        return;
+    }
+
+    slot = bplib_route_intf_slot(tbl, intf_id);
+    if (!bp_handle_is_valid(slot->intf_id))
+    {
+        /* the handle is stored last, so a lookup never sees it with the pointers of a previous interface */
+        __atomic_store_n(&slot->flow_block, flow_block, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->flow, flow, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->intf_id.hdl, intf_id.hdl, __ATOMIC_RELEASE);
+    }
+#endif
+}
+
+/*
+ * Takes an interface out of its slot, if it has one.
+ * Must be called with the activity lock held.
+ */
+static void bplib_route_intf_slot_clear(bplib_routetbl_t *tbl, bp_handle_t intf_id)
+{
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    bplib_route_intfslot_t *slot;
+
+    if (tbl->intf_slots == NULL)
+    {
+        return;
+    }
+
+    slot = bplib_route_intf_slot(tbl, intf_id);
+    if (bp_handle_equal(slot->intf_id, intf_id))
+    {
+        __atomic_store_n(&slot->intf_id.hdl, BP_INVALID_HANDLE.hdl, __ATOMIC_RELEASE);
+        __atomic_store_n(&slot->flow, NULL, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->flow_block, NULL, __ATOMIC_RELAXED);
+    }
+#endif
+}
+
+/*
+ * Sets the time of the next poll of a flow.  Only the flows with a time are in the poll_list, so
+ * the timed poll never has to look at the others, and BP_DTNTIME_INFINITE takes it off again.
+ * Must be called with the activity lock held, the caller also takes care of next_poll_time.
+ */
+static void bplib_route_poll_schedule(bplib_routetbl_t *tbl, bplib_mpool_flow_t *flow, uint64_t poll_time)
+{
+    flow->poll_time = poll_time;
+    if (poll_time == BP_DTNTIME_INFINITE)
+    {
+        if (bplib_mpool_is_link_attached(&flow->poll_link))
+        {
+            bplib_mpool_extract_node(&flow->poll_link);
+        }
+    }
+    else if (bplib_mpool_is_link_unattached(&flow->poll_link))
+    {
+        bplib_mpool_insert_before(&tbl->poll_list, &flow->poll_link);
+    }
+}
+
 bplib_mpool_ref_t bplib_route_get_intf_controlblock(bplib_routetbl_t *tbl, bp_handle_t intf_id)
 {
-    bplib_mpool_block_t *blk;
+    bplib_mpool_block_t          *blk;
+    bplib_route_intfslot_t        slot_buf;
+    const bplib_route_intfslot_t *slot;
+
+    slot = bplib_route_intf_slot_lookup(tbl, intf_id, &slot_buf);
+    if (slot != NULL)
+    {
+        blk = slot->flow_block;
+    }
+    else
+    {
+        blk = bplib_mpool_block_from_external_id(tbl->pool, intf_id);
+    }
 
-    blk = bplib_mpool_block_from_external_id(tbl->pool, intf_id);
     return bplib_mpool_ref_create(blk);
 }
 
@@ -57,7 +313,16 @@ void bplib_route_release_intf_controlblock(bplib_routetbl_t *tbl, bplib_mpool_re
 
 bplib_mpool_flow_t *bplip_route_lookup_intf(const bplib_routetbl_t *tbl, bp_handle_t intf_id)
 {
-    bplib_mpool_block_t *blk;
+    bplib_mpool_block_t          *blk;
+    bplib_route_intfslot_t        slot_buf;
+    const bplib_route_intfslot_t *slot;
+
+    /* the slot was filled in from an already validated flow, so it can be used directly */
+    slot = bplib_route_intf_slot_lookup(tbl, intf_id, &slot_buf);
+    if (slot != NULL)
+    {
+        return slot->flow;
+    }
 
     blk = bplib_mpool_block_from_external_id(tbl->pool, intf_id);
     return bplib_mpool_flow_cast(blk);
@@ -69,649 +334,2002 @@ static inline const bplib_mpool_flow_t *bplip_route_lookup_intf_const(const bpli
     return bplip_route_lookup_intf(tbl, intf_id);
 }
 
-/******************************************************************************
- EXPORTED FUNCTIONS
- ******************************************************************************/
+/*
+ * Recompute the mask levels after route_tbl was changed.  The entries are always kept
+ * grouped by mask, most specific first, so this only needs to find the boundaries.
+ */
+static void bplib_route_rebuild_levels(bplib_routeset_t *set)
+{
+    uint32_t            pos;
+    bplib_routelevel_t *lvl;
 
-int bplib_route_ingress_to_parent(void *arg, bplib_mpool_block_t *subq_src)
+    lvl             = NULL;
+    set->num_levels = 0;
+    for (pos = 0; pos < set->registered_routes; ++pos)
+    {
+        if (lvl == NULL || lvl->mask != set->route_tbl[pos].mask)
+        {
+            lvl            = &set->levels[set->num_levels];
+            lvl->mask      = set->route_tbl[pos].mask;
+            lvl->start_pos = pos;
+            ++set->num_levels;
+        }
+        lvl->end_pos = pos + 1;
+    }
+}
+
+/*
+ * Invalidate everything in the route cache.  This must be called after (not before) changing
+ * a route or the state flags of an interface, so a lookup racing with the change either sees
+ * the new generation or stores an entry under the old one.
+ */
+static inline void bplib_route_cache_invalidate(bplib_routetbl_t *tbl)
 {
-    bplib_mpool_flow_t *curr_flow;
-    bplib_mpool_flow_t *next_flow;
-    uint32_t            queue_depth;
+    ++tbl->route_generation;
+}
 
-    /* This implements a simple ingress for sub-interfaces (of any kind) where the ingress
-     * of the sub-interface nodes is simply funneled into the parent */
+/*
+ * Gets the current route set for a lookup.  It stays valid and unchanged until
+ * bplib_route_read_end(), even if the routes are changed in the meantime.
+ */
+static bplib_routeset_t *bplib_route_read_begin(const bplib_routetbl_t *tbl)
+{
+    bplib_routeset_t *set;
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    uint32_t idx;
 
-    curr_flow = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(subq_src));
-    if (curr_flow == NULL)
+    while (true)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to cast flow block\n");
-        return -1;
+        idx = __atomic_load_n(&tbl->route_set_idx, __ATOMIC_SEQ_CST);
+        set = &tbl->route_sets[idx];
+        __atomic_fetch_add(&set->reader_count, 1, __ATOMIC_SEQ_CST);
+
+        /* If a change was published in between, the writer might already be past the
+         * point of checking for readers of this set, so it cannot be used */
+        if (__atomic_load_n(&tbl->route_set_idx, __ATOMIC_SEQ_CST) == idx)
+        {
+            break;
+        }
+        __atomic_fetch_sub(&set->reader_count, 1, __ATOMIC_SEQ_CST);
     }
+#else
+    bplib_os_lock(tbl->route_update_lock);
+    set = &tbl->route_sets[tbl->route_set_idx];
+#endif
 
-    next_flow = bplib_mpool_flow_cast(bplib_mpool_dereference(curr_flow->parent));
-    if (next_flow == NULL)
+    return set;
+}
+
+static void bplib_route_read_end(const bplib_routetbl_t *tbl, bplib_routeset_t *set)
+{
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    __atomic_fetch_sub(&set->reader_count, 1, __ATOMIC_SEQ_CST);
+#else
+    bplib_os_unlock(tbl->route_update_lock);
+#endif
+}
+
+/*
+ * Starts a change to the routes.  This returns the set that is not current, which the caller
+ * can fill in at will, as nothing reads it.  What is in it is left over from an earlier change.
+ * This must be followed by either bplib_route_update_commit() or bplib_route_update_cancel().
+ */
+static bplib_routeset_t *bplib_route_update_begin_empty(bplib_routetbl_t *tbl)
+{
+    bplib_routeset_t *next;
+
+    bplib_os_lock(tbl->route_update_lock);
+    next = &tbl->route_sets[tbl->route_set_idx ^ 1];
+
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    /* lookups that started before the previous change may still be using this set,
+     * but a lookup is short and new ones cannot start on it, so this will not be long */
+    while (__atomic_load_n(&next->reader_count, __ATOMIC_SEQ_CST) != 0)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to cast flow parent block\n");
-        return -1;
+        /* spin */
     }
+#endif
 
-    /* Entire contents moved as a batch. */
-    queue_depth = bplib_mpool_flow_try_move_all(&next_flow->ingress, &curr_flow->ingress, 0);
+    return next;
+}
 
-    return queue_depth;
+/*
+ * The same as bplib_route_update_begin_empty(), with the set filled with a copy of the current routes
+ */
+static bplib_routeset_t *bplib_route_update_begin(bplib_routetbl_t *tbl)
+{
+    bplib_routeset_t *curr;
+    bplib_routeset_t *next;
+
+    next = bplib_route_update_begin_empty(tbl);
+    curr = &tbl->route_sets[tbl->route_set_idx];
+
+    next->registered_routes = curr->registered_routes;
+    next->num_levels        = curr->num_levels;
+    memcpy(next->levels, curr->levels, sizeof(curr->levels[0]) * curr->num_levels);
+    memcpy(next->route_tbl, curr->route_tbl, sizeof(curr->route_tbl[0]) * curr->registered_routes);
+
+    return next;
 }
 
-void bplib_route_ingress_route_single_bundle(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk)
+/*
+ * Makes the changed set current, so all lookups from now on see all of the change at once
+ */
+static void bplib_route_update_commit(bplib_routetbl_t *tbl, bplib_routeset_t *next)
 {
-    bplib_mpool_bblock_primary_t *pri_block;
-    bp_primary_block_t           *pri;
-    bp_ipn_addr_t                 dest_addr;
-    bp_handle_t                   next_hop;
-    uint32_t                      req_flags;
-    uint32_t                      flag_mask;
+    bplib_route_rebuild_levels(next);
 
-    /* is this routable right now? */
-    pri_block = bplib_mpool_bblock_primary_cast(pblk);
-    if (pri_block != NULL)
-    {
-        pri = bplib_mpool_bblock_primary_get_logical(pri_block);
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    __atomic_store_n(&tbl->route_set_idx, tbl->route_set_idx ^ 1, __ATOMIC_SEQ_CST);
+#else
+    tbl->route_set_idx ^= 1;
+#endif
 
-        v7_get_eid(&dest_addr, &pri->destinationEID);
+    bplib_route_cache_invalidate(tbl);
+    bplib_os_unlock(tbl->route_update_lock);
+}
 
-        /* the next hop must be "up" (both administratively and operationally) to be valid */
-        /* Also, if this bundle has not yet been stored, and the delivery policy wants some form of acknowledgement,
-         * then it should be directed to an interface that is storage-capable, even if the outgoing CLA is up */
-        req_flags = BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP;
-        flag_mask = req_flags;
+static void bplib_route_update_cancel(bplib_routetbl_t *tbl)
+{
+    bplib_os_unlock(tbl->route_update_lock);
+}
 
-        if (!bp_handle_is_valid(pri_block->data.delivery.storage_intf_id) &&
-            pri_block->data.delivery.delivery_policy != bplib_policy_delivery_none)
+/*
+ * Find the first entry in the level whose masked dest is not less than key.
+ * If upper is set, this instead finds the first entry whose masked dest is greater than key.
+ */
+static uint32_t bplib_route_level_search(const bplib_routeset_t *set, const bplib_routelevel_t *lvl, bp_ipn_t key,
+                                         bool upper)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+    bp_ipn_t mid_key;
+
+    lo = lvl->start_pos;
+    hi = lvl->end_pos;
+    while (lo < hi)
+    {
+        mid     = lo + ((hi - lo) / 2);
+        mid_key = set->route_tbl[mid].dest & lvl->mask;
+        if (mid_key < key || (upper && mid_key == key))
         {
-            /* not yet stored and needs to be, so next hop must be a storage */
-            flag_mask |= BPLIB_MPOOL_FLOW_FLAGS_STORAGE;
-            req_flags |= BPLIB_MPOOL_FLOW_FLAGS_STORAGE;
+            lo = mid + 1;
         }
-        next_hop = bplib_route_get_next_intf_with_flags(tbl, dest_addr.node_number, req_flags, flag_mask);
-        if (bp_handle_is_valid(next_hop) && bplib_route_push_egress_bundle(tbl, next_hop, pblk) == 0)
+        else
         {
-            /* successfully routed */
-            ++tbl->routing_success_count;
-            pblk = NULL;
+            hi = mid;
         }
     }
 
-    /* if qblk is still set to non-null at this point, it means the block was not routable */
-    if (pblk != NULL)
-    {
-        /* this should never happen, must discard the block because there is nowhere to put it */
-        bplib_mpool_recycle_block(pblk);
-        ++tbl->routing_error_count;
-    }
+    return lo;
 }
 
-int bplib_route_ingress_baseintf_forwarder(void *arg, bplib_mpool_block_t *subq_src)
+/*
+ * Picks one path out of a multipath group for the given flow hash.  With load awareness,
+ * paths whose egress queue is over its high watermark are only used if all of them are.
+ */
+static bp_handle_t bplib_route_select_path(const bplib_routeentry_t *const paths[], const bool congested[],
+                                           uint32_t num_paths, uint32_t flow_hash)
 {
-    bplib_mpool_block_t *qblk;
-    bplib_mpool_flow_t  *flow;
-    int                  forward_count;
+    uint32_t pos;
+    uint32_t num_open;
+    uint32_t sel;
 
-    flow = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(subq_src));
-    if (flow == NULL)
+    num_open = 0;
+    for (pos = 0; pos < num_paths; ++pos)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to cast flow block\n");
-        return -1;
+        if (!congested[pos])
+        {
+            ++num_open;
+        }
     }
 
-    forward_count = 0;
-    while (true)
+    if (num_open == 0 || num_open == num_paths)
+    {
+        return paths[flow_hash % num_paths]->intf_id;
+    }
+
+    sel = flow_hash % num_open;
+    for (pos = 0; pos < num_paths; ++pos)
     {
-        qblk = bplib_mpool_flow_try_pull(&flow->ingress, 0);
-        if (qblk == NULL)
+        if (!congested[pos])
         {
-            /* no more bundles */
-            break;
+            if (sel == 0)
+            {
+                break;
+            }
+            --sel;
         }
+    }
 
-        /* Increment the counter based off items shifted from the input queue -
-         * even if it gets dropped after this (hopefully not) it still counts
-         * as something moved/changed by this action */
-        ++forward_count;
+    return paths[pos]->intf_id;
+}
+
+/*
+ * The uncached lookup.  Sets is_cacheable to false if the result depends on something that does
+ * not invalidate the cache, that is, an interface flag change still in flight or a queue depth.
+ */
+static bp_handle_t bplib_route_search_intf(const bplib_routetbl_t *tbl, const bplib_routeset_t *set, bp_ipn_t dest,
+                                           uint32_t flow_hash, uint32_t req_flags, uint32_t flag_mask,
+                                           bool *is_cacheable)
+{
+    uint32_t                  lvl_num;
+    uint32_t                  pos;
+    bp_ipn_t                  key;
+    const bplib_routelevel_t *lvl;
+    const bplib_routeentry_t *rp;
+    bp_handle_t               intf;
+    const bplib_mpool_flow_t *ifp;
+    uint32_t                  intf_flags;
+    uint32_t                  num_paths;
+    const bplib_routeentry_t *paths[BPLIB_ROUTE_MAX_PATHS];
+    bool                      congested[BPLIB_ROUTE_MAX_PATHS];
+
+    /* The levels go from most to least specific mask, so the first usable entry is the
+     * longest prefix match.  Within a level only the entries for this dest are visited. */
+    intf          = BP_INVALID_HANDLE;
+    num_paths     = 0;
+    *is_cacheable = true;
+    for (lvl_num = 0; lvl_num < set->num_levels && !bp_handle_is_valid(intf) && num_paths == 0; ++lvl_num)
+    {
+        lvl = &set->levels[lvl_num];
+        key = dest & lvl->mask;
+        for (pos = bplib_route_level_search(set, lvl, key, false); pos < lvl->end_pos; ++pos)
+        {
+            rp = &set->route_tbl[pos];
+            if ((rp->dest & lvl->mask) != key)
+            {
+                break;
+            }
 
-        /*
-         * This call always puts the block somewhere -
-         * if its unroutable, the block will be put into the recycle bin.
-         */
-        bplib_route_ingress_route_single_bundle(arg, qblk);
+            /* once a multipath group is found, only other members of it are of interest */
+            if (num_paths != 0 && (rp->flags & BPLIB_ROUTE_FLAG_MULTIPATH) == 0)
+            {
+                continue;
+            }
+
+            intf_flags = ~req_flags;
+            ifp        = NULL;
+            if (flag_mask != 0 || (rp->flags & BPLIB_ROUTE_FLAG_LOAD_AWARE) != 0)
+            {
+                ifp = bplip_route_lookup_intf_const(tbl, rp->intf_id);
+            }
+            if (ifp != NULL && flag_mask != 0)
+            {
+                intf_flags = ifp->current_state_flags;
+                if (((ifp->pending_state_flags ^ intf_flags) & flag_mask) != 0)
+                {
+                    *is_cacheable = false;
+                }
+            }
+            if ((intf_flags & flag_mask) != req_flags)
+            {
+                continue;
+            }
+
+            if ((rp->flags & BPLIB_ROUTE_FLAG_MULTIPATH) == 0)
+            {
+                intf = rp->intf_id;
+                break;
+            }
+
+            paths[num_paths]     = rp;
+            congested[num_paths] = false;
+            if (ifp != NULL && (rp->flags & BPLIB_ROUTE_FLAG_LOAD_AWARE) != 0)
+            {
+                /* the watermark flags change without invalidating the cache */
+                congested[num_paths] = (ifp->current_state_flags & BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH) != 0;
+                *is_cacheable        = false;
+            }
+            ++num_paths;
+            if (num_paths >= BPLIB_ROUTE_MAX_PATHS)
+            {
+                break;
+            }
+        }
+    }
+
+    if (num_paths != 0)
+    {
+        intf = bplib_route_select_path(paths, congested, num_paths, flow_hash);
+    }
+
+    return intf;
+}
+
+/*
+ * Bundles of the same flow (same source and destination endpoint) must take the same path
+ * so they stay in order, so the path within a multipath group is selected by this hash.
+ */
+static uint32_t bplib_route_flow_hash(const bp_ipn_addr_t *src_addr, const bp_ipn_addr_t *dest_addr)
+{
+    uint64_t hash;
+
+    hash = src_addr->node_number;
+    hash = (hash * BPLIB_ROUTE_FLOW_HASH_MULT) + src_addr->service_number;
+    hash = (hash * BPLIB_ROUTE_FLOW_HASH_MULT) + dest_addr->node_number;
+    hash = (hash * BPLIB_ROUTE_FLOW_HASH_MULT) + dest_addr->service_number;
+
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/*
+ * Custody acknowledgements (DACS) can arrive at a high rate, and all that is done with one
+ * here is to hand it to the custody code in the cache, so these are recognized on ingress
+ * to skip the hop through the service base interface.
+ */
+static bool bplib_route_is_custody_ack(bplib_mpool_bblock_primary_t *pri_block)
+{
+    return (pri_block->data.logical.controlFlags.isAdminRecord &&
+            bplib_mpool_bblock_primary_locate_canonical(pri_block, bp_blocktype_custodyAcceptPayloadBlock) != NULL);
+}
+
+/*
+ * Bundles are now routed by the CLA threads as well as the maintenance thread (see
+ * bplib_route_ingress_cut_through), so the success count is updated atomically if possible.
+ */
+static inline void bplib_route_count_success(bplib_routetbl_t *tbl)
+{
+#ifdef BPLIB_ROUTE_ATOMIC_SNAPSHOT
+    __atomic_add_fetch(&tbl->routing_success_count, 1, __ATOMIC_RELAXED);
+#else
+    ++tbl->routing_success_count;
+#endif
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int bplib_route_ingress_to_parent(void *arg, bplib_mpool_block_t *subq_src)
+{
+    bplib_mpool_flow_t *curr_flow;
+    bplib_mpool_flow_t *next_flow;
+    uint32_t            queue_depth;
+
+    /* This implements a simple ingress for sub-interfaces (of any kind) where the ingress
+     * of the sub-interface nodes is simply funneled into the parent */
+
+    curr_flow = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(subq_src));
+    if (curr_flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to cast flow block\n");
+        return -1;
+    }
+
+    next_flow = bplib_mpool_flow_cast(bplib_mpool_dereference(curr_flow->parent));
+    if (next_flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to cast flow parent block\n");
+        return -1;
+    }
+
+    /* Entire contents moved as a batch. */
+    queue_depth = bplib_mpool_flow_try_move_all(&next_flow->ingress, &curr_flow->ingress, 0);
+
+    return queue_depth;
+}
+
+void bplib_route_ingress_route_single_bundle(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    bp_primary_block_t           *pri;
+    bp_ipn_addr_t                 src_addr;
+    bp_ipn_addr_t                 dest_addr;
+    bp_handle_t                   next_hop;
+    uint32_t                      req_flags;
+    uint32_t                      flag_mask;
+
+    /* is this routable right now? */
+    pri_block = bplib_mpool_bblock_primary_cast(pblk);
+    if (pri_block != NULL)
+    {
+        pri = bplib_mpool_bblock_primary_get_logical(pri_block);
+
+        v7_get_eid(&src_addr, &pri->sourceEID);
+        v7_get_eid(&dest_addr, &pri->destinationEID);
+
+        /* the next hop must be "up" (both administratively and operationally) to be valid */
+        /* Also, if this bundle has not yet been stored, and the delivery policy wants some form of acknowledgement,
+         * then it should be directed to an interface that is storage-capable, even if the outgoing CLA is up */
+        req_flags = BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP;
+        flag_mask = req_flags;
+
+        if (!bp_handle_is_valid(pri_block->data.delivery.storage_intf_id) &&
+            pri_block->data.delivery.delivery_policy != bplib_policy_delivery_none)
+        {
+            /* not yet stored and needs to be, so next hop must be a storage */
+            flag_mask |= BPLIB_MPOOL_FLOW_FLAGS_STORAGE;
+            req_flags |= BPLIB_MPOOL_FLOW_FLAGS_STORAGE;
+        }
+        next_hop = bplib_route_get_next_intf_for_flow(tbl, dest_addr.node_number,
+                                                      bplib_route_flow_hash(&src_addr, &dest_addr), req_flags,
+                                                      flag_mask);
+        BPLIB_TRACEPOINT_BUNDLE(route, pri_block, bp_handle_printable(next_hop));
+        if (!bp_handle_is_valid(next_hop))
+        {
+            bplib_cla_count_drop(tbl, pri_block->data.delivery.ingress_intf_id, bplib_cla_counter_drop_no_route);
+        }
+        else if (bplib_route_is_custody_ack(pri_block) && bplib_serviceflow_push_custody_ack(tbl, next_hop, pblk))
+        {
+            /* went straight to the storage service of the local node */
+            bplib_route_count_success(tbl);
+            pblk = NULL;
+        }
+        else if (bplib_route_push_egress_bundle(tbl, next_hop, pblk) == 0)
+        {
+            /* successfully routed */
+            bplib_route_count_success(tbl);
+            pblk = NULL;
+        }
+        else
+        {
+            bplib_cla_count_drop(tbl, next_hop, bplib_cla_counter_drop_queue_full);
+        }
+    }
+
+    /* if qblk is still set to non-null at this point, it means the block was not routable */
+    if (pblk != NULL)
+    {
+        /* this should never happen, must discard the block because there is nowhere to put it */
+        bplib_mpool_recycle_block(pblk);
+        ++tbl->routing_error_count;
+    }
+}
+
+bool bplib_route_ingress_cut_through(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    bp_primary_block_t           *pri;
+    bp_ipn_addr_t                 src_addr;
+    bp_ipn_addr_t                 dest_addr;
+    bp_handle_t                   next_hop;
+    bplib_mpool_ref_t             flow_ref;
+    bplib_mpool_flow_t           *flow;
+    bool                          forwarded;
+
+    /*
+     * Only a best effort bundle that needs nothing else done to it here qualifies: it does not
+     * have to be stored first, it is not a fragment to be reassembled, and it is not an admin
+     * record for the local node.  Anything else takes the usual path via the ingress queue.
+     */
+    pri_block = bplib_mpool_bblock_primary_cast(pblk);
+    if (pri_block == NULL || pri_block->data.delivery.delivery_policy != bplib_policy_delivery_none)
+    {
+        return false;
+    }
+
+    pri = bplib_mpool_bblock_primary_get_logical(pri_block);
+    if (pri->controlFlags.isFragment || pri->controlFlags.isAdminRecord)
+    {
+        return false;
+    }
+
+    v7_get_eid(&src_addr, &pri->sourceEID);
+    v7_get_eid(&dest_addr, &pri->destinationEID);
+
+    next_hop = bplib_route_get_next_intf_for_flow(
+        tbl, dest_addr.node_number, bplib_route_flow_hash(&src_addr, &dest_addr),
+        BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+    if (!bp_handle_is_valid(next_hop))
+    {
+        return false;
+    }
+
+    /* the ref keeps the next hop from going away, this is not the maintenance thread */
+    forwarded = false;
+    flow_ref  = bplib_route_get_intf_controlblock(tbl, next_hop);
+    flow      = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+
+    /* a bundle for a local service still goes the usual way, this is only for CLA to CLA */
+    if (flow != NULL && bplib_cla_is_intf(bplib_mpool_dereference(flow_ref)))
+    {
+        BPLIB_TRACEPOINT_BUNDLE(route, pri_block, bp_handle_printable(next_hop));
+        if (bplib_cla_push_egress_bundle(flow, pblk) == BP_SUCCESS)
+        {
+            bplib_route_count_success(tbl);
+            forwarded = true;
+        }
+    }
+
+    if (flow_ref != NULL)
+    {
+        bplib_route_release_intf_controlblock(tbl, flow_ref);
+    }
+
+    return forwarded;
+}
+
+int bplib_route_ingress_baseintf_forwarder(void *arg, bplib_mpool_block_t *subq_src)
+{
+    bplib_mpool_block_t  batch;
+    bplib_mpool_block_t *qblk;
+    bplib_mpool_block_t *intf_block;
+    bplib_mpool_flow_t  *flow;
+    bplib_mpool_job_t   *job;
+    int                  forward_count;
+    uint32_t             count;
+    bool                 share_spent;
+
+    intf_block = bplib_mpool_get_block_from_link(subq_src);
+    flow       = bplib_mpool_flow_cast(intf_block);
+    if (flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to cast flow block\n");
+        return -1;
+    }
+
+    job           = bplib_mpool_job_cast(subq_src);
+    forward_count = 0;
+    share_spent   = false;
+    bplib_mpool_init_list_head(NULL, &batch);
+    while (!share_spent)
+    {
+        count = bplib_mpool_flow_try_pull_n(&flow->ingress, &batch, BPLIB_ROUTE_FORWARD_BATCH_SIZE, 0);
+        if (count == 0)
+        {
+            /* no more bundles */
+            break;
+        }
+
+        /* Increment the counter based off items shifted from the input queue -
+         * even if it gets dropped after this (hopefully not) it still counts
+         * as something moved/changed by this action */
+        forward_count += count;
+
+        while (count > 0)
+        {
+            qblk = bplib_mpool_get_next_block(&batch);
+            bplib_mpool_extract_node(qblk);
+            --count;
+
+            /* the rest of the batch is still done, any overrun is taken from the next turn */
+            if (job != NULL && bplib_mpool_job_spend_share(job, qblk))
+            {
+                share_spent = true;
+            }
+
+            /* so may all of the decoding, and then a bundle that does not decode goes no further */
+            qblk = bplib_cla_decode_ingress(intf_block, qblk);
+            if (qblk == NULL)
+            {
+                continue;
+            }
+
+            /* the block CRCs may have been left for here, off the receiving thread */
+            qblk = bplib_cla_verify_ingress(intf_block, qblk);
+            if (qblk == NULL)
+            {
+                continue;
+            }
+
+            /* a fragment is held until the whole bundle can be put back together */
+            qblk = bplib_cla_reassemble_ingress(intf_block, qblk);
+            if (qblk == NULL)
+            {
+                continue;
+            }
+
+            /*
+             * This call always puts the block somewhere -
+             * if its unroutable, the block will be put into the recycle bin.
+             */
+            bplib_route_ingress_route_single_bundle(arg, qblk);
+        }
+    }
+
+    /* with a quantum, the other active jobs get a turn before the rest of this queue */
+    if (share_spent)
+    {
+        bplib_mpool_job_mark_active(job);
+    }
+
+    /* This should return 0 if it did no work and no errors.
+     * Should return >0 if some work was done */
+    return forward_count;
+}
+
+bplib_mpool_t *bplib_route_get_mpool(const bplib_routetbl_t *tbl)
+{
+    return tbl->pool;
+}
+
+bplib_routetbl_t *bplib_route_alloc_table(uint32_t max_routes, size_t cache_mem_size)
+{
+    return bplib_route_alloc_table_ext(max_routes, cache_mem_size, 0);
+}
+
+bplib_routetbl_t *bplib_route_alloc_table_ext(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags)
+{
+    return bplib_route_alloc_table_partitioned(max_routes, cache_mem_size, mem_flags, 1);
+}
+
+bplib_routetbl_t *bplib_route_alloc_table_partitioned(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags,
+                                                      uint32_t num_partitions)
+{
+    size_t            complete_size;
+    size_t            align;
+    size_t            set_offset;
+    size_t            route_offset;
+    size_t            cache_offset;
+    size_t            slot_offset;
+    size_t            contact_offset;
+    size_t            bplib_mpool_offset;
+    uint32_t          os_flags;
+    uint32_t          pool_flags;
+    uint8_t          *mem_ptr;
+    bplib_routetbl_t *tbl_ptr;
+    bplib_routeset_t *sets;
+    struct routeset_align
+    {
+        /* This byte only exists to check the offset of the following member */
+        /* cppcheck-suppress unusedStructMember */
+        uint8_t          byte;
+        bplib_routeset_t route_set_offset;
+    };
+    struct routeentry_align
+    {
+        /* This byte only exists to check the offset of the following member */
+        /* cppcheck-suppress unusedStructMember */
+        uint8_t            byte;
+        bplib_routeentry_t route_tbl_offset;
+    };
+    struct routecache_align
+    {
+        /* This byte only exists to check the offset of the following member */
+        /* cppcheck-suppress unusedStructMember */
+        uint8_t                  byte;
+        bplib_routecache_entry_t route_cache_offset;
+    };
+    struct intfslot_align
+    {
+        /* This byte only exists to check the offset of the following member */
+        /* cppcheck-suppress unusedStructMember */
+        uint8_t                byte;
+        bplib_route_intfslot_t intf_slot_offset;
+    };
+    struct contactslot_align
+    {
+        /* This byte only exists to check the offset of the following member */
+        /* cppcheck-suppress unusedStructMember */
+        uint8_t                   byte;
+        bplib_route_contactslot_t contact_slot_offset;
+    };
+    struct pool_align
+    {
+        /* This byte only exists to check the offset of the following member */
+        /* cppcheck-suppress unusedStructMember */
+        uint8_t byte;
+        union
+        {
+            uintmax_t   align_int;
+            void       *align_ptr;
+            long double align_float;
+        } pool_offset;
+    };
+
+    if (max_routes == 0)
+    {
+        return NULL;
+    }
+
+    complete_size = sizeof(bplib_routetbl_t);
+
+    /* two route sets, each with its own copy of the route entries, see bplib_route_update_begin() */
+    align         = offsetof(struct routeset_align, route_set_offset) - 1;
+    complete_size = (complete_size + align) & ~align;
+    set_offset    = complete_size;
+    complete_size += sizeof(bplib_routeset_t) * 2;
+
+    align         = offsetof(struct routeentry_align, route_tbl_offset) - 1;
+    complete_size = (complete_size + align) & ~align;
+    route_offset  = complete_size;
+    complete_size += sizeof(bplib_routeentry_t) * max_routes * 2;
+
+    align         = offsetof(struct routecache_align, route_cache_offset) - 1;
+    complete_size = (complete_size + align) & ~align;
+    cache_offset  = complete_size;
+    complete_size += sizeof(bplib_routecache_entry_t) * BPLIB_ROUTE_CACHE_SIZE;
+
+    align         = offsetof(struct intfslot_align, intf_slot_offset) - 1;
+    complete_size = (complete_size + align) & ~align;
+    slot_offset   = complete_size;
+    complete_size += sizeof(bplib_route_intfslot_t) * BPLIB_ROUTE_INTF_SLOTS;
+
+    align          = offsetof(struct contactslot_align, contact_slot_offset) - 1;
+    complete_size  = (complete_size + align) & ~align;
+    contact_offset = complete_size;
+    complete_size += sizeof(bplib_route_contactslot_t) * BPLIB_ROUTE_MAX_CONTACTS;
+
+    /* the pool puts long doubles in its blocks, which may need more than a pointer or an integer */
+    align              = offsetof(struct pool_align, pool_offset) - 1;
+    complete_size      = (complete_size + align) & ~align;
+    bplib_mpool_offset = complete_size;
+    complete_size += cache_mem_size;
+
+    complete_size = (complete_size + align) & ~align;
+
+    /* the OS-specific pool memory is only needed for the options that the heap cannot do */
+    os_flags = 0;
+    if ((mem_flags & BPLIB_ROUTE_MEM_HUGEPAGE) != 0)
+    {
+        os_flags |= BPLIB_OS_POOLMEM_HUGEPAGE;
+    }
+    if ((mem_flags & BPLIB_ROUTE_MEM_LOCKED) != 0)
+    {
+        os_flags |= BPLIB_OS_POOLMEM_LOCKED;
+    }
+
+#ifdef BPLIB_STATIC_CONFIG
+    /* the table is always the static one, where that goes (and so the memory flags) is up to the link */
+    (void)os_flags;
+    if (bplib_route_static_mem_taken || max_routes > BPLIB_STATIC_MAX_ROUTES ||
+        cache_mem_size > BPLIB_STATIC_POOL_SIZE || complete_size > sizeof(bplib_route_static_mem))
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Route table of %lu routes and %zu bytes does not fit the static config\n",
+              (unsigned long)max_routes, cache_mem_size);
+        return NULL;
+    }
+    bplib_route_static_mem_taken = true;
+    tbl_ptr                      = (bplib_routetbl_t *)(void *)&bplib_route_static_mem;
+#else
+    if (os_flags != 0)
+    {
+        tbl_ptr = (bplib_routetbl_t *)bplib_os_alloc_pool_mem(complete_size, os_flags);
+    }
+    else
+    {
+        tbl_ptr = (bplib_routetbl_t *)bplib_os_calloc(complete_size);
+    }
+#endif
+    mem_ptr = (uint8_t *)tbl_ptr;
+
+    if (tbl_ptr != NULL)
+    {
+        /* either way, the memory is zero filled, so the pool can leave it untouched until used */
+        pool_flags = 0;
+        if ((mem_flags & BPLIB_ROUTE_MEM_LAZY_INIT) != 0)
+        {
+            pool_flags |= BPLIB_MPOOL_CREATE_LAZY_INIT;
+        }
+
+        if (num_partitions > 1)
+        {
+            tbl_ptr->pool = bplib_mpool_create_partitioned(mem_ptr + bplib_mpool_offset,
+                                                           complete_size - bplib_mpool_offset, num_partitions,
+                                                           pool_flags);
+        }
+        else if (pool_flags != 0)
+        {
+            tbl_ptr->pool =
+                bplib_mpool_create_ext(mem_ptr + bplib_mpool_offset, complete_size - bplib_mpool_offset, pool_flags);
+        }
+        else
+        {
+            tbl_ptr->pool = bplib_mpool_create(mem_ptr + bplib_mpool_offset, complete_size - bplib_mpool_offset);
+        }
+
+        if (tbl_ptr->pool == NULL)
+        {
+#ifdef BPLIB_STATIC_CONFIG
+            /* put it back the way it was, zero filled, for another try */
+            memset(mem_ptr, 0, complete_size);
+            bplib_route_static_mem_taken = false;
+#else
+            if (os_flags != 0)
+            {
+                bplib_os_free_pool_mem(tbl_ptr, complete_size);
+            }
+            else
+            {
+                bplib_os_free(tbl_ptr);
+            }
+#endif
+            tbl_ptr = NULL;
+        }
+    }
+
+    if (tbl_ptr != NULL)
+    {
+        tbl_ptr->activity_lock     = bplib_os_createlock();
+        tbl_ptr->route_update_lock = bplib_os_createlock();
+        tbl_ptr->route_cache_lock  = bplib_os_createlock();
+        tbl_ptr->contact_lock      = bplib_os_createlock();
+#ifdef BPLIB_LOCK_PROFILE
+        bplib_mpool_lock_profile_init(&tbl_ptr->activity_hold, "activity_lock");
+#endif
+        tbl_ptr->next_poll_time    = BP_DTNTIME_INFINITE;
+        tbl_ptr->next_contact_time = BP_DTNTIME_INFINITE;
+        bplib_mpool_init_list_head(NULL, &tbl_ptr->flow_list);
+        bplib_mpool_init_list_head(NULL, &tbl_ptr->poll_list);
+
+        /* the cache entries are zero filled, so starting at generation 1 makes them all invalid */
+        tbl_ptr->route_generation    = 1;
+        tbl_ptr->max_routes          = max_routes;
+        tbl_ptr->pool_inspect_budget = BPLIB_MPOOL_INSPECT_BUDGET;
+        tbl_ptr->route_sets       = (void *)(mem_ptr + set_offset);
+        tbl_ptr->route_cache      = (void *)(mem_ptr + cache_offset);
+        tbl_ptr->intf_slots       = (void *)(mem_ptr + slot_offset);
+        tbl_ptr->contacts         = (void *)(mem_ptr + contact_offset);
+
+        sets              = tbl_ptr->route_sets;
+        sets[0].route_tbl = (void *)(mem_ptr + route_offset);
+        sets[1].route_tbl = sets[0].route_tbl + max_routes;
+    }
+
+    return tbl_ptr;
+}
+
+bp_handle_t bplib_route_register_generic_intf(bplib_routetbl_t *tbl, bp_handle_t parent_intf_id,
+                                              bplib_mpool_block_t *flow_block)
+{
+    bplib_mpool_flow_t *flow;
+    bplib_mpool_ref_t   fref;
+    bp_handle_t         result;
+
+    result = BP_INVALID_HANDLE;
+    flow   = bplib_mpool_flow_cast(flow_block);
+    if (flow == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to cast flow block\n");
+        return result;
+    }
+
+    fref = bplib_route_get_intf_controlblock(tbl, parent_intf_id);
+
+    if (fref == NULL && bp_handle_is_valid(parent_intf_id))
+    {
+        /* this is an error */
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Parent intf not valid\n");
+    }
+    else
+    {
+        flow->parent = fref;
+        result       = bplib_mpool_get_external_id(flow_block);
+
+        /* keep track of all flows here in the flow_list - this counts as a ref so it
+         * will not be auto-collected as long as its here in this list.  The ref is
+         * intentionally _not_ released here, see bplib_route_del_intf */
+        fref = bplib_mpool_ref_create(flow_block);
+        if (fref != NULL)
+        {
+            bplib_route_activity_lock(tbl);
+            bplib_mpool_insert_before(&tbl->flow_list, flow_block);
+            bplib_route_intf_slot_set(tbl, result, flow_block, flow);
+            bplib_route_activity_unlock(tbl);
+        }
+    }
+
+    return result;
+}
+
+int bplib_route_register_handler_impl(bplib_routetbl_t *tbl, bp_handle_t intf_id, size_t func_position,
+                                      bplib_mpool_callback_func_t new_func)
+{
+    bplib_mpool_flow_t          *ifp;
+    uint8_t                     *base_ptr;
+    bplib_mpool_subq_workitem_t *subq;
+
+    ifp = bplip_route_lookup_intf(tbl, intf_id);
+    if (ifp == NULL)
+    {
+        /* Not a valid handle */
+        return -1;
+    }
+
+    base_ptr = (uint8_t *)ifp;
+
+    subq = (bplib_mpool_subq_workitem_t *)(void *)(base_ptr + func_position);
+
+    if (subq->job_header.handler == new_func)
+    {
+        /* already registered */
+        return 0;
+    }
+
+    /* One or the other must be NULL or else this is an invalid registration */
+    if (subq->job_header.handler != NULL && new_func != NULL)
+    {
+        return -1;
+    }
+
+    /* OK, now set it to the new value */
+    subq->job_header.handler = new_func;
+    return 0;
+}
+
+int bplib_route_register_forward_ingress_handler(bplib_routetbl_t *tbl, bp_handle_t intf_id,
+                                                 bplib_mpool_callback_func_t ingress)
+{
+    return bplib_route_register_handler_impl(tbl, intf_id, offsetof(bplib_mpool_flow_t, ingress), ingress);
+}
+
+int bplib_route_register_forward_egress_handler(bplib_routetbl_t *tbl, bp_handle_t intf_id,
+                                                bplib_mpool_callback_func_t egress)
+{
+    return bplib_route_register_handler_impl(tbl, intf_id, offsetof(bplib_mpool_flow_t, egress), egress);
+}
+
+int bplib_route_register_event_handler(bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_callback_func_t event)
+{
+    bplib_mpool_flow_t *ifp;
+
+    ifp = bplip_route_lookup_intf(tbl, intf_id);
+    if (ifp == NULL)
+    {
+        /* Not a valid handle */
+        return -1;
+    }
+
+    if (ifp->statechange_job.event_handler == event)
+    {
+        /* already registered */
+        return 0;
+    }
+
+    /* One or the other must be NULL or else this is an invalid registration */
+    if (ifp->statechange_job.event_handler != NULL && event != NULL)
+    {
+        return -1;
+    }
+
+    /* OK, now set it to the new value */
+    ifp->statechange_job.event_handler = event;
+    return 0;
+}
+
+int bplib_route_del_intf(bplib_routetbl_t *tbl, bp_handle_t intf_id)
+{
+    uint32_t            pos;
+    bplib_routeentry_t *rp;
+    bplib_routeset_t   *set;
+    bplib_mpool_ref_t   ref;
+    bplib_mpool_flow_t *ifp;
+    bool                found;
+
+    ref = bplib_route_get_intf_controlblock(tbl, intf_id);
+    if (ref == NULL)
+    {
+        /* Not a valid handle */
+        return -1;
+    }
+
+    ifp = bplib_mpool_flow_cast(bplib_mpool_dereference(ref));
+    if (ifp != NULL)
+    {
+        /* before it can be deleted, should ensure it is not referenced */
+        set   = bplib_route_update_begin(tbl);
+        found = false;
+        for (pos = 0; pos < set->registered_routes; ++pos)
+        {
+            rp = &set->route_tbl[pos];
+            if (bp_handle_equal(rp->intf_id, intf_id))
+            {
+                found = true;
+                --set->registered_routes;
+
+                /* close the gap, if this left one */
+                if (pos < set->registered_routes)
+                {
+                    memmove(&rp[0], &rp[1], sizeof(*rp) * (set->registered_routes - pos));
+                }
+                break;
+            }
+        }
+
+        if (found)
+        {
+            bplib_route_update_commit(tbl, set);
+        }
+        else
+        {
+            bplib_route_update_cancel(tbl);
+        }
+    }
+
+    /* remove the flow from the flow_list.  This releases the reference
+     * that was created during bplib_route_register_generic_intf()  */
+    bplib_route_activity_lock(tbl);
+    bplib_route_intf_slot_clear(tbl, intf_id);
+    if (bplib_mpool_is_link_attached(bplib_mpool_dereference(ref)))
+    {
+        bplib_mpool_extract_node(bplib_mpool_dereference(ref));
+    }
+    if (ifp != NULL)
+    {
+        bplib_route_poll_schedule(tbl, ifp, BP_DTNTIME_INFINITE);
+    }
+    bplib_route_activity_unlock(tbl);
+
+    /* release the local ref, this should make the refcount 0 again */
+    bplib_mpool_ref_release(ref);
+
+    /* just wipe it */
+    memset(ifp, 0, sizeof(*ifp));
+    return 0;
+}
+
+bp_handle_t bplib_route_get_next_intf_with_flags(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t req_flags,
+                                                 uint32_t flag_mask)
+{
+    /* without a flow, this always gives the first path of a multipath group */
+    return bplib_route_get_next_intf_for_flow(tbl, dest, 0, req_flags, flag_mask);
+}
+
+bp_handle_t bplib_route_get_next_intf_for_flow(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t flow_hash,
+                                               uint32_t req_flags, uint32_t flag_mask)
+{
+    bplib_routecache_entry_t *cep;
+    uint32_t                  generation;
+    bplib_routeset_t         *set;
+    bp_handle_t               intf;
+    bool                      is_cacheable;
+    bool                      is_cached;
+
+    /* tables that were not created by bplib_route_alloc_table() have no cache */
+    if (tbl->route_cache == NULL)
+    {
+        set  = bplib_route_read_begin(tbl);
+        intf = bplib_route_search_intf(tbl, set, dest, flow_hash, req_flags, flag_mask, &is_cacheable);
+        bplib_route_read_end(tbl, set);
+        return intf;
+    }
+
+    /* bursts of bundles usually all go to the same place, so the last answer for
+     * this dest is kept until something changes that might make it different */
+    cep        = &tbl->route_cache[(dest + flow_hash) & (BPLIB_ROUTE_CACHE_SIZE - 1)];
+    generation = tbl->route_generation;
+    intf       = BP_INVALID_HANDLE;
+
+    bplib_os_lock(tbl->route_cache_lock);
+    is_cached = (cep->generation == generation && cep->dest == dest && cep->flow_hash == flow_hash &&
+                 cep->req_flags == req_flags && cep->flag_mask == flag_mask);
+    if (is_cached)
+    {
+        intf = cep->intf_id;
+    }
+    bplib_os_unlock(tbl->route_cache_lock);
+
+    if (!is_cached)
+    {
+        /* the search itself is done without the cache lock, it may look up flows */
+        set  = bplib_route_read_begin(tbl);
+        intf = bplib_route_search_intf(tbl, set, dest, flow_hash, req_flags, flag_mask, &is_cacheable);
+        bplib_route_read_end(tbl, set);
+        if (is_cacheable)
+        {
+            bplib_os_lock(tbl->route_cache_lock);
+            cep->dest       = dest;
+            cep->flow_hash  = flow_hash;
+            cep->req_flags  = req_flags;
+            cep->flag_mask  = flag_mask;
+            cep->generation = generation;
+            cep->intf_id    = intf;
+            bplib_os_unlock(tbl->route_cache_lock);
+        }
+    }
+
+    return intf;
+}
+
+bp_handle_t bplib_route_get_next_avail_intf(const bplib_routetbl_t *tbl, bp_ipn_t dest)
+{
+    return bplib_route_get_next_intf_with_flags(tbl, dest, BPLIB_INTF_AVAILABLE_FLAGS, BPLIB_INTF_AVAILABLE_FLAGS);
+}
+
+int bplib_route_push_ingress_bundle(const bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *cb)
+{
+    bplib_mpool_flow_t *flow;
+    int                 status;
+
+    status = -1;
+    flow   = bplip_route_lookup_intf(tbl, intf_id);
+    if (flow != NULL && bplib_mpool_flow_try_push(&flow->ingress, cb, 0))
+    {
+        status = 0;
+    }
+
+    return status;
+}
+
+int bplib_route_push_egress_bundle(const bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *cb)
+{
+    bplib_mpool_flow_t *flow;
+    int                 status;
+
+    status = -1;
+    flow   = bplip_route_lookup_intf(tbl, intf_id);
+
+    /* a CLA may send the bundle as fragments instead */
+    if (flow != NULL && bplib_cla_push_egress_bundle(flow, cb) == BP_SUCCESS)
+    {
+        status = 0;
     }
 
-    /* This should return 0 if it did no work and no errors.
-     * Should return >0 if some work was done */
-    return forward_count;
+    return status;
 }
 
-bplib_mpool_t *bplib_route_get_mpool(const bplib_routetbl_t *tbl)
+int bplib_route_add(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id)
 {
-    return tbl->pool;
+    return bplib_route_add_ext(tbl, dest, mask, intf_id, 0);
 }
 
-bplib_routetbl_t *bplib_route_alloc_table(uint32_t max_routes, size_t cache_mem_size)
+int bplib_route_add_ext(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id, uint32_t route_flags)
 {
-    size_t            complete_size;
-    size_t            align;
-    size_t            route_offset;
-    size_t            bplib_mpool_offset;
-    uint8_t          *mem_ptr;
-    bplib_routetbl_t *tbl_ptr;
-    struct routeentry_align
+    uint32_t                  lvl_num;
+    uint32_t                  pos;
+    uint32_t                  insert_pos;
+    bp_ipn_t                  key;
+    const bplib_routelevel_t *lvl;
+    bplib_routeentry_t       *rp;
+    bplib_routeset_t         *set;
+
+    /* Mask check: should have MSB's set, no gaps */
+    if (((~mask + 1) & (~mask)) != 0)
     {
-        /* This byte only exists to check the offset of the following member */
-        /* cppcheck-suppress unusedStructMember */
-        uint8_t            byte;
-        bplib_routeentry_t route_tbl_offset;
-    };
+        return -1;
+    }
 
-    if (max_routes == 0)
+    set = bplib_route_update_begin(tbl);
+    if (set->registered_routes >= tbl->max_routes)
     {
-        return NULL;
+        bplib_route_update_cancel(tbl);
+        return -1;
     }
 
-    complete_size = sizeof(bplib_routetbl_t);
+    /* Find the position, the sequence should go from most specific to least specific mask,
+     * and within the same mask it is sorted by the masked dest, in the order added */
+    key        = dest & mask;
+    insert_pos = set->registered_routes;
+    for (lvl_num = 0; lvl_num < set->num_levels; ++lvl_num)
+    {
+        lvl = &set->levels[lvl_num];
+        if (lvl->mask == mask)
+        {
+            insert_pos = bplib_route_level_search(set, lvl, key, true);
+            for (pos = bplib_route_level_search(set, lvl, key, false); pos < insert_pos; ++pos)
+            {
+                rp = &set->route_tbl[pos];
+                if (rp->dest == dest && bp_handle_equal(rp->intf_id, intf_id))
+                {
+                    /* duplicate route */
+                    bplib_route_update_cancel(tbl);
+                    return -1;
+                }
+            }
+            break;
+        }
+        if ((lvl->mask & mask) != mask)
+        {
+            /* this level is less specific, must come before it */
+            insert_pos = lvl->start_pos;
+            break;
+        }
+    }
 
-    align         = offsetof(struct routeentry_align, route_tbl_offset) - 1;
-    complete_size = (complete_size + align) & ~align;
-    route_offset  = complete_size;
-    complete_size += sizeof(bplib_routeentry_t) * max_routes;
+    /* If necessary, shift entries back to make a gap.
+     * This is somewhat expensive, but route add/remove probably does not
+     * happen that often */
+    rp = &set->route_tbl[insert_pos];
+    if (insert_pos < set->registered_routes)
+    {
+        memmove(&rp[1], &rp[0], sizeof(*rp) * (set->registered_routes - insert_pos));
+    }
 
-    align = sizeof(void *) - 1;
-    align |= sizeof(uintmax_t) - 1;
-    complete_size      = (complete_size + align) & ~align;
-    bplib_mpool_offset = complete_size;
-    complete_size += cache_mem_size;
+    rp->dest    = dest;
+    rp->mask    = mask;
+    rp->intf_id = intf_id;
+    rp->flags   = route_flags;
 
-    complete_size = (complete_size + align) & ~align;
+    ++set->registered_routes;
+    bplib_route_update_commit(tbl, set);
 
-    tbl_ptr = (bplib_routetbl_t *)bplib_os_calloc(complete_size);
-    mem_ptr = (uint8_t *)tbl_ptr;
+    return 0;
+}
 
-    if (tbl_ptr != NULL)
+int bplib_route_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id)
+{
+    uint32_t                  lvl_num;
+    uint32_t                  pos;
+    uint32_t                  end_pos;
+    bp_ipn_t                  key;
+    const bplib_routelevel_t *lvl;
+    bplib_routeentry_t       *rp;
+    bplib_routeset_t         *set;
+
+    /* Find the position, only the entries with the same mask and masked dest need checking */
+    set     = bplib_route_update_begin(tbl);
+    key     = dest & mask;
+    pos     = 0;
+    end_pos = 0;
+    for (lvl_num = 0; lvl_num < set->num_levels; ++lvl_num)
     {
-        tbl_ptr->pool = bplib_mpool_create(mem_ptr + bplib_mpool_offset, complete_size - bplib_mpool_offset);
-        if (tbl_ptr->pool == NULL)
+        lvl = &set->levels[lvl_num];
+        if (lvl->mask == mask)
         {
-            bplib_os_free(tbl_ptr);
-            tbl_ptr = NULL;
+            end_pos = bplib_route_level_search(set, lvl, key, true);
+            for (pos = bplib_route_level_search(set, lvl, key, false); pos < end_pos; ++pos)
+            {
+                rp = &set->route_tbl[pos];
+                if (rp->dest == dest && bp_handle_equal(rp->intf_id, intf_id))
+                {
+                    break;
+                }
+            }
+            break;
         }
     }
 
-    if (tbl_ptr != NULL)
+    if (pos >= end_pos)
     {
-        tbl_ptr->activity_lock  = bplib_os_createlock();
-        tbl_ptr->last_intf_poll = bplib_os_get_dtntime_ms();
-        bplib_mpool_init_list_head(NULL, &tbl_ptr->flow_list);
+        /* route not found */
+        bplib_route_update_cancel(tbl);
+        return -1;
+    }
 
-        tbl_ptr->max_routes = max_routes;
-        tbl_ptr->route_tbl  = (void *)(mem_ptr + route_offset);
+    --set->registered_routes;
+
+    /* If this was in the middle, close the gap */
+    rp = &set->route_tbl[pos];
+    if (pos < set->registered_routes)
+    {
+        memmove(&rp[0], &rp[1], sizeof(*rp) * (set->registered_routes - pos));
     }
 
-    return tbl_ptr;
+    bplib_route_update_commit(tbl, set);
+
+    return 0;
 }
 
-bp_handle_t bplib_route_register_generic_intf(bplib_routetbl_t *tbl, bp_handle_t parent_intf_id,
-                                              bplib_mpool_block_t *flow_block)
+/*
+ * Whether entry a goes before entry b in a route set, see bplib_route_add_ext() for the order
+ */
+static inline bool bplib_route_entry_before(const bplib_routeentry_t *a, const bplib_routeentry_t *b)
 {
-    bplib_mpool_flow_t *flow;
-    bplib_mpool_ref_t   fref;
-    bp_handle_t         result;
-
-    result = BP_INVALID_HANDLE;
-    flow   = bplib_mpool_flow_cast(flow_block);
-    if (flow == NULL)
+    if (a->mask != b->mask)
     {
-        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to cast flow block\n");
-        return result;
+        /* the masks have no gaps, so the one with more bits set is the bigger value */
+        return a->mask > b->mask;
     }
 
-    fref = bplib_route_get_intf_controlblock(tbl, parent_intf_id);
+    return (a->dest & a->mask) < (b->dest & b->mask);
+}
 
-    if (fref == NULL && bp_handle_is_valid(parent_intf_id))
+/*
+ * Sorts the entries into route set order.  This is a merge sort, so entries that are the same
+ * for the order stay as they were given, and scratch must have room for count entries.
+ */
+static void bplib_route_sort_entries(bplib_routeentry_t *entries, bplib_routeentry_t *scratch, uint32_t count)
+{
+    bplib_routeentry_t *src;
+    bplib_routeentry_t *dst;
+    bplib_routeentry_t *tmp;
+    uint32_t            width;
+    uint32_t            start;
+    uint32_t            mid;
+    uint32_t            end;
+    uint32_t            left;
+    uint32_t            right;
+    uint32_t            pos;
+
+    src = entries;
+    dst = scratch;
+    for (width = 1; width < count; width *= 2)
     {
-        /* this is an error */
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Parent intf not valid\n");
+        for (start = 0; start < count; start += 2 * width)
+        {
+            mid   = (width < count - start) ? (start + width) : count;
+            end   = (2 * width < count - start) ? (start + 2 * width) : count;
+            left  = start;
+            right = mid;
+            for (pos = start; pos < end; ++pos)
+            {
+                /* on a tie the left one goes first, which keeps the sort stable */
+                if (left < mid && (right >= end || !bplib_route_entry_before(&src[right], &src[left])))
+                {
+                    dst[pos] = src[left];
+                    ++left;
+                }
+                else
+                {
+                    dst[pos] = src[right];
+                    ++right;
+                }
+            }
+        }
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
     }
-    else
+
+    if (src != entries)
     {
-        flow->parent = fref;
-        result       = bplib_mpool_get_external_id(flow_block);
+        memcpy(entries, src, sizeof(*entries) * count);
+    }
+}
 
-        /* keep track of all flows here in the flow_list - this counts as a ref so it
-         * will not be auto-collected as long as its here in this list.  The ref is
-         * intentionally _not_ released here, see bplib_route_del_intf */
-        fref = bplib_mpool_ref_create(flow_block);
-        if (fref != NULL)
+/*
+ * Gives every flow that asked for contact events a single route change event, by toggling
+ * BPLIB_MPOOL_FLOW_FLAGS_ROUTES (either way is a change).  The locks are taken in the same
+ * order as in bplib_route_do_timed_poll().
+ */
+static void bplib_route_notify_route_change(bplib_routetbl_t *tbl)
+{
+    bplib_mpool_flow_t     *flow;
+    bplib_mpool_list_iter_t iter;
+    int                     status;
+
+    bplib_route_activity_lock(tbl);
+    status = bplib_mpool_list_iter_goto_first(&tbl->flow_list, &iter);
+    while (status == BP_SUCCESS)
+    {
+        flow = bplib_mpool_flow_cast(iter.position);
+        if (flow != NULL &&
+            ((flow->pending_state_flags | flow->current_state_flags) & BPLIB_MPOOL_FLOW_FLAGS_CONTACTS) != 0)
         {
-            bplib_os_lock(tbl->activity_lock);
-            bplib_mpool_insert_before(&tbl->flow_list, flow_block);
-            bplib_os_unlock(tbl->activity_lock);
+            if ((flow->pending_state_flags & BPLIB_MPOOL_FLOW_FLAGS_ROUTES) != 0)
+            {
+                bplib_mpool_flow_modify_flags(iter.position, 0, BPLIB_MPOOL_FLOW_FLAGS_ROUTES);
+            }
+            else
+            {
+                bplib_mpool_flow_modify_flags(iter.position, BPLIB_MPOOL_FLOW_FLAGS_ROUTES, 0);
+            }
         }
+        status = bplib_mpool_list_iter_forward(&iter);
     }
+    bplib_route_activity_unlock(tbl);
 
-    return result;
+    bplib_route_set_maintenance_request(tbl);
 }
 
-int bplib_route_register_handler_impl(bplib_routetbl_t *tbl, bp_handle_t intf_id, size_t func_position,
-                                      bplib_mpool_callback_func_t new_func)
+int bplib_route_replace_all(bplib_routetbl_t *tbl, const bplib_route_spec_t *routes, uint32_t route_count)
 {
-    bplib_mpool_flow_t          *ifp;
-    uint8_t                     *base_ptr;
-    bplib_mpool_subq_workitem_t *subq;
+    bplib_routeentry_t *scratch;
+    bplib_routeentry_t *rp;
+    bplib_routeentry_t *prev_rp;
+    bplib_routeset_t   *set;
+    uint32_t            pos;
+    uint32_t            prev;
 
-    ifp = bplip_route_lookup_intf(tbl, intf_id);
-    if (ifp == NULL)
+    if (route_count > tbl->max_routes)
     {
-        /* Not a valid handle */
         return -1;
     }
 
-    base_ptr = (uint8_t *)ifp;
+    /* Mask check, same as for bplib_route_add_ext() */
+    for (pos = 0; pos < route_count; ++pos)
+    {
+        if (((~routes[pos].mask + 1) & (~routes[pos].mask)) != 0)
+        {
+            return -1;
+        }
+    }
 
-    subq = (bplib_mpool_subq_workitem_t *)(void *)(base_ptr + func_position);
+    scratch = NULL;
+    if (route_count > 1)
+    {
+        scratch = bplib_os_calloc(sizeof(*scratch) * route_count);
+        if (scratch == NULL)
+        {
+            return -1;
+        }
+    }
 
-    if (subq->job_header.handler == new_func)
+    /* The new set is built in the one that is not current, so lookups go on with the old routes
+     * until all of it is done, and then see all of the new routes at once */
+    set = bplib_route_update_begin_empty(tbl);
+    for (pos = 0; pos < route_count; ++pos)
     {
-        /* already registered */
-        return 0;
+        rp          = &set->route_tbl[pos];
+        rp->dest    = routes[pos].dest;
+        rp->mask    = routes[pos].mask;
+        rp->intf_id = routes[pos].intf_id;
+        rp->flags   = routes[pos].flags;
     }
 
-    /* One or the other must be NULL or else this is an invalid registration */
-    if (subq->job_header.handler != NULL && new_func != NULL)
+    if (scratch != NULL)
     {
-        return -1;
+        bplib_route_sort_entries(set->route_tbl, scratch, route_count);
+        bplib_os_free(scratch);
     }
 
-    /* OK, now set it to the new value */
-    subq->job_header.handler = new_func;
-    return 0;
-}
+    /* a duplicate can only be among the entries just before it with the same mask and masked dest */
+    for (pos = 1; pos < route_count; ++pos)
+    {
+        rp = &set->route_tbl[pos];
+        for (prev = pos; prev > 0 && !bplib_route_entry_before(&set->route_tbl[prev - 1], rp); --prev)
+        {
+            prev_rp = &set->route_tbl[prev - 1];
+            if (prev_rp->dest == rp->dest && bp_handle_equal(prev_rp->intf_id, rp->intf_id))
+            {
+                bplib_route_update_cancel(tbl);
+                return -1;
+            }
+        }
+    }
 
-int bplib_route_register_forward_ingress_handler(bplib_routetbl_t *tbl, bp_handle_t intf_id,
-                                                 bplib_mpool_callback_func_t ingress)
-{
-    return bplib_route_register_handler_impl(tbl, intf_id, offsetof(bplib_mpool_flow_t, ingress), ingress);
-}
+    set->registered_routes = route_count;
+    bplib_route_update_commit(tbl, set);
 
-int bplib_route_register_forward_egress_handler(bplib_routetbl_t *tbl, bp_handle_t intf_id,
-                                                bplib_mpool_callback_func_t egress)
-{
-    return bplib_route_register_handler_impl(tbl, intf_id, offsetof(bplib_mpool_flow_t, egress), egress);
+    /* one event for all of it, rather than one for each route */
+    bplib_route_notify_route_change(tbl);
+
+    return 0;
 }
 
-int bplib_route_register_event_handler(bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_callback_func_t event)
+int bplib_route_intf_set_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint32_t flags)
 {
-    bplib_mpool_flow_t *ifp;
+    bplib_mpool_ref_t flow_ref;
 
-    ifp = bplip_route_lookup_intf(tbl, intf_id);
-    if (ifp == NULL)
+    flow_ref = bplib_route_get_intf_controlblock(tbl, intf_id);
+    if (flow_ref != NULL)
     {
-        /* Not a valid handle */
-        return -1;
+        if (bplib_mpool_flow_modify_flags(bplib_mpool_dereference(flow_ref), flags, 0))
+        {
+            bplib_route_cache_invalidate(tbl);
+            bplib_route_set_maintenance_request(tbl);
+        }
     }
+    bplib_route_release_intf_controlblock(tbl, flow_ref);
 
-    if (ifp->statechange_job.event_handler == event)
-    {
-        /* already registered */
-        return 0;
-    }
+    return 0;
+}
 
-    /* One or the other must be NULL or else this is an invalid registration */
-    if (ifp->statechange_job.event_handler != NULL && event != NULL)
+int bplib_route_intf_unset_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint32_t flags)
+{
+    bplib_mpool_ref_t flow_ref;
+
+    flow_ref = bplib_route_get_intf_controlblock(tbl, intf_id);
+    if (flow_ref != NULL)
     {
-        return -1;
+        if (bplib_mpool_flow_modify_flags(bplib_mpool_dereference(flow_ref), 0, flags))
+        {
+            bplib_route_cache_invalidate(tbl);
+            bplib_route_set_maintenance_request(tbl);
+        }
     }
+    bplib_route_release_intf_controlblock(tbl, flow_ref);
 
-    /* OK, now set it to the new value */
-    ifp->statechange_job.event_handler = event;
     return 0;
 }
 
-int bplib_route_del_intf(bplib_routetbl_t *tbl, bp_handle_t intf_id)
+int bplib_route_intf_set_poll_time(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint64_t poll_time)
 {
-    uint32_t            pos;
-    bplib_routeentry_t *rp;
-    bplib_mpool_ref_t   ref;
-    bplib_mpool_flow_t *ifp;
+    bplib_mpool_ref_t   flow_ref;
+    bplib_mpool_flow_t *flow;
 
-    ref = bplib_route_get_intf_controlblock(tbl, intf_id);
-    if (ref == NULL)
+    flow_ref = bplib_route_get_intf_controlblock(tbl, intf_id);
+    flow     = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL)
     {
-        /* Not a valid handle */
+        bplib_route_release_intf_controlblock(tbl, flow_ref);
         return -1;
     }
 
-    ifp = bplib_mpool_flow_cast(bplib_mpool_dereference(ref));
-    if (ifp != NULL)
-    {
-        /* before it can be deleted, should ensure it is not referenced */
-        for (pos = 0; pos < tbl->registered_routes; ++pos)
-        {
-            rp = &tbl->route_tbl[pos];
-            if (bp_handle_equal(rp->intf_id, intf_id))
-            {
-                --tbl->registered_routes;
-
-                /* close the gap, if this left one */
-                if (pos < tbl->registered_routes)
-                {
-                    memmove(&rp[0], &rp[1], sizeof(*rp) * (tbl->registered_routes - pos));
-                }
-                break;
-            }
-        }
-    }
-
-    /* remove the flow from the flow_list.  This releases the reference
-     * that was created during bplib_route_register_generic_intf()  */
-    bplib_os_lock(tbl->activity_lock);
-    if (bplib_mpool_is_link_attached(bplib_mpool_dereference(ref)))
+    /* the deadlines are only read and written with the activity lock held, see bplib_route_do_timed_poll() */
+    bplib_route_activity_lock(tbl);
+    bplib_route_poll_schedule(tbl, flow, poll_time);
+    if (poll_time < tbl->next_poll_time)
     {
-        bplib_mpool_extract_node(bplib_mpool_dereference(ref));
+        /* the maintenance task may be sleeping until a later time, so wake it to recompute */
+        tbl->next_poll_time = poll_time;
+        bplib_os_broadcast_signal(tbl->activity_lock);
     }
-    bplib_os_unlock(tbl->activity_lock);
+    bplib_route_activity_unlock(tbl);
 
-    /* release the local ref, this should make the refcount 0 again */
-    bplib_mpool_ref_release(ref);
+    bplib_route_release_intf_controlblock(tbl, flow_ref);
 
-    /* just wipe it */
-    memset(ifp, 0, sizeof(*ifp));
     return 0;
 }
 
-bp_handle_t bplib_route_get_next_intf_with_flags(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t req_flags,
-                                                 uint32_t flag_mask)
+void bplib_route_do_timed_poll(bplib_routetbl_t *tbl)
 {
-    uint32_t                  pos;
-    bplib_routeentry_t       *rp;
-    bp_handle_t               intf;
-    const bplib_mpool_flow_t *ifp;
-    uint32_t                  intf_flags;
+    uint64_t                current_time;
+    uint64_t                next_poll_time;
+    bplib_mpool_flow_t     *flow;
+    bplib_mpool_list_iter_t iter;
+    int                     status;
+
+    current_time = bplib_os_get_dtntime_coarse_ms();
 
-    intf = BP_INVALID_HANDLE;
-    for (pos = 0; pos < tbl->registered_routes; ++pos)
+    /* because the time is a 64-bit value and may not be atomic, it should
+     * be sampled and updated inside of a lock section to ensure the value
+     * is consistent */
+    bplib_route_activity_lock(tbl);
+    if (current_time >= tbl->next_poll_time)
     {
-        rp = &tbl->route_tbl[pos];
-        if (((rp->dest ^ dest) & rp->mask) == 0)
+        /* only the flows whose own deadline has been reached get a poll event,
+         * everything else just contributes its deadline to the next wakeup */
+        next_poll_time = BP_DTNTIME_INFINITE;
+
+        status = bplib_mpool_list_iter_goto_first(&tbl->poll_list, &iter);
+        while (status == BP_SUCCESS)
         {
-            intf_flags = ~req_flags;
-            if (flag_mask != 0)
+            /* the list holds the poll_link of each flow, not the flow block itself */
+            flow = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(iter.position));
+            if (flow != NULL && flow->poll_time <= current_time)
             {
-                ifp = bplip_route_lookup_intf_const(tbl, rp->intf_id);
-                if (ifp != NULL)
+                /* the flow must register again if it needs another poll, the iterator
+                 * has already moved past it, so it can be taken off the list here */
+                bplib_route_poll_schedule(tbl, flow, BP_DTNTIME_INFINITE);
+
+                /* NOTE: this will end up taking the pool lock as well, when it schedules the
+                 * state change for processing.  This means this task will have two locks at
+                 * once (the tbl activity lock and the pool resource lock).  As long as the locks
+                 * are always taken in that order (and not the other way around) this should be OK
+                 * for now, but it needs to be ensured that locks are never taken in the opposite
+                 * order.  Only this function changes the POLL flag, so toggling it always makes
+                 * a change and therefore always generates the event. */
+                if ((flow->pending_state_flags & BPLIB_MPOOL_FLOW_FLAGS_POLL) != 0)
+                {
+                    bplib_mpool_flow_modify_flags(bplib_mpool_get_block_from_link(iter.position), 0,
+                                                  BPLIB_MPOOL_FLOW_FLAGS_POLL);
+                }
+                else
                 {
-                    intf_flags = ifp->current_state_flags;
+                    bplib_mpool_flow_modify_flags(bplib_mpool_get_block_from_link(iter.position),
+                                                  BPLIB_MPOOL_FLOW_FLAGS_POLL, 0);
                 }
             }
-            if ((intf_flags & flag_mask) == req_flags)
+            else if (flow != NULL && flow->poll_time < next_poll_time)
             {
-                intf = rp->intf_id;
-                break;
+                next_poll_time = flow->poll_time;
             }
+            status = bplib_mpool_list_iter_forward(&iter);
         }
-    }
-
-    return intf;
-}
 
-bp_handle_t bplib_route_get_next_avail_intf(const bplib_routetbl_t *tbl, bp_ipn_t dest)
-{
-    return bplib_route_get_next_intf_with_flags(tbl, dest, BPLIB_INTF_AVAILABLE_FLAGS, BPLIB_INTF_AVAILABLE_FLAGS);
+        tbl->next_poll_time = next_poll_time;
+    }
+    bplib_route_activity_unlock(tbl);
 }
 
-int bplib_route_push_ingress_bundle(const bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *cb)
+/*
+ * The time a contact is announced, never before time 0 and never after its start
+ */
+static inline uint64_t bplib_route_contact_announce_time(const bplib_route_contact_t *contact)
 {
-    bplib_mpool_flow_t *flow;
-    int                 status;
-
-    status = -1;
-    flow   = bplip_route_lookup_intf(tbl, intf_id);
-    if (flow != NULL && bplib_mpool_flow_try_push(&flow->ingress, cb, 0))
+    if (contact->start_time < contact->lead_time)
     {
-        status = 0;
+        return 0;
     }
 
-    return status;
+    return contact->start_time - contact->lead_time;
 }
 
-int bplib_route_push_egress_bundle(const bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *cb)
+/*
+ * Brings the time of the next poll of every flow that asked for contact events forward to the
+ * given time, if it is later than that.  Called with the activity lock held.
+ */
+static void bplib_route_contact_poll_flows(bplib_routetbl_t *tbl, uint64_t poll_time)
 {
-    bplib_mpool_flow_t *flow;
-    int                 status;
+    bplib_mpool_flow_t     *flow;
+    bplib_mpool_list_iter_t iter;
+    int                     status;
 
-    status = -1;
-    flow   = bplip_route_lookup_intf(tbl, intf_id);
-    if (flow != NULL && bplib_mpool_flow_try_push(&flow->egress, cb, 0))
+    status = bplib_mpool_list_iter_goto_first(&tbl->flow_list, &iter);
+    while (status == BP_SUCCESS)
     {
-        status = 0;
+        flow = bplib_mpool_flow_cast(iter.position);
+        if (flow != NULL && poll_time < flow->poll_time &&
+            ((flow->pending_state_flags | flow->current_state_flags) & BPLIB_MPOOL_FLOW_FLAGS_CONTACTS) != 0)
+        {
+            bplib_route_poll_schedule(tbl, flow, poll_time);
+        }
+        status = bplib_mpool_list_iter_forward(&iter);
     }
 
-    return status;
+    if (poll_time < tbl->next_poll_time)
+    {
+        tbl->next_poll_time = poll_time;
+    }
 }
 
-int bplib_route_add(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id)
+int bplib_route_contact_add(bplib_routetbl_t *tbl, const bplib_route_contact_t *contact)
 {
-    uint32_t            pos;
-    uint32_t            insert_pos;
-    bplib_routeentry_t *rp;
+    bplib_route_contactslot_t *slot;
+    uint32_t                   i;
 
-    if (tbl->registered_routes >= tbl->max_routes)
+    /* Mask check, same as for bplib_route_add_ext() */
+    if (((~contact->mask + 1) & (~contact->mask)) != 0 || contact->end_time <= contact->start_time)
     {
         return -1;
     }
 
-    /* Mask check: should have MSB's set, no gaps */
-    if (((~mask + 1) & (~mask)) != 0)
-    {
-        return -1;
-    }
+    bplib_os_lock(tbl->contact_lock);
 
-    /* Find the position, the sequence should go from most specific to least specific mask */
-    insert_pos = 0;
-    for (pos = 0; pos < tbl->registered_routes; ++pos)
+    slot = NULL;
+    for (i = 0; i < BPLIB_ROUTE_MAX_CONTACTS; ++i)
     {
-        rp = &tbl->route_tbl[pos];
-        if (rp->mask == mask && rp->dest == dest && bp_handle_equal(rp->intf_id, intf_id))
+        if (!tbl->contacts[i].in_use)
         {
+            slot = &tbl->contacts[i];
             break;
         }
-        if ((rp->mask & mask) == mask)
-        {
-            ++insert_pos; /* must come (at least) after this route */
-        }
     }
 
-    if (pos < tbl->registered_routes)
+    if (slot != NULL)
     {
-        /* duplicate route */
-        return -1;
-    }
+        slot->contact = *contact;
+        slot->in_use  = true;
+        slot->active  = false;
 
-    /* If necessary, shift entries back to make a gap.
-     * This is somewhat expensive, but route add/remove probably does not
-     * happen that often */
-    rp = &tbl->route_tbl[insert_pos];
-    if (insert_pos < tbl->registered_routes)
-    {
-        memmove(&rp[1], &rp[0], sizeof(*rp) * (tbl->registered_routes - insert_pos));
+        /* the announcement is left to the flows, the route table itself only needs to wake for the start */
+        bplib_route_activity_lock(tbl);
+        if (contact->start_time < tbl->next_contact_time)
+        {
+            tbl->next_contact_time = contact->start_time;
+        }
+        bplib_route_contact_poll_flows(tbl, bplib_route_contact_announce_time(contact));
+        bplib_os_broadcast_signal(tbl->activity_lock);
+        bplib_route_activity_unlock(tbl);
     }
 
-    rp->dest    = dest;
-    rp->mask    = mask;
-    rp->intf_id = intf_id;
+    bplib_os_unlock(tbl->contact_lock);
 
-    ++tbl->registered_routes;
+    if (slot == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): contact plan is full\n", __func__);
+        return -1;
+    }
 
     return 0;
 }
 
-int bplib_route_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id)
+int bplib_route_contact_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id,
+                            uint64_t start_time)
 {
-    uint32_t            pos;
-    bplib_routeentry_t *rp;
+    bplib_route_contactslot_t *slot;
+    uint32_t                   i;
+    int                        status;
 
-    if (tbl->registered_routes == 0)
-    {
-        return -1;
-    }
+    status = -1;
 
-    /* Find the position, the sequence should go from most specific to least specific */
-    for (pos = 0; pos < tbl->registered_routes; ++pos)
+    bplib_os_lock(tbl->contact_lock);
+    for (i = 0; i < BPLIB_ROUTE_MAX_CONTACTS; ++i)
     {
-        rp = &tbl->route_tbl[pos];
-        if (rp->mask == mask && rp->dest == dest && bp_handle_equal(rp->intf_id, intf_id))
+        slot = &tbl->contacts[i];
+        if (slot->in_use && slot->contact.dest == dest && slot->contact.mask == mask &&
+            bp_handle_equal(slot->contact.intf_id, intf_id) && slot->contact.start_time == start_time)
         {
+            /* a contact in progress is ended now */
+            if (slot->active)
+            {
+                bplib_route_del(tbl, dest, mask, intf_id);
+            }
+            slot->in_use = false;
+            slot->active = false;
+            status       = 0;
             break;
         }
     }
+    bplib_os_unlock(tbl->contact_lock);
 
-    if (pos >= tbl->registered_routes)
-    {
-        /* route not found */
-        return -1;
-    }
+    /* the next wakeup of the route table may now be for nothing, which is sorted out when it is reached */
+    return status;
+}
 
-    --tbl->registered_routes;
+int bplib_route_contact_lookup(bplib_routetbl_t *tbl, bp_ipn_t dest, uint64_t dtntime, bplib_route_contact_t *contact)
+{
+    const bplib_route_contactslot_t *slot;
+    uint32_t                         i;
+    int                              status;
 
-    /* If this was in the middle, close the gap */
-    rp = &tbl->route_tbl[pos];
-    if (pos < tbl->registered_routes)
+    status = -1;
+
+    bplib_os_lock(tbl->contact_lock);
+    for (i = 0; i < BPLIB_ROUTE_MAX_CONTACTS; ++i)
     {
-        memmove(&rp[0], &rp[1], sizeof(*rp) * (tbl->registered_routes - pos));
+        slot = &tbl->contacts[i];
+        if (slot->in_use && (dest & slot->contact.mask) == (slot->contact.dest & slot->contact.mask) &&
+            slot->contact.start_time <= dtntime && dtntime < slot->contact.end_time)
+        {
+            *contact = slot->contact;
+            status   = 0;
+            break;
+        }
     }
+    bplib_os_unlock(tbl->contact_lock);
 
-    return 0;
+    return status;
 }
 
-int bplib_route_intf_set_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint32_t flags)
+uint64_t bplib_route_contact_scan(bplib_routetbl_t *tbl, uint64_t after_time, uint64_t until_time,
+                                  bplib_route_contact_func_t func, void *arg)
 {
-    bplib_mpool_ref_t flow_ref;
-
-    flow_ref = bplib_route_get_intf_controlblock(tbl, intf_id);
-    if (flow_ref != NULL)
+    bplib_route_contact_t            due[BPLIB_ROUTE_MAX_CONTACTS];
+    bool                             due_start[BPLIB_ROUTE_MAX_CONTACTS];
+    const bplib_route_contactslot_t *slot;
+    uint64_t                         announce_time;
+    uint64_t                         next_time;
+    uint32_t                         num_due;
+    uint32_t                         i;
+
+    /* the contacts are copied out, so the callback is made without the lock */
+    next_time = BP_DTNTIME_INFINITE;
+    num_due   = 0;
+
+    bplib_os_lock(tbl->contact_lock);
+    for (i = 0; i < BPLIB_ROUTE_MAX_CONTACTS; ++i)
     {
-        if (bplib_mpool_flow_modify_flags(bplib_mpool_dereference(flow_ref), flags, 0))
+        slot = &tbl->contacts[i];
+        if (!slot->in_use || slot->contact.end_time <= until_time)
         {
-            bplib_route_set_maintenance_request(tbl);
+            continue;
         }
-    }
-    bplib_route_release_intf_controlblock(tbl, flow_ref);
 
-    return 0;
-}
+        /* with no lead time there is no separate announcement, only the start */
+        announce_time = bplib_route_contact_announce_time(&slot->contact);
+        if (announce_time > until_time && announce_time < slot->contact.start_time)
+        {
+            if (announce_time < next_time)
+            {
+                next_time = announce_time;
+            }
+        }
+        else if (announce_time > after_time && announce_time < slot->contact.start_time &&
+                 slot->contact.start_time > until_time)
+        {
+            due[num_due]       = slot->contact;
+            due_start[num_due] = false;
+            ++num_due;
+        }
 
-int bplib_route_intf_unset_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint32_t flags)
-{
-    bplib_mpool_ref_t flow_ref;
+        if (slot->contact.start_time > until_time)
+        {
+            if (slot->contact.start_time < next_time)
+            {
+                next_time = slot->contact.start_time;
+            }
+        }
+        else if (slot->contact.start_time > after_time)
+        {
+            due[num_due]       = slot->contact;
+            due_start[num_due] = true;
+            ++num_due;
+        }
+    }
+    bplib_os_unlock(tbl->contact_lock);
 
-    flow_ref = bplib_route_get_intf_controlblock(tbl, intf_id);
-    if (flow_ref != NULL)
+    if (func != NULL)
     {
-        if (bplib_mpool_flow_modify_flags(bplib_mpool_dereference(flow_ref), 0, flags))
+        for (i = 0; i < num_due; ++i)
         {
-            bplib_route_set_maintenance_request(tbl);
+            func(arg, &due[i], due_start[i]);
         }
     }
-    bplib_route_release_intf_controlblock(tbl, flow_ref);
 
-    return 0;
+    return next_time;
 }
 
-void bplib_route_do_timed_poll(bplib_routetbl_t *tbl)
+void bplib_route_do_contact_plan(bplib_routetbl_t *tbl)
 {
-    uint64_t                current_time;
-    uint64_t                poll_time;
-    uint32_t                set_flags;
-    uint32_t                clear_flags;
-    bool                    poll_cycle;
-    bplib_mpool_list_iter_t iter;
-    int                     status;
+    bplib_route_contactslot_t *slot;
+    uint64_t                   current_time;
+    uint64_t                   next_time;
+    uint32_t                   i;
+    bool                       is_due;
 
-    current_time = bplib_os_get_dtntime_ms();
-    set_flags    = 0;
-    clear_flags  = 0;
+    current_time = bplib_os_get_dtntime_coarse_ms();
 
-    /* because the time is a 64-bit value and may not be atomic, it should
-     * be sampled and updated inside of a lock section to ensure the value
-     * is consistent */
-    bplib_os_lock(tbl->activity_lock);
-    poll_time = tbl->last_intf_poll + BPLIB_INTF_MIN_POLL_INTERVAL;
-    if (current_time >= poll_time)
+    bplib_route_activity_lock(tbl);
+    is_due = (current_time >= tbl->next_contact_time);
+    bplib_route_activity_unlock(tbl);
+
+    if (!is_due)
     {
-        tbl->last_intf_poll = poll_time;
-        ++tbl->poll_count;
-        poll_cycle = (tbl->poll_count & 1);
+        return;
+    }
+
+    /* this is held while the routes are changed, so a contact being deleted cannot leave its route behind */
+    bplib_os_lock(tbl->contact_lock);
 
-        if (poll_cycle)
+    next_time = BP_DTNTIME_INFINITE;
+    for (i = 0; i < BPLIB_ROUTE_MAX_CONTACTS; ++i)
+    {
+        slot = &tbl->contacts[i];
+        if (!slot->in_use)
         {
-            set_flags = BPLIB_MPOOL_FLOW_FLAGS_POLL;
+            continue;
         }
-        else
+
+        if (!slot->active && current_time >= slot->contact.start_time && current_time < slot->contact.end_time)
         {
-            clear_flags = BPLIB_MPOOL_FLOW_FLAGS_POLL;
+            if (bplib_route_add(tbl, slot->contact.dest, slot->contact.mask, slot->contact.intf_id) == 0)
+            {
+                slot->active = true;
+            }
+            else
+            {
+                /* most likely the table is full or the same route is already there, the contact still runs */
+                bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s(): cannot add route for contact to ipn:%lu\n", __func__,
+                      (unsigned long)slot->contact.dest);
+            }
         }
 
-        status = bplib_mpool_list_iter_goto_first(&tbl->flow_list, &iter);
-        while (status == BP_SUCCESS)
+        if (current_time >= slot->contact.end_time)
         {
-            /* NOTE: this will end up taking the pool lock as well, when it schedules the
-             * state change for processing.  This means this task will have two locks at
-             * once (the tbl activity lock and the pool resource lock).  As long as the locks
-             * are always taken in that order (and not the other way around) this should be OK
-             * for now, but it needs to be ensured that locks are never taken in the opposite
-             * order. */
-            bplib_mpool_flow_modify_flags(iter.position, set_flags, clear_flags);
-            status = bplib_mpool_list_iter_forward(&iter);
+            if (slot->active)
+            {
+                bplib_route_del(tbl, slot->contact.dest, slot->contact.mask, slot->contact.intf_id);
+            }
+            slot->in_use = false;
+            slot->active = false;
+        }
+        else if (current_time < slot->contact.start_time)
+        {
+            if (slot->contact.start_time < next_time)
+            {
+                next_time = slot->contact.start_time;
+            }
+        }
+        else if (slot->contact.end_time < next_time)
+        {
+            next_time = slot->contact.end_time;
         }
     }
-    bplib_os_unlock(tbl->activity_lock);
+
+    bplib_route_activity_lock(tbl);
+    tbl->next_contact_time = next_time;
+    bplib_route_activity_unlock(tbl);
+
+    bplib_os_unlock(tbl->contact_lock);
 }
 
 void bplib_route_set_maintenance_request(bplib_routetbl_t *tbl)
 {
     tbl->maint_request_flag = true;
+    ++tbl->maint_request_count;
     bplib_os_broadcast_signal(tbl->activity_lock);
 }
 
 void bplib_route_maintenance_request_wait(bplib_routetbl_t *tbl)
 {
+    uint64_t idle_time;
     uint64_t poll_time;
 
-    bplib_os_lock(tbl->activity_lock);
+    bplib_route_activity_lock(tbl);
 
     /* because the time is a 64-bit value and may not be atomic, it should
      * be sampled and updated inside of a lock section to ensure the value
-     * is consistent */
-    poll_time = tbl->last_intf_poll + BPLIB_INTF_MIN_POLL_INTERVAL;
-
-    while (!tbl->maint_request_flag && bplib_os_get_dtntime_ms() < poll_time)
+     * is consistent.  It is sampled again on every wakeup, as an interface
+     * may have registered an earlier deadline in the meantime. */
+    idle_time = bplib_os_get_dtntime_coarse_ms() + BPLIB_ROUTE_IDLE_MAINT_INTERVAL;
+    while (true)
     {
-        bplib_os_wait_until_ms(tbl->activity_lock, poll_time);
+        poll_time = tbl->next_poll_time;
+        if (poll_time > tbl->next_contact_time)
+        {
+            poll_time = tbl->next_contact_time;
+        }
+        if (poll_time > idle_time)
+        {
+            poll_time = idle_time;
+        }
+
+        if (tbl->maint_request_flag || bplib_os_get_dtntime_coarse_ms() >= poll_time)
+        {
+            break;
+        }
+
+        bplib_route_activity_wait(tbl, poll_time);
     }
 
     tbl->maint_request_flag = false;
     tbl->maint_active_flag  = true;
 
-    bplib_os_unlock(tbl->activity_lock);
+    bplib_route_activity_unlock(tbl);
 }
 
 void bplib_route_maintenance_complete_wait(bplib_routetbl_t *tbl)
 {
-    bplib_os_lock(tbl->activity_lock);
+    bplib_route_activity_lock(tbl);
 
     while (tbl->maint_request_flag || tbl->maint_active_flag)
     {
-        bplib_os_wait_until_ms(tbl->activity_lock, BP_DTNTIME_INFINITE);
+        bplib_route_activity_wait(tbl, BP_DTNTIME_INFINITE);
     }
 
-    bplib_os_unlock(tbl->activity_lock);
+    bplib_route_activity_unlock(tbl);
+}
+
+void bplib_route_wait_until(bplib_routetbl_t *tbl, uint64_t until_dtntime)
+{
+    /* the activity lock is only used as a timer here, any wakeup sent on it is just ignored */
+    bplib_route_activity_lock(tbl);
+    while (bplib_os_get_dtntime_coarse_ms() < until_dtntime)
+    {
+        if (bplib_route_activity_wait(tbl, until_dtntime) != BP_SUCCESS)
+        {
+            break;
+        }
+    }
+    bplib_route_activity_unlock(tbl);
+}
+
+static void bplib_route_read_metric(bplib_routetbl_t *tbl, bplib_mpool_block_t *flow_block, uint32_t idx,
+                                    bplib_metric_t *metric)
+{
+    switch (idx)
+    {
+        case 0:
+            metric->value = tbl->routing_success_count;
+            break;
+        case 1:
+            metric->value = tbl->routing_error_count;
+            break;
+        default:
+            metric->value = tbl->route_sets[tbl->route_set_idx].registered_routes;
+            break;
+    }
+}
+
+static void bplib_route_collect_group(bplib_routetbl_t *tbl, bplib_mpool_block_t *flow_block,
+                                      const bplib_metric_group_t *group, bplib_metric_t *metrics,
+                                      uint32_t max_metrics, uint32_t *count)
+{
+    bplib_metric_t *metric;
+    uint32_t        i;
+
+    for (i = 0; i < group->num_descs; ++i)
+    {
+        /* the rest are still counted, so the caller knows how many there would have been */
+        if (*count < max_metrics)
+        {
+            metric = &metrics[*count];
+            memset(metric, 0, sizeof(*metric));
+            metric->desc    = &group->descs[i];
+            metric->intf_id = BP_INVALID_HANDLE;
+            if (flow_block != NULL)
+            {
+                metric->intf_id = bplib_mpool_get_external_id(flow_block);
+            }
+            group->read(tbl, flow_block, i, metric);
+        }
+        ++(*count);
+    }
+}
+
+/*
+ * Fills in the table metrics of the groups without a match function, then the intf metrics of the
+ * others for each intf that matches.  Returns the number there are, even if more than max_metrics.
+ */
+uint32_t bplib_route_collect_metrics(bplib_routetbl_t *tbl, const bplib_metric_group_t *const *groups,
+                                     uint32_t num_groups, bplib_metric_t *metrics, uint32_t max_metrics)
+{
+    bplib_mpool_list_iter_t iter;
+    uint32_t                count;
+    uint32_t                g;
+    int                     status;
+
+    count = 0;
+    for (g = 0; g < num_groups; ++g)
+    {
+        if (groups[g]->match == NULL)
+        {
+            bplib_route_collect_group(tbl, NULL, groups[g], metrics, max_metrics, &count);
+        }
+    }
+
+    /* the lock keeps intfs from going away while they are read, the same as for the timed poll */
+    bplib_route_activity_lock(tbl);
+    status = bplib_mpool_list_iter_goto_first(&tbl->flow_list, &iter);
+    while (status == BP_SUCCESS)
+    {
+        for (g = 0; g < num_groups; ++g)
+        {
+            if (groups[g]->match != NULL && groups[g]->match(iter.position))
+            {
+                bplib_route_collect_group(tbl, iter.position, groups[g], metrics, max_metrics, &count);
+            }
+        }
+        status = bplib_mpool_list_iter_forward(&iter);
+    }
+    bplib_route_activity_unlock(tbl);
+
+    return count;
 }
 
 void bplib_route_process_active_flows(bplib_routetbl_t *tbl)
@@ -719,8 +2337,31 @@ void bplib_route_process_active_flows(bplib_routetbl_t *tbl)
     bplib_mpool_job_run_all(tbl->pool, tbl);
 }
 
+void bplib_route_worker_process_flows(bplib_routetbl_t *tbl, uint32_t timeout_ms)
+{
+    uint64_t wait_limit;
+    uint32_t request_count;
+
+    /* this waits for the same requests as the maintenance thread, but does not clear them, so
+     * any number of workers can wake up along with it and share the active flows between them */
+    wait_limit = bplib_os_get_dtntime_ms() + timeout_ms;
+
+    bplib_route_activity_lock(tbl);
+    request_count = tbl->maint_request_count;
+    while (request_count == tbl->maint_request_count && bplib_os_get_dtntime_coarse_ms() < wait_limit)
+    {
+        bplib_route_activity_wait(tbl, wait_limit);
+    }
+    bplib_route_activity_unlock(tbl);
+
+    bplib_route_process_active_flows(tbl);
+}
+
 void bplib_route_periodic_maintenance(bplib_routetbl_t *tbl)
 {
+    /* routes of the contact plan go in and out first, so a poll at the start of a contact already sees the route */
+    bplib_route_do_contact_plan(tbl);
+
     /* execute time-based interface polling for intfs that require it */
     bplib_route_do_timed_poll(tbl);
 
@@ -730,7 +2371,23 @@ void bplib_route_periodic_maintenance(bplib_routetbl_t *tbl)
     /* do general pool garbage collection to make sure it was done at least once */
     bplib_mpool_maintain(tbl->pool);
 
-    bplib_os_lock(tbl->activity_lock);
+    /* and look at a few more blocks of the pool, which is done last so that it sees the pool after collection */
+    if (tbl->pool_inspect_budget != 0)
+    {
+        bplib_mpool_inspect_step(tbl->pool, &tbl->pool_inspector, tbl->pool_inspect_budget);
+    }
+
+    bplib_route_activity_lock(tbl);
     tbl->maint_active_flag = false;
-    bplib_os_broadcast_signal_and_unlock(tbl->activity_lock);
+    bplib_route_activity_signal_and_unlock(tbl);
+}
+
+void bplib_route_set_pool_inspect_budget(bplib_routetbl_t *tbl, uint32_t blocks_per_cycle)
+{
+    tbl->pool_inspect_budget = blocks_per_cycle;
+}
+
+void bplib_route_get_pool_inspection(bplib_routetbl_t *tbl, bplib_mpool_inspection_t *result)
+{
+    bplib_mpool_inspect_get(tbl->pool, &tbl->pool_inspector, result);
 }
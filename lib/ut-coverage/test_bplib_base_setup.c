@@ -52,20 +52,6 @@ void UT_lib_egress_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey
     }
 }
 
-void UT_lib_baseintf_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
-{
-    void *retval = NULL;
-    int   count  = UT_GetStubCount(UT_KEY(bplib_mpool_flow_try_pull));
-    if (count > 25)
-    {
-        UT_Stub_SetReturnValue(FuncKey, retval);
-    }
-    else
-    {
-        UT_Stub_SetReturnValue(FuncKey, UserObj);
-    }
-}
-
 void UT_lib_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
 {
     UT_Stub_SetReturnValue(FuncKey, UserObj);
@@ -101,6 +87,23 @@ void UT_lib_bool_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubCont
     UT_Stub_SetReturnValue(FuncKey, retval);
 }
 
+/*
+ * Gives a table that was not made by bplib_route_alloc_table() its pair of route sets,
+ * the entries must have room for max_routes in each set.  This returns the current set.
+ */
+bplib_routeset_t *UT_lib_SetupRouteSets(bplib_routetbl_t *tbl, bplib_routeset_t sets[2], bplib_routeentry_t *entries,
+                                        uint32_t max_routes)
+{
+    memset(sets, 0, sizeof(bplib_routeset_t) * 2);
+    sets[0].route_tbl  = entries;
+    sets[1].route_tbl  = entries + max_routes;
+    tbl->route_sets    = sets;
+    tbl->route_set_idx = 0;
+    tbl->max_routes    = max_routes;
+
+    return &sets[0];
+}
+
 void UtTest_Setup(void)
 {
     TestBplibBase_Register();
@@ -26,9 +26,11 @@
 #include "uttest.h"
 #include "bplib.h"
 #include "bplib_file_offload.h"
+#include "bplib_packed_offload.h"
 #include "test_bplib_base.h"
 
-const bplib_cache_module_api_t *BPLIB_FILE_OFFLOAD_API = NULL;
+const bplib_cache_module_api_t *BPLIB_FILE_OFFLOAD_API   = NULL;
+const bplib_cache_module_api_t *BPLIB_PACKED_OFFLOAD_API = NULL;
 
 void test_bplib_init(void)
 {
@@ -57,6 +59,19 @@ void test_bplib_create_ram_storage(void)
     memset(&storage_addr, 0, sizeof(bp_ipn_addr_t));
 
     UtAssert_UINT32_EQ(bplib_create_ram_storage(rtbl, &storage_addr).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_cache_register_module_service, 0);
+
+    /* the packed module is registered, and the cache is only started if that worked */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_cache_attach), 0x1);
+    UtAssert_UINT32_GT(bplib_create_ram_storage(rtbl, &storage_addr).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_cache_register_module_service, 1);
+    UtAssert_STUB_COUNT(bplib_cache_start, 0);
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_cache_register_module_service), 0x1);
+    UtAssert_UINT32_GT(bplib_create_ram_storage(rtbl, &storage_addr).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_cache_start, 1);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_cache_register_module_service), 0);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_cache_attach), 0);
 }
 
 void test_bplib_create_file_storage(void)
@@ -81,12 +96,16 @@ void test_bplib_create_node_intf(void)
      * bp_handle_t bplib_create_node_intf(bplib_routetbl_t *rtbl, bp_ipn_t node_num)
      */
     bplib_routetbl_t    rtbl;
+    bplib_routeset_t    route_sets[2];
+    bplib_routeentry_t  route_entry[2];
     bp_ipn_t            node_num = 101;
     bplib_mpool_block_t sblk;
     bplib_mpool_ref_t   flow_ref;
     bplib_mpool_flow_t  flow;
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 1);
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
     memset(&flow_ref, 0, sizeof(bplib_mpool_ref_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
@@ -100,6 +119,7 @@ void test_bplib_create_node_intf(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_block_from_external_id), UT_lib_AltHandler_PointerReturn, NULL);
     UtAssert_UINT32_GT(bplib_create_node_intf(&rtbl, node_num).hdl, 0);
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 1);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
@@ -167,6 +187,67 @@ void test_bplib_ipn2eid(void)
     UtAssert_UINT32_EQ(bplib_ipn2eid(eid, len, node, service), 0);
 }
 
+void test_bplib_eid2ipn_n(void)
+{
+    /* Test function for:
+     * size_t bplib_eid2ipn_n(const char *const *eids, bp_ipn_t *nodes, bp_ipn_t *services, size_t count)
+     */
+    const char *eids[] = {"ipn:101.11", "ipn:0.0", "ipn:18446744073709551615.1", "ipn:7.3x", "ipn:1.2"};
+    const char *bad[]  = {"ipn:18446744073709551616.1", "ipn:.1", "ipn:1", "ipn:1.", "dtn:1.1", NULL};
+    bp_ipn_t    nodes[5];
+    bp_ipn_t    services[5];
+    size_t      i;
+
+    memset(nodes, 0xEE, sizeof(nodes));
+    memset(services, 0xEE, sizeof(services));
+
+    /* stops at the one with extra chars after the service number */
+    UtAssert_UINT32_EQ(bplib_eid2ipn_n(eids, nodes, services, 5), 3);
+    UtAssert_STUB_COUNT(bplib_os_log, 1);
+    UtAssert_UINT32_EQ(nodes[0], 101);
+    UtAssert_UINT32_EQ(services[0], 11);
+    UtAssert_UINT32_EQ(nodes[1], 0);
+    UtAssert_UINT32_EQ(services[1], 0);
+    UtAssert_True(nodes[2] == (bp_ipn_t)-1, "largest node number");
+    UtAssert_UINT32_EQ(services[2], 1);
+
+    UtAssert_UINT32_EQ(bplib_eid2ipn_n(&eids[4], nodes, services, 1), 1);
+    UtAssert_UINT32_EQ(nodes[0], 1);
+    UtAssert_UINT32_EQ(services[0], 2);
+    UtAssert_UINT32_EQ(bplib_eid2ipn_n(eids, nodes, services, 0), 0);
+
+    for (i = 0; i < (sizeof(bad) / sizeof(bad[0])); ++i)
+    {
+        UtAssert_UINT32_EQ(bplib_eid2ipn_n(&bad[i], nodes, services, 1), 0);
+    }
+    UtAssert_STUB_COUNT(bplib_os_log, 7);
+}
+
+void test_bplib_ipn2eid_n(void)
+{
+    /* Test function for:
+     * size_t bplib_ipn2eid_n(char *eids, size_t eid_size, const bp_ipn_t *nodes, const bp_ipn_t *services,
+     * size_t count)
+     */
+    char     eids[3][48];
+    bp_ipn_t nodes[3]    = {4, 72, (bp_ipn_t)-1};
+    bp_ipn_t services[3] = {3, 1024, 99};
+
+    memset(eids, 0xEE, sizeof(eids));
+    UtAssert_UINT32_EQ(bplib_ipn2eid_n(&eids[0][0], sizeof(eids[0]), nodes, services, 3), 3);
+    UtAssert_STRINGBUF_EQ(eids[0], sizeof(eids[0]), "ipn:4.3", UTASSERT_STRINGBUF_NULL_TERM);
+    UtAssert_STRINGBUF_EQ(eids[1], sizeof(eids[1]), "ipn:72.1024", UTASSERT_STRINGBUF_NULL_TERM);
+    UtAssert_STRINGBUF_EQ(eids[2], sizeof(eids[2]), "ipn:18446744073709551615.99", UTASSERT_STRINGBUF_NULL_TERM);
+
+    /* cut short to fit, like snprintf */
+    UtAssert_UINT32_EQ(bplib_ipn2eid_n(&eids[0][0], 8, &nodes[1], &services[1], 1), 1);
+    UtAssert_STRINGBUF_EQ(eids[0], sizeof(eids[0]), "ipn:72.", UTASSERT_STRINGBUF_NULL_TERM);
+
+    UtAssert_UINT32_EQ(bplib_ipn2eid_n(&eids[0][0], 6, nodes, services, 3), 0);
+    UtAssert_UINT32_EQ(bplib_ipn2eid_n(&eids[0][0], BP_MAX_EID_STRING + 1, nodes, services, 3), 0);
+    UtAssert_STUB_COUNT(bplib_os_log, 2);
+}
+
 void test_bplib_query_integer(void)
 {
     /* Test function for:
@@ -181,9 +262,33 @@ void test_bplib_query_integer(void)
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_mem_current_use), UT_lib_sizet_Handler, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_mem_max_use), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_collect_backlog), UT_lib_sizet_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_current_use, &value), 0);
     UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_high_use, &value), 0);
-    UtAssert_UINT32_GT(bplib_query_integer(&rtbl, intf_id, 5, &value), 0);
+    UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_collect_backlog, &value), 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_stat), UT_lib_sizet_Handler, NULL);
+    UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_alloc_refused, &value), 0);
+    UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_lock_wait_long, &value), 0);
+    UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cache_wait_100us, &value), 0);
+    UtAssert_UINT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_service_run_long, &value), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_query_stat, 4);
+
+    /* interface variables, which need a valid CLA intf */
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_burst, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_frame_mtu, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_frame_wait, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_ingress_bytes, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_drop_no_route, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_queue_long, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_bps, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_quota_limit, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_quota_over, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_reserve_blocks, &value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_query_integer(&rtbl, intf_id, bplib_variable_mem_reserve_used, &value), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_query_stat, 4);
+    UtAssert_UINT32_GT(bplib_query_integer(&rtbl, intf_id, bplib_variable_none, &value), 0);
+    UtAssert_UINT32_GT(bplib_query_integer(&rtbl, intf_id, bplib_variable_max, &value), 0);
 }
 
 void test_bplib_config_integer(void)
@@ -192,6 +297,7 @@ void test_bplib_config_integer(void)
      * int bplib_config_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t value)
      */
     bplib_routetbl_t *rtbl = NULL;
+    bplib_routetbl_t  tbl;
     bp_handle_t       intf_id;
 
     memset(&intf_id, 0, sizeof(bp_handle_t));
@@ -199,6 +305,64 @@ void test_bplib_config_integer(void)
     bplib_variable_t var_id = bplib_variable_mem_current_use;
     bp_sval_t        value  = 10;
     UtAssert_VOIDCALL(bplib_config_integer(rtbl, intf_id, var_id, value));
+
+    /* interface variables, which need a valid CLA intf */
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_cla_egress_rate, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_cla_egress_burst, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_cla_frame_mtu, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_cla_frame_wait, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_mem_quota_limit, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_mem_quota_refuse, -1), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_mem_reserve_blocks, value), BP_ERROR);
+
+    /* the interface statistics are read only */
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_cla_ingress_bytes, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_mem_quota_used, value), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_config_integer(&tbl, intf_id, bplib_variable_mem_reserve_used, value), BP_ERROR);
+}
+
+void test_bplib_metrics_snapshot(void)
+{
+    /* Test function for:
+     * int bplib_metrics_snapshot(bplib_routetbl_t *rtbl, bplib_metric_t *metrics, uint32_t max_metrics,
+     *                            uint32_t *num_metrics)
+     */
+    bplib_routetbl_t   rtbl;
+    bplib_routeset_t   sets[2];
+    bplib_routeentry_t entries[2];
+    bplib_routeset_t  *set;
+    bplib_metric_t     metrics[32];
+    uint32_t           num_metrics;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    set                        = UT_lib_SetupRouteSets(&rtbl, sets, entries, 2);
+    set->registered_routes     = 2;
+    rtbl.routing_success_count = 7;
+    rtbl.routing_error_count   = 1;
+
+    /* no intfs, so there are only the pool and route table metrics */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_goto_first), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_mem_current_use), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_mem_max_use), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_collect_backlog), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_query_stat), UT_lib_sizet_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_metrics_snapshot(&rtbl, metrics, 32, &num_metrics), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_metrics, 30);
+    UtAssert_STRINGBUF_EQ(metrics[0].desc->name, UTASSERT_STRINGBUF_NULL_TERM, "mem_current_use",
+                          UTASSERT_STRINGBUF_NULL_TERM);
+    UtAssert_True(!bp_handle_is_valid(metrics[0].intf_id), "table metrics have no intf");
+    UtAssert_UINT32_EQ(metrics[20].desc->type, bplib_metric_type_histogram);
+    UtAssert_UINT32_EQ(metrics[20].desc->num_bins, 5);
+    UtAssert_STRINGBUF_EQ(metrics[27].desc->name, UTASSERT_STRINGBUF_NULL_TERM, "route_success",
+                          UTASSERT_STRINGBUF_NULL_TERM);
+    UtAssert_INT32_EQ(metrics[27].value, 7);
+    UtAssert_INT32_EQ(metrics[28].value, 1);
+    UtAssert_INT32_EQ(metrics[29].value, 2);
+
+    /* the ones that do not fit are still counted */
+    UtAssert_INT32_EQ(bplib_metrics_snapshot(&rtbl, metrics, 10, &num_metrics), BP_ERROR);
+    UtAssert_UINT32_EQ(num_metrics, 30);
 }
 
 void TestBplibBase_Register(void)
@@ -211,6 +375,9 @@ void TestBplibBase_Register(void)
     UtTest_Add(test_bplib_display, NULL, NULL, "Test bplib_display");
     UtTest_Add(test_bplib_eid2ipn, NULL, NULL, "Test bplib_eid2ipn");
     UtTest_Add(test_bplib_ipn2eid, NULL, NULL, "Test bplib_ipn2eid");
+    UtTest_Add(test_bplib_eid2ipn_n, NULL, NULL, "Test bplib_eid2ipn_n");
+    UtTest_Add(test_bplib_ipn2eid_n, NULL, NULL, "Test bplib_ipn2eid_n");
     UtTest_Add(test_bplib_query_integer, NULL, NULL, "Test bplib_query_integer");
     UtTest_Add(test_bplib_config_integer, NULL, NULL, "Test bplib_config_integer");
+    UtTest_Add(test_bplib_metrics_snapshot, NULL, NULL, "Test bplib_metrics_snapshot");
 }
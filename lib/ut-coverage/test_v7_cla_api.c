@@ -24,6 +24,94 @@
 #include "uttest.h"
 #include "test_bplib_base.h"
 
+static void UT_lib_cla_AltHandler_PullBatch(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *list = UT_Hook_GetArgValueByName(Context, "list", bplib_mpool_block_t *);
+    int32                StatusCode;
+    uint32_t             retval;
+
+    /* the list is not really changed by the extract stub, so every pull gives the same block */
+    UT_Stub_GetInt32StatusCode(Context, &StatusCode);
+    retval = StatusCode;
+    if (retval != 0)
+    {
+        list->next = UserObj;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_cla_AltHandler_SizeSequence(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    const size_t *sizes = UserObj;
+    size_t        retval;
+
+    /* the list of sizes is one per call, and must be long enough */
+    retval = sizes[UT_GetStubCount(FuncKey) - 1];
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_cla_AltHandler_CanonicalCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *cb = UT_Hook_GetArgValueByName(Context, "cb", bplib_mpool_block_t *);
+    void                *retval;
+
+    /* the end of a canonical block list is not a canonical block */
+    retval = UserObj;
+    if (cb == NULL || cb->type == bplib_mpool_blocktype_list_head)
+    {
+        retval = NULL;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_cla_AltHandler_ExportLength(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    size_t retval = UT_Hook_GetArgValueByName(Context, "max_out_size", size_t);
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_cla_AltHandler_CreateLock(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bp_handle_t retval = BPLIB_HANDLE_OS_BASE;
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+typedef struct UT_lib_cla_datacast
+{
+    uint32_t magic_number;
+    void    *ptr;
+} UT_lib_cla_datacast_t;
+
+static void UT_lib_cla_AltHandler_DataCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    const UT_lib_cla_datacast_t *map          = UserObj;
+    uint32_t                     magic_number = UT_Hook_GetArgValueByName(Context, "required_magic", uint32_t);
+    void                        *retval;
+
+    /* the list ends with a NULL pointer, which is also what an unknown type gets */
+    while (map->ptr != NULL && map->magic_number != magic_number)
+    {
+        ++map;
+    }
+
+    retval = map->ptr;
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_cla_Handler_ImportFlags(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    uint32_t *import_flags = UserObj;
+    size_t    retval       = 0;
+
+    /* records what the import was asked to do, and then does not decode */
+    *import_flags = UT_Hook_GetArgValueByName(Context, "import_flags", uint32_t);
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
 void test_bplib_create_cla_intf(void)
 {
     /* Test function for:
@@ -55,6 +143,90 @@ void test_bplib_create_cla_intf(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_create_cla_intf_ext(void)
+{
+    /* Test function for:
+     * bp_handle_t bplib_create_cla_intf_ext(bplib_routetbl_t *rtbl, uint32_t flags)
+     */
+    static bplib_cla_dedup_t dedup;
+    bplib_routetbl_t         rtbl;
+    bplib_mpool_block_t      sblk;
+    bplib_mpool_flow_t       flow;
+    bplib_cla_stats_t        stats;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_lib_AltHandler_PointerReturn, &sblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_block_from_external_id), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+
+    /* without the flag, the queues are left alone */
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, 0).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_ring, 0);
+
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_SPSC_RINGS).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_ring, 2);
+
+    /* failing to set up the rings does not fail the interface */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_attach_ring), BP_ERROR);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_SPSC_RINGS).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_ring, 3);
+
+    /* priority bands go on egress only */
+    UT_ResetState(UT_KEY(bplib_mpool_flow_attach_ring));
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_PRIORITY_EGRESS).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_bands, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_ring, 0);
+
+    /* with both flags, egress keeps its bands and only ingress becomes a ring */
+    flow.egress.bands = (bplib_mpool_subq_bands_t *)&sblk;
+    UtAssert_UINT32_GT(
+        bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_PRIORITY_EGRESS | BPLIB_CLA_INTF_SPSC_RINGS).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_bands, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_ring, 1);
+    flow.egress.bands = NULL;
+
+    /* failing to set up the bands does not fail the interface either */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_attach_bands), BP_ERROR);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_PRIORITY_EGRESS).hdl, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_bands, 3);
+
+    /* the interface remembers whether to decode extension blocks lazily, and when to check CRCs */
+    memset(&stats, 0, sizeof(stats));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_LAZY_DECODE).hdl, 0);
+    UtAssert_BOOL_TRUE(stats.lazy_decode);
+    UtAssert_BOOL_FALSE(stats.defer_crc);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_DEFER_CRC).hdl, 0);
+    UtAssert_BOOL_FALSE(stats.lazy_decode);
+    UtAssert_BOOL_TRUE(stats.defer_crc);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, 0).hdl, 0);
+    UtAssert_BOOL_FALSE(stats.lazy_decode);
+    UtAssert_BOOL_FALSE(stats.defer_crc);
+
+    /* the duplicate filter is only made when asked for, and without memory the interface goes on without it */
+    UtAssert_NULL(stats.dedup);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_DEDUP).hdl, 0);
+    UtAssert_NULL(stats.dedup);
+    memset(&dedup, 0, sizeof(dedup));
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, &dedup);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_DEDUP).hdl, 0);
+    UtAssert_NULL(stats.dedup);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_createlock), UT_lib_cla_AltHandler_CreateLock, NULL);
+    UtAssert_UINT32_GT(bplib_create_cla_intf_ext(&rtbl, BPLIB_CLA_INTF_DEDUP).hdl, 0);
+    UtAssert_ADDRESS_EQ(stats.dedup, &dedup);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_createlock), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
 void test_bplib_cla_ingress(void)
 {
     /* Test function for:
@@ -83,154 +255,2118 @@ void test_bplib_cla_ingress(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
     UtAssert_INT32_NEQ(bplib_cla_ingress(&rtbl, intf_id, bundle, size, timeout), 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
     UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, size, timeout), 0);
 
     timeout = 0;
     UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, size, timeout), 0);
 
+    /* framed */
+    stats.framing.mtu = 1000;
+    UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, size, timeout), 0);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
-void test_bplib_cla_egress(void)
+void test_bplib_cla_ingress_batch(void)
 {
     /* Test function for:
-     * int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle, size_t *size, uint32_t timeout)
+     * int bplib_cla_ingress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const bplib_cla_bundle_buf_t *bundles,
+     * uint32_t count, int *status_list, uint32_t timeout)
      */
-    bplib_routetbl_t  rtbl;
-    bp_handle_t       intf_id;
-    void             *bundle  = NULL;
-    size_t            size    = 100;
-    uint64_t          timeout = 0;
-    bplib_mpool_ref_t flow_ref;
-    bplib_cla_stats_t stats;
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_cla_bundle_buf_t      bundles[2];
+    int                         status_list[2];
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
     memset(&intf_id, 0, sizeof(bp_handle_t));
-    memset(&flow_ref, 0, sizeof(bplib_mpool_ref_t));
+    memset(bundles, 0, sizeof(bundles));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
     memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    bundles[0].size = 10;
+    bundles[1].size = 20;
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
-    UtAssert_INT32_NEQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    /* invalid intf */
+    memset(status_list, 0, sizeof(status_list));
+    UtAssert_INT32_EQ(bplib_cla_ingress_batch(&rtbl, intf_id, bundles, 2, status_list, 0), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[0], BP_ERROR);
+    UtAssert_INT32_EQ(status_list[1], BP_ERROR);
 
-    timeout = 3000;
+    /* not a CLA */
+    memset(status_list, 0, sizeof(status_list));
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
-    UtAssert_INT32_NEQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    UtAssert_INT32_EQ(bplib_cla_ingress_batch(&rtbl, intf_id, bundles, 2, status_list, 3000), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[0], BP_ERROR);
+    UtAssert_INT32_EQ(status_list[1], BP_ERROR);
 
+    /* the flow is not valid, which gives the bplog status */
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
-    UtAssert_INT32_EQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    UtAssert_INT32_EQ(bplib_cla_ingress_batch(&rtbl, intf_id, bundles, 2, status_list, 3000), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.ingress_byte_count, 30);
+    /* the routing task is woken once per batch, not per bundle */
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 2);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
-void test_bplib_cla_event_impl(void)
+void test_bplib_cla_rxbuf_get(void)
 {
     /* Test function for:
-     * int bplib_cla_event_impl(void *arg, bplib_mpool_block_t *intf_block)
+     * int bplib_cla_rxbuf_get(bplib_routetbl_t *rtbl, size_t *size, void **buffer, bplib_mpool_ref_t *buffer_ref)
+     * void bplib_cla_rxbuf_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t buffer_ref)
      */
-    bplib_mpool_flow_generic_event_t arg;
-    bplib_mpool_block_t              intf_block;
-    bplib_mpool_flow_t               flow;
+    static const size_t         capacity[] = {50, 200, 200, 200};
+    bplib_routetbl_t            rtbl;
+    size_t                      size;
+    void                       *buffer;
+    bplib_mpool_ref_t           buffer_ref;
+    bplib_mpool_block_t         blk;
+    bplib_mpool_block_content_t refblk;
+    uint8_t                     data[8];
 
-    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refblk, 0, sizeof(bplib_mpool_block_content_t));
 
-    memset(&arg, 0, sizeof(bplib_mpool_flow_generic_event_t));
-    memset(&intf_block, 0, sizeof(bplib_mpool_block_t));
-    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    /* no memory */
+    size = 100;
+    UtAssert_INT32_EQ(bplib_cla_rxbuf_get(&rtbl, &size, &buffer, &buffer_ref), BP_ERROR);
+    UtAssert_NULL(buffer);
+    UtAssert_NULL(buffer_ref);
 
-    arg.event_type = bplib_mpool_flow_event_up;
-    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    /* block is not big enough */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_alloc_sized), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_generic_data_capacity), UT_lib_cla_AltHandler_SizeSequence,
+                          (void *)capacity);
+    UtAssert_INT32_EQ(bplib_cla_rxbuf_get(&rtbl, &size, &buffer, &buffer_ref), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
-    arg.intf_state.intf_id = BPLIB_HANDLE_MPOOL_BASE;
-    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    /* ref creation fails */
+    UtAssert_INT32_EQ(bplib_cla_rxbuf_get(&rtbl, &size, &buffer, &buffer_ref), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_NULL(buffer_ref);
 
-    arg.event_type = bplib_mpool_flow_event_down;
-    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    /* nominal, the full capacity is reported back */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_lib_AltHandler_PointerReturn, data);
+    UtAssert_INT32_EQ(bplib_cla_rxbuf_get(&rtbl, &size, &buffer, &buffer_ref), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(buffer, data);
+    UtAssert_ADDRESS_EQ(buffer_ref, &refblk);
+    UtAssert_UINT32_EQ(size, 200);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_VOIDCALL(bplib_cla_rxbuf_release(&rtbl, buffer_ref));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
 }
 
-void test_bplib_generic_bundle_ingress(void)
+void test_bplib_cla_ingress_adopt(void)
 {
     /* Test function for:
-     * int bplib_generic_bundle_ingress(bplib_mpool_ref_t flow_ref, const void *content, size_t size, uint64_t
-     * time_limit)
+     * int bplib_cla_ingress_adopt(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t buffer_ref, size_t
+     * size, uint32_t timeout)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_block_content_t buffer_ref;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&buffer_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+
+    /* invalid intf, the buffer is still consumed */
+    UtAssert_INT32_EQ(bplib_cla_ingress_adopt(&rtbl, intf_id, &buffer_ref, 100, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_ingress_adopt(&rtbl, intf_id, &buffer_ref, 100, 3000), BP_ERROR);
+
+    /* bundle is bigger than the buffer */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_ingress_adopt(&rtbl, intf_id, &buffer_ref, 100, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_set_size, 0);
+
+    /* nominal */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_generic_data_capacity), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_get_generic_data_capacity), 200);
+    UtAssert_INT32_EQ(bplib_cla_ingress_adopt(&rtbl, intf_id, &buffer_ref, 100, 3000), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_set_size, 1);
+    UtAssert_UINT32_EQ(stats.ingress_byte_count, 100);
+
+    UtAssert_INT32_EQ(bplib_cla_ingress_adopt(&rtbl, intf_id, &buffer_ref, 100, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.ingress_byte_count, 200);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 4);
+}
+
+void test_bplib_cla_ingress_begin(void)
+{
+    /* Test function for:
+     * int bplib_cla_ingress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_ref_t           stream_ref;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_mpool_block_t         sblk;
+    bplib_mpool_block_t         pblk;
+    bplib_cla_stats_t           stats;
+    bplib_cla_ingress_stream_t  stream;
+    uint8_t                     stage[32];
+    UT_lib_cla_datacast_t       datacast[3];
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&stream, 0, sizeof(bplib_cla_ingress_stream_t));
+    memset(datacast, 0, sizeof(datacast));
+
+    /* invalid intf */
+    stream_ref = &flow_ref;
+    UtAssert_INT32_EQ(bplib_cla_ingress_begin(&rtbl, intf_id, &stream_ref), BP_ERROR);
+    UtAssert_NULL(stream_ref);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_ingress_begin(&rtbl, intf_id, &stream_ref), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 0);
+
+    /* no memory for the stream */
+    datacast[0].magic_number = 0x7b643c85;
+    datacast[0].ptr          = &stats;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_cla_AltHandler_DataCast, datacast);
+    UtAssert_INT32_EQ(bplib_cla_ingress_begin(&rtbl, intf_id, &stream_ref), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 0);
+
+    /* no memory for the stage, the stream goes back */
+    datacast[1].magic_number = 0x6f2d91a4;
+    datacast[1].ptr          = &stream;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, &sblk);
+    UtAssert_INT32_EQ(bplib_cla_ingress_begin(&rtbl, intf_id, &stream_ref), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    /* no memory for the bundle */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_lib_AltHandler_PointerReturn, stage);
+    UtAssert_INT32_EQ(bplib_cla_ingress_begin(&rtbl, intf_id, &stream_ref), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_NULL(stream_ref);
+
+    /* nominal, the ref takes over the stream */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_generic_data_capacity), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_get_generic_data_capacity), sizeof(stage));
+    UtAssert_INT32_EQ(bplib_cla_ingress_begin(&rtbl, intf_id, &stream_ref), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(stream_ref, &flow_ref);
+    UtAssert_ADDRESS_EQ(stream.pblk, &pblk);
+    UtAssert_STUB_COUNT(v7_stream_import_begin, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_UINT32_EQ(stream.intf_id.hdl, intf_id.hdl);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_ingress_feed(void)
+{
+    /* Test function for:
+     * int bplib_cla_ingress_feed(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, const void *data, size_t size)
+     */
+    bplib_routetbl_t            rtbl;
+    bplib_mpool_block_content_t stream_ref;
+    bplib_cla_ingress_stream_t  stream;
+    uint8_t                     data[8];
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&stream_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stream, 0, sizeof(bplib_cla_ingress_stream_t));
+    memset(data, 0, sizeof(data));
+
+    UtAssert_INT32_EQ(bplib_cla_ingress_feed(&rtbl, &stream_ref, data, sizeof(data)), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_stream_import_feed, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stream);
+    UtAssert_INT32_EQ(bplib_cla_ingress_feed(&rtbl, &stream_ref, data, sizeof(data)), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(v7_stream_import_feed), UT_lib_bool_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_cla_ingress_feed(&rtbl, &stream_ref, data, sizeof(data)), BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_stream_import_feed, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_ingress_end(void)
+{
+    /* Test function for:
+     * int bplib_cla_ingress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, uint32_t timeout)
      */
+    bplib_routetbl_t             rtbl;
+    bplib_mpool_block_content_t  stream_ref;
     bplib_mpool_block_content_t  flow_ref;
-    void                        *content    = NULL;
-    size_t                       size       = 1;
-    uint64_t                     time_limit = 0;
     bplib_mpool_flow_t           flow;
     bplib_mpool_block_t          pblk;
-    bplib_mpool_ref_t            refptr;
+    bplib_mpool_block_t          rblk;
     bplib_mpool_bblock_primary_t pri_block;
+    bplib_cla_stats_t            stats;
+    bplib_cla_ingress_stream_t   stream;
+    UT_lib_cla_datacast_t        datacast[3];
 
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&stream_ref, 0, sizeof(bplib_mpool_block_content_t));
     memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
     memset(&pblk, 0, sizeof(bplib_mpool_block_t));
-    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&rblk, 0, sizeof(bplib_mpool_block_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&stream, 0, sizeof(bplib_cla_ingress_stream_t));
+    memset(datacast, 0, sizeof(datacast));
 
-    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), 0);
+    /* not a stream, it is still released */
+    UtAssert_INT32_EQ(bplib_cla_ingress_end(&rtbl, &stream_ref, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
-    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), BP_ERROR);
+    /* the intf went away */
+    datacast[0].magic_number = 0x6f2d91a4;
+    datacast[0].ptr          = &stream;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_cla_AltHandler_DataCast, datacast);
+    UtAssert_INT32_EQ(bplib_cla_ingress_end(&rtbl, &stream_ref, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 2);
 
-    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_sizet_Handler, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_int8_Handler, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
-    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), BP_ERROR);
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_ingress_end(&rtbl, &stream_ref, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_stream_import_end, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 4);
 
-    size = 0;
+    /* the bundle was not complete, it is dropped */
+    datacast[1].magic_number = 0x7b643c85;
+    datacast[1].ptr          = &stats;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &pblk);
-    UtAssert_INT32_NEQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), 0);
+    stream.pblk            = &pblk;
+    stream.import.total_in = 75;
+    UtAssert_INT32_EQ(bplib_cla_ingress_end(&rtbl, &stream_ref, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_stream_import_end, 1);
+    UtAssert_NULL(stream.pblk);
+    UtAssert_UINT32_EQ(stats.ingress_byte_count, 0);
 
+    /* nominal */
+    UT_SetHandlerFunction(UT_KEY(v7_stream_import_end), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_stream_import_end), 75);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &rblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    stream.pblk = &pblk;
+    UtAssert_INT32_EQ(bplib_cla_ingress_end(&rtbl, &stream_ref, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.ingress_byte_count, 75);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 3);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
-void test_bplib_generic_bundle_egress(void)
+void test_bplib_cla_egress(void)
 {
     /* Test function for:
-     * int bplib_generic_bundle_egress(bplib_mpool_ref_t flow_ref, void *content, size_t *size, uint64_t time_limit)
+     * int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle, size_t *size, uint32_t timeout)
      */
-    bplib_mpool_block_content_t  flow_ref;
-    void                        *content    = NULL;
-    size_t                       size       = 1;
-    uint64_t                     time_limit = 0;
-    bplib_mpool_flow_t           flow;
-    bplib_mpool_block_t          pblk;
-    bplib_mpool_ref_t            refptr;
-    bplib_mpool_bblock_primary_t pri_block;
+    bplib_routetbl_t    rtbl;
+    bp_handle_t         intf_id;
+    void               *bundle  = NULL;
+    size_t              size    = 100;
+    uint64_t            timeout = 0;
+    bplib_mpool_ref_t   flow_ref;
+    bplib_cla_stats_t   stats;
+    bplib_mpool_block_t pblk;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_ref_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_NEQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+
+    timeout = 3000;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_NEQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 1);
+
+    /* paced, the last bundle is still going out so nothing is pulled within a zero timeout */
+    stats.egress_pacing.rate   = 1000;
+    stats.egress_pacing.tokens = -500;
+    UtAssert_INT32_EQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, 0), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 1);
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 0);
+
+    /* but it is within a longer one, and this waits for it */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_wait_until_ms), BP_TIMEOUT);
+    UtAssert_INT32_EQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 2);
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 1);
+
+    /* framed, which is also how a held over bundle gets sent once framing is off again */
+    stats.egress_pacing.rate = 0;
+    stats.framing.mtu        = 1000;
+    UtAssert_INT32_EQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    stats.framing.mtu      = 0;
+    stats.framing.holdover = &pblk;
+    UtAssert_INT32_EQ(bplib_cla_egress(&rtbl, intf_id, bundle, &size, timeout), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 4);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_egress_batch(void)
+{
+    /* Test function for:
+     * int bplib_cla_egress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_egress_buf_t *buffers,
+     * uint32_t count, uint32_t *num_filled, uint32_t timeout)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_cla_egress_buf_t      buffers[2];
+    uint32_t                    num_filled;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(buffers, 0, sizeof(buffers));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+
+    /* invalid intf */
+    num_filled = 1;
+    UtAssert_INT32_EQ(bplib_cla_egress_batch(&rtbl, intf_id, buffers, 2, &num_filled, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(num_filled, 0);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_egress_batch(&rtbl, intf_id, buffers, 2, &num_filled, 3000), BP_ERROR);
+    UtAssert_UINT32_EQ(num_filled, 0);
+
+    /* the flow is not valid, which gives the bplog status */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_egress_batch(&rtbl, intf_id, buffers, 2, &num_filled, 3000), 0);
+    UtAssert_UINT32_EQ(num_filled, 0);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 3);
+
+    /* paced, but enough time has gone by to fill the bucket again */
+    stats.egress_pacing.rate   = 1000;
+    stats.egress_pacing.tokens = -500;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 2000);
+    UtAssert_INT32_EQ(bplib_cla_egress_batch(&rtbl, intf_id, buffers, 2, &num_filled, 0), 0);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, 1000);
+    UtAssert_UINT32_EQ(stats.egress_pacing.update_ms, 2000);
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
 
+void test_bplib_cla_get_notify_fd(void)
+{
+    /* Test function for:
+     * int bplib_cla_get_notify_fd(bplib_routetbl_t *rtbl, bp_handle_t intf_id)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+    bplib_mpool_flow_t          flow;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
     memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
-    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
-    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
-    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
 
-    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+    /* invalid intf */
+    UtAssert_INT32_EQ(bplib_cla_get_notify_fd(&rtbl, intf_id), BP_ERROR);
 
-    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_sizet_Handler, NULL);
-    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_out), UT_lib_sizet_Handler, NULL);
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_get_notify_fd(&rtbl, intf_id), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_get_notify_fd(&rtbl, intf_id), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_notifier, 0);
+
+    /* nominal, the descriptor is the one of the egress queue */
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
-    UtAssert_INT32_NEQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_notifier_get_fd), 5);
+    UtAssert_INT32_EQ(bplib_cla_get_notify_fd(&rtbl, intf_id), 5);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_notifier, 1);
 
-    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_sizet_Handler, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &pblk);
-    UtAssert_INT32_NEQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+    /* no notifier */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_attach_notifier), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cla_get_notify_fd(&rtbl, intf_id), BP_ERROR);
 
-    size = 0;
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
-    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_egress_iov(void)
+{
+    /* Test function for:
+     * int bplib_cla_egress_iov(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_iovec_t *iov, uint32_t *iov_count,
+     * bplib_mpool_ref_t *bundle_ref, uint32_t timeout)
+     * void bplib_cla_egress_iov_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t bundle_ref)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_iovec_t               iov[4];
+    uint32_t                    iov_count;
+    bplib_mpool_ref_t           bundle_ref;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(iov, 0, sizeof(iov));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    iov_count = 4;
+
+    /* invalid intf */
+    UtAssert_INT32_EQ(bplib_cla_egress_iov(&rtbl, intf_id, iov, &iov_count, &bundle_ref, 0), BP_ERROR);
+    UtAssert_NULL(bundle_ref);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_egress_iov(&rtbl, intf_id, iov, &iov_count, &bundle_ref, 3000), BP_ERROR);
+    UtAssert_NULL(bundle_ref);
+
+    /* the flow is not valid, which gives the bplog status */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_egress_iov(&rtbl, intf_id, iov, &iov_count, &bundle_ref, 3000), 0);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 3);
+
+    /* paced, and only some of the debt has been paid off since */
+    stats.egress_pacing.rate   = 1000;
+    stats.egress_pacing.tokens = -500;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 300);
+    UtAssert_INT32_EQ(bplib_cla_egress_iov(&rtbl, intf_id, iov, &iov_count, &bundle_ref, 0), BP_TIMEOUT);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, -200);
+    UtAssert_UINT32_EQ(stats.egress_pacing.update_ms, 300);
+    UtAssert_NULL(bundle_ref);
+
+    UT_ResetState(UT_KEY(bplib_mpool_ref_release));
+    bplib_cla_egress_iov_release(&rtbl, bundle_ref);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_egress_stream(void)
+{
+    /* Test function for:
+     * int bplib_cla_egress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref, size_t
+     * *size, uint32_t timeout)
+     * int bplib_cla_egress_read(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, void *buffer, size_t *size)
+     * void bplib_cla_egress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref)
+     */
+    bplib_routetbl_t             rtbl;
+    bp_handle_t                  intf_id;
+    bplib_mpool_ref_t            stream_ref;
+    size_t                       size;
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_mpool_block_content_t  bundle_content;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          sblk;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_cla_stats_t            stats;
+    bplib_cla_egress_stream_t    stream;
+    UT_lib_cla_datacast_t        datacast[3];
+    uint8_t                      buffer[16];
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&bundle_content, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&stream, 0, sizeof(bplib_cla_egress_stream_t));
+    memset(datacast, 0, sizeof(datacast));
+    size = 1;
+
+    /* invalid intf */
+    UtAssert_INT32_EQ(bplib_cla_egress_begin(&rtbl, intf_id, &stream_ref, &size, 0), BP_ERROR);
+    UtAssert_NULL(stream_ref);
+    UtAssert_ZERO(size);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_egress_begin(&rtbl, intf_id, &stream_ref, &size, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 0);
+
+    /* no memory for the stream, nothing is pulled */
+    datacast[0].magic_number = 0x7b643c85;
+    datacast[0].ptr          = &stats;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_cla_AltHandler_DataCast, datacast);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_cla_egress_begin(&rtbl, intf_id, &stream_ref, &size, 3000), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 0);
+
+    /* nothing in the queue, the stream goes back */
+    datacast[1].magic_number = 0x1c8e5b37;
+    datacast[1].ptr          = &stream;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, &sblk);
+    UtAssert_INT32_EQ(bplib_cla_egress_begin(&rtbl, intf_id, &stream_ref, &size, 0), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(stream_ref);
+
+    /* nominal */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &bundle_content);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(v7_stream_export_begin), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_stream_export_begin), 40);
+    UtAssert_INT32_EQ(bplib_cla_egress_begin(&rtbl, intf_id, &stream_ref, &size, 0), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(stream_ref, &flow_ref);
+    UtAssert_ADDRESS_EQ(stream.bundle_ref, &bundle_content);
+    UtAssert_UINT32_EQ(size, 40);
+    UtAssert_UINT32_EQ(stats.egress_byte_count, 40);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 5);
+
+    /* the pieces */
+    size = sizeof(buffer);
+    UT_SetHandlerFunction(UT_KEY(v7_stream_export_next), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_stream_export_next), sizeof(buffer));
+    UtAssert_INT32_EQ(bplib_cla_egress_read(&rtbl, stream_ref, buffer, &size), BP_SUCCESS);
+    UtAssert_UINT32_EQ(size, sizeof(buffer));
+
+    UT_SetDefaultReturnValue(UT_KEY(v7_stream_export_next), 0);
+    UtAssert_INT32_EQ(bplib_cla_egress_read(&rtbl, stream_ref, buffer, &size), BP_SUCCESS);
+    UtAssert_ZERO(size);
+
+    UT_ResetState(UT_KEY(bplib_mpool_ref_release));
+    bplib_cla_egress_end(&rtbl, stream_ref);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    /* not a stream */
+    size = sizeof(buffer);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_cla_egress_read(&rtbl, stream_ref, buffer, &size), BP_ERROR);
+    UtAssert_ZERO(size);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_event_impl(void)
+{
+    /* Test function for:
+     * int bplib_cla_event_impl(void *arg, bplib_mpool_block_t *intf_block)
+     */
+    bplib_mpool_flow_generic_event_t arg;
+    bplib_mpool_block_t              intf_block;
+    bplib_mpool_flow_t               flow;
+    bplib_mpool_block_t              pblk;
+    bplib_cla_stats_t                stats;
+    bplib_cla_fragmentation_t        frag;
+
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+
+    memset(&arg, 0, sizeof(bplib_mpool_flow_generic_event_t));
+    memset(&intf_block, 0, sizeof(bplib_mpool_block_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+
+    arg.event_type = bplib_mpool_flow_event_up;
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    arg.intf_state.intf_id = BPLIB_HANDLE_MPOOL_BASE;
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+
+    arg.event_type = bplib_mpool_flow_event_down;
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+
+    /* a bundle held over for the next frame is dropped with the rest of the queue */
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    stats.framing.holdover = &pblk;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(stats.framing.holdover);
+
+    /* a poll with nothing held for reassembly */
+    arg.event_type = bplib_mpool_flow_event_poll;
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    UtAssert_STUB_COUNT(bplib_os_lock, 0);
+
+    /* bundles waiting for fragments are given up once they expire */
+    memset(&frag, 0, sizeof(bplib_cla_fragmentation_t));
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
+    stats.fragmentation = &frag;
+    UtAssert_INT32_EQ(bplib_cla_event_impl(&arg, &intf_block), 0);
+    UtAssert_STUB_COUNT(bplib_os_lock, 1);
+    UtAssert_STUB_COUNT(bplib_os_unlock, 1);
+    UtAssert_UINT32_EQ(frag.drop_reassembly, 0);
+    UtAssert_UINT32_EQ(frag.poll_time, BP_DTNTIME_INFINITE);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_destruct_intf(void)
+{
+    /* Test function for:
+     * int bplib_cla_destruct_intf(void *arg, bplib_mpool_block_t *sblk)
+     */
+    bplib_mpool_block_t       sblk;
+    bplib_mpool_block_t       pblk;
+    bplib_cla_stats_t         stats;
+    bplib_cla_fragmentation_t frag;
+
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&frag, 0, sizeof(bplib_cla_fragmentation_t));
+
+    UtAssert_INT32_EQ(bplib_cla_destruct_intf(NULL, &sblk), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_destruct_intf(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 0);
+
+    stats.framing.holdover = &pblk;
+    UtAssert_INT32_EQ(bplib_cla_destruct_intf(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(stats.framing.holdover);
+
+    /* the fragmentation state goes with the intf */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
+    frag.self_ptr       = &pblk;
+    stats.fragmentation = &frag;
+    UtAssert_INT32_EQ(bplib_cla_destruct_intf(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_os_destroylock, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_NULL(stats.fragmentation);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_destruct_ingress_stream(void)
+{
+    /* Test function for:
+     * int bplib_cla_destruct_ingress_stream(void *arg, bplib_mpool_block_t *sblk)
+     */
+    bplib_mpool_block_t        sblk;
+    bplib_mpool_block_t        pblk;
+    bplib_mpool_block_t        stage_blk;
+    bplib_cla_ingress_stream_t stream;
+
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&stage_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&stream, 0, sizeof(bplib_cla_ingress_stream_t));
+
+    UtAssert_INT32_EQ(bplib_cla_destruct_ingress_stream(NULL, &sblk), BP_ERROR);
+
+    /* everything already went on, or was never allocated */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stream);
+    UtAssert_INT32_EQ(bplib_cla_destruct_ingress_stream(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 0);
+
+    /* a bundle that was never ended */
+    stream.pblk      = &pblk;
+    stream.stage_blk = &stage_blk;
+    UtAssert_INT32_EQ(bplib_cla_destruct_ingress_stream(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_stream_import_end, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_NULL(stream.pblk);
+    UtAssert_NULL(stream.stage_blk);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_destruct_egress_stream(void)
+{
+    /* Test function for:
+     * int bplib_cla_destruct_egress_stream(void *arg, bplib_mpool_block_t *sblk)
+     */
+    bplib_mpool_block_t         sblk;
+    bplib_mpool_block_content_t bundle_content;
+    bplib_cla_egress_stream_t   stream;
+
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&bundle_content, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stream, 0, sizeof(bplib_cla_egress_stream_t));
+
+    UtAssert_INT32_EQ(bplib_cla_destruct_egress_stream(NULL, &sblk), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stream);
+    UtAssert_INT32_EQ(bplib_cla_destruct_egress_stream(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 0);
+
+    stream.bundle_ref = &bundle_content;
+    UtAssert_INT32_EQ(bplib_cla_destruct_egress_stream(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+    UtAssert_NULL(stream.bundle_ref);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_query_integer(void)
+{
+    /* Test function for:
+     * int bplib_cla_query_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t
+     * *value)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+    bplib_cla_fragmentation_t   frag;
+    bp_sval_t                   value;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&frag, 0, sizeof(bplib_cla_fragmentation_t));
+    stats.egress_pacing.rate  = 1000;
+    stats.egress_pacing.burst = 200;
+    stats.framing.mtu         = 1500;
+    stats.framing.max_wait    = 20;
+
+    /* invalid intf */
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, &value), BP_ERROR);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, &value), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    value = 0;
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 1000);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_burst, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 200);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_frame_mtu, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 1500);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_frame_wait, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 20);
+
+    /* nothing to say about fragmentation until some of it is configured */
+    value = -1;
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_fragment_mtu, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 0);
+
+    stats.fragmentation = &frag;
+    frag.mtu            = 512;
+    frag.mem_limit      = 65536;
+    frag.max_wait       = 30000;
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_fragment_mtu, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 512);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_reassembly_mem, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 65536);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_reassembly_wait, &value),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 30000);
+
+    /* statistics */
+    stats.ingress_byte_count                           = 5000;
+    stats.egress_byte_count                            = 3000;
+    stats.counters[bplib_cla_counter_egress_bundles]   = 7;
+    stats.counters[bplib_cla_counter_drop_expired]     = 2;
+    stats.counters[bplib_cla_counter_queue_time_100ms] = 3;
+    frag.fragmented                                    = 4;
+    frag.reassembled                                   = 5;
+    frag.drop_reassembly                               = 6;
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_ingress_bytes, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 5000);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_bytes, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 3000);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_bundles, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 7);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_drop_expired, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 2);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_queue_100ms, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 3);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_ingress_bundles, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 0);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_fragmented, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 4);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_reassembled, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 5);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_drop_reassembly, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 6);
+
+    /* the first sample only sets the starting point */
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_ingress_bps, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 0);
+    UtAssert_UINT32_EQ(stats.rate_ewma.ingress_sample, 5000);
+
+    /* two windows later, 4000 more bytes in and none out */
+    stats.ingress_byte_count      = 9000;
+    stats.rate_ewma.sample_ms     = 1000;
+    stats.rate_ewma.egress_sample = 3000;
+    stats.rate_ewma.egress_rate   = 800;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 3000);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_ingress_bps, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 468);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_bps, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 612);
+    UtAssert_UINT32_EQ(stats.rate_ewma.sample_ms, 3000);
+
+    /* a long quiet period only decays it so far */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 1003000);
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_cla_egress_bps, &value), BP_SUCCESS);
+    UtAssert_INT32_EQ(value, 69);
+
+    /* not an intf variable */
+    UtAssert_INT32_EQ(bplib_cla_query_integer(&rtbl, intf_id, bplib_variable_mem_current_use, &value), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_count_drop(void)
+{
+    /* Test function for:
+     * void bplib_cla_count_drop(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_counter_t counter)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+
+    /* invalid intf, nothing to count */
+    UtAssert_VOIDCALL(bplib_cla_count_drop(&rtbl, intf_id, bplib_cla_counter_drop_no_route));
+
+    /* not a CLA, also nothing to count */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_VOIDCALL(bplib_cla_count_drop(&rtbl, intf_id, bplib_cla_counter_drop_no_route));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_VOIDCALL(bplib_cla_count_drop(&rtbl, intf_id, bplib_cla_counter_drop_no_route));
+    UtAssert_VOIDCALL(bplib_cla_count_drop(&rtbl, intf_id, bplib_cla_counter_drop_queue_full));
+    UtAssert_VOIDCALL(bplib_cla_count_drop(&rtbl, intf_id, bplib_cla_counter_drop_queue_full));
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_no_route], 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_queue_full], 2);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 4);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_config_integer(void)
+{
+    /* Test function for:
+     * int bplib_cla_config_integer(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_variable_t var_id, bp_sval_t
+     * value)
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_cla_stats_t           stats;
+    bplib_cla_fragmentation_t   frag;
+    UT_lib_cla_datacast_t       datacast[3];
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&frag, 0, sizeof(bplib_cla_fragmentation_t));
+    memset(datacast, 0, sizeof(datacast));
+    datacast[0].magic_number = 0x7b643c85;
+    datacast[0].ptr          = &stats;
+
+    /* bad value, then invalid intf */
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, -1), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, 1000), BP_ERROR);
+
+    /* not a CLA */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, 1000), BP_ERROR);
+
+    /* with no burst set, the bucket holds one second of the rate */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_egress_rate, 1000), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.egress_pacing.rate, 1000);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, 1000);
+
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_egress_burst, 200), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.egress_pacing.burst, 200);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, 200);
+
+    /* framing does not touch the bucket */
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_frame_mtu, 1500), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_frame_wait, 20), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.framing.mtu, 1500);
+    UtAssert_UINT32_EQ(stats.framing.max_wait, 20);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, 200);
+
+    /* the fragmentation state is made the first time, which needs memory and a lock */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_cla_AltHandler_DataCast, datacast);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_fragment_mtu, 512), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_os_createlock, 0);
+
+    datacast[1].magic_number = 0x3b71c0e2;
+    datacast[1].ptr          = &frag;
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_fragment_mtu, 512), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_os_createlock, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(stats.fragmentation);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_createlock), UT_lib_cla_AltHandler_CreateLock, NULL);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_fragment_mtu, 512), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(stats.fragmentation, &frag);
+    UtAssert_UINT32_EQ(frag.poll_time, BP_DTNTIME_INFINITE);
+
+    /* and kept after that */
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_reassembly_mem, 65536), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_cla_reassembly_wait, 30000), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_os_createlock, 2);
+    UtAssert_UINT32_EQ(frag.mtu, 512);
+    UtAssert_UINT32_EQ(frag.mem_limit, 65536);
+    UtAssert_UINT32_EQ(frag.max_wait, 30000);
+
+    /* not writable, the bucket is left alone */
+    stats.egress_pacing.tokens = -10;
+    UtAssert_INT32_EQ(bplib_cla_config_integer(&rtbl, intf_id, bplib_variable_mem_current_use, 5), BP_ERROR);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, -10);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_createlock), NULL, NULL);
+}
+
+void test_bplib_cla_push_egress_bundle(void)
+{
+    /* Test function for:
+     * int bplib_cla_push_egress_bundle(bplib_mpool_flow_t *flow, bplib_mpool_block_t *cb)
+     */
+    bplib_mpool_flow_t             flow;
+    bplib_mpool_block_t            intf_block;
+    bplib_mpool_block_t            cb;
+    bplib_mpool_block_t            fblk;
+    bplib_mpool_block_content_t    rblk;
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t pay;
+    bplib_cla_stats_t              stats;
+    bplib_cla_fragmentation_t      frag;
+    uint8_t                        content[50];
+
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&intf_block, 0, sizeof(bplib_mpool_block_t));
+    memset(&cb, 0, sizeof(bplib_mpool_block_t));
+    memset(&fblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&rblk, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&cpb, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&frag, 0, sizeof(bplib_cla_fragmentation_t));
+
+    /* no extension blocks, only the payload */
+    cpb.cblock_list.type = bplib_mpool_blocktype_list_head;
+    cpb.cblock_list.next = &cpb.cblock_list;
+    cpb.cblock_list.prev = &cpb.cblock_list;
+
+    /* not a CLA, so just a push */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_try_push), true);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 1);
+
+    /* no fragmentation configured, then no fragment MTU set */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &cpb);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    stats.fragmentation = &frag;
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 3);
+
+    /* fits the MTU */
+    frag.mtu = 100;
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_compute_full_bundle_size), 80);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 4);
+
+    /* too big, but must not be fragmented */
+    UT_SetDefaultReturnValue(UT_KEY(v7_compute_full_bundle_size), 300);
+    cpb.data.logical.controlFlags.mustNotFragment = true;
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 5);
+    cpb.data.logical.controlFlags.mustNotFragment = false;
+
+    /* no payload to split up */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_cla_AltHandler_CanonicalCast, &pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_locate_canonical), UT_lib_AltHandler_PointerReturn, &fblk);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 6);
+
+    /* 240 bytes of payload, and 50 bytes of blocks around it, in a fragment */
+    cpb.block_encode_size_cache = 20;
+    pay.block_encode_size_cache = 250;
+    pay.encoded_content_length  = 240;
+    UT_SetDefaultReturnValue(UT_KEY(v7_compute_full_bundle_size), 272);
+
+    /* the MTU does not fit the blocks */
+    frag.mtu = 40;
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 7);
+
+    /* no memory for the fragment content */
+    frag.mtu = 100;
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 7);
+
+    /* the payload could not be copied */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, content);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &fblk);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 0);
+
+    /* five fragments made, but the queue did not take them all */
+    memset(&cpb.data, 0, sizeof(cpb.data));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_lib_cla_AltHandler_ExportLength, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, &fblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &rblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &fblk);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 5);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 2);
+    UtAssert_UINT32_EQ(frag.fragmented, 0);
+    UtAssert_True(cpb.data.logical.controlFlags.isFragment, "fragment flag set");
+    UtAssert_UINT32_EQ(cpb.data.logical.totalADUlength, 240);
+
+    /* all sent, the bundle goes out as if it were whole */
+    memset(&cpb.data, 0, sizeof(cpb.data));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_lib_AltHandler_PointerReturn, &intf_block);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_try_push_n), 5);
+    UtAssert_INT32_EQ(bplib_cla_push_egress_bundle(&flow, &cb), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 10);
+    UtAssert_UINT32_EQ(frag.fragmented, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 7);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_locate_canonical), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_verify_ingress(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_cla_verify_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk)
+     */
+    bplib_mpool_block_t          intf_block;
+    bplib_mpool_block_t          qblk;
+    bplib_mpool_bblock_primary_t cpb;
+    bplib_cla_stats_t            stats;
+
+    memset(&intf_block, 0, sizeof(intf_block));
+    memset(&qblk, 0, sizeof(qblk));
+    memset(&cpb, 0, sizeof(cpb));
+    memset(&stats, 0, sizeof(stats));
+
+    /* not a bundle, nothing to check */
+    UtAssert_ADDRESS_EQ(bplib_cla_verify_ingress(&intf_block, &qblk), &qblk);
+    UtAssert_STUB_COUNT(v7_verify_deferred_crcs, 0);
+
+    /* CRCs good, or already checked */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &cpb);
+    UT_SetDefaultReturnValue(UT_KEY(v7_verify_deferred_crcs), true);
+    UtAssert_ADDRESS_EQ(bplib_cla_verify_ingress(&intf_block, &qblk), &qblk);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 0);
+
+    /* a bad CRC drops the bundle, which counts against the intf if it is a CLA */
+    UT_SetDefaultReturnValue(UT_KEY(v7_verify_deferred_crcs), false);
+    UtAssert_NULL(bplib_cla_verify_ingress(&intf_block, &qblk));
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_NULL(bplib_cla_verify_ingress(&intf_block, &qblk));
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_decode], 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_ingress_defer_decode(void)
+{
+    /* Test function for:
+     * int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *bundle, size_t size, uint32_t
+     * timeout), with BPLIB_CLA_INTF_DEFER_DECODE
+     */
+    bplib_routetbl_t            rtbl;
+    bp_handle_t                 intf_id;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_mpool_flow_t          flow;
+    bplib_mpool_block_t         cblk;
+    bplib_mpool_block_t         rblk;
+    bplib_cla_stats_t           stats;
+    uint8_t                     bundle[100];
+    uint8_t                     buffer[200];
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&intf_id, 0, sizeof(bp_handle_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&cblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&rblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(bundle, 0xa5, sizeof(bundle));
+    memset(buffer, 0, sizeof(buffer));
+    stats.defer_decode = true;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+
+    /* over the quota, nothing is allocated */
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_quota_admit), 1, BP_TIMEOUT);
+    UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, sizeof(bundle), 0), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_alloc_sized, 0);
+
+    /* a bundle that does not fit in the block is decoded here after all */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_alloc_sized), UT_lib_AltHandler_PointerReturn, &cblk);
+    UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, sizeof(bundle), 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 1);
+
+    /* otherwise it is copied, and queued as it is */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_generic_data_capacity), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_get_generic_data_capacity), sizeof(buffer));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_lib_AltHandler_PointerReturn, buffer);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &rblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, sizeof(bundle), 0), BP_SUCCESS);
+    UtAssert_MemCmp(buffer, bundle, sizeof(bundle), "bundle copied");
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_ingress_bundles], 1);
+    UtAssert_UINT32_EQ(stats.ingress_byte_count, sizeof(bundle));
+
+    /* the queue is full */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_int8_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_cla_ingress(&rtbl, intf_id, bundle, sizeof(bundle), 0), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_queue_full], 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+
+    /* no memory for the queue entry */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+    bplib_cla_ingress(&rtbl, intf_id, bundle, sizeof(bundle), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_alloc_sized), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_decode_ingress(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_cla_decode_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk)
+     */
+    bplib_mpool_block_t         intf_block;
+    bplib_mpool_block_t         qblk;
+    bplib_mpool_block_t         pblk;
+    bplib_mpool_block_content_t flow_ref;
+    bplib_mpool_block_content_t buffer_ref;
+    bplib_cla_stats_t           stats;
+
+    memset(&intf_block, 0, sizeof(intf_block));
+    memset(&qblk, 0, sizeof(qblk));
+    memset(&pblk, 0, sizeof(pblk));
+    memset(&flow_ref, 0, sizeof(flow_ref));
+    memset(&buffer_ref, 0, sizeof(buffer_ref));
+    memset(&stats, 0, sizeof(stats));
+
+    /* already decoded, nothing to do */
+    UtAssert_ADDRESS_EQ(bplib_cla_decode_ingress(&intf_block, &qblk), &qblk);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_from_block, 0);
+
+    /* the queue entry goes either way, and without refs nothing is decoded */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_NULL(bplib_cla_decode_ingress(&intf_block, &qblk));
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 0);
+
+    /* the buffer is adopted rather than copied, and a bundle that does not decode is dropped */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &buffer_ref);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(v7_adopt_full_bundle_in), UT_lib_sizet_Handler, NULL);
+    UtAssert_NULL(bplib_cla_decode_ingress(&intf_block, &qblk));
+    UtAssert_STUB_COUNT(v7_adopt_full_bundle_in, 1);
+    UtAssert_STUB_COUNT(v7_copy_full_bundle_in, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_reassemble_ingress(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_cla_reassemble_ingress(bplib_mpool_block_t *intf_block, bplib_mpool_block_t *qblk)
+     */
+    bplib_mpool_block_t            intf_block;
+    bplib_mpool_block_t            qblk;
+    bplib_mpool_block_t            pblk;
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t pay;
+    bplib_cla_stats_t              stats;
+    bplib_cla_reassembly_t         entry;
+    bplib_cla_fragment_t           fragment;
+    bplib_cla_fragmentation_t      frag;
+    UT_lib_cla_datacast_t          datacast[4];
+
+    memset(&intf_block, 0, sizeof(bplib_mpool_block_t));
+    memset(&qblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&cpb, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&entry, 0, sizeof(bplib_cla_reassembly_t));
+    memset(&fragment, 0, sizeof(bplib_cla_fragment_t));
+    memset(&frag, 0, sizeof(bplib_cla_fragmentation_t));
+    memset(datacast, 0, sizeof(datacast));
+
+    /* the intf, a reassembly entry and a fragment */
+    datacast[0].magic_number = 0x7b643c85;
+    datacast[0].ptr          = &stats;
+    datacast[1].magic_number = 0x5a13f6b8;
+    datacast[1].ptr          = &entry;
+    datacast[2].magic_number = 0xe4d0827f;
+    datacast[2].ptr          = &fragment;
+
+    /* not a CLA */
+    UtAssert_ADDRESS_EQ(bplib_cla_reassemble_ingress(&intf_block, &qblk), &qblk);
+
+    /* reassembly is off, then fragmentation is on but not reassembly */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_cla_AltHandler_DataCast, datacast);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &cpb);
+    UtAssert_ADDRESS_EQ(bplib_cla_reassemble_ingress(&intf_block, &qblk), &qblk);
+    stats.fragmentation = &frag;
+    frag.poll_time      = BP_DTNTIME_INFINITE;
+    UtAssert_ADDRESS_EQ(bplib_cla_reassemble_ingress(&intf_block, &qblk), &qblk);
+
+    /* not a fragment */
+    frag.mem_limit = 1000;
+    UtAssert_ADDRESS_EQ(bplib_cla_reassemble_ingress(&intf_block, &qblk), &qblk);
+
+    /* a fragment with no payload */
+    cpb.data.logical.controlFlags.isFragment = true;
+    cpb.data.logical.totalADUlength          = 100;
+    UtAssert_NULL(bplib_cla_reassemble_ingress(&intf_block, &qblk));
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_decode], 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    /* a fragment past the end of the ADU */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &pay);
+    pay.encoded_content_length     = 50;
+    cpb.data.logical.fragmentOffset = 60;
+    UtAssert_NULL(bplib_cla_reassemble_ingress(&intf_block, &qblk));
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_decode], 2);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+
+    /* the first half, which is held until the rest comes in */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_iter_goto_min), BP_ERROR);
+    cpb.data.logical.fragmentOffset = 0;
+    UtAssert_NULL(bplib_cla_reassemble_ingress(&intf_block, &qblk));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_from_block, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 3);
+    UtAssert_UINT32_EQ(entry.total_length, 100);
+    UtAssert_UINT32_EQ(entry.held_bytes, 50);
+    UtAssert_UINT32_EQ(frag.held_bytes, 50);
+    UtAssert_UINT32_EQ(fragment.length, 50);
+    UtAssert_UINT32_EQ(frag.drop_reassembly, 0);
+
+    /* the same part again is not held twice */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_lib_AltHandler_PointerReturn, &entry);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_insert_value_generic), BP_DUPLICATE);
+    UtAssert_NULL(bplib_cla_reassemble_ingress(&intf_block, &qblk));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_from_block, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 5);
+    UtAssert_UINT32_EQ(entry.held_bytes, 50);
+
+    /* bigger than all of the reassembly memory */
+    frag.mem_limit = 10;
+    UtAssert_NULL(bplib_cla_reassemble_ingress(&intf_block, &qblk));
+    UtAssert_UINT32_EQ(frag.drop_reassembly, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 6);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_ingress(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_ingress(bplib_mpool_ref_t flow_ref, const void *content, size_t size, uint64_t
+     * time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    void                        *content    = NULL;
+    size_t                       size       = 1;
+    uint64_t                     time_limit = 0;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_cla_stats_t            stats;
+    uint32_t                     import_flags;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_int8_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), BP_ERROR);
+
+    size = 0;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &pblk);
+    UtAssert_INT32_NEQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), 0);
+
+    /* the counts, of a queue that did not take it, a bundle that did not decode, and one that went in */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_queue_full], 1);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 1, time_limit), BP_ERROR);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_decode], 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, size, time_limit), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_ingress_bundles], 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_queue_full], 1);
+
+    /* a CLA set up for it asks for the extension blocks to be decoded lazily, or the CRCs checked later */
+    import_flags = 0xFF;
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_cla_Handler_ImportFlags, &import_flags);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 1, time_limit), BP_ERROR);
+    UtAssert_UINT32_EQ(import_flags, 0);
+    stats.lazy_decode = true;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 1, time_limit), BP_ERROR);
+    UtAssert_UINT32_EQ(import_flags, V7_IMPORT_LAZY_DECODE);
+    stats.defer_crc = true;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 1, time_limit), BP_ERROR);
+    UtAssert_UINT32_EQ(import_flags, V7_IMPORT_LAZY_DECODE | V7_IMPORT_DEFER_CRC);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_cla_ingress_dedup(void)
+{
+    /* Test function for:
+     * bplib_generic_bundle_ingress(), on an interface made with BPLIB_CLA_INTF_DEDUP
+     */
+    static bplib_cla_dedup_t     dedup;
+    bplib_mpool_block_content_t  flow_ref;
+    uint8_t                      content[8];
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_cla_stats_t            stats;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(content, 0, sizeof(content));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    memset(&dedup, 0, sizeof(dedup));
+    stats.dedup = &dedup;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+
+    /* the first time a bundle goes in, the same bundle again is dropped but not as a bad one */
+    pri_block.data.logical.creationTimeStamp.time         = 1000;
+    pri_block.data.logical.creationTimeStamp.sequence_num = 1;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_ingress_bundles], 1);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_ingress_bundles], 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_duplicate], 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_decode], 0);
+
+    /* another sequence number is another bundle */
+    pri_block.data.logical.creationTimeStamp.sequence_num = 2;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_ingress_bundles], 2);
+
+    /* and each fragment of it is told apart by its offset */
+    pri_block.data.logical.controlFlags.isFragment = true;
+    pri_block.data.logical.fragmentOffset          = 0;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_SUCCESS);
+    pri_block.data.logical.fragmentOffset = 500;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_ingress_bundles], 4);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_duplicate], 2);
+
+    /* once enough others have gone in, the filter is rotated and old bundles are let in again */
+    pri_block.data.logical.controlFlags.isFragment = false;
+    pri_block.data.logical.fragmentOffset          = 0;
+    while (stats.counters[bplib_cla_counter_ingress_bundles] < (2 * BPLIB_CLA_DEDUP_GENERATION) + 4)
+    {
+        ++pri_block.data.logical.creationTimeStamp.sequence_num;
+        bplib_generic_bundle_ingress(&flow_ref, content, 0, 0);
+    }
+    pri_block.data.logical.creationTimeStamp.sequence_num = 1;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress(&flow_ref, content, 0, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_duplicate], 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_ingress_frame(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_ingress_frame(bplib_mpool_ref_t flow_ref, const void *content, size_t size, uint64_t
+     * time_limit)
+     */
+    static const size_t          bundle_sizes[] = {40, 60, 30, 0};
+    bplib_mpool_block_content_t  flow_ref;
+    uint8_t                      content[100];
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(content, 0, sizeof(content));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_frame(&flow_ref, content, sizeof(content), 0), 0);
+
+    /* no memory for the first bundle */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_frame(&flow_ref, content, sizeof(content), 0), BP_ERROR);
+
+    /* two bundles fill the frame, each one is decoded from where the one before ended */
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_cla_AltHandler_SizeSequence, (void *)bundle_sizes);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &pblk);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_frame(&flow_ref, content, sizeof(content), 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_copy_full_bundle_in, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 2);
+
+    /* the second bundle does not decode, the first was already passed on */
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_frame(&flow_ref, content, sizeof(content), 0), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_copy_full_bundle_in, 4);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 3);
+
+    /* queue is full */
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_copy_full_bundle_in), sizeof(content));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_int8_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_frame(&flow_ref, content, sizeof(content), 0), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_ingress_batch(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_ingress_batch(bplib_mpool_ref_t flow_ref, const bplib_cla_bundle_buf_t *bundles,
+     * uint32_t count, int *status_list, uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_cla_bundle_buf_t       bundles[3];
+    int                          status_list[3];
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(bundles, 0, sizeof(bundles));
+    memset(status_list, 0xff, sizeof(status_list));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+
+    /* the flow is not valid, so all get the same status */
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_batch(&flow_ref, bundles, 3, status_list, 0), 0);
+    UtAssert_INT32_EQ(status_list[0], 0);
+    UtAssert_INT32_EQ(status_list[2], 0);
+
+    /* nothing decodes, so nothing is pushed */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_batch(&flow_ref, bundles, 3, status_list, 0), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[0], BP_ERROR);
+    UtAssert_INT32_EQ(status_list[1], BP_ERROR);
+    UtAssert_INT32_EQ(status_list[2], BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 0);
+
+    /* the middle bundle does not match its size, and only one of the other two fits */
+    bundles[1].size = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push_n), 1, 1);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_batch(&flow_ref, bundles, 3, status_list, 0), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[0], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[1], BP_ERROR);
+    UtAssert_INT32_EQ(status_list[2], BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_all_blocks_in_list, 2);
+
+    /* everything fits */
+    bundles[1].size = 0;
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push_n), 1, 3);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_batch(&flow_ref, bundles, 3, status_list, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[0], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[1], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[2], BP_SUCCESS);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_ingress_adopt(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_ingress_adopt(bplib_mpool_ref_t flow_ref, bplib_mpool_ref_t buffer_ref, size_t size,
+     * uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_mpool_block_content_t  buffer_ref;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&buffer_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_adopt(&flow_ref, &buffer_ref, 1, 0), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_adopt(&flow_ref, &buffer_ref, 1, 0), BP_ERROR);
+
+    /* the bundle is decoded from the buffer, never copied */
+    UT_SetHandlerFunction(UT_KEY(v7_adopt_full_bundle_in), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_int8_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_adopt(&flow_ref, &buffer_ref, 1, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_adopt_full_bundle_in, 1);
+    UtAssert_STUB_COUNT(v7_copy_full_bundle_in, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &pblk);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_adopt(&flow_ref, &buffer_ref, 0, 0), BP_TIMEOUT);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_ingress_stream(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_ingress_stream(bplib_mpool_ref_t flow_ref, bplib_cla_ingress_stream_t *stream,
+     * uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_block_t          rblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_cla_ingress_stream_t   stream;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&rblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&stream, 0, sizeof(bplib_cla_ingress_stream_t));
+
+    stream.pblk = &pblk;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_stream(&flow_ref, &stream, 0), 0);
+    UtAssert_ADDRESS_EQ(stream.pblk, &pblk);
+
+    /* the bundle is taken from the stream, even if it is no good */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_stream(&flow_ref, &stream, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_stream_import_end, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_make_block, 0);
+    UtAssert_NULL(stream.pblk);
+
+    UT_SetHandlerFunction(UT_KEY(v7_stream_import_end), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_stream_import_end), 75);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &rblk);
+    stream.pblk = &pblk;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_stream(&flow_ref, &stream, 0), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    stream.pblk = &pblk;
+    UtAssert_INT32_EQ(bplib_generic_bundle_ingress_stream(&flow_ref, &stream, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_egress(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_egress(bplib_mpool_ref_t flow_ref, void *content, size_t *size, uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    void                        *content    = NULL;
+    size_t                       size       = 1;
+    uint64_t                     time_limit = 0;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_ref_t            refptr;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_cla_stats_t            stats;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+    pri_block.block_encode_size_cache = 20; /* already encoded, so it is copied out */
+
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_out), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_NEQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_in), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &pblk);
+    UtAssert_INT32_NEQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+
+    size = 0;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), 0);
+
+    /* paced, so the egress time is when the link will have sent the part beyond the burst */
+    stats.egress_pacing.rate   = 1000;
+    stats.egress_pacing.tokens = 50;
+    size                       = 100;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_compute_full_bundle_size), 100);
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_out), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_copy_full_bundle_out), 100);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), BP_SUCCESS);
+    UtAssert_UINT32_EQ(pri_block.data.delivery.egress_time, 50);
+    UtAssert_INT32_EQ(stats.egress_pacing.tokens, -50);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_egress_bundles], 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_queue_time_10ms], 1);
+
+    /* past its lifetime, so it is dropped */
+    stats.egress_pacing.rate                      = 0;
+    pri_block.data.logical.creationTimeStamp.time = 1000;
+    pri_block.data.logical.lifetime               = 500;
+    pri_block.data.delivery.ingress_time          = 1200;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 2500);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), BP_ERROR);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_expired], 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_egress_bundles], 1);
+
+    /* still in its lifetime, after a long time in the node */
+    pri_block.data.logical.lifetime = 5000;
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_egress_bundles], 2);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_queue_time_long], 1);
+
+    /* the primary block was left to be encoded on the way out, straight into the buffer */
+    pri_block.block_encode_size_cache = 0;
+    size                              = 100;
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), BP_ERROR);
+    UtAssert_STUB_COUNT(v7_encode_full_bundle_out, 1);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_egress_bundles], 2);
+    UT_SetHandlerFunction(UT_KEY(v7_encode_full_bundle_out), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_encode_full_bundle_out), 90);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress(&flow_ref, content, &size, time_limit), BP_SUCCESS);
+    UtAssert_UINT32_EQ(size, 90);
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_egress_bundles], 3);
+    UtAssert_STUB_COUNT(v7_copy_full_bundle_out, 3);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_egress_frame(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_egress_frame(bplib_mpool_ref_t flow_ref, bplib_cla_framing_t *framing, void *content,
+     * size_t *size, uint64_t time_limit)
+     */
+    static const size_t          compute_sizes[] = {30, 50, 50, 40, 40, 300};
+    static const size_t          copy_sizes[]    = {30, 50, 40};
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_cla_framing_t          framing;
+    uint8_t                      content[200];
+    size_t                       size;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&framing, 0, sizeof(bplib_cla_framing_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    pri_block.block_encode_size_cache = 20;
+    framing.mtu                       = 100;
+
+    size = sizeof(content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_frame(&flow_ref, &framing, content, &size, 0), 0);
+
+    /* queue is empty */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_frame(&flow_ref, &framing, content, &size, 0), BP_TIMEOUT);
+    UtAssert_ZERO(size);
+
+    /* two bundles fit in the mtu, the third is held for the next frame */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_cla_AltHandler_SizeSequence,
+                          (void *)compute_sizes);
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_out), UT_lib_cla_AltHandler_SizeSequence, (void *)copy_sizes);
+    size = sizeof(content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_frame(&flow_ref, &framing, content, &size, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(size, 80);
+    UtAssert_ADDRESS_EQ(framing.holdover, &pblk);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 4);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+
+    /* with packing off, only the held over bundle goes */
+    framing.mtu = 0;
+    size        = sizeof(content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_frame(&flow_ref, &framing, content, &size, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(size, 40);
+    UtAssert_NULL(framing.holdover);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 4);
+
+    /* the first bundle does not fit in the buffer at all, and is dropped */
+    size = sizeof(content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_frame(&flow_ref, &framing, content, &size, 0), BP_ERROR);
+    UtAssert_ZERO(size);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 4);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_egress_batch(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_egress_batch(bplib_mpool_ref_t flow_ref, bplib_cla_egress_buf_t *buffers,
+     * uint32_t count, uint32_t *num_filled, uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_cla_egress_buf_t       buffers[3];
+    uint8_t                      content[3][50];
+    uint32_t                     num_filled;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_bblock_primary_t pri_block;
+    uint32_t                     i;
+    size_t                       export_sizes[] = {20, 100, 30};
+    size_t                       copy_sizes[]   = {20, 30};
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    pri_block.block_encode_size_cache = 20;
+    for (i = 0; i < 3; ++i)
+    {
+        buffers[i].bundle = content[i];
+        buffers[i].size   = sizeof(content[i]);
+    }
+
+    /* the flow is not valid */
+    num_filled = 1;
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_batch(&flow_ref, buffers, 3, &num_filled, 0), 0);
+    UtAssert_UINT32_EQ(num_filled, 0);
+
+    /* nothing in the queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull_n), UT_lib_cla_AltHandler_PullBatch, &pblk);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_batch(&flow_ref, buffers, 3, &num_filled, 0), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(num_filled, 0);
+
+    /* three bundles, the second of which does not fit, so it is dropped and the others fill two buffers */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_try_pull_n), 3);
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_cla_AltHandler_SizeSequence, export_sizes);
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_out), UT_lib_cla_AltHandler_SizeSequence, copy_sizes);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_batch(&flow_ref, buffers, 3, &num_filled, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_filled, 2);
+    UtAssert_UINT32_EQ(buffers[0].size, 20);
+    UtAssert_UINT32_EQ(buffers[1].size, 30);
+    UtAssert_UINT32_EQ(buffers[2].size, sizeof(content[2]));
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 3);
+    UtAssert_STUB_COUNT(bplib_mpool_release_defer_begin, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_release_defer_end, 1);
+
+    /* one bundle that does not fit */
+    UT_ResetState(UT_KEY(v7_compute_full_bundle_size));
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), UT_lib_cla_AltHandler_SizeSequence, export_sizes + 1);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_try_pull_n), 1);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_batch(&flow_ref, buffers, 1, &num_filled, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(num_filled, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull_n), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(v7_compute_full_bundle_size), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(v7_copy_full_bundle_out), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_egress_iov(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_egress_iov(bplib_mpool_ref_t flow_ref, bplib_iovec_t *iov, uint32_t *iov_count,
+     * bplib_mpool_ref_t *bundle_ref, size_t *size, uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_mpool_block_content_t  bundle_content;
+    bplib_iovec_t                iov[4];
+    uint32_t                     iov_count;
+    bplib_mpool_ref_t            bundle_ref;
+    size_t                       size;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&bundle_content, 0, sizeof(bplib_mpool_block_content_t));
+    memset(iov, 0, sizeof(iov));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    iov_count = 4;
+    size      = 0;
+
+    /* the flow is not valid */
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0), 0);
+    UtAssert_NULL(bundle_ref);
+
+    /* nothing in the queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0),
+                      BP_TIMEOUT);
+    UtAssert_NULL(bundle_ref);
+
+    /* a ref block that is not to a bundle, the ref is released again */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &bundle_content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0), BP_ERROR);
+    UtAssert_NULL(bundle_ref);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    /* not enough entries */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UT_SetDefaultReturnValue(UT_KEY(v7_export_full_bundle_iov), 5);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0), BP_ERROR);
+    UtAssert_NULL(bundle_ref);
+    UtAssert_UINT32_EQ(iov_count, 5);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 2);
+
+    /* nominal, the ref is kept for the caller */
+    iov_count = 4;
+    UT_SetDefaultReturnValue(UT_KEY(v7_export_full_bundle_iov), 3);
+    UT_SetDefaultReturnValue(UT_KEY(v7_compute_full_bundle_size), 40);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bundle_ref, &bundle_content);
+    UtAssert_UINT32_EQ(iov_count, 3);
+    UtAssert_UINT32_EQ(size, 40);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 2);
+
+    /* a block that is not a ref block becomes managed by the new ref */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &bundle_content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bundle_ref, &bundle_content);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 3);
+
+    /* which may fail */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_iov(&flow_ref, iov, &iov_count, &bundle_ref, &size, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 4);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_generic_bundle_egress_stream(void)
+{
+    /* Test function for:
+     * int bplib_generic_bundle_egress_stream(bplib_mpool_ref_t flow_ref, bplib_cla_egress_stream_t *stream, size_t
+     * *size, uint64_t time_limit)
+     */
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_mpool_block_content_t  bundle_content;
+    bplib_cla_egress_stream_t    stream;
+    size_t                       size;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_bblock_primary_t pri_block;
+
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&bundle_content, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stream, 0, sizeof(bplib_cla_egress_stream_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    size = 0;
+
+    /* the flow is not valid */
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_stream(&flow_ref, &stream, &size, 0), 0);
+
+    /* nothing in the queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_stream(&flow_ref, &stream, &size, 0), BP_TIMEOUT);
+
+    /* a ref block that is not to a bundle, the ref is released again */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &bundle_content);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_stream(&flow_ref, &stream, &size, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+    UtAssert_STUB_COUNT(v7_stream_export_begin, 0);
+
+    /* could not be encoded */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_stream(&flow_ref, &stream, &size, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 2);
+    UtAssert_NULL(stream.bundle_ref);
+
+    /* nominal, the stream keeps the ref */
+    UT_SetHandlerFunction(UT_KEY(v7_stream_export_begin), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(v7_stream_export_begin), 40);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_stream(&flow_ref, &stream, &size, 0), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(stream.bundle_ref, &bundle_content);
+    UtAssert_UINT32_EQ(size, 40);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 2);
+
+    /* expired */
+    pri_block.data.logical.creationTimeStamp.time = 1;
+    pri_block.data.logical.lifetime               = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 1000);
+    UtAssert_INT32_EQ(bplib_generic_bundle_egress_stream(&flow_ref, &stream, &size, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 3);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
@@ -240,9 +2376,40 @@ void test_bplib_generic_bundle_egress(void)
 void TestBplibBase_ClaApi_Register(void)
 {
     UtTest_Add(test_bplib_create_cla_intf, NULL, NULL, "Test bplib_create_cla_intf");
+    UtTest_Add(test_bplib_create_cla_intf_ext, NULL, NULL, "Test bplib_create_cla_intf_ext");
     UtTest_Add(test_bplib_cla_ingress, NULL, NULL, "Test bplib_cla_ingress");
+    UtTest_Add(test_bplib_cla_ingress_batch, NULL, NULL, "Test bplib_cla_ingress_batch");
+    UtTest_Add(test_bplib_cla_rxbuf_get, NULL, NULL, "Test bplib_cla_rxbuf_get");
+    UtTest_Add(test_bplib_cla_ingress_adopt, NULL, NULL, "Test bplib_cla_ingress_adopt");
+    UtTest_Add(test_bplib_cla_ingress_begin, NULL, NULL, "Test bplib_cla_ingress_begin");
+    UtTest_Add(test_bplib_cla_ingress_feed, NULL, NULL, "Test bplib_cla_ingress_feed");
+    UtTest_Add(test_bplib_cla_ingress_end, NULL, NULL, "Test bplib_cla_ingress_end");
     UtTest_Add(test_bplib_cla_egress, NULL, NULL, "Test bplib_cla_egress");
+    UtTest_Add(test_bplib_cla_egress_batch, NULL, NULL, "Test bplib_cla_egress_batch");
+    UtTest_Add(test_bplib_cla_egress_iov, NULL, NULL, "Test bplib_cla_egress_iov");
+    UtTest_Add(test_bplib_cla_egress_stream, NULL, NULL, "Test bplib_cla_egress_stream");
+    UtTest_Add(test_bplib_cla_get_notify_fd, NULL, NULL, "Test bplib_cla_get_notify_fd");
     UtTest_Add(test_bplib_cla_event_impl, NULL, NULL, "Test bplib_cla_event_impl");
+    UtTest_Add(test_bplib_cla_destruct_intf, NULL, NULL, "Test bplib_cla_destruct_intf");
+    UtTest_Add(test_bplib_cla_destruct_ingress_stream, NULL, NULL, "Test bplib_cla_destruct_ingress_stream");
+    UtTest_Add(test_bplib_cla_destruct_egress_stream, NULL, NULL, "Test bplib_cla_destruct_egress_stream");
+    UtTest_Add(test_bplib_cla_query_integer, NULL, NULL, "Test bplib_cla_query_integer");
+    UtTest_Add(test_bplib_cla_count_drop, NULL, NULL, "Test bplib_cla_count_drop");
+    UtTest_Add(test_bplib_cla_config_integer, NULL, NULL, "Test bplib_cla_config_integer");
+    UtTest_Add(test_bplib_cla_push_egress_bundle, NULL, NULL, "Test bplib_cla_push_egress_bundle");
+    UtTest_Add(test_bplib_cla_verify_ingress, NULL, NULL, "Test bplib_cla_verify_ingress");
+    UtTest_Add(test_bplib_cla_ingress_defer_decode, NULL, NULL, "Test bplib_cla_ingress_defer_decode");
+    UtTest_Add(test_bplib_cla_decode_ingress, NULL, NULL, "Test bplib_cla_decode_ingress");
+    UtTest_Add(test_bplib_cla_reassemble_ingress, NULL, NULL, "Test bplib_cla_reassemble_ingress");
     UtTest_Add(test_bplib_generic_bundle_ingress, NULL, NULL, "Test bplib_generic_bundle_ingress");
+    UtTest_Add(test_bplib_cla_ingress_dedup, NULL, NULL, "Test bplib_cla_ingress_dedup");
+    UtTest_Add(test_bplib_generic_bundle_ingress_frame, NULL, NULL, "Test bplib_generic_bundle_ingress_frame");
+    UtTest_Add(test_bplib_generic_bundle_ingress_batch, NULL, NULL, "Test bplib_generic_bundle_ingress_batch");
+    UtTest_Add(test_bplib_generic_bundle_ingress_adopt, NULL, NULL, "Test bplib_generic_bundle_ingress_adopt");
+    UtTest_Add(test_bplib_generic_bundle_ingress_stream, NULL, NULL, "Test bplib_generic_bundle_ingress_stream");
     UtTest_Add(test_bplib_generic_bundle_egress, NULL, NULL, "Test bplib_generic_bundle_egress");
+    UtTest_Add(test_bplib_generic_bundle_egress_frame, NULL, NULL, "Test bplib_generic_bundle_egress_frame");
+    UtTest_Add(test_bplib_generic_bundle_egress_batch, NULL, NULL, "Test bplib_generic_bundle_egress_batch");
+    UtTest_Add(test_bplib_generic_bundle_egress_iov, NULL, NULL, "Test bplib_generic_bundle_egress_iov");
+    UtTest_Add(test_bplib_generic_bundle_egress_stream, NULL, NULL, "Test bplib_generic_bundle_egress_stream");
 }
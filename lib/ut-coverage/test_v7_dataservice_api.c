@@ -25,6 +25,320 @@
 #include "bplib_dataservice.h"
 #include "test_bplib_base.h"
 
+static void UT_lib_dataservice_AltHandler_PullBatch(void *UserObj, UT_EntryKey_t FuncKey,
+                                                    const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *list = UT_Hook_GetArgValueByName(Context, "list", bplib_mpool_block_t *);
+    int32                StatusCode;
+    uint32_t             retval;
+
+    /* the list is not really changed by the extract stub, so every pull gives the same block */
+    UT_Stub_GetInt32StatusCode(Context, &StatusCode);
+    retval = StatusCode;
+    if (retval != 0)
+    {
+        list->next = UserObj;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+/* more endpoints than the hash table will hold, so some of them overflow */
+#define UT_LIB_SVCHASH_ENDPOINTS (BPLIB_SERVICE_HASH_SLOTS + 8)
+
+typedef struct
+{
+    bplib_mpool_block_t            base_blk;
+    bplib_route_serviceintf_info_t base_intf;
+    bplib_service_hash_t           hash;
+    bplib_mpool_block_t            endpt_blk[UT_LIB_SVCHASH_ENDPOINTS];
+    bplib_service_endpt_t          endpt[UT_LIB_SVCHASH_ENDPOINTS];
+    uint32_t                       next_alloc;
+    bp_ipn_addr_t                  bundle_dest;
+} UT_lib_svchash_t;
+
+static UT_lib_svchash_t UT_lib_svchash;
+
+/* endpoint i is used for service number (i + 1) */
+static void UT_lib_svchash_AltHandler_DataCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *cb     = UT_Hook_GetArgValueByName(Context, "cb", bplib_mpool_block_t *);
+    void                *retval = NULL;
+
+    if (cb == &UT_lib_svchash.base_blk)
+    {
+        retval = &UT_lib_svchash.base_intf;
+    }
+    else if (cb >= UT_lib_svchash.endpt_blk && cb < &UT_lib_svchash.endpt_blk[UT_LIB_SVCHASH_ENDPOINTS])
+    {
+        retval = &UT_lib_svchash.endpt[cb - UT_lib_svchash.endpt_blk];
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_svchash_AltHandler_DataAlloc(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    void *retval = NULL;
+
+    if (UT_lib_svchash.next_alloc < UT_LIB_SVCHASH_ENDPOINTS)
+    {
+        retval = &UT_lib_svchash.endpt_blk[UT_lib_svchash.next_alloc];
+        ++UT_lib_svchash.next_alloc;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_svchash_AltHandler_Search(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bp_val_t          key    = UT_Hook_GetArgValueByName(Context, "search_key_value", bp_val_t);
+    bplib_rbt_link_t *retval = NULL;
+
+    if (key > 0 && key <= UT_LIB_SVCHASH_ENDPOINTS)
+    {
+        retval = &UT_lib_svchash.endpt[key - 1].rbt_link;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_svchash_AltHandler_GetEid(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bp_ipn_addr_t *bp_addr = UT_Hook_GetArgValueByName(Context, "bp_addr", bp_ipn_addr_t *);
+
+    *bp_addr = UT_lib_svchash.bundle_dest;
+}
+
+/* gives a bundle on every other call, so each bplib_serviceflow_forward_egress() call forwards one */
+static void UT_lib_svchash_AltHandler_TryPull(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    void *retval = NULL;
+
+    if (UT_GetStubCount(UT_KEY(bplib_mpool_flow_try_pull)) & 1)
+    {
+        retval = UserObj;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+/*
+ * Sets up a base interface with the hash table and adds all the endpoints to it
+ */
+static void UT_lib_svchash_Setup(void)
+{
+    uint32_t i;
+
+    memset(&UT_lib_svchash, 0, sizeof(UT_lib_svchash));
+    UT_lib_svchash.base_intf.service_hash = &UT_lib_svchash.hash;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_svchash_AltHandler_DataCast, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_svchash_AltHandler_DataAlloc, NULL);
+
+    for (i = 0; i < UT_LIB_SVCHASH_ENDPOINTS; ++i)
+    {
+        UtAssert_INT32_EQ(bplib_serviceflow_add_to_base(&UT_lib_svchash.base_blk, i + 1,
+                                                        bplib_dataservice_type_application, NULL),
+                          BP_SUCCESS);
+
+        /* the ref is only passed along, so any distinct non-NULL value will do */
+        UT_lib_svchash.endpt[i].subflow_ref = (bplib_mpool_ref_t)&UT_lib_svchash.endpt_blk[i];
+    }
+}
+
+static void UT_lib_svchash_Teardown(void)
+{
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+typedef struct
+{
+    bplib_mpool_block_t  sock_blk;
+    bplib_socket_info_t  sock;
+    bplib_mpool_block_t  trace_blk;
+    bplib_socket_trace_t trace;
+} UT_lib_trace_t;
+
+static UT_lib_trace_t UT_lib_trace;
+
+static void UT_lib_trace_AltHandler_DataCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *cb     = UT_Hook_GetArgValueByName(Context, "cb", bplib_mpool_block_t *);
+    void                *retval = NULL;
+
+    if (cb == &UT_lib_trace.sock_blk)
+    {
+        retval = &UT_lib_trace.sock;
+    }
+    else if (cb == &UT_lib_trace.trace_blk)
+    {
+        retval = &UT_lib_trace.trace;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+/*
+ * Sets up a socket and its histograms, the descriptor is the socket block
+ */
+static bp_socket_t *UT_lib_trace_Setup(void)
+{
+    memset(&UT_lib_trace, 0, sizeof(UT_lib_trace));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_trace_AltHandler_DataCast, NULL);
+
+    return (bp_socket_t *)&UT_lib_trace.sock_blk;
+}
+
+/*
+ * A socket with a completion queue, and one op sent on it
+ */
+typedef struct
+{
+    bplib_mpool_block_t        sock_blk;
+    bplib_socket_info_t        sock;
+    bplib_mpool_block_t        cq_blk;
+    bplib_socket_completions_t cq;
+    bplib_mpool_block_t        op_blk;
+    bplib_socket_async_op_t    op;
+    bplib_completion_t         ring[8];
+    int                        lock;
+} UT_lib_cq_t;
+
+static UT_lib_cq_t UT_lib_cq;
+
+static void UT_lib_cq_AltHandler_DataCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *cb     = UT_Hook_GetArgValueByName(Context, "cb", bplib_mpool_block_t *);
+    void                *retval = NULL;
+
+    if (cb == &UT_lib_cq.sock_blk)
+    {
+        retval = &UT_lib_cq.sock;
+    }
+    else if (cb == &UT_lib_cq.cq_blk)
+    {
+        retval = &UT_lib_cq.cq;
+    }
+    else if (cb == &UT_lib_cq.op_blk)
+    {
+        retval = &UT_lib_cq.op;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+/*
+ * Sets up a socket whose queue has room for two ops, the descriptor is the socket block
+ */
+static bp_socket_t *UT_lib_cq_Setup(void)
+{
+    memset(&UT_lib_cq, 0, sizeof(UT_lib_cq));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_cq_AltHandler_DataCast, NULL);
+
+    UT_lib_cq.sock.completions_ref = (bplib_mpool_ref_t)&UT_lib_cq.cq_blk;
+    UT_lib_cq.cq.lock              = (bplib_os_mutex_t *)&UT_lib_cq.lock;
+    UT_lib_cq.cq.ring              = UT_lib_cq.ring;
+    UT_lib_cq.cq.ring_size         = 8;
+    UT_lib_cq.cq.max_in_flight     = 2;
+    UT_lib_cq.op.cq_ref            = (bplib_mpool_ref_t)&UT_lib_cq.cq_blk;
+    UT_lib_cq.op.user_tag          = 42;
+
+    return (bp_socket_t *)&UT_lib_cq.sock_blk;
+}
+
+/*
+ * A socket bound under a base interface, for the direct local delivery tests
+ */
+typedef struct
+{
+    bplib_mpool_block_t            sock_blk;
+    bplib_socket_info_t            sock;
+    bplib_mpool_block_t            base_blk;
+    bplib_route_serviceintf_info_t base_intf;
+} UT_lib_local_t;
+
+static UT_lib_local_t UT_lib_local;
+
+static void UT_lib_local_AltHandler_DataCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *cb     = UT_Hook_GetArgValueByName(Context, "cb", bplib_mpool_block_t *);
+    void                *retval = NULL;
+
+    if (cb == &UT_lib_local.sock_blk)
+    {
+        retval = &UT_lib_local.sock;
+    }
+    else if (cb == &UT_lib_local.base_blk)
+    {
+        retval = &UT_lib_local.base_intf;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+/*
+ * A coalescing buffer as bplib_socket_set_coalescing() makes it, and what went in and out of it
+ */
+typedef struct
+{
+    bplib_socket_coalesce_t co;
+    uint8_t                 buf[64];
+    uint8_t                 encoded[64];
+    size_t                  encoded_size;
+    uint8_t                 payload[16];
+} UT_lib_coalesce_t;
+
+static UT_lib_coalesce_t UT_lib_coalesce;
+
+static void UT_lib_coalesce_AltHandler_EncodePay(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    const void *data_ptr  = UT_Hook_GetArgValueByName(Context, "data_ptr", const void *);
+    size_t      data_size = UT_Hook_GetArgValueByName(Context, "data_size", size_t);
+    int         retval    = 0;
+
+    UT_lib_coalesce.encoded_size = data_size;
+    if (data_size <= sizeof(UT_lib_coalesce.encoded))
+    {
+        memcpy(UT_lib_coalesce.encoded, data_ptr, data_size);
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_lib_coalesce_AltHandler_Export(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    void  *out_ptr    = UT_Hook_GetArgValueByName(Context, "out_ptr", void *);
+    size_t seek_start = UT_Hook_GetArgValueByName(Context, "seek_start", size_t);
+    size_t max_count  = UT_Hook_GetArgValueByName(Context, "max_count", size_t);
+
+    /* the payload content starts at offset 1 of the encoded block */
+    memcpy(out_ptr, &UT_lib_coalesce.payload[seek_start - 1], max_count);
+
+    UT_Stub_SetReturnValue(FuncKey, max_count);
+}
+
+/*
+ * Sets up the socket with a coalescing buffer of max_size bytes
+ */
+static void UT_lib_coalesce_Setup(bplib_socket_info_t *sock, size_t max_size, uint32_t max_delay)
+{
+    memset(&UT_lib_coalesce, 0, sizeof(UT_lib_coalesce));
+    UT_lib_coalesce.co.tx_lock   = (bplib_os_mutex_t *)&UT_lib_coalesce.buf;
+    UT_lib_coalesce.co.rx_lock   = (bplib_os_mutex_t *)&UT_lib_coalesce.buf;
+    UT_lib_coalesce.co.buf       = UT_lib_coalesce.buf;
+    UT_lib_coalesce.co.buf_size  = sizeof(UT_lib_coalesce.buf);
+    UT_lib_coalesce.co.max_size  = max_size;
+    UT_lib_coalesce.co.max_delay = max_delay;
+    sock->coalesce               = &UT_lib_coalesce.co;
+}
+
+static void test_bplib_payload_release_stub(void *release_arg, const void *payload, size_t size)
+{
+    UT_DEFAULT_IMPL(test_bplib_payload_release_stub);
+}
+
 void test_bplib_dataservice_add_base_intf(void)
 {
     /* Test function for:
@@ -62,8 +376,12 @@ void test_bplib_dataservice_attach(void)
     bplib_mpool_block_t         sblk;
     bplib_mpool_ref_t           flow_ref;
     bplib_mpool_block_t         temp_block;
+    bplib_routeset_t            route_sets[2];
+    bplib_routeentry_t          route_entry[2];
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 1);
     memset(&ipn, 0, sizeof(bp_ipn_addr_t));
     memset(&blkref, 0, sizeof(bplib_mpool_block_content_t));
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
@@ -104,8 +422,12 @@ void test_bplib_dataservice_detach(void)
     bplib_mpool_ref_t   flow_ref;
     bplib_rbt_link_t    rbt_link;
     bplib_mpool_block_t temp_block;
+    bplib_routeset_t    route_sets[2];
+    bplib_routeentry_t  route_entry[2];
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 1);
     ipn.node_number    = 10;
     ipn.service_number = 100;
     memset(&ipn, 0, sizeof(bp_ipn_addr_t));
@@ -166,6 +488,21 @@ void test_bplib_connect_socket(void)
     destination_ipn.node_number        = 2;
     sock.params.remote_ipn.node_number = 0;
     UtAssert_UINT32_EQ(bplib_connect_socket(&desc, &destination_ipn), 0);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_template, 2);
+    UtAssert_NOT_NULL(sock.pri_template);
+
+    /* a primary block that does not fit a template still connects, it is just encoded in full */
+    sock.params.remote_ipn.node_number = 0;
+    UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pri_template), -1);
+    UtAssert_UINT32_EQ(bplib_connect_socket(&desc, &destination_ipn), 0);
+    UtAssert_NULL(sock.pri_template);
+
+    /* the template block is only allocated once */
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 3);
+    sock.params.remote_ipn.node_number = 0;
+    sock.pri_template_blk              = (bplib_mpool_block_t *)&rbtl;
+    UtAssert_UINT32_EQ(bplib_connect_socket(&desc, &destination_ipn), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 3);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
@@ -206,11 +543,15 @@ void test_bplib_bind_socket(void)
     bplib_routetbl_t    rtbl;
     bplib_mpool_block_t sblk;
     bplib_mpool_ref_t   flow_ref;
+    bplib_routeset_t    route_sets[2];
+    bplib_routeentry_t  route_entry[2];
 
     memset(&desc, 0, sizeof(bp_socket_t));
     memset(&source_ipn, 0, sizeof(bp_ipn_addr_t));
     memset(&sock, 0, sizeof(bplib_socket_info_t));
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 1);
     sock.parent_rtbl = &rtbl;
     memset(&sblk, 0, sizeof(bplib_mpool_block_t));
     memset(&flow_ref, 0, sizeof(bplib_mpool_ref_t));
@@ -255,12 +596,16 @@ void test_bplib_close_socket(void)
     bplib_routetbl_t               rtbl;
     bplib_route_serviceintf_info_t base_intf;
     bplib_mpool_ref_t              ref;
+    bplib_routeset_t               route_sets[2];
+    bplib_routeentry_t             route_entry[2];
 
     memset(&desc, 0, sizeof(bp_socket_t));
     memset(&sock, 0, sizeof(bplib_socket_info_t));
     sock.params.local_ipn.node_number    = 10;
     sock.params.local_ipn.service_number = 11;
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 1);
     sock.parent_rtbl = &rtbl;
     memset(&base_intf, 0, sizeof(bplib_route_serviceintf_info_t));
     memset(&ref, 0, sizeof(bplib_mpool_ref_t));
@@ -291,11 +636,14 @@ void test_bplib_send(void)
     bplib_mpool_ref_t              refptr;
     bplib_mpool_bblock_primary_t   pri;
     bplib_mpool_bblock_canonical_t ccb_pay;
+    bp_pri_template_t              tmpl;
 
     memset(&desc, 0, sizeof(bp_socket_t));
     memset(&sock, 0, sizeof(bplib_socket_info_t));
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
-    sock.parent_rtbl = &rtbl;
+    memset(&tmpl, 0, sizeof(bp_pri_template_t));
+    sock.parent_rtbl  = &rtbl;
+    sock.pri_template = &tmpl;
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
     memset(&blk, 0, sizeof(bplib_mpool_block_t));
     memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
@@ -334,10 +682,29 @@ void test_bplib_send(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_send(&desc, payload, size, timeout), 0);
 
+    /* non-blocking, the queue is seen to be full before anything is made */
+    UT_ResetState(UT_KEY(bplib_mpool_bblock_primary_alloc));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    sock.nonblocking = true;
+    UtAssert_INT32_EQ(bplib_send(&desc, payload, size, timeout), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 0);
+
+    flow.ingress.current_depth_limit = 1;
+    UtAssert_INT32_EQ(bplib_send(&desc, payload, size, timeout), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_primary_alloc, 1);
+    sock.nonblocking = false;
+
+    /* without a template, the primary block is encoded in full */
+    sock.pri_template = NULL;
     UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pri), -1);
     UtAssert_UINT32_NEQ(bplib_send(&desc, payload, size, timeout), 0);
+    UtAssert_STUB_COUNT(v7_block_encode_pri, 1);
+    sock.pri_template = &tmpl;
+
+    UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pri_from_template), -1);
+    UtAssert_UINT32_NEQ(bplib_send(&desc, payload, size, timeout), 0);
 
-    UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pri), 1);
+    UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pri_from_template), 1);
     UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pay), -1);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, &blk);
     UtAssert_UINT32_NEQ(bplib_send(&desc, payload, size, timeout), 0);
@@ -352,6 +719,200 @@ void test_bplib_send(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_send_many(void)
+{
+    /* Test function for:
+     * int bplib_send_many(bp_socket_t *desc, const bplib_send_buf_t *payloads, uint32_t count, int *status_list,
+     *                     uint32_t timeout)
+     */
+    bp_socket_t                    desc;
+    uint8_t                        payload[10];
+    bplib_send_buf_t               payloads[3];
+    int                            status_list[3];
+    bplib_socket_info_t            sock;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_flow_t             flow;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_primary_t   pri;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+    bp_pri_template_t              tmpl;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(payload, 0, sizeof(payload));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&tmpl, 0, sizeof(bp_pri_template_t));
+    sock.parent_rtbl  = &rtbl;
+    sock.pri_template = &tmpl;
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    payloads[0].payload = payload;
+    payloads[0].size    = 4;
+    payloads[1].payload = payload;
+    payloads[1].size    = 6;
+    payloads[2].payload = payload;
+    payloads[2].size    = 10;
+
+    /* bad descriptor and unconnected socket fail every payload */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 0), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[2], BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 0), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[0], BP_ERROR);
+
+    /* no blocks to make the bundles with */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 0), BP_TIMEOUT);
+    UtAssert_INT32_EQ(status_list[0], BP_TIMEOUT);
+    UtAssert_INT32_EQ(status_list[2], BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 0);
+
+    /* all three are made, but only two fit in the queue */
+    UT_SetHandlerFunction(UT_KEY(v7_get_current_time), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push_n), 1, 2);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 0), BP_TIMEOUT);
+    UtAssert_INT32_EQ(status_list[0], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[1], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[2], BP_TIMEOUT);
+    UtAssert_UINT32_EQ(sock.ingress_byte_count, 10);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 3);
+
+    /* the middle one cannot be bundleized, the others all fit */
+    UT_SetDeferredRetcode(UT_KEY(v7_block_encode_pri_from_template), 2, -1);
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push_n), 1, 2);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 0), BP_ERROR);
+    UtAssert_INT32_EQ(status_list[0], BP_SUCCESS);
+    UtAssert_INT32_NEQ(status_list[1], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[2], BP_SUCCESS);
+    UtAssert_UINT32_EQ(sock.ingress_byte_count, 24);
+
+    /* everything fits */
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push_n), 1, 3);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[2], BP_SUCCESS);
+    UtAssert_UINT32_EQ(sock.ingress_byte_count, 44);
+
+    /* non-blocking, only as many are made as the queue has room for, and nothing if it is full */
+    UT_ResetState(UT_KEY(bplib_mpool_insert_before));
+    sock.nonblocking                 = true;
+    flow.ingress.current_depth_limit = 2;
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push_n), 1, 2);
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 3000), BP_TIMEOUT);
+    UtAssert_INT32_EQ(status_list[0], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[1], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[2], BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 2);
+    UtAssert_UINT32_EQ(sock.ingress_byte_count, 54);
+
+    flow.ingress.base_subq.push_count = 2;
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 3, status_list, 3000), BP_TIMEOUT);
+    UtAssert_INT32_EQ(status_list[0], BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push_n, 4);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_send_extern(void)
+{
+    /* Test function for:
+     * int bplib_send_extern(bp_socket_t *desc, const void *payload, size_t size,
+     *                       bplib_payload_release_func_t release_func, void *release_arg, uint32_t timeout)
+     */
+    bp_socket_t                    desc;
+    uint8_t                        payload[10];
+    bplib_socket_info_t            sock;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_flow_t             flow;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_primary_t   pri;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(payload, 0, sizeof(payload));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    sock.parent_rtbl = &rtbl;
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+
+    /* the buffer is given back right away if it cannot be used at all */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_send_extern(&desc, payload, sizeof(payload), test_bplib_payload_release_stub, &sock, 0),
+                      BP_ERROR);
+    UtAssert_STUB_COUNT(test_bplib_payload_release_stub, 1);
+    UtAssert_INT32_EQ(bplib_send_extern(&desc, payload, sizeof(payload), NULL, NULL, 0), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_send_extern(&desc, payload, sizeof(payload), test_bplib_payload_release_stub, &sock, 0),
+                      BP_ERROR);
+    UtAssert_STUB_COUNT(test_bplib_payload_release_stub, 2);
+
+    /* once the block is made, recycling it gives the buffer back */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_extern_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UtAssert_INT32_EQ(bplib_send_extern(&desc, payload, sizeof(payload), test_bplib_payload_release_stub, &sock, 0),
+                      BP_ERROR);
+    UtAssert_STUB_COUNT(test_bplib_payload_release_stub, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    /* nominal, the payload is encoded by reference */
+    UT_SetHandlerFunction(UT_KEY(v7_get_current_time), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_send_extern(&desc, payload, sizeof(payload), test_bplib_payload_release_stub, &sock, 0),
+                      BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_block_encode_pay_extern, 1);
+    UtAssert_STUB_COUNT(v7_block_encode_pay, 0);
+    UtAssert_UINT32_EQ(sock.ingress_byte_count, sizeof(payload));
+
+    /* the payload cannot be encoded */
+    UT_SetDefaultReturnValue(UT_KEY(v7_block_encode_pay_extern), -1);
+    UtAssert_INT32_NEQ(bplib_send_extern(&desc, payload, sizeof(payload), test_bplib_payload_release_stub, &sock, 0),
+                       BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_payload_release_stub, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_extern_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
 void test_bplib_recv(void)
 {
     /* Test function for:
@@ -405,7 +966,10 @@ void test_bplib_recv(void)
     ccb_pay.encoded_content_offset = 1;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), UT_lib_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 2000);
     UtAssert_UINT32_EQ(bplib_recv(&desc, payload, &size, timeout), 0);
+    UtAssert_UINT32_EQ(pri.data.delivery.stage_time[bplib_trace_stage_recv], 2000);
 
     UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_export), 1);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_lib_uint64_Handler, NULL);
@@ -414,6 +978,17 @@ void test_bplib_recv(void)
     ccb_pay.encoded_content_offset = 0;
     UtAssert_UINT32_NEQ(bplib_recv(&desc, payload, &size, timeout), 0);
 
+    /* non-blocking, the queue is seen to be empty without pulling */
+    UT_ResetState(UT_KEY(bplib_mpool_flow_try_pull));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &blk);
+    sock.nonblocking = true;
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 3000), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 0);
+
+    flow.egress.base_subq.push_count = 1;
+    UtAssert_UINT32_NEQ(bplib_recv(&desc, payload, &size, 3000), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 1);
+
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
@@ -421,38 +996,1124 @@ void test_bplib_recv(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
-void test_bplib_serviceflow_forward_ingress(void)
+void test_bplib_recv_many(void)
 {
     /* Test function for:
-     * int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
+     * int bplib_recv_many(bp_socket_t *desc, bplib_recv_buf_t *buffers, uint32_t count, uint32_t *num_filled,
+     *                     uint32_t timeout)
      */
-    bplib_routetbl_t    tbl;
-    bplib_mpool_block_t subq_src;
-    bplib_mpool_block_t sblk;
+    bp_socket_t                    desc;
+    uint8_t                        payload[10];
+    bplib_recv_buf_t               buffers[2];
+    uint32_t                       num_filled;
+    bplib_socket_info_t            sock;
+    bplib_mpool_flow_t             flow;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+    bplib_mpool_bblock_primary_t   pri;
 
-    memset(&tbl, 0, sizeof(bplib_routetbl_t));
-    memset(&subq_src, 0, sizeof(bplib_mpool_block_t));
-    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    sock.parent_rtbl = &rtbl;
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    buffers[0].payload = payload;
+    buffers[0].size    = sizeof(payload);
+    buffers[1].payload = payload;
+    buffers[1].size    = sizeof(payload);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_lib_sizet_Handler, NULL);
-    UtAssert_UINT32_EQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(num_filled, 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
-    UtAssert_UINT32_NEQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 0), BP_ERROR);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &sblk);
-    UtAssert_UINT32_EQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+    /* nothing in the queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull_n), UT_lib_dataservice_AltHandler_PullBatch, &blk);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 3000), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(num_filled, 0);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_ingress_AltHandler_PointerReturn, &sblk);
-    UtAssert_UINT32_NEQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+    /* two bundles that cannot be delivered are both dropped */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_try_pull_n), 2);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(num_filled, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+
+    /* two bundles delivered, one per buffer */
+    ccb_pay.encoded_content_offset = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_locate_canonical), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_lib_sizet_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_filled, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull_n, 3);
+
+    /* non-blocking, the queue is seen to be empty without pulling */
+    sock.nonblocking = true;
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 3000), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(num_filled, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull_n, 3);
+
+    flow.egress.base_subq.push_count = 2;
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 2, &num_filled, 3000), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_filled, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull_n, 4);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull_n), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
-void test_bplib_serviceflow_forward_egress(void)
+void test_bplib_recv_view(void)
+{
+    /* Test function for:
+     * int bplib_recv_view(bp_socket_t *desc, bplib_iovec_t *iov, uint32_t *iov_count, size_t *size,
+     *                     bplib_mpool_ref_t *payload_ref, uint32_t timeout)
+     */
+    bp_socket_t                    desc;
+    bplib_iovec_t                  iov[2];
+    uint32_t                       iov_count;
+    size_t                         size;
+    bplib_mpool_ref_t              payload_ref;
+    bplib_socket_info_t            sock;
+    bplib_mpool_flow_t             flow;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+    bplib_mpool_bblock_primary_t   pri;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    sock.parent_rtbl = &rtbl;
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    size      = 0;
+    iov_count = 2;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+    UtAssert_NULL(payload_ref);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+
+    /* nothing in the queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 3000), BP_TIMEOUT);
+    UtAssert_NULL(payload_ref);
+
+    /* non-blocking, the queue is seen to be empty without pulling */
+    sock.nonblocking = true;
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 3000), BP_TIMEOUT);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 1);
+    sock.nonblocking = false;
+
+    /* no ref could be made, the block is recycled */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &blk);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(payload_ref);
+
+    /* not a bundle, the ref is released */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &refptr);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+    UtAssert_NULL(payload_ref);
+
+    /* no payload */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+
+    /* bad offset */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+
+    /* not enough entries, reports how many are needed and drops the bundle */
+    ccb_pay.encoded_content_offset = 4;
+    ccb_pay.encoded_content_length = 10;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_export_iov_range), 3);
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_ERROR);
+    UtAssert_UINT32_EQ(iov_count, 3);
+    UtAssert_NULL(payload_ref);
+
+    /* nominal, the ref is kept for the caller */
+    iov_count = 2;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_export_iov_range), 2);
+    UT_ResetState(UT_KEY(bplib_mpool_ref_release));
+    UtAssert_INT32_EQ(bplib_recv_view(&desc, iov, &iov_count, &size, &payload_ref, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(iov_count, 2);
+    UtAssert_UINT32_EQ(size, 10);
+    UtAssert_ADDRESS_EQ(payload_ref, &refptr);
+    UtAssert_UINT32_EQ(sock.egress_byte_count, 10);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 0);
+
+    UtAssert_VOIDCALL(bplib_recv_view_release(&desc, payload_ref));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_send_local(void)
+{
+    /* Test function for:
+     * int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t timeout)
+     * to another socket on the same node
+     */
+    bp_socket_t                   *desc;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_flow_t             flow;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_block_t            tgt_blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_primary_t   pri;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+    bplib_service_endpt_t          endpt;
+    bp_pri_template_t              tmpl;
+
+    memset(&UT_lib_local, 0, sizeof(UT_lib_local));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&tgt_blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&endpt, 0, sizeof(bplib_service_endpt_t));
+    memset(&tmpl, 0, sizeof(bp_pri_template_t));
+
+    desc                                               = (bp_socket_t *)&UT_lib_local.sock_blk;
+    UT_lib_local.sock.parent_rtbl                      = &rtbl;
+    UT_lib_local.sock.pri_template                     = &tmpl;
+    UT_lib_local.sock.params.local_ipn.node_number     = 10;
+    UT_lib_local.sock.params.local_ipn.service_number  = 1;
+    UT_lib_local.sock.params.remote_ipn.node_number    = 10;
+    UT_lib_local.sock.params.remote_ipn.service_number = 2;
+    UT_lib_local.base_intf.node_number                 = 10;
+    flow.parent                                        = (bplib_mpool_ref_t)&UT_lib_local.base_blk;
+    endpt.subflow_ref                                  = (bplib_mpool_ref_t)&tgt_blk;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_local_AltHandler_DataCast, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_lib_AltHandler_PointerReturn, &endpt);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_duplicate), UT_lib_AltHandler_PointerReturn, &tgt_blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_sizet_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+
+    /* delivered straight to the other socket, without waking the maintenance task */
+    UtAssert_INT32_EQ(bplib_send(desc, NULL, 100, 3000), BP_SUCCESS);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_duplicate, 1);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_from_template, 1);
+    UtAssert_UINT32_EQ(UT_lib_local.sock.ingress_byte_count, 100);
+
+    /* and the primary block need not be encoded */
+    UtAssert_INT32_EQ(bplib_socket_set_local_skip_encode(desc, true), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_send(desc, NULL, 100, 3000), BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_from_template, 1);
+
+    /* a bundle that needs storing still goes the usual way, and is encoded after all */
+    UT_lib_local.sock.params.local_delivery_policy = bplib_policy_delivery_custody_tracking;
+    UtAssert_INT32_EQ(bplib_send(desc, NULL, 100, 3000), BP_SUCCESS);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 1);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_from_template, 2);
+    UT_lib_local.sock.params.local_delivery_policy = bplib_policy_delivery_none;
+
+    /* as does one for a service that is not bound here */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_send(desc, NULL, 100, 3000), BP_SUCCESS);
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_duplicate, 2);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_from_template, 3);
+
+    /* a best effort bundle going out can be left for the CLA to encode, but not one that is stored */
+    UtAssert_INT32_EQ(bplib_socket_set_egress_encode(desc, true), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_send(desc, NULL, 100, 3000), BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_from_template, 3);
+    UT_lib_local.sock.params.local_delivery_policy = bplib_policy_delivery_custody_tracking;
+    UtAssert_INT32_EQ(bplib_send(desc, NULL, 100, 3000), BP_SUCCESS);
+    UtAssert_STUB_COUNT(v7_block_encode_pri_from_template, 4);
+    UT_lib_local.sock.params.local_delivery_policy = bplib_policy_delivery_none;
+    UtAssert_INT32_EQ(bplib_socket_set_egress_encode(desc, false), BP_SUCCESS);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_set_nonblocking(void)
+{
+    /* Test function for:
+     * int bplib_socket_set_nonblocking(bp_socket_t *desc, bool enable)
+     */
+    bp_socket_t         desc;
+    bplib_socket_info_t sock;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_nonblocking(&desc, true), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UtAssert_INT32_EQ(bplib_socket_set_nonblocking(&desc, true), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(sock.nonblocking);
+    UtAssert_INT32_EQ(bplib_socket_set_nonblocking(&desc, false), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(sock.nonblocking);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_set_egress_encode(void)
+{
+    /* Test function for:
+     * int bplib_socket_set_egress_encode(bp_socket_t *desc, bool enable)
+     */
+    bp_socket_t         desc;
+    bplib_socket_info_t sock;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_egress_encode(&desc, true), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UtAssert_INT32_EQ(bplib_socket_set_egress_encode(&desc, true), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(sock.egress_encode);
+    UtAssert_INT32_EQ(bplib_socket_set_egress_encode(&desc, false), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(sock.egress_encode);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_set_coalescing(void)
+{
+    /* Test function for:
+     * int bplib_socket_set_coalescing(bp_socket_t *desc, size_t max_size, uint32_t max_delay)
+     */
+    bp_socket_t         desc;
+    bplib_socket_info_t sock;
+    bplib_mpool_flow_t  flow;
+    bplib_routetbl_t    rtbl;
+    bplib_mpool_ref_t   refptr;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&UT_lib_coalesce, 0, sizeof(UT_lib_coalesce));
+    sock.parent_rtbl = &rtbl;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 32, 10), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+
+    /* turning it off when it was never on is nothing to do */
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 0, 0), BP_SUCCESS);
+    UtAssert_NULL(sock.coalesce);
+
+    /* no memory for the buffer, or for its locks */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 32, 10), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, &UT_lib_coalesce.co);
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 32, 10), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UtAssert_NULL(sock.coalesce);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 32, 10), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(sock.coalesce, &UT_lib_coalesce.co);
+    UtAssert_ADDRESS_EQ(UT_lib_coalesce.co.buf, UT_lib_coalesce.buf);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.buf_size, 32);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.max_size, 32);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.max_delay, 10);
+
+    /* the buffer can only be used for less after that */
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 33, 10), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 16, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.max_size, 16);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.max_delay, 0);
+
+    /* it stays on while the ADUs pending cannot be sent */
+    UT_lib_coalesce.co.used = 5;
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 0, 0), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.max_size, 16);
+
+    /* and when it goes off, what is left of a bundle being split goes with it */
+    UT_lib_coalesce.co.used   = 0;
+    UT_lib_coalesce.co.rx_ref = &refptr;
+    UtAssert_INT32_EQ(bplib_socket_set_coalescing(&desc, 0, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.max_size, 0);
+    UtAssert_NULL(UT_lib_coalesce.co.rx_ref);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    /* the buffer is freed with the socket */
+    UtAssert_INT32_EQ(bplib_dataservice_socket_destruct(NULL, (bplib_mpool_block_t *)&desc), BP_SUCCESS);
+    UtAssert_NULL(sock.coalesce);
+    UtAssert_STUB_COUNT(bplib_os_free, 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_destroy, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_send_coalesce(void)
+{
+    /* Test function for:
+     * bplib_send() and the other send calls, and bplib_socket_flush(), on a socket with coalescing on
+     */
+    static const uint8_t           framed_two[] = {0, 0, 0, 10, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+                                                   0, 0, 0, 10, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    uint8_t                        big[40];
+    uint8_t                        framed_big[44];
+    bp_socket_t                    desc;
+    bplib_socket_info_t            sock;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_flow_t             flow;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_primary_t   pri;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+    bplib_send_buf_t               payloads[2];
+    int                            status_list[2];
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(big, 'x', sizeof(big));
+    sock.parent_rtbl = &rtbl;
+    UT_lib_coalesce_Setup(&sock, 32, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, &blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UT_SetHandlerFunction(UT_KEY(v7_block_encode_pay), UT_lib_coalesce_AltHandler_EncodePay, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_coarse_ms), UT_lib_uint64_Handler, NULL);
+
+    /* the first ADU waits in the buffer, the second fills it so both go in one bundle */
+    UtAssert_INT32_EQ(bplib_send(&desc, "0123456789", 10, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 0);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 14);
+    UtAssert_INT32_EQ(bplib_send(&desc, "0123456789", 10, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 1);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 0);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded_size, sizeof(framed_two));
+    UtAssert_MemCmp(UT_lib_coalesce.encoded, framed_two, sizeof(framed_two), "ADUs framed in order");
+
+    /* one that does not fit with what is pending sends that first */
+    UtAssert_INT32_EQ(bplib_send(&desc, "0123456789", 10, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 20, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 2);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded_size, 14);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 24);
+
+    /* if that cannot be sent, the new one is not taken */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_int8_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 20, 0), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 24);
+    UtAssert_INT32_EQ(bplib_socket_flush(&desc, 0), BP_TIMEOUT);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_push), UT_lib_bool_Handler, NULL);
+    UtAssert_INT32_EQ(bplib_socket_flush(&desc, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 0);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded_size, 24);
+    UtAssert_INT32_EQ(bplib_socket_flush(&desc, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 5);
+
+    /* one too big to share a bundle goes alone, still framed, once there is memory for that */
+    UtAssert_INT32_EQ(bplib_send(&desc, big, sizeof(big), 0), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, UT_lib_coalesce.payload);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 8, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 12);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, framed_big);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, sizeof(big), 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded_size, sizeof(framed_big));
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded[3], sizeof(big));
+    UtAssert_MemCmp(&UT_lib_coalesce.encoded[4], big, sizeof(big), "big ADU follows its length");
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 0);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
+
+    /* the extern buffer is copied and given back at once, and a batch goes in the buffer one by one */
+    UtAssert_INT32_EQ(bplib_send_extern(&desc, big, 4, test_bplib_payload_release_stub, NULL, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_payload_release_stub, 1);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 8);
+    payloads[0].payload = big;
+    payloads[0].size    = 2;
+    payloads[1].payload = big;
+    payloads[1].size    = 3;
+    UtAssert_INT32_EQ(bplib_send_many(&desc, payloads, 2, status_list, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[0], BP_SUCCESS);
+    UtAssert_INT32_EQ(status_list[1], BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 21);
+    UtAssert_INT32_EQ(bplib_socket_flush(&desc, 0), BP_SUCCESS);
+
+    /* with a delay, the first ADU asks for a poll, and the one that comes after its time sends them */
+    UT_lib_coalesce.co.max_delay = 100;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 1000);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 5, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(flow.poll_time, 1100);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 1050);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 2, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 15);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 1100);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 1, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 0);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded_size, 20);
+
+    /* or the poll does, once it is time */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 2000);
+    UtAssert_INT32_EQ(bplib_send(&desc, big, 3, 0), BP_SUCCESS);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 2050);
+    bplib_serviceflow_coalesce_poll(&blk);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 7);
+    UtAssert_UINT32_EQ(flow.poll_time, 2100);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 2100);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_trylock), BP_TIMEOUT);
+    bplib_serviceflow_coalesce_poll(&blk);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 7);
+    UtAssert_UINT32_EQ(flow.poll_time, 2200);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_trylock), BP_SUCCESS);
+    bplib_serviceflow_coalesce_poll(&blk);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.co.used, 0);
+    UtAssert_UINT32_EQ(UT_lib_coalesce.encoded_size, 7);
+
+    /* a poll on a socket without it does nothing */
+    sock.coalesce = NULL;
+    bplib_serviceflow_coalesce_poll(&blk);
+    UtAssert_INT32_EQ(bplib_socket_flush(&desc, 0), BP_SUCCESS);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_flush(&desc, 0), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_coarse_ms), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(v7_block_encode_pay), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_make_block), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_recv_coalesce(void)
+{
+    /* Test function for:
+     * bplib_recv() and bplib_recv_many() on a socket with coalescing on
+     */
+    static const uint8_t           framed[] = {0, 0, 0, 3, 'a', 'b', 'c', 0, 0, 0, 2, 'd', 'e'};
+    uint8_t                        payload[10];
+    size_t                         size;
+    bplib_recv_buf_t               buffers[3];
+    uint32_t                       num_filled;
+    bp_socket_t                    desc;
+    bplib_socket_info_t            sock;
+    bplib_mpool_flow_t             flow;
+    bplib_routetbl_t               rtbl;
+    bplib_mpool_block_t            blk;
+    bplib_mpool_ref_t              refptr;
+    bplib_mpool_bblock_canonical_t ccb_pay;
+    bplib_mpool_bblock_primary_t   pri;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+    memset(&ccb_pay, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    sock.parent_rtbl = &rtbl;
+    UT_lib_coalesce_Setup(&sock, 32, 0);
+    memcpy(UT_lib_coalesce.payload, framed, sizeof(framed));
+    ccb_pay.encoded_content_offset = 1;
+    ccb_pay.encoded_content_length = sizeof(framed);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, &refptr);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, &ccb_pay);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_lib_coalesce_AltHandler_Export, NULL);
+
+    /* nothing in the queue */
+    size = sizeof(payload);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_TIMEOUT);
+
+    /* each ADU of the bundle comes out in turn, from one pull */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, &blk);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(size, 3);
+    UtAssert_MemCmp(payload, "abc", 3, "first ADU");
+    UtAssert_ADDRESS_EQ(UT_lib_coalesce.co.rx_ref, &refptr);
+    size = sizeof(payload);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(size, 2);
+    UtAssert_MemCmp(payload, "de", 2, "second ADU");
+    UtAssert_NULL(UT_lib_coalesce.co.rx_ref);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_pull, 2);
+    UtAssert_UINT32_EQ(sock.egress_byte_count, 5);
+
+    /* in non-blocking mode, an ADU left in the bundle is there to take even with the queue empty */
+    sock.nonblocking = true;
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_TIMEOUT);
+    UT_lib_coalesce.co.rx_ref    = &refptr;
+    UT_lib_coalesce.co.rx_offset = 7;
+    size                         = sizeof(payload);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_SUCCESS);
+    UtAssert_MemCmp(payload, "de", 2, "ADU left in bundle");
+    sock.nonblocking = false;
+
+    /* an ADU too big for the buffer is dropped, and the next one is still there */
+    size = 2;
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_SUCCESS);
+    UtAssert_MemCmp(payload, "de", 2, "ADU after one dropped");
+
+    /* a length that runs past the payload, or a payload that ends partway into a length */
+    ccb_pay.encoded_content_length = 6;
+    size                           = sizeof(payload);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_ERROR);
+    UtAssert_NULL(UT_lib_coalesce.co.rx_ref);
+    ccb_pay.encoded_content_length = 9;
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_ERROR);
+    UtAssert_NULL(UT_lib_coalesce.co.rx_ref);
+    ccb_pay.encoded_content_length = sizeof(framed);
+
+    /* a batch takes ADUs as it would take bundles, and one too big leaves its buffer for the next */
+    buffers[0].payload = payload;
+    buffers[0].size    = 2;
+    buffers[1].payload = payload;
+    buffers[1].size    = 2;
+    buffers[2].payload = payload;
+    buffers[2].size    = sizeof(payload);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 3, &num_filled, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_filled, 3);
+    UtAssert_UINT32_EQ(buffers[0].size, 2);
+    UtAssert_UINT32_EQ(buffers[1].size, 2);
+    UtAssert_UINT32_EQ(buffers[2].size, 3);
+
+    /* a bundle without a payload */
+    UT_lib_coalesce.co.rx_ref      = NULL;
+    ccb_pay.encoded_content_offset = 0;
+    UtAssert_INT32_EQ(bplib_recv(&desc, payload, &size, 0), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_recv_many(&desc, buffers, 1, &num_filled, 0), BP_TIMEOUT);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_from_block), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), NULL, NULL);
+}
+
+void test_bplib_socket_set_tracing(void)
+{
+    /* Test function for:
+     * int bplib_socket_set_tracing(bp_socket_t *desc, bool enable)
+     */
+    bp_socket_t      *desc;
+    bplib_routetbl_t  rtbl;
+    bplib_mpool_ref_t refptr;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&refptr, 0, sizeof(bplib_mpool_ref_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_tracing(NULL, true), BP_ERROR);
+
+    desc                          = UT_lib_trace_Setup();
+    UT_lib_trace.sock.parent_rtbl = &rtbl;
+
+    /* no memory for the histograms */
+    UtAssert_INT32_EQ(bplib_socket_set_tracing(desc, true), BP_ERROR);
+    UtAssert_BOOL_FALSE(UT_lib_trace.sock.tracing);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn,
+                          &UT_lib_trace.trace_blk);
+    UtAssert_INT32_EQ(bplib_socket_set_tracing(desc, true), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(UT_lib_trace.sock.trace_ref);
+    UtAssert_BOOL_FALSE(UT_lib_trace.sock.tracing);
+
+    /* nominal, the histograms are only made once */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &refptr);
+    UtAssert_INT32_EQ(bplib_socket_set_tracing(desc, true), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(UT_lib_trace.sock.tracing);
+    UtAssert_ADDRESS_EQ(UT_lib_trace.sock.trace_ref, &refptr);
+    UtAssert_INT32_EQ(bplib_socket_set_tracing(desc, false), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(UT_lib_trace.sock.tracing);
+    UtAssert_INT32_EQ(bplib_socket_set_tracing(desc, true), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_generic_data_alloc, 3);
+    UtAssert_ADDRESS_EQ(UT_lib_trace.sock.trace_ref, &refptr);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_sizet_Handler, NULL);
+}
+
+void test_bplib_socket_query_latency(void)
+{
+    /* Test function for:
+     * int bplib_socket_query_latency(bp_socket_t *desc, bplib_trace_stage_t stage, uint32_t *histogram)
+     */
+    bp_socket_t *desc;
+    uint32_t     histogram[BPLIB_TRACE_LATENCY_BINS];
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_query_latency(NULL, bplib_trace_stage_route, histogram), BP_ERROR);
+
+    desc = UT_lib_trace_Setup();
+    UtAssert_INT32_EQ(bplib_socket_query_latency(desc, bplib_trace_stage_max, histogram), BP_ERROR);
+
+    /* tracing was never turned on */
+    memset(histogram, 0xff, sizeof(histogram));
+    UtAssert_INT32_EQ(bplib_socket_query_latency(desc, bplib_trace_stage_route, histogram), BP_SUCCESS);
+    UtAssert_UINT32_EQ(histogram[0], 0);
+    UtAssert_UINT32_EQ(histogram[BPLIB_TRACE_LATENCY_BINS - 1], 0);
+
+    UT_lib_trace.sock.trace_ref                            = (bplib_mpool_ref_t)&UT_lib_trace.trace_blk;
+    UT_lib_trace.trace.latency[bplib_trace_stage_route][2] = 5;
+    UT_lib_trace.trace.latency[bplib_trace_stage_recv][2]  = 7;
+    UtAssert_INT32_EQ(bplib_socket_query_latency(desc, bplib_trace_stage_route, histogram), BP_SUCCESS);
+    UtAssert_UINT32_EQ(histogram[1], 0);
+    UtAssert_UINT32_EQ(histogram[2], 5);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_set_sampling(void)
+{
+    /* Test function for:
+     * int bplib_socket_set_sampling(bp_socket_t *desc, uint32_t interval, uint32_t ring_size)
+     * int bplib_socket_read_samples(bp_socket_t *desc, bplib_trace_sample_t *samples, uint32_t max_samples,
+     *                               uint32_t *num_samples)
+     */
+    bp_socket_t                 *desc;
+    bplib_trace_sample_t         ring[2];
+    bplib_trace_sample_t         samples[3];
+    bplib_mpool_bblock_primary_t pri;
+    uint32_t                     num_samples;
+    uint32_t                     i;
+    int                          lock;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_sampling(NULL, 2, 2), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_socket_read_samples(NULL, samples, 3, &num_samples), BP_ERROR);
+
+    /* sampling was never turned on */
+    desc = UT_lib_trace_Setup();
+    UtAssert_INT32_EQ(bplib_socket_set_sampling(desc, 0, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_socket_read_samples(desc, samples, 3, &num_samples), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_samples, 0);
+
+    /* no memory for the ring */
+    UT_lib_trace.sock.trace_ref = (bplib_mpool_ref_t)&UT_lib_trace.trace_blk;
+    UtAssert_INT32_EQ(bplib_socket_set_sampling(desc, 2, 2), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), UT_lib_AltHandler_PointerReturn, &lock);
+    UtAssert_INT32_EQ(bplib_socket_set_sampling(desc, 2, 2), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_os_mutex_destroy, 1);
+    UtAssert_UINT32_EQ(UT_lib_trace.sock.sample_interval, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, ring);
+    UtAssert_INT32_EQ(bplib_socket_set_sampling(desc, 2, 2), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_trace.sock.sample_interval, 2);
+    UtAssert_UINT32_EQ(UT_lib_trace.trace.sample_ring_size, 2);
+
+    /* a bundle only sent for the sample is not counted, and the oldest is replaced when the ring is full */
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    pri.data.delivery.trace_ref         = (bplib_mpool_ref_t)&UT_lib_trace.trace_blk;
+    pri.data.delivery.trace_sampled     = true;
+    pri.data.delivery.trace_sample_only = true;
+    for (i = 1; i <= 3; ++i)
+    {
+        pri.data.logical.creationTimeStamp.sequence_num = i;
+        bplib_serviceflow_trace_egress(&pri, 100 * i);
+    }
+    UtAssert_UINT32_EQ(UT_lib_trace.trace.latency[bplib_trace_stage_cla_egress][0], 0);
+
+    UtAssert_INT32_EQ(bplib_socket_read_samples(desc, samples, 3, &num_samples), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_samples, 2);
+    UtAssert_UINT32_EQ(samples[0].sequence, 2);
+    UtAssert_UINT32_EQ(samples[0].stage_time[bplib_trace_stage_cla_egress], 200);
+    UtAssert_UINT32_EQ(samples[1].sequence, 3);
+    UtAssert_INT32_EQ(bplib_socket_read_samples(desc, samples, 3, &num_samples), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_samples, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_set_completions(void)
+{
+    /* Test function for:
+     * int bplib_socket_set_completions(bp_socket_t *desc, uint32_t max_in_flight)
+     */
+    bp_socket_t       *desc;
+    bplib_routetbl_t   rtbl;
+    bplib_completion_t ring[20];
+    int                lock;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_set_completions(NULL, 2), BP_ERROR);
+
+    desc                           = UT_lib_cq_Setup();
+    UT_lib_cq.sock.parent_rtbl     = &rtbl;
+    UT_lib_cq.sock.completions_ref = NULL;
+    memset(&UT_lib_cq.cq, 0, sizeof(UT_lib_cq.cq));
+
+    /* no memory for the block, or the lock, or the ring */
+    UtAssert_INT32_EQ(bplib_socket_set_completions(desc, 2), BP_ERROR);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, &UT_lib_cq.cq_blk);
+    UtAssert_INT32_EQ(bplib_socket_set_completions(desc, 2), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), UT_lib_AltHandler_PointerReturn, &lock);
+    UtAssert_INT32_EQ(bplib_socket_set_completions(desc, 2), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 2);
+    UtAssert_NULL(UT_lib_cq.sock.completions_ref);
+
+    /* five entries are kept for each op in flight */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, ring);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &UT_lib_cq.cq_blk);
+    UtAssert_INT32_EQ(bplib_socket_set_completions(desc, 4), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(UT_lib_cq.sock.completions_ref, &UT_lib_cq.cq_blk);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.ring_size, 20);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.max_in_flight, 4);
+
+    /* the queue is only made once */
+    UtAssert_INT32_EQ(bplib_socket_set_completions(desc, 8), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_os_calloc, 2);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.max_in_flight, 4);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_send_async(void)
+{
+    /* Test function for:
+     * int bplib_send_async(bp_socket_t *desc, const void *payload, size_t size, uint64_t user_tag)
+     */
+    bp_socket_t            *desc;
+    bplib_routetbl_t        rtbl;
+    bplib_mpool_flow_t      flow;
+    bplib_socket_coalesce_t co;
+    uint8_t                 payload[4];
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&co, 0, sizeof(bplib_socket_coalesce_t));
+    memset(payload, 0, sizeof(payload));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_send_async(NULL, payload, sizeof(payload), 1), BP_ERROR);
+
+    desc                       = UT_lib_cq_Setup();
+    UT_lib_cq.sock.parent_rtbl = &rtbl;
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 1), BP_ERROR);
+
+    /* no completion queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_lib_cq.sock.completions_ref = NULL;
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 1), BP_ERROR);
+    UT_lib_cq.sock.completions_ref = (bplib_mpool_ref_t)&UT_lib_cq.cq_blk;
+
+    /* too many in flight */
+    UT_lib_cq.cq.in_flight = 2;
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 1), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 2);
+    UT_lib_cq.cq.in_flight = 0;
+
+    /* no memory for the op */
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 1), BP_ERROR);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, &UT_lib_cq.op_blk);
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 1), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 0);
+
+    /* the bundle could not be made at once, so the op will never post anything */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &UT_lib_cq.op_blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_duplicate), UT_lib_AltHandler_PointerReturn, &UT_lib_cq.cq_blk);
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 7), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(UT_lib_cq.op.user_tag, 7);
+    UtAssert_NULL(UT_lib_cq.op.cq_ref);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    /* nor while coalescing, as the ADUs would not each have a bundle */
+    co.max_size             = 100;
+    UT_lib_cq.sock.coalesce = &co;
+    UtAssert_INT32_EQ(bplib_send_async(desc, payload, sizeof(payload), 1), BP_ERROR);
+    UT_lib_cq.sock.coalesce = NULL;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_duplicate), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_alloc), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_get_completions(void)
+{
+    /* Test function for:
+     * int bplib_get_completions(bp_socket_t *desc, bplib_completion_t *completions, uint32_t max_completions,
+     *                           uint32_t *num_completions, uint32_t timeout)
+     * void bplib_dataservice_complete(bplib_mpool_ref_t op_ref, bplib_completion_event_t event)
+     * int bplib_dataservice_async_op_destruct(void *arg, bplib_mpool_block_t *oblk)
+     */
+    bp_socket_t        *desc;
+    bplib_routetbl_t    rtbl;
+    bplib_completion_t  completions[4];
+    uint32_t            num_completions;
+    bplib_mpool_block_t other_blk;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(&other_blk, 0, sizeof(bplib_mpool_block_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_get_completions(NULL, completions, 4, &num_completions, 0), BP_ERROR);
+
+    desc                       = UT_lib_cq_Setup();
+    UT_lib_cq.sock.parent_rtbl = &rtbl;
+    UT_lib_cq.cq.in_flight     = 2;
+
+    /* nothing yet, waiting until the timeout */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_wait_until_ms), BP_TIMEOUT);
+    UtAssert_INT32_EQ(bplib_get_completions(desc, completions, 4, &num_completions, 10), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(num_completions, 0);
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 1);
+
+    /* each event is only posted once, however often it happens */
+    bplib_dataservice_complete(NULL, bplib_completion_sent);
+    bplib_dataservice_complete((bplib_mpool_ref_t)&UT_lib_cq.op_blk, bplib_completion_sent);
+    bplib_dataservice_complete((bplib_mpool_ref_t)&UT_lib_cq.op_blk, bplib_completion_sent);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.held, 1);
+
+    /* a best effort bundle that was sent is done when released, one for custody is not until acked */
+    UtAssert_INT32_EQ(bplib_dataservice_async_op_destruct(NULL, &UT_lib_cq.op_blk), BP_SUCCESS);
+    UtAssert_NULL(UT_lib_cq.op.cq_ref);
+    UT_lib_cq.op.cq_ref = (bplib_mpool_ref_t)&UT_lib_cq.cq_blk;
+    UT_lib_cq.op.policy = bplib_policy_delivery_custody_tracking;
+    UtAssert_INT32_EQ(bplib_dataservice_async_op_destruct(NULL, &UT_lib_cq.op_blk), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.held, 3);
+
+    /* oldest first, and the final ones free up their ops */
+    UtAssert_INT32_EQ(bplib_get_completions(desc, completions, 2, &num_completions, 10), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_completions, 2);
+    UtAssert_UINT32_EQ(completions[0].user_tag, 42);
+    UtAssert_INT32_EQ(completions[0].event, bplib_completion_sent);
+    UtAssert_INT32_EQ(completions[1].event, bplib_completion_done);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 1);
+    UtAssert_INT32_EQ(bplib_get_completions(desc, completions, 4, &num_completions, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_completions, 1);
+    UtAssert_INT32_EQ(completions[0].event, bplib_completion_failed);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 0);
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 1);
+
+    /* one only stored locally is done once it is in storage, even if it was never sent */
+    UT_lib_cq.cq.in_flight = 1;
+    UT_lib_cq.op.events    = 0;
+    UT_lib_cq.op.cq_ref    = (bplib_mpool_ref_t)&UT_lib_cq.cq_blk;
+    UT_lib_cq.op.policy    = bplib_policy_delivery_local_ack;
+    bplib_dataservice_complete((bplib_mpool_ref_t)&UT_lib_cq.op_blk, bplib_completion_custody_taken);
+    UtAssert_INT32_EQ(bplib_dataservice_async_op_destruct(NULL, &UT_lib_cq.op_blk), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_get_completions(desc, completions, 4, &num_completions, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(num_completions, 2);
+    UtAssert_INT32_EQ(completions[0].event, bplib_completion_custody_taken);
+    UtAssert_INT32_EQ(completions[1].event, bplib_completion_done);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.in_flight, 0);
+
+    /* an op which never had a queue posts nothing */
+    UT_lib_cq.op.cq_ref = NULL;
+    UtAssert_INT32_EQ(bplib_dataservice_async_op_destruct(NULL, &UT_lib_cq.op_blk), BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.held, 0);
+    UtAssert_INT32_EQ(bplib_dataservice_async_op_destruct(NULL, &other_blk), BP_ERROR);
+
+    /* the ring is the only part not in the block itself */
+    UtAssert_INT32_EQ(bplib_dataservice_cq_destruct(NULL, &UT_lib_cq.cq_blk), BP_SUCCESS);
+    UtAssert_NULL(UT_lib_cq.cq.ring);
+    UtAssert_NULL(UT_lib_cq.cq.lock);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_destroy, 1);
+
+    /* no queue at all */
+    UT_lib_cq.sock.completions_ref = NULL;
+    UtAssert_INT32_EQ(bplib_get_completions(desc, completions, 4, &num_completions, 0), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_get_completion_fd(void)
+{
+    /* Test function for:
+     * int bplib_socket_get_completion_fd(bp_socket_t *desc)
+     */
+    bp_socket_t       *desc;
+    bplib_routetbl_t   rtbl;
+    bplib_completion_t completion;
+    uint32_t           num_completions;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_get_completion_fd(NULL), BP_ERROR);
+
+    desc                           = UT_lib_cq_Setup();
+    UT_lib_cq.sock.parent_rtbl     = &rtbl;
+    UT_lib_cq.sock.completions_ref = NULL;
+    UtAssert_INT32_EQ(bplib_socket_get_completion_fd(desc), BP_ERROR);
+    UT_lib_cq.sock.completions_ref = (bplib_mpool_ref_t)&UT_lib_cq.cq_blk;
+
+    /* no OS support */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_notifier_get_fd), -1);
+    UtAssert_INT32_EQ(bplib_socket_get_completion_fd(desc), BP_ERROR);
+
+    /* made once, and set at once if there is anything to take */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_notifier_get_fd), 9);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_create_notifier), 5);
+    UT_lib_cq.cq.held = 1;
+    UtAssert_INT32_EQ(bplib_socket_get_completion_fd(desc), 9);
+    UtAssert_UINT32_EQ(UT_lib_cq.cq.notifier.hdl, 5);
+    UtAssert_STUB_COUNT(bplib_os_notifier_set, 1);
+    UtAssert_INT32_EQ(bplib_socket_get_completion_fd(desc), 9);
+    UtAssert_STUB_COUNT(bplib_os_create_notifier, 2);
+
+    /* cleared once the queue is drained, and set again when the next one is posted */
+    UT_lib_cq.cq.ring[0].event = bplib_completion_sent;
+    UT_lib_cq.cq.in_flight     = 1;
+    UtAssert_INT32_EQ(bplib_get_completions(desc, &completion, 1, &num_completions, 0), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_os_notifier_clear, 1);
+    bplib_dataservice_complete((bplib_mpool_ref_t)&UT_lib_cq.op_blk, bplib_completion_sent);
+    UtAssert_STUB_COUNT(bplib_os_notifier_set, 2);
+
+    UtAssert_INT32_EQ(bplib_dataservice_cq_destruct(NULL, &UT_lib_cq.cq_blk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_os_destroy_notifier, 1);
+    UtAssert_BOOL_FALSE(bp_handle_is_valid(UT_lib_cq.cq.notifier));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_socket_get_notify_fd(void)
+{
+    /* Test function for:
+     * int bplib_socket_get_notify_fd(bp_socket_t *desc)
+     */
+    bp_socket_t         desc;
+    bplib_socket_info_t sock;
+    bplib_mpool_flow_t  flow;
+
+    memset(&desc, 0, sizeof(bp_socket_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_get_notify_fd(&desc), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_socket_get_notify_fd(&desc), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_notifier, 0);
+
+    /* nominal, the descriptor is the one of the egress queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_notifier_get_fd), 7);
+    UtAssert_INT32_EQ(bplib_socket_get_notify_fd(&desc), 7);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_attach_notifier, 1);
+
+    /* no notifier */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_attach_notifier), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_socket_get_notify_fd(&desc), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_serviceflow_forward_ingress(void)
+{
+    /* Test function for:
+     * int bplib_serviceflow_forward_ingress(void *arg, bplib_mpool_block_t *subq_src)
+     */
+    bplib_routetbl_t    tbl;
+    bplib_mpool_block_t subq_src;
+    bplib_mpool_block_t sblk;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(&subq_src, 0, sizeof(bplib_mpool_block_t));
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_lib_sizet_Handler, NULL);
+    UtAssert_UINT32_EQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_UINT32_NEQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &sblk);
+    UtAssert_UINT32_EQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_ingress_AltHandler_PointerReturn, &sblk);
+    UtAssert_UINT32_NEQ(bplib_serviceflow_forward_ingress(&tbl, &subq_src), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_serviceflow_forward_egress(void)
 {
     /* Test function for:
      * int bplib_serviceflow_forward_egress(void *arg, bplib_mpool_block_t *subq_src)
@@ -488,6 +2149,197 @@ void test_bplib_serviceflow_forward_egress(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_serviceflow_push_custody_ack(void)
+{
+    /* Test function for:
+     * bool bplib_serviceflow_push_custody_ack(bplib_routetbl_t *tbl, bp_handle_t intf_id, bplib_mpool_block_t *pblk)
+     */
+    bplib_routetbl_t               tbl;
+    bplib_mpool_block_t            pblk;
+    bplib_mpool_block_content_t    intf_blk;
+    bplib_mpool_block_content_t    storage_blk;
+    bplib_mpool_flow_t             storage_flow;
+    bplib_route_serviceintf_info_t base_intf;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&intf_blk, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&storage_blk, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&storage_flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&base_intf, 0, sizeof(bplib_route_serviceintf_info_t));
+
+    /* not a service base interface, so it goes the normal way */
+    UtAssert_BOOL_FALSE(bplib_serviceflow_push_custody_ack(&tbl, BPLIB_HANDLE_FLASH_STORE_BASE, &pblk));
+
+    /* a base interface without storage */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &base_intf);
+    UtAssert_BOOL_FALSE(bplib_serviceflow_push_custody_ack(&tbl, BPLIB_HANDLE_FLASH_STORE_BASE, &pblk));
+
+    base_intf.storage_service = (bplib_mpool_ref_t)&storage_blk;
+    UtAssert_BOOL_FALSE(bplib_serviceflow_push_custody_ack(&tbl, BPLIB_HANDLE_FLASH_STORE_BASE, &pblk));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 0);
+
+    /* the storage queue is full */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &storage_flow);
+    UtAssert_BOOL_FALSE(bplib_serviceflow_push_custody_ack(&tbl, BPLIB_HANDLE_FLASH_STORE_BASE, &pblk));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 1);
+
+    /* the interface ref is let go once the bundle is on the storage queue */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_flow_try_push), true);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &intf_blk);
+    UtAssert_BOOL_TRUE(bplib_serviceflow_push_custody_ack(&tbl, BPLIB_HANDLE_FLASH_STORE_BASE, &pblk));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_sizet_Handler, NULL);
+}
+
+void test_bplib_serviceflow_add_to_base(void)
+{
+    /* Test function for:
+     * int bplib_serviceflow_add_to_base(bplib_mpool_block_t *base_intf_blk, bp_val_t svc_num, bplib_dataservice_type_t
+     * type, bplib_mpool_ref_t endpoint_intf_ref)
+     */
+    bplib_mpool_block_t base_blk;
+    uint32_t            i;
+    uint32_t            in_slots;
+
+    memset(&base_blk, 0, sizeof(bplib_mpool_block_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_serviceflow_add_to_base(&base_blk, 1, bplib_dataservice_type_application, NULL),
+                      BP_ERROR);
+
+    /* endpoints go into the hash table up to its limit, the rest only into the RB tree */
+    UT_lib_svchash_Setup();
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.count, BPLIB_SERVICE_HASH_LIMIT);
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.overflow, UT_LIB_SVCHASH_ENDPOINTS - BPLIB_SERVICE_HASH_LIMIT);
+    UtAssert_STUB_COUNT(bplib_rbt_insert_value_generic, UT_LIB_SVCHASH_ENDPOINTS);
+
+    in_slots = 0;
+    for (i = 0; i < BPLIB_SERVICE_HASH_SLOTS; ++i)
+    {
+        if (UT_lib_svchash.hash.slots[i] != NULL)
+        {
+            ++in_slots;
+        }
+    }
+    UtAssert_UINT32_EQ(in_slots, BPLIB_SERVICE_HASH_LIMIT);
+    UtAssert_UINT32_EQ(UT_lib_svchash.endpt[4].service_number, 5);
+
+    /* a duplicate is refused by the RB tree, and is not put in the hash table either */
+    UT_lib_svchash.next_alloc = 0;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_insert_value_generic), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_serviceflow_add_to_base(&UT_lib_svchash.base_blk, 1, bplib_dataservice_type_application,
+                                                    NULL),
+                      BP_ERROR);
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.count, BPLIB_SERVICE_HASH_LIMIT);
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.overflow, UT_LIB_SVCHASH_ENDPOINTS - BPLIB_SERVICE_HASH_LIMIT);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+
+    /* without a hash table, only the RB tree is used */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_insert_value_generic), BP_SUCCESS);
+    UT_lib_svchash.base_intf.service_hash = NULL;
+    UtAssert_INT32_EQ(bplib_serviceflow_add_to_base(&UT_lib_svchash.base_blk, 1, bplib_dataservice_type_application,
+                                                    NULL),
+                      BP_SUCCESS);
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.count, BPLIB_SERVICE_HASH_LIMIT);
+
+    UT_lib_svchash.next_alloc = UT_LIB_SVCHASH_ENDPOINTS;
+    UtAssert_INT32_EQ(bplib_serviceflow_add_to_base(&UT_lib_svchash.base_blk, 1, bplib_dataservice_type_application,
+                                                    NULL),
+                      BP_ERROR);
+
+    UT_lib_svchash_Teardown();
+}
+
+void test_bplib_serviceflow_remove_from_base(void)
+{
+    /* Test function for:
+     * bplib_mpool_ref_t bplib_serviceflow_remove_from_base(bplib_mpool_block_t *base_intf_blk, bp_val_t svc_num)
+     */
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_flow_t           flow;
+    bplib_mpool_bblock_primary_t pri;
+    uint32_t                     i;
+    uint32_t                     found;
+
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_NULL(bplib_serviceflow_remove_from_base(&pblk, 1));
+
+    UT_lib_svchash_Setup();
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_lib_svchash_AltHandler_Search, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_extract_node), BP_SUCCESS);
+
+    /* not in the RB tree */
+    UtAssert_NULL(bplib_serviceflow_remove_from_base(&UT_lib_svchash.base_blk, UT_LIB_SVCHASH_ENDPOINTS + 1));
+
+    /* every other endpoint, both from the hash table and from the overflow */
+    for (i = 0; i < UT_LIB_SVCHASH_ENDPOINTS; i += 2)
+    {
+        UtAssert_ADDRESS_EQ(bplib_serviceflow_remove_from_base(&UT_lib_svchash.base_blk, i + 1),
+                            UT_lib_svchash.endpt[i].subflow_ref);
+    }
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.count, BPLIB_SERVICE_HASH_LIMIT / 2);
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.overflow, (UT_LIB_SVCHASH_ENDPOINTS - BPLIB_SERVICE_HASH_LIMIT) / 2);
+
+    /* the rest of the overflow */
+    for (i = BPLIB_SERVICE_HASH_LIMIT + 1; i < UT_LIB_SVCHASH_ENDPOINTS; i += 2)
+    {
+        UtAssert_NOT_NULL(bplib_serviceflow_remove_from_base(&UT_lib_svchash.base_blk, i + 1));
+    }
+    UtAssert_UINT32_EQ(UT_lib_svchash.hash.count, BPLIB_SERVICE_HASH_LIMIT / 2);
+    UtAssert_ZERO(UT_lib_svchash.hash.overflow);
+
+    /*
+     * With no overflow, every lookup is answered by the hash table alone.  The entries that were
+     * moved back to fill the removed slots must all still be found, and the removed ones must not.
+     */
+    UT_ResetState(UT_KEY(bplib_rbt_search_generic));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_lib_AltHandler_PointerReturn,
+                          &UT_lib_svchash.base_blk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_svchash_AltHandler_TryPull, &pblk);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri);
+    UT_SetHandlerFunction(UT_KEY(v7_get_eid), UT_lib_svchash_AltHandler_GetEid, NULL);
+
+    /* the flow is cast once for the base intf, and once more if the endpoint was found */
+    found = 0;
+    for (i = 0; i < UT_LIB_SVCHASH_ENDPOINTS; ++i)
+    {
+        UT_ResetState(UT_KEY(bplib_mpool_flow_cast));
+        UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+        UT_lib_svchash.bundle_dest.service_number = i + 1;
+        UtAssert_INT32_EQ(bplib_serviceflow_forward_egress(NULL, NULL), 1);
+        if (UT_GetStubCount(UT_KEY(bplib_mpool_flow_cast)) > 1)
+        {
+            UtAssert_BOOL_TRUE(i < BPLIB_SERVICE_HASH_LIMIT && (i & 1) != 0);
+            ++found;
+        }
+    }
+    UtAssert_UINT32_EQ(found, BPLIB_SERVICE_HASH_LIMIT / 2);
+    UtAssert_STUB_COUNT(bplib_rbt_search_generic, 0);
+
+    /* once there is overflow, a miss goes on to the RB tree */
+    UT_lib_svchash.hash.overflow = 1;
+    UT_lib_svchash.bundle_dest.service_number = 1;
+    UtAssert_INT32_EQ(bplib_serviceflow_forward_egress(NULL, NULL), 1);
+    UtAssert_STUB_COUNT(bplib_rbt_search_generic, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_block_from_link), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(v7_get_eid), NULL, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_lib_svchash_Teardown();
+}
+
 void test_bplib_dataservice_event_impl(void)
 {
     /* Test function for:
@@ -504,6 +2356,10 @@ void test_bplib_dataservice_event_impl(void)
 
     UtAssert_UINT32_EQ(bplib_dataservice_event_impl(&event, &intf_block), 0);
 
+    /* a poll is for ADUs waiting to be sent, there are none without a socket */
+    event.event_type = bplib_mpool_flow_event_poll;
+    UtAssert_UINT32_EQ(bplib_dataservice_event_impl(&event, &intf_block), 0);
+
     event.event_type = bplib_mpool_flow_event_up;
     UtAssert_UINT32_EQ(bplib_dataservice_event_impl(&event, &intf_block), 0);
 
@@ -541,6 +2397,135 @@ void test_bplib_dataservice_base_construct(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_dataservice_base_destruct(void)
+{
+    /* Test function for:
+     * int bplib_dataservice_base_destruct(void *arg, bplib_mpool_block_t *blk)
+     */
+    bplib_mpool_block_t            blk;
+    bplib_mpool_block_t            hblk;
+    bplib_route_serviceintf_info_t base_intf;
+    bplib_service_hash_t           hash;
+
+    memset(&blk, 0, sizeof(bplib_mpool_block_t));
+    memset(&hblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&base_intf, 0, sizeof(bplib_route_serviceintf_info_t));
+    memset(&hash, 0, sizeof(bplib_service_hash_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_dataservice_base_destruct(NULL, &blk), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &base_intf);
+    UtAssert_INT32_EQ(bplib_dataservice_base_destruct(NULL, &blk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 0);
+
+    hash.self_ptr          = &hblk;
+    base_intf.service_hash = &hash;
+    UtAssert_INT32_EQ(bplib_dataservice_base_destruct(NULL, &blk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(base_intf.service_hash);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_dataservice_socket_destruct(void)
+{
+    /* Test function for:
+     * int bplib_dataservice_socket_destruct(void *arg, bplib_mpool_block_t *sblk)
+     */
+    bplib_mpool_block_t sblk;
+    bplib_mpool_block_t tblk;
+    bplib_socket_info_t sock;
+    bp_pri_template_t   tmpl;
+
+    memset(&sblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&tblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&sock, 0, sizeof(bplib_socket_info_t));
+    memset(&tmpl, 0, sizeof(bp_pri_template_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_dataservice_socket_destruct(NULL, &sblk), BP_ERROR);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &sock);
+    UtAssert_INT32_EQ(bplib_dataservice_socket_destruct(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 0);
+
+    sock.pri_template_blk = &tblk;
+    sock.pri_template     = &tmpl;
+    UtAssert_INT32_EQ(bplib_dataservice_socket_destruct(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(sock.pri_template_blk);
+    UtAssert_NULL(sock.pri_template);
+
+    /* the histograms are only released, bundles may still hold refs to them */
+    sock.trace_ref = (bplib_mpool_ref_t)&tblk;
+    sock.tracing   = true;
+    UtAssert_INT32_EQ(bplib_dataservice_socket_destruct(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(sock.trace_ref);
+    UtAssert_BOOL_FALSE(sock.tracing);
+
+    /* as is the completion queue, ops still in flight hold their own refs */
+    sock.completions_ref = (bplib_mpool_ref_t)&tblk;
+    UtAssert_INT32_EQ(bplib_dataservice_socket_destruct(NULL, &sblk), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_mpool_recycle_block, 1);
+    UtAssert_NULL(sock.completions_ref);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_serviceflow_trace_egress(void)
+{
+    /* Test function for:
+     * void bplib_serviceflow_trace_egress(bplib_mpool_bblock_primary_t *pri_block, uint64_t now)
+     */
+    bplib_mpool_bblock_primary_t pri;
+    bplib_mpool_block_t          other_blk;
+    uint32_t (*latency)[BPLIB_TRACE_LATENCY_BINS];
+
+    memset(&pri, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&other_blk, 0, sizeof(bplib_mpool_block_t));
+    UT_lib_trace_Setup();
+    latency = UT_lib_trace.trace.latency;
+
+    /* not traced, only the time is kept */
+    bplib_serviceflow_trace_egress(&pri, 1000);
+    UtAssert_UINT32_EQ(pri.data.delivery.stage_time[bplib_trace_stage_cla_egress], 1000);
+
+    /* a bundle made here is timed from the send call, skipping the stages it did not go through */
+    pri.data.delivery.trace_ref                                 = (bplib_mpool_ref_t)&UT_lib_trace.trace_blk;
+    pri.data.delivery.ingress_time                              = 100;
+    pri.data.delivery.stage_time[bplib_trace_stage_bundleize]   = 100;
+    pri.data.delivery.stage_time[bplib_trace_stage_route]       = 105;
+    pri.data.delivery.stage_time[bplib_trace_stage_cache_store] = 0;
+    pri.data.logical.creationTimeStamp.time                     = 50;
+    bplib_serviceflow_trace_egress(&pri, 1105);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_bundleize][0], 1);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_route][1], 1);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_cache_store][0], 0);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_cla_egress][4], 1);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_cla_ingress][0], 0);
+
+    /* one from another node is timed from its creation, but not if it had no clock */
+    memset(&pri.data.delivery.stage_time, 0, sizeof(pri.data.delivery.stage_time));
+    pri.data.delivery.stage_time[bplib_trace_stage_route] = 80;
+    bplib_serviceflow_trace_egress(&pri, 90);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_route][2], 1);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_cla_egress][2], 1);
+
+    pri.data.logical.creationTimeStamp.time = 0;
+    bplib_serviceflow_trace_egress(&pri, 90);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_route][2], 1);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_cla_egress][2], 2);
+
+    /* the ref is not to a histogram block */
+    pri.data.delivery.trace_ref = (bplib_mpool_ref_t)&other_blk;
+    bplib_serviceflow_trace_egress(&pri, 90);
+    UtAssert_UINT32_EQ(latency[bplib_trace_stage_cla_egress][2], 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
 void TestBplibBase_DataServiceApi_Register(void)
 {
     UtTest_Add(test_bplib_dataservice_add_base_intf, NULL, NULL, "Test bplib_dataservice_add_base_intf");
@@ -551,9 +2536,33 @@ void TestBplibBase_DataServiceApi_Register(void)
     UtTest_Add(test_bplib_bind_socket, NULL, NULL, "Test bplib_bind_socket");
     UtTest_Add(test_bplib_close_socket, NULL, NULL, "Test bplib_close_socket");
     UtTest_Add(test_bplib_send, NULL, NULL, "Test bplib_send");
+    UtTest_Add(test_bplib_send_local, NULL, NULL, "Test bplib_send to a local service");
+    UtTest_Add(test_bplib_send_many, NULL, NULL, "Test bplib_send_many");
+    UtTest_Add(test_bplib_send_extern, NULL, NULL, "Test bplib_send_extern");
     UtTest_Add(test_bplib_recv, NULL, NULL, "Test bplib_recv");
+    UtTest_Add(test_bplib_recv_many, NULL, NULL, "Test bplib_recv_many");
+    UtTest_Add(test_bplib_recv_view, NULL, NULL, "Test bplib_recv_view");
+    UtTest_Add(test_bplib_socket_set_nonblocking, NULL, NULL, "Test bplib_socket_set_nonblocking");
+    UtTest_Add(test_bplib_socket_set_egress_encode, NULL, NULL, "Test bplib_socket_set_egress_encode");
+    UtTest_Add(test_bplib_socket_set_coalescing, NULL, NULL, "Test bplib_socket_set_coalescing");
+    UtTest_Add(test_bplib_send_coalesce, NULL, NULL, "Test bplib_send_coalesce");
+    UtTest_Add(test_bplib_recv_coalesce, NULL, NULL, "Test bplib_recv_coalesce");
+    UtTest_Add(test_bplib_socket_set_tracing, NULL, NULL, "Test bplib_socket_set_tracing");
+    UtTest_Add(test_bplib_socket_query_latency, NULL, NULL, "Test bplib_socket_query_latency");
+    UtTest_Add(test_bplib_socket_set_sampling, NULL, NULL, "Test bplib_socket_set_sampling");
+    UtTest_Add(test_bplib_socket_set_completions, NULL, NULL, "Test bplib_socket_set_completions");
+    UtTest_Add(test_bplib_send_async, NULL, NULL, "Test bplib_send_async");
+    UtTest_Add(test_bplib_get_completions, NULL, NULL, "Test bplib_get_completions");
+    UtTest_Add(test_bplib_socket_get_completion_fd, NULL, NULL, "Test bplib_socket_get_completion_fd");
+    UtTest_Add(test_bplib_socket_get_notify_fd, NULL, NULL, "Test bplib_socket_get_notify_fd");
     UtTest_Add(test_bplib_serviceflow_forward_ingress, NULL, NULL, "Test bplib_serviceflow_forward_ingress");
     UtTest_Add(test_bplib_serviceflow_forward_egress, NULL, NULL, "Test bplib_serviceflow_forward_egress");
+    UtTest_Add(test_bplib_serviceflow_push_custody_ack, NULL, NULL, "Test bplib_serviceflow_push_custody_ack");
+    UtTest_Add(test_bplib_serviceflow_add_to_base, NULL, NULL, "Test bplib_serviceflow_add_to_base");
+    UtTest_Add(test_bplib_serviceflow_remove_from_base, NULL, NULL, "Test bplib_serviceflow_remove_from_base");
     UtTest_Add(test_bplib_dataservice_event_impl, NULL, NULL, "Test bplib_dataservice_event_impl");
     UtTest_Add(test_bplib_dataservice_base_construct, NULL, NULL, "Test bplib_dataservice_base_construct");
+    UtTest_Add(test_bplib_dataservice_base_destruct, NULL, NULL, "Test bplib_dataservice_base_destruct");
+    UtTest_Add(test_bplib_dataservice_socket_destruct, NULL, NULL, "Test bplib_dataservice_socket_destruct");
+    UtTest_Add(test_bplib_serviceflow_trace_egress, NULL, NULL, "Test bplib_serviceflow_trace_egress");
 }
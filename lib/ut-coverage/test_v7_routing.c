@@ -30,6 +30,21 @@ static void V7__routing_GetTime_Handler(void *UserObj, UT_EntryKey_t FuncKey, co
     UT_Stub_SetReturnValue(FuncKey, retval);
 }
 
+static void UT_lib_baseintf_AltHandler_PullBatch(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *list   = UT_Hook_GetArgValueByName(Context, "list", bplib_mpool_block_t *);
+    uint32_t             retval = 0;
+
+    /* hand out a batch of one on the first few calls, then report the queue as empty */
+    if (UT_GetStubCount(UT_KEY(bplib_mpool_flow_try_pull_n)) <= 3)
+    {
+        list->next = UserObj;
+        retval     = 1;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
 void test_bplib_route_ingress_to_parent(void)
 {
     /* Test function for:
@@ -59,23 +74,101 @@ void test_bplib_route_ingress_route_single_bundle(void)
      * void bplib_route_ingress_route_single_bundle(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk)
      */
     bplib_routetbl_t             tbl;
-    bplib_routeentry_t           route_entry;
+    bplib_routeentry_t           route_entry[2];
+    bplib_routeset_t             route_sets[2];
     bplib_mpool_block_t          pblk;
     bplib_mpool_bblock_primary_t pri_block;
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_cla_stats_t            stats;
 
     memset(&tbl, 0, sizeof(bplib_routetbl_t));
-    memset(&route_entry, 0, sizeof(bplib_routeentry_t));
-    tbl.route_tbl          = &route_entry;
-    tbl.route_tbl->intf_id = BPLIB_HANDLE_FLASH_STORE_BASE;
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 1);
     memset(&pblk, 0, sizeof(bplib_mpool_block_t));
     memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
 
     pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
-    tbl.registered_routes                   = 1;
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 0, 0, BPLIB_HANDLE_FLASH_STORE_BASE), 0);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
     UtAssert_VOIDCALL(bplib_route_ingress_route_single_bundle((bplib_routetbl_t *)&tbl, &pblk));
+    UtAssert_UINT32_EQ(tbl.routing_error_count, 1);
+
+    /* with nowhere to go, it is counted against the CLA it came in on */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_VOIDCALL(bplib_route_ingress_route_single_bundle((bplib_routetbl_t *)&tbl, &pblk));
+    UtAssert_UINT32_EQ(stats.counters[bplib_cla_counter_drop_no_route], 1);
+    UtAssert_UINT32_EQ(tbl.routing_error_count, 2);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_route_ingress_cut_through(void)
+{
+    /* Test function for:
+     * bool bplib_route_ingress_cut_through(bplib_routetbl_t *tbl, bplib_mpool_block_t *pblk)
+     */
+    bplib_routetbl_t             tbl;
+    bplib_routeentry_t           route_entry[2];
+    bplib_routeset_t             route_sets[2];
+    bplib_mpool_block_t          pblk;
+    bplib_mpool_bblock_primary_t pri_block;
+    bplib_mpool_block_content_t  flow_ref;
+    bplib_mpool_flow_t           flow;
+    bplib_cla_stats_t            stats;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 1);
+    memset(&pblk, 0, sizeof(bplib_mpool_block_t));
+    memset(&pri_block, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&flow_ref, 0, sizeof(bplib_mpool_block_content_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&stats, 0, sizeof(bplib_cla_stats_t));
+
+    /* not a bundle */
+    UtAssert_BOOL_FALSE(bplib_route_ingress_cut_through(&tbl, &pblk));
+
+    /* a bundle that has to be stored first takes the usual path */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, &pri_block);
+    pri_block.data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
+    UtAssert_BOOL_FALSE(bplib_route_ingress_cut_through(&tbl, &pblk));
+
+    /* so does a fragment */
+    pri_block.data.delivery.delivery_policy        = bplib_policy_delivery_none;
+    pri_block.data.logical.controlFlags.isFragment = true;
+    UtAssert_BOOL_FALSE(bplib_route_ingress_cut_through(&tbl, &pblk));
+
+    /* no route */
+    pri_block.data.logical.controlFlags.isFragment = false;
+    UtAssert_BOOL_FALSE(bplib_route_ingress_cut_through(&tbl, &pblk));
+
+    /* the next hop is up but is not a CLA */
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 0, 0, bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE)), 0);
+    flow.current_state_flags = BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_ref);
+    UtAssert_BOOL_FALSE(bplib_route_ingress_cut_through(&tbl, &pblk));
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 1);
+
+    /* a CLA with a full egress queue */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, &stats);
+    UtAssert_BOOL_FALSE(bplib_route_ingress_cut_through(&tbl, &pblk));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_try_push, 1);
+
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push), 1, true);
+    UtAssert_BOOL_TRUE(bplib_route_ingress_cut_through(&tbl, &pblk));
+    UtAssert_UINT32_EQ(tbl.routing_success_count, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_ref_release, 3);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_primary_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_generic_data_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
 void test_bplib_route_ingress_baseintf_forwarder(void)
@@ -86,18 +179,34 @@ void test_bplib_route_ingress_baseintf_forwarder(void)
     bplib_routetbl_t    rtbl;
     bplib_mpool_block_t subq_src;
     bplib_mpool_flow_t  flow;
+    bplib_mpool_job_t   job;
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
     memset(&subq_src, 0, sizeof(bplib_mpool_block_t));
     memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    memset(&job, 0, sizeof(bplib_mpool_job_t));
 
     UtAssert_UINT32_NEQ(bplib_route_ingress_baseintf_forwarder(&rtbl, NULL), 0);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_baseintf_AltHandler_PointerReturn, &subq_src);
-    UtAssert_UINT32_NEQ(bplib_route_ingress_baseintf_forwarder(&rtbl, NULL), 0);
-
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_EQ(bplib_route_ingress_baseintf_forwarder(&rtbl, NULL), 0);
+
+    UT_ResetState(UT_KEY(bplib_mpool_flow_try_pull_n));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull_n), UT_lib_baseintf_AltHandler_PullBatch, &subq_src);
+    UtAssert_INT32_EQ(bplib_route_ingress_baseintf_forwarder(&rtbl, NULL), 3);
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 3);
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 0);
+
+    /* once the share of the job is used up, it yields to the other jobs */
+    UT_ResetState(UT_KEY(bplib_mpool_flow_try_pull_n));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_try_pull_n), UT_lib_baseintf_AltHandler_PullBatch, &subq_src);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_job_cast), UT_lib_AltHandler_PointerReturn, &job);
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_job_spend_share), 1, true);
+    UtAssert_INT32_EQ(bplib_route_ingress_baseintf_forwarder(&rtbl, &job.link), 1);
+    UtAssert_STUB_COUNT(bplib_mpool_job_mark_active, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_job_cast), UT_lib_AltHandler_PointerReturn, NULL);
+
+    UT_ResetState(UT_KEY(bplib_mpool_flow_try_pull_n));
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
@@ -173,6 +282,14 @@ void test_bplib_route_push_egress_bundle(void)
     UtAssert_UINT32_NEQ(bplib_route_push_egress_bundle(&tbl, intf_id, cb), 0);
 }
 
+static void UT_lib_routing_AltHandler_SetRequest(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_routetbl_t *rtbl = UserObj;
+
+    /* as if another thread called bplib_route_set_maintenance_request() while this one was waiting */
+    rtbl->maint_request_flag = true;
+}
+
 void test_bplib_route_maintenance_request_wait(void)
 {
     /* Test function for:
@@ -181,10 +298,106 @@ void test_bplib_route_maintenance_request_wait(void)
     bplib_routetbl_t rtbl;
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
-    rtbl.last_intf_poll = 0;
+    rtbl.next_poll_time    = 0;
+    rtbl.next_contact_time = BP_DTNTIME_INFINITE;
 
     UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), V7__routing_GetTime_Handler, NULL);
     UtAssert_VOIDCALL(bplib_route_maintenance_request_wait(&rtbl));
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 0);
+    UtAssert_BOOL_TRUE(rtbl.maint_active_flag);
+
+    /* with no deadline, only a request ends the wait */
+    rtbl.next_poll_time = BP_DTNTIME_INFINITE;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_wait_until_ms), UT_lib_routing_AltHandler_SetRequest, &rtbl);
+    UtAssert_VOIDCALL(bplib_route_maintenance_request_wait(&rtbl));
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 1);
+    UtAssert_BOOL_FALSE(rtbl.maint_request_flag);
+}
+
+static void UT_lib_routing_AltHandler_NewRequest(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_routetbl_t *rtbl = UserObj;
+
+    /* as if another thread made a request while this one was waiting */
+    ++rtbl->maint_request_count;
+}
+
+void test_bplib_route_worker_process_flows(void)
+{
+    /* Test function for:
+     * void bplib_route_worker_process_flows(bplib_routetbl_t *tbl, uint32_t timeout_ms)
+     */
+    bplib_routetbl_t rtbl;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), V7__routing_GetTime_Handler, NULL);
+    UtAssert_VOIDCALL(bplib_route_worker_process_flows(&rtbl, 0));
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_job_run_all, 1);
+
+    /* a request wakes the worker without being cleared */
+    rtbl.maint_request_flag = true;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_wait_until_ms), UT_lib_routing_AltHandler_NewRequest, &rtbl);
+    UtAssert_VOIDCALL(bplib_route_worker_process_flows(&rtbl, 100));
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_job_run_all, 2);
+    UtAssert_BOOL_TRUE(rtbl.maint_request_flag);
+
+    UtAssert_VOIDCALL(bplib_route_set_maintenance_request(&rtbl));
+    UtAssert_UINT32_EQ(rtbl.maint_request_count, 2);
+}
+
+void test_bplib_route_intf_slots(void)
+{
+    /* Test function for:
+     * the interface slot table used by bplib_route_register_generic_intf(), bplib_route_del_intf()
+     * and every function that resolves an interface handle
+     */
+    bplib_routetbl_t       tbl;
+    bplib_route_intfslot_t intf_slots[BPLIB_ROUTE_INTF_SLOTS];
+    bplib_routeentry_t     route_entry[2];
+    bplib_routeset_t       route_sets[2];
+    bplib_mpool_block_t    flow_block;
+    bplib_mpool_flow_t     ifp;
+    bp_handle_t            intf_id;
+    bp_handle_t            other_id;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(intf_slots, 0, sizeof(intf_slots));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 1);
+    tbl.intf_slots = intf_slots;
+    memset(&flow_block, 0, sizeof(bplib_mpool_block_t));
+    flow_block.parent_offset = 20;
+    flow_block.type          = bplib_mpool_blocktype_flow;
+    memset(&ifp, 0, sizeof(bplib_mpool_flow_t));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &ifp);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &flow_block);
+    intf_id = bplib_route_register_generic_intf(&tbl, BP_INVALID_HANDLE, &flow_block);
+    UtAssert_BOOL_TRUE(bp_handle_equal(intf_id, bplib_mpool_get_external_id(&flow_block)));
+    UT_ResetState(UT_KEY(bplib_mpool_block_from_external_id));
+
+    /* a registered interface is found without asking the pool */
+    UT_SetDeferredRetcode(UT_KEY(bplib_mpool_flow_try_push), 1, true);
+    UtAssert_INT32_EQ(bplib_route_push_egress_bundle(&tbl, intf_id, NULL), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_block_from_external_id, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 1);
+
+    /* a different handle, which may or may not be the same slot, is not */
+    other_id = bp_handle_from_serial(21, BPLIB_HANDLE_MPOOL_BASE);
+    UtAssert_INT32_NEQ(bplib_route_push_egress_bundle(&tbl, other_id, NULL), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_block_from_external_id, 1);
+
+    /* after deletion the slot is free again, so the pool is asked */
+    UtAssert_INT32_EQ(bplib_route_del_intf(&tbl, intf_id), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_block_from_external_id, 1);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_INT32_NEQ(bplib_route_push_egress_bundle(&tbl, intf_id, NULL), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_block_from_external_id, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
 void test_bplib_route_register_event_handler(void)
@@ -216,13 +429,15 @@ void test_bplib_route_del_intf(void)
      * int bplib_route_del_intf(bplib_routetbl_t *tbl, bp_handle_t intf_id)
      */
     bplib_routetbl_t   tbl;
-    bplib_routeentry_t route_entry;
+    bplib_routeentry_t route_entry[2];
+    bplib_routeset_t   route_sets[2];
     bp_handle_t        intf_id;
     bplib_mpool_ref_t  ref;
     bplib_mpool_flow_t ifp;
 
     memset(&tbl, 0, sizeof(bplib_routetbl_t));
-    memset(&route_entry, 0, sizeof(bplib_routeentry_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 1);
     memset(&intf_id, 0, sizeof(bp_handle_t));
     memset(&ref, 0, sizeof(bplib_mpool_ref_t));
     memset(&ifp, 0, sizeof(bplib_mpool_flow_t));
@@ -232,9 +447,14 @@ void test_bplib_route_del_intf(void)
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &ref);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &ifp);
-    tbl.registered_routes = 1;
-    tbl.route_tbl         = &route_entry;
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 0, 0, intf_id), 0);
+    UtAssert_UINT32_EQ(bplib_route_del_intf((bplib_routetbl_t *)&tbl, intf_id), 0);
+    UtAssert_UINT32_EQ(tbl.route_sets[tbl.route_set_idx].registered_routes, 0);
+    UtAssert_UINT32_EQ(tbl.route_sets[tbl.route_set_idx].num_levels, 0);
+
+    /* nothing to take out the second time */
     UtAssert_UINT32_EQ(bplib_route_del_intf((bplib_routetbl_t *)&tbl, intf_id), 0);
+    UtAssert_UINT32_EQ(tbl.route_set_idx, 0);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
@@ -245,9 +465,13 @@ void test_bplib_route_get_next_avail_intf(void)
     /* Test function for:
      * bp_handle_t bplib_route_get_next_avail_intf(const bplib_routetbl_t *tbl, bp_ipn_t dest)
      */
-    bplib_routetbl_t tbl;
+    bplib_routetbl_t   tbl;
+    bplib_routeset_t   route_sets[2];
+    bplib_routeentry_t route_entry[2];
 
     memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 1);
     bp_ipn_t dest = 101;
     UtAssert_UINT32_EQ(bplib_route_get_next_avail_intf(&tbl, dest).hdl, 0);
 }
@@ -278,40 +502,50 @@ void test_bplib_route_add(void)
      * int bplib_route_add(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id)
      */
     bplib_routetbl_t   rtbl;
-    bplib_routeentry_t route_entry;
-    bplib_mpool_t      pool;
+    bplib_routeentry_t route_entry[8];
+    bplib_routeset_t   route_sets[2];
+    bplib_routeset_t  *set;
     bp_ipn_t           dest = 101;
     bp_ipn_t           mask = 100;
     bp_handle_t        intf_id;
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
-    memset(&route_entry, 0, sizeof(bplib_routeentry_t));
-    rtbl.route_tbl = &route_entry;
-    memset(&pool, 0, sizeof(bplib_mpool_t));
-    rtbl.pool = &pool;
-
-    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, &rtbl);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_create), UT_lib_AltHandler_PointerReturn, &pool);
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 4);
     memset(&intf_id, 0, sizeof(bp_handle_t));
 
-    rtbl.registered_routes = 20;
-    UtAssert_UINT32_NEQ(bplib_route_add((bplib_routetbl_t *)&rtbl, dest, mask, intf_id), 0);
-
-    rtbl.registered_routes = 1;
-    rtbl.max_routes        = 100;
+    /* mask with gaps */
     UtAssert_UINT32_NEQ(bplib_route_add((bplib_routetbl_t *)&rtbl, dest, mask, intf_id), 0);
 
-    mask             = 0;
-    route_entry.mask = 0;
-    route_entry.dest = 101;
+    /* table full */
+    mask            = 0;
+    rtbl.max_routes = 0;
     UtAssert_UINT32_NEQ(bplib_route_add((bplib_routetbl_t *)&rtbl, dest, mask, intf_id), 0);
+    UtAssert_UINT32_EQ(rtbl.route_set_idx, 0);
 
-    route_entry.mask       = 1;
-    rtbl.registered_routes = 2;
+    /* each change is made in the other set, which then becomes current */
+    rtbl.max_routes = 4;
     UtAssert_UINT32_EQ(bplib_route_add((bplib_routetbl_t *)&rtbl, dest, mask, intf_id), 0);
+    UtAssert_UINT32_EQ(rtbl.route_set_idx, 1);
+    UtAssert_UINT32_EQ(route_sets[0].registered_routes, 0);
+    UtAssert_UINT32_EQ(route_sets[1].registered_routes, 1);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
-    UT_SetHandlerFunction(UT_KEY(bplib_mpool_create), UT_lib_AltHandler_PointerReturn, NULL);
+    /* duplicate */
+    UtAssert_UINT32_NEQ(bplib_route_add((bplib_routetbl_t *)&rtbl, dest, mask, intf_id), 0);
+
+    /* more specific routes go in front of the default one, sorted by dest */
+    UtAssert_UINT32_EQ(bplib_route_add((bplib_routetbl_t *)&rtbl, 200, ~(bp_ipn_t)0xFF, intf_id), 0);
+    UtAssert_UINT32_EQ(bplib_route_add((bplib_routetbl_t *)&rtbl, 0x100, ~(bp_ipn_t)0xFF, intf_id), 0);
+    UtAssert_UINT32_EQ(bplib_route_add((bplib_routetbl_t *)&rtbl, 0x100, ~(bp_ipn_t)0, intf_id), 0);
+    set = &route_sets[rtbl.route_set_idx];
+    UtAssert_UINT32_EQ(set->registered_routes, 4);
+    UtAssert_UINT32_EQ(set->num_levels, 3);
+    UtAssert_UINT32_EQ(set->route_tbl[0].mask, ~(bp_ipn_t)0);
+    UtAssert_UINT32_EQ(set->route_tbl[1].dest, 200);
+    UtAssert_UINT32_EQ(set->route_tbl[2].dest, 0x100);
+    UtAssert_UINT32_EQ(set->route_tbl[3].mask, 0);
+    UtAssert_UINT32_EQ(set->levels[1].start_pos, 1);
+    UtAssert_UINT32_EQ(set->levels[1].end_pos, 3);
 }
 
 void test_bplib_route_del(void)
@@ -320,21 +554,116 @@ void test_bplib_route_del(void)
      * int bplib_route_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id)
      */
     bplib_routetbl_t   tbl;
-    bplib_routeentry_t route_entry;
+    bplib_routeentry_t route_entry[4];
+    bplib_routeset_t   route_sets[2];
     bp_ipn_t           dest = 101;
-    bp_ipn_t           mask = 100;
+    bp_ipn_t           mask = ~(bp_ipn_t)0xFF;
     bp_handle_t        intf_id;
 
     memset(&tbl, 0, sizeof(bplib_routetbl_t));
-    memset(&route_entry, 0, sizeof(bplib_routeentry_t));
+    memset(route_entry, 0, sizeof(route_entry));
     memset(&intf_id, 0, sizeof(bp_handle_t));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 2);
 
     UtAssert_UINT32_NEQ(bplib_route_del((bplib_routetbl_t *)&tbl, dest, mask, intf_id), 0);
-    tbl.registered_routes = 1;
-    tbl.route_tbl         = &route_entry;
-    tbl.route_tbl->dest   = 101;
-    tbl.route_tbl->mask   = 100;
+
+    UtAssert_UINT32_EQ(bplib_route_add((bplib_routetbl_t *)&tbl, dest, mask, intf_id), 0);
+    UtAssert_UINT32_EQ(bplib_route_add((bplib_routetbl_t *)&tbl, 0, 0, intf_id), 0);
+
+    /* not a route that was added */
+    UtAssert_UINT32_NEQ(bplib_route_del((bplib_routetbl_t *)&tbl, dest, ~(bp_ipn_t)0, intf_id), 0);
+    UtAssert_UINT32_NEQ(bplib_route_del((bplib_routetbl_t *)&tbl, 0x1000, mask, intf_id), 0);
+
+    UtAssert_UINT32_EQ(tbl.route_set_idx, 0);
     UtAssert_UINT32_EQ(bplib_route_del((bplib_routetbl_t *)&tbl, dest, mask, intf_id), 0);
+    UtAssert_UINT32_EQ(tbl.route_set_idx, 1);
+    UtAssert_UINT32_EQ(route_sets[1].registered_routes, 1);
+    UtAssert_UINT32_EQ(route_sets[1].num_levels, 1);
+    UtAssert_UINT32_EQ(route_sets[1].route_tbl[0].mask, 0);
+
+    /* the set that was current before still has both, for any lookup that was using it */
+    UtAssert_UINT32_EQ(route_sets[0].registered_routes, 2);
+}
+
+void test_bplib_route_replace_all(void)
+{
+    /* Test function for:
+     * int bplib_route_replace_all(bplib_routetbl_t *tbl, const bplib_route_spec_t *routes, uint32_t route_count)
+     */
+    bplib_routetbl_t   rtbl;
+    bplib_routeentry_t route_entry[8];
+    bplib_routeentry_t scratch[4];
+    bplib_routeset_t   route_sets[2];
+    bplib_routeset_t  *set;
+    bplib_route_spec_t routes[5];
+    bplib_mpool_flow_t flow;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    memset(routes, 0, sizeof(routes));
+    memset(&flow, 0, sizeof(flow));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 4);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
+
+    /* given out of order, with the two routes to 0x100/24 in the order that has to stay */
+    routes[0] = (bplib_route_spec_t) {.dest = 0, .mask = 0, .intf_id = {1}};
+    routes[1] = (bplib_route_spec_t) {.dest = 0x100, .mask = ~(bp_ipn_t)0xFF, .intf_id = {3}};
+    routes[2] = (bplib_route_spec_t) {.dest = 200, .mask = ~(bp_ipn_t)0xFF, .intf_id = {1}};
+    routes[3] = (bplib_route_spec_t) {.dest = 0x100, .mask = ~(bp_ipn_t)0xFF, .intf_id = {2}};
+    routes[4] = (bplib_route_spec_t) {.dest = 0x100, .mask = ~(bp_ipn_t)0, .intf_id = {1}};
+
+    /* too many for the table */
+    UtAssert_INT32_NEQ(bplib_route_replace_all(&rtbl, routes, 5), 0);
+
+    /* not a mask */
+    routes[4].mask = 100;
+    UtAssert_INT32_NEQ(bplib_route_replace_all(&rtbl, &routes[1], 4), 0);
+    routes[4].mask = ~(bp_ipn_t)0;
+
+    /* no memory to sort in */
+    UtAssert_INT32_NEQ(bplib_route_replace_all(&rtbl, &routes[1], 4), 0);
+    UtAssert_UINT32_EQ(rtbl.route_set_idx, 0);
+
+    /* all at once, and one event for each flow that wants to know */
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, scratch);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    flow.current_state_flags = BPLIB_MPOOL_FLOW_FLAGS_CONTACTS;
+    UtAssert_INT32_EQ(bplib_route_replace_all(&rtbl, &routes[1], 4), 0);
+    UtAssert_UINT32_EQ(rtbl.route_set_idx, 1);
+    UtAssert_STUB_COUNT(bplib_os_free, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 1);
+    set = &route_sets[1];
+    UtAssert_UINT32_EQ(set->registered_routes, 4);
+    UtAssert_UINT32_EQ(set->num_levels, 2);
+    UtAssert_UINT32_EQ(set->route_tbl[0].mask, ~(bp_ipn_t)0);
+    UtAssert_UINT32_EQ(set->route_tbl[1].dest, 200);
+    UtAssert_UINT32_EQ(set->route_tbl[2].intf_id.hdl, 3);
+    UtAssert_UINT32_EQ(set->route_tbl[3].intf_id.hdl, 2);
+    UtAssert_UINT32_EQ(set->levels[1].start_pos, 1);
+    UtAssert_UINT32_EQ(set->levels[1].end_pos, 4);
+
+    /* the flag is toggled back the next time */
+    flow.pending_state_flags = BPLIB_MPOOL_FLOW_FLAGS_ROUTES;
+    UtAssert_INT32_EQ(bplib_route_replace_all(&rtbl, routes, 1), 0);
+    UtAssert_UINT32_EQ(rtbl.route_set_idx, 0);
+    UtAssert_UINT32_EQ(route_sets[0].registered_routes, 1);
+    UtAssert_UINT32_EQ(route_sets[0].num_levels, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 2);
+
+    /* a duplicate, which leaves the routes as they are */
+    routes[3].intf_id = routes[1].intf_id;
+    UtAssert_INT32_NEQ(bplib_route_replace_all(&rtbl, &routes[1], 4), 0);
+    UtAssert_UINT32_EQ(rtbl.route_set_idx, 0);
+
+    /* a flow that does not want contact events gets nothing, and no routes is also a route set */
+    flow.current_state_flags = 0;
+    flow.pending_state_flags = 0;
+    UtAssert_INT32_EQ(bplib_route_replace_all(&rtbl, routes, 0), 0);
+    UtAssert_UINT32_EQ(route_sets[1].registered_routes, 0);
+    UtAssert_UINT32_EQ(route_sets[1].num_levels, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), NULL, NULL);
 }
 
 void test_bplib_route_get_next_intf_with_flags(void)
@@ -344,25 +673,194 @@ void test_bplib_route_get_next_intf_with_flags(void)
      * uint32_t flag_mask)
      */
     bplib_routetbl_t   tbl;
-    bplib_routeentry_t route_entry;
+    bplib_routeentry_t route_entry[6];
+    bplib_routeset_t   route_sets[2];
     bp_ipn_t           dest      = 101;
     uint32_t           req_flags = 0;
     uint32_t           flag_mask = 0;
     bplib_mpool_flow_t flow_block;
 
     memset(&tbl, 0, sizeof(bplib_routetbl_t));
-    memset(&route_entry, 0, sizeof(bplib_routeentry_t));
-    tbl.route_tbl = &route_entry;
+    memset(route_entry, 0, sizeof(route_entry));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 3);
     memset(&flow_block, 0, sizeof(bplib_mpool_flow_t));
 
-    tbl.registered_routes = 1;
+    /* no routes */
     UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags((bplib_routetbl_t *)&tbl, dest, req_flags, flag_mask).hdl,
                        0);
 
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 0, 0, bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE)), 0);
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 100, ~(bp_ipn_t)0xF, bp_handle_from_serial(2, BPLIB_HANDLE_MPOOL_BASE)),
+                       0);
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 200, ~(bp_ipn_t)0xF, bp_handle_from_serial(3, BPLIB_HANDLE_MPOOL_BASE)),
+                       0);
+
+    /* longest prefix match wins, otherwise falls back to the default route */
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, dest, req_flags, flag_mask).hdl,
+                       bp_handle_from_serial(2, BPLIB_HANDLE_MPOOL_BASE).hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 205, req_flags, flag_mask).hdl,
+                       bp_handle_from_serial(3, BPLIB_HANDLE_MPOOL_BASE).hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 300, req_flags, flag_mask).hdl,
+                       bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE).hdl);
+
+    /* a flow that does not have the required flags is passed over */
     flag_mask = 1;
+    req_flags = 1;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow_block);
     UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags((bplib_routetbl_t *)&tbl, dest, req_flags, flag_mask).hdl,
                        0);
+    flow_block.current_state_flags = 1;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, dest, req_flags, flag_mask).hdl,
+                       bp_handle_from_serial(2, BPLIB_HANDLE_MPOOL_BASE).hdl);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+void test_bplib_route_get_next_intf_cached(void)
+{
+    /* Test function for:
+     * bp_handle_t bplib_route_get_next_intf_with_flags(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t req_flags,
+     * uint32_t flag_mask)
+     * with the route cache in use
+     */
+    bplib_routetbl_t         tbl;
+    bplib_routeentry_t       route_entry[4];
+    bplib_routeset_t         route_sets[2];
+    bplib_routecache_entry_t route_cache[BPLIB_ROUTE_CACHE_SIZE];
+    bplib_mpool_flow_t       flow_block;
+    bp_handle_t              intf_id;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    memset(route_cache, 0, sizeof(route_cache));
+    memset(&flow_block, 0, sizeof(bplib_mpool_flow_t));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 2);
+    tbl.route_cache      = route_cache;
+    tbl.route_generation = 1;
+    intf_id              = bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE);
+
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 100, ~(bp_ipn_t)0xF, intf_id), 0);
+    UtAssert_UINT32_EQ(tbl.route_generation, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow_block);
+    flow_block.current_state_flags = 1;
+    flow_block.pending_state_flags = 1;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 1, 1).hdl, intf_id.hdl);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 1);
+
+    /* the second time the answer comes from the cache, without looking at the flow */
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 1, 1).hdl, intf_id.hdl);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 1);
+
+    /* but not for a different set of flags */
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 0, 0).hdl, intf_id.hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 1, 1).hdl, intf_id.hdl);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 2);
+
+    /* any route change invalidates it */
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 0, 0, intf_id), 0);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 1, 1).hdl, intf_id.hdl);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 3);
+
+    /* a flow that is in the middle of a flag change is not cached */
+    tbl.route_generation++;
+    flow_block.pending_state_flags = 0;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 1, 1).hdl, intf_id.hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 101, 1, 1).hdl, intf_id.hdl);
+    UtAssert_STUB_COUNT(bplib_mpool_flow_cast, 5);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+typedef struct
+{
+    bplib_mpool_flow_t *flows;
+    uint32_t            num_flows;
+    uint32_t            next_flow;
+} UT_lib_routing_FlowSequence_t;
+
+static void UT_lib_routing_AltHandler_FlowSequence(void *UserObj, UT_EntryKey_t FuncKey,
+                                                   const UT_StubContext_t *Context)
+{
+    UT_lib_routing_FlowSequence_t *seq = UserObj;
+    void                          *retval;
+
+    /* each lookup gets the next flow, as if each route was to a different interface */
+    retval = &seq->flows[seq->next_flow % seq->num_flows];
+    ++seq->next_flow;
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+void test_bplib_route_get_next_intf_for_flow(void)
+{
+    /* Test function for:
+     * bp_handle_t bplib_route_get_next_intf_for_flow(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t flow_hash,
+     *                                                uint32_t req_flags, uint32_t flag_mask)
+     */
+    bplib_routetbl_t              tbl;
+    bplib_routeentry_t            route_entry[8];
+    bplib_routeset_t              route_sets[2];
+    bplib_mpool_flow_t            flows[3];
+    UT_lib_routing_FlowSequence_t seq;
+    bp_handle_t                   intf_id[4];
+    uint32_t                      route_flags = BPLIB_ROUTE_FLAG_MULTIPATH | BPLIB_ROUTE_FLAG_LOAD_AWARE;
+    uint32_t                      i;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    memset(flows, 0, sizeof(flows));
+    memset(&seq, 0, sizeof(seq));
+    UT_lib_SetupRouteSets(&tbl, route_sets, route_entry, 4);
+    seq.flows     = flows;
+    seq.num_flows = 3;
+
+    for (i = 0; i < 4; ++i)
+    {
+        intf_id[i] = bp_handle_from_serial(1 + i, BPLIB_HANDLE_MPOOL_BASE);
+    }
+
+    /* three parallel paths to the same node, plus a plain default route */
+    UtAssert_UINT32_EQ(bplib_route_add_ext(&tbl, 100, ~(bp_ipn_t)0, intf_id[0], route_flags), 0);
+    UtAssert_UINT32_EQ(bplib_route_add_ext(&tbl, 100, ~(bp_ipn_t)0, intf_id[1], route_flags), 0);
+    UtAssert_UINT32_EQ(bplib_route_add_ext(&tbl, 100, ~(bp_ipn_t)0, intf_id[2], route_flags), 0);
+    UtAssert_UINT32_EQ(bplib_route_add(&tbl, 0, 0, intf_id[3]), 0);
+    UtAssert_UINT32_EQ(route_sets[tbl.route_set_idx].route_tbl[0].flags, route_flags);
+    UtAssert_UINT32_EQ(route_sets[tbl.route_set_idx].route_tbl[3].flags, 0);
+
+    /* the path is chosen by the flow hash */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_routing_AltHandler_FlowSequence, &seq);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 0, 0, 0).hdl, intf_id[0].hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 1, 0, 0).hdl, intf_id[1].hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 5, 0, 0).hdl, intf_id[2].hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_with_flags(&tbl, 100, 0, 0).hdl, intf_id[0].hdl);
+
+    /* paths that are down are not part of the group */
+    flows[0].current_state_flags = 1;
+    flows[2].current_state_flags = 1;
+    flows[0].pending_state_flags = 1;
+    flows[2].pending_state_flags = 1;
+    seq.next_flow                = 0;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 1, 1, 1).hdl, intf_id[2].hdl);
+
+    /* a congested path is passed over while others are open */
+    flows[2].current_state_flags |= BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH;
+    seq.next_flow = 0;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 1, 1, 1).hdl, intf_id[0].hdl);
+
+    /* if all are congested, it goes back to the hash */
+    flows[0].current_state_flags |= BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH;
+    seq.next_flow = 0;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 1, 1, 1).hdl, intf_id[2].hdl);
+
+    /* with none of the group up, it falls back to the less specific route */
+    flows[0].current_state_flags = 0;
+    flows[2].current_state_flags = 0;
+    flows[0].pending_state_flags = 0;
+    flows[2].pending_state_flags = 0;
+    seq.next_flow                = 0;
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 1, 1, 1).hdl, 0);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 100, 1, 0, 0).hdl, intf_id[1].hdl);
+    UtAssert_UINT32_EQ(bplib_route_get_next_intf_for_flow(&tbl, 200, 1, 0, 0).hdl, intf_id[3].hdl);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
 }
@@ -383,6 +881,7 @@ void test_bplib_route_intf_set_flags(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &ref);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_modify_flags), UT_lib_bool_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_route_intf_set_flags(&tbl, intf_id, flags), 0);
+    UtAssert_UINT32_EQ(tbl.route_generation, 1);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
 }
@@ -404,6 +903,7 @@ void test_bplib_route_intf_unset_flags(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, &ref);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_modify_flags), UT_lib_bool_Handler, NULL);
     UtAssert_UINT32_EQ(bplib_route_intf_unset_flags(&tbl, intf_id, flags), 0);
+    UtAssert_UINT32_EQ(tbl.route_generation, 1);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_ref_create), UT_lib_AltHandler_PointerReturn, NULL);
 }
@@ -418,73 +918,393 @@ void test_bplib_route_maintenance_complete_wait(void)
     UtAssert_VOIDCALL(bplib_route_maintenance_complete_wait(&rtbl));
 }
 
+void test_bplib_route_wait_until(void)
+{
+    /* Test function for:
+     * void bplib_route_wait_until(bplib_routetbl_t *tbl, uint64_t until_dtntime)
+     */
+    bplib_routetbl_t rtbl;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), V7__routing_GetTime_Handler, NULL);
+
+    /* already past */
+    UtAssert_VOIDCALL(bplib_route_wait_until(&rtbl, 1000));
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 0);
+    UtAssert_STUB_COUNT(bplib_os_unlock, 1);
+
+    /* waits until the timeout, a wakeup before that would wait again */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_wait_until_ms), BP_TIMEOUT);
+    UtAssert_VOIDCALL(bplib_route_wait_until(&rtbl, 1500));
+    UtAssert_STUB_COUNT(bplib_os_wait_until_ms, 1);
+    UtAssert_STUB_COUNT(bplib_os_unlock, 2);
+}
+
 void test_bplib_route_periodic_maintenance(void)
 {
     /* Test function for:
      * void bplib_route_periodic_maintenance(bplib_routetbl_t *tbl)
      */
-    bplib_routetbl_t rtbl;
+    bplib_routetbl_t   rtbl;
+    bplib_mpool_flow_t flow;
 
     memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    rtbl.next_contact_time = BP_DTNTIME_INFINITE;
 
     UT_SetHandlerFunction(UT_KEY(bplib_os_get_dtntime_ms), V7__routing_GetTime_Handler, NULL);
     UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
     UtAssert_VOIDCALL(bplib_route_periodic_maintenance((bplib_routetbl_t *)&rtbl));
 
-    rtbl.poll_count = 1;
+    /* a flow whose deadline passed gets a poll event, by toggling the POLL flag either way */
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_True(rtbl.next_poll_time == BP_DTNTIME_INFINITE, "rtbl.next_poll_time == BP_DTNTIME_INFINITE");
+    rtbl.next_poll_time = 0;
+    flow.poll_time      = 500;
+    UtAssert_VOIDCALL(bplib_route_periodic_maintenance((bplib_routetbl_t *)&rtbl));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 1);
+    UtAssert_True(flow.poll_time == BP_DTNTIME_INFINITE, "flow.poll_time cleared");
+    UtAssert_True(rtbl.next_poll_time == BP_DTNTIME_INFINITE, "rtbl.next_poll_time == BP_DTNTIME_INFINITE");
+
+    rtbl.next_poll_time       = 0;
+    flow.poll_time            = 1000;
+    flow.pending_state_flags  = BPLIB_MPOOL_FLOW_FLAGS_POLL;
     UtAssert_VOIDCALL(bplib_route_periodic_maintenance((bplib_routetbl_t *)&rtbl));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 2);
+
+    /* a flow that is not due yet only sets the next wakeup */
+    rtbl.next_poll_time = 0;
+    flow.poll_time      = 5000;
+    UtAssert_VOIDCALL(bplib_route_periodic_maintenance((bplib_routetbl_t *)&rtbl));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 2);
+    UtAssert_True(rtbl.next_poll_time == 5000, "rtbl.next_poll_time == 5000");
+
+    /* nothing is looked at before the next deadline */
+    flow.poll_time = 500;
+    UtAssert_VOIDCALL(bplib_route_periodic_maintenance((bplib_routetbl_t *)&rtbl));
+    UtAssert_STUB_COUNT(bplib_mpool_flow_modify_flags, 2);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+
+    /* the pool is only inspected with a budget */
+    UtAssert_STUB_COUNT(bplib_mpool_inspect_step, 0);
+    bplib_route_set_pool_inspect_budget(&rtbl, 10);
+    UtAssert_VOIDCALL(bplib_route_periodic_maintenance((bplib_routetbl_t *)&rtbl));
+    UtAssert_STUB_COUNT(bplib_mpool_inspect_step, 1);
+}
+
+void test_bplib_route_get_pool_inspection(void)
+{
+    /* Test function for:
+     * void bplib_route_get_pool_inspection(bplib_routetbl_t *tbl, bplib_mpool_inspection_t *result)
+     */
+    bplib_routetbl_t         rtbl;
+    bplib_mpool_inspection_t result;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    UtAssert_VOIDCALL(bplib_route_get_pool_inspection(&rtbl, &result));
+    UtAssert_STUB_COUNT(bplib_mpool_inspect_get, 1);
+}
+
+void test_bplib_route_intf_set_poll_time(void)
+{
+    /* Test function for:
+     * int bplib_route_intf_set_poll_time(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint64_t poll_time)
+     */
+    bplib_routetbl_t   tbl;
+    bp_handle_t        intf_id = BP_INVALID_HANDLE;
+    bplib_mpool_flow_t flow;
+
+    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    tbl.next_poll_time = BP_DTNTIME_INFINITE;
+
+    UtAssert_INT32_NEQ(bplib_route_intf_set_poll_time(&tbl, intf_id, 2000), 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UtAssert_INT32_EQ(bplib_route_intf_set_poll_time(&tbl, intf_id, 2000), 0);
+    UtAssert_True(flow.poll_time == 2000, "flow.poll_time == 2000");
+    UtAssert_True(tbl.next_poll_time == 2000, "tbl.next_poll_time == 2000");
+    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 1);
+
+    /* a later deadline does not move the next wakeup, that is sorted out when it is reached */
+    UtAssert_INT32_EQ(bplib_route_intf_set_poll_time(&tbl, intf_id, 3000), 0);
+    UtAssert_True(flow.poll_time == 3000, "flow.poll_time == 3000");
+    UtAssert_True(tbl.next_poll_time == 2000, "tbl.next_poll_time == 2000");
+    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 1);
+
+    /* the flow goes on the poll list once, and comes off it without a deadline */
+    flow.poll_link.next = &flow.poll_link;
+    flow.poll_link.prev = &flow.poll_link;
+    UtAssert_INT32_EQ(bplib_route_intf_set_poll_time(&tbl, intf_id, 2500), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 1);
+    flow.poll_link.next = &tbl.poll_list;
+    UtAssert_INT32_EQ(bplib_route_intf_set_poll_time(&tbl, intf_id, 2600), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_insert_before, 1);
+    UtAssert_INT32_EQ(bplib_route_intf_set_poll_time(&tbl, intf_id, BP_DTNTIME_INFINITE), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_extract_node, 1);
+    UtAssert_True(flow.poll_time == BP_DTNTIME_INFINITE, "flow.poll_time == BP_DTNTIME_INFINITE");
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
+static void UT_lib_routing_ContactFunc(void *arg, const bplib_route_contact_t *contact, bool is_start)
+{
+    uint32_t *counts = arg;
+
+    ++counts[is_start];
 }
 
+void test_bplib_route_contact_plan(void)
+{
+    /* Test function for:
+     * int bplib_route_contact_add(bplib_routetbl_t *tbl, const bplib_route_contact_t *contact)
+     * int bplib_route_contact_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id,
+     *                             uint64_t start_time)
+     * int bplib_route_contact_lookup(bplib_routetbl_t *tbl, bp_ipn_t dest, uint64_t dtntime,
+     *                                bplib_route_contact_t *contact)
+     * uint64_t bplib_route_contact_scan(bplib_routetbl_t *tbl, uint64_t after_time, uint64_t until_time,
+     *                                   bplib_route_contact_func_t func, void *arg)
+     * void bplib_route_do_contact_plan(bplib_routetbl_t *tbl)
+     */
+    bplib_routetbl_t          rtbl;
+    bplib_routeentry_t        route_entry[4];
+    bplib_routeset_t          route_sets[2];
+    bplib_route_contactslot_t contacts[BPLIB_ROUTE_MAX_CONTACTS];
+    bplib_route_contact_t     contact;
+    bplib_route_contact_t     found;
+    bplib_mpool_flow_t        flow;
+    uint32_t                  counts[2];
+    uint32_t                  i;
+
+    memset(&rtbl, 0, sizeof(bplib_routetbl_t));
+    memset(route_entry, 0, sizeof(route_entry));
+    memset(contacts, 0, sizeof(contacts));
+    memset(&flow, 0, sizeof(bplib_mpool_flow_t));
+    UT_lib_SetupRouteSets(&rtbl, route_sets, route_entry, 2);
+    rtbl.contacts          = contacts;
+    rtbl.next_poll_time    = BP_DTNTIME_INFINITE;
+    rtbl.next_contact_time = BP_DTNTIME_INFINITE;
+    flow.poll_time         = BP_DTNTIME_INFINITE;
+
+    memset(&contact, 0, sizeof(contact));
+    contact.dest       = 0x100;
+    contact.mask       = ~(bp_ipn_t)0xFF;
+    contact.start_time = 5000;
+    contact.end_time   = 8000;
+    contact.rate       = 1000000;
+    contact.lead_time  = 2000;
+
+    /* mask with gaps, or nothing to the contact */
+    contact.mask = 100;
+    UtAssert_INT32_NEQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    contact.mask     = ~(bp_ipn_t)0xFF;
+    contact.end_time = 5000;
+    UtAssert_INT32_NEQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    contact.end_time = 8000;
+
+    /* a flow that asked for contact events gets a poll at the announcement */
+    flow.current_state_flags = BPLIB_MPOOL_FLOW_FLAGS_CONTACTS;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, &flow);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_list_iter_forward), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_flow_cast), UT_lib_AltHandler_PointerReturn, NULL);
+    UtAssert_True(flow.poll_time == 3000, "flow.poll_time == 3000");
+    UtAssert_True(rtbl.next_poll_time == 3000, "rtbl.next_poll_time == 3000");
+    UtAssert_True(rtbl.next_contact_time == 5000, "rtbl.next_contact_time == 5000");
+    UtAssert_BOOL_TRUE(contacts[0].in_use);
+
+    /* the announcement comes first, then the start, and each is only seen once */
+    memset(counts, 0, sizeof(counts));
+    UtAssert_True(bplib_route_contact_scan(&rtbl, 0, 0, NULL, NULL) == 3000, "next is the announcement");
+    UtAssert_True(bplib_route_contact_scan(&rtbl, 0, 3500, UT_lib_routing_ContactFunc, counts) == 5000,
+                  "next is the start");
+    UtAssert_UINT32_EQ(counts[0], 1);
+    UtAssert_UINT32_EQ(counts[1], 0);
+    UtAssert_True(bplib_route_contact_scan(&rtbl, 3500, 4000, UT_lib_routing_ContactFunc, counts) == 5000,
+                  "nothing new");
+    UtAssert_UINT32_EQ(counts[0], 1);
+    UtAssert_True(bplib_route_contact_scan(&rtbl, 4000, 6000, UT_lib_routing_ContactFunc, counts) ==
+                      BP_DTNTIME_INFINITE,
+                  "nothing after the start");
+    UtAssert_UINT32_EQ(counts[0], 1);
+    UtAssert_UINT32_EQ(counts[1], 1);
+
+    /* one looked at late only gets the start, and an ended one nothing */
+    UtAssert_True(bplib_route_contact_scan(&rtbl, 0, 6000, UT_lib_routing_ContactFunc, counts) ==
+                      BP_DTNTIME_INFINITE,
+                  "only the start");
+    UtAssert_UINT32_EQ(counts[0], 1);
+    UtAssert_UINT32_EQ(counts[1], 2);
+    bplib_route_contact_scan(&rtbl, 0, 9000, UT_lib_routing_ContactFunc, counts);
+    UtAssert_UINT32_EQ(counts[1], 2);
+
+    /* nothing happens before the start */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 4000);
+    UtAssert_VOIDCALL(bplib_route_do_contact_plan(&rtbl));
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 0);
+    UtAssert_INT32_NEQ(bplib_route_contact_lookup(&rtbl, 0x123, 4000, &found), 0);
+
+    /* the route is in the table for the length of the contact */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 5000);
+    UtAssert_VOIDCALL(bplib_route_do_contact_plan(&rtbl));
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 1);
+    UtAssert_BOOL_TRUE(contacts[0].active);
+    UtAssert_True(rtbl.next_contact_time == 8000, "rtbl.next_contact_time == 8000");
+    UtAssert_INT32_EQ(bplib_route_contact_lookup(&rtbl, 0x123, 5000, &found), 0);
+    UtAssert_UINT32_EQ(found.rate, 1000000);
+    UtAssert_INT32_NEQ(bplib_route_contact_lookup(&rtbl, 0x223, 5000, &found), 0);
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 8000);
+    UtAssert_VOIDCALL(bplib_route_do_contact_plan(&rtbl));
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 0);
+    UtAssert_BOOL_FALSE(contacts[0].in_use);
+    UtAssert_True(rtbl.next_contact_time == BP_DTNTIME_INFINITE, "rtbl.next_contact_time == BP_DTNTIME_INFINITE");
+
+    /* a route that cannot be added, and deleting a contact in progress takes its route out */
+    UtAssert_INT32_EQ(bplib_route_add(&rtbl, contact.dest, contact.mask, contact.intf_id), 0);
+    contact.start_time = 9000;
+    contact.end_time   = 12000;
+    contact.lead_time  = 0;
+    UtAssert_INT32_EQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    contact.dest = 0x200;
+    UtAssert_INT32_EQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 9000);
+    UtAssert_VOIDCALL(bplib_route_do_contact_plan(&rtbl));
+    UtAssert_BOOL_FALSE(contacts[0].active);
+    UtAssert_BOOL_TRUE(contacts[1].active);
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 2);
+    UtAssert_INT32_EQ(bplib_route_contact_del(&rtbl, 0x200, contact.mask, contact.intf_id, 9000), 0);
+    UtAssert_INT32_NEQ(bplib_route_contact_del(&rtbl, 0x200, contact.mask, contact.intf_id, 9000), 0);
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 1);
+    UtAssert_INT32_EQ(bplib_route_contact_del(&rtbl, 0x100, contact.mask, contact.intf_id, 9000), 0);
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 1);
+
+    /* a contact missed entirely never puts its route in */
+    contact.start_time = 10000;
+    contact.end_time   = 11000;
+    UtAssert_INT32_EQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 11000);
+    UtAssert_VOIDCALL(bplib_route_do_contact_plan(&rtbl));
+    UtAssert_BOOL_FALSE(contacts[0].in_use);
+    UtAssert_UINT32_EQ(route_sets[rtbl.route_set_idx].registered_routes, 1);
+
+    /* the plan is full */
+    for (i = 0; i < BPLIB_ROUTE_MAX_CONTACTS; ++i)
+    {
+        UtAssert_INT32_EQ(bplib_route_contact_add(&rtbl, &contact), 0);
+    }
+    UtAssert_INT32_NEQ(bplib_route_contact_add(&rtbl, &contact), 0);
+
+    UT_ResetState(UT_KEY(bplib_os_get_dtntime_coarse_ms));
+}
+
+/* the table allocation also holds the route sets and route cache, this is big enough for a few routes */
+static union
+{
+    bplib_routetbl_t tbl;
+    uint8_t          mem[16384];
+} UT_lib_routing_TblMem;
+
 void test_bplib_route_alloc_table(void)
 {
     /* Test function for:
      * bplib_routetbl_t *bplib_route_alloc_table(uint32_t max_routes, size_t cache_mem_size)
      */
-    uint32_t         max_routes     = 0;
-    size_t           cache_mem_size = 1000;
-    bplib_routetbl_t tbl;
-    bplib_mpool_t    pool;
+    uint32_t          max_routes     = 0;
+    size_t            cache_mem_size = 1000;
+    bplib_routetbl_t *tbl            = &UT_lib_routing_TblMem.tbl;
+    bplib_mpool_t     pool;
 
-    memset(&tbl, 0, sizeof(bplib_routetbl_t));
+    memset(&UT_lib_routing_TblMem, 0, sizeof(UT_lib_routing_TblMem));
     memset(&pool, 0, sizeof(bplib_mpool_t));
 
     UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_sizet_Handler, NULL);
     UtAssert_NULL(bplib_route_alloc_table(max_routes, cache_mem_size));
 
     max_routes = 1;
-    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, &tbl);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, tbl);
     UtAssert_NULL(bplib_route_alloc_table(max_routes, cache_mem_size));
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_create), UT_lib_AltHandler_PointerReturn, &pool);
     UtAssert_NOT_NULL(bplib_route_alloc_table(max_routes, cache_mem_size));
+    UtAssert_NOT_NULL(tbl->route_sets);
+    UtAssert_ADDRESS_EQ(tbl->route_sets[1].route_tbl, tbl->route_sets[0].route_tbl + max_routes);
+    UtAssert_NOT_NULL(tbl->route_cache);
+    UtAssert_NOT_NULL(tbl->intf_slots);
+    UtAssert_NOT_NULL(tbl->contacts);
+    UtAssert_True(tbl->next_contact_time == BP_DTNTIME_INFINITE, "tbl->next_contact_time == BP_DTNTIME_INFINITE");
+    UtAssert_UINT32_EQ(tbl->pool_inspect_budget, BPLIB_MPOOL_INSPECT_BUDGET);
 
     UT_SetHandlerFunction(UT_KEY(bplib_os_calloc), UT_lib_AltHandler_PointerReturn, NULL);
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_create), UT_lib_AltHandler_PointerReturn, NULL);
 }
 
+void test_bplib_route_alloc_table_ext(void)
+{
+    /* Test function for:
+     * bplib_routetbl_t *bplib_route_alloc_table_ext(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags)
+     */
+    uint32_t          max_routes     = 1;
+    size_t            cache_mem_size = 1000;
+    bplib_routetbl_t *tbl            = &UT_lib_routing_TblMem.tbl;
+    bplib_mpool_t     pool;
+
+    memset(&UT_lib_routing_TblMem, 0, sizeof(UT_lib_routing_TblMem));
+    memset(&pool, 0, sizeof(bplib_mpool_t));
+
+    /* huge pages come from the OS pool memory, not calloc */
+    UtAssert_NULL(bplib_route_alloc_table_ext(max_routes, cache_mem_size, BPLIB_ROUTE_MEM_HUGEPAGE));
+    UtAssert_STUB_COUNT(bplib_os_alloc_pool_mem, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_alloc_pool_mem), UT_lib_AltHandler_PointerReturn, tbl);
+    UtAssert_NULL(bplib_route_alloc_table_ext(max_routes, cache_mem_size, BPLIB_ROUTE_MEM_LOCKED));
+    UtAssert_STUB_COUNT(bplib_os_free_pool_mem, 1);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_create_ext), UT_lib_AltHandler_PointerReturn, &pool);
+    UtAssert_ADDRESS_EQ(bplib_route_alloc_table_ext(max_routes, cache_mem_size,
+                                                    BPLIB_ROUTE_MEM_HUGEPAGE | BPLIB_ROUTE_MEM_LAZY_INIT),
+                        tbl);
+    UtAssert_ADDRESS_EQ(tbl->pool, &pool);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_alloc_pool_mem), UT_lib_AltHandler_PointerReturn, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_create_ext), UT_lib_AltHandler_PointerReturn, NULL);
+}
+
 void TestBplibBase_Routing_Register(void)
 {
     UtTest_Add(test_bplib_route_ingress_to_parent, NULL, NULL, "Test bplib_route_ingress_to_parent");
     UtTest_Add(test_bplib_route_ingress_route_single_bundle, NULL, NULL,
                "Test bplib_route_ingress_route_single_bundle");
+    UtTest_Add(test_bplib_route_ingress_cut_through, NULL, NULL, "Test bplib_route_ingress_cut_through");
     UtTest_Add(test_bplib_route_ingress_baseintf_forwarder, NULL, NULL, "Test bplib_route_ingress_baseintf_forwarder");
     UtTest_Add(test_bplib_route_register_forward_ingress_handler, NULL, NULL,
                "Test bplib_route_register_forward_ingress_handler");
     UtTest_Add(test_bplib_route_register_forward_egress_handler, NULL, NULL,
                "Test bplib_route_register_forward_egress_handler");
     UtTest_Add(test_bplib_route_register_generic_intf, NULL, NULL, "Test bplib_route_register_generic_intf");
+    UtTest_Add(test_bplib_route_intf_slots, NULL, NULL, "Test bplib_route_intf_slots");
     UtTest_Add(test_bplib_route_register_event_handler, NULL, NULL, "Test bplib_route_register_event_handler");
     UtTest_Add(test_bplib_route_del_intf, NULL, NULL, "Test bplib_route_del_intf");
     UtTest_Add(test_bplib_route_get_next_avail_intf, NULL, NULL, "Test bplib_route_get_next_avail_intf");
     UtTest_Add(test_bplib_route_push_ingress_bundle, NULL, NULL, "Test bplib_route_push_ingress_bundle");
     UtTest_Add(test_bplib_route_intf_set_flags, NULL, NULL, "Test bplib_route_intf_set_flags");
     UtTest_Add(test_bplib_route_intf_unset_flags, NULL, NULL, "Test bplib_route_intf_unset_flags");
+    UtTest_Add(test_bplib_route_intf_set_poll_time, NULL, NULL, "Test bplib_route_intf_set_poll_time");
+    UtTest_Add(test_bplib_route_contact_plan, NULL, NULL, "Test bplib_route_contact_plan");
     UtTest_Add(test_bplib_route_add, NULL, NULL, "Test bplib_route_add");
     UtTest_Add(test_bplib_route_del, NULL, NULL, "Test bplib_route_del");
+    UtTest_Add(test_bplib_route_replace_all, NULL, NULL, "Test bplib_route_replace_all");
     UtTest_Add(test_bplib_route_get_next_intf_with_flags, NULL, NULL, "Test bplib_route_get_next_intf_with_flags");
+    UtTest_Add(test_bplib_route_get_next_intf_cached, NULL, NULL, "Test bplib_route_get_next_intf_cached");
+    UtTest_Add(test_bplib_route_get_next_intf_for_flow, NULL, NULL, "Test bplib_route_get_next_intf_for_flow");
     UtTest_Add(test_bplib_route_push_egress_bundle, NULL, NULL, "Test bplib_route_push_egress_bundle");
     UtTest_Add(test_bplib_route_maintenance_complete_wait, NULL, NULL, "Test bplib_route_maintenance_complete_wait");
+    UtTest_Add(test_bplib_route_wait_until, NULL, NULL, "Test bplib_route_wait_until");
     UtTest_Add(test_bplib_route_periodic_maintenance, NULL, NULL, "Test bplib_route_periodic_maintenance");
+    UtTest_Add(test_bplib_route_get_pool_inspection, NULL, NULL, "Test bplib_route_get_pool_inspection");
     UtTest_Add(test_bplib_route_maintenance_request_wait, NULL, NULL, "Test bplib_route_maintenance_request_wait");
+    UtTest_Add(test_bplib_route_worker_process_flows, NULL, NULL, "Test bplib_route_worker_process_flows");
     UtTest_Add(test_bplib_route_alloc_table, NULL, NULL, "Test bplib_route_alloc_table");
+    UtTest_Add(test_bplib_route_alloc_table_ext, NULL, NULL, "Test bplib_route_alloc_table_ext");
 }
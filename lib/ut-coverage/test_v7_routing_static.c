@@ -0,0 +1,87 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Coverage of the route table of the static profile, which v7_routing.c makes in place of
+ * allocating it with BPLIB_STATIC_CONFIG.  This is built with the small BPLIB_STATIC_MAX_ROUTES
+ * and BPLIB_STATIC_POOL_SIZE of its own runner, and there is only one table per process, so
+ * everything about making it is in the one test.
+ */
+
+/*
+ * Includes
+ */
+#include "utassert.h"
+#include "utstubs.h"
+#include "uttest.h"
+#include "test_bplib_base.h"
+#include "bplib_config.h"
+
+static void UT_lib_static_AltHandler_PointerReturn(void *UserObj, UT_EntryKey_t FuncKey,
+                                                   const UT_StubContext_t *Context)
+{
+    UT_Stub_SetReturnValue(FuncKey, UserObj);
+}
+
+void test_bplib_route_alloc_table_static(void)
+{
+    /* Test function for:
+     * bplib_routetbl_t *bplib_route_alloc_table(uint32_t max_routes, size_t cache_mem_size)
+     * bplib_routetbl_t *bplib_route_alloc_table_ext(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags)
+     */
+    size_t            cache_mem_size = 1000;
+    bplib_routetbl_t *tbl;
+    bplib_mpool_t     pool;
+
+    memset(&pool, 0, sizeof(bplib_mpool_t));
+
+    /* more than the static table was made for */
+    UtAssert_NULL(bplib_route_alloc_table(BPLIB_STATIC_MAX_ROUTES + 1, cache_mem_size));
+    UtAssert_NULL(bplib_route_alloc_table(1, BPLIB_STATIC_POOL_SIZE + 1));
+    UtAssert_STUB_COUNT(bplib_mpool_create, 0);
+
+    /* a pool that could not be made leaves the table free for another try */
+    UtAssert_NULL(bplib_route_alloc_table(1, cache_mem_size));
+    UtAssert_STUB_COUNT(bplib_mpool_create, 1);
+
+    /* the whole of it, with the pool at the end */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_create), UT_lib_static_AltHandler_PointerReturn, &pool);
+    UtAssert_NOT_NULL(tbl = bplib_route_alloc_table(BPLIB_STATIC_MAX_ROUTES, BPLIB_STATIC_POOL_SIZE));
+    UtAssert_ADDRESS_EQ(tbl->pool, &pool);
+    UtAssert_NOT_NULL(tbl->route_sets);
+    UtAssert_ADDRESS_EQ(tbl->route_sets[1].route_tbl, tbl->route_sets[0].route_tbl + BPLIB_STATIC_MAX_ROUTES);
+    UtAssert_NOT_NULL(tbl->route_cache);
+    UtAssert_NOT_NULL(tbl->intf_slots);
+    UtAssert_NOT_NULL(tbl->contacts);
+
+    /* and there is only the one, however small the next one asks to be, or wherever it asks to be */
+    UtAssert_NULL(bplib_route_alloc_table(1, cache_mem_size));
+    UtAssert_NULL(bplib_route_alloc_table_ext(1, cache_mem_size, BPLIB_ROUTE_MEM_HUGEPAGE));
+    UtAssert_STUB_COUNT(bplib_mpool_create, 2);
+
+    /* none of it came from the heap or the OS */
+    UtAssert_STUB_COUNT(bplib_os_calloc, 0);
+    UtAssert_STUB_COUNT(bplib_os_alloc_pool_mem, 0);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_create), UT_lib_static_AltHandler_PointerReturn, NULL);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(test_bplib_route_alloc_table_static, NULL, NULL, "Test bplib_route_alloc_table_static");
+}
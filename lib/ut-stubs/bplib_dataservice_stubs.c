@@ -64,6 +64,19 @@ bp_handle_t bplib_dataservice_attach(bplib_routetbl_t *tbl, const bp_ipn_addr_t
     return UT_GenStub_GetReturnValue(bplib_dataservice_attach, bp_handle_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_dataservice_complete()
+ * ----------------------------------------------------
+ */
+void bplib_dataservice_complete(bplib_mpool_ref_t op_ref, bplib_completion_event_t event)
+{
+    UT_GenStub_AddParam(bplib_dataservice_complete, bplib_mpool_ref_t, op_ref);
+    UT_GenStub_AddParam(bplib_dataservice_complete, bplib_completion_event_t, event);
+
+    UT_GenStub_Execute(bplib_dataservice_complete, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_dataservice_detach()
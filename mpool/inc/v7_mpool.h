@@ -42,6 +42,31 @@
 #define BPLIB_MPOOL_ALLOC_PRI_MHI 191
 #define BPLIB_MPOOL_ALLOC_PRI_HI  255
 
+/*
+ * Options for bplib_mpool_create_ext()
+ */
+#define BPLIB_MPOOL_CREATE_LAZY_INIT 0x01 /**< memory is already zero, set up blocks on first use */
+
+/*
+ * Sizes of the statistics tables, see bplib_mpool_query_stat()
+ */
+#define BPLIB_MPOOL_STAT_PRIORITY_BANDS 4 /**< allocations are counted in bands of 64 priority levels */
+#define BPLIB_MPOOL_STAT_DEPTH_SAMPLES  8 /**< free list depth is kept for this many maintenance cycles */
+#define BPLIB_MPOOL_STAT_LOCK_WAIT_BINS 5 /**< no wait, under 10us, under 100us, under 1ms, and longer */
+#define BPLIB_MPOOL_STAT_JOB_TIME_BINS  4 /**< under 100us, under 1ms, under 10ms, and longer */
+
+/*
+ * Bundles are counted by age in bplib_mpool_inspection_t, the first bin is under 1 second,
+ * each bin after that is twice as wide as the one before, and the last one has the rest
+ */
+#define BPLIB_MPOOL_INSPECT_AGE_BINS 20
+
+/*
+ * The job wait and run time statistics are a histogram for each job type,
+ * this combines the two into the index for bplib_mpool_query_stat()
+ */
+#define BPLIB_MPOOL_STAT_JOB_TIME_INDEX(jobtype, bin) (((uint32_t)(jobtype) * BPLIB_MPOOL_STAT_JOB_TIME_BINS) + (bin))
+
 /*
  * The basic types of blocks which are cacheable in the mpool
  */
@@ -49,8 +74,24 @@ typedef struct bplib_mpool_bblock_primary   bplib_mpool_bblock_primary_t;
 typedef struct bplib_mpool_bblock_canonical bplib_mpool_bblock_canonical_t;
 
 typedef struct bplib_mpool_subq_base bplib_mpool_subq_base_t;
+typedef struct bplib_mpool_subq_ring bplib_mpool_subq_ring_t;
+typedef struct bplib_mpool_subq_bands bplib_mpool_subq_bands_t;
 typedef struct bplib_mpool_flow      bplib_mpool_flow_t;
 
+/*
+ * The kinds of jobs which are run from the active list, for statistics.
+ * This is only informational, it does not change how the job is run.
+ */
+typedef enum bplib_mpool_jobtype
+{
+    bplib_mpool_jobtype_other = 0,   /**< any job not listed below, such as flow state changes */
+    bplib_mpool_jobtype_cache_fsm,   /**< bundle cache (storage) state machine */
+    bplib_mpool_jobtype_cla_forward, /**< forwarding of bundles from a convergence layer */
+    bplib_mpool_jobtype_dataservice, /**< forwarding of bundles to or from a data service */
+    bplib_mpool_jobtype_max          /**< reserved value, keep last */
+
+} bplib_mpool_jobtype_t;
+
 typedef enum bplib_mpool_blocktype
 {
     bplib_mpool_blocktype_undefined = 0,
@@ -90,8 +131,11 @@ typedef enum bplib_mpool_blocktype
 struct bplib_mpool_block
 {
     /* note that if it becomes necessary to recover bits here,
-     * both the type and offset could be reduced in size */
-    bplib_mpool_blocktype_t   type;
+     * the offset could also be reduced in size.  The registry index and content length
+     * are only used in content blocks, but are kept here to use the space before the offset. */
+    uint8_t                   type;                /* a bplib_mpool_blocktype_t value, all of which fit in 8 bits */
+    uint8_t                   registry_index;      /* for content blocks, the dense index of the blocktype api */
+    uint16_t                  user_content_length; /* for content blocks, actual length of user content */
     uint32_t                  parent_offset;
     struct bplib_mpool_block *next;
     struct bplib_mpool_block *prev;
@@ -122,6 +166,102 @@ typedef struct bplib_mpool_list_iter
     bplib_mpool_block_t *pending_entry;
 } bplib_mpool_list_iter_t;
 
+/**
+ * @brief Per-thread block cache statistics
+ *
+ * These are kept by each thread, and only reflect the calling thread.
+ */
+typedef struct bplib_mpool_thread_cache_stats
+{
+    uint32_t hit_count;         /**< allocations served directly from the thread cache */
+    uint32_t miss_count;        /**< allocations where the thread cache was empty */
+    uint32_t refill_count;      /**< batch transfers from the pool free list into the thread cache */
+    uint32_t drain_count;       /**< batch transfers from the thread cache back to the pool free list */
+    uint32_t defer_count;       /**< blocks recycled while deferred, see bplib_mpool_release_defer_begin() */
+    uint32_t defer_flush_count; /**< batch transfers of deferred blocks to the pool recycle list */
+
+} bplib_mpool_thread_cache_stats_t;
+
+/**
+ * @brief Blocks set aside from a pool for one user
+ *
+ * See bplib_mpool_reserve_set_target() and bplib_mpool_reserve_enter()
+ */
+typedef struct bplib_mpool_reserve
+{
+    bplib_mpool_t      *pool;         /**< pool that the reserved blocks belong to, NULL if never set */
+    bplib_mpool_block_t block_list;   /**< the reserved blocks, all free */
+    uint32_t            block_count;  /**< number of blocks in block_list */
+    uint32_t            target_count; /**< number of blocks the reserve is filled up to */
+    uint32_t            use_count;    /**< allocations served from the reserve */
+
+} bplib_mpool_reserve_t;
+
+/**
+ * @brief The state of a block, as counted by the pool inspection
+ */
+typedef enum bplib_mpool_inspect_state
+{
+    bplib_mpool_inspect_state_free,         /**< free, or never used */
+    bplib_mpool_inspect_state_unreferenced, /**< in use with no refs, normally waiting to be collected */
+    bplib_mpool_inspect_state_single,       /**< in use with one ref */
+    bplib_mpool_inspect_state_shared,       /**< in use with more than one ref */
+    bplib_mpool_inspect_state_max           /**< reserved value, keep last */
+
+} bplib_mpool_inspect_state_t;
+
+/**
+ * @brief Histograms of the blocks in a pool, from one pass of bplib_mpool_inspect_step()
+ */
+struct bplib_mpool_inspection
+{
+    uint32_t passes; /**< complete passes over the pool, these histograms are from the last one */
+
+    uint32_t by_type[bplib_mpool_blocktype_max];        /**< blocks, by bplib_mpool_blocktype_t */
+    uint32_t by_state[bplib_mpool_inspect_state_max];   /**< blocks, by bplib_mpool_inspect_state_t */
+    uint32_t bundle_age[BPLIB_MPOOL_INSPECT_AGE_BINS]; /**< primary blocks with a creation time, by age */
+
+    /* generic blocks by blocktype, the magic number of each is set by bplib_mpool_inspect_get() */
+    uint32_t blocktype_count[BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES];
+    uint32_t blocktype_magic[BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES];
+};
+
+/**
+ * @brief State of an incremental inspection of a pool
+ *
+ * This is kept by whoever runs the inspection, and starts out zero filled.  The members
+ * are internal, the results are read with bplib_mpool_inspect_get().
+ */
+typedef struct bplib_mpool_inspector
+{
+    uint32_t                 partition; /**< partition of the pool being inspected */
+    uint32_t                 position;  /**< next block in the partition, over all the size classes */
+    bplib_mpool_inspection_t work;      /**< the pass in progress */
+    bplib_mpool_inspection_t last;      /**< the last complete pass */
+
+} bplib_mpool_inspector_t;
+
+/**
+ * @brief Pool statistics which can be read with bplib_mpool_query_stat()
+ *
+ * These are always kept, and are cheap enough to be updated on every allocation.
+ */
+typedef enum bplib_mpool_stat
+{
+    bplib_mpool_stat_alloc_count,     /**< blocks allocated, index is the bplib_mpool_blocktype_t */
+    bplib_mpool_stat_free_count,      /**< blocks freed, index is the bplib_mpool_blocktype_t */
+    bplib_mpool_stat_alloc_priority,  /**< blocks allocated, index is the priority band (priority / 64) */
+    bplib_mpool_stat_alloc_refused,   /**< allocations refused at the bundle block threshold, index is unused */
+    bplib_mpool_stat_free_depth,      /**< free blocks, index is the number of maintenance cycles ago */
+    bplib_mpool_stat_free_depth_min,  /**< lowest free_depth of all the samples, index is unused */
+    bplib_mpool_stat_free_depth_max,  /**< highest free_depth of all the samples, index is unused */
+    bplib_mpool_stat_lock_wait_count, /**< lock acquisitions in all pools, index is the wait time bin */
+    bplib_mpool_stat_job_wait_time,   /**< jobs run, by time spent in the active list, index is the job time index */
+    bplib_mpool_stat_job_run_time,    /**< jobs run, by time spent in the handler, index is the job time index */
+    bplib_mpool_stat_max              /**< reserved value, keep last */
+
+} bplib_mpool_stat_t;
+
 /**
  * @brief Blocktype API
  *
@@ -507,6 +647,18 @@ size_t bplib_mpool_get_user_content_size(const bplib_mpool_block_t *cb);
  */
 size_t bplib_mpool_read_refcount(const bplib_mpool_block_t *cb);
 
+/**
+ * @brief Gets the pool memory taken by a block
+ *
+ * This is the whole block in its size class, including the header and any of the
+ * user area that is not in use, so it is what the block counts for against the pool.
+ * A ref block counts only for itself, not for the block it refers to.
+ *
+ * @param cb pointer to block
+ * @return size in bytes, or 0 if cb is not a content block
+ */
+size_t bplib_mpool_get_block_footprint(const bplib_mpool_block_t *cb);
+
 /**
  * @brief Allocate a new user data block
  *
@@ -520,6 +672,24 @@ size_t bplib_mpool_read_refcount(const bplib_mpool_block_t *cb);
  */
 bplib_mpool_block_t *bplib_mpool_generic_data_alloc(bplib_mpool_t *pool, uint32_t magic_number, void *init_arg);
 
+/**
+ * @brief Allocate several user data blocks at once
+ *
+ * This is the same as calling bplib_mpool_generic_data_alloc() repeatedly, but the pool is only
+ * locked once for the whole set.  The blocks are appended to the given list, which may be a
+ * temporary list head.  When no longer needed, the whole list can be returned in a single
+ * operation via bplib_mpool_recycle_all_blocks_in_list().
+ *
+ * @param pool
+ * @param list List to append the new blocks to
+ * @param count Number of blocks to allocate
+ * @param magic_number
+ * @param init_arg Opaque pointer passed to initializer (may be NULL)
+ * @returns Number of blocks actually allocated, which may be less than count if the pool runs low
+ */
+uint32_t bplib_mpool_generic_data_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, uint32_t count,
+                                          uint32_t magic_number, void *init_arg);
+
 /**
  * @brief Recycle a single block which is no longer needed
  *
@@ -591,6 +761,20 @@ bplib_mpool_block_t *bplib_mpool_search_list(const bplib_mpool_block_t *list, bp
  */
 uint32_t bplib_mpool_collect_blocks(bplib_mpool_t *pool, uint32_t limit);
 
+/**
+ * @brief Garbage collection routine, with a time budget
+ *
+ * Same as bplib_mpool_collect_blocks(), but also stops once the given time is reached.
+ * The time is checked between batches of blocks, so this always makes some progress.
+ *
+ * @param pool The mpool object
+ * @param limit The maximum number of entries to process
+ * @param until_dtntime DTN time (ms) at which to stop, or BP_DTNTIME_INFINITE for no time limit
+ *
+ * @returns The number of blocks collected
+ */
+uint32_t bplib_mpool_collect_blocks_timed(bplib_mpool_t *pool, uint32_t limit, uint64_t until_dtntime);
+
 /**
  * @brief Run basic maintenance on the memory pool
  *
@@ -633,6 +817,87 @@ int bplib_mpool_register_blocktype(bplib_mpool_t *pool, uint32_t magic_number, c
  */
 bplib_mpool_t *bplib_mpool_create(void *pool_mem, size_t pool_size);
 
+/**
+ * @brief Creates a memory pool object using a preallocated memory block, with options
+ *
+ * With BPLIB_MPOOL_CREATE_LAZY_INIT, the memory must already be zero filled (such as fresh
+ * memory from bplib_os_alloc_pool_mem() or calloc).  Standard blocks are then set up as they
+ * are first used, rather than all at once, so pages of memory are not touched until needed.
+ *
+ * @param pool_mem  Pointer to pool memory
+ * @param pool_size Size of pool memory
+ * @param flags     Combination of BPLIB_MPOOL_CREATE_xxx flags
+ * @return bplib_mpool_t*
+ */
+bplib_mpool_t *bplib_mpool_create_ext(void *pool_mem, size_t pool_size, uint32_t flags);
+
+/**
+ * @brief Creates a memory pool object which is split into several partitions
+ *
+ * Each partition is a complete pool with its own lock and free lists, so threads running
+ * on different CPUs do not contend with each other when allocating.  Bundle and data blocks
+ * are allocated from the partition local to the calling thread, and come from the other
+ * partitions only when the local one is exhausted.  A thread is local to the partition its
+ * block cache is attached to, if any, or else the partition selected by the CPU it runs on.
+ *
+ * Combined with BPLIB_MPOOL_CREATE_LAZY_INIT, the memory of each partition is first touched
+ * by the threads that use it, which places it in the local NUMA node on most systems.
+ *
+ * The returned object is the first partition, and may be used anywhere that a pool is needed.
+ * With num_partitions of 0 or 1, this is the same as bplib_mpool_create_ext().
+ *
+ * @param pool_mem       Pointer to pool memory
+ * @param pool_size      Size of pool memory, this is split equally between the partitions
+ * @param num_partitions Number of partitions, up to BPLIB_MPOOL_MAX_PARTITIONS
+ * @param flags          Combination of BPLIB_MPOOL_CREATE_xxx flags, applied to every partition
+ * @return bplib_mpool_t*
+ */
+bplib_mpool_t *bplib_mpool_create_partitioned(void *pool_mem, size_t pool_size, uint32_t num_partitions,
+                                              uint32_t flags);
+
+/**
+ * @brief Attaches again to a pool left in memory by an earlier process
+ *
+ * This is for pool memory that outlives the process, such as a file mapped by bplib_os_map_pool_file().
+ * The pool must have been made by bplib_mpool_create() or bplib_mpool_create_ext() (not partitioned) with
+ * the same size, and be at the same address, as the links in it are pointers.
+ *
+ * Only bundles are kept: every primary block whose canonical blocks and CBOR data are all intact, and
+ * in plain CBOR data blocks rather than slices.  Everything else, including the refs, flows and module
+ * state that were in the pool, goes back on the free lists.  Each bundle that is kept is passed to
+ * recover_fn, which then owns it, as a block that is in no list and has no refs.  The blocktypes of the
+ * modules are not registered yet at that point, so it will usually just put them in a list for later.
+ * If recover_fn is NULL the bundles are recycled.
+ *
+ * @param pool_mem    Pointer to pool memory
+ * @param pool_size   Size of pool memory
+ * @param recover_fn  Called with each bundle that is kept, may be NULL
+ * @param recover_arg Opaque argument for recover_fn
+ * @return bplib_mpool_t*, or NULL if the memory does not hold such a pool or its lists are damaged
+ */
+bplib_mpool_t *bplib_mpool_reattach(void *pool_mem, size_t pool_size, bplib_mpool_callback_func_t recover_fn,
+                                    void *recover_arg);
+
+/**
+ * @brief Gets the number of partitions in a pool
+ *
+ * @param pool Pool object, or any partition of it
+ * @return number of partitions, which is 1 if the pool is not partitioned
+ */
+uint32_t bplib_mpool_get_num_partitions(bplib_mpool_t *pool);
+
+/**
+ * @brief Gets a partition of a pool
+ *
+ * A thread can be homed to a partition by attaching its block cache to it, see
+ * bplib_mpool_thread_cache_attach().
+ *
+ * @param pool            Pool object, or any partition of it
+ * @param partition_index Index of the partition
+ * @return the partition, or NULL if the index is not valid
+ */
+bplib_mpool_t *bplib_mpool_get_partition(bplib_mpool_t *pool, uint32_t partition_index);
+
 /**
  * @brief Obtain current usage of a memory pool
  *
@@ -649,6 +914,182 @@ size_t bplib_mpool_query_mem_current_use(bplib_mpool_t *pool);
  */
 size_t bplib_mpool_query_mem_max_use(bplib_mpool_t *pool);
 
+/**
+ * @brief Obtain the number of blocks waiting to be garbage-collected
+ *
+ * If this keeps growing, then reclamation is not keeping up with the rate of new data.
+ *
+ * @param pool Pool object
+ * @return number of blocks in the recycle list
+ */
+size_t bplib_mpool_query_collect_backlog(bplib_mpool_t *pool);
+
+/**
+ * @brief Checks if a pool is down to its bundle threshold
+ *
+ * While it is, new bundles at the lowest priority are refused, and only those of higher priority
+ * get blocks, see BPLIB_MPOOL_ALLOC_PRI_LO.  For a partitioned pool this is true if any partition is.
+ *
+ * @param pool Pool object
+ * @retval true if a bundle block at the lowest priority would be refused
+ */
+bool bplib_mpool_is_at_bundle_threshold(bplib_mpool_t *pool);
+
+/**
+ * @brief Inspects the next part of a pool, without stopping the rest of the pool
+ *
+ * This looks at the header of up to limit blocks from where the last call stopped, and adds
+ * them to the histograms of the pass in progress.  When a pass has been over every block of
+ * every partition it becomes the result, and the next pass starts over.  The pool lock is only
+ * held for the blocks of one call, so calling this with a small limit on every maintenance cycle
+ * keeps a picture of the pool that is at most one pass old, where bplib_mpool_debug_scan() has
+ * to go through all of the pool at once.
+ *
+ * The blocks are not locked while they are looked at, so a pass is a sample of the blocks as
+ * they were while it was going on, not a snapshot of the pool at one time.
+ *
+ * @param pool Pool object
+ * @param insp The inspection state, zero filled for the first call
+ * @param limit The most blocks to look at
+ * @returns the number of blocks looked at, less than limit at the end of a pass
+ */
+uint32_t bplib_mpool_inspect_step(bplib_mpool_t *pool, bplib_mpool_inspector_t *insp, uint32_t limit);
+
+/**
+ * @brief Gets the histograms of the last complete pass of an inspection
+ *
+ * All of them are zero, with passes of 0, until the first pass is done.
+ *
+ * @param pool Pool object
+ * @param insp The inspection state, as passed to bplib_mpool_inspect_step()
+ * @param[out] result The histograms
+ */
+void bplib_mpool_inspect_get(bplib_mpool_t *pool, const bplib_mpool_inspector_t *insp,
+                             bplib_mpool_inspection_t *result);
+
+/**
+ * @brief Obtain a statistic of a memory pool
+ *
+ * For a partitioned pool this is the total of all partitions.  The free list depth
+ * is sampled by bplib_mpool_maintain(), so the history is only as long as it has
+ * been running.
+ *
+ * @param pool Pool object
+ * @param stat The statistic to get
+ * @param index Entry within the statistic, see bplib_mpool_stat_t
+ * @return the value, or 0 if the stat or index is not valid
+ */
+size_t bplib_mpool_query_stat(bplib_mpool_t *pool, bplib_mpool_stat_t stat, uint32_t index);
+
+/**
+ * @brief Attaches a block cache to the calling thread
+ *
+ * Once attached, block allocations from this pool made by the calling thread are served
+ * from a small cache of free blocks private to the thread, and blocks freed by this thread
+ * (via garbage collection) go back into the same cache.  The cache is refilled from, and
+ * drained to, the pool free list in batches, so the pool lock is only needed occasionally.
+ *
+ * @note Blocks held in a thread cache are counted as in use by the pool.  A thread should
+ * call bplib_mpool_thread_cache_detach() before it exits, or else the blocks in its cache
+ * will not be returned.
+ *
+ * A thread can only be attached to one pool at a time, attaching to a different pool
+ * will detach from the previous one.  This does nothing if the toolchain does not support
+ * thread-local storage.
+ *
+ * @param pool Pool object
+ */
+void bplib_mpool_thread_cache_attach(bplib_mpool_t *pool);
+
+/**
+ * @brief Detaches the block cache from the calling thread
+ *
+ * All blocks in the cache are returned to the pool free list.
+ */
+void bplib_mpool_thread_cache_detach(void);
+
+/**
+ * @brief Gets the block cache statistics for the calling thread
+ *
+ * @param stats Output buffer for statistics
+ */
+void bplib_mpool_thread_cache_get_stats(bplib_mpool_thread_cache_stats_t *stats);
+
+/**
+ * @brief Defers the recycling of blocks released by the calling thread
+ *
+ * Until the matching bplib_mpool_release_defer_end(), a block of this pool that is recycled
+ * by the calling thread, including one whose last reference is released, is kept on a list
+ * private to the thread instead of going to the pool recycle list one at a time under the pool
+ * lock.  The whole list is given to the pool in one step when the deferral ends, or sooner if
+ * it gets long.  Blocks of any other pool are recycled as usual.
+ *
+ * Calls can be nested, only the outermost one picks the pool.  This does nothing if the
+ * toolchain does not support thread-local storage.
+ *
+ * @param pool Pool object
+ */
+void bplib_mpool_release_defer_begin(bplib_mpool_t *pool);
+
+/**
+ * @brief Ends a deferral started by bplib_mpool_release_defer_begin()
+ *
+ * At the end of the outermost one, the blocks that were deferred go on the pool recycle list.
+ */
+void bplib_mpool_release_defer_end(void);
+
+/**
+ * @brief Initializes a block reserve, which holds no blocks
+ *
+ * @param base_block The block that the reserve is part of, or NULL if it is not in a block
+ * @param rsv        The reserve
+ */
+void bplib_mpool_reserve_init(bplib_mpool_block_t *base_block, bplib_mpool_reserve_t *rsv);
+
+/**
+ * @brief Sets the number of blocks held in a reserve
+ *
+ * The blocks are taken from the pool free list now, so they are there later when the pool
+ * is too full to give any more to the bundles of everyone else.  A reserve only gets blocks
+ * from what is free above the bundle threshold, so this fails, and the reserve is left as it
+ * was, if the pool does not have that many to spare.  Making it smaller gives the rest back.
+ *
+ * @param pool         Pool object
+ * @param rsv          The reserve
+ * @param target_count Number of blocks to hold, 0 to hold none
+ * @returns BP_SUCCESS if the reserve holds target_count blocks
+ */
+int bplib_mpool_reserve_set_target(bplib_mpool_t *pool, bplib_mpool_reserve_t *rsv, uint32_t target_count);
+
+/**
+ * @brief Gives back all of the blocks of a reserve
+ *
+ * @param rsv The reserve
+ */
+void bplib_mpool_reserve_release(bplib_mpool_reserve_t *rsv);
+
+/**
+ * @brief Makes a reserve the one used by the calling thread
+ *
+ * Until bplib_mpool_reserve_leave(), any allocation from the pool of the reserve that the pool
+ * would refuse because it is over its threshold is served from the reserve instead, without
+ * waiting.  Blocks that were used in this way return to the pool free list as usual, and are
+ * taken back into the reserve the next time it is entered, while the pool has any to spare.
+ *
+ * This does nothing if the toolchain does not support thread-local storage.
+ *
+ * @param rsv The reserve, or NULL to use none until bplib_mpool_reserve_leave()
+ * @returns the reserve that was in use before, to pass to bplib_mpool_reserve_leave()
+ */
+bplib_mpool_reserve_t *bplib_mpool_reserve_enter(bplib_mpool_reserve_t *rsv);
+
+/**
+ * @brief Stops using a reserve in the calling thread
+ *
+ * @param prev The value returned from bplib_mpool_reserve_enter()
+ */
+void bplib_mpool_reserve_leave(bplib_mpool_reserve_t *prev);
+
 /**
  * @brief Initializes the global lock table
  *
@@ -656,9 +1097,52 @@ size_t bplib_mpool_query_mem_max_use(bplib_mpool_t *pool);
  */
 void bplib_mpool_lock_init(void);
 
+/**
+ * @brief Use of one lock, or of the locks taken at one call site, when built with BPLIB_LOCK_PROFILE
+ *
+ * A record for a whole lock has a line of 0, and func is the name of the lock.
+ */
+typedef struct bplib_mpool_lock_profile
+{
+    const char *func;            /**< function of the call site, or the name of the lock */
+    uint32_t    line;            /**< line of the call site, 0 for a whole lock */
+    uint64_t    acquire_count;   /**< times the lock was acquired */
+    uint64_t    contended_count; /**< acquisitions that found the lock held elsewhere */
+    uint64_t    wait_us_total;   /**< total time spent waiting in contended acquisitions */
+    uint64_t    hold_us_max;     /**< longest time the lock was held, from the outermost acquisition */
+} bplib_mpool_lock_profile_t;
+
+/**
+ * @brief Profile state kept alongside a lock, only updated while the lock is held
+ */
+typedef struct bplib_mpool_lock_hold
+{
+    bplib_mpool_lock_profile_t *lock_prof; /**< the record for the lock as a whole */
+    bplib_mpool_lock_profile_t *site_prof; /**< the record for the call site of the outermost acquisition */
+    uint64_t                    start_us;  /**< monotonic time of the outermost acquisition */
+    uint32_t                    depth;     /**< the pool locks are recursive, only the outermost hold is timed */
+} bplib_mpool_lock_hold_t;
+
+#ifdef BPLIB_LOCK_PROFILE
+
+/*
+ * These are for profiling locks outside the pool, such as the routing table locks.  The lock
+ * user calls them around its own lock calls, with the lock held in all cases.
+ */
+void bplib_mpool_lock_profile_init(bplib_mpool_lock_hold_t *hold, const char *lock_name);
+void bplib_mpool_lock_profile_acquired(bplib_mpool_lock_hold_t *hold, const char *func, uint32_t line, bool contended,
+                                       uint64_t wait_us);
+void bplib_mpool_lock_profile_released(bplib_mpool_lock_hold_t *hold);
+void bplib_mpool_lock_profile_suspend(bplib_mpool_lock_hold_t *hold); /* before a wait that releases the lock */
+void bplib_mpool_lock_profile_resume(bplib_mpool_lock_hold_t *hold);  /* after the wait re-acquires it */
+
+#endif
+
 /* DEBUG/TEST verification routines */
 
 void bplib_mpool_debug_scan(bplib_mpool_t *pool);
+void bplib_mpool_debug_print_inspection(const bplib_mpool_inspection_t *result);
 void bplib_mpool_debug_print_list_stats(bplib_mpool_block_t *list, const char *label);
+void bplib_mpool_debug_print_lock_profile(void); /* only has data when built with BPLIB_LOCK_PROFILE */
 
 #endif /* V7_MPOOL_H */
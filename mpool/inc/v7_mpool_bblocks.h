@@ -25,19 +25,43 @@
 
 #include "v7_mpool.h"
 #include "v7_types.h"
+#include "crc.h"
+#include "bplib_tracepoint.h"
 
 typedef struct bplib_mpool_bblock_tracking
 {
+    /*
+     * This is in every primary block, so the 32-bit and 8-bit fields are kept together ahead of the
+     * 64-bit ones, leaving no padding between them.  Every byte saved here is left for the user content.
+     */
     bplib_policy_delivery_t delivery_policy;
+    uint32_t                class_of_service; /* BP_COS_* value, picks the band in a flow with priority bands */
     bp_handle_t             ingress_intf_id;
-    uint64_t                ingress_time;
     bp_handle_t             egress_intf_id;
-    uint64_t                egress_time;
     bp_handle_t             storage_intf_id;
-    bp_sid_t                committed_storage_id;
+    bool                    crc_deferred;      /* CRCs of canonical blocks not checked yet, see V7_IMPORT_DEFER_CRC */
+    bool                    trace_sampled;     /* the stage times go in the sample ring of trace_ref as well */
+    bool                    trace_sample_only; /* the socket was only sampling, so it is not counted in the histograms */
 
-    /* JPHFIX: this is here for now, but really it belongs on the egress CLA intf based on its RTT */
+    uint64_t ingress_time;
+    uint64_t egress_time;
+    bp_sid_t committed_storage_id;
+
+    /* the cache uses this until it has measured the round trip time of the egress intf, see v7_cache_rtt.c */
     uint64_t local_retx_interval;
+
+    /* DTN time that each bplib_trace_stage_t ended, 0 for the stages it has not been through here */
+    uint64_t stage_time[bplib_trace_stage_max];
+
+    /* latency histograms of the socket it was sent from, if that socket is tracing, released with the block */
+    bplib_mpool_ref_t trace_ref;
+
+    /* the op of bplib_send_async() that the bundle was sent by, which reports back when this is released */
+    bplib_mpool_ref_t completion_ref;
+
+    /* the flow whose memory quota this is charged to, if it has one, also released with the block */
+    bplib_mpool_ref_t quota_ref;
+    size_t            quota_charge;
 } bplib_mpool_bblock_tracking_t;
 
 typedef struct bplib_mpool_bblock_primary_data
@@ -53,6 +77,13 @@ struct bplib_mpool_bblock_primary
     size_t              block_encode_size_cache;
     size_t              bundle_encode_size_cache;
 
+    /*
+     * Sum of block_encode_size_cache over this block and every canonical block in the bundle, and
+     * how many of those blocks are not encoded yet.  When that reaches zero the bundle size is known.
+     */
+    size_t              encoded_blocks_size;
+    uint32_t            unencoded_block_count;
+
     bplib_mpool_bblock_primary_data_t data;
 };
 
@@ -66,6 +97,67 @@ struct bplib_mpool_bblock_canonical
     bp_canonical_block_buffer_t   canonical_logical_data;
 };
 
+/**
+ * @brief Accounts for a change in the encoded size of one block of a bundle
+ *
+ * A size of 0 means the block is not encoded.  The size of the full bundle becomes
+ * known as soon as every block in it has been encoded, without going through the blocks.
+ *
+ * @param cpb
+ * @param old_size
+ * @param new_size
+ */
+static inline void bplib_mpool_bblock_primary_adjust_encode_size(bplib_mpool_bblock_primary_t *cpb, size_t old_size,
+                                                                 size_t new_size)
+{
+    cpb->encoded_blocks_size += new_size - old_size;
+    if (old_size == 0 && new_size != 0 && cpb->unencoded_block_count > 0)
+    {
+        --cpb->unencoded_block_count;
+    }
+    else if (old_size != 0 && new_size == 0)
+    {
+        ++cpb->unencoded_block_count;
+    }
+
+    /* the 2 extra bytes are the indefinite-length array around the blocks */
+    if (cpb->unencoded_block_count == 0)
+    {
+        cpb->bundle_encode_size_cache = 2 + cpb->encoded_blocks_size;
+    }
+    else
+    {
+        cpb->bundle_encode_size_cache = 0;
+    }
+}
+
+/**
+ * @brief Sets the encoded size of a primary block, and updates the size of the bundle
+ *
+ * @param cpb
+ * @param block_size encoded size, or 0 if not encoded
+ */
+static inline void bplib_mpool_bblock_primary_set_encode_size(bplib_mpool_bblock_primary_t *cpb, size_t block_size)
+{
+    bplib_mpool_bblock_primary_adjust_encode_size(cpb, cpb->block_encode_size_cache, block_size);
+    cpb->block_encode_size_cache = block_size;
+}
+
+/**
+ * @brief Sets the encoded size of a canonical block, and updates the size of the bundle it is in, if any
+ *
+ * @param ccb
+ * @param block_size encoded size, or 0 if not encoded
+ */
+static inline void bplib_mpool_bblock_canonical_set_encode_size(bplib_mpool_bblock_canonical_t *ccb, size_t block_size)
+{
+    if (ccb->bundle_ref != NULL)
+    {
+        bplib_mpool_bblock_primary_adjust_encode_size(ccb->bundle_ref, ccb->block_encode_size_cache, block_size);
+    }
+    ccb->block_encode_size_cache = block_size;
+}
+
 /**
  * @brief Gets the logical information associated with a primary block
  *
@@ -77,6 +169,29 @@ static inline bp_primary_block_t *bplib_mpool_bblock_primary_get_logical(bplib_m
     return &cpb->data.logical;
 }
 
+/**
+ * @brief Gets the flow of a bundle, as given to the static tracepoints
+ *
+ * @param cpb
+ * @return the source node and service, or 0 if the source is not an ipn address
+ */
+static inline uint64_t bplib_mpool_bblock_primary_trace_flow(const bplib_mpool_bblock_primary_t *cpb)
+{
+    const bp_endpointid_buffer_t *src = &cpb->data.logical.sourceEID;
+
+    if (src->scheme != bp_endpointid_scheme_ipn)
+    {
+        return 0;
+    }
+
+    return BPLIB_TRACEPOINT_FLOW(src->ssp.ipn.node_number, src->ssp.ipn.service_number);
+}
+
+/* A tracepoint about a bundle, from its primary block, see bplib_tracepoint.h */
+#define BPLIB_TRACEPOINT_BUNDLE(name, cpb, arg3)                                                   \
+    BPLIB_TRACEPOINT(name, bplib_mpool_bblock_primary_trace_flow(cpb),                             \
+                     (cpb)->data.logical.creationTimeStamp.sequence_num, arg3)
+
 /**
  * @brief Gets the list of encoded chunks associated with a primary block
  *
@@ -217,6 +332,91 @@ bplib_mpool_block_t *bplib_mpool_bblock_canonical_alloc(bplib_mpool_t *pool, uin
  */
 bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc(bplib_mpool_t *pool);
 
+/**
+ * @brief Allocate a new CBOR data block, for the given amount of data
+ *
+ * If the size hint is larger than a standard block, this will get a block from the large
+ * size class of the pool, if one is available.  The actual capacity of the block returned
+ * should always be checked via bplib_mpool_get_generic_data_capacity().
+ *
+ * @param pool
+ * @param size_hint the amount of data that is going to be written now, or 0 if not known
+ * @return bplib_mpool_block_t*
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc_sized(bplib_mpool_t *pool, size_t size_hint);
+
+/**
+ * @brief Allocate enough CBOR data blocks to hold the given amount of data
+ *
+ * All blocks are obtained under a single lock of the pool, and are appended to the given
+ * list, which is typically a temporary list head.  Blocks are selected in the same manner
+ * as bplib_mpool_bblock_cbor_alloc_sized().
+ *
+ * @param pool
+ * @param list List to append the new blocks to
+ * @param total_size the amount of data that is going to be written
+ * @returns The total capacity of the blocks that were appended, which is less than total_size
+ * if the pool ran out of blocks.
+ */
+size_t bplib_mpool_bblock_cbor_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, size_t total_size);
+
+/**
+ * @brief Register the blocktype for CBOR data slices
+ *
+ * This must be done once before bplib_mpool_bblock_cbor_slice_alloc() is used with the pool.
+ * Calling it again is harmless.
+ *
+ * @param pool
+ * @returns BP_SUCCESS, or BP_DUPLICATE if it was already registered
+ */
+int bplib_mpool_bblock_cbor_slice_init(bplib_mpool_t *pool);
+
+/**
+ * @brief Allocate a CBOR data block that refers to part of another CBOR data block
+ *
+ * The slice can be used wherever a CBOR data block can be read, but no data is copied:
+ * bplib_mpool_bblock_cbor_cast() returns a pointer into the buffer, and the user content size
+ * is the length.  The slice holds its own ref to the buffer, so the buffer stays allocated
+ * until every slice of it has been recycled.  Slices must not be written to.
+ *
+ * @param buffer_ref Ref to the CBOR data block, with its user content size set to the amount of data in it,
+ *                   or to an external buffer from bplib_mpool_bblock_cbor_extern_alloc()
+ * @param offset Start of the slice in the data
+ * @param length Size of the slice
+ * @returns The slice block, or NULL if the range is not within the data or there was no memory
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_slice_alloc(bplib_mpool_ref_t buffer_ref, size_t offset, size_t length);
+
+/**
+ * @brief Register the blocktype for external CBOR data buffers
+ *
+ * This must be done once before bplib_mpool_bblock_cbor_extern_alloc() is used with the pool.
+ * Calling it again is harmless.
+ *
+ * @param pool
+ * @returns BP_SUCCESS, or BP_DUPLICATE if it was already registered
+ */
+int bplib_mpool_bblock_cbor_extern_init(bplib_mpool_t *pool);
+
+/**
+ * @brief Allocate a block that stands in for a buffer outside of the pool
+ *
+ * No data is copied.  Once this is made into a ref, bplib_mpool_bblock_cbor_slice_alloc() can make
+ * slices of the buffer, which are read like any other CBOR data block.  When the block is recycled,
+ * which is after the last slice is gone, the release function is called from the task that collects
+ * recycled blocks.  The buffer must not be changed or freed until then.
+ *
+ * @param pool
+ * @param data_ptr Pointer to the buffer
+ * @param data_size Size of the buffer
+ * @param release_func Called once the buffer is no longer used, may be NULL
+ * @param release_arg Opaque argument for release_func
+ * @returns The block, or NULL if the blocktype was not registered or there was no memory
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_extern_alloc(bplib_mpool_t *pool, const void *data_ptr, size_t data_size,
+                                                          bplib_payload_release_func_t release_func,
+                                                          void                        *release_arg);
+
 /**
  * @brief Append CBOR data to the given list
  *
@@ -225,6 +425,24 @@ bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc(bplib_mpool_t *pool);
  */
 void bplib_mpool_bblock_cbor_append(bplib_mpool_block_t *head, bplib_mpool_block_t *blk);
 
+/**
+ * @brief Append slices of every CBOR data block in one list to another list
+ *
+ * No data is copied, the blocks appended to dst_list refer to the same data as those in src_list.
+ * Plain data blocks in src_list belong to that list, so each one is first made into a buffer of its
+ * own, with a slice of it put in its place.  Afterwards both lists read the same, and the data stays
+ * allocated until the last slice of it is recycled.  The slice blocktype must be registered, see
+ * bplib_mpool_bblock_cbor_slice_init().
+ *
+ * src_list is changed, so it must not be in use by another task at the same time.
+ *
+ * @param dst_list List to append the slices to
+ * @param src_list List of CBOR data blocks to share
+ * @returns BP_SUCCESS, or BP_ERROR if there was no memory, in which case anything appended to dst_list is
+ * recycled again and src_list still reads the same as before
+ */
+int bplib_mpool_bblock_cbor_share(bplib_mpool_block_t *dst_list, bplib_mpool_block_t *src_list);
+
 /**
  * @brief Append a canonical block to the bundle
  *
@@ -233,6 +451,42 @@ void bplib_mpool_bblock_cbor_append(bplib_mpool_block_t *head, bplib_mpool_block
  */
 void bplib_mpool_bblock_primary_append(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_block_t *blk);
 
+/**
+ * @brief Make another instance of a bundle that shares the encoded data of the original
+ *
+ * This is for sending the same bundle to more than one place.  The copy gets its own primary block and
+ * canonical blocks, with the same logical data as the original, but the encoded data of those blocks is
+ * shared with the original via bplib_mpool_bblock_cbor_share(), so a copy of a large bundle only takes a
+ * few blocks from the pool.  The blocks which change at every hop (previous node, bundle age and hop count)
+ * are not shared, they are left unencoded in the copy, to be updated and encoded for the hop it takes.
+ *
+ * The copy is not stored or traced, and its egress information is not set.
+ *
+ * @param pool
+ * @param cpb The bundle to copy, which must not be in use by another task at the same time
+ * @param priority Allocation priority, as for bplib_mpool_bblock_primary_alloc()
+ * @param timeout Time limit to wait for the primary block, as for bplib_mpool_bblock_primary_alloc()
+ * @returns The primary block of the copy, or NULL if there was no memory
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_primary_share_copy(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t *cpb,
+                                                           uint8_t priority, uint64_t timeout);
+
+/**
+ * @brief Add up the pool memory taken by a bundle
+ *
+ * This counts the primary block, every canonical block, and the CBOR data of each, at the
+ * footprint of the block in its size class (see bplib_mpool_get_block_footprint()).  A slice
+ * counts for itself and for the buffer it refers to, which is only counted once for the slices
+ * in a row that share it, such as those of a bundle decoded in place.  A buffer which is also
+ * shared with another bundle is counted for both.  External data is not in the pool, so only
+ * the block standing in for it counts.
+ *
+ * @param cpb
+ * @param block_count Set to the number of pool blocks counted, may be NULL
+ * @returns The total size in bytes
+ */
+size_t bplib_mpool_bblock_primary_get_footprint(bplib_mpool_bblock_primary_t *cpb, uint32_t *block_count);
+
 /**
  * @brief Find a canonical block within the bundle
  *
@@ -252,6 +506,36 @@ bplib_mpool_block_t *bplib_mpool_bblock_primary_locate_canonical(bplib_mpool_bbl
  */
 void bplib_mpool_bblock_primary_drop_encode(bplib_mpool_bblock_primary_t *cpb);
 
+/**
+ * @brief Charge a bundle to the memory quota of the flow it came in through
+ *
+ * Nothing is charged if the flow has no limit or the bundle is charged already.  The bundle holds
+ * a ref to the flow until bplib_mpool_bblock_primary_quota_release() gives the charge back, which
+ * is done when the primary block is recycled.
+ *
+ * @param cpb
+ * @param flow_ref the flow block, see bplib_mpool_flow_set_quota()
+ * @param size what the bundle counts for against the limit, normally its encoded size
+ */
+void bplib_mpool_bblock_primary_quota_charge(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t flow_ref,
+                                             size_t size);
+
+/**
+ * @brief Give back what a bundle was charged against a memory quota, if anything
+ *
+ * @param cpb
+ */
+void bplib_mpool_bblock_primary_quota_release(bplib_mpool_bblock_primary_t *cpb);
+
+/**
+ * @brief Drop all canonical blocks from a bundle
+ *
+ * The canonical blocks are returned to the pool, leaving only the primary block.
+ *
+ * @param cpb
+ */
+void bplib_mpool_bblock_primary_drop_canonical_blocks(bplib_mpool_bblock_primary_t *cpb);
+
 /**
  * @brief Drop all encode data (CBOR) from a canonical block
  *
@@ -275,4 +559,67 @@ void bplib_mpool_bblock_canonical_drop_encode(bplib_mpool_bblock_canonical_t *cc
 size_t bplib_mpool_bblock_cbor_export(bplib_mpool_block_t *list, void *out_ptr, size_t max_out_size, size_t seek_start,
                                       size_t max_count);
 
+/**
+ * @brief Describe an entire chain of encoded blocks without copying it
+ *
+ * One entry is filled in for every nonempty block in the chain, pointing directly
+ * at the data in the pool.  The blocks must not be changed or recycled while the
+ * entries are in use.
+ *
+ * @param list
+ * @param iov array of entries to fill in
+ * @param max_iov number of entries in iov
+ * @return number of entries needed for the whole chain, if more than max_iov only max_iov were filled in
+ */
+size_t bplib_mpool_bblock_cbor_export_iov(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov);
+
+/**
+ * @brief Describe part of a chain of encoded blocks without copying it
+ *
+ * This is the same as bplib_mpool_bblock_cbor_export_iov(), but only for the data starting at
+ * seek_start, up to max_count bytes, as with bplib_mpool_bblock_cbor_export().  The first and last
+ * entries may point at only part of a block.
+ *
+ * @param list
+ * @param iov array of entries to fill in
+ * @param max_iov number of entries in iov
+ * @param seek_start offset of the data in the chain
+ * @param max_count size of the data
+ * @return number of entries needed for the data, if more than max_iov only max_iov were filled in
+ */
+size_t bplib_mpool_bblock_cbor_export_iov_range(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov,
+                                                size_t seek_start, size_t max_count);
+
+/**
+ * @brief Update a CRC over part of a chain of encoded blocks
+ *
+ * This digests the data that bplib_mpool_bblock_cbor_export_iov_range() would describe, in place,
+ * handing the blocks to bplib_crc_update_list() a batch at a time rather than one call per block.
+ *
+ * @param list
+ * @param params CRC algorithm to use
+ * @param crc CRC value to update, not finalized
+ * @param seek_start offset of the data in the chain
+ * @param max_count size of the data
+ * @return number of bytes digested, less than max_count if the chain ends first
+ */
+size_t bplib_mpool_bblock_cbor_crc_update(bplib_mpool_block_t *list, bplib_crc_parameters_t *params,
+                                          bp_crcval_t *crc, size_t seek_start, size_t max_count);
+
+/**
+ * @brief Replace part of a chain of encoded blocks, in place
+ *
+ * This is the reverse of bplib_mpool_bblock_cbor_export(), the data is copied into the existing
+ * blocks starting at seek_start, without changing their size.  It stops at the end of the chain,
+ * or at any slice, as that data may be shared with something else.
+ *
+ * @param list
+ * @param in_ptr data to put into the chain
+ * @param seek_start offset of the data in the chain
+ * @param count size of the data
+ * @return number of bytes copied, less than count if the chain did not have room for all of it
+ */
+size_t bplib_mpool_bblock_cbor_overwrite(bplib_mpool_block_t *list, const void *in_ptr, size_t seek_start,
+                                         size_t count);
+
 #endif /* V7_MPOOL_BUNDLE_BLOCKS_H */
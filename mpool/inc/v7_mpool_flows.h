@@ -32,6 +32,26 @@
 #define BPLIB_MPOOL_FLOW_FLAGS_ENDPOINT 0x08
 #define BPLIB_MPOOL_FLOW_FLAGS_POLL     0x10
 
+/*
+ * Set while the ingress/egress queue of the flow is above its high watermark, and cleared
+ * when it drains to its low watermark (see bplib_mpool_flow_set_watermarks()).
+ */
+#define BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH 0x20
+#define BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH  0x40
+
+/*
+ * Set on a flow that wants a poll event when a contact in the contact plan of the
+ * route table is announced or starts (see bplib_route_contact_add()).
+ */
+#define BPLIB_MPOOL_FLOW_FLAGS_CONTACTS 0x80
+
+/*
+ * Toggled on every flow with BPLIB_MPOOL_FLOW_FLAGS_CONTACTS when the routes of the route table
+ * are replaced as a whole (see bplib_route_replace_all()), which gives it a route change event.
+ * Like BPLIB_MPOOL_FLOW_FLAGS_POLL, only the change of this flag matters and not its value.
+ */
+#define BPLIB_MPOOL_FLOW_FLAGS_ROUTES 0x100
+
 /**
  * @brief Upper limit to how deep a single queue may ever be
  *
@@ -46,6 +66,23 @@
 #define BP_MPOOL_MAX_SUBQ_DEPTH   0x10000000
 #define BP_MPOOL_SHORT_SUBQ_DEPTH 0x10
 
+/*
+ * Options for bplib_mpool_flow_attach_ring().  Each indicates that only one thread
+ * at a time will ever be on that side of the queue, so that side does not need the lock.
+ * The other side still takes the subq lock, so it may be used by several threads.
+ */
+#define BPLIB_MPOOL_RING_SINGLE_PRODUCER 0x01
+#define BPLIB_MPOOL_RING_SINGLE_CONSUMER 0x02
+
+/*
+ * Options for bplib_mpool_flow_attach_bands().  The bands are numbered from 0 (lowest priority)
+ * upward, and a bundle goes into the band matching its class of service (BP_COS_*), or the
+ * highest band if there are fewer bands than classes.  Anything that is not a bundle goes in band 0.
+ */
+#define BPLIB_MPOOL_SUBQ_MAX_BANDS         4
+#define BPLIB_MPOOL_BANDS_DEQUEUE_STRICT   0 /**< always pull from the highest band that is not empty */
+#define BPLIB_MPOOL_BANDS_DEQUEUE_WEIGHTED 1 /**< pull up to "weight" entries from each band in turn */
+
 /*
  * Enumeration that defines the various possible routing table events.  This enum
  * must always appear first in the structure that is the argument to the event handler,
@@ -57,6 +94,9 @@ typedef enum
     bplib_mpool_flow_event_poll,
     bplib_mpool_flow_event_up,
     bplib_mpool_flow_event_down,
+    bplib_mpool_flow_event_high_watermark,
+    bplib_mpool_flow_event_low_watermark,
+    bplib_mpool_flow_event_route_change,
     bplib_mpool_flow_event_max
 
 } bplib_mpool_flow_event_t;
@@ -74,10 +114,18 @@ typedef struct bplib_mpool_flow_statechange_event
     bp_handle_t              intf_id;
 } bplib_mpool_flow_statechange_event_t;
 
+typedef struct bplib_mpool_flow_watermark_event
+{
+    bplib_mpool_flow_event_t          event_type; /* must be first */
+    bp_handle_t                       intf_id;
+    struct bplib_mpool_subq_workitem *subq; /**< the ingress or egress queue of the flow that crossed the mark */
+} bplib_mpool_flow_watermark_event_t;
+
 typedef union bplib_mpool_flow_generic_event
 {
     bplib_mpool_flow_event_t             event_type;
     bplib_mpool_flow_statechange_event_t intf_state;
+    bplib_mpool_flow_watermark_event_t   watermark;
 } bplib_mpool_flow_generic_event_t;
 
 struct bplib_mpool_subq_base
@@ -94,23 +142,65 @@ struct bplib_mpool_subq_base
     volatile unsigned int pull_count;
 };
 
+typedef struct bplib_mpool_subq_band_config
+{
+    uint32_t depth_limit; /**< entries allowed in this band, in addition to the overall limit of the queue */
+    uint32_t weight;      /**< entries pulled from this band per round, for weighted dequeue (at least 1) */
+} bplib_mpool_subq_band_config_t;
+
+typedef struct bplib_mpool_subq_band_stats
+{
+    uint32_t push_count;  /**< entries that have gone into this band */
+    uint32_t pull_count;  /**< entries that have come out of this band, including dropped entries */
+    uint32_t depth_limit; /**< configured limit of this band */
+} bplib_mpool_subq_band_stats_t;
+
 typedef struct bplib_mpool_subq_workitem
 {
-    bplib_mpool_job_t       job_header;
-    bplib_mpool_subq_base_t base_subq;
-    unsigned int            current_depth_limit;
+    bplib_mpool_job_t         job_header;
+    bplib_mpool_subq_base_t   base_subq;
+    unsigned int              current_depth_limit;
+    unsigned int              fill_waiters;   /**< threads waiting for this queue to be non-empty, updated under lock */
+    unsigned int              space_waiters;  /**< threads waiting for space in this queue, updated under lock */
+    bplib_mpool_subq_ring_t  *ring;           /**< if set, entries are kept in this ring rather than the block_list */
+    bplib_mpool_subq_bands_t *bands;          /**< if set, entries are kept in priority bands instead */
+    unsigned int              high_watermark; /**< depth that raises a high watermark event, 0 if not used */
+    unsigned int              low_watermark;  /**< depth that raises the low watermark event after a high one */
+    bp_handle_t               notifier;       /**< set while not empty, see bplib_mpool_flow_attach_notifier() */
+    bool                      notifier_set;   /**< last state given to the notifier, updated under lock */
 } bplib_mpool_subq_workitem_t;
 
+/*
+ * The memory held by the bundles that came into the pool through a flow, so that one sender
+ * cannot fill the whole pool and hold off the custody and DACS traffic of the others.  While
+ * there is a limit, each bundle is charged its encoded size as it comes in, and that is given
+ * back when its primary block is recycled, wherever that happens, so the count is atomic.
+ */
+typedef struct bplib_mpool_flow_quota
+{
+    size_t       limit;        /**< bytes the bundles of the flow may hold, 0 for no limit */
+    size_t       used;         /**< bytes charged to bundles which are still in the pool */
+    bool         backpressure; /**< refuse new bundles for now while over, rather than dropping them */
+    unsigned int over_count;   /**< bundles dropped or refused because the flow was over its limit */
+} bplib_mpool_flow_quota_t;
+
 struct bplib_mpool_flow
 {
     uint32_t pending_state_flags;
     uint32_t current_state_flags;
+    bool     jobs_running; /**< a job of this flow is being run, see bplib_mpool_job_claim_next_active() */
+    uint64_t poll_time;    /**< DTN time of the next poll event wanted by this flow, set via the route table */
+
+    bplib_mpool_block_t poll_link; /**< in the poll list of the route table while poll_time is set */
 
     bplib_mpool_job_statechange_t statechange_job;
     bplib_mpool_ref_t             parent;
 
     bplib_mpool_subq_workitem_t ingress;
     bplib_mpool_subq_workitem_t egress;
+
+    bplib_mpool_flow_quota_t quota;
+    bplib_mpool_reserve_t    reserve; /**< blocks set aside for the bundles of this flow, entered while it runs */
 };
 
 /**
@@ -149,6 +239,158 @@ uint32_t bplib_mpool_flow_try_move_all(bplib_mpool_subq_workitem_t *subq_dst, bp
 
 bplib_mpool_block_t *bplib_mpool_flow_try_pull(bplib_mpool_subq_workitem_t *subq_src, uint64_t abs_timeout);
 
+/**
+ * @brief Convert a flow queue to a bounded single producer/single consumer ring
+ *
+ * The entries of the queue are kept in a fixed size ring, stored in a block allocated
+ * from the same pool, rather than in the linked block_list.  The side(s) of the queue
+ * indicated in ring_flags then push or pull without taking any lock, unless they need
+ * to wait.  The queue depth is further limited to the size of the ring.
+ *
+ * This must be done when the flow is created, before it is enabled or visible to any other
+ * thread.  A ring queue cannot be used with bplib_mpool_flow_try_move_all().  If a ring queue
+ * is disabled, entries still in the ring are dropped as they are pulled.
+ *
+ * @note This requires atomic operations, so if the toolchain does not have them, this
+ * always fails and the queue remains a normal locked queue.
+ *
+ * @param subq the queue to convert, which must be empty and must not have priority bands
+ * @param ring_flags combination of BPLIB_MPOOL_RING_SINGLE_PRODUCER and BPLIB_MPOOL_RING_SINGLE_CONSUMER
+ * @retval BP_SUCCESS if the queue is now a ring
+ * @retval BP_ERROR if the ring could not be set up
+ */
+int bplib_mpool_flow_attach_ring(bplib_mpool_subq_workitem_t *subq, uint32_t ring_flags);
+
+/**
+ * @brief Split a flow queue into priority bands
+ *
+ * The entries of the queue are kept in a separate FIFO per band, stored in a block allocated
+ * from the same pool, and the band is chosen from the class of service of each bundle as it is
+ * pushed.  Pulling from the queue then takes the highest band first (strict), or goes around
+ * the bands from the highest down, taking up to the weight of each band in turn (weighted).
+ *
+ * The depth limit of the queue still applies to all the bands together, and a push is also
+ * held back if the band it goes to is at its own limit.  The push and pull counts of the queue
+ * also cover all the bands, while each band keeps its own counts (see bplib_mpool_flow_query_band()).
+ * Moving a whole queue with bplib_mpool_flow_try_move_all() only checks the overall limit.
+ *
+ * @param subq the queue to split, which must be empty and must not be a ring
+ * @param dequeue_mode BPLIB_MPOOL_BANDS_DEQUEUE_STRICT or BPLIB_MPOOL_BANDS_DEQUEUE_WEIGHTED
+ * @param num_bands number of bands, from 1 to BPLIB_MPOOL_SUBQ_MAX_BANDS
+ * @param config array of num_bands entries, or NULL for no per-band limit and weights of 1, 2, 4, ...
+ * @retval BP_SUCCESS if the queue now has priority bands
+ * @retval BP_ERROR if the bands could not be set up
+ */
+int bplib_mpool_flow_attach_bands(bplib_mpool_subq_workitem_t *subq, uint32_t dequeue_mode, uint32_t num_bands,
+                                  const bplib_mpool_subq_band_config_t *config);
+
+/**
+ * @brief Get the counters of one priority band of a flow queue
+ *
+ * @param subq the queue
+ * @param band band number, 0 is the lowest priority
+ * @param stats output buffer
+ * @retval BP_SUCCESS if the stats were filled in
+ * @retval BP_ERROR if the queue does not have that band
+ */
+int bplib_mpool_flow_query_band(bplib_mpool_subq_workitem_t *subq, uint32_t band, bplib_mpool_subq_band_stats_t *stats);
+
+/**
+ * @brief Push a batch of blocks into a flow queue
+ *
+ * Blocks are taken from the head of the list, so the list order is preserved in the queue.
+ * This waits until there is room for at least one block, then pushes up to max_count
+ * blocks, or as many as the queue depth limit allows, all under a single lock.
+ * Any blocks which did not fit are left in the list.
+ *
+ * @param subq_dst the destination queue
+ * @param list list of blocks to push
+ * @param max_count maximum number of blocks to push
+ * @param abs_timeout DTN time at which to stop waiting for room, or 0 to not wait
+ * @return number of blocks pushed, which may be 0
+ */
+uint32_t bplib_mpool_flow_try_push_n(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_block_t *list,
+                                     uint32_t max_count, uint64_t abs_timeout);
+
+/**
+ * @brief Pull a batch of blocks from a flow queue
+ *
+ * This waits until there is at least one block in the queue, then moves up to max_count
+ * blocks to the end of the list, all under a single lock.
+ *
+ * @param subq_src the source queue
+ * @param list list to append the blocks to, usually local to the caller
+ * @param max_count maximum number of blocks to pull
+ * @param abs_timeout DTN time at which to stop waiting for a block, or 0 to not wait
+ * @return number of blocks pulled, which may be 0
+ */
+uint32_t bplib_mpool_flow_try_pull_n(bplib_mpool_subq_workitem_t *subq_src, bplib_mpool_block_t *list,
+                                     uint32_t max_count, uint64_t abs_timeout);
+
+/**
+ * @brief Set the watermarks of a flow queue
+ *
+ * When a push takes the depth of the queue to the high watermark, the
+ * BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH or BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH flag is set on
+ * the flow, and once a pull takes it back down to the low watermark that flag is cleared.
+ * Like the other flags, the change is handled by the statechange job of the flow, which
+ * calls the event handler of the interface with bplib_mpool_flow_event_high_watermark or
+ * bplib_mpool_flow_event_low_watermark.  A producer can then slow down well before the
+ * queue is at its depth limit, and the gap between the marks keeps it from flapping.
+ *
+ * @note Queue depth is not checked against the watermarks when the queue is a ring.
+ *
+ * @param subq the ingress or egress queue of a flow
+ * @param high_watermark the depth at which to raise the event, or 0 to turn watermarks off
+ * @param low_watermark the depth at which to clear it again, must be less than high_watermark
+ * @retval BP_SUCCESS if the watermarks were set
+ * @retval BP_ERROR if the low watermark is not below the high watermark
+ */
+int bplib_mpool_flow_set_watermarks(bplib_mpool_subq_workitem_t *subq, uint32_t high_watermark, uint32_t low_watermark);
+
+/**
+ * @brief Set the memory quota of a flow
+ *
+ * The bundles already in the pool keep the charge they came in with, if any, so a flow that was
+ * not limited before starts from what comes in after this.  Bundles may still take the flow a
+ * little over the limit, as the check and the charge are not done under one lock.
+ *
+ * @param flow
+ * @param limit bytes of encoded bundles that may come in through the flow, 0 for no limit
+ * @param backpressure true to refuse bundles while over the limit, false to drop them
+ */
+void bplib_mpool_flow_set_quota(bplib_mpool_flow_t *flow, size_t limit, bool backpressure);
+
+/**
+ * @brief Checks whether a bundle may come into the pool through a flow
+ *
+ * This is done before the bundle is allocated, so no work is spent on a bundle that cannot be kept.
+ * Each bundle that may not is counted in the over_count of the quota.
+ *
+ * @param flow the flow the bundle comes in through, may be NULL
+ * @param size encoded size of the bundle, or 0 if not known yet
+ * @retval BP_SUCCESS if the flow has no limit (or is NULL), or is under it
+ * @retval BP_TIMEOUT if over the limit and the quota applies backpressure, so it may be tried again
+ * @retval BP_ERROR if over the limit and the bundle is to be dropped
+ */
+int bplib_mpool_flow_quota_admit(bplib_mpool_flow_t *flow, size_t size);
+
+/**
+ * @brief Attach an OS notifier to a flow queue
+ *
+ * The notifier is set whenever the queue is not empty and cleared when it is drained, so that the
+ * file descriptor from bplib_os_notifier_get_fd() can be polled by an event loop instead of having
+ * a thread wait in bplib_mpool_flow_try_pull().  It is only updated on transitions, under the queue
+ * lock.  Calling this again returns the same notifier.  It is destroyed when the flow is recycled.
+ *
+ * @note A ring queue is pushed and pulled without the lock, so it cannot have a notifier.
+ *
+ * @param subq the ingress or egress queue of a flow
+ * @retval BP_SUCCESS if subq->notifier is now valid
+ * @retval BP_ERROR if the queue is a ring, or the OS does not have notifiers
+ */
+int bplib_mpool_flow_attach_notifier(bplib_mpool_subq_workitem_t *subq);
+
 bool bplib_mpool_flow_modify_flags(bplib_mpool_block_t *cb, uint32_t set_bits, uint32_t clear_bits);
 
 /**
@@ -209,9 +451,48 @@ static inline bool bplib_mpool_subq_workitem_may_push(const bplib_mpool_subq_wor
     return (bplib_mpool_subq_get_depth(&subq->base_subq) < (subq->current_depth_limit / 2));
 }
 
+/**
+ * @brief Get the number of entries that can be pushed before the subq reaches its depth limit
+ *
+ * @note This check is lockless, the same as bplib_mpool_subq_workitem_may_push().  If it returns
+ * zero, a push with no timeout would have failed at the time of the check, so the caller can skip
+ * the lock entirely.  Otherwise the push may still accept fewer, e.g. if the subq has priority bands.
+ *
+ * @param subq
+ * @returns Number of entries the subq has room for
+ */
+static inline uint32_t bplib_mpool_subq_workitem_get_space(const bplib_mpool_subq_workitem_t *subq)
+{
+    uint32_t depth;
+    uint32_t depth_limit;
+
+    depth       = bplib_mpool_subq_get_depth(&subq->base_subq);
+    depth_limit = subq->current_depth_limit;
+    if (depth >= depth_limit)
+    {
+        return 0;
+    }
+
+    return (depth_limit - depth);
+}
+
 static inline bool bplib_mpool_flow_is_up(const bplib_mpool_flow_t *flow)
 {
     return (~flow->current_state_flags & (BPLIB_MPOOL_FLOW_FLAGS_ADMIN_UP | BPLIB_MPOOL_FLOW_FLAGS_OPER_UP)) == 0;
 }
 
+/**
+ * @brief Sets the job type of the forwarding jobs of a flow
+ *
+ * This only determines where the job times are counted, see bplib_mpool_stat_job_wait_time
+ *
+ * @param flow
+ * @param jobtype
+ */
+static inline void bplib_mpool_flow_set_jobtype(bplib_mpool_flow_t *flow, bplib_mpool_jobtype_t jobtype)
+{
+    flow->ingress.job_header.jobtype = jobtype;
+    flow->egress.job_header.jobtype  = jobtype;
+}
+
 #endif /* V7_MPOOL_FLOWS_H */
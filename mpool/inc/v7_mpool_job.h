@@ -29,6 +29,11 @@ typedef struct bplib_mpool_job
 {
     bplib_mpool_block_t         link;
     bplib_mpool_callback_func_t handler;
+    uint32_t                    activate_time_us; /**< when it was marked active, wraps around, only for intervals */
+    uint8_t                     jobtype;          /**< a bplib_mpool_jobtype_t value, for statistics */
+    bool                        quantum_bytes;    /**< whether the quantum is in bytes rather than entries */
+    uint32_t                    quantum;          /**< share of the work this job may do per run, 0 if not limited */
+    int32_t                     deficit;          /**< share left in this run, carried over as debt if overspent */
 } bplib_mpool_job_t;
 
 typedef struct bplib_mpool_job_statechange
@@ -74,6 +79,70 @@ void bplib_mpool_job_mark_active(bplib_mpool_job_t *job);
  */
 bplib_mpool_job_t *bplib_mpool_job_get_next_active(bplib_mpool_t *pool);
 
+/**
+ * @brief Take the next active job in the pool that may be run right now
+ *
+ * This is like bplib_mpool_job_get_next_active(), but skips over the jobs of any flow that
+ * already has a job being run by another thread.  The skipped jobs stay in the active list,
+ * so they run once that flow is released.  The jobs of one flow therefore never run at the
+ * same time, and the entries of each queue are still handled in order, while separate flows
+ * can be handled by separate threads.
+ *
+ * Every job returned from here must be passed to bplib_mpool_job_release() after it has run.
+ *
+ * @param pool
+ * @return bplib_mpool_job_t*, or NULL if there is no job that can be run now
+ */
+bplib_mpool_job_t *bplib_mpool_job_claim_next_active(bplib_mpool_t *pool);
+
+/**
+ * @brief Release a job that was taken by bplib_mpool_job_claim_next_active()
+ *
+ * This allows the other jobs of the same flow to be claimed.
+ *
+ * @param job
+ */
+void bplib_mpool_job_release(bplib_mpool_job_t *job);
+
+/**
+ * @brief Set the share of work a job may do each time it is run
+ *
+ * Jobs with a quantum are run deficit round robin: each run adds the quantum to the share
+ * of the job (up to one quantum), the job handler spends it as it goes with
+ * bplib_mpool_job_spend_share(), and once that says it is used up the job puts itself back at
+ * the end of the active list with bplib_mpool_job_mark_active() so the other active jobs get
+ * their turn.
+ * A job handler that does not take note of its share is not affected.
+ *
+ * @param job
+ * @param quantum which is in entries or bytes, 0 for no limit
+ * @param in_bytes whether the quantum is in bytes
+ */
+void bplib_mpool_job_set_quantum(bplib_mpool_job_t *job, uint32_t quantum, bool in_bytes);
+
+/**
+ * @brief Take the work done on one entry from the share of a job
+ *
+ * A bundle counts as its encoded size when the quantum is in bytes.  This may leave the
+ * share below zero, the difference is then taken from the next run.
+ *
+ * @param job
+ * @param qblk the entry that was handled, this should be called before it is passed on
+ * @retval true if the share of this run is used up, so the job should yield
+ * @retval false if it may go on (always, if it has no quantum)
+ */
+bool bplib_mpool_job_spend_share(bplib_mpool_job_t *job, bplib_mpool_block_t *qblk);
+
+/**
+ * @brief Run all the active jobs in the pool
+ *
+ * This may be called by any number of threads at the same time, which then share the jobs
+ * between them (see bplib_mpool_job_claim_next_active()).  It returns once there are no
+ * more jobs that the calling thread can run.
+ *
+ * @param pool
+ * @param arg passed to the job handlers
+ */
 void bplib_mpool_job_run_all(bplib_mpool_t *pool, void *arg);
 
 #endif /* V7_MPOOL_JOB_H */
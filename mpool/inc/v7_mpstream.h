@@ -35,15 +35,26 @@ typedef enum bplib_mpool_stream_dir
     bplib_mpool_stream_dir_read
 } bplib_mpool_stream_dir_t;
 
+/*
+ * Where one block of a read stream starts, see bplib_mpool_stream_set_index()
+ */
+typedef struct bplib_mpool_stream_index_entry
+{
+    bplib_mpool_block_t *blk;
+    size_t               position;
+} bplib_mpool_stream_index_entry_t;
+
 typedef struct bplib_mpool_stream
 {
-    bplib_mpool_stream_dir_t dir;
-    bplib_mpool_t           *pool;
-    bplib_mpool_block_t     *last_eblk;
-    bplib_mpool_block_t      head;
-    size_t                   curr_pos;
-    size_t                   curr_limit;
-    size_t                   stream_position;
+    bplib_mpool_stream_dir_t          dir;
+    bplib_mpool_t                    *pool;
+    bplib_mpool_block_t              *last_eblk;
+    bplib_mpool_block_t               head;
+    size_t                            curr_pos;
+    size_t                            curr_limit;
+    size_t                            stream_position;
+    bplib_mpool_stream_index_entry_t *index;
+    size_t                            index_count;
 } bplib_mpool_stream_t;
 
 void   bplib_mpool_start_stream_init(bplib_mpool_stream_t *mps, bplib_mpool_t *pool, bplib_mpool_stream_dir_t dir);
@@ -51,6 +62,29 @@ size_t bplib_mpool_stream_write(bplib_mpool_stream_t *mps, const void *data, siz
 size_t bplib_mpool_stream_read(bplib_mpool_stream_t *mps, void *data, size_t size);
 size_t bplib_mpool_stream_seek(bplib_mpool_stream_t *mps, size_t target_position);
 void   bplib_mpool_stream_attach(bplib_mpool_stream_t *mps, bplib_mpool_block_t *head);
+
+/*
+ * Points a read stream at a list of CBOR blocks that is kept elsewhere, such as the encoded chunks
+ * of a block, and rewinds it.  The list is only read, and stays with whatever it belongs to.
+ */
+void bplib_mpool_stream_read_list(bplib_mpool_stream_t *mps, bplib_mpool_block_t *list);
+
+/*
+ * Same as bplib_mpool_stream_read(), but instead of copying the data this fills in iov with where it is
+ * in the blocks, one entry per block, up to the number of entries in *iov_count.  The stream is moved on
+ * past the data, and *iov_count is set to the number of entries used.  Returns the number of bytes.
+ */
+size_t bplib_mpool_stream_read_iov(bplib_mpool_stream_t *mps, bplib_iovec_t *iov, size_t *iov_count, size_t size);
+
+/*
+ * Indexes where each block of a read stream starts, so that bplib_mpool_stream_seek() can go straight to
+ * the block instead of walking the list to it.  This rewinds the stream, and the caller provides the
+ * storage for the index, which must stay valid while the stream is used.  If the stream has more blocks
+ * than max_entries, seeking past the indexed ones walks the list from the last of them as usual.  Changing
+ * to another list with bplib_mpool_stream_read_list() drops the index.
+ */
+void bplib_mpool_stream_set_index(bplib_mpool_stream_t *mps, bplib_mpool_stream_index_entry_t *entries,
+                                  size_t max_entries);
 static inline size_t bplib_mpool_stream_tell(const bplib_mpool_stream_t *mps)
 {
     return mps->stream_position;
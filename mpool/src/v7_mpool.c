@@ -32,12 +32,139 @@
 
 /**
  * @brief Maxmimum number of blocks to be collected in a single maintenace cycle
+ *
+ * Normally the time budget (below) ends the cycle before this is reached.
+ */
+#define BPLIB_MPOOL_MAINTENCE_COLLECT_LIMIT 256
+
+/**
+ * @brief Time budget for garbage collection in a single maintenance cycle, in milliseconds
+ *
+ * This bounds the pause in the maintenance thread, which also forwards bundles.  If
+ * the backlog is not cleared, the rest is collected in the next cycle.
+ */
+#ifndef BPLIB_MPOOL_MAINTENANCE_COLLECT_TIME_MS
+#define BPLIB_MPOOL_MAINTENANCE_COLLECT_TIME_MS 2
+#endif
+
+/**
+ * @brief Number of blocks collected between checks of the time budget
+ */
+#define BPLIB_MPOOL_COLLECT_BATCH_SIZE 16
+
+/**
+ * @brief Number of bits in the lock set index
+ *
+ * The lock set is striped, and each resource is mapped to one of the locks in the set
+ * by a hash of its address.  The number of locks is always a power of two.
+ */
+#define BPLIB_MPOOL_LOCK_SET_BITS 4
+
+/**
+ * @brief Number of locks in the lock set
+ */
+#define BPLIB_MPOOL_NUM_LOCKS (1U << BPLIB_MPOOL_LOCK_SET_BITS)
+
+/**
+ * @brief Number of bits in the pool lock set index
+ *
+ * The pools are locked through a set of their own, apart from the one used for the
+ * subqueues, so a pool lock never shares a mutex with a subqueue lock.  That is what
+ * allows the pool lock to be taken last (see the lock ordering rules in v7_mpool_internal.h).
+ * There is one pool per partition, so this set is small.
+ */
+#define BPLIB_MPOOL_POOL_LOCK_SET_BITS 2
+
+/**
+ * @brief Number of locks in the pool lock set
+ */
+#define BPLIB_MPOOL_NUM_POOL_LOCKS (1U << BPLIB_MPOOL_POOL_LOCK_SET_BITS)
+
+/**
+ * @brief Number of low-order address bits to discard before hashing
+ *
+ * Resources are never smaller than a list link, so the low order bits of
+ * the address carry almost no information.
+ */
+#define BPLIB_MPOOL_LOCK_ADDR_SHIFT 4
+
+/**
+ * @brief Number of bits in the wait channel set index
+ *
+ * There are more wait channels than locks, as a channel is only shared by conditions
+ * that collide in the hash, and every thread on a channel is woken together.
+ */
+#define BPLIB_MPOOL_WAIT_CHANNEL_BITS 5
+
+/**
+ * @brief Number of wait channels in the wait channel set
+ */
+#define BPLIB_MPOOL_NUM_WAIT_CHANNELS (1U << BPLIB_MPOOL_WAIT_CHANNEL_BITS)
+
+bplib_mpool_lock_t         BPLIB_MPOOL_LOCK_SET[BPLIB_MPOOL_NUM_LOCKS];
+bplib_mpool_lock_t         BPLIB_MPOOL_POOL_LOCK_SET[BPLIB_MPOOL_NUM_POOL_LOCKS];
+bplib_mpool_wait_channel_t BPLIB_MPOOL_WAIT_CHANNEL_SET[BPLIB_MPOOL_NUM_WAIT_CHANNELS];
+
+#ifdef BPLIB_MPOOL_THREAD_LOCAL
+static BPLIB_MPOOL_THREAD_LOCAL bplib_mpool_thread_cache_t  BPLIB_MPOOL_THREAD_CACHE;
+static BPLIB_MPOOL_THREAD_LOCAL bplib_mpool_reserve_t      *BPLIB_MPOOL_ACTIVE_RESERVE;
+static BPLIB_MPOOL_THREAD_LOCAL bplib_mpool_release_defer_t BPLIB_MPOOL_RELEASE_DEFER;
+#endif
+
+#ifdef BPLIB_LOCK_PROFILE
+/**
+ * @brief Number of call site and named lock records in the lock profile
+ *
+ * Once this is full, further call sites are not recorded, only the locks as a whole.
  */
-#define BPLIB_MPOOL_MAINTENCE_COLLECT_LIMIT 20
+#define BPLIB_MPOOL_LOCK_PROFILE_SITES 256
+
+static bplib_mpool_lock_profile_t BPLIB_MPOOL_LOCK_PROFILE_SET[BPLIB_MPOOL_LOCK_PROFILE_SITES];
+static uint32_t                   BPLIB_MPOOL_LOCK_PROFILE_INSERT_FLAG;
+#endif
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_thread_cache
+ *
+ *-----------------------------------------------------------------*/
+static inline bplib_mpool_thread_cache_t *bplib_mpool_get_thread_cache(void)
+{
+#ifdef BPLIB_MPOOL_THREAD_LOCAL
+    return &BPLIB_MPOOL_THREAD_CACHE;
+#else
+    /* no thread-local storage on this toolchain, so there is no per-thread cache */
+    return NULL;
+#endif
+}
 
-#define BPLIB_MPOOL_NUM_LOCKS 1 /* for now */
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_release_defer
+ *
+ *-----------------------------------------------------------------*/
+static inline bplib_mpool_release_defer_t *bplib_mpool_get_release_defer(void)
+{
+#ifdef BPLIB_MPOOL_THREAD_LOCAL
+    return &BPLIB_MPOOL_RELEASE_DEFER;
+#else
+    return NULL;
+#endif
+}
 
-bplib_mpool_lock_t BPLIB_MPOOL_LOCK_SET[BPLIB_MPOOL_NUM_LOCKS];
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_active_reserve
+ *
+ *-----------------------------------------------------------------*/
+static inline bplib_mpool_reserve_t *bplib_mpool_get_active_reserve(void)
+{
+#ifdef BPLIB_MPOOL_THREAD_LOCAL
+    return BPLIB_MPOOL_ACTIVE_RESERVE;
+#else
+    return NULL;
+#endif
+}
 
 /*----------------------------------------------------------------
  *
@@ -53,54 +180,351 @@ static inline void bplib_mpool_link_reset(bplib_mpool_block_t *link, bplib_mpool
     link->prev          = link;
 }
 
-void bplib_mpool_lock_init(void)
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_addr_hash
+ *
+ *-----------------------------------------------------------------*/
+static inline uint32_t bplib_mpool_addr_hash(const void *addr, uint32_t bits)
+{
+    uint32_t hash;
+
+    /*
+     * Multiplicative (Fibonacci) hash of the address - this spreads adjacent
+     * blocks in the pool across different entries, and the top bits of the product
+     * select the entry in the set.
+     */
+    hash = (uint32_t)((uintptr_t)addr >> BPLIB_MPOOL_LOCK_ADDR_SHIFT);
+    hash *= 0x9E3779B1U;
+    hash >>= 32 - bits;
+
+    return hash;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_init_set
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_lock_init_set(bplib_mpool_lock_t *lock_set, uint32_t num_locks, const char *name)
 {
     uint32_t            i;
     bplib_mpool_lock_t *lock;
 
     /* note - this relies on the BSS section being properly zero'ed out at start */
-    for (i = 0; i < BPLIB_MPOOL_NUM_LOCKS; ++i)
+    for (i = 0; i < num_locks; ++i)
+    {
+        lock = &lock_set[i];
+        if (lock->mutex == NULL)
+        {
+            /* these are held briefly, so a waiter is better off spinning for a moment than sleeping */
+            lock->mutex = bplib_os_mutex_create(BPLIB_OS_MUTEX_RECURSIVE | BPLIB_OS_MUTEX_ADAPTIVE);
+        }
+#ifdef BPLIB_LOCK_PROFILE
+        lock->hold.lock_prof = &lock->profile;
+        lock->profile.func   = name;
+        lock->profile.line   = 0;
+#else
+        (void)name;
+#endif
+    }
+}
+
+void bplib_mpool_lock_init(void)
+{
+    uint32_t                    i;
+    bplib_mpool_wait_channel_t *channel;
+
+    bplib_mpool_lock_init_set(BPLIB_MPOOL_LOCK_SET, BPLIB_MPOOL_NUM_LOCKS, "mpool_lock");
+    bplib_mpool_lock_init_set(BPLIB_MPOOL_POOL_LOCK_SET, BPLIB_MPOOL_NUM_POOL_LOCKS, "mpool_pool_lock");
+
+    for (i = 0; i < BPLIB_MPOOL_NUM_WAIT_CHANNELS; ++i)
     {
-        lock = &BPLIB_MPOOL_LOCK_SET[i];
-        if (!bp_handle_is_valid(lock->lock_id))
+        channel = &BPLIB_MPOOL_WAIT_CHANNEL_SET[i];
+        if (channel->mutex == NULL)
         {
-            lock->lock_id = bplib_os_createlock();
+            channel->mutex = bplib_os_mutex_create(BPLIB_OS_MUTEX_ADAPTIVE);
         }
     }
 }
 
 bplib_mpool_lock_t *bplib_mpool_lock_prepare(void *resource_addr)
 {
-    /*
-     * for now, this always uses the same lock (coarse-grained locking) but in the future
-     * it might become a striped or finer-grained bucketed lock for more concurrency
-     */
-    return &BPLIB_MPOOL_LOCK_SET[0];
+    return &BPLIB_MPOOL_LOCK_SET[bplib_mpool_addr_hash(resource_addr, BPLIB_MPOOL_LOCK_SET_BITS)];
+}
+
+bplib_mpool_lock_t *bplib_mpool_lock_prepare_pool(bplib_mpool_t *pool)
+{
+    return &BPLIB_MPOOL_POOL_LOCK_SET[bplib_mpool_addr_hash(pool, BPLIB_MPOOL_POOL_LOCK_SET_BITS)];
 }
 
+#ifndef BPLIB_LOCK_PROFILE
 bplib_mpool_lock_t *bplib_mpool_lock_resource(void *resource_addr)
 {
     bplib_mpool_lock_t *selected_lock;
 
-    /*
-     * for now, this always uses the same lock (coarse-grained locking) but in the future
-     * it might become a striped or finer-grained bucketed lock for more concurrency
-     */
     selected_lock = bplib_mpool_lock_prepare(resource_addr);
     bplib_mpool_lock_acquire(selected_lock);
 
     return selected_lock;
 }
 
+bplib_mpool_lock_t *bplib_mpool_lock_pool(bplib_mpool_t *pool)
+{
+    bplib_mpool_lock_t *selected_lock;
+
+    selected_lock = bplib_mpool_lock_prepare_pool(pool);
+    bplib_mpool_lock_acquire(selected_lock);
+
+    return selected_lock;
+}
+#else
+bplib_mpool_lock_t *bplib_mpool_lock_resource_at(void *resource_addr, const char *func, uint32_t line)
+{
+    bplib_mpool_lock_t *selected_lock;
+
+    selected_lock = bplib_mpool_lock_prepare(resource_addr);
+    bplib_mpool_lock_acquire_at(selected_lock, func, line);
+
+    return selected_lock;
+}
+
+bplib_mpool_lock_t *bplib_mpool_lock_pool_at(bplib_mpool_t *pool, const char *func, uint32_t line)
+{
+    bplib_mpool_lock_t *selected_lock;
+
+    selected_lock = bplib_mpool_lock_prepare_pool(pool);
+    bplib_mpool_lock_acquire_at(selected_lock, func, line);
+
+    return selected_lock;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_find
+ *
+ * Finds the record for the given call site, or creates it.  Records are never removed,
+ * and a record is published by storing its func last, so the lookup does not need a
+ * lock.  Only creating a record is serialized, so two threads cannot create the same one.
+ *-----------------------------------------------------------------*/
+static bplib_mpool_lock_profile_t *bplib_mpool_lock_profile_find(const char *func, uint32_t line, bool create)
+{
+    bplib_mpool_lock_profile_t *prof;
+    const char                 *curr_func;
+    uint32_t                    pos;
+    uint32_t                    count;
+    uint32_t                    expected;
+
+    pos = (bplib_mpool_addr_hash(func, 8) + line) & (BPLIB_MPOOL_LOCK_PROFILE_SITES - 1);
+    for (count = 0; count < BPLIB_MPOOL_LOCK_PROFILE_SITES; ++count)
+    {
+        prof      = &BPLIB_MPOOL_LOCK_PROFILE_SET[pos];
+        curr_func = __atomic_load_n(&prof->func, __ATOMIC_ACQUIRE);
+        if (curr_func == NULL)
+        {
+            break;
+        }
+        if (curr_func == func && prof->line == line)
+        {
+            return prof;
+        }
+        pos = (pos + 1) & (BPLIB_MPOOL_LOCK_PROFILE_SITES - 1);
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+
+    /* only taken the first time a site is seen, so a simple spin is enough */
+    expected = 0;
+    while (!__atomic_compare_exchange_n(&BPLIB_MPOOL_LOCK_PROFILE_INSERT_FLAG, &expected, 1, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED))
+    {
+        expected = 0;
+    }
+
+    /* another thread may have created it in the meantime */
+    prof = bplib_mpool_lock_profile_find(func, line, false);
+    if (prof == NULL)
+    {
+        for (count = 0; count < BPLIB_MPOOL_LOCK_PROFILE_SITES; ++count)
+        {
+            if (BPLIB_MPOOL_LOCK_PROFILE_SET[pos].func == NULL)
+            {
+                prof       = &BPLIB_MPOOL_LOCK_PROFILE_SET[pos];
+                prof->line = line;
+                __atomic_store_n(&prof->func, func, __ATOMIC_RELEASE);
+                break;
+            }
+            pos = (pos + 1) & (BPLIB_MPOOL_LOCK_PROFILE_SITES - 1);
+        }
+    }
+
+    __atomic_store_n(&BPLIB_MPOOL_LOCK_PROFILE_INSERT_FLAG, 0, __ATOMIC_RELEASE);
+
+    return prof;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_update
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_lock_profile_update(bplib_mpool_lock_profile_t *prof, bool contended, uint64_t wait_us)
+{
+    __atomic_add_fetch(&prof->acquire_count, 1, __ATOMIC_RELAXED);
+    if (contended)
+    {
+        __atomic_add_fetch(&prof->contended_count, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&prof->wait_us_total, wait_us, __ATOMIC_RELAXED);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_update_hold
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_lock_profile_update_hold(bplib_mpool_lock_profile_t *prof, uint64_t hold_us)
+{
+    uint64_t curr_max;
+
+    curr_max = __atomic_load_n(&prof->hold_us_max, __ATOMIC_RELAXED);
+    while (hold_us > curr_max && !__atomic_compare_exchange_n(&prof->hold_us_max, &curr_max, hold_us, true,
+                                                              __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        /* curr_max was refreshed by the failed exchange */
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_init
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_lock_profile_init(bplib_mpool_lock_hold_t *hold, const char *lock_name)
+{
+    memset(hold, 0, sizeof(*hold));
+    hold->lock_prof = bplib_mpool_lock_profile_find(lock_name, 0, true);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_acquired
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_lock_profile_acquired(bplib_mpool_lock_hold_t *hold, const char *func, uint32_t line, bool contended,
+                                       uint64_t wait_us)
+{
+    bplib_mpool_lock_profile_t *site_prof;
+
+    site_prof = bplib_mpool_lock_profile_find(func, line, true);
+    if (site_prof != NULL)
+    {
+        bplib_mpool_lock_profile_update(site_prof, contended, wait_us);
+    }
+    if (hold->lock_prof != NULL)
+    {
+        bplib_mpool_lock_profile_update(hold->lock_prof, contended, wait_us);
+    }
+
+    if (hold->depth == 0)
+    {
+        hold->site_prof = site_prof;
+        hold->start_us  = bplib_os_get_monotonic_us();
+    }
+    ++hold->depth;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_suspend
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_lock_profile_suspend(bplib_mpool_lock_hold_t *hold)
+{
+    uint64_t hold_us;
+
+    hold_us = bplib_os_get_monotonic_us() - hold->start_us;
+    if (hold->site_prof != NULL)
+    {
+        bplib_mpool_lock_profile_update_hold(hold->site_prof, hold_us);
+    }
+    if (hold->lock_prof != NULL)
+    {
+        bplib_mpool_lock_profile_update_hold(hold->lock_prof, hold_us);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_resume
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_lock_profile_resume(bplib_mpool_lock_hold_t *hold)
+{
+    /* the rest of the hold is timed as a separate hold by the same call site */
+    hold->start_us = bplib_os_get_monotonic_us();
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_lock_profile_released
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_lock_profile_released(bplib_mpool_lock_hold_t *hold)
+{
+    if (hold->depth > 0)
+    {
+        --hold->depth;
+        if (hold->depth == 0)
+        {
+            bplib_mpool_lock_profile_suspend(hold);
+            hold->site_prof = NULL;
+        }
+    }
+}
+#endif
+
+void bplib_mpool_lock_acquire_contended(bplib_mpool_lock_t *lock)
+{
+    uint64_t start_us;
+    uint64_t wait_us;
+    uint64_t bin_limit_us;
+    uint32_t bin;
+
+    start_us = bplib_os_get_monotonic_us();
+    bplib_os_mutex_lock(lock->mutex);
+    wait_us = bplib_os_get_monotonic_us() - start_us;
+
+    /* bin 0 is for no wait at all, the rest are by powers of 10 from 10us, the last is for anything longer */
+    bin          = 1;
+    bin_limit_us = 10;
+    while (bin < (BPLIB_MPOOL_STAT_LOCK_WAIT_BINS - 1) && wait_us >= bin_limit_us)
+    {
+        ++bin;
+        bin_limit_us *= 10;
+    }
+
+    ++lock->wait_count[bin];
+}
+
 bool bplib_mpool_lock_wait(bplib_mpool_lock_t *lock, uint64_t until_dtntime)
 {
     bool within_timeout;
     int  status;
 
-    within_timeout = (until_dtntime > bplib_os_get_dtntime_ms());
+    within_timeout = (until_dtntime > bplib_os_get_dtntime_coarse_ms());
     if (within_timeout)
     {
-        status = bplib_os_wait_until_ms(lock->lock_id, until_dtntime);
+#ifdef BPLIB_LOCK_PROFILE
+        bplib_mpool_lock_profile_suspend(&lock->hold);
+        status = bplib_os_mutex_wait_until_ms(lock->mutex, until_dtntime);
+        bplib_mpool_lock_profile_resume(&lock->hold);
+#else
+        status = bplib_os_mutex_wait_until_ms(lock->mutex, until_dtntime);
+#endif
         if (status == BP_TIMEOUT)
         {
             /* if timeout was returned, then assume that enough time has elapsed
@@ -114,6 +538,47 @@ bool bplib_mpool_lock_wait(bplib_mpool_lock_t *lock, uint64_t until_dtntime)
     return within_timeout;
 }
 
+bplib_mpool_wait_channel_t *bplib_mpool_wait_channel_prepare(void *condition_addr)
+{
+    return &BPLIB_MPOOL_WAIT_CHANNEL_SET[bplib_mpool_addr_hash(condition_addr, BPLIB_MPOOL_WAIT_CHANNEL_BITS)];
+}
+
+bool bplib_mpool_wait_channel_wait(bplib_mpool_lock_t *lock, bplib_mpool_wait_channel_t *channel,
+                                   uint64_t until_dtntime)
+{
+    bool within_timeout;
+    int  status;
+
+    within_timeout = (until_dtntime > bplib_os_get_dtntime_coarse_ms());
+    if (within_timeout)
+    {
+        /*
+         * The channel is locked before the resource lock is released, and a waker must hold
+         * the resource lock to get the channel lock.  So a wakeup cannot be sent in between
+         * releasing the resource and sleeping on the channel, where it would be missed.
+         */
+        bplib_os_mutex_lock(channel->mutex);
+        bplib_mpool_lock_release(lock);
+        status = bplib_os_mutex_wait_until_ms(channel->mutex, until_dtntime);
+        bplib_os_mutex_unlock(channel->mutex);
+        bplib_mpool_lock_acquire(lock);
+
+        if (status == BP_TIMEOUT)
+        {
+            /* as in bplib_mpool_lock_wait(), the caller should still check the condition */
+            within_timeout = false;
+        }
+    }
+
+    return within_timeout;
+}
+
+void bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_t *channel)
+{
+    bplib_os_mutex_lock(channel->mutex);
+    bplib_os_mutex_broadcast_and_unlock(channel->mutex);
+}
+
 bplib_mpool_block_t *bplib_mpool_block_from_external_id(bplib_mpool_t *pool, bp_handle_t handle)
 {
     bplib_mpool_block_admin_content_t *admin;
@@ -122,10 +587,16 @@ bplib_mpool_block_t *bplib_mpool_block_from_external_id(bplib_mpool_t *pool, bp_
 
     admin  = bplib_mpool_get_admin(pool);
     serial = bp_handle_to_serial(handle, BPLIB_HANDLE_MPOOL_BASE);
-    if (serial < admin->num_bufs_total)
+    if (serial > 0 && serial < admin->pool_extent)
     {
-        blk = &pool->admin_block;
-        blk += serial;
+        /* the serial number is the parent_offset of the block, in units of the block granule.
+         * As blocks of different size classes are not all the same size, not every value is
+         * the start of a block, so confirm that this points to one */
+        blk = (bplib_mpool_block_content_t *)(void *)((uint8_t *)pool + ((size_t)serial * BPLIB_MPOOL_BLOCK_GRANULE));
+        if (blk->header.base_link.parent_offset != serial)
+        {
+            blk = NULL;
+        }
     }
     else
     {
@@ -245,15 +716,99 @@ size_t bplib_mpool_get_user_data_offset_by_blocktype(bplib_mpool_blocktype_t bt)
  *-----------------------------------------------------------------*/
 size_t bplib_mpool_get_generic_data_capacity(const bplib_mpool_block_t *cb)
 {
-    size_t data_offset;
+    const bplib_mpool_block_content_t *block;
+    size_t                             data_offset;
+    size_t                             buffer_size;
+
+    block = bplib_mpool_get_block_content_const(cb);
+    if (block != NULL)
+    {
+        buffer_size = bplib_mpool_get_block_buffer_size(block);
+    }
+    else
+    {
+        buffer_size = sizeof(bplib_mpool_block_buffer_t);
+    }
 
     data_offset = bplib_mpool_get_user_data_offset_by_blocktype(cb->type);
-    if (data_offset > sizeof(bplib_mpool_block_buffer_t))
+    if (data_offset > buffer_size)
+    {
+        return 0;
+    }
+
+    return buffer_size - data_offset;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_size_class_capacity
+ *
+ *-----------------------------------------------------------------*/
+static inline size_t bplib_mpool_get_size_class_capacity(const bplib_mpool_size_class_t *sclass)
+{
+    return sclass->block_size - offsetof(bplib_mpool_block_content_t, u);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_size_class_contains
+ *
+ *-----------------------------------------------------------------*/
+static inline bool bplib_mpool_size_class_contains(const bplib_mpool_size_class_t *sclass, uint32_t parent_offset)
+{
+    return (parent_offset >= sclass->region_start && parent_offset < sclass->region_end);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_block_buffer_size
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_get_block_buffer_size(const bplib_mpool_block_content_t *block)
+{
+    const bplib_mpool_block_content_t       *admin_block;
+    const bplib_mpool_block_admin_content_t *admin;
+    uint32_t                                 offset;
+
+    /* blocks which are not part of a pool (offset 0) are always standard size */
+    offset = block->header.base_link.parent_offset;
+    if (offset != 0)
+    {
+        admin_block = (const bplib_mpool_block_content_t *)(const void *)((const uint8_t *)block -
+                                                                          ((size_t)offset * BPLIB_MPOOL_BLOCK_GRANULE));
+        if (admin_block->header.base_link.type == bplib_mpool_blocktype_admin)
+        {
+            admin = &admin_block->u.admin;
+            if (bplib_mpool_size_class_contains(&admin->small_class, offset))
+            {
+                return bplib_mpool_get_size_class_capacity(&admin->small_class);
+            }
+            if (bplib_mpool_size_class_contains(&admin->large_class, offset))
+            {
+                return bplib_mpool_get_size_class_capacity(&admin->large_class);
+            }
+        }
+    }
+
+    return sizeof(bplib_mpool_block_buffer_t);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_block_footprint
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_get_block_footprint(const bplib_mpool_block_t *cb)
+{
+    const bplib_mpool_block_content_t *block;
+
+    block = bplib_mpool_get_block_content_const(cb);
+    if (block == NULL)
     {
         return 0;
     }
 
-    return sizeof(bplib_mpool_block_buffer_t) - data_offset;
+    return offsetof(bplib_mpool_block_content_t, u) + bplib_mpool_get_block_buffer_size(block);
 }
 
 /*----------------------------------------------------------------
@@ -272,8 +827,9 @@ void bplib_mpool_init_secondary_link(bplib_mpool_block_t *base_block, bplib_mpoo
     }
     else
     {
+        /* the base block may be of the large class, see bplib_mpool_alloc_check_api() */
         offset = (uint8_t *)secondary_link - (uint8_t *)base_block;
-        assert(offset > 0 && offset < sizeof(bplib_mpool_block_content_t));
+        assert(offset > 0 && offset < (offsetof(bplib_mpool_block_content_t, u) + BP_MPOOL_LARGE_USER_BLOCK_SIZE));
     }
 
     bplib_mpool_link_reset(secondary_link, block_type, offset);
@@ -366,7 +922,7 @@ size_t bplib_mpool_get_user_content_size(const bplib_mpool_block_t *cb)
     block = bplib_mpool_get_block_content_const(cb);
     if (block != NULL)
     {
-        return block->header.user_content_length;
+        return block->header.base_link.user_content_length;
     }
     return 0;
 }
@@ -396,14 +952,17 @@ size_t bplib_mpool_read_refcount(const bplib_mpool_block_t *cb)
 bplib_mpool_t *bplib_mpool_get_parent_pool_from_link(bplib_mpool_block_t *cb)
 {
     bplib_mpool_block_content_t *block;
+    uint32_t                     offset;
 
     block = bplib_mpool_get_block_content(bplib_mpool_get_block_from_link(cb));
     if (block != NULL)
     {
         /* the "parent_offset" should provide a map back to the parent pool.
-         * in this context the units are blocks, not bytes (this extends the
-         * representable range for large pools, and simplifies this arithmetic) */
-        block -= block->header.base_link.parent_offset;
+         * in this context the units are the block granule, not bytes (this extends the
+         * representable range for large pools, while allowing blocks of different sizes) */
+        offset = block->header.base_link.parent_offset;
+        block  = (bplib_mpool_block_content_t *)(void *)((uint8_t *)block -
+                                                        ((size_t)offset * BPLIB_MPOOL_BLOCK_GRANULE));
 
         /* this should have always arrived at the admin block, which is the first block */
         assert(block->header.base_link.type == bplib_mpool_blocktype_admin);
@@ -490,38 +1049,63 @@ bplib_mpool_block_t *bplib_mpool_generic_data_uncast(void *blk, bplib_mpool_bloc
 void bplib_mpool_init_base_object(bplib_mpool_block_header_t *block_hdr, uint16_t user_content_length,
                                   uint32_t content_type_signature)
 {
-    block_hdr->user_content_length    = user_content_length;
-    block_hdr->content_type_signature = content_type_signature;
+    block_hdr->base_link.user_content_length = user_content_length;
+    block_hdr->content_type_signature        = content_type_signature;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_alloc_block_internal
+ * Function: bplib_mpool_get_free_block_count
  *
- * NOTE: this must be invoked with the lock already held
+ * Number of standard blocks available, including those not yet initialized.
  *-----------------------------------------------------------------*/
-bplib_mpool_block_content_t *bplib_mpool_alloc_block_internal(bplib_mpool_t *pool, bplib_mpool_blocktype_t blocktype,
-                                                              uint32_t content_type_signature, void *init_arg,
-                                                              uint8_t priority)
+static inline uint32_t bplib_mpool_get_free_block_count(bplib_mpool_block_admin_content_t *admin)
 {
-    bplib_mpool_block_t         *node;
-    bplib_mpool_block_content_t *block;
-    bplib_mpool_api_content_t   *api_block;
-    size_t                       data_offset;
-    uint32_t                     alloc_threshold;
-    uint32_t                     block_count;
+    return bplib_mpool_subq_get_depth(&admin->free_blocks) + admin->lazy_block_count;
+}
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_pull_free_block
+ *
+ * Gets a standard block from the free list.  Blocks that were used before are
+ * preferred, so that memory which was never touched can stay that way.
+ *
+ * NOTE: this must be invoked with the lock already held
+ *-----------------------------------------------------------------*/
+static bplib_mpool_block_t *bplib_mpool_pull_free_block(bplib_mpool_t *pool)
+{
     bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *pchunk;
+    bplib_mpool_block_t               *node;
 
     admin = bplib_mpool_get_admin(pool);
-
-    /* Only real blocks are allocated here - not secondary links nor head nodes,
-     * as those are embedded within the blocks themselves. */
-    if (blocktype == bplib_mpool_blocktype_undefined || blocktype >= bplib_mpool_blocktype_max)
+    node  = bplib_mpool_subq_pull_single(&admin->free_blocks);
+    if (node == NULL && admin->lazy_block_count != 0)
     {
-        return NULL;
+        /* This block is being used for the first time - the memory is already zero,
+         * only the link needs to be set up, as bplib_mpool_create() would have done */
+        pchunk = admin->lazy_next_block;
+        bplib_mpool_link_reset(&pchunk->header.base_link, bplib_mpool_blocktype_undefined,
+                               ((uint8_t *)pchunk - (uint8_t *)pool) / BPLIB_MPOOL_BLOCK_GRANULE);
+        ++admin->lazy_next_block;
+        --admin->lazy_block_count;
+        node = &pchunk->header.base_link;
     }
 
+    return node;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_alloc_check_threshold
+ *
+ *-----------------------------------------------------------------*/
+static inline bool bplib_mpool_alloc_check_threshold(bplib_mpool_block_admin_content_t *admin, uint32_t block_count,
+                                                     uint8_t priority)
+{
+    uint32_t alloc_threshold;
+
     /*
      * Check free block threshold: Note that it may take additional pool blocks (refs, cbor, etc)
      * in order to forward stored bundles along when the time comes.
@@ -533,54 +1117,94 @@ bplib_mpool_block_content_t *bplib_mpool_alloc_block_internal(bplib_mpool_t *poo
      */
     alloc_threshold = (admin->bblock_alloc_threshold * priority) / 255;
 
-    block_count = bplib_mpool_subq_get_depth(&admin->free_blocks);
-    if (block_count <= (admin->bblock_alloc_threshold - alloc_threshold))
-    {
+    return (block_count > (admin->bblock_alloc_threshold - alloc_threshold));
+}
 
-        /* no free blocks available for the requested type */
-        return NULL;
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_stats_count_alloc
+ *
+ *-----------------------------------------------------------------*/
+static inline void bplib_mpool_stats_count_alloc(bplib_mpool_block_admin_content_t *admin,
+                                                 bplib_mpool_blocktype_t blocktype, uint8_t priority)
+{
+    if (admin->stats != NULL)
+    {
+        bplib_mpool_stat_increment(&admin->stats->alloc_count[blocktype]);
+        bplib_mpool_stat_increment(&admin->stats->priority_alloc_count[priority >> 6]);
     }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_alloc_check_api
+ *
+ *-----------------------------------------------------------------*/
+static bool bplib_mpool_alloc_check_api(const bplib_mpool_block_admin_content_t *admin,
+                                        bplib_mpool_blocktype_t blocktype, const bplib_mpool_api_content_t *api_block)
+{
+    size_t data_offset;
+    size_t capacity;
 
-    /* figure out how to initialize this block by looking up the content type */
-    api_block = (bplib_mpool_api_content_t *)(void *)bplib_rbt_search_unique(content_type_signature,
-                                                                             &admin->blocktype_registry);
     if (api_block == NULL)
     {
         /* no constructor, cannot create the block! */
-        return NULL;
+        return false;
+    }
+
+    /* content that does not fit a standard block can still be put in a large one, if the pool has them */
+    capacity = sizeof(bplib_mpool_block_buffer_t);
+    if (admin->large_class.num_bufs_total != 0 && bplib_mpool_get_size_class_capacity(&admin->large_class) > capacity)
+    {
+        capacity = bplib_mpool_get_size_class_capacity(&admin->large_class);
     }
 
     /* sanity check that the user content will fit in the block */
     data_offset = bplib_mpool_get_user_data_offset_by_blocktype(blocktype);
-    if (data_offset > sizeof(bplib_mpool_block_buffer_t) ||
-        (data_offset + api_block->user_content_size) > sizeof(bplib_mpool_block_buffer_t))
+    if (data_offset > capacity || (data_offset + api_block->user_content_size) > capacity)
     {
         /* User content will not fit in the block - cannot create an instance of this type combo */
-        return NULL;
+        return false;
     }
 
-    /* get a block */
-    node = bplib_mpool_subq_pull_single(&admin->free_blocks);
-    if (node == NULL)
-    {
-        /* this should never happen, because depth was already checked */
-        return NULL;
-    }
+    return true;
+}
 
-    /*
-     * Convert from blocks free to blocks used, and update high watermark if necessary.
-     * This is +1 to include the block that was just pulled (that is, a call to
-     * bplib_mpool_subq_get_depth() on the free list now will return 1 fewer than it
-     * did earlier in this function).
-     */
-    block_count = 1 + admin->num_bufs_total - block_count;
-    if (block_count > admin->max_alloc_watermark)
-    {
-        admin->max_alloc_watermark = block_count;
-    }
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_alloc_needs_large
+ *
+ * Whether the fixed content of the block type is too big for a standard block,
+ * so only a block of the large class will do.
+ *-----------------------------------------------------------------*/
+static inline bool bplib_mpool_alloc_needs_large(bplib_mpool_blocktype_t          blocktype,
+                                                 const bplib_mpool_api_content_t *api_block)
+{
+    return (bplib_mpool_get_user_data_offset_by_blocktype(blocktype) + api_block->user_content_size) >
+           sizeof(bplib_mpool_block_buffer_t);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_alloc_init_content
+ *
+ * Initializes a block that was just taken from a free list.  This does not
+ * need the lock, as the block is not reachable by any other thread yet.
+ *-----------------------------------------------------------------*/
+static bplib_mpool_block_content_t *bplib_mpool_alloc_init_content(bplib_mpool_block_t *node,
+                                                                   bplib_mpool_blocktype_t blocktype,
+                                                                   uint32_t content_type_signature,
+                                                                   const bplib_mpool_api_content_t *api_block,
+                                                                   void                            *init_arg)
+{
+    bplib_mpool_block_content_t *block;
+    size_t                       data_offset;
+
+    data_offset = bplib_mpool_get_user_data_offset_by_blocktype(blocktype);
 
-    node->type = blocktype;
-    block      = bplib_mpool_get_block_content(node);
+    node->type           = blocktype;
+    node->registry_index = api_block->registry_index;
+    block                = bplib_mpool_get_block_content(node);
 
     /*
      * zero fill the content part first, this ensures that this is always done,
@@ -622,616 +1246,2807 @@ bplib_mpool_block_content_t *bplib_mpool_alloc_block_internal(bplib_mpool_t *poo
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_generic_data_alloc
+ * Function: bplib_mpool_alloc_select_class
  *
+ * Picks the size class for a new block, or returns NULL if a standard block should be used.
+ * Only size classes which currently have a free block are considered.
  *-----------------------------------------------------------------*/
-bplib_mpool_block_t *bplib_mpool_generic_data_alloc(bplib_mpool_t *pool, uint32_t magic_number, void *init_arg)
+static bplib_mpool_size_class_t *bplib_mpool_alloc_select_class(bplib_mpool_block_admin_content_t *admin,
+                                                                bplib_mpool_blocktype_t            blocktype,
+                                                                const bplib_mpool_api_content_t   *api_block,
+                                                                size_t                             size_hint)
 {
-    bplib_mpool_block_content_t *result;
-    bplib_mpool_lock_t          *lock;
+    size_t required_size;
 
-    lock   = bplib_mpool_lock_resource(pool);
-    result = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_generic, magic_number, init_arg,
-                                              BPLIB_MPOOL_ALLOC_PRI_MLO);
-    bplib_mpool_lock_release(lock);
+    if (size_hint > api_block->user_content_size)
+    {
+        required_size = size_hint;
+    }
+    else if (blocktype == bplib_mpool_blocktype_generic && api_block->user_content_size == 0)
+    {
+        /* generic data without a fixed size (such as CBOR data) is filled up to the capacity of
+         * the block by the user, without a hint this should get a standard block */
+        return NULL;
+    }
+    else
+    {
+        required_size = api_block->user_content_size;
+    }
 
-    return (bplib_mpool_block_t *)result;
-}
+    required_size += bplib_mpool_get_user_data_offset_by_blocktype(blocktype);
 
-/*----------------------------------------------------------------
- *
- * Function: bplib_mpool_recycle_block_internal
- *
- *-----------------------------------------------------------------*/
-void bplib_mpool_recycle_block_internal(bplib_mpool_t *pool, bplib_mpool_block_t *blk)
-{
-    bplib_mpool_block_admin_content_t *admin;
+    if (required_size <= bplib_mpool_get_size_class_capacity(&admin->small_class) &&
+        bplib_mpool_subq_get_depth(&admin->small_class.free_blocks) != 0)
+    {
+        return &admin->small_class;
+    }
 
-    admin = bplib_mpool_get_admin(pool);
+    /* a large block is used even if it does not hold all the data - it is still fewer blocks */
+    if (required_size > sizeof(bplib_mpool_block_buffer_t) &&
+        bplib_mpool_subq_get_depth(&admin->large_class.free_blocks) != 0)
+    {
+        return &admin->large_class;
+    }
 
-    bplib_mpool_extract_node(blk);
-    bplib_mpool_subq_push_single(&admin->recycle_blocks, blk);
+    return NULL;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_recycle_all_blocks_in_list
+ * Function: bplib_mpool_reserve_take
+ *
+ * Gets a block from the reserve entered by the calling thread, if it is
+ * a reserve of this pool and it has any left.
  *
+ * NOTE: this must be invoked with the lock already held
  *-----------------------------------------------------------------*/
-void bplib_mpool_recycle_all_blocks_in_list(bplib_mpool_t *pool, bplib_mpool_block_t *list)
+static bplib_mpool_block_t *bplib_mpool_reserve_take(bplib_mpool_t *pool)
 {
-    bplib_mpool_lock_t                *lock;
-    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_reserve_t *rsv;
+    bplib_mpool_block_t   *node;
 
-    /*
-     * If the pool was not specified, then attempt to deduce from the list pointer.
-     *
-     * List objects embedded within pool objects have breadcrumbs such that the parent pool
-     * pointer can be reconstituted.  However, if the list is NOT part of a pool object
-     * (e.g. a temporary list created on the stack, for instance) then this does not work.
-     */
-    if (pool == NULL)
+    rsv = bplib_mpool_get_active_reserve();
+    if (rsv == NULL || rsv->pool != pool || rsv->block_count == 0)
     {
-        pool = bplib_mpool_get_parent_pool_from_link(list);
+        return NULL;
     }
 
-    admin = bplib_mpool_get_admin(pool);
+    node = bplib_mpool_get_next_block(&rsv->block_list);
+    bplib_mpool_extract_node(node);
+    --rsv->block_count;
+    ++rsv->use_count;
 
-    assert(bplib_mpool_is_list_head(list));
-    lock = bplib_mpool_lock_resource(pool);
-    bplib_mpool_subq_merge_list(&admin->recycle_blocks, list);
-    bplib_mpool_lock_release(lock);
+    return node;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_recycle_block
+ * Function: bplib_mpool_alloc_sized_block_internal
  *
+ * NOTE: this must be invoked with the lock already held
  *-----------------------------------------------------------------*/
-void bplib_mpool_recycle_block(bplib_mpool_block_t *blk)
+bplib_mpool_block_content_t *bplib_mpool_alloc_sized_block_internal(bplib_mpool_t          *pool,
+                                                                    bplib_mpool_blocktype_t blocktype,
+                                                                    uint32_t content_type_signature, void *init_arg,
+                                                                    uint8_t priority, size_t size_hint)
 {
-    bplib_mpool_lock_t *lock;
-    bplib_mpool_t      *pool;
-
-    /* only real content blocks should be recycled.  No secondary links or components/members. */
-    assert(bplib_mpool_is_any_content_node(blk));
+    bplib_mpool_block_t       *node;
+    bplib_mpool_api_content_t *api_block;
+    bplib_mpool_size_class_t  *sclass;
+    uint32_t                   block_count;
 
-    pool = bplib_mpool_get_parent_pool_from_link(blk);
+    bplib_mpool_block_admin_content_t *admin;
 
-    lock = bplib_mpool_lock_resource(pool);
-    bplib_mpool_recycle_block_internal(pool, blk);
-    bplib_mpool_lock_release(lock);
-}
+    admin = bplib_mpool_get_admin(pool);
 
-/*----------------------------------------------------------------
- *
- * Function: bplib_mpool_list_iter_goto_first
- *
- *-----------------------------------------------------------------*/
-int bplib_mpool_list_iter_goto_first(const bplib_mpool_block_t *list, bplib_mpool_list_iter_t *iter)
-{
-    if (!bplib_mpool_is_list_head(list))
+    /* Only real blocks are allocated here - not secondary links nor head nodes,
+     * as those are embedded within the blocks themselves. */
+    if (blocktype == bplib_mpool_blocktype_undefined || blocktype >= bplib_mpool_blocktype_max)
     {
-        return BP_ERROR;
+        return NULL;
     }
 
-    iter->pending_entry = list->next;
-
-    return bplib_mpool_list_iter_forward(iter);
-}
+    /* figure out how to initialize this block by looking up the content type */
+    api_block = (bplib_mpool_api_content_t *)(void *)bplib_rbt_search_unique(content_type_signature,
+                                                                             &admin->blocktype_registry);
+    if (!bplib_mpool_alloc_check_api(admin, blocktype, api_block))
+    {
+        return NULL;
+    }
 
-/*----------------------------------------------------------------
- *
- * Function: bplib_mpool_list_iter_goto_last
- *
- *-----------------------------------------------------------------*/
-int bplib_mpool_list_iter_goto_last(const bplib_mpool_block_t *list, bplib_mpool_list_iter_t *iter)
-{
-    if (!bplib_mpool_is_list_head(list))
+    /*
+     * The small and large classes are not subject to the alloc threshold - the threshold
+     * protects the standard blocks, which can hold anything, and these are always tried first.
+     */
+    sclass = bplib_mpool_alloc_select_class(admin, blocktype, api_block, size_hint);
+    if (sclass != NULL)
     {
-        return BP_ERROR;
+        node = bplib_mpool_subq_pull_single(&sclass->free_blocks);
+        if (node != NULL)
+        {
+            bplib_mpool_stats_count_alloc(admin, blocktype, priority);
+            return bplib_mpool_alloc_init_content(node, blocktype, content_type_signature, api_block, init_arg);
+        }
     }
 
-    iter->pending_entry = list->prev;
+    /* the standard blocks and the reserve cannot hold this, and there is no large block free */
+    if (bplib_mpool_alloc_needs_large(blocktype, api_block))
+    {
+        if (admin->stats != NULL)
+        {
+            bplib_mpool_stat_increment(&admin->stats->alloc_refused_count);
+        }
+        BPLIB_TRACEPOINT(pool_alloc_fail, blocktype, priority, bplib_mpool_get_free_block_count(admin));
+        return NULL;
+    }
 
-    return bplib_mpool_list_iter_reverse(iter);
-}
+    block_count = bplib_mpool_get_free_block_count(admin);
+    if (!bplib_mpool_alloc_check_threshold(admin, block_count, priority))
+    {
+        /* the pool is too full for this, but the flow being run may have blocks set aside */
+        node = bplib_mpool_reserve_take(pool);
+        if (node != NULL)
+        {
+            bplib_mpool_stats_count_alloc(admin, blocktype, priority);
+            return bplib_mpool_alloc_init_content(node, blocktype, content_type_signature, api_block, init_arg);
+        }
 
-/*----------------------------------------------------------------
- *
- * Function: bplib_mpool_list_iter_forward
+        /* no free blocks available for the requested type */
+        if (admin->stats != NULL)
+        {
+            bplib_mpool_stat_increment(&admin->stats->alloc_refused_count);
+        }
+        BPLIB_TRACEPOINT(pool_alloc_fail, blocktype, priority, block_count);
+        return NULL;
+    }
+
+    /* get a block */
+    node = bplib_mpool_pull_free_block(pool);
+    if (node == NULL)
+    {
+        /* this should never happen, because depth was already checked */
+        return NULL;
+    }
+
+    /*
+     * Convert from blocks free to blocks used, and update high watermark if necessary.
+     * This is +1 to include the block that was just pulled (that is, a call to
+     * bplib_mpool_subq_get_depth() on the free list now will return 1 fewer than it
+     * did earlier in this function).
+     */
+    block_count = 1 + admin->num_bufs_total - block_count;
+    if (block_count > admin->max_alloc_watermark)
+    {
+        admin->max_alloc_watermark = block_count;
+    }
+
+    bplib_mpool_stats_count_alloc(admin, blocktype, priority);
+    return bplib_mpool_alloc_init_content(node, blocktype, content_type_signature, api_block, init_arg);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_alloc_block_internal
+ *
+ * NOTE: this must be invoked with the lock already held
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_content_t *bplib_mpool_alloc_block_internal(bplib_mpool_t *pool, bplib_mpool_blocktype_t blocktype,
+                                                              uint32_t content_type_signature, void *init_arg,
+                                                              uint8_t priority)
+{
+    return bplib_mpool_alloc_sized_block_internal(pool, blocktype, content_type_signature, init_arg, priority, 0);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_thread_cache_refill
  *
+ * Moves a batch of blocks from the pool free list into the thread cache.
+ * The pool lock is acquired here, once for the whole batch.
  *-----------------------------------------------------------------*/
-int bplib_mpool_list_iter_forward(bplib_mpool_list_iter_t *iter)
+static void bplib_mpool_thread_cache_refill(bplib_mpool_thread_cache_t *tc, uint8_t priority)
 {
-    if (iter->pending_entry == NULL || bplib_mpool_is_list_head(iter->pending_entry))
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_block_t               *node;
+    uint32_t                           block_count;
+
+    admin = bplib_mpool_get_admin(tc->pool);
+    lock  = bplib_mpool_lock_pool(tc->pool);
+
+    block_count = bplib_mpool_get_free_block_count(admin);
+    while (tc->block_count < BPLIB_MPOOL_THREAD_CACHE_BATCH &&
+           bplib_mpool_alloc_check_threshold(admin, block_count, priority))
     {
-        iter->position = NULL;
-        return BP_ERROR;
+        node = bplib_mpool_pull_free_block(tc->pool);
+        if (node == NULL)
+        {
+            break;
+        }
+
+        bplib_mpool_insert_before(&tc->block_list, node);
+        ++tc->block_count;
+        --block_count;
     }
 
-    iter->position      = iter->pending_entry;
-    iter->pending_entry = iter->position->next;
-    return BP_SUCCESS;
+    /* Blocks held in a thread cache count as used, as far as the pool is concerned */
+    block_count = admin->num_bufs_total - block_count;
+    if (block_count > admin->max_alloc_watermark)
+    {
+        admin->max_alloc_watermark = block_count;
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    ++tc->stats.refill_count;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_list_iter_reverse
+ * Function: bplib_mpool_thread_cache_drain
  *
+ * Returns blocks from the thread cache to the pool free list, until
+ * only the given number of blocks remain in the cache.
  *-----------------------------------------------------------------*/
-int bplib_mpool_list_iter_reverse(bplib_mpool_list_iter_t *iter)
+static void bplib_mpool_thread_cache_drain(bplib_mpool_thread_cache_t *tc, uint32_t keep_count)
 {
-    if (iter->pending_entry == NULL || bplib_mpool_is_list_head(iter->pending_entry))
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_block_t               *node;
+
+    admin = bplib_mpool_get_admin(tc->pool);
+    lock  = bplib_mpool_lock_pool(tc->pool);
+
+    while (tc->block_count > keep_count)
     {
-        iter->position = NULL;
-        return BP_ERROR;
+        /* take from the tail - the head holds the most recently freed (hottest) blocks */
+        node = bplib_mpool_get_prev_block(&tc->block_list);
+        bplib_mpool_extract_node(node);
+        bplib_mpool_subq_push_single(&admin->free_blocks, node);
+        --tc->block_count;
     }
 
-    iter->position      = iter->pending_entry;
-    iter->pending_entry = iter->position->prev;
-    return BP_SUCCESS;
+    bplib_mpool_lock_release(lock);
+
+    ++tc->stats.drain_count;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_foreach_item_in_list
+ * Function: bplib_mpool_thread_cache_alloc
  *
+ * Attempts to satisfy an allocation from the thread cache, without the pool lock.
+ * Returns NULL if the calling thread has no cache for this pool, or the cache
+ * could not supply a block.
  *-----------------------------------------------------------------*/
-int bplib_mpool_foreach_item_in_list(bplib_mpool_block_t *list, bool always_remove,
-                                     bplib_mpool_callback_func_t callback_fn, void *callback_arg)
+static bplib_mpool_block_content_t *bplib_mpool_thread_cache_alloc(bplib_mpool_t          *pool,
+                                                                   bplib_mpool_blocktype_t blocktype,
+                                                                   uint32_t content_type_signature, void *init_arg,
+                                                                   uint8_t priority)
 {
-    bplib_mpool_block_t *curr_node;
-    bplib_mpool_block_t *next_node;
-    int                  count;
+    bplib_mpool_thread_cache_t        *tc;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_block_t               *node;
+    uint32_t                           block_count;
+
+    tc = bplib_mpool_get_thread_cache();
+    if (tc == NULL || tc->pool != pool)
+    {
+        return NULL;
+    }
+
+    if (blocktype == bplib_mpool_blocktype_undefined || blocktype >= bplib_mpool_blocktype_max)
+    {
+        return NULL;
+    }
 
     /*
-     * Note: To handle the possibility that the callback removes the node
-     * from this list and puts it into another list, this needs to preemptively
-     * get the next node from this list before running the callback.
+     * The same threshold applies as for the pool free list, but blocks in this cache are
+     * also free.  Note the depth of the free list can be read without the lock, as it
+     * involves counter values which should be testable in an atomic fashion.
      */
-    next_node = list->next;
-    count     = 0;
-    while (next_node != list)
+    admin       = bplib_mpool_get_admin(pool);
+    block_count = bplib_mpool_get_free_block_count(admin) + tc->block_count;
+    if (!bplib_mpool_alloc_check_threshold(admin, block_count, priority))
     {
-        curr_node = next_node;
-        next_node = curr_node->next;
+        return NULL;
+    }
 
-        /*
-         * If always_remove is set, then take it out of this list before invoking the callback.
-         * The callback function must take responsibility for inserting the item into another list
-         */
-        if (always_remove)
+    /*
+     * The registry only changes at startup, and entries are never removed, so the api
+     * block for the last signature used can be kept here to avoid the lookup (and lock)
+     */
+    if (tc->api_block == NULL || tc->api_signature != content_type_signature)
+    {
+        lock = bplib_mpool_lock_pool(pool);
+        tc->api_block = (bplib_mpool_api_content_t *)(void *)bplib_rbt_search_unique(content_type_signature,
+                                                                                     &admin->blocktype_registry);
+        bplib_mpool_lock_release(lock);
+        tc->api_signature = content_type_signature;
+    }
+
+    if (!bplib_mpool_alloc_check_api(admin, blocktype, tc->api_block))
+    {
+        return NULL;
+    }
+
+    /* The cache only holds standard blocks, if this should be a small or a large block then
+     * the pool free list must be used instead */
+    if (bplib_mpool_alloc_needs_large(blocktype, tc->api_block) ||
+        bplib_mpool_alloc_select_class(admin, blocktype, tc->api_block, 0) != NULL)
+    {
+        return NULL;
+    }
+
+    if (tc->block_count == 0)
+    {
+        ++tc->stats.miss_count;
+        bplib_mpool_thread_cache_refill(tc, priority);
+        if (tc->block_count == 0)
         {
-            bplib_mpool_extract_node(curr_node);
+            return NULL;
         }
-
-        callback_fn(callback_arg, curr_node);
-        ++count;
+    }
+    else
+    {
+        ++tc->stats.hit_count;
     }
 
-    return count;
+    node = bplib_mpool_get_next_block(&tc->block_list);
+    bplib_mpool_extract_node(node);
+    --tc->block_count;
+
+    bplib_mpool_stats_count_alloc(admin, blocktype, priority);
+    return bplib_mpool_alloc_init_content(node, blocktype, content_type_signature, tc->api_block, init_arg);
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_search_list
+ * Function: bplib_mpool_alloc_block
  *
  *-----------------------------------------------------------------*/
-bplib_mpool_block_t *bplib_mpool_search_list(const bplib_mpool_block_t *list, bplib_mpool_callback_func_t match_fn,
-                                             void *match_arg)
+bplib_mpool_block_content_t *bplib_mpool_alloc_block(bplib_mpool_t *pool, bplib_mpool_blocktype_t blocktype,
+                                                     uint32_t content_type_signature, void *init_arg, uint8_t priority)
 {
-    int                     status;
-    bplib_mpool_list_iter_t iter;
-
-    memset(&iter, 0, sizeof(iter));
+    bplib_mpool_block_content_t *result;
+    bplib_mpool_lock_t          *lock;
 
-    status = bplib_mpool_list_iter_goto_first(list, &iter);
-    while (status == BP_SUCCESS)
+    result = bplib_mpool_thread_cache_alloc(pool, blocktype, content_type_signature, init_arg, priority);
+    if (result == NULL)
     {
-        /* this calls the match function with the actual content block, as that is where
-         * the real information lies (this is typically a list full of secondary links) */
-        if (match_fn(match_arg, bplib_mpool_get_block_from_link(iter.position)) == 0)
-        {
-            break;
-        }
-        status = bplib_mpool_list_iter_forward(&iter);
+        lock   = bplib_mpool_lock_pool(pool);
+        result = bplib_mpool_alloc_block_internal(pool, blocktype, content_type_signature, init_arg, priority);
+        bplib_mpool_lock_release(lock);
     }
 
-    /* the iterator sets position to NULL if end of list was reached */
-    return iter.position;
+    return result;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_register_blocktype_internal
+ * Function: bplib_mpool_get_local_partition
  *
  *-----------------------------------------------------------------*/
-int bplib_mpool_register_blocktype_internal(bplib_mpool_t *pool, uint32_t magic_number,
-                                            const bplib_mpool_blocktype_api_t *api, size_t user_content_size)
+bplib_mpool_t *bplib_mpool_get_local_partition(bplib_mpool_t *pool)
 {
-    bplib_mpool_block_content_t       *ablk;
-    bplib_mpool_api_content_t         *api_block;
-    int                                status;
     bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_thread_cache_t        *tc;
 
     admin = bplib_mpool_get_admin(pool);
-
-    /* before doing anything, check if this is a duplicate.  If so, ignore it.
-     * This permits "lazy binding" of apis where the blocktype is registered at the time of first use */
-    if (bplib_rbt_search_unique(magic_number, &admin->blocktype_registry) != NULL)
+    if (admin->partition_table == NULL)
     {
-        return BP_DUPLICATE;
+        return pool;
     }
 
-    ablk = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_api, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_LO);
-    if (ablk == NULL)
+    /* a thread with its cache attached to one of the partitions has been homed there */
+    tc = bplib_mpool_get_thread_cache();
+    if (tc != NULL && tc->pool != NULL &&
+        bplib_mpool_get_admin(tc->pool)->partition_table == admin->partition_table)
     {
-        return BP_ERROR;
+        return tc->pool;
     }
 
-    api_block = &ablk->u.api;
+    return admin->partition_table[bplib_os_get_cpu_index() % admin->num_partitions];
+}
 
-    if (api != NULL)
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_alloc_partition_block
+ *
+ *-----------------------------------------------------------------*/
+static bplib_mpool_block_content_t *bplib_mpool_alloc_partition_block(bplib_mpool_t          *pool,
+                                                                      bplib_mpool_blocktype_t blocktype,
+                                                                      uint32_t content_type_signature,
+                                                                      void *init_arg, uint8_t priority,
+                                                                      size_t size_hint)
+{
+    bplib_mpool_block_content_t *result;
+    bplib_mpool_lock_t          *lock;
+
+    /* the thread cache only holds standard blocks, so it is only useful without a size hint */
+    if (size_hint == 0)
     {
-        api_block->api = *api;
+        result = bplib_mpool_alloc_block(pool, blocktype, content_type_signature, init_arg, priority);
     }
-    api_block->user_content_size = user_content_size;
-
-    status = bplib_rbt_insert_value_unique(magic_number, &admin->blocktype_registry, &api_block->rbt_link);
-
-    /* due to the pre-check above this should always have been successful, but just in case, return the block if error
-     */
-    if (status != BP_SUCCESS)
+    else
     {
-        bplib_mpool_recycle_block_internal(pool, &ablk->header.base_link);
+        lock   = bplib_mpool_lock_pool(pool);
+        result = bplib_mpool_alloc_sized_block_internal(pool, blocktype, content_type_signature, init_arg, priority,
+                                                        size_hint);
+        bplib_mpool_lock_release(lock);
     }
 
-    return status;
+    return result;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_register_blocktype
+ * Function: bplib_mpool_alloc_local_block
  *
  *-----------------------------------------------------------------*/
-int bplib_mpool_register_blocktype(bplib_mpool_t *pool, uint32_t magic_number, const bplib_mpool_blocktype_api_t *api,
-                                   size_t user_content_size)
+bplib_mpool_block_content_t *bplib_mpool_alloc_local_block(bplib_mpool_t *pool, bplib_mpool_blocktype_t blocktype,
+                                                           uint32_t content_type_signature, void *init_arg,
+                                                           uint8_t priority, size_t size_hint)
 {
-    bplib_mpool_lock_t *lock;
-    int                 result;
+    bplib_mpool_block_content_t *result;
+    bplib_mpool_t               *local_pool;
+    bplib_mpool_t               *part;
+    uint32_t                     i;
+
+    local_pool = bplib_mpool_get_local_partition(pool);
+    result = bplib_mpool_alloc_partition_block(local_pool, blocktype, content_type_signature, init_arg, priority,
+                                               size_hint);
+
+    /* if the local partition is exhausted, any other partition will do */
+    for (i = 0; result == NULL && i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        part = bplib_mpool_get_partition(pool, i);
+        if (part != local_pool)
+        {
+            result = bplib_mpool_alloc_partition_block(part, blocktype, content_type_signature, init_arg, priority,
+                                                       size_hint);
+        }
+    }
 
-    lock   = bplib_mpool_lock_resource(pool);
-    result = bplib_mpool_register_blocktype_internal(pool, magic_number, api, user_content_size);
-    bplib_mpool_lock_release(lock);
     return result;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_collect_blocks
+ * Function: bplib_mpool_alloc_n
  *
  *-----------------------------------------------------------------*/
-uint32_t bplib_mpool_collect_blocks(bplib_mpool_t *pool, uint32_t limit)
+uint32_t bplib_mpool_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, uint32_t count,
+                             bplib_mpool_blocktype_t blocktype, uint32_t content_type_signature, void *init_arg,
+                             uint8_t priority)
 {
-    bplib_mpool_block_t               *rblk;
-    bplib_mpool_api_content_t         *api_block;
-    bplib_mpool_block_content_t       *content;
-    bplib_mpool_callback_func_t        destruct;
-    uint32_t                           count;
-    bplib_mpool_lock_t                *lock;
-    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t *blk;
+    bplib_mpool_lock_t          *lock;
+    uint32_t                     num_allocated;
 
-    admin = bplib_mpool_get_admin(pool);
+    assert(bplib_mpool_is_list_head(list));
 
-    count = 0;
-    lock  = bplib_mpool_lock_resource(pool);
-    while (count < limit)
+    num_allocated = 0;
+    lock          = bplib_mpool_lock_pool(pool);
+    while (num_allocated < count)
     {
-        rblk = bplib_mpool_subq_pull_single(&admin->recycle_blocks);
-        if (rblk == NULL)
+        blk = bplib_mpool_alloc_block_internal(pool, blocktype, content_type_signature, init_arg, priority);
+        if (blk == NULL)
         {
             break;
         }
 
-        /* recycled blocks must all be "real" blocks (not secondary refs or head nodes, etc) and
-         * have refcount of 0, or else bad things might happen */
-        content = bplib_mpool_get_block_content(rblk);
-        assert(content != NULL);
-        assert(content->header.refcount == 0);
+        bplib_mpool_insert_before(list, &blk->header.base_link);
+        ++num_allocated;
+    }
+    bplib_mpool_lock_release(lock);
 
-        /* figure out how to de-initialize the user content by looking up the content type */
-        api_block = (bplib_mpool_api_content_t *)(void *)bplib_rbt_search_unique(content->header.content_type_signature,
-                                                                                 &admin->blocktype_registry);
+    return num_allocated;
+}
 
-        if (api_block != NULL)
-        {
-            destruct = api_block->api.destruct;
-        }
-        else
-        {
-            destruct = NULL;
-        }
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_free_block_internal
+ *
+ * NOTE: this must be invoked with the lock already held
+ *-----------------------------------------------------------------*/
+void bplib_mpool_free_block_internal(bplib_mpool_t *pool, bplib_mpool_block_t *blk)
+{
+    bplib_mpool_thread_cache_t        *tc;
+    bplib_mpool_block_admin_content_t *admin;
 
-        /* pool should be UN-locked when invoking destructor */
-        bplib_mpool_lock_release(lock);
+    /* blocks of the other size classes go directly back to the free list of that class */
+    admin = bplib_mpool_get_admin(pool);
+    if (bplib_mpool_size_class_contains(&admin->small_class, blk->parent_offset))
+    {
+        bplib_mpool_subq_push_single(&admin->small_class.free_blocks, blk);
+        return;
+    }
+    if (bplib_mpool_size_class_contains(&admin->large_class, blk->parent_offset))
+    {
+        bplib_mpool_subq_push_single(&admin->large_class.free_blocks, blk);
+        return;
+    }
 
-        /* note that, like in C++, one cannot pass an arg to the destructor here.  It
-         * uses the same API/function pointer type, the arg will always be NULL. */
-        if (destruct != NULL)
+    tc = bplib_mpool_get_thread_cache();
+    if (tc != NULL && tc->pool == pool)
+    {
+        /* most recently freed blocks go at the head, they are the first to be reused */
+        bplib_mpool_insert_after(&tc->block_list, blk);
+        ++tc->block_count;
+
+        if (tc->block_count > BPLIB_MPOOL_THREAD_CACHE_DEPTH)
         {
-            destruct(NULL, rblk);
+            bplib_mpool_thread_cache_drain(tc, BPLIB_MPOOL_THREAD_CACHE_DEPTH - BPLIB_MPOOL_THREAD_CACHE_BATCH);
         }
+    }
+    else
+    {
+        bplib_mpool_subq_push_single(&admin->free_blocks, blk);
+    }
+}
 
-        /* now de-initialize the base content */
-        switch (rblk->type)
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_thread_cache_attach
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_thread_cache_attach(bplib_mpool_t *pool)
+{
+    bplib_mpool_thread_cache_t *tc;
+
+    tc = bplib_mpool_get_thread_cache();
+    if (tc == NULL || tc->pool == pool)
+    {
+        return;
+    }
+
+    /* a thread only caches blocks from one pool at a time */
+    bplib_mpool_thread_cache_detach();
+
+    memset(tc, 0, sizeof(*tc));
+    bplib_mpool_init_list_head(NULL, &tc->block_list);
+    tc->pool = pool;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_thread_cache_detach
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_thread_cache_detach(void)
+{
+    bplib_mpool_thread_cache_t *tc;
+
+    tc = bplib_mpool_get_thread_cache();
+    if (tc == NULL || tc->pool == NULL)
+    {
+        return;
+    }
+
+    if (tc->block_count > 0)
+    {
+        bplib_mpool_thread_cache_drain(tc, 0);
+    }
+
+    tc->pool      = NULL;
+    tc->api_block = NULL;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_thread_cache_get_stats
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_thread_cache_get_stats(bplib_mpool_thread_cache_stats_t *stats)
+{
+    bplib_mpool_thread_cache_t  *tc;
+    bplib_mpool_release_defer_t *rd;
+
+    tc = bplib_mpool_get_thread_cache();
+    rd = bplib_mpool_get_release_defer();
+    if (tc == NULL || rd == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+    else
+    {
+        *stats                   = tc->stats;
+        stats->defer_count       = rd->defer_count;
+        stats->defer_flush_count = rd->flush_count;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_init
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_reserve_init(bplib_mpool_block_t *base_block, bplib_mpool_reserve_t *rsv)
+{
+    memset(rsv, 0, sizeof(*rsv));
+    bplib_mpool_init_list_head(base_block, &rsv->block_list);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_fill
+ *
+ * Moves blocks from the pool free list into the reserve, until it has
+ * its target count or the free list is down to the given threshold.
+ *
+ * NOTE: this must be invoked with the lock already held
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_reserve_fill(bplib_mpool_reserve_t *rsv, uint32_t threshold)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_t               *node;
+    uint32_t                           block_count;
+
+    admin       = bplib_mpool_get_admin(rsv->pool);
+    block_count = bplib_mpool_get_free_block_count(admin);
+    while (rsv->block_count < rsv->target_count && block_count > threshold)
+    {
+        node = bplib_mpool_pull_free_block(rsv->pool);
+        if (node == NULL)
         {
-            case bplib_mpool_blocktype_canonical:
-            {
-                bplib_mpool_lock_acquire(lock);
-                bplib_mpool_subq_merge_list(&admin->recycle_blocks, &content->u.canonical.cblock.chunk_list);
-                bplib_mpool_lock_release(lock);
-                break;
-            }
-            case bplib_mpool_blocktype_primary:
-            {
-                bplib_mpool_lock_acquire(lock);
-                bplib_mpool_subq_merge_list(&admin->recycle_blocks, &content->u.primary.pblock.cblock_list);
-                bplib_mpool_subq_merge_list(&admin->recycle_blocks, &content->u.primary.pblock.chunk_list);
-                bplib_mpool_lock_release(lock);
-                break;
-            }
-            case bplib_mpool_blocktype_flow:
-            {
-                bplib_mpool_lock_acquire(lock);
-                bplib_mpool_subq_move_all(&admin->recycle_blocks, &content->u.flow.fblock.ingress.base_subq);
-                bplib_mpool_subq_move_all(&admin->recycle_blocks, &content->u.flow.fblock.egress.base_subq);
-                bplib_mpool_lock_release(lock);
-                break;
-            }
-            case bplib_mpool_blocktype_ref:
-            {
-                bplib_mpool_ref_release(content->u.ref.pref_target);
-                content->u.ref.pref_target = NULL; /* this ref is going away */
-                break;
-            }
-            default:
-            {
-                break;
-            }
+            break;
         }
 
-        // printf("DEBUG: %s() recycled block type %d\n", __func__, rblk->type);
-        ++count;
+        bplib_mpool_insert_before(&rsv->block_list, node);
+        ++rsv->block_count;
+        --block_count;
+    }
 
-        /* always return _this_ node to the free pile */
-        rblk->type = bplib_mpool_blocktype_undefined;
-        bplib_mpool_init_base_object(&content->header, 0, 0);
+    /* Blocks held in a reserve count as used, as far as the pool is concerned */
+    block_count = admin->num_bufs_total - block_count;
+    if (block_count > admin->max_alloc_watermark)
+    {
+        admin->max_alloc_watermark = block_count;
+    }
+}
 
-        bplib_mpool_lock_acquire(lock);
-        bplib_mpool_subq_push_single(&admin->free_blocks, rblk);
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_drain
+ *
+ * Returns blocks from the reserve to the pool free list, until it holds
+ * no more than its target count.
+ *
+ * NOTE: this must be invoked with the lock already held
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_reserve_drain(bplib_mpool_reserve_t *rsv)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_t               *node;
+
+    admin = bplib_mpool_get_admin(rsv->pool);
+    while (rsv->block_count > rsv->target_count)
+    {
+        node = bplib_mpool_get_prev_block(&rsv->block_list);
+        bplib_mpool_extract_node(node);
+        bplib_mpool_subq_push_single(&admin->free_blocks, node);
+        --rsv->block_count;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_set_target
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_reserve_set_target(bplib_mpool_t *pool, bplib_mpool_reserve_t *rsv, uint32_t target_count)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    uint32_t                           needed;
+    int                                status;
+
+    /* a reserve only holds blocks of one pool, so moving it drops all it had */
+    if (rsv->pool != NULL && rsv->pool != pool)
+    {
+        bplib_mpool_reserve_release(rsv);
+    }
+
+    admin  = bplib_mpool_get_admin(pool);
+    lock   = bplib_mpool_lock_pool(pool);
+    status = BP_SUCCESS;
+
+    /*
+     * The blocks for a new or bigger reserve must come from what is free above the bundle
+     * threshold, as the blocks under it are needed to get the stored bundles out again.
+     */
+    needed = 0;
+    if (target_count > rsv->block_count)
+    {
+        needed = target_count - rsv->block_count;
+    }
+
+    if (needed != 0 && bplib_mpool_get_free_block_count(admin) < (admin->bblock_alloc_threshold + needed))
+    {
+        status = BP_ERROR;
+    }
+    else
+    {
+        rsv->pool         = pool;
+        rsv->target_count = target_count;
+        bplib_mpool_reserve_fill(rsv, admin->bblock_alloc_threshold);
+        bplib_mpool_reserve_drain(rsv);
     }
 
     bplib_mpool_lock_release(lock);
 
-    return count;
+    return status;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_release
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_reserve_release(bplib_mpool_reserve_t *rsv)
+{
+    bplib_mpool_lock_t *lock;
+
+    if (rsv->pool == NULL)
+    {
+        return;
+    }
+
+    lock              = bplib_mpool_lock_pool(rsv->pool);
+    rsv->target_count = 0;
+    bplib_mpool_reserve_drain(rsv);
+    bplib_mpool_lock_release(lock);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_enter
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_reserve_t *bplib_mpool_reserve_enter(bplib_mpool_reserve_t *rsv)
+{
+#ifdef BPLIB_MPOOL_THREAD_LOCAL
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_reserve_t             *prev;
+
+    /*
+     * The blocks that were used go back to the pool free list when they are recycled, like
+     * any others, so this is where they are taken back.  This can go down to the internal
+     * threshold, as these blocks were already given to the reserve once.  The count is
+     * read without the lock first, as usually the reserve was not used since last time.
+     */
+    if (rsv != NULL && rsv->pool != NULL && rsv->block_count < rsv->target_count)
+    {
+        admin = bplib_mpool_get_admin(rsv->pool);
+        lock  = bplib_mpool_lock_pool(rsv->pool);
+        bplib_mpool_reserve_fill(rsv, admin->internal_alloc_threshold);
+        bplib_mpool_lock_release(lock);
+    }
+
+    prev                       = BPLIB_MPOOL_ACTIVE_RESERVE;
+    BPLIB_MPOOL_ACTIVE_RESERVE = rsv;
+
+    return prev;
+#else
+    /* no thread-local storage on this toolchain, so a reserve cannot be entered */
+    return NULL;
+#endif
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reserve_leave
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_reserve_leave(bplib_mpool_reserve_t *prev)
+{
+#ifdef BPLIB_MPOOL_THREAD_LOCAL
+    BPLIB_MPOOL_ACTIVE_RESERVE = prev;
+#endif
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_generic_data_alloc
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_generic_data_alloc(bplib_mpool_t *pool, uint32_t magic_number, void *init_arg)
+{
+    bplib_mpool_block_content_t *result;
+
+    result = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, magic_number, init_arg,
+                                     BPLIB_MPOOL_ALLOC_PRI_MLO);
+
+    return (bplib_mpool_block_t *)result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_generic_data_alloc_n
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_generic_data_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, uint32_t count,
+                                          uint32_t magic_number, void *init_arg)
+{
+    return bplib_mpool_alloc_n(pool, list, count, bplib_mpool_blocktype_generic, magic_number, init_arg,
+                               BPLIB_MPOOL_ALLOC_PRI_MLO);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_recycle_block_internal
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_recycle_block_internal(bplib_mpool_t *pool, bplib_mpool_block_t *blk)
+{
+    bplib_mpool_block_admin_content_t *admin;
+
+    admin = bplib_mpool_get_admin(pool);
+
+    bplib_mpool_extract_node(blk);
+    bplib_mpool_subq_push_single(&admin->recycle_blocks, blk);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_recycle_all_blocks_in_list
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_recycle_all_blocks_in_list(bplib_mpool_t *pool, bplib_mpool_block_t *list)
+{
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_block_admin_content_t *admin;
+
+    /*
+     * If the pool was not specified, then attempt to deduce from the list pointer.
+     *
+     * List objects embedded within pool objects have breadcrumbs such that the parent pool
+     * pointer can be reconstituted.  However, if the list is NOT part of a pool object
+     * (e.g. a temporary list created on the stack, for instance) then this does not work.
+     */
+    if (pool == NULL)
+    {
+        pool = bplib_mpool_get_parent_pool_from_link(list);
+    }
+
+    admin = bplib_mpool_get_admin(pool);
+
+    assert(bplib_mpool_is_list_head(list));
+    lock = bplib_mpool_lock_pool(pool);
+    bplib_mpool_subq_merge_list(&admin->recycle_blocks, list);
+    bplib_mpool_lock_release(lock);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_release_defer_flush
+ *
+ * Gives the deferred blocks of the calling thread to the pool recycle list
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_release_defer_flush(bplib_mpool_release_defer_t *rd)
+{
+    if (rd->block_count != 0)
+    {
+        bplib_mpool_recycle_all_blocks_in_list(rd->pool, &rd->block_list);
+        rd->block_count = 0;
+        ++rd->flush_count;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_release_defer_begin
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_release_defer_begin(bplib_mpool_t *pool)
+{
+    bplib_mpool_release_defer_t *rd;
+
+    rd = bplib_mpool_get_release_defer();
+    if (rd == NULL)
+    {
+        return;
+    }
+
+    if (rd->depth == 0)
+    {
+        bplib_mpool_init_list_head(NULL, &rd->block_list);
+        rd->block_count = 0;
+        rd->pool        = pool;
+    }
+    ++rd->depth;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_release_defer_end
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_release_defer_end(void)
+{
+    bplib_mpool_release_defer_t *rd;
+
+    rd = bplib_mpool_get_release_defer();
+    if (rd == NULL || rd->depth == 0)
+    {
+        return;
+    }
+
+    --rd->depth;
+    if (rd->depth == 0)
+    {
+        bplib_mpool_release_defer_flush(rd);
+        rd->pool = NULL;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_recycle_block
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_recycle_block(bplib_mpool_block_t *blk)
+{
+    bplib_mpool_lock_t          *lock;
+    bplib_mpool_t               *pool;
+    bplib_mpool_release_defer_t *rd;
+
+    /* only real content blocks should be recycled.  No secondary links or components/members. */
+    assert(bplib_mpool_is_any_content_node(blk));
+
+    pool = bplib_mpool_get_parent_pool_from_link(blk);
+
+    /* nobody else has the block by now, so it can wait on a list of this thread without the lock */
+    rd = bplib_mpool_get_release_defer();
+    if (rd != NULL && rd->pool == pool)
+    {
+        bplib_mpool_extract_node(blk);
+        bplib_mpool_insert_before(&rd->block_list, blk);
+        ++rd->block_count;
+        ++rd->defer_count;
+
+        if (rd->block_count >= BPLIB_MPOOL_RELEASE_DEFER_LIMIT)
+        {
+            bplib_mpool_release_defer_flush(rd);
+        }
+        return;
+    }
+
+    lock = bplib_mpool_lock_pool(pool);
+    bplib_mpool_recycle_block_internal(pool, blk);
+    bplib_mpool_lock_release(lock);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_list_iter_goto_first
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_list_iter_goto_first(const bplib_mpool_block_t *list, bplib_mpool_list_iter_t *iter)
+{
+    if (!bplib_mpool_is_list_head(list))
+    {
+        return BP_ERROR;
+    }
+
+    iter->pending_entry = list->next;
+
+    return bplib_mpool_list_iter_forward(iter);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_list_iter_goto_last
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_list_iter_goto_last(const bplib_mpool_block_t *list, bplib_mpool_list_iter_t *iter)
+{
+    if (!bplib_mpool_is_list_head(list))
+    {
+        return BP_ERROR;
+    }
+
+    iter->pending_entry = list->prev;
+
+    return bplib_mpool_list_iter_reverse(iter);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_list_iter_forward
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_list_iter_forward(bplib_mpool_list_iter_t *iter)
+{
+    if (iter->pending_entry == NULL || bplib_mpool_is_list_head(iter->pending_entry))
+    {
+        iter->position = NULL;
+        return BP_ERROR;
+    }
+
+    iter->position      = iter->pending_entry;
+    iter->pending_entry = iter->position->next;
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_list_iter_reverse
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_list_iter_reverse(bplib_mpool_list_iter_t *iter)
+{
+    if (iter->pending_entry == NULL || bplib_mpool_is_list_head(iter->pending_entry))
+    {
+        iter->position = NULL;
+        return BP_ERROR;
+    }
+
+    iter->position      = iter->pending_entry;
+    iter->pending_entry = iter->position->prev;
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_foreach_item_in_list
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_foreach_item_in_list(bplib_mpool_block_t *list, bool always_remove,
+                                     bplib_mpool_callback_func_t callback_fn, void *callback_arg)
+{
+    bplib_mpool_block_t *curr_node;
+    bplib_mpool_block_t *next_node;
+    int                  count;
+
+    /*
+     * Note: To handle the possibility that the callback removes the node
+     * from this list and puts it into another list, this needs to preemptively
+     * get the next node from this list before running the callback.
+     */
+    next_node = list->next;
+    count     = 0;
+    while (next_node != list)
+    {
+        curr_node = next_node;
+        next_node = curr_node->next;
+
+        /*
+         * If always_remove is set, then take it out of this list before invoking the callback.
+         * The callback function must take responsibility for inserting the item into another list
+         */
+        if (always_remove)
+        {
+            bplib_mpool_extract_node(curr_node);
+        }
+
+        callback_fn(callback_arg, curr_node);
+        ++count;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_search_list
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_search_list(const bplib_mpool_block_t *list, bplib_mpool_callback_func_t match_fn,
+                                             void *match_arg)
+{
+    int                     status;
+    bplib_mpool_list_iter_t iter;
+
+    memset(&iter, 0, sizeof(iter));
+
+    status = bplib_mpool_list_iter_goto_first(list, &iter);
+    while (status == BP_SUCCESS)
+    {
+        /* this calls the match function with the actual content block, as that is where
+         * the real information lies (this is typically a list full of secondary links) */
+        if (match_fn(match_arg, bplib_mpool_get_block_from_link(iter.position)) == 0)
+        {
+            break;
+        }
+        status = bplib_mpool_list_iter_forward(&iter);
+    }
+
+    /* the iterator sets position to NULL if end of list was reached */
+    return iter.position;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_registry_index_add
+ *
+ * Adds a registry entry to the dense index table, if there is room.
+ * NOTE: this must be invoked with the lock already held
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_registry_index_add(bplib_mpool_block_admin_content_t *admin,
+                                           bplib_mpool_api_content_t         *api_block)
+{
+    if (admin->registry_index != NULL && admin->registry_index_count < BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES)
+    {
+        api_block->registry_index                         = admin->registry_index_count;
+        admin->registry_index[admin->registry_index_count] = api_block;
+        ++admin->registry_index_count;
+    }
+    else
+    {
+        api_block->registry_index = BPLIB_MPOOL_REGISTRY_INDEX_NONE;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_registry_lookup_block_api
+ *
+ * Finds the registry entry for an allocated block.  This is normally just an index
+ * into the table, but if the blocktype is not indexed, the registry is searched.
+ *-----------------------------------------------------------------*/
+static bplib_mpool_api_content_t *bplib_mpool_registry_lookup_block_api(bplib_mpool_block_admin_content_t *admin,
+                                                                        bplib_mpool_block_content_t       *content)
+{
+    uint8_t idx;
+
+    idx = content->header.base_link.registry_index;
+    if (idx < admin->registry_index_count)
+    {
+        return admin->registry_index[idx];
+    }
+
+    return (bplib_mpool_api_content_t *)(void *)bplib_rbt_search_unique(content->header.content_type_signature,
+                                                                       &admin->blocktype_registry);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_register_blocktype_internal
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_register_blocktype_internal(bplib_mpool_t *pool, uint32_t magic_number,
+                                            const bplib_mpool_blocktype_api_t *api, size_t user_content_size)
+{
+    bplib_mpool_block_content_t       *ablk;
+    bplib_mpool_api_content_t         *api_block;
+    int                                status;
+    bplib_mpool_block_admin_content_t *admin;
+
+    admin = bplib_mpool_get_admin(pool);
+
+    /* before doing anything, check if this is a duplicate.  If so, ignore it.
+     * This permits "lazy binding" of apis where the blocktype is registered at the time of first use */
+    if (bplib_rbt_search_unique(magic_number, &admin->blocktype_registry) != NULL)
+    {
+        return BP_DUPLICATE;
+    }
+
+    ablk = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_api, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_LO);
+    if (ablk == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    api_block = &ablk->u.api;
+
+    if (api != NULL)
+    {
+        api_block->api = *api;
+    }
+    api_block->user_content_size = user_content_size;
+
+    status = bplib_rbt_insert_value_unique(magic_number, &admin->blocktype_registry, &api_block->rbt_link);
+
+    /* due to the pre-check above this should always have been successful, but just in case, return the block if error
+     */
+    if (status != BP_SUCCESS)
+    {
+        bplib_mpool_recycle_block_internal(pool, &ablk->header.base_link);
+    }
+    else
+    {
+        bplib_mpool_registry_index_add(admin, api_block);
+    }
+
+    return status;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_register_blocktype
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_register_blocktype(bplib_mpool_t *pool, uint32_t magic_number, const bplib_mpool_blocktype_api_t *api,
+                                   size_t user_content_size)
+{
+    bplib_mpool_lock_t *lock;
+    bplib_mpool_t      *part;
+    int                 result;
+    int                 status;
+    uint32_t            i;
+
+    /*
+     * A block may be allocated from any partition, so every partition needs the same registry.
+     * As they are all registered in the same order, the index of each entry is also the same.
+     * The result is from the first partition, the others should always match it.
+     */
+    result = BP_ERROR;
+    for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        part   = bplib_mpool_get_partition(pool, i);
+        lock   = bplib_mpool_lock_pool(part);
+        status = bplib_mpool_register_blocktype_internal(part, magic_number, api, user_content_size);
+        bplib_mpool_lock_release(lock);
+
+        if (i == 0)
+        {
+            result = status;
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_collect_blocks
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_collect_blocks(bplib_mpool_t *pool, uint32_t limit)
+{
+    return bplib_mpool_collect_blocks_timed(pool, limit, BP_DTNTIME_INFINITE);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_collect_blocks_timed
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_collect_blocks_timed(bplib_mpool_t *pool, uint32_t limit, uint64_t until_dtntime)
+{
+    bplib_mpool_block_t               *rblk;
+    bplib_mpool_api_content_t         *api_block;
+    bplib_mpool_block_content_t       *content;
+    bplib_mpool_callback_func_t        destruct;
+    uint32_t                           count;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_t                foreign_list;
+
+    admin = bplib_mpool_get_admin(pool);
+    bplib_mpool_init_list_head(NULL, &foreign_list);
+
+    count = 0;
+    lock  = bplib_mpool_lock_pool(pool);
+    while (count < limit)
+    {
+        /* the clock is only checked once per batch, but always after at least one batch */
+        if (until_dtntime != BP_DTNTIME_INFINITE && count != 0 && (count % BPLIB_MPOOL_COLLECT_BATCH_SIZE) == 0 &&
+            bplib_os_get_dtntime_coarse_ms() >= until_dtntime)
+        {
+            break;
+        }
+
+        rblk = bplib_mpool_subq_pull_single(&admin->recycle_blocks);
+        if (rblk == NULL)
+        {
+            break;
+        }
+
+        /* recycled blocks must all be "real" blocks (not secondary refs or head nodes, etc) and
+         * have refcount of 0, or else bad things might happen */
+        content = bplib_mpool_get_block_content(rblk);
+        assert(content != NULL);
+        assert(content->header.refcount == 0);
+
+        /* In a partitioned pool, the sub-lists of a block may contain blocks of a different
+         * partition.  Those must be destructed and freed by their own partition, so they are
+         * set aside here and moved to the correct recycle list once this lock is released. */
+        if (admin->partition_table != NULL && bplib_mpool_get_parent_pool_from_link(rblk) != pool)
+        {
+            bplib_mpool_insert_before(&foreign_list, rblk);
+            ++count;
+            continue;
+        }
+
+        /* figure out how to de-initialize the user content by looking up the content type */
+        api_block = bplib_mpool_registry_lookup_block_api(admin, content);
+
+        if (api_block != NULL)
+        {
+            destruct = api_block->api.destruct;
+        }
+        else
+        {
+            destruct = NULL;
+        }
+
+        /* pool should be UN-locked when invoking destructor */
+        bplib_mpool_lock_release(lock);
+
+        /* note that, like in C++, one cannot pass an arg to the destructor here.  It
+         * uses the same API/function pointer type, the arg will always be NULL. */
+        if (destruct != NULL)
+        {
+            destruct(NULL, rblk);
+        }
+
+        /* now de-initialize the base content */
+        switch (rblk->type)
+        {
+            case bplib_mpool_blocktype_canonical:
+            {
+                bplib_mpool_lock_acquire(lock);
+                bplib_mpool_subq_merge_list(&admin->recycle_blocks, &content->u.canonical.cblock.chunk_list);
+                bplib_mpool_lock_release(lock);
+                break;
+            }
+            case bplib_mpool_blocktype_primary:
+            {
+                bplib_mpool_lock_acquire(lock);
+                bplib_mpool_subq_merge_list(&admin->recycle_blocks, &content->u.primary.pblock.cblock_list);
+                bplib_mpool_subq_merge_list(&admin->recycle_blocks, &content->u.primary.pblock.chunk_list);
+                bplib_mpool_lock_release(lock);
+                bplib_mpool_ref_release(content->u.primary.pblock.data.delivery.trace_ref);
+                content->u.primary.pblock.data.delivery.trace_ref = NULL;
+                bplib_mpool_ref_release(content->u.primary.pblock.data.delivery.completion_ref);
+                content->u.primary.pblock.data.delivery.completion_ref = NULL;
+                bplib_mpool_bblock_primary_quota_release(&content->u.primary.pblock);
+                break;
+            }
+            case bplib_mpool_blocktype_flow:
+            {
+                bplib_mpool_lock_acquire(lock);
+                bplib_mpool_subq_ring_detach_all(&admin->recycle_blocks, &content->u.flow.fblock.ingress);
+                bplib_mpool_subq_ring_detach_all(&admin->recycle_blocks, &content->u.flow.fblock.egress);
+                bplib_mpool_subq_bands_detach_all(&admin->recycle_blocks, &content->u.flow.fblock.ingress);
+                bplib_mpool_subq_bands_detach_all(&admin->recycle_blocks, &content->u.flow.fblock.egress);
+                bplib_mpool_subq_move_all(&admin->recycle_blocks, &content->u.flow.fblock.ingress.base_subq);
+                bplib_mpool_subq_move_all(&admin->recycle_blocks, &content->u.flow.fblock.egress.base_subq);
+                bplib_mpool_lock_release(lock);
+                bplib_mpool_subq_detach_notifier(&content->u.flow.fblock.ingress);
+                bplib_mpool_subq_detach_notifier(&content->u.flow.fblock.egress);
+                bplib_mpool_reserve_release(&content->u.flow.fblock.reserve);
+                break;
+            }
+            case bplib_mpool_blocktype_ref:
+            {
+                bplib_mpool_ref_release(content->u.ref.pref_target);
+                content->u.ref.pref_target = NULL; /* this ref is going away */
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+
+        // printf("DEBUG: %s() recycled block type %d\n", __func__, rblk->type);
+        ++count;
+
+        if (admin->stats != NULL && rblk->type < bplib_mpool_blocktype_max)
+        {
+            bplib_mpool_stat_increment(&admin->stats->free_count[rblk->type]);
+        }
+
+        /* always return _this_ node to the free pile */
+        rblk->type = bplib_mpool_blocktype_undefined;
+        bplib_mpool_init_base_object(&content->header, 0, 0);
+
+        bplib_mpool_lock_acquire(lock);
+        bplib_mpool_free_block_internal(pool, rblk);
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    while (!bplib_mpool_is_empty_list_head(&foreign_list))
+    {
+        bplib_mpool_recycle_block(bplib_mpool_get_next_block(&foreign_list));
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_inspect_age_bin
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_inspect_age_bin(uint64_t age_ms)
+{
+    uint64_t age_sec;
+    uint32_t bin;
+
+    /* bin 0 is under 1 second, then bin N is from 2^(N-1) up to 2^N seconds */
+    age_sec = age_ms / 1000;
+    bin     = 0;
+    while (age_sec != 0 && bin < (BPLIB_MPOOL_INSPECT_AGE_BINS - 1))
+    {
+        age_sec >>= 1;
+        ++bin;
+    }
+
+    return bin;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_inspect_block
+ *
+ * Adds one block to the histograms, a NULL block is one that has never been used
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_inspect_block(bplib_mpool_inspection_t *hist, const bplib_mpool_block_content_t *pchunk,
+                                      uint64_t now)
+{
+    uint8_t      type;
+    uint32_t     refcount;
+    bp_dtntime_t created;
+
+    if (pchunk == NULL)
+    {
+        ++hist->by_type[bplib_mpool_blocktype_undefined];
+        ++hist->by_state[bplib_mpool_inspect_state_free];
+        return;
+    }
+
+    type = pchunk->header.base_link.type;
+    if (type >= bplib_mpool_blocktype_max)
+    {
+        /* not a valid block, bplib_mpool_debug_scan() is the way to look into this */
+        return;
+    }
+
+    ++hist->by_type[type];
+
+    refcount = pchunk->header.refcount;
+    if (type == bplib_mpool_blocktype_undefined)
+    {
+        ++hist->by_state[bplib_mpool_inspect_state_free];
+    }
+    else if (refcount == 0)
+    {
+        ++hist->by_state[bplib_mpool_inspect_state_unreferenced];
+    }
+    else if (refcount == 1)
+    {
+        ++hist->by_state[bplib_mpool_inspect_state_single];
+    }
+    else
+    {
+        ++hist->by_state[bplib_mpool_inspect_state_shared];
+    }
+
+    if (type == bplib_mpool_blocktype_generic &&
+        pchunk->header.base_link.registry_index < BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES)
+    {
+        ++hist->blocktype_count[pchunk->header.base_link.registry_index];
+    }
+    else if (type == bplib_mpool_blocktype_primary)
+    {
+        /* a bundle made without a clock has no creation time, so its age is not known */
+        created = pchunk->u.primary.pblock.data.logical.creationTimeStamp.time;
+        if (created != 0)
+        {
+            ++hist->bundle_age[bplib_mpool_inspect_age_bin((now > created) ? (now - created) : 0)];
+        }
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_inspect_partition
+ *
+ * The blocks of a partition are numbered with the standard blocks first, then the
+ * small class and then the large class.  This stops at the end of the partition.
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_inspect_partition(bplib_mpool_t *pool, bplib_mpool_inspector_t *insp, uint32_t limit,
+                                              uint64_t now)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_size_class_t          *sclass;
+    bplib_mpool_block_content_t       *pchunk;
+    size_t                             offset;
+    uint32_t                           total;
+    uint32_t                           pos;
+    uint32_t                           count;
+
+    admin = bplib_mpool_get_admin(pool);
+    total = admin->num_bufs_total + admin->small_class.num_bufs_total + admin->large_class.num_bufs_total;
+    count = 0;
+
+    lock = bplib_mpool_lock_pool(pool);
+    while (count < limit && insp->position < total)
+    {
+        pos = insp->position;
+        if (pos < admin->num_bufs_total)
+        {
+            /* note the admin block is not counted in num_bufs_total */
+            pchunk = &pool->admin_block + 1 + pos;
+            if (admin->lazy_block_count != 0 && pchunk >= admin->lazy_next_block)
+            {
+                pchunk = NULL;
+            }
+        }
+        else
+        {
+            pos -= admin->num_bufs_total;
+            sclass = &admin->small_class;
+            if (pos >= sclass->num_bufs_total)
+            {
+                pos -= sclass->num_bufs_total;
+                sclass = &admin->large_class;
+            }
+            offset = ((size_t)sclass->region_start * BPLIB_MPOOL_BLOCK_GRANULE) + ((size_t)pos * sclass->block_size);
+            pchunk = (bplib_mpool_block_content_t *)(void *)((uint8_t *)pool + offset);
+        }
+
+        bplib_mpool_inspect_block(&insp->work, pchunk, now);
+        ++insp->position;
+        ++count;
+    }
+    bplib_mpool_lock_release(lock);
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_inspect_step
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_inspect_step(bplib_mpool_t *pool, bplib_mpool_inspector_t *insp, uint32_t limit)
+{
+    bplib_mpool_lock_t *lock;
+    uint64_t            now;
+    uint32_t            count;
+    uint32_t            passes;
+
+    now   = bplib_os_get_dtntime_coarse_ms();
+    count = 0;
+    while (count < limit)
+    {
+        if (insp->partition < bplib_mpool_get_num_partitions(pool))
+        {
+            count += bplib_mpool_inspect_partition(bplib_mpool_get_partition(pool, insp->partition), insp,
+                                                   limit - count, now);
+            if (count == limit)
+            {
+                break;
+            }
+
+            /* that partition is done */
+            ++insp->partition;
+            insp->position = 0;
+        }
+        else
+        {
+            /* this is under the lock of the pool as a whole, which is what bplib_mpool_inspect_get() takes */
+            lock   = bplib_mpool_lock_pool(pool);
+            passes = insp->last.passes + 1;
+
+            insp->last        = insp->work;
+            insp->last.passes = passes;
+            bplib_mpool_lock_release(lock);
+
+            memset(&insp->work, 0, sizeof(insp->work));
+            insp->partition = 0;
+            break;
+        }
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_inspect_get
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_inspect_get(bplib_mpool_t *pool, const bplib_mpool_inspector_t *insp,
+                             bplib_mpool_inspection_t *result)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_lock_t                *lock;
+    uint32_t                           i;
+
+    lock    = bplib_mpool_lock_pool(pool);
+    *result = insp->last;
+    bplib_mpool_lock_release(lock);
+
+    /* the blocktypes are registered in the same order in all partitions, so the first one has them all */
+    admin = bplib_mpool_get_admin(pool);
+    for (i = 0; i < admin->registry_index_count && i < BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES; ++i)
+    {
+        result->blocktype_magic[i] = (uint32_t)bplib_rbt_get_key_value(&admin->registry_index[i]->rbt_link);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_maintain_partition
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_maintain_partition(bplib_mpool_t *pool)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_stats_t               *stats;
+
+    admin = bplib_mpool_get_admin(pool);
+
+    /* the depth is sampled before collecting, as this is the low point of the cycle */
+    stats = admin->stats;
+    if (stats != NULL)
+    {
+        stats->free_depth_history[stats->free_depth_pos % BPLIB_MPOOL_STAT_DEPTH_SAMPLES] =
+            bplib_mpool_get_free_block_count(admin);
+        ++stats->free_depth_pos;
+    }
+
+    /* the check for non-empty list can be done unlocked, as it
+     * involves counter values which should be testable in an atomic fashion.
+     * note this isn't final - Subq will be re-checked after locking, if this is true */
+    if (bplib_mpool_subq_get_depth(&admin->recycle_blocks) != 0)
+    {
+        if (bplib_mpool_get_free_block_count(admin) < admin->bblock_alloc_threshold)
+        {
+            /* Memory is low enough that bundle allocations are being refused, so the
+             * pause is not as important as getting those blocks back - collect everything,
+             * including the blocks which are released as a result of this collection */
+            bplib_mpool_collect_blocks(pool, UINT32_MAX);
+        }
+        else
+        {
+            bplib_mpool_collect_blocks_timed(pool, BPLIB_MPOOL_MAINTENCE_COLLECT_LIMIT,
+                                             bplib_os_get_dtntime_coarse_ms() +
+                                                 BPLIB_MPOOL_MAINTENANCE_COLLECT_TIME_MS);
+        }
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_maintain
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_maintain(bplib_mpool_t *pool)
+{
+    uint32_t i;
+
+    for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        bplib_mpool_maintain_partition(bplib_mpool_get_partition(pool, i));
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_query_mem_current_use
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_query_mem_current_use(bplib_mpool_t *pool)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    size_t                             result;
+    uint32_t                           i;
+
+    result = 0;
+    for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        admin = bplib_mpool_get_admin(bplib_mpool_get_partition(pool, i));
+        result += (bplib_mpool_get_free_block_count(admin) * (size_t)admin->buffer_size) +
+                  (bplib_mpool_subq_get_depth(&admin->small_class.free_blocks) * admin->small_class.block_size) +
+                  (bplib_mpool_subq_get_depth(&admin->large_class.free_blocks) * admin->large_class.block_size);
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_query_collect_backlog
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_query_collect_backlog(bplib_mpool_t *pool)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    size_t                             result;
+    uint32_t                           i;
+
+    result = 0;
+    for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        admin = bplib_mpool_get_admin(bplib_mpool_get_partition(pool, i));
+        result += bplib_mpool_subq_get_depth(&admin->recycle_blocks);
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_is_at_bundle_threshold
+ *
+ *-----------------------------------------------------------------*/
+bool bplib_mpool_is_at_bundle_threshold(bplib_mpool_t *pool)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    uint32_t                           i;
+
+    /* the depth of the free list can be read without the lock, the same as for the thread cache */
+    for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        admin = bplib_mpool_get_admin(bplib_mpool_get_partition(pool, i));
+        if (!bplib_mpool_alloc_check_threshold(admin, bplib_mpool_get_free_block_count(admin),
+                                               BPLIB_MPOOL_ALLOC_PRI_LO))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_query_mem_max_use
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_query_mem_max_use(bplib_mpool_t *pool)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    size_t                             result;
+    uint32_t                           i;
+
+    /* note this is the sum of the watermarks, the partitions may not have peaked at the same time */
+    result = 0;
+    for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+    {
+        admin = bplib_mpool_get_admin(bplib_mpool_get_partition(pool, i));
+        result += (admin->max_alloc_watermark * (size_t)admin->buffer_size);
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_stats_get_value
+ *
+ * Gets a statistic of a single partition
+ *-----------------------------------------------------------------*/
+static size_t bplib_mpool_stats_get_value(const bplib_mpool_stats_t *stats, bplib_mpool_stat_t stat, uint32_t index)
+{
+    size_t result;
+
+    result = 0;
+    switch (stat)
+    {
+        case bplib_mpool_stat_alloc_count:
+            if (index < bplib_mpool_blocktype_max)
+            {
+                result = stats->alloc_count[index];
+            }
+            break;
+        case bplib_mpool_stat_free_count:
+            if (index < bplib_mpool_blocktype_max)
+            {
+                result = stats->free_count[index];
+            }
+            break;
+        case bplib_mpool_stat_alloc_priority:
+            if (index < BPLIB_MPOOL_STAT_PRIORITY_BANDS)
+            {
+                result = stats->priority_alloc_count[index];
+            }
+            break;
+        case bplib_mpool_stat_alloc_refused:
+            result = stats->alloc_refused_count;
+            break;
+        case bplib_mpool_stat_free_depth:
+            /* index 0 is the most recent sample */
+            if (index < BPLIB_MPOOL_STAT_DEPTH_SAMPLES && index < stats->free_depth_pos)
+            {
+                index  = (stats->free_depth_pos - 1 - index) % BPLIB_MPOOL_STAT_DEPTH_SAMPLES;
+                result = stats->free_depth_history[index];
+            }
+            break;
+        case bplib_mpool_stat_job_wait_time:
+            if (index < (bplib_mpool_jobtype_max * BPLIB_MPOOL_STAT_JOB_TIME_BINS))
+            {
+                result = stats->job_wait_time[index];
+            }
+            break;
+        case bplib_mpool_stat_job_run_time:
+            if (index < (bplib_mpool_jobtype_max * BPLIB_MPOOL_STAT_JOB_TIME_BINS))
+            {
+                result = stats->job_run_time[index];
+            }
+            break;
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_query_stat
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_query_stat(bplib_mpool_t *pool, bplib_mpool_stat_t stat, uint32_t index)
+{
+    bplib_mpool_block_admin_content_t *admin;
+    size_t                             result;
+    size_t                             value;
+    uint32_t                           num_samples;
+    uint32_t                           i;
+
+    result = 0;
+    switch (stat)
+    {
+        case bplib_mpool_stat_lock_wait_count:
+            /* the lock sets are shared by all pools */
+            if (index < BPLIB_MPOOL_STAT_LOCK_WAIT_BINS)
+            {
+                for (i = 0; i < BPLIB_MPOOL_NUM_LOCKS; ++i)
+                {
+                    result += BPLIB_MPOOL_LOCK_SET[i].wait_count[index];
+                }
+                for (i = 0; i < BPLIB_MPOOL_NUM_POOL_LOCKS; ++i)
+                {
+                    result += BPLIB_MPOOL_POOL_LOCK_SET[i].wait_count[index];
+                }
+            }
+            break;
+
+        case bplib_mpool_stat_free_depth_min:
+        case bplib_mpool_stat_free_depth_max:
+            /* all partitions are sampled in the same maintenance cycle, so the first one has the count */
+            admin       = bplib_mpool_get_admin(pool);
+            num_samples = 0;
+            if (admin->stats != NULL)
+            {
+                num_samples = admin->stats->free_depth_pos;
+                if (num_samples > BPLIB_MPOOL_STAT_DEPTH_SAMPLES)
+                {
+                    num_samples = BPLIB_MPOOL_STAT_DEPTH_SAMPLES;
+                }
+            }
+            for (i = 0; i < num_samples; ++i)
+            {
+                value = bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, i);
+                if (i == 0 || (stat == bplib_mpool_stat_free_depth_min && value < result) ||
+                    (stat == bplib_mpool_stat_free_depth_max && value > result))
+                {
+                    result = value;
+                }
+            }
+            break;
+
+        default:
+            for (i = 0; i < bplib_mpool_get_num_partitions(pool); ++i)
+            {
+                admin = bplib_mpool_get_admin(bplib_mpool_get_partition(pool, i));
+                if (admin->stats != NULL)
+                {
+                    result += bplib_mpool_stats_get_value(admin->stats, stat, index);
+                }
+            }
+            break;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_print_list_stats
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_debug_print_list_stats(bplib_mpool_block_t *list, const char *label)
+{
+    bplib_mpool_block_t         *blk;
+    bplib_mpool_block_content_t *content;
+    size_t                       depth;
+
+    blk   = list;
+    depth = 0;
+    while (true)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        if (bplib_mpool_is_list_head(blk))
+        {
+            /* as a sanity check, this should be the same head node as where it started,
+             * there should be one (and only one) head node in a list */
+            assert(blk == list);
+            break;
+        }
+
+        content = bplib_mpool_get_block_content(blk);
+        if (content != NULL)
+        {
+            printf("DEBUG: %s(): block addr=%lx type=%d refcount=%u\n", __func__, (unsigned long)blk,
+                   content->header.base_link.type, content->header.refcount);
+
+            if (blk->type == bplib_mpool_blocktype_canonical)
+            {
+                printf("DEBUG: %s():  --> canonical block type %d\n", __func__,
+                       (int)content->u.canonical.cblock.canonical_logical_data.canonical_block.blockType);
+            }
+            else if (blk->type == bplib_mpool_blocktype_primary)
+            {
+                printf("DEBUG: %s():  -->  primary dest IPN %lu\n", __func__,
+                       (unsigned long)content->u.primary.pblock.data.logical.destinationEID.ssp.ipn.node_number);
+            }
+        }
+
+        ++depth;
+    }
+    printf("DEBUG: %s(): %s depth=%lu\n", __func__, label, (unsigned long)depth);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_scan_size_class
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_debug_scan_size_class(bplib_mpool_t *pool, bplib_mpool_size_class_t *sclass,
+                                              uint32_t *count_by_type, uint32_t *count_invalid)
+{
+    uint32_t                     i;
+    bplib_mpool_block_content_t *pchunk;
+
+    pchunk = (bplib_mpool_block_content_t *)(void *)((uint8_t *)pool +
+                                                     ((size_t)sclass->region_start * BPLIB_MPOOL_BLOCK_GRANULE));
+    for (i = 0; i < sclass->num_bufs_total; ++i)
+    {
+        if (pchunk->header.base_link.type < bplib_mpool_blocktype_max)
+        {
+            ++count_by_type[pchunk->header.base_link.type];
+        }
+        else
+        {
+            ++(*count_invalid);
+        }
+        pchunk = (bplib_mpool_block_content_t *)(void *)((uint8_t *)pchunk + sclass->block_size);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_print_job_times
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_debug_print_job_times(const bplib_mpool_stats_t *stats, bplib_mpool_jobtype_t jobtype)
+{
+    uint32_t bin;
+
+    printf("DEBUG: %s(): job type=%u wait:", __func__, (unsigned int)jobtype);
+    for (bin = 0; bin < BPLIB_MPOOL_STAT_JOB_TIME_BINS; ++bin)
+    {
+        printf(" %lu", (unsigned long)stats->job_wait_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(jobtype, bin)]);
+    }
+    printf(" run:");
+    for (bin = 0; bin < BPLIB_MPOOL_STAT_JOB_TIME_BINS; ++bin)
+    {
+        printf(" %lu", (unsigned long)stats->job_run_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(jobtype, bin)]);
+    }
+    printf("\n");
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_scan
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_debug_scan(bplib_mpool_t *pool)
+{
+    size_t                             i;
+    bplib_mpool_block_content_t       *pchunk;
+    uint32_t                           count_by_type[bplib_mpool_blocktype_max];
+    uint32_t                           count_invalid;
+    bplib_mpool_block_admin_content_t *admin;
+
+    admin = bplib_mpool_get_admin(pool);
+
+    printf("DEBUG: %s(): total blocks=%u, buffer_size=%zu, free=%u, recycled=%u\n", __func__,
+           (unsigned int)admin->num_bufs_total, admin->buffer_size,
+           (unsigned int)bplib_mpool_subq_get_depth(&admin->free_blocks),
+           (unsigned int)bplib_mpool_subq_get_depth(&admin->recycle_blocks));
+    printf("DEBUG: %s(): small blocks=%u, block_size=%zu, free=%u\n", __func__,
+           (unsigned int)admin->small_class.num_bufs_total, admin->small_class.block_size,
+           (unsigned int)bplib_mpool_subq_get_depth(&admin->small_class.free_blocks));
+    printf("DEBUG: %s(): large blocks=%u, block_size=%zu, free=%u\n", __func__,
+           (unsigned int)admin->large_class.num_bufs_total, admin->large_class.block_size,
+           (unsigned int)bplib_mpool_subq_get_depth(&admin->large_class.free_blocks));
+
+    bplib_mpool_debug_print_list_stats(&admin->free_blocks.block_list, "free_blocks");
+    bplib_mpool_debug_print_list_stats(&admin->recycle_blocks.block_list, "recycle_blocks");
+    bplib_mpool_debug_print_list_stats(&admin->active_list, "active_list");
+
+    if (admin->stats != NULL)
+    {
+        for (i = 0; i < bplib_mpool_jobtype_max; ++i)
+        {
+            bplib_mpool_debug_print_job_times(admin->stats, (bplib_mpool_jobtype_t)i);
+        }
+    }
+
+    memset(count_by_type, 0, sizeof(count_by_type));
+    count_invalid = 0;
+    pchunk        = &pool->admin_block;
+
+    /* Note that num_bufs_total does not include the admin block (0) */
+    for (i = 0; i <= admin->num_bufs_total; ++i)
+    {
+        if (i == 0)
+        {
+            assert(pchunk->header.base_link.type == bplib_mpool_blocktype_admin);
+        }
+        else if (pchunk->header.base_link.type < bplib_mpool_blocktype_max)
+        {
+            ++count_by_type[pchunk->header.base_link.type];
+        }
+        else
+        {
+            ++count_invalid;
+        }
+        ++pchunk;
+    }
+
+    bplib_mpool_debug_scan_size_class(pool, &admin->small_class, count_by_type, &count_invalid);
+    bplib_mpool_debug_scan_size_class(pool, &admin->large_class, count_by_type, &count_invalid);
+
+    for (i = 0; i < bplib_mpool_blocktype_max; ++i)
+    {
+        printf("DEBUG: %s(): block type=%zu count=%lu\n", __func__, i, (unsigned long)count_by_type[i]);
+    }
+    printf("DEBUG: %s(): invalid count=%lu\n", __func__, (unsigned long)count_invalid);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_print_inspection
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_debug_print_inspection(const bplib_mpool_inspection_t *result)
+{
+    uint32_t i;
+
+    printf("DEBUG: %s(): passes=%lu free=%lu unreferenced=%lu single=%lu shared=%lu\n", __func__,
+           (unsigned long)result->passes, (unsigned long)result->by_state[bplib_mpool_inspect_state_free],
+           (unsigned long)result->by_state[bplib_mpool_inspect_state_unreferenced],
+           (unsigned long)result->by_state[bplib_mpool_inspect_state_single],
+           (unsigned long)result->by_state[bplib_mpool_inspect_state_shared]);
+
+    for (i = 0; i < bplib_mpool_blocktype_max; ++i)
+    {
+        printf("DEBUG: %s(): block type=%lu count=%lu\n", __func__, (unsigned long)i,
+               (unsigned long)result->by_type[i]);
+    }
+
+    for (i = 0; i < BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES; ++i)
+    {
+        if (result->blocktype_count[i] != 0)
+        {
+            printf("DEBUG: %s(): blocktype magic=0x%08lx count=%lu\n", __func__,
+                   (unsigned long)result->blocktype_magic[i], (unsigned long)result->blocktype_count[i]);
+        }
+    }
+
+    printf("DEBUG: %s(): bundle age:", __func__);
+    for (i = 0; i < BPLIB_MPOOL_INSPECT_AGE_BINS; ++i)
+    {
+        printf(" %lu", (unsigned long)result->bundle_age[i]);
+    }
+    printf("\n");
+}
+
+#ifdef BPLIB_LOCK_PROFILE
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_print_lock_record
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_debug_print_lock_record(const char *caller, const char *label, uint32_t index,
+                                                const bplib_mpool_lock_profile_t *prof)
+{
+    printf("DEBUG: %s(): %s %s:%lu acquired=%llu contended=%llu wait_us=%llu hold_max_us=%llu\n", caller, label,
+           prof->func, (unsigned long)index,
+           (unsigned long long)prof->acquire_count, (unsigned long long)prof->contended_count,
+           (unsigned long long)prof->wait_us_total, (unsigned long long)prof->hold_us_max);
+}
+#endif
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_debug_print_lock_profile
+ *
+ * The resource locks are listed per stripe, then the pool locks, then the other
+ * named locks, then each call site which took any of them.
+ *-----------------------------------------------------------------*/
+void bplib_mpool_debug_print_lock_profile(void)
+{
+#ifdef BPLIB_LOCK_PROFILE
+    const bplib_mpool_lock_profile_t *prof;
+    uint32_t                          i;
+
+    for (i = 0; i < BPLIB_MPOOL_NUM_LOCKS; ++i)
+    {
+        prof = &BPLIB_MPOOL_LOCK_SET[i].profile;
+        if (prof->acquire_count != 0)
+        {
+            bplib_mpool_debug_print_lock_record(__func__, "lock", i, prof);
+        }
+    }
+
+    for (i = 0; i < BPLIB_MPOOL_NUM_POOL_LOCKS; ++i)
+    {
+        prof = &BPLIB_MPOOL_POOL_LOCK_SET[i].profile;
+        if (prof->acquire_count != 0)
+        {
+            bplib_mpool_debug_print_lock_record(__func__, "pool", i, prof);
+        }
+    }
+
+    for (i = 0; i < BPLIB_MPOOL_LOCK_PROFILE_SITES; ++i)
+    {
+        prof = &BPLIB_MPOOL_LOCK_PROFILE_SET[i];
+        if (__atomic_load_n(&prof->func, __ATOMIC_ACQUIRE) != NULL && prof->line == 0)
+        {
+            bplib_mpool_debug_print_lock_record(__func__, "lock", 0, prof);
+        }
+    }
+
+    for (i = 0; i < BPLIB_MPOOL_LOCK_PROFILE_SITES; ++i)
+    {
+        prof = &BPLIB_MPOOL_LOCK_PROFILE_SET[i];
+        if (__atomic_load_n(&prof->func, __ATOMIC_ACQUIRE) != NULL && prof->line != 0)
+        {
+            bplib_mpool_debug_print_lock_record(__func__, "site", prof->line, prof);
+        }
+    }
+#else
+    printf("DEBUG: %s(): not built with BPLIB_LOCK_PROFILE\n", __func__);
+#endif
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_size_class_init
+ *
+ * Carves blocks of the given size from the region starting at region_start,
+ * and puts them into the free list of the size class.  "region_size" is the
+ * memory set aside for the class, but if this would not hold a useful number
+ * of blocks, the class is left empty.  Returns the amount of memory used.
+ *-----------------------------------------------------------------*/
+static size_t bplib_mpool_size_class_init(bplib_mpool_t *pool, bplib_mpool_size_class_t *sclass, uint8_t *region_start,
+                                          size_t region_size, size_t user_size)
+{
+    bplib_mpool_block_content_t *pchunk;
+    size_t                       block_size;
+    uint32_t                     offset;
+    uint32_t                     count;
+    uint32_t                     i;
+
+    /* all blocks must be a multiple of the granule so parent_offset can be computed */
+    block_size = offsetof(bplib_mpool_block_content_t, u) + user_size;
+    block_size = (block_size + BPLIB_MPOOL_BLOCK_GRANULE - 1) / BPLIB_MPOOL_BLOCK_GRANULE;
+    block_size *= BPLIB_MPOOL_BLOCK_GRANULE;
+
+    bplib_mpool_subq_init(&pool->admin_block.header.base_link, &sclass->free_blocks);
+    offset               = (region_start - (uint8_t *)pool) / BPLIB_MPOOL_BLOCK_GRANULE;
+    sclass->block_size   = block_size;
+    sclass->region_start = offset;
+    sclass->region_end   = offset;
+
+    count = region_size / block_size;
+    if (count < BPLIB_MPOOL_SIZE_CLASS_MIN_BLOCKS)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        /* a block kept by bplib_mpool_reattach() is left as it is */
+        pchunk = (bplib_mpool_block_content_t *)(void *)region_start;
+        if (pchunk->header.refcount != BPLIB_MPOOL_REATTACH_KEEP)
+        {
+            bplib_mpool_link_reset(&pchunk->header.base_link, bplib_mpool_blocktype_undefined, offset);
+            bplib_mpool_subq_push_single(&sclass->free_blocks, &pchunk->header.base_link);
+        }
+        region_start += block_size;
+        offset += block_size / BPLIB_MPOOL_BLOCK_GRANULE;
+    }
+
+    sclass->num_bufs_total = count;
+    sclass->region_end     = offset;
+
+    return count * block_size;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_create
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_t *bplib_mpool_create(void *pool_mem, size_t pool_size)
+{
+    return bplib_mpool_create_ext(pool_mem, pool_size, 0);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_format
+ *
+ *-----------------------------------------------------------------*/
+static bplib_mpool_t *bplib_mpool_format(void *pool_mem, size_t pool_size, uint32_t flags)
+{
+    bplib_mpool_t                     *pool;
+    size_t                             remain;
+    size_t                             small_size;
+    size_t                             large_size;
+    size_t                             index_size;
+    size_t                             stats_size;
+    size_t                             used;
+    uint8_t                           *pmem;
+    bplib_mpool_block_content_t       *pchunk;
+    bplib_mpool_block_admin_content_t *admin;
+
+    /* everything else is set up from the admin block, blocks already in use are only in its lists */
+    memset(pool_mem, 0, sizeof(bplib_mpool_block_content_t));
+
+    pool = pool_mem;
+
+    bplib_mpool_link_reset(&pool->admin_block.header.base_link, bplib_mpool_blocktype_admin, 0);
+    admin = bplib_mpool_get_admin(pool);
+
+    /* the block lists are circular, as this reduces
+     * complexity of operations (never a null pointer) */
+    admin->buffer_size = sizeof(bplib_mpool_block_content_t);
+    admin->pool_size   = pool_size;
+    admin->pool_base   = pool_mem;
+    bplib_mpool_subq_init(&pool->admin_block.header.base_link, &admin->free_blocks);
+    bplib_mpool_subq_init(&pool->admin_block.header.base_link, &admin->recycle_blocks);
+    bplib_mpool_init_list_head(&pool->admin_block.header.base_link, &admin->active_list);
+    bplib_rbt_init_root(&admin->blocktype_registry);
+
+    /* start at the _next_ buffer, which is the first usable buffer (first is the admin block) */
+    pchunk = &pool->admin_block + 1;
+    remain = pool_size - sizeof(bplib_mpool_block_content_t);
+
+    /*
+     * The pool is laid out as: [admin][standard blocks][small blocks][large blocks][registry index][stats]
+     * Set aside the memory for the other size classes and the index first, the standard blocks get the rest.
+     * In a pool too small to have the index, all registry lookups just use the tree, and no stats are kept.
+     */
+    index_size = BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES * sizeof(bplib_mpool_api_content_t *);
+    stats_size = sizeof(bplib_mpool_stats_t);
+    if (remain < (index_size + stats_size + sizeof(bplib_mpool_block_content_t)))
+    {
+        index_size = 0;
+        stats_size = 0;
+    }
+    remain -= index_size + stats_size;
+    small_size = (remain / 100) * BPLIB_MPOOL_SMALL_CLASS_PERCENT;
+    large_size = (remain / 100) * BPLIB_MPOOL_LARGE_CLASS_PERCENT;
+    if ((small_size / (offsetof(bplib_mpool_block_content_t, u) + BP_MPOOL_SMALL_USER_BLOCK_SIZE)) <
+        BPLIB_MPOOL_SIZE_CLASS_MIN_BLOCKS)
+    {
+        small_size = 0;
+    }
+    if ((large_size / (offsetof(bplib_mpool_block_content_t, u) + BP_MPOOL_LARGE_USER_BLOCK_SIZE)) <
+        BPLIB_MPOOL_SIZE_CLASS_MIN_BLOCKS)
+    {
+        large_size = 0;
+    }
+    remain -= small_size + large_size;
+
+    if ((flags & BPLIB_MPOOL_CREATE_LAZY_INIT) != 0)
+    {
+        /* standard blocks are set up one at a time as the pool grows, see bplib_mpool_pull_free_block() */
+        admin->lazy_next_block  = pchunk;
+        admin->lazy_block_count = remain / sizeof(bplib_mpool_block_content_t);
+        admin->num_bufs_total   = admin->lazy_block_count;
+        pchunk += admin->lazy_block_count;
+        remain -= admin->lazy_block_count * sizeof(bplib_mpool_block_content_t);
+    }
+
+    while (remain >= sizeof(bplib_mpool_block_content_t))
+    {
+        /* a block kept by bplib_mpool_reattach() is left as it is */
+        if (pchunk->header.refcount != BPLIB_MPOOL_REATTACH_KEEP)
+        {
+            bplib_mpool_link_reset(&pchunk->header.base_link, bplib_mpool_blocktype_undefined,
+                                   ((uint8_t *)pchunk - (uint8_t *)pool) / BPLIB_MPOOL_BLOCK_GRANULE);
+            bplib_mpool_subq_push_single(&admin->free_blocks, &pchunk->header.base_link);
+        }
+        remain -= sizeof(bplib_mpool_block_content_t);
+        ++pchunk;
+        ++admin->num_bufs_total;
+    }
+
+    /* the large class also gets whatever was not used by the others */
+    pmem = (uint8_t *)pchunk;
+    remain += small_size + large_size;
+    used = bplib_mpool_size_class_init(pool, &admin->small_class, pmem, small_size, BP_MPOOL_SMALL_USER_BLOCK_SIZE);
+    pmem += used;
+    remain -= used;
+    used = bplib_mpool_size_class_init(pool, &admin->large_class, pmem, remain, BP_MPOOL_LARGE_USER_BLOCK_SIZE);
+    pmem += used;
+
+    /* Note that the serial number of an external ID is the parent_offset of the block, which
+     * limits the size of pool where every block can be referred to by an external ID */
+    admin->pool_extent = (pmem - (uint8_t *)pool) / BPLIB_MPOOL_BLOCK_GRANULE;
+
+    /* the index and stats go after all the blocks, these are always suitably aligned because pmem is block-aligned */
+    if (index_size != 0)
+    {
+        admin->registry_index = (bplib_mpool_api_content_t **)(void *)pmem;
+        memset(admin->registry_index, 0, index_size);
+        pmem += index_size;
+    }
+    if (stats_size != 0)
+    {
+        admin->stats = (bplib_mpool_stats_t *)(void *)pmem;
+        memset(admin->stats, 0, stats_size);
+    }
+
+    /* register the first API type, which is 0.
+     * Notably this prevents other modules from actually registering something at 0.
+     * This is always the first entry in the index, so a zero-filled block refers to it */
+    bplib_rbt_insert_value_unique(0, &admin->blocktype_registry, &admin->blocktype_basic.rbt_link);
+    bplib_mpool_registry_index_add(admin, &admin->blocktype_basic);
+    bplib_rbt_insert_value_unique(MPOOL_CACHE_CBOR_DATA_SIGNATURE, &admin->blocktype_registry,
+                                  &admin->blocktype_cbor.rbt_link);
+    bplib_mpool_registry_index_add(admin, &admin->blocktype_cbor);
+
+    /*
+     * Set the bundle alloc threshold at 30% remaining (just a guess)
+     * Set the internal alloc threshold at 10% remaining
+     * The intent is to NOT allow the entire pool to be used by bundles,
+     * there must be some buffer room for refs which transport the bundles.
+     */
+    admin->bblock_alloc_threshold   = (admin->num_bufs_total * 30) / 100;
+    admin->internal_alloc_threshold = (admin->num_bufs_total * 10) / 100;
+    admin->layout_signature         = BPLIB_MPOOL_LAYOUT_SIGNATURE;
+    fprintf(stderr, "%s(): created pool of size %zu, with %u chunks, bblock threshold = %u, internal threshold = %u\n",
+            __func__, pool_size, (unsigned int)admin->num_bufs_total, (unsigned int)admin->bblock_alloc_threshold,
+            (unsigned int)admin->internal_alloc_threshold);
+    fprintf(stderr, "%s(): %u small chunks of %zu bytes, %u large chunks of %zu bytes\n", __func__,
+            (unsigned int)admin->small_class.num_bufs_total, admin->small_class.block_size,
+            (unsigned int)admin->large_class.num_bufs_total, admin->large_class.block_size);
+
+    return pool;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_maintain
+ * Function: bplib_mpool_create_ext
  *
  *-----------------------------------------------------------------*/
-void bplib_mpool_maintain(bplib_mpool_t *pool)
+bplib_mpool_t *bplib_mpool_create_ext(void *pool_mem, size_t pool_size, uint32_t flags)
 {
-    /* the check for non-empty list can be done unlocked, as it
-     * involves counter values which should be testable in an atomic fashion.
-     * note this isn't final - Subq will be re-checked after locking, if this is true */
-    if (bplib_mpool_subq_get_depth(&bplib_mpool_get_admin(pool)->recycle_blocks) != 0)
+    /* this is just a sanity check, a pool that has only 1 block will not
+     * be useful for anything, but it can at least be created */
+    if (pool_mem == NULL || pool_size < sizeof(bplib_mpool_t))
+    {
+        /* pool memory too small */
+        return NULL;
+    }
+
+    /* initialize the lock table - OK to call this multiple times,
+     * subsequent calls shouldn't do anything */
+    bplib_mpool_lock_init();
+
+    /* wiping the entire memory might be overkill, but it is only done once
+     * at start up, and this may also help verify that the memory "works".
+     * With lazy init the memory must already be zero, and is not touched here. */
+    if ((flags & BPLIB_MPOOL_CREATE_LAZY_INIT) == 0)
     {
-        bplib_mpool_collect_blocks(pool, BPLIB_MPOOL_MAINTENCE_COLLECT_LIMIT);
+        memset(pool_mem, 0, pool_size);
     }
+
+    return bplib_mpool_format(pool_mem, pool_size, flags);
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_query_mem_current_use
+ * Function: bplib_mpool_reattach_check_block
  *
  *-----------------------------------------------------------------*/
-size_t bplib_mpool_query_mem_current_use(bplib_mpool_t *pool)
+static bplib_mpool_block_content_t *bplib_mpool_reattach_check_block(bplib_mpool_t *pool, bplib_mpool_block_t *link)
 {
     bplib_mpool_block_admin_content_t *admin;
+    const bplib_mpool_size_class_t    *sclass;
+    size_t                             pos;
+    uint32_t                           offset;
 
+    /* the link must be the start of a block in one of the regions, nothing else is a block */
     admin = bplib_mpool_get_admin(pool);
+    if ((uint8_t *)link < (uint8_t *)(&pool->admin_block + 1))
+    {
+        return NULL;
+    }
+
+    pos = (uint8_t *)link - (uint8_t *)pool;
+    if ((pos % BPLIB_MPOOL_BLOCK_GRANULE) != 0 || (pos / BPLIB_MPOOL_BLOCK_GRANULE) >= admin->pool_extent)
+    {
+        return NULL;
+    }
+
+    offset = pos / BPLIB_MPOOL_BLOCK_GRANULE;
+    if (link->parent_offset != offset || link->type >= bplib_mpool_blocktype_max)
+    {
+        return NULL;
+    }
+
+    if (bplib_mpool_size_class_contains(&admin->small_class, offset))
+    {
+        sclass = &admin->small_class;
+    }
+    else if (bplib_mpool_size_class_contains(&admin->large_class, offset))
+    {
+        sclass = &admin->large_class;
+    }
+    else
+    {
+        sclass = NULL;
+    }
+
+    if (sclass != NULL)
+    {
+        if ((((size_t)(offset - sclass->region_start) * BPLIB_MPOOL_BLOCK_GRANULE) % sclass->block_size) != 0)
+        {
+            return NULL;
+        }
+    }
+    else if ((pos % sizeof(bplib_mpool_block_content_t)) != 0 ||
+             (pos / sizeof(bplib_mpool_block_content_t)) > admin->num_bufs_total)
+    {
+        return NULL;
+    }
 
-    return (bplib_mpool_subq_get_depth(&admin->free_blocks) * (size_t)admin->buffer_size);
+    return (bplib_mpool_block_content_t *)(void *)link;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_query_mem_max_use
+ * Function: bplib_mpool_reattach_walk_list
  *
  *-----------------------------------------------------------------*/
-size_t bplib_mpool_query_mem_max_use(bplib_mpool_t *pool)
+static bool bplib_mpool_reattach_walk_list(bplib_mpool_t *pool, bplib_mpool_block_t *list,
+                                           bplib_mpool_bblock_primary_t *owner, bool keep)
 {
     bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *content;
+    bplib_mpool_block_t               *prev;
+    bplib_mpool_block_t               *node;
+    uint32_t                           limit;
 
+    /* owner is the bundle if this is its list of canonical blocks, otherwise it is a list of CBOR data */
     admin = bplib_mpool_get_admin(pool);
+    limit = admin->num_bufs_total + admin->small_class.num_bufs_total + admin->large_class.num_bufs_total;
+    prev  = list;
+    node  = list->next;
+    while (node != list)
+    {
+        content = bplib_mpool_reattach_check_block(pool, node);
+        if (content == NULL || node->prev != prev || limit == 0)
+        {
+            return false;
+        }
+
+        /* a block that some other bundle is keeping means the lists are crossed somehow */
+        if (!keep && content->header.refcount == BPLIB_MPOOL_REATTACH_KEEP)
+        {
+            return false;
+        }
+
+        if (owner != NULL)
+        {
+            if (node->type != bplib_mpool_blocktype_canonical || content->u.canonical.cblock.bundle_ref != owner ||
+                !bplib_mpool_reattach_walk_list(pool, &content->u.canonical.cblock.chunk_list, NULL, keep))
+            {
+                return false;
+            }
+        }
+        else if (node->type != bplib_mpool_blocktype_generic ||
+                 content->header.content_type_signature != MPOOL_CACHE_CBOR_DATA_SIGNATURE)
+        {
+            /* slices refer to data through refs, which are not kept, so only plain CBOR data can be */
+            return false;
+        }
+
+        if (keep)
+        {
+            content->header.refcount = BPLIB_MPOOL_REATTACH_KEEP;
+        }
 
-    return (admin->max_alloc_watermark * (size_t)admin->buffer_size);
+        --limit;
+        prev = node;
+        node = node->next;
+    }
+
+    return (list->prev == prev);
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_debug_print_list_stats
+ * Function: bplib_mpool_reattach_mark_bundles
  *
  *-----------------------------------------------------------------*/
-void bplib_mpool_debug_print_list_stats(bplib_mpool_block_t *list, const char *label)
+static bool bplib_mpool_reattach_mark_bundles(bplib_mpool_t *pool)
 {
-    bplib_mpool_block_t         *blk;
-    bplib_mpool_block_content_t *content;
-    size_t                       depth;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *pchunk;
+    bplib_mpool_block_t               *node;
+    uint32_t                           limit;
+    uint32_t                           i;
 
-    blk   = list;
-    depth = 0;
-    while (true)
+    admin = bplib_mpool_get_admin(pool);
+
+    /* anything waiting to be collected was already gone, so it must not be found as a bundle below */
+    limit = admin->num_bufs_total + admin->small_class.num_bufs_total + admin->large_class.num_bufs_total;
+    node  = admin->recycle_blocks.block_list.next;
+    while (node != &admin->recycle_blocks.block_list)
     {
-        blk = bplib_mpool_get_next_block(blk);
-        if (bplib_mpool_is_list_head(blk))
+        if (bplib_mpool_reattach_check_block(pool, node) == NULL || limit == 0)
         {
-            /* as a sanity check, this should be the same head node as where it started,
-             * there should be one (and only one) head node in a list */
-            assert(blk == list);
-            break;
+            return false;
         }
 
-        content = bplib_mpool_get_block_content(blk);
-        if (content != NULL)
+        if (node->type == bplib_mpool_blocktype_primary)
         {
-            printf("DEBUG: %s(): block addr=%lx type=%d refcount=%u\n", __func__, (unsigned long)blk,
-                   content->header.base_link.type, content->header.refcount);
+            node->type = bplib_mpool_blocktype_undefined;
+        }
 
-            if (blk->type == bplib_mpool_blocktype_canonical)
-            {
-                printf("DEBUG: %s():  --> canonical block type %d\n", __func__,
-                       (int)content->u.canonical.cblock.canonical_logical_data.canonical_block.blockType);
-            }
-            else if (blk->type == bplib_mpool_blocktype_primary)
-            {
-                printf("DEBUG: %s():  -->  primary dest IPN %lu\n", __func__,
-                       (unsigned long)content->u.primary.pblock.data.logical.destinationEID.ssp.ipn.node_number);
-            }
+        --limit;
+        node = node->next;
+    }
+
+    /* a bundle always starts with a standard block, and is kept if all of it is intact */
+    pchunk = &pool->admin_block + 1;
+    for (i = 0; i < admin->num_bufs_total; ++i)
+    {
+        if (pchunk->header.base_link.type == bplib_mpool_blocktype_primary &&
+            pchunk->header.base_link.parent_offset ==
+                ((uint8_t *)pchunk - (uint8_t *)pool) / BPLIB_MPOOL_BLOCK_GRANULE &&
+            bplib_mpool_reattach_walk_list(pool, &pchunk->u.primary.pblock.chunk_list, NULL, false) &&
+            bplib_mpool_reattach_walk_list(pool, &pchunk->u.primary.pblock.cblock_list, &pchunk->u.primary.pblock,
+                                           false))
+        {
+            bplib_mpool_reattach_walk_list(pool, &pchunk->u.primary.pblock.chunk_list, NULL, true);
+            bplib_mpool_reattach_walk_list(pool, &pchunk->u.primary.pblock.cblock_list, &pchunk->u.primary.pblock,
+                                           true);
+            pchunk->header.refcount = BPLIB_MPOOL_REATTACH_KEEP;
         }
+        ++pchunk;
+    }
 
-        ++depth;
+    return true;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_reattach_unmark_region
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_reattach_unmark_region(bplib_mpool_t *pool, uint32_t region_start, size_t block_size,
+                                               uint32_t count)
+{
+    bplib_mpool_block_content_t *pchunk;
+    uint32_t                     i;
+
+    pchunk = (bplib_mpool_block_content_t *)(void *)((uint8_t *)pool +
+                                                     ((size_t)region_start * BPLIB_MPOOL_BLOCK_GRANULE));
+    for (i = 0; i < count; ++i)
+    {
+        if (pchunk->header.refcount == BPLIB_MPOOL_REATTACH_KEEP)
+        {
+            pchunk->header.refcount = 0;
+        }
+        pchunk = (bplib_mpool_block_content_t *)(void *)((uint8_t *)pchunk + block_size);
     }
-    printf("DEBUG: %s(): %s depth=%lu\n", __func__, label, (unsigned long)depth);
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_debug_scan
+ * Function: bplib_mpool_reattach
  *
  *-----------------------------------------------------------------*/
-void bplib_mpool_debug_scan(bplib_mpool_t *pool)
+bplib_mpool_t *bplib_mpool_reattach(void *pool_mem, size_t pool_size, bplib_mpool_callback_func_t recover_fn,
+                                    void *recover_arg)
 {
-    size_t                             i;
-    bplib_mpool_block_content_t       *pchunk;
-    uint32_t                           count_by_type[bplib_mpool_blocktype_max];
-    uint32_t                           count_invalid;
+    bplib_mpool_t                     *pool;
     bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *pchunk;
+    bplib_mpool_block_t                recovered;
+    bplib_mpool_block_t               *blk;
+    uint32_t                           i;
+
+    if (pool_mem == NULL || pool_size < sizeof(bplib_mpool_t))
+    {
+        return NULL;
+    }
 
+    /* the links are pointers, so the pool must be where it was made, and laid out the same way */
+    pool  = pool_mem;
     admin = bplib_mpool_get_admin(pool);
+    if (pool->admin_block.header.base_link.type != bplib_mpool_blocktype_admin ||
+        admin->layout_signature != BPLIB_MPOOL_LAYOUT_SIGNATURE || admin->pool_base != pool_mem ||
+        admin->pool_size != pool_size || admin->buffer_size != sizeof(bplib_mpool_block_content_t) ||
+        admin->partition_table != NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Memory does not hold a pool that can be attached again\n");
+        return NULL;
+    }
 
-    printf("DEBUG: %s(): total blocks=%u, buffer_size=%zu, free=%u, recycled=%u\n", __func__,
-           (unsigned int)admin->num_bufs_total, admin->buffer_size,
-           (unsigned int)bplib_mpool_subq_get_depth(&admin->free_blocks),
-           (unsigned int)bplib_mpool_subq_get_depth(&admin->recycle_blocks));
+    bplib_mpool_lock_init();
 
-    bplib_mpool_debug_print_list_stats(&admin->free_blocks.block_list, "free_blocks");
-    bplib_mpool_debug_print_list_stats(&admin->recycle_blocks.block_list, "recycle_blocks");
-    bplib_mpool_debug_print_list_stats(&admin->active_list, "active_list");
+    if (!bplib_mpool_reattach_mark_bundles(pool))
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Pool lists are damaged, it cannot be attached again\n");
+        return NULL;
+    }
 
-    memset(count_by_type, 0, sizeof(count_by_type));
-    count_invalid = 0;
-    pchunk        = &pool->admin_block;
+    /* the same layout comes out again, with every block that is not kept back on the free lists */
+    bplib_mpool_format(pool_mem, pool_size, 0);
 
-    /* Note that num_bufs_total does not include the admin block (0) */
-    for (i = 0; i <= admin->num_bufs_total; ++i)
+    bplib_mpool_init_list_head(NULL, &recovered);
+    pchunk = &pool->admin_block + 1;
+    for (i = 0; i < admin->num_bufs_total; ++i)
     {
-        if (i == 0)
+        if (pchunk->header.refcount == BPLIB_MPOOL_REATTACH_KEEP &&
+            pchunk->header.base_link.type == bplib_mpool_blocktype_primary)
         {
-            assert(pchunk->header.base_link.type == bplib_mpool_blocktype_admin);
+            /* refs and flows were not kept, so the bundle starts out on its own */
+            pchunk->header.refcount                               = 0;
+            pchunk->u.primary.pblock.data.delivery.trace_ref      = NULL;
+            pchunk->u.primary.pblock.data.delivery.completion_ref = NULL;
+            pchunk->u.primary.pblock.data.delivery.quota_ref      = NULL;
+            pchunk->u.primary.pblock.data.delivery.quota_charge   = 0;
+            bplib_mpool_link_reset(&pchunk->header.base_link, bplib_mpool_blocktype_primary,
+                                   pchunk->header.base_link.parent_offset);
+            bplib_mpool_insert_before(&recovered, &pchunk->header.base_link);
         }
-        else if (pchunk->header.base_link.type < bplib_mpool_blocktype_max)
+        ++pchunk;
+    }
+
+    bplib_mpool_reattach_unmark_region(pool, sizeof(bplib_mpool_block_content_t) / BPLIB_MPOOL_BLOCK_GRANULE,
+                                       sizeof(bplib_mpool_block_content_t), admin->num_bufs_total);
+    bplib_mpool_reattach_unmark_region(pool, admin->small_class.region_start, admin->small_class.block_size,
+                                       admin->small_class.num_bufs_total);
+    bplib_mpool_reattach_unmark_region(pool, admin->large_class.region_start, admin->large_class.block_size,
+                                       admin->large_class.num_bufs_total);
+
+    /* gathered first, so that the callback can allocate without the new blocks being seen here */
+    while (!bplib_mpool_is_empty_list_head(&recovered))
+    {
+        blk = bplib_mpool_get_next_block(&recovered);
+        bplib_mpool_extract_node(blk);
+        if (recover_fn != NULL)
         {
-            ++count_by_type[pchunk->header.base_link.type];
+            recover_fn(recover_arg, blk);
         }
         else
         {
-            ++count_invalid;
+            bplib_mpool_recycle_block(blk);
         }
-        ++pchunk;
     }
 
-    for (i = 0; i < bplib_mpool_blocktype_max; ++i)
-    {
-        printf("DEBUG: %s(): block type=%zu count=%lu\n", __func__, i, (unsigned long)count_by_type[i]);
-    }
-    printf("DEBUG: %s(): invalid count=%lu\n", __func__, (unsigned long)count_invalid);
+    return pool;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_create
+ * Function: bplib_mpool_create_partitioned
  *
  *-----------------------------------------------------------------*/
-bplib_mpool_t *bplib_mpool_create(void *pool_mem, size_t pool_size)
+bplib_mpool_t *bplib_mpool_create_partitioned(void *pool_mem, size_t pool_size, uint32_t num_partitions,
+                                              uint32_t flags)
 {
-    bplib_mpool_t                     *pool;
-    size_t                             remain;
-    bplib_mpool_block_content_t       *pchunk;
+    bplib_mpool_t                    **partition_table;
     bplib_mpool_block_admin_content_t *admin;
+    uint8_t                           *pmem;
+    size_t                             table_size;
+    size_t                             part_size;
+    uint32_t                           i;
 
-    /* this is just a sanity check, a pool that has only 1 block will not
-     * be useful for anything, but it can at least be created */
-    if (pool_mem == NULL || pool_size < sizeof(bplib_mpool_t))
+    if (num_partitions <= 1)
+    {
+        return bplib_mpool_create_ext(pool_mem, pool_size, flags);
+    }
+
+    if (pool_mem == NULL || num_partitions > BPLIB_MPOOL_MAX_PARTITIONS)
     {
-        /* pool memory too small */
         return NULL;
     }
 
-    /* initialize the lock table - OK to call this multiple times,
-     * subsequent calls shouldn't do anything */
-    bplib_mpool_lock_init();
+    /*
+     * The memory is laid out as: [partition table][partition 0][partition 1]...
+     * The table is padded to a whole block so that every partition starts on a block boundary.
+     */
+    table_size = num_partitions * sizeof(bplib_mpool_t *);
+    table_size = (table_size + sizeof(bplib_mpool_block_content_t) - 1) / sizeof(bplib_mpool_block_content_t);
+    table_size *= sizeof(bplib_mpool_block_content_t);
+    if (pool_size < table_size)
+    {
+        return NULL;
+    }
 
-    /* wiping the entire memory might be overkill, but it is only done once
-     * at start up, and this may also help verify that the memory "works" */
-    memset(pool_mem, 0, pool_size);
+    part_size = (pool_size - table_size) / num_partitions;
+    part_size -= part_size % sizeof(bplib_mpool_block_content_t);
 
-    pool = pool_mem;
+    partition_table = (bplib_mpool_t **)pool_mem;
+    pmem            = (uint8_t *)pool_mem + table_size;
+    for (i = 0; i < num_partitions; ++i)
+    {
+        /* each partition is a complete pool in its own right.  With lazy init, the memory of
+         * each one is not touched until a thread allocates from it, so it ends up local to
+         * the node that thread runs on (first-touch placement) */
+        partition_table[i] = bplib_mpool_create_ext(pmem, part_size, flags);
+        if (partition_table[i] == NULL)
+        {
+            return NULL;
+        }
+        pmem += part_size;
+    }
 
-    bplib_mpool_link_reset(&pool->admin_block.header.base_link, bplib_mpool_blocktype_admin, 0);
-    admin = bplib_mpool_get_admin(pool);
+    for (i = 0; i < num_partitions; ++i)
+    {
+        admin                  = bplib_mpool_get_admin(partition_table[i]);
+        admin->partition_table = partition_table;
+        admin->partition_index = i;
+        admin->num_partitions  = num_partitions;
+    }
 
-    /* the block lists are circular, as this reduces
-     * complexity of operations (never a null pointer) */
-    admin->buffer_size = sizeof(bplib_mpool_block_content_t);
-    bplib_mpool_subq_init(&pool->admin_block.header.base_link, &admin->free_blocks);
-    bplib_mpool_subq_init(&pool->admin_block.header.base_link, &admin->recycle_blocks);
-    bplib_mpool_init_list_head(&pool->admin_block.header.base_link, &admin->active_list);
-    bplib_rbt_init_root(&admin->blocktype_registry);
+    return partition_table[0];
+}
 
-    /* start at the _next_ buffer, which is the first usable buffer (first is the admin block) */
-    pchunk = &pool->admin_block + 1;
-    remain = pool_size - sizeof(bplib_mpool_block_content_t);
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_num_partitions
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_get_num_partitions(bplib_mpool_t *pool)
+{
+    bplib_mpool_block_admin_content_t *admin;
 
-    /* register the first API type, which is 0.
-     * Notably this prevents other modules from actually registering something at 0. */
-    bplib_rbt_insert_value_unique(0, &admin->blocktype_registry, &admin->blocktype_basic.rbt_link);
-    bplib_rbt_insert_value_unique(MPOOL_CACHE_CBOR_DATA_SIGNATURE, &admin->blocktype_registry,
-                                  &admin->blocktype_cbor.rbt_link);
+    admin = bplib_mpool_get_admin(pool);
+    if (admin->partition_table == NULL)
+    {
+        return 1;
+    }
 
-    while (remain >= sizeof(bplib_mpool_block_content_t))
+    return admin->num_partitions;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_get_partition
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_t *bplib_mpool_get_partition(bplib_mpool_t *pool, uint32_t partition_index)
+{
+    bplib_mpool_block_admin_content_t *admin;
+
+    admin = bplib_mpool_get_admin(pool);
+    if (admin->partition_table == NULL)
     {
-        bplib_mpool_link_reset(&pchunk->header.base_link, bplib_mpool_blocktype_undefined, pchunk - &pool->admin_block);
-        bplib_mpool_subq_push_single(&admin->free_blocks, &pchunk->header.base_link);
-        remain -= sizeof(bplib_mpool_block_content_t);
-        ++pchunk;
-        ++admin->num_bufs_total;
+        return (partition_index == 0) ? pool : NULL;
     }
 
-    /*
-     * Set the bundle alloc threshold at 30% remaining (just a guess)
-     * Set the internal alloc threshold at 10% remaining
-     * The intent is to NOT allow the entire pool to be used by bundles,
-     * there must be some buffer room for refs which transport the bundles.
-     */
-    admin->bblock_alloc_threshold   = (admin->num_bufs_total * 30) / 100;
-    admin->internal_alloc_threshold = (admin->num_bufs_total * 10) / 100;
-    fprintf(stderr, "%s(): created pool of size %zu, with %u chunks, bblock threshold = %u, internal threshold = %u\n",
-            __func__, pool_size, (unsigned int)admin->num_bufs_total, (unsigned int)admin->bblock_alloc_threshold,
-            (unsigned int)admin->internal_alloc_threshold);
+    if (partition_index >= admin->num_partitions)
+    {
+        return NULL;
+    }
 
-    return pool;
+    return admin->partition_table[partition_index];
 }
@@ -34,6 +34,11 @@
 #include "v7_types.h"
 #include "v7_mpool_internal.h"
 
+/*
+ * Number of blocks handed to bplib_crc_update_list() in one call by bplib_mpool_bblock_cbor_crc_update()
+ */
+#define BPLIB_MPOOL_CRC_IOV_BATCH 16
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_mpool_bblock_primary_cast
@@ -75,8 +80,31 @@ bplib_mpool_bblock_canonical_t *bplib_mpool_bblock_canonical_cast(bplib_mpool_bl
  *-----------------------------------------------------------------*/
 void *bplib_mpool_bblock_cbor_cast(bplib_mpool_block_t *cb)
 {
+    bplib_mpool_bblock_cbor_slice_t  *slice;
+    bplib_mpool_bblock_cbor_extern_t *ext;
+    uint8_t                          *data;
+
     /* CBOR data blocks are nothing more than generic blocks with a different sig */
-    return bplib_mpool_generic_data_cast(cb, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    data = bplib_mpool_generic_data_cast(cb, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+
+    /* a slice is a ref to a CBOR data block, so the above found the data of the target */
+    slice = bplib_mpool_generic_data_cast(cb, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    if (slice != NULL && data == NULL)
+    {
+        /* or it is a ref to an external buffer, which is only ever read through slices */
+        ext = bplib_mpool_generic_data_cast(cb, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+        if (ext != NULL)
+        {
+            data = (uint8_t *)ext->data_ptr;
+        }
+    }
+
+    if (slice != NULL && data != NULL)
+    {
+        data += slice->offset;
+    }
+
+    return data;
 }
 
 /*----------------------------------------------------------------
@@ -92,7 +120,7 @@ void bplib_mpool_bblock_cbor_set_size(bplib_mpool_block_t *cb, size_t user_conte
     if (content != NULL && content->header.base_link.type == bplib_mpool_blocktype_generic &&
         content->header.content_type_signature == MPOOL_CACHE_CBOR_DATA_SIGNATURE)
     {
-        content->header.user_content_length = user_content_size;
+        content->header.base_link.user_content_length = user_content_size;
     }
 }
 
@@ -105,6 +133,12 @@ void bplib_mpool_bblock_primary_init(bplib_mpool_block_t *base_block, bplib_mpoo
 {
     bplib_mpool_init_list_head(base_block, &pblk->cblock_list);
     bplib_mpool_init_list_head(base_block, &pblk->chunk_list);
+
+    /* the primary block itself is not encoded yet */
+    pblk->unencoded_block_count = 1;
+
+    /* bundles received without any other indication are treated as normal priority */
+    pblk->data.delivery.class_of_service = BP_COS_NORMAL;
 }
 
 /*----------------------------------------------------------------
@@ -129,20 +163,27 @@ bplib_mpool_block_t *bplib_mpool_bblock_primary_alloc(bplib_mpool_t *pool, uint3
     bplib_mpool_lock_t          *lock;
     bool                         within_timeout;
 
-    lock           = bplib_mpool_lock_resource(pool);
-    within_timeout = true;
-    while (true)
+    /* first try without waiting, this may not need the lock at all */
+    result = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_primary, magic_number, init_arg, priority, 0);
+    if (result == NULL && timeout != 0)
     {
-        result =
-            bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_primary, magic_number, init_arg, priority);
-        if (result != NULL || !within_timeout)
+        /* in a partitioned pool, wait for blocks to be freed in the local partition */
+        pool           = bplib_mpool_get_local_partition(pool);
+        lock           = bplib_mpool_lock_pool(pool);
+        within_timeout = true;
+        while (true)
         {
-            break;
-        }
+            result =
+                bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_primary, magic_number, init_arg, priority);
+            if (result != NULL || !within_timeout)
+            {
+                break;
+            }
 
-        within_timeout = bplib_mpool_lock_wait(lock, timeout);
+            within_timeout = bplib_mpool_lock_wait(lock, timeout);
+        }
+        bplib_mpool_lock_release(lock);
     }
-    bplib_mpool_lock_release(lock);
 
     return (bplib_mpool_block_t *)result;
 }
@@ -155,12 +196,9 @@ bplib_mpool_block_t *bplib_mpool_bblock_primary_alloc(bplib_mpool_t *pool, uint3
 bplib_mpool_block_t *bplib_mpool_bblock_canonical_alloc(bplib_mpool_t *pool, uint32_t magic_number, void *init_arg)
 {
     bplib_mpool_block_content_t *result;
-    bplib_mpool_lock_t          *lock;
 
-    lock   = bplib_mpool_lock_resource(pool);
-    result = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_canonical, magic_number, init_arg,
-                                              BPLIB_MPOOL_ALLOC_PRI_MED);
-    bplib_mpool_lock_release(lock);
+    result = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_canonical, magic_number, init_arg,
+                                           BPLIB_MPOOL_ALLOC_PRI_MED, 0);
 
     return (bplib_mpool_block_t *)result;
 }
@@ -171,16 +209,221 @@ bplib_mpool_block_t *bplib_mpool_bblock_canonical_alloc(bplib_mpool_t *pool, uin
  *
  *-----------------------------------------------------------------*/
 bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc(bplib_mpool_t *pool)
+{
+    return bplib_mpool_bblock_cbor_alloc_sized(pool, 0);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_alloc_sized
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc_sized(bplib_mpool_t *pool, size_t size_hint)
 {
     bplib_mpool_block_content_t *result;
+
+    /*
+     * CBOR data is written in many small pieces, so a hint that fits in a standard block
+     * is not useful here - it would only create a long chain of small blocks.  Only the
+     * hint for a big chunk of data is passed on, so that a large block may be used.
+     */
+    if (size_hint <= MPOOL_GET_BLOCK_USER_CAPACITY(generic_data))
+    {
+        size_hint = 0;
+    }
+
+    result = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE, NULL,
+                                           BPLIB_MPOOL_ALLOC_PRI_MED, size_hint);
+
+    return (bplib_mpool_block_t *)result;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_alloc_n
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_bblock_cbor_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, size_t total_size)
+{
+    bplib_mpool_block_content_t *blk;
     bplib_mpool_lock_t          *lock;
+    size_t                       size_hint;
+    size_t                       capacity;
+
+    assert(bplib_mpool_is_list_head(list));
+
+    /* the whole batch comes from one partition, so it only needs the one lock */
+    pool     = bplib_mpool_get_local_partition(pool);
+    capacity = 0;
+    lock     = bplib_mpool_lock_pool(pool);
+    while (capacity < total_size)
+    {
+        /* same as bplib_mpool_bblock_cbor_alloc_sized(), only pass on hints for big data */
+        size_hint = total_size - capacity;
+        if (size_hint <= MPOOL_GET_BLOCK_USER_CAPACITY(generic_data))
+        {
+            size_hint = 0;
+        }
 
-    lock   = bplib_mpool_lock_resource(pool);
-    result = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE,
-                                              NULL, BPLIB_MPOOL_ALLOC_PRI_MED);
+        blk = bplib_mpool_alloc_sized_block_internal(pool, bplib_mpool_blocktype_generic,
+                                                     MPOOL_CACHE_CBOR_DATA_SIGNATURE, NULL, BPLIB_MPOOL_ALLOC_PRI_MED,
+                                                     size_hint);
+        if (blk == NULL)
+        {
+            break;
+        }
+
+        bplib_mpool_insert_before(list, &blk->header.base_link);
+        capacity += bplib_mpool_get_generic_data_capacity(&blk->header.base_link);
+    }
     bplib_mpool_lock_release(lock);
 
-    return (bplib_mpool_block_t *)result;
+    return capacity;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_slice_init
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_bblock_cbor_slice_init(bplib_mpool_t *pool)
+{
+    return bplib_mpool_register_blocktype(pool, MPOOL_CACHE_CBOR_SLICE_SIGNATURE, NULL,
+                                          sizeof(bplib_mpool_bblock_cbor_slice_t));
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_slice_alloc
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_slice_alloc(bplib_mpool_ref_t buffer_ref, size_t offset, size_t length)
+{
+    bplib_mpool_block_t              *sblk;
+    bplib_mpool_block_content_t      *content;
+    bplib_mpool_bblock_cbor_slice_t  *slice;
+    bplib_mpool_bblock_cbor_extern_t *ext;
+    size_t                            buffer_size;
+
+    /* the slice must be within the data that is in the buffer */
+    ext = bplib_mpool_generic_data_cast(bplib_mpool_dereference(buffer_ref), MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    if (ext != NULL)
+    {
+        buffer_size = ext->data_size;
+    }
+    else if (bplib_mpool_generic_data_cast(bplib_mpool_dereference(buffer_ref), MPOOL_CACHE_CBOR_DATA_SIGNATURE) !=
+             NULL)
+    {
+        buffer_size = bplib_mpool_get_user_content_size(bplib_mpool_dereference(buffer_ref));
+    }
+    else
+    {
+        return NULL;
+    }
+
+    if (offset > buffer_size || length > (buffer_size - offset) || length > UINT16_MAX)
+    {
+        return NULL;
+    }
+
+    /* this holds a ref to the buffer, which is released when the slice is recycled */
+    sblk  = bplib_mpool_ref_make_block(buffer_ref, MPOOL_CACHE_CBOR_SLICE_SIGNATURE, NULL);
+    slice = bplib_mpool_generic_data_cast(sblk, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    if (slice == NULL)
+    {
+        /* the slice blocktype was not registered, or no memory */
+        if (sblk != NULL)
+        {
+            bplib_mpool_recycle_block(sblk);
+        }
+        return NULL;
+    }
+
+    slice->offset = offset;
+
+    content                                       = bplib_mpool_get_block_content(sblk);
+    content->header.base_link.user_content_length = length;
+
+    return sblk;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_extern_construct
+ *
+ *-----------------------------------------------------------------*/
+static int bplib_mpool_bblock_cbor_extern_construct(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_mpool_bblock_cbor_extern_t *ext;
+
+    ext = bplib_mpool_generic_data_cast_unchecked(blk, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    if (ext == NULL || arg == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    *ext = *((const bplib_mpool_bblock_cbor_extern_t *)arg);
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_extern_destruct
+ *
+ *-----------------------------------------------------------------*/
+static int bplib_mpool_bblock_cbor_extern_destruct(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_mpool_bblock_cbor_extern_t *ext;
+
+    ext = bplib_mpool_generic_data_cast_unchecked(blk, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    if (ext == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* nothing in the pool refers to the buffer anymore, so the owner can have it back */
+    if (ext->release_func != NULL)
+    {
+        ext->release_func(ext->release_arg, ext->data_ptr, ext->data_size);
+        ext->release_func = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_extern_init
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_bblock_cbor_extern_init(bplib_mpool_t *pool)
+{
+    const bplib_mpool_blocktype_api_t extern_api = (bplib_mpool_blocktype_api_t) {
+        .construct = bplib_mpool_bblock_cbor_extern_construct,
+        .destruct  = bplib_mpool_bblock_cbor_extern_destruct,
+    };
+
+    return bplib_mpool_register_blocktype(pool, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE, &extern_api,
+                                          sizeof(bplib_mpool_bblock_cbor_extern_t));
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_extern_alloc
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_extern_alloc(bplib_mpool_t *pool, const void *data_ptr, size_t data_size,
+                                                          bplib_payload_release_func_t release_func,
+                                                          void                        *release_arg)
+{
+    bplib_mpool_bblock_cbor_extern_t init_ext;
+
+    init_ext.data_ptr     = data_ptr;
+    init_ext.data_size    = data_size;
+    init_ext.release_func = release_func;
+    init_ext.release_arg  = release_arg;
+
+    return bplib_mpool_generic_data_alloc(pool, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE, &init_ext);
 }
 
 /*----------------------------------------------------------------
@@ -195,6 +438,106 @@ void bplib_mpool_bblock_cbor_append(bplib_mpool_block_t *head, bplib_mpool_block
     bplib_mpool_insert_before(head, blk);
 }
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_share_chunk
+ *
+ * Makes another slice of the same data as a CBOR data block in a list.  A plain
+ * data block in the list is swapped for a slice of itself first.
+ *
+ *-----------------------------------------------------------------*/
+static bplib_mpool_block_t *bplib_mpool_bblock_cbor_share_chunk(bplib_mpool_block_t *blk)
+{
+    bplib_mpool_block_content_t     *content;
+    bplib_mpool_bblock_cbor_slice_t *slice;
+    bplib_mpool_block_t             *next;
+    bplib_mpool_block_t             *sblk;
+    bplib_mpool_ref_t                buffer_ref;
+    size_t                           offset;
+
+    slice = bplib_mpool_generic_data_cast(blk, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    if (slice != NULL)
+    {
+        offset = slice->offset;
+    }
+    else
+    {
+        if (bplib_mpool_generic_data_cast(blk, MPOOL_CACHE_CBOR_DATA_SIGNATURE) == NULL)
+        {
+            return NULL;
+        }
+
+        /* the block has to be out of the list to be refcounted, its slice goes in the same place */
+        next = bplib_mpool_get_next_block(blk);
+        bplib_mpool_extract_node(blk);
+        buffer_ref = bplib_mpool_ref_create(blk);
+        sblk       = bplib_mpool_bblock_cbor_slice_alloc(buffer_ref, 0, bplib_mpool_get_user_content_size(blk));
+        if (sblk == NULL)
+        {
+            /* nothing else was given the ref, so it can go back as the plain block it was */
+            content                  = bplib_mpool_get_block_content(blk);
+            content->header.refcount = 0;
+            bplib_mpool_insert_before(next, blk);
+            return NULL;
+        }
+
+        /* from here the slice holds the only ref */
+        bplib_mpool_insert_before(next, sblk);
+        bplib_mpool_ref_release(buffer_ref);
+        blk    = sblk;
+        offset = 0;
+    }
+
+    buffer_ref = bplib_mpool_ref_from_block(blk);
+    sblk       = bplib_mpool_bblock_cbor_slice_alloc(buffer_ref, offset, bplib_mpool_get_user_content_size(blk));
+    bplib_mpool_ref_release(buffer_ref);
+
+    return sblk;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_share
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_bblock_cbor_share(bplib_mpool_block_t *dst_list, bplib_mpool_block_t *src_list)
+{
+    bplib_mpool_block_t *blk;
+    bplib_mpool_block_t *next;
+    bplib_mpool_block_t *sblk;
+    bplib_mpool_block_t  new_list;
+
+    /* the slices are gathered separately, so they can all be put back if one cannot be made */
+    bplib_mpool_init_list_head(NULL, &new_list);
+
+    blk = bplib_mpool_get_next_block(src_list);
+    while (blk != src_list)
+    {
+        next = bplib_mpool_get_next_block(blk);
+        sblk = bplib_mpool_bblock_cbor_share_chunk(blk);
+        if (sblk == NULL)
+        {
+            if (bplib_mpool_is_nonempty_list_head(&new_list))
+            {
+                bplib_mpool_recycle_all_blocks_in_list(bplib_mpool_get_parent_pool_from_link(src_list), &new_list);
+            }
+            return BP_ERROR;
+        }
+
+        bplib_mpool_insert_before(&new_list, sblk);
+        blk = next;
+    }
+
+    if (bplib_mpool_is_nonempty_list_head(&new_list))
+    {
+        /* this moves the slices to the end of dst_list, and leaves the temporary head by itself */
+        bplib_mpool_merge_list(dst_list, &new_list);
+        bplib_mpool_extract_node(&new_list);
+    }
+
+    return BP_SUCCESS;
+}
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_mpool_bblock_primary_drop_encode
@@ -210,10 +553,78 @@ void bplib_mpool_bblock_primary_drop_encode(bplib_mpool_bblock_primary_t *cpb)
     {
         bplib_mpool_recycle_all_blocks_in_list(NULL, elist);
     }
-    cpb->block_encode_size_cache  = 0;
+    bplib_mpool_bblock_primary_set_encode_size(cpb, 0);
     cpb->bundle_encode_size_cache = 0;
 }
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_primary_quota_charge
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_bblock_primary_quota_charge(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t flow_ref,
+                                             size_t size)
+{
+    bplib_mpool_flow_t *flow;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(flow_ref));
+    if (flow == NULL || cpb->data.delivery.quota_ref != NULL ||
+        __atomic_load_n(&flow->quota.limit, __ATOMIC_RELAXED) == 0)
+    {
+        return;
+    }
+
+    cpb->data.delivery.quota_ref = bplib_mpool_ref_duplicate(flow_ref);
+    if (cpb->data.delivery.quota_ref != NULL)
+    {
+        cpb->data.delivery.quota_charge = size;
+        __atomic_fetch_add(&flow->quota.used, size, __ATOMIC_RELAXED);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_primary_quota_release
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_bblock_primary_quota_release(bplib_mpool_bblock_primary_t *cpb)
+{
+    bplib_mpool_flow_t *flow;
+
+    if (cpb->data.delivery.quota_ref == NULL)
+    {
+        return;
+    }
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_dereference(cpb->data.delivery.quota_ref));
+    if (flow != NULL)
+    {
+        __atomic_fetch_sub(&flow->quota.used, cpb->data.delivery.quota_charge, __ATOMIC_RELAXED);
+    }
+
+    bplib_mpool_ref_release(cpb->data.delivery.quota_ref);
+    cpb->data.delivery.quota_ref    = NULL;
+    cpb->data.delivery.quota_charge = 0;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_primary_drop_canonical_blocks
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_bblock_primary_drop_canonical_blocks(bplib_mpool_bblock_primary_t *cpb)
+{
+    if (bplib_mpool_is_nonempty_list_head(&cpb->cblock_list))
+    {
+        bplib_mpool_recycle_all_blocks_in_list(NULL, &cpb->cblock_list);
+    }
+
+    /* only the primary block is left to count */
+    cpb->encoded_blocks_size   = cpb->block_encode_size_cache;
+    cpb->unencoded_block_count = (cpb->block_encode_size_cache == 0);
+    bplib_mpool_bblock_primary_adjust_encode_size(cpb, 0, 0);
+}
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_mpool_bblock_canonical_drop_encode
@@ -229,13 +640,9 @@ void bplib_mpool_bblock_canonical_drop_encode(bplib_mpool_bblock_canonical_t *cc
     {
         bplib_mpool_recycle_all_blocks_in_list(NULL, elist);
     }
-    ccb->block_encode_size_cache = 0;
 
     /* this also invalidates the size of the parent bundle, if it was in one */
-    if (ccb->bundle_ref)
-    {
-        ccb->bundle_ref->bundle_encode_size_cache = 0;
-    }
+    bplib_mpool_bblock_canonical_set_encode_size(ccb, 0);
 }
 
 /*----------------------------------------------------------------
@@ -305,6 +712,238 @@ size_t bplib_mpool_bblock_cbor_export(bplib_mpool_block_t *list, void *out_ptr,
     return max_out_size - remain_sz;
 }
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_export_iov
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_bblock_cbor_export_iov(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov)
+{
+    bplib_mpool_block_t *blk;
+    const uint8_t       *src_ptr;
+    size_t               chunk_sz;
+    size_t               iov_count;
+
+    iov_count = 0;
+    blk       = list;
+    while (true)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        if (blk == list)
+        {
+            break;
+        }
+        src_ptr = bplib_mpool_bblock_cbor_cast(blk);
+        if (src_ptr == NULL)
+        {
+            break;
+        }
+        chunk_sz = bplib_mpool_get_user_content_size(blk);
+        if (chunk_sz == 0)
+        {
+            continue;
+        }
+
+        if (iov_count < max_iov)
+        {
+            iov[iov_count].base = src_ptr;
+            iov[iov_count].len  = chunk_sz;
+        }
+        ++iov_count;
+    }
+
+    return iov_count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_export_iov_range
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_bblock_cbor_export_iov_range(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov,
+                                                size_t seek_start, size_t max_count)
+{
+    bplib_mpool_block_t *blk;
+    const uint8_t       *src_ptr;
+    size_t               chunk_sz;
+    size_t               seek_left;
+    size_t               data_left;
+    size_t               iov_count;
+
+    iov_count = 0;
+    seek_left = seek_start;
+    data_left = max_count;
+    blk       = list;
+    while (data_left > 0)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        if (blk == list)
+        {
+            break;
+        }
+        src_ptr = bplib_mpool_bblock_cbor_cast(blk);
+        if (src_ptr == NULL)
+        {
+            break;
+        }
+        chunk_sz = bplib_mpool_get_user_content_size(blk);
+        if (seek_left >= chunk_sz)
+        {
+            seek_left -= chunk_sz;
+            continue;
+        }
+
+        src_ptr += seek_left;
+        chunk_sz -= seek_left;
+        seek_left = 0;
+
+        if (chunk_sz > data_left)
+        {
+            chunk_sz = data_left;
+        }
+
+        if (iov_count < max_iov)
+        {
+            iov[iov_count].base = src_ptr;
+            iov[iov_count].len  = chunk_sz;
+        }
+        ++iov_count;
+        data_left -= chunk_sz;
+    }
+
+    return iov_count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_crc_update
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_bblock_cbor_crc_update(bplib_mpool_block_t *list, bplib_crc_parameters_t *params,
+                                          bp_crcval_t *crc, size_t seek_start, size_t max_count)
+{
+    bplib_iovec_t        iov[BPLIB_MPOOL_CRC_IOV_BATCH];
+    bplib_mpool_block_t *blk;
+    const uint8_t       *src_ptr;
+    size_t               chunk_sz;
+    size_t               seek_left;
+    size_t               data_left;
+    size_t               iov_count;
+
+    /* this is the same walk as bplib_mpool_bblock_cbor_export_iov_range(), digesting each full batch */
+    iov_count = 0;
+    seek_left = seek_start;
+    data_left = max_count;
+    blk       = list;
+    while (data_left > 0)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        if (blk == list)
+        {
+            break;
+        }
+        src_ptr = bplib_mpool_bblock_cbor_cast(blk);
+        if (src_ptr == NULL)
+        {
+            break;
+        }
+        chunk_sz = bplib_mpool_get_user_content_size(blk);
+        if (seek_left >= chunk_sz)
+        {
+            seek_left -= chunk_sz;
+            continue;
+        }
+
+        src_ptr += seek_left;
+        chunk_sz -= seek_left;
+        seek_left = 0;
+
+        if (chunk_sz > data_left)
+        {
+            chunk_sz = data_left;
+        }
+
+        if (iov_count == BPLIB_MPOOL_CRC_IOV_BATCH)
+        {
+            *crc      = bplib_crc_update_list(params, *crc, iov, iov_count);
+            iov_count = 0;
+        }
+
+        iov[iov_count].base = src_ptr;
+        iov[iov_count].len  = chunk_sz;
+        ++iov_count;
+        data_left -= chunk_sz;
+    }
+
+    if (iov_count > 0)
+    {
+        *crc = bplib_crc_update_list(params, *crc, iov, iov_count);
+    }
+
+    return max_count - data_left;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_overwrite
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_bblock_cbor_overwrite(bplib_mpool_block_t *list, const void *in_ptr, size_t seek_start,
+                                         size_t count)
+{
+    bplib_mpool_block_t *blk;
+    uint8_t             *dst_ptr;
+    const uint8_t       *curr_ptr;
+    size_t               chunk_sz;
+    size_t               seek_left;
+    size_t               data_left;
+
+    curr_ptr  = in_ptr;
+    seek_left = seek_start;
+    data_left = count;
+    blk       = list;
+    while (data_left > 0)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        if (blk == list)
+        {
+            break;
+        }
+
+        /* slices may be shared with other bundles, or point at application memory, so only plain data is changed */
+        if (bplib_mpool_generic_data_cast(blk, MPOOL_CACHE_CBOR_SLICE_SIGNATURE) != NULL)
+        {
+            break;
+        }
+        dst_ptr = bplib_mpool_bblock_cbor_cast(blk);
+        if (dst_ptr == NULL)
+        {
+            break;
+        }
+        chunk_sz = bplib_mpool_get_user_content_size(blk);
+        if (seek_left >= chunk_sz)
+        {
+            seek_left -= chunk_sz;
+            continue;
+        }
+
+        dst_ptr += seek_left;
+        chunk_sz -= seek_left;
+        seek_left = 0;
+
+        if (chunk_sz > data_left)
+        {
+            chunk_sz = data_left;
+        }
+
+        memcpy(dst_ptr, curr_ptr, chunk_sz);
+        curr_ptr += chunk_sz;
+        data_left -= chunk_sz;
+    }
+
+    return count - data_left;
+}
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_mpool_bblock_primary_append
@@ -337,9 +976,216 @@ void bplib_mpool_bblock_primary_append(bplib_mpool_bblock_primary_t *cpb, bplib_
         bplib_mpool_insert_after(&cpb->cblock_list, blk);
     }
 
-    /* this changes the size of the fully-encoded bundle, but don't recalculate now */
-    cpb->bundle_encode_size_cache = 0;
-    ccb->bundle_ref               = cpb;
+    /* the size of the bundle is only known if this block is already encoded too */
+    cpb->encoded_blocks_size += ccb->block_encode_size_cache;
+    if (ccb->block_encode_size_cache == 0)
+    {
+        ++cpb->unencoded_block_count;
+    }
+    bplib_mpool_bblock_primary_adjust_encode_size(cpb, 0, 0);
+    ccb->bundle_ref = cpb;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_canonical_is_per_hop
+ *
+ * Whether the content of the block is updated by every node that forwards the bundle
+ *
+ *-----------------------------------------------------------------*/
+static inline bool bplib_mpool_bblock_canonical_is_per_hop(const bplib_mpool_bblock_canonical_t *ccb)
+{
+    switch (ccb->canonical_logical_data.canonical_block.blockType)
+    {
+        case bp_blocktype_previousNode:
+        case bp_blocktype_bundleAge:
+        case bp_blocktype_hopCount:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_primary_share_copy
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_bblock_primary_share_copy(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t *cpb,
+                                                           uint8_t priority, uint64_t timeout)
+{
+    bplib_mpool_block_t            *pblk;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_block_t            *src_cblk;
+    bplib_mpool_bblock_primary_t   *copy_cpb;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bplib_mpool_bblock_canonical_t *src_ccb;
+    int                             status;
+
+    pblk     = bplib_mpool_bblock_primary_alloc(pool, 0, NULL, priority, timeout);
+    copy_cpb = bplib_mpool_bblock_primary_cast(pblk);
+    if (copy_cpb == NULL)
+    {
+        return NULL;
+    }
+
+    /* the copy is a new instance of the bundle at this node, so only the ingress side is the same */
+    copy_cpb->data.logical                      = cpb->data.logical;
+    copy_cpb->data.delivery.delivery_policy     = cpb->data.delivery.delivery_policy;
+    copy_cpb->data.delivery.class_of_service    = cpb->data.delivery.class_of_service;
+    copy_cpb->data.delivery.ingress_intf_id     = cpb->data.delivery.ingress_intf_id;
+    copy_cpb->data.delivery.ingress_time        = cpb->data.delivery.ingress_time;
+    copy_cpb->data.delivery.crc_deferred        = cpb->data.delivery.crc_deferred;
+    copy_cpb->data.delivery.local_retx_interval = cpb->data.delivery.local_retx_interval;
+    memcpy(copy_cpb->data.delivery.stage_time, cpb->data.delivery.stage_time, sizeof(cpb->data.delivery.stage_time));
+
+    status = bplib_mpool_bblock_cbor_share(&copy_cpb->chunk_list, &cpb->chunk_list);
+    if (status == BP_SUCCESS)
+    {
+        bplib_mpool_bblock_primary_set_encode_size(copy_cpb, cpb->block_encode_size_cache);
+    }
+
+    src_cblk = bplib_mpool_get_next_block(&cpb->cblock_list);
+    while (status == BP_SUCCESS && src_cblk != &cpb->cblock_list)
+    {
+        src_ccb = bplib_mpool_bblock_canonical_cast_unchecked(src_cblk);
+        cblk    = bplib_mpool_bblock_canonical_alloc(pool, 0, NULL);
+        ccb     = bplib_mpool_bblock_canonical_cast(cblk);
+        if (src_ccb == NULL || ccb == NULL)
+        {
+            if (cblk != NULL)
+            {
+                bplib_mpool_recycle_block(cblk);
+            }
+            status = BP_ERROR;
+            break;
+        }
+
+        ccb->canonical_logical_data = src_ccb->canonical_logical_data;
+        if (!bplib_mpool_bblock_canonical_is_per_hop(src_ccb))
+        {
+            status = bplib_mpool_bblock_cbor_share(&ccb->chunk_list, &src_ccb->chunk_list);
+            if (status != BP_SUCCESS)
+            {
+                bplib_mpool_recycle_block(cblk);
+                break;
+            }
+
+            /* this is before the append, which counts it in the size of the bundle */
+            ccb->block_encode_size_cache = src_ccb->block_encode_size_cache;
+            ccb->encoded_content_offset  = src_ccb->encoded_content_offset;
+            ccb->encoded_content_length  = src_ccb->encoded_content_length;
+        }
+
+        bplib_mpool_bblock_primary_append(copy_cpb, cblk);
+        src_cblk = bplib_mpool_get_next_block(src_cblk);
+    }
+
+    if (status != BP_SUCCESS)
+    {
+        /* this also recycles the canonical blocks and slices that were made for it */
+        bplib_mpool_recycle_block(pblk);
+        pblk = NULL;
+    }
+
+    return pblk;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_cbor_add_footprint
+ *
+ * Adds the blocks in a chain of CBOR data to the footprint.  last_buffer is the buffer of the
+ * slice before, carried from one chain to the next so that a buffer is only counted once.
+ *-----------------------------------------------------------------*/
+static size_t bplib_mpool_bblock_cbor_add_footprint(bplib_mpool_block_t *list, uint32_t *block_count,
+                                                    const bplib_mpool_block_content_t **last_buffer)
+{
+    bplib_mpool_block_t               *blk;
+    const bplib_mpool_block_content_t *content;
+    size_t                             total;
+
+    total = 0;
+    blk   = list;
+    while (true)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        if (blk == list)
+        {
+            break;
+        }
+
+        content = bplib_mpool_get_block_content_const(blk);
+        if (content == NULL)
+        {
+            break;
+        }
+
+        total += bplib_mpool_get_block_footprint(blk);
+        ++(*block_count);
+
+        /* a slice keeps its whole buffer in the pool */
+        if (content->header.base_link.type == bplib_mpool_blocktype_ref && content->u.ref.pref_target != *last_buffer)
+        {
+            *last_buffer = content->u.ref.pref_target;
+            total += bplib_mpool_get_block_footprint(&(*last_buffer)->header.base_link);
+            ++(*block_count);
+        }
+    }
+
+    return total;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_bblock_primary_get_footprint
+ *
+ *-----------------------------------------------------------------*/
+size_t bplib_mpool_bblock_primary_get_footprint(bplib_mpool_bblock_primary_t *cpb, uint32_t *block_count)
+{
+    const bplib_mpool_block_content_t *last_buffer;
+    bplib_mpool_block_content_t       *content;
+    bplib_mpool_block_t               *cblk;
+    bplib_mpool_bblock_canonical_t    *ccb;
+    size_t                             total;
+    uint32_t                           count;
+
+    /* the block holding the primary block itself */
+    content = (bplib_mpool_block_content_t *)(void *)((uint8_t *)cpb -
+                                                      offsetof(bplib_mpool_block_content_t, u.primary.pblock));
+    total   = bplib_mpool_get_block_footprint(&content->header.base_link);
+    count   = 1;
+
+    last_buffer = NULL;
+    total += bplib_mpool_bblock_cbor_add_footprint(bplib_mpool_bblock_primary_get_encoded_chunks(cpb), &count,
+                                                   &last_buffer);
+
+    cblk = bplib_mpool_bblock_primary_get_canonical_list(cpb);
+    while (true)
+    {
+        cblk = bplib_mpool_get_next_block(cblk);
+        if (bplib_mpool_is_list_head(cblk))
+        {
+            break;
+        }
+        ccb = bplib_mpool_bblock_canonical_cast_unchecked(cblk);
+        if (ccb == NULL)
+        {
+            break;
+        }
+
+        total += bplib_mpool_get_block_footprint(cblk);
+        ++count;
+        total += bplib_mpool_bblock_cbor_add_footprint(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), &count,
+                                                       &last_buffer);
+    }
+
+    if (block_count != NULL)
+    {
+        *block_count = count;
+    }
+
+    return total;
 }
 
 bplib_mpool_block_t *bplib_mpool_bblock_primary_locate_canonical(bplib_mpool_bblock_primary_t *cpb,
@@ -361,7 +1207,7 @@ bplib_mpool_block_t *bplib_mpool_bblock_primary_locate_canonical(bplib_mpool_bbl
             cblk = NULL;
             break;
         }
-        ccb = bplib_mpool_bblock_canonical_cast(cblk);
+        ccb = bplib_mpool_bblock_canonical_cast_unchecked(cblk);
         if (ccb != NULL && ccb->canonical_logical_data.canonical_block.blockType == block_type)
         {
             /* found it */
@@ -53,6 +53,25 @@ void bplib_mpool_subq_workitem_init(bplib_mpool_block_t *base_block, bplib_mpool
     wblk->current_depth_limit = 0;
 }
 
+static void bplib_mpool_flow_report_watermark(bplib_mpool_flow_t *flow, bplib_mpool_block_t *fblk,
+                                              bplib_mpool_subq_workitem_t *subq, uint32_t flag)
+{
+    bplib_mpool_flow_generic_event_t event;
+
+    if (flow->current_state_flags & flag)
+    {
+        event.watermark.event_type = bplib_mpool_flow_event_high_watermark;
+    }
+    else
+    {
+        event.watermark.event_type = bplib_mpool_flow_event_low_watermark;
+    }
+
+    event.watermark.intf_id = bplib_mpool_get_external_id(fblk);
+    event.watermark.subq    = subq;
+    flow->statechange_job.event_handler(&event, fblk);
+}
+
 static int bplib_mpool_flow_event_handler(void *arg, bplib_mpool_block_t *jblk)
 {
     bplib_mpool_block_t             *fblk;
@@ -62,8 +81,9 @@ static int bplib_mpool_flow_event_handler(void *arg, bplib_mpool_block_t *jblk)
     bool                             was_running;
     bool                             is_running;
 
+    /* this handler is only set on the statechange job of a flow */
     fblk = bplib_mpool_get_block_from_link(jblk);
-    flow = bplib_mpool_flow_cast(fblk);
+    flow = bplib_mpool_flow_cast_unchecked(fblk);
     if (flow == NULL)
     {
         return -1;
@@ -97,6 +117,23 @@ static int bplib_mpool_flow_event_handler(void *arg, bplib_mpool_block_t *jblk)
         flow->statechange_job.event_handler(&event, fblk);
     }
 
+    if (changed_flags & BPLIB_MPOOL_FLOW_FLAGS_ROUTES)
+    {
+        event.event_type = bplib_mpool_flow_event_route_change;
+        flow->statechange_job.event_handler(&event, fblk);
+    }
+
+    /* a queue crossing a watermark is reported once per crossing, the flag is the hysteresis state */
+    if (changed_flags & BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH)
+    {
+        bplib_mpool_flow_report_watermark(flow, fblk, &flow->ingress, BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH);
+    }
+
+    if (changed_flags & BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH)
+    {
+        bplib_mpool_flow_report_watermark(flow, fblk, &flow->egress, BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH);
+    }
+
     return 0;
 }
 
@@ -110,8 +147,85 @@ void bplib_mpool_flow_init(bplib_mpool_block_t *base_block, bplib_mpool_flow_t *
     /* now init the link structs */
     bplib_mpool_job_init(base_block, &fblk->statechange_job.base_job);
     fblk->statechange_job.base_job.handler = bplib_mpool_flow_event_handler;
+    fblk->poll_time                        = BP_DTNTIME_INFINITE;
+    bplib_mpool_init_secondary_link(base_block, &fblk->poll_link, bplib_mpool_blocktype_secondary_generic);
     bplib_mpool_subq_workitem_init(base_block, &fblk->ingress);
     bplib_mpool_subq_workitem_init(base_block, &fblk->egress);
+    bplib_mpool_reserve_init(base_block, &fblk->reserve);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_bands_classify
+ *
+ *-----------------------------------------------------------------*/
+static bplib_mpool_subq_band_t *bplib_mpool_subq_bands_classify(bplib_mpool_subq_bands_t *bands,
+                                                                bplib_mpool_block_t      *qblk)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    uint32_t                      band_idx;
+
+    /* anything that is not a bundle goes in the lowest band */
+    band_idx  = 0;
+    pri_block = bplib_mpool_bblock_primary_cast(qblk);
+    if (pri_block != NULL)
+    {
+        band_idx = pri_block->data.delivery.class_of_service;
+        if (band_idx >= bands->num_bands)
+        {
+            band_idx = bands->num_bands - 1;
+        }
+    }
+
+    return &bands->band[band_idx];
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_bands_select
+ *
+ * Internal function, picks the band to pull the next entry from, or NULL if all are empty
+ *
+ *-----------------------------------------------------------------*/
+static bplib_mpool_subq_band_t *bplib_mpool_subq_bands_select(bplib_mpool_subq_bands_t *bands)
+{
+    bplib_mpool_subq_band_t *band;
+    uint32_t                 i;
+
+    if (bands->dequeue_mode == BPLIB_MPOOL_BANDS_DEQUEUE_WEIGHTED)
+    {
+        /* this may need to go all the way around, back to the current band with new credit */
+        for (i = 0; i <= bands->num_bands; ++i)
+        {
+            band = &bands->band[bands->curr_band];
+            if (bands->curr_credit > 0 && bplib_mpool_subq_get_depth(&band->subq) != 0)
+            {
+                --bands->curr_credit;
+                return band;
+            }
+
+            /* on to the next lower band, any credit left in an empty band is not kept */
+            if (bands->curr_band == 0)
+            {
+                bands->curr_band = bands->num_bands;
+            }
+            --bands->curr_band;
+            bands->curr_credit = bands->band[bands->curr_band].weight;
+        }
+    }
+    else
+    {
+        for (i = bands->num_bands; i > 0; --i)
+        {
+            band = &bands->band[i - 1];
+            if (bplib_mpool_subq_get_depth(&band->subq) != 0)
+            {
+                return band;
+            }
+        }
+    }
+
+    return NULL;
 }
 
 /*----------------------------------------------------------------
@@ -227,6 +341,67 @@ bplib_mpool_block_t *bplib_mpool_subq_pull_single(bplib_mpool_subq_base_t *subq)
     return node;
 }
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_pull_n
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_subq_pull_n(bplib_mpool_subq_base_t *subq, bplib_mpool_block_t *list, uint32_t limit)
+{
+    bplib_mpool_block_t *node;
+    uint32_t             count;
+
+    count = 0;
+    while (count < limit)
+    {
+        /* if the head is reached here, then the list is empty */
+        node = subq->block_list.next;
+        if (bplib_mpool_is_list_head(node))
+        {
+            break;
+        }
+
+        bplib_mpool_extract_node(node);
+        bplib_mpool_insert_before(list, node);
+        ++count;
+    }
+
+    /* the counter is only updated once for the whole batch */
+    subq->pull_count += count;
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_push_n
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_subq_push_n(bplib_mpool_subq_base_t *subq, bplib_mpool_block_t *list, uint32_t limit)
+{
+    bplib_mpool_block_t *node;
+    uint32_t             count;
+
+    count = 0;
+    while (count < limit)
+    {
+        node = list->next;
+        if (bplib_mpool_is_list_head(node))
+        {
+            break;
+        }
+
+        bplib_mpool_extract_node(node);
+        bplib_mpool_insert_before(&subq->block_list, node);
+        ++count;
+    }
+
+    /* the counter is only updated once for the whole batch */
+    subq->push_count += count;
+
+    return count;
+}
+
 /*----------------------------------------------------------------
  *
  * Function: bplib_mpool_flow_cast
@@ -247,219 +422,1502 @@ bplib_mpool_flow_t *bplib_mpool_flow_cast(bplib_mpool_block_t *cb)
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_subq_workitem_wait_for_space
+ * Function: bplib_mpool_subq_workitem_notify_fill
  *
  * Internal function, lock must be held when invoked
  *
  *-----------------------------------------------------------------*/
-bool bplib_mpool_subq_workitem_wait_for_space(bplib_mpool_lock_t *lock, bplib_mpool_subq_workitem_t *subq,
-                                              uint32_t quantity, uint64_t abs_timeout)
+static inline void bplib_mpool_subq_workitem_notify_fill(bplib_mpool_subq_workitem_t *subq)
 {
-    uint32_t next_depth;
-    bool     within_timeout;
-
-    /* future depth after adding given quantity */
-    next_depth     = bplib_mpool_subq_get_depth(&subq->base_subq) + quantity;
-    within_timeout = (abs_timeout != 0);
-    while (next_depth > subq->current_depth_limit && within_timeout)
+    /* the channel is only touched if a thread is actually waiting for this queue */
+    if (subq->fill_waiters != 0)
     {
-        /* adding given quantity would overfill, wait for something else to pull */
-        within_timeout = bplib_mpool_lock_wait(lock, abs_timeout);
-        next_depth     = bplib_mpool_subq_get_depth(&subq->base_subq) + quantity;
+        bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_prepare(&subq->fill_waiters));
     }
-
-    return (next_depth <= subq->current_depth_limit);
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_subq_workitem_wait_for_fill
+ * Function: bplib_mpool_subq_workitem_notify_space
  *
  * Internal function, lock must be held when invoked
  *
  *-----------------------------------------------------------------*/
-bool bplib_mpool_subq_workitem_wait_for_fill(bplib_mpool_lock_t *lock, bplib_mpool_subq_workitem_t *subq,
-                                             uint32_t quantity, uint64_t abs_timeout)
+static inline void bplib_mpool_subq_workitem_notify_space(bplib_mpool_subq_workitem_t *subq)
 {
-    uint32_t curr_depth;
-    bool     within_timeout;
-
-    curr_depth     = bplib_mpool_subq_get_depth(&subq->base_subq);
-    within_timeout = (abs_timeout != 0);
-    while (curr_depth < quantity && within_timeout)
+    if (subq->space_waiters != 0)
     {
-        within_timeout = bplib_mpool_lock_wait(lock, abs_timeout);
-        curr_depth     = bplib_mpool_subq_get_depth(&subq->base_subq);
+        bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_prepare(&subq->space_waiters));
     }
-
-    return (curr_depth >= quantity);
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_flow_try_push
+ * Function: bplib_mpool_subq_workitem_update_high_flag
+ *
+ * Internal function, lock must be held when invoked.  This nests the pool lock
+ * if the flag has to change, so the pool lock must not be held.
  *
  *-----------------------------------------------------------------*/
-bool bplib_mpool_flow_try_push(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_block_t *qblk, uint64_t abs_timeout)
+static void bplib_mpool_subq_workitem_update_high_flag(bplib_mpool_subq_workitem_t *subq, bool is_high)
 {
-    bplib_mpool_lock_t                *lock;
-    bool                               got_space;
-    bplib_mpool_block_admin_content_t *admin;
-    bplib_mpool_t                     *pool;
-
-    pool  = bplib_mpool_get_parent_pool_from_link(&subq_dst->job_header.link);
-    admin = bplib_mpool_get_admin(pool);
-    lock  = bplib_mpool_lock_resource(pool);
+    bplib_mpool_block_t *fblk;
+    bplib_mpool_flow_t  *flow;
+    uint32_t             flag;
 
-    got_space = bplib_mpool_subq_workitem_wait_for_space(lock, subq_dst, 1, abs_timeout);
-    if (got_space)
+    fblk = bplib_mpool_get_block_from_link(&subq->job_header.link);
+    flow = bplib_mpool_flow_cast_unchecked(fblk);
+    if (flow == NULL)
     {
-        /* this does not fail, but must be done under lock to keep things consistent */
-        bplib_mpool_subq_push_single(&subq_dst->base_subq, qblk);
-
-        /* mark the flow as "active" - done directly here while the lock is still held */
-        bplib_mpool_job_mark_active_internal(&admin->active_list, &subq_dst->job_header);
-
-        /* in case any threads were waiting on a non-empty queue */
-        bplib_mpool_lock_broadcast_signal(lock);
+        return;
     }
 
-    bplib_mpool_lock_release(lock);
+    if (subq == &flow->ingress)
+    {
+        flag = BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH;
+    }
+    else
+    {
+        flag = BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH;
+    }
 
-    return got_space;
+    /* the pending flags are only changed under the pool lock, but this avoids taking it on every push */
+    if (((flow->pending_state_flags & flag) != 0) != is_high)
+    {
+        if (is_high)
+        {
+            bplib_mpool_flow_modify_flags(fblk, flag, 0);
+        }
+        else
+        {
+            bplib_mpool_flow_modify_flags(fblk, 0, flag);
+        }
+    }
 }
 
-bplib_mpool_block_t *bplib_mpool_flow_try_pull(bplib_mpool_subq_workitem_t *subq_src, uint64_t abs_timeout)
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_check_watermarks
+ *
+ * Internal function, lock must be held when invoked, and the pool lock must not be held
+ *
+ *-----------------------------------------------------------------*/
+static inline void bplib_mpool_subq_workitem_check_watermarks(bplib_mpool_subq_workitem_t *subq)
 {
-    bplib_mpool_lock_t  *lock;
-    bplib_mpool_block_t *qblk;
-    bool                 got_space;
-    bplib_mpool_t       *pool;
-
-    qblk = NULL;
-    pool = bplib_mpool_get_parent_pool_from_link(&subq_src->job_header.link);
-    lock = bplib_mpool_lock_resource(pool);
+    uint32_t depth;
 
-    got_space = bplib_mpool_subq_workitem_wait_for_fill(lock, subq_src, 1, abs_timeout);
-    if (got_space)
+    if (subq->high_watermark == 0)
     {
-        qblk = bplib_mpool_subq_pull_single(&subq_src->base_subq);
-
-        /* in case any threads were waiting on a non-full queue */
-        bplib_mpool_lock_broadcast_signal(lock);
+        return;
     }
 
-    bplib_mpool_lock_release(lock);
-
-    return qblk;
+    /* nothing changes while the depth is in between the marks */
+    depth = bplib_mpool_subq_get_depth(&subq->base_subq);
+    if (depth >= subq->high_watermark)
+    {
+        bplib_mpool_subq_workitem_update_high_flag(subq, true);
+    }
+    else if (depth <= subq->low_watermark)
+    {
+        bplib_mpool_subq_workitem_update_high_flag(subq, false);
+    }
 }
 
-uint32_t bplib_mpool_flow_try_move_all(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_subq_workitem_t *subq_src,
-                                       uint64_t abs_timeout)
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_update_notifier
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static inline void bplib_mpool_subq_workitem_update_notifier(bplib_mpool_subq_workitem_t *subq)
 {
-    bplib_mpool_lock_t                *lock;
-    uint32_t                           prev_quantity;
-    uint32_t                           quantity;
-    bool                               got_space;
-    bplib_mpool_block_admin_content_t *admin;
-    bplib_mpool_t                     *pool;
-
-    got_space = false;
-    pool      = bplib_mpool_get_parent_pool_from_link(&subq_dst->job_header.link);
-    admin     = bplib_mpool_get_admin(pool);
-    lock      = bplib_mpool_lock_resource(pool);
+    bool is_set;
 
-    /* note, there is a possibility that while waiting, another task puts more entries
-     * into the source queue.  This loop will catch that and wait again.  However it
-     * will not catch the case of another thread taking out of the source queue, as
-     * it will still wait for the original amount. */
-    quantity = bplib_mpool_subq_get_depth(&subq_src->base_subq);
-    do
+    if (!bp_handle_is_valid(subq->notifier))
     {
-        prev_quantity = quantity;
-        got_space     = bplib_mpool_subq_workitem_wait_for_space(lock, subq_dst, quantity, abs_timeout);
-        quantity      = bplib_mpool_subq_get_depth(&subq_src->base_subq);
+        return;
     }
-    while (got_space && quantity > prev_quantity);
-
-    if (got_space)
-    {
-        /* this does not fail, but must be done under lock to keep things consistent */
-        quantity = bplib_mpool_subq_move_all(&subq_dst->base_subq, &subq_src->base_subq);
-
-        /* mark the flow as "active" - done directly here while the lock is still held */
-        bplib_mpool_job_mark_active_internal(&admin->active_list, &subq_dst->job_header);
 
-        /* in case any threads were waiting on a non-empty queue */
-        bplib_mpool_lock_broadcast_signal(lock);
-    }
-    else
+    /* the OS is only called when the queue goes from empty to not empty or back */
+    is_set = (bplib_mpool_subq_get_depth(&subq->base_subq) != 0);
+    if (is_set != subq->notifier_set)
     {
-        quantity = 0;
+        subq->notifier_set = is_set;
+        if (is_set)
+        {
+            bplib_os_notifier_set(subq->notifier);
+        }
+        else
+        {
+            bplib_os_notifier_clear(subq->notifier);
+        }
     }
-
-    bplib_mpool_lock_release(lock);
-
-    return quantity;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_flow_disable
+ * Function: bplib_mpool_subq_workitem_depth_limit
  *
  *-----------------------------------------------------------------*/
-uint32_t bplib_mpool_flow_disable(bplib_mpool_subq_workitem_t *subq)
+static inline uint32_t bplib_mpool_subq_workitem_depth_limit(const bplib_mpool_subq_workitem_t *subq)
 {
-    bplib_mpool_t      *pool;
-    bplib_mpool_lock_t *lock;
-    uint32_t            quantity_dropped;
-
-    pool = bplib_mpool_get_parent_pool_from_link(&subq->job_header.link);
-    lock = bplib_mpool_lock_resource(pool);
-
-    /* prevents any additional entries in flow queues */
-    subq->current_depth_limit = 0;
-    quantity_dropped          = bplib_mpool_subq_drop_all(pool, &subq->base_subq);
+    uint32_t depth_limit;
 
-    bplib_mpool_job_cancel_internal(&subq->job_header);
+    depth_limit = subq->current_depth_limit;
 
-    bplib_mpool_lock_release(lock);
+    /* a ring cannot hold more than its number of slots, regardless of the configured limit */
+    if (subq->ring != NULL && depth_limit > subq->ring->slot_mask)
+    {
+        depth_limit = subq->ring->slot_mask + 1;
+    }
 
-    return quantity_dropped;
+    return depth_limit;
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_flow_enable
+ * Function: bplib_mpool_subq_workitem_sync_waiters
+ *
+ * Internal function, makes a waiter count visible before the queue depth is checked again
  *
  *-----------------------------------------------------------------*/
-void bplib_mpool_flow_enable(bplib_mpool_subq_workitem_t *subq, uint32_t depth_limit)
+static inline void bplib_mpool_subq_workitem_sync_waiters(void)
 {
-    bplib_mpool_t      *pool;
-    bplib_mpool_lock_t *lock;
-
-    pool = bplib_mpool_get_parent_pool_from_link(&subq->job_header.link);
-    lock = bplib_mpool_lock_resource(pool);
-
-    /* prevents any additional entries in flow queues */
-    subq->current_depth_limit = depth_limit;
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    /* pairs with the fence in bplib_mpool_subq_ring_notify(), as ring entries move without the lock */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
 
-    bplib_mpool_lock_release(lock);
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_push_single
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_subq_workitem_push_single(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *cpb)
+{
+    if (subq->bands != NULL)
+    {
+        /* the counts of the flow subq cover all the bands */
+        bplib_mpool_subq_push_single(&bplib_mpool_subq_bands_classify(subq->bands, cpb)->subq, cpb);
+        ++subq->base_subq.push_count;
+    }
+    else
+    {
+        bplib_mpool_subq_push_single(&subq->base_subq, cpb);
+    }
 }
 
 /*----------------------------------------------------------------
  *
- * Function: bplib_mpool_flow_alloc
+ * Function: bplib_mpool_subq_workitem_pull_single
+ *
+ * Internal function, lock must be held when invoked
  *
  *-----------------------------------------------------------------*/
-bplib_mpool_block_t *bplib_mpool_flow_alloc(bplib_mpool_t *pool, uint32_t magic_number, void *init_arg)
+static bplib_mpool_block_t *bplib_mpool_subq_workitem_pull_single(bplib_mpool_subq_workitem_t *subq)
 {
-    bplib_mpool_block_content_t *result;
-    bplib_mpool_lock_t          *lock;
+    bplib_mpool_subq_band_t *band;
 
-    lock   = bplib_mpool_lock_resource(pool);
-    result = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_flow, magic_number, init_arg, BPLIB_MPOOL_ALLOC_PRI_LO);
-    bplib_mpool_lock_release(lock);
+    if (subq->bands == NULL)
+    {
+        return bplib_mpool_subq_pull_single(&subq->base_subq);
+    }
+
+    band = bplib_mpool_subq_bands_select(subq->bands);
+    if (band == NULL)
+    {
+        return NULL;
+    }
+
+    ++subq->base_subq.pull_count;
+    return bplib_mpool_subq_pull_single(&band->subq);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_pull_n
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_workitem_pull_n(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                 uint32_t limit)
+{
+    bplib_mpool_block_t *node;
+    uint32_t             count;
+
+    if (subq->bands == NULL)
+    {
+        return bplib_mpool_subq_pull_n(&subq->base_subq, list, limit);
+    }
+
+    /* the band is picked again for every entry */
+    count = 0;
+    while (count < limit && (node = bplib_mpool_subq_workitem_pull_single(subq)) != NULL)
+    {
+        bplib_mpool_insert_before(list, node);
+        ++count;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_move_all
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_workitem_move_all(bplib_mpool_subq_workitem_t *subq_dst,
+                                                   bplib_mpool_subq_workitem_t *subq_src)
+{
+    bplib_mpool_block_t *node;
+    uint32_t             count;
+
+    if (subq_dst->bands == NULL && subq_src->bands == NULL)
+    {
+        return bplib_mpool_subq_move_all(&subq_dst->base_subq, &subq_src->base_subq);
+    }
+
+    /* the entries are not in one list, so they are moved one at a time */
+    count = 0;
+    while ((node = bplib_mpool_subq_workitem_pull_single(subq_src)) != NULL)
+    {
+        bplib_mpool_subq_workitem_push_single(subq_dst, node);
+        ++count;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_drop_all
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_workitem_drop_all(bplib_mpool_t *pool, bplib_mpool_subq_workitem_t *subq)
+{
+    uint32_t count;
+    uint32_t i;
+
+    if (subq->bands == NULL)
+    {
+        return bplib_mpool_subq_drop_all(pool, &subq->base_subq);
+    }
+
+    count = 0;
+    for (i = 0; i < subq->bands->num_bands; ++i)
+    {
+        count += bplib_mpool_subq_drop_all(pool, &subq->bands->band[i].subq);
+    }
+
+    subq->base_subq.pull_count += count;
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_has_space
+ *
+ *-----------------------------------------------------------------*/
+static inline bool bplib_mpool_subq_workitem_has_space(const bplib_mpool_subq_workitem_t *subq,
+                                                       const bplib_mpool_subq_band_t     *band, uint32_t quantity)
+{
+    /* future depth after adding given quantity, both overall and in the band it goes to */
+    if ((bplib_mpool_subq_get_depth(&subq->base_subq) + quantity) > bplib_mpool_subq_workitem_depth_limit(subq))
+    {
+        return false;
+    }
+
+    return (band == NULL || (bplib_mpool_subq_get_depth(&band->subq) + quantity) <= band->depth_limit);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_wait_for_band_space
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static bool bplib_mpool_subq_workitem_wait_for_band_space(bplib_mpool_lock_t *lock, bplib_mpool_subq_workitem_t *subq,
+                                                          const bplib_mpool_subq_band_t *band, uint32_t quantity,
+                                                          uint64_t abs_timeout)
+{
+    bplib_mpool_wait_channel_t *channel;
+    bool                        got_space;
+    bool                        within_timeout;
+
+    got_space      = bplib_mpool_subq_workitem_has_space(subq, band, quantity);
+    within_timeout = (abs_timeout != 0);
+    channel        = bplib_mpool_wait_channel_prepare(&subq->space_waiters);
+    while (!got_space && within_timeout)
+    {
+        /* adding given quantity would overfill, wait for something else to pull */
+        ++subq->space_waiters;
+        bplib_mpool_subq_workitem_sync_waiters();
+
+        /* a ring consumer does not take the lock, so it may have pulled since the last check */
+        got_space = bplib_mpool_subq_workitem_has_space(subq, band, quantity);
+        if (!got_space)
+        {
+            within_timeout = bplib_mpool_wait_channel_wait(lock, channel, abs_timeout);
+        }
+
+        --subq->space_waiters;
+        got_space = bplib_mpool_subq_workitem_has_space(subq, band, quantity);
+    }
+
+    return got_space;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_push_bands
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_workitem_push_bands(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                     uint32_t limit)
+{
+    bplib_mpool_subq_band_t *band;
+    bplib_mpool_block_t     *node;
+    uint32_t                 count;
+
+    count = 0;
+    while (count < limit)
+    {
+        node = list->next;
+        if (bplib_mpool_is_list_head(node))
+        {
+            break;
+        }
+
+        /* the list order is kept, so this stops at the first entry whose band is full */
+        band = bplib_mpool_subq_bands_classify(subq->bands, node);
+        if (!bplib_mpool_subq_workitem_has_space(subq, band, 1))
+        {
+            break;
+        }
+
+        bplib_mpool_extract_node(node);
+        bplib_mpool_subq_workitem_push_single(subq, node);
+        ++count;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_wait_for_space
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+bool bplib_mpool_subq_workitem_wait_for_space(bplib_mpool_lock_t *lock, bplib_mpool_subq_workitem_t *subq,
+                                              uint32_t quantity, uint64_t abs_timeout)
+{
+    return bplib_mpool_subq_workitem_wait_for_band_space(lock, subq, NULL, quantity, abs_timeout);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_workitem_wait_for_fill
+ *
+ * Internal function, lock must be held when invoked
+ *
+ *-----------------------------------------------------------------*/
+bool bplib_mpool_subq_workitem_wait_for_fill(bplib_mpool_lock_t *lock, bplib_mpool_subq_workitem_t *subq,
+                                             uint32_t quantity, uint64_t abs_timeout)
+{
+    bplib_mpool_wait_channel_t *channel;
+    uint32_t                    curr_depth;
+    bool                        within_timeout;
+
+    curr_depth     = bplib_mpool_subq_get_depth(&subq->base_subq);
+    within_timeout = (abs_timeout != 0);
+    channel        = bplib_mpool_wait_channel_prepare(&subq->fill_waiters);
+    while (curr_depth < quantity && within_timeout)
+    {
+        ++subq->fill_waiters;
+        bplib_mpool_subq_workitem_sync_waiters();
+
+        /* likewise, a ring producer may have pushed since the last check */
+        curr_depth = bplib_mpool_subq_get_depth(&subq->base_subq);
+        if (curr_depth < quantity)
+        {
+            within_timeout = bplib_mpool_wait_channel_wait(lock, channel, abs_timeout);
+        }
+
+        --subq->fill_waiters;
+        curr_depth = bplib_mpool_subq_get_depth(&subq->base_subq);
+    }
+
+    return (curr_depth >= quantity);
+}
+
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_notify
+ *
+ * Internal function, wakes any thread blocked on the other side of a ring after entries moved.
+ * The lock must NOT be held when invoked.
+ *
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_subq_ring_notify(bplib_mpool_subq_workitem_t *subq, unsigned int *waiters)
+{
+    bplib_mpool_lock_t *lock;
+
+    /* pairs with bplib_mpool_subq_workitem_sync_waiters(), so a waiter either sees the
+     * entry that just moved or is seen here - only then is the lock needed */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_RELAXED) != 0)
+    {
+        lock = bplib_mpool_lock_resource(subq);
+        bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_prepare(waiters));
+        bplib_mpool_lock_release(lock);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_push_slot
+ *
+ * Internal function, must only be invoked by one thread at a time (the producer)
+ *
+ *-----------------------------------------------------------------*/
+static bool bplib_mpool_subq_ring_push_slot(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *qblk)
+{
+    bplib_mpool_subq_ring_t *ring;
+    unsigned int             push_pos;
+    unsigned int             depth_limit;
+
+    ring        = subq->ring;
+    push_pos    = subq->base_subq.push_count;
+    depth_limit = __atomic_load_n(&subq->current_depth_limit, __ATOMIC_RELAXED);
+    if (depth_limit > ring->slot_mask)
+    {
+        depth_limit = ring->slot_mask + 1;
+    }
+
+    /* the acquire ensures the consumer is finished with the slot before it is reused */
+    if ((push_pos - __atomic_load_n(&subq->base_subq.pull_count, __ATOMIC_ACQUIRE)) >= depth_limit)
+    {
+        return false;
+    }
+
+    ring->slots[push_pos & ring->slot_mask] = qblk;
+
+    /* this publishes the slot to the consumer */
+    __atomic_store_n(&subq->base_subq.push_count, push_pos + 1, __ATOMIC_SEQ_CST);
+
+    return true;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_pull_slot
+ *
+ * Internal function, must only be invoked by one thread at a time (the consumer)
+ *
+ *-----------------------------------------------------------------*/
+static bplib_mpool_block_t *bplib_mpool_subq_ring_pull_slot(bplib_mpool_subq_workitem_t *subq)
+{
+    bplib_mpool_subq_ring_t *ring;
+    bplib_mpool_block_t     *qblk;
+    unsigned int             pull_pos;
+
+    ring     = subq->ring;
+    pull_pos = subq->base_subq.pull_count;
+    if (pull_pos == __atomic_load_n(&subq->base_subq.push_count, __ATOMIC_ACQUIRE))
+    {
+        /*
+         * Before reporting empty, tell the producer that the job will need to be marked active
+         * again for the next entry.  The ring is checked once more after that, in case an entry
+         * was pushed while the old flag value was still visible to the producer.
+         */
+        __atomic_store_n(&ring->job_pending, 0, __ATOMIC_SEQ_CST);
+        if (pull_pos == __atomic_load_n(&subq->base_subq.push_count, __ATOMIC_SEQ_CST))
+        {
+            return NULL;
+        }
+    }
+
+    qblk = ring->slots[pull_pos & ring->slot_mask];
+
+    /* this gives the slot back to the producer */
+    __atomic_store_n(&subq->base_subq.pull_count, pull_pos + 1, __ATOMIC_SEQ_CST);
+
+    return qblk;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_push_list
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_ring_push_list(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                uint32_t max_count)
+{
+    bplib_mpool_block_t *node;
+    uint32_t             count;
+
+    count = 0;
+    while (count < max_count)
+    {
+        node = bplib_mpool_get_next_block(list);
+        if (bplib_mpool_is_list_head(node))
+        {
+            break;
+        }
+
+        /* the node must be off the list before the consumer can see it, so it goes back if there is no room */
+        bplib_mpool_extract_node(node);
+        if (!bplib_mpool_subq_ring_push_slot(subq, node))
+        {
+            bplib_mpool_insert_after(list, node);
+            break;
+        }
+
+        ++count;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_pull_list
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_ring_pull_list(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                uint32_t max_count)
+{
+    bplib_mpool_block_t *qblk;
+    uint32_t             count;
+
+    count = 0;
+    while (count < max_count)
+    {
+        qblk = bplib_mpool_subq_ring_pull_slot(subq);
+        if (qblk == NULL)
+        {
+            break;
+        }
+
+        if (__atomic_load_n(&subq->current_depth_limit, __ATOMIC_RELAXED) == 0)
+        {
+            /* the flow was disabled, which drops the entries as they come out of the ring */
+            bplib_mpool_recycle_block(qblk);
+        }
+        else
+        {
+            bplib_mpool_insert_before(list, qblk);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_lock_side
+ *
+ * Internal function, locks the subq unless the caller is the only thread on this side of the ring
+ *
+ *-----------------------------------------------------------------*/
+static inline bplib_mpool_lock_t *bplib_mpool_subq_ring_lock_side(bplib_mpool_subq_workitem_t *subq,
+                                                                  uint32_t                     single_flag)
+{
+    if ((subq->ring->ring_flags & single_flag) != 0)
+    {
+        return NULL;
+    }
+
+    return bplib_mpool_lock_resource(subq);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_try_push_n
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_ring_try_push_n(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                 uint32_t max_count, uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t *lock;
+    bplib_mpool_lock_t *pool_lock;
+    bplib_mpool_t      *pool;
+    uint32_t            quantity;
+
+    lock     = bplib_mpool_subq_ring_lock_side(subq, BPLIB_MPOOL_RING_SINGLE_PRODUCER);
+    quantity = bplib_mpool_subq_ring_push_list(subq, list, max_count);
+
+    /* only a full ring needs the lock, to block until the consumer makes room */
+    if (quantity == 0 && max_count > 0 && abs_timeout != 0)
+    {
+        if (lock == NULL)
+        {
+            lock = bplib_mpool_lock_resource(subq);
+        }
+
+        if (bplib_mpool_subq_workitem_wait_for_space(lock, subq, 1, abs_timeout))
+        {
+            quantity = bplib_mpool_subq_ring_push_list(subq, list, max_count);
+        }
+    }
+
+    if (lock != NULL)
+    {
+        bplib_mpool_lock_release(lock);
+    }
+
+    if (quantity > 0)
+    {
+        /* the job only needs to be marked active once, until the consumer finds the ring empty again */
+        if (subq->job_header.handler != NULL &&
+            __atomic_exchange_n(&subq->ring->job_pending, 1, __ATOMIC_SEQ_CST) == 0)
+        {
+            pool      = bplib_mpool_get_parent_pool_from_link(&subq->job_header.link);
+            pool_lock = bplib_mpool_lock_pool(pool);
+            bplib_mpool_job_mark_active_internal(&bplib_mpool_get_admin(pool)->active_list, &subq->job_header);
+            bplib_mpool_lock_release(pool_lock);
+        }
+
+        bplib_mpool_subq_ring_notify(subq, &subq->fill_waiters);
+    }
+
+    return quantity;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_try_pull_n
+ *
+ *-----------------------------------------------------------------*/
+static uint32_t bplib_mpool_subq_ring_try_pull_n(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                 uint32_t max_count, uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t *lock;
+    uint32_t            quantity;
+
+    lock     = bplib_mpool_subq_ring_lock_side(subq, BPLIB_MPOOL_RING_SINGLE_CONSUMER);
+    quantity = bplib_mpool_subq_ring_pull_list(subq, list, max_count);
+
+    /* only an empty ring needs the lock, to block until the producer adds something */
+    if (quantity == 0 && max_count > 0 && abs_timeout != 0)
+    {
+        if (lock == NULL)
+        {
+            lock = bplib_mpool_lock_resource(subq);
+        }
+
+        if (bplib_mpool_subq_workitem_wait_for_fill(lock, subq, 1, abs_timeout))
+        {
+            quantity = bplib_mpool_subq_ring_pull_list(subq, list, max_count);
+        }
+    }
+
+    if (lock != NULL)
+    {
+        bplib_mpool_lock_release(lock);
+    }
+
+    if (quantity > 0)
+    {
+        bplib_mpool_subq_ring_notify(subq, &subq->space_waiters);
+    }
+
+    return quantity;
+}
+
+#else
+
+/* without atomic operations bplib_mpool_flow_attach_ring() always fails, so these are never reached */
+static inline uint32_t bplib_mpool_subq_ring_try_push_n(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                        uint32_t max_count, uint64_t abs_timeout)
+{
+    return 0;
+}
+
+static inline uint32_t bplib_mpool_subq_ring_try_pull_n(bplib_mpool_subq_workitem_t *subq, bplib_mpool_block_t *list,
+                                                        uint32_t max_count, uint64_t abs_timeout)
+{
+    return 0;
+}
+
+#endif /* BPLIB_MPOOL_ATOMIC_REFCOUNT */
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_ring_detach_all
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_subq_ring_detach_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpool_subq_workitem_t *subq)
+{
+    bplib_mpool_subq_ring_t *ring;
+    uint32_t                 count;
+
+    ring = subq->ring;
+    if (ring == NULL)
+    {
+        return 0;
+    }
+
+    count = 0;
+    while (subq->base_subq.pull_count != subq->base_subq.push_count)
+    {
+        bplib_mpool_subq_push_single(subq_dst, ring->slots[subq->base_subq.pull_count & ring->slot_mask]);
+        ++subq->base_subq.pull_count;
+        ++count;
+    }
+
+    /* the slots live in this block, so it has to be last */
+    subq->ring = NULL;
+    bplib_mpool_subq_push_single(subq_dst, ring->storage_block);
+
+    return count + 1;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_attach_ring
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_flow_attach_ring(bplib_mpool_subq_workitem_t *subq, uint32_t ring_flags)
+{
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    bplib_mpool_t               *pool;
+    bplib_mpool_block_content_t *blk;
+    bplib_mpool_subq_ring_t     *ring;
+    bplib_mpool_lock_t          *lock;
+    size_t                       num_slots;
+    int                          status;
+
+    pool = bplib_mpool_get_parent_pool_from_link(&subq->job_header.link);
+    blk  = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_generic, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_LO,
+                                         BPLIB_MPOOL_SUBQ_RING_SIZE_HINT);
+    if (blk == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    ring      = bplib_mpool_generic_data_cast(&blk->header.base_link, 0);
+    num_slots = bplib_mpool_get_generic_data_capacity(&blk->header.base_link);
+    if (ring == NULL || num_slots < offsetof(bplib_mpool_subq_ring_t, slots))
+    {
+        num_slots = 0;
+    }
+    else
+    {
+        num_slots = (num_slots - offsetof(bplib_mpool_subq_ring_t, slots)) / sizeof(ring->slots[0]);
+    }
+
+    /* round down to a power of two, so a position can be masked into a slot index */
+    while ((num_slots & (num_slots - 1)) != 0)
+    {
+        num_slots &= num_slots - 1;
+    }
+
+    status = BP_ERROR;
+    lock   = bplib_mpool_lock_resource(subq);
+
+    /* the existing entries would be on the block_list, so this can only be done while empty */
+    if (num_slots > 1 && subq->ring == NULL && subq->bands == NULL &&
+        bplib_mpool_subq_get_depth(&subq->base_subq) == 0)
+    {
+        ring->storage_block = &blk->header.base_link;
+        ring->ring_flags    = ring_flags;
+        ring->slot_mask     = num_slots - 1;
+        ring->job_pending   = 0;
+
+        subq->ring = ring;
+        blk        = NULL;
+        status     = BP_SUCCESS;
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    if (blk != NULL)
+    {
+        bplib_mpool_recycle_block(&blk->header.base_link);
+    }
+
+    return status;
+#else
+    return BP_ERROR;
+#endif
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_bands_detach_all
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_subq_bands_detach_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpool_subq_workitem_t *subq)
+{
+    bplib_mpool_subq_bands_t *bands;
+    bplib_mpool_block_t      *node;
+    uint32_t                  count;
+
+    bands = subq->bands;
+    if (bands == NULL)
+    {
+        return 0;
+    }
+
+    count = 0;
+    while ((node = bplib_mpool_subq_workitem_pull_single(subq)) != NULL)
+    {
+        bplib_mpool_subq_push_single(subq_dst, node);
+        ++count;
+    }
+
+    /* the band lists live in this block, so it has to be last */
+    subq->bands = NULL;
+    bplib_mpool_subq_push_single(subq_dst, bands->storage_block);
+
+    return count + 1;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_attach_bands
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_flow_attach_bands(bplib_mpool_subq_workitem_t *subq, uint32_t dequeue_mode, uint32_t num_bands,
+                                  const bplib_mpool_subq_band_config_t *config)
+{
+    bplib_mpool_t               *pool;
+    bplib_mpool_block_content_t *blk;
+    bplib_mpool_subq_bands_t    *bands;
+    bplib_mpool_lock_t          *lock;
+    uint32_t                     i;
+    int                          status;
+
+    if (num_bands == 0 || num_bands > BPLIB_MPOOL_SUBQ_MAX_BANDS)
+    {
+        return BP_ERROR;
+    }
+
+    pool = bplib_mpool_get_parent_pool_from_link(&subq->job_header.link);
+    blk  = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_generic, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_LO,
+                                         sizeof(bplib_mpool_subq_bands_t));
+    if (blk == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    bands = bplib_mpool_generic_data_cast(&blk->header.base_link, 0);
+    if (bands == NULL || bplib_mpool_get_generic_data_capacity(&blk->header.base_link) < sizeof(*bands))
+    {
+        bplib_mpool_recycle_block(&blk->header.base_link);
+        return BP_ERROR;
+    }
+
+    bands->storage_block = &blk->header.base_link;
+    bands->dequeue_mode  = dequeue_mode;
+    bands->num_bands     = num_bands;
+    for (i = 0; i < num_bands; ++i)
+    {
+        bplib_mpool_subq_init(&blk->header.base_link, &bands->band[i].subq);
+        if (config != NULL)
+        {
+            bands->band[i].depth_limit = config[i].depth_limit;
+            bands->band[i].weight      = config[i].weight;
+        }
+        else
+        {
+            bands->band[i].depth_limit = BP_MPOOL_MAX_SUBQ_DEPTH;
+            bands->band[i].weight      = 1 << i;
+        }
+
+        /* a band with no weight would never be served */
+        if (bands->band[i].weight == 0)
+        {
+            bands->band[i].weight = 1;
+        }
+    }
+
+    /* weighted mode starts a round at the highest band */
+    bands->curr_band   = num_bands - 1;
+    bands->curr_credit = bands->band[bands->curr_band].weight;
+
+    status = BP_ERROR;
+    lock   = bplib_mpool_lock_resource(subq);
+
+    /* the existing entries would be on the block_list, so this can only be done while empty */
+    if (subq->ring == NULL && subq->bands == NULL && bplib_mpool_subq_get_depth(&subq->base_subq) == 0)
+    {
+        subq->bands = bands;
+        blk                   = NULL;
+        status                = BP_SUCCESS;
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    if (blk != NULL)
+    {
+        bplib_mpool_recycle_block(&blk->header.base_link);
+    }
+
+    return status;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_query_band
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_flow_query_band(bplib_mpool_subq_workitem_t *subq, uint32_t band, bplib_mpool_subq_band_stats_t *stats)
+{
+    bplib_mpool_subq_bands_t *bands;
+    bplib_mpool_lock_t       *lock;
+    int                       status;
+
+    status = BP_ERROR;
+    lock   = bplib_mpool_lock_resource(subq);
+
+    bands = subq->bands;
+    if (bands != NULL && band < bands->num_bands)
+    {
+        stats->push_count  = bands->band[band].subq.push_count;
+        stats->pull_count  = bands->band[band].subq.pull_count;
+        stats->depth_limit = bands->band[band].depth_limit;
+        status             = BP_SUCCESS;
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return status;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_try_push
+ *
+ *-----------------------------------------------------------------*/
+bool bplib_mpool_flow_try_push(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_block_t *qblk, uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_lock_t                *pool_lock;
+    bool                               got_space;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_block_t                list;
+    bplib_mpool_subq_band_t           *band;
+
+    if (subq_dst->ring != NULL)
+    {
+        /* the ring works on lists, so this goes through a temporary one */
+        bplib_mpool_init_list_head(NULL, &list);
+        bplib_mpool_insert_before(&list, qblk);
+        got_space = (bplib_mpool_subq_ring_try_push_n(subq_dst, &list, 1, abs_timeout) != 0);
+        if (!got_space)
+        {
+            bplib_mpool_extract_node(qblk);
+        }
+
+        return got_space;
+    }
+
+    pool  = bplib_mpool_get_parent_pool_from_link(&subq_dst->job_header.link);
+    admin = bplib_mpool_get_admin(pool);
+    lock  = bplib_mpool_lock_resource(subq_dst);
+
+    /* with priority bands, the band this goes into must also have room */
+    band = NULL;
+    if (subq_dst->bands != NULL)
+    {
+        band = bplib_mpool_subq_bands_classify(subq_dst->bands, qblk);
+    }
+
+    got_space = bplib_mpool_subq_workitem_wait_for_band_space(lock, subq_dst, band, 1, abs_timeout);
+    if (got_space)
+    {
+        /* this does not fail, but must be done under lock to keep things consistent */
+        bplib_mpool_subq_workitem_push_single(subq_dst, qblk);
+
+        /* mark the flow as "active" - the active list belongs to the pool, so this nests the pool lock */
+        pool_lock = bplib_mpool_lock_pool(pool);
+        bplib_mpool_job_mark_active_internal(&admin->active_list, &subq_dst->job_header);
+        bplib_mpool_lock_release(pool_lock);
+
+        /* in case any threads were waiting on a non-empty queue */
+        bplib_mpool_subq_workitem_notify_fill(subq_dst);
+        bplib_mpool_subq_workitem_update_notifier(subq_dst);
+        bplib_mpool_subq_workitem_check_watermarks(subq_dst);
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return got_space;
+}
+
+bplib_mpool_block_t *bplib_mpool_flow_try_pull(bplib_mpool_subq_workitem_t *subq_src, uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t  *lock;
+    bplib_mpool_block_t *qblk;
+    bool                 got_space;
+    bplib_mpool_block_t  list;
+
+    qblk = NULL;
+
+    if (subq_src->ring != NULL)
+    {
+        bplib_mpool_init_list_head(NULL, &list);
+        if (bplib_mpool_subq_ring_try_pull_n(subq_src, &list, 1, abs_timeout) != 0)
+        {
+            qblk = bplib_mpool_get_next_block(&list);
+            bplib_mpool_extract_node(qblk);
+        }
+
+        return qblk;
+    }
+
+    lock = bplib_mpool_lock_resource(subq_src);
+
+    got_space = bplib_mpool_subq_workitem_wait_for_fill(lock, subq_src, 1, abs_timeout);
+    if (got_space)
+    {
+        qblk = bplib_mpool_subq_workitem_pull_single(subq_src);
+
+        /* in case any threads were waiting on a non-full queue */
+        bplib_mpool_subq_workitem_notify_space(subq_src);
+        bplib_mpool_subq_workitem_update_notifier(subq_src);
+        bplib_mpool_subq_workitem_check_watermarks(subq_src);
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return qblk;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_try_push_n
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_flow_try_push_n(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_block_t *list,
+                                     uint32_t max_count, uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_lock_t                *pool_lock;
+    uint32_t                           quantity;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_subq_band_t           *band;
+
+    if (subq_dst->ring != NULL)
+    {
+        return bplib_mpool_subq_ring_try_push_n(subq_dst, list, max_count, abs_timeout);
+    }
+
+    quantity = 0;
+    pool     = bplib_mpool_get_parent_pool_from_link(&subq_dst->job_header.link);
+    admin    = bplib_mpool_get_admin(pool);
+    lock     = bplib_mpool_lock_resource(subq_dst);
+
+    /* with priority bands, this waits for room in the band of the first entry */
+    band = NULL;
+    if (subq_dst->bands != NULL && !bplib_mpool_is_list_head(list->next))
+    {
+        band = bplib_mpool_subq_bands_classify(subq_dst->bands, list->next);
+    }
+
+    /* this only waits for room for one entry, then pushes as many as will fit */
+    if (max_count > 0 && bplib_mpool_subq_workitem_wait_for_band_space(lock, subq_dst, band, 1, abs_timeout))
+    {
+        quantity = subq_dst->current_depth_limit - bplib_mpool_subq_get_depth(&subq_dst->base_subq);
+        if (quantity > max_count)
+        {
+            quantity = max_count;
+        }
+
+        if (band != NULL)
+        {
+            quantity = bplib_mpool_subq_workitem_push_bands(subq_dst, list, quantity);
+        }
+        else
+        {
+            quantity = bplib_mpool_subq_push_n(&subq_dst->base_subq, list, quantity);
+        }
+        if (quantity > 0)
+        {
+            /* mark the flow as "active" - the active list belongs to the pool, so this nests the pool lock */
+            pool_lock = bplib_mpool_lock_pool(pool);
+            bplib_mpool_job_mark_active_internal(&admin->active_list, &subq_dst->job_header);
+            bplib_mpool_lock_release(pool_lock);
+
+            /* in case any threads were waiting on a non-empty queue */
+            bplib_mpool_subq_workitem_notify_fill(subq_dst);
+            bplib_mpool_subq_workitem_update_notifier(subq_dst);
+            bplib_mpool_subq_workitem_check_watermarks(subq_dst);
+        }
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return quantity;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_try_pull_n
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_flow_try_pull_n(bplib_mpool_subq_workitem_t *subq_src, bplib_mpool_block_t *list,
+                                     uint32_t max_count, uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t *lock;
+    uint32_t            quantity;
+
+    if (subq_src->ring != NULL)
+    {
+        return bplib_mpool_subq_ring_try_pull_n(subq_src, list, max_count, abs_timeout);
+    }
+
+    quantity = 0;
+    lock     = bplib_mpool_lock_resource(subq_src);
+
+    /* this only waits for one entry, then takes as many as are there */
+    if (max_count > 0 && bplib_mpool_subq_workitem_wait_for_fill(lock, subq_src, 1, abs_timeout))
+    {
+        quantity = bplib_mpool_subq_workitem_pull_n(subq_src, list, max_count);
+
+        /* in case any threads were waiting on a non-full queue */
+        bplib_mpool_subq_workitem_notify_space(subq_src);
+        bplib_mpool_subq_workitem_update_notifier(subq_src);
+        bplib_mpool_subq_workitem_check_watermarks(subq_src);
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return quantity;
+}
+
+uint32_t bplib_mpool_flow_try_move_all(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_subq_workitem_t *subq_src,
+                                       uint64_t abs_timeout)
+{
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_lock_t                *src_lock;
+    bplib_mpool_lock_t                *pool_lock;
+    uint32_t                           prev_quantity;
+    uint32_t                           quantity;
+    bool                               got_space;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_t                     *pool;
+
+    /* the whole list is moved at once, which the entries of a ring cannot do */
+    if (subq_dst->ring != NULL || subq_src->ring != NULL)
+    {
+        return 0;
+    }
+
+    got_space = false;
+    pool      = bplib_mpool_get_parent_pool_from_link(&subq_dst->job_header.link);
+    admin     = bplib_mpool_get_admin(pool);
+    lock      = bplib_mpool_lock_resource(subq_dst);
+
+    /* note, there is a possibility that while waiting, another task puts more entries
+     * into the source queue.  This loop will catch that and wait again.  However it
+     * will not catch the case of another thread taking out of the source queue, as
+     * it will still wait for the original amount. */
+    quantity = bplib_mpool_subq_get_depth(&subq_src->base_subq);
+    do
+    {
+        prev_quantity = quantity;
+        got_space     = bplib_mpool_subq_workitem_wait_for_space(lock, subq_dst, quantity, abs_timeout);
+        quantity      = bplib_mpool_subq_get_depth(&subq_src->base_subq);
+    }
+    while (got_space && quantity > prev_quantity);
+
+    if (got_space)
+    {
+        /*
+         * The source queue also needs to be locked to move its contents.  If it is a
+         * different stripe, the lock ordering rule requires the lower lock to be taken first,
+         * which may mean temporarily giving up the destination lock.  In that case, the
+         * space check is redone, as another thread may have gotten in while it was unlocked.
+         */
+        src_lock = bplib_mpool_lock_prepare(subq_src);
+        if (src_lock == lock)
+        {
+            src_lock = NULL;
+        }
+        else if (src_lock > lock)
+        {
+            bplib_mpool_lock_acquire(src_lock);
+        }
+        else
+        {
+            bplib_mpool_lock_release(lock);
+            bplib_mpool_lock_acquire(src_lock);
+            bplib_mpool_lock_acquire(lock);
+            quantity  = bplib_mpool_subq_get_depth(&subq_src->base_subq);
+            got_space =
+                ((bplib_mpool_subq_get_depth(&subq_dst->base_subq) + quantity) <= subq_dst->current_depth_limit);
+        }
+
+        if (got_space)
+        {
+            /* this does not fail, but must be done under lock to keep things consistent */
+            quantity = bplib_mpool_subq_workitem_move_all(subq_dst, subq_src);
+
+            /* mark the flow as "active" - the active list belongs to the pool, so this nests the pool lock */
+            pool_lock = bplib_mpool_lock_pool(pool);
+            bplib_mpool_job_mark_active_internal(&admin->active_list, &subq_dst->job_header);
+            bplib_mpool_lock_release(pool_lock);
+
+            /* in case any threads were waiting on a non-empty or non-full queue */
+            bplib_mpool_subq_workitem_notify_fill(subq_dst);
+            bplib_mpool_subq_workitem_notify_space(subq_src);
+            bplib_mpool_subq_workitem_update_notifier(subq_dst);
+            bplib_mpool_subq_workitem_check_watermarks(subq_dst);
+            bplib_mpool_subq_workitem_update_notifier(subq_src);
+            bplib_mpool_subq_workitem_check_watermarks(subq_src);
+        }
+        else
+        {
+            quantity = 0;
+        }
+
+        if (src_lock != NULL)
+        {
+            bplib_mpool_lock_release(src_lock);
+        }
+    }
+    else
+    {
+        quantity = 0;
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return quantity;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_disable
+ *
+ *-----------------------------------------------------------------*/
+uint32_t bplib_mpool_flow_disable(bplib_mpool_subq_workitem_t *subq)
+{
+    bplib_mpool_t      *pool;
+    bplib_mpool_lock_t *lock;
+    bplib_mpool_lock_t *pool_lock;
+    uint32_t            quantity_dropped;
+
+    pool = bplib_mpool_get_parent_pool_from_link(&subq->job_header.link);
+    lock = bplib_mpool_lock_resource(subq);
+
+    /* prevents any additional entries in flow queues */
+    subq->current_depth_limit = 0;
+
+    /* the recycled blocks and the active job list belong to the pool, so this nests the pool lock */
+    pool_lock = bplib_mpool_lock_pool(pool);
+    if (subq->ring != NULL)
+    {
+        /* the ring is only emptied by its consumer, which drops the entries as it pulls them.
+         * As the job is canceled here, the next push after it is enabled must mark it active again. */
+        quantity_dropped        = bplib_mpool_subq_get_depth(&subq->base_subq);
+        subq->ring->job_pending = 0;
+    }
+    else
+    {
+        quantity_dropped = bplib_mpool_subq_workitem_drop_all(pool, subq);
+    }
+
+    bplib_mpool_job_cancel_internal(&subq->job_header);
+    bplib_mpool_lock_release(pool_lock);
+
+    /* the dropped entries may have emptied the queue or taken it below its low watermark */
+    bplib_mpool_subq_workitem_update_notifier(subq);
+    bplib_mpool_subq_workitem_check_watermarks(subq);
+    bplib_mpool_lock_release(lock);
+
+    return quantity_dropped;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_enable
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_flow_enable(bplib_mpool_subq_workitem_t *subq, uint32_t depth_limit)
+{
+    bplib_mpool_lock_t *lock;
+
+    lock = bplib_mpool_lock_resource(subq);
+
+    /* prevents any additional entries in flow queues */
+    subq->current_depth_limit = depth_limit;
+
+    /* a higher limit may have made room for a thread waiting to push */
+    bplib_mpool_subq_workitem_notify_space(subq);
+
+    bplib_mpool_lock_release(lock);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_set_watermarks
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_flow_set_watermarks(bplib_mpool_subq_workitem_t *subq, uint32_t high_watermark, uint32_t low_watermark)
+{
+    bplib_mpool_lock_t *lock;
+
+    if (high_watermark != 0 && low_watermark >= high_watermark)
+    {
+        return BP_ERROR;
+    }
+
+    lock = bplib_mpool_lock_resource(subq);
+
+    subq->high_watermark = high_watermark;
+    subq->low_watermark  = low_watermark;
+
+    /* the queue may already be past the new marks, and if they are turned off while
+     * the queue is high, the event handler still gets the low watermark event */
+    if (high_watermark != 0)
+    {
+        bplib_mpool_subq_workitem_check_watermarks(subq);
+    }
+    else
+    {
+        bplib_mpool_subq_workitem_update_high_flag(subq, false);
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_set_quota
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_flow_set_quota(bplib_mpool_flow_t *flow, size_t limit, bool backpressure)
+{
+    __atomic_store_n(&flow->quota.backpressure, backpressure, __ATOMIC_RELAXED);
+    __atomic_store_n(&flow->quota.limit, limit, __ATOMIC_RELAXED);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_quota_admit
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_flow_quota_admit(bplib_mpool_flow_t *flow, size_t size)
+{
+    size_t limit;
+    size_t used;
+
+    if (flow == NULL)
+    {
+        return BP_SUCCESS;
+    }
+
+    limit = __atomic_load_n(&flow->quota.limit, __ATOMIC_RELAXED);
+    if (limit == 0)
+    {
+        return BP_SUCCESS;
+    }
+
+    used = __atomic_load_n(&flow->quota.used, __ATOMIC_RELAXED);
+    if (used < limit && size <= (limit - used))
+    {
+        return BP_SUCCESS;
+    }
+
+    __atomic_fetch_add(&flow->quota.over_count, 1, __ATOMIC_RELAXED);
+
+    if (__atomic_load_n(&flow->quota.backpressure, __ATOMIC_RELAXED))
+    {
+        return BP_TIMEOUT;
+    }
+
+    return BP_ERROR;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_attach_notifier
+ *
+ *-----------------------------------------------------------------*/
+int bplib_mpool_flow_attach_notifier(bplib_mpool_subq_workitem_t *subq)
+{
+    bplib_mpool_lock_t *lock;
+    int                 status;
+
+    if (subq->ring != NULL)
+    {
+        return BP_ERROR;
+    }
+
+    lock = bplib_mpool_lock_resource(subq);
+
+    if (!bp_handle_is_valid(subq->notifier))
+    {
+        subq->notifier     = bplib_os_create_notifier();
+        subq->notifier_set = false;
+    }
+
+    if (bp_handle_is_valid(subq->notifier))
+    {
+        /* the queue may already have something in it */
+        bplib_mpool_subq_workitem_update_notifier(subq);
+        status = BP_SUCCESS;
+    }
+    else
+    {
+        status = BP_ERROR;
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return status;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_subq_detach_notifier
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_subq_detach_notifier(bplib_mpool_subq_workitem_t *subq)
+{
+    if (bp_handle_is_valid(subq->notifier))
+    {
+        bplib_os_destroy_notifier(subq->notifier);
+        subq->notifier     = BP_INVALID_HANDLE;
+        subq->notifier_set = false;
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_flow_alloc
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_block_t *bplib_mpool_flow_alloc(bplib_mpool_t *pool, uint32_t magic_number, void *init_arg)
+{
+    bplib_mpool_block_content_t *result;
+
+    result = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_flow, magic_number, init_arg, BPLIB_MPOOL_ALLOC_PRI_LO);
 
     return (bplib_mpool_block_t *)result;
 }
@@ -480,7 +1938,7 @@ bool bplib_mpool_flow_modify_flags(bplib_mpool_block_t *cb, uint32_t set_bits, u
 
     pool  = bplib_mpool_get_parent_pool_from_link(cb);
     admin = bplib_mpool_get_admin(pool);
-    lock  = bplib_mpool_lock_resource(pool);
+    lock  = bplib_mpool_lock_pool(pool);
     flow  = bplib_mpool_flow_cast(cb);
     if (flow != NULL)
     {
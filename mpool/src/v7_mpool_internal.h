@@ -21,6 +21,7 @@
 #ifndef V7_MPOOL_INTERNAL_H
 #define V7_MPOOL_INTERNAL_H
 
+#include <assert.h>
 #include <string.h>
 
 #include "bplib_api_types.h"
@@ -33,24 +34,160 @@
 #include "v7_mpool_ref.h"
 
 /*
- * Minimum size of a generic data block
+ * Size of the user area in the small and large block size classes.
+ *
+ * The standard class (BP_MPOOL_MIN_USER_BLOCK_SIZE) can hold any type of block.  Small
+ * blocks are used for anything whose content fits, such as refs and small generic blocks.
+ * Large blocks are used for CBOR data chunks, when a large amount of data is written at once,
+ * and for block types whose fixed content is too big for a standard block, such as flows that
+ * carry the state of an interface.  With the block header, these are 128 and 4096 bytes on a
+ * 64-bit CPU.
  */
-#define BP_MPOOL_MIN_USER_BLOCK_SIZE 480
+#define BP_MPOOL_SMALL_USER_BLOCK_SIZE 96
+#define BP_MPOOL_LARGE_USER_BLOCK_SIZE 4064
+
+/*
+ * Share of the pool memory given to the small and large classes when the pool
+ * is created (percent).  The remainder is used for standard blocks.
+ */
+#ifndef BPLIB_MPOOL_SMALL_CLASS_PERCENT
+#define BPLIB_MPOOL_SMALL_CLASS_PERCENT 5
+#endif
+
+#ifndef BPLIB_MPOOL_LARGE_CLASS_PERCENT
+#define BPLIB_MPOOL_LARGE_CLASS_PERCENT 25
+#endif
+
+/*
+ * A small or large class is only created if the pool is big enough to have at least
+ * this many blocks of that class, otherwise the memory is used for standard blocks.
+ */
+#define BPLIB_MPOOL_SIZE_CLASS_MIN_BLOCKS 16
+
+/* registry_index value for a blocktype that is not in the index table */
+#define BPLIB_MPOOL_REGISTRY_INDEX_NONE 0xFF
+
+/*
+ * Set in the admin block once a pool is set up, so bplib_mpool_reattach() can tell a pool
+ * from any other memory.  This must be changed whenever the layout of the blocks changes.
+ */
+#define BPLIB_MPOOL_LAYOUT_SIGNATURE 0x6d701a01
+
+/* the refcount of a block that bplib_mpool_reattach() is keeping, no block in use ever gets this high */
+#define BPLIB_MPOOL_REATTACH_KEEP 0xFFFFFFFF
 
 #define MPOOL_CACHE_CBOR_DATA_SIGNATURE 0x6b243e33
+#define MPOOL_CACHE_CBOR_SLICE_SIGNATURE 0x4b9c6e21
+#define MPOOL_CACHE_CBOR_EXTERN_SIGNATURE 0x2f71d05a
+
+/*
+ * Per-thread block cache sizing - a thread keeps up to BPLIB_MPOOL_THREAD_CACHE_DEPTH
+ * free blocks, and moves blocks to/from the pool free list BPLIB_MPOOL_THREAD_CACHE_BATCH
+ * at a time.
+ */
+#define BPLIB_MPOOL_THREAD_CACHE_DEPTH 32
+#define BPLIB_MPOOL_THREAD_CACHE_BATCH 16
+
+/*
+ * Most blocks held on the deferred recycle list of a thread, after which they are handed
+ * to the pool even though the deferral is still in effect, so that GC is not kept waiting.
+ */
+#define BPLIB_MPOOL_RELEASE_DEFER_LIMIT 64
+
+/*
+ * Thread-local storage is a compiler extension in C99.  If not available, then
+ * the per-thread cache is not used, and all allocations go to the pool.
+ */
+#if !defined(BPLIB_MPOOL_THREAD_LOCAL) && (defined(__GNUC__) || defined(__clang__))
+#define BPLIB_MPOOL_THREAD_LOCAL __thread
+#endif
+
+/*
+ * Atomic operations are also a compiler extension in C99.  If available, refcounts are
+ * updated using these, otherwise refcounts are updated under the pool lock.  The pool
+ * statistics also use these when available, otherwise a count may occasionally be lost.
+ * Flow queues can only be made into lock-free rings if these are available.
+ */
+#if !defined(BPLIB_MPOOL_NO_ATOMIC_REFCOUNT) && (defined(__GNUC__) || defined(__clang__))
+#define BPLIB_MPOOL_ATOMIC_REFCOUNT
+#endif
+
+/* The lock profile records are shared between threads holding different locks */
+#if defined(BPLIB_LOCK_PROFILE) && !defined(BPLIB_MPOOL_ATOMIC_REFCOUNT)
+#error "BPLIB_LOCK_PROFILE requires atomic operations"
+#endif
 
 typedef struct bplib_mpool_lock
 {
-    bp_handle_t lock_id;
+    bplib_os_mutex_t *mutex;
+    uint32_t          wait_count[BPLIB_MPOOL_STAT_LOCK_WAIT_BINS]; /**< acquisitions by wait time, updated with lock held */
+#ifdef BPLIB_LOCK_PROFILE
+    bplib_mpool_lock_profile_t profile; /**< this lock as a whole */
+    bplib_mpool_lock_hold_t    hold;
+#endif
 } bplib_mpool_lock_t;
 
+/*
+ * A wait channel is where a thread sleeps while waiting for a specific condition on a
+ * resource, such as a queue becoming non-empty.  Channels are striped like the locks,
+ * but are selected by the condition rather than the resource lock, so a state change
+ * only wakes the threads waiting for that condition instead of every thread waiting
+ * on anything that happens to share the same lock.
+ */
+typedef struct bplib_mpool_wait_channel
+{
+    bplib_os_mutex_t *mutex;
+} bplib_mpool_wait_channel_t;
+
+/**
+ * Preferred size of the block holding a subq ring.  If the pool has large blocks this gets
+ * one, otherwise the ring is as big as will fit in a standard block.
+ */
+#define BPLIB_MPOOL_SUBQ_RING_SIZE_HINT 4096
+
+/*
+ * A flow subq in ring mode keeps its entries here rather than in its block_list.  The
+ * producer owns the push_count of the subq and the consumer owns the pull_count, and
+ * these are used as the ring positions.  This is the user content of a generic block.
+ */
+struct bplib_mpool_subq_ring
+{
+    bplib_mpool_block_t *storage_block; /**< the block holding this ring, recycled along with the flow */
+    uint32_t             ring_flags;    /**< BPLIB_MPOOL_RING_SINGLE_PRODUCER and/or BPLIB_MPOOL_RING_SINGLE_CONSUMER */
+    unsigned int         slot_mask;     /**< number of slots minus one, the number of slots is a power of two */
+    unsigned int         job_pending;   /**< set once the job is marked active, cleared when the ring is found empty */
+    bplib_mpool_block_t *slots[];
+};
+
+typedef struct bplib_mpool_subq_band
+{
+    bplib_mpool_subq_base_t subq;        /**< entries of this band, these counts are also the per-band stats */
+    uint32_t                depth_limit; /**< maximum depth of this band */
+    uint32_t                weight;      /**< entries per round in weighted mode */
+} bplib_mpool_subq_band_t;
+
+/*
+ * A flow subq with priority bands keeps its entries in these per-band queues rather than
+ * in the block_list of its base_subq.  The push_count and pull_count of the base_subq still
+ * cover all the bands, so its depth is the total.  This is the user content of a generic block.
+ */
+struct bplib_mpool_subq_bands
+{
+    bplib_mpool_block_t    *storage_block; /**< the block holding this, recycled along with the flow */
+    uint32_t                dequeue_mode;  /**< BPLIB_MPOOL_BANDS_DEQUEUE_STRICT or _WEIGHTED */
+    uint32_t                num_bands;     /**< number of entries used in band[] */
+    uint32_t                curr_band;     /**< band currently being served, in weighted mode */
+    uint32_t                curr_credit;   /**< entries left for curr_band in this round, in weighted mode */
+    bplib_mpool_subq_band_t band[BPLIB_MPOOL_SUBQ_MAX_BANDS];
+};
+
 typedef struct bplib_mpool_block_header
 {
     bplib_mpool_block_t base_link; /* must be first - this is the pointer used in the application */
 
+    /* note the actual length of user content (not including fixed fields) is in the base_link */
     uint32_t content_type_signature; /* a "signature" (sanity check) value for identifying the data */
-    uint16_t user_content_length;    /* actual length of user content (does not include fixed fields) */
-    uint16_t refcount;               /* number of active references to the object */
+    uint32_t refcount;               /* number of active references to the object */
 
 } bplib_mpool_block_header_t;
 
@@ -72,9 +209,31 @@ typedef struct bplib_mpool_api_content
     bplib_rbt_link_t            rbt_link;
     bplib_mpool_blocktype_api_t api;
     size_t                      user_content_size;
+    uint8_t                     registry_index; /**< position in the admin registry_index table */
     bplib_mpool_aligned_data_t  user_data_start;
 } bplib_mpool_api_content_t;
 
+/*
+ * A slice is a ref block to a CBOR data block, which stands in for the part of that data
+ * starting at the offset.  The length of the slice is its user content length.
+ */
+typedef struct bplib_mpool_bblock_cbor_slice
+{
+    size_t offset;
+} bplib_mpool_bblock_cbor_slice_t;
+
+/*
+ * An external buffer is a generic block which stands in for data outside the pool.  It is only
+ * read through slices, and the release function is called when the block is recycled.
+ */
+typedef struct bplib_mpool_bblock_cbor_extern
+{
+    const void                  *data_ptr;
+    size_t                       data_size;
+    bplib_payload_release_func_t release_func;
+    void                        *release_arg;
+} bplib_mpool_bblock_cbor_extern_t;
+
 typedef struct bplib_mpool_generic_data_content
 {
     bplib_mpool_aligned_data_t user_data_start;
@@ -104,10 +263,47 @@ typedef struct bplib_mpool_block_ref_content
     bplib_mpool_aligned_data_t user_data_start;
 } bplib_mpool_block_ref_content_t;
 
+/*
+ * Additional size classes are each a contiguous region of the pool memory, after the
+ * standard blocks.  The region position is in units of BPLIB_MPOOL_BLOCK_GRANULE, which
+ * is the same value as the parent_offset of the blocks, so the class of a block can
+ * be identified directly from its parent_offset.
+ */
+typedef struct bplib_mpool_size_class
+{
+    size_t                  block_size;     /**< size of each block in this class, including the header */
+    uint32_t                num_bufs_total; /**< number of blocks in this class */
+    uint32_t                region_start;   /**< parent_offset of the first block in this class */
+    uint32_t                region_end;     /**< parent_offset just beyond the last block in this class */
+    bplib_mpool_subq_base_t free_blocks;    /**< blocks of this class which are available for use */
+} bplib_mpool_size_class_t;
+
+/*
+ * Pool statistics, see bplib_mpool_stat_t for the meaning of each
+ */
+typedef struct bplib_mpool_stats
+{
+    uint32_t alloc_count[bplib_mpool_blocktype_max];
+    uint32_t free_count[bplib_mpool_blocktype_max];
+    uint32_t priority_alloc_count[BPLIB_MPOOL_STAT_PRIORITY_BANDS];
+    uint32_t alloc_refused_count;
+    uint32_t free_depth_pos; /**< total number of samples taken, the next one goes at this position (modulo) */
+    uint32_t free_depth_history[BPLIB_MPOOL_STAT_DEPTH_SAMPLES];
+
+    /* histograms for each job type, indexed by BPLIB_MPOOL_STAT_JOB_TIME_INDEX() */
+    uint32_t job_wait_time[bplib_mpool_jobtype_max * BPLIB_MPOOL_STAT_JOB_TIME_BINS];
+    uint32_t job_run_time[bplib_mpool_jobtype_max * BPLIB_MPOOL_STAT_JOB_TIME_BINS];
+
+} bplib_mpool_stats_t;
+
 typedef struct bplib_mpool_block_admin_content
 {
     size_t   buffer_size;
+    size_t   pool_size;        /**< as passed to bplib_mpool_create(), checked by bplib_mpool_reattach() */
+    void    *pool_base;        /**< where the pool was created, the links are only valid at this address */
+    uint32_t layout_signature; /**< BPLIB_MPOOL_LAYOUT_SIGNATURE once the pool is set up */
     uint32_t num_bufs_total;
+    uint32_t pool_extent; /**< size of the pool, in units of BPLIB_MPOOL_BLOCK_GRANULE */
     uint32_t bblock_alloc_threshold;   /**< threshold at which new bundles will no longer be allocatable */
     uint32_t internal_alloc_threshold; /**< threshold at which internal blocks will no longer be allocatable */
     uint32_t max_alloc_watermark;
@@ -116,9 +312,29 @@ typedef struct bplib_mpool_block_admin_content
     bplib_mpool_api_content_t blocktype_basic;    /**< a fixed entity in the registry for type 0 */
     bplib_mpool_api_content_t blocktype_cbor;     /**< a fixed entity in the registry for CBOR blocks */
 
+    /* the same registry entries, by registry_index - this table is at the end of the pool memory */
+    bplib_mpool_api_content_t **registry_index;
+    uint32_t                    registry_index_count;
+
+    /* always-on counters, see bplib_mpool_query_stat() - this is at the end of the pool memory with the index,
+     * and is NULL if the pool is too small for it */
+    bplib_mpool_stats_t *stats;
+
+    /* if this pool is one partition of a larger pool, all the partitions (otherwise NULL) */
+    struct bplib_mpool **partition_table;
+    uint32_t             partition_index; /**< position of this pool in the partition_table */
+    uint32_t             num_partitions;
+
     bplib_mpool_subq_base_t free_blocks;    /**< blocks which are available for use */
     bplib_mpool_subq_base_t recycle_blocks; /**< blocks which can be garbage-collected */
 
+    bplib_mpool_size_class_t small_class; /**< blocks smaller than standard, for refs etc. */
+    bplib_mpool_size_class_t large_class; /**< blocks larger than standard, for CBOR data */
+
+    /* standard blocks that have never been used, if the pool was created with lazy init */
+    struct bplib_mpool_block_content *lazy_next_block;
+    uint32_t                          lazy_block_count;
+
     /* note that the active_list and managed_block_list are not FIFO in nature, as blocks
      * can be removed from the middle of the list or otherwise rearranged. Therefore a subq
      * is not used for these, because the push_count and pull_count would not remain accurate. */
@@ -127,6 +343,37 @@ typedef struct bplib_mpool_block_admin_content
 
 } bplib_mpool_block_admin_content_t;
 
+/*
+ * A magazine of free blocks private to one thread, so allocations and frees
+ * can be done without the pool lock in the common case
+ */
+typedef struct bplib_mpool_thread_cache
+{
+    bplib_mpool_t             *pool;          /**< pool that the cached blocks belong to, NULL if not attached */
+    bplib_mpool_block_t        block_list;    /**< free blocks held by this thread */
+    uint32_t                   block_count;   /**< number of blocks in block_list */
+    uint32_t                   api_signature; /**< signature of the most recently used blocktype */
+    bplib_mpool_api_content_t *api_block;     /**< registry entry for api_signature */
+
+    bplib_mpool_thread_cache_stats_t stats;
+
+} bplib_mpool_thread_cache_t;
+
+/*
+ * Blocks of one pool released by a thread while it has deferral in effect, which are all
+ * put on the pool recycle list at once when it ends, under one lock
+ */
+typedef struct bplib_mpool_release_defer
+{
+    bplib_mpool_t      *pool;        /**< pool that the deferred blocks belong to, NULL if not deferring */
+    bplib_mpool_block_t block_list;  /**< blocks waiting to go on the recycle list of the pool */
+    uint32_t            block_count; /**< number of blocks in block_list */
+    uint32_t            depth;       /**< number of bplib_mpool_release_defer_begin() calls not yet ended */
+    uint32_t            defer_count; /**< blocks put on block_list */
+    uint32_t            flush_count; /**< times block_list was given to the pool */
+
+} bplib_mpool_release_defer_t;
+
 typedef union bplib_mpool_block_buffer
 {
     bplib_mpool_generic_data_content_t     generic_data;
@@ -153,6 +400,20 @@ struct bplib_mpool
     bplib_mpool_block_content_t admin_block; /**< Start of first real block (see num_bufs_total) */
 };
 
+/*
+ * Helper to get the alignment of a block - all blocks of every size class are a multiple
+ * of this size, and the parent_offset of a block is the distance from the admin block in these units.
+ */
+struct bplib_mpool_block_content_align
+{
+    /* This byte only exists to check the offset of the following member */
+    /* cppcheck-suppress unusedStructMember */
+    uint8_t                     byte;
+    bplib_mpool_block_content_t content;
+};
+
+#define BPLIB_MPOOL_BLOCK_GRANULE (offsetof(struct bplib_mpool_block_content_align, content))
+
 #define MPOOL_GET_BUFFER_USER_START_OFFSET(m) (offsetof(bplib_mpool_block_buffer_t, m.user_data_start))
 
 #define MPOOL_GET_BLOCK_USER_CAPACITY(m) (sizeof(bplib_mpool_block_buffer_t) - MPOOL_GET_BUFFER_USER_START_OFFSET(m))
@@ -171,19 +432,78 @@ static inline bplib_mpool_block_admin_content_t *bplib_mpool_get_admin(bplib_mpo
     return &pool->admin_block.u.admin;
 }
 
+/**
+ * @brief Increments a pool statistic
+ *
+ * This may be called without the lock held
+ *
+ * @param counter
+ */
+static inline void bplib_mpool_stat_increment(uint32_t *counter)
+{
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+#else
+    ++(*counter);
+#endif
+}
+
+/**
+ * @brief Acquires a given lock, waiting for it and recording the wait time
+ *
+ * This is the slow path of bplib_mpool_lock_acquire(), it should not be called directly
+ *
+ * @param lock
+ */
+void bplib_mpool_lock_acquire_contended(bplib_mpool_lock_t *lock);
+
 /**
  * @brief Acquires a given lock
  *
- * The lock should be identified via bplib_mpool_lock_prepare() or this
+ * The lock should be identified via bplib_mpool_lock_prepare() or
+ * bplib_mpool_lock_prepare_pool(), or this
  * can re-acquire the same lock again after releasing it with
  * bplib_mpool_lock_release().
  *
  * @param lock
  */
+#ifndef BPLIB_LOCK_PROFILE
 static inline void bplib_mpool_lock_acquire(bplib_mpool_lock_t *lock)
 {
-    bplib_os_lock(lock->lock_id);
+    /* the clock is only read if the lock is not immediately available */
+    if (bplib_os_mutex_trylock(lock->mutex) == BP_SUCCESS)
+    {
+        ++lock->wait_count[0];
+    }
+    else
+    {
+        bplib_mpool_lock_acquire_contended(lock);
+    }
 }
+#else
+/*
+ * In the profile build every acquisition is counted against its call site, so the
+ * acquire calls are routed here with the location of the caller.
+ */
+#define bplib_mpool_lock_acquire(lock) bplib_mpool_lock_acquire_at(lock, __func__, __LINE__)
+
+static inline void bplib_mpool_lock_acquire_at(bplib_mpool_lock_t *lock, const char *func, uint32_t line)
+{
+    uint64_t start_us;
+
+    if (bplib_os_mutex_trylock(lock->mutex) == BP_SUCCESS)
+    {
+        ++lock->wait_count[0];
+        bplib_mpool_lock_profile_acquired(&lock->hold, func, line, false, 0);
+    }
+    else
+    {
+        start_us = bplib_os_get_monotonic_us();
+        bplib_mpool_lock_acquire_contended(lock);
+        bplib_mpool_lock_profile_acquired(&lock->hold, func, line, true, bplib_os_get_monotonic_us() - start_us);
+    }
+}
+#endif
 
 /**
  * @brief Release a given lock (simple)
@@ -197,7 +517,10 @@ static inline void bplib_mpool_lock_acquire(bplib_mpool_lock_t *lock)
  */
 static inline void bplib_mpool_lock_release(bplib_mpool_lock_t *lock)
 {
-    bplib_os_unlock(lock->lock_id);
+#ifdef BPLIB_LOCK_PROFILE
+    bplib_mpool_lock_profile_released(&lock->hold);
+#endif
+    bplib_os_mutex_unlock(lock->mutex);
 }
 
 /**
@@ -212,9 +535,36 @@ static inline void bplib_mpool_lock_release(bplib_mpool_lock_t *lock)
  */
 static inline void bplib_mpool_lock_broadcast_signal(bplib_mpool_lock_t *lock)
 {
-    bplib_os_broadcast_signal(lock->lock_id);
+    bplib_os_mutex_broadcast(lock->mutex);
 }
 
+/*
+ * Lock ordering rules
+ *
+ * The locks are striped - each resource is mapped to one of a fixed set of locks based
+ * on a hash of its address.  Unrelated resources may share a lock, but the same resource
+ * always maps to the same lock.  There are two separate sets:
+ *
+ *  - The resource lock set, from bplib_mpool_lock_resource().  Flow subqueues
+ *    (bplib_mpool_subq_workitem_t) are locked by the address of the workitem, which protects
+ *    the queue contents, counters, and depth limit.  Without atomic operations, refcounts
+ *    are also updated under the lock of the block, which is never held while taking another.
+ *  - The pool lock set, from bplib_mpool_lock_pool().  This protects everything in the admin
+ *    block, such as the free/recycle lists, the active job list and the blocktype registry.
+ *
+ * As a pool lock is never the same mutex as a subqueue lock, when more than one lock is needed
+ * they must be acquired in this order:
+ *
+ *  1. Subqueue locks, lowest lock first (by position in the lock set) if two are needed
+ *  2. The pool lock, always last, and only one pool at a time
+ *  3. A wait channel lock, which is only held briefly and never while acquiring another lock
+ *
+ * The locks are recursive, so acquiring a lock that happens to be the same stripe as
+ * one already held is harmless.  Wait channel locks are not recursive.  However,
+ * bplib_mpool_lock_wait() and bplib_mpool_wait_channel_wait() must only be called when
+ * exactly one lock is held, at a depth of one, so it is fully released while waiting.
+ */
+
 /**
  * @brief Prepares for resource-based locking
  *
@@ -222,6 +572,7 @@ static inline void bplib_mpool_lock_broadcast_signal(bplib_mpool_lock_t *lock)
  *
  * @note  it is imperative that all calls use the same referece address (such as the head
  * of the list) when referring to the same resource for locking to work correctly.
+ * See the lock ordering rules above when taking more than one lock.
  *
  * @param resource_addr
  * @return bplib_mpool_lock_t*
@@ -241,6 +592,37 @@ bplib_mpool_lock_t *bplib_mpool_lock_prepare(void *resource_addr);
  */
 bplib_mpool_lock_t *bplib_mpool_lock_resource(void *resource_addr);
 
+#ifdef BPLIB_LOCK_PROFILE
+bplib_mpool_lock_t *bplib_mpool_lock_resource_at(void *resource_addr, const char *func, uint32_t line);
+#define bplib_mpool_lock_resource(addr) bplib_mpool_lock_resource_at(addr, __func__, __LINE__)
+#endif
+
+/**
+ * @brief Prepares for locking a pool
+ *
+ * Same as bplib_mpool_lock_prepare(), but locates the lock of the pool (or partition)
+ * in the pool lock set.  See the lock ordering rules above.
+ *
+ * @param pool
+ * @return bplib_mpool_lock_t*
+ */
+bplib_mpool_lock_t *bplib_mpool_lock_prepare_pool(bplib_mpool_t *pool);
+
+/**
+ * @brief Lock a pool
+ *
+ * Locates the lock of the pool (or partition) and acquires it.  This protects the admin block.
+ *
+ * @param pool
+ * @return bplib_mpool_lock_t*
+ */
+bplib_mpool_lock_t *bplib_mpool_lock_pool(bplib_mpool_t *pool);
+
+#ifdef BPLIB_LOCK_PROFILE
+bplib_mpool_lock_t *bplib_mpool_lock_pool_at(bplib_mpool_t *pool, const char *func, uint32_t line);
+#define bplib_mpool_lock_pool(pool) bplib_mpool_lock_pool_at(pool, __func__, __LINE__)
+#endif
+
 /**
  * @brief Waits for a state change related to the given lock
  *
@@ -253,6 +635,46 @@ bplib_mpool_lock_t *bplib_mpool_lock_resource(void *resource_addr);
  */
 bool bplib_mpool_lock_wait(bplib_mpool_lock_t *lock, uint64_t until_dtntime);
 
+/**
+ * @brief Locates the wait channel for the given condition
+ *
+ * As with locks, it is imperative that all calls use the same reference address
+ * when referring to the same condition.  Different conditions on the same resource
+ * should use different addresses within that resource.
+ *
+ * @param condition_addr
+ * @return bplib_mpool_wait_channel_t*
+ */
+bplib_mpool_wait_channel_t *bplib_mpool_wait_channel_prepare(void *condition_addr);
+
+/**
+ * @brief Waits on a wait channel for a state change related to the given lock
+ *
+ * This is the same as bplib_mpool_lock_wait() but the thread sleeps on the channel, and
+ * is only woken by bplib_mpool_wait_channel_wake() on the same channel.  The resource
+ * lock is released while waiting and re-acquired before returning.
+ *
+ * @note The resource must be locked when called, and the same rules as bplib_mpool_lock_wait() apply.
+ *
+ * @param lock
+ * @param channel
+ * @param until_dtntime
+ * @return true
+ * @return false
+ */
+bool bplib_mpool_wait_channel_wait(bplib_mpool_lock_t *lock, bplib_mpool_wait_channel_t *channel,
+                                   uint64_t until_dtntime);
+
+/**
+ * @brief Wakes all threads waiting on the given wait channel
+ *
+ * @note This must be called with the lock of the resource held, the same lock that the waiting
+ * threads passed to bplib_mpool_wait_channel_wait(), otherwise a wakeup may be missed.
+ *
+ * @param channel
+ */
+void bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_t *channel);
+
 void bplib_mpool_bblock_primary_init(bplib_mpool_block_t *base_block, bplib_mpool_bblock_primary_t *pblk);
 void bplib_mpool_bblock_canonical_init(bplib_mpool_block_t *base_block, bplib_mpool_bblock_canonical_t *cblk);
 void bplib_mpool_subq_init(bplib_mpool_block_t *base_block, bplib_mpool_subq_base_t *qblk);
@@ -278,6 +700,36 @@ void bplib_mpool_subq_push_single(bplib_mpool_subq_base_t *subq, bplib_mpool_blo
  */
 bplib_mpool_block_t *bplib_mpool_subq_pull_single(bplib_mpool_subq_base_t *subq);
 
+/**
+ * @brief Append blocks from a list to the given queue (flow)
+ *
+ * Blocks are taken from the head of the list, in order, until the list is empty
+ * or the limit is reached.  The push count is updated once for the whole batch.
+ *
+ * @note This should only be called from internal contexts where a lock is held
+ *
+ * @param subq
+ * @param list the source list
+ * @param limit maximum number of blocks to move
+ * @return uint32_t number of blocks moved
+ */
+uint32_t bplib_mpool_subq_push_n(bplib_mpool_subq_base_t *subq, bplib_mpool_block_t *list, uint32_t limit);
+
+/**
+ * @brief Get the next bundles from the given queue (flow)
+ *
+ * Blocks are appended to the list in queue order, until the queue is empty or
+ * the limit is reached.  The pull count is updated once for the whole batch.
+ *
+ * @note This should only be called from internal contexts where a lock is held
+ *
+ * @param subq
+ * @param list the destination list
+ * @param limit maximum number of blocks to move
+ * @return uint32_t number of blocks moved
+ */
+uint32_t bplib_mpool_subq_pull_n(bplib_mpool_subq_base_t *subq, bplib_mpool_block_t *list, uint32_t limit);
+
 /**
  * @brief Counts the number of blocks in a list
  *
@@ -332,6 +784,44 @@ uint32_t bplib_mpool_subq_move_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpoo
  */
 uint32_t bplib_mpool_subq_drop_all(bplib_mpool_t *pool, bplib_mpool_subq_base_t *subq);
 
+/**
+ * @brief Moves the entire contents of a ring subq, and the ring itself, to another subq
+ *
+ * This is used when the flow is being recycled, so the subq is no longer in use by any
+ * producer or consumer.  The subq reverts to a normal (empty) queue.  Nothing is done if
+ * the subq is not a ring.
+ *
+ * @note This should only be called from internal contexts where a lock is held
+ *
+ * @param subq_dst the destination, normally the recycle list
+ * @param subq the ring subq
+ * @return uint32_t The number of blocks moved, including the ring storage block
+ */
+uint32_t bplib_mpool_subq_ring_detach_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpool_subq_workitem_t *subq);
+
+/**
+ * @brief Moves the entire contents of a subq with priority bands, and the bands themselves, to another subq
+ *
+ * Like bplib_mpool_subq_ring_detach_all(), this is used when the flow is being recycled, and
+ * the subq reverts to a normal (empty) queue.  Nothing is done if the subq does not have bands.
+ *
+ * @note This should only be called from internal contexts where a lock is held
+ *
+ * @param subq_dst the destination, normally the recycle list
+ * @param subq the subq with bands
+ * @return uint32_t The number of blocks moved, including the band storage block
+ */
+uint32_t bplib_mpool_subq_bands_detach_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpool_subq_workitem_t *subq);
+
+/**
+ * @brief Destroys the notifier of a subq, if it has one
+ *
+ * This is used when the flow is being recycled, see bplib_mpool_flow_attach_notifier()
+ *
+ * @param subq the subq
+ */
+void bplib_mpool_subq_detach_notifier(bplib_mpool_subq_workitem_t *subq);
+
 void bplib_mpool_job_cancel_internal(bplib_mpool_job_t *job);
 void bplib_mpool_job_mark_active_internal(bplib_mpool_block_t *active_list, bplib_mpool_job_t *job);
 
@@ -342,6 +832,105 @@ const bplib_mpool_block_content_t *bplib_mpool_get_block_content_const(const bpl
 /* similar to bplib_mpool_get_block_content() but also dereferences any ref blocks */
 bplib_mpool_block_content_t *bplib_mpool_block_dereference_content(bplib_mpool_block_t *cb);
 
+/*
+ * Unchecked casts, for places within mpool where the type of the block is already known,
+ * such as the canonical blocks in the list of a primary, or the flow that owns a subq.
+ *
+ * When built with BPLIB_MPOOL_UNCHECKED_CASTS (the BPLIB_ENABLE_UNCHECKED_CASTS option) these
+ * skip the checks of the blocktype and the content signature, which are left as assert() only.
+ * Otherwise they are the same as the checked functions, so the callers still check for NULL.
+ *
+ * The public cast functions are always checked, these must never be used on a block that
+ * the caller of the API supplied.
+ */
+#ifdef BPLIB_MPOOL_UNCHECKED_CASTS
+
+static inline bplib_mpool_block_content_t *bplib_mpool_block_dereference_content_unchecked(bplib_mpool_block_t *cb)
+{
+    bplib_mpool_block_content_t *block_ptr;
+
+    assert(cb != NULL && bplib_mpool_is_any_content_node(cb));
+
+    block_ptr = (bplib_mpool_block_content_t *)(void *)cb;
+    while (block_ptr->header.base_link.type == bplib_mpool_blocktype_ref)
+    {
+        block_ptr = block_ptr->u.ref.pref_target;
+    }
+
+    return block_ptr;
+}
+
+static inline void *bplib_mpool_generic_data_cast_unchecked(bplib_mpool_block_t *cb, uint32_t required_magic)
+{
+    bplib_mpool_block_content_t *block;
+
+    /* unlike the checked call, this does not look through refs for the signature */
+    block = (bplib_mpool_block_content_t *)(void *)cb;
+    assert(cb != NULL && bplib_mpool_is_any_content_node(cb));
+    assert(block->header.content_type_signature == required_magic);
+
+    return &block->u.content_bytes[bplib_mpool_get_user_data_offset_by_blocktype(block->header.base_link.type)];
+}
+
+static inline bplib_mpool_bblock_primary_t *bplib_mpool_bblock_primary_cast_unchecked(bplib_mpool_block_t *cb)
+{
+    bplib_mpool_block_content_t *content;
+
+    content = bplib_mpool_block_dereference_content_unchecked(cb);
+    assert(content->header.base_link.type == bplib_mpool_blocktype_primary);
+
+    return &content->u.primary.pblock;
+}
+
+static inline bplib_mpool_bblock_canonical_t *bplib_mpool_bblock_canonical_cast_unchecked(bplib_mpool_block_t *cb)
+{
+    bplib_mpool_block_content_t *content;
+
+    content = bplib_mpool_block_dereference_content_unchecked(cb);
+    assert(content->header.base_link.type == bplib_mpool_blocktype_canonical);
+
+    return &content->u.canonical.cblock;
+}
+
+static inline bplib_mpool_flow_t *bplib_mpool_flow_cast_unchecked(bplib_mpool_block_t *cb)
+{
+    bplib_mpool_block_content_t *content;
+
+    content = bplib_mpool_block_dereference_content_unchecked(cb);
+    assert(content->header.base_link.type == bplib_mpool_blocktype_flow);
+
+    return &content->u.flow.fblock;
+}
+
+#else
+
+static inline bplib_mpool_block_content_t *bplib_mpool_block_dereference_content_unchecked(bplib_mpool_block_t *cb)
+{
+    return bplib_mpool_block_dereference_content(cb);
+}
+
+static inline void *bplib_mpool_generic_data_cast_unchecked(bplib_mpool_block_t *cb, uint32_t required_magic)
+{
+    return bplib_mpool_generic_data_cast(cb, required_magic);
+}
+
+static inline bplib_mpool_bblock_primary_t *bplib_mpool_bblock_primary_cast_unchecked(bplib_mpool_block_t *cb)
+{
+    return bplib_mpool_bblock_primary_cast(cb);
+}
+
+static inline bplib_mpool_bblock_canonical_t *bplib_mpool_bblock_canonical_cast_unchecked(bplib_mpool_block_t *cb)
+{
+    return bplib_mpool_bblock_canonical_cast(cb);
+}
+
+static inline bplib_mpool_flow_t *bplib_mpool_flow_cast_unchecked(bplib_mpool_block_t *cb)
+{
+    return bplib_mpool_flow_cast(cb);
+}
+
+#endif /* BPLIB_MPOOL_UNCHECKED_CASTS */
+
 void bplib_mpool_init_base_object(bplib_mpool_block_header_t *block_hdr, uint16_t user_content_length,
                                   uint32_t content_type_signature);
 
@@ -349,4 +938,84 @@ bplib_mpool_block_content_t *bplib_mpool_alloc_block_internal(bplib_mpool_t *poo
                                                               uint32_t content_type_signature, void *init_arg,
                                                               uint8_t priority);
 
+/**
+ * @brief Allocates a block with a preferred data capacity
+ *
+ * Same as bplib_mpool_alloc_block_internal(), but if size_hint is larger than the capacity of
+ * a standard block, this will use a block from the large size class if one is available.
+ *
+ * @note this must be invoked with the lock already held
+ */
+bplib_mpool_block_content_t *bplib_mpool_alloc_sized_block_internal(bplib_mpool_t          *pool,
+                                                                    bplib_mpool_blocktype_t blocktype,
+                                                                    uint32_t content_type_signature, void *init_arg,
+                                                                    uint8_t priority, size_t size_hint);
+
+/**
+ * @brief Gets the size of the content area of a block, based on its size class
+ *
+ * This is sizeof(bplib_mpool_block_buffer_t) for standard blocks (and blocks outside of a pool)
+ *
+ * @param block
+ * @return size_t
+ */
+size_t bplib_mpool_get_block_buffer_size(const bplib_mpool_block_content_t *block);
+
+/**
+ * @brief Allocates a block, using the thread cache if possible
+ *
+ * This tries the per-thread cache of the calling thread first, which does not need the pool lock.
+ * If that does not work, this locks the pool and calls bplib_mpool_alloc_block_internal().
+ *
+ * @note The pool lock must NOT already be held when calling this
+ */
+bplib_mpool_block_content_t *bplib_mpool_alloc_block(bplib_mpool_t *pool, bplib_mpool_blocktype_t blocktype,
+                                                     uint32_t content_type_signature, void *init_arg, uint8_t priority);
+
+/**
+ * @brief Gets the partition of a pool that is local to the calling thread
+ *
+ * This is the partition the thread cache is attached to, if it is attached to one of
+ * the partitions of this pool.  Otherwise it is selected by the CPU the thread is running on.
+ * If the pool is not partitioned, this is just the pool itself.
+ */
+bplib_mpool_t *bplib_mpool_get_local_partition(bplib_mpool_t *pool);
+
+/**
+ * @brief Allocates a block from the partition local to the calling thread
+ *
+ * If the local partition cannot supply the block, the other partitions are tried in order.
+ * If the pool is not partitioned, this is the same as bplib_mpool_alloc_block(), or if size_hint
+ * is nonzero, bplib_mpool_alloc_sized_block_internal() under lock.
+ *
+ * @note The pool lock must NOT already be held when calling this
+ */
+bplib_mpool_block_content_t *bplib_mpool_alloc_local_block(bplib_mpool_t *pool, bplib_mpool_blocktype_t blocktype,
+                                                           uint32_t content_type_signature, void *init_arg,
+                                                           uint8_t priority, size_t size_hint);
+
+/**
+ * @brief Allocates several blocks of the same type at once
+ *
+ * All the blocks are taken within a single lock of the pool, and are appended to the given list.
+ * This stops at the first allocation that does not succeed.
+ *
+ * @note The pool lock must NOT already be held when calling this
+ *
+ * @returns The number of blocks that were appended to the list
+ */
+uint32_t bplib_mpool_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, uint32_t count,
+                             bplib_mpool_blocktype_t blocktype, uint32_t content_type_signature, void *init_arg,
+                             uint8_t priority);
+
+/**
+ * @brief Returns a fully de-initialized block to the free blocks
+ *
+ * If the calling thread has a cache for this pool, the block is kept there, otherwise it goes
+ * back to the pool free list.
+ *
+ * @note The pool lock must already be held when calling this
+ */
+void bplib_mpool_free_block_internal(bplib_mpool_t *pool, bplib_mpool_block_t *blk);
+
 #endif /* V7_MPOOL_INTERNAL_H */
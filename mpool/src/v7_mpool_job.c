@@ -41,6 +41,11 @@
 void bplib_mpool_job_init(bplib_mpool_block_t *base_block, bplib_mpool_job_t *jblk)
 {
     bplib_mpool_init_secondary_link(base_block, &jblk->link, bplib_mpool_blocktype_job);
+    jblk->activate_time_us = 0;
+    jblk->jobtype          = bplib_mpool_jobtype_other;
+    jblk->quantum_bytes    = false;
+    jblk->quantum          = 0;
+    jblk->deficit          = 0;
 }
 
 /*----------------------------------------------------------------
@@ -76,6 +81,12 @@ void bplib_mpool_job_cancel_internal(bplib_mpool_job_t *job)
  *-----------------------------------------------------------------*/
 void bplib_mpool_job_mark_active_internal(bplib_mpool_block_t *active_list, bplib_mpool_job_t *job)
 {
+    /* if it was already active, the wait is still counted from the first time */
+    if (bplib_mpool_is_link_unattached(&job->link))
+    {
+        job->activate_time_us = (uint32_t)bplib_os_get_monotonic_us();
+    }
+
     /* first cancel the job it if it was already active */
     /* this permits it to be marked as active multiple times, it will still only be in the runnable list once */
     bplib_mpool_job_cancel_internal(job);
@@ -99,7 +110,7 @@ void bplib_mpool_job_mark_active(bplib_mpool_job_t *job)
     pool  = bplib_mpool_get_parent_pool_from_link(&job->link);
     admin = bplib_mpool_get_admin(pool);
 
-    lock = bplib_mpool_lock_resource(pool);
+    lock = bplib_mpool_lock_pool(pool);
     bplib_mpool_job_mark_active_internal(&admin->active_list, job);
     bplib_mpool_lock_broadcast_signal(lock);
     bplib_mpool_lock_release(lock);
@@ -121,7 +132,7 @@ bplib_mpool_job_t *bplib_mpool_job_get_next_active(bplib_mpool_t *pool)
 
     do
     {
-        lock = bplib_mpool_lock_resource(pool);
+        lock = bplib_mpool_lock_pool(pool);
 
         /* if the head is reached here, then the list is empty */
         jblk = bplib_mpool_get_next_block(&admin->active_list);
@@ -142,14 +153,199 @@ bplib_mpool_job_t *bplib_mpool_job_get_next_active(bplib_mpool_t *pool)
     return job;
 }
 
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_claim_next_active
+ *
+ *-----------------------------------------------------------------*/
+bplib_mpool_job_t *bplib_mpool_job_claim_next_active(bplib_mpool_t *pool)
+{
+    bplib_mpool_job_t                 *job;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_block_t               *jblk;
+    bplib_mpool_flow_t                *flow;
+    bplib_mpool_block_admin_content_t *admin;
+
+    admin = bplib_mpool_get_admin(pool);
+    job   = NULL;
+    lock  = bplib_mpool_lock_pool(pool);
+
+    jblk = bplib_mpool_get_next_block(&admin->active_list);
+    while (!bplib_mpool_is_list_head(jblk))
+    {
+        /* the jobs of a flow that is already being run by another thread are left for later */
+        flow = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(jblk));
+        if (flow == NULL || !flow->jobs_running)
+        {
+            bplib_mpool_extract_node(jblk);
+            job = bplib_mpool_job_cast(jblk);
+            if (job != NULL)
+            {
+                if (flow != NULL)
+                {
+                    flow->jobs_running = true;
+                }
+                break;
+            }
+
+            /* not a job, this does not belong here (same as bplib_mpool_job_get_next_active) */
+            jblk = bplib_mpool_get_next_block(&admin->active_list);
+        }
+        else
+        {
+            jblk = bplib_mpool_get_next_block(jblk);
+        }
+    }
+
+    bplib_mpool_lock_release(lock);
+
+    return job;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_release
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_job_release(bplib_mpool_job_t *job)
+{
+    bplib_mpool_lock_t *lock;
+    bplib_mpool_flow_t *flow;
+
+    flow = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(&job->link));
+    if (flow != NULL)
+    {
+        lock               = bplib_mpool_lock_pool(bplib_mpool_get_parent_pool_from_link(&job->link));
+        flow->jobs_running = false;
+        bplib_mpool_lock_release(lock);
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_set_quantum
+ *
+ *-----------------------------------------------------------------*/
+void bplib_mpool_job_set_quantum(bplib_mpool_job_t *job, uint32_t quantum, bool in_bytes)
+{
+    /* a quantum bigger than this could not be told apart from a debt */
+    if (quantum > INT32_MAX)
+    {
+        quantum = INT32_MAX;
+    }
+
+    job->quantum_bytes = in_bytes;
+    job->quantum       = quantum;
+    job->deficit       = 0;
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_spend_share
+ *
+ *-----------------------------------------------------------------*/
+bool bplib_mpool_job_spend_share(bplib_mpool_job_t *job, bplib_mpool_block_t *qblk)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    int64_t                       deficit;
+    size_t                        size;
+
+    if (job->quantum == 0)
+    {
+        return false;
+    }
+
+    /* anything that is not a bundle, or not encoded yet, counts as one byte */
+    size = 1;
+    if (job->quantum_bytes)
+    {
+        pri_block = bplib_mpool_bblock_primary_cast(qblk);
+        if (pri_block != NULL && pri_block->bundle_encode_size_cache != 0)
+        {
+            size = pri_block->bundle_encode_size_cache;
+        }
+    }
+
+    /* the debt is kept to at most one quantum, so a huge entry does not stall the job for long */
+    deficit = (int64_t)job->deficit - (int64_t)size;
+    if (deficit < -(int64_t)job->quantum)
+    {
+        deficit = -(int64_t)job->quantum;
+    }
+
+    job->deficit = (int32_t)deficit;
+
+    return (job->deficit <= 0);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_refill_share
+ *
+ * Adds the quantum of a job to its share before it is run, and since
+ * the share is not saved up past one quantum, a job that was idle
+ * does not get to take more than others when it comes back.
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_job_refill_share(bplib_mpool_job_t *job)
+{
+    if (job->quantum != 0)
+    {
+        job->deficit += (int32_t)job->quantum;
+        if (job->deficit > (int32_t)job->quantum)
+        {
+            job->deficit = (int32_t)job->quantum;
+        }
+    }
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_record_time
+ *
+ * Counts a job time in the histogram for its job type
+ *-----------------------------------------------------------------*/
+static void bplib_mpool_job_record_time(uint32_t *histogram, bplib_mpool_jobtype_t jobtype, uint32_t elapsed_us)
+{
+    uint32_t bin;
+    uint32_t bin_limit_us;
+
+    /* bins are by powers of 10 from 100us, the last is for anything longer */
+    bin          = 0;
+    bin_limit_us = 100;
+    while (bin < (BPLIB_MPOOL_STAT_JOB_TIME_BINS - 1) && elapsed_us >= bin_limit_us)
+    {
+        ++bin;
+        bin_limit_us *= 10;
+    }
+
+    bplib_mpool_stat_increment(&histogram[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(jobtype, bin)]);
+}
+
+/*----------------------------------------------------------------
+ *
+ * Function: bplib_mpool_job_run_all
+ *
+ *-----------------------------------------------------------------*/
 void bplib_mpool_job_run_all(bplib_mpool_t *pool, void *arg)
 {
-    bplib_mpool_job_t *job;
+    bplib_mpool_job_t     *job;
+    bplib_mpool_stats_t   *stats;
+    bplib_mpool_jobtype_t  jobtype;
+    bplib_mpool_flow_t    *flow;
+    bplib_mpool_reserve_t *prev_reserve;
+    uint32_t               start_time_us;
+
+    stats = bplib_mpool_get_admin(pool)->stats;
+
+    /* the bundles let go of by the jobs here are all recycled together at the end */
+    bplib_mpool_release_defer_begin(pool);
 
     /* forward any bundles between interfaces, based on active flow list */
     while (true)
     {
-        job = bplib_mpool_job_get_next_active(pool);
+        /* when several threads run this, any job skipped here
+         * is picked up by the thread that has its flow */
+        job = bplib_mpool_job_claim_next_active(pool);
         if (job == NULL)
         {
             break;
@@ -159,9 +355,39 @@ void bplib_mpool_job_run_all(bplib_mpool_t *pool, void *arg)
          * deferred to a lower priority task if necessary, but this will be sure to get it done */
         bplib_mpool_maintain(pool);
 
+        jobtype = bplib_mpool_jobtype_other;
+        if (job->jobtype < bplib_mpool_jobtype_max)
+        {
+            jobtype = job->jobtype;
+        }
+
+        start_time_us = (uint32_t)bplib_os_get_monotonic_us();
+        if (stats != NULL)
+        {
+            bplib_mpool_job_record_time(stats->job_wait_time, jobtype, start_time_us - job->activate_time_us);
+        }
+
+        bplib_mpool_job_refill_share(job);
+
+        BPLIB_TRACEPOINT(job_start, jobtype, (uintptr_t)job, 0);
         if (job->handler != NULL)
         {
+            /* the jobs of a flow can use the blocks it has set aside, if any */
+            flow         = bplib_mpool_flow_cast(bplib_mpool_get_block_from_link(&job->link));
+            prev_reserve = bplib_mpool_reserve_enter((flow != NULL) ? &flow->reserve : NULL);
             job->handler(arg, &job->link);
+            bplib_mpool_reserve_leave(prev_reserve);
+        }
+
+        BPLIB_TRACEPOINT(job_stop, jobtype, (uintptr_t)job, 0);
+        if (stats != NULL)
+        {
+            bplib_mpool_job_record_time(stats->job_run_time, jobtype,
+                                        (uint32_t)bplib_os_get_monotonic_us() - start_time_us);
         }
+
+        bplib_mpool_job_release(job);
     }
+
+    bplib_mpool_release_defer_end();
 }
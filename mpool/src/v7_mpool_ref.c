@@ -38,17 +38,28 @@
  *-----------------------------------------------------------------*/
 bplib_mpool_ref_t bplib_mpool_ref_duplicate(bplib_mpool_ref_t refptr)
 {
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    uint32_t prev_count;
+#else
     bplib_mpool_lock_t *lock;
+#endif
 
     /*
      * If the refcount is 0, that means this is still a regular (non-refcounted) object,
      * or it should have been garbage-collected already, so something is broken.
      */
 
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    /* the caller already holds a ref, so the block cannot go away while doing this */
+    prev_count = __atomic_fetch_add(&refptr->header.refcount, 1, __ATOMIC_RELAXED);
+    assert(prev_count > 0);
+    (void)prev_count;
+#else
     lock = bplib_mpool_lock_resource(&refptr->header.base_link);
     assert(refptr->header.refcount > 0);
     ++refptr->header.refcount;
     bplib_mpool_lock_release(lock);
+#endif
 
     return refptr;
 }
@@ -61,7 +72,9 @@ bplib_mpool_ref_t bplib_mpool_ref_duplicate(bplib_mpool_ref_t refptr)
 bplib_mpool_ref_t bplib_mpool_ref_create(bplib_mpool_block_t *blk)
 {
     bplib_mpool_block_content_t *content;
-    bplib_mpool_lock_t          *lock;
+#ifndef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    bplib_mpool_lock_t *lock;
+#endif
 
     /*
      * This drills down to the actual base object (the "root" so to speak), so that the
@@ -75,9 +88,13 @@ bplib_mpool_ref_t bplib_mpool_ref_create(bplib_mpool_block_t *blk)
         return NULL;
     }
 
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    __atomic_fetch_add(&content->header.refcount, 1, __ATOMIC_RELAXED);
+#else
     lock = bplib_mpool_lock_resource(content);
     ++content->header.refcount;
     bplib_mpool_lock_release(lock);
+#endif
 
     return content;
 }
@@ -91,16 +108,13 @@ bplib_mpool_block_t *bplib_mpool_ref_make_block(bplib_mpool_ref_t refptr, uint32
 {
     bplib_mpool_block_content_t *rblk;
     bplib_mpool_block_content_t *bblk;
-    bplib_mpool_lock_t          *lock;
     bplib_mpool_t               *pool;
 
     bblk = bplib_mpool_block_dereference_content(bplib_mpool_dereference(refptr));
     pool = bplib_mpool_get_parent_pool_from_link(&bblk->header.base_link);
 
-    lock = bplib_mpool_lock_resource(pool);
-    rblk = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_ref, magic_number, init_arg,
-                                            BPLIB_MPOOL_ALLOC_PRI_MHI);
-    bplib_mpool_lock_release(lock);
+    rblk = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_ref, magic_number, init_arg,
+                                         BPLIB_MPOOL_ALLOC_PRI_MHI, 0);
 
     if (rblk == NULL)
     {
@@ -139,13 +153,31 @@ bplib_mpool_ref_t bplib_mpool_ref_from_block(bplib_mpool_block_t *rblk)
 void bplib_mpool_ref_release(bplib_mpool_ref_t refptr)
 {
     bplib_mpool_block_header_t *block_hdr;
-    bplib_mpool_lock_t         *lock;
     bool                        needs_recycle;
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+    uint32_t prev_count;
+#else
+    bplib_mpool_lock_t *lock;
+#endif
 
     if (refptr != NULL)
     {
         block_hdr = &refptr->header;
 
+#ifdef BPLIB_MPOOL_ATOMIC_REFCOUNT
+        /*
+         * The refcount must never go below zero, so this is a compare-and-swap rather than a
+         * plain decrement.  The release ordering makes any changes by this thread visible to
+         * the thread that does the recycle, which only happens on the decrement to zero.
+         */
+        prev_count = __atomic_load_n(&block_hdr->refcount, __ATOMIC_RELAXED);
+        while (prev_count > 0 && !__atomic_compare_exchange_n(&block_hdr->refcount, &prev_count, prev_count - 1, true,
+                                                              __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            /* prev_count was updated with the current value, so just try again */
+        }
+        needs_recycle = (prev_count <= 1);
+#else
         /*
          * Refcount decrement must be done under lock, but it can be
          * a fine-grained lock.
@@ -157,6 +189,7 @@ void bplib_mpool_ref_release(bplib_mpool_ref_t refptr)
         }
         needs_recycle = (block_hdr->refcount == 0);
         bplib_mpool_lock_release(lock);
+#endif
 
         if (needs_recycle)
         {
@@ -44,6 +44,7 @@ void bplib_mpool_start_stream_init(bplib_mpool_stream_t *mps, bplib_mpool_t *poo
 
 size_t bplib_mpool_stream_write(bplib_mpool_stream_t *mps, const void *data, size_t size)
 {
+    bplib_mpool_block_t  avail_list;
     bplib_mpool_block_t *next_block;
     const uint8_t       *chunk_p;
     uint8_t             *out_p;
@@ -55,6 +56,16 @@ size_t bplib_mpool_stream_write(bplib_mpool_stream_t *mps, const void *data, siz
         return 0;
     }
 
+    /*
+     * Get all the blocks needed for this write at once, to avoid locking the pool once per block.
+     * If the current block has enough space left, this does not allocate anything.
+     */
+    bplib_mpool_init_list_head(NULL, &avail_list);
+    if (size > (mps->curr_limit - mps->curr_pos))
+    {
+        bplib_mpool_bblock_cbor_alloc_n(mps->pool, &avail_list, size - (mps->curr_limit - mps->curr_pos));
+    }
+
     remain_sz = size;
     chunk_p   = data;
     while (remain_sz > 0)
@@ -62,12 +73,13 @@ size_t bplib_mpool_stream_write(bplib_mpool_stream_t *mps, const void *data, siz
         /* If no block is ready, get one now */
         if (mps->curr_pos >= mps->curr_limit)
         {
-            next_block = bplib_mpool_bblock_cbor_alloc(mps->pool);
-            if (next_block == NULL)
+            if (bplib_mpool_is_empty_list_head(&avail_list))
             {
                 break;
             }
 
+            next_block = bplib_mpool_get_next_block(&avail_list);
+            bplib_mpool_extract_node(next_block);
             bplib_mpool_bblock_cbor_append(&mps->head, next_block);
 
             mps->last_eblk  = next_block;
@@ -92,9 +104,50 @@ size_t bplib_mpool_stream_write(bplib_mpool_stream_t *mps, const void *data, siz
         chunk_p += chunk_sz;
     }
 
+    /* this should not happen, but in case any blocks were not used, return them now */
+    if (bplib_mpool_is_nonempty_list_head(&avail_list))
+    {
+        bplib_mpool_recycle_all_blocks_in_list(mps->pool, &avail_list);
+    }
+
     return (size - remain_sz);
 }
 
+/*
+ * Moves a read stream straight to the start of the last indexed block that starts at or before target_position,
+ * from where the rest of the seek only has to go forward within that block, or on past the end of the index
+ */
+static void bplib_mpool_stream_index_jump(bplib_mpool_stream_t *mps, size_t target_position)
+{
+    const bplib_mpool_stream_index_entry_t *entry;
+    size_t                                  lo;
+    size_t                                  hi;
+    size_t                                  mid;
+
+    /* the first entry always starts at 0, so there is always one at or before the target */
+    lo = 0;
+    hi = mps->index_count;
+    while ((hi - lo) > 1)
+    {
+        mid = lo + ((hi - lo) / 2);
+        if (mps->index[mid].position <= target_position)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    entry = &mps->index[lo];
+
+    mps->last_eblk       = entry->blk;
+    mps->curr_limit      = bplib_mpool_get_user_content_size(entry->blk);
+    mps->curr_pos        = 0;
+    mps->stream_position = entry->position;
+}
+
 size_t bplib_mpool_stream_seek(bplib_mpool_stream_t *mps, size_t target_position)
 {
     bplib_mpool_block_t *next_block;
@@ -102,6 +155,11 @@ size_t bplib_mpool_stream_seek(bplib_mpool_stream_t *mps, size_t target_position
     size_t               block_avail;
     size_t               chunk_sz;
 
+    if (mps->dir == bplib_mpool_stream_dir_read && mps->index_count > 0)
+    {
+        bplib_mpool_stream_index_jump(mps, target_position);
+    }
+
     /*
      * Loop to move the stream position forward
      * On a read this should just advance through the existing data
@@ -121,7 +179,7 @@ size_t bplib_mpool_stream_seek(bplib_mpool_stream_t *mps, size_t target_position
             }
             else if (mps->dir == bplib_mpool_stream_dir_write)
             {
-                next_block = bplib_mpool_bblock_cbor_alloc(mps->pool);
+                next_block = bplib_mpool_bblock_cbor_alloc_sized(mps->pool, chunk_sz);
             }
             else
             {
@@ -214,13 +272,45 @@ size_t bplib_mpool_stream_seek(bplib_mpool_stream_t *mps, size_t target_position
     return mps->stream_position;
 }
 
-size_t bplib_mpool_stream_read(bplib_mpool_stream_t *mps, void *data, size_t size)
+/*
+ * Gets where the stream is in the current block of a read stream, and how much of the block is left,
+ * going on to the next block if the current one is done.  Returns NULL at the end of the stream.
+ */
+static const uint8_t *bplib_mpool_stream_read_span(bplib_mpool_stream_t *mps, size_t *span_sz)
 {
     bplib_mpool_block_t *next_block;
     const uint8_t       *in_p;
-    uint8_t             *chunk_p;
-    size_t               chunk_sz;
-    size_t               remain_sz;
+
+    /* If no block is ready, get one now */
+    if (mps->curr_pos >= mps->curr_limit)
+    {
+        next_block = bplib_mpool_get_next_block(mps->last_eblk);
+        in_p       = bplib_mpool_bblock_cbor_cast(next_block);
+        if (in_p == NULL)
+        {
+            /* end of stream */
+            return NULL;
+        }
+
+        mps->last_eblk  = next_block;
+        mps->curr_limit = bplib_mpool_get_user_content_size(next_block);
+        mps->curr_pos   = 0;
+    }
+    else
+    {
+        in_p = bplib_mpool_bblock_cbor_cast(mps->last_eblk);
+    }
+
+    *span_sz = mps->curr_limit - mps->curr_pos;
+    return in_p + mps->curr_pos;
+}
+
+size_t bplib_mpool_stream_read(bplib_mpool_stream_t *mps, void *data, size_t size)
+{
+    const uint8_t *in_p;
+    uint8_t       *chunk_p;
+    size_t         chunk_sz;
+    size_t         remain_sz;
 
     if (mps->dir != bplib_mpool_stream_dir_read || size == 0)
     {
@@ -231,33 +321,17 @@ size_t bplib_mpool_stream_read(bplib_mpool_stream_t *mps, void *data, size_t siz
     chunk_p   = data;
     while (remain_sz > 0)
     {
-        /* If no block is ready, get one now */
-        if (mps->curr_pos >= mps->curr_limit)
-        {
-            next_block = bplib_mpool_get_next_block(mps->last_eblk);
-            in_p       = bplib_mpool_bblock_cbor_cast(next_block);
-            if (in_p == NULL)
-            {
-                /* end of stream */
-                break;
-            }
-
-            mps->last_eblk  = next_block;
-            mps->curr_limit = bplib_mpool_get_user_content_size(next_block);
-            mps->curr_pos   = 0;
-        }
-        else
+        in_p = bplib_mpool_stream_read_span(mps, &chunk_sz);
+        if (in_p == NULL)
         {
-            in_p = bplib_mpool_bblock_cbor_cast(mps->last_eblk);
+            break;
         }
 
-        chunk_sz = mps->curr_limit - mps->curr_pos;
         if (chunk_sz > remain_sz)
         {
             chunk_sz = remain_sz;
         }
 
-        in_p += mps->curr_pos;
         memcpy(chunk_p, in_p, chunk_sz);
 
         mps->curr_pos += chunk_sz;
@@ -269,6 +343,48 @@ size_t bplib_mpool_stream_read(bplib_mpool_stream_t *mps, void *data, size_t siz
     return (size - remain_sz);
 }
 
+size_t bplib_mpool_stream_read_iov(bplib_mpool_stream_t *mps, bplib_iovec_t *iov, size_t *iov_count, size_t size)
+{
+    const uint8_t *in_p;
+    size_t         chunk_sz;
+    size_t         remain_sz;
+    size_t         used;
+
+    used      = 0;
+    remain_sz = size;
+    if (mps->dir == bplib_mpool_stream_dir_read)
+    {
+        while (remain_sz > 0 && used < *iov_count)
+        {
+            in_p = bplib_mpool_stream_read_span(mps, &chunk_sz);
+            if (in_p == NULL)
+            {
+                break;
+            }
+
+            if (chunk_sz > remain_sz)
+            {
+                chunk_sz = remain_sz;
+            }
+
+            /* an empty block does not need an entry */
+            if (chunk_sz > 0)
+            {
+                iov[used].base = in_p;
+                iov[used].len  = chunk_sz;
+                ++used;
+            }
+
+            mps->curr_pos += chunk_sz;
+            mps->stream_position += chunk_sz;
+            remain_sz -= chunk_sz;
+        }
+    }
+
+    *iov_count = used;
+    return (size - remain_sz);
+}
+
 void bplib_mpool_stream_attach(bplib_mpool_stream_t *mps, bplib_mpool_block_t *head)
 {
     bplib_mpool_merge_list(head, &mps->head);
@@ -280,6 +396,52 @@ void bplib_mpool_stream_attach(bplib_mpool_stream_t *mps, bplib_mpool_block_t *h
     mps->stream_position = 0;
 }
 
+void bplib_mpool_stream_read_list(bplib_mpool_stream_t *mps, bplib_mpool_block_t *list)
+{
+    /* the blocks are never put on the stream head, so closing the stream does not free them */
+    mps->index_count     = 0;
+    mps->last_eblk       = list;
+    mps->curr_limit      = 0;
+    mps->curr_pos        = 0;
+    mps->stream_position = 0;
+}
+
+void bplib_mpool_stream_set_index(bplib_mpool_stream_t *mps, bplib_mpool_stream_index_entry_t *entries,
+                                  size_t max_entries)
+{
+    bplib_mpool_block_t *blk;
+    size_t               position;
+
+    mps->index       = entries;
+    mps->index_count = 0;
+
+    /* a write stream is only ever added to at the end, so there is nothing to index */
+    if (mps->dir != bplib_mpool_stream_dir_read)
+    {
+        return;
+    }
+
+    bplib_mpool_stream_seek(mps, 0);
+
+    /* this is either on the head of the list still, or at the start of the first block */
+    blk = mps->last_eblk;
+    if (bplib_mpool_bblock_cbor_cast(blk) == NULL)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+    }
+
+    position = 0;
+    while (mps->index_count < max_entries && bplib_mpool_bblock_cbor_cast(blk) != NULL)
+    {
+        entries[mps->index_count].blk      = blk;
+        entries[mps->index_count].position = position;
+        ++mps->index_count;
+
+        position += bplib_mpool_get_user_content_size(blk);
+        blk = bplib_mpool_get_next_block(blk);
+    }
+}
+
 void bplib_mpool_stream_close(bplib_mpool_stream_t *mps)
 {
     /* discard anything that wasn't saved (will be a no-op if it was saved) */
@@ -48,5 +48,6 @@ void TestBplibMpoolJob_Register(void);
 void TestBplibMpoolRef_Register(void);
 void TestBplibMpoolBase_Register(void);
 void TestBplibMpoolMPStream_Register(void);
+void TestBplibMpoolUnchecked_Register(void);
 
 #endif
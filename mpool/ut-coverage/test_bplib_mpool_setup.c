@@ -40,7 +40,7 @@ void test_make_singleton_link(bplib_mpool_t *parent_pool, bplib_mpool_block_t *b
 {
     if (parent_pool != NULL)
     {
-        b->parent_offset = ((uintptr_t)b - (uintptr_t)parent_pool) / sizeof(bplib_mpool_block_content_t);
+        b->parent_offset = ((uintptr_t)b - (uintptr_t)parent_pool) / BPLIB_MPOOL_BLOCK_GRANULE;
     }
     else
     {
@@ -54,8 +54,9 @@ void test_make_singleton_link(bplib_mpool_t *parent_pool, bplib_mpool_block_t *b
 void test_setup_mpblock(bplib_mpool_t *pool, bplib_mpool_block_content_t *b, bplib_mpool_blocktype_t blktype,
                         uint32 sig)
 {
-    b->header.base_link.type         = blktype;
-    b->header.content_type_signature = sig;
+    b->header.base_link.type           = blktype;
+    b->header.base_link.registry_index = 0;
+    b->header.content_type_signature   = sig;
     test_make_singleton_link(pool, &b->header.base_link);
 
     /*
@@ -110,10 +111,17 @@ void test_setup_allocation(bplib_mpool_t *pool, bplib_mpool_block_content_t *db,
 
 void UtTest_Setup(void)
 {
+#ifndef BPLIB_MPOOL_UNCHECKED_CASTS
     TestBplibMpoolBase_Register();
     TestBplibMpoolRef_Register();
     TestBplibMpoolBBlocks_Register();
     TestBplibMpoolJob_Register();
     TestBplibMpoolFlows_Register();
     TestBplibMpoolMPStream_Register();
+#endif
+    /*
+     * With the unchecked casts the other tests would reach the asserts, as they give the
+     * pool blocks of the wrong type on purpose, so that build only runs this one
+     */
+    TestBplibMpoolUnchecked_Register();
 }
@@ -24,6 +24,7 @@
 #include "uttest.h"
 
 #include "test_bplib_mpool.h"
+#include "bplib.h"
 #include "v7_mpool.h"
 
 const uint32 UT_TESTBLOCKTYPE_SIG = 0x5f33c01a;
@@ -46,11 +47,16 @@ void test_bplib_mpool_lock_init(void)
      * void bplib_mpool_lock_init(void)
      */
 
-    UT_SetDefaultReturnValue(UT_KEY(bplib_os_createlock), 1);
+    static uint8_t dummy_mutex;
+    uint32         create_count;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_create), UT_AltHandler_PointerReturn, &dummy_mutex);
 
     /* Call it twice, first time should init, second time should skip init */
     UtAssert_VOIDCALL(bplib_mpool_lock_init());
+    create_count = UT_GetStubCount(UT_KEY(bplib_os_mutex_create));
     UtAssert_VOIDCALL(bplib_mpool_lock_init());
+    UtAssert_STUB_COUNT(bplib_os_mutex_create, create_count);
 }
 
 void test_bplib_mpool_lock_prepare(void)
@@ -59,7 +65,27 @@ void test_bplib_mpool_lock_prepare(void)
      * bplib_mpool_lock_t *bplib_mpool_lock_prepare(void *resource_addr)
      */
 
+    uint8_t             resource_buf[512];
+    bplib_mpool_lock_t *lock;
+    bool                is_striped;
+    uint32_t            i;
+
     UtAssert_NOT_NULL(bplib_mpool_lock_prepare(NULL));
+
+    /* The same resource must always map to the same lock */
+    UtAssert_NOT_NULL(lock = bplib_mpool_lock_prepare(&resource_buf[0]));
+    UtAssert_ADDRESS_EQ(bplib_mpool_lock_prepare(&resource_buf[0]), lock);
+
+    /* Adjacent resources should be spread across more than one lock */
+    is_striped = false;
+    for (i = 16; i < sizeof(resource_buf); i += 16)
+    {
+        if (bplib_mpool_lock_prepare(&resource_buf[i]) != lock)
+        {
+            is_striped = true;
+        }
+    }
+    UtAssert_BOOL_TRUE(is_striped);
 }
 
 void test_bplib_mpool_lock_resource(void)
@@ -71,6 +97,30 @@ void test_bplib_mpool_lock_resource(void)
     UtAssert_NOT_NULL(bplib_mpool_lock_resource(NULL));
 }
 
+void test_bplib_mpool_lock_pool(void)
+{
+    /* Test function for:
+     * bplib_mpool_lock_t *bplib_mpool_lock_prepare_pool(bplib_mpool_t *pool)
+     * bplib_mpool_lock_t *bplib_mpool_lock_pool(bplib_mpool_t *pool)
+     */
+
+    uint8_t             resource_buf[512];
+    bplib_mpool_lock_t *lock;
+    uint32_t            i;
+
+    UtAssert_NOT_NULL(lock = bplib_mpool_lock_prepare_pool((bplib_mpool_t *)&resource_buf[0]));
+    UtAssert_ADDRESS_EQ(bplib_mpool_lock_prepare_pool((bplib_mpool_t *)&resource_buf[0]), lock);
+    UtAssert_ADDRESS_EQ(bplib_mpool_lock_pool((bplib_mpool_t *)&resource_buf[0]), lock);
+    bplib_mpool_lock_release(lock);
+
+    /* A pool lock is never one of the resource locks, whatever the addresses, so it can always be taken last */
+    for (i = 0; i < sizeof(resource_buf); i += 16)
+    {
+        UtAssert_True(bplib_mpool_lock_prepare(&resource_buf[i]) != lock, "resource lock %lu is not the pool lock",
+                      (unsigned long)i);
+    }
+}
+
 void test_bplib_mpool_lock_wait(void)
 {
     /* Test function for:
@@ -82,10 +132,75 @@ void test_bplib_mpool_lock_wait(void)
     UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 1000);
     UtAssert_BOOL_FALSE(bplib_mpool_lock_wait(lock, 0));
     UtAssert_BOOL_TRUE(bplib_mpool_lock_wait(lock, 5000));
-    UT_SetDefaultReturnValue(UT_KEY(bplib_os_wait_until_ms), BP_TIMEOUT);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_wait_until_ms), BP_TIMEOUT);
     UtAssert_BOOL_FALSE(bplib_mpool_lock_wait(lock, 5000));
 }
 
+void test_bplib_mpool_wait_channel_prepare(void)
+{
+    /* Test function for:
+     * bplib_mpool_wait_channel_t *bplib_mpool_wait_channel_prepare(void *condition_addr)
+     */
+
+    uint8_t                     condition_buf[512];
+    bplib_mpool_wait_channel_t *channel;
+    bool                        is_striped;
+    uint32_t                    i;
+
+    UtAssert_NOT_NULL(bplib_mpool_wait_channel_prepare(NULL));
+
+    /* The same condition must always map to the same channel */
+    UtAssert_NOT_NULL(channel = bplib_mpool_wait_channel_prepare(&condition_buf[0]));
+    UtAssert_ADDRESS_EQ(bplib_mpool_wait_channel_prepare(&condition_buf[0]), channel);
+
+    /* Adjacent conditions should be spread across more than one channel */
+    is_striped = false;
+    for (i = 16; i < sizeof(condition_buf); i += 16)
+    {
+        if (bplib_mpool_wait_channel_prepare(&condition_buf[i]) != channel)
+        {
+            is_striped = true;
+        }
+    }
+    UtAssert_BOOL_TRUE(is_striped);
+}
+
+void test_bplib_mpool_wait_channel_wait(void)
+{
+    /* Test function for:
+     * bool bplib_mpool_wait_channel_wait(bplib_mpool_lock_t *lock, bplib_mpool_wait_channel_t *channel,
+     *      uint64_t until_dtntime)
+     */
+
+    bplib_mpool_lock_t         *lock    = bplib_mpool_lock_prepare(NULL);
+    bplib_mpool_wait_channel_t *channel = bplib_mpool_wait_channel_prepare(NULL);
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_ms), 1000);
+    UtAssert_BOOL_FALSE(bplib_mpool_wait_channel_wait(lock, channel, 0));
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 0);
+
+    /* the resource lock is given up while waiting on the channel, then taken back */
+    UtAssert_BOOL_TRUE(bplib_mpool_wait_channel_wait(lock, channel, 5000));
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_lock, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_unlock, 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_trylock, 1);
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_wait_until_ms), BP_TIMEOUT);
+    UtAssert_BOOL_FALSE(bplib_mpool_wait_channel_wait(lock, channel, 5000));
+}
+
+void test_bplib_mpool_wait_channel_wake(void)
+{
+    /* Test function for:
+     * void bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_t *channel)
+     */
+
+    UtAssert_VOIDCALL(bplib_mpool_wait_channel_wake(bplib_mpool_wait_channel_prepare(NULL)));
+    UtAssert_STUB_COUNT(bplib_os_mutex_lock, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
+}
+
 void test_bplib_mpool_block_from_external_id(void)
 {
     /* Test function for:
@@ -108,9 +223,12 @@ void test_bplib_mpool_block_from_external_id(void)
     UtAssert_NULL(bplib_mpool_block_from_external_id(&buf.pool, id1));
     UtAssert_NULL(bplib_mpool_block_from_external_id(&buf.pool, id2));
 
-    buf.pool.admin_block.u.admin.num_bufs_total = 3;
+    buf.pool.admin_block.u.admin.pool_extent = (3 * sizeof(bplib_mpool_block_content_t)) / BPLIB_MPOOL_BLOCK_GRANULE;
     UtAssert_ADDRESS_EQ(bplib_mpool_block_from_external_id(&buf.pool, id1), &buf.blk[0].header.base_link);
     UtAssert_ADDRESS_EQ(bplib_mpool_block_from_external_id(&buf.pool, id2), &buf.blk[1].header.base_link);
+
+    /* an ID that does not refer to the start of a block */
+    UtAssert_NULL(bplib_mpool_block_from_external_id(&buf.pool, bp_handle_from_serial(1, BPLIB_HANDLE_MPOOL_BASE)));
 }
 
 void test_bplib_mpool_get_block_from_link(void)
@@ -387,7 +505,7 @@ void test_bplib_mpool_get_user_content_size(void)
 
     memset(&my_block, 0, sizeof(my_block));
     test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, 0);
-    my_block.header.user_content_length = 14;
+    my_block.header.base_link.user_content_length = 14;
 
     UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(&my_block.header.base_link), 14);
 }
@@ -408,6 +526,22 @@ void test_bplib_mpool_read_refcount(void)
     UtAssert_UINT32_EQ(bplib_mpool_read_refcount(&my_block.header.base_link), 6);
 }
 
+void test_bplib_mpool_get_block_footprint(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_get_block_footprint(const bplib_mpool_block_t *cb)
+     */
+    bplib_mpool_block_content_t my_block;
+
+    UtAssert_ZERO(bplib_mpool_get_block_footprint(NULL));
+
+    /* a block outside of a pool is always a standard block */
+    memset(&my_block, 0, sizeof(my_block));
+    test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, 0);
+    UtAssert_UINT32_EQ(bplib_mpool_get_block_footprint(&my_block.header.base_link),
+                       offsetof(bplib_mpool_block_content_t, u) + sizeof(bplib_mpool_block_buffer_t));
+}
+
 void test_bplib_mpool_get_parent_pool_from_link(void)
 {
     /* Test function for:
@@ -478,7 +612,7 @@ void test_bplib_mpool_init_base_object(void)
     UtAssert_VOIDCALL(bplib_mpool_init_base_object(&my_block.header, UT_LEN, UT_SIG));
 
     UtAssert_UINT32_EQ(my_block.header.content_type_signature, UT_SIG);
-    UtAssert_UINT16_EQ(my_block.header.user_content_length, UT_LEN);
+    UtAssert_UINT16_EQ(my_block.header.base_link.user_content_length, UT_LEN);
 }
 
 void test_bplib_mpool_alloc_block_internal(void)
@@ -549,6 +683,175 @@ void test_bplib_mpool_generic_data_alloc(void)
     UtAssert_ADDRESS_EQ(bplib_mpool_generic_data_alloc(&buf.pool, 0, &my_constructor_val), &buf.blk[0]);
 }
 
+void test_bplib_mpool_generic_data_alloc_n(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_generic_data_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, uint32_t count,
+     *                                           uint32_t magic_number, void *init_arg)
+     */
+
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t  list;
+
+    memset(&buf, 0, sizeof(buf));
+    bplib_mpool_init_list_head(NULL, &list);
+
+    /* This only has one free block, so it should stop after that */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_UINT32_EQ(bplib_mpool_generic_data_alloc_n(&buf.pool, &list, 3, 0, NULL), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &buf.blk[0]);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&buf.blk[0].header.base_link), &list);
+
+    UtAssert_ZERO(bplib_mpool_generic_data_alloc_n(&buf.pool, &list, 3, 0, NULL));
+    UtAssert_ZERO(bplib_mpool_generic_data_alloc_n(&buf.pool, &list, 0, 0, NULL));
+}
+
+void test_bplib_mpool_reserve(void)
+{
+    /* Test function for:
+     * void bplib_mpool_reserve_init(bplib_mpool_block_t *base_block, bplib_mpool_reserve_t *rsv)
+     * int bplib_mpool_reserve_set_target(bplib_mpool_t *pool, bplib_mpool_reserve_t *rsv, uint32_t target_count)
+     * void bplib_mpool_reserve_release(bplib_mpool_reserve_t *rsv)
+     * bplib_mpool_reserve_t *bplib_mpool_reserve_enter(bplib_mpool_reserve_t *rsv)
+     * void bplib_mpool_reserve_leave(bplib_mpool_reserve_t *prev)
+     */
+
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_reserve_t              rsv;
+    bplib_mpool_reserve_t             *prev;
+    bplib_mpool_lock_t                *lock;
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    admin                 = bplib_mpool_get_admin(&buf.pool);
+    admin->num_bufs_total = 3;
+
+    UtAssert_VOIDCALL(bplib_mpool_reserve_init(NULL, &rsv));
+    UtAssert_NULL(rsv.pool);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&rsv.block_list));
+
+    /* giving a block away would take the pool under its bundle threshold */
+    admin->bblock_alloc_threshold = 1;
+    UtAssert_INT32_EQ(bplib_mpool_reserve_set_target(&buf.pool, &rsv, 1), BP_ERROR);
+    UtAssert_ZERO(rsv.block_count);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 1);
+
+    admin->bblock_alloc_threshold = 0;
+    UtAssert_INT32_EQ(bplib_mpool_reserve_set_target(&buf.pool, &rsv, 1), BP_SUCCESS);
+    UtAssert_UINT32_EQ(rsv.block_count, 1);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&admin->free_blocks));
+    UtAssert_UINT32_EQ(admin->max_alloc_watermark, 3);
+
+    /* the reserved block is not given to anyone else */
+    UtAssert_NULL(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL));
+
+    /* but is used once the reserve is entered */
+    UtAssert_NULL(bplib_mpool_reserve_enter(&rsv));
+    UtAssert_ADDRESS_EQ(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL), &buf.blk[0]);
+    UtAssert_ZERO(rsv.block_count);
+    UtAssert_UINT32_EQ(rsv.use_count, 1);
+    UtAssert_NULL(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL));
+
+    /* entering none stops the use of it until the leave */
+    UtAssert_ADDRESS_EQ(bplib_mpool_reserve_enter(NULL), &rsv);
+    UtAssert_VOIDCALL(bplib_mpool_reserve_leave(&rsv));
+    UtAssert_VOIDCALL(bplib_mpool_reserve_leave(NULL));
+
+    /* the block goes back to the pool when freed, and into the reserve when it is next entered */
+    lock = bplib_mpool_lock_pool(&buf.pool);
+    UtAssert_VOIDCALL(bplib_mpool_free_block_internal(&buf.pool, &buf.blk[0].header.base_link));
+    bplib_mpool_lock_release(lock);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 1);
+    prev = bplib_mpool_reserve_enter(&rsv);
+    UtAssert_NULL(prev);
+    UtAssert_UINT32_EQ(rsv.block_count, 1);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&admin->free_blocks));
+    UtAssert_VOIDCALL(bplib_mpool_reserve_leave(prev));
+
+    /* making it smaller gives the blocks back */
+    UtAssert_INT32_EQ(bplib_mpool_reserve_set_target(&buf.pool, &rsv, 0), BP_SUCCESS);
+    UtAssert_ZERO(rsv.block_count);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 1);
+
+    UtAssert_INT32_EQ(bplib_mpool_reserve_set_target(&buf.pool, &rsv, 1), BP_SUCCESS);
+    UtAssert_VOIDCALL(bplib_mpool_reserve_release(&rsv));
+    UtAssert_ZERO(rsv.block_count);
+    UtAssert_ZERO(rsv.target_count);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 1);
+
+    /* releasing a reserve that was never set does nothing */
+    bplib_mpool_reserve_init(NULL, &rsv);
+    UtAssert_VOIDCALL(bplib_mpool_reserve_release(&rsv));
+}
+
+void test_bplib_mpool_thread_cache(void)
+{
+    /* Test function for:
+     * void bplib_mpool_thread_cache_attach(bplib_mpool_t *pool)
+     * void bplib_mpool_thread_cache_detach(void)
+     * void bplib_mpool_thread_cache_get_stats(bplib_mpool_thread_cache_stats_t *stats)
+     */
+
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_thread_cache_stats_t   stats;
+    bplib_mpool_lock_t                *lock;
+
+    memset(&buf, 0, sizeof(buf));
+
+    /* Detach when not attached does nothing */
+    UtAssert_VOIDCALL(bplib_mpool_thread_cache_detach());
+
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    admin                 = bplib_mpool_get_admin(&buf.pool);
+    admin->num_bufs_total = 3;
+
+    UtAssert_VOIDCALL(bplib_mpool_thread_cache_attach(&buf.pool));
+    /* attaching again to the same pool is a no-op */
+    UtAssert_VOIDCALL(bplib_mpool_thread_cache_attach(&buf.pool));
+
+    /* First allocation has to refill the cache from the free list */
+    UtAssert_ADDRESS_EQ(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL), &buf.blk[0]);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&admin->free_blocks));
+    UtAssert_UINT32_EQ(admin->max_alloc_watermark, 3);
+    bplib_mpool_thread_cache_get_stats(&stats);
+    UtAssert_UINT32_EQ(stats.miss_count, 1);
+    UtAssert_UINT32_EQ(stats.refill_count, 1);
+    UtAssert_ZERO(stats.hit_count);
+
+    /* Nothing left in the pool or the cache */
+    UtAssert_NULL(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL));
+
+    /* Freeing the block puts it in the cache, not the pool free list */
+    lock = bplib_mpool_lock_pool(&buf.pool);
+    UtAssert_VOIDCALL(bplib_mpool_free_block_internal(&buf.pool, &buf.blk[0].header.base_link));
+    bplib_mpool_lock_release(lock);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&admin->free_blocks));
+
+    /* So the next allocation is a hit */
+    UtAssert_ADDRESS_EQ(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL), &buf.blk[0]);
+    bplib_mpool_thread_cache_get_stats(&stats);
+    UtAssert_UINT32_EQ(stats.hit_count, 1);
+
+    /* Detach returns any cached blocks to the pool */
+    lock = bplib_mpool_lock_pool(&buf.pool);
+    UtAssert_VOIDCALL(bplib_mpool_free_block_internal(&buf.pool, &buf.blk[0].header.base_link));
+    bplib_mpool_lock_release(lock);
+    UtAssert_VOIDCALL(bplib_mpool_thread_cache_detach());
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 1);
+    bplib_mpool_thread_cache_get_stats(&stats);
+    UtAssert_UINT32_EQ(stats.drain_count, 1);
+
+    /* Without a cache, freed blocks go straight to the pool */
+    UtAssert_ADDRESS_EQ(bplib_mpool_generic_data_alloc(&buf.pool, 0, NULL), &buf.blk[0]);
+    lock = bplib_mpool_lock_pool(&buf.pool);
+    UtAssert_VOIDCALL(bplib_mpool_free_block_internal(&buf.pool, &buf.blk[0].header.base_link));
+    bplib_mpool_lock_release(lock);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 1);
+}
+
 void test_bplib_mpool_recycle_all_blocks_in_list(void)
 {
     /* Test function for:
@@ -608,6 +911,75 @@ void test_bplib_mpool_recycle_block(void)
     UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&admin->active_list), &buf.blk[0].header.base_link);
 }
 
+void test_bplib_mpool_release_defer(void)
+{
+    /* Test function for:
+     * void bplib_mpool_release_defer_begin(bplib_mpool_t *pool)
+     * void bplib_mpool_release_defer_end(void)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    UT_bplib_mpool_buf_t               other;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_thread_cache_stats_t   before;
+    bplib_mpool_thread_cache_stats_t   stats;
+    uint32_t                           i;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&other, 0, sizeof(other));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&other.pool, &other.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    admin = bplib_mpool_get_admin(&buf.pool);
+
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&other.pool, &other.blk[0], bplib_mpool_blocktype_primary, 0);
+    bplib_mpool_thread_cache_get_stats(&before);
+
+    /* ending without a begin does nothing */
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_end());
+
+    /* the blocks wait until the outermost end, those of another pool do not */
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_begin(&buf.pool));
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_begin(&other.pool));
+    UtAssert_VOIDCALL(bplib_mpool_recycle_block(&buf.blk[0].header.base_link));
+    UtAssert_VOIDCALL(bplib_mpool_recycle_block(&buf.blk[1].header.base_link));
+    UtAssert_VOIDCALL(bplib_mpool_recycle_block(&other.blk[0].header.base_link));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->recycle_blocks.block_list));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&bplib_mpool_get_admin(&other.pool)->recycle_blocks.block_list),
+                        &other.blk[0].header.base_link);
+
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_end());
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->recycle_blocks.block_list));
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_end());
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&admin->recycle_blocks.block_list), &buf.blk[0].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_prev_block(&admin->recycle_blocks.block_list), &buf.blk[1].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 2);
+
+    bplib_mpool_thread_cache_get_stats(&stats);
+    UtAssert_UINT32_EQ(stats.defer_count - before.defer_count, 2);
+    UtAssert_UINT32_EQ(stats.defer_flush_count - before.defer_flush_count, 1);
+
+    /* after it ends, blocks are recycled one at a time again */
+    UtAssert_VOIDCALL(bplib_mpool_recycle_block(&buf.blk[0].header.base_link));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_prev_block(&admin->recycle_blocks.block_list), &buf.blk[0].header.base_link);
+
+    /* a long list is given to the pool before the end */
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_begin(&buf.pool));
+    for (i = 0; i < BPLIB_MPOOL_RELEASE_DEFER_LIMIT; ++i)
+    {
+        bplib_mpool_recycle_block(&buf.blk[i & 1].header.base_link);
+    }
+    bplib_mpool_thread_cache_get_stats(&stats);
+    UtAssert_UINT32_EQ(stats.defer_flush_count - before.defer_flush_count, 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_prev_block(&admin->recycle_blocks.block_list), &buf.blk[1].header.base_link);
+
+    /* and then there is nothing left for the end to do */
+    UtAssert_VOIDCALL(bplib_mpool_release_defer_end());
+    bplib_mpool_thread_cache_get_stats(&stats);
+    UtAssert_UINT32_EQ(stats.defer_flush_count - before.defer_flush_count, 2);
+}
+
 void test_bplib_mpool_list_iter_goto_first(void)
 {
     /* Test function for:
@@ -777,6 +1149,55 @@ void test_bplib_mpool_register_blocktype(void)
         BP_DUPLICATE);
 }
 
+void test_bplib_mpool_registry_index(void)
+{
+    /* Test function for:
+     * The dense registry index, used by bplib_mpool_register_blocktype() and bplib_mpool_collect_blocks()
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_api_content_t         *index_table[BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES];
+    bplib_mpool_block_admin_content_t *admin;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(index_table, 0, sizeof(index_table));
+
+    /* registering a blocktype adds it to the index */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturnForSignature, &buf.blk[1].u);
+    admin                 = bplib_mpool_get_admin(&buf.pool);
+    admin->registry_index = index_table;
+    UtAssert_INT32_EQ(bplib_mpool_register_blocktype(&buf.pool, UT_TESTBLOCKTYPE_SIG, NULL, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(admin->registry_index_count, 1);
+    UtAssert_ADDRESS_EQ(index_table[0], &buf.blk[0].u.api);
+    UtAssert_UINT32_EQ(buf.blk[0].u.api.registry_index, 0);
+
+    /* once the index is full, the blocktype is still registered, just not indexed */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturnForSignature, &buf.blk[1].u);
+    admin->registry_index       = index_table;
+    admin->registry_index_count = BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES;
+    UtAssert_INT32_EQ(bplib_mpool_register_blocktype(&buf.pool, UT_TESTBLOCKTYPE_SIG, NULL, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(admin->registry_index_count, BPLIB_MPOOL_MAX_INDEXED_BLOCKTYPES);
+    UtAssert_UINT32_EQ(buf.blk[0].u.api.registry_index, BPLIB_MPOOL_REGISTRY_INDEX_NONE);
+
+    /* collecting an indexed block finds the destructor without searching the registry */
+    UT_ResetState(0);
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_api, 0);
+    buf.blk[0].u.api.api.destruct = test_bplib_mpool_callback_stub;
+    admin->registry_index         = index_table;
+    admin->registry_index_count   = 2;
+    index_table[1]                = &buf.blk[0].u.api;
+
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, UT_TESTBLOCKTYPE_SIG);
+    buf.blk[1].header.base_link.registry_index = 1;
+    bplib_mpool_subq_push_single(&admin->recycle_blocks, &buf.blk[1].header.base_link);
+
+    UtAssert_UINT32_EQ(bplib_mpool_collect_blocks(&buf.pool, 1), 1);
+    UtAssert_STUB_COUNT(test_bplib_mpool_callback_stub, 1);
+    UtAssert_STUB_COUNT(bplib_rbt_search_generic, 0);
+}
+
 void test_bplib_mpool_collect_blocks(void)
 {
     /* Test function for:
@@ -815,6 +1236,46 @@ void test_bplib_mpool_collect_blocks(void)
     UtAssert_UINT32_EQ(bplib_mpool_collect_blocks(&buf.pool, 10), 3);
 }
 
+void test_bplib_mpool_collect_blocks_timed(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_collect_blocks_timed(bplib_mpool_t *pool, uint32_t limit, uint64_t until_dtntime)
+     * size_t bplib_mpool_query_collect_backlog(bplib_mpool_t *pool)
+     */
+    struct
+    {
+        bplib_mpool_t               pool;
+        bplib_mpool_block_content_t blk[40];
+    } buf;
+    bplib_mpool_block_admin_content_t *admin;
+    uint64_t                           now;
+    uint32_t                           i;
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturn, NULL);
+    admin = bplib_mpool_get_admin(&buf.pool);
+    for (i = 0; i < 40; ++i)
+    {
+        test_setup_mpblock(&buf.pool, &buf.blk[i], bplib_mpool_blocktype_generic, 0);
+        bplib_mpool_subq_push_single(&admin->recycle_blocks, &buf.blk[i].header.base_link);
+    }
+
+    UtAssert_UINT32_EQ(bplib_mpool_query_collect_backlog(&buf.pool), 40);
+
+    /* The time has already passed, but this should still do one batch */
+    now = 1000;
+    UT_SetDeferredRetcode(UT_KEY(bplib_os_get_dtntime_ms), 1, now);
+    UtAssert_UINT32_EQ(bplib_mpool_collect_blocks_timed(&buf.pool, 40, now), 16);
+    UtAssert_UINT32_EQ(bplib_mpool_query_collect_backlog(&buf.pool), 24);
+
+    /* With time remaining, this is bound by the limit */
+    UtAssert_UINT32_EQ(bplib_mpool_collect_blocks_timed(&buf.pool, 20, now), 20);
+    UtAssert_UINT32_EQ(bplib_mpool_collect_blocks_timed(&buf.pool, 20, BP_DTNTIME_INFINITE), 4);
+    UtAssert_UINT32_EQ(bplib_mpool_query_collect_backlog(&buf.pool), 0);
+}
+
 void test_bplib_mpool_maintain(void)
 {
     /* Test function for:
@@ -835,6 +1296,109 @@ void test_bplib_mpool_maintain(void)
     bplib_mpool_subq_push_single(&admin->recycle_blocks, &buf.blk[0].header.base_link);
 
     UtAssert_VOIDCALL(bplib_mpool_maintain(&buf.pool));
+
+    /* with memory low, everything should be collected */
+    admin->bblock_alloc_threshold = 10;
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_generic, 0);
+    bplib_mpool_subq_push_single(&admin->recycle_blocks, &buf.blk[0].header.base_link);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, 0);
+    bplib_mpool_subq_push_single(&admin->recycle_blocks, &buf.blk[1].header.base_link);
+
+    UtAssert_VOIDCALL(bplib_mpool_maintain(&buf.pool));
+    UtAssert_UINT32_EQ(bplib_mpool_query_collect_backlog(&buf.pool), 0);
+}
+
+void test_bplib_mpool_inspect_step(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_inspect_step(bplib_mpool_t *pool, bplib_mpool_inspector_t *insp, uint32_t limit)
+     * void bplib_mpool_inspect_get(bplib_mpool_t *pool, const bplib_mpool_inspector_t *insp,
+     *                              bplib_mpool_inspection_t *result)
+     */
+    static bplib_mpool_block_content_t pool_mem[64];
+    bplib_mpool_api_content_t          api;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *blk[3];
+    bplib_mpool_inspector_t            insp;
+    bplib_mpool_inspection_t           result;
+    uint32_t                           total;
+
+    memset(pool_mem, 0, sizeof(pool_mem));
+    memset(&api, 0, sizeof(api));
+    memset(&insp, 0, sizeof(insp));
+
+    UtAssert_NOT_NULL(pool = bplib_mpool_create(pool_mem, sizeof(pool_mem)));
+    admin = bplib_mpool_get_admin(pool);
+    total = admin->num_bufs_total + admin->small_class.num_bufs_total + admin->large_class.num_bufs_total;
+
+    /* nothing is reported until a pass is complete */
+    UtAssert_ZERO(bplib_mpool_inspect_step(pool, &insp, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_inspect_step(pool, &insp, 2), 2);
+    UtAssert_VOIDCALL(bplib_mpool_inspect_get(pool, &insp, &result));
+    UtAssert_ZERO(result.passes);
+    UtAssert_ZERO(result.by_state[bplib_mpool_inspect_state_free]);
+
+    UtAssert_UINT32_EQ(bplib_mpool_inspect_step(pool, &insp, UINT32_MAX), total - 2);
+    UtAssert_VOIDCALL(bplib_mpool_inspect_get(pool, &insp, &result));
+    UtAssert_UINT32_EQ(result.passes, 1);
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_free], total);
+    UtAssert_UINT32_EQ(result.by_type[bplib_mpool_blocktype_undefined], total);
+
+    /* blocks in use are counted by type, state and blocktype, and bundles by age */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturn, &api);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_rbt_get_key_value), 0x1234);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), 100000);
+    UtAssert_NOT_NULL(blk[0] = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                       BPLIB_MPOOL_ALLOC_PRI_HI));
+    UtAssert_NOT_NULL(blk[1] = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                       BPLIB_MPOOL_ALLOC_PRI_HI));
+    UtAssert_NOT_NULL(blk[2] = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_primary, 0, NULL,
+                                                       BPLIB_MPOOL_ALLOC_PRI_HI));
+    blk[0]->header.refcount                                      = 1;
+    blk[1]->header.refcount                                      = 2;
+    blk[2]->u.primary.pblock.data.logical.creationTimeStamp.time = 95000;
+
+    UtAssert_UINT32_EQ(bplib_mpool_inspect_step(pool, &insp, UINT32_MAX), total);
+    UtAssert_VOIDCALL(bplib_mpool_inspect_get(pool, &insp, &result));
+    UtAssert_UINT32_EQ(result.passes, 2);
+    UtAssert_UINT32_EQ(result.by_type[bplib_mpool_blocktype_generic], 2);
+    UtAssert_UINT32_EQ(result.by_type[bplib_mpool_blocktype_primary], 1);
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_free], total - 3);
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_unreferenced], 1);
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_single], 1);
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_shared], 1);
+    UtAssert_UINT32_EQ(result.blocktype_count[0], 2);
+    UtAssert_UINT32_EQ(result.blocktype_magic[0], 0x1234);
+    UtAssert_UINT32_EQ(result.bundle_age[3], 1); /* 5 seconds is in the bin from 4 to 8 */
+
+    /* age bins beyond the last one all go in the last one, and a bundle with no creation time is left out */
+    blk[2]->u.primary.pblock.data.logical.creationTimeStamp.time = 1;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_dtntime_coarse_ms), INT32_MAX);
+    UtAssert_UINT32_EQ(bplib_mpool_inspect_step(pool, &insp, UINT32_MAX), total);
+    UtAssert_VOIDCALL(bplib_mpool_inspect_get(pool, &insp, &result));
+    UtAssert_UINT32_EQ(result.bundle_age[BPLIB_MPOOL_INSPECT_AGE_BINS - 1], 1);
+    blk[2]->u.primary.pblock.data.logical.creationTimeStamp.time = 0;
+    blk[1]->header.base_link.type                                = bplib_mpool_blocktype_max;
+    UtAssert_UINT32_EQ(bplib_mpool_inspect_step(pool, &insp, UINT32_MAX), total);
+    UtAssert_VOIDCALL(bplib_mpool_inspect_get(pool, &insp, &result));
+    UtAssert_UINT32_EQ(result.passes, 4);
+    UtAssert_UINT32_EQ(result.by_type[bplib_mpool_blocktype_generic], 1);
+    UtAssert_UINT32_EQ(result.bundle_age[BPLIB_MPOOL_INSPECT_AGE_BINS - 1], 0);
+    UtAssert_VOIDCALL(bplib_mpool_debug_print_inspection(&result));
+
+    /* the blocks of a lazy pool that were never used are free without being read */
+    memset(pool_mem, 0, sizeof(pool_mem));
+    memset(&insp, 0, sizeof(insp));
+    UtAssert_NOT_NULL(pool = bplib_mpool_create_ext(pool_mem, sizeof(pool_mem), BPLIB_MPOOL_CREATE_LAZY_INIT));
+    UtAssert_NOT_NULL(blk[0] = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                       BPLIB_MPOOL_ALLOC_PRI_HI));
+    admin = bplib_mpool_get_admin(pool);
+    total = admin->num_bufs_total + admin->small_class.num_bufs_total + admin->large_class.num_bufs_total;
+    UtAssert_UINT32_EQ(bplib_mpool_inspect_step(pool, &insp, UINT32_MAX), total);
+    UtAssert_VOIDCALL(bplib_mpool_inspect_get(pool, &insp, &result));
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_free], total - 1);
+    UtAssert_UINT32_EQ(result.by_state[bplib_mpool_inspect_state_unreferenced], 1);
 }
 
 void test_bplib_mpool_query_mem_current_use(void)
@@ -866,6 +1430,115 @@ void test_bplib_mpool_query_mem_max_use(void)
     UtAssert_UINT32_EQ(bplib_mpool_query_mem_max_use(&pool), 0);
 }
 
+void test_bplib_mpool_query_stat(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_query_stat(bplib_mpool_t *pool, bplib_mpool_stat_t stat, uint32_t index)
+     */
+    static bplib_mpool_block_content_t pool_mem[64];
+    bplib_mpool_api_content_t          api;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_block_content_t       *blk[2];
+    bplib_mpool_block_t                list;
+    bplib_mpool_lock_t                *lock;
+    bplib_mpool_stats_t               *stats;
+    size_t                             free_depth;
+    size_t                             lock_count;
+
+    memset(pool_mem, 0, sizeof(pool_mem));
+    memset(&api, 0, sizeof(api));
+    bplib_mpool_init_list_head(NULL, &list);
+
+    /* a pool too small for the stats has none */
+    UtAssert_NOT_NULL(pool = bplib_mpool_create(pool_mem, 3 * sizeof(bplib_mpool_block_content_t)));
+    UtAssert_NULL(bplib_mpool_get_admin(pool)->stats);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_refused, 0));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth_min, 0));
+
+    UtAssert_NOT_NULL(pool = bplib_mpool_create(pool_mem, sizeof(pool_mem)));
+    UtAssert_NOT_NULL(bplib_mpool_get_admin(pool)->stats);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_generic));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, 0));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth_max, 0));
+
+    /* allocations are counted by blocktype and priority band */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturn, &api);
+    UtAssert_NOT_NULL(blk[0] = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                       BPLIB_MPOOL_ALLOC_PRI_HI));
+    UtAssert_NOT_NULL(blk[1] = bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                       BPLIB_MPOOL_ALLOC_PRI_LO));
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_generic), 2);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_primary));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_count, bplib_mpool_blocktype_max));
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_priority, 0), 1);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_priority, 1));
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_priority, 3), 1);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_priority, BPLIB_MPOOL_STAT_PRIORITY_BANDS));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_max, 0));
+
+    /* job times are only counted when jobs are run */
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_job_wait_time, 0));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_job_run_time, 0));
+    stats = bplib_mpool_get_admin(pool)->stats;
+    stats->job_wait_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 1)] = 3;
+    stats->job_run_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 3)]  = 2;
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_job_wait_time,
+                                              BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 1)),
+                       3);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_job_run_time,
+                                              BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cache_fsm, 3)),
+                       2);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_job_wait_time,
+                                         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_max, 0)));
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_job_run_time,
+                                         BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_max, 0)));
+
+    /* an allocation refused at the threshold */
+    bplib_mpool_get_admin(pool)->bblock_alloc_threshold = UINT32_MAX;
+    UtAssert_NULL(bplib_mpool_alloc_block(pool, bplib_mpool_blocktype_generic, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_LO));
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_alloc_refused, 0), 1);
+    bplib_mpool_get_admin(pool)->bblock_alloc_threshold = 0;
+
+    /* frees are counted when the block is collected */
+    bplib_mpool_insert_before(&list, &blk[0]->header.base_link);
+    bplib_mpool_recycle_all_blocks_in_list(pool, &list);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_count, bplib_mpool_blocktype_generic));
+    UtAssert_UINT32_EQ(bplib_mpool_collect_blocks(pool, 10), 1);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_count, bplib_mpool_blocktype_generic), 1);
+
+    /* free list depth is sampled on each maintenance cycle */
+    UtAssert_VOIDCALL(bplib_mpool_maintain(pool));
+    free_depth = bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, 0);
+    UtAssert_NONZERO(free_depth);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, 1));
+    bplib_mpool_insert_before(&list, &blk[1]->header.base_link);
+    bplib_mpool_recycle_all_blocks_in_list(pool, &list);
+    UtAssert_VOIDCALL(bplib_mpool_maintain(pool));
+    UtAssert_VOIDCALL(bplib_mpool_maintain(pool));
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, 0), free_depth + 1);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, 2), free_depth);
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth, BPLIB_MPOOL_STAT_DEPTH_SAMPLES));
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth_min, 0), free_depth);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_free_depth_max, 0), free_depth + 1);
+
+    /* lock waits are binned by the time taken */
+    UtAssert_ZERO(bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, BPLIB_MPOOL_STAT_LOCK_WAIT_BINS));
+    lock_count = bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, 0);
+    UtAssert_NOT_NULL(lock = bplib_mpool_lock_pool(pool));
+    bplib_mpool_lock_release(lock);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, 0), lock_count + 1);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_trylock), BP_TIMEOUT);
+    lock_count = bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, 1);
+    bplib_mpool_lock_acquire(lock);
+    bplib_mpool_lock_release(lock);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, 1), lock_count + 1);
+    lock_count = bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, 4);
+    UT_SetDeferredRetcode(UT_KEY(bplib_os_get_monotonic_us), 2, 5000);
+    bplib_mpool_lock_acquire(lock);
+    bplib_mpool_lock_release(lock);
+    UtAssert_UINT32_EQ(bplib_mpool_query_stat(pool, bplib_mpool_stat_lock_wait_count, 4), lock_count + 1);
+}
+
 void test_bplib_mpool_create(void)
 {
     /* Test function for:
@@ -880,6 +1553,262 @@ void test_bplib_mpool_create(void)
     UtAssert_ADDRESS_EQ(bplib_mpool_create(&buf, sizeof(buf)), &buf);
 }
 
+void test_bplib_mpool_create_ext(void)
+{
+    /* Test function for:
+     * bplib_mpool_t *bplib_mpool_create_ext(void *pool_mem, size_t pool_size, uint32_t flags)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_api_content_t          api;
+    bplib_mpool_block_admin_content_t *admin;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&api, 0, sizeof(api));
+
+    UtAssert_NULL(bplib_mpool_create_ext(NULL, sizeof(buf), BPLIB_MPOOL_CREATE_LAZY_INIT));
+    UtAssert_ADDRESS_EQ(bplib_mpool_create_ext(&buf, sizeof(buf), BPLIB_MPOOL_CREATE_LAZY_INIT), &buf);
+
+    /* nothing should be on the free list yet, but all blocks are still available.
+     * The memory of the last two blocks is used for the registry index and stats */
+    admin = bplib_mpool_get_admin(&buf.pool);
+    UtAssert_UINT32_EQ(admin->num_bufs_total, 1);
+    UtAssert_UINT32_EQ(admin->lazy_block_count, 1);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), 0);
+    UtAssert_UINT32_EQ(bplib_mpool_query_mem_current_use(&buf.pool), sizeof(bplib_mpool_block_content_t));
+    UtAssert_NOT_NULL(admin->stats);
+
+    /* blocks are set up in order, on first use */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturn, &api);
+    UtAssert_ADDRESS_EQ(bplib_mpool_alloc_block_internal(&buf.pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                         BPLIB_MPOOL_ALLOC_PRI_HI),
+                        &buf.blk[0]);
+    UtAssert_UINT32_EQ(admin->lazy_block_count, 0);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_parent_pool_from_link(&buf.blk[0].header.base_link), &buf.pool);
+}
+
+void test_bplib_mpool_size_classes(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_content_t *bplib_mpool_alloc_sized_block_internal(bplib_mpool_t *pool,
+     *      bplib_mpool_blocktype_t blocktype, uint32_t content_type_signature, void *init_arg,
+     *      uint8_t priority, size_t size_hint)
+     * size_t bplib_mpool_get_block_buffer_size(const bplib_mpool_block_content_t *block)
+     */
+    static bplib_mpool_block_content_t pool_mem[2048];
+    bplib_mpool_api_content_t          api;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *blk;
+
+    memset(&api, 0, sizeof(api));
+    UtAssert_NOT_NULL(pool = bplib_mpool_create(pool_mem, sizeof(pool_mem)));
+    admin = bplib_mpool_get_admin(pool);
+    UtAssert_NONZERO(admin->small_class.num_bufs_total);
+    UtAssert_NONZERO(admin->large_class.num_bufs_total);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturn, &api);
+
+    /* a ref fits into a small block */
+    UtAssert_NOT_NULL(blk = bplib_mpool_alloc_sized_block_internal(pool, bplib_mpool_blocktype_ref, 0, NULL,
+                                                                   BPLIB_MPOOL_ALLOC_PRI_MHI, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_get_block_buffer_size(blk), BP_MPOOL_SMALL_USER_BLOCK_SIZE);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_parent_pool_from_link(&blk->header.base_link), pool);
+    UtAssert_ADDRESS_EQ(
+        bplib_mpool_block_from_external_id(pool, bplib_mpool_get_external_id(&blk->header.base_link)),
+        &blk->header.base_link);
+    bplib_mpool_free_block_internal(pool, &blk->header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->small_class.free_blocks), admin->small_class.num_bufs_total);
+
+    /* generic data without a size hint uses a standard block */
+    UtAssert_NOT_NULL(blk = bplib_mpool_alloc_sized_block_internal(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                                   BPLIB_MPOOL_ALLOC_PRI_MHI, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_get_block_buffer_size(blk), sizeof(bplib_mpool_block_buffer_t));
+
+    /* generic data with a large size hint uses a large block */
+    UtAssert_NOT_NULL(blk = bplib_mpool_alloc_sized_block_internal(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                                   BPLIB_MPOOL_ALLOC_PRI_MHI,
+                                                                   2 * sizeof(bplib_mpool_block_buffer_t)));
+    UtAssert_UINT32_EQ(bplib_mpool_get_block_buffer_size(blk), BP_MPOOL_LARGE_USER_BLOCK_SIZE);
+    UtAssert_UINT32_EQ(bplib_mpool_get_generic_data_capacity(&blk->header.base_link),
+                       BP_MPOOL_LARGE_USER_BLOCK_SIZE -
+                           bplib_mpool_get_user_data_offset_by_blocktype(bplib_mpool_blocktype_generic));
+    bplib_mpool_free_block_internal(pool, &blk->header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->large_class.free_blocks), admin->large_class.num_bufs_total);
+}
+
+void test_bplib_mpool_create_partitioned(void)
+{
+    /* Test function for:
+     * bplib_mpool_t *bplib_mpool_create_partitioned(void *pool_mem, size_t pool_size, uint32_t num_partitions,
+     *      uint32_t flags)
+     * uint32_t bplib_mpool_get_num_partitions(bplib_mpool_t *pool)
+     * bplib_mpool_t *bplib_mpool_get_partition(bplib_mpool_t *pool, uint32_t partition_index)
+     * bplib_mpool_t *bplib_mpool_get_local_partition(bplib_mpool_t *pool)
+     */
+    static bplib_mpool_block_content_t pool_mem[512];
+    bplib_mpool_api_content_t          api;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_t                     *part1;
+    bplib_mpool_block_content_t       *blk;
+    bplib_mpool_block_t                list;
+    size_t                             mem_free;
+
+    memset(&api, 0, sizeof(api));
+    bplib_mpool_init_list_head(NULL, &list);
+
+    UtAssert_NULL(bplib_mpool_create_partitioned(NULL, sizeof(pool_mem), 2, 0));
+    UtAssert_NULL(bplib_mpool_create_partitioned(pool_mem, sizeof(pool_mem), BPLIB_MPOOL_MAX_PARTITIONS + 1, 0));
+    UtAssert_NULL(bplib_mpool_create_partitioned(pool_mem, sizeof(bplib_mpool_block_content_t), 2, 0));
+
+    /* a single partition is just a normal pool */
+    UtAssert_ADDRESS_EQ(pool = bplib_mpool_create_partitioned(pool_mem, sizeof(pool_mem), 1, 0), pool_mem);
+    UtAssert_UINT32_EQ(bplib_mpool_get_num_partitions(pool), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_partition(pool, 0), pool);
+    UtAssert_NULL(bplib_mpool_get_partition(pool, 1));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_local_partition(pool), pool);
+
+    UtAssert_NOT_NULL(pool = bplib_mpool_create_partitioned(pool_mem, sizeof(pool_mem), 2, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_get_num_partitions(pool), 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_partition(pool, 0), pool);
+    UtAssert_NOT_NULL(part1 = bplib_mpool_get_partition(pool, 1));
+    UtAssert_BOOL_FALSE(part1 == pool);
+    UtAssert_NULL(bplib_mpool_get_partition(pool, 2));
+    UtAssert_UINT32_EQ(bplib_mpool_get_num_partitions(part1), 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_partition(part1, 0), pool);
+
+    /* registration applies to all partitions */
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturnForSignature, &api);
+    UtAssert_INT32_EQ(bplib_mpool_register_blocktype(pool, UT_TESTBLOCKTYPE_SIG, NULL, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(bplib_mpool_get_admin(pool)->registry_index_count, 3);
+    UtAssert_UINT32_EQ(bplib_mpool_get_admin(part1)->registry_index_count, 3);
+
+    /* the memory use is for the whole pool */
+    mem_free = bplib_mpool_query_mem_current_use(pool);
+    UtAssert_UINT32_EQ(bplib_mpool_query_mem_current_use(part1), mem_free);
+
+    /* without a thread cache, the local partition is selected by cpu */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_cpu_index), 3);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_local_partition(pool), part1);
+    UtAssert_NOT_NULL(blk = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_generic, 0, NULL,
+                                                          BPLIB_MPOOL_ALLOC_PRI_HI, 0));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_parent_pool_from_link(&blk->header.base_link), part1);
+    UtAssert_UINT32_EQ(bplib_mpool_query_mem_current_use(pool), mem_free - sizeof(bplib_mpool_block_content_t));
+    UtAssert_UINT32_EQ(bplib_mpool_query_mem_max_use(pool), sizeof(bplib_mpool_block_content_t));
+
+    /* a block collected by the wrong partition is passed on to its own partition */
+    bplib_mpool_insert_before(&list, &blk->header.base_link);
+    bplib_mpool_recycle_all_blocks_in_list(pool, &list);
+    UtAssert_UINT32_EQ(bplib_mpool_query_collect_backlog(pool), 1);
+    UtAssert_UINT32_EQ(bplib_mpool_collect_blocks(pool, 10), 1);
+    UtAssert_UINT32_EQ(bplib_mpool_query_collect_backlog(pool), 1);
+    UtAssert_UINT32_EQ(bplib_mpool_query_mem_current_use(pool), mem_free - sizeof(bplib_mpool_block_content_t));
+    UtAssert_VOIDCALL(bplib_mpool_maintain(pool));
+    UtAssert_ZERO(bplib_mpool_query_collect_backlog(pool));
+    UtAssert_UINT32_EQ(bplib_mpool_query_mem_current_use(pool), mem_free);
+
+    /* a thread with a cache attached to a partition is homed there */
+    bplib_mpool_thread_cache_attach(pool);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_local_partition(part1), pool);
+    bplib_mpool_thread_cache_detach();
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_local_partition(pool), part1);
+
+    /* if the local partition cannot supply a block, the others are tried */
+    bplib_mpool_get_admin(part1)->bblock_alloc_threshold = UINT32_MAX;
+    UtAssert_NOT_NULL(blk = bplib_mpool_alloc_local_block(pool, bplib_mpool_blocktype_primary, 0, NULL,
+                                                          BPLIB_MPOOL_ALLOC_PRI_LO, 0));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_parent_pool_from_link(&blk->header.base_link), pool);
+}
+
+static int UT_RecoverBundle(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_mpool_insert_before(arg, blk);
+    return BP_SUCCESS;
+}
+
+void test_bplib_mpool_reattach(void)
+{
+    /* Test function for:
+     * bplib_mpool_t *bplib_mpool_reattach(void *pool_mem, size_t pool_size, bplib_mpool_callback_func_t recover_fn,
+     *      void *recover_arg)
+     */
+    static bplib_mpool_block_content_t pool_mem[256];
+    bplib_mpool_api_content_t          api;
+    bplib_mpool_t                     *pool;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_block_content_t       *pblk;
+    bplib_mpool_block_content_t       *cblk;
+    bplib_mpool_block_content_t       *dblk;
+    bplib_mpool_block_content_t       *gone;
+    bplib_mpool_block_content_t       *broken;
+    bplib_mpool_block_content_t       *bdata;
+    bplib_mpool_block_t                queue;
+    bplib_mpool_block_t                recovered;
+    uint32_t                           free_depth;
+
+    memset(&api, 0, sizeof(api));
+    memset(pool_mem, 0, sizeof(pool_mem));
+    bplib_mpool_init_list_head(NULL, &queue);
+    bplib_mpool_init_list_head(NULL, &recovered);
+
+    UtAssert_NULL(bplib_mpool_reattach(NULL, sizeof(pool_mem), NULL, NULL));
+    UtAssert_NULL(bplib_mpool_reattach(pool_mem, sizeof(pool_mem), NULL, NULL));
+
+    UtAssert_NOT_NULL(pool = bplib_mpool_create(pool_mem, sizeof(pool_mem)));
+    admin      = bplib_mpool_get_admin(pool);
+    free_depth = bplib_mpool_subq_get_depth(&admin->free_blocks);
+    UtAssert_NULL(bplib_mpool_reattach(pool_mem, sizeof(pool_mem) - sizeof(pool_mem[0]), NULL, NULL));
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_PointerReturn, &api);
+
+    /* a bundle that was queued somewhere, with a canonical block and its data */
+    pblk = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_primary, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_HI);
+    cblk = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_canonical, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_HI);
+    dblk = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE,
+                                            NULL, BPLIB_MPOOL_ALLOC_PRI_HI);
+    cblk->u.canonical.cblock.bundle_ref = &pblk->u.primary.pblock;
+    bplib_mpool_insert_before(&cblk->u.canonical.cblock.chunk_list, &dblk->header.base_link);
+    bplib_mpool_insert_before(&pblk->u.primary.pblock.cblock_list, &cblk->header.base_link);
+    bplib_mpool_insert_before(&queue, &pblk->header.base_link);
+    pblk->header.refcount                            = 2;
+    pblk->u.primary.pblock.data.delivery.trace_ref   = (bplib_mpool_ref_t)&api;
+    pblk->u.primary.pblock.data.delivery.quota_charge = 100;
+
+    /* a bundle that was already recycled */
+    gone = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_primary, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_HI);
+    bplib_mpool_recycle_block_internal(pool, &gone->header.base_link);
+
+    /* a bundle with its list of data cut short */
+    broken = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_primary, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_HI);
+    bdata  = bplib_mpool_alloc_block_internal(pool, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE,
+                                              NULL, BPLIB_MPOOL_ALLOC_PRI_HI);
+    bplib_mpool_insert_before(&broken->u.primary.pblock.chunk_list, &bdata->header.base_link);
+    bdata->header.base_link.next = &bdata->header.base_link;
+
+    UtAssert_ADDRESS_EQ(bplib_mpool_reattach(pool_mem, sizeof(pool_mem), UT_RecoverBundle, &recovered), pool);
+
+    /* only the intact bundle comes back, and everything else is free again */
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&recovered), &pblk->header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&pblk->header.base_link), &recovered);
+    UtAssert_UINT32_EQ(pblk->header.refcount, 0);
+    UtAssert_NULL(pblk->u.primary.pblock.data.delivery.trace_ref);
+    UtAssert_ZERO(pblk->u.primary.pblock.data.delivery.quota_charge);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&pblk->u.primary.pblock.cblock_list), &cblk->header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&cblk->u.canonical.cblock.chunk_list), &dblk->header.base_link);
+    UtAssert_UINT32_EQ(cblk->header.refcount, 0);
+    UtAssert_UINT32_EQ(dblk->header.refcount, 0);
+    UtAssert_UINT32_EQ(gone->header.base_link.type, bplib_mpool_blocktype_undefined);
+    UtAssert_UINT32_EQ(broken->header.base_link.type, bplib_mpool_blocktype_undefined);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->free_blocks), free_depth - 3);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 0);
+
+    /* without a callback the bundle is recycled */
+    bplib_mpool_extract_node(&pblk->header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_reattach(pool_mem, sizeof(pool_mem), NULL, NULL), pool);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 1);
+
+    /* a damaged list of recycled blocks means nothing can be trusted */
+    admin->recycle_blocks.block_list.next = (bplib_mpool_block_t *)&api;
+    UtAssert_NULL(bplib_mpool_reattach(pool_mem, sizeof(pool_mem), NULL, NULL));
+}
+
 void test_bplib_mpool_debug_scan(void)
 {
     /* Test function for:
@@ -912,7 +1841,14 @@ void TestBplibMpoolBase_Register(void)
     UtTest_Add(test_bplib_mpool_lock_init, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_lock_init");
     UtTest_Add(test_bplib_mpool_lock_prepare, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_lock_prepare");
     UtTest_Add(test_bplib_mpool_lock_resource, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_lock_resource");
+    UtTest_Add(test_bplib_mpool_lock_pool, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_lock_pool");
     UtTest_Add(test_bplib_mpool_lock_wait, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_lock_wait");
+    UtTest_Add(test_bplib_mpool_wait_channel_prepare, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_wait_channel_prepare");
+    UtTest_Add(test_bplib_mpool_wait_channel_wait, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_wait_channel_wait");
+    UtTest_Add(test_bplib_mpool_wait_channel_wake, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_wait_channel_wake");
     UtTest_Add(test_bplib_mpool_block_from_external_id, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_block_from_external_id");
     UtTest_Add(test_bplib_mpool_get_block_from_link, TestBplibMpool_ResetTestEnvironment, NULL,
@@ -936,6 +1872,8 @@ void TestBplibMpoolBase_Register(void)
     UtTest_Add(test_bplib_mpool_get_user_content_size, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_get_user_content_size");
     UtTest_Add(test_bplib_mpool_read_refcount, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_read_refcount");
+    UtTest_Add(test_bplib_mpool_get_block_footprint, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_get_block_footprint");
     UtTest_Add(test_bplib_mpool_get_parent_pool_from_link, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_get_parent_pool_from_link");
     UtTest_Add(test_bplib_mpool_generic_data_cast, TestBplibMpool_ResetTestEnvironment, NULL,
@@ -946,8 +1884,13 @@ void TestBplibMpoolBase_Register(void)
                "bplib_mpool_alloc_block_internal");
     UtTest_Add(test_bplib_mpool_generic_data_alloc, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_generic_data_alloc");
+    UtTest_Add(test_bplib_mpool_generic_data_alloc_n, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_generic_data_alloc_n");
+    UtTest_Add(test_bplib_mpool_thread_cache, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_thread_cache");
+    UtTest_Add(test_bplib_mpool_reserve, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_reserve");
     UtTest_Add(test_bplib_mpool_recycle_all_blocks_in_list, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_recycle_all_blocks_in_list");
+    UtTest_Add(test_bplib_mpool_release_defer, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_release_defer");
     UtTest_Add(test_bplib_mpool_recycle_block, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_recycle_block");
     UtTest_Add(test_bplib_mpool_list_iter_goto_first, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_list_iter_goto_first");
@@ -962,13 +1905,24 @@ void TestBplibMpoolBase_Register(void)
     UtTest_Add(test_bplib_mpool_search_list, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_search_list");
     UtTest_Add(test_bplib_mpool_register_blocktype, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_register_blocktype");
+    UtTest_Add(test_bplib_mpool_registry_index, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_registry_index");
     UtTest_Add(test_bplib_mpool_collect_blocks, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_collect_blocks");
+    UtTest_Add(test_bplib_mpool_collect_blocks_timed, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_collect_blocks_timed");
     UtTest_Add(test_bplib_mpool_maintain, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_maintain");
+    UtTest_Add(test_bplib_mpool_inspect_step, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_inspect_step");
     UtTest_Add(test_bplib_mpool_query_mem_current_use, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_query_mem_current_use");
     UtTest_Add(test_bplib_mpool_query_mem_max_use, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_query_mem_max_use");
+    UtTest_Add(test_bplib_mpool_query_stat, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_query_stat");
     UtTest_Add(test_bplib_mpool_create, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_create");
+    UtTest_Add(test_bplib_mpool_create_ext, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_create_ext");
+    UtTest_Add(test_bplib_mpool_size_classes, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_size_classes");
+    UtTest_Add(test_bplib_mpool_create_partitioned, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_create_partitioned");
+    UtTest_Add(test_bplib_mpool_reattach, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_reattach");
     UtTest_Add(test_bplib_mpool_debug_scan, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_debug_scan");
 }
@@ -26,6 +26,71 @@
 #include "test_bplib_mpool.h"
 #include "v7_mpool_bblocks.h"
 
+/* the slice blocktype is not registered yet, but everything else is found */
+static void UT_AltHandler_SliceNotRegistered(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bp_val_t RefSig = UT_Hook_GetArgValueByName(Context, "search_key_value", bp_val_t);
+
+    if (RefSig == MPOOL_CACHE_CBOR_SLICE_SIGNATURE)
+    {
+        UserObj = NULL;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, UserObj);
+}
+
+/* same as above, for the external buffer blocktype */
+static void UT_AltHandler_ExternNotRegistered(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bp_val_t RefSig = UT_Hook_GetArgValueByName(Context, "search_key_value", bp_val_t);
+
+    if (RefSig == MPOOL_CACHE_CBOR_EXTERN_SIGNATURE)
+    {
+        UserObj = NULL;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, UserObj);
+}
+
+/* stands in for the CRC, so the result shows how many bytes in how many entries went through it */
+static void UT_AltHandler_CrcUpdateList(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bp_crcval_t          crc       = UT_Hook_GetArgValueByName(Context, "crc", bp_crcval_t);
+    const bplib_iovec_t *iov       = UT_Hook_GetArgValueByName(Context, "iov", const bplib_iovec_t *);
+    size_t               iov_count = UT_Hook_GetArgValueByName(Context, "iov_count", size_t);
+
+    while (iov_count > 0)
+    {
+        crc += iov->len;
+        ++iov;
+        --iov_count;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, crc);
+}
+
+static void test_bplib_mpool_bblock_release_stub(void *release_arg, const void *payload, size_t size)
+{
+    UT_DEFAULT_IMPL(test_bplib_mpool_bblock_release_stub);
+}
+
+/* makes one more block available to allocate, after those from test_setup_allocation() */
+static void test_add_free_block(bplib_mpool_t *pool, bplib_mpool_block_content_t *b)
+{
+    test_setup_mpblock(pool, b, bplib_mpool_blocktype_undefined, 0);
+    bplib_mpool_subq_push_single(&bplib_mpool_get_admin(pool)->free_blocks, &b->header.base_link);
+}
+
+/* a slice of the first length bytes of a data block, as in a received bundle */
+static void test_setup_slice(bplib_mpool_t *pool, bplib_mpool_block_content_t *sb, bplib_mpool_block_content_t *db,
+                             size_t length)
+{
+    test_setup_mpblock(pool, sb, bplib_mpool_blocktype_ref, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    sb->u.ref.pref_target                    = db;
+    sb->header.base_link.user_content_length = length;
+    ++db->header.refcount;
+}
+
 void test_bplib_mpool_bblock_primary_cast(void)
 {
     /* Test function for:
@@ -82,8 +147,12 @@ void test_bplib_mpool_bblock_cbor_cast(void)
     /* Test function for:
      * void *bplib_mpool_bblock_cbor_cast(bplib_mpool_block_t *cb);
      */
-    bplib_mpool_block_content_t my_block;
-    bplib_mpool_block_t        *cb = &my_block.header.base_link;
+    bplib_mpool_block_content_t      my_block;
+    bplib_mpool_block_content_t       slice_block;
+    bplib_mpool_bblock_cbor_slice_t  *slice;
+    bplib_mpool_bblock_cbor_extern_t *ext;
+    uint8_t                           ext_data[16];
+    bplib_mpool_block_t              *cb = &my_block.header.base_link;
 
     UtAssert_NULL(bplib_mpool_bblock_cbor_cast(NULL));
 
@@ -92,6 +161,26 @@ void test_bplib_mpool_bblock_cbor_cast(void)
 
     test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
     UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(cb), &my_block.u);
+
+    /* a slice refers to the data of its target, at the offset */
+    test_setup_mpblock(NULL, &slice_block, bplib_mpool_blocktype_ref, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    slice_block.u.ref.pref_target = &my_block;
+    slice                         = bplib_mpool_generic_data_cast(&slice_block.header.base_link,
+                                                                  MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    UtAssert_NOT_NULL(slice);
+    slice->offset = 12;
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(&slice_block.header.base_link), &my_block.u.content_bytes[12]);
+
+    /* a slice of something that is not CBOR data is not CBOR data either */
+    test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, ~MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    UtAssert_NULL(bplib_mpool_bblock_cbor_cast(&slice_block.header.base_link));
+
+    /* a slice of an external buffer refers into that buffer, but the buffer itself is not CBOR data */
+    test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    ext           = bplib_mpool_generic_data_cast(cb, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    ext->data_ptr = ext_data;
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(&slice_block.header.base_link), &ext_data[12]);
+    UtAssert_NULL(bplib_mpool_bblock_cbor_cast(cb));
 }
 
 void test_bplib_mpool_bblock_cbor_set_size(void)
@@ -115,7 +204,7 @@ void test_bplib_mpool_bblock_cbor_set_size(void)
     test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
     UtAssert_VOIDCALL(bplib_mpool_bblock_cbor_set_size(&my_block.header.base_link, 123));
 
-    UtAssert_UINT32_EQ(my_block.header.user_content_length, 123);
+    UtAssert_UINT32_EQ(my_block.header.base_link.user_content_length, 123);
 }
 
 void test_bplib_mpool_bblock_primary_alloc(void)
@@ -167,6 +256,261 @@ void test_bplib_mpool_bblock_cbor_alloc(void)
     UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_alloc(&buf.pool), &buf.blk[0]);
 }
 
+void test_bplib_mpool_bblock_cbor_alloc_sized(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc_sized(bplib_mpool_t *pool, size_t size_hint);
+     */
+
+    UT_bplib_mpool_buf_t buf;
+
+    memset(&buf, 0, sizeof(buf));
+
+    UtAssert_NULL(bplib_mpool_bblock_cbor_alloc_sized(&buf.pool, 0));
+    UtAssert_NULL(bplib_mpool_bblock_cbor_alloc_sized(&buf.pool, 2 * sizeof(bplib_mpool_block_buffer_t)));
+
+    /* with no large blocks in the pool, this should fall back to a standard block */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_alloc_sized(&buf.pool, 2 * sizeof(bplib_mpool_block_buffer_t)),
+                        &buf.blk[0]);
+}
+
+void test_bplib_mpool_bblock_cbor_alloc_n(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_bblock_cbor_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, size_t total_size);
+     */
+
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t  list;
+
+    memset(&buf, 0, sizeof(buf));
+    bplib_mpool_init_list_head(NULL, &list);
+
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_alloc_n(&buf.pool, &list, 0));
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_alloc_n(&buf.pool, &list, 1));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&list));
+
+    /* This only has one free block, so the capacity returned will be short of the request */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_alloc_n(&buf.pool, &list, 2 * sizeof(bplib_mpool_block_buffer_t)),
+                       bplib_mpool_get_generic_data_capacity(&buf.blk[0].header.base_link));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &buf.blk[0]);
+}
+
+void test_bplib_mpool_bblock_cbor_slice_init(void)
+{
+    /* Test function for:
+     * int bplib_mpool_bblock_cbor_slice_init(bplib_mpool_t *pool);
+     */
+    UT_bplib_mpool_buf_t buf;
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_SliceNotRegistered, &buf.blk[1].u);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_slice_init(&buf.pool), BP_SUCCESS);
+    UtAssert_UINT32_EQ(buf.blk[0].u.api.user_content_size, sizeof(bplib_mpool_bblock_cbor_slice_t));
+
+    /* registering again is harmless */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_slice_init(&buf.pool), BP_DUPLICATE);
+}
+
+void test_bplib_mpool_bblock_cbor_slice_alloc(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_mpool_bblock_cbor_slice_alloc(bplib_mpool_ref_t buffer_ref, size_t offset,
+     * size_t length);
+     */
+    UT_bplib_mpool_buf_t              buf;
+    bplib_mpool_bblock_cbor_extern_t *ext;
+    uint8_t                           ext_data[16];
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, ~MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    buf.blk[2].header.refcount = 1;
+
+    /* not a CBOR data block */
+    UtAssert_NULL(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 0, 0));
+
+    /* beyond the data in the buffer */
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    buf.blk[2].header.refcount = 1;
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[2].header.base_link, 100);
+    UtAssert_NULL(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 101, 0));
+    UtAssert_NULL(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 50, 51));
+
+    /* nominal, the slice is a ref to the buffer */
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 50, 50), &buf.blk[0]);
+    UtAssert_ADDRESS_EQ(buf.blk[0].u.ref.pref_target, &buf.blk[2]);
+    UtAssert_UINT32_EQ(buf.blk[2].header.refcount, 2);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(&buf.blk[0].header.base_link), 50);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(&buf.blk[0].header.base_link), &buf.blk[2].u.content_bytes[50]);
+
+    /* no memory */
+    UtAssert_NULL(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 0, 10));
+
+    /* an external buffer is checked against its own size */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    buf.blk[2].header.refcount = 1;
+    ext            = bplib_mpool_generic_data_cast(&buf.blk[2].header.base_link, MPOOL_CACHE_CBOR_EXTERN_SIGNATURE);
+    ext->data_ptr  = ext_data;
+    ext->data_size = sizeof(ext_data);
+    UtAssert_NULL(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 4, sizeof(ext_data)));
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_slice_alloc(&buf.blk[2], 4, 8), &buf.blk[0]);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(&buf.blk[0].header.base_link), 8);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(&buf.blk[0].header.base_link), &ext_data[4]);
+}
+
+void test_bplib_mpool_bblock_cbor_share(void)
+{
+    /* Test function for:
+     * int bplib_mpool_bblock_cbor_share(bplib_mpool_block_t *dst_list, bplib_mpool_block_t *src_list);
+     */
+    UT_bplib_mpool_buf_t        buf;
+    bplib_mpool_block_content_t more[4];
+    bplib_mpool_block_t        *src_list;
+    bplib_mpool_block_t        *dst_list;
+    bplib_mpool_block_t        *blk;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(more, 0, sizeof(more));
+
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_setup_mpblock(&buf.pool, &more[0], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_canonical, 0);
+    src_list = &more[0].u.canonical.cblock.chunk_list;
+    dst_list = &buf.blk[2].u.canonical.cblock.chunk_list;
+
+    /* nothing to share */
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_share(dst_list, src_list), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(dst_list));
+
+    /* a slice is shared as another slice of the same data */
+    test_setup_mpblock(&buf.pool, &more[1], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    bplib_mpool_bblock_cbor_set_size(&more[1].header.base_link, 100);
+    test_setup_slice(&buf.pool, &more[2], &more[1], 40);
+    bplib_mpool_insert_before(src_list, &more[2].header.base_link);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_share(dst_list, src_list), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(dst_list), &buf.blk[0]);
+    UtAssert_ADDRESS_EQ(buf.blk[0].u.ref.pref_target, &more[1]);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(&buf.blk[0].header.base_link), 40);
+    UtAssert_UINT32_EQ(more[1].header.refcount, 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(src_list), &more[2]);
+
+    /* plain data is swapped for a slice of itself, which needs a block more */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_add_free_block(&buf.pool, &more[2]);
+    test_setup_mpblock(&buf.pool, &more[0], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &more[1], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    more[1].header.refcount = 0;
+    bplib_mpool_bblock_cbor_set_size(&more[1].header.base_link, 100);
+    bplib_mpool_insert_before(src_list, &more[1].header.base_link);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_share(dst_list, src_list), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&more[1].header.base_link));
+    UtAssert_UINT32_EQ(more[1].header.refcount, 2);
+    blk = bplib_mpool_get_next_block(src_list);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(blk), more[1].u.content_bytes);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(blk), 100);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(blk), src_list);
+    blk = bplib_mpool_get_next_block(dst_list);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(blk), more[1].u.content_bytes);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(blk), 100);
+
+    /* no memory, the plain data stays where it was */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    bplib_mpool_subq_pull_single(&bplib_mpool_get_admin(&buf.pool)->free_blocks);
+    test_setup_mpblock(&buf.pool, &more[0], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &more[1], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    more[1].header.refcount = 0;
+    bplib_mpool_insert_before(src_list, &more[1].header.base_link);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_share(dst_list, src_list), BP_ERROR);
+    UtAssert_ZERO(more[1].header.refcount);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(src_list), &more[1]);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&more[1].header.base_link), src_list);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(dst_list));
+
+    /* not CBOR data at all */
+    test_setup_mpblock(&buf.pool, &more[0], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &more[1], bplib_mpool_blocktype_generic, ~MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    bplib_mpool_insert_before(src_list, &more[1].header.base_link);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_share(dst_list, src_list), BP_ERROR);
+}
+
+void test_bplib_mpool_bblock_cbor_extern_init(void)
+{
+    /* Test function for:
+     * int bplib_mpool_bblock_cbor_extern_init(bplib_mpool_t *pool);
+     */
+    UT_bplib_mpool_buf_t buf;
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_ExternNotRegistered, &buf.blk[1].u);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_extern_init(&buf.pool), BP_SUCCESS);
+    UtAssert_UINT32_EQ(buf.blk[0].u.api.user_content_size, sizeof(bplib_mpool_bblock_cbor_extern_t));
+    UtAssert_NOT_NULL(buf.blk[0].u.api.api.construct);
+    UtAssert_NOT_NULL(buf.blk[0].u.api.api.destruct);
+
+    /* registering again is harmless */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_extern_init(&buf.pool), BP_DUPLICATE);
+}
+
+void test_bplib_mpool_bblock_cbor_extern_alloc(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_mpool_bblock_cbor_extern_alloc(bplib_mpool_t *pool, const void *data_ptr,
+     * size_t data_size, bplib_payload_release_func_t release_func, void *release_arg);
+     */
+    UT_bplib_mpool_buf_t              buf;
+    bplib_mpool_blocktype_api_t       extern_api;
+    bplib_mpool_bblock_cbor_extern_t *ext;
+    uint8_t                           ext_data[16];
+
+    memset(&buf, 0, sizeof(buf));
+
+    /* get the real constructor and destructor, by registering the blocktype */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UT_SetHandlerFunction(UT_KEY(bplib_rbt_search_generic), UT_AltHandler_ExternNotRegistered, &buf.blk[1].u);
+    UtAssert_INT32_EQ(bplib_mpool_bblock_cbor_extern_init(&buf.pool), BP_SUCCESS);
+    extern_api = buf.blk[0].u.api.api;
+
+    /* the block remembers the buffer, without copying it */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    buf.blk[1].u.api.api               = extern_api;
+    buf.blk[1].u.api.user_content_size = sizeof(bplib_mpool_bblock_cbor_extern_t);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_extern_alloc(&buf.pool, ext_data, sizeof(ext_data),
+                                                             test_bplib_mpool_bblock_release_stub, &buf),
+                        &buf.blk[0]);
+    UtAssert_NOT_NULL(ext = bplib_mpool_generic_data_cast(&buf.blk[0].header.base_link,
+                                                          MPOOL_CACHE_CBOR_EXTERN_SIGNATURE));
+    UtAssert_ADDRESS_EQ(ext->data_ptr, ext_data);
+    UtAssert_UINT32_EQ(ext->data_size, sizeof(ext_data));
+    UtAssert_ADDRESS_EQ(ext->release_arg, &buf);
+
+    /* recycling it gives the buffer back, but only once */
+    UtAssert_INT32_EQ(extern_api.destruct(NULL, &buf.blk[0].header.base_link), BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_mpool_bblock_release_stub, 1);
+    UtAssert_INT32_EQ(extern_api.destruct(NULL, &buf.blk[0].header.base_link), BP_SUCCESS);
+    UtAssert_STUB_COUNT(test_bplib_mpool_bblock_release_stub, 1);
+
+    /* not an external buffer block */
+    UtAssert_INT32_EQ(extern_api.construct(&buf, &buf.blk[2].header.base_link), BP_ERROR);
+    UtAssert_INT32_EQ(extern_api.destruct(NULL, &buf.blk[2].header.base_link), BP_ERROR);
+    UtAssert_INT32_EQ(extern_api.construct(NULL, &buf.blk[0].header.base_link), BP_ERROR);
+
+    /* no memory */
+    UtAssert_NULL(bplib_mpool_bblock_cbor_extern_alloc(&buf.pool, ext_data, sizeof(ext_data), NULL, NULL));
+}
+
 void test_bplib_mpool_bblock_cbor_append(void)
 {
     /* Test function for:
@@ -203,6 +547,32 @@ void test_bplib_mpool_bblock_primary_append(void)
     b                           = bplib_mpool_bblock_canonical_get_logical(&buf.blk[2].u.canonical.cblock);
     b->canonical_block.blockNum = 1;
     UtAssert_VOIDCALL(bplib_mpool_bblock_primary_append(&buf.blk[0].u.primary.pblock, &buf.blk[2].header.base_link));
+
+    /* the bundle size follows the blocks as they are appended and encoded */
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_canonical, 0);
+    UtAssert_ZERO(buf.blk[0].u.primary.pblock.bundle_encode_size_cache);
+    bplib_mpool_bblock_primary_set_encode_size(&buf.blk[0].u.primary.pblock, 20);
+    UtAssert_UINT32_EQ(buf.blk[0].u.primary.pblock.bundle_encode_size_cache, 22);
+
+    bplib_mpool_bblock_canonical_set_encode_size(&buf.blk[1].u.canonical.cblock, 30);
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_append(&buf.blk[0].u.primary.pblock, &buf.blk[1].header.base_link));
+    UtAssert_UINT32_EQ(buf.blk[0].u.primary.pblock.bundle_encode_size_cache, 52);
+
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_append(&buf.blk[0].u.primary.pblock, &buf.blk[2].header.base_link));
+    UtAssert_ZERO(buf.blk[0].u.primary.pblock.bundle_encode_size_cache);
+    bplib_mpool_bblock_canonical_set_encode_size(&buf.blk[2].u.canonical.cblock, 10);
+    UtAssert_UINT32_EQ(buf.blk[0].u.primary.pblock.bundle_encode_size_cache, 62);
+
+    /* re-encoding a block to a different size */
+    bplib_mpool_bblock_canonical_set_encode_size(&buf.blk[1].u.canonical.cblock, 40);
+    UtAssert_UINT32_EQ(buf.blk[0].u.primary.pblock.bundle_encode_size_cache, 72);
+    bplib_mpool_bblock_primary_set_encode_size(&buf.blk[0].u.primary.pblock, 0);
+    UtAssert_ZERO(buf.blk[0].u.primary.pblock.bundle_encode_size_cache);
+    bplib_mpool_bblock_primary_set_encode_size(&buf.blk[0].u.primary.pblock, 24);
+    UtAssert_UINT32_EQ(buf.blk[0].u.primary.pblock.bundle_encode_size_cache, 76);
 }
 
 void test_bplib_mpool_bblock_primary_locate_canonical(void)
@@ -238,6 +608,134 @@ void test_bplib_mpool_bblock_primary_locate_canonical(void)
     UtAssert_NULL(bplib_mpool_bblock_primary_locate_canonical(&buf.blk[0].u.primary.pblock, bp_blocktype_hopCount));
 }
 
+void test_bplib_mpool_bblock_primary_get_footprint(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_bblock_primary_get_footprint(bplib_mpool_bblock_primary_t *cpb, uint32_t *block_count);
+     */
+    UT_bplib_mpool_buf_t        buf;
+    bplib_mpool_block_content_t slices[3];
+    uint32_t                    count;
+    size_t                      block_size;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(slices, 0, sizeof(slices));
+    block_size = offsetof(bplib_mpool_block_content_t, u) + sizeof(bplib_mpool_block_buffer_t);
+
+    /* just the primary block */
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_primary_get_footprint(&buf.blk[0].u.primary.pblock, &count), block_size);
+    UtAssert_UINT32_EQ(count, 1);
+
+    /* a canonical block with a chunk of CBOR data */
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_canonical, 0);
+    bplib_mpool_insert_before(&buf.blk[0].u.primary.pblock.cblock_list, &buf.blk[1].header.base_link);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    bplib_mpool_insert_before(&buf.blk[1].u.canonical.cblock.chunk_list, &buf.blk[2].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_primary_get_footprint(&buf.blk[0].u.primary.pblock, NULL), 3 * block_size);
+
+    /* slices of the same buffer in a row only count for the buffer once */
+    test_setup_mpblock(&buf.pool, &slices[0], bplib_mpool_blocktype_ref, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &slices[1], bplib_mpool_blocktype_ref, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &slices[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    slices[0].u.ref.pref_target = &slices[2];
+    slices[1].u.ref.pref_target = &slices[2];
+    bplib_mpool_insert_before(&buf.blk[0].u.primary.pblock.chunk_list, &slices[0].header.base_link);
+    bplib_mpool_insert_before(&buf.blk[1].u.canonical.cblock.chunk_list, &slices[1].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_primary_get_footprint(&buf.blk[0].u.primary.pblock, &count),
+                       6 * block_size);
+    UtAssert_UINT32_EQ(count, 6);
+}
+
+void test_bplib_mpool_bblock_primary_share_copy(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_t *bplib_mpool_bblock_primary_share_copy(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t
+     * *cpb, uint8_t priority, uint64_t timeout);
+     */
+    UT_bplib_mpool_buf_t            buf;
+    bplib_mpool_block_content_t     more[9];
+    bplib_mpool_bblock_primary_t   *src_cpb;
+    bplib_mpool_bblock_primary_t   *copy_cpb;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bplib_mpool_block_t            *pblk;
+    bplib_mpool_block_t            *cblk;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(more, 0, sizeof(more));
+
+    /* a bundle with an encoded payload and a hop count block */
+    test_setup_mpblock(&buf.pool, &more[0], bplib_mpool_blocktype_primary, 0);
+    src_cpb                                              = &more[0].u.primary.pblock;
+    src_cpb->data.logical.creationTimeStamp.sequence_num = 1234;
+    src_cpb->data.delivery.ingress_time                  = 5678;
+    src_cpb->data.delivery.committed_storage_id          = 42;
+    src_cpb->data.delivery.trace_ref                     = &more[8];
+
+    test_setup_mpblock(&buf.pool, &more[1], bplib_mpool_blocktype_canonical, 0);
+    more[1].u.canonical.cblock.canonical_logical_data.canonical_block.blockType = bp_blocktype_payloadBlock;
+    more[1].u.canonical.cblock.canonical_logical_data.canonical_block.blockNum  = 1;
+    more[1].u.canonical.cblock.encoded_content_offset                           = 4;
+    more[1].u.canonical.cblock.encoded_content_length                           = 60;
+    bplib_mpool_bblock_primary_append(src_cpb, &more[1].header.base_link);
+    test_setup_mpblock(&buf.pool, &more[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    bplib_mpool_bblock_cbor_set_size(&more[2].header.base_link, 100);
+    test_setup_slice(&buf.pool, &more[3], &more[2], 64);
+    bplib_mpool_bblock_cbor_append(&more[1].u.canonical.cblock.chunk_list, &more[3].header.base_link);
+    bplib_mpool_bblock_canonical_set_encode_size(&more[1].u.canonical.cblock, 64);
+
+    test_setup_mpblock(&buf.pool, &more[4], bplib_mpool_blocktype_canonical, 0);
+    more[4].u.canonical.cblock.canonical_logical_data.canonical_block.blockType = bp_blocktype_hopCount;
+    more[4].u.canonical.cblock.canonical_logical_data.canonical_block.blockNum  = 2;
+    bplib_mpool_bblock_primary_append(src_cpb, &more[4].header.base_link);
+    test_setup_slice(&buf.pool, &more[5], &more[2], 6);
+    bplib_mpool_bblock_cbor_append(&more[4].u.canonical.cblock.chunk_list, &more[5].header.base_link);
+    bplib_mpool_bblock_canonical_set_encode_size(&more[4].u.canonical.cblock, 6);
+    UtAssert_UINT32_EQ(more[2].header.refcount, 2);
+
+    /* no memory */
+    test_setup_allocation(&buf.pool, &more[6], &buf.blk[1]);
+    bplib_mpool_subq_pull_single(&bplib_mpool_get_admin(&buf.pool)->free_blocks);
+    UtAssert_NULL(bplib_mpool_bblock_primary_share_copy(&buf.pool, src_cpb, 0, 0));
+
+    /* the primary block is there, but not the rest */
+    test_setup_allocation(&buf.pool, &more[6], &buf.blk[1]);
+    UtAssert_NULL(bplib_mpool_bblock_primary_share_copy(&buf.pool, src_cpb, 0, 0));
+    UtAssert_UINT32_EQ(more[2].header.refcount, 2);
+
+    /* nominal */
+    test_setup_allocation(&buf.pool, &more[6], &buf.blk[1]);
+    test_add_free_block(&buf.pool, &buf.blk[0]);
+    test_add_free_block(&buf.pool, &buf.blk[2]);
+    test_add_free_block(&buf.pool, &more[7]);
+    pblk = bplib_mpool_bblock_primary_share_copy(&buf.pool, src_cpb, 0, 0);
+    UtAssert_NOT_NULL(pblk);
+    copy_cpb = bplib_mpool_bblock_primary_cast(pblk);
+    UtAssert_NOT_NULL(copy_cpb);
+    UtAssert_UINT32_EQ(copy_cpb->data.logical.creationTimeStamp.sequence_num, 1234);
+    UtAssert_UINT32_EQ(copy_cpb->data.delivery.ingress_time, 5678);
+    UtAssert_ZERO(copy_cpb->data.delivery.committed_storage_id);
+    UtAssert_NULL(copy_cpb->data.delivery.trace_ref);
+
+    /* the payload refers to the same data, the hop count is left to be encoded again */
+    cblk = bplib_mpool_bblock_primary_locate_canonical(copy_cpb, bp_blocktype_payloadBlock);
+    UtAssert_NOT_NULL(cblk);
+    ccb = bplib_mpool_bblock_canonical_cast(cblk);
+    UtAssert_UINT32_EQ(ccb->block_encode_size_cache, 64);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_canonical_get_content_offset(ccb), 4);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_canonical_get_content_length(ccb), 60);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_cbor_cast(bplib_mpool_get_next_block(&ccb->chunk_list)),
+                        more[2].u.content_bytes);
+    UtAssert_UINT32_EQ(more[2].header.refcount, 3);
+
+    cblk = bplib_mpool_bblock_primary_locate_canonical(copy_cpb, bp_blocktype_hopCount);
+    UtAssert_NOT_NULL(cblk);
+    ccb = bplib_mpool_bblock_canonical_cast(cblk);
+    UtAssert_ZERO(ccb->block_encode_size_cache);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&ccb->chunk_list));
+    UtAssert_UINT32_EQ(copy_cpb->unencoded_block_count, 2);
+}
+
 void test_bplib_mpool_bblock_primary_drop_encode(void)
 {
     /* Test function for:
@@ -265,6 +763,78 @@ void test_bplib_mpool_bblock_primary_drop_encode(void)
     UtAssert_BOOL_FALSE(bplib_mpool_is_empty_list_head(&admin->recycle_blocks.block_list));
 }
 
+void test_bplib_mpool_bblock_primary_quota(void)
+{
+    /* Test function for:
+     * void bplib_mpool_bblock_primary_quota_charge(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t flow_ref,
+     *                                              size_t size)
+     * void bplib_mpool_bblock_primary_quota_release(bplib_mpool_bblock_primary_t *cpb)
+     */
+    UT_bplib_mpool_buf_t          buf;
+    bplib_mpool_bblock_primary_t *cpb;
+    bplib_mpool_flow_t           *flow;
+    bplib_mpool_ref_t             flow_ref;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_flow, 0);
+    cpb                        = &buf.blk[0].u.primary.pblock;
+    flow                       = &buf.blk[1].u.flow.fblock;
+    flow_ref                   = (bplib_mpool_ref_t)&buf.blk[1];
+    buf.blk[1].header.refcount = 1;
+
+    /* nothing is charged without a limit, or to something that is not a flow */
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_quota_charge(cpb, flow_ref, 100));
+    UtAssert_NULL(cpb->data.delivery.quota_ref);
+    flow->quota.limit = 1000;
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_quota_charge(cpb, (bplib_mpool_ref_t)&buf.blk[0], 100));
+    UtAssert_NULL(cpb->data.delivery.quota_ref);
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_quota_release(cpb));
+
+    /* charged once, holding a ref to the flow until it is given back */
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_quota_charge(cpb, flow_ref, 100));
+    UtAssert_ADDRESS_EQ(cpb->data.delivery.quota_ref, flow_ref);
+    UtAssert_UINT32_EQ(flow->quota.used, 100);
+    UtAssert_UINT32_EQ(buf.blk[1].header.refcount, 2);
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_quota_charge(cpb, flow_ref, 100));
+    UtAssert_UINT32_EQ(flow->quota.used, 100);
+
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_quota_release(cpb));
+    UtAssert_NULL(cpb->data.delivery.quota_ref);
+    UtAssert_ZERO(flow->quota.used);
+    UtAssert_UINT32_EQ(buf.blk[1].header.refcount, 1);
+}
+
+void test_bplib_mpool_bblock_primary_drop_canonical_blocks(void)
+{
+    /* Test function for:
+     * void bplib_mpool_bblock_primary_drop_canonical_blocks(bplib_mpool_bblock_primary_t *cpb);
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    admin = bplib_mpool_get_admin(&buf.pool);
+
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_drop_canonical_blocks(&buf.blk[0].u.primary.pblock));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->recycle_blocks.block_list));
+    UtAssert_ZERO(buf.blk[0].u.primary.pblock.bundle_encode_size_cache);
+
+    /* an unencoded block is dropped, which leaves only the encoded primary block to count */
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_canonical, 0);
+    bplib_mpool_bblock_primary_set_encode_size(&buf.blk[0].u.primary.pblock, 20);
+    bplib_mpool_bblock_primary_append(&buf.blk[0].u.primary.pblock, &buf.blk[1].header.base_link);
+    UtAssert_ZERO(buf.blk[0].u.primary.pblock.bundle_encode_size_cache);
+    UtAssert_VOIDCALL(bplib_mpool_bblock_primary_drop_canonical_blocks(&buf.blk[0].u.primary.pblock));
+    UtAssert_BOOL_FALSE(bplib_mpool_is_empty_list_head(&admin->recycle_blocks.block_list));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&buf.blk[0].u.primary.pblock.cblock_list));
+    UtAssert_UINT32_EQ(buf.blk[0].u.primary.pblock.bundle_encode_size_cache, 22);
+}
+
 void test_bplib_mpool_bblock_canonical_drop_encode(void)
 {
     /* Test function for:
@@ -364,6 +934,233 @@ void test_bplib_mpool_bblock_cbor_export(void)
                                                  sizeof(output)));
 }
 
+void test_bplib_mpool_bblock_cbor_export_iov(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_bblock_cbor_export_iov(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_iovec_t        iov[2];
+
+    memset(&buf, 0, sizeof(buf));
+    memset(iov, 0, sizeof(iov));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+
+    /* empty list */
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_export_iov(&buf.blk[0].u.primary.pblock.chunk_list, iov, 2));
+
+    /* zero-size blocks are skipped */
+    bplib_mpool_insert_before(&buf.blk[0].u.primary.pblock.chunk_list, &buf.blk[1].header.base_link);
+    bplib_mpool_insert_before(&buf.blk[0].u.primary.pblock.chunk_list, &buf.blk[2].header.base_link);
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_export_iov(&buf.blk[0].u.primary.pblock.chunk_list, iov, 2));
+
+    /* nominal, the entries point at the block content in order */
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[1].header.base_link, 32);
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[2].header.base_link, 16);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export_iov(&buf.blk[0].u.primary.pblock.chunk_list, iov, 2), 2);
+    UtAssert_ADDRESS_EQ(iov[0].base, bplib_mpool_bblock_cbor_cast(&buf.blk[1].header.base_link));
+    UtAssert_UINT32_EQ(iov[0].len, 32);
+    UtAssert_ADDRESS_EQ(iov[1].base, bplib_mpool_bblock_cbor_cast(&buf.blk[2].header.base_link));
+    UtAssert_UINT32_EQ(iov[1].len, 16);
+
+    /* not enough entries, still reports how many are needed */
+    memset(iov, 0, sizeof(iov));
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export_iov(&buf.blk[0].u.primary.pblock.chunk_list, iov, 1), 2);
+    UtAssert_UINT32_EQ(iov[0].len, 32);
+    UtAssert_ZERO(iov[1].len);
+
+    /* start over with a block that is NOT cbor first, should stop at that point */
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, ~MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[2].header.base_link, 16);
+    bplib_mpool_insert_before(&buf.blk[0].u.primary.pblock.chunk_list, &buf.blk[1].header.base_link);
+    bplib_mpool_insert_before(&buf.blk[0].u.primary.pblock.chunk_list, &buf.blk[2].header.base_link);
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_export_iov(&buf.blk[0].u.primary.pblock.chunk_list, iov, 2));
+}
+
+void test_bplib_mpool_bblock_cbor_export_iov_range(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_bblock_cbor_export_iov_range(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov,
+     *                                                 size_t seek_start, size_t max_count)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t *list;
+    const uint8_t       *data1;
+    const uint8_t       *data2;
+    bplib_iovec_t        iov[2];
+
+    memset(&buf, 0, sizeof(buf));
+    memset(iov, 0, sizeof(iov));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    list = &buf.blk[0].u.primary.pblock.chunk_list;
+
+    /* empty list */
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 2, 0, 16));
+
+    bplib_mpool_insert_before(list, &buf.blk[1].header.base_link);
+    bplib_mpool_insert_before(list, &buf.blk[2].header.base_link);
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[1].header.base_link, 32);
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[2].header.base_link, 16);
+    data1 = bplib_mpool_bblock_cbor_cast(&buf.blk[1].header.base_link);
+    data2 = bplib_mpool_bblock_cbor_cast(&buf.blk[2].header.base_link);
+
+    /* zero size */
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 2, 8, 0));
+
+    /* range within the first block */
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 2, 8, 16), 1);
+    UtAssert_ADDRESS_EQ(iov[0].base, data1 + 8);
+    UtAssert_UINT32_EQ(iov[0].len, 16);
+
+    /* range crossing into the second block */
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 2, 24, 20), 2);
+    UtAssert_ADDRESS_EQ(iov[0].base, data1 + 24);
+    UtAssert_UINT32_EQ(iov[0].len, 8);
+    UtAssert_ADDRESS_EQ(iov[1].base, data2);
+    UtAssert_UINT32_EQ(iov[1].len, 12);
+
+    /* range starting in the second block */
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 2, 36, 100), 1);
+    UtAssert_ADDRESS_EQ(iov[0].base, data2 + 4);
+    UtAssert_UINT32_EQ(iov[0].len, 12);
+
+    /* not enough entries, still reports how many are needed */
+    memset(iov, 0, sizeof(iov));
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 1, 0, 48), 2);
+    UtAssert_UINT32_EQ(iov[0].len, 32);
+    UtAssert_ZERO(iov[1].len);
+
+    /* seek beyond the end */
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_export_iov_range(list, iov, 2, 48, 16));
+}
+
+void test_bplib_mpool_bblock_cbor_crc_update(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_bblock_cbor_crc_update(bplib_mpool_block_t *list, bplib_crc_parameters_t *params,
+     *                                           bp_crcval_t *crc, size_t seek_start, size_t max_count)
+     */
+    UT_bplib_mpool_buf_t        buf;
+    bplib_mpool_block_content_t chunks[20];
+    bplib_mpool_block_t        *list;
+    bp_crcval_t                 crc;
+    size_t                      i;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(chunks, 0, sizeof(chunks));
+    UT_SetHandlerFunction(UT_KEY(bplib_crc_update_list), UT_AltHandler_CrcUpdateList, NULL);
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    list = &buf.blk[0].u.primary.pblock.chunk_list;
+
+    /* empty list */
+    crc = 0;
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_crc_update(list, &BPLIB_CRC32_CASTAGNOLI, &crc, 0, 16));
+    UtAssert_ZERO(crc);
+    UtAssert_STUB_COUNT(bplib_crc_update_list, 0);
+
+    /* more chunks than are digested in one call */
+    for (i = 0; i < 20; ++i)
+    {
+        test_setup_mpblock(&buf.pool, &chunks[i], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+        bplib_mpool_insert_before(list, &chunks[i].header.base_link);
+        bplib_mpool_bblock_cbor_set_size(&chunks[i].header.base_link, 10);
+    }
+
+    /* range within the first chunks, in one call */
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_crc_update(list, &BPLIB_CRC32_CASTAGNOLI, &crc, 5, 20), 20);
+    UtAssert_UINT32_EQ(crc, 20);
+    UtAssert_STUB_COUNT(bplib_crc_update_list, 1);
+
+    /* the whole list, the CRC value is carried from one call to the next */
+    crc = 1;
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_crc_update(list, &BPLIB_CRC32_CASTAGNOLI, &crc, 0, SIZE_MAX), 200);
+    UtAssert_UINT32_EQ(crc, 201);
+    UtAssert_STUB_COUNT(bplib_crc_update_list, 3);
+
+    /* the list ends before the range does */
+    crc = 0;
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_crc_update(list, &BPLIB_CRC32_CASTAGNOLI, &crc, 195, 10), 5);
+    UtAssert_UINT32_EQ(crc, 5);
+
+    /* a chunk which is not CBOR data stops it */
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, 0);
+    bplib_mpool_insert_after(&chunks[1].header.base_link, &buf.blk[1].header.base_link);
+    crc = 0;
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_crc_update(list, &BPLIB_CRC32_CASTAGNOLI, &crc, 0, 100), 20);
+    UtAssert_UINT32_EQ(crc, 20);
+}
+
+void test_bplib_mpool_bblock_cbor_overwrite(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_bblock_cbor_overwrite(bplib_mpool_block_t *list, const void *in_ptr, size_t seek_start,
+     *                                          size_t count)
+     */
+    UT_bplib_mpool_buf_t             buf;
+    bplib_mpool_block_content_t      slice_block;
+    bplib_mpool_bblock_cbor_slice_t *slice;
+    bplib_mpool_block_t             *list;
+    uint8_t                         *data1;
+    uint8_t                         *data2;
+    uint8_t                          input[24];
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&slice_block, 0, sizeof(slice_block));
+    memset(input, 0xA5, sizeof(input));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
+    list = &buf.blk[0].u.primary.pblock.chunk_list;
+
+    /* empty list */
+    UtAssert_ZERO(bplib_mpool_bblock_cbor_overwrite(list, input, 0, 16));
+
+    bplib_mpool_insert_before(list, &buf.blk[1].header.base_link);
+    bplib_mpool_insert_before(list, &buf.blk[2].header.base_link);
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[1].header.base_link, 32);
+    bplib_mpool_bblock_cbor_set_size(&buf.blk[2].header.base_link, 16);
+    data1 = bplib_mpool_bblock_cbor_cast(&buf.blk[1].header.base_link);
+    data2 = bplib_mpool_bblock_cbor_cast(&buf.blk[2].header.base_link);
+
+    /* range crossing into the second block, the sizes stay the same */
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_overwrite(list, input, 24, 20), 20);
+    UtAssert_ZERO(data1[23]);
+    UtAssert_UINT32_EQ(data1[24], 0xA5);
+    UtAssert_UINT32_EQ(data1[31], 0xA5);
+    UtAssert_UINT32_EQ(data2[11], 0xA5);
+    UtAssert_ZERO(data2[12]);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(&buf.blk[1].header.base_link), 32);
+    UtAssert_UINT32_EQ(bplib_mpool_get_user_content_size(&buf.blk[2].header.base_link), 16);
+
+    /* runs off the end of the chain */
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_overwrite(list, input, 40, sizeof(input)), 8);
+
+    /* a slice is not changed, and stops it */
+    test_setup_mpblock(&buf.pool, &slice_block, bplib_mpool_blocktype_ref, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    slice_block.u.ref.pref_target = &buf.blk[2];
+    slice = bplib_mpool_generic_data_cast(&slice_block.header.base_link, MPOOL_CACHE_CBOR_SLICE_SIGNATURE);
+    UtAssert_NOT_NULL(slice);
+    bplib_mpool_extract_node(&buf.blk[2].header.base_link);
+    bplib_mpool_insert_before(list, &slice_block.header.base_link);
+    memset(data2, 0, 16);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_overwrite(list, input, 24, 20), 8);
+    UtAssert_ZERO(data2[0]);
+}
+
 void TestBplibMpoolBBlocks_Register(void)
 {
     UtTest_Add(test_bplib_mpool_bblock_primary_cast, TestBplibMpool_ResetTestEnvironment, NULL,
@@ -380,16 +1177,46 @@ void TestBplibMpoolBBlocks_Register(void)
                "bplib_mpool_bblock_canonical_alloc");
     UtTest_Add(test_bplib_mpool_bblock_cbor_alloc, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_cbor_alloc");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_alloc_sized, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_alloc_sized");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_alloc_n, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_alloc_n");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_slice_init, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_slice_init");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_slice_alloc, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_slice_alloc");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_share, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_share");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_extern_init, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_extern_init");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_extern_alloc, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_extern_alloc");
     UtTest_Add(test_bplib_mpool_bblock_cbor_append, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_cbor_append");
     UtTest_Add(test_bplib_mpool_bblock_primary_append, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_primary_append");
     UtTest_Add(test_bplib_mpool_bblock_primary_locate_canonical, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_primary_locate_canonical");
+    UtTest_Add(test_bplib_mpool_bblock_primary_get_footprint, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_primary_get_footprint");
+    UtTest_Add(test_bplib_mpool_bblock_primary_share_copy, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_primary_share_copy");
     UtTest_Add(test_bplib_mpool_bblock_primary_drop_encode, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_primary_drop_encode");
+    UtTest_Add(test_bplib_mpool_bblock_primary_quota, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_primary_quota");
+    UtTest_Add(test_bplib_mpool_bblock_primary_drop_canonical_blocks, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_primary_drop_canonical_blocks");
     UtTest_Add(test_bplib_mpool_bblock_canonical_drop_encode, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_canonical_drop_encode");
     UtTest_Add(test_bplib_mpool_bblock_cbor_export, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_bblock_cbor_export");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_export_iov, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_export_iov");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_export_iov_range, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_export_iov_range");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_crc_update, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_crc_update");
+    UtTest_Add(test_bplib_mpool_bblock_cbor_overwrite, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_bblock_cbor_overwrite");
 }
@@ -127,6 +127,66 @@ void test_bplib_mpool_subq_pull_single(void)
     UtAssert_NULL(bplib_mpool_subq_pull_single(&buf.blk[0].u.flow.fblock.ingress.base_subq));
 }
 
+void test_bplib_mpool_subq_push_n(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_subq_push_n(bplib_mpool_subq_base_t *subq, bplib_mpool_block_t *list, uint32_t limit)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t  list;
+
+    memset(&buf, 0, sizeof(buf));
+    bplib_mpool_init_list_head(NULL, &list);
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_primary, 0);
+
+    UtAssert_ZERO(bplib_mpool_subq_push_n(&buf.blk[0].u.flow.fblock.ingress.base_subq, &list, 5));
+
+    bplib_mpool_insert_before(&list, &buf.blk[1].header.base_link);
+    bplib_mpool_insert_before(&list, &buf.blk[2].header.base_link);
+
+    /* the limit is respected, and blocks are taken in order */
+    UtAssert_UINT32_EQ(bplib_mpool_subq_push_n(&buf.blk[0].u.flow.fblock.ingress.base_subq, &list, 1), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &buf.blk[2].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_push_n(&buf.blk[0].u.flow.fblock.ingress.base_subq, &list, 5), 1);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&list));
+    UtAssert_UINT32_EQ(buf.blk[0].u.flow.fblock.ingress.base_subq.push_count, 2);
+    UtAssert_UINT32_EQ(buf.blk[0].u.flow.fblock.ingress.base_subq.pull_count, 0);
+    UtAssert_ADDRESS_EQ(bplib_mpool_subq_pull_single(&buf.blk[0].u.flow.fblock.ingress.base_subq),
+                        &buf.blk[1].header.base_link);
+}
+
+void test_bplib_mpool_subq_pull_n(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_subq_pull_n(bplib_mpool_subq_base_t *subq, bplib_mpool_block_t *list, uint32_t limit)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t  list;
+
+    memset(&buf, 0, sizeof(buf));
+    bplib_mpool_init_list_head(NULL, &list);
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_primary, 0);
+
+    UtAssert_ZERO(bplib_mpool_subq_pull_n(&buf.blk[0].u.flow.fblock.ingress.base_subq, &list, 5));
+
+    bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.ingress.base_subq, &buf.blk[1].header.base_link);
+    bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.ingress.base_subq, &buf.blk[2].header.base_link);
+
+    UtAssert_UINT32_EQ(bplib_mpool_subq_pull_n(&buf.blk[0].u.flow.fblock.ingress.base_subq, &list, 1), 1);
+    UtAssert_UINT32_EQ(buf.blk[0].u.flow.fblock.ingress.base_subq.pull_count, 1);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_pull_n(&buf.blk[0].u.flow.fblock.ingress.base_subq, &list, 5), 1);
+    UtAssert_UINT32_EQ(buf.blk[0].u.flow.fblock.ingress.base_subq.pull_count, 2);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&buf.blk[0].u.flow.fblock.ingress.base_subq));
+    UtAssert_UINT32_EQ(bplib_mpool_list_count_blocks(&list), 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &buf.blk[1].header.base_link);
+}
+
 void test_bplib_mpool_flow_cast(void)
 {
     /* Test function for:
@@ -160,6 +220,13 @@ void test_bplib_mpool_flow_alloc(void)
 
     test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
     UtAssert_ADDRESS_EQ(bplib_mpool_flow_alloc(&buf.pool, 1234, NULL), &buf.blk[0]);
+
+    /* a new flow wants no poll, so it is not in any poll list */
+    UtAssert_True(buf.blk[0].u.flow.fblock.poll_time == BP_DTNTIME_INFINITE, "poll_time == BP_DTNTIME_INFINITE");
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&buf.blk[0].u.flow.fblock.poll_link));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_block_from_link(&buf.blk[0].u.flow.fblock.poll_link), &buf.blk[0]);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&buf.blk[0].u.flow.fblock.reserve.block_list));
+    UtAssert_ZERO(buf.blk[0].u.flow.fblock.reserve.target_count);
 }
 
 void test_bplib_mpool_flow_disable(void)
@@ -188,6 +255,12 @@ void test_bplib_mpool_flow_enable(void)
     test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
 
     UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.ingress, 1));
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
+
+    /* a thread waiting for space should be woken */
+    buf.blk[0].u.flow.fblock.ingress.space_waiters = 1;
+    UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.ingress, 2));
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
 }
 
 void test_bplib_mpool_flow_try_push(void)
@@ -205,22 +278,26 @@ void test_bplib_mpool_flow_try_push(void)
     test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_primary, 0);
 
     UtAssert_BOOL_FALSE(bplib_mpool_flow_try_push(&buf.blk[0].u.flow.fblock.ingress, &buf.blk[1].header.base_link, 0));
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 0);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
 
+    /* with nobody waiting, a push does not need to wake anything */
     UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&buf.blk[1].header.base_link));
     UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.ingress, 1));
     UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(&buf.blk[0].u.flow.fblock.ingress, &buf.blk[1].header.base_link, 0));
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
     UtAssert_BOOL_TRUE(bplib_mpool_is_link_attached(&buf.blk[1].header.base_link));
 
     UtAssert_BOOL_FALSE(bplib_mpool_flow_try_push(&buf.blk[0].u.flow.fblock.ingress, &buf.blk[2].header.base_link, 0));
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
     UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&buf.blk[2].header.base_link));
 
-    /* This time use a nonzero timeout */
-    UT_SetHandlerFunction(UT_KEY(bplib_os_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
+    /* This time use a nonzero timeout, and have a reader waiting on the queue */
+    buf.blk[0].u.flow.fblock.ingress.fill_waiters = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
     UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(&buf.blk[0].u.flow.fblock.ingress, &buf.blk[2].header.base_link, 100));
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
+    UtAssert_ZERO(buf.blk[0].u.flow.fblock.ingress.space_waiters);
 }
 
 void test_bplib_mpool_flow_try_move_all(void)
@@ -239,8 +316,16 @@ void test_bplib_mpool_flow_try_move_all(void)
 
     UtAssert_ZERO(
         bplib_mpool_flow_try_move_all(&buf.blk[0].u.flow.fblock.egress, &buf.blk[0].u.flow.fblock.ingress, 0));
-    /* Even though the above did nothing it still signals on the lock */
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
+
+    /* both queues are signaled when something is waiting on each of them */
+    buf.blk[0].u.flow.fblock.egress.fill_waiters   = 1;
+    buf.blk[0].u.flow.fblock.ingress.space_waiters = 1;
+    UtAssert_ZERO(
+        bplib_mpool_flow_try_move_all(&buf.blk[0].u.flow.fblock.egress, &buf.blk[0].u.flow.fblock.ingress, 0));
+    /* Even though the above did nothing it still signals the waiters */
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 2);
+    buf.blk[0].u.flow.fblock.ingress.space_waiters = 0;
 
     UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.ingress, 1));
     UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.egress, 1));
@@ -248,15 +333,16 @@ void test_bplib_mpool_flow_try_move_all(void)
         bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.ingress.base_subq, &buf.blk[1].header.base_link));
     UtAssert_UINT32_EQ(
         bplib_mpool_flow_try_move_all(&buf.blk[0].u.flow.fblock.egress, &buf.blk[0].u.flow.fblock.ingress, 0), 1);
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 3);
 
-    UT_SetHandlerFunction(UT_KEY(bplib_os_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
-    UT_SetDeferredRetcode(UT_KEY(bplib_os_wait_until_ms), 2, BP_TIMEOUT);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
+    UT_SetDeferredRetcode(UT_KEY(bplib_os_mutex_wait_until_ms), 2, BP_TIMEOUT);
     UtAssert_VOIDCALL(
         bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.ingress.base_subq, &buf.blk[2].header.base_link));
     UtAssert_ZERO(
         bplib_mpool_flow_try_move_all(&buf.blk[0].u.flow.fblock.ingress, &buf.blk[0].u.flow.fblock.egress, 100));
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 3);
+    UtAssert_ZERO(buf.blk[0].u.flow.fblock.ingress.space_waiters);
 }
 
 void test_bplib_mpool_flow_try_pull(void)
@@ -273,23 +359,482 @@ void test_bplib_mpool_flow_try_pull(void)
     test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_primary, 0);
 
     UtAssert_NULL(bplib_mpool_flow_try_pull(&buf.blk[0].u.flow.fblock.ingress, 0));
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 0);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
 
     UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.ingress, 1));
     UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.egress, 1));
+    buf.blk[0].u.flow.fblock.egress.space_waiters = 1;
     UtAssert_VOIDCALL(
         bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.egress.base_subq, &buf.blk[1].header.base_link));
 
     UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(&buf.blk[0].u.flow.fblock.egress, 0), &buf.blk[1]);
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
     UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&buf.blk[1].header.base_link));
 
     /* This time use a nonzero timeout */
     UtAssert_VOIDCALL(
         bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.ingress.base_subq, &buf.blk[1].header.base_link));
-    UT_SetHandlerFunction(UT_KEY(bplib_os_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
     UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(&buf.blk[0].u.flow.fblock.egress, 100), &buf.blk[1]);
-    UtAssert_STUB_COUNT(bplib_os_broadcast_signal, 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 2);
+    UtAssert_ZERO(buf.blk[0].u.flow.fblock.egress.fill_waiters);
+}
+
+void test_bplib_mpool_flow_try_push_n(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_flow_try_push_n(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_block_t *list,
+     *      uint32_t max_count, uint64_t abs_timeout)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t  list;
+
+    memset(&buf, 0, sizeof(buf));
+    bplib_mpool_init_list_head(NULL, &list);
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_primary, 0);
+    bplib_mpool_insert_before(&list, &buf.blk[1].header.base_link);
+    bplib_mpool_insert_before(&list, &buf.blk[2].header.base_link);
+
+    buf.blk[0].u.flow.fblock.ingress.fill_waiters = 1;
+    buf.blk[0].u.flow.fblock.egress.fill_waiters  = 1;
+
+    /* flow not enabled, so nothing fits */
+    UtAssert_ZERO(bplib_mpool_flow_try_push_n(&buf.blk[0].u.flow.fblock.ingress, &list, 5, 0));
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
+    UtAssert_UINT32_EQ(bplib_mpool_list_count_blocks(&list), 2);
+
+    /* only pushes as many as the depth limit allows */
+    UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.ingress, 1));
+    UtAssert_ZERO(bplib_mpool_flow_try_push_n(&buf.blk[0].u.flow.fblock.ingress, &list, 0, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(&buf.blk[0].u.flow.fblock.ingress, &list, 5, 0), 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
+    UtAssert_UINT32_EQ(bplib_mpool_list_count_blocks(&list), 1);
+    UtAssert_ZERO(bplib_mpool_flow_try_push_n(&buf.blk[0].u.flow.fblock.ingress, &list, 5, 0));
+
+    /* nothing to push is not an error, and does not signal */
+    UtAssert_VOIDCALL(bplib_mpool_flow_enable(&buf.blk[0].u.flow.fblock.egress, 2));
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(&buf.blk[0].u.flow.fblock.egress, &list, 5, 0), 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 2);
+    UtAssert_ZERO(bplib_mpool_flow_try_push_n(&buf.blk[0].u.flow.fblock.egress, &list, 5, 0));
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 2);
+    UtAssert_UINT32_EQ(buf.blk[0].u.flow.fblock.egress.base_subq.push_count, 1);
+}
+
+void test_bplib_mpool_flow_try_pull_n(void)
+{
+    /* Test function for:
+     * uint32_t bplib_mpool_flow_try_pull_n(bplib_mpool_subq_workitem_t *subq_src, bplib_mpool_block_t *list,
+     *      uint32_t max_count, uint64_t abs_timeout)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_block_t  list;
+
+    memset(&buf, 0, sizeof(buf));
+    bplib_mpool_init_list_head(NULL, &list);
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_primary, 0);
+
+    buf.blk[0].u.flow.fblock.egress.space_waiters = 1;
+    UtAssert_ZERO(bplib_mpool_flow_try_pull_n(&buf.blk[0].u.flow.fblock.egress, &list, 5, 0));
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
+
+    UtAssert_VOIDCALL(
+        bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.egress.base_subq, &buf.blk[1].header.base_link));
+    UtAssert_VOIDCALL(
+        bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.egress.base_subq, &buf.blk[2].header.base_link));
+    UtAssert_ZERO(bplib_mpool_flow_try_pull_n(&buf.blk[0].u.flow.fblock.egress, &list, 0, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_pull_n(&buf.blk[0].u.flow.fblock.egress, &list, 5, 0), 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
+    UtAssert_UINT32_EQ(bplib_mpool_list_count_blocks(&list), 2);
+    UtAssert_UINT32_EQ(buf.blk[0].u.flow.fblock.egress.base_subq.pull_count, 2);
+
+    /* This time use a nonzero timeout */
+    bplib_mpool_extract_node(&buf.blk[1].header.base_link);
+    bplib_mpool_extract_node(&buf.blk[2].header.base_link);
+    UtAssert_VOIDCALL(
+        bplib_mpool_subq_push_single(&buf.blk[0].u.flow.fblock.ingress.base_subq, &buf.blk[1].header.base_link));
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_wait_until_ms), UT_AltHandler_MoveQueue, &buf.blk[0].u.flow.fblock);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_pull_n(&buf.blk[0].u.flow.fblock.egress, &list, 5, 100), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &buf.blk[1].header.base_link);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 2);
+}
+
+static void UT_AltHandler_RingConsume(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_subq_workitem_t *subq = UserObj;
+
+    /* acts as the consumer of the ring, making room for one more entry */
+    ++subq->base_subq.pull_count;
+}
+
+void test_bplib_mpool_flow_attach_ring(void)
+{
+    /* Test function for:
+     * int bplib_mpool_flow_attach_ring(bplib_mpool_subq_workitem_t *subq, uint32_t ring_flags)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_subq_workitem_t       *subq;
+    bplib_mpool_block_t                node;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    test_make_singleton_link(NULL, &node);
+    subq = &buf.blk[2].u.flow.fblock.ingress;
+
+    /* no block available for the ring */
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_ring(subq, BPLIB_MPOOL_RING_SINGLE_PRODUCER), BP_ERROR);
+    UtAssert_NULL(subq->ring);
+
+    /* the queue is not empty, so the block is given back */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    admin = bplib_mpool_get_admin(&buf.pool);
+    bplib_mpool_subq_push_single(&subq->base_subq, &node);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_ring(subq, BPLIB_MPOOL_RING_SINGLE_PRODUCER), BP_ERROR);
+    UtAssert_NULL(subq->ring);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 1);
+
+    UtAssert_ADDRESS_EQ(bplib_mpool_subq_pull_single(&subq->base_subq), &node);
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_ring(subq, BPLIB_MPOOL_RING_SINGLE_PRODUCER), BP_SUCCESS);
+    UtAssert_NOT_NULL(subq->ring);
+    UtAssert_ADDRESS_EQ(subq->ring->storage_block, &buf.blk[0].header.base_link);
+    UtAssert_UINT32_EQ(subq->ring->ring_flags, BPLIB_MPOOL_RING_SINGLE_PRODUCER);
+    UtAssert_NONZERO(subq->ring->slot_mask);
+    UtAssert_ZERO(subq->ring->slot_mask & (subq->ring->slot_mask + 1));
+    UtAssert_ZERO(subq->ring->job_pending);
+}
+
+void test_bplib_mpool_flow_ring(void)
+{
+    /* Test function for the ring mode of:
+     * bplib_mpool_flow_try_push(), bplib_mpool_flow_try_pull(), bplib_mpool_flow_try_push_n(),
+     * bplib_mpool_flow_try_pull_n(), bplib_mpool_flow_try_move_all() and bplib_mpool_flow_disable(), plus
+     * uint32_t bplib_mpool_subq_ring_detach_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpool_subq_workitem_t *subq)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_subq_workitem_t       *subq;
+    bplib_mpool_block_t                node[3];
+    bplib_mpool_block_t                list;
+    int                                i;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    admin = bplib_mpool_get_admin(&buf.pool);
+    subq  = &buf.blk[2].u.flow.fblock.ingress;
+    bplib_mpool_init_list_head(NULL, &list);
+    for (i = 0; i < 3; ++i)
+    {
+        test_make_singleton_link(NULL, &node[i]);
+    }
+
+    subq->job_header.handler = test_bplib_mpool_callback_stub;
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_ring(subq, BPLIB_MPOOL_RING_SINGLE_PRODUCER), BP_SUCCESS);
+
+    /* still disabled, so nothing fits */
+    UtAssert_BOOL_FALSE(bplib_mpool_flow_try_push(subq, &node[0], 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&node[0]));
+
+    /* the first push marks the job active, the next one does not need to */
+    UtAssert_VOIDCALL(bplib_mpool_flow_enable(subq, 2));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[0], 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&node[0]));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_attached(&subq->job_header.link));
+    UtAssert_UINT32_EQ(subq->ring->job_pending, 1);
+    bplib_mpool_extract_node(&subq->job_header.link);
+
+    bplib_mpool_insert_before(&list, &node[1]);
+    bplib_mpool_insert_before(&list, &node[2]);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(subq, &list, 5, 0), 1);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&subq->job_header.link));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &node[2]);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&subq->base_subq), 2);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 0);
+
+    /* This time the ring is full, and the consumer makes room while waiting */
+    subq->fill_waiters = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_wait_until_ms), UT_AltHandler_RingConsume, subq);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(subq, &list, 5, 100), 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 1);
+    UtAssert_ZERO(subq->space_waiters);
+    subq->fill_waiters = 0;
+
+    /* the whole queue cannot be moved at once */
+    UtAssert_ZERO(bplib_mpool_flow_try_move_all(&buf.blk[2].u.flow.fblock.egress, subq, 0));
+    UtAssert_ZERO(bplib_mpool_flow_try_move_all(subq, &buf.blk[2].u.flow.fblock.egress, 0));
+
+    /* finding the ring empty means the next push has to mark the job active again */
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &node[1]);
+    UtAssert_UINT32_EQ(subq->ring->job_pending, 1);
+    subq->space_waiters = 1;
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_pull_n(subq, &list, 5, 0), 1);
+    UtAssert_STUB_COUNT(bplib_os_mutex_broadcast_and_unlock, 2);
+    UtAssert_ZERO(subq->ring->job_pending);
+    subq->space_waiters = 0;
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &node[2]);
+    bplib_mpool_extract_node(&node[2]);
+
+    UT_SetHandlerFunction(UT_KEY(bplib_os_mutex_wait_until_ms), NULL, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_mutex_wait_until_ms), BP_TIMEOUT);
+    UtAssert_NULL(bplib_mpool_flow_try_pull(subq, 100));
+    UtAssert_STUB_COUNT(bplib_os_mutex_wait_until_ms, 2);
+    UtAssert_ZERO(subq->fill_waiters);
+
+    /* a disabled ring keeps its entries until the consumer pulls them, then drops them */
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_primary, 0);
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &buf.blk[1].header.base_link, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_flow_disable(subq), 1);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&subq->base_subq), 1);
+    UtAssert_ZERO(subq->ring->job_pending);
+    UtAssert_ZERO(bplib_mpool_flow_try_pull_n(subq, &list, 5, 0));
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&subq->base_subq));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 1);
+
+    /* detaching gives back the storage and anything left in the ring */
+    UtAssert_VOIDCALL(bplib_mpool_flow_enable(subq, 2));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[0], 0));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_ring_detach_all(&admin->recycle_blocks, subq), 2);
+    UtAssert_NULL(subq->ring);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&subq->base_subq));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 3);
+    UtAssert_ZERO(bplib_mpool_subq_ring_detach_all(&admin->recycle_blocks, subq));
+}
+
+void test_bplib_mpool_flow_attach_bands(void)
+{
+    /* Test function for:
+     * int bplib_mpool_flow_attach_bands(bplib_mpool_subq_workitem_t *subq, uint32_t dequeue_mode, uint32_t num_bands,
+     *      const bplib_mpool_subq_band_config_t *config)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_subq_workitem_t       *subq;
+    bplib_mpool_subq_band_config_t     config[2];
+    bplib_mpool_block_t                node;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    test_make_singleton_link(NULL, &node);
+    subq = &buf.blk[2].u.flow.fblock.egress;
+
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_STRICT, 0, NULL), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_STRICT,
+                                                    BPLIB_MPOOL_SUBQ_MAX_BANDS + 1, NULL),
+                      BP_ERROR);
+
+    /* no block available for the bands */
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_STRICT, 2, NULL), BP_ERROR);
+
+    /* the queue is not empty, so the block is given back */
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    admin = bplib_mpool_get_admin(&buf.pool);
+    bplib_mpool_subq_push_single(&subq->base_subq, &node);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_STRICT, 2, NULL), BP_ERROR);
+    UtAssert_NULL(subq->bands);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_subq_pull_single(&subq->base_subq), &node);
+
+    /* a weight of 0 is raised to 1 */
+    config[0].depth_limit = 10;
+    config[0].weight      = 3;
+    config[1].depth_limit = 1;
+    config[1].weight      = 0;
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_WEIGHTED, 2, config), BP_SUCCESS);
+    UtAssert_NOT_NULL(subq->bands);
+    UtAssert_ADDRESS_EQ(subq->bands->storage_block, &buf.blk[0].header.base_link);
+    UtAssert_UINT32_EQ(subq->bands->num_bands, 2);
+    UtAssert_UINT32_EQ(subq->bands->band[0].depth_limit, 10);
+    UtAssert_UINT32_EQ(subq->bands->band[0].weight, 3);
+    UtAssert_UINT32_EQ(subq->bands->band[1].depth_limit, 1);
+    UtAssert_UINT32_EQ(subq->bands->band[1].weight, 1);
+    UtAssert_UINT32_EQ(subq->bands->curr_band, 1);
+    UtAssert_UINT32_EQ(subq->bands->curr_credit, 1);
+
+    /* the defaults have no extra limit, and double the weight for each band up */
+    memset(&buf, 0, sizeof(buf));
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_STRICT, 3, NULL), BP_SUCCESS);
+    UtAssert_UINT32_EQ(subq->bands->band[0].depth_limit, BP_MPOOL_MAX_SUBQ_DEPTH);
+    UtAssert_UINT32_EQ(subq->bands->band[0].weight, 1);
+    UtAssert_UINT32_EQ(subq->bands->band[2].weight, 4);
+}
+
+void test_bplib_mpool_flow_bands(void)
+{
+    /* Test function for the priority band handling of:
+     * bplib_mpool_flow_try_push(), bplib_mpool_flow_try_push_n(), bplib_mpool_flow_try_pull_n() and
+     * bplib_mpool_flow_disable(), plus
+     * int bplib_mpool_flow_query_band(bplib_mpool_subq_workitem_t *subq, uint32_t band,
+     *      bplib_mpool_subq_band_stats_t *stats)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_content_t        pri[4];
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_subq_workitem_t       *subq;
+    bplib_mpool_subq_band_config_t     config[2];
+    bplib_mpool_subq_band_stats_t      stats;
+    bplib_mpool_block_t                list;
+    int                                i;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_allocation(&buf.pool, &buf.blk[0], &buf.blk[1]);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    admin = bplib_mpool_get_admin(&buf.pool);
+    subq  = &buf.blk[2].u.flow.fblock.egress;
+    bplib_mpool_init_list_head(NULL, &list);
+    for (i = 0; i < 4; ++i)
+    {
+        test_setup_mpblock(NULL, &pri[i], bplib_mpool_blocktype_primary, 0);
+        pri[i].u.primary.pblock.data.delivery.class_of_service = i;
+    }
+
+    config[0].depth_limit = BP_MPOOL_MAX_SUBQ_DEPTH;
+    config[0].weight      = 1;
+    config[1].depth_limit = 1;
+    config[1].weight      = 1;
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_bands(subq, BPLIB_MPOOL_BANDS_DEQUEUE_STRICT, 2, config), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_mpool_flow_query_band(subq, 2, &stats), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_mpool_flow_query_band(&buf.blk[2].u.flow.fblock.ingress, 0, &stats), BP_ERROR);
+
+    /* the upper band only holds one, but the lower band still has room */
+    UtAssert_VOIDCALL(bplib_mpool_flow_enable(subq, 3));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &pri[1].header.base_link, 0));
+    UtAssert_BOOL_FALSE(bplib_mpool_flow_try_push(subq, &pri[2].header.base_link, 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&pri[2].header.base_link));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &pri[0].header.base_link, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&subq->base_subq), 2);
+
+    /* a batch whose first entry goes to a full band does not push anything */
+    bplib_mpool_insert_before(&list, &pri[2].header.base_link);
+    bplib_mpool_insert_before(&list, &pri[3].header.base_link);
+    UtAssert_ZERO(bplib_mpool_flow_try_push_n(subq, &list, 5, 0));
+
+    /* after the upper band is pulled, only the first of the batch fits */
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_pull_n(subq, &list, 1, 0), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_prev_block(&list), &pri[1].header.base_link);
+    bplib_mpool_extract_node(&pri[1].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(subq, &list, 5, 0), 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &pri[3].header.base_link);
+
+    UtAssert_INT32_EQ(bplib_mpool_flow_query_band(subq, 1, &stats), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.push_count, 2);
+    UtAssert_UINT32_EQ(stats.pull_count, 1);
+    UtAssert_UINT32_EQ(stats.depth_limit, 1);
+    UtAssert_INT32_EQ(bplib_mpool_flow_query_band(subq, 0, &stats), BP_SUCCESS);
+    UtAssert_UINT32_EQ(stats.push_count, 1);
+    UtAssert_ZERO(stats.pull_count);
+
+    /* disabling drops the entries from every band */
+    UtAssert_UINT32_EQ(bplib_mpool_flow_disable(subq), 2);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&subq->base_subq));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 2);
+}
+
+void test_bplib_mpool_flow_bands_order(void)
+{
+    /* Test function for the dequeue order of a flow with priority bands, through:
+     * bplib_mpool_flow_try_push(), bplib_mpool_flow_try_pull(), bplib_mpool_flow_try_pull_n() and
+     * bplib_mpool_flow_try_move_all(), plus
+     * uint32_t bplib_mpool_subq_bands_detach_all(bplib_mpool_subq_base_t *subq_dst, bplib_mpool_subq_workitem_t *subq)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_content_t        pri[4];
+    bplib_mpool_subq_bands_t           bands;
+    bplib_mpool_subq_workitem_t       *subq;
+    bplib_mpool_subq_workitem_t       *other;
+    bplib_mpool_block_t                list;
+    bplib_mpool_block_admin_content_t *admin;
+    int                                i;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&bands, 0, sizeof(bands));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_generic, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_generic, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    admin = bplib_mpool_get_admin(&buf.pool);
+    subq  = &buf.blk[2].u.flow.fblock.egress;
+    other = &buf.blk[2].u.flow.fblock.ingress;
+    bplib_mpool_init_list_head(NULL, &list);
+    for (i = 0; i < 4; ++i)
+    {
+        test_setup_mpblock(NULL, &pri[i], bplib_mpool_blocktype_primary, 0);
+        pri[i].u.primary.pblock.data.delivery.class_of_service = i;
+    }
+
+    bands.storage_block = &buf.blk[0].header.base_link;
+    bands.num_bands     = 3;
+    for (i = 0; i < 3; ++i)
+    {
+        bplib_mpool_subq_init(NULL, &bands.band[i].subq);
+        bands.band[i].depth_limit = BP_MPOOL_MAX_SUBQ_DEPTH;
+        bands.band[i].weight      = 1;
+    }
+    subq->bands = &bands;
+    bplib_mpool_flow_enable(subq, 10);
+    bplib_mpool_flow_enable(other, 10);
+
+    /* strict: the highest band always goes first, the highest class shares the top band */
+    bands.dequeue_mode = BPLIB_MPOOL_BANDS_DEQUEUE_STRICT;
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &pri[0].header.base_link, 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &pri[3].header.base_link, 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &pri[1].header.base_link, 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &pri[2].header.base_link, 0));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&subq->base_subq), 4);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&bands.band[2].subq), 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &pri[3].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &pri[2].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &pri[1].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &pri[0].header.base_link);
+    UtAssert_NULL(bplib_mpool_flow_try_pull(subq, 0));
+    UtAssert_UINT32_EQ(subq->base_subq.pull_count, 4);
+
+    /* weighted: band 2 gets two entries per round, the others one, and non-bundles go in band 0 */
+    bands.dequeue_mode   = BPLIB_MPOOL_BANDS_DEQUEUE_WEIGHTED;
+    bands.band[2].weight = 2;
+    bands.curr_band      = 2;
+    bands.curr_credit    = 2;
+    bplib_mpool_insert_before(&list, &pri[0].header.base_link);
+    bplib_mpool_insert_before(&list, &pri[1].header.base_link);
+    bplib_mpool_insert_before(&list, &pri[2].header.base_link);
+    bplib_mpool_insert_before(&list, &pri[3].header.base_link);
+    bplib_mpool_insert_before(&list, &buf.blk[1].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(subq, &list, 5, 0), 5);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&bands.band[0].subq), 2);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_pull_n(subq, &list, 2, 0), 2);
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list), &pri[2].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &pri[1].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &pri[0].header.base_link);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &buf.blk[1].header.base_link);
+    UtAssert_NULL(bplib_mpool_flow_try_pull(subq, 0));
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&subq->base_subq));
+
+    /* whole queues go through the bands one entry at a time */
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_push_n(subq, &list, 5, 0), 2);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_move_all(other, subq, 0), 2);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&subq->base_subq));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&other->base_subq), 2);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_try_move_all(subq, other, 0), 2);
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&bands.band[2].subq), 2);
+
+    /* detaching gives back the storage along with anything left in the bands */
+    UtAssert_UINT32_EQ(bplib_mpool_subq_bands_detach_all(&admin->recycle_blocks, subq), 3);
+    UtAssert_NULL(subq->bands);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&subq->base_subq));
+    UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&admin->recycle_blocks), 3);
+    UtAssert_ZERO(bplib_mpool_subq_bands_detach_all(&admin->recycle_blocks, subq));
 }
 
 void test_bplib_mpool_flow_modify_flags(void)
@@ -309,8 +854,193 @@ void test_bplib_mpool_flow_modify_flags(void)
     UtAssert_BOOL_TRUE(bplib_mpool_flow_modify_flags(&buf.blk[0].header.base_link, 1, 2));
 }
 
+void test_bplib_mpool_flow_set_watermarks(void)
+{
+    /* Test function for:
+     * int bplib_mpool_flow_set_watermarks(bplib_mpool_subq_workitem_t *subq, uint32_t high_watermark,
+     *      uint32_t low_watermark)
+     */
+    UT_bplib_mpool_buf_t         buf;
+    bplib_mpool_flow_t          *flow;
+    bplib_mpool_subq_workitem_t *subq;
+    bplib_mpool_block_t          node[3];
+    int                          i;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    flow = &buf.blk[0].u.flow.fblock;
+    subq = &flow->egress;
+    for (i = 0; i < 3; ++i)
+    {
+        test_make_singleton_link(NULL, &node[i]);
+    }
+
+    UtAssert_INT32_EQ(bplib_mpool_flow_set_watermarks(subq, 2, 2), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_mpool_flow_set_watermarks(subq, 3, 1), BP_SUCCESS);
+    UtAssert_UINT32_EQ(subq->high_watermark, 3);
+    UtAssert_UINT32_EQ(subq->low_watermark, 1);
+    bplib_mpool_flow_enable(subq, 10);
+
+    /* the flag is set when the high mark is reached */
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[0], 0));
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[1], 0));
+    UtAssert_ZERO(flow->pending_state_flags);
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[2], 0));
+    UtAssert_UINT32_EQ(flow->pending_state_flags, BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH);
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_attached(&flow->statechange_job.base_job.link));
+
+    /* and only cleared when it drains to the low mark */
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &node[0]);
+    UtAssert_UINT32_EQ(flow->pending_state_flags, BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &node[1]);
+    UtAssert_ZERO(flow->pending_state_flags);
+
+    /* the ingress queue has its own flag */
+    UtAssert_INT32_EQ(bplib_mpool_flow_set_watermarks(&flow->ingress, 1, 0), BP_SUCCESS);
+    bplib_mpool_flow_enable(&flow->ingress, 10);
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(&flow->ingress, &node[0], 0));
+    UtAssert_UINT32_EQ(flow->pending_state_flags, BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH);
+    UtAssert_UINT32_EQ(bplib_mpool_flow_disable(&flow->ingress), 1);
+    UtAssert_ZERO(flow->pending_state_flags);
+
+    /* new marks apply to the current depth, and turning them off clears the flag */
+    UtAssert_INT32_EQ(bplib_mpool_flow_set_watermarks(subq, 1, 0), BP_SUCCESS);
+    UtAssert_UINT32_EQ(flow->pending_state_flags, BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH);
+    UtAssert_INT32_EQ(bplib_mpool_flow_set_watermarks(subq, 0, 0), BP_SUCCESS);
+    UtAssert_ZERO(flow->pending_state_flags);
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[1], 0));
+    UtAssert_ZERO(flow->pending_state_flags);
+}
+
+void test_bplib_mpool_flow_quota(void)
+{
+    /* Test function for:
+     * void bplib_mpool_flow_set_quota(bplib_mpool_flow_t *flow, size_t limit, bool backpressure)
+     * int bplib_mpool_flow_quota_admit(bplib_mpool_flow_t *flow, size_t size)
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_flow_t  *flow;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    flow = &buf.blk[0].u.flow.fblock;
+
+    /* no flow, or no limit */
+    UtAssert_INT32_EQ(bplib_mpool_flow_quota_admit(NULL, 100), BP_SUCCESS);
+    flow->quota.used = 1000;
+    UtAssert_INT32_EQ(bplib_mpool_flow_quota_admit(flow, 100), BP_SUCCESS);
+
+    /* up to the limit, and dropped past it */
+    UtAssert_VOIDCALL(bplib_mpool_flow_set_quota(flow, 1000, false));
+    UtAssert_UINT32_EQ(flow->quota.limit, 1000);
+    flow->quota.used = 900;
+    UtAssert_INT32_EQ(bplib_mpool_flow_quota_admit(flow, 100), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_mpool_flow_quota_admit(flow, 101), BP_ERROR);
+    UtAssert_UINT32_EQ(flow->quota.over_count, 1);
+
+    /* when already over, even a bundle of unknown size */
+    flow->quota.used = 1200;
+    UtAssert_INT32_EQ(bplib_mpool_flow_quota_admit(flow, 0), BP_ERROR);
+
+    /* or refused, so it can be tried again */
+    UtAssert_VOIDCALL(bplib_mpool_flow_set_quota(flow, 1000, true));
+    UtAssert_BOOL_TRUE(flow->quota.backpressure);
+    UtAssert_INT32_EQ(bplib_mpool_flow_quota_admit(flow, 1), BP_TIMEOUT);
+    UtAssert_UINT32_EQ(flow->quota.over_count, 3);
+}
+
+void test_bplib_mpool_flow_attach_notifier(void)
+{
+    /* Test function for:
+     * int bplib_mpool_flow_attach_notifier(bplib_mpool_subq_workitem_t *subq)
+     * void bplib_mpool_subq_detach_notifier(bplib_mpool_subq_workitem_t *subq)
+     */
+    UT_bplib_mpool_buf_t         buf;
+    bplib_mpool_subq_workitem_t *subq;
+    bplib_mpool_subq_ring_t      ring;
+    bplib_mpool_block_t          node[2];
+    int                          i;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&ring, 0, sizeof(ring));
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    subq = &buf.blk[0].u.flow.fblock.egress;
+    for (i = 0; i < 2; ++i)
+    {
+        test_make_singleton_link(NULL, &node[i]);
+    }
+
+    /* a ring cannot have one */
+    subq->ring = &ring;
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_notifier(subq), BP_ERROR);
+    UtAssert_STUB_COUNT(bplib_os_create_notifier, 0);
+    subq->ring = NULL;
+
+    /* the OS does not have notifiers */
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_notifier(subq), BP_ERROR);
+    UtAssert_BOOL_FALSE(bp_handle_is_valid(subq->notifier));
+
+    /* nominal, the queue is empty so it stays clear */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_create_notifier), 1);
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_notifier(subq), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(subq->notifier));
+    UtAssert_BOOL_FALSE(subq->notifier_set);
+    UtAssert_STUB_COUNT(bplib_os_notifier_set, 0);
+
+    /* the same one is kept if called again */
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_notifier(subq), BP_SUCCESS);
+    UtAssert_STUB_COUNT(bplib_os_create_notifier, 2);
+
+    /* set on the first push, cleared on the last pull */
+    bplib_mpool_flow_enable(subq, 10);
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[0], 0));
+    UtAssert_BOOL_TRUE(subq->notifier_set);
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[1], 0));
+    UtAssert_STUB_COUNT(bplib_os_notifier_set, 1);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &node[0]);
+    UtAssert_STUB_COUNT(bplib_os_notifier_clear, 0);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_try_pull(subq, 0), &node[1]);
+    UtAssert_BOOL_FALSE(subq->notifier_set);
+    UtAssert_STUB_COUNT(bplib_os_notifier_clear, 1);
+
+    /* attaching to a queue which is not empty sets it right away */
+    UtAssert_BOOL_TRUE(bplib_mpool_flow_try_push(subq, &node[0], 0));
+    UtAssert_STUB_COUNT(bplib_os_notifier_set, 2);
+    UtAssert_VOIDCALL(bplib_mpool_subq_detach_notifier(subq));
+    UtAssert_STUB_COUNT(bplib_os_destroy_notifier, 1);
+    UtAssert_BOOL_FALSE(bp_handle_is_valid(subq->notifier));
+    UtAssert_INT32_EQ(bplib_mpool_flow_attach_notifier(subq), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(subq->notifier_set);
+    UtAssert_STUB_COUNT(bplib_os_notifier_set, 3);
+
+    /* disabling the queue drops the entries, so it is cleared */
+    UtAssert_UINT32_EQ(bplib_mpool_flow_disable(subq), 1);
+    UtAssert_BOOL_FALSE(subq->notifier_set);
+    UtAssert_STUB_COUNT(bplib_os_notifier_clear, 2);
+
+    /* nothing to do without one */
+    UtAssert_VOIDCALL(bplib_mpool_subq_detach_notifier(subq));
+    UtAssert_VOIDCALL(bplib_mpool_subq_detach_notifier(subq));
+    UtAssert_STUB_COUNT(bplib_os_destroy_notifier, 2);
+}
+
+static bplib_mpool_flow_event_t     ut_flow_last_event;
+static bplib_mpool_subq_workitem_t *ut_flow_last_event_subq;
+
 static int ut_flow_statechange_check(void *arg, bplib_mpool_block_t *jblk)
 {
+    bplib_mpool_flow_generic_event_t *event = arg;
+
+    ut_flow_last_event = event->event_type;
+    if (event->event_type == bplib_mpool_flow_event_high_watermark ||
+        event->event_type == bplib_mpool_flow_event_low_watermark)
+    {
+        ut_flow_last_event_subq = event->watermark.subq;
+    }
+
     return 0;
 }
 
@@ -339,6 +1069,29 @@ void test_bplib_mpool_flow_event_handler(void)
     UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
     flow->pending_state_flags &= ~BPLIB_MPOOL_FLOW_FLAGS_OPER_UP;
     UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
+
+    /* the route change is reported when the flag is toggled either way */
+    flow->pending_state_flags ^= BPLIB_MPOOL_FLOW_FLAGS_ROUTES;
+    UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
+    UtAssert_INT32_EQ(ut_flow_last_event, bplib_mpool_flow_event_route_change);
+    ut_flow_last_event = bplib_mpool_flow_event_undefined;
+    flow->pending_state_flags ^= BPLIB_MPOOL_FLOW_FLAGS_ROUTES;
+    UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
+    UtAssert_INT32_EQ(ut_flow_last_event, bplib_mpool_flow_event_route_change);
+
+    /* watermark crossings are reported for the queue that crossed */
+    flow->pending_state_flags |= BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH;
+    UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
+    UtAssert_INT32_EQ(ut_flow_last_event, bplib_mpool_flow_event_high_watermark);
+    UtAssert_ADDRESS_EQ(ut_flow_last_event_subq, &flow->egress);
+    flow->pending_state_flags |= BPLIB_MPOOL_FLOW_FLAGS_INGRESS_HIGH;
+    UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
+    UtAssert_INT32_EQ(ut_flow_last_event, bplib_mpool_flow_event_high_watermark);
+    UtAssert_ADDRESS_EQ(ut_flow_last_event_subq, &flow->ingress);
+    flow->pending_state_flags &= ~BPLIB_MPOOL_FLOW_FLAGS_EGRESS_HIGH;
+    UtAssert_INT32_EQ(evhandler(NULL, &my_block.header.base_link), 0);
+    UtAssert_INT32_EQ(ut_flow_last_event, bplib_mpool_flow_event_low_watermark);
+    UtAssert_ADDRESS_EQ(ut_flow_last_event_subq, &flow->egress);
 }
 
 void TestBplibMpoolFlows_Register(void)
@@ -349,6 +1102,8 @@ void TestBplibMpoolFlows_Register(void)
     UtTest_Add(test_bplib_mpool_subq_drop_all, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_subq_drop_all");
     UtTest_Add(test_bplib_mpool_subq_pull_single, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_subq_pull_single");
+    UtTest_Add(test_bplib_mpool_subq_push_n, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_subq_push_n");
+    UtTest_Add(test_bplib_mpool_subq_pull_n, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_subq_pull_n");
     UtTest_Add(test_bplib_mpool_flow_cast, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_cast");
     UtTest_Add(test_bplib_mpool_flow_alloc, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_alloc");
     UtTest_Add(test_bplib_mpool_flow_disable, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_disable");
@@ -357,6 +1112,23 @@ void TestBplibMpoolFlows_Register(void)
     UtTest_Add(test_bplib_mpool_flow_try_move_all, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_flow_try_move_all");
     UtTest_Add(test_bplib_mpool_flow_try_pull, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_try_pull");
+    UtTest_Add(test_bplib_mpool_flow_try_push_n, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_try_push_n");
+    UtTest_Add(test_bplib_mpool_flow_try_pull_n, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_try_pull_n");
+    UtTest_Add(test_bplib_mpool_flow_attach_ring, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_attach_ring");
+    UtTest_Add(test_bplib_mpool_flow_ring, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_ring");
+    UtTest_Add(test_bplib_mpool_flow_attach_bands, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_attach_bands");
+    UtTest_Add(test_bplib_mpool_flow_bands, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_bands");
+    UtTest_Add(test_bplib_mpool_flow_bands_order, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_bands_order");
+    UtTest_Add(test_bplib_mpool_flow_set_watermarks, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_set_watermarks");
+    UtTest_Add(test_bplib_mpool_flow_quota, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_flow_quota");
+    UtTest_Add(test_bplib_mpool_flow_attach_notifier, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_flow_attach_notifier");
     UtTest_Add(test_bplib_mpool_flow_modify_flags, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_flow_modify_flags");
     UtTest_Add(test_bplib_mpool_flow_event_handler, TestBplibMpool_ResetTestEnvironment, NULL,
@@ -55,6 +55,7 @@ void test_bplib_mpool_job_init(void)
     memset(&buf, 0, sizeof(buf));
 
     UtAssert_VOIDCALL(bplib_mpool_job_init(&buf.blkh.base_link, &buf.job));
+    UtAssert_UINT32_EQ(buf.job.jobtype, bplib_mpool_jobtype_other);
 }
 
 void test_bplib_mpool_job_cast(void)
@@ -93,8 +94,16 @@ void test_bplib_mpool_job_mark_active(void)
     bplib_mpool_job_init(&buf.u.block, job);
 
     job->handler = test_bplib_mpool_callback_stub;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_monotonic_us), 1000);
     UtAssert_VOIDCALL(bplib_mpool_job_mark_active(job));
     UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&admin->active_list), job);
+    UtAssert_UINT32_EQ(job->activate_time_us, 1000);
+
+    /* marking it again keeps the time it was first marked */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_monotonic_us), 2000);
+    UtAssert_VOIDCALL(bplib_mpool_job_mark_active(job));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&admin->active_list), job);
+    UtAssert_UINT32_EQ(job->activate_time_us, 1000);
 
     job->handler = NULL;
     UtAssert_VOIDCALL(bplib_mpool_job_mark_active(job));
@@ -133,6 +142,122 @@ void test_bplib_mpool_job_get_next_active(void)
     UtAssert_NULL(bplib_mpool_job_get_next_active(&buf.pool));
 }
 
+void test_bplib_mpool_job_claim_next_active(void)
+{
+    /* Test function for:
+     * bplib_mpool_job_t *bplib_mpool_job_claim_next_active(bplib_mpool_t *pool)
+     * void bplib_mpool_job_release(bplib_mpool_job_t *job)
+     */
+    UT_bplib_mpool_buf_t               buf;
+    bplib_mpool_block_admin_content_t *admin;
+    bplib_mpool_flow_t                *flow0;
+    bplib_mpool_flow_t                *flow1;
+    bplib_mpool_job_t                 *job;
+
+    memset(&buf, 0, sizeof(buf));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_generic, 0);
+
+    admin = bplib_mpool_get_admin(&buf.pool);
+    flow0 = &buf.blk[0].u.flow.fblock;
+    flow1 = &buf.blk[1].u.flow.fblock;
+
+    flow0->ingress.job_header.handler = test_bplib_mpool_callback_stub;
+    flow0->egress.job_header.handler  = test_bplib_mpool_callback_stub;
+    flow1->ingress.job_header.handler = test_bplib_mpool_callback_stub;
+    bplib_mpool_job_mark_active_internal(&admin->active_list, &flow0->ingress.job_header);
+    bplib_mpool_job_mark_active_internal(&admin->active_list, &flow0->egress.job_header);
+    bplib_mpool_job_mark_active_internal(&admin->active_list, &flow1->ingress.job_header);
+
+    /* the second job of flow0 is skipped while the first one is claimed */
+    UtAssert_ADDRESS_EQ(bplib_mpool_job_claim_next_active(&buf.pool), &flow0->ingress.job_header);
+    UtAssert_BOOL_TRUE(flow0->jobs_running);
+    UtAssert_ADDRESS_EQ(bplib_mpool_job_claim_next_active(&buf.pool), &flow1->ingress.job_header);
+    UtAssert_BOOL_TRUE(flow1->jobs_running);
+    UtAssert_NULL(bplib_mpool_job_claim_next_active(&buf.pool));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&admin->active_list), &flow0->egress.job_header);
+
+    /* a job marked active again while running waits for the release too */
+    bplib_mpool_job_mark_active_internal(&admin->active_list, &flow1->ingress.job_header);
+    UtAssert_NULL(bplib_mpool_job_claim_next_active(&buf.pool));
+
+    UtAssert_VOIDCALL(bplib_mpool_job_release(&flow0->ingress.job_header));
+    UtAssert_BOOL_FALSE(flow0->jobs_running);
+    UtAssert_ADDRESS_EQ(bplib_mpool_job_claim_next_active(&buf.pool), &flow0->egress.job_header);
+    UtAssert_VOIDCALL(bplib_mpool_job_release(&flow0->egress.job_header));
+    UtAssert_VOIDCALL(bplib_mpool_job_release(&flow1->ingress.job_header));
+    UtAssert_ADDRESS_EQ(bplib_mpool_job_claim_next_active(&buf.pool), &flow1->ingress.job_header);
+    UtAssert_VOIDCALL(bplib_mpool_job_release(&flow1->ingress.job_header));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->active_list));
+
+    /* jobs that are not part of a flow are not held back, and something that is not a job is dropped */
+    bplib_mpool_insert_after(&admin->active_list, &buf.blk[2].header.base_link);
+    UtAssert_NULL(bplib_mpool_job_claim_next_active(&buf.pool));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->active_list));
+
+    job = bplib_mpool_generic_data_cast(&buf.blk[2].header.base_link, 0);
+    bplib_mpool_job_init(&buf.blk[2].header.base_link, job);
+    job->handler = test_bplib_mpool_callback_stub;
+    bplib_mpool_job_mark_active_internal(&admin->active_list, job);
+    UtAssert_ADDRESS_EQ(bplib_mpool_job_claim_next_active(&buf.pool), job);
+    UtAssert_VOIDCALL(bplib_mpool_job_release(job));
+}
+
+void test_bplib_mpool_job_share(void)
+{
+    /* Test function for:
+     * void bplib_mpool_job_set_quantum(bplib_mpool_job_t *job, uint32_t quantum, bool in_bytes)
+     * bool bplib_mpool_job_spend_share(bplib_mpool_job_t *job, bplib_mpool_block_t *qblk)
+     */
+
+    struct UT_job_poolbuf       buf;
+    bplib_mpool_block_content_t pblk;
+    bplib_mpool_job_t          *job;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&pblk, 0, sizeof(pblk));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+    test_setup_mpblock(&buf.pool, &buf.u.reserved_space, bplib_mpool_blocktype_generic, 0);
+    test_setup_mpblock(&buf.pool, &pblk, bplib_mpool_blocktype_primary, 0);
+    pblk.u.primary.pblock.bundle_encode_size_cache = 40;
+
+    job = &buf.u.content.job;
+    bplib_mpool_job_init(&buf.u.block, job);
+
+    /* without a quantum it is never used up */
+    UtAssert_BOOL_FALSE(bplib_mpool_job_spend_share(job, &pblk.header.base_link));
+    UtAssert_ZERO(job->deficit);
+
+    /* counted in bundles */
+    UtAssert_VOIDCALL(bplib_mpool_job_set_quantum(job, 2, false));
+    job->deficit = 2;
+    UtAssert_BOOL_FALSE(bplib_mpool_job_spend_share(job, &pblk.header.base_link));
+    UtAssert_BOOL_TRUE(bplib_mpool_job_spend_share(job, &pblk.header.base_link));
+    UtAssert_INT32_EQ(job->deficit, 0);
+
+    /* counted in bytes, the overrun is owed but only up to one quantum */
+    UtAssert_VOIDCALL(bplib_mpool_job_set_quantum(job, 100, true));
+    UtAssert_ZERO(job->deficit);
+    job->deficit = 50;
+    UtAssert_BOOL_FALSE(bplib_mpool_job_spend_share(job, &pblk.header.base_link));
+    UtAssert_INT32_EQ(job->deficit, 10);
+    UtAssert_BOOL_FALSE(bplib_mpool_job_spend_share(job, NULL));
+    UtAssert_INT32_EQ(job->deficit, 9);
+    UtAssert_BOOL_TRUE(bplib_mpool_job_spend_share(job, &pblk.header.base_link));
+    UtAssert_INT32_EQ(job->deficit, -31);
+    pblk.u.primary.pblock.bundle_encode_size_cache = 1000;
+    UtAssert_BOOL_TRUE(bplib_mpool_job_spend_share(job, &pblk.header.base_link));
+    UtAssert_INT32_EQ(job->deficit, -100);
+
+    /* a quantum that would not fit the share is kept to what does */
+    UtAssert_VOIDCALL(bplib_mpool_job_set_quantum(job, UINT32_MAX, true));
+    UtAssert_UINT32_EQ(job->quantum, INT32_MAX);
+}
+
 void test_bplib_mpool_job_run_all(void)
 {
     /* Test function for:
@@ -142,8 +267,10 @@ void test_bplib_mpool_job_run_all(void)
     struct UT_job_poolbuf              buf;
     bplib_mpool_block_admin_content_t *admin;
     bplib_mpool_job_t                 *job;
+    bplib_mpool_stats_t                stats;
 
     memset(&buf, 0, sizeof(buf));
+    memset(&stats, 0, sizeof(stats));
 
     test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
     test_setup_mpblock(&buf.pool, &buf.u.reserved_space, bplib_mpool_blocktype_generic, 0);
@@ -159,6 +286,35 @@ void test_bplib_mpool_job_run_all(void)
     UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->active_list));
     UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&job->link));
 
+    /* with stats, the wait and run times are counted by job type */
+    admin->stats = &stats;
+    job->jobtype = bplib_mpool_jobtype_cla_forward;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_monotonic_us), 500);
+    bplib_mpool_job_mark_active_internal(&admin->active_list, job);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_os_get_monotonic_us), 5500);
+    UtAssert_VOIDCALL(bplib_mpool_job_run_all(&buf.pool, NULL));
+    UtAssert_UINT32_EQ(stats.job_wait_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 2)], 1);
+    UtAssert_UINT32_EQ(stats.job_run_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_cla_forward, 0)], 1);
+
+    /* an unknown job type is counted as other */
+    job->jobtype = bplib_mpool_jobtype_max;
+    bplib_mpool_job_mark_active_internal(&admin->active_list, job);
+    UtAssert_VOIDCALL(bplib_mpool_job_run_all(&buf.pool, NULL));
+    UtAssert_UINT32_EQ(stats.job_wait_time[BPLIB_MPOOL_STAT_JOB_TIME_INDEX(bplib_mpool_jobtype_other, 0)], 1);
+    admin->stats = NULL;
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->active_list));
+    UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&job->link));
+
+    /* a job with a quantum gets its share before each run, but does not save it up */
+    bplib_mpool_job_set_quantum(job, 10, false);
+    job->deficit = -4;
+    bplib_mpool_job_mark_active_internal(&admin->active_list, job);
+    UtAssert_VOIDCALL(bplib_mpool_job_run_all(&buf.pool, NULL));
+    UtAssert_INT32_EQ(job->deficit, 6);
+    bplib_mpool_job_mark_active_internal(&admin->active_list, job);
+    UtAssert_VOIDCALL(bplib_mpool_job_run_all(&buf.pool, NULL));
+    UtAssert_INT32_EQ(job->deficit, 10);
+
     job->handler = NULL;
     bplib_mpool_insert_after(&admin->active_list, &job->link);
 
@@ -181,5 +337,8 @@ void TestBplibMpoolJob_Register(void)
                "bplib_mpool_job_mark_active");
     UtTest_Add(test_bplib_mpool_job_get_next_active, TestBplibMpool_ResetTestEnvironment, NULL,
                "bplib_mpool_job_get_next_active");
+    UtTest_Add(test_bplib_mpool_job_claim_next_active, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_job_claim_next_active");
+    UtTest_Add(test_bplib_mpool_job_share, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_job_share");
     UtTest_Add(test_bplib_mpool_job_run_all, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_job_run_all");
 }
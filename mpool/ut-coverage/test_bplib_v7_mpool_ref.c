@@ -40,7 +40,7 @@ void test_bplib_mpool_ref_create(void)
 
     test_setup_mpblock(NULL, &my_block, bplib_mpool_blocktype_generic, 0);
     UtAssert_ADDRESS_EQ(bplib_mpool_ref_create(&my_block.header.base_link), &my_block);
-    UtAssert_UINT16_EQ(my_block.header.refcount, 1);
+    UtAssert_UINT32_EQ(my_block.header.refcount, 1);
 }
 
 void test_bplib_mpool_ref_duplicate(void)
@@ -54,7 +54,12 @@ void test_bplib_mpool_ref_duplicate(void)
     my_block.header.refcount = 1;
 
     UtAssert_ADDRESS_EQ(bplib_mpool_ref_duplicate(&my_block), &my_block);
-    UtAssert_UINT16_EQ(my_block.header.refcount, 2);
+    UtAssert_UINT32_EQ(my_block.header.refcount, 2);
+
+    /* the refcount must not wrap at 16 bits */
+    my_block.header.refcount = 0xFFFF;
+    UtAssert_ADDRESS_EQ(bplib_mpool_ref_duplicate(&my_block), &my_block);
+    UtAssert_UINT32_EQ(my_block.header.refcount, 0x10000);
 }
 
 void test_bplib_mpool_ref_from_block(void)
@@ -95,7 +100,7 @@ void test_bplib_mpool_ref_release(void)
     admin = bplib_mpool_get_admin(&buf.pool);
 
     UtAssert_VOIDCALL(bplib_mpool_ref_release(&buf.blk[0]));
-    UtAssert_UINT16_EQ(buf.blk[0].header.refcount, 1);
+    UtAssert_UINT32_EQ(buf.blk[0].header.refcount, 1);
     UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&admin->recycle_blocks.block_list));
     UtAssert_BOOL_TRUE(bplib_mpool_is_link_unattached(&buf.blk[0].header.base_link));
 
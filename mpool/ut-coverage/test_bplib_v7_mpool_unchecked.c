@@ -0,0 +1,87 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "utassert.h"
+#include "utstubs.h"
+#include "uttest.h"
+
+#include "test_bplib_mpool.h"
+
+#define UT_UNCHECKED_SIGNATURE 0x5be3a7c1
+
+void test_bplib_mpool_unchecked_casts(void)
+{
+    /* Test function for:
+     * bplib_mpool_block_content_t *bplib_mpool_block_dereference_content_unchecked(bplib_mpool_block_t *cb)
+     * void *bplib_mpool_generic_data_cast_unchecked(bplib_mpool_block_t *cb, uint32_t required_magic)
+     * bplib_mpool_bblock_primary_t *bplib_mpool_bblock_primary_cast_unchecked(bplib_mpool_block_t *cb)
+     * bplib_mpool_bblock_canonical_t *bplib_mpool_bblock_canonical_cast_unchecked(bplib_mpool_block_t *cb)
+     * bplib_mpool_flow_t *bplib_mpool_flow_cast_unchecked(bplib_mpool_block_t *cb)
+     *
+     * Whether or not the checks are built in, a valid block gives the same pointer as the checked call
+     */
+    UT_bplib_mpool_buf_t        buf;
+    bplib_mpool_block_content_t gblk;
+    bplib_mpool_block_content_t rblk;
+    bplib_mpool_block_t        *pblk;
+    bplib_mpool_block_t        *cblk;
+    bplib_mpool_block_t        *fblk;
+
+    memset(&buf, 0, sizeof(buf));
+    test_setup_mpblock(&buf.pool, &buf.blk[0], bplib_mpool_blocktype_primary, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[1], bplib_mpool_blocktype_canonical, 0);
+    test_setup_mpblock(&buf.pool, &buf.blk[2], bplib_mpool_blocktype_flow, 0);
+    test_setup_mpblock(&buf.pool, &gblk, bplib_mpool_blocktype_generic, UT_UNCHECKED_SIGNATURE);
+    test_setup_mpblock(&buf.pool, &rblk, bplib_mpool_blocktype_ref, 0);
+    rblk.u.ref.pref_target = &buf.blk[0];
+
+    pblk = &buf.blk[0].header.base_link;
+    cblk = &buf.blk[1].header.base_link;
+    fblk = &buf.blk[2].header.base_link;
+
+    UtAssert_ADDRESS_EQ(bplib_mpool_block_dereference_content_unchecked(pblk), &buf.blk[0]);
+    UtAssert_ADDRESS_EQ(bplib_mpool_block_dereference_content_unchecked(pblk),
+                        bplib_mpool_block_dereference_content(pblk));
+
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_primary_cast_unchecked(pblk), &buf.blk[0].u.primary.pblock);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_primary_cast_unchecked(pblk), bplib_mpool_bblock_primary_cast(pblk));
+
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_canonical_cast_unchecked(cblk), &buf.blk[1].u.canonical.cblock);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_canonical_cast_unchecked(cblk), bplib_mpool_bblock_canonical_cast(cblk));
+
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_cast_unchecked(fblk), &buf.blk[2].u.flow.fblock);
+    UtAssert_ADDRESS_EQ(bplib_mpool_flow_cast_unchecked(fblk), bplib_mpool_flow_cast(fblk));
+
+    UtAssert_NOT_NULL(bplib_mpool_generic_data_cast_unchecked(&gblk.header.base_link, UT_UNCHECKED_SIGNATURE));
+    UtAssert_ADDRESS_EQ(bplib_mpool_generic_data_cast_unchecked(&gblk.header.base_link, UT_UNCHECKED_SIGNATURE),
+                        bplib_mpool_generic_data_cast(&gblk.header.base_link, UT_UNCHECKED_SIGNATURE));
+
+    /* a ref is followed to the block it refers to */
+    UtAssert_ADDRESS_EQ(bplib_mpool_block_dereference_content_unchecked(&rblk.header.base_link), &buf.blk[0]);
+    UtAssert_ADDRESS_EQ(bplib_mpool_bblock_primary_cast_unchecked(&rblk.header.base_link),
+                        bplib_mpool_bblock_primary_cast(&rblk.header.base_link));
+}
+
+void TestBplibMpoolUnchecked_Register(void)
+{
+    UtTest_Add(test_bplib_mpool_unchecked_casts, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_unchecked_casts");
+}
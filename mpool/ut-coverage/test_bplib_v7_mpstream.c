@@ -30,7 +30,7 @@ static void test_setup_append_mps_block(bplib_mpool_t *pool, bplib_mpool_stream_
                                         uint8_t byte_val, size_t amount)
 {
     test_setup_mpblock(pool, b, bplib_mpool_blocktype_generic, MPOOL_CACHE_CBOR_DATA_SIGNATURE);
-    b->header.user_content_length = amount;
+    b->header.base_link.user_content_length = amount;
     memset(&b->u, byte_val, amount);
     bplib_mpool_insert_before(&mps->head, &b->header.base_link);
 }
@@ -98,6 +98,154 @@ void test_bplib_mpool_stream_read(void)
     UtAssert_ZERO(bplib_mpool_stream_read(&mps, data, sizeof(data)));
 }
 
+void test_bplib_mpool_stream_read_list(void)
+{
+    /* Test function for:
+     * void bplib_mpool_stream_read_list(bplib_mpool_stream_t *mps, bplib_mpool_block_t *list);
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_stream_t mps;
+    bplib_mpool_stream_t list_mps;
+    uint8_t              data[BP_MPOOL_MIN_USER_BLOCK_SIZE];
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&data, 0, sizeof(data));
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+
+    /* the list is set up on its own stream, so it is not the one being read */
+    UtAssert_VOIDCALL(bplib_mpool_start_stream_init(&list_mps, &buf.pool, bplib_mpool_stream_dir_read));
+    test_setup_append_mps_block(&buf.pool, &list_mps, &buf.blk[0], 0xAA, sizeof(data) / 2);
+    test_setup_append_mps_block(&buf.pool, &list_mps, &buf.blk[1], 0xBB, sizeof(data) / 2);
+
+    UtAssert_VOIDCALL(bplib_mpool_start_stream_init(&mps, &buf.pool, bplib_mpool_stream_dir_read));
+    UtAssert_VOIDCALL(bplib_mpool_stream_read_list(&mps, &list_mps.head));
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read(&mps, data, sizeof(data) / 4), sizeof(data) / 4);
+    UtAssert_UINT32_EQ(data[0], 0xAA);
+
+    /* rewinds, even partway through */
+    UtAssert_VOIDCALL(bplib_mpool_stream_read_list(&mps, &list_mps.head));
+    UtAssert_ZERO(bplib_mpool_stream_tell(&mps));
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read(&mps, data, sizeof(data) + 1), sizeof(data));
+    UtAssert_UINT32_EQ(data[sizeof(data) - 1], 0xBB);
+    UtAssert_ZERO(bplib_mpool_stream_read(&mps, data, sizeof(data)));
+
+    /* the blocks still belong to the list */
+    UtAssert_BOOL_TRUE(bplib_mpool_is_empty_list_head(&mps.head));
+    UtAssert_ADDRESS_EQ(bplib_mpool_get_next_block(&list_mps.head), &buf.blk[0].header.base_link);
+}
+
+void test_bplib_mpool_stream_read_iov(void)
+{
+    /* Test function for:
+     * size_t bplib_mpool_stream_read_iov(bplib_mpool_stream_t *mps, bplib_iovec_t *iov, size_t *iov_count, size_t
+     * size);
+     */
+    UT_bplib_mpool_buf_t buf;
+    bplib_mpool_stream_t mps;
+    bplib_iovec_t        iov[3];
+    size_t               iov_count;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(iov, 0, sizeof(iov));
+
+    /* not a read stream */
+    iov_count = 3;
+    UtAssert_VOIDCALL(bplib_mpool_start_stream_init(&mps, NULL, bplib_mpool_stream_dir_undefined));
+    UtAssert_ZERO(bplib_mpool_stream_read_iov(&mps, iov, &iov_count, 100));
+    UtAssert_ZERO(iov_count);
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+
+    UtAssert_VOIDCALL(bplib_mpool_start_stream_init(&mps, &buf.pool, bplib_mpool_stream_dir_read));
+    test_setup_append_mps_block(&buf.pool, &mps, &buf.blk[0], 0xAA, 10);
+    test_setup_append_mps_block(&buf.pool, &mps, &buf.blk[1], 0xBB, 0);
+    test_setup_append_mps_block(&buf.pool, &mps, &buf.blk[2], 0xCC, 20);
+
+    /* the spans point into the blocks, the empty one gets no entry */
+    iov_count = 3;
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read_iov(&mps, iov, &iov_count, 4), 4);
+    UtAssert_UINT32_EQ(iov_count, 1);
+    UtAssert_ADDRESS_EQ(iov[0].base, &buf.blk[0].u);
+    UtAssert_UINT32_EQ(iov[0].len, 4);
+
+    iov_count = 3;
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read_iov(&mps, iov, &iov_count, 16), 16);
+    UtAssert_UINT32_EQ(iov_count, 2);
+    UtAssert_ADDRESS_EQ(iov[0].base, (uint8_t *)&buf.blk[0].u + 4);
+    UtAssert_UINT32_EQ(iov[0].len, 6);
+    UtAssert_ADDRESS_EQ(iov[1].base, &buf.blk[2].u);
+    UtAssert_UINT32_EQ(iov[1].len, 10);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_tell(&mps), 20);
+
+    /* out of entries */
+    iov_count = 0;
+    UtAssert_ZERO(bplib_mpool_stream_read_iov(&mps, iov, &iov_count, 16));
+
+    /* end of the stream */
+    iov_count = 3;
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read_iov(&mps, iov, &iov_count, 16), 10);
+    UtAssert_UINT32_EQ(iov_count, 1);
+    UtAssert_ZERO(bplib_mpool_stream_read_iov(&mps, iov, &iov_count, 16));
+    UtAssert_ZERO(iov_count);
+}
+
+void test_bplib_mpool_stream_set_index(void)
+{
+    /* Test function for:
+     * void bplib_mpool_stream_set_index(bplib_mpool_stream_t *mps, bplib_mpool_stream_index_entry_t *entries,
+     * size_t max_entries);
+     */
+    UT_bplib_mpool_buf_t             buf;
+    bplib_mpool_stream_t             mps;
+    bplib_mpool_stream_index_entry_t entries[3];
+    uint8_t                          data[4];
+
+    memset(&buf, 0, sizeof(buf));
+    memset(entries, 0, sizeof(entries));
+
+    /* write streams are not indexed */
+    UtAssert_VOIDCALL(bplib_mpool_start_stream_init(&mps, NULL, bplib_mpool_stream_dir_write));
+    UtAssert_VOIDCALL(bplib_mpool_stream_set_index(&mps, entries, 3));
+    UtAssert_ZERO(mps.index_count);
+
+    test_setup_mpblock(&buf.pool, &buf.pool.admin_block, bplib_mpool_blocktype_admin, 0);
+
+    UtAssert_VOIDCALL(bplib_mpool_start_stream_init(&mps, &buf.pool, bplib_mpool_stream_dir_read));
+    test_setup_append_mps_block(&buf.pool, &mps, &buf.blk[0], 0xAA, 10);
+    test_setup_append_mps_block(&buf.pool, &mps, &buf.blk[1], 0xBB, 10);
+    test_setup_append_mps_block(&buf.pool, &mps, &buf.blk[2], 0xCC, 10);
+
+    /* the index is built from the start, wherever the stream was */
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read(&mps, data, 1), 1);
+    UtAssert_VOIDCALL(bplib_mpool_stream_set_index(&mps, entries, 3));
+    UtAssert_UINT32_EQ(mps.index_count, 3);
+    UtAssert_ZERO(bplib_mpool_stream_tell(&mps));
+    UtAssert_ADDRESS_EQ(entries[2].blk, &buf.blk[2].header.base_link);
+    UtAssert_UINT32_EQ(entries[2].position, 20);
+
+    /* seeks go straight to the block, either way */
+    UtAssert_UINT32_EQ(bplib_mpool_stream_seek(&mps, 25), 25);
+    UtAssert_ADDRESS_EQ(mps.last_eblk, &buf.blk[2].header.base_link);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read(&mps, data, 1), 1);
+    UtAssert_UINT32_EQ(data[0], 0xCC);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_seek(&mps, 12), 12);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read(&mps, data, 1), 1);
+    UtAssert_UINT32_EQ(data[0], 0xBB);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_seek(&mps, 100), 30);
+
+    /* only part of the stream is indexed, the rest is walked */
+    UtAssert_VOIDCALL(bplib_mpool_stream_set_index(&mps, entries, 1));
+    UtAssert_UINT32_EQ(mps.index_count, 1);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_seek(&mps, 22), 22);
+    UtAssert_UINT32_EQ(bplib_mpool_stream_read(&mps, data, 1), 1);
+    UtAssert_UINT32_EQ(data[0], 0xCC);
+
+    /* another list drops it */
+    UtAssert_VOIDCALL(bplib_mpool_stream_read_list(&mps, &mps.head));
+    UtAssert_ZERO(mps.index_count);
+}
+
 void test_bplib_mpool_stream_seek(void)
 {
     /* Test function for:
@@ -173,6 +321,12 @@ void TestBplibMpoolMPStream_Register(void)
                "bplib_mpool_start_stream_init");
     UtTest_Add(test_bplib_mpool_stream_write, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_stream_write");
     UtTest_Add(test_bplib_mpool_stream_read, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_stream_read");
+    UtTest_Add(test_bplib_mpool_stream_read_list, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_stream_read_list");
+    UtTest_Add(test_bplib_mpool_stream_read_iov, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_stream_read_iov");
+    UtTest_Add(test_bplib_mpool_stream_set_index, TestBplibMpool_ResetTestEnvironment, NULL,
+               "bplib_mpool_stream_set_index");
     UtTest_Add(test_bplib_mpool_stream_seek, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_stream_seek");
     UtTest_Add(test_bplib_mpool_stream_attach, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_stream_attach");
     UtTest_Add(test_bplib_mpool_stream_close, TestBplibMpool_ResetTestEnvironment, NULL, "bplib_mpool_stream_close");
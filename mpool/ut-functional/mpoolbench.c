@@ -0,0 +1,604 @@
+/************************************************************************
+ *
+ *  Benchmark of the memory pool
+ *
+ *  The parts of the pool that every bundle goes through are timed on
+ *  their own: allocating and recycling each type of block, duplicating
+ *  and releasing a reference, pushing and pulling a flow queue from one
+ *  thread up to several at once, collecting recycled blocks, and writing
+ *  and reading a stream.  The throughput of each is printed, so that
+ *  allocator and locking changes can be compared between builds on one
+ *  standard harness.  Every block, queue entry and byte is checked as it
+ *  goes, so this runs as a test too.
+ *
+ *  It is set up from the environment, which the defaults are shown for:
+ *
+ *    MPOOL_BENCH_OPS      1000000      operations for each measurement
+ *    MPOOL_BENCH_BATCH    256          blocks allocated before they are recycled
+ *    MPOOL_BENCH_THREADS  4            most threads that share one flow queue
+ *    MPOOL_BENCH_STREAM   65536        bytes written to a stream, then read back
+ *
+ *  The allocations are timed with and without a thread cache attached,
+ *  and the flow queue is timed with 1, 2, ... up to the most threads,
+ *  each pushing a block then pulling one, so the queue lock and the pool
+ *  lock it nests are contended by all of them.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7_mpool.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "v7_mpool_flows.h"
+#include "v7_mpstream.h"
+#include "benchutil.h"
+
+/* the memory pool, shared by every thread */
+#define MPOOL_BENCH_POOL_SIZE (32 * 1024 * 1024)
+
+/* limits of what can be asked for */
+#define MPOOL_BENCH_MAX_BATCH   4096
+#define MPOOL_BENCH_MAX_THREADS 16
+#define MPOOL_BENCH_MAX_STREAM  (1024 * 1024)
+
+/* the stream is written and read back until this many bytes have gone through it */
+#define MPOOL_BENCH_STREAM_TOTAL (64 * 1024 * 1024)
+
+/* the magic numbers of the generic data and flow blocks */
+#define MPOOL_BENCH_DATA_MAGIC 0x3b0c8a11
+#define MPOOL_BENCH_FLOW_MAGIC 0x3b0c8a12
+
+typedef enum mpool_bench_blocktype
+{
+    mpool_bench_blocktype_generic,
+    mpool_bench_blocktype_primary,
+    mpool_bench_blocktype_canonical,
+    mpool_bench_blocktype_cbor,
+    mpool_bench_blocktype_flow,
+    mpool_bench_blocktype_max
+} mpool_bench_blocktype_t;
+
+typedef struct mpool_bench_config
+{
+    uint32_t ops;
+    uint32_t batch;
+    uint32_t threads;
+    uint32_t stream_size;
+} mpool_bench_config_t;
+
+typedef struct mpool_bench_thread
+{
+    pthread_t            thread;
+    bplib_mpool_block_t *blk; /* the block this thread pushes, it gets some other one back */
+    uint32_t             ops;
+    uint32_t             errors;
+} mpool_bench_thread_t;
+
+static const char *const MPOOL_BENCH_BLOCKTYPE_NAMES[mpool_bench_blocktype_max] = {"generic", "primary",
+                                                                                   "canonical", "cbor", "flow"};
+
+/* the stream is read and written in pieces of each of these sizes */
+static const size_t MPOOL_BENCH_STREAM_CHUNKS[] = {16, 256, 4096};
+
+/* the numbers of recycled blocks that are collected at once */
+static const uint32_t MPOOL_BENCH_COLLECT_SIZES[] = {64, 1024, 16384};
+
+static uint8_t              mpool_bench_pool_mem[MPOOL_BENCH_POOL_SIZE];
+static bplib_mpool_t       *mpool_bench_pool;
+static mpool_bench_config_t mpool_bench_config;
+
+static bplib_mpool_block_t *mpool_bench_blocks[16384];
+static bplib_mpool_ref_t    mpool_bench_refs[MPOOL_BENCH_MAX_BATCH];
+
+static mpool_bench_thread_t mpool_bench_threads[MPOOL_BENCH_MAX_THREADS];
+static bplib_mpool_flow_t  *mpool_bench_flow;
+
+static uint8_t mpool_bench_stream_in[MPOOL_BENCH_MAX_STREAM];
+static uint8_t mpool_bench_stream_out[MPOOL_BENCH_MAX_STREAM];
+
+#define MPOOL_BENCH_NUM_STREAM_CHUNKS (sizeof(MPOOL_BENCH_STREAM_CHUNKS) / sizeof(MPOOL_BENCH_STREAM_CHUNKS[0]))
+#define MPOOL_BENCH_NUM_COLLECT_SIZES (sizeof(MPOOL_BENCH_COLLECT_SIZES) / sizeof(MPOOL_BENCH_COLLECT_SIZES[0]))
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static void mpool_bench_report(const char *test, const char *name, uint64_t count, uint64_t elapsed_ns)
+{
+    if (elapsed_ns == 0)
+    {
+        elapsed_ns = 1;
+    }
+
+    UtPrintf("%-8s %-20s %9lu ops: %12.1f ops/s %9.1f ns/op", test, name, (unsigned long)count,
+             ((double)count * 1e9) / (double)elapsed_ns, (double)elapsed_ns / (double)count);
+}
+
+static bplib_mpool_block_t *mpool_bench_alloc(mpool_bench_blocktype_t bt)
+{
+    switch (bt)
+    {
+        case mpool_bench_blocktype_generic:
+            return bplib_mpool_generic_data_alloc(mpool_bench_pool, MPOOL_BENCH_DATA_MAGIC, NULL);
+        case mpool_bench_blocktype_primary:
+            return bplib_mpool_bblock_primary_alloc(mpool_bench_pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+        case mpool_bench_blocktype_canonical:
+            return bplib_mpool_bblock_canonical_alloc(mpool_bench_pool, 0, NULL);
+        case mpool_bench_blocktype_cbor:
+            return bplib_mpool_bblock_cbor_alloc(mpool_bench_pool);
+        case mpool_bench_blocktype_flow:
+            return bplib_mpool_flow_alloc(mpool_bench_pool, MPOOL_BENCH_FLOW_MAGIC, NULL);
+        default:
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Allocates a batch of blocks, then recycles and collects them, until ops have been done.
+ * Returns the time, or 0 if an allocation failed.
+ */
+static uint64_t mpool_bench_alloc_run(mpool_bench_blocktype_t bt, uint32_t ops)
+{
+    uint64_t start_time;
+    uint32_t done;
+    uint32_t count;
+    uint32_t i;
+    bool     failed;
+
+    failed     = false;
+    start_time = bench_get_time_ns();
+
+    for (done = 0; done < ops && !failed; done += count)
+    {
+        count = mpool_bench_config.batch;
+        if (count > ops - done)
+        {
+            count = ops - done;
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            mpool_bench_blocks[i] = mpool_bench_alloc(bt);
+            if (mpool_bench_blocks[i] == NULL)
+            {
+                failed = true;
+                break;
+            }
+        }
+
+        count = i;
+        for (i = 0; i < count; ++i)
+        {
+            bplib_mpool_recycle_block(mpool_bench_blocks[i]);
+        }
+
+        bplib_mpool_collect_blocks(mpool_bench_pool, UINT32_MAX);
+    }
+
+    if (failed)
+    {
+        return 0;
+    }
+
+    return bench_get_time_ns() - start_time;
+}
+
+/* Each thread pushes its block and pulls one back, which is never empty, see usage */
+static void *mpool_bench_flow_entry(void *arg)
+{
+    mpool_bench_thread_t *t = arg;
+    uint32_t              i;
+
+    for (i = 0; i < t->ops; ++i)
+    {
+        if (!bplib_mpool_flow_try_push(&mpool_bench_flow->ingress, t->blk, 0))
+        {
+            ++t->errors;
+            break;
+        }
+
+        /*
+         * Every thread pulls only after it pushes, so the queue has at least one entry
+         * for each thread that is between the two, and a pull never finds it empty.
+         */
+        t->blk = bplib_mpool_flow_try_pull(&mpool_bench_flow->ingress, 0);
+        if (t->blk == NULL)
+        {
+            ++t->errors;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void mpool_bench_setup(void)
+{
+    static const bplib_mpool_blocktype_api_t data_api = {.construct = NULL, .destruct = NULL};
+
+    if (mpool_bench_pool == NULL)
+    {
+        UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+        UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+        mpool_bench_pool = bplib_mpool_create(mpool_bench_pool_mem, sizeof(mpool_bench_pool_mem));
+        UtAssert_NOT_NULL(mpool_bench_pool);
+        UtAssert_INT32_EQ(bplib_mpool_register_blocktype(mpool_bench_pool, MPOOL_BENCH_DATA_MAGIC, &data_api, 64),
+                          BP_SUCCESS);
+        UtAssert_INT32_EQ(bplib_mpool_register_blocktype(mpool_bench_pool, MPOOL_BENCH_FLOW_MAGIC, &data_api, 0),
+                          BP_SUCCESS);
+    }
+
+    mpool_bench_config.ops         = bench_getenv_num("MPOOL_BENCH_OPS", 1000000);
+    mpool_bench_config.batch       = bench_getenv_num("MPOOL_BENCH_BATCH", 256);
+    mpool_bench_config.threads     = bench_getenv_num("MPOOL_BENCH_THREADS", 4);
+    mpool_bench_config.stream_size = bench_getenv_num("MPOOL_BENCH_STREAM", 65536);
+
+    if (mpool_bench_config.ops < 1)
+    {
+        mpool_bench_config.ops = 1;
+    }
+    if (mpool_bench_config.batch < 1 || mpool_bench_config.batch > MPOOL_BENCH_MAX_BATCH)
+    {
+        mpool_bench_config.batch = 256;
+    }
+    if (mpool_bench_config.threads < 1 || mpool_bench_config.threads > MPOOL_BENCH_MAX_THREADS)
+    {
+        mpool_bench_config.threads = 4;
+    }
+    if (mpool_bench_config.stream_size < 1 || mpool_bench_config.stream_size > MPOOL_BENCH_MAX_STREAM)
+    {
+        mpool_bench_config.stream_size = 65536;
+    }
+}
+
+void mpool_bench_run_alloc(void)
+{
+    mpool_bench_blocktype_t bt;
+    uint64_t                elapsed_ns;
+    char                    name[32];
+    int                     cached;
+
+    /* the same again with the blocks coming from a cache private to the thread */
+    for (cached = 0; cached < 2; ++cached)
+    {
+        if (cached)
+        {
+            bplib_mpool_thread_cache_attach(mpool_bench_pool);
+        }
+
+        for (bt = 0; bt < mpool_bench_blocktype_max; ++bt)
+        {
+            snprintf(name, sizeof(name), "%s%s", MPOOL_BENCH_BLOCKTYPE_NAMES[bt], cached ? "/cached" : "");
+
+            elapsed_ns = mpool_bench_alloc_run(bt, mpool_bench_config.ops);
+            UtAssert_True(elapsed_ns != 0, "%s: every block allocated", name);
+            if (elapsed_ns != 0)
+            {
+                mpool_bench_report("alloc", name, mpool_bench_config.ops, elapsed_ns);
+            }
+        }
+
+        if (cached)
+        {
+            bplib_mpool_thread_cache_detach();
+        }
+    }
+
+    UtAssert_ZERO(bplib_mpool_query_collect_backlog(mpool_bench_pool));
+}
+
+void mpool_bench_run_ref(void)
+{
+    bplib_mpool_block_t *blk;
+    bplib_mpool_ref_t    ref;
+    uint64_t             start_time;
+    uint32_t             done;
+    uint32_t             count;
+    uint32_t             i;
+
+    blk = bplib_mpool_generic_data_alloc(mpool_bench_pool, MPOOL_BENCH_DATA_MAGIC, NULL);
+    UtAssert_NOT_NULL(blk);
+    ref = bplib_mpool_ref_create(blk);
+    UtAssert_NOT_NULL(ref);
+    if (ref == NULL)
+    {
+        return;
+    }
+
+    /* one at a time, so the count only ever goes between 1 and 2 */
+    start_time = bench_get_time_ns();
+    for (done = 0; done < mpool_bench_config.ops; ++done)
+    {
+        bplib_mpool_ref_release(bplib_mpool_ref_duplicate(ref));
+    }
+    mpool_bench_report("ref", "duplicate+release", done, bench_get_time_ns() - start_time);
+
+    /* a batch of duplicates held at once, as when a bundle is queued to several places */
+    start_time = bench_get_time_ns();
+    for (done = 0; done < mpool_bench_config.ops; done += count)
+    {
+        count = mpool_bench_config.batch;
+        if (count > mpool_bench_config.ops - done)
+        {
+            count = mpool_bench_config.ops - done;
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            mpool_bench_refs[i] = bplib_mpool_ref_duplicate(ref);
+        }
+        for (i = 0; i < count; ++i)
+        {
+            bplib_mpool_ref_release(mpool_bench_refs[i]);
+        }
+    }
+    mpool_bench_report("ref", "duplicate+release/n", done, bench_get_time_ns() - start_time);
+
+    UtAssert_UINT32_EQ(bplib_mpool_read_refcount(blk), 1);
+
+    bplib_mpool_ref_release(ref);
+    bplib_mpool_collect_blocks(mpool_bench_pool, UINT32_MAX);
+}
+
+void mpool_bench_run_flow(void)
+{
+    bplib_mpool_block_t  *fblk;
+    mpool_bench_thread_t *t;
+    uint64_t              start_time;
+    uint64_t              elapsed_ns;
+    uint32_t              num_threads;
+    uint32_t              errors;
+    uint32_t              i;
+    char                  name[32];
+
+    fblk             = bplib_mpool_flow_alloc(mpool_bench_pool, MPOOL_BENCH_FLOW_MAGIC, NULL);
+    mpool_bench_flow = bplib_mpool_flow_cast(fblk);
+    UtAssert_NOT_NULL(mpool_bench_flow);
+    if (mpool_bench_flow == NULL)
+    {
+        return;
+    }
+
+    bplib_mpool_flow_enable(&mpool_bench_flow->ingress, MPOOL_BENCH_MAX_THREADS);
+
+    for (num_threads = 1; num_threads <= mpool_bench_config.threads; ++num_threads)
+    {
+        memset(mpool_bench_threads, 0, sizeof(mpool_bench_threads));
+        for (i = 0; i < num_threads; ++i)
+        {
+            t      = &mpool_bench_threads[i];
+            t->ops = mpool_bench_config.ops / num_threads;
+            t->blk = bplib_mpool_generic_data_alloc(mpool_bench_pool, MPOOL_BENCH_DATA_MAGIC, NULL);
+            UtAssert_NOT_NULL(t->blk);
+        }
+
+        /* the whole amount of work is split between the threads, so the rate shows what contention costs */
+        start_time = bench_get_time_ns();
+        for (i = 0; i < num_threads; ++i)
+        {
+            t = &mpool_bench_threads[i];
+            if (t->blk == NULL || pthread_create(&t->thread, NULL, mpool_bench_flow_entry, t) != 0)
+            {
+                UtAssert_Failed("flow: could not start thread %lu", (unsigned long)i);
+                t->ops = 0;
+            }
+        }
+
+        errors = 0;
+        for (i = 0; i < num_threads; ++i)
+        {
+            t = &mpool_bench_threads[i];
+            if (t->ops != 0)
+            {
+                pthread_join(t->thread, NULL);
+            }
+            errors += t->errors;
+        }
+        elapsed_ns = bench_get_time_ns() - start_time;
+
+        snprintf(name, sizeof(name), "push+pull/%lu", (unsigned long)num_threads);
+        UtAssert_True(errors == 0, "%s: %lu pushes or pulls failed", name, (unsigned long)errors);
+        UtAssert_UINT32_EQ(bplib_mpool_subq_get_depth(&mpool_bench_flow->ingress.base_subq), 0);
+        mpool_bench_report("flow", name, (uint64_t)(mpool_bench_config.ops / num_threads) * num_threads,
+                           elapsed_ns);
+
+        for (i = 0; i < num_threads; ++i)
+        {
+            if (mpool_bench_threads[i].blk != NULL)
+            {
+                bplib_mpool_recycle_block(mpool_bench_threads[i].blk);
+            }
+        }
+        bplib_mpool_collect_blocks(mpool_bench_pool, UINT32_MAX);
+    }
+
+    bplib_mpool_flow_disable(&mpool_bench_flow->ingress);
+    bplib_mpool_recycle_block(fblk);
+    bplib_mpool_collect_blocks(mpool_bench_pool, UINT32_MAX);
+    mpool_bench_flow = NULL;
+}
+
+void mpool_bench_run_collect(void)
+{
+    uint64_t start_time;
+    uint64_t elapsed_ns;
+    uint64_t collected;
+    uint32_t size;
+    uint32_t done;
+    uint32_t count;
+    uint32_t s;
+    uint32_t i;
+    char     name[32];
+
+    for (s = 0; s < MPOOL_BENCH_NUM_COLLECT_SIZES; ++s)
+    {
+        size = MPOOL_BENCH_COLLECT_SIZES[s];
+
+        /* only the collection is timed, not the allocation and recycling of what it collects */
+        elapsed_ns = 0;
+        collected  = 0;
+        count      = 0;
+        for (done = 0; done < mpool_bench_config.ops; done += count)
+        {
+            for (count = 0; count < size; ++count)
+            {
+                mpool_bench_blocks[count] =
+                    bplib_mpool_generic_data_alloc(mpool_bench_pool, MPOOL_BENCH_DATA_MAGIC, NULL);
+                if (mpool_bench_blocks[count] == NULL)
+                {
+                    break;
+                }
+            }
+            for (i = 0; i < count; ++i)
+            {
+                bplib_mpool_recycle_block(mpool_bench_blocks[i]);
+            }
+
+            start_time = bench_get_time_ns();
+            collected += bplib_mpool_collect_blocks(mpool_bench_pool, UINT32_MAX);
+            elapsed_ns += bench_get_time_ns() - start_time;
+
+            if (count < size)
+            {
+                break;
+            }
+        }
+
+        snprintf(name, sizeof(name), "blocks/%lu", (unsigned long)size);
+        UtAssert_True(count == size, "%s: every block allocated", name);
+        UtAssert_True(collected >= done, "%s: %lu of %lu blocks collected", name, (unsigned long)collected,
+                      (unsigned long)done);
+        mpool_bench_report("collect", name, collected, elapsed_ns);
+    }
+}
+
+void mpool_bench_run_stream(void)
+{
+    bplib_mpool_stream_t wr;
+    bplib_mpool_stream_t rd;
+    uint64_t             write_ns;
+    uint64_t             read_ns;
+    uint64_t             start_time;
+    uint32_t             reps;
+    uint32_t             r;
+    uint32_t             c;
+    size_t               chunk;
+    size_t               pos;
+    size_t               len;
+    size_t               written;
+    size_t               got;
+    char                 name[32];
+    bool                 match;
+
+    for (pos = 0; pos < mpool_bench_config.stream_size; ++pos)
+    {
+        mpool_bench_stream_in[pos] = (uint8_t)((pos * 7) ^ (pos >> 8));
+    }
+
+    reps = MPOOL_BENCH_STREAM_TOTAL / mpool_bench_config.stream_size;
+    if (reps < 1)
+    {
+        reps = 1;
+    }
+
+    for (c = 0; c < MPOOL_BENCH_NUM_STREAM_CHUNKS; ++c)
+    {
+        chunk    = MPOOL_BENCH_STREAM_CHUNKS[c];
+        write_ns = 0;
+        read_ns  = 0;
+        match    = true;
+
+        for (r = 0; r < reps && match; ++r)
+        {
+            bplib_mpool_start_stream_init(&wr, mpool_bench_pool, bplib_mpool_stream_dir_write);
+            bplib_mpool_start_stream_init(&rd, mpool_bench_pool, bplib_mpool_stream_dir_read);
+
+            start_time = bench_get_time_ns();
+            written    = 0;
+            for (pos = 0; pos < mpool_bench_config.stream_size; pos += len)
+            {
+                len = mpool_bench_config.stream_size - pos;
+                if (len > chunk)
+                {
+                    len = chunk;
+                }
+                written += bplib_mpool_stream_write(&wr, &mpool_bench_stream_in[pos], len);
+            }
+            write_ns += bench_get_time_ns() - start_time;
+
+            /* the written blocks are read where they are, as the list stays with the write stream */
+            start_time = bench_get_time_ns();
+            bplib_mpool_stream_read_list(&rd, &wr.head);
+            got = 0;
+            for (pos = 0; pos < mpool_bench_config.stream_size; pos += len)
+            {
+                len = mpool_bench_config.stream_size - pos;
+                if (len > chunk)
+                {
+                    len = chunk;
+                }
+                got += bplib_mpool_stream_read(&rd, &mpool_bench_stream_out[pos], len);
+            }
+            read_ns += bench_get_time_ns() - start_time;
+
+            match = (written == mpool_bench_config.stream_size && got == written &&
+                     memcmp(mpool_bench_stream_in, mpool_bench_stream_out, got) == 0);
+
+            bplib_mpool_stream_close(&rd);
+            bplib_mpool_stream_close(&wr);
+            bplib_mpool_collect_blocks(mpool_bench_pool, UINT32_MAX);
+        }
+
+        snprintf(name, sizeof(name), "%lu bytes/chunk", (unsigned long)chunk);
+        UtAssert_True(match, "stream: %s read back the same", name);
+        if (write_ns == 0)
+        {
+            write_ns = 1;
+        }
+        if (read_ns == 0)
+        {
+            read_ns = 1;
+        }
+
+        /* bytes per microsecond is MB/s */
+        UtPrintf("%-8s %-20s %9lu reps: %9.1f MB/s write %9.1f MB/s read", "stream", name, (unsigned long)r,
+                 ((double)r * mpool_bench_config.stream_size * 1000.0) / (double)write_ns,
+                 ((double)r * mpool_bench_config.stream_size * 1000.0) / (double)read_ns);
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(mpool_bench_run_alloc, mpool_bench_setup, NULL, "alloc");
+    UtTest_Add(mpool_bench_run_ref, mpool_bench_setup, NULL, "ref");
+    UtTest_Add(mpool_bench_run_flow, mpool_bench_setup, NULL, "flow");
+    UtTest_Add(mpool_bench_run_collect, mpool_bench_setup, NULL, "collect");
+    UtTest_Add(mpool_bench_run_stream, mpool_bench_setup, NULL, "stream");
+}
@@ -0,0 +1,307 @@
+/************************************************************************
+ *
+ *  Lock ordering test of the memory pool
+ *
+ *  Two threads use a pair of flow queues whose locks are chosen so that
+ *  a queue lock and the pool lock cannot be taken in a consistent order
+ *  if they come from the same set.  One thread moves everything from
+ *  queue B into queue A, which takes the lock of A, then the lock of B,
+ *  then the pool lock to mark A active.  The other thread pushes into B,
+ *  which takes the lock of B, then the pool lock to mark B active.  Queue
+ *  A is picked so that its lock is the one the pool address hashes to in
+ *  the resource lock set, and B so that its lock comes after it.  If the
+ *  pool were locked through that set, each thread would end up holding
+ *  the lock the other waits for.
+ *
+ *  The threads are given a time limit, and if they do not finish within
+ *  it the test fails rather than hanging.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7_mpool_internal.h"
+#include "benchutil.h"
+
+/* the memory pool, with room to move its start around */
+#define MPOOL_LOCK_TEST_POOL_SIZE (4 * 1024 * 1024)
+#define MPOOL_LOCK_TEST_POOL_SLIDE 4096
+
+/* the most flows allocated while looking for a pair of queues with the right locks */
+#define MPOOL_LOCK_TEST_MAX_FLOWS 512
+
+/* pushes by one thread, and moves by the other */
+#define MPOOL_LOCK_TEST_OPS 200000
+
+/* seconds the threads have to finish in */
+#define MPOOL_LOCK_TEST_TIME_LIMIT 30
+
+/* the magic numbers of the generic data and flow blocks */
+#define MPOOL_LOCK_TEST_DATA_MAGIC 0x3b0c8a21
+#define MPOOL_LOCK_TEST_FLOW_MAGIC 0x3b0c8a22
+
+typedef struct mpool_lock_test_thread
+{
+    pthread_t     thread;
+    uint32_t      ops;
+    volatile bool done;
+} mpool_lock_test_thread_t;
+
+static uint8_t        mpool_lock_test_pool_mem[MPOOL_LOCK_TEST_POOL_SIZE + MPOOL_LOCK_TEST_POOL_SLIDE];
+static bplib_mpool_t *mpool_lock_test_pool;
+
+static bplib_mpool_subq_workitem_t *mpool_lock_test_subq_a;
+static bplib_mpool_subq_workitem_t *mpool_lock_test_subq_b;
+
+static mpool_lock_test_thread_t mpool_lock_test_mover;
+static mpool_lock_test_thread_t mpool_lock_test_pusher;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/*
+ * Checks if some resource could map to a lock after the given one, that is, if the
+ * given lock is not the last in the set.  The locks in the set are compared by address,
+ * the same as bplib_mpool_flow_try_move_all() does.
+ */
+static bool mpool_lock_test_has_later_lock(bplib_mpool_lock_t *lock)
+{
+    size_t offset;
+
+    for (offset = 0; offset < MPOOL_LOCK_TEST_POOL_SLIDE; offset += 16)
+    {
+        if (bplib_mpool_lock_prepare(&mpool_lock_test_pool_mem[offset]) > lock)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void *mpool_lock_test_mover_entry(void *arg)
+{
+    mpool_lock_test_thread_t *t;
+    bplib_mpool_block_t       list;
+    bplib_mpool_block_t      *blk;
+    uint32_t                  i;
+
+    t = arg;
+    bplib_mpool_init_list_head(NULL, &list);
+
+    for (i = 0; i < t->ops; ++i)
+    {
+        /* this holds the lock of A and then B, and nests the pool lock */
+        bplib_mpool_flow_try_move_all(mpool_lock_test_subq_a, mpool_lock_test_subq_b, 0);
+
+        /* then A is emptied again, so it always has room */
+        bplib_mpool_flow_try_pull_n(mpool_lock_test_subq_a, &list, UINT32_MAX, 0);
+        while (true)
+        {
+            blk = bplib_mpool_get_next_block(&list);
+            if (bplib_mpool_is_list_head(blk))
+            {
+                break;
+            }
+            bplib_mpool_extract_node(blk);
+            bplib_mpool_recycle_block(blk);
+        }
+    }
+
+    t->done = true;
+    return NULL;
+}
+
+static void *mpool_lock_test_pusher_entry(void *arg)
+{
+    mpool_lock_test_thread_t *t;
+    bplib_mpool_block_t      *blk;
+    uint32_t                  i;
+
+    t = arg;
+    for (i = 0; i < t->ops; ++i)
+    {
+        blk = bplib_mpool_generic_data_alloc(mpool_lock_test_pool, MPOOL_LOCK_TEST_DATA_MAGIC, NULL);
+        if (blk == NULL)
+        {
+            /* the mover has not caught up, which is not an error */
+            bplib_mpool_collect_blocks(mpool_lock_test_pool, UINT32_MAX);
+            continue;
+        }
+
+        /* this holds the lock of B, and nests the pool lock */
+        if (!bplib_mpool_flow_try_push(mpool_lock_test_subq_b, blk, 0))
+        {
+            bplib_mpool_recycle_block(blk);
+        }
+    }
+
+    t->done = true;
+    return NULL;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void mpool_lock_test_setup(void)
+{
+    static const bplib_mpool_blocktype_api_t data_api = {.construct = NULL, .destruct = NULL};
+
+    bplib_mpool_lock_t *pool_stripe;
+    size_t              offset;
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+
+    /* the pool must not hash to the last lock in the set, or no queue lock could come after it */
+    for (offset = 0; offset < MPOOL_LOCK_TEST_POOL_SLIDE; offset += 64)
+    {
+        pool_stripe = bplib_mpool_lock_prepare(&mpool_lock_test_pool_mem[offset]);
+        if (mpool_lock_test_has_later_lock(pool_stripe))
+        {
+            break;
+        }
+    }
+    UtAssert_True(offset < MPOOL_LOCK_TEST_POOL_SLIDE, "found a pool address before the last lock");
+
+    mpool_lock_test_pool = bplib_mpool_create(&mpool_lock_test_pool_mem[offset], MPOOL_LOCK_TEST_POOL_SIZE);
+    UtAssert_NOT_NULL(mpool_lock_test_pool);
+    UtAssert_BOOL_TRUE(mpool_lock_test_has_later_lock(bplib_mpool_lock_prepare(mpool_lock_test_pool)));
+    UtAssert_INT32_EQ(bplib_mpool_register_blocktype(mpool_lock_test_pool, MPOOL_LOCK_TEST_DATA_MAGIC, &data_api, 0),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_mpool_register_blocktype(mpool_lock_test_pool, MPOOL_LOCK_TEST_FLOW_MAGIC, &data_api, 0),
+                      BP_SUCCESS);
+}
+
+void mpool_lock_test_find_queues(void)
+{
+    bplib_mpool_lock_t          *pool_stripe;
+    bplib_mpool_lock_t          *subq_lock;
+    bplib_mpool_block_t         *fblk;
+    bplib_mpool_flow_t          *flow;
+    bplib_mpool_subq_workitem_t *subq[2];
+    uint32_t                     i;
+    uint32_t                     j;
+
+    /* this is where the pool would be locked, if it were a resource like the queues */
+    pool_stripe = bplib_mpool_lock_prepare(mpool_lock_test_pool);
+
+    mpool_lock_test_subq_a = NULL;
+    mpool_lock_test_subq_b = NULL;
+    for (i = 0; i < MPOOL_LOCK_TEST_MAX_FLOWS; ++i)
+    {
+        if (mpool_lock_test_subq_a != NULL && mpool_lock_test_subq_b != NULL)
+        {
+            break;
+        }
+
+        fblk = bplib_mpool_flow_alloc(mpool_lock_test_pool, MPOOL_LOCK_TEST_FLOW_MAGIC, NULL);
+        flow = bplib_mpool_flow_cast(fblk);
+        if (flow == NULL)
+        {
+            break;
+        }
+
+        /* the flows that are not used are left allocated, so the next one is at a different address */
+        subq[0] = &flow->ingress;
+        subq[1] = &flow->egress;
+        for (j = 0; j < 2; ++j)
+        {
+            subq_lock = bplib_mpool_lock_prepare(subq[j]);
+            if (subq_lock == pool_stripe && mpool_lock_test_subq_a == NULL)
+            {
+                mpool_lock_test_subq_a = subq[j];
+                bplib_mpool_flow_enable(subq[j], MPOOL_LOCK_TEST_OPS);
+            }
+            else if (subq_lock > pool_stripe && mpool_lock_test_subq_b == NULL)
+            {
+                mpool_lock_test_subq_b = subq[j];
+                bplib_mpool_flow_enable(subq[j], MPOOL_LOCK_TEST_OPS);
+            }
+        }
+    }
+
+    UtAssert_NOT_NULL(mpool_lock_test_subq_a);
+    UtAssert_NOT_NULL(mpool_lock_test_subq_b);
+}
+
+void mpool_lock_test_move_all_push(void)
+{
+    struct timespec poll_time;
+    time_t          start_time;
+    uint32_t        waited;
+
+    /* this was already reported as a failure when looking for them */
+    if (mpool_lock_test_subq_a == NULL || mpool_lock_test_subq_b == NULL)
+    {
+        return;
+    }
+
+    memset(&mpool_lock_test_mover, 0, sizeof(mpool_lock_test_mover));
+    memset(&mpool_lock_test_pusher, 0, sizeof(mpool_lock_test_pusher));
+    mpool_lock_test_mover.ops  = MPOOL_LOCK_TEST_OPS;
+    mpool_lock_test_pusher.ops = MPOOL_LOCK_TEST_OPS;
+
+    UtAssert_ZERO(pthread_create(&mpool_lock_test_mover.thread, NULL, mpool_lock_test_mover_entry,
+                                 &mpool_lock_test_mover));
+    UtAssert_ZERO(pthread_create(&mpool_lock_test_pusher.thread, NULL, mpool_lock_test_pusher_entry,
+                                 &mpool_lock_test_pusher));
+
+    /* a thread stuck on a lock cannot be joined, so this only waits so long for them */
+    poll_time.tv_sec  = 0;
+    poll_time.tv_nsec = 10000000;
+    start_time        = time(NULL);
+    waited            = 0;
+    while (!mpool_lock_test_mover.done || !mpool_lock_test_pusher.done)
+    {
+        if ((time(NULL) - start_time) > MPOOL_LOCK_TEST_TIME_LIMIT)
+        {
+            UtAssert_Failed("move_all/push did not finish in %d seconds, the locks are deadlocked",
+                            MPOOL_LOCK_TEST_TIME_LIMIT);
+            fflush(stdout);
+            exit(EXIT_FAILURE);
+        }
+        nanosleep(&poll_time, NULL);
+        ++waited;
+    }
+
+    pthread_join(mpool_lock_test_mover.thread, NULL);
+    pthread_join(mpool_lock_test_pusher.thread, NULL);
+    UtPrintf("move_all/push finished %lu ops each after %lu polls", (unsigned long)MPOOL_LOCK_TEST_OPS,
+             (unsigned long)waited);
+
+    /* what is left in B is moved and recycled, so nothing is lost */
+    mpool_lock_test_mover.ops = 1;
+    mpool_lock_test_mover_entry(&mpool_lock_test_mover);
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&mpool_lock_test_subq_a->base_subq));
+    UtAssert_ZERO(bplib_mpool_subq_get_depth(&mpool_lock_test_subq_b->base_subq));
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(mpool_lock_test_find_queues, mpool_lock_test_setup, NULL, "find queues");
+    UtTest_Add(mpool_lock_test_move_all_push, NULL, NULL, "move_all/push");
+}
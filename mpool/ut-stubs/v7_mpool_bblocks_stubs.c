@@ -89,6 +89,41 @@ bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc(bplib_mpool_t *pool)
     return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_alloc, bplib_mpool_block_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_alloc_n()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_bblock_cbor_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, size_t total_size)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_alloc_n, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_alloc_n, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_alloc_n, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_alloc_n, size_t, total_size);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_alloc_n, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_alloc_n, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_alloc_sized()
+ * ----------------------------------------------------
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_alloc_sized(bplib_mpool_t *pool, size_t size_hint)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_alloc_sized, bplib_mpool_block_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_alloc_sized, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_alloc_sized, size_t, size_hint);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_alloc_sized, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_alloc_sized, bplib_mpool_block_t *);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_bblock_cbor_append()
@@ -118,6 +153,27 @@ void *bplib_mpool_bblock_cbor_cast(bplib_mpool_block_t *cb)
     return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_cast, void *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_crc_update()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_bblock_cbor_crc_update(bplib_mpool_block_t *list, bplib_crc_parameters_t *params,
+                                          bp_crcval_t *crc, size_t seek_start, size_t max_count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_crc_update, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_crc_update, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_crc_update, bplib_crc_parameters_t *, params);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_crc_update, bp_crcval_t *, crc);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_crc_update, size_t, seek_start);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_crc_update, size_t, max_count);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_crc_update, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_crc_update, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_bblock_cbor_export()
@@ -139,6 +195,103 @@ size_t bplib_mpool_bblock_cbor_export(bplib_mpool_block_t *list, void *out_ptr,
     return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_export, size_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_export_iov()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_bblock_cbor_export_iov(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_export_iov, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov, bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov, size_t, max_iov);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_export_iov, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_export_iov, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_export_iov_range()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_bblock_cbor_export_iov_range(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov,
+                                                size_t seek_start, size_t max_count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_export_iov_range, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov_range, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov_range, bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov_range, size_t, max_iov);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov_range, size_t, seek_start);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_export_iov_range, size_t, max_count);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_export_iov_range, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_export_iov_range, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_extern_alloc()
+ * ----------------------------------------------------
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_extern_alloc(bplib_mpool_t *pool, const void *data_ptr, size_t data_size,
+                                                          bplib_payload_release_func_t release_func,
+                                                          void                        *release_arg)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_extern_alloc, bplib_mpool_block_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_extern_alloc, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_extern_alloc, const void *, data_ptr);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_extern_alloc, size_t, data_size);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_extern_alloc, bplib_payload_release_func_t, release_func);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_extern_alloc, void *, release_arg);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_extern_alloc, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_extern_alloc, bplib_mpool_block_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_extern_init()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_bblock_cbor_extern_init(bplib_mpool_t *pool)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_extern_init, int);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_extern_init, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_extern_init, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_extern_init, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_overwrite()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_bblock_cbor_overwrite(bplib_mpool_block_t *list, const void *in_ptr, size_t seek_start,
+                                         size_t count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_overwrite, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_overwrite, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_overwrite, const void *, in_ptr);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_overwrite, size_t, seek_start);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_overwrite, size_t, count);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_overwrite, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_overwrite, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_bblock_cbor_set_size()
@@ -152,6 +305,57 @@ void bplib_mpool_bblock_cbor_set_size(bplib_mpool_block_t *cb, size_t user_conte
     UT_GenStub_Execute(bplib_mpool_bblock_cbor_set_size, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_share()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_bblock_cbor_share(bplib_mpool_block_t *dst_list, bplib_mpool_block_t *src_list)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_share, int);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_share, bplib_mpool_block_t *, dst_list);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_share, bplib_mpool_block_t *, src_list);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_share, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_share, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_slice_alloc()
+ * ----------------------------------------------------
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_cbor_slice_alloc(bplib_mpool_ref_t buffer_ref, size_t offset, size_t length)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_slice_alloc, bplib_mpool_block_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_slice_alloc, bplib_mpool_ref_t, buffer_ref);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_slice_alloc, size_t, offset);
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_slice_alloc, size_t, length);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_slice_alloc, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_slice_alloc, bplib_mpool_block_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_cbor_slice_init()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_bblock_cbor_slice_init(bplib_mpool_t *pool)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_cbor_slice_init, int);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_cbor_slice_init, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_cbor_slice_init, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_cbor_slice_init, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_bblock_primary_alloc()
@@ -202,6 +406,18 @@ bplib_mpool_bblock_primary_t *bplib_mpool_bblock_primary_cast(bplib_mpool_block_
     return UT_GenStub_GetReturnValue(bplib_mpool_bblock_primary_cast, bplib_mpool_bblock_primary_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_primary_drop_canonical_blocks()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_bblock_primary_drop_canonical_blocks(bplib_mpool_bblock_primary_t *cpb)
+{
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_drop_canonical_blocks, bplib_mpool_bblock_primary_t *, cpb);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_primary_drop_canonical_blocks, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_bblock_primary_drop_encode()
@@ -214,6 +430,23 @@ void bplib_mpool_bblock_primary_drop_encode(bplib_mpool_bblock_primary_t *cpb)
     UT_GenStub_Execute(bplib_mpool_bblock_primary_drop_encode, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_primary_get_footprint()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_bblock_primary_get_footprint(bplib_mpool_bblock_primary_t *cpb, uint32_t *block_count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_primary_get_footprint, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_get_footprint, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_get_footprint, uint32_t *, block_count);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_primary_get_footprint, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_primary_get_footprint, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_bblock_primary_locate_canonical()
@@ -231,3 +464,50 @@ bplib_mpool_block_t *bplib_mpool_bblock_primary_locate_canonical(bplib_mpool_bbl
 
     return UT_GenStub_GetReturnValue(bplib_mpool_bblock_primary_locate_canonical, bplib_mpool_block_t *);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_primary_quota_charge()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_bblock_primary_quota_charge(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t flow_ref,
+                                             size_t size)
+{
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_quota_charge, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_quota_charge, bplib_mpool_ref_t, flow_ref);
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_quota_charge, size_t, size);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_primary_quota_charge, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_primary_quota_release()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_bblock_primary_quota_release(bplib_mpool_bblock_primary_t *cpb)
+{
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_quota_release, bplib_mpool_bblock_primary_t *, cpb);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_primary_quota_release, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_bblock_primary_share_copy()
+ * ----------------------------------------------------
+ */
+bplib_mpool_block_t *bplib_mpool_bblock_primary_share_copy(bplib_mpool_t *pool, bplib_mpool_bblock_primary_t *cpb,
+                                                           uint8_t priority, uint64_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_bblock_primary_share_copy, bplib_mpool_block_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_share_copy, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_share_copy, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_share_copy, uint8_t, priority);
+    UT_GenStub_AddParam(bplib_mpool_bblock_primary_share_copy, uint64_t, timeout);
+
+    UT_GenStub_Execute(bplib_mpool_bblock_primary_share_copy, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_bblock_primary_share_copy, bplib_mpool_block_t *);
+}
@@ -45,6 +45,59 @@ bplib_mpool_block_t *bplib_mpool_flow_alloc(bplib_mpool_t *pool, uint32_t magic_
     return UT_GenStub_GetReturnValue(bplib_mpool_flow_alloc, bplib_mpool_block_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_attach_bands()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_flow_attach_bands(bplib_mpool_subq_workitem_t *subq, uint32_t dequeue_mode, uint32_t num_bands,
+                                  const bplib_mpool_subq_band_config_t *config)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_attach_bands, int);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_bands, bplib_mpool_subq_workitem_t *, subq);
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_bands, uint32_t, dequeue_mode);
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_bands, uint32_t, num_bands);
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_bands, const bplib_mpool_subq_band_config_t *, config);
+
+    UT_GenStub_Execute(bplib_mpool_flow_attach_bands, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_attach_bands, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_attach_notifier()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_flow_attach_notifier(bplib_mpool_subq_workitem_t *subq)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_attach_notifier, int);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_notifier, bplib_mpool_subq_workitem_t *, subq);
+
+    UT_GenStub_Execute(bplib_mpool_flow_attach_notifier, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_attach_notifier, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_attach_ring()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_flow_attach_ring(bplib_mpool_subq_workitem_t *subq, uint32_t ring_flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_attach_ring, int);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_ring, bplib_mpool_subq_workitem_t *, subq);
+    UT_GenStub_AddParam(bplib_mpool_flow_attach_ring, uint32_t, ring_flags);
+
+    UT_GenStub_Execute(bplib_mpool_flow_attach_ring, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_attach_ring, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_flow_cast()
@@ -108,6 +161,73 @@ bool bplib_mpool_flow_modify_flags(bplib_mpool_block_t *cb, uint32_t set_bits, u
     return UT_GenStub_GetReturnValue(bplib_mpool_flow_modify_flags, bool);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_query_band()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_flow_query_band(bplib_mpool_subq_workitem_t *subq, uint32_t band, bplib_mpool_subq_band_stats_t *stats)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_query_band, int);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_query_band, bplib_mpool_subq_workitem_t *, subq);
+    UT_GenStub_AddParam(bplib_mpool_flow_query_band, uint32_t, band);
+    UT_GenStub_AddParam(bplib_mpool_flow_query_band, bplib_mpool_subq_band_stats_t *, stats);
+
+    UT_GenStub_Execute(bplib_mpool_flow_query_band, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_query_band, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_quota_admit()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_flow_quota_admit(bplib_mpool_flow_t *flow, size_t size)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_quota_admit, int);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_quota_admit, bplib_mpool_flow_t *, flow);
+    UT_GenStub_AddParam(bplib_mpool_flow_quota_admit, size_t, size);
+
+    UT_GenStub_Execute(bplib_mpool_flow_quota_admit, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_quota_admit, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_set_quota()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_flow_set_quota(bplib_mpool_flow_t *flow, size_t limit, bool backpressure)
+{
+    UT_GenStub_AddParam(bplib_mpool_flow_set_quota, bplib_mpool_flow_t *, flow);
+    UT_GenStub_AddParam(bplib_mpool_flow_set_quota, size_t, limit);
+    UT_GenStub_AddParam(bplib_mpool_flow_set_quota, bool, backpressure);
+
+    UT_GenStub_Execute(bplib_mpool_flow_set_quota, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_set_watermarks()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_flow_set_watermarks(bplib_mpool_subq_workitem_t *subq, uint32_t high_watermark, uint32_t low_watermark)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_set_watermarks, int);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_set_watermarks, bplib_mpool_subq_workitem_t *, subq);
+    UT_GenStub_AddParam(bplib_mpool_flow_set_watermarks, uint32_t, high_watermark);
+    UT_GenStub_AddParam(bplib_mpool_flow_set_watermarks, uint32_t, low_watermark);
+
+    UT_GenStub_Execute(bplib_mpool_flow_set_watermarks, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_set_watermarks, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_flow_try_move_all()
@@ -144,6 +264,26 @@ bplib_mpool_block_t *bplib_mpool_flow_try_pull(bplib_mpool_subq_workitem_t *subq
     return UT_GenStub_GetReturnValue(bplib_mpool_flow_try_pull, bplib_mpool_block_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_try_pull_n()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_mpool_flow_try_pull_n(bplib_mpool_subq_workitem_t *subq_src, bplib_mpool_block_t *list,
+                                     uint32_t max_count, uint64_t abs_timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_try_pull_n, uint32_t);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_try_pull_n, bplib_mpool_subq_workitem_t *, subq_src);
+    UT_GenStub_AddParam(bplib_mpool_flow_try_pull_n, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_flow_try_pull_n, uint32_t, max_count);
+    UT_GenStub_AddParam(bplib_mpool_flow_try_pull_n, uint64_t, abs_timeout);
+
+    UT_GenStub_Execute(bplib_mpool_flow_try_pull_n, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_try_pull_n, uint32_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_flow_try_push()
@@ -161,3 +301,23 @@ bool bplib_mpool_flow_try_push(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpoo
 
     return UT_GenStub_GetReturnValue(bplib_mpool_flow_try_push, bool);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_flow_try_push_n()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_mpool_flow_try_push_n(bplib_mpool_subq_workitem_t *subq_dst, bplib_mpool_block_t *list,
+                                     uint32_t max_count, uint64_t abs_timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_flow_try_push_n, uint32_t);
+
+    UT_GenStub_AddParam(bplib_mpool_flow_try_push_n, bplib_mpool_subq_workitem_t *, subq_dst);
+    UT_GenStub_AddParam(bplib_mpool_flow_try_push_n, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_flow_try_push_n, uint32_t, max_count);
+    UT_GenStub_AddParam(bplib_mpool_flow_try_push_n, uint64_t, abs_timeout);
+
+    UT_GenStub_Execute(bplib_mpool_flow_try_push_n, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_flow_try_push_n, uint32_t);
+}
@@ -43,6 +43,22 @@ bplib_mpool_job_t *bplib_mpool_job_cast(bplib_mpool_block_t *cb)
     return UT_GenStub_GetReturnValue(bplib_mpool_job_cast, bplib_mpool_job_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_job_claim_next_active()
+ * ----------------------------------------------------
+ */
+bplib_mpool_job_t *bplib_mpool_job_claim_next_active(bplib_mpool_t *pool)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_job_claim_next_active, bplib_mpool_job_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_job_claim_next_active, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_job_claim_next_active, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_job_claim_next_active, bplib_mpool_job_t *);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_job_get_next_active()
@@ -84,6 +100,18 @@ void bplib_mpool_job_mark_active(bplib_mpool_job_t *job)
     UT_GenStub_Execute(bplib_mpool_job_mark_active, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_job_release()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_job_release(bplib_mpool_job_t *job)
+{
+    UT_GenStub_AddParam(bplib_mpool_job_release, bplib_mpool_job_t *, job);
+
+    UT_GenStub_Execute(bplib_mpool_job_release, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_job_run_all()
@@ -96,3 +124,34 @@ void bplib_mpool_job_run_all(bplib_mpool_t *pool, void *arg)
 
     UT_GenStub_Execute(bplib_mpool_job_run_all, Basic, NULL);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_job_set_quantum()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_job_set_quantum(bplib_mpool_job_t *job, uint32_t quantum, bool in_bytes)
+{
+    UT_GenStub_AddParam(bplib_mpool_job_set_quantum, bplib_mpool_job_t *, job);
+    UT_GenStub_AddParam(bplib_mpool_job_set_quantum, uint32_t, quantum);
+    UT_GenStub_AddParam(bplib_mpool_job_set_quantum, bool, in_bytes);
+
+    UT_GenStub_Execute(bplib_mpool_job_set_quantum, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_job_spend_share()
+ * ----------------------------------------------------
+ */
+bool bplib_mpool_job_spend_share(bplib_mpool_job_t *job, bplib_mpool_block_t *qblk)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_job_spend_share, bool);
+
+    UT_GenStub_AddParam(bplib_mpool_job_spend_share, bplib_mpool_job_t *, job);
+    UT_GenStub_AddParam(bplib_mpool_job_spend_share, bplib_mpool_block_t *, qblk);
+
+    UT_GenStub_Execute(bplib_mpool_job_spend_share, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_job_spend_share, bool);
+}
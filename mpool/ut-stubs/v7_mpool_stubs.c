@@ -61,6 +61,56 @@ bplib_mpool_t *bplib_mpool_create(void *pool_mem, size_t pool_size)
     return UT_GenStub_GetReturnValue(bplib_mpool_create, bplib_mpool_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_create_ext()
+ * ----------------------------------------------------
+ */
+bplib_mpool_t *bplib_mpool_create_ext(void *pool_mem, size_t pool_size, uint32_t flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_create_ext, bplib_mpool_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_create_ext, void *, pool_mem);
+    UT_GenStub_AddParam(bplib_mpool_create_ext, size_t, pool_size);
+    UT_GenStub_AddParam(bplib_mpool_create_ext, uint32_t, flags);
+
+    UT_GenStub_Execute(bplib_mpool_create_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_create_ext, bplib_mpool_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_create_partitioned()
+ * ----------------------------------------------------
+ */
+bplib_mpool_t *bplib_mpool_create_partitioned(void *pool_mem, size_t pool_size, uint32_t num_partitions,
+                                              uint32_t flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_create_partitioned, bplib_mpool_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_create_partitioned, void *, pool_mem);
+    UT_GenStub_AddParam(bplib_mpool_create_partitioned, size_t, pool_size);
+    UT_GenStub_AddParam(bplib_mpool_create_partitioned, uint32_t, num_partitions);
+    UT_GenStub_AddParam(bplib_mpool_create_partitioned, uint32_t, flags);
+
+    UT_GenStub_Execute(bplib_mpool_create_partitioned, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_create_partitioned, bplib_mpool_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_debug_print_inspection()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_debug_print_inspection(const bplib_mpool_inspection_t *result)
+{
+    UT_GenStub_AddParam(bplib_mpool_debug_print_inspection, const bplib_mpool_inspection_t *, result);
+
+    UT_GenStub_Execute(bplib_mpool_debug_print_inspection, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_debug_print_list_stats()
@@ -136,6 +186,27 @@ bplib_mpool_block_t *bplib_mpool_generic_data_alloc(bplib_mpool_t *pool, uint32_
     return UT_GenStub_GetReturnValue(bplib_mpool_generic_data_alloc, bplib_mpool_block_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_generic_data_alloc_n()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_mpool_generic_data_alloc_n(bplib_mpool_t *pool, bplib_mpool_block_t *list, uint32_t count,
+                                          uint32_t magic_number, void *init_arg)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_generic_data_alloc_n, uint32_t);
+
+    UT_GenStub_AddParam(bplib_mpool_generic_data_alloc_n, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_generic_data_alloc_n, bplib_mpool_block_t *, list);
+    UT_GenStub_AddParam(bplib_mpool_generic_data_alloc_n, uint32_t, count);
+    UT_GenStub_AddParam(bplib_mpool_generic_data_alloc_n, uint32_t, magic_number);
+    UT_GenStub_AddParam(bplib_mpool_generic_data_alloc_n, void *, init_arg);
+
+    UT_GenStub_Execute(bplib_mpool_generic_data_alloc_n, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_generic_data_alloc_n, uint32_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_generic_data_cast()
@@ -204,6 +275,22 @@ size_t bplib_mpool_get_generic_data_capacity(const bplib_mpool_block_t *cb)
     return UT_GenStub_GetReturnValue(bplib_mpool_get_generic_data_capacity, size_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_get_num_partitions()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_mpool_get_num_partitions(bplib_mpool_t *pool)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_get_num_partitions, uint32_t);
+
+    UT_GenStub_AddParam(bplib_mpool_get_num_partitions, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_get_num_partitions, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_get_num_partitions, uint32_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_get_parent_pool_from_link()
@@ -220,6 +307,23 @@ bplib_mpool_t *bplib_mpool_get_parent_pool_from_link(bplib_mpool_block_t *cb)
     return UT_GenStub_GetReturnValue(bplib_mpool_get_parent_pool_from_link, bplib_mpool_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_get_partition()
+ * ----------------------------------------------------
+ */
+bplib_mpool_t *bplib_mpool_get_partition(bplib_mpool_t *pool, uint32_t partition_index)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_get_partition, bplib_mpool_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_get_partition, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_get_partition, uint32_t, partition_index);
+
+    UT_GenStub_Execute(bplib_mpool_get_partition, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_get_partition, bplib_mpool_t *);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_get_user_content_size()
@@ -290,6 +394,55 @@ void bplib_mpool_insert_before(bplib_mpool_block_t *list, bplib_mpool_block_t *n
     UT_GenStub_Execute(bplib_mpool_insert_before, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_inspect_get()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_inspect_get(bplib_mpool_t *pool, const bplib_mpool_inspector_t *insp,
+                             bplib_mpool_inspection_t *result)
+{
+    UT_GenStub_AddParam(bplib_mpool_inspect_get, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_inspect_get, const bplib_mpool_inspector_t *, insp);
+    UT_GenStub_AddParam(bplib_mpool_inspect_get, bplib_mpool_inspection_t *, result);
+
+    UT_GenStub_Execute(bplib_mpool_inspect_get, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_inspect_step()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_mpool_inspect_step(bplib_mpool_t *pool, bplib_mpool_inspector_t *insp, uint32_t limit)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_inspect_step, uint32_t);
+
+    UT_GenStub_AddParam(bplib_mpool_inspect_step, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_inspect_step, bplib_mpool_inspector_t *, insp);
+    UT_GenStub_AddParam(bplib_mpool_inspect_step, uint32_t, limit);
+
+    UT_GenStub_Execute(bplib_mpool_inspect_step, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_inspect_step, uint32_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_is_at_bundle_threshold()
+ * ----------------------------------------------------
+ */
+bool bplib_mpool_is_at_bundle_threshold(bplib_mpool_t *pool)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_is_at_bundle_threshold, bool);
+
+    UT_GenStub_AddParam(bplib_mpool_is_at_bundle_threshold, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_is_at_bundle_threshold, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_is_at_bundle_threshold, bool);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_list_iter_forward()
@@ -381,6 +534,22 @@ void bplib_mpool_merge_list(bplib_mpool_block_t *dest, bplib_mpool_block_t *src)
     UT_GenStub_Execute(bplib_mpool_merge_list, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_query_collect_backlog()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_query_collect_backlog(bplib_mpool_t *pool)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_query_collect_backlog, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_query_collect_backlog, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_query_collect_backlog, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_query_collect_backlog, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_query_mem_current_use()
@@ -413,6 +582,40 @@ size_t bplib_mpool_query_mem_max_use(bplib_mpool_t *pool)
     return UT_GenStub_GetReturnValue(bplib_mpool_query_mem_max_use, size_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_query_stat()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_query_stat(bplib_mpool_t *pool, bplib_mpool_stat_t stat, uint32_t index)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_query_stat, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_query_stat, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_query_stat, bplib_mpool_stat_t, stat);
+    UT_GenStub_AddParam(bplib_mpool_query_stat, uint32_t, index);
+
+    UT_GenStub_Execute(bplib_mpool_query_stat, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_query_stat, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_get_block_footprint()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_get_block_footprint(const bplib_mpool_block_t *cb)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_get_block_footprint, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_get_block_footprint, const bplib_mpool_block_t *, cb);
+
+    UT_GenStub_Execute(bplib_mpool_get_block_footprint, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_get_block_footprint, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_read_refcount()
@@ -429,6 +632,26 @@ size_t bplib_mpool_read_refcount(const bplib_mpool_block_t *cb)
     return UT_GenStub_GetReturnValue(bplib_mpool_read_refcount, size_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_reattach()
+ * ----------------------------------------------------
+ */
+bplib_mpool_t *bplib_mpool_reattach(void *pool_mem, size_t pool_size, bplib_mpool_callback_func_t recover_fn,
+                                    void *recover_arg)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_reattach, bplib_mpool_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_reattach, void *, pool_mem);
+    UT_GenStub_AddParam(bplib_mpool_reattach, size_t, pool_size);
+    UT_GenStub_AddParam(bplib_mpool_reattach, bplib_mpool_callback_func_t, recover_fn);
+    UT_GenStub_AddParam(bplib_mpool_reattach, void *, recover_arg);
+
+    UT_GenStub_Execute(bplib_mpool_reattach, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_reattach, bplib_mpool_t *);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_recycle_all_blocks_in_list()
@@ -474,6 +697,100 @@ int bplib_mpool_register_blocktype(bplib_mpool_t *pool, uint32_t magic_number, c
     return UT_GenStub_GetReturnValue(bplib_mpool_register_blocktype, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_release_defer_begin()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_release_defer_begin(bplib_mpool_t *pool)
+{
+    UT_GenStub_AddParam(bplib_mpool_release_defer_begin, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_release_defer_begin, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_release_defer_end()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_release_defer_end(void)
+{
+
+    UT_GenStub_Execute(bplib_mpool_release_defer_end, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_reserve_enter()
+ * ----------------------------------------------------
+ */
+bplib_mpool_reserve_t *bplib_mpool_reserve_enter(bplib_mpool_reserve_t *rsv)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_reserve_enter, bplib_mpool_reserve_t *);
+
+    UT_GenStub_AddParam(bplib_mpool_reserve_enter, bplib_mpool_reserve_t *, rsv);
+
+    UT_GenStub_Execute(bplib_mpool_reserve_enter, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_reserve_enter, bplib_mpool_reserve_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_reserve_init()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_reserve_init(bplib_mpool_block_t *base_block, bplib_mpool_reserve_t *rsv)
+{
+    UT_GenStub_AddParam(bplib_mpool_reserve_init, bplib_mpool_block_t *, base_block);
+    UT_GenStub_AddParam(bplib_mpool_reserve_init, bplib_mpool_reserve_t *, rsv);
+
+    UT_GenStub_Execute(bplib_mpool_reserve_init, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_reserve_leave()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_reserve_leave(bplib_mpool_reserve_t *prev)
+{
+    UT_GenStub_AddParam(bplib_mpool_reserve_leave, bplib_mpool_reserve_t *, prev);
+
+    UT_GenStub_Execute(bplib_mpool_reserve_leave, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_reserve_release()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_reserve_release(bplib_mpool_reserve_t *rsv)
+{
+    UT_GenStub_AddParam(bplib_mpool_reserve_release, bplib_mpool_reserve_t *, rsv);
+
+    UT_GenStub_Execute(bplib_mpool_reserve_release, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_reserve_set_target()
+ * ----------------------------------------------------
+ */
+int bplib_mpool_reserve_set_target(bplib_mpool_t *pool, bplib_mpool_reserve_t *rsv, uint32_t target_count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_reserve_set_target, int);
+
+    UT_GenStub_AddParam(bplib_mpool_reserve_set_target, bplib_mpool_t *, pool);
+    UT_GenStub_AddParam(bplib_mpool_reserve_set_target, bplib_mpool_reserve_t *, rsv);
+    UT_GenStub_AddParam(bplib_mpool_reserve_set_target, uint32_t, target_count);
+
+    UT_GenStub_Execute(bplib_mpool_reserve_set_target, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_reserve_set_target, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_search_list()
@@ -492,3 +809,38 @@ bplib_mpool_block_t *bplib_mpool_search_list(const bplib_mpool_block_t *list, bp
 
     return UT_GenStub_GetReturnValue(bplib_mpool_search_list, bplib_mpool_block_t *);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_thread_cache_attach()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_thread_cache_attach(bplib_mpool_t *pool)
+{
+    UT_GenStub_AddParam(bplib_mpool_thread_cache_attach, bplib_mpool_t *, pool);
+
+    UT_GenStub_Execute(bplib_mpool_thread_cache_attach, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_thread_cache_detach()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_thread_cache_detach(void)
+{
+
+    UT_GenStub_Execute(bplib_mpool_thread_cache_detach, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_thread_cache_get_stats()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_thread_cache_get_stats(bplib_mpool_thread_cache_stats_t *stats)
+{
+    UT_GenStub_AddParam(bplib_mpool_thread_cache_get_stats, bplib_mpool_thread_cache_stats_t *, stats);
+
+    UT_GenStub_Execute(bplib_mpool_thread_cache_get_stats, Basic, NULL);
+}
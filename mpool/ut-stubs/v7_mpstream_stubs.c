@@ -84,6 +84,38 @@ size_t bplib_mpool_stream_read(bplib_mpool_stream_t *mps, void *data, size_t siz
     return UT_GenStub_GetReturnValue(bplib_mpool_stream_read, size_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_stream_read_iov()
+ * ----------------------------------------------------
+ */
+size_t bplib_mpool_stream_read_iov(bplib_mpool_stream_t *mps, bplib_iovec_t *iov, size_t *iov_count, size_t size)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_mpool_stream_read_iov, size_t);
+
+    UT_GenStub_AddParam(bplib_mpool_stream_read_iov, bplib_mpool_stream_t *, mps);
+    UT_GenStub_AddParam(bplib_mpool_stream_read_iov, bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(bplib_mpool_stream_read_iov, size_t *, iov_count);
+    UT_GenStub_AddParam(bplib_mpool_stream_read_iov, size_t, size);
+
+    UT_GenStub_Execute(bplib_mpool_stream_read_iov, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_mpool_stream_read_iov, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_stream_read_list()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_stream_read_list(bplib_mpool_stream_t *mps, bplib_mpool_block_t *list)
+{
+    UT_GenStub_AddParam(bplib_mpool_stream_read_list, bplib_mpool_stream_t *, mps);
+    UT_GenStub_AddParam(bplib_mpool_stream_read_list, bplib_mpool_block_t *, list);
+
+    UT_GenStub_Execute(bplib_mpool_stream_read_list, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_stream_seek()
@@ -101,6 +133,21 @@ size_t bplib_mpool_stream_seek(bplib_mpool_stream_t *mps, size_t position)
     return UT_GenStub_GetReturnValue(bplib_mpool_stream_seek, size_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_mpool_stream_set_index()
+ * ----------------------------------------------------
+ */
+void bplib_mpool_stream_set_index(bplib_mpool_stream_t *mps, bplib_mpool_stream_index_entry_t *entries,
+                                  size_t max_entries)
+{
+    UT_GenStub_AddParam(bplib_mpool_stream_set_index, bplib_mpool_stream_t *, mps);
+    UT_GenStub_AddParam(bplib_mpool_stream_set_index, bplib_mpool_stream_index_entry_t *, entries);
+    UT_GenStub_AddParam(bplib_mpool_stream_set_index, size_t, max_entries);
+
+    UT_GenStub_Execute(bplib_mpool_stream_set_index, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_mpool_stream_write()
@@ -48,10 +48,38 @@
 /* Macros */
 #define bplog(flags, evt, ...) bplib_os_log(__FILE__, __LINE__, flags, evt, __VA_ARGS__)
 
+/* Options for bplib_os_alloc_pool_mem() */
+#define BPLIB_OS_POOLMEM_HUGEPAGE 0x01 /* back the memory with huge pages, if the OS supports it */
+#define BPLIB_OS_POOLMEM_LOCKED   0x02 /* lock the memory into RAM, so it is never paged out */
+
+/* Options for bplib_os_mutex_create(), ignored where the OS does not support them */
+#define BPLIB_OS_MUTEX_RECURSIVE 0x01 /* the holder may take it again, and must release it as many times */
+#define BPLIB_OS_MUTEX_ADAPTIVE  0x02 /* spin briefly before sleeping, for locks that are only held briefly */
+
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
 
+typedef struct bplib_os_mutex  bplib_os_mutex_t;
+typedef struct bplib_os_thread bplib_os_thread_t;
+
+typedef void (*bplib_os_thread_entry_t)(void *arg);
+
+/*
+ * Memory for the library, from somewhere other than the C library heap and the OS pages, such as
+ * an arena or a static region.  The arg is passed to every call.  alloc returns zero filled memory,
+ * or NULL if there is none, and release is never given NULL.  The pool calls are optional: when
+ * they are NULL, pool memory also comes from alloc and release, and the flags do not apply.
+ */
+typedef struct bplib_os_allocator
+{
+    void *arg;
+    void *(*alloc)(void *arg, size_t size);
+    void (*release)(void *arg, void *ptr);
+    void *(*alloc_pool)(void *arg, size_t size, uint32_t flags);
+    void (*release_pool)(void *arg, void *ptr, size_t size);
+} bplib_os_allocator_t;
+
 /******************************************************************************
  PROTOTYPES
  ******************************************************************************/
@@ -61,11 +89,14 @@ void        bplib_os_enable_log_flags(uint32_t enable_mask);
 int         bplib_os_log(const char *file, unsigned int line, uint32_t *flags, uint32_t event, const char *fmt, ...);
 int         bplib_os_systime(unsigned long *sysnow); /* seconds */
 uint64_t    bplib_os_get_dtntime_ms(void);
+uint64_t    bplib_os_get_dtntime_coarse_ms(void); /* cheaper, to within a few ms: for deadlines, not timestamps */
+uint64_t    bplib_os_get_monotonic_us(void); /* for measuring intervals only, the epoch is arbitrary */
 void        bplib_os_sleep(int seconds);
 uint32_t    bplib_os_random(void);
 bp_handle_t bplib_os_createlock(void);
 void        bplib_os_destroylock(bp_handle_t h);
 void        bplib_os_lock(bp_handle_t h);
+int         bplib_os_trylock(bp_handle_t h); /* BP_SUCCESS if acquired, BP_TIMEOUT if it is held elsewhere */
 void        bplib_os_unlock(bp_handle_t h);
 void        bplib_os_broadcast_signal(bp_handle_t h);
 void        bplib_os_broadcast_signal_and_unlock(bp_handle_t h);
@@ -74,5 +105,65 @@ int         bplib_os_waiton(bp_handle_t h, int timeout_ms);
 int         bplib_os_wait_until_ms(bp_handle_t h, uint64_t abs_dtntime_ms);
 void       *bplib_os_calloc(size_t size);
 void        bplib_os_free(void *ptr);
+void       *bplib_os_alloc_pool_mem(size_t size, uint32_t flags); /* always zero filled */
+void        bplib_os_free_pool_mem(void *ptr, size_t size);
+uint32_t    bplib_os_get_cpu_index(void); /* CPU the caller is running on, or 0 if not known */
+
+/*
+ * The allocator is set once at startup, before bplib_init(), so that every allocation made by the
+ * library (pool memory, locks, interfaces and so on) comes from it.  NULL goes back to the default.
+ */
+int                         bplib_os_set_allocator(const bplib_os_allocator_t *allocator);
+const bplib_os_allocator_t *bplib_os_get_allocator(void); /* NULL if the default is in use */
+
+/*
+ * Pool memory that outlives the process, in a file such as one in /dev/shm or on a DAX file system.
+ * The file is created if need be, and is mapped shared at the same address it was mapped at by the
+ * last process, so a pool in it can be attached again with bplib_mpool_reattach().  If that is not
+ * possible, or the file is new or not of this size, it starts over zero filled and existed is false.
+ * Returns NULL if the OS has no such thing or the file cannot be mapped.
+ */
+void *bplib_os_map_pool_file(const char *path, size_t size, bool *existed);
+void  bplib_os_unmap_pool_file(void *ptr, size_t size); /* writes it back to the file first */
+
+/*
+ * A notifier is a file descriptor which can be given to poll()/epoll() and is readable while it is set,
+ * so an event loop can wait on it along with its other descriptors.  If the OS does not have such a
+ * thing, bplib_os_create_notifier() returns BP_INVALID_HANDLE.  Set and clear are level, not counted.
+ */
+bp_handle_t bplib_os_create_notifier(void);
+void        bplib_os_destroy_notifier(bp_handle_t h);
+int         bplib_os_notifier_get_fd(bp_handle_t h); /* -1 if h is not a notifier */
+void        bplib_os_notifier_set(bp_handle_t h);
+void        bplib_os_notifier_clear(bp_handle_t h);
+
+/*
+ * A mutex, with a condition to wait on, which is used directly rather than through a handle, and
+ * which is not limited in number by a table.  Unless created with BPLIB_OS_MUTEX_RECURSIVE it must
+ * not be taken again by the thread which holds it.  The calls mirror the handle based lock calls.
+ */
+bplib_os_mutex_t *bplib_os_mutex_create(uint32_t flags); /* NULL if it could not be created */
+void              bplib_os_mutex_destroy(bplib_os_mutex_t *mtx);
+void              bplib_os_mutex_lock(bplib_os_mutex_t *mtx);
+int               bplib_os_mutex_trylock(bplib_os_mutex_t *mtx); /* BP_SUCCESS if acquired, BP_TIMEOUT if held */
+void              bplib_os_mutex_unlock(bplib_os_mutex_t *mtx);
+void              bplib_os_mutex_signal(bplib_os_mutex_t *mtx);
+void              bplib_os_mutex_broadcast(bplib_os_mutex_t *mtx);
+void              bplib_os_mutex_broadcast_and_unlock(bplib_os_mutex_t *mtx);
+int               bplib_os_mutex_wait_until_ms(bplib_os_mutex_t *mtx, uint64_t abs_dtntime_ms);
+
+/*
+ * A thread, created by the library or an app, which can be named, placed on a set of CPUs and given
+ * a realtime priority.  The calls taking a thread apply to the calling thread if it is NULL, so a
+ * thread which was not started this way, such as main(), can still be placed.  A realtime priority
+ * of 0 is the normal scheduling of the OS, and 1-99 are realtime with 99 being most urgent.  These
+ * return BP_ERROR if the OS refuses or cannot do it, such as for lack of privileges, and the thread
+ * then carries on as it was.  Joining a thread waits for its entry to return, then frees it.
+ */
+bplib_os_thread_t *bplib_os_thread_create(const char *name, bplib_os_thread_entry_t entry, void *arg);
+int                bplib_os_thread_join(bplib_os_thread_t *thr);
+int                bplib_os_thread_set_name(bplib_os_thread_t *thr, const char *name);
+int                bplib_os_thread_set_affinity(bplib_os_thread_t *thr, const uint32_t *cpus, uint32_t num_cpus);
+int                bplib_os_thread_set_priority(bplib_os_thread_t *thr, uint32_t rt_priority);
 
 #endif /* BPLIB_OS_H */
@@ -0,0 +1,67 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BPLIB_TRACEPOINT_H
+#define BPLIB_TRACEPOINT_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*
+ * Static tracepoints, for bpftrace, perf and the like to attach to on a running node.  They
+ * are compiled in when BPLIB_ENABLE_USDT is defined on Linux (the BPLIB_ENABLE_USDT cmake
+ * option, which needs sys/sdt.h from systemtap), and are nothing at all otherwise, so the
+ * arguments are not even evaluated.  While nothing is attached one costs a single nop.
+ *
+ * Every tracepoint is in the "bplib" provider and has three 64 bit arguments.  For those about
+ * a bundle the first two are its flow (see BPLIB_TRACEPOINT_FLOW) and its creation sequence
+ * number, which together identify the bundle from one tracepoint to the next:
+ *
+ *   bundle_ingress   flow, sequence, receiving interface       a CLA has received and decoded it
+ *   route            flow, sequence, next hop interface (0 if none)   it has been routed
+ *   cache_store      flow, sequence, storage interface         the cache has accepted it
+ *   cache_restore    flow, sequence, storage id                it has been read back from offload
+ *   cla_egress       flow, sequence, sending interface         a CLA has taken it to send
+ *   dacs_generate    flow, sequence, custodian node            a DACS was started for it
+ *   pool_alloc_fail  block type, priority, free blocks         a block allocation was refused
+ *   job_start        job type, job address, 0                  a job is about to run
+ *   job_stop         job type, job address, 0                  it has returned
+ */
+#if defined(BPLIB_ENABLE_USDT) && defined(__linux__)
+
+#include <sys/sdt.h>
+
+#define BPLIB_TRACEPOINT(name, arg1, arg2, arg3) \
+    DTRACE_PROBE3(bplib, name, (uint64_t)(arg1), (uint64_t)(arg2), (uint64_t)(arg3))
+
+#else
+
+#define BPLIB_TRACEPOINT(name, arg1, arg2, arg3) ((void)0)
+
+#endif
+
+/* The flow of a bundle in a tracepoint is its source node and service number */
+#define BPLIB_TRACEPOINT_FLOW(node_number, service_number) \
+    (((uint64_t)(node_number) << 32) | (uint32_t)(service_number))
+
+#endif /* BPLIB_TRACEPOINT_H */
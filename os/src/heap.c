@@ -25,17 +25,194 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "bplib.h"
 #include "bplib_os.h"
 
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+/* the registered allocator, this uses the C library (or the static arena) while alloc is NULL */
+static bplib_os_allocator_t heap_allocator;
+
+#ifdef BPLIB_STATIC_CONFIG
+/*
+ * Each chunk of the static arena starts with one of these, and the chunks follow one another
+ * to the end, so the arena is found by walking it from the start.  Sizes are in units of the
+ * header, which also keeps every chunk aligned for any type.
+ */
+typedef union bplib_os_arena_hdr
+{
+    struct
+    {
+        size_t units;  /* including this header */
+        size_t in_use; /* zero if the chunk is free */
+    } chunk;
+    uintmax_t align_val;
+    void     *align_ptr;
+} bplib_os_arena_hdr_t;
+
+#define BPLIB_OS_ARENA_UNITS (BPLIB_STATIC_HEAP_SIZE / sizeof(bplib_os_arena_hdr_t))
+
+static bplib_os_arena_hdr_t heap_arena[BPLIB_OS_ARENA_UNITS];
+
+/* this can be used before any lock exists, as bplib_os_createlock() allocates from here */
+static char heap_arena_lock;
+#endif
+
+#ifdef BPLIB_STATIC_CONFIG
+/*----------------------------------------------------------------------------
+ * bplib_os_arena_alloc - first fit, free chunks next to each other are joined as they are passed
+ *----------------------------------------------------------------------------*/
+static void *bplib_os_arena_alloc(size_t size)
+{
+    bplib_os_arena_hdr_t *hdr;
+    size_t                units;
+    size_t                idx;
+    size_t                next;
+
+    if (size >= BPLIB_STATIC_HEAP_SIZE)
+    {
+        return NULL;
+    }
+
+    units = 1 + ((size + sizeof(bplib_os_arena_hdr_t) - 1) / sizeof(bplib_os_arena_hdr_t));
+
+    while (__atomic_test_and_set(&heap_arena_lock, __ATOMIC_ACQUIRE))
+    {
+        /* spin, this is never held for longer than one walk of the arena */
+    }
+
+    /* the arena is zero filled to start with, which is one free chunk of everything */
+    if (heap_arena[0].chunk.units == 0)
+    {
+        heap_arena[0].chunk.units = BPLIB_OS_ARENA_UNITS;
+    }
+
+    hdr = NULL;
+    idx = 0;
+    while (idx < BPLIB_OS_ARENA_UNITS)
+    {
+        if (heap_arena[idx].chunk.in_use == 0)
+        {
+            next = idx + heap_arena[idx].chunk.units;
+            while (next < BPLIB_OS_ARENA_UNITS && heap_arena[next].chunk.in_use == 0)
+            {
+                heap_arena[idx].chunk.units += heap_arena[next].chunk.units;
+                next = idx + heap_arena[idx].chunk.units;
+            }
+
+            if (heap_arena[idx].chunk.units >= units)
+            {
+                hdr = &heap_arena[idx];
+                break;
+            }
+        }
+
+        idx += heap_arena[idx].chunk.units;
+    }
+
+    if (hdr != NULL)
+    {
+        if (hdr->chunk.units > units)
+        {
+            hdr[units].chunk.units  = hdr->chunk.units - units;
+            hdr[units].chunk.in_use = 0;
+            hdr->chunk.units        = units;
+        }
+        hdr->chunk.in_use = 1;
+    }
+
+    __atomic_clear(&heap_arena_lock, __ATOMIC_RELEASE);
+
+    if (hdr == NULL)
+    {
+        return NULL;
+    }
+
+    memset(&hdr[1], 0, (units - 1) * sizeof(bplib_os_arena_hdr_t));
+
+    return &hdr[1];
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_arena_release
+ *----------------------------------------------------------------------------*/
+static bool bplib_os_arena_release(void *ptr)
+{
+    bplib_os_arena_hdr_t *hdr;
+
+    hdr = (bplib_os_arena_hdr_t *)ptr;
+    if (hdr <= &heap_arena[0] || hdr >= &heap_arena[BPLIB_OS_ARENA_UNITS])
+    {
+        return false;
+    }
+
+    --hdr;
+    while (__atomic_test_and_set(&heap_arena_lock, __ATOMIC_ACQUIRE))
+    {
+        /* spin */
+    }
+    hdr->chunk.in_use = 0;
+    __atomic_clear(&heap_arena_lock, __ATOMIC_RELEASE);
+
+    return true;
+}
+#endif
+
+/*----------------------------------------------------------------------------
+ * bplib_os_set_allocator
+ *----------------------------------------------------------------------------*/
+int bplib_os_set_allocator(const bplib_os_allocator_t *allocator)
+{
+    static const bplib_os_allocator_t DEFAULT_ALLOCATOR = {0};
+
+    if (allocator == NULL)
+    {
+        allocator = &DEFAULT_ALLOCATOR;
+    }
+    else if (allocator->alloc == NULL || allocator->release == NULL ||
+             (allocator->alloc_pool == NULL) != (allocator->release_pool == NULL))
+    {
+        return BP_ERROR;
+    }
+
+    heap_allocator = *allocator;
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_get_allocator
+ *----------------------------------------------------------------------------*/
+const bplib_os_allocator_t *bplib_os_get_allocator(void)
+{
+    if (heap_allocator.alloc == NULL)
+    {
+        return NULL;
+    }
+
+    return &heap_allocator;
+}
+
 /*----------------------------------------------------------------------------
  * bplib_os_calloc
  *----------------------------------------------------------------------------*/
 void *bplib_os_calloc(size_t size)
 {
+    if (heap_allocator.alloc != NULL)
+    {
+        return heap_allocator.alloc(heap_allocator.arg, size);
+    }
+
+#ifdef BPLIB_STATIC_CONFIG
+    return bplib_os_arena_alloc(size);
+#else
     /* Allocate Memory Block */
     return calloc(size, 1);
+#endif
 }
 
 /*----------------------------------------------------------------------------
@@ -43,6 +220,25 @@ void *bplib_os_calloc(size_t size)
  *----------------------------------------------------------------------------*/
 void bplib_os_free(void *ptr)
 {
+#ifdef BPLIB_STATIC_CONFIG
+    /* memory from before an allocator was set still goes back to the arena */
+    if (ptr != NULL && bplib_os_arena_release(ptr))
+    {
+        return;
+    }
+#endif
+
+    if (heap_allocator.release != NULL)
+    {
+        if (ptr != NULL)
+        {
+            heap_allocator.release(heap_allocator.arg, ptr);
+        }
+        return;
+    }
+
+#ifndef BPLIB_STATIC_CONFIG
     /* Free Memory Block */
     free(ptr);
+#endif
 }
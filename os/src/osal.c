@@ -61,11 +61,40 @@
  */
 static OS_time_t BPLIB_OSAL_LOCALTIME_DTN_CONV;
 
+/* The OSAL priority of threads at the normal (0) realtime priority, OSAL priorities are 1-255 with 1 most urgent */
+#ifndef BPLIB_OSAL_THREAD_PRIORITY
+#define BPLIB_OSAL_THREAD_PRIORITY 100
+#endif
+
+#ifndef BPLIB_OSAL_THREAD_STACK_SIZE
+#define BPLIB_OSAL_THREAD_STACK_SIZE 16384
+#endif
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+struct bplib_os_mutex
+{
+    osal_id_t id;
+};
+
+struct bplib_os_thread
+{
+    osal_id_t               id;
+    bplib_os_thread_entry_t entry;
+    void                   *arg;
+    bplib_os_mutex_t       *done_mtx;
+    uint32_t                done;
+    bplib_os_thread_t      *next;
+};
+
 /******************************************************************************
  FILE DATA
  ******************************************************************************/
 
-static osal_id_t file_data_lock;
+static osal_id_t          file_data_lock;
+static bplib_os_thread_t *thread_list; /* threads from bplib_os_thread_create(), under file_data_lock */
 
 unsigned int bplib_os_next_serial(void)
 {
@@ -144,6 +173,18 @@ void bplib_os_lock(bp_handle_t h)
     OS_CondVarLock(id);
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_trylock -
+ *
+ * OSAL does not have a non-blocking lock, so this always waits and reports success
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_trylock(bp_handle_t h)
+{
+    bplib_os_lock(h);
+
+    return BP_SUCCESS;
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_unlock -
  *-------------------------------------------------------------------------------------*/
@@ -187,14 +228,11 @@ void bplib_os_signal(bp_handle_t h)
     OS_CondVarSignal(id);
 }
 
-int bplib_os_wait_until_ms(bp_handle_t h, uint64_t abs_dtntime_ms)
+static int bplib_os_condvar_wait_until_ms(osal_id_t id, uint64_t abs_dtntime_ms)
 {
-    osal_id_t id;
     OS_time_t until_time;
     int32     status;
 
-    id = OS_ObjectIdFromInteger(bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE));
-
     if (abs_dtntime_ms == BP_DTNTIME_INFINITE)
     {
         /* Block Forever until Success */
@@ -227,6 +265,398 @@ int bplib_os_wait_until_ms(bp_handle_t h, uint64_t abs_dtntime_ms)
     return BP_SUCCESS;
 }
 
+int bplib_os_wait_until_ms(bp_handle_t h, uint64_t abs_dtntime_ms)
+{
+    return bplib_os_condvar_wait_until_ms(OS_ObjectIdFromInteger(bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)),
+                                          abs_dtntime_ms);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_create -
+ *
+ * An OSAL condition variable has its own mutex, which is what this uses.  OSAL does not
+ * have any options for that mutex, so the flags do not apply here.  The number of these is
+ * still limited by the OSAL condition variable table.
+ *-------------------------------------------------------------------------------------*/
+bplib_os_mutex_t *bplib_os_mutex_create(uint32_t flags)
+{
+    char              lock_name[OS_MAX_API_NAME];
+    bplib_os_mutex_t *mtx;
+
+    mtx = (bplib_os_mutex_t *)bplib_os_calloc(sizeof(bplib_os_mutex_t));
+    if (mtx == NULL)
+    {
+        return NULL;
+    }
+
+    snprintf(lock_name, sizeof(lock_name), "bpm%02u", bplib_os_next_serial());
+    if (OS_CondVarCreate(&mtx->id, lock_name, 0) != OS_SUCCESS)
+    {
+        bplib_os_free(mtx);
+        return NULL;
+    }
+
+    return mtx;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_destroy -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_destroy(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarDelete(mtx->id);
+    bplib_os_free(mtx);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_lock -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_lock(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarLock(mtx->id);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_trylock -
+ *
+ * OSAL does not have a non-blocking lock, so this always waits and reports success
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_mutex_trylock(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarLock(mtx->id);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_unlock -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_unlock(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarUnlock(mtx->id);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_signal -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_signal(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarSignal(mtx->id);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_broadcast -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_broadcast(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarBroadcast(mtx->id);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_broadcast_and_unlock -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_broadcast_and_unlock(bplib_os_mutex_t *mtx)
+{
+    OS_CondVarBroadcast(mtx->id);
+    OS_CondVarUnlock(mtx->id);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_wait_until_ms -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_mutex_wait_until_ms(bplib_os_mutex_t *mtx, uint64_t abs_dtntime_ms)
+{
+    return bplib_os_condvar_wait_until_ms(mtx->id, abs_dtntime_ms);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_start - runs the entry of a thread created by bplib_os_thread_create()
+ *
+ * An OSAL task entry has no argument, so the task finds its thread by its own id.  The
+ * creator holds file_data_lock until the thread is in the list, so it is always found.
+ *-------------------------------------------------------------------------------------*/
+static void bplib_os_thread_start(void)
+{
+    bplib_os_thread_t *thr;
+    osal_id_t          self;
+
+    self = OS_TaskGetId();
+
+    OS_MutSemTake(file_data_lock);
+    thr = thread_list;
+    while (thr != NULL && !OS_ObjectIdEqual(thr->id, self))
+    {
+        thr = thr->next;
+    }
+    OS_MutSemGive(file_data_lock);
+
+    if (thr != NULL)
+    {
+        thr->entry(thr->arg);
+
+        bplib_os_mutex_lock(thr->done_mtx);
+        thr->done = 1;
+        bplib_os_mutex_broadcast_and_unlock(thr->done_mtx);
+    }
+
+    OS_TaskExit();
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_create -
+ *
+ * The name is given to OSAL here, as it cannot be changed once the task exists
+ *-------------------------------------------------------------------------------------*/
+bplib_os_thread_t *bplib_os_thread_create(const char *name, bplib_os_thread_entry_t entry, void *arg)
+{
+    char               task_name[OS_MAX_API_NAME];
+    bplib_os_thread_t *thr;
+    int32              status;
+
+    thr = (bplib_os_thread_t *)bplib_os_calloc(sizeof(bplib_os_thread_t));
+    if (thr == NULL)
+    {
+        return NULL;
+    }
+
+    thr->done_mtx = bplib_os_mutex_create(0);
+    if (thr->done_mtx == NULL)
+    {
+        bplib_os_free(thr);
+        return NULL;
+    }
+
+    thr->entry = entry;
+    thr->arg   = arg;
+
+    if (name != NULL)
+    {
+        snprintf(task_name, sizeof(task_name), "%s", name);
+    }
+    else
+    {
+        snprintf(task_name, sizeof(task_name), "bpt%02u", bplib_os_next_serial());
+    }
+
+    OS_MutSemTake(file_data_lock);
+    status = OS_TaskCreate(&thr->id, task_name, bplib_os_thread_start, OSAL_TASK_STACK_ALLOCATE,
+                           BPLIB_OSAL_THREAD_STACK_SIZE, BPLIB_OSAL_THREAD_PRIORITY, 0);
+    if (status == OS_SUCCESS)
+    {
+        thr->next   = thread_list;
+        thread_list = thr;
+    }
+    OS_MutSemGive(file_data_lock);
+
+    if (status != OS_SUCCESS)
+    {
+        bplib_os_mutex_destroy(thr->done_mtx);
+        bplib_os_free(thr);
+        return NULL;
+    }
+
+    return thr;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_join -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_join(bplib_os_thread_t *thr)
+{
+    bplib_os_thread_t **pprev;
+
+    bplib_os_mutex_lock(thr->done_mtx);
+    while (!thr->done)
+    {
+        if (bplib_os_mutex_wait_until_ms(thr->done_mtx, BP_DTNTIME_INFINITE) == BP_ERROR)
+        {
+            bplib_os_mutex_unlock(thr->done_mtx);
+            return BP_ERROR;
+        }
+    }
+    bplib_os_mutex_unlock(thr->done_mtx);
+
+    OS_MutSemTake(file_data_lock);
+    pprev = &thread_list;
+    while (*pprev != NULL && *pprev != thr)
+    {
+        pprev = &(*pprev)->next;
+    }
+    if (*pprev != NULL)
+    {
+        *pprev = thr->next;
+    }
+    OS_MutSemGive(file_data_lock);
+
+    bplib_os_mutex_destroy(thr->done_mtx);
+    bplib_os_free(thr);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_set_name -
+ *
+ * OSAL names a task when it is created and cannot rename it
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_set_name(bplib_os_thread_t *thr, const char *name)
+{
+    return BP_ERROR;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_set_affinity -
+ *
+ * OSAL does not have an API to place a task on a CPU, that is left to the BSP
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_set_affinity(bplib_os_thread_t *thr, const uint32_t *cpus, uint32_t num_cpus)
+{
+    return BP_ERROR;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_set_priority -
+ *
+ * Realtime priorities 1-99 are spread over the OSAL priorities more urgent than the normal one
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_set_priority(bplib_os_thread_t *thr, uint32_t rt_priority)
+{
+    osal_id_t task_id;
+    uint32_t  osal_priority;
+
+    if (rt_priority > 99)
+    {
+        rt_priority = 99;
+    }
+
+    osal_priority = BPLIB_OSAL_THREAD_PRIORITY - (((BPLIB_OSAL_THREAD_PRIORITY - 1) * rt_priority) / 99);
+
+    if (thr != NULL)
+    {
+        task_id = thr->id;
+    }
+    else
+    {
+        task_id = OS_TaskGetId();
+    }
+
+    if (OS_TaskSetPriority(task_id, (osal_priority_t)osal_priority) != OS_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_alloc_pool_mem -
+ *
+ * OSAL does not have an abstraction for mapped memory, so unless the allocator has
+ * its own pool calls the flags are not applicable here, and this comes from the heap
+ * like any other allocation.
+ *-------------------------------------------------------------------------------------*/
+void *bplib_os_alloc_pool_mem(size_t size, uint32_t flags)
+{
+    const bplib_os_allocator_t *allocator;
+
+    allocator = bplib_os_get_allocator();
+    if (allocator != NULL && allocator->alloc_pool != NULL)
+    {
+        return allocator->alloc_pool(allocator->arg, size, flags);
+    }
+
+    return bplib_os_calloc(size);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_free_pool_mem -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_free_pool_mem(void *ptr, size_t size)
+{
+    const bplib_os_allocator_t *allocator;
+
+    allocator = bplib_os_get_allocator();
+    if (allocator != NULL && allocator->release_pool != NULL)
+    {
+        if (ptr != NULL)
+        {
+            allocator->release_pool(allocator->arg, ptr, size);
+        }
+        return;
+    }
+
+    bplib_os_free(ptr);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_map_pool_file -
+ *
+ * OSAL does not have an abstraction for mapped files either, so a pool cannot outlive
+ * the process here.
+ *-------------------------------------------------------------------------------------*/
+void *bplib_os_map_pool_file(const char *path, size_t size, bool *existed)
+{
+    *existed = false;
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_unmap_pool_file -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_unmap_pool_file(void *ptr, size_t size) {}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_get_cpu_index -
+ *
+ * OSAL does not provide a way to get this, so all callers appear to be on the same CPU
+ *-------------------------------------------------------------------------------------*/
+uint32_t bplib_os_get_cpu_index(void)
+{
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_create_notifier -
+ *
+ * OSAL does not have a pollable event object, so notifiers are not available
+ *-------------------------------------------------------------------------------------*/
+bp_handle_t bplib_os_create_notifier(void)
+{
+    return BP_INVALID_HANDLE;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_destroy_notifier -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_destroy_notifier(bp_handle_t h)
+{
+    /* nothing to do, this handle is never valid here */
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_notifier_get_fd -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_notifier_get_fd(bp_handle_t h)
+{
+    return -1;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_notifier_set -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_notifier_set(bp_handle_t h)
+{
+    /* nothing to do, this handle is never valid here */
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_notifier_clear -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_notifier_clear(bp_handle_t h)
+{
+    /* nothing to do, this handle is never valid here */
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_get_dtntime_ms - returns milliseconds since DTN epoch
  * this should be compatible with the BPv7 time definition
@@ -253,3 +683,28 @@ uint64_t bplib_os_get_dtntime_ms(void)
     /* Convert to milliseconds */
     return OS_TimeGetTotalMilliseconds(ref_tm);
 }
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_get_dtntime_coarse_ms - returns milliseconds since DTN epoch, for deadlines
+ *
+ * OSAL has no cheaper clock, so this is the same as bplib_os_get_dtntime_ms()
+ *-------------------------------------------------------------------------------------*/
+uint64_t bplib_os_get_dtntime_coarse_ms(void)
+{
+    return bplib_os_get_dtntime_ms();
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_get_monotonic_us - returns microseconds for measuring intervals
+ *
+ * The OSAL local time is used, this is not guaranteed to be monotonic if the
+ * time is set, but it is only used for statistics
+ *-------------------------------------------------------------------------------------*/
+uint64_t bplib_os_get_monotonic_us(void)
+{
+    OS_time_t ref_tm;
+
+    OS_GetLocalTime(&ref_tm);
+
+    return OS_TimeGetTotalMicroseconds(ref_tm);
+}
@@ -22,50 +22,100 @@
  INCLUDES
  ******************************************************************************/
 
+/* sched_getcpu() is a GNU extension */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 #include "bplib.h"
 #include "bplib_os.h"
+#include "posix_log_internal.h"
 
 /******************************************************************************
  DEFINES
  ******************************************************************************/
 
-#define UNIX_SECS_AT_2000     946684800
-#define BP_MAX_LOG_ENTRY_SIZE 256
-#define BP_MAX_LOCKS          128
+#define UNIX_SECS_AT_2000 946684800
+
+/* How many times an adaptive mutex is tried before sleeping on it */
+#ifndef BP_MUTEX_SPIN_LIMIT
+#define BP_MUTEX_SPIN_LIMIT 100
+#endif
+
+/* Linux keeps thread names of up to 15 characters, longer ones are truncated */
+#define BP_THREAD_NAME_SIZE 16
+
+/* the first page of a pool file says where it was mapped, the pool is the rest of it */
+#define BP_POOLFILE_MAGIC 0x62706f6f
+
+/* The coarse clock is only used if it is at least this fine, otherwise the precise one is */
+#ifndef BP_COARSE_CLOCK_MAX_RES_NS
+#define BP_COARSE_CLOCK_MAX_RES_NS 10000000
+#endif
+
+/*
+ * Pool memory is allocated in multiples of this size, so it can be backed by huge pages.
+ * Memory beyond the requested size is never touched, so this does not use any real memory.
+ */
+#ifndef BP_POOLMEM_HUGEPAGE_SIZE
+#define BP_POOLMEM_HUGEPAGE_SIZE (2 * 1024 * 1024)
+#endif
 
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
 
-typedef struct
+struct bplib_os_mutex
 {
     pthread_cond_t  cond;
     pthread_mutex_t mutex;
-} bplib_os_lock_t;
+    uint32_t        spin; /* set if adaptive, and the pthread mutex does not spin by itself */
+};
+
+struct bplib_os_thread
+{
+    pthread_t               thread;
+    bplib_os_thread_entry_t entry;
+    void                   *arg;
+};
 
 /******************************************************************************
  FILE DATA
  ******************************************************************************/
 
-static bplib_os_lock_t *locks[BP_MAX_LOCKS] = {0};
+static bplib_os_mutex_t *locks[BP_MAX_LOCKS] = {0};
 static pthread_mutex_t  lock_of_locks;
 
 static struct timespec prevnow;
+static clockid_t       coarse_clock = CLOCK_REALTIME;
 
 static uint32_t flag_log_enable = BP_FLAG_NONCOMPLIANT | BP_FLAG_DROPPED | BP_FLAG_BUNDLE_TOO_LARGE |
                                   BP_FLAG_UNKNOWNREC | BP_FLAG_INVALID_CIPHER_SUITEID |
                                   BP_FLAG_INVALID_BIB_RESULT_TYPE | BP_FLAG_INVALID_BIB_TARGET_TYPE |
                                   BP_FLAG_FAILED_TO_PARSE | BP_FLAG_API_ERROR;
 
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static int            log_writer_running;
+
 static inline uint64_t bplib_timespec_to_u64(const struct timespec *ts)
 {
     uint64_t result;
@@ -76,6 +126,41 @@ static inline uint64_t bplib_timespec_to_u64(const struct timespec *ts)
 
     return result;
 }
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_flush - writes out whatever is still queued when the process exits
+ *-------------------------------------------------------------------------------------*/
+static void bplib_os_log_flush(void)
+{
+    bplib_os_log_drain(stderr);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_start - starts the writer, once per process
+ *-------------------------------------------------------------------------------------*/
+static void bplib_os_log_start(void)
+{
+    bplib_os_thread_t *writer;
+
+    if (bplib_os_log_init_rings() != BP_SUCCESS)
+    {
+        return;
+    }
+
+    /* the writer runs until the process exits, so it is never joined */
+    writer = bplib_os_thread_create("bplib_log", bplib_os_log_writer, NULL);
+    if (writer != NULL)
+    {
+        pthread_detach(writer->thread);
+        atexit(bplib_os_log_flush);
+        log_writer_running = 1;
+    }
+}
+
 /******************************************************************************
  EXPORTED UTILITY FUNCTIONS
  ******************************************************************************/
@@ -105,6 +190,19 @@ void bplib_os_init()
     clock_gettime(CLOCK_REALTIME, &prevnow);
 
     srand((unsigned int)prevnow.tv_nsec);
+
+#ifdef CLOCK_REALTIME_COARSE
+    {
+        struct timespec res;
+
+        /* this is read from the vDSO without a syscall or reading the clock hardware */
+        if (clock_getres(CLOCK_REALTIME_COARSE, &res) == 0 && res.tv_sec == 0 &&
+            res.tv_nsec <= BP_COARSE_CLOCK_MAX_RES_NS)
+        {
+            coarse_clock = CLOCK_REALTIME_COARSE;
+        }
+    }
+#endif
 }
 
 /*--------------------------------------------------------------------------------------
@@ -114,53 +212,29 @@ void bplib_os_init()
  *-------------------------------------------------------------------------------------*/
 int bplib_os_log(const char *file, unsigned int line, uint32_t *flags, uint32_t event, const char *fmt, ...)
 {
-    if ((flag_log_enable & event) == event)
+    if ((flag_log_enable & event) == event && bplib_os_log_rate_ok(event))
     {
-        char    formatted_string[BP_MAX_LOG_ENTRY_SIZE];
-        va_list args;
-        int     vlen, msglen;
+        bplib_os_log_ring_t *ring;
+        va_list              args;
 
-        /* Build Formatted String */
-        va_start(args, fmt);
-        vlen   = vsnprintf(formatted_string, BP_MAX_LOG_ENTRY_SIZE - 1, fmt, args);
-        msglen = vlen < BP_MAX_LOG_ENTRY_SIZE - 1 ? vlen : BP_MAX_LOG_ENTRY_SIZE - 1;
-        va_end(args);
-
-        /* Log Message */
-        if (msglen > 0)
+        /* the record is queued for the writer thread when there is one, so formatting is done there */
+        pthread_once(&log_once, bplib_os_log_start);
+        ring = NULL;
+        if (log_writer_running)
         {
-            char  log_message[BP_MAX_LOG_ENTRY_SIZE];
-            char *pathptr;
-
-            formatted_string[msglen] = '\0';
-
-            /* Chop Path in Filename */
-            pathptr = strrchr(file, '/');
-            if (pathptr)
-                pathptr++;
-            else
-                pathptr = (char *)file;
-
-            /* Create Log Message */
-            if (event != BP_FLAG_DIAGNOSTIC)
-            {
-                msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%08X:%s", pathptr, line, event,
-                                  formatted_string);
-            }
-            else
-            {
-                msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%s", pathptr, line, formatted_string);
-            }
-
-            /* Provide Truncation Indicator */
-            if (msglen > (BP_MAX_LOG_ENTRY_SIZE - 2))
-            {
-                log_message[BP_MAX_LOG_ENTRY_SIZE - 2] = '#';
-            }
+            ring = bplib_os_log_get_ring();
+        }
 
-            /* Display Log Message */
-            fputs(log_message, stderr);
+        va_start(args, fmt);
+        if (ring != NULL)
+        {
+            bplib_os_log_enqueue(ring, file, line, event, fmt, args);
+        }
+        else
+        {
+            bplib_os_log_write_now(file, line, event, fmt, args);
         }
+        va_end(args);
     }
 
     /* Set Event Flag and Return */
@@ -219,6 +293,38 @@ uint64_t bplib_os_get_dtntime_ms(void)
     return bplib_timespec_to_u64(&now);
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_get_dtntime_coarse_ms - returns milliseconds since DTN epoch, to within a tick
+ *
+ * This is the same time base as bplib_os_get_dtntime_ms(), but may lag it by up to the
+ * kernel tick, so it is for deadlines and timeouts rather than for timestamps.
+ *-------------------------------------------------------------------------------------*/
+uint64_t bplib_os_get_dtntime_coarse_ms(void)
+{
+    struct timespec now;
+
+    if (clock_gettime(coarse_clock, &now) < 0 || now.tv_sec < UNIX_SECS_AT_2000)
+    {
+        return 0; /* This is BP-speak for unknown time */
+    }
+
+    now.tv_sec -= UNIX_SECS_AT_2000;
+
+    return bplib_timespec_to_u64(&now);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_get_monotonic_us - returns microseconds since an arbitrary point
+ *-------------------------------------------------------------------------------------*/
+uint64_t bplib_os_get_monotonic_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_systime - returns seconds
  *-------------------------------------------------------------------------------------*/
@@ -264,8 +370,664 @@ uint32_t bplib_os_random(void)
     return (uint32_t)rand();
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_alloc_pool_mem -
+ *
+ * Uses an anonymous mapping rather than the heap, unless an allocator has been set.  The
+ * pages are zero filled by the kernel on first touch, so there is no need to write the
+ * memory up front.
+ *-------------------------------------------------------------------------------------*/
+void *bplib_os_alloc_pool_mem(size_t size, uint32_t flags)
+{
+    const bplib_os_allocator_t *allocator;
+    void                       *ptr;
+
+    allocator = bplib_os_get_allocator();
+    if (allocator != NULL)
+    {
+        if (allocator->alloc_pool != NULL)
+        {
+            return allocator->alloc_pool(allocator->arg, size, flags);
+        }
+        return allocator->alloc(allocator->arg, size);
+    }
+
+    size = (size + BP_POOLMEM_HUGEPAGE_SIZE - 1) & ~((size_t)BP_POOLMEM_HUGEPAGE_SIZE - 1);
+    ptr  = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    /* explicit huge pages only work if these were reserved by the administrator */
+    if ((flags & BPLIB_OS_POOLMEM_HUGEPAGE) != 0)
+    {
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+
+    if (ptr == MAP_FAILED)
+    {
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to map %zu bytes of pool memory: %s\n", size, strerror(errno));
+            return NULL;
+        }
+
+#ifdef MADV_HUGEPAGE
+        /* otherwise ask for transparent huge pages; failure is not an error, it is just slower */
+        if ((flags & BPLIB_OS_POOLMEM_HUGEPAGE) != 0)
+        {
+            madvise(ptr, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    if ((flags & BPLIB_OS_POOLMEM_LOCKED) != 0 && mlock(ptr, size) != 0)
+    {
+        /* this is usually a resource limit (RLIMIT_MEMLOCK), the memory is still usable */
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to lock %zu bytes of pool memory: %s\n", size, strerror(errno));
+    }
+
+    return ptr;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_free_pool_mem -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_free_pool_mem(void *ptr, size_t size)
+{
+    const bplib_os_allocator_t *allocator;
+
+    allocator = bplib_os_get_allocator();
+    if (allocator != NULL)
+    {
+        if (ptr != NULL)
+        {
+            if (allocator->release_pool != NULL)
+            {
+                allocator->release_pool(allocator->arg, ptr, size);
+            }
+            else
+            {
+                allocator->release(allocator->arg, ptr);
+            }
+        }
+    }
+    else if (ptr != NULL)
+    {
+        size = (size + BP_POOLMEM_HUGEPAGE_SIZE - 1) & ~((size_t)BP_POOLMEM_HUGEPAGE_SIZE - 1);
+        munmap(ptr, size);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_map_pool_file -
+ *
+ * Every pointer in the pool is only valid at the address it was made at, so an existing
+ * file is mapped there again or not at all.  With MAP_FIXED_NOREPLACE the kernel refuses
+ * an address already in use, otherwise the address is only a hint and is checked after.
+ *-------------------------------------------------------------------------------------*/
+void *bplib_os_map_pool_file(const char *path, size_t size, bool *existed)
+{
+    struct bp_poolfile_header
+    {
+        uint32_t magic;
+        uint32_t header_size;
+        uint64_t pool_size;
+        uint64_t map_addr;
+    } hdr;
+    struct stat st;
+    size_t      header_size;
+    size_t      map_size;
+    void       *hint;
+    void       *ptr;
+    int         map_flags;
+    int         fd;
+
+    *existed    = false;
+    header_size = (size_t)sysconf(_SC_PAGESIZE);
+    map_size    = header_size + size;
+
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to open pool file %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    hint = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size == (off_t)map_size && pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) &&
+        hdr.magic == BP_POOLFILE_MAGIC && hdr.header_size == header_size && hdr.pool_size == size)
+    {
+        hint = (void *)(uintptr_t)hdr.map_addr;
+    }
+
+    ptr = MAP_FAILED;
+    if (hint != NULL)
+    {
+        map_flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+        map_flags |= MAP_FIXED_NOREPLACE;
+#endif
+        ptr = mmap(hint, map_size, PROT_READ | PROT_WRITE, map_flags, fd, 0);
+        if (ptr != MAP_FAILED && ptr != hint)
+        {
+            munmap(ptr, map_size);
+            ptr = MAP_FAILED;
+        }
+        if (ptr == MAP_FAILED)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Pool file %s cannot be mapped at %p again, starting over\n", path, hint);
+        }
+    }
+
+    if (ptr == MAP_FAILED)
+    {
+        /* whatever was in the file is not kept, a new pool starts out zero filled */
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)map_size) != 0)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to size pool file %s: %s\n", path, strerror(errno));
+        }
+        else
+        {
+            ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (ptr == MAP_FAILED)
+            {
+                bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Failed to map pool file %s: %s\n", path, strerror(errno));
+            }
+        }
+
+        if (ptr != MAP_FAILED)
+        {
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.magic       = BP_POOLFILE_MAGIC;
+            hdr.header_size = header_size;
+            hdr.pool_size   = size;
+            hdr.map_addr    = (uintptr_t)ptr;
+            memcpy(ptr, &hdr, sizeof(hdr));
+        }
+    }
+    else
+    {
+        *existed = true;
+    }
+
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    return (uint8_t *)ptr + header_size;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_unmap_pool_file -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_unmap_pool_file(void *ptr, size_t size)
+{
+    size_t header_size;
+
+    if (ptr != NULL)
+    {
+        header_size = (size_t)sysconf(_SC_PAGESIZE);
+        msync((uint8_t *)ptr - header_size, header_size + size, MS_SYNC);
+        munmap((uint8_t *)ptr - header_size, header_size + size);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_get_cpu_index -
+ *-------------------------------------------------------------------------------------*/
+uint32_t bplib_os_get_cpu_index(void)
+{
+#ifdef __linux__
+    int cpu;
+
+    cpu = sched_getcpu();
+    if (cpu >= 0)
+    {
+        return (uint32_t)cpu;
+    }
+#endif
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_create_notifier -
+ *
+ * This is an eventfd on Linux, the handle is the descriptor itself
+ *-------------------------------------------------------------------------------------*/
+bp_handle_t bplib_os_create_notifier(void)
+{
+#ifdef __linux__
+    int fd;
+
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd >= 0 && fd <= BPLIB_HANDLE_MAX_SERIAL)
+    {
+        return bp_handle_from_serial(fd, BPLIB_HANDLE_OS_NOTIFIER_BASE);
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+
+    return BP_INVALID_HANDLE;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_destroy_notifier -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_destroy_notifier(bp_handle_t h)
+{
+    int fd = bplib_os_notifier_get_fd(h);
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_notifier_get_fd -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_notifier_get_fd(bp_handle_t h)
+{
+    int fd = bp_handle_to_serial(h, BPLIB_HANDLE_OS_NOTIFIER_BASE);
+
+    if (fd < 0 || fd > BPLIB_HANDLE_MAX_SERIAL)
+    {
+        return -1;
+    }
+
+    return fd;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_notifier_set -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_notifier_set(bp_handle_t h)
+{
+    int      fd = bplib_os_notifier_get_fd(h);
+    uint64_t value;
+    ssize_t  rc;
+
+    if (fd >= 0)
+    {
+        /* the counter only saturates after ~2^64 sets, and it stays readable in that case */
+        value = 1;
+        rc    = write(fd, &value, sizeof(value));
+        (void)rc;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_notifier_clear -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_notifier_clear(bp_handle_t h)
+{
+    int      fd = bplib_os_notifier_get_fd(h);
+    uint64_t value;
+    ssize_t  rc;
+
+    if (fd >= 0)
+    {
+        /* reading an eventfd resets its counter, this is non-blocking so it is fine if already clear */
+        rc = read(fd, &value, sizeof(value));
+        (void)rc;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_cpu_relax - tells the CPU this is a spin loop
+ *-------------------------------------------------------------------------------------*/
+static inline void bplib_os_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_create -
+ *-------------------------------------------------------------------------------------*/
+bplib_os_mutex_t *bplib_os_mutex_create(uint32_t flags)
+{
+    bplib_os_mutex_t   *mtx;
+    pthread_mutexattr_t attr;
+    int                 status;
+
+    mtx = (bplib_os_mutex_t *)bplib_os_calloc(sizeof(bplib_os_mutex_t));
+    if (mtx == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutexattr_init(&attr);
+    if ((flags & BPLIB_OS_MUTEX_RECURSIVE) != 0)
+    {
+        /* a recursive mutex cannot also be the adaptive type, so it spins here instead */
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        mtx->spin = flags & BPLIB_OS_MUTEX_ADAPTIVE;
+    }
+    else if ((flags & BPLIB_OS_MUTEX_ADAPTIVE) != 0)
+    {
+#ifdef PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+#else
+        mtx->spin = 1;
+#endif
+    }
+
+    status = pthread_mutex_init(&mtx->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (status != 0)
+    {
+        bplib_os_free(mtx);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&mtx->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&mtx->mutex);
+        bplib_os_free(mtx);
+        return NULL;
+    }
+
+    return mtx;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_destroy -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_destroy(bplib_os_mutex_t *mtx)
+{
+    pthread_mutex_destroy(&mtx->mutex);
+    pthread_cond_destroy(&mtx->cond);
+    bplib_os_free(mtx);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_lock -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_lock(bplib_os_mutex_t *mtx)
+{
+    uint32_t i;
+
+    if (mtx->spin)
+    {
+        for (i = 0; i < BP_MUTEX_SPIN_LIMIT; ++i)
+        {
+            if (pthread_mutex_trylock(&mtx->mutex) == 0)
+            {
+                return;
+            }
+            bplib_os_cpu_relax();
+        }
+    }
+
+    pthread_mutex_lock(&mtx->mutex);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_trylock -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_mutex_trylock(bplib_os_mutex_t *mtx)
+{
+    if (pthread_mutex_trylock(&mtx->mutex) != 0)
+    {
+        return BP_TIMEOUT;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_unlock -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_unlock(bplib_os_mutex_t *mtx)
+{
+    pthread_mutex_unlock(&mtx->mutex);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_signal -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_signal(bplib_os_mutex_t *mtx)
+{
+    pthread_cond_signal(&mtx->cond);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_broadcast -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_broadcast(bplib_os_mutex_t *mtx)
+{
+    pthread_cond_broadcast(&mtx->cond);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_broadcast_and_unlock -
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_mutex_broadcast_and_unlock(bplib_os_mutex_t *mtx)
+{
+    pthread_cond_broadcast(&mtx->cond);
+    pthread_mutex_unlock(&mtx->mutex);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_mutex_wait_until_ms -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_mutex_wait_until_ms(bplib_os_mutex_t *mtx, uint64_t abs_dtntime_ms)
+{
+    struct timespec until_time;
+    int             status;
+
+    if (abs_dtntime_ms == BP_DTNTIME_INFINITE)
+    {
+        /* Block Forever until Success */
+        status = pthread_cond_wait(&mtx->cond, &mtx->mutex);
+    }
+    else
+    {
+        until_time.tv_sec  = (abs_dtntime_ms / 1000);
+        until_time.tv_nsec = (abs_dtntime_ms % 1000) * 1000000;
+
+        /* change the epoch from DTN (2000) to UNIX (1970) */
+        until_time.tv_sec += UNIX_SECS_AT_2000;
+
+        /* Block on Timed Wait and Update Timeout */
+        status = pthread_cond_timedwait(&mtx->cond, &mtx->mutex, &until_time);
+    }
+
+    /* check for timeout error explicitly and translate to BP_TIMEOUT */
+    if (status == ETIMEDOUT)
+    {
+        return BP_TIMEOUT;
+    }
+
+    /* other unexpected/unhandled errors become BP_ERROR */
+    if (status != 0)
+    {
+        return BP_ERROR;
+    }
+
+    /* status of 0 indicates success */
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_start - runs the entry of a thread created by bplib_os_thread_create()
+ *-------------------------------------------------------------------------------------*/
+static void *bplib_os_thread_start(void *arg)
+{
+    bplib_os_thread_t *thr = arg;
+
+    thr->entry(thr->arg);
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_create -
+ *-------------------------------------------------------------------------------------*/
+bplib_os_thread_t *bplib_os_thread_create(const char *name, bplib_os_thread_entry_t entry, void *arg)
+{
+    bplib_os_thread_t *thr;
+
+    thr = (bplib_os_thread_t *)bplib_os_calloc(sizeof(bplib_os_thread_t));
+    if (thr == NULL)
+    {
+        return NULL;
+    }
+
+    thr->entry = entry;
+    thr->arg   = arg;
+
+    if (pthread_create(&thr->thread, NULL, bplib_os_thread_start, thr) != 0)
+    {
+        bplib_os_free(thr);
+        return NULL;
+    }
+
+    /* the name is only for the OS tools, so the thread is still usable without it */
+    if (name != NULL)
+    {
+        bplib_os_thread_set_name(thr, name);
+    }
+
+    return thr;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_join -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_join(bplib_os_thread_t *thr)
+{
+    if (pthread_join(thr->thread, NULL) != 0)
+    {
+        return BP_ERROR;
+    }
+
+    bplib_os_free(thr);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_set_name -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_set_name(bplib_os_thread_t *thr, const char *name)
+{
+#ifdef __linux__
+    char thread_name[BP_THREAD_NAME_SIZE];
+
+    strncpy(thread_name, name, sizeof(thread_name) - 1);
+    thread_name[sizeof(thread_name) - 1] = 0;
+
+    if (pthread_setname_np((thr != NULL) ? thr->thread : pthread_self(), thread_name) != 0)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+#else
+    (void)thr;
+    (void)name;
+
+    return BP_ERROR;
+#endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_set_affinity -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_set_affinity(bplib_os_thread_t *thr, const uint32_t *cpus, uint32_t num_cpus)
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    uint32_t  i;
+
+    CPU_ZERO(&cpu_set);
+    for (i = 0; i < num_cpus; ++i)
+    {
+        if (cpus[i] >= CPU_SETSIZE)
+        {
+            return BP_ERROR;
+        }
+        CPU_SET(cpus[i], &cpu_set);
+    }
+
+    if (pthread_setaffinity_np((thr != NULL) ? thr->thread : pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+#else
+    (void)thr;
+    (void)cpus;
+    (void)num_cpus;
+
+    return BP_ERROR;
+#endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_thread_set_priority -
+ *
+ * Realtime priorities use SCHED_FIFO, limited to the range the system allows
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_thread_set_priority(bplib_os_thread_t *thr, uint32_t rt_priority)
+{
+    struct sched_param param;
+    int                policy;
+    int                prio_min;
+    int                prio_max;
+
+    memset(&param, 0, sizeof(param));
+    if (rt_priority == 0)
+    {
+        policy = SCHED_OTHER;
+    }
+    else
+    {
+        policy   = SCHED_FIFO;
+        prio_min = sched_get_priority_min(policy);
+        prio_max = sched_get_priority_max(policy);
+        if (rt_priority > (uint32_t)prio_max)
+        {
+            param.sched_priority = prio_max;
+        }
+        else if (rt_priority < (uint32_t)prio_min)
+        {
+            param.sched_priority = prio_min;
+        }
+        else
+        {
+            param.sched_priority = (int)rt_priority;
+        }
+    }
+
+    if (pthread_setschedparam((thr != NULL) ? thr->thread : pthread_self(), policy, &param) != 0)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_createlock -
+ *
+ * The handle based locks are recursive mutexes kept in a table, see
+ * bplib_os_mutex_create() for locks without those limits
  *-------------------------------------------------------------------------------------*/
 bp_handle_t bplib_os_createlock(void)
 {
@@ -278,14 +1040,9 @@ bp_handle_t bplib_os_createlock(void)
         {
             if (locks[i] == NULL)
             {
-                locks[i] = (bplib_os_lock_t *)bplib_os_calloc(sizeof(bplib_os_lock_t));
+                locks[i] = bplib_os_mutex_create(BPLIB_OS_MUTEX_RECURSIVE);
                 if (locks[i])
                 {
-                    pthread_mutexattr_t attr;
-                    pthread_mutexattr_init(&attr);
-                    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-                    pthread_mutex_init(&locks[i]->mutex, &attr);
-                    pthread_cond_init(&locks[i]->cond, NULL);
                     handle = bp_handle_from_serial(i, BPLIB_HANDLE_OS_BASE);
                     break;
                 }
@@ -308,9 +1065,7 @@ void bplib_os_destroylock(bp_handle_t h)
     {
         if (locks[handle])
         {
-            pthread_mutex_destroy(&locks[handle]->mutex);
-            pthread_cond_destroy(&locks[handle]->cond);
-            bplib_os_free(locks[handle]);
+            bplib_os_mutex_destroy(locks[handle]);
             locks[handle] = NULL;
         }
     }
@@ -322,9 +1077,15 @@ void bplib_os_destroylock(bp_handle_t h)
  *-------------------------------------------------------------------------------------*/
 void bplib_os_lock(bp_handle_t h)
 {
-    int handle = bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE);
+    bplib_os_mutex_lock(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)]);
+}
 
-    pthread_mutex_lock(&locks[handle]->mutex);
+/*--------------------------------------------------------------------------------------
+ * bplib_os_trylock -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_trylock(bp_handle_t h)
+{
+    return bplib_os_mutex_trylock(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)]);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -332,24 +1093,17 @@ void bplib_os_lock(bp_handle_t h)
  *-------------------------------------------------------------------------------------*/
 void bplib_os_unlock(bp_handle_t h)
 {
-    int handle = bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE);
-
-    pthread_mutex_unlock(&locks[handle]->mutex);
+    bplib_os_mutex_unlock(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)]);
 }
 
 void bplib_os_broadcast_signal_and_unlock(bp_handle_t h)
 {
-    bplib_os_lock_t *lock = locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)];
-
-    pthread_cond_broadcast(&lock->cond);
-    pthread_mutex_unlock(&lock->mutex);
+    bplib_os_mutex_broadcast_and_unlock(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)]);
 }
 
 void bplib_os_broadcast_signal(bp_handle_t h)
 {
-    bplib_os_lock_t *lock = locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)];
-
-    pthread_cond_broadcast(&lock->cond);
+    bplib_os_mutex_broadcast(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)]);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -357,9 +1111,7 @@ void bplib_os_broadcast_signal(bp_handle_t h)
  *-------------------------------------------------------------------------------------*/
 void bplib_os_signal(bp_handle_t h)
 {
-    int handle = bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE);
-
-    pthread_cond_signal(&locks[handle]->cond);
+    bplib_os_mutex_signal(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)]);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -367,14 +1119,14 @@ void bplib_os_signal(bp_handle_t h)
  *-------------------------------------------------------------------------------------*/
 int bplib_os_waiton(bp_handle_t h, int timeout_ms)
 {
-    int handle = bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE);
-    int status;
+    bplib_os_mutex_t *mtx = locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)];
+    int               status;
 
     /* Perform Wait */
     if (timeout_ms == -1)
     {
         /* Block Forever until Success */
-        status = pthread_cond_wait(&locks[handle]->cond, &locks[handle]->mutex);
+        status = pthread_cond_wait(&mtx->cond, &mtx->mutex);
         if (status != 0)
         {
             status = BP_ERROR;
@@ -398,7 +1150,7 @@ int bplib_os_waiton(bp_handle_t h, int timeout_ms)
         }
 
         /* Block on Timed Wait and Update Timeout */
-        status = pthread_cond_timedwait(&locks[handle]->cond, &locks[handle]->mutex, &ts);
+        status = pthread_cond_timedwait(&mtx->cond, &mtx->mutex, &ts);
         if (status == ETIMEDOUT)
         {
             status = BP_TIMEOUT;
@@ -421,41 +1173,7 @@ int bplib_os_waiton(bp_handle_t h, int timeout_ms)
 
 int bplib_os_wait_until_ms(bp_handle_t h, uint64_t abs_dtntime_ms)
 {
-    bplib_os_lock_t *lock = locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)];
-    struct timespec  until_time;
-    int              status;
-
-    if (abs_dtntime_ms == BP_DTNTIME_INFINITE)
-    {
-        /* Block Forever until Success */
-        status = pthread_cond_wait(&lock->cond, &lock->mutex);
-    }
-    else
-    {
-        until_time.tv_sec  = (abs_dtntime_ms / 1000);
-        until_time.tv_nsec = (abs_dtntime_ms % 1000) * 1000000;
-
-        /* change the epoch from DTN (2000) to UNIX (1970) */
-        until_time.tv_sec += UNIX_SECS_AT_2000;
-
-        /* Block on Timed Wait and Update Timeout */
-        status = pthread_cond_timedwait(&lock->cond, &lock->mutex, &until_time);
-    }
-
-    /* check for timeout error explicitly and translate to BP_TIMEOUT */
-    if (status == ETIMEDOUT)
-    {
-        return BP_TIMEOUT;
-    }
-
-    /* other unexpected/unhandled errors become BP_ERROR */
-    if (status != 0)
-    {
-        return BP_ERROR;
-    }
-
-    /* status of 0 indicates success */
-    return BP_SUCCESS;
+    return bplib_os_mutex_wait_until_ms(locks[bp_handle_to_serial(h, BPLIB_HANDLE_OS_BASE)], abs_dtntime_ms);
 }
 
 /*--------------------------------------------------------------------------------------
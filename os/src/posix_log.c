@@ -0,0 +1,661 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "posix_log_internal.h"
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static bplib_os_log_ring_t *log_rings[BP_LOG_MAX_RINGS];
+static uint32_t             log_num_rings;
+static pthread_key_t        log_ring_key;
+static pthread_mutex_t      log_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t log_rate_window[BP_LOG_NUM_BUCKETS];
+static uint32_t log_rate_count[BP_LOG_NUM_BUCKETS];
+static uint32_t log_not_written[BP_LOG_NUM_BUCKETS];
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_basename - chops the path from a file name
+ *-------------------------------------------------------------------------------------*/
+static const char *bplib_os_log_basename(const char *file)
+{
+    const char *pathptr;
+
+    pathptr = strrchr(file, '/');
+    if (pathptr)
+        pathptr++;
+    else
+        pathptr = file;
+
+    return pathptr;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_emit - writes one formatted message
+ *-------------------------------------------------------------------------------------*/
+static void bplib_os_log_emit(FILE *out, const char *file, unsigned int line, uint32_t event,
+                              const char *formatted_string)
+{
+    char log_message[BP_MAX_LOG_ENTRY_SIZE];
+    int  msglen;
+
+    /* Create Log Message */
+    if (event != BP_FLAG_DIAGNOSTIC)
+    {
+        msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%08X:%s", file, line, event, formatted_string);
+    }
+    else
+    {
+        msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%s", file, line, formatted_string);
+    }
+
+    /* Provide Truncation Indicator */
+    if (msglen > (BP_MAX_LOG_ENTRY_SIZE - 2))
+    {
+        log_message[BP_MAX_LOG_ENTRY_SIZE - 2] = '#';
+    }
+
+    /* Display Log Message */
+    fputs(log_message, out);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_release_ring - frees a thread's ring for the next thread when it exits
+ *-------------------------------------------------------------------------------------*/
+static void bplib_os_log_release_ring(void *arg)
+{
+    bplib_os_log_ring_t *ring = arg;
+
+    __atomic_store_n(&ring->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_rate_ok - counts a record against the limit for its event flag
+ *
+ * Returns - nonzero if the record should be logged
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_log_rate_ok(uint32_t event)
+{
+    uint32_t bucket;
+    uint32_t now;
+    uint32_t window;
+
+    if (BP_LOG_RATE_LIMIT == 0)
+    {
+        return 1;
+    }
+
+    bucket = (event == 0) ? 0 : (__builtin_ctz(event) + 1);
+    now    = (uint32_t)(bplib_os_get_monotonic_us() / 1000000);
+
+    /* whichever thread sees the second change first starts the new window */
+    window = __atomic_load_n(&log_rate_window[bucket], __ATOMIC_RELAXED);
+    if (window != now &&
+        __atomic_compare_exchange_n(&log_rate_window[bucket], &window, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&log_rate_count[bucket], 0, __ATOMIC_RELAXED);
+    }
+
+    if (__atomic_fetch_add(&log_rate_count[bucket], 1, __ATOMIC_RELAXED) >= BP_LOG_RATE_LIMIT)
+    {
+        __atomic_fetch_add(&log_not_written[bucket], 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_report_not_written - says how many records were limited or dropped
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_report_not_written(FILE *out)
+{
+    uint32_t bucket;
+    uint32_t count;
+
+    for (bucket = 0; bucket < BP_LOG_NUM_BUCKETS; ++bucket)
+    {
+        if (__atomic_load_n(&log_not_written[bucket], __ATOMIC_RELAXED) != 0)
+        {
+            count = __atomic_exchange_n(&log_not_written[bucket], 0, __ATOMIC_RELAXED);
+            fprintf(out, "bplib: %u log messages not written for event %08X\n", (unsigned int)count,
+                    (bucket == 0) ? 0 : (1U << (bucket - 1)));
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_capture - copies the format and its arguments into a record
+ *
+ * Only the common conversions are understood; anything else (such as '*' widths)
+ * is left to the caller to format right away.
+ *
+ * Returns - nonzero if the record holds everything needed to format it later
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_log_capture(bplib_os_log_record_t *rec, const char *fmt, va_list args)
+{
+    bplib_os_log_argval_t *arg;
+    bplib_os_log_argtype_t type;
+    const char            *spec;
+    const char            *str;
+    size_t                 space;
+    size_t                 len;
+    long                   precision;
+
+    len = strlen(fmt) + 1;
+    if (len > (sizeof(rec->text) - rec->text_used))
+    {
+        return 0;
+    }
+
+    rec->fmt_offset = rec->text_used;
+    memcpy(&rec->text[rec->text_used], fmt, len);
+    rec->text_used += len;
+    rec->num_args = 0;
+
+    while ((fmt = strchr(fmt, '%')) != NULL)
+    {
+        spec = fmt;
+        ++fmt;
+        if (*fmt == '%')
+        {
+            ++fmt;
+            continue;
+        }
+
+        fmt += strspn(fmt, "-+ #0");
+        fmt += strspn(fmt, "0123456789");
+        precision = -1;
+        if (*fmt == '.')
+        {
+            ++fmt;
+            precision = strtol(fmt, NULL, 10);
+            fmt += strspn(fmt, "0123456789");
+        }
+
+        type = bplib_os_log_arg_int;
+        if (*fmt == 'h')
+        {
+            ++fmt;
+            if (*fmt == 'h')
+            {
+                ++fmt;
+            }
+        }
+        else if (*fmt == 'l')
+        {
+            ++fmt;
+            type = bplib_os_log_arg_long;
+            if (*fmt == 'l')
+            {
+                ++fmt;
+                type = bplib_os_log_arg_llong;
+            }
+        }
+        else if (*fmt == 'z' || *fmt == 'j' || *fmt == 't')
+        {
+            type = (*fmt == 'z') ? bplib_os_log_arg_size
+                                 : ((*fmt == 'j') ? bplib_os_log_arg_intmax : bplib_os_log_arg_ptrdiff);
+            ++fmt;
+        }
+
+        if ((fmt - spec) >= (BP_LOG_MAX_SPEC_SIZE - 1) || rec->num_args >= BP_LOG_MAX_ARGS)
+        {
+            return 0;
+        }
+
+        switch (*fmt)
+        {
+            case 'd':
+            case 'i':
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if (type != bplib_os_log_arg_int && type != bplib_os_log_arg_long)
+                {
+                    return 0;
+                }
+                type = bplib_os_log_arg_double;
+                break;
+            case 'c':
+            case 's':
+            case 'p':
+                if (type != bplib_os_log_arg_int)
+                {
+                    return 0;
+                }
+                if (*fmt == 's')
+                {
+                    type = bplib_os_log_arg_str;
+                }
+                else if (*fmt == 'p')
+                {
+                    type = bplib_os_log_arg_ptr;
+                }
+                break;
+            default:
+                /* '*' widths, long double, %n and anything unknown */
+                return 0;
+        }
+        ++fmt;
+
+        arg = &rec->args[rec->num_args];
+        switch (type)
+        {
+            case bplib_os_log_arg_long:
+                arg->l = va_arg(args, long);
+                break;
+            case bplib_os_log_arg_llong:
+                arg->ll = va_arg(args, long long);
+                break;
+            case bplib_os_log_arg_size:
+                arg->z = va_arg(args, size_t);
+                break;
+            case bplib_os_log_arg_intmax:
+                arg->j = va_arg(args, intmax_t);
+                break;
+            case bplib_os_log_arg_ptrdiff:
+                arg->t = va_arg(args, ptrdiff_t);
+                break;
+            case bplib_os_log_arg_double:
+                arg->d = va_arg(args, double);
+                break;
+            case bplib_os_log_arg_ptr:
+                arg->p = va_arg(args, const void *);
+                break;
+            case bplib_os_log_arg_str:
+                str = va_arg(args, const char *);
+                if (str == NULL)
+                {
+                    str = "(null)";
+                }
+
+                /* a precision means the string need not be terminated */
+                space = sizeof(rec->text) - rec->text_used;
+                len   = strnlen(str, (precision >= 0 && (size_t)precision < space) ? (size_t)precision : space);
+                if (len >= space)
+                {
+                    return 0;
+                }
+                arg->str_offset = rec->text_used;
+                memcpy(&rec->text[rec->text_used], str, len);
+                rec->text[rec->text_used + len] = 0;
+                rec->text_used += len + 1;
+                break;
+            default:
+                arg->i = va_arg(args, int);
+                break;
+        }
+
+        rec->arg_types[rec->num_args] = type;
+        ++rec->num_args;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_format - formats a captured record, on the writer thread
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_format(const bplib_os_log_record_t *rec, char *out, size_t size)
+{
+    char                         spec[BP_LOG_MAX_SPEC_SIZE];
+    const bplib_os_log_argval_t *arg;
+    const char                  *fmt;
+    const char                  *start;
+    size_t                       pos;
+    int                          len;
+    uint8_t                      i;
+
+    fmt = &rec->text[rec->fmt_offset];
+    pos = 0;
+    i   = 0;
+    while (*fmt != 0 && pos < (size - 1))
+    {
+        if (*fmt != '%' || fmt[1] == '%')
+        {
+            out[pos] = *fmt;
+            ++pos;
+            fmt += (*fmt == '%') ? 2 : 1;
+            continue;
+        }
+
+        /* bplib_os_log_capture already checked each conversion and its length */
+        start = fmt;
+        fmt += strcspn(fmt + 1, "diouxXeEfFgGaAcsp") + 2;
+        memcpy(spec, start, fmt - start);
+        spec[fmt - start] = 0;
+
+        if (i >= rec->num_args)
+        {
+            break;
+        }
+
+        arg = &rec->args[i];
+        switch (rec->arg_types[i])
+        {
+            case bplib_os_log_arg_long:
+                len = snprintf(&out[pos], size - pos, spec, arg->l);
+                break;
+            case bplib_os_log_arg_llong:
+                len = snprintf(&out[pos], size - pos, spec, arg->ll);
+                break;
+            case bplib_os_log_arg_size:
+                len = snprintf(&out[pos], size - pos, spec, arg->z);
+                break;
+            case bplib_os_log_arg_intmax:
+                len = snprintf(&out[pos], size - pos, spec, arg->j);
+                break;
+            case bplib_os_log_arg_ptrdiff:
+                len = snprintf(&out[pos], size - pos, spec, arg->t);
+                break;
+            case bplib_os_log_arg_double:
+                len = snprintf(&out[pos], size - pos, spec, arg->d);
+                break;
+            case bplib_os_log_arg_ptr:
+                len = snprintf(&out[pos], size - pos, spec, arg->p);
+                break;
+            case bplib_os_log_arg_str:
+                len = snprintf(&out[pos], size - pos, spec, &rec->text[arg->str_offset]);
+                break;
+            default:
+                len = snprintf(&out[pos], size - pos, spec, arg->i);
+                break;
+        }
+        ++i;
+
+        if (len > 0)
+        {
+            pos += len;
+        }
+    }
+
+    if (pos > (size - 1))
+    {
+        pos = size - 1;
+    }
+    out[pos] = 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_drain - writes out everything queued on every ring
+ *
+ * Returns - the number of records written
+ *-------------------------------------------------------------------------------------*/
+uint32_t bplib_os_log_drain(FILE *out)
+{
+    char                         formatted_string[BP_MAX_LOG_ENTRY_SIZE];
+    const bplib_os_log_record_t *rec;
+    bplib_os_log_ring_t         *ring;
+    uint32_t                     num_rings;
+    uint32_t                     count;
+    uint32_t                     pos;
+    uint32_t                     i;
+
+    count = 0;
+    pthread_mutex_lock(&log_drain_mutex);
+
+    num_rings = __atomic_load_n(&log_num_rings, __ATOMIC_ACQUIRE);
+    if (num_rings > BP_LOG_MAX_RINGS)
+    {
+        num_rings = BP_LOG_MAX_RINGS;
+    }
+
+    for (i = 0; i < num_rings; ++i)
+    {
+        ring = __atomic_load_n(&log_rings[i], __ATOMIC_ACQUIRE);
+        if (ring == NULL)
+        {
+            continue;
+        }
+
+        pos = ring->pull_count;
+        while (pos != __atomic_load_n(&ring->push_count, __ATOMIC_ACQUIRE))
+        {
+            rec = &ring->records[pos & (BP_LOG_RING_SIZE - 1)];
+            if (rec->preformatted)
+            {
+                strncpy(formatted_string, &rec->text[rec->fmt_offset], sizeof(formatted_string) - 1);
+                formatted_string[sizeof(formatted_string) - 1] = 0;
+            }
+            else
+            {
+                bplib_os_log_format(rec, formatted_string, sizeof(formatted_string));
+            }
+
+            if (formatted_string[0] != 0)
+            {
+                bplib_os_log_emit(out, rec->text, rec->line, rec->event, formatted_string);
+            }
+
+            ++pos;
+            __atomic_store_n(&ring->pull_count, pos, __ATOMIC_RELEASE);
+            ++count;
+        }
+    }
+
+    bplib_os_log_report_not_written(out);
+
+    pthread_mutex_unlock(&log_drain_mutex);
+
+    return count;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_writer - background thread which formats and writes queued records
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_writer(void *arg)
+{
+    struct timespec interval;
+
+    (void)arg;
+
+    interval.tv_sec  = 0;
+    interval.tv_nsec = BP_LOG_DRAIN_INTERVAL_NS;
+
+    for (;;)
+    {
+        if (bplib_os_log_drain(stderr) == 0)
+        {
+            nanosleep(&interval, NULL);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_init_rings - sets up the key rings are found by, once per process
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_log_init_rings(void)
+{
+    if (pthread_key_create(&log_ring_key, bplib_os_log_release_ring) != 0)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_get_ring - gets the ring of the calling thread, setting one up if needed
+ *
+ * Returns - the ring, or NULL if the thread has to log synchronously
+ *-------------------------------------------------------------------------------------*/
+bplib_os_log_ring_t *bplib_os_log_get_ring(void)
+{
+    bplib_os_log_ring_t *ring;
+    uint32_t             num_rings;
+    uint32_t             expected;
+    uint32_t             i;
+
+    ring = pthread_getspecific(log_ring_key);
+    if (ring != NULL)
+    {
+        return ring;
+    }
+
+    /* take over the ring of a thread that has exited, if there is one */
+    num_rings = __atomic_load_n(&log_num_rings, __ATOMIC_ACQUIRE);
+    if (num_rings > BP_LOG_MAX_RINGS)
+    {
+        num_rings = BP_LOG_MAX_RINGS;
+    }
+
+    for (i = 0; i < num_rings && ring == NULL; ++i)
+    {
+        ring     = __atomic_load_n(&log_rings[i], __ATOMIC_ACQUIRE);
+        expected = 0;
+        if (ring != NULL &&
+            !__atomic_compare_exchange_n(&ring->in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            ring = NULL;
+        }
+    }
+
+    if (ring == NULL)
+    {
+        if (num_rings >= BP_LOG_MAX_RINGS)
+        {
+            return NULL;
+        }
+
+        i = __atomic_fetch_add(&log_num_rings, 1, __ATOMIC_RELAXED);
+        if (i >= BP_LOG_MAX_RINGS)
+        {
+            return NULL;
+        }
+
+        ring = (bplib_os_log_ring_t *)bplib_os_calloc(sizeof(bplib_os_log_ring_t));
+        if (ring == NULL)
+        {
+            return NULL;
+        }
+
+        ring->in_use = 1;
+        __atomic_store_n(&log_rings[i], ring, __ATOMIC_RELEASE);
+    }
+
+    pthread_setspecific(log_ring_key, ring);
+
+    return ring;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_enqueue - queues a record on the caller's ring without formatting it
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_enqueue(bplib_os_log_ring_t *ring, const char *file, unsigned int line, uint32_t event,
+                          const char *fmt, va_list args)
+{
+    bplib_os_log_record_t *rec;
+    va_list                capture_args;
+    const char            *pathptr;
+    uint32_t               pos;
+    size_t                 len;
+
+    pos = ring->push_count;
+    if ((pos - __atomic_load_n(&ring->pull_count, __ATOMIC_ACQUIRE)) >= BP_LOG_RING_SIZE)
+    {
+        __atomic_fetch_add(&log_not_written[(event == 0) ? 0 : (__builtin_ctz(event) + 1)], 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    rec        = &ring->records[pos & (BP_LOG_RING_SIZE - 1)];
+    rec->event = event;
+    rec->line  = line;
+
+    pathptr = bplib_os_log_basename(file);
+    len     = strnlen(pathptr, sizeof(rec->text) / 2);
+    memcpy(rec->text, pathptr, len);
+    rec->text[len] = 0;
+    rec->text_used = len + 1;
+
+    va_copy(capture_args, args);
+    rec->preformatted = !bplib_os_log_capture(rec, fmt, capture_args);
+    va_end(capture_args);
+
+    if (rec->preformatted)
+    {
+        rec->fmt_offset = len + 1;
+        vsnprintf(&rec->text[rec->fmt_offset], sizeof(rec->text) - rec->fmt_offset, fmt, args);
+    }
+
+    __atomic_store_n(&ring->push_count, pos + 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_write_now - formats and writes a record on the calling thread
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_write_now(const char *file, unsigned int line, uint32_t event, const char *fmt, va_list args)
+{
+    char formatted_string[BP_MAX_LOG_ENTRY_SIZE];
+    int  vlen, msglen;
+
+    /* Build Formatted String */
+    vlen   = vsnprintf(formatted_string, BP_MAX_LOG_ENTRY_SIZE - 1, fmt, args);
+    msglen = vlen < BP_MAX_LOG_ENTRY_SIZE - 1 ? vlen : BP_MAX_LOG_ENTRY_SIZE - 1;
+
+    /* Log Message */
+    if (msglen > 0)
+    {
+        formatted_string[msglen] = '\0';
+        bplib_os_log_emit(stderr, bplib_os_log_basename(file), line, event, formatted_string);
+    }
+
+    bplib_os_log_report_not_written(stderr);
+}
+
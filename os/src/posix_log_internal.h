@@ -0,0 +1,190 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef POSIX_LOG_INTERNAL_H
+#define POSIX_LOG_INTERNAL_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bplib.h"
+#include "bplib_os.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define BP_MAX_LOG_ENTRY_SIZE 256
+
+/*
+ * Log records are queued on a ring per thread and written to stderr by a background thread,
+ * so that a burst of events does not stall the thread that hit them.  Once a ring is full
+ * further records from that thread are dropped (and counted) until the writer catches up.
+ *
+ * The writer is started with the first record, and is detached, running until the process
+ * exits, when whatever is still queued is flushed.  It drains every ring each time it wakes,
+ * and when it finds nothing it sleeps for BP_LOG_DRAIN_INTERVAL_NS (10 ms) before looking again.
+ */
+#ifndef BP_LOG_RING_SIZE
+#define BP_LOG_RING_SIZE 64 /* must be a power of two */
+#endif
+#ifndef BP_LOG_MAX_RINGS
+#define BP_LOG_MAX_RINGS 64 /* threads beyond this log synchronously */
+#endif
+#define BP_LOG_MAX_ARGS          12
+#define BP_LOG_MAX_SPEC_SIZE     24
+#define BP_LOG_DRAIN_INTERVAL_NS 10000000
+
+/*
+ * Records logged per event flag per second, beyond which they are counted but not written.
+ * By default that is 100 records a second for each flag, diagnostics counting as a flag of
+ * their own.  How many were not written is reported by the writer for each flag.  Set to 0
+ * for no limit.
+ */
+#ifndef BP_LOG_RATE_LIMIT
+#define BP_LOG_RATE_LIMIT 100
+#endif
+#define BP_LOG_NUM_BUCKETS 33 /* one per flag bit, plus diagnostics */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef enum
+{
+    bplib_os_log_arg_int,
+    bplib_os_log_arg_long,
+    bplib_os_log_arg_llong,
+    bplib_os_log_arg_size,
+    bplib_os_log_arg_intmax,
+    bplib_os_log_arg_ptrdiff,
+    bplib_os_log_arg_double,
+    bplib_os_log_arg_ptr,
+    bplib_os_log_arg_str
+} bplib_os_log_argtype_t;
+
+typedef union
+{
+    int         i;
+    long        l;
+    long long   ll;
+    size_t      z;
+    intmax_t    j;
+    ptrdiff_t   t;
+    double      d;
+    const void *p;
+    uint16_t    str_offset; /* into the record text */
+} bplib_os_log_argval_t;
+
+/*
+ * A log entry as queued: the arguments are kept in binary and only formatted by the writer.
+ * The text holds the file name, then the format, then a copy of every string argument, so
+ * nothing the caller passed needs to outlive the call.  If the format cannot be captured
+ * this way, the text holds the formatted message instead.
+ */
+typedef struct
+{
+    uint32_t              event;
+    uint32_t              line;
+    uint16_t              fmt_offset;
+    uint16_t              text_used;
+    uint8_t               num_args;
+    uint8_t               preformatted;
+    uint8_t               arg_types[BP_LOG_MAX_ARGS];
+    bplib_os_log_argval_t args[BP_LOG_MAX_ARGS];
+    char                  text[BP_MAX_LOG_ENTRY_SIZE];
+} bplib_os_log_record_t;
+
+/* written by the owning thread only, read by the writer only */
+typedef struct
+{
+    uint32_t              in_use;
+    uint32_t              push_count;
+    uint32_t              pull_count;
+    bplib_os_log_record_t records[BP_LOG_RING_SIZE];
+} bplib_os_log_ring_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * Counts a record against the limit for its event flag, returns nonzero if it should be logged
+ */
+int bplib_os_log_rate_ok(uint32_t event);
+
+/*
+ * Writes how many records were limited or dropped for each event flag since the last time, to out
+ */
+void bplib_os_log_report_not_written(FILE *out);
+
+/*
+ * Copies the format and its arguments into a record, after whatever text it already holds.
+ * Returns nonzero if the record holds everything needed to format it later, or 0 if the
+ * caller has to format it right away.
+ */
+int bplib_os_log_capture(bplib_os_log_record_t *rec, const char *fmt, va_list args);
+
+/*
+ * Formats a record from bplib_os_log_capture() into out, which is always terminated
+ */
+void bplib_os_log_format(const bplib_os_log_record_t *rec, char *out, size_t size);
+
+/*
+ * Writes out everything queued on every ring to out, then the counts of what was not written.
+ * Returns the number of records written.
+ */
+uint32_t bplib_os_log_drain(FILE *out);
+
+/*
+ * The entry of the writer thread, which drains the rings to stderr until the process exits
+ */
+void bplib_os_log_writer(void *arg);
+
+/*
+ * Sets up the rings, this must be done once before bplib_os_log_get_ring() is called
+ */
+int bplib_os_log_init_rings(void);
+
+/*
+ * Gets the ring of the calling thread, setting one up or taking over the ring of a thread that
+ * has exited if needed.  Returns NULL if the thread has to log synchronously.
+ */
+bplib_os_log_ring_t *bplib_os_log_get_ring(void);
+
+/*
+ * Queues a record on the ring of the calling thread without formatting it, or counts it as not
+ * written if the ring is full
+ */
+void bplib_os_log_enqueue(bplib_os_log_ring_t *ring, const char *file, unsigned int line, uint32_t event,
+                          const char *fmt, va_list args);
+
+/*
+ * Formats and writes a record to stderr on the calling thread
+ */
+void bplib_os_log_write_now(const char *file, unsigned int line, uint32_t event, const char *fmt, va_list args);
+
+#endif /* POSIX_LOG_INTERNAL_H */
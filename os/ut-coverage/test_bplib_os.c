@@ -19,14 +19,23 @@
 /*
  * Includes
  */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+
 #include "utassert.h"
 #include "utstubs.h"
 #include "uttest.h"
 
+#include "bplib.h"
 #include "bplib_os.h"
 #include "bplib_cs_stdlib.h"
 #include "osapi-error.h"
 #include "osapi-clock.h"
+#include "osapi-condvar.h"
+#include "osapi-task.h"
+#include "posix_log_internal.h"
 
 static void UT_OS_GetTime_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
 {
@@ -91,6 +100,16 @@ void test_bplib_os_lock(void)
     UtAssert_VOIDCALL(bplib_os_lock(h));
 }
 
+void test_bplib_os_trylock(void)
+{
+    /* Test function for:
+     * int bplib_os_trylock(bp_handle_t h)
+     */
+    bp_handle_t h = bp_handle_from_serial(100, BPLIB_HANDLE_OS_BASE);
+
+    UtAssert_INT32_EQ(bplib_os_trylock(h), BP_SUCCESS);
+}
+
 void test_bplib_os_unlock(void)
 {
     /* Test function for:
@@ -141,6 +160,105 @@ void test_bplib_os_wait_until_ms(void)
     UtAssert_VOIDCALL(bplib_os_wait_until_ms(h, 500000000));
 }
 
+void test_bplib_os_mutex(void)
+{
+    /* Test function for:
+     * bplib_os_mutex_t *bplib_os_mutex_create(uint32_t flags)
+     * void bplib_os_mutex_destroy(bplib_os_mutex_t *mtx)
+     * and the calls on the mutex
+     */
+    uint32            buffer[16];
+    bplib_os_mutex_t *mtx;
+
+    /* allocation failure */
+    UT_SetDefaultReturnValue(UT_KEY(BPLIB_CS_calloc), -1);
+    UtAssert_NULL(bplib_os_mutex_create(0));
+    UT_ResetState(UT_KEY(BPLIB_CS_calloc));
+
+    /* condition variable failure */
+    UT_SetDataBuffer(UT_KEY(BPLIB_CS_calloc), buffer, sizeof(buffer), false);
+    UT_SetDeferredRetcode(UT_KEY(OS_CondVarCreate), 1, OS_ERROR);
+    UtAssert_NULL(bplib_os_mutex_create(BPLIB_OS_MUTEX_ADAPTIVE));
+
+    UT_SetDataBuffer(UT_KEY(BPLIB_CS_calloc), buffer, sizeof(buffer), false);
+    UtAssert_ADDRESS_EQ(mtx = bplib_os_mutex_create(BPLIB_OS_MUTEX_RECURSIVE), buffer);
+
+    UtAssert_VOIDCALL(bplib_os_mutex_lock(mtx));
+    UtAssert_INT32_EQ(bplib_os_mutex_trylock(mtx), BP_SUCCESS);
+    UtAssert_VOIDCALL(bplib_os_mutex_unlock(mtx));
+    UtAssert_VOIDCALL(bplib_os_mutex_signal(mtx));
+    UtAssert_VOIDCALL(bplib_os_mutex_broadcast(mtx));
+    UtAssert_VOIDCALL(bplib_os_mutex_broadcast_and_unlock(mtx));
+
+    UtAssert_INT32_EQ(bplib_os_mutex_wait_until_ms(mtx, BP_DTNTIME_INFINITE), BP_SUCCESS);
+    UT_SetDeferredRetcode(UT_KEY(OS_CondVarTimedWait), 1, OS_ERROR_TIMEOUT);
+    UtAssert_INT32_EQ(bplib_os_mutex_wait_until_ms(mtx, 500000000), BP_TIMEOUT);
+    UT_SetDeferredRetcode(UT_KEY(OS_CondVarTimedWait), 1, OS_ERROR);
+    UtAssert_INT32_EQ(bplib_os_mutex_wait_until_ms(mtx, 500000000), BP_ERROR);
+
+    UtAssert_VOIDCALL(bplib_os_mutex_destroy(mtx));
+}
+
+static osal_task_entry UT_TaskEntry;
+static uint32          UT_ThreadEntryCount;
+
+static void UT_OS_TaskCreate_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    UT_TaskEntry = UT_Hook_GetArgValueByName(Context, "function_pointer", osal_task_entry);
+}
+
+static void UT_ThreadEntry(void *arg)
+{
+    ++UT_ThreadEntryCount;
+}
+
+void test_bplib_os_thread(void)
+{
+    /* Test function for:
+     * bplib_os_thread_t *bplib_os_thread_create(const char *name, bplib_os_thread_entry_t entry, void *arg)
+     * int bplib_os_thread_join(bplib_os_thread_t *thr)
+     * and the calls on the thread
+     */
+    uint32             buffer[16] = {0};
+    bplib_os_thread_t *thr;
+
+    /* allocation failure */
+    UT_SetDefaultReturnValue(UT_KEY(BPLIB_CS_calloc), -1);
+    UtAssert_NULL(bplib_os_thread_create("ut", UT_ThreadEntry, NULL));
+    UT_ResetState(UT_KEY(BPLIB_CS_calloc));
+
+    /* mutex failure */
+    UT_SetDataBuffer(UT_KEY(BPLIB_CS_calloc), buffer, sizeof(buffer), false);
+    UT_SetDeferredRetcode(UT_KEY(OS_CondVarCreate), 1, OS_ERROR);
+    UtAssert_NULL(bplib_os_thread_create("ut", UT_ThreadEntry, NULL));
+
+    /* task failure */
+    UT_SetDeferredRetcode(UT_KEY(OS_TaskCreate), 1, OS_ERROR);
+    UtAssert_NULL(bplib_os_thread_create(NULL, UT_ThreadEntry, NULL));
+
+    UT_SetHandlerFunction(UT_KEY(OS_TaskCreate), UT_OS_TaskCreate_Handler, NULL);
+    UtAssert_ADDRESS_EQ(thr = bplib_os_thread_create("ut", UT_ThreadEntry, NULL), buffer);
+    UtAssert_NOT_NULL(UT_TaskEntry);
+
+    UtAssert_INT32_EQ(bplib_os_thread_set_name(thr, "ut2"), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_os_thread_set_affinity(thr, buffer, 1), BP_ERROR);
+    UtAssert_INT32_EQ(bplib_os_thread_set_priority(thr, 0), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_os_thread_set_priority(NULL, 1000), BP_SUCCESS);
+    UT_SetDeferredRetcode(UT_KEY(OS_TaskSetPriority), 1, OS_ERROR);
+    UtAssert_INT32_EQ(bplib_os_thread_set_priority(thr, 50), BP_ERROR);
+
+    /* the task finds its thread by id, runs the entry and reports that it is done */
+    UT_TaskEntry();
+    UtAssert_UINT32_EQ(UT_ThreadEntryCount, 1);
+    UtAssert_STUB_COUNT(OS_TaskExit, 1);
+    UtAssert_INT32_EQ(bplib_os_thread_join(thr), BP_SUCCESS);
+
+    /* a task which is not in the list only exits */
+    UT_TaskEntry();
+    UtAssert_UINT32_EQ(UT_ThreadEntryCount, 1);
+    UtAssert_STUB_COUNT(OS_TaskExit, 2);
+}
+
 void test_bplib_os_get_dtntime_ms(void)
 {
     /* Test function for:
@@ -150,6 +268,24 @@ void test_bplib_os_get_dtntime_ms(void)
     UtAssert_UINT32_EQ(bplib_os_get_dtntime_ms(), 1775592944);
 }
 
+void test_bplib_os_get_dtntime_coarse_ms(void)
+{
+    /* Test function for:
+     * uint64_t bplib_os_get_dtntime_coarse_ms(void)
+     */
+    UT_SetHandlerFunction(UT_KEY(OS_GetLocalTime), UT_OS_GetTime_Handler, NULL);
+    UtAssert_UINT32_EQ(bplib_os_get_dtntime_coarse_ms(), 1775592944);
+}
+
+void test_bplib_os_get_monotonic_us(void)
+{
+    /* Test function for:
+     * uint64_t bplib_os_get_monotonic_us(void)
+     */
+    UT_SetHandlerFunction(UT_KEY(OS_GetLocalTime), UT_OS_GetTime_Handler, NULL);
+    UtAssert_BOOL_TRUE(bplib_os_get_monotonic_us() == 1000000000496000);
+}
+
 void test_bplib_os_calloc_free(void)
 {
     /* Test function for:
@@ -164,6 +300,341 @@ void test_bplib_os_calloc_free(void)
     UtAssert_VOIDCALL(bplib_os_free(p));
 }
 
+void test_bplib_os_alloc_free_pool_mem(void)
+{
+    /* Test function for:
+     * void *bplib_os_alloc_pool_mem(size_t size, uint32_t flags)
+     * void bplib_os_free_pool_mem(void *ptr, size_t size)
+     */
+    uint32 buffer[16];
+    void  *p;
+
+    UT_SetDataBuffer(UT_KEY(BPLIB_CS_calloc), buffer, sizeof(buffer), false);
+    UtAssert_ADDRESS_EQ(p = bplib_os_alloc_pool_mem(sizeof(buffer), BPLIB_OS_POOLMEM_HUGEPAGE), buffer);
+    UtAssert_VOIDCALL(bplib_os_free_pool_mem(p, sizeof(buffer)));
+}
+
+void test_bplib_os_map_pool_file(void)
+{
+    /* Test function for:
+     * void *bplib_os_map_pool_file(const char *path, size_t size, bool *existed)
+     * void bplib_os_unmap_pool_file(void *ptr, size_t size)
+     */
+    bool existed;
+
+    existed = true;
+    UtAssert_NULL(bplib_os_map_pool_file("/dev/shm/bplib", 4096, &existed));
+    UtAssert_BOOL_FALSE(existed);
+    UtAssert_VOIDCALL(bplib_os_unmap_pool_file(NULL, 4096));
+}
+
+static uint32 UT_AllocBuffer[16];
+static uint32 UT_AllocCount;
+static uint32 UT_ReleaseCount;
+
+static void *UT_Alloc(void *arg, size_t size)
+{
+    ++UT_AllocCount;
+    return UT_AllocBuffer;
+}
+
+static void UT_Release(void *arg, void *ptr)
+{
+    ++UT_ReleaseCount;
+}
+
+static void *UT_AllocPool(void *arg, size_t size, uint32_t flags)
+{
+    UT_AllocCount += 10;
+    return UT_AllocBuffer;
+}
+
+static void UT_ReleasePool(void *arg, void *ptr, size_t size)
+{
+    UT_ReleaseCount += 10;
+}
+
+void test_bplib_os_set_allocator(void)
+{
+    /* Test function for:
+     * int bplib_os_set_allocator(const bplib_os_allocator_t *allocator)
+     * const bplib_os_allocator_t *bplib_os_get_allocator(void)
+     */
+    bplib_os_allocator_t allocator = {NULL, UT_Alloc, UT_Release, NULL, NULL};
+
+    UtAssert_NULL(bplib_os_get_allocator());
+
+    /* must have both halves */
+    allocator.release = NULL;
+    UtAssert_INT32_EQ(bplib_os_set_allocator(&allocator), BP_ERROR);
+    allocator.release    = UT_Release;
+    allocator.alloc_pool = UT_AllocPool;
+    UtAssert_INT32_EQ(bplib_os_set_allocator(&allocator), BP_ERROR);
+    allocator.alloc_pool = NULL;
+    UtAssert_NULL(bplib_os_get_allocator());
+
+    /* without pool calls, pool memory comes from the same place */
+    UtAssert_INT32_EQ(bplib_os_set_allocator(&allocator), BP_SUCCESS);
+    UtAssert_NOT_NULL(bplib_os_get_allocator());
+    UtAssert_ADDRESS_EQ(bplib_os_calloc(8), UT_AllocBuffer);
+    UtAssert_ADDRESS_EQ(bplib_os_alloc_pool_mem(8, 0), UT_AllocBuffer);
+    UtAssert_UINT32_EQ(UT_AllocCount, 2);
+    UtAssert_VOIDCALL(bplib_os_free(UT_AllocBuffer));
+    UtAssert_VOIDCALL(bplib_os_free(NULL));
+    UtAssert_VOIDCALL(bplib_os_free_pool_mem(UT_AllocBuffer, 8));
+    UtAssert_UINT32_EQ(UT_ReleaseCount, 2);
+
+    allocator.alloc_pool   = UT_AllocPool;
+    allocator.release_pool = UT_ReleasePool;
+    UtAssert_INT32_EQ(bplib_os_set_allocator(&allocator), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bplib_os_alloc_pool_mem(8, BPLIB_OS_POOLMEM_HUGEPAGE), UT_AllocBuffer);
+    UtAssert_UINT32_EQ(UT_AllocCount, 12);
+    UtAssert_VOIDCALL(bplib_os_free_pool_mem(UT_AllocBuffer, 8));
+    UtAssert_VOIDCALL(bplib_os_free_pool_mem(NULL, 8));
+    UtAssert_UINT32_EQ(UT_ReleaseCount, 12);
+
+    /* back to the C library */
+    UtAssert_INT32_EQ(bplib_os_set_allocator(NULL), BP_SUCCESS);
+    UtAssert_NULL(bplib_os_get_allocator());
+    UtAssert_STUB_COUNT(BPLIB_CS_calloc, 0);
+}
+
+void test_bplib_os_get_cpu_index(void)
+{
+    /* Test function for:
+     * uint32_t bplib_os_get_cpu_index(void)
+     */
+    UtAssert_ZERO(bplib_os_get_cpu_index());
+}
+
+void test_bplib_os_notifier(void)
+{
+    /* Test function for:
+     * bp_handle_t bplib_os_create_notifier(void)
+     * void bplib_os_destroy_notifier(bp_handle_t h)
+     * int bplib_os_notifier_get_fd(bp_handle_t h)
+     * void bplib_os_notifier_set(bp_handle_t h)
+     * void bplib_os_notifier_clear(bp_handle_t h)
+     */
+    bp_handle_t h;
+
+    /* not available with OSAL */
+    h = bplib_os_create_notifier();
+    UtAssert_BOOL_FALSE(bp_handle_is_valid(h));
+    UtAssert_INT32_EQ(bplib_os_notifier_get_fd(h), -1);
+    UtAssert_VOIDCALL(bplib_os_notifier_set(h));
+    UtAssert_VOIDCALL(bplib_os_notifier_clear(h));
+    UtAssert_VOIDCALL(bplib_os_destroy_notifier(h));
+}
+
+static int UT_LogCapture(bplib_os_log_record_t *rec, const char *fmt, ...)
+{
+    va_list args;
+    int     retval;
+
+    memset(rec, 0, sizeof(*rec));
+    va_start(args, fmt);
+    retval = bplib_os_log_capture(rec, fmt, args);
+    va_end(args);
+
+    return retval;
+}
+
+static void UT_LogEnqueue(bplib_os_log_ring_t *ring, unsigned int line, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    bplib_os_log_enqueue(ring, "/path/to/ut.c", line, BP_FLAG_CUSTODY_FULL, fmt, args);
+    va_end(args);
+}
+
+static bplib_os_log_ring_t *UT_LogThreadRing;
+
+static void *UT_LogThread(void *arg)
+{
+    UT_LogThreadRing = bplib_os_log_get_ring();
+    return NULL;
+}
+
+void test_bplib_os_log_format(void)
+{
+    /* Test function for:
+     * int bplib_os_log_capture(bplib_os_log_record_t *rec, const char *fmt, va_list args)
+     * void bplib_os_log_format(const bplib_os_log_record_t *rec, char *out, size_t size)
+     */
+    static bplib_os_log_record_t rec;
+    static const char            name[3] = {'a', 'b', 'c'}; /* not terminated */
+    char                         long_str[BP_MAX_LOG_ENTRY_SIZE + 8];
+    char                         expected[BP_MAX_LOG_ENTRY_SIZE];
+    char                         out[BP_MAX_LOG_ENTRY_SIZE];
+
+    /* the arguments are kept in binary and formatted later the same as printf would */
+    UtAssert_INT32_EQ(UT_LogCapture(&rec, "%.2s|%zu|%lld|%p|%-5d|%5.2f|%%|%c|%lx|%jd|%td|%hhu", name, (size_t)42,
+                                    -1234567890123LL, (void *)&rec, 7, 3.14159, 'x', 0xbeefUL, (intmax_t)-5,
+                                    (ptrdiff_t)9, (unsigned char)200),
+                      1);
+    UtAssert_UINT32_EQ(rec.num_args, 11);
+    UtAssert_UINT32_EQ(rec.arg_types[0], bplib_os_log_arg_str);
+    UtAssert_UINT32_EQ(rec.arg_types[1], bplib_os_log_arg_size);
+    UtAssert_UINT32_EQ(rec.arg_types[2], bplib_os_log_arg_llong);
+    UtAssert_UINT32_EQ(rec.arg_types[3], bplib_os_log_arg_ptr);
+    UtAssert_UINT32_EQ(rec.arg_types[5], bplib_os_log_arg_double);
+    snprintf(expected, sizeof(expected), "%.2s|%zu|%lld|%p|%-5d|%5.2f|%%|%c|%lx|%jd|%td|%hhu", name, (size_t)42,
+             -1234567890123LL, (void *)&rec, 7, 3.14159, 'x', 0xbeefUL, (intmax_t)-5, (ptrdiff_t)9,
+             (unsigned char)200);
+    bplib_os_log_format(&rec, out, sizeof(out));
+    UtAssert_STRINGBUF_EQ(out, sizeof(out), expected, sizeof(expected));
+
+    /* a precision bounds the copy, so the string need not be terminated */
+    UtAssert_INT32_EQ(UT_LogCapture(&rec, "[%.3s]", name), 1);
+    bplib_os_log_format(&rec, out, sizeof(out));
+    UtAssert_STRINGBUF_EQ(out, sizeof(out), "[abc]", UTASSERT_STRINGBUF_NULL_TERM);
+
+    UtAssert_INT32_EQ(UT_LogCapture(&rec, "%s", (const char *)NULL), 1);
+    bplib_os_log_format(&rec, out, sizeof(out));
+    UtAssert_STRINGBUF_EQ(out, sizeof(out), "(null)", UTASSERT_STRINGBUF_NULL_TERM);
+
+    /* output is cut at the buffer size */
+    UtAssert_INT32_EQ(UT_LogCapture(&rec, "%d%d", 1234, 5678), 1);
+    bplib_os_log_format(&rec, out, 6);
+    UtAssert_STRINGBUF_EQ(out, sizeof(out), "12345", UTASSERT_STRINGBUF_NULL_TERM);
+
+    /* anything the walker does not keep is left to be formatted right away */
+    UtAssert_ZERO(UT_LogCapture(&rec, "%*d", 4, 1));
+    UtAssert_ZERO(UT_LogCapture(&rec, "%Lf", (long double)1.0));
+    UtAssert_ZERO(UT_LogCapture(&rec, "%lls", "x"));
+    UtAssert_ZERO(UT_LogCapture(&rec, "%n", NULL));
+    UtAssert_ZERO(UT_LogCapture(&rec, "%d %d %d %d %d %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                13));
+    UtAssert_ZERO(UT_LogCapture(&rec, "%000000000000000000000001d", 1));
+
+    /* as are strings too long to copy, and formats too long to keep */
+    memset(long_str, 'a', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = 0;
+    UtAssert_ZERO(UT_LogCapture(&rec, "%s", long_str));
+    UtAssert_ZERO(UT_LogCapture(&rec, long_str));
+}
+
+void test_bplib_os_log_rate_ok(void)
+{
+    /* Test function for:
+     * int bplib_os_log_rate_ok(uint32_t event)
+     * void bplib_os_log_report_not_written(FILE *out)
+     */
+    char     line[BP_MAX_LOG_ENTRY_SIZE];
+    FILE    *out;
+    uint32_t i;
+
+    /* the time does not move, so everything is in the same second */
+    UT_SetHandlerFunction(UT_KEY(OS_GetLocalTime), UT_OS_GetTime_Handler, NULL);
+
+    for (i = 0; i < BP_LOG_RATE_LIMIT; ++i)
+    {
+        UtAssert_INT32_EQ(bplib_os_log_rate_ok(BP_FLAG_DUPLICATES), 1);
+    }
+    UtAssert_ZERO(bplib_os_log_rate_ok(BP_FLAG_DUPLICATES));
+    UtAssert_ZERO(bplib_os_log_rate_ok(BP_FLAG_DUPLICATES));
+
+    /* each flag has a limit of its own */
+    UtAssert_INT32_EQ(bplib_os_log_rate_ok(BP_FLAG_DIAGNOSTIC), 1);
+    UtAssert_INT32_EQ(bplib_os_log_rate_ok(BP_FLAG_UNIMPLEMENTED), 1);
+
+    /* what was not written is reported once */
+    UtAssert_NOT_NULL(out = tmpfile());
+    bplib_os_log_report_not_written(out);
+    rewind(out);
+    UtAssert_NOT_NULL(fgets(line, sizeof(line), out));
+    UtAssert_STRINGBUF_EQ(line, sizeof(line), "bplib: 2 log messages not written for event 00001000\n",
+                          UTASSERT_STRINGBUF_NULL_TERM);
+    UtAssert_NULL(fgets(line, sizeof(line), out));
+    fclose(out);
+
+    UtAssert_NOT_NULL(out = tmpfile());
+    bplib_os_log_report_not_written(out);
+    UtAssert_ZERO(ftell(out));
+    fclose(out);
+}
+
+void test_bplib_os_log_ring(void)
+{
+    /* Test function for:
+     * int bplib_os_log_init_rings(void)
+     * bplib_os_log_ring_t *bplib_os_log_get_ring(void)
+     * void bplib_os_log_enqueue(bplib_os_log_ring_t *ring, const char *file, unsigned int line, uint32_t event,
+     *                           const char *fmt, va_list args)
+     * uint32_t bplib_os_log_drain(FILE *out)
+     */
+    static bplib_os_log_ring_t ring_buffer;
+    bplib_os_log_ring_t       *ring;
+    pthread_t                  thr;
+    char                       line[BP_MAX_LOG_ENTRY_SIZE];
+    char                       expected[BP_MAX_LOG_ENTRY_SIZE];
+    FILE                      *out;
+    uint32_t                   i;
+
+    UtAssert_INT32_EQ(bplib_os_log_init_rings(), BP_SUCCESS);
+    UT_SetDataBuffer(UT_KEY(BPLIB_CS_calloc), &ring_buffer, sizeof(ring_buffer), false);
+
+    /* the first thread gets a new ring, which is given up when it exits */
+    UtAssert_ZERO(pthread_create(&thr, NULL, UT_LogThread, NULL));
+    UtAssert_ZERO(pthread_join(thr, NULL));
+    UtAssert_ADDRESS_EQ(UT_LogThreadRing, &ring_buffer);
+    UtAssert_UINT32_EQ(ring_buffer.in_use, 0);
+
+    /* the next thread takes it over instead of allocating another */
+    UT_LogThreadRing = NULL;
+    UtAssert_ZERO(pthread_create(&thr, NULL, UT_LogThread, NULL));
+    UtAssert_ZERO(pthread_join(thr, NULL));
+    UtAssert_ADDRESS_EQ(UT_LogThreadRing, &ring_buffer);
+    UtAssert_STUB_COUNT(BPLIB_CS_calloc, 1);
+
+    /* and so does this one, which keeps it */
+    UtAssert_ADDRESS_EQ(ring = bplib_os_log_get_ring(), &ring_buffer);
+    UtAssert_UINT32_EQ(ring->in_use, 1);
+    UtAssert_ADDRESS_EQ(bplib_os_log_get_ring(), ring);
+    UtAssert_STUB_COUNT(BPLIB_CS_calloc, 1);
+
+    /* fill the ring, the first record being formatted right away */
+    UT_LogEnqueue(ring, 1, "%*d\n", 5, 42);
+    UtAssert_BOOL_TRUE(ring->records[0].preformatted);
+    for (i = 1; i < BP_LOG_RING_SIZE; ++i)
+    {
+        UT_LogEnqueue(ring, i + 1, "record %u of %s\n", (unsigned int)i, "ring");
+    }
+    UtAssert_BOOL_FALSE(ring->records[1].preformatted);
+
+    /* one more does not fit, and is counted */
+    UT_LogEnqueue(ring, 0, "dropped\n");
+    UtAssert_UINT32_EQ(ring->push_count, BP_LOG_RING_SIZE);
+
+    UtAssert_NOT_NULL(out = tmpfile());
+    UtAssert_UINT32_EQ(bplib_os_log_drain(out), BP_LOG_RING_SIZE);
+    UtAssert_UINT32_EQ(ring->pull_count, BP_LOG_RING_SIZE);
+    rewind(out);
+    UtAssert_NOT_NULL(fgets(line, sizeof(line), out));
+    UtAssert_STRINGBUF_EQ(line, sizeof(line), "ut.c:1:00002000:   42\n", UTASSERT_STRINGBUF_NULL_TERM);
+    for (i = 1; i < BP_LOG_RING_SIZE; ++i)
+    {
+        snprintf(expected, sizeof(expected), "ut.c:%u:00002000:record %u of ring\n", (unsigned int)(i + 1),
+                 (unsigned int)i);
+        UtAssert_NOT_NULL(fgets(line, sizeof(line), out));
+        UtAssert_STRINGBUF_EQ(line, sizeof(line), expected, UTASSERT_STRINGBUF_NULL_TERM);
+    }
+    UtAssert_NOT_NULL(fgets(line, sizeof(line), out));
+    UtAssert_STRINGBUF_EQ(line, sizeof(line), "bplib: 1 log messages not written for event 00002000\n",
+                          UTASSERT_STRINGBUF_NULL_TERM);
+    UtAssert_NULL(fgets(line, sizeof(line), out));
+    fclose(out);
+
+    /* once drained there is room again */
+    UT_LogEnqueue(ring, 2, "again\n");
+    UtAssert_NOT_NULL(out = tmpfile());
+    UtAssert_UINT32_EQ(bplib_os_log_drain(out), 1);
+    UtAssert_UINT32_EQ(bplib_os_log_drain(out), 0);
+    fclose(out);
+}
+
 void UtTest_Setup(void)
 {
     UtTest_Add(test_bplib_os_init, NULL, NULL, "bplib_os_init");
@@ -171,11 +642,24 @@ void UtTest_Setup(void)
     UtTest_Add(test_bplib_os_createlock, NULL, NULL, "bplib_os_createlock");
     UtTest_Add(test_bplib_os_destroylock, NULL, NULL, "bplib_os_destroylock");
     UtTest_Add(test_bplib_os_lock, NULL, NULL, "bplib_os_lock");
+    UtTest_Add(test_bplib_os_trylock, NULL, NULL, "bplib_os_trylock");
     UtTest_Add(test_bplib_os_unlock, NULL, NULL, "bplib_os_unlock");
     UtTest_Add(test_bplib_os_broadcast_signal_and_unlock, NULL, NULL, "bplib_os_broadcast_signal_and_unlock");
     UtTest_Add(test_bplib_os_broadcast_signal, NULL, NULL, "bplib_os_broadcast_signal");
     UtTest_Add(test_bplib_os_signal, NULL, NULL, "bplib_os_signal");
     UtTest_Add(test_bplib_os_wait_until_ms, NULL, NULL, "bplib_os_wait_until_ms");
+    UtTest_Add(test_bplib_os_mutex, NULL, NULL, "bplib_os_mutex");
+    UtTest_Add(test_bplib_os_thread, NULL, NULL, "bplib_os_thread");
     UtTest_Add(test_bplib_os_get_dtntime_ms, NULL, NULL, "bplib_os_get_dtntime_ms");
+    UtTest_Add(test_bplib_os_get_dtntime_coarse_ms, NULL, NULL, "bplib_os_get_dtntime_coarse_ms");
+    UtTest_Add(test_bplib_os_get_monotonic_us, NULL, NULL, "bplib_os_get_monotonic_us");
     UtTest_Add(test_bplib_os_calloc_free, NULL, NULL, "bplib_os_calloc/free");
+    UtTest_Add(test_bplib_os_alloc_free_pool_mem, NULL, NULL, "bplib_os_alloc_pool_mem/free_pool_mem");
+    UtTest_Add(test_bplib_os_map_pool_file, NULL, NULL, "bplib_os_map_pool_file/unmap_pool_file");
+    UtTest_Add(test_bplib_os_set_allocator, NULL, NULL, "bplib_os_set_allocator");
+    UtTest_Add(test_bplib_os_get_cpu_index, NULL, NULL, "bplib_os_get_cpu_index");
+    UtTest_Add(test_bplib_os_notifier, NULL, NULL, "bplib_os_notifier");
+    UtTest_Add(test_bplib_os_log_format, NULL, NULL, "bplib_os_log_capture/format");
+    UtTest_Add(test_bplib_os_log_rate_ok, NULL, NULL, "bplib_os_log_rate_ok");
+    UtTest_Add(test_bplib_os_log_ring, NULL, NULL, "bplib_os_log_get_ring/enqueue/drain");
 }
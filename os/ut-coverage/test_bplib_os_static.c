@@ -0,0 +1,221 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Coverage of the static arena behind bplib_os_calloc(), which heap.c uses in place of the C
+ * library with BPLIB_STATIC_CONFIG.  This is built with a small BPLIB_STATIC_HEAP_SIZE so the
+ * arena can be filled, and every test gives back all it takes, so the next starts from empty.
+ */
+
+/*
+ * Includes
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_config.h"
+
+/* what each test takes from the arena at a time, so that a number of them fill it */
+#define UT_STATIC_CHUNK_SIZE 200
+#define UT_STATIC_MAX_CHUNKS (BPLIB_STATIC_HEAP_SIZE / UT_STATIC_CHUNK_SIZE)
+
+static void *UT_StaticChunks[UT_STATIC_MAX_CHUNKS];
+
+static uint32 UT_AllocBuffer[16];
+static uint32 UT_AllocCount;
+static uint32 UT_ReleaseCount;
+
+static void *UT_Alloc(void *arg, size_t size)
+{
+    ++UT_AllocCount;
+    return UT_AllocBuffer;
+}
+
+static void UT_Release(void *arg, void *ptr)
+{
+    ++UT_ReleaseCount;
+}
+
+/* takes chunks from the arena until it is full, returning how many it got */
+static uint32 UT_FillArena(void)
+{
+    uint32 count;
+
+    count = 0;
+    while (count < UT_STATIC_MAX_CHUNKS)
+    {
+        UT_StaticChunks[count] = bplib_os_calloc(UT_STATIC_CHUNK_SIZE);
+        if (UT_StaticChunks[count] == NULL)
+        {
+            break;
+        }
+        ++count;
+    }
+
+    return count;
+}
+
+static void UT_EmptyArena(uint32 count)
+{
+    while (count > 0)
+    {
+        --count;
+        bplib_os_free(UT_StaticChunks[count]);
+    }
+}
+
+static bool UT_IsZero(const void *ptr, size_t size)
+{
+    const uint8_t *p = ptr;
+
+    while (size > 0)
+    {
+        if (*p != 0)
+        {
+            return false;
+        }
+        ++p;
+        --size;
+    }
+
+    return true;
+}
+
+void test_bplib_os_static_calloc_free(void)
+{
+    /* Test function for:
+     * void *bplib_os_calloc(size_t size)
+     * void bplib_os_free(void *ptr)
+     */
+    uint8_t *p1;
+    uint8_t *p2;
+
+    /* each one is aligned for any type, and apart from the others */
+    UtAssert_NOT_NULL(p1 = bplib_os_calloc(UT_STATIC_CHUNK_SIZE));
+    UtAssert_NOT_NULL(p2 = bplib_os_calloc(UT_STATIC_CHUNK_SIZE));
+    UtAssert_ZERO((uintptr_t)p1 % sizeof(uintmax_t));
+    UtAssert_ZERO((uintptr_t)p2 % sizeof(uintmax_t));
+    UtAssert_True(p2 >= p1 + UT_STATIC_CHUNK_SIZE || p1 >= p2 + UT_STATIC_CHUNK_SIZE, "chunks do not overlap");
+
+    /* the first that fits is used again once it is given back */
+    UtAssert_VOIDCALL(bplib_os_free(p1));
+    UtAssert_ADDRESS_EQ(bplib_os_calloc(UT_STATIC_CHUNK_SIZE), p1);
+    UtAssert_VOIDCALL(bplib_os_free(p1));
+
+    /* nothing happens for NULL, nor for memory that was never in the arena */
+    UtAssert_VOIDCALL(bplib_os_free(NULL));
+    UtAssert_VOIDCALL(bplib_os_free(UT_AllocBuffer));
+
+    UtAssert_VOIDCALL(bplib_os_free(p2));
+}
+
+void test_bplib_os_static_zero_fill(void)
+{
+    /* Test function for:
+     * void *bplib_os_calloc(size_t size)
+     */
+    uint8_t *p;
+
+    /* what was left in a chunk is gone when it is handed out again */
+    UtAssert_NOT_NULL(p = bplib_os_calloc(UT_STATIC_CHUNK_SIZE));
+    UtAssert_BOOL_TRUE(UT_IsZero(p, UT_STATIC_CHUNK_SIZE));
+    memset(p, 0xA5, UT_STATIC_CHUNK_SIZE);
+    bplib_os_free(p);
+
+    UtAssert_ADDRESS_EQ(bplib_os_calloc(UT_STATIC_CHUNK_SIZE), p);
+    UtAssert_BOOL_TRUE(UT_IsZero(p, UT_STATIC_CHUNK_SIZE));
+    bplib_os_free(p);
+
+    /* including a larger one over chunks that were joined back together */
+    UtAssert_NOT_NULL(p = bplib_os_calloc(3 * UT_STATIC_CHUNK_SIZE));
+    UtAssert_BOOL_TRUE(UT_IsZero(p, 3 * UT_STATIC_CHUNK_SIZE));
+    bplib_os_free(p);
+}
+
+void test_bplib_os_static_exhaustion(void)
+{
+    /* Test function for:
+     * void *bplib_os_calloc(size_t size)
+     * void bplib_os_free(void *ptr)
+     */
+    uint32 count;
+    void  *p;
+
+    /* more than all of it is never handed out, even a size that would wrap around when counted in headers */
+    UtAssert_NULL(bplib_os_calloc(BPLIB_STATIC_HEAP_SIZE));
+    UtAssert_NULL(bplib_os_calloc(SIZE_MAX));
+
+    /* it holds some number of chunks, with its headers, and then there is no more */
+    count = UT_FillArena();
+    UtAssert_True(count > 0 && count < UT_STATIC_MAX_CHUNKS, "arena held %lu chunks", (unsigned long)count);
+    UtAssert_NULL(bplib_os_calloc(UT_STATIC_CHUNK_SIZE));
+
+    /* one given back can be taken again, and only that one */
+    bplib_os_free(UT_StaticChunks[count / 2]);
+    UtAssert_ADDRESS_EQ(bplib_os_calloc(UT_STATIC_CHUNK_SIZE), UT_StaticChunks[count / 2]);
+    UtAssert_NULL(bplib_os_calloc(UT_STATIC_CHUNK_SIZE));
+
+    /* and once all are given back, the chunks are joined so that most of the arena is one chunk again */
+    UT_EmptyArena(count);
+    UtAssert_NOT_NULL(p = bplib_os_calloc((count - 1) * UT_STATIC_CHUNK_SIZE));
+    bplib_os_free(p);
+    UtAssert_UINT32_EQ(UT_FillArena(), count);
+    UT_EmptyArena(count);
+}
+
+void test_bplib_os_static_allocator(void)
+{
+    /* Test function for:
+     * int bplib_os_set_allocator(const bplib_os_allocator_t *allocator)
+     * void *bplib_os_calloc(size_t size)
+     * void bplib_os_free(void *ptr)
+     */
+    bplib_os_allocator_t allocator = {NULL, UT_Alloc, UT_Release, NULL, NULL};
+    void                *p;
+
+    UtAssert_NOT_NULL(p = bplib_os_calloc(UT_STATIC_CHUNK_SIZE));
+
+    /* once set, the allocator is used instead of the arena */
+    UtAssert_INT32_EQ(bplib_os_set_allocator(&allocator), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bplib_os_calloc(UT_STATIC_CHUNK_SIZE), UT_AllocBuffer);
+    UtAssert_UINT32_EQ(UT_AllocCount, 1);
+    UtAssert_VOIDCALL(bplib_os_free(UT_AllocBuffer));
+    UtAssert_UINT32_EQ(UT_ReleaseCount, 1);
+
+    /* but what came from the arena before goes back there, and not to the allocator */
+    UtAssert_VOIDCALL(bplib_os_free(p));
+    UtAssert_UINT32_EQ(UT_ReleaseCount, 1);
+
+    UtAssert_INT32_EQ(bplib_os_set_allocator(NULL), BP_SUCCESS);
+    UtAssert_ADDRESS_EQ(bplib_os_calloc(UT_STATIC_CHUNK_SIZE), p);
+    bplib_os_free(p);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(test_bplib_os_static_calloc_free, NULL, NULL, "bplib_os_static_calloc_free");
+    UtTest_Add(test_bplib_os_static_zero_fill, NULL, NULL, "bplib_os_static_zero_fill");
+    UtTest_Add(test_bplib_os_static_exhaustion, NULL, NULL, "bplib_os_static_exhaustion");
+    UtTest_Add(test_bplib_os_static_allocator, NULL, NULL, "bplib_os_static_allocator");
+}
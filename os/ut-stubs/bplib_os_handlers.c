@@ -29,6 +29,32 @@
 #include "utstubs.h"
 #include "utgenstub.h"
 
+#include "bplib_os.h"
+
+/*----------------------------------------------------------------
+ *
+ * Unless a test sets a value for this one, it follows bplib_os_get_dtntime_ms()
+ * so tests that set the time need not care which of the two is called
+ *
+ *-----------------------------------------------------------------*/
+void UT_DefaultHandler_bplib_os_get_dtntime_coarse_ms(void *UserObj, UT_EntryKey_t FuncKey,
+                                                      const UT_StubContext_t *Context)
+{
+    int32    StatusCode;
+    uint64_t Result;
+
+    if (UT_Stub_GetInt32StatusCode(Context, &StatusCode))
+    {
+        Result = StatusCode;
+    }
+    else
+    {
+        Result = bplib_os_get_dtntime_ms();
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, Result);
+}
+
 /*----------------------------------------------------------------
  *
  * This just translates the 32-bit return status into a 64-bit
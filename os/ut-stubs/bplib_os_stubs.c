@@ -29,8 +29,26 @@
 #include "bplib_os.h"
 #include "utgenstub.h"
 
+void UT_DefaultHandler_bplib_os_get_dtntime_coarse_ms(void *, UT_EntryKey_t, const UT_StubContext_t *);
 void UT_DefaultHandler_bplib_os_get_dtntime_ms(void *, UT_EntryKey_t, const UT_StubContext_t *);
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_alloc_pool_mem()
+ * ----------------------------------------------------
+ */
+void *bplib_os_alloc_pool_mem(size_t size, uint32_t flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_alloc_pool_mem, void *);
+
+    UT_GenStub_AddParam(bplib_os_alloc_pool_mem, size_t, size);
+    UT_GenStub_AddParam(bplib_os_alloc_pool_mem, uint32_t, flags);
+
+    UT_GenStub_Execute(bplib_os_alloc_pool_mem, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_alloc_pool_mem, void *);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_broadcast_signal()
@@ -71,6 +89,20 @@ void *bplib_os_calloc(size_t size)
     return UT_GenStub_GetReturnValue(bplib_os_calloc, void *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_create_notifier()
+ * ----------------------------------------------------
+ */
+bp_handle_t bplib_os_create_notifier(void)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_create_notifier, bp_handle_t);
+
+    UT_GenStub_Execute(bplib_os_create_notifier, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_create_notifier, bp_handle_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_createlock()
@@ -85,6 +117,18 @@ bp_handle_t bplib_os_createlock(void)
     return UT_GenStub_GetReturnValue(bplib_os_createlock, bp_handle_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_destroy_notifier()
+ * ----------------------------------------------------
+ */
+void bplib_os_destroy_notifier(bp_handle_t h)
+{
+    UT_GenStub_AddParam(bplib_os_destroy_notifier, bp_handle_t, h);
+
+    UT_GenStub_Execute(bplib_os_destroy_notifier, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_destroylock()
@@ -121,6 +165,61 @@ void bplib_os_free(void *ptr)
     UT_GenStub_Execute(bplib_os_free, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_free_pool_mem()
+ * ----------------------------------------------------
+ */
+void bplib_os_free_pool_mem(void *ptr, size_t size)
+{
+    UT_GenStub_AddParam(bplib_os_free_pool_mem, void *, ptr);
+    UT_GenStub_AddParam(bplib_os_free_pool_mem, size_t, size);
+
+    UT_GenStub_Execute(bplib_os_free_pool_mem, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_get_allocator()
+ * ----------------------------------------------------
+ */
+const bplib_os_allocator_t *bplib_os_get_allocator(void)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_get_allocator, const bplib_os_allocator_t *);
+
+    UT_GenStub_Execute(bplib_os_get_allocator, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_get_allocator, const bplib_os_allocator_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_get_cpu_index()
+ * ----------------------------------------------------
+ */
+uint32_t bplib_os_get_cpu_index(void)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_get_cpu_index, uint32_t);
+
+    UT_GenStub_Execute(bplib_os_get_cpu_index, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_get_cpu_index, uint32_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_get_dtntime_coarse_ms()
+ * ----------------------------------------------------
+ */
+uint64_t bplib_os_get_dtntime_coarse_ms(void)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_get_dtntime_coarse_ms, uint64_t);
+
+    UT_GenStub_Execute(bplib_os_get_dtntime_coarse_ms, Basic, UT_DefaultHandler_bplib_os_get_dtntime_coarse_ms);
+
+    return UT_GenStub_GetReturnValue(bplib_os_get_dtntime_coarse_ms, uint64_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_get_dtntime_ms()
@@ -135,6 +234,20 @@ uint64_t bplib_os_get_dtntime_ms(void)
     return UT_GenStub_GetReturnValue(bplib_os_get_dtntime_ms, uint64_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_get_monotonic_us()
+ * ----------------------------------------------------
+ */
+uint64_t bplib_os_get_monotonic_us(void)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_get_monotonic_us, uint64_t);
+
+    UT_GenStub_Execute(bplib_os_get_monotonic_us, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_get_monotonic_us, uint64_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_init()
@@ -182,6 +295,185 @@ int bplib_os_log(const char *file, unsigned int line, uint32_t *flags, uint32_t
     return UT_GenStub_GetReturnValue(bplib_os_log, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_map_pool_file()
+ * ----------------------------------------------------
+ */
+void *bplib_os_map_pool_file(const char *path, size_t size, bool *existed)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_map_pool_file, void *);
+
+    UT_GenStub_AddParam(bplib_os_map_pool_file, const char *, path);
+    UT_GenStub_AddParam(bplib_os_map_pool_file, size_t, size);
+    UT_GenStub_AddParam(bplib_os_map_pool_file, bool *, existed);
+
+    UT_GenStub_Execute(bplib_os_map_pool_file, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_map_pool_file, void *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_broadcast()
+ * ----------------------------------------------------
+ */
+void bplib_os_mutex_broadcast(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_AddParam(bplib_os_mutex_broadcast, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_broadcast, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_broadcast_and_unlock()
+ * ----------------------------------------------------
+ */
+void bplib_os_mutex_broadcast_and_unlock(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_AddParam(bplib_os_mutex_broadcast_and_unlock, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_broadcast_and_unlock, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_create()
+ * ----------------------------------------------------
+ */
+bplib_os_mutex_t *bplib_os_mutex_create(uint32_t flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_mutex_create, bplib_os_mutex_t *);
+
+    UT_GenStub_AddParam(bplib_os_mutex_create, uint32_t, flags);
+
+    UT_GenStub_Execute(bplib_os_mutex_create, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_mutex_create, bplib_os_mutex_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_destroy()
+ * ----------------------------------------------------
+ */
+void bplib_os_mutex_destroy(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_AddParam(bplib_os_mutex_destroy, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_destroy, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_lock()
+ * ----------------------------------------------------
+ */
+void bplib_os_mutex_lock(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_AddParam(bplib_os_mutex_lock, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_lock, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_signal()
+ * ----------------------------------------------------
+ */
+void bplib_os_mutex_signal(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_AddParam(bplib_os_mutex_signal, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_signal, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_trylock()
+ * ----------------------------------------------------
+ */
+int bplib_os_mutex_trylock(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_mutex_trylock, int);
+
+    UT_GenStub_AddParam(bplib_os_mutex_trylock, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_trylock, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_mutex_trylock, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_unlock()
+ * ----------------------------------------------------
+ */
+void bplib_os_mutex_unlock(bplib_os_mutex_t *mtx)
+{
+    UT_GenStub_AddParam(bplib_os_mutex_unlock, bplib_os_mutex_t *, mtx);
+
+    UT_GenStub_Execute(bplib_os_mutex_unlock, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_mutex_wait_until_ms()
+ * ----------------------------------------------------
+ */
+int bplib_os_mutex_wait_until_ms(bplib_os_mutex_t *mtx, uint64_t abs_dtntime_ms)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_mutex_wait_until_ms, int);
+
+    UT_GenStub_AddParam(bplib_os_mutex_wait_until_ms, bplib_os_mutex_t *, mtx);
+    UT_GenStub_AddParam(bplib_os_mutex_wait_until_ms, uint64_t, abs_dtntime_ms);
+
+    UT_GenStub_Execute(bplib_os_mutex_wait_until_ms, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_mutex_wait_until_ms, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_notifier_clear()
+ * ----------------------------------------------------
+ */
+void bplib_os_notifier_clear(bp_handle_t h)
+{
+    UT_GenStub_AddParam(bplib_os_notifier_clear, bp_handle_t, h);
+
+    UT_GenStub_Execute(bplib_os_notifier_clear, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_notifier_get_fd()
+ * ----------------------------------------------------
+ */
+int bplib_os_notifier_get_fd(bp_handle_t h)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_notifier_get_fd, int);
+
+    UT_GenStub_AddParam(bplib_os_notifier_get_fd, bp_handle_t, h);
+
+    UT_GenStub_Execute(bplib_os_notifier_get_fd, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_notifier_get_fd, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_notifier_set()
+ * ----------------------------------------------------
+ */
+void bplib_os_notifier_set(bp_handle_t h)
+{
+    UT_GenStub_AddParam(bplib_os_notifier_set, bp_handle_t, h);
+
+    UT_GenStub_Execute(bplib_os_notifier_set, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_random()
@@ -196,6 +488,22 @@ uint32_t bplib_os_random(void)
     return UT_GenStub_GetReturnValue(bplib_os_random, uint32_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_set_allocator()
+ * ----------------------------------------------------
+ */
+int bplib_os_set_allocator(const bplib_os_allocator_t *allocator)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_set_allocator, int);
+
+    UT_GenStub_AddParam(bplib_os_set_allocator, const bplib_os_allocator_t *, allocator);
+
+    UT_GenStub_Execute(bplib_os_set_allocator, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_set_allocator, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_signal()
@@ -236,6 +544,108 @@ int bplib_os_systime(unsigned long *sysnow)
     return UT_GenStub_GetReturnValue(bplib_os_systime, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_thread_create()
+ * ----------------------------------------------------
+ */
+bplib_os_thread_t *bplib_os_thread_create(const char *name, bplib_os_thread_entry_t entry, void *arg)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_thread_create, bplib_os_thread_t *);
+
+    UT_GenStub_AddParam(bplib_os_thread_create, const char *, name);
+    UT_GenStub_AddParam(bplib_os_thread_create, bplib_os_thread_entry_t, entry);
+    UT_GenStub_AddParam(bplib_os_thread_create, void *, arg);
+
+    UT_GenStub_Execute(bplib_os_thread_create, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_thread_create, bplib_os_thread_t *);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_thread_join()
+ * ----------------------------------------------------
+ */
+int bplib_os_thread_join(bplib_os_thread_t *thr)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_thread_join, int);
+
+    UT_GenStub_AddParam(bplib_os_thread_join, bplib_os_thread_t *, thr);
+
+    UT_GenStub_Execute(bplib_os_thread_join, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_thread_join, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_thread_set_affinity()
+ * ----------------------------------------------------
+ */
+int bplib_os_thread_set_affinity(bplib_os_thread_t *thr, const uint32_t *cpus, uint32_t num_cpus)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_thread_set_affinity, int);
+
+    UT_GenStub_AddParam(bplib_os_thread_set_affinity, bplib_os_thread_t *, thr);
+    UT_GenStub_AddParam(bplib_os_thread_set_affinity, const uint32_t *, cpus);
+    UT_GenStub_AddParam(bplib_os_thread_set_affinity, uint32_t, num_cpus);
+
+    UT_GenStub_Execute(bplib_os_thread_set_affinity, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_thread_set_affinity, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_thread_set_name()
+ * ----------------------------------------------------
+ */
+int bplib_os_thread_set_name(bplib_os_thread_t *thr, const char *name)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_thread_set_name, int);
+
+    UT_GenStub_AddParam(bplib_os_thread_set_name, bplib_os_thread_t *, thr);
+    UT_GenStub_AddParam(bplib_os_thread_set_name, const char *, name);
+
+    UT_GenStub_Execute(bplib_os_thread_set_name, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_thread_set_name, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_thread_set_priority()
+ * ----------------------------------------------------
+ */
+int bplib_os_thread_set_priority(bplib_os_thread_t *thr, uint32_t rt_priority)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_thread_set_priority, int);
+
+    UT_GenStub_AddParam(bplib_os_thread_set_priority, bplib_os_thread_t *, thr);
+    UT_GenStub_AddParam(bplib_os_thread_set_priority, uint32_t, rt_priority);
+
+    UT_GenStub_Execute(bplib_os_thread_set_priority, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_thread_set_priority, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_trylock()
+ * ----------------------------------------------------
+ */
+int bplib_os_trylock(bp_handle_t h)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_os_trylock, int);
+
+    UT_GenStub_AddParam(bplib_os_trylock, bp_handle_t, h);
+
+    UT_GenStub_Execute(bplib_os_trylock, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_os_trylock, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_unlock()
@@ -248,6 +658,19 @@ void bplib_os_unlock(bp_handle_t h)
     UT_GenStub_Execute(bplib_os_unlock, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_os_unmap_pool_file()
+ * ----------------------------------------------------
+ */
+void bplib_os_unmap_pool_file(void *ptr, size_t size)
+{
+    UT_GenStub_AddParam(bplib_os_unmap_pool_file, void *, ptr);
+    UT_GenStub_AddParam(bplib_os_unmap_pool_file, size_t, size);
+
+    UT_GenStub_Execute(bplib_os_unmap_pool_file, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_os_wait_until_ms()
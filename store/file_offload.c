@@ -23,20 +23,43 @@
  ******************************************************************************/
 
 #include "bplib.h"
+#include "bplib_os.h"
 #include "v7_cache.h"
 #include "v7_mpool_ref.h"
 #include "v7_mpool_bblocks.h"
 #include "v7_mpstream.h"
+#include "v7_decode.h"
+#include "lz.h"
+#include "file_offload_internal.h"
 
 /* for now this uses POSIX files directly */
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
 #define BPLIB_FILE_PATH_SIZE     128
 #define BPLIB_FILE_OFFLOAD_MAGIC 0xdb5e774e
 
+/* payloads smaller than this are not worth the time to try to compress */
+#define BPLIB_FILE_OFFLOAD_COMPRESS_MIN 256
+
+/* pieces of a record written by one call, beyond this a record takes more than one */
+#define BPLIB_FILE_OFFLOAD_IOV_COUNT 64
+
+/*
+ * Released records are deleted by a thread of the module rather than in the release call, a batch
+ * at a time, so that a custody acknowledgement does not wait on the file system.  The thread wakes
+ * when a batch has built up, or after the wait if fewer are queued.  Should the queue fill, the
+ * release deletes its record itself.  The batch and the wait are the defaults of the config keys.
+ */
+#define BPLIB_FILE_OFFLOAD_RELEASE_BATCH     32
+#define BPLIB_FILE_OFFLOAD_RELEASE_QUEUE     4096
+#define BPLIB_FILE_OFFLOAD_RELEASE_CHUNK     64
+#define BPLIB_FILE_OFFLOAD_RELEASE_WAIT_MSEC 100
+
 static bplib_mpool_block_t *bplib_file_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg);
 static int bplib_file_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
                                         const void *val);
@@ -47,21 +70,50 @@ static int bplib_file_offload_stop(bplib_mpool_block_t *svc);
 static int bplib_file_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
 static int bplib_file_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out);
 static int bplib_file_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid);
+static void bplib_file_offload_release_entry(void *arg);
 
 typedef struct bplib_file_offload_state
 {
     char     base_dir[BPLIB_FILE_PATH_SIZE];
     bp_sid_t last_sid;
+    int      compress; /**< set by bplib_cache_confkey_offload_compress */
+
+    /* directories already made under base_dir, so offloads skip the mkdir() calls */
+    uint8_t made_top_mask[32];
+    uint8_t made_sub_mask[32];
+    uint8_t made_sub_dir;
+
+    /* releases waiting to be deleted by release_thread, a ring of release_queue_size */
+    uint32_t           release_batch; /**< set by bplib_cache_confkey_offload_delete_batch */
+    uint32_t           release_wait;  /**< set by bplib_cache_confkey_offload_delete_wait */
+    bplib_os_mutex_t  *release_lock;
+    bplib_os_thread_t *release_thread;
+    bool               release_running;
+    bp_sid_t          *release_queue;
+    uint32_t           release_head;
+    uint32_t           release_count;
 
 } bplib_file_offload_state_t;
 
-typedef struct bplib_file_offload_record
+/*
+ * The pieces of a record are gathered here, where they are in the bundle blocks, and written together
+ * rather than with a write() each.
+ */
+typedef struct bplib_file_offload_writer
 {
-    uint32_t check_val;
-    uint32_t num_blocks;
-    uint32_t num_bytes;
-    uint32_t crc;
-} bplib_file_offload_record_t;
+    int                          fd;
+    uint8_t                     *buf;      /**< when not NULL, the record goes here rather than to fd */
+    size_t                       buf_size;
+    off_t                        start_pos; /**< where the header goes */
+    off_t                        data_pos;  /**< where the gathered pieces go */
+    bplib_file_offload_record_t *rec;
+    struct iovec                 iov[BPLIB_FILE_OFFLOAD_IOV_COUNT];
+    int                          iov_count;
+    size_t                       iov_bytes;
+    uint32_t                     raw_size; /**< of a compressed payload, which is written ahead of it */
+    uint8_t                     *packed;   /**< the compressed payload, until it is written */
+
+} bplib_file_offload_writer_t;
 
 static const bplib_cache_offload_api_t BPLIB_FILE_OFFLOAD_INTERNAL_API = {
     .std.module_type = bplib_cache_module_type_offload,
@@ -79,6 +131,17 @@ const bplib_cache_module_api_t *BPLIB_FILE_OFFLOAD_API =
 
 int bplib_file_offload_construct_block(void *arg, bplib_mpool_block_t *blk)
 {
+    bplib_file_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_FILE_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    state->release_batch = BPLIB_FILE_OFFLOAD_RELEASE_BATCH;
+    state->release_wait  = BPLIB_FILE_OFFLOAD_RELEASE_WAIT_MSEC;
+
     return BP_SUCCESS;
 }
 
@@ -112,6 +175,27 @@ int bplib_file_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_
                 state->base_dir[sizeof(state->base_dir) - 1] = 0;
                 result                                       = BP_SUCCESS;
                 break;
+
+            case bplib_cache_confkey_offload_compress:
+                state->compress = *((const int *)val);
+                result          = BP_SUCCESS;
+                break;
+
+            case bplib_cache_confkey_offload_delete_batch:
+                if (*((const int *)val) >= 0)
+                {
+                    state->release_batch = *((const int *)val);
+                    result               = BP_SUCCESS;
+                }
+                break;
+
+            case bplib_cache_confkey_offload_delete_wait:
+                if (*((const int *)val) > 0)
+                {
+                    state->release_wait = *((const int *)val);
+                    result              = BP_SUCCESS;
+                }
+                break;
         }
     }
 
@@ -141,104 +225,322 @@ int bplib_file_offload_start(bplib_mpool_block_t *svc)
         }
     }
 
+    /*
+     * Without the thread, or with a batch of 0, each release deletes its own record as it always did
+     */
+    if (result == BP_SUCCESS && state->release_batch > 0 && state->release_thread == NULL)
+    {
+        state->release_queue = bplib_os_calloc(BPLIB_FILE_OFFLOAD_RELEASE_QUEUE * sizeof(bp_sid_t));
+        state->release_lock  = bplib_os_mutex_create(0);
+        if (state->release_queue != NULL && state->release_lock != NULL)
+        {
+            state->release_head    = 0;
+            state->release_count   = 0;
+            state->release_running = true;
+            state->release_thread  = bplib_os_thread_create("file_offload", bplib_file_offload_release_entry, state);
+        }
+
+        if (state->release_thread == NULL)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to start file offload release thread, deleting inline\n");
+            state->release_running = false;
+            if (state->release_lock != NULL)
+            {
+                bplib_os_mutex_destroy(state->release_lock);
+                state->release_lock = NULL;
+            }
+            bplib_os_free(state->release_queue);
+            state->release_queue = NULL;
+        }
+    }
+
     return result;
 }
 int bplib_file_offload_stop(bplib_mpool_block_t *svc)
 {
+    bplib_file_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FILE_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* the thread deletes whatever is still queued before it returns */
+    if (state->release_thread != NULL)
+    {
+        bplib_os_mutex_lock(state->release_lock);
+        state->release_running = false;
+        bplib_os_mutex_signal(state->release_lock);
+        bplib_os_mutex_unlock(state->release_lock);
+
+        bplib_os_thread_join(state->release_thread);
+        bplib_os_mutex_destroy(state->release_lock);
+        bplib_os_free(state->release_queue);
+
+        state->release_thread = NULL;
+        state->release_lock   = NULL;
+        state->release_queue  = NULL;
+    }
+
     return 0;
 }
 
+static bool bplib_file_offload_make_dir(const char *dir_name)
+{
+    if (mkdir(dir_name, 0755) != 0 && errno != EEXIST)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "mkdir(%s): %s\n", dir_name, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
 static void bplib_file_offload_sid_to_name(bplib_file_offload_state_t *state, char *name_buf, size_t name_sz,
                                            bp_sid_t sid, bool create_dirs)
 {
-    char *p;
-    int   result;
-    char *pd1;
-    char *pd2;
+    int      result;
+    uint8_t  top_dir;
+    uint8_t  sub_dir;
+    uint8_t  mask;
+    uint32_t path_len;
 
-    result = snprintf(name_buf, name_sz, "%s/%02x/%02x/%08x.dat", state->base_dir, (unsigned int)((sid >> 0) & 0xFF),
-                      (unsigned int)((sid >> 8) & 0xFF), (unsigned int)((sid >> 16) & 0xFFFFFFFF));
+    top_dir = (sid >> 0) & 0xFF;
+    sub_dir = (sid >> 8) & 0xFF;
+
+    result = snprintf(name_buf, name_sz, "%s/%02x/%02x/%08x.dat", state->base_dir, (unsigned int)top_dir,
+                      (unsigned int)sub_dir, (unsigned int)((sid >> 16) & 0xFFFFFFFF));
 
     if (result > 0 && result < name_sz && create_dirs)
     {
-        pd1 = NULL;
-        pd2 = NULL;
-        p   = name_buf + result;
-        while (p > name_buf)
+        /*
+         * Only the directories not already known to exist are created.  Sids are
+         * handed out in sequence, so the top level directories all get made in the
+         * first 256 offloads and the second level fills in one sub_dir at a time,
+         * which needs one set of bits for the sub_dir currently being filled.
+         */
+        if (sub_dir != state->made_sub_dir)
         {
-            --p;
-            if (*p == '/')
-            {
-                if (pd1 == NULL)
-                {
-                    pd1 = p;
-                }
-                else if (pd2 == NULL)
-                {
-                    pd2 = p;
-                }
-                else
-                {
-                    break;
-                }
-            }
+            memset(state->made_sub_mask, 0, sizeof(state->made_sub_mask));
+            state->made_sub_dir = sub_dir;
         }
 
-        if (pd2 != NULL)
+        mask     = 1 << (top_dir & 0x7);
+        path_len = strlen(state->base_dir);
+
+        if ((state->made_top_mask[top_dir >> 3] & mask) == 0)
         {
-            *pd2   = 0;
-            result = mkdir(name_buf, 0755);
-            if (result != 0)
+            name_buf[path_len + 3] = 0;
+            if (bplib_file_offload_make_dir(name_buf))
             {
-                bplog(NULL, BP_FLAG_DIAGNOSTIC, "mkdir(%s): %s\n", name_buf, strerror(errno));
+                state->made_top_mask[top_dir >> 3] |= mask;
             }
-            *pd2 = '/';
+            name_buf[path_len + 3] = '/';
         }
-        if (pd1 != NULL)
+
+        if ((state->made_sub_mask[top_dir >> 3] & mask) == 0)
         {
-            *pd1   = 0;
-            result = mkdir(name_buf, 0755);
-            if (result != 0)
+            name_buf[path_len + 6] = 0;
+            if (bplib_file_offload_make_dir(name_buf))
             {
-                bplog(NULL, BP_FLAG_DIAGNOSTIC, "mkdir(%s): %s\n", name_buf, strerror(errno));
+                state->made_sub_mask[top_dir >> 3] |= mask;
             }
-            *pd1 = '/';
+            name_buf[path_len + 6] = '/';
         }
     }
 }
 
-static int bplib_file_offload_write_block_content(int fd, bplib_file_offload_record_t *rec, const void *ptr, size_t sz)
+/*
+ * The release thread, which deletes the queued records a chunk at a time with the lock dropped, so that
+ * releases can be queued while it works.  Once stopped, it empties the queue and returns.
+ */
+static void bplib_file_offload_release_entry(void *arg)
 {
-    ssize_t res;
-    int     status;
+    char                        bundle_file[BPLIB_FILE_PATH_SIZE];
+    bplib_file_offload_state_t *state;
+    bp_sid_t                    chunk[BPLIB_FILE_OFFLOAD_RELEASE_CHUNK];
+    uint32_t                    count;
+    uint32_t                    i;
 
-    if (ptr == NULL)
+    state = arg;
+
+    bplib_os_mutex_lock(state->release_lock);
+    while (true)
+    {
+        if (state->release_running && state->release_count < state->release_batch)
+        {
+            bplib_os_mutex_wait_until_ms(state->release_lock, bplib_os_get_dtntime_ms() + state->release_wait);
+        }
+
+        count = state->release_count;
+        if (count > BPLIB_FILE_OFFLOAD_RELEASE_CHUNK)
+        {
+            count = BPLIB_FILE_OFFLOAD_RELEASE_CHUNK;
+        }
+
+        if (count == 0 && !state->release_running)
+        {
+            break;
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            chunk[i]            = state->release_queue[state->release_head];
+            state->release_head = (state->release_head + 1) % BPLIB_FILE_OFFLOAD_RELEASE_QUEUE;
+        }
+        state->release_count -= count;
+
+        bplib_os_mutex_unlock(state->release_lock);
+
+        for (i = 0; i < count; ++i)
+        {
+            bplib_file_offload_sid_to_name(state, bundle_file, sizeof(bundle_file), chunk[i], false);
+            unlink(bundle_file);
+        }
+
+        bplib_os_mutex_lock(state->release_lock);
+    }
+    bplib_os_mutex_unlock(state->release_lock);
+}
+
+/*
+ * Writes what has been gathered.  Slot 0 is for the header, which is only filled in by the last
+ * call, once the size and CRC are known.  Until a record needs more pieces than there are slots
+ * it all goes in that one call, otherwise the pieces so far are written ahead of the header.
+ */
+static int bplib_file_offload_writer_flush(bplib_file_offload_writer_t *w, bool last)
+{
+    const struct iovec *iov;
+    size_t              expect;
+    off_t               pos;
+    int                 iov_count;
+
+    iov       = &w->iov[1];
+    iov_count = w->iov_count - 1;
+    expect    = w->iov_bytes;
+    pos       = w->data_pos;
+
+    if (last)
+    {
+        w->rec->crc        = bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, w->rec->crc);
+        w->iov[0].iov_base = w->rec;
+        w->iov[0].iov_len  = sizeof(*w->rec);
+
+        if (w->data_pos == w->start_pos + (off_t)sizeof(*w->rec))
+        {
+            iov = w->iov;
+            ++iov_count;
+            expect += sizeof(*w->rec);
+            pos = w->start_pos;
+        }
+        else if (pwrite(w->fd, w->rec, sizeof(*w->rec), w->start_pos) != sizeof(*w->rec))
+        {
+            return bplog(NULL, BP_FLAG_DIAGNOSTIC, "pwrite(): %s\n", strerror(errno));
+        }
+    }
+
+    if (iov_count > 0 && pwritev(w->fd, iov, iov_count, pos) != (ssize_t)expect)
     {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "pwritev(): %s\n", strerror(errno));
+    }
+
+    w->data_pos += w->iov_bytes;
+    w->iov_count = 1;
+    w->iov_bytes = 0;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * The same as bplib_file_offload_writer_flush(), for a record put together in memory.  The
+ * pieces are copied where they go, so it does not matter which comes first.
+ */
+static int bplib_file_offload_writer_copy(bplib_file_offload_writer_t *w, bool last)
+{
+    size_t pos;
+    int    i;
+
+    pos = (size_t)w->data_pos;
+    if (pos + w->iov_bytes > w->buf_size)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Stored record does not fit in %lu bytes\n", (unsigned long)w->buf_size);
         return BP_ERROR;
     }
 
-    rec->num_bytes += sz;
-    rec->crc = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, rec->crc, ptr, sz);
+    for (i = 1; i < w->iov_count; ++i)
+    {
+        memcpy(&w->buf[pos], w->iov[i].iov_base, w->iov[i].iov_len);
+        pos += w->iov[i].iov_len;
+    }
 
-    res = write(fd, ptr, sz);
-    if (res == sz)
+    if (last)
     {
-        status = BP_SUCCESS;
+        w->rec->crc = bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, w->rec->crc);
+        memcpy(&w->buf[w->start_pos], w->rec, sizeof(*w->rec));
     }
-    else
+
+    w->data_pos += w->iov_bytes;
+    w->iov_count = 1;
+    w->iov_bytes = 0;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Adds a piece to be written, which the caller has already counted in the size and CRC of the record
+ */
+static int bplib_file_offload_write_piece(bplib_file_offload_writer_t *w, const void *ptr, size_t sz)
+{
+    int write_status;
+
+    if (sz == 0)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "write(): %s\n", strerror(errno));
-        status = BP_ERROR;
+        return BP_SUCCESS;
     }
 
-    return status;
+    if (w->iov_count == BPLIB_FILE_OFFLOAD_IOV_COUNT)
+    {
+        if (w->buf != NULL)
+        {
+            write_status = bplib_file_offload_writer_copy(w, false);
+        }
+        else
+        {
+            write_status = bplib_file_offload_writer_flush(w, false);
+        }
+
+        if (write_status != BP_SUCCESS)
+        {
+            return BP_ERROR;
+        }
+    }
+
+    /* the pieces are not copied, they stay where they are until the record is written */
+    w->iov[w->iov_count].iov_base = (void *)ptr;
+    w->iov[w->iov_count].iov_len  = sz;
+    ++w->iov_count;
+    w->iov_bytes += sz;
+
+    return BP_SUCCESS;
 }
 
-static int bplib_file_offload_read_block_content(int fd, bplib_file_offload_record_t *rec, void *ptr, size_t sz)
+static int bplib_file_offload_write_block_content(bplib_file_offload_writer_t *w, const void *ptr, size_t sz)
 {
-    ssize_t res;
-    int     status;
+    if (ptr == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    w->rec->num_bytes += sz;
+    w->rec->crc = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, w->rec->crc, ptr, sz);
+
+    return bplib_file_offload_write_piece(w, ptr, sz);
+}
 
+static int bplib_file_offload_read_block_content(const uint8_t **src, bplib_file_offload_record_t *rec, void *ptr,
+                                                 size_t sz)
+{
     if (ptr == NULL)
     {
         return BP_ERROR;
@@ -251,57 +553,160 @@ static int bplib_file_offload_read_block_content(int fd, bplib_file_offload_reco
 
     rec->num_bytes -= sz;
 
-    res = read(fd, ptr, sz);
-    if (res == sz)
-    {
-        status   = BP_SUCCESS;
-        rec->crc = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, rec->crc, ptr, sz);
-    }
-    else
+    memcpy(ptr, *src, sz);
+    rec->crc = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, rec->crc, *src, sz);
+    *src += sz;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_file_offload_write_chunks(bplib_file_offload_writer_t *w, bplib_mpool_bblock_canonical_t *c_block)
+{
+    bplib_mpool_list_iter_t it;
+    const void             *chunk;
+    int                     iter_stat;
+    int                     write_status;
+
+    /* the CRC is taken over the whole list in one call, then the chunks are gathered as they are */
+    w->rec->num_bytes += bplib_mpool_bblock_cbor_crc_update(&c_block->chunk_list, &BPLIB_CRC32_CASTAGNOLI,
+                                                            &w->rec->crc, 0, SIZE_MAX);
+
+    write_status = BP_SUCCESS;
+    iter_stat    = bplib_mpool_list_iter_goto_first(&c_block->chunk_list, &it);
+    while (write_status == BP_SUCCESS && iter_stat == BP_SUCCESS)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "write(): %s\n", strerror(errno));
-        status = BP_ERROR;
+        chunk = bplib_mpool_bblock_cbor_cast(it.position);
+        if (chunk == NULL)
+        {
+            return BP_ERROR;
+        }
+
+        write_status = bplib_file_offload_write_piece(w, chunk, bplib_mpool_get_user_content_size(it.position));
+        iter_stat    = bplib_mpool_list_iter_forward(&it);
     }
 
-    return status;
+    return write_status;
 }
 
-static int bplib_file_offload_write_payload(int fd, bplib_file_offload_record_t *rec,
-                                            bplib_mpool_bblock_canonical_t *c_block)
+/*
+ * The chunks are put together to be compressed as one, as matches can span them.  If that is not
+ * worth it the flag is cleared and they are written as they are, so the record is never bigger.
+ */
+static int bplib_file_offload_write_compressed(bplib_file_offload_writer_t *w, bplib_mpool_bblock_canonical_t *c_block)
 {
     bplib_mpool_list_iter_t it;
+    uint8_t                *raw;
+    uint8_t                *packed;
+    uint32_t                raw_size;
+    size_t                  packed_size;
+    size_t                  chunk_sz;
     int                     iter_stat;
     int                     write_status;
 
-    write_status = bplib_file_offload_write_block_content(fd, rec, &c_block->block_encode_size_cache,
+    raw_size  = 0;
+    iter_stat = bplib_mpool_list_iter_goto_first(&c_block->chunk_list, &it);
+    while (iter_stat == BP_SUCCESS)
+    {
+        raw_size += bplib_mpool_get_user_content_size(it.position);
+        iter_stat = bplib_mpool_list_iter_forward(&it);
+    }
+
+    raw         = NULL;
+    packed      = NULL;
+    packed_size = 0;
+    if (raw_size >= BPLIB_FILE_OFFLOAD_COMPRESS_MIN)
+    {
+        raw    = bplib_os_calloc(raw_size);
+        packed = bplib_os_calloc(raw_size);
+    }
+
+    if (raw != NULL && packed != NULL)
+    {
+        chunk_sz  = 0;
+        iter_stat = bplib_mpool_list_iter_goto_first(&c_block->chunk_list, &it);
+        while (iter_stat == BP_SUCCESS)
+        {
+            memcpy(&raw[chunk_sz], bplib_mpool_bblock_cbor_cast(it.position),
+                   bplib_mpool_get_user_content_size(it.position));
+            chunk_sz += bplib_mpool_get_user_content_size(it.position);
+            iter_stat = bplib_mpool_list_iter_forward(&it);
+        }
+
+        /* it has to save at least a sixteenth to be worth decompressing on every restore */
+        if (bplib_lz_is_compressible(raw, raw_size))
+        {
+            packed_size = bplib_lz_compress(raw, raw_size, packed, raw_size - (raw_size / 16));
+        }
+    }
+
+    if (raw != NULL)
+    {
+        bplib_os_free(raw);
+    }
+
+    if (packed_size != 0)
+    {
+        /* both are written from the writer, which frees the buffer once the record is written */
+        w->raw_size  = raw_size;
+        w->packed    = packed;
+        write_status = bplib_file_offload_write_block_content(w, &w->raw_size, sizeof(w->raw_size));
+        if (write_status == BP_SUCCESS)
+        {
+            write_status = bplib_file_offload_write_block_content(w, packed, packed_size);
+        }
+    }
+    else
+    {
+        if (packed != NULL)
+        {
+            bplib_os_free(packed);
+        }
+
+        w->rec->flags &= ~BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED;
+        write_status = bplib_file_offload_write_chunks(w, c_block);
+    }
+
+    return write_status;
+}
+
+static int bplib_file_offload_write_payload(bplib_file_offload_writer_t *w, bplib_mpool_bblock_canonical_t *c_block)
+{
+    int write_status;
+
+    write_status = bplib_file_offload_write_block_content(w, &c_block->block_encode_size_cache,
                                                           sizeof(c_block->block_encode_size_cache));
     if (write_status == BP_SUCCESS)
     {
-        write_status = bplib_file_offload_write_block_content(fd, rec, &c_block->encoded_content_length,
+        write_status = bplib_file_offload_write_block_content(w, &c_block->encoded_content_length,
                                                               sizeof(c_block->encoded_content_length));
     }
     if (write_status == BP_SUCCESS)
     {
-        write_status = bplib_file_offload_write_block_content(fd, rec, &c_block->encoded_content_offset,
+        write_status = bplib_file_offload_write_block_content(w, &c_block->encoded_content_offset,
                                                               sizeof(c_block->encoded_content_offset));
     }
 
-    iter_stat = bplib_mpool_list_iter_goto_first(&c_block->chunk_list, &it);
-    while (write_status == BP_SUCCESS && iter_stat == BP_SUCCESS)
+    if (write_status == BP_SUCCESS)
     {
-        write_status = bplib_file_offload_write_block_content(fd, rec, bplib_mpool_bblock_cbor_cast(it.position),
-                                                              bplib_mpool_get_user_content_size(it.position));
-        iter_stat    = bplib_mpool_list_iter_forward(&it);
+        if ((w->rec->flags & BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED) != 0)
+        {
+            write_status = bplib_file_offload_write_compressed(w, c_block);
+        }
+        else
+        {
+            write_status = bplib_file_offload_write_chunks(w, c_block);
+        }
     }
 
     return write_status;
 }
 
-static int bplib_file_offload_write_blocks(int fd, bplib_file_offload_record_t *rec, bplib_mpool_block_t *blk)
+static int bplib_file_offload_write_blocks(bplib_file_offload_writer_t *w, bplib_mpool_block_t *blk)
 {
     bplib_mpool_bblock_primary_t   *pri_block;
     bplib_mpool_bblock_canonical_t *c_block;
     bplib_mpool_list_iter_t         it;
+    uint16_t                        compress_flag;
     int                             iter_stat;
     int                             write_status;
 
@@ -312,8 +717,12 @@ static int bplib_file_offload_write_blocks(int fd, bplib_file_offload_record_t *
         return BP_ERROR;
     }
 
-    ++rec->num_blocks;
-    write_status = bplib_file_offload_write_block_content(fd, rec, &pri_block->data, sizeof(pri_block->data));
+    /* only the payload is compressed, so without one the flag is not kept */
+    compress_flag = w->rec->flags & BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED;
+    w->rec->flags &= ~BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED;
+
+    ++w->rec->num_blocks;
+    write_status = bplib_file_offload_write_block_content(w, &pri_block->data, sizeof(pri_block->data));
 
     iter_stat = bplib_mpool_list_iter_goto_first(&pri_block->cblock_list, &it);
     while (write_status == BP_SUCCESS && iter_stat == BP_SUCCESS)
@@ -322,20 +731,26 @@ static int bplib_file_offload_write_blocks(int fd, bplib_file_offload_record_t *
         iter_stat = bplib_mpool_list_iter_forward(&it);
         if (c_block != NULL)
         {
-            ++rec->num_blocks;
+            ++w->rec->num_blocks;
             write_status =
-                bplib_file_offload_write_block_content(fd, rec, &c_block->canonical_logical_data.canonical_block,
+                bplib_file_offload_write_block_content(w, &c_block->canonical_logical_data.canonical_block,
                                                        sizeof(c_block->canonical_logical_data.canonical_block));
             if (write_status == BP_SUCCESS)
             {
                 if (c_block->canonical_logical_data.canonical_block.blockType == bp_blocktype_payloadBlock)
                 {
-                    write_status = bplib_file_offload_write_payload(fd, rec, c_block);
+                    w->rec->flags |= compress_flag;
+                    write_status = bplib_file_offload_write_payload(w, c_block);
+                }
+                else if (v7_block_decode_canonical_data(c_block) != 0)
+                {
+                    /* only the logical data is stored, so it has to be decoded */
+                    write_status = BP_ERROR;
                 }
                 else
                 {
                     write_status = bplib_file_offload_write_block_content(
-                        fd, rec, &c_block->canonical_logical_data.data, sizeof(c_block->canonical_logical_data.data));
+                        w, &c_block->canonical_logical_data.data, sizeof(c_block->canonical_logical_data.data));
                 }
             }
         }
@@ -344,71 +759,192 @@ static int bplib_file_offload_write_blocks(int fd, bplib_file_offload_record_t *
     return write_status;
 }
 
-static int bplib_file_offload_read_payload(int fd, bplib_file_offload_record_t *rec, bplib_mpool_t *pool,
-                                           bplib_mpool_bblock_canonical_t *c_block)
+static int bplib_file_offload_write_to(bplib_file_offload_writer_t *w, bplib_file_offload_record_t *rec,
+                                       bplib_mpool_block_t *blk)
+{
+    int write_status;
+
+    w->data_pos  = w->start_pos + (off_t)sizeof(*rec);
+    w->rec       = rec;
+    w->iov_count = 1;
+
+    rec->num_blocks = 0;
+    rec->num_bytes  = 0;
+    rec->crc        = bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI);
+
+    write_status = bplib_file_offload_write_blocks(w, blk);
+    if (write_status == BP_SUCCESS)
+    {
+        if (w->buf != NULL)
+        {
+            write_status = bplib_file_offload_writer_copy(w, true);
+        }
+        else
+        {
+            write_status = bplib_file_offload_writer_flush(w, true);
+        }
+    }
+
+    if (w->packed != NULL)
+    {
+        bplib_os_free(w->packed);
+    }
+
+    return write_status;
+}
+
+int bplib_file_offload_write_record(int fd, off_t pos, bplib_file_offload_record_t *rec, bplib_mpool_block_t *blk)
 {
+    bplib_file_offload_writer_t w;
+
+    memset(&w, 0, sizeof(w));
+    w.fd        = fd;
+    w.start_pos = pos;
+
+    return bplib_file_offload_write_to(&w, rec, blk);
+}
+
+int bplib_file_offload_encode_record(void *buf, size_t buf_size, bplib_file_offload_record_t *rec,
+                                     bplib_mpool_block_t *blk)
+{
+    bplib_file_offload_writer_t w;
+
+    if (buf_size < sizeof(*rec))
+    {
+        return BP_ERROR;
+    }
+
+    memset(&w, 0, sizeof(w));
+    w.fd       = -1;
+    w.buf      = buf;
+    w.buf_size = buf_size;
+
+    return bplib_file_offload_write_to(&w, rec, blk);
+}
+
+/* puts the CBOR data of a payload into new chunks, this is only done if there is room for all of it */
+static int bplib_file_offload_fill_chunks(bplib_mpool_t *pool, bplib_mpool_bblock_canonical_t *c_block,
+                                          const uint8_t *data, size_t size)
+{
+    bplib_mpool_block_t  avail_list;
     bplib_mpool_block_t *eblk;
     size_t               chunk_sz;
     int                  read_status;
 
-    eblk = NULL;
+    bplib_mpool_init_list_head(NULL, &avail_list);
+
+    read_status = BP_SUCCESS;
+
+    /* get all the blocks at once */
+    if (bplib_mpool_bblock_cbor_alloc_n(pool, &avail_list, size) < size)
+    {
+        /* out of memory */
+        read_status = BP_ERROR;
+    }
+
+    while (read_status == BP_SUCCESS && size > 0)
+    {
+        eblk = bplib_mpool_get_next_block(&avail_list);
+        if (bplib_mpool_bblock_cbor_cast(eblk) == NULL)
+        {
+            /* should not happen, as the size was checked above */
+            read_status = BP_ERROR;
+            break;
+        }
+
+        chunk_sz = bplib_mpool_get_generic_data_capacity(eblk);
+        if (chunk_sz > size)
+        {
+            chunk_sz = size;
+        }
+
+        memcpy(bplib_mpool_bblock_cbor_cast(eblk), data, chunk_sz);
+        data += chunk_sz;
+        size -= chunk_sz;
+
+        bplib_mpool_bblock_cbor_set_size(eblk, chunk_sz);
+        bplib_mpool_extract_node(eblk);
+        bplib_mpool_bblock_cbor_append(&c_block->chunk_list, eblk);
+    }
+
+    /* anything not used (e.g. due to an error) gets returned to the pool */
+    if (bplib_mpool_is_nonempty_list_head(&avail_list))
+    {
+        bplib_mpool_recycle_all_blocks_in_list(pool, &avail_list);
+    }
+
+    return read_status;
+}
+
+static int bplib_file_offload_read_payload(const uint8_t **src, bplib_file_offload_record_t *rec, bplib_mpool_t *pool,
+                                           bplib_mpool_bblock_canonical_t *c_block)
+{
+    const uint8_t *data;
+    uint8_t       *raw;
+    uint32_t       raw_size;
+    size_t         data_size;
+    int            read_status;
 
     /* payload block: size and offset info written in native form, followed by encoded CBOR data */
 
-    read_status = bplib_file_offload_read_block_content(fd, rec, &c_block->block_encode_size_cache,
+    read_status = bplib_file_offload_read_block_content(src, rec, &c_block->block_encode_size_cache,
                                                         sizeof(c_block->block_encode_size_cache));
     if (read_status == BP_SUCCESS)
     {
-        read_status = bplib_file_offload_read_block_content(fd, rec, &c_block->encoded_content_length,
+        read_status = bplib_file_offload_read_block_content(src, rec, &c_block->encoded_content_length,
                                                             sizeof(c_block->encoded_content_length));
     }
     if (read_status == BP_SUCCESS)
     {
-        read_status = bplib_file_offload_read_block_content(fd, rec, &c_block->encoded_content_offset,
+        read_status = bplib_file_offload_read_block_content(src, rec, &c_block->encoded_content_offset,
                                                             sizeof(c_block->encoded_content_offset));
     }
 
-    /* The remainder of the chunk is CBOR data */
-    if (read_status == BP_SUCCESS)
+    /* when compressed, that is preceded by its size */
+    raw_size = 0;
+    if (read_status == BP_SUCCESS && (rec->flags & BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED) != 0)
     {
-        while (rec->num_bytes > 0)
-        {
-            eblk = bplib_mpool_bblock_cbor_alloc(pool);
-            if (eblk == NULL)
-            {
-                /* out of memory */
-                read_status = BP_ERROR;
-                break;
-            }
+        read_status = bplib_file_offload_read_block_content(src, rec, &raw_size, sizeof(raw_size));
+    }
 
-            chunk_sz = bplib_mpool_get_generic_data_capacity(eblk);
-            if (chunk_sz > rec->num_bytes)
-            {
-                chunk_sz = rec->num_bytes;
-            }
+    if (read_status != BP_SUCCESS)
+    {
+        return read_status;
+    }
 
-            read_status = bplib_file_offload_read_block_content(fd, rec, bplib_mpool_bblock_cbor_cast(eblk), chunk_sz);
-            if (read_status != BP_SUCCESS)
-            {
-                break;
-            }
+    /* The remainder of the record is the CBOR data, which the CRC covers as it is stored */
+    data      = *src;
+    data_size = rec->num_bytes;
+    rec->crc  = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, rec->crc, data, data_size);
+    *src += data_size;
+    rec->num_bytes = 0;
 
-            bplib_mpool_bblock_cbor_set_size(eblk, chunk_sz);
-            bplib_mpool_bblock_cbor_append(&c_block->chunk_list, eblk);
-            eblk = NULL;
-        }
+    if ((rec->flags & BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED) == 0)
+    {
+        return bplib_file_offload_fill_chunks(pool, c_block, data, data_size);
+    }
+
+    raw = bplib_os_calloc(raw_size);
+    if (raw == NULL)
+    {
+        return BP_ERROR;
     }
 
-    if (eblk != NULL)
+    if (bplib_lz_decompress(data, data_size, raw, raw_size) == raw_size)
+    {
+        read_status = bplib_file_offload_fill_chunks(pool, c_block, raw, raw_size);
+    }
+    else
     {
-        bplib_mpool_recycle_block(eblk);
+        read_status = bplog(NULL, BP_FLAG_DIAGNOSTIC, "Stored payload does not decompress\n");
     }
 
-    /* This should have read the entire remainder, if not then there was a problem */
+    bplib_os_free(raw);
+
     return read_status;
 }
 
-static bplib_mpool_block_t *bplib_file_offload_read_blocks(int fd, bplib_file_offload_record_t *rec,
+static bplib_mpool_block_t *bplib_file_offload_read_blocks(const uint8_t *src, bplib_file_offload_record_t *rec,
                                                            bplib_mpool_t *pool)
 {
     bplib_mpool_block_t            *pblk;
@@ -429,7 +965,7 @@ static bplib_mpool_block_t *bplib_file_offload_read_blocks(int fd, bplib_file_of
 
         if (rec->num_blocks > 0)
         {
-            read_status = bplib_file_offload_read_block_content(fd, rec, &pri_block->data, sizeof(pri_block->data));
+            read_status = bplib_file_offload_read_block_content(&src, rec, &pri_block->data, sizeof(pri_block->data));
             if (read_status == BP_SUCCESS)
             {
                 --rec->num_blocks;
@@ -446,21 +982,21 @@ static bplib_mpool_block_t *bplib_file_offload_read_blocks(int fd, bplib_file_of
                     assert(c_block != NULL);
 
                     --rec->num_blocks;
-                    read_status =
-                        bplib_file_offload_read_block_content(fd, rec, &c_block->canonical_logical_data.canonical_block,
-                                                              sizeof(c_block->canonical_logical_data.canonical_block));
+                    read_status = bplib_file_offload_read_block_content(
+                        &src, rec, &c_block->canonical_logical_data.canonical_block,
+                        sizeof(c_block->canonical_logical_data.canonical_block));
                     if (read_status == BP_SUCCESS)
                     {
                         if (c_block->canonical_logical_data.canonical_block.blockType == bp_blocktype_payloadBlock)
                         {
                             /* payload block has multiple parts */
-                            read_status = bplib_file_offload_read_payload(fd, rec, pool, c_block);
+                            read_status = bplib_file_offload_read_payload(&src, rec, pool, c_block);
                         }
                         else
                         {
                             /* other extension block, the whole thing is written in native form (known size) */
                             read_status =
-                                bplib_file_offload_read_block_content(fd, rec, &c_block->canonical_logical_data.data,
+                                bplib_file_offload_read_block_content(&src, rec, &c_block->canonical_logical_data.data,
                                                                       sizeof(c_block->canonical_logical_data.data));
                         }
                     }
@@ -485,17 +1021,104 @@ static bplib_mpool_block_t *bplib_file_offload_read_blocks(int fd, bplib_file_of
     if (read_status != BP_SUCCESS && pblk != NULL)
     {
         bplib_mpool_recycle_block(pblk);
+        pblk = NULL;
     }
 
     return pblk;
 }
 
+int bplib_file_offload_restore_record(int fd, off_t pos, uint32_t check_val, bplib_mpool_t *pool,
+                                     bplib_mpool_block_t **pblk_out)
+{
+    bplib_file_offload_record_t rec;
+    struct stat                 st;
+    off_t                       map_pos;
+    size_t                      map_sz;
+    void                       *map_base;
+    int                         result;
+
+    if (pread(fd, &rec, sizeof(rec), pos) != sizeof(rec) || rec.check_val != check_val)
+    {
+        return BP_ERROR;
+    }
+
+    /* touching a mapped page past the end of the file faults, so a short record is rejected up front */
+    if (fstat(fd, &st) != 0 || st.st_size < pos + (off_t)sizeof(rec) + (off_t)rec.num_bytes)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Stored record is truncated\n");
+    }
+
+    /*
+     * The record is mapped and copied into the pool blocks from there, rather than read a
+     * piece at a time, so a restore is the same few calls no matter how many chunks it has.
+     */
+    map_pos  = pos & ~((off_t)sysconf(_SC_PAGESIZE) - 1);
+    map_sz   = (size_t)(pos - map_pos) + sizeof(rec) + rec.num_bytes;
+    map_base = mmap(NULL, map_sz, PROT_READ, MAP_SHARED, fd, map_pos);
+    if (map_base == MAP_FAILED)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "mmap(): %s\n", strerror(errno));
+    }
+
+    result = bplib_file_offload_decode_record((const uint8_t *)map_base + (pos - map_pos), map_sz - (pos - map_pos),
+                                              check_val, pool, pblk_out);
+
+    munmap(map_base, map_sz);
+
+    return result;
+}
+
+int bplib_file_offload_decode_record(const void *buf, size_t buf_size, uint32_t check_val, bplib_mpool_t *pool,
+                                     bplib_mpool_block_t **pblk_out)
+{
+    bplib_file_offload_record_t rec;
+    bplib_mpool_block_t        *pblk;
+    bp_crcval_t                 crcval;
+    int                         result;
+
+    result    = BP_ERROR;
+    *pblk_out = NULL;
+
+    if (buf_size < sizeof(rec))
+    {
+        return BP_ERROR;
+    }
+
+    memcpy(&rec, buf, sizeof(rec));
+    if (rec.check_val != check_val || buf_size - sizeof(rec) < rec.num_bytes)
+    {
+        return BP_ERROR;
+    }
+
+    crcval  = rec.crc;
+    rec.crc = bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI);
+
+    pblk = bplib_file_offload_read_blocks((const uint8_t *)buf + sizeof(rec), &rec, pool);
+    if (pblk != NULL)
+    {
+        rec.crc = bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, rec.crc);
+        if (rec.crc == crcval)
+        {
+            result = BP_SUCCESS;
+        }
+        else
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "CRC mismatch during bundle restore\n");
+            bplib_mpool_recycle_block(pblk);
+            pblk = NULL;
+        }
+    }
+
+    *pblk_out = pblk;
+
+    return result;
+}
+
 static int bplib_file_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk)
 {
     char                        bundle_file[BPLIB_FILE_PATH_SIZE];
     bplib_file_offload_state_t *state;
     bplib_file_offload_record_t rec;
-    off_t                       off;
     int                         result;
     int                         fd;
 
@@ -516,25 +1139,15 @@ static int bplib_file_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, b
     {
         memset(&rec, 0, sizeof(rec));
         rec.check_val = BPLIB_FILE_OFFLOAD_MAGIC;
-        rec.crc       = bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI);
-
-        off = lseek(fd, sizeof(rec), SEEK_SET);
-        if (off != sizeof(rec))
+        if (state->compress)
         {
-            bplog(NULL, BP_FLAG_DIAGNOSTIC, "lseek(): %s\n", strerror(errno));
+            rec.flags = BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED;
         }
 
-        result = bplib_file_offload_write_blocks(fd, &rec, pblk);
+        result = bplib_file_offload_write_record(fd, 0, &rec, pblk);
         if (result == BP_SUCCESS)
         {
             fsync(fd);
-
-            lseek(fd, 0, SEEK_SET);
-            rec.crc = bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, rec.crc);
-            if (write(fd, &rec, sizeof(rec)) != sizeof(rec))
-            {
-                result = BP_ERROR;
-            }
         }
 
         close(fd);
@@ -547,10 +1160,6 @@ static int bplib_file_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bp
 {
     char                        bundle_file[BPLIB_FILE_PATH_SIZE];
     bplib_file_offload_state_t *state;
-    bplib_mpool_block_t        *pblk;
-    bplib_file_offload_record_t rec;
-    bp_crcval_t                 crcval;
-    bplib_mpool_t              *pool;
     int                         result;
     int                         fd;
 
@@ -560,57 +1169,20 @@ static int bplib_file_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bp
         return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
     }
 
-    pool = bplib_mpool_get_parent_pool_from_link(svc);
-
-    result = BP_ERROR;
-    pblk   = NULL;
+    *pblk_out = NULL;
 
     bplib_file_offload_sid_to_name(state, bundle_file, sizeof(bundle_file), sid, false);
 
-    do
+    fd = open(bundle_file, O_RDONLY);
+    if (fd < 0)
     {
-        fd = open(bundle_file, O_RDONLY);
-        if (fd < 0)
-        {
-            break;
-        }
-
-        if (read(fd, &rec, sizeof(rec)) != sizeof(rec))
-        {
-            break;
-        }
-
-        crcval  = rec.crc;
-        rec.crc = bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI);
-
-        pblk = bplib_file_offload_read_blocks(fd, &rec, pool);
-        if (pblk != NULL)
-        {
-            rec.crc = bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, rec.crc);
-            if (rec.crc == crcval)
-            {
-                result = BP_SUCCESS;
-            }
-            else
-            {
-                bplog(NULL, BP_FLAG_DIAGNOSTIC, "CRC mismatch during bundle restore\n");
-            }
-        }
-    }
-    while (false);
-
-    if (fd >= 0)
-    {
-        close(fd);
+        return BP_ERROR;
     }
 
-    if (pblk != NULL && result != BP_SUCCESS)
-    {
-        bplib_mpool_recycle_block(pblk);
-        pblk = NULL;
-    }
+    result = bplib_file_offload_restore_record(fd, 0, BPLIB_FILE_OFFLOAD_MAGIC,
+                                               bplib_mpool_get_parent_pool_from_link(svc), pblk_out);
 
-    *pblk_out = pblk;
+    close(fd);
 
     return result;
 }
@@ -619,6 +1191,7 @@ static int bplib_file_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid)
 {
     char                        bundle_file[BPLIB_FILE_PATH_SIZE];
     bplib_file_offload_state_t *state;
+    bool                        queued;
 
     state = bplib_mpool_generic_data_cast(svc, BPLIB_FILE_OFFLOAD_MAGIC);
     if (state == NULL)
@@ -626,6 +1199,32 @@ static int bplib_file_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid)
         return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
     }
 
+    queued = false;
+    if (state->release_thread != NULL)
+    {
+        bplib_os_mutex_lock(state->release_lock);
+        if (state->release_count < BPLIB_FILE_OFFLOAD_RELEASE_QUEUE)
+        {
+            state->release_queue[(state->release_head + state->release_count) % BPLIB_FILE_OFFLOAD_RELEASE_QUEUE] =
+                sid;
+            ++state->release_count;
+
+            /* a partial batch waits for the thread to time out, so it is only woken for a full one */
+            if (state->release_count == state->release_batch)
+            {
+                bplib_os_mutex_signal(state->release_lock);
+            }
+
+            queued = true;
+        }
+        bplib_os_mutex_unlock(state->release_lock);
+    }
+
+    if (queued)
+    {
+        return 0;
+    }
+
     bplib_file_offload_sid_to_name(state, bundle_file, sizeof(bundle_file), sid, false);
 
     unlink(bundle_file);
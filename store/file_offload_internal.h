@@ -0,0 +1,85 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef FILE_OFFLOAD_INTERNAL_H
+#define FILE_OFFLOAD_INTERNAL_H
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "v7_mpool.h"
+
+#include <sys/types.h>
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * The header in front of every stored bundle.  The CRC covers everything after the
+ * header, and num_bytes is the size of that, so a record is sizeof(header) + num_bytes.
+ *
+ * The flags took the upper half of what was a 32 bit block count, so records written
+ * before there were any flags read back (on a little endian host) with none set.
+ */
+typedef struct bplib_file_offload_record
+{
+    uint32_t check_val;
+    uint16_t num_blocks;
+    uint16_t flags;
+    uint32_t num_bytes;
+    uint32_t crc;
+} bplib_file_offload_record_t;
+
+/*
+ * The payload data is stored compressed by bplib_lz_compress(), after its size when not.
+ * Set by the caller of bplib_file_offload_write_record() to ask for it, which clears it
+ * again if the payload was not worth compressing.
+ */
+#define BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED 0x0001
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/*
+ * These are shared by the offload modules so that all of them store bundles the same way.
+ *
+ * Writing puts the whole record for a bundle, header first, at pos in fd, usually with one
+ * pwritev() of the pieces where they are in the bundle blocks.  The caller sets check_val and
+ * the flags in rec, the rest is filled in.  Restoring takes the whole record that starts at
+ * pos in fd, checks it against check_val and its CRC, and rebuilds the bundle from it in pool.
+ */
+int bplib_file_offload_write_record(int fd, off_t pos, bplib_file_offload_record_t *rec, bplib_mpool_block_t *blk);
+int bplib_file_offload_restore_record(int fd, off_t pos, uint32_t check_val, bplib_mpool_t *pool,
+                                      bplib_mpool_block_t **pblk_out);
+
+/*
+ * The same, for a record kept in memory rather than in a file.  Encoding fails if the record
+ * would not fit in buf_size, and decoding if the record is longer than the buf_size it is given.
+ */
+int bplib_file_offload_encode_record(void *buf, size_t buf_size, bplib_file_offload_record_t *rec,
+                                     bplib_mpool_block_t *blk);
+int bplib_file_offload_decode_record(const void *buf, size_t buf_size, uint32_t check_val, bplib_mpool_t *pool,
+                                     bplib_mpool_block_t **pblk_out);
+
+#endif /* FILE_OFFLOAD_INTERNAL_H */
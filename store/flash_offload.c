@@ -0,0 +1,1307 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_flash_offload.h"
+#include "v7_cache.h"
+#include "v7.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "crc.h"
+#include "file_offload_internal.h"
+
+#include <stdlib.h>
+
+#define BPLIB_FLASH_OFFLOAD_MAGIC 0xf1a50ff1
+#define BPLIB_FLASH_BLOCK_MAGIC   0xf1a5b10c
+#define BPLIB_FLASH_ENTRY_MAGIC   0xf1a5e417
+#define BPLIB_FLASH_ENTRY_ALIGN   8
+#define BPLIB_FLASH_INITIAL_SLOTS 256
+#define BPLIB_FLASH_NO_BLOCK      UINT32_MAX
+
+/* erased blocks kept back so that collection always has somewhere to copy to */
+#define BPLIB_FLASH_GC_RESERVE 1
+
+/*
+ * The layout on the device: every block in use starts with a header giving the order it was
+ * opened in, followed by entries, each aligned to BPLIB_FLASH_ENTRY_ALIGN.  An entry is either
+ * a bundle, with its record from bplib_file_offload_encode_record() after it, or a release of
+ * one, with nothing after it.  A flush programs the page being filled even if it is not full,
+ * so the entries after it start on the next page, and anything that does not check out at a
+ * position (padding, erased flash, a page that was being programmed at a crash) means there is
+ * nothing more until the next page.
+ *
+ * Sids are handed out in increasing order and never reused.  A bundle keeps its sid when it is
+ * copied to another block, so from a restart the copy in the newest block is the one used, and
+ * any release of a sid means it is gone whatever block it was in.
+ */
+typedef struct bplib_flash_offload_block_header
+{
+    uint32_t check_val;
+    uint32_t seq; /**< order the block was opened in, never 0 */
+    uint32_t crc;
+
+} bplib_flash_offload_block_header_t;
+
+typedef struct bplib_flash_offload_entry
+{
+    uint32_t                    check_val;
+    uint32_t                    length;     /**< of the bundle record after this, 0 for a release */
+    uint32_t                    target_seq; /**< for a release, the seq of the block the bundle was in */
+    uint32_t                    data_crc;   /**< of the bundle record after this */
+    bplib_cache_offload_index_t index;      /**< only the sid for a release */
+    uint32_t                    crc;        /**< of the entry up to here */
+
+} bplib_flash_offload_entry_t;
+
+typedef struct bplib_flash_offload_block
+{
+    uint32_t seq;          /**< from the header, 0 for an erased block */
+    uint32_t end_pos;      /**< bytes used, for the active block where the next entry goes */
+    uint32_t live_records; /**< bundles in the block that are still held */
+    uint32_t live_bytes;   /**< taken by the entries of those */
+    uint32_t stale_copies; /**< older copies of bundles found at start, see bplib_flash_offload_collect() */
+    bool     bad;          /**< never used again, until the next start */
+
+} bplib_flash_offload_block_t;
+
+/* where each bundle held is, in order of sid */
+typedef struct bplib_flash_offload_slot
+{
+    bp_sid_t sid;
+    uint32_t block; /**< BPLIB_FLASH_NO_BLOCK once it is released */
+    uint32_t pos;   /**< of the entry in the block */
+    uint32_t size;  /**< of the entry, with its alignment */
+
+} bplib_flash_offload_slot_t;
+
+/* an entry read at start, before it is known which ones are still held */
+typedef struct bplib_flash_offload_found
+{
+    bplib_flash_offload_entry_t entry;
+    uint32_t                    block;
+    uint32_t                    pos;
+
+} bplib_flash_offload_found_t;
+
+typedef struct bplib_flash_offload_state
+{
+    bplib_flash_driver_t driver;
+    uint32_t             block_size; /**< bytes in an erase block */
+    int                  compress;   /**< set by bplib_cache_confkey_offload_compress */
+
+    /*
+     * Without a commit delay, the page being filled is programmed after every bundle, so records
+     * only share a page with a delay set.  See the segment offload for how the two work together.
+     */
+    int      commit_delay;    /**< set by bplib_cache_confkey_offload_commit_delay */
+    int      commit_bytes;    /**< set by bplib_cache_confkey_offload_commit_bytes */
+    size_t   unflushed_bytes; /**< written since the last flush */
+    uint64_t unflushed_time;  /**< DTN time of the first record written since the last flush */
+
+    bplib_flash_offload_block_t *blocks; /**< NULL when not started */
+    uint32_t                     active_block;
+    uint32_t                     next_block; /**< where the search for an erased block starts, for wear */
+    uint32_t                     free_blocks;
+    uint32_t                     last_seq;
+    bp_sid_t                     last_sid;
+
+    uint8_t *page_buf;   /**< the page of the active block being filled */
+    uint8_t *read_buf;   /**< one page read from the device */
+    uint32_t read_block; /**< where read_buf is from, so entries in the same page do not read it again */
+    uint32_t read_page;
+    uint8_t *rec_buf; /**< the record of one entry, which can be as big as a block */
+
+    bplib_flash_offload_slot_t  *slots;
+    uint32_t                     num_slots;
+    uint32_t                     max_slots;
+    uint32_t                     dead_slots; /**< released, until the slots are compacted */
+    bplib_cache_offload_index_t *recovered;  /**< held from before the start, until recover() */
+    uint32_t                     num_recovered;
+
+} bplib_flash_offload_state_t;
+
+static bplib_mpool_block_t *bplib_flash_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg);
+static int bplib_flash_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                         const void *val);
+static int bplib_flash_offload_query(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                     const void **val);
+static int bplib_flash_offload_start(bplib_mpool_block_t *svc);
+static int bplib_flash_offload_stop(bplib_mpool_block_t *svc);
+static int bplib_flash_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
+static int bplib_flash_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out);
+static int bplib_flash_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid);
+static int bplib_flash_offload_flush(bplib_mpool_block_t *svc);
+static int bplib_flash_offload_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg);
+
+static const bplib_cache_offload_api_t BPLIB_FLASH_OFFLOAD_INTERNAL_API = {
+    .std.module_type = bplib_cache_module_type_offload,
+    .std.instantiate = bplib_flash_offload_instantiate,
+    .std.configure   = bplib_flash_offload_configure,
+    .std.query       = bplib_flash_offload_query,
+    .std.start       = bplib_flash_offload_start,
+    .std.stop        = bplib_flash_offload_stop,
+    .offload         = bplib_flash_offload_offload,
+    .restore         = bplib_flash_offload_restore,
+    .release         = bplib_flash_offload_release,
+    .flush           = bplib_flash_offload_flush,
+    .recover         = bplib_flash_offload_recover};
+
+const bplib_cache_module_api_t *BPLIB_FLASH_OFFLOAD_API =
+    (const bplib_cache_module_api_t *)&BPLIB_FLASH_OFFLOAD_INTERNAL_API;
+
+static inline uint32_t bplib_flash_offload_align(size_t sz)
+{
+    return (uint32_t)((sz + BPLIB_FLASH_ENTRY_ALIGN - 1) & ~((size_t)BPLIB_FLASH_ENTRY_ALIGN - 1));
+}
+
+static uint32_t bplib_flash_offload_crc(const void *ptr, size_t sz)
+{
+    bp_crcval_t crc;
+
+    crc = bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI);
+    crc = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, crc, ptr, sz);
+
+    return bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, crc);
+}
+
+/*
+ * Reads from anywhere in a block.  The page of the active block that is being filled has not
+ * been programmed yet, so that one comes from the buffer instead.
+ */
+static int bplib_flash_offload_read(bplib_flash_offload_state_t *state, uint32_t block, uint32_t pos, void *dest,
+                                    uint32_t size)
+{
+    const uint8_t *src;
+    uint8_t       *out;
+    uint32_t       page;
+    uint32_t       offset;
+    uint32_t       chunk_sz;
+
+    out = dest;
+    while (size > 0)
+    {
+        page     = pos / state->driver.page_size;
+        offset   = pos % state->driver.page_size;
+        chunk_sz = state->driver.page_size - offset;
+        if (chunk_sz > size)
+        {
+            chunk_sz = size;
+        }
+
+        if (block == state->active_block && page == state->blocks[block].end_pos / state->driver.page_size)
+        {
+            src = state->page_buf;
+        }
+        else if ((block == state->read_block && page == state->read_page) ||
+                 state->driver.read(state->driver.arg, block, page, state->read_buf) == BP_SUCCESS)
+        {
+            state->read_block = block;
+            state->read_page  = page;
+            src               = state->read_buf;
+        }
+        else
+        {
+            state->read_block = BPLIB_FLASH_NO_BLOCK;
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash read of block %lu page %lu failed\n", (unsigned long)block,
+                  (unsigned long)page);
+            return BP_ERROR;
+        }
+
+        memcpy(out, &src[offset], chunk_sz);
+        out += chunk_sz;
+        pos += chunk_sz;
+        size -= chunk_sz;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Reads the entry at pos, and the record after it into rec_buf.  It is only BP_SUCCESS if both
+ * check out, a bundle only partly programmed is as good as not there.
+ */
+static int bplib_flash_offload_read_entry(bplib_flash_offload_state_t *state, uint32_t block, uint32_t pos,
+                                          bplib_flash_offload_entry_t *entry)
+{
+    if (pos + sizeof(*entry) > state->block_size ||
+        bplib_flash_offload_read(state, block, pos, entry, sizeof(*entry)) != BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    if (entry->check_val != BPLIB_FLASH_ENTRY_MAGIC ||
+        entry->crc != bplib_flash_offload_crc(entry, offsetof(bplib_flash_offload_entry_t, crc)) ||
+        entry->length > state->block_size - pos - sizeof(*entry))
+    {
+        return BP_ERROR;
+    }
+
+    if (entry->length > 0 &&
+        (bplib_flash_offload_read(state, block, pos + sizeof(*entry), state->rec_buf, entry->length) != BP_SUCCESS ||
+         entry->data_crc != bplib_flash_offload_crc(state->rec_buf, entry->length)))
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*
+ * A block that fails to program is not written again, nor erased, as what is already in its
+ * earlier pages may still be held.  Whatever was in the page buffer is lost, which the failed
+ * flush tells the cache.
+ */
+static int bplib_flash_offload_program_page(bplib_flash_offload_state_t *state, uint32_t page)
+{
+    int result;
+
+    result = state->driver.program(state->driver.arg, state->active_block, page, state->page_buf);
+    if (result != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash program of block %lu page %lu failed\n",
+              (unsigned long)state->active_block, (unsigned long)page);
+        state->blocks[state->active_block].bad = true;
+        state->active_block                    = BPLIB_FLASH_NO_BLOCK;
+        result                                 = BP_ERROR;
+    }
+
+    memset(state->page_buf, 0xFF, state->driver.page_size);
+
+    return result;
+}
+
+/* appends to the active block, with src NULL for padding */
+static int bplib_flash_offload_write(bplib_flash_offload_state_t *state, const void *src, uint32_t size)
+{
+    bplib_flash_offload_block_t *blk;
+    const uint8_t               *in;
+    uint32_t                     offset;
+    uint32_t                     chunk_sz;
+
+    in  = src;
+    blk = &state->blocks[state->active_block];
+    while (size > 0)
+    {
+        offset   = blk->end_pos % state->driver.page_size;
+        chunk_sz = state->driver.page_size - offset;
+        if (chunk_sz > size)
+        {
+            chunk_sz = size;
+        }
+
+        if (in != NULL)
+        {
+            memcpy(&state->page_buf[offset], in, chunk_sz);
+            in += chunk_sz;
+        }
+        else
+        {
+            memset(&state->page_buf[offset], 0, chunk_sz);
+        }
+
+        blk->end_pos += chunk_sz;
+        size -= chunk_sz;
+
+        if ((blk->end_pos % state->driver.page_size) == 0 &&
+            bplib_flash_offload_program_page(state, (blk->end_pos / state->driver.page_size) - 1) != BP_SUCCESS)
+        {
+            return BP_ERROR;
+        }
+    }
+
+    return BP_SUCCESS;
+}
+
+/* programs the page being filled, so that everything written so far is on the device */
+static int bplib_flash_offload_flush_page(bplib_flash_offload_state_t *state)
+{
+    bplib_flash_offload_block_t *blk;
+    uint32_t                     page;
+
+    state->unflushed_bytes = 0;
+    state->unflushed_time  = 0;
+
+    if (state->active_block == BPLIB_FLASH_NO_BLOCK)
+    {
+        return BP_SUCCESS;
+    }
+
+    blk = &state->blocks[state->active_block];
+    if ((blk->end_pos % state->driver.page_size) == 0)
+    {
+        return BP_SUCCESS;
+    }
+
+    /* the rest of the page stays as erased, so the next entry starts on the next page */
+    page         = blk->end_pos / state->driver.page_size;
+    blk->end_pos = (page + 1) * state->driver.page_size;
+
+    return bplib_flash_offload_program_page(state, page);
+}
+
+/*
+ * Erases the next usable block after the last one and starts it as the active block.  Only
+ * collection may take the last BPLIB_FLASH_GC_RESERVE erased blocks.
+ */
+static int bplib_flash_offload_open_block(bplib_flash_offload_state_t *state, bool for_gc)
+{
+    bplib_flash_offload_block_header_t hdr;
+    bplib_flash_offload_block_t       *blk;
+    uint32_t                           block;
+    uint32_t                           i;
+
+    for (i = 0; i < state->driver.num_blocks; ++i)
+    {
+        if (state->free_blocks <= (for_gc ? 0 : BPLIB_FLASH_GC_RESERVE))
+        {
+            break;
+        }
+
+        block = (state->next_block + i) % state->driver.num_blocks;
+        blk   = &state->blocks[block];
+        if (blk->bad || blk->seq != 0)
+        {
+            continue;
+        }
+
+        --state->free_blocks;
+        if (block == state->read_block)
+        {
+            state->read_block = BPLIB_FLASH_NO_BLOCK;
+        }
+
+        if (state->driver.erase(state->driver.arg, block) != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash erase of block %lu failed\n", (unsigned long)block);
+            blk->bad = true;
+            continue;
+        }
+
+        memset(blk, 0, sizeof(*blk));
+        blk->seq            = ++state->last_seq;
+        state->active_block = block;
+        state->next_block   = (block + 1) % state->driver.num_blocks;
+
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.check_val = BPLIB_FLASH_BLOCK_MAGIC;
+        hdr.seq       = blk->seq;
+        hdr.crc       = bplib_flash_offload_crc(&hdr, offsetof(bplib_flash_offload_block_header_t, crc));
+
+        if (bplib_flash_offload_write(state, &hdr, sizeof(hdr)) != BP_SUCCESS ||
+            bplib_flash_offload_write(state, NULL, bplib_flash_offload_align(sizeof(hdr)) - sizeof(hdr)) !=
+                BP_SUCCESS)
+        {
+            return BP_ERROR;
+        }
+
+        return BP_SUCCESS;
+    }
+
+    bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash storage is full\n");
+    return BP_ERROR;
+}
+
+/* fills in the check values of the entry and appends it and its record, which go in one block */
+static int bplib_flash_offload_append(bplib_flash_offload_state_t *state, bplib_flash_offload_entry_t *entry,
+                                      const void *data, bool for_gc, uint32_t *pos_out)
+{
+    uint32_t size;
+
+    size = bplib_flash_offload_align(sizeof(*entry) + entry->length);
+    if (size > state->block_size - bplib_flash_offload_align(sizeof(bplib_flash_offload_block_header_t)))
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Bundle of %lu bytes does not fit in a flash block\n",
+              (unsigned long)entry->length);
+        return BP_ERROR;
+    }
+
+    if (state->active_block != BPLIB_FLASH_NO_BLOCK &&
+        state->blocks[state->active_block].end_pos + size > state->block_size)
+    {
+        /* the rest of the block is left erased */
+        if (bplib_flash_offload_flush_page(state) != BP_SUCCESS)
+        {
+            return BP_ERROR;
+        }
+
+        state->active_block = BPLIB_FLASH_NO_BLOCK;
+    }
+
+    if (state->active_block == BPLIB_FLASH_NO_BLOCK && bplib_flash_offload_open_block(state, for_gc) != BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    entry->check_val = BPLIB_FLASH_ENTRY_MAGIC;
+    entry->data_crc  = (entry->length != 0) ? bplib_flash_offload_crc(data, entry->length) : 0;
+    entry->crc       = bplib_flash_offload_crc(entry, offsetof(bplib_flash_offload_entry_t, crc));
+
+    *pos_out = state->blocks[state->active_block].end_pos;
+
+    if (bplib_flash_offload_write(state, entry, sizeof(*entry)) != BP_SUCCESS ||
+        bplib_flash_offload_write(state, data, entry->length) != BP_SUCCESS ||
+        bplib_flash_offload_write(state, NULL, size - sizeof(*entry) - entry->length) != BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    return BP_SUCCESS;
+}
+
+static bplib_flash_offload_slot_t *bplib_flash_offload_lookup(bplib_flash_offload_state_t *state, bp_sid_t sid)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    lo = 0;
+    hi = state->num_slots;
+    while (lo < hi)
+    {
+        mid = lo + ((hi - lo) / 2);
+        if (state->slots[mid].sid < sid)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if (lo == state->num_slots || state->slots[lo].sid != sid || state->slots[lo].block == BPLIB_FLASH_NO_BLOCK)
+    {
+        return NULL;
+    }
+
+    return &state->slots[lo];
+}
+
+/* slots are appended in order of sid, the released ones are dropped when there is no room for more */
+static int bplib_flash_offload_add_slot(bplib_flash_offload_state_t *state, bp_sid_t sid, uint32_t block,
+                                        uint32_t pos, uint32_t size)
+{
+    bplib_flash_offload_slot_t *slots;
+    uint32_t                    i;
+    uint32_t                    n;
+
+    if (state->num_slots == state->max_slots && state->dead_slots > 0)
+    {
+        n = 0;
+        for (i = 0; i < state->num_slots; ++i)
+        {
+            if (state->slots[i].block != BPLIB_FLASH_NO_BLOCK)
+            {
+                state->slots[n] = state->slots[i];
+                ++n;
+            }
+        }
+
+        state->num_slots  = n;
+        state->dead_slots = 0;
+    }
+
+    if (state->num_slots == state->max_slots)
+    {
+        n     = (state->max_slots == 0) ? BPLIB_FLASH_INITIAL_SLOTS : (state->max_slots * 2);
+        slots = bplib_os_calloc(sizeof(bplib_flash_offload_slot_t) * n);
+        if (slots == NULL)
+        {
+            return bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Cannot grow the flash index to %lu\n", (unsigned long)n);
+        }
+
+        if (state->slots != NULL)
+        {
+            memcpy(slots, state->slots, sizeof(bplib_flash_offload_slot_t) * state->num_slots);
+            bplib_os_free(state->slots);
+        }
+
+        state->slots     = slots;
+        state->max_slots = n;
+    }
+
+    state->slots[state->num_slots].sid   = sid;
+    state->slots[state->num_slots].block = block;
+    state->slots[state->num_slots].pos   = pos;
+    state->slots[state->num_slots].size  = size;
+    ++state->num_slots;
+
+    ++state->blocks[block].live_records;
+    state->blocks[block].live_bytes += size;
+
+    return BP_SUCCESS;
+}
+
+static void bplib_flash_offload_move_slot(bplib_flash_offload_state_t *state, bplib_flash_offload_slot_t *slot,
+                                          uint32_t block, uint32_t pos)
+{
+    --state->blocks[slot->block].live_records;
+    state->blocks[slot->block].live_bytes -= slot->size;
+
+    slot->block = block;
+    slot->pos   = pos;
+
+    if (block != BPLIB_FLASH_NO_BLOCK)
+    {
+        ++state->blocks[block].live_records;
+        state->blocks[block].live_bytes += slot->size;
+    }
+    else
+    {
+        ++state->dead_slots;
+    }
+}
+
+/*
+ * A release is needed for as long as the bundle it is for may still be read at start, which is
+ * while the block it was in when it was released is not erased.  A restart after a block was
+ * copied but before it was erased also leaves older copies, which start counts, so a release
+ * newer than one of those is kept until that block is erased too.
+ */
+static bool bplib_flash_offload_release_needed(bplib_flash_offload_state_t *state, uint32_t victim,
+                                               uint32_t target_seq)
+{
+    bplib_flash_offload_block_t *blk;
+    uint32_t                     block;
+
+    for (block = 0; block < state->driver.num_blocks; ++block)
+    {
+        blk = &state->blocks[block];
+        if (block != victim && blk->seq != 0 &&
+            (blk->seq == target_seq || (blk->stale_copies > 0 && blk->seq < target_seq)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * After a copy failed to program, the bundles copied to the block that failed go back to the
+ * block they were copied from, which is not erased.  Those copied to a block before that are
+ * left where they are, that copy is as good.
+ */
+static void bplib_flash_offload_undo_collect(bplib_flash_offload_state_t *state, uint32_t victim)
+{
+    bplib_flash_offload_entry_t entry;
+    bplib_flash_offload_slot_t *slot;
+    uint32_t                    pos;
+
+    pos = bplib_flash_offload_align(sizeof(bplib_flash_offload_block_header_t));
+    while (pos + sizeof(entry) <= state->blocks[victim].end_pos)
+    {
+        if (bplib_flash_offload_read_entry(state, victim, pos, &entry) != BP_SUCCESS)
+        {
+            pos = ((pos / state->driver.page_size) + 1) * state->driver.page_size;
+            continue;
+        }
+
+        slot = NULL;
+        if (entry.length != 0)
+        {
+            slot = bplib_flash_offload_lookup(state, entry.index.sid);
+        }
+
+        if (slot != NULL && slot->block != victim && state->blocks[slot->block].bad)
+        {
+            bplib_flash_offload_move_slot(state, slot, victim, pos);
+        }
+
+        pos += bplib_flash_offload_align(sizeof(entry) + entry.length);
+    }
+}
+
+/*
+ * Takes back the block with the least still held in it.  The bundles that are still held are
+ * copied to the active block, and so are the releases that are still needed.  The copies are
+ * programmed before the block is erased, so a restart in between only finds some bundles twice.
+ */
+static int bplib_flash_offload_collect(bplib_flash_offload_state_t *state)
+{
+    bplib_flash_offload_entry_t  entry;
+    bplib_flash_offload_slot_t  *slot;
+    bplib_flash_offload_block_t *blk;
+    uint32_t                     victim;
+    uint32_t                     block;
+    uint32_t                     pos;
+    uint32_t                     new_pos;
+    uint32_t                     hdr_size;
+
+    hdr_size = bplib_flash_offload_align(sizeof(bplib_flash_offload_block_header_t));
+    victim   = BPLIB_FLASH_NO_BLOCK;
+    for (block = 0; block < state->driver.num_blocks; ++block)
+    {
+        blk = &state->blocks[block];
+        if (blk->seq == 0 || blk->bad || block == state->active_block || blk->live_bytes + hdr_size >= blk->end_pos)
+        {
+            continue;
+        }
+
+        if (victim == BPLIB_FLASH_NO_BLOCK || blk->live_bytes < state->blocks[victim].live_bytes)
+        {
+            victim = block;
+        }
+    }
+
+    if (victim == BPLIB_FLASH_NO_BLOCK)
+    {
+        return BP_ERROR;
+    }
+
+    pos = hdr_size;
+    while (pos + sizeof(entry) <= state->blocks[victim].end_pos)
+    {
+        if (bplib_flash_offload_read_entry(state, victim, pos, &entry) != BP_SUCCESS)
+        {
+            pos = ((pos / state->driver.page_size) + 1) * state->driver.page_size;
+            continue;
+        }
+
+        slot = NULL;
+        if (entry.length != 0)
+        {
+            slot = bplib_flash_offload_lookup(state, entry.index.sid);
+            if (slot != NULL && (slot->block != victim || slot->pos != pos))
+            {
+                slot = NULL;
+            }
+        }
+
+        if (slot != NULL ||
+            (entry.length == 0 && bplib_flash_offload_release_needed(state, victim, entry.target_seq)))
+        {
+            if (bplib_flash_offload_append(state, &entry, state->rec_buf, true, &new_pos) != BP_SUCCESS)
+            {
+                bplib_flash_offload_undo_collect(state, victim);
+                return BP_ERROR;
+            }
+
+            if (slot != NULL)
+            {
+                bplib_flash_offload_move_slot(state, slot, state->active_block, new_pos);
+            }
+        }
+
+        pos += bplib_flash_offload_align(sizeof(entry) + entry.length);
+    }
+
+    if (bplib_flash_offload_flush_page(state) != BP_SUCCESS)
+    {
+        bplib_flash_offload_undo_collect(state, victim);
+        return BP_ERROR;
+    }
+
+    if (victim == state->read_block)
+    {
+        state->read_block = BPLIB_FLASH_NO_BLOCK;
+    }
+
+    blk = &state->blocks[victim];
+    memset(blk, 0, sizeof(*blk));
+    if (state->driver.erase(state->driver.arg, victim) != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash erase of block %lu failed\n", (unsigned long)victim);
+        blk->bad = true;
+    }
+    else
+    {
+        ++state->free_blocks;
+    }
+
+    return BP_SUCCESS;
+}
+
+/* collects until there are more erased blocks than the reserve, or there is nothing left to take back */
+static void bplib_flash_offload_make_room(bplib_flash_offload_state_t *state)
+{
+    uint32_t free_blocks;
+
+    /* one that took as many blocks for its copies as it freed means the rest are as full, so it stops there */
+    free_blocks = 0;
+    while (state->free_blocks <= BPLIB_FLASH_GC_RESERVE && state->free_blocks >= free_blocks)
+    {
+        free_blocks = state->free_blocks + 1;
+        if (bplib_flash_offload_collect(state) != BP_SUCCESS)
+        {
+            break;
+        }
+    }
+}
+
+static int bplib_flash_offload_compare_found(const void *a, const void *b)
+{
+    const bplib_flash_offload_found_t *fa = a;
+    const bplib_flash_offload_found_t *fb = b;
+
+    if (fa->entry.index.sid != fb->entry.index.sid)
+    {
+        return (fa->entry.index.sid < fb->entry.index.sid) ? -1 : 1;
+    }
+
+    /* a release of it first, otherwise the copy in the newest block */
+    if ((fa->entry.length == 0) != (fb->entry.length == 0))
+    {
+        return (fa->entry.length == 0) ? -1 : 1;
+    }
+
+    return (fa->entry.target_seq > fb->entry.target_seq) ? -1 : (fa->entry.target_seq < fb->entry.target_seq);
+}
+
+/*
+ * Reads every block to find what is held.  Blocks that were in use are not written to again,
+ * new entries go in erased ones, so nothing depends on where a page was left at the crash.
+ */
+static int bplib_flash_offload_scan(bplib_flash_offload_state_t *state)
+{
+    bplib_flash_offload_block_header_t hdr;
+    bplib_flash_offload_found_t       *found;
+    bplib_flash_offload_found_t       *more;
+    bplib_flash_offload_block_t       *blk;
+    uint32_t                           num_found;
+    uint32_t                           max_found;
+    uint32_t                           block;
+    uint32_t                           pos;
+    uint32_t                           i;
+    int                                result;
+
+    found     = NULL;
+    num_found = 0;
+    max_found = 0;
+    result    = BP_SUCCESS;
+
+    for (block = 0; block < state->driver.num_blocks && result == BP_SUCCESS; ++block)
+    {
+        blk = &state->blocks[block];
+        if (state->driver.isbad != NULL && state->driver.isbad(state->driver.arg, block))
+        {
+            blk->bad = true;
+            continue;
+        }
+
+        if (bplib_flash_offload_read(state, block, 0, &hdr, sizeof(hdr)) != BP_SUCCESS ||
+            hdr.check_val != BPLIB_FLASH_BLOCK_MAGIC || hdr.seq == 0 ||
+            hdr.crc != bplib_flash_offload_crc(&hdr, offsetof(bplib_flash_offload_block_header_t, crc)))
+        {
+            /* erased, or as good as, it is erased again before it is used */
+            ++state->free_blocks;
+            continue;
+        }
+
+        blk->seq     = hdr.seq;
+        blk->end_pos = state->block_size;
+        if (hdr.seq > state->last_seq)
+        {
+            state->last_seq   = hdr.seq;
+            state->next_block = (block + 1) % state->driver.num_blocks;
+        }
+
+        pos = bplib_flash_offload_align(sizeof(hdr));
+        while (pos + sizeof(bplib_flash_offload_entry_t) <= state->block_size)
+        {
+            if (num_found == max_found)
+            {
+                max_found = (max_found == 0) ? BPLIB_FLASH_INITIAL_SLOTS : (max_found * 2);
+                more      = bplib_os_calloc(sizeof(bplib_flash_offload_found_t) * max_found);
+                if (more == NULL)
+                {
+                    result = bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Cannot hold %lu flash entries\n",
+                                   (unsigned long)max_found);
+                    break;
+                }
+
+                if (found != NULL)
+                {
+                    memcpy(more, found, sizeof(bplib_flash_offload_found_t) * num_found);
+                    bplib_os_free(found);
+                }
+
+                found = more;
+            }
+
+            if (bplib_flash_offload_read_entry(state, block, pos, &found[num_found].entry) != BP_SUCCESS)
+            {
+                pos = ((pos / state->driver.page_size) + 1) * state->driver.page_size;
+                continue;
+            }
+
+            /* for a bundle this is used to sort the copies of it, it is not stored */
+            if (found[num_found].entry.length != 0)
+            {
+                found[num_found].entry.target_seq = hdr.seq;
+            }
+
+            found[num_found].block = block;
+            found[num_found].pos   = pos;
+            pos += bplib_flash_offload_align(sizeof(bplib_flash_offload_entry_t) + found[num_found].entry.length);
+            ++num_found;
+        }
+    }
+
+    if (result == BP_SUCCESS && num_found > 0)
+    {
+        qsort(found, num_found, sizeof(*found), bplib_flash_offload_compare_found);
+
+        state->recovered = bplib_os_calloc(sizeof(bplib_cache_offload_index_t) * num_found);
+        if (state->recovered == NULL)
+        {
+            result = bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Cannot hold %lu recovered bundles\n",
+                           (unsigned long)num_found);
+        }
+    }
+
+    for (i = 0; i < num_found && result == BP_SUCCESS; ++i)
+    {
+        if (found[i].entry.index.sid > state->last_sid)
+        {
+            state->last_sid = found[i].entry.index.sid;
+        }
+
+        /* only the first of each sid counts */
+        if (found[i].entry.length == 0)
+        {
+            continue;
+        }
+
+        /* after a release it is the copy the release was for, after another copy it is an older one */
+        if (i > 0 && found[i - 1].entry.index.sid == found[i].entry.index.sid)
+        {
+            if (found[i - 1].entry.length != 0)
+            {
+                ++state->blocks[found[i].block].stale_copies;
+            }
+            continue;
+        }
+
+        result = bplib_flash_offload_add_slot(
+            state, found[i].entry.index.sid, found[i].block, found[i].pos,
+            bplib_flash_offload_align(sizeof(bplib_flash_offload_entry_t) + found[i].entry.length));
+
+        state->recovered[state->num_recovered] = found[i].entry.index;
+        ++state->num_recovered;
+    }
+
+    bplib_os_free(found);
+
+    return result;
+}
+
+static void bplib_flash_offload_close_all(bplib_flash_offload_state_t *state)
+{
+    if (state->blocks != NULL)
+    {
+        bplib_flash_offload_flush_page(state);
+    }
+
+    bplib_os_free(state->slots);
+    state->slots      = NULL;
+    state->num_slots  = 0;
+    state->max_slots  = 0;
+    state->dead_slots = 0;
+
+    bplib_os_free(state->recovered);
+    state->recovered     = NULL;
+    state->num_recovered = 0;
+
+    bplib_os_free(state->page_buf);
+    bplib_os_free(state->read_buf);
+    bplib_os_free(state->rec_buf);
+    state->page_buf = NULL;
+    state->read_buf = NULL;
+    state->rec_buf  = NULL;
+
+    bplib_os_free(state->blocks);
+    state->blocks = NULL;
+}
+
+static int bplib_flash_offload_construct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_flash_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL || arg == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    state->driver       = *((const bplib_flash_driver_t *)arg);
+    state->block_size   = state->driver.pages_per_block * state->driver.page_size;
+    state->active_block = BPLIB_FLASH_NO_BLOCK;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_flash_offload_destruct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_flash_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* in case it was never stopped */
+    bplib_flash_offload_close_all(state);
+
+    return BP_SUCCESS;
+}
+
+static bplib_mpool_block_t *bplib_flash_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg)
+{
+    const bplib_flash_driver_t *driver;
+    bplib_mpool_t              *pool;
+
+    static const bplib_mpool_blocktype_api_t offload_block_api = {.construct = bplib_flash_offload_construct_block,
+                                                                  .destruct  = bplib_flash_offload_destruct_block};
+
+    driver = init_arg;
+    if (driver == NULL || driver->read == NULL || driver->program == NULL || driver->erase == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash offload needs a driver\n");
+        return NULL;
+    }
+
+    /* a block has to hold its header and at least one entry */
+    if (driver->num_blocks < (BPLIB_FLASH_GC_RESERVE + 2) || driver->page_size == 0 ||
+        (driver->page_size % BPLIB_FLASH_ENTRY_ALIGN) != 0 || driver->pages_per_block == 0 ||
+        driver->pages_per_block > (UINT32_MAX / driver->page_size) ||
+        (driver->pages_per_block * driver->page_size) <
+            2 * bplib_flash_offload_align(sizeof(bplib_flash_offload_entry_t)))
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Flash geometry of %lu blocks of %lu pages of %lu bytes is not usable\n",
+              (unsigned long)driver->num_blocks, (unsigned long)driver->pages_per_block,
+              (unsigned long)driver->page_size);
+        return NULL;
+    }
+
+    pool = bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(parent));
+    bplib_mpool_register_blocktype(pool, BPLIB_FLASH_OFFLOAD_MAGIC, &offload_block_api,
+                                   sizeof(bplib_flash_offload_state_t));
+
+    return bplib_mpool_ref_make_block(parent, BPLIB_FLASH_OFFLOAD_MAGIC, init_arg);
+}
+
+static int bplib_flash_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                         const void *val)
+{
+    bplib_flash_offload_state_t *state;
+    int                          result;
+
+    result = BP_ERROR;
+    state  = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state != NULL)
+    {
+        switch (key)
+        {
+            case bplib_cache_confkey_offload_commit_delay:
+                state->commit_delay = *((const int *)val);
+                result              = BP_SUCCESS;
+                break;
+
+            case bplib_cache_confkey_offload_commit_bytes:
+                state->commit_bytes = *((const int *)val);
+                result              = BP_SUCCESS;
+                break;
+
+            case bplib_cache_confkey_offload_compress:
+                state->compress = *((const int *)val);
+                result          = BP_SUCCESS;
+                break;
+        }
+    }
+
+    return result;
+}
+
+static int bplib_flash_offload_query(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                     const void **val)
+{
+    return 0;
+}
+
+static int bplib_flash_offload_start(bplib_mpool_block_t *svc)
+{
+    bplib_flash_offload_state_t *state;
+    int                          result;
+
+    result = BP_ERROR;
+    state  = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state != NULL && state->blocks == NULL)
+    {
+        state->blocks   = bplib_os_calloc(sizeof(bplib_flash_offload_block_t) * state->driver.num_blocks);
+        state->page_buf = bplib_os_calloc(state->driver.page_size);
+        state->read_buf = bplib_os_calloc(state->driver.page_size);
+        state->rec_buf  = bplib_os_calloc(state->block_size);
+
+        state->active_block = BPLIB_FLASH_NO_BLOCK;
+        state->read_block   = BPLIB_FLASH_NO_BLOCK;
+        state->next_block   = 0;
+        state->free_blocks  = 0;
+        state->last_seq     = 0;
+        state->last_sid     = 0;
+
+        if (state->blocks != NULL && state->page_buf != NULL && state->read_buf != NULL && state->rec_buf != NULL)
+        {
+            memset(state->page_buf, 0xFF, state->driver.page_size);
+            result = bplib_flash_offload_scan(state);
+        }
+
+        /* so that it can be started again */
+        if (result != BP_SUCCESS)
+        {
+            bplib_flash_offload_close_all(state);
+        }
+    }
+
+    return result;
+}
+
+static int bplib_flash_offload_stop(bplib_mpool_block_t *svc)
+{
+    bplib_flash_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state != NULL)
+    {
+        bplib_flash_offload_close_all(state);
+    }
+
+    return 0;
+}
+
+static void bplib_flash_offload_index_bundle(bplib_cache_offload_index_t *index, bp_sid_t sid,
+                                            bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    bp_ipn_addr_t                 dest_addr;
+
+    /* the same things the cache takes from the bundle when it is stored */
+    pri_block  = bplib_mpool_bblock_primary_cast(pblk);
+    index->sid = sid;
+    if (pri_block != NULL)
+    {
+        v7_get_eid(&index->flow_id, &pri_block->data.logical.sourceEID);
+        v7_get_eid(&dest_addr, &pri_block->data.logical.destinationEID);
+        index->sequence_num       = pri_block->data.logical.creationTimeStamp.sequence_num;
+        index->final_dest_node    = dest_addr.node_number;
+        index->expire_time        = pri_block->data.logical.creationTimeStamp.time + pri_block->data.logical.lifetime;
+        index->bundle_encode_size = pri_block->bundle_encode_size_cache;
+    }
+}
+
+static int bplib_flash_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk)
+{
+    bplib_flash_offload_state_t *state;
+    bplib_flash_offload_entry_t  entry;
+    bplib_flash_offload_slot_t  *slot;
+    bplib_file_offload_record_t  rec;
+    bp_sid_t                     new_sid;
+    uint32_t                     pos;
+    int                          result;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL || state->blocks == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    /* done first, as collection uses the same buffer the record is put together in */
+    bplib_flash_offload_make_room(state);
+
+    memset(&rec, 0, sizeof(rec));
+    rec.check_val = BPLIB_FLASH_OFFLOAD_MAGIC;
+    if (state->compress)
+    {
+        rec.flags = BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED;
+    }
+
+    result = bplib_file_offload_encode_record(state->rec_buf, state->block_size - sizeof(entry), &rec, pblk);
+
+    if (result == BP_SUCCESS)
+    {
+        /* taken even if the append fails, as some of it may be on the device */
+        new_sid         = state->last_sid + 1;
+        state->last_sid = new_sid;
+
+        memset(&entry, 0, sizeof(entry));
+        entry.length = sizeof(rec) + rec.num_bytes;
+        bplib_flash_offload_index_bundle(&entry.index, new_sid, pblk);
+
+        result = bplib_flash_offload_append(state, &entry, state->rec_buf, false, &pos);
+    }
+
+    if (result == BP_SUCCESS)
+    {
+        result = bplib_flash_offload_add_slot(state, new_sid, state->active_block, pos,
+                                              bplib_flash_offload_align(sizeof(entry) + entry.length));
+    }
+
+    if (result == BP_SUCCESS)
+    {
+        state->unflushed_bytes += entry.length;
+        if (state->unflushed_time == 0)
+        {
+            state->unflushed_time = bplib_os_get_dtntime_coarse_ms();
+        }
+
+        if (state->commit_delay <= 0 ||
+            (state->commit_bytes > 0 && state->unflushed_bytes >= (size_t)state->commit_bytes) ||
+            (bplib_os_get_dtntime_coarse_ms() - state->unflushed_time) >= (uint64_t)state->commit_delay)
+        {
+            result = bplib_flash_offload_flush_page(state);
+            if (result != BP_SUCCESS)
+            {
+                slot = bplib_flash_offload_lookup(state, new_sid);
+                if (slot != NULL)
+                {
+                    bplib_flash_offload_move_slot(state, slot, BPLIB_FLASH_NO_BLOCK, 0);
+                }
+            }
+        }
+    }
+
+    if (result == BP_SUCCESS)
+    {
+        *sid = new_sid;
+    }
+
+    return result;
+}
+
+static int bplib_flash_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out)
+{
+    bplib_flash_offload_state_t *state;
+    bplib_flash_offload_slot_t  *slot;
+    bplib_flash_offload_entry_t  entry;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    *pblk_out = NULL;
+
+    slot = NULL;
+    if (state->blocks != NULL)
+    {
+        slot = bplib_flash_offload_lookup(state, sid);
+    }
+
+    if (slot == NULL || bplib_flash_offload_read_entry(state, slot->block, slot->pos, &entry) != BP_SUCCESS ||
+        entry.index.sid != sid)
+    {
+        return BP_ERROR;
+    }
+
+    return bplib_file_offload_decode_record(state->rec_buf, entry.length, BPLIB_FLASH_OFFLOAD_MAGIC,
+                                            bplib_mpool_get_parent_pool_from_link(svc), pblk_out);
+}
+
+static int bplib_flash_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid)
+{
+    bplib_flash_offload_state_t *state;
+    bplib_flash_offload_slot_t  *slot;
+    bplib_flash_offload_entry_t  entry;
+    uint32_t                     pos;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    slot = NULL;
+    if (state->blocks != NULL)
+    {
+        slot = bplib_flash_offload_lookup(state, sid);
+    }
+
+    if (slot != NULL)
+    {
+        memset(&entry, 0, sizeof(entry));
+        entry.target_seq = state->blocks[slot->block].seq;
+        entry.index.sid  = sid;
+
+        bplib_flash_offload_move_slot(state, slot, BPLIB_FLASH_NO_BLOCK, 0);
+
+        /* not flushed here, the worst a lost release does is bring back a bundle already done with */
+        bplib_flash_offload_make_room(state);
+        bplib_flash_offload_append(state, &entry, NULL, false, &pos);
+    }
+
+    return 0;
+}
+
+/*
+ * Besides making what was written durable, this is where collection is done ahead of need, one
+ * block at a time once a quarter or less of the blocks are left erased, so that offload() rarely
+ * has to wait for it.
+ */
+static int bplib_flash_offload_flush(bplib_mpool_block_t *svc)
+{
+    bplib_flash_offload_state_t *state;
+    int                          result;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL || state->blocks == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    result = bplib_flash_offload_flush_page(state);
+    if (result == BP_SUCCESS && state->free_blocks <= (state->driver.num_blocks / 4))
+    {
+        bplib_flash_offload_collect(state);
+    }
+
+    return result;
+}
+
+static int bplib_flash_offload_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg)
+{
+    bplib_flash_offload_state_t *state;
+    uint32_t                     i;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_FLASH_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    /* only the bundles held at start are handed over, and only once */
+    for (i = 0; i < state->num_recovered; ++i)
+    {
+        func(arg, &state->recovered[i]);
+    }
+
+    bplib_os_free(state->recovered);
+    state->recovered     = NULL;
+    state->num_recovered = 0;
+
+    return BP_SUCCESS;
+}
@@ -0,0 +1,472 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "v7_cache.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "v7_codec.h"
+
+#define BPLIB_PACKED_OFFLOAD_MAGIC  0x9ac40ff1
+#define BPLIB_PACKED_RECORD_MAGIC   0x9ac4ec0d
+#define BPLIB_PACKED_INITIAL_SLOTS  256
+#define BPLIB_PACKED_RESTORE_STAGE  4000
+
+/*
+ * The sid of a bundle here is the index of its slot.  Slot 0 is never handed out, so a sid
+ * of 0 still means the bundle was not offloaded.
+ */
+
+static bplib_mpool_block_t *bplib_packed_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg);
+static int                  bplib_packed_offload_configure(bplib_mpool_block_t *svc, int key,
+                                                           bplib_cache_module_valtype_t vt, const void *val);
+static int                  bplib_packed_offload_query(bplib_mpool_block_t *svc, int key,
+                                                       bplib_cache_module_valtype_t vt, const void **val);
+static int                  bplib_packed_offload_start(bplib_mpool_block_t *svc);
+static int                  bplib_packed_offload_stop(bplib_mpool_block_t *svc);
+static int bplib_packed_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
+static int bplib_packed_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out);
+static int bplib_packed_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid);
+
+/*
+ * One stored bundle.  Only the tracking data is kept from the primary block, everything in the
+ * logical primary and canonical blocks is decoded again from encoded_list on restore.
+ */
+typedef struct bplib_packed_offload_record
+{
+    bplib_mpool_bblock_tracking_t delivery;     /**< without the refs, those were released with the bundle */
+    size_t                        bundle_size;  /**< of the encoded bundle, all of it is in encoded_list */
+    bplib_mpool_block_t           encoded_list; /**< CBOR data blocks, in order */
+
+} bplib_packed_offload_record_t;
+
+typedef struct bplib_packed_offload_slot
+{
+    bplib_mpool_block_t *rblk; /**< the record, NULL if the slot is free */
+    uint32_t             next; /**< the next free slot */
+
+} bplib_packed_offload_slot_t;
+
+typedef struct bplib_packed_offload_state
+{
+    bplib_packed_offload_slot_t *slots;
+    uint32_t                     num_slots;
+    uint32_t                     free_slot; /**< first of the free slots, 0 if none */
+
+} bplib_packed_offload_state_t;
+
+static const bplib_cache_offload_api_t BPLIB_PACKED_OFFLOAD_INTERNAL_API = {
+    .std.module_type = bplib_cache_module_type_offload,
+    .std.instantiate = bplib_packed_offload_instantiate,
+    .std.configure   = bplib_packed_offload_configure,
+    .std.query       = bplib_packed_offload_query,
+    .std.start       = bplib_packed_offload_start,
+    .std.stop        = bplib_packed_offload_stop,
+    .offload         = bplib_packed_offload_offload,
+    .restore         = bplib_packed_offload_restore,
+    .release         = bplib_packed_offload_release,
+    .in_memory       = true};
+
+const bplib_cache_module_api_t *BPLIB_PACKED_OFFLOAD_API =
+    (const bplib_cache_module_api_t *)&BPLIB_PACKED_OFFLOAD_INTERNAL_API;
+
+static uint32_t bplib_packed_offload_alloc_slot(bplib_packed_offload_state_t *state)
+{
+    bplib_packed_offload_slot_t *grown;
+    uint32_t                     num_slots;
+    uint32_t                     slot;
+
+    if (state->free_slot == 0)
+    {
+        num_slots = (state->num_slots == 0) ? BPLIB_PACKED_INITIAL_SLOTS : (state->num_slots * 2);
+        grown     = bplib_os_calloc(sizeof(*grown) * num_slots);
+        if (grown == NULL)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to grow packed offload slots\n");
+            return 0;
+        }
+
+        if (state->slots != NULL)
+        {
+            memcpy(grown, state->slots, sizeof(*grown) * state->num_slots);
+            bplib_os_free(state->slots);
+        }
+
+        /* the new slots are all free, in order */
+        for (slot = num_slots - 1; slot >= state->num_slots && slot > 0; --slot)
+        {
+            grown[slot].next = state->free_slot;
+            state->free_slot = slot;
+        }
+
+        state->slots     = grown;
+        state->num_slots = num_slots;
+    }
+
+    slot             = state->free_slot;
+    state->free_slot = state->slots[slot].next;
+    memset(&state->slots[slot], 0, sizeof(state->slots[slot]));
+
+    return slot;
+}
+
+static void bplib_packed_offload_free_slot(bplib_packed_offload_state_t *state, uint32_t slot)
+{
+    state->slots[slot].rblk = NULL;
+    state->slots[slot].next = state->free_slot;
+    state->free_slot        = slot;
+}
+
+static bplib_packed_offload_record_t *bplib_packed_offload_lookup(bplib_packed_offload_state_t *state, bp_sid_t sid)
+{
+    if (sid == 0 || sid >= state->num_slots)
+    {
+        return NULL;
+    }
+
+    return bplib_mpool_generic_data_cast(state->slots[sid].rblk, BPLIB_PACKED_RECORD_MAGIC);
+}
+
+static void bplib_packed_offload_release_all(bplib_packed_offload_state_t *state)
+{
+    uint32_t slot;
+
+    if (state->slots != NULL)
+    {
+        for (slot = 1; slot < state->num_slots; ++slot)
+        {
+            if (state->slots[slot].rblk != NULL)
+            {
+                bplib_mpool_recycle_block(state->slots[slot].rblk);
+            }
+        }
+
+        bplib_os_free(state->slots);
+        state->slots     = NULL;
+        state->num_slots = 0;
+        state->free_slot = 0;
+    }
+}
+
+static int bplib_packed_offload_construct_record(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_packed_offload_record_t *rec;
+
+    rec = bplib_mpool_generic_data_cast(blk, BPLIB_PACKED_RECORD_MAGIC);
+    if (rec == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    bplib_mpool_init_list_head(blk, &rec->encoded_list);
+
+    return BP_SUCCESS;
+}
+
+static int bplib_packed_offload_destruct_record(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_packed_offload_record_t *rec;
+
+    rec = bplib_mpool_generic_data_cast(blk, BPLIB_PACKED_RECORD_MAGIC);
+    if (rec == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    bplib_mpool_recycle_all_blocks_in_list(NULL, &rec->encoded_list);
+
+    return BP_SUCCESS;
+}
+
+static int bplib_packed_offload_construct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    return BP_SUCCESS;
+}
+
+static int bplib_packed_offload_destruct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_packed_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_PACKED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* in case it was never stopped */
+    bplib_packed_offload_release_all(state);
+
+    return BP_SUCCESS;
+}
+
+static bplib_mpool_block_t *bplib_packed_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg)
+{
+    bplib_mpool_t *pool;
+
+    static const bplib_mpool_blocktype_api_t offload_block_api = {.construct = bplib_packed_offload_construct_block,
+                                                                  .destruct  = bplib_packed_offload_destruct_block};
+    static const bplib_mpool_blocktype_api_t record_block_api  = {.construct = bplib_packed_offload_construct_record,
+                                                                  .destruct  = bplib_packed_offload_destruct_record};
+
+    pool = bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(parent));
+    bplib_mpool_register_blocktype(pool, BPLIB_PACKED_OFFLOAD_MAGIC, &offload_block_api,
+                                   sizeof(bplib_packed_offload_state_t));
+    bplib_mpool_register_blocktype(pool, BPLIB_PACKED_RECORD_MAGIC, &record_block_api,
+                                   sizeof(bplib_packed_offload_record_t));
+
+    return bplib_mpool_ref_make_block(parent, BPLIB_PACKED_OFFLOAD_MAGIC, init_arg);
+}
+
+static int bplib_packed_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                          const void *val)
+{
+    /* there is nothing to configure */
+    return BP_ERROR;
+}
+
+static int bplib_packed_offload_query(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                      const void **val)
+{
+    /* there is nothing to query, and as it is the only module of RAM storage this is what the cache returns */
+    return BP_ERROR;
+}
+
+static int bplib_packed_offload_start(bplib_mpool_block_t *svc)
+{
+    return 0;
+}
+
+static int bplib_packed_offload_stop(bplib_mpool_block_t *svc)
+{
+    bplib_packed_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_PACKED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    bplib_packed_offload_release_all(state);
+
+    return BP_SUCCESS;
+}
+
+/* copies the encoded bundle into the blocks of the record, which have room for all of it */
+static int bplib_packed_offload_pack(bplib_mpool_t *pool, bplib_packed_offload_record_t *rec,
+                                     bplib_mpool_bblock_primary_t *pri_block)
+{
+    v7_stream_export_t      sxs;
+    bplib_mpool_list_iter_t it;
+    size_t                  total_out;
+    size_t                  chunk_sz;
+    int                     iter_stat;
+
+    rec->bundle_size = v7_stream_export_begin(&sxs, pri_block);
+    if (rec->bundle_size == 0)
+    {
+        return BP_ERROR;
+    }
+
+    if (bplib_mpool_bblock_cbor_alloc_n(pool, &rec->encoded_list, rec->bundle_size) < rec->bundle_size)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to allocate blocks for packed bundle\n");
+        return BP_ERROR;
+    }
+
+    total_out = 0;
+    iter_stat = bplib_mpool_list_iter_goto_first(&rec->encoded_list, &it);
+    while (iter_stat == BP_SUCCESS)
+    {
+        chunk_sz = v7_stream_export_next(&sxs, bplib_mpool_bblock_cbor_cast(it.position),
+                                         bplib_mpool_get_generic_data_capacity(it.position));
+        bplib_mpool_bblock_cbor_set_size(it.position, chunk_sz);
+        total_out += chunk_sz;
+        iter_stat = bplib_mpool_list_iter_forward(&it);
+    }
+
+    if (total_out != rec->bundle_size)
+    {
+        return BP_ERROR;
+    }
+
+    /* the flow and the trace are the bundle's, and were released with it, the rest is still correct */
+    rec->delivery                = pri_block->data.delivery;
+    rec->delivery.trace_ref      = NULL;
+    rec->delivery.completion_ref = NULL;
+    rec->delivery.quota_ref      = NULL;
+    rec->delivery.quota_charge   = 0;
+
+    return BP_SUCCESS;
+}
+
+/* decodes the bundle in the record into pri_block */
+static int bplib_packed_offload_unpack(bplib_mpool_t *pool, bplib_packed_offload_record_t *rec,
+                                       bplib_mpool_bblock_primary_t *pri_block)
+{
+    v7_stream_import_t      sis;
+    bplib_mpool_list_iter_t it;
+    bplib_mpool_block_t    *stage_blk;
+    uint8_t                *stage;
+    int                     iter_stat;
+    bool                    import_ok;
+
+    stage_blk = bplib_mpool_bblock_cbor_alloc_sized(pool, BPLIB_PACKED_RESTORE_STAGE);
+    stage     = bplib_mpool_bblock_cbor_cast(stage_blk);
+    if (stage == NULL)
+    {
+        bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to allocate stage for packed bundle\n");
+        return BP_ERROR;
+    }
+
+    /* the extension blocks are only decoded if they are used */
+    v7_stream_import_begin(&sis, pri_block, stage, bplib_mpool_get_generic_data_capacity(stage_blk),
+                           V7_IMPORT_LAZY_DECODE);
+
+    import_ok = true;
+    iter_stat = bplib_mpool_list_iter_goto_first(&rec->encoded_list, &it);
+    while (import_ok && iter_stat == BP_SUCCESS)
+    {
+        import_ok = v7_stream_import_feed(&sis, bplib_mpool_bblock_cbor_cast(it.position),
+                                          bplib_mpool_get_user_content_size(it.position));
+        iter_stat = bplib_mpool_list_iter_forward(&it);
+    }
+
+    import_ok = (v7_stream_import_end(&sis) == rec->bundle_size) && import_ok;
+
+    bplib_mpool_recycle_block(stage_blk);
+
+    if (!import_ok)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Packed bundle did not decode\n");
+        return BP_ERROR;
+    }
+
+    /* every CRC was just checked, whatever the bundle had when it was offloaded */
+    pri_block->data.delivery              = rec->delivery;
+    pri_block->data.delivery.crc_deferred = false;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_packed_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk)
+{
+    bplib_packed_offload_state_t  *state;
+    bplib_packed_offload_record_t *rec;
+    bplib_mpool_bblock_primary_t  *pri_block;
+    bplib_mpool_block_t           *rblk;
+    bplib_mpool_t                 *pool;
+    uint32_t                       slot;
+
+    state     = bplib_mpool_generic_data_cast(svc, BPLIB_PACKED_OFFLOAD_MAGIC);
+    pri_block = bplib_mpool_bblock_primary_cast(pblk);
+    if (state == NULL || pri_block == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    pool = bplib_mpool_get_parent_pool_from_link(svc);
+    rblk = bplib_mpool_generic_data_alloc(pool, BPLIB_PACKED_RECORD_MAGIC, NULL);
+    rec  = bplib_mpool_generic_data_cast(rblk, BPLIB_PACKED_RECORD_MAGIC);
+    if (rec == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    slot = 0;
+    if (bplib_packed_offload_pack(pool, rec, pri_block) == BP_SUCCESS)
+    {
+        slot = bplib_packed_offload_alloc_slot(state);
+    }
+
+    if (slot == 0)
+    {
+        /* the destructor returns any blocks it got */
+        bplib_mpool_recycle_block(rblk);
+        return BP_ERROR;
+    }
+
+    state->slots[slot].rblk = rblk;
+    *sid                    = slot;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_packed_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out)
+{
+    bplib_packed_offload_state_t  *state;
+    bplib_packed_offload_record_t *rec;
+    bplib_mpool_block_t           *pblk;
+    bplib_mpool_t                 *pool;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_PACKED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    *pblk_out = NULL;
+
+    rec = bplib_packed_offload_lookup(state, sid);
+    if (rec == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    pool = bplib_mpool_get_parent_pool_from_link(svc);
+    pblk = bplib_mpool_bblock_primary_alloc(pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MLO, 0);
+    if (pblk == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (bplib_packed_offload_unpack(pool, rec, bplib_mpool_bblock_primary_cast(pblk)) != BP_SUCCESS)
+    {
+        bplib_mpool_recycle_block(pblk);
+        return BP_ERROR;
+    }
+
+    *pblk_out = pblk;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_packed_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid)
+{
+    bplib_packed_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_PACKED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    if (bplib_packed_offload_lookup(state, sid) != NULL)
+    {
+        bplib_mpool_recycle_block(state->slots[sid].rblk);
+        bplib_packed_offload_free_slot(state, sid);
+    }
+
+    return 0;
+}
@@ -0,0 +1,948 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "v7_cache.h"
+#include "v7.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "crc.h"
+#include "file_offload_internal.h"
+
+/* for now this uses POSIX files directly */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+
+#define BPLIB_SEGMENT_PATH_SIZE      128
+#define BPLIB_SEGMENT_OFFLOAD_MAGIC  0x5e9a0ff1
+#define BPLIB_SEGMENT_MAX_SEGMENTS   256
+#define BPLIB_SEGMENT_RECORD_ALIGN   16
+#define BPLIB_SEGMENT_OFFSET_BITS    20
+#define BPLIB_SEGMENT_OFFSET_MASK    ((1UL << BPLIB_SEGMENT_OFFSET_BITS) - 1)
+#define BPLIB_SEGMENT_SIZE           ((off_t)BPLIB_SEGMENT_RECORD_ALIGN << BPLIB_SEGMENT_OFFSET_BITS)
+#define BPLIB_SEGMENT_INDEX_MAGIC    0x5e9a1d8c
+#define BPLIB_SEGMENT_INDEX_BATCH    64
+#define BPLIB_SEGMENT_INDEX_COMPACT  65536
+
+/*
+ * The sid of a record is the segment number (plus one, so that no sid is 0) above the offset of the
+ * record in units of the alignment.  A record is only started below BPLIB_SEGMENT_SIZE, so the offset
+ * always fits, though the record itself may run past the end of the preallocated part of the file.
+ */
+
+static bplib_mpool_block_t *bplib_segment_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg);
+static int                  bplib_segment_offload_configure(bplib_mpool_block_t *svc, int key,
+                                                            bplib_cache_module_valtype_t vt, const void *val);
+static int                  bplib_segment_offload_query(bplib_mpool_block_t *svc, int key,
+                                                        bplib_cache_module_valtype_t vt, const void **val);
+static int                  bplib_segment_offload_start(bplib_mpool_block_t *svc);
+static int                  bplib_segment_offload_stop(bplib_mpool_block_t *svc);
+static int bplib_segment_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
+static int bplib_segment_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out);
+static int bplib_segment_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid);
+static int bplib_segment_offload_flush(bplib_mpool_block_t *svc);
+static int bplib_segment_offload_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg);
+
+/*
+ * Every record offloaded and every one released is appended to the journal.  At start the
+ * checkpoint and then the journal are read back, the last entry for each sid says whether it is
+ * still held, and those still held are written out as the new checkpoint with the journal emptied.
+ * The same is done while running once the journal gets longer than what it was started from.  An
+ * entry that does not check out, such as a partly written one at the end after a crash, ends what
+ * is read from that file.
+ */
+typedef struct bplib_segment_offload_journal_entry
+{
+    uint32_t                    check_val;
+    uint32_t                    record_size; /**< aligned size of the record in its segment, 0 when released */
+    bplib_cache_offload_index_t index;
+    uint32_t                    crc;
+
+} bplib_segment_offload_journal_entry_t;
+
+typedef struct bplib_segment_offload_segment
+{
+    int      fd;           /**< open for as long as the module is started, -1 if never used */
+    uint32_t live_records; /**< records offloaded and not yet released */
+    off_t    end_pos;      /**< where the next record goes, for the active segment */
+    bool     dirty;        /**< written since the last flush */
+
+} bplib_segment_offload_segment_t;
+
+typedef struct bplib_segment_offload_state
+{
+    char                             base_dir[BPLIB_SEGMENT_PATH_SIZE];
+    bplib_segment_offload_segment_t *segments;
+    uint32_t                         active_seg;
+    int                              compress; /**< set by bplib_cache_confkey_offload_compress */
+
+    /*
+     * With a commit delay, records are not flushed as they are written, but together once this many
+     * ms have passed since the first one, or enough bytes have built up, or the cache needs them to be
+     * durable because a DACS is going out.  Without one, every record is flushed on its own.
+     */
+    int      commit_delay;    /**< set by bplib_cache_confkey_offload_commit_delay */
+    int      commit_bytes;    /**< set by bplib_cache_confkey_offload_commit_bytes */
+    size_t   unflushed_bytes; /**< written since the last flush */
+    uint64_t unflushed_time;  /**< DTN time of the first record written since the last flush */
+
+    /* the index of what is held, see bplib_segment_offload_journal_entry_t */
+    int                                    journal_fd;
+    bool                                   journal_dirty;      /**< appended to since the last flush */
+    uint32_t                               journal_entries;    /**< appended since the last checkpoint */
+    uint32_t                               checkpoint_entries; /**< held as of the last checkpoint */
+    bplib_segment_offload_journal_entry_t *recovered;          /**< held from before the start, until recover() */
+    uint32_t                               num_recovered;
+
+} bplib_segment_offload_state_t;
+
+static const bplib_cache_offload_api_t BPLIB_SEGMENT_OFFLOAD_INTERNAL_API = {
+    .std.module_type = bplib_cache_module_type_offload,
+    .std.instantiate = bplib_segment_offload_instantiate,
+    .std.configure   = bplib_segment_offload_configure,
+    .std.query       = bplib_segment_offload_query,
+    .std.start       = bplib_segment_offload_start,
+    .std.stop        = bplib_segment_offload_stop,
+    .offload         = bplib_segment_offload_offload,
+    .restore         = bplib_segment_offload_restore,
+    .release         = bplib_segment_offload_release,
+    .flush           = bplib_segment_offload_flush,
+    .recover         = bplib_segment_offload_recover};
+
+const bplib_cache_module_api_t *BPLIB_SEGMENT_OFFLOAD_API =
+    (const bplib_cache_module_api_t *)&BPLIB_SEGMENT_OFFLOAD_INTERNAL_API;
+
+static uint32_t bplib_segment_offload_journal_crc(const bplib_segment_offload_journal_entry_t *entry)
+{
+    bp_crcval_t crc;
+
+    crc = bplib_crc_initial_value(&BPLIB_CRC32_CASTAGNOLI);
+    crc = bplib_crc_update(&BPLIB_CRC32_CASTAGNOLI, crc, entry, offsetof(bplib_segment_offload_journal_entry_t, crc));
+
+    return bplib_crc_finalize(&BPLIB_CRC32_CASTAGNOLI, crc);
+}
+
+static int bplib_segment_offload_journal_append(bplib_segment_offload_state_t         *state,
+                                                bplib_segment_offload_journal_entry_t *entry)
+{
+    entry->check_val = BPLIB_SEGMENT_INDEX_MAGIC;
+    entry->crc       = bplib_segment_offload_journal_crc(entry);
+
+    if (write(state->journal_fd, entry, sizeof(*entry)) != sizeof(*entry))
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "write(): %s\n", strerror(errno));
+    }
+
+    ++state->journal_entries;
+    state->journal_dirty = true;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_segment_offload_read_index_file(const char *name_buf, bplib_segment_offload_journal_entry_t **list,
+                                                 uint32_t *count, uint32_t *capacity)
+{
+    bplib_segment_offload_journal_entry_t  batch[BPLIB_SEGMENT_INDEX_BATCH];
+    bplib_segment_offload_journal_entry_t *grown;
+    ssize_t                                got;
+    uint32_t                               n;
+    uint32_t                               i;
+    bool                                   more;
+    int                                    result;
+    int                                    fd;
+
+    fd = open(name_buf, O_RDONLY);
+    if (fd < 0)
+    {
+        /* not there yet is the same as empty */
+        if (errno == ENOENT)
+        {
+            return BP_SUCCESS;
+        }
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "open(%s): %s\n", name_buf, strerror(errno));
+    }
+
+    result = BP_SUCCESS;
+    more   = true;
+    while (more)
+    {
+        got  = read(fd, batch, sizeof(batch));
+        n    = (got > 0) ? (uint32_t)(got / sizeof(batch[0])) : 0;
+        more = (n == BPLIB_SEGMENT_INDEX_BATCH);
+
+        for (i = 0; i < n; ++i)
+        {
+            if (batch[i].check_val != BPLIB_SEGMENT_INDEX_MAGIC ||
+                batch[i].crc != bplib_segment_offload_journal_crc(&batch[i]))
+            {
+                more = false;
+                break;
+            }
+
+            if (*count == *capacity)
+            {
+                *capacity = (*capacity == 0) ? 1024 : (*capacity * 2);
+                grown     = bplib_os_calloc(sizeof(*grown) * (*capacity));
+                if (grown == NULL)
+                {
+                    result = BP_ERROR;
+                    more   = false;
+                    break;
+                }
+
+                if (*list != NULL)
+                {
+                    memcpy(grown, *list, sizeof(*grown) * (*count));
+                    bplib_os_free(*list);
+                }
+
+                *list = grown;
+            }
+
+            /* the check value has done its job, so in memory it holds the order the entries were read in */
+            batch[i].check_val  = *count;
+            (*list)[(*count)++] = batch[i];
+        }
+    }
+
+    close(fd);
+
+    return result;
+}
+
+static int bplib_segment_offload_compare_entries(const void *a, const void *b)
+{
+    const bplib_segment_offload_journal_entry_t *ea = a;
+    const bplib_segment_offload_journal_entry_t *eb = b;
+
+    if (ea->index.sid != eb->index.sid)
+    {
+        return (ea->index.sid < eb->index.sid) ? -1 : 1;
+    }
+
+    return (ea->check_val < eb->check_val) ? -1 : (ea->check_val > eb->check_val);
+}
+
+/*
+ * Puts the checkpoint and journal together into the records still held, each one once.  What
+ * is returned in list is then owned by the caller, to be freed with bplib_os_free().
+ */
+static int bplib_segment_offload_load_index(bplib_segment_offload_state_t          *state,
+                                            bplib_segment_offload_journal_entry_t **list, uint32_t *count)
+{
+    char     name_buf[BPLIB_SEGMENT_PATH_SIZE];
+    uint32_t capacity;
+    uint32_t in;
+    uint32_t out;
+    int      result;
+
+    *list    = NULL;
+    *count   = 0;
+    capacity = 0;
+
+    snprintf(name_buf, sizeof(name_buf), "%s/index.ckp", state->base_dir);
+    result = bplib_segment_offload_read_index_file(name_buf, list, count, &capacity);
+    if (result == BP_SUCCESS)
+    {
+        snprintf(name_buf, sizeof(name_buf), "%s/index.jnl", state->base_dir);
+        result = bplib_segment_offload_read_index_file(name_buf, list, count, &capacity);
+    }
+
+    if (result != BP_SUCCESS)
+    {
+        bplib_os_free(*list);
+        *list  = NULL;
+        *count = 0;
+        return BP_ERROR;
+    }
+
+    if (*list != NULL)
+    {
+        qsort(*list, *count, sizeof(**list), bplib_segment_offload_compare_entries);
+    }
+
+    /* only the last entry for a sid counts, and only if it was not a release */
+    out = 0;
+    for (in = 0; in < *count; ++in)
+    {
+        if ((in + 1) < *count && (*list)[in + 1].index.sid == (*list)[in].index.sid)
+        {
+            continue;
+        }
+        if ((*list)[in].record_size != 0)
+        {
+            (*list)[out] = (*list)[in];
+            ++out;
+        }
+    }
+
+    *count = out;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Replaces the checkpoint with what is in list, which must be everything still held, and empties
+ * the journal.  The new checkpoint is complete on disk before it takes the place of the old one,
+ * and the journal it came from still gives the same result if it is not emptied after all.
+ */
+static int bplib_segment_offload_write_checkpoint(bplib_segment_offload_state_t         *state,
+                                                  bplib_segment_offload_journal_entry_t *list, uint32_t count)
+{
+    char     tmp_name[BPLIB_SEGMENT_PATH_SIZE];
+    char     name_buf[BPLIB_SEGMENT_PATH_SIZE];
+    uint32_t i;
+    ssize_t  sz;
+    int      fd;
+
+    for (i = 0; i < count; ++i)
+    {
+        list[i].check_val = BPLIB_SEGMENT_INDEX_MAGIC;
+        list[i].crc       = bplib_segment_offload_journal_crc(&list[i]);
+    }
+
+    snprintf(tmp_name, sizeof(tmp_name), "%s/index.tmp", state->base_dir);
+    snprintf(name_buf, sizeof(name_buf), "%s/index.ckp", state->base_dir);
+
+    fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "open(%s): %s\n", tmp_name, strerror(errno));
+    }
+
+    sz = sizeof(*list) * count;
+    if ((count > 0 && write(fd, list, sz) != sz) || fdatasync(fd) != 0)
+    {
+        close(fd);
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "write(%s): %s\n", tmp_name, strerror(errno));
+    }
+
+    close(fd);
+
+    if (rename(tmp_name, name_buf) != 0)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "rename(%s): %s\n", tmp_name, strerror(errno));
+    }
+
+    /* the rename itself has to be durable before the journal can go */
+    fd = open(state->base_dir, O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+
+    if (ftruncate(state->journal_fd, 0) != 0)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "ftruncate(): %s\n", strerror(errno));
+    }
+
+    state->journal_entries    = 0;
+    state->journal_dirty      = false;
+    state->checkpoint_entries = count;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_segment_offload_compact_index(bplib_segment_offload_state_t *state)
+{
+    bplib_segment_offload_journal_entry_t *list;
+    uint32_t                               count;
+    int                                    result;
+
+    result = bplib_segment_offload_load_index(state, &list, &count);
+    if (result == BP_SUCCESS)
+    {
+        result = bplib_segment_offload_write_checkpoint(state, list, count);
+        bplib_os_free(list);
+    }
+
+    return result;
+}
+
+static int bplib_segment_offload_flush_segments(bplib_segment_offload_state_t *state)
+{
+    uint32_t seg;
+    int      result;
+
+    result = BP_SUCCESS;
+    if (state->segments != NULL)
+    {
+        for (seg = 0; seg < BPLIB_SEGMENT_MAX_SEGMENTS; ++seg)
+        {
+            /* the file size does not change within the preallocated part, so only the data has to be flushed */
+            if (state->segments[seg].dirty)
+            {
+                if (fdatasync(state->segments[seg].fd) == 0)
+                {
+                    state->segments[seg].dirty = false;
+                }
+                else
+                {
+                    result = bplog(NULL, BP_FLAG_DIAGNOSTIC, "fdatasync(): %s\n", strerror(errno));
+                }
+            }
+        }
+    }
+
+    /* the journal goes last, so it never says a record is held before the record itself is durable */
+    if (result == BP_SUCCESS && state->journal_dirty)
+    {
+        if (fdatasync(state->journal_fd) == 0)
+        {
+            state->journal_dirty = false;
+        }
+        else
+        {
+            result = bplog(NULL, BP_FLAG_DIAGNOSTIC, "fdatasync(): %s\n", strerror(errno));
+        }
+    }
+
+    if (result == BP_SUCCESS)
+    {
+        state->unflushed_bytes = 0;
+        state->unflushed_time  = 0;
+
+        if (state->journal_entries >= BPLIB_SEGMENT_INDEX_COMPACT &&
+            state->journal_entries >= state->checkpoint_entries)
+        {
+            /* not fatal, the journal just keeps growing until the next try */
+            bplib_segment_offload_compact_index(state);
+        }
+    }
+
+    return result;
+}
+
+static void bplib_segment_offload_close_all(bplib_segment_offload_state_t *state)
+{
+    uint32_t seg;
+
+    if (state->segments != NULL)
+    {
+        bplib_segment_offload_flush_segments(state);
+
+        for (seg = 0; seg < BPLIB_SEGMENT_MAX_SEGMENTS; ++seg)
+        {
+            if (state->segments[seg].fd >= 0)
+            {
+                close(state->segments[seg].fd);
+            }
+        }
+
+        if (state->journal_fd >= 0)
+        {
+            close(state->journal_fd);
+        }
+
+        bplib_os_free(state->recovered);
+        state->recovered     = NULL;
+        state->num_recovered = 0;
+
+        bplib_os_free(state->segments);
+        state->segments = NULL;
+    }
+}
+
+static int bplib_segment_offload_construct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    return BP_SUCCESS;
+}
+
+static int bplib_segment_offload_destruct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_segment_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* in case it was never stopped */
+    bplib_segment_offload_close_all(state);
+
+    return BP_SUCCESS;
+}
+
+static bplib_mpool_block_t *bplib_segment_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg)
+{
+    bplib_mpool_t *pool;
+
+    static const bplib_mpool_blocktype_api_t offload_block_api = {.construct = bplib_segment_offload_construct_block,
+                                                                  .destruct  = bplib_segment_offload_destruct_block};
+
+    pool = bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(parent));
+    bplib_mpool_register_blocktype(pool, BPLIB_SEGMENT_OFFLOAD_MAGIC, &offload_block_api,
+                                   sizeof(bplib_segment_offload_state_t));
+
+    return bplib_mpool_ref_make_block(parent, BPLIB_SEGMENT_OFFLOAD_MAGIC, init_arg);
+}
+
+static int bplib_segment_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                           const void *val)
+{
+    bplib_segment_offload_state_t *state;
+    int                            result;
+
+    result = BP_ERROR;
+    state  = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state != NULL)
+    {
+        switch (key)
+        {
+            case bplib_cache_confkey_offload_base_dir:
+                strncpy(state->base_dir, val, sizeof(state->base_dir) - 1);
+                state->base_dir[sizeof(state->base_dir) - 1] = 0;
+                result                                       = BP_SUCCESS;
+                break;
+
+            case bplib_cache_confkey_offload_commit_delay:
+                state->commit_delay = *((const int *)val);
+                result              = BP_SUCCESS;
+                break;
+
+            case bplib_cache_confkey_offload_commit_bytes:
+                state->commit_bytes = *((const int *)val);
+                result              = BP_SUCCESS;
+                break;
+
+            case bplib_cache_confkey_offload_compress:
+                state->compress = *((const int *)val);
+                result          = BP_SUCCESS;
+                break;
+        }
+    }
+
+    return result;
+}
+
+static int bplib_segment_offload_query(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                       const void **val)
+{
+    return 0;
+}
+
+static int bplib_segment_offload_open_segment(bplib_segment_offload_state_t *state, uint32_t seg)
+{
+    char name_buf[BPLIB_SEGMENT_PATH_SIZE];
+    int  fd;
+    int  err;
+
+    if (state->segments[seg].fd >= 0)
+    {
+        return BP_SUCCESS;
+    }
+
+    snprintf(name_buf, sizeof(name_buf), "%s/seg%04x.dat", state->base_dir, (unsigned int)seg);
+
+    fd = open(name_buf, O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "open(%s): %s\n", name_buf, strerror(errno));
+    }
+
+    /* not fatal, the file just grows as it is written if the space cannot be reserved up front */
+    err = posix_fallocate(fd, 0, BPLIB_SEGMENT_SIZE);
+    if (err != 0)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "posix_fallocate(%s): %s\n", name_buf, strerror(err));
+    }
+
+    state->segments[seg].fd = fd;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Moves on from a full segment.  One whose records have all been released is preferred over one
+ * never used, as its file has already been allocated, so the store only grows while every segment
+ * still holds something.
+ */
+static int bplib_segment_offload_next_segment(bplib_segment_offload_state_t *state)
+{
+    uint32_t seg;
+    uint32_t next_seg;
+
+    next_seg = BPLIB_SEGMENT_MAX_SEGMENTS;
+    for (seg = 0; seg < BPLIB_SEGMENT_MAX_SEGMENTS; ++seg)
+    {
+        if (seg != state->active_seg && state->segments[seg].live_records == 0)
+        {
+            if (state->segments[seg].fd >= 0)
+            {
+                next_seg = seg;
+                break;
+            }
+            if (next_seg == BPLIB_SEGMENT_MAX_SEGMENTS)
+            {
+                next_seg = seg;
+            }
+        }
+    }
+
+    if (next_seg == BPLIB_SEGMENT_MAX_SEGMENTS)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "All storage segments are in use\n");
+    }
+
+    if (bplib_segment_offload_open_segment(state, next_seg) != BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    state->active_seg                 = next_seg;
+    state->segments[next_seg].end_pos = 0;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * With the index loaded, the segments holding its records are opened again and their ends put
+ * past the last record, and it is rewritten as the checkpoint to start the journal from.
+ */
+static int bplib_segment_offload_start_index(bplib_segment_offload_state_t *state)
+{
+    char                                   name_buf[BPLIB_SEGMENT_PATH_SIZE];
+    bplib_segment_offload_journal_entry_t *entry;
+    bplib_segment_offload_segment_t       *seg;
+    unsigned long                          seg_num;
+    uint32_t                               i;
+    off_t                                  pos;
+
+    for (i = 0; i < state->num_recovered; ++i)
+    {
+        entry   = &state->recovered[i];
+        seg_num = entry->index.sid >> BPLIB_SEGMENT_OFFSET_BITS;
+        pos     = (off_t)(entry->index.sid & BPLIB_SEGMENT_OFFSET_MASK) * BPLIB_SEGMENT_RECORD_ALIGN;
+        if (seg_num == 0 || seg_num > BPLIB_SEGMENT_MAX_SEGMENTS ||
+            bplib_segment_offload_open_segment(state, seg_num - 1) != BP_SUCCESS)
+        {
+            return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unable to recover storage segments\n");
+        }
+
+        seg = &state->segments[seg_num - 1];
+        ++seg->live_records;
+        if (seg->end_pos < pos + entry->record_size)
+        {
+            seg->end_pos = pos + entry->record_size;
+        }
+    }
+
+    snprintf(name_buf, sizeof(name_buf), "%s/index.jnl", state->base_dir);
+    state->journal_fd = open(name_buf, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (state->journal_fd < 0)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "open(%s): %s\n", name_buf, strerror(errno));
+    }
+
+    return bplib_segment_offload_write_checkpoint(state, state->recovered, state->num_recovered);
+}
+
+static int bplib_segment_offload_start(bplib_mpool_block_t *svc)
+{
+    bplib_segment_offload_state_t *state;
+    uint32_t                       seg;
+    int                            result;
+
+    result = BP_ERROR;
+    state  = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state != NULL && state->segments == NULL)
+    {
+        result = mkdir(state->base_dir, 0700);
+        if (result == 0 || errno == EEXIST)
+        {
+            state->segments = bplib_os_calloc(sizeof(bplib_segment_offload_segment_t) * BPLIB_SEGMENT_MAX_SEGMENTS);
+        }
+
+        result = BP_ERROR;
+        if (state->segments != NULL)
+        {
+            for (seg = 0; seg < BPLIB_SEGMENT_MAX_SEGMENTS; ++seg)
+            {
+                state->segments[seg].fd = -1;
+            }
+
+            state->journal_fd = -1;
+            result            = bplib_segment_offload_load_index(state, &state->recovered, &state->num_recovered);
+        }
+
+        if (result == BP_SUCCESS)
+        {
+            result = bplib_segment_offload_start_index(state);
+        }
+
+        if (result == BP_SUCCESS)
+        {
+            /* new records go after whatever is still held in the first segment */
+            state->active_seg = 0;
+            result            = bplib_segment_offload_open_segment(state, 0);
+        }
+
+        /* so that it can be started again */
+        if (result != BP_SUCCESS)
+        {
+            bplib_segment_offload_close_all(state);
+        }
+    }
+
+    return result;
+}
+
+static int bplib_segment_offload_stop(bplib_mpool_block_t *svc)
+{
+    bplib_segment_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state != NULL)
+    {
+        bplib_segment_offload_close_all(state);
+    }
+
+    return 0;
+}
+
+static bplib_segment_offload_segment_t *bplib_segment_offload_lookup(bplib_segment_offload_state_t *state,
+                                                                     bp_sid_t sid, off_t *pos)
+{
+    bplib_segment_offload_segment_t *seg;
+    unsigned long                    seg_num;
+
+    seg_num = sid >> BPLIB_SEGMENT_OFFSET_BITS;
+    if (state->segments == NULL || seg_num == 0 || seg_num > BPLIB_SEGMENT_MAX_SEGMENTS)
+    {
+        return NULL;
+    }
+
+    seg  = &state->segments[seg_num - 1];
+    *pos = (off_t)(sid & BPLIB_SEGMENT_OFFSET_MASK) * BPLIB_SEGMENT_RECORD_ALIGN;
+    if (seg->fd < 0 || seg->live_records == 0)
+    {
+        return NULL;
+    }
+
+    return seg;
+}
+
+static void bplib_segment_offload_index_bundle(bplib_cache_offload_index_t *index, bp_sid_t sid,
+                                              bplib_mpool_block_t *pblk)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    bp_ipn_addr_t                 dest_addr;
+
+    /* the same things the cache takes from the bundle when it is stored */
+    pri_block  = bplib_mpool_bblock_primary_cast(pblk);
+    index->sid = sid;
+    if (pri_block != NULL)
+    {
+        v7_get_eid(&index->flow_id, &pri_block->data.logical.sourceEID);
+        v7_get_eid(&dest_addr, &pri_block->data.logical.destinationEID);
+        index->sequence_num       = pri_block->data.logical.creationTimeStamp.sequence_num;
+        index->final_dest_node    = dest_addr.node_number;
+        index->expire_time        = pri_block->data.logical.creationTimeStamp.time + pri_block->data.logical.lifetime;
+        index->bundle_encode_size = pri_block->bundle_encode_size_cache;
+    }
+}
+
+static int bplib_segment_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk)
+{
+    bplib_segment_offload_state_t        *state;
+    bplib_segment_offload_segment_t      *seg;
+    bplib_file_offload_record_t           rec;
+    bplib_segment_offload_journal_entry_t entry;
+    bp_sid_t                              new_sid;
+    off_t                                 pos;
+    off_t                                 end_pos;
+    int                                   result;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state == NULL || state->segments == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    if (state->segments[state->active_seg].end_pos >= BPLIB_SEGMENT_SIZE &&
+        bplib_segment_offload_next_segment(state) != BP_SUCCESS)
+    {
+        return BP_ERROR;
+    }
+
+    seg = &state->segments[state->active_seg];
+    pos = seg->end_pos;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.check_val = BPLIB_SEGMENT_OFFLOAD_MAGIC;
+    if (state->compress)
+    {
+        rec.flags = BPLIB_FILE_OFFLOAD_FLAG_COMPRESSED;
+    }
+
+    result = bplib_file_offload_write_record(seg->fd, pos, &rec, pblk);
+
+    if (result == BP_SUCCESS)
+    {
+        new_sid = ((bp_sid_t)(state->active_seg + 1) << BPLIB_SEGMENT_OFFSET_BITS) |
+                  (bp_sid_t)(pos / BPLIB_SEGMENT_RECORD_ALIGN);
+
+        end_pos = pos + sizeof(rec) + rec.num_bytes + BPLIB_SEGMENT_RECORD_ALIGN - 1;
+        end_pos -= end_pos % BPLIB_SEGMENT_RECORD_ALIGN;
+
+        /* the journal entry is made durable by the same flush as the record */
+        memset(&entry, 0, sizeof(entry));
+        entry.record_size = (uint32_t)(end_pos - pos);
+        bplib_segment_offload_index_bundle(&entry.index, new_sid, pblk);
+        result = bplib_segment_offload_journal_append(state, &entry);
+    }
+
+    /* on failure the end does not move, so the next record is written over whatever got written of this one */
+    if (result == BP_SUCCESS)
+    {
+        seg->dirty = true;
+        state->unflushed_bytes += sizeof(rec) + rec.num_bytes;
+        if (state->unflushed_time == 0)
+        {
+            state->unflushed_time = bplib_os_get_dtntime_coarse_ms();
+        }
+
+        if (state->commit_delay <= 0 ||
+            (state->commit_bytes > 0 && state->unflushed_bytes >= (size_t)state->commit_bytes) ||
+            (bplib_os_get_dtntime_coarse_ms() - state->unflushed_time) >= (uint64_t)state->commit_delay)
+        {
+            result = bplib_segment_offload_flush_segments(state);
+            if (result != BP_SUCCESS)
+            {
+                /* the journal already has it, so it has to say it is gone again */
+                entry.record_size = 0;
+                bplib_segment_offload_journal_append(state, &entry);
+            }
+        }
+    }
+
+    if (result == BP_SUCCESS)
+    {
+        *sid         = new_sid;
+        seg->end_pos = end_pos;
+        ++seg->live_records;
+    }
+
+    return result;
+}
+
+static int bplib_segment_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out)
+{
+    bplib_segment_offload_state_t   *state;
+    bplib_segment_offload_segment_t *seg;
+    off_t                            pos;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    *pblk_out = NULL;
+
+    seg = bplib_segment_offload_lookup(state, sid, &pos);
+    if (seg == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    return bplib_file_offload_restore_record(seg->fd, pos, BPLIB_SEGMENT_OFFLOAD_MAGIC,
+                                             bplib_mpool_get_parent_pool_from_link(svc), pblk_out);
+}
+
+static int bplib_segment_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid)
+{
+    bplib_segment_offload_state_t        *state;
+    bplib_segment_offload_segment_t      *seg;
+    bplib_segment_offload_journal_entry_t entry;
+    off_t                                 pos;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    seg = bplib_segment_offload_lookup(state, sid, &pos);
+    if (seg != NULL)
+    {
+        /* not flushed here, the worst a lost release does is bring back a bundle already done with */
+        memset(&entry, 0, sizeof(entry));
+        entry.index.sid = sid;
+        bplib_segment_offload_journal_append(state, &entry);
+
+        --seg->live_records;
+
+        /* the active segment can go back to the start right away, any other is picked up when it fills */
+        if (seg->live_records == 0 && seg == &state->segments[state->active_seg])
+        {
+            seg->end_pos = 0;
+        }
+    }
+
+    return 0;
+}
+
+static int bplib_segment_offload_flush(bplib_mpool_block_t *svc)
+{
+    bplib_segment_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    return bplib_segment_offload_flush_segments(state);
+}
+
+static int bplib_segment_offload_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg)
+{
+    bplib_segment_offload_state_t *state;
+    uint32_t                       i;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_SEGMENT_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    /* only the bundles held at start are handed over, and only once */
+    for (i = 0; i < state->num_recovered; ++i)
+    {
+        func(arg, &state->recovered[i].index);
+    }
+
+    bplib_os_free(state->recovered);
+    state->recovered     = NULL;
+    state->num_recovered = 0;
+
+    return BP_SUCCESS;
+}
@@ -0,0 +1,585 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "v7_cache.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+
+#define BPLIB_TIERED_OFFLOAD_MAGIC   0x7e1d0ff1
+#define BPLIB_TIERED_INITIAL_SLOTS   256
+
+/*
+ * The sid of a bundle here is the index of its slot, which stays the same while the bundle moves
+ * between memory and the lower module.  Slot 0 is never handed out, it is the head of the list of
+ * slots in memory, most recently used first, which is where the budget is enforced from the end of.
+ */
+
+static bplib_mpool_block_t *bplib_tiered_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg);
+static int                  bplib_tiered_offload_configure(bplib_mpool_block_t *svc, int key,
+                                                           bplib_cache_module_valtype_t vt, const void *val);
+static int                  bplib_tiered_offload_query(bplib_mpool_block_t *svc, int key,
+                                                       bplib_cache_module_valtype_t vt, const void **val);
+static int                  bplib_tiered_offload_start(bplib_mpool_block_t *svc);
+static int                  bplib_tiered_offload_stop(bplib_mpool_block_t *svc);
+static int bplib_tiered_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk);
+static int bplib_tiered_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out);
+static int bplib_tiered_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid);
+static int bplib_tiered_offload_flush(bplib_mpool_block_t *svc);
+static int bplib_tiered_offload_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg);
+
+typedef struct bplib_tiered_offload_slot
+{
+    bplib_mpool_ref_t ref;       /**< the copy in memory, NULL if only in the lower module */
+    bp_sid_t          lower_sid; /**< the copy in the lower module, 0 if only in memory */
+    size_t            size;      /**< counted against the budget while in memory */
+    uint32_t          prev;      /**< in the list of slots in memory */
+    uint32_t          next;      /**< in the list of slots in memory, or the next free slot */
+    bool              in_use;
+
+} bplib_tiered_offload_slot_t;
+
+typedef struct bplib_tiered_offload_state
+{
+    const bplib_cache_offload_api_t *lower_api;
+    bplib_mpool_block_t             *lower_blk;
+
+    int    ram_budget; /**< set by bplib_cache_confkey_offload_ram_budget */
+    size_t ram_bytes;  /**< size of the slots in memory */
+
+    bplib_tiered_offload_slot_t *slots;
+    uint32_t                     num_slots;
+    uint32_t                     free_slot; /**< first of the free slots, 0 if none */
+
+} bplib_tiered_offload_state_t;
+
+typedef struct bplib_tiered_offload_recover_arg
+{
+    bplib_tiered_offload_state_t      *state;
+    bplib_cache_offload_recover_func_t func;
+    void                              *arg;
+
+} bplib_tiered_offload_recover_arg_t;
+
+static const bplib_cache_offload_api_t BPLIB_TIERED_OFFLOAD_INTERNAL_API = {
+    .std.module_type = bplib_cache_module_type_offload,
+    .std.instantiate = bplib_tiered_offload_instantiate,
+    .std.configure   = bplib_tiered_offload_configure,
+    .std.query       = bplib_tiered_offload_query,
+    .std.start       = bplib_tiered_offload_start,
+    .std.stop        = bplib_tiered_offload_stop,
+    .offload         = bplib_tiered_offload_offload,
+    .restore         = bplib_tiered_offload_restore,
+    .release         = bplib_tiered_offload_release,
+    .flush           = bplib_tiered_offload_flush,
+    .recover         = bplib_tiered_offload_recover};
+
+const bplib_cache_module_api_t *BPLIB_TIERED_OFFLOAD_API =
+    (const bplib_cache_module_api_t *)&BPLIB_TIERED_OFFLOAD_INTERNAL_API;
+
+static void bplib_tiered_offload_unlink(bplib_tiered_offload_state_t *state, uint32_t slot)
+{
+    state->slots[state->slots[slot].prev].next = state->slots[slot].next;
+    state->slots[state->slots[slot].next].prev = state->slots[slot].prev;
+}
+
+static void bplib_tiered_offload_link_first(bplib_tiered_offload_state_t *state, uint32_t slot)
+{
+    state->slots[slot].prev                    = 0;
+    state->slots[slot].next                    = state->slots[0].next;
+    state->slots[state->slots[0].next].prev    = slot;
+    state->slots[0].next                       = slot;
+}
+
+static uint32_t bplib_tiered_offload_alloc_slot(bplib_tiered_offload_state_t *state)
+{
+    bplib_tiered_offload_slot_t *grown;
+    uint32_t                     num_slots;
+    uint32_t                     slot;
+
+    if (state->free_slot == 0)
+    {
+        num_slots = (state->num_slots == 0) ? BPLIB_TIERED_INITIAL_SLOTS : (state->num_slots * 2);
+        grown     = bplib_os_calloc(sizeof(*grown) * num_slots);
+        if (grown == NULL)
+        {
+            bplog(NULL, BP_FLAG_OUT_OF_MEMORY, "Unable to track offloaded bundle\n");
+            return 0;
+        }
+
+        if (state->slots != NULL)
+        {
+            memcpy(grown, state->slots, sizeof(*grown) * state->num_slots);
+            bplib_os_free(state->slots);
+        }
+
+        /* the new slots are all free, in order, and slot 0 starts as an empty list */
+        for (slot = num_slots - 1; slot >= state->num_slots && slot > 0; --slot)
+        {
+            grown[slot].next = state->free_slot;
+            state->free_slot = slot;
+        }
+
+        state->slots     = grown;
+        state->num_slots = num_slots;
+    }
+
+    slot             = state->free_slot;
+    state->free_slot = state->slots[slot].next;
+    memset(&state->slots[slot], 0, sizeof(state->slots[slot]));
+    state->slots[slot].in_use = true;
+
+    return slot;
+}
+
+static void bplib_tiered_offload_free_slot(bplib_tiered_offload_state_t *state, uint32_t slot)
+{
+    state->slots[slot].in_use = false;
+    state->slots[slot].next   = state->free_slot;
+    state->free_slot          = slot;
+}
+
+static bplib_tiered_offload_slot_t *bplib_tiered_offload_lookup(bplib_tiered_offload_state_t *state, bp_sid_t sid)
+{
+    if (sid == 0 || sid >= state->num_slots || !state->slots[sid].in_use)
+    {
+        return NULL;
+    }
+
+    return &state->slots[sid];
+}
+
+/* makes sure the lower module has a copy, the one in memory is kept */
+static int bplib_tiered_offload_write_lower(bplib_tiered_offload_state_t *state, bplib_tiered_offload_slot_t *entry)
+{
+    if (entry->lower_sid != 0)
+    {
+        return BP_SUCCESS;
+    }
+
+    return state->lower_api->offload(state->lower_blk, &entry->lower_sid, bplib_mpool_dereference(entry->ref));
+}
+
+static void bplib_tiered_offload_drop_copy(bplib_tiered_offload_state_t *state, uint32_t slot)
+{
+    bplib_tiered_offload_unlink(state, slot);
+    bplib_mpool_ref_release(state->slots[slot].ref);
+    state->slots[slot].ref = NULL;
+    state->ram_bytes -= state->slots[slot].size;
+}
+
+/*
+ * Moves the least recently used bundles out of memory until the rest fit, other than keep_slot,
+ * which is just being handed to the cache.  One that cannot be written to the lower module stays
+ * in memory, and so does everything used more recently than it, in which case this fails.
+ */
+static int bplib_tiered_offload_enforce_budget(bplib_tiered_offload_state_t *state, uint32_t keep_slot)
+{
+    uint32_t slot;
+
+    while (state->ram_bytes > (size_t)state->ram_budget)
+    {
+        slot = state->slots[0].prev;
+        if (slot == 0 || slot == keep_slot)
+        {
+            break;
+        }
+
+        if (bplib_tiered_offload_write_lower(state, &state->slots[slot]) != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unable to move bundle out of memory\n");
+            return BP_ERROR;
+        }
+
+        bplib_tiered_offload_drop_copy(state, slot);
+    }
+
+    return BP_SUCCESS;
+}
+
+static void bplib_tiered_offload_release_all(bplib_tiered_offload_state_t *state)
+{
+    uint32_t slot;
+
+    if (state->slots != NULL)
+    {
+        for (slot = 1; slot < state->num_slots; ++slot)
+        {
+            if (state->slots[slot].ref != NULL)
+            {
+                bplib_mpool_ref_release(state->slots[slot].ref);
+            }
+        }
+
+        bplib_os_free(state->slots);
+        state->slots     = NULL;
+        state->num_slots = 0;
+        state->free_slot = 0;
+        state->ram_bytes = 0;
+    }
+}
+
+static int bplib_tiered_offload_construct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_tiered_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL || arg == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    state->lower_api = arg;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_tiered_offload_destruct_block(void *arg, bplib_mpool_block_t *blk)
+{
+    bplib_tiered_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(blk, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* in case it was never stopped */
+    bplib_tiered_offload_release_all(state);
+
+    return BP_SUCCESS;
+}
+
+static bplib_mpool_block_t *bplib_tiered_offload_instantiate(bplib_mpool_ref_t parent, void *init_arg)
+{
+    const bplib_cache_module_api_t *lower_api;
+    bplib_tiered_offload_state_t   *state;
+    bplib_mpool_block_t            *svc;
+    bplib_mpool_t                  *pool;
+
+    static const bplib_mpool_blocktype_api_t offload_block_api = {.construct = bplib_tiered_offload_construct_block,
+                                                                  .destruct  = bplib_tiered_offload_destruct_block};
+
+    /* only another offload module can be the lower tier */
+    lower_api = init_arg;
+    if (lower_api == NULL || lower_api->module_type != bplib_cache_module_type_offload)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Tiered offload needs an offload module below it\n");
+        return NULL;
+    }
+
+    pool = bplib_mpool_get_parent_pool_from_link(bplib_mpool_dereference(parent));
+    bplib_mpool_register_blocktype(pool, BPLIB_TIERED_OFFLOAD_MAGIC, &offload_block_api,
+                                   sizeof(bplib_tiered_offload_state_t));
+
+    svc   = bplib_mpool_ref_make_block(parent, BPLIB_TIERED_OFFLOAD_MAGIC, init_arg);
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return NULL;
+    }
+
+    state->lower_blk = lower_api->instantiate(parent, NULL);
+    if (state->lower_blk == NULL)
+    {
+        bplib_mpool_recycle_block(svc);
+        return NULL;
+    }
+
+    return svc;
+}
+
+static int bplib_tiered_offload_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                          const void *val)
+{
+    bplib_tiered_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (key == bplib_cache_confkey_offload_ram_budget)
+    {
+        state->ram_budget = *((const int *)val);
+        return BP_SUCCESS;
+    }
+
+    return state->lower_api->std.configure(state->lower_blk, key, vt, val);
+}
+
+static int bplib_tiered_offload_query(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                      const void **val)
+{
+    bplib_tiered_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    return state->lower_api->std.query(state->lower_blk, key, vt, val);
+}
+
+static int bplib_tiered_offload_start(bplib_mpool_block_t *svc)
+{
+    bplib_tiered_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    return state->lower_api->std.start(state->lower_blk);
+}
+
+static int bplib_tiered_offload_stop(bplib_mpool_block_t *svc)
+{
+    bplib_tiered_offload_state_t *state;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    /* whatever is only in memory is written out first, so it is not lost */
+    bplib_tiered_offload_flush(svc);
+    bplib_tiered_offload_release_all(state);
+
+    return state->lower_api->std.stop(state->lower_blk);
+}
+
+static int bplib_tiered_offload_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk)
+{
+    bplib_tiered_offload_state_t *state;
+    bplib_mpool_bblock_primary_t *pri_block;
+    bplib_tiered_offload_slot_t  *entry;
+    uint32_t                      slot;
+
+    state     = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    pri_block = bplib_mpool_bblock_primary_cast(pblk);
+    if (state == NULL || pri_block == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    slot = bplib_tiered_offload_alloc_slot(state);
+    if (slot == 0)
+    {
+        return BP_ERROR;
+    }
+
+    entry      = &state->slots[slot];
+    entry->ref = bplib_mpool_ref_create(pblk);
+    if (entry->ref == NULL)
+    {
+        bplib_tiered_offload_free_slot(state, slot);
+        return BP_ERROR;
+    }
+
+    /* the same size the cache counts, so the two budgets can be compared */
+    entry->size = sizeof(bplib_mpool_bblock_primary_t) + pri_block->bundle_encode_size_cache;
+    state->ram_bytes += entry->size;
+    bplib_tiered_offload_link_first(state, slot);
+
+    /*
+     * The new bundle is the last to be moved out.  If it is still only in memory when the budget
+     * could not be met, the bundle is not taken at all, so that with no budget a bundle is only
+     * ever handed back to the cache as stored once the lower module has it.
+     */
+    if (bplib_tiered_offload_enforce_budget(state, 0) != BP_SUCCESS && entry->ref != NULL && entry->lower_sid == 0)
+    {
+        bplib_tiered_offload_drop_copy(state, slot);
+        bplib_tiered_offload_free_slot(state, slot);
+        return BP_ERROR;
+    }
+
+    *sid = slot;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_tiered_offload_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out)
+{
+    bplib_tiered_offload_state_t *state;
+    bplib_tiered_offload_slot_t  *entry;
+    bplib_mpool_block_t          *pblk;
+    int                           result;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    *pblk_out = NULL;
+
+    entry = bplib_tiered_offload_lookup(state, sid);
+    if (entry == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if (entry->ref != NULL)
+    {
+        /* the cache takes its own ref to the same bundle */
+        bplib_tiered_offload_unlink(state, sid);
+        bplib_tiered_offload_link_first(state, sid);
+        *pblk_out = bplib_mpool_dereference(entry->ref);
+        return BP_SUCCESS;
+    }
+
+    result = state->lower_api->restore(state->lower_blk, entry->lower_sid, &pblk);
+    if (result != BP_SUCCESS)
+    {
+        return result;
+    }
+
+    /* brought back into memory, where it stays while it is being used, the lower copy stays as well */
+    if (entry->size <= (size_t)state->ram_budget)
+    {
+        entry->ref = bplib_mpool_ref_create(pblk);
+        if (entry->ref != NULL)
+        {
+            state->ram_bytes += entry->size;
+            bplib_tiered_offload_link_first(state, sid);
+
+            /* not an error for the restore, the others just stay in memory until there is room */
+            bplib_tiered_offload_enforce_budget(state, sid);
+        }
+    }
+
+    *pblk_out = pblk;
+
+    return BP_SUCCESS;
+}
+
+static int bplib_tiered_offload_release(bplib_mpool_block_t *svc, bp_sid_t sid)
+{
+    bplib_tiered_offload_state_t *state;
+    bplib_tiered_offload_slot_t  *entry;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    entry = bplib_tiered_offload_lookup(state, sid);
+    if (entry != NULL)
+    {
+        if (entry->ref != NULL)
+        {
+            bplib_tiered_offload_drop_copy(state, sid);
+        }
+        if (entry->lower_sid != 0)
+        {
+            state->lower_api->release(state->lower_blk, entry->lower_sid);
+        }
+
+        bplib_tiered_offload_free_slot(state, sid);
+    }
+
+    return 0;
+}
+
+static int bplib_tiered_offload_flush(bplib_mpool_block_t *svc)
+{
+    bplib_tiered_offload_state_t *state;
+    uint32_t                      slot;
+    int                           result;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    /* everything must be durable, so anything only in memory is written down, and stays in memory */
+    result = BP_SUCCESS;
+    for (slot = state->slots ? state->slots[0].next : 0; slot != 0; slot = state->slots[slot].next)
+    {
+        if (bplib_tiered_offload_write_lower(state, &state->slots[slot]) != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unable to write bundle out of memory\n");
+            result = BP_ERROR;
+        }
+    }
+
+    if (result == BP_SUCCESS && state->lower_api->flush != NULL)
+    {
+        result = state->lower_api->flush(state->lower_blk);
+    }
+
+    return result;
+}
+
+static void bplib_tiered_offload_recover_lower(void *arg, const bplib_cache_offload_index_t *index)
+{
+    bplib_tiered_offload_recover_arg_t *recover_arg;
+    bplib_cache_offload_index_t         tier_index;
+    uint32_t                            slot;
+
+    recover_arg = arg;
+
+    /* it gets a slot here like any other, only not in memory */
+    slot = bplib_tiered_offload_alloc_slot(recover_arg->state);
+    if (slot != 0)
+    {
+        recover_arg->state->slots[slot].lower_sid = index->sid;
+        recover_arg->state->slots[slot].size      = sizeof(bplib_mpool_bblock_primary_t) + index->bundle_encode_size;
+
+        tier_index     = *index;
+        tier_index.sid = slot;
+        recover_arg->func(recover_arg->arg, &tier_index);
+    }
+}
+
+static int bplib_tiered_offload_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg)
+{
+    bplib_tiered_offload_state_t      *state;
+    bplib_tiered_offload_recover_arg_t recover_arg;
+
+    state = bplib_mpool_generic_data_cast(svc, BPLIB_TIERED_OFFLOAD_MAGIC);
+    if (state == NULL)
+    {
+        return bplog(NULL, BP_FLAG_DIAGNOSTIC, "Not a valid offload state object\n");
+    }
+
+    if (state->lower_api->recover == NULL)
+    {
+        return BP_SUCCESS;
+    }
+
+    recover_arg.state = state;
+    recover_arg.func  = func;
+    recover_arg.arg   = arg;
+
+    return state->lower_api->recover(state->lower_blk, bplib_tiered_offload_recover_lower, &recover_arg);
+}
@@ -0,0 +1,259 @@
+/************************************************************************
+ *
+ *  Behavior test of the deletion of released records by the file offload module
+ *
+ *  The module is run on a directory of its own, which is removed at the
+ *  start and the end.  It is kept in between, as the module remembers the
+ *  directories it has made, and the sids it hands out never repeat, so each
+ *  test still has records of its own.  A record is on disk for as long as
+ *  it still restores.
+ *
+ *  Records released fewer than a batch at a time must stay on disk until
+ *  the batch fills, when they are deleted together, or until the wait is
+ *  up.  Those still queued when the module stops are deleted by the stop.
+ *  With a batch of 0, or once the queue is full, a release deletes its own
+ *  record before it returns.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "bplib_file_offload.h"
+#include "benchutil.h"
+#include "offloadtest.h"
+
+#define FILE_TEST_PAYLOAD_SIZE 200
+#define FILE_TEST_PATH_SIZE    256
+
+/* the batch of most of the tests, and a wait that none of them get to the end of */
+#define FILE_TEST_BATCH     4
+#define FILE_TEST_LONG_WAIT 3600000
+
+/* the wait of the timeout test, and how long any of the tests waits for the thread to delete something */
+#define FILE_TEST_SHORT_WAIT 50
+#define FILE_TEST_LIMIT_MSEC 5000
+
+/* the releases the module can queue, as BPLIB_FILE_OFFLOAD_RELEASE_QUEUE */
+#define FILE_TEST_QUEUE_SIZE 4096
+
+/* sids well past any of the ones offloaded in a test, with no record of their own */
+#define FILE_TEST_UNUSED_SID 0x100000
+
+static char file_test_dir[FILE_TEST_PATH_SIZE];
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static int file_test_remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftwbuf)
+{
+    return remove(path);
+}
+
+/* Stops the module if it is running, and starts it again with the given batch and wait */
+static void file_test_restart(int batch, int wait)
+{
+    offload_test.api->std.stop(offload_test.svc);
+    bplib_mpool_collect_blocks(offload_test.pool, UINT32_MAX);
+
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_delete_batch,
+                                                      bplib_cache_module_valtype_integer, &batch),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_delete_wait,
+                                                      bplib_cache_module_valtype_integer, &wait),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+}
+
+static void file_test_offload(bp_sid_t *sid, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; ++i)
+    {
+        sid[i] = offload_test_offload(100 + i);
+        UtAssert_NONZERO(sid[i]);
+    }
+}
+
+/*
+ * How many of the records, offloaded with sequence numbers from 100, are still on disk.  What the
+ * restores let go of is collected first, so that a restore only fails for want of its record.
+ */
+static uint32_t file_test_count_stored(const bp_sid_t *sid, uint32_t count)
+{
+    uint32_t i;
+    uint32_t stored;
+
+    bplib_mpool_collect_blocks(offload_test.pool, UINT32_MAX);
+
+    stored = 0;
+    for (i = 0; i < count; ++i)
+    {
+        if (offload_test_check(sid[i], 100 + i))
+        {
+            ++stored;
+        }
+    }
+
+    return stored;
+}
+
+/* Waits for the thread to delete the records, returning false if they are not all gone in time */
+static bool file_test_wait_deleted(const bp_sid_t *sid, uint32_t count)
+{
+    uint64_t limit;
+
+    limit = bplib_os_get_dtntime_ms() + FILE_TEST_LIMIT_MSEC;
+    while (file_test_count_stored(sid, count) != 0)
+    {
+        if (bplib_os_get_dtntime_ms() >= limit)
+        {
+            return false;
+        }
+
+        OS_TaskDelay(10);
+    }
+
+    return true;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void file_test_setup(void)
+{
+    if (offload_test.svc != NULL)
+    {
+        return;
+    }
+
+    strncpy(file_test_dir, bench_getenv("FILE_TEST_DIR", "file_test"), sizeof(file_test_dir) - 1);
+
+    nftw(file_test_dir, file_test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+    offload_test_setup(BPLIB_FILE_OFFLOAD_API, NULL, FILE_TEST_PAYLOAD_SIZE);
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_base_dir,
+                                                      bplib_cache_module_valtype_string, file_test_dir),
+                      BP_SUCCESS);
+}
+
+void file_test_full_batch(void)
+{
+    bp_sid_t sid[FILE_TEST_BATCH];
+    uint32_t i;
+
+    file_test_restart(FILE_TEST_BATCH, FILE_TEST_LONG_WAIT);
+    file_test_offload(sid, FILE_TEST_BATCH);
+
+    /* short of a batch, the released records are all still there */
+    for (i = 0; i < FILE_TEST_BATCH - 1; ++i)
+    {
+        UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[i]), BP_SUCCESS);
+    }
+    UtAssert_UINT32_EQ(file_test_count_stored(sid, FILE_TEST_BATCH), FILE_TEST_BATCH);
+
+    /* and the one that makes the batch has them deleted together, long before the wait is up */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[FILE_TEST_BATCH - 1]), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(file_test_wait_deleted(sid, FILE_TEST_BATCH));
+}
+
+void file_test_timeout(void)
+{
+    bp_sid_t sid[2];
+
+    /* a partial batch is deleted once the wait is up, as nothing else wakes the thread */
+    file_test_restart(FILE_TEST_BATCH, FILE_TEST_SHORT_WAIT);
+    file_test_offload(sid, 2);
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[0]), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(file_test_wait_deleted(sid, 1));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[1], 101));
+
+    /* and so is the next one, so the thread goes on waiting after the first */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[1]), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(file_test_wait_deleted(sid, 2));
+}
+
+void file_test_stop(void)
+{
+    bp_sid_t sid[FILE_TEST_BATCH];
+
+    file_test_restart(FILE_TEST_BATCH, FILE_TEST_LONG_WAIT);
+    file_test_offload(sid, FILE_TEST_BATCH);
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[0]), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[1]), BP_SUCCESS);
+    UtAssert_UINT32_EQ(file_test_count_stored(sid, FILE_TEST_BATCH), FILE_TEST_BATCH);
+
+    /* what is still queued is gone once the stop returns, and what was not released is left */
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_UINT32_EQ(file_test_count_stored(sid, 2), 0);
+    UtAssert_BOOL_TRUE(offload_test_check(sid[2], 102));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[3], 103));
+}
+
+void file_test_inline(void)
+{
+    bp_sid_t sid[2];
+    uint32_t i;
+
+    /* with a batch of 0 there is no thread, and a release deletes its record itself */
+    file_test_restart(0, FILE_TEST_LONG_WAIT);
+    file_test_offload(sid, 2);
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[0]), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(offload_test_check(sid[0], 100));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[1], 101));
+
+    /*
+     * So does one that finds the queue full.  The batch is larger than the queue, so nothing wakes the
+     * thread to empty it, and the queue is filled with sids that have no record so this is quick.
+     */
+    file_test_restart(FILE_TEST_QUEUE_SIZE + 1, FILE_TEST_LONG_WAIT);
+    file_test_offload(sid, 2);
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[0]), BP_SUCCESS);
+    for (i = 1; i < FILE_TEST_QUEUE_SIZE; ++i)
+    {
+        UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, FILE_TEST_UNUSED_SID + i), BP_SUCCESS);
+    }
+    UtAssert_UINT32_EQ(file_test_count_stored(sid, 2), 2);
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[1]), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(offload_test_check(sid[1], 101));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[0], 100));
+
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(offload_test_check(sid[0], 100));
+    nftw(file_test_dir, file_test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(file_test_full_batch, file_test_setup, NULL, "full batch");
+    UtTest_Add(file_test_timeout, file_test_setup, NULL, "timeout");
+    UtTest_Add(file_test_stop, file_test_setup, NULL, "stop");
+    UtTest_Add(file_test_inline, file_test_setup, NULL, "inline");
+}
@@ -0,0 +1,380 @@
+/************************************************************************
+ *
+ *  Behavior test of the flash offload module
+ *
+ *  The module is run on a small flash device in RAM, which refuses to
+ *  program a page that is not erased, as the real thing would, and keeps
+ *  count of what is done to each of its blocks.
+ *
+ *  Bundles are offloaded, restored and released, and then the module is
+ *  stopped and started again on the same device to check that the index
+ *  it builds by reading the device holds what was held and nothing that
+ *  was released.  Many more bundles are then put through the device than
+ *  it can hold at once, which only works if collection takes blocks back,
+ *  and the bundles held all along must still come back as they were.
+ *  Finally a block marked bad at the factory and one that fails to
+ *  program must not be used again.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "bplib_flash_offload.h"
+#include "offloadtest.h"
+
+#define FLASH_TEST_PAYLOAD_SIZE 1000
+
+/* the geometry of the RAM flash device, which holds a few bundles in each block */
+#define FLASH_TEST_BLOCKS     8
+#define FLASH_TEST_PAGES      16
+#define FLASH_TEST_PAGE_SIZE  512
+#define FLASH_TEST_BLOCK_SIZE (FLASH_TEST_PAGES * FLASH_TEST_PAGE_SIZE)
+
+/* bundles put through the device in the collection tests, several times what it holds */
+#define FLASH_TEST_CYCLES 200
+
+/* bundles held while the others go through */
+#define FLASH_TEST_HELD 6
+
+#define FLASH_TEST_NO_BLOCK UINT32_MAX
+
+typedef struct flash_test_device
+{
+    uint8_t  mem[FLASH_TEST_BLOCKS * FLASH_TEST_BLOCK_SIZE];
+    uint32_t programs[FLASH_TEST_BLOCKS];
+    uint32_t erases[FLASH_TEST_BLOCKS];
+    uint32_t reads[FLASH_TEST_BLOCKS];
+    uint32_t overwrites; /* programs of a page that was not erased, which are refused */
+    uint32_t bad_block;  /* reported bad by isbad */
+    uint32_t fail_block; /* every program of it fails */
+
+} flash_test_device_t;
+
+static flash_test_device_t  flash_test_device;
+static bplib_flash_driver_t flash_test_driver;
+
+/*************************************************************************
+ * RAM flash device
+ *************************************************************************/
+
+static uint8_t *flash_test_page(flash_test_device_t *dev, uint32_t block, uint32_t page)
+{
+    return &dev->mem[((size_t)block * FLASH_TEST_BLOCK_SIZE) + ((size_t)page * FLASH_TEST_PAGE_SIZE)];
+}
+
+static int flash_test_read(void *arg, uint32_t block, uint32_t page, void *buf)
+{
+    flash_test_device_t *dev = arg;
+
+    ++dev->reads[block];
+    memcpy(buf, flash_test_page(dev, block, page), FLASH_TEST_PAGE_SIZE);
+    return BP_SUCCESS;
+}
+
+static int flash_test_program(void *arg, uint32_t block, uint32_t page, const void *buf)
+{
+    flash_test_device_t *dev = arg;
+    uint8_t             *dest;
+    uint32_t             i;
+
+    ++dev->programs[block];
+    if (block == dev->fail_block)
+    {
+        return BP_ERROR;
+    }
+
+    dest = flash_test_page(dev, block, page);
+    for (i = 0; i < FLASH_TEST_PAGE_SIZE; ++i)
+    {
+        if (dest[i] != 0xFF)
+        {
+            ++dev->overwrites;
+            return BP_ERROR;
+        }
+    }
+
+    memcpy(dest, buf, FLASH_TEST_PAGE_SIZE);
+    return BP_SUCCESS;
+}
+
+static int flash_test_erase(void *arg, uint32_t block)
+{
+    flash_test_device_t *dev = arg;
+
+    ++dev->erases[block];
+    memset(flash_test_page(dev, block, 0), 0xFF, FLASH_TEST_BLOCK_SIZE);
+    return BP_SUCCESS;
+}
+
+static bool flash_test_isbad(void *arg, uint32_t block)
+{
+    flash_test_device_t *dev = arg;
+
+    return block == dev->bad_block;
+}
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* Stops the module if it is running and starts it on a device that is all erased */
+static void flash_test_start_blank(uint32_t bad_block, uint32_t fail_block)
+{
+    offload_test.api->std.stop(offload_test.svc);
+
+    memset(&flash_test_device, 0, sizeof(flash_test_device));
+    memset(flash_test_device.mem, 0xFF, sizeof(flash_test_device.mem));
+    flash_test_device.bad_block  = bad_block;
+    flash_test_device.fail_block = fail_block;
+
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+}
+
+/* Puts bundles through one at a time, each offloaded, restored and released */
+static void flash_test_cycle(uint32_t first_seq)
+{
+    bp_sid_t sid;
+    uint32_t i;
+    uint32_t failed;
+
+    failed = 0;
+    for (i = 0; i < FLASH_TEST_CYCLES; ++i)
+    {
+        sid = offload_test_offload(first_seq + i);
+        if (sid == 0 || !offload_test_check(sid, first_seq + i) ||
+            offload_test.api->release(offload_test.svc, sid) != BP_SUCCESS)
+        {
+            ++failed;
+        }
+    }
+
+    UtAssert_ZERO(failed);
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void flash_test_setup(void)
+{
+    if (offload_test.svc != NULL)
+    {
+        return;
+    }
+
+    flash_test_driver.num_blocks      = FLASH_TEST_BLOCKS;
+    flash_test_driver.pages_per_block = FLASH_TEST_PAGES;
+    flash_test_driver.page_size       = FLASH_TEST_PAGE_SIZE;
+    flash_test_driver.arg             = &flash_test_device;
+    flash_test_driver.read            = flash_test_read;
+    flash_test_driver.program         = flash_test_program;
+    flash_test_driver.erase           = flash_test_erase;
+    flash_test_driver.isbad           = flash_test_isbad;
+
+    /* the driver is copied, so it is fine that this one is changed later */
+    offload_test_setup(BPLIB_FLASH_OFFLOAD_API, &flash_test_driver, FLASH_TEST_PAYLOAD_SIZE);
+    UtAssert_BOOL_FALSE(offload_test.api->in_memory);
+}
+
+void flash_test_round_trip(void)
+{
+    bplib_mpool_block_t *rblk;
+    bp_sid_t             sid;
+
+    flash_test_start_blank(FLASH_TEST_NO_BLOCK, FLASH_TEST_NO_BLOCK);
+
+    sid = offload_test_offload(1);
+    UtAssert_NONZERO(sid);
+
+    /* the record stays until it is released, so it can be restored again the next time it is needed */
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 1));
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 1));
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid), BP_SUCCESS);
+    rblk = NULL;
+    UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid, &rblk), BP_ERROR);
+    UtAssert_NULL(rblk);
+
+    /* sids are not reused */
+    UtAssert_True(offload_test_offload(2) > sid, "sid after a release is new");
+    UtAssert_ZERO(flash_test_device.overwrites);
+}
+
+void flash_test_restart(void)
+{
+    bplib_mpool_block_t *rblk;
+    bp_sid_t             sid[FLASH_TEST_HELD];
+    bp_sid_t             held_sid[FLASH_TEST_HELD];
+    uint32_t             held_seq[FLASH_TEST_HELD];
+    uint32_t             num_held;
+    bp_sid_t             last_sid;
+    uint32_t             i;
+
+    flash_test_start_blank(FLASH_TEST_NO_BLOCK, FLASH_TEST_NO_BLOCK);
+
+    for (i = 0; i < FLASH_TEST_HELD; ++i)
+    {
+        sid[i] = offload_test_offload(10 + i);
+        UtAssert_NONZERO(sid[i]);
+    }
+
+    /* every other one is released, and the release is made durable with the next flush */
+    num_held = 0;
+    for (i = 0; i < FLASH_TEST_HELD; ++i)
+    {
+        if ((i & 1) == 0)
+        {
+            UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[i]), BP_SUCCESS);
+        }
+        else
+        {
+            held_sid[num_held] = sid[i];
+            held_seq[num_held] = 10 + i;
+            ++num_held;
+        }
+    }
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+
+    /* a new start has only what is on the device to go on */
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+
+    offload_test_check_recovered(held_sid, held_seq, num_held);
+    for (i = 0; i < num_held; ++i)
+    {
+        UtAssert_True(offload_test_check(held_sid[i], held_seq[i]), "sid %lu restored after restart",
+                      (unsigned long)held_sid[i]);
+    }
+
+    last_sid = 0;
+    for (i = 0; i < FLASH_TEST_HELD; ++i)
+    {
+        if ((i & 1) == 0)
+        {
+            rblk = NULL;
+            UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid[i], &rblk), BP_ERROR);
+        }
+        if (sid[i] > last_sid)
+        {
+            last_sid = sid[i];
+        }
+    }
+
+    /* and a sid from before the restart is not handed out again */
+    UtAssert_True(offload_test_offload(20) > last_sid, "sid after a restart is new");
+    UtAssert_ZERO(flash_test_device.overwrites);
+}
+
+void flash_test_collect(void)
+{
+    bp_sid_t held_sid[FLASH_TEST_HELD];
+    uint32_t held_seq[FLASH_TEST_HELD];
+    uint32_t erases;
+    uint32_t i;
+
+    flash_test_start_blank(FLASH_TEST_NO_BLOCK, FLASH_TEST_NO_BLOCK);
+
+    for (i = 0; i < FLASH_TEST_HELD; ++i)
+    {
+        held_seq[i] = 100 + i;
+        held_sid[i] = offload_test_offload(held_seq[i]);
+        UtAssert_NONZERO(held_sid[i]);
+    }
+
+    flash_test_cycle(1000);
+
+    /* that much only fits if the blocks of what was released were erased and used again */
+    erases = 0;
+    for (i = 0; i < FLASH_TEST_BLOCKS; ++i)
+    {
+        erases += flash_test_device.erases[i];
+    }
+    UtAssert_True(erases > FLASH_TEST_BLOCKS, "blocks erased %lu times in all", (unsigned long)erases);
+    UtAssert_ZERO(flash_test_device.overwrites);
+
+    /* the held bundles were copied along the way, and are still there after a restart */
+    for (i = 0; i < FLASH_TEST_HELD; ++i)
+    {
+        UtAssert_True(offload_test_check(held_sid[i], held_seq[i]), "held sid %lu restored",
+                      (unsigned long)held_sid[i]);
+    }
+
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+
+    offload_test_check_recovered(held_sid, held_seq, FLASH_TEST_HELD);
+    for (i = 0; i < FLASH_TEST_HELD; ++i)
+    {
+        UtAssert_True(offload_test_check(held_sid[i], held_seq[i]), "held sid %lu restored after restart",
+                      (unsigned long)held_sid[i]);
+    }
+}
+
+void flash_test_bad_blocks(void)
+{
+    bp_sid_t held_sid;
+    uint32_t held_seq;
+    uint32_t fail_programs;
+
+    /* the search for an erased block starts at block 0, so block 1 is the first one opened */
+    flash_test_start_blank(0, 1);
+
+    /* the first bundle goes to the block that fails, and is lost */
+    UtAssert_ZERO(offload_test_offload(1));
+    UtAssert_UINT32_EQ(flash_test_device.erases[1], 1);
+    UtAssert_NONZERO(flash_test_device.programs[1]);
+    fail_programs = flash_test_device.programs[1];
+
+    held_seq = 2;
+    held_sid = offload_test_offload(held_seq);
+    UtAssert_NONZERO(held_sid);
+
+    flash_test_cycle(1000);
+
+    /* neither block was touched after that, even with collection looking for space */
+    UtAssert_ZERO(flash_test_device.reads[0]);
+    UtAssert_ZERO(flash_test_device.programs[0]);
+    UtAssert_ZERO(flash_test_device.erases[0]);
+    UtAssert_UINT32_EQ(flash_test_device.programs[1], fail_programs);
+    UtAssert_UINT32_EQ(flash_test_device.erases[1], 1);
+    UtAssert_ZERO(flash_test_device.overwrites);
+
+    UtAssert_BOOL_TRUE(offload_test_check(held_sid, held_seq));
+
+    /* a factory bad block is still skipped at the next start */
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+    offload_test_check_recovered(&held_sid, &held_seq, 1);
+    UtAssert_ZERO(flash_test_device.reads[0]);
+    UtAssert_BOOL_TRUE(offload_test_check(held_sid, held_seq));
+
+    offload_test.api->std.stop(offload_test.svc);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(flash_test_round_trip, flash_test_setup, NULL, "round trip");
+    UtTest_Add(flash_test_restart, flash_test_setup, NULL, "restart");
+    UtTest_Add(flash_test_collect, flash_test_setup, NULL, "collection");
+    UtTest_Add(flash_test_bad_blocks, flash_test_setup, NULL, "bad blocks");
+}
@@ -0,0 +1,828 @@
+/************************************************************************
+ *
+ *  Benchmark of the offload (storage) modules
+ *
+ *  Each module is driven directly through its offload API with synthetic
+ *  bundles, the way the cache would drive it: a random mix of offloads,
+ *  restores and releases, with bundle sizes picked from a list.  Every
+ *  restored bundle is checked against the one that was offloaded.  The
+ *  operations per second, MB/s and p50/p99 latency of each operation are
+ *  printed per module, so that storage changes can be evaluated on the
+ *  hardware they will run on.
+ *
+ *  The modules are not made to be called from more than one thread at a
+ *  time, so for concurrency each thread drives its own instance of the
+ *  module, in its own directory, all sharing one memory pool.
+ *
+ *  It is set up from the environment, which the defaults are shown for:
+ *
+ *    OFFLOAD_BENCH_BACKENDS  file,segment,tiered  modules to run, or flash
+ *    OFFLOAD_BENCH_SIZES     256,4096,65536       payload sizes, picked at random
+ *    OFFLOAD_BENCH_MIX       1:2:1                weights of offload:restore:release
+ *    OFFLOAD_BENCH_THREADS   1                    instances run at once
+ *    OFFLOAD_BENCH_OPS       2000                 operations per thread
+ *    OFFLOAD_BENCH_LIVE      256                  bundles held at once per thread
+ *    OFFLOAD_BENCH_DIR       offload_bench        removed again after the run
+ *    OFFLOAD_BENCH_COMPRESS  0                    bplib_cache_confkey_offload_compress
+ *    OFFLOAD_BENCH_RAM       1048576              RAM budget of the tiered module
+ *    OFFLOAD_BENCH_FLASH     64                   erase blocks of 512 KiB for the flash module
+ *
+ *  The tiered module is run in front of the segment module.  The flash
+ *  module is run on a device in RAM for each thread, which only lets a page
+ *  be programmed once between erases, as NAND would.  Half of each
+ *  payload is repeated text and half is random, so compression has
+ *  something to do without everything being compressible.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7.h"
+#include "v7_codec.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "bplib_file_offload.h"
+#include "bplib_segment_offload.h"
+#include "bplib_tiered_offload.h"
+#include "bplib_flash_offload.h"
+#include "benchutil.h"
+
+/* the memory pool, shared by every thread */
+#define OFFLOAD_BENCH_POOL_SIZE (32 * 1024 * 1024)
+
+/* limits of what can be asked for */
+#define OFFLOAD_BENCH_MAX_PAYLOAD 262144
+#define OFFLOAD_BENCH_WIRE_SIZE   (OFFLOAD_BENCH_MAX_PAYLOAD + 1024)
+#define OFFLOAD_BENCH_MAX_SIZES   8
+#define OFFLOAD_BENCH_MAX_THREADS 16
+#define OFFLOAD_BENCH_PATH_SIZE   128
+
+/* the geometry of the RAM flash device, other than the number of blocks */
+#define OFFLOAD_BENCH_FLASH_PAGE_SIZE  2048
+#define OFFLOAD_BENCH_FLASH_PAGES      256
+#define OFFLOAD_BENCH_FLASH_BLOCK_SIZE (OFFLOAD_BENCH_FLASH_PAGE_SIZE * OFFLOAD_BENCH_FLASH_PAGES)
+
+/* the magic number of the block each instance is made under, as the cache would be */
+#define OFFLOAD_BENCH_PARENT_MAGIC 0x0ffbe7c4
+
+typedef enum offload_bench_op
+{
+    offload_bench_op_offload,
+    offload_bench_op_restore,
+    offload_bench_op_release,
+    offload_bench_op_max
+} offload_bench_op_t;
+
+typedef struct offload_bench_backend
+{
+    const char                            *name;
+    const bplib_cache_module_api_t *const *api;
+    const bplib_cache_module_api_t *const *lower_api; /* the init_arg, for a module in front of another */
+    bool                                   on_flash;  /* on a RAM flash device rather than in a directory */
+} offload_bench_backend_t;
+
+typedef struct offload_bench_config
+{
+    char     backends[OFFLOAD_BENCH_PATH_SIZE];
+    char     dir[OFFLOAD_BENCH_PATH_SIZE];
+    size_t   sizes[OFFLOAD_BENCH_MAX_SIZES];
+    uint32_t num_sizes;
+    uint32_t weights[offload_bench_op_max];
+    uint32_t threads;
+    uint32_t ops;
+    uint32_t live;
+    int      compress;
+    int      ram_budget;
+    uint32_t flash_blocks;
+} offload_bench_config_t;
+
+typedef struct offload_bench_held
+{
+    bp_sid_t sid;
+    uint32_t size_index;
+} offload_bench_held_t;
+
+typedef struct offload_bench_thread
+{
+    const offload_bench_backend_t *backend;
+    uint32_t                       index;
+    pthread_t                      thread;
+
+    const bplib_cache_offload_api_t *api;
+    bplib_mpool_block_t             *svc;
+    bplib_mpool_block_t             *parent;
+    bplib_mpool_ref_t                bundles[OFFLOAD_BENCH_MAX_SIZES];
+    size_t                           wire_sizes[OFFLOAD_BENCH_MAX_SIZES];
+
+    offload_bench_held_t *held;
+    uint32_t              num_held;
+    uint32_t              rng;
+    uint8_t              *expect; /* what a restored bundle is encoded into to be compared */
+    uint8_t              *actual;
+    uint8_t              *flash; /* the device for the flash module, erased to 0xFF */
+    bplib_flash_driver_t  flash_driver;
+
+    uint64_t *latency_ns[offload_bench_op_max];
+    uint32_t  count[offload_bench_op_max];
+    uint64_t  bytes[offload_bench_op_max];
+    uint64_t  elapsed_ns;
+    uint32_t  errors;
+    uint32_t  mismatches;
+} offload_bench_thread_t;
+
+static const offload_bench_backend_t OFFLOAD_BENCH_BACKENDS[] = {
+    {"file", &BPLIB_FILE_OFFLOAD_API, NULL, false},
+    {"segment", &BPLIB_SEGMENT_OFFLOAD_API, NULL, false},
+    {"tiered", &BPLIB_TIERED_OFFLOAD_API, &BPLIB_SEGMENT_OFFLOAD_API, false},
+    {"flash", &BPLIB_FLASH_OFFLOAD_API, NULL, true}};
+
+static const char *const OFFLOAD_BENCH_OP_NAMES[offload_bench_op_max] = {"offload", "restore", "release"};
+
+static const bp_ipn_addr_t OFFLOAD_BENCH_SRC_ADDR = {100, 1};
+static const bp_ipn_addr_t OFFLOAD_BENCH_DST_ADDR = {200, 1};
+
+static uint8_t                offload_bench_pool_mem[OFFLOAD_BENCH_POOL_SIZE];
+static uint8_t                offload_bench_payload[OFFLOAD_BENCH_MAX_PAYLOAD];
+static bplib_mpool_t         *offload_bench_pool;
+static offload_bench_config_t offload_bench_config;
+
+static offload_bench_thread_t offload_bench_threads[OFFLOAD_BENCH_MAX_THREADS];
+
+#define OFFLOAD_BENCH_NUM_BACKENDS (sizeof(OFFLOAD_BENCH_BACKENDS) / sizeof(OFFLOAD_BENCH_BACKENDS[0]))
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static uint32_t offload_bench_random(offload_bench_thread_t *t)
+{
+    t->rng ^= t->rng << 13;
+    t->rng ^= t->rng >> 17;
+    t->rng ^= t->rng << 5;
+    return t->rng;
+}
+
+static int offload_bench_remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftwbuf)
+{
+    return remove(path);
+}
+
+static uint8_t *offload_bench_flash_page(offload_bench_thread_t *t, uint32_t block, uint32_t page)
+{
+    return &t->flash[((size_t)block * OFFLOAD_BENCH_FLASH_BLOCK_SIZE) + ((size_t)page * OFFLOAD_BENCH_FLASH_PAGE_SIZE)];
+}
+
+static int offload_bench_flash_read(void *arg, uint32_t block, uint32_t page, void *buf)
+{
+    memcpy(buf, offload_bench_flash_page(arg, block, page), OFFLOAD_BENCH_FLASH_PAGE_SIZE);
+    return BP_SUCCESS;
+}
+
+/* a page that is not erased cannot be programmed, as it could not be on the real thing */
+static int offload_bench_flash_program(void *arg, uint32_t block, uint32_t page, const void *buf)
+{
+    uint8_t *dest;
+    uint32_t i;
+
+    dest = offload_bench_flash_page(arg, block, page);
+    for (i = 0; i < OFFLOAD_BENCH_FLASH_PAGE_SIZE; ++i)
+    {
+        if (dest[i] != 0xFF)
+        {
+            return BP_ERROR;
+        }
+    }
+
+    memcpy(dest, buf, OFFLOAD_BENCH_FLASH_PAGE_SIZE);
+    return BP_SUCCESS;
+}
+
+static int offload_bench_flash_erase(void *arg, uint32_t block)
+{
+    memset(offload_bench_flash_page(arg, block, 0), 0xFF, OFFLOAD_BENCH_FLASH_BLOCK_SIZE);
+    return BP_SUCCESS;
+}
+
+/* Builds and encodes a bundle with a payload of the given size, as the library would store it */
+static bplib_mpool_block_t *offload_bench_build(size_t payload_size)
+{
+    bplib_mpool_block_t            *pblk;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bp_primary_block_t             *pri;
+    bp_canonical_block_buffer_t    *pay;
+
+    pblk = bplib_mpool_bblock_primary_alloc(offload_bench_pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    cblk = bplib_mpool_bblock_canonical_alloc(offload_bench_pool, 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (cpb == NULL || ccb == NULL)
+    {
+        if (pblk != NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+        if (cblk != NULL)
+        {
+            bplib_mpool_recycle_block(cblk);
+        }
+        return NULL;
+    }
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    pri->version = 7;
+
+    v7_set_eid(&pri->destinationEID, &OFFLOAD_BENCH_DST_ADDR);
+    v7_set_eid(&pri->sourceEID, &OFFLOAD_BENCH_SRC_ADDR);
+    v7_set_eid(&pri->reportEID, &OFFLOAD_BENCH_SRC_ADDR);
+
+    pri->creationTimeStamp.time         = v7_get_current_time();
+    pri->creationTimeStamp.sequence_num = 1;
+
+    pri->lifetime                     = 3600000;
+    pri->controlFlags.mustNotFragment = true;
+    pri->crctype                      = bp_crctype_CRC32C;
+
+    pay = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    pay->canonical_block.blockNum  = 1;
+    pay->canonical_block.crctype   = bp_crctype_CRC32C;
+    pay->canonical_block.blockType = bp_blocktype_payloadBlock;
+
+    if (v7_block_encode_pri(cpb) != 0 || v7_block_encode_pay(ccb, offload_bench_payload, payload_size) != 0)
+    {
+        bplib_mpool_recycle_block(pblk);
+        bplib_mpool_recycle_block(cblk);
+        return NULL;
+    }
+
+    bplib_mpool_bblock_primary_append(cpb, cblk);
+
+    /* this also sets the size the tiered module counts against its budget */
+    v7_compute_full_bundle_size(cpb);
+
+    return pblk;
+}
+
+/* Compares a restored bundle with the one that was offloaded, by how they are encoded */
+static bool offload_bench_check(offload_bench_thread_t *t, uint32_t size_index, bplib_mpool_block_t *rblk)
+{
+    bplib_mpool_bblock_primary_t *cpb;
+    size_t                        wire_size;
+
+    cpb = bplib_mpool_bblock_primary_cast(rblk);
+    if (cpb == NULL || v7_compute_full_bundle_size(cpb) != t->wire_sizes[size_index])
+    {
+        return false;
+    }
+
+    wire_size = t->wire_sizes[size_index];
+    return v7_copy_full_bundle_out(bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(t->bundles[size_index])),
+                                   t->expect, OFFLOAD_BENCH_WIRE_SIZE) == wire_size &&
+           v7_copy_full_bundle_out(cpb, t->actual, OFFLOAD_BENCH_WIRE_SIZE) == wire_size &&
+           memcmp(t->expect, t->actual, wire_size) == 0;
+}
+
+/* Picks the next operation, which has to be possible with what is held */
+static offload_bench_op_t offload_bench_pick_op(offload_bench_thread_t *t)
+{
+    uint32_t           total;
+    uint32_t           pick;
+    offload_bench_op_t op;
+
+    total = 0;
+    for (op = 0; op < offload_bench_op_max; ++op)
+    {
+        total += offload_bench_config.weights[op];
+    }
+
+    pick = offload_bench_random(t) % total;
+    for (op = 0; op < (offload_bench_op_max - 1); ++op)
+    {
+        if (pick < offload_bench_config.weights[op])
+        {
+            break;
+        }
+        pick -= offload_bench_config.weights[op];
+    }
+
+    if (t->num_held == 0)
+    {
+        op = offload_bench_op_offload;
+    }
+    else if (op == offload_bench_op_offload && t->num_held >= offload_bench_config.live)
+    {
+        op = offload_bench_op_release;
+    }
+
+    return op;
+}
+
+/* Runs one operation, and returns the bundle bytes it moved or 0 if it failed */
+static size_t offload_bench_run_op(offload_bench_thread_t *t, offload_bench_op_t op, uint32_t h)
+{
+    bplib_mpool_block_t *rblk;
+    bplib_mpool_ref_t    rref;
+    uint32_t             size_index;
+    size_t               result;
+
+    result = 0;
+    switch (op)
+    {
+        case offload_bench_op_offload:
+            size_index = offload_bench_random(t) % offload_bench_config.num_sizes;
+            if (t->api->offload(t->svc, &t->held[h].sid, bplib_mpool_dereference(t->bundles[size_index])) ==
+                BP_SUCCESS)
+            {
+                t->held[h].size_index = size_index;
+                result                = t->wire_sizes[size_index];
+            }
+            break;
+
+        case offload_bench_op_restore:
+            size_index = t->held[h].size_index;
+            if (t->api->restore(t->svc, t->held[h].sid, &rblk) == BP_SUCCESS)
+            {
+                result = t->wire_sizes[size_index];
+
+                /* the cache holds it by a ref, and once that goes it is recycled unless the module kept one too */
+                rref = bplib_mpool_ref_create(rblk);
+                if (!offload_bench_check(t, size_index, rblk))
+                {
+                    ++t->mismatches;
+                }
+                bplib_mpool_ref_release(rref);
+            }
+            break;
+
+        case offload_bench_op_release:
+            if (t->api->release(t->svc, t->held[h].sid) == BP_SUCCESS)
+            {
+                result = t->wire_sizes[t->held[h].size_index];
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/* Makes an instance of the module under its own parent block and directory, as the cache would */
+static bool offload_bench_start(offload_bench_thread_t *t)
+{
+    static const bplib_mpool_blocktype_api_t parent_api = {NULL, NULL};
+
+    char              base_dir[OFFLOAD_BENCH_PATH_SIZE + 32];
+    bplib_mpool_ref_t parent_ref;
+    void             *init_arg;
+
+    bplib_mpool_register_blocktype(offload_bench_pool, OFFLOAD_BENCH_PARENT_MAGIC, &parent_api, sizeof(uint32_t));
+    t->parent = bplib_mpool_generic_data_alloc(offload_bench_pool, OFFLOAD_BENCH_PARENT_MAGIC, NULL);
+    if (t->parent == NULL)
+    {
+        return false;
+    }
+
+    init_arg = NULL;
+    if (t->backend->lower_api != NULL)
+    {
+        init_arg = (void *)*t->backend->lower_api;
+    }
+
+    if (t->backend->on_flash)
+    {
+        t->flash = malloc((size_t)offload_bench_config.flash_blocks * OFFLOAD_BENCH_FLASH_BLOCK_SIZE);
+        if (t->flash == NULL)
+        {
+            return false;
+        }
+
+        memset(t->flash, 0xFF, (size_t)offload_bench_config.flash_blocks * OFFLOAD_BENCH_FLASH_BLOCK_SIZE);
+        t->flash_driver.num_blocks      = offload_bench_config.flash_blocks;
+        t->flash_driver.pages_per_block = OFFLOAD_BENCH_FLASH_PAGES;
+        t->flash_driver.page_size       = OFFLOAD_BENCH_FLASH_PAGE_SIZE;
+        t->flash_driver.arg             = t;
+        t->flash_driver.read            = offload_bench_flash_read;
+        t->flash_driver.program         = offload_bench_flash_program;
+        t->flash_driver.erase           = offload_bench_flash_erase;
+        init_arg                        = &t->flash_driver;
+    }
+
+    t->api     = (const bplib_cache_offload_api_t *)*t->backend->api;
+    parent_ref = bplib_mpool_ref_create(t->parent);
+    t->svc     = t->api->std.instantiate(parent_ref, init_arg);
+    bplib_mpool_ref_release(parent_ref);
+    if (t->svc == NULL)
+    {
+        return false;
+    }
+
+    snprintf(base_dir, sizeof(base_dir), "%s/%s.%lu", offload_bench_config.dir, t->backend->name,
+             (unsigned long)t->index);
+
+    /* only the base directory is needed, the others are for the modules that have them */
+    if (!t->backend->on_flash && t->api->std.configure(t->svc, bplib_cache_confkey_offload_base_dir,
+                                                       bplib_cache_module_valtype_string, base_dir) != BP_SUCCESS)
+    {
+        return false;
+    }
+    t->api->std.configure(t->svc, bplib_cache_confkey_offload_compress, bplib_cache_module_valtype_integer,
+                          &offload_bench_config.compress);
+    t->api->std.configure(t->svc, bplib_cache_confkey_offload_ram_budget, bplib_cache_module_valtype_integer,
+                          &offload_bench_config.ram_budget);
+
+    return t->api->std.start(t->svc) == BP_SUCCESS;
+}
+
+static void *offload_bench_thread_entry(void *arg)
+{
+    offload_bench_thread_t *t;
+    offload_bench_op_t      op;
+    uint64_t                start_time;
+    uint64_t                op_time;
+    uint64_t                run_time;
+    size_t                  result;
+    uint32_t                h;
+    uint32_t                i;
+
+    t = arg;
+
+    if (!offload_bench_start(t))
+    {
+        ++t->errors;
+        return NULL;
+    }
+
+    run_time = bench_get_time_ns();
+    for (i = 0; i < offload_bench_config.ops; ++i)
+    {
+        op = offload_bench_pick_op(t);
+
+        /* a new bundle goes at the end of the held list, an old one is picked at random */
+        if (op == offload_bench_op_offload)
+        {
+            h = t->num_held;
+        }
+        else
+        {
+            h = offload_bench_random(t) % t->num_held;
+        }
+
+        start_time = bench_get_time_ns();
+        result     = offload_bench_run_op(t, op, h);
+        op_time    = bench_get_time_ns();
+
+        if (result == 0)
+        {
+            ++t->errors;
+            continue;
+        }
+
+        t->latency_ns[op][t->count[op]] = op_time - start_time;
+        ++t->count[op];
+        t->bytes[op] += result;
+
+        if (op == offload_bench_op_offload)
+        {
+            ++t->num_held;
+        }
+        else if (op == offload_bench_op_release)
+        {
+            --t->num_held;
+            t->held[h] = t->held[t->num_held];
+        }
+
+        /* anything let go of goes back to the pool now, so the pool never runs out */
+        bplib_mpool_collect_blocks(offload_bench_pool, UINT32_MAX);
+    }
+
+    /* when the module shares flushes, what is still pending is part of the time */
+    if (t->api->flush != NULL && t->api->flush(t->svc) != BP_SUCCESS)
+    {
+        ++t->errors;
+    }
+    t->elapsed_ns = bench_get_time_ns() - run_time;
+
+    /* the rest is not timed */
+    while (t->num_held > 0)
+    {
+        --t->num_held;
+        t->api->release(t->svc, t->held[t->num_held].sid);
+    }
+    t->api->std.stop(t->svc);
+
+    return NULL;
+}
+
+static int offload_bench_compare_u64(const void *a, const void *b)
+{
+    uint64_t va = *((const uint64_t *)a);
+    uint64_t vb = *((const uint64_t *)b);
+
+    return (va > vb) - (va < vb);
+}
+
+/* Puts the latencies of one operation from every thread together and sorts them */
+static uint64_t *offload_bench_gather(offload_bench_op_t op, uint32_t *count_out)
+{
+    uint64_t *all;
+    uint32_t  count;
+    uint32_t  i;
+
+    count = 0;
+    for (i = 0; i < offload_bench_config.threads; ++i)
+    {
+        count += offload_bench_threads[i].count[op];
+    }
+
+    *count_out = count;
+    all        = malloc(sizeof(*all) * (count + 1));
+    if (all == NULL)
+    {
+        return NULL;
+    }
+
+    count = 0;
+    for (i = 0; i < offload_bench_config.threads; ++i)
+    {
+        memcpy(&all[count], offload_bench_threads[i].latency_ns[op],
+               sizeof(*all) * offload_bench_threads[i].count[op]);
+        count += offload_bench_threads[i].count[op];
+    }
+
+    qsort(all, count, sizeof(*all), offload_bench_compare_u64);
+
+    return all;
+}
+
+static void offload_bench_report(const offload_bench_backend_t *backend)
+{
+    offload_bench_op_t op;
+    uint64_t          *all;
+    uint64_t           wall_ns;
+    uint64_t           bytes;
+    uint32_t           count;
+    uint32_t           i;
+
+    /* the threads run at the same time, so the rate is over the longest of them */
+    wall_ns = 1;
+    for (i = 0; i < offload_bench_config.threads; ++i)
+    {
+        if (offload_bench_threads[i].elapsed_ns > wall_ns)
+        {
+            wall_ns = offload_bench_threads[i].elapsed_ns;
+        }
+    }
+
+    for (op = 0; op < offload_bench_op_max; ++op)
+    {
+        all = offload_bench_gather(op, &count);
+        if (all == NULL || count == 0)
+        {
+            free(all);
+            continue;
+        }
+
+        bytes = 0;
+        for (i = 0; i < offload_bench_config.threads; ++i)
+        {
+            bytes += offload_bench_threads[i].bytes[op];
+        }
+
+        /* bytes per microsecond is MB/s */
+        UtPrintf("%-8s %-8s %7lu ops: %10.1f ops/s %9.1f MB/s  p50 %9.1f us  p99 %9.1f us", backend->name,
+                 OFFLOAD_BENCH_OP_NAMES[op], (unsigned long)count, ((double)count * 1e9) / (double)wall_ns,
+                 ((double)bytes * 1000.0) / (double)wall_ns, (double)all[count / 2] / 1000.0,
+                 (double)all[((uint64_t)count * 99) / 100] / 1000.0);
+
+        free(all);
+    }
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void offload_bench_setup(void)
+{
+    unsigned long list[OFFLOAD_BENCH_MAX_SIZES];
+    uint32_t      seed;
+    uint32_t      i;
+
+    if (offload_bench_pool == NULL)
+    {
+        UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+        UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+        offload_bench_pool = bplib_mpool_create(offload_bench_pool_mem, sizeof(offload_bench_pool_mem));
+        UtAssert_NOT_NULL(offload_bench_pool);
+    }
+
+    strncpy(offload_bench_config.backends, bench_getenv("OFFLOAD_BENCH_BACKENDS", "file,segment,tiered"),
+            sizeof(offload_bench_config.backends) - 1);
+    strncpy(offload_bench_config.dir, bench_getenv("OFFLOAD_BENCH_DIR", "offload_bench"),
+            sizeof(offload_bench_config.dir) - 1);
+
+    offload_bench_config.num_sizes =
+        bench_parse_list(bench_getenv("OFFLOAD_BENCH_SIZES", "256,4096,65536"), list, OFFLOAD_BENCH_MAX_SIZES, 0,
+                         ULONG_MAX);
+    for (i = 0; i < offload_bench_config.num_sizes; ++i)
+    {
+        offload_bench_config.sizes[i] = (list[i] < OFFLOAD_BENCH_MAX_PAYLOAD) ? list[i] : OFFLOAD_BENCH_MAX_PAYLOAD;
+    }
+    UtAssert_True(offload_bench_config.num_sizes > 0, "payload sizes given");
+
+    memset(list, 0, sizeof(list));
+    bench_parse_list(bench_getenv("OFFLOAD_BENCH_MIX", "1:2:1"), list, offload_bench_op_max, 0, ULONG_MAX);
+    for (i = 0; i < offload_bench_op_max; ++i)
+    {
+        offload_bench_config.weights[i] = list[i];
+    }
+
+    /* without an offload and a release the held bundles could not be kept in bounds */
+    if (offload_bench_config.weights[offload_bench_op_offload] == 0 ||
+        offload_bench_config.weights[offload_bench_op_release] == 0)
+    {
+        UtAssert_Message(UTASSERT_CASETYPE_WARN, __FILE__, __LINE__, "Mix needs offloads and releases, using 1:2:1");
+        offload_bench_config.weights[offload_bench_op_offload] = 1;
+        offload_bench_config.weights[offload_bench_op_restore] = 2;
+        offload_bench_config.weights[offload_bench_op_release] = 1;
+    }
+
+    offload_bench_config.threads = bench_getenv_num("OFFLOAD_BENCH_THREADS", 1);
+    if (offload_bench_config.threads < 1 || offload_bench_config.threads > OFFLOAD_BENCH_MAX_THREADS)
+    {
+        offload_bench_config.threads = 1;
+    }
+
+    offload_bench_config.ops          = bench_getenv_num("OFFLOAD_BENCH_OPS", 2000);
+    offload_bench_config.live         = bench_getenv_num("OFFLOAD_BENCH_LIVE", 256);
+    offload_bench_config.compress     = bench_getenv_num("OFFLOAD_BENCH_COMPRESS", 0);
+    offload_bench_config.ram_budget   = bench_getenv_num("OFFLOAD_BENCH_RAM", 1048576);
+    offload_bench_config.flash_blocks = bench_getenv_num("OFFLOAD_BENCH_FLASH", 64);
+    if (offload_bench_config.live < 1)
+    {
+        offload_bench_config.live = 1;
+    }
+
+    /* half repeated text and half random, see above */
+    seed = 0x2545F491;
+    for (i = 0; i < sizeof(offload_bench_payload); ++i)
+    {
+        seed = (seed * 1103515245) + 12345;
+        if ((i & 0x400) == 0)
+        {
+            offload_bench_payload[i] = (uint8_t)"instrument frame 0042 temperature nominal "[i % 42];
+        }
+        else
+        {
+            offload_bench_payload[i] = (uint8_t)(seed >> 16);
+        }
+    }
+}
+
+void offload_bench_run(void)
+{
+    const offload_bench_backend_t *backend;
+    offload_bench_thread_t        *t;
+    offload_bench_op_t             op;
+    uint32_t                       b;
+    uint32_t                       i;
+    uint32_t                       s;
+
+    if (mkdir(offload_bench_config.dir, 0700) != 0 && errno != EEXIST)
+    {
+        UtAssert_Failed("mkdir(%s): %s", offload_bench_config.dir, strerror(errno));
+        return;
+    }
+
+    for (b = 0; b < OFFLOAD_BENCH_NUM_BACKENDS; ++b)
+    {
+        backend = &OFFLOAD_BENCH_BACKENDS[b];
+        if (strstr(offload_bench_config.backends, backend->name) == NULL)
+        {
+            continue;
+        }
+
+        memset(offload_bench_threads, 0, sizeof(offload_bench_threads));
+        for (i = 0; i < offload_bench_config.threads; ++i)
+        {
+            t          = &offload_bench_threads[i];
+            t->backend = backend;
+            t->index   = i;
+            t->rng     = 0x9E3779B9 ^ (i * 0x85EBCA6B);
+            t->held    = calloc(offload_bench_config.live + 1, sizeof(*t->held));
+            t->expect  = malloc(OFFLOAD_BENCH_WIRE_SIZE);
+            t->actual  = malloc(OFFLOAD_BENCH_WIRE_SIZE);
+            for (op = 0; op < offload_bench_op_max; ++op)
+            {
+                t->latency_ns[op] = calloc(offload_bench_config.ops + 1, sizeof(uint64_t));
+                UtAssert_NOT_NULL(t->latency_ns[op]);
+            }
+            UtAssert_NOT_NULL(t->held);
+            UtAssert_NOT_NULL(t->expect);
+            UtAssert_NOT_NULL(t->actual);
+
+            /* each thread offloads its own copies, so there is nothing shared but the pool */
+            for (s = 0; s < offload_bench_config.num_sizes; ++s)
+            {
+                t->bundles[s]    = bplib_mpool_ref_create(offload_bench_build(offload_bench_config.sizes[s]));
+                t->wire_sizes[s] = 0;
+                if (t->bundles[s] != NULL)
+                {
+                    t->wire_sizes[s] = v7_compute_full_bundle_size(
+                        bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(t->bundles[s])));
+                }
+                UtAssert_True(t->bundles[s] != NULL, "%s: bundle with %lu byte payload", backend->name,
+                              (unsigned long)offload_bench_config.sizes[s]);
+            }
+        }
+
+        for (i = 0; i < offload_bench_config.threads; ++i)
+        {
+            t = &offload_bench_threads[i];
+            if (t->held == NULL || t->expect == NULL || t->actual == NULL)
+            {
+                t->held = NULL;
+            }
+            else if (pthread_create(&t->thread, NULL, offload_bench_thread_entry, t) != 0)
+            {
+                UtAssert_Failed("%s: could not start thread %lu", backend->name, (unsigned long)i);
+                t->held = NULL;
+            }
+        }
+
+        for (i = 0; i < offload_bench_config.threads; ++i)
+        {
+            t = &offload_bench_threads[i];
+            if (t->held != NULL)
+            {
+                pthread_join(t->thread, NULL);
+            }
+            UtAssert_True(t->errors == 0, "%s.%lu: %lu operations failed", backend->name, (unsigned long)i,
+                          (unsigned long)t->errors);
+            UtAssert_True(t->mismatches == 0, "%s.%lu: %lu restored bundles differ", backend->name,
+                          (unsigned long)i, (unsigned long)t->mismatches);
+        }
+
+        offload_bench_report(backend);
+
+        for (i = 0; i < offload_bench_config.threads; ++i)
+        {
+            t = &offload_bench_threads[i];
+            for (s = 0; s < offload_bench_config.num_sizes; ++s)
+            {
+                if (t->bundles[s] != NULL)
+                {
+                    bplib_mpool_ref_release(t->bundles[s]);
+                }
+            }
+            for (op = 0; op < offload_bench_op_max; ++op)
+            {
+                free(t->latency_ns[op]);
+            }
+            free(t->held);
+            free(t->expect);
+            free(t->actual);
+            free(t->flash);
+        }
+
+        bplib_mpool_collect_blocks(offload_bench_pool, UINT32_MAX);
+    }
+
+    nftw(offload_bench_config.dir, offload_bench_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(offload_bench_run, offload_bench_setup, NULL, "offload");
+}
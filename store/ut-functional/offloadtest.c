@@ -0,0 +1,283 @@
+/************************************************************************
+ *
+ *  Helpers shared by the tests of the offload modules
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utassert.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7.h"
+#include "v7_codec.h"
+#include "v7_encode.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "offloadtest.h"
+
+#define OFFLOAD_TEST_POOL_SIZE (4 * 1024 * 1024)
+
+/* the magic number of the block the module is made under, as the cache would be */
+#define OFFLOAD_TEST_PARENT_MAGIC 0x0ff1e57a
+
+const bp_ipn_addr_t OFFLOAD_TEST_SRC_ADDR = {100, 1};
+const bp_ipn_addr_t OFFLOAD_TEST_DST_ADDR = {200, 1};
+
+offload_test_t offload_test;
+
+static uint8_t              offload_test_pool_mem[OFFLOAD_TEST_POOL_SIZE];
+static uint8_t              offload_test_payload[OFFLOAD_TEST_MAX_PAYLOAD];
+static uint8_t              offload_test_actual[OFFLOAD_TEST_MAX_PAYLOAD];
+static bplib_mpool_block_t *offload_test_parent;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+void offload_test_setup(const bplib_cache_module_api_t *api, void *init_arg, size_t payload_size)
+{
+    static const bplib_mpool_blocktype_api_t parent_api = {NULL, NULL};
+
+    bplib_mpool_ref_t parent_ref;
+    uint32_t          i;
+
+    if (offload_test.pool != NULL)
+    {
+        return;
+    }
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+    offload_test.pool = bplib_mpool_create(offload_test_pool_mem, sizeof(offload_test_pool_mem));
+    UtAssert_NOT_NULL(offload_test.pool);
+
+    UtAssert_True(payload_size <= sizeof(offload_test_payload), "payload of %lu bytes", (unsigned long)payload_size);
+    for (i = 0; i < sizeof(offload_test_payload); ++i)
+    {
+        offload_test_payload[i] = (uint8_t)(i * 13);
+    }
+
+    offload_test.payload      = offload_test_payload;
+    offload_test.payload_size = payload_size;
+
+    /* the module is made under its own parent block, as the cache would */
+    bplib_mpool_register_blocktype(offload_test.pool, OFFLOAD_TEST_PARENT_MAGIC, &parent_api, sizeof(uint32_t));
+    offload_test_parent = bplib_mpool_generic_data_alloc(offload_test.pool, OFFLOAD_TEST_PARENT_MAGIC, NULL);
+    UtAssert_NOT_NULL(offload_test_parent);
+
+    offload_test.api = (const bplib_cache_offload_api_t *)api;
+
+    parent_ref       = bplib_mpool_ref_create(offload_test_parent);
+    offload_test.svc = offload_test.api->std.instantiate(parent_ref, init_arg);
+    bplib_mpool_ref_release(parent_ref);
+    UtAssert_NOT_NULL(offload_test.svc);
+}
+
+bplib_mpool_block_t *offload_test_alloc_primary(uint32_t seq)
+{
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *cpb;
+    bp_primary_block_t           *pri;
+
+    pblk = bplib_mpool_bblock_primary_alloc(offload_test.pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    if (cpb == NULL)
+    {
+        return NULL;
+    }
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    pri->version = 7;
+
+    v7_set_eid(&pri->destinationEID, &OFFLOAD_TEST_DST_ADDR);
+    v7_set_eid(&pri->sourceEID, &OFFLOAD_TEST_SRC_ADDR);
+    v7_set_eid(&pri->reportEID, &OFFLOAD_TEST_SRC_ADDR);
+
+    pri->creationTimeStamp.time         = v7_get_current_time();
+    pri->creationTimeStamp.sequence_num = seq;
+
+    pri->lifetime                     = 3600000;
+    pri->controlFlags.mustNotFragment = true;
+    pri->crctype                      = bp_crctype_CRC32C;
+
+    return pblk;
+}
+
+bool offload_test_append_payload(bplib_mpool_bblock_primary_t *cpb)
+{
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bp_canonical_block_buffer_t    *pay;
+
+    cblk = bplib_mpool_bblock_canonical_alloc(offload_test.pool, 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (ccb == NULL)
+    {
+        return false;
+    }
+
+    pay = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    pay->canonical_block.blockNum  = 1;
+    pay->canonical_block.crctype   = bp_crctype_CRC32C;
+    pay->canonical_block.blockType = bp_blocktype_payloadBlock;
+
+    if (v7_block_encode_pay(ccb, offload_test.payload, offload_test.payload_size) != 0)
+    {
+        bplib_mpool_recycle_block(cblk);
+        return false;
+    }
+
+    bplib_mpool_bblock_primary_append(cpb, cblk);
+    v7_compute_full_bundle_size(cpb);
+
+    return true;
+}
+
+bplib_mpool_block_t *offload_test_build(uint32_t seq)
+{
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *cpb;
+
+    pblk = offload_test_alloc_primary(seq);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    if (cpb == NULL)
+    {
+        return NULL;
+    }
+
+    if (v7_block_encode_pri(cpb) != 0 || !offload_test_append_payload(cpb))
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    return pblk;
+}
+
+bp_sid_t offload_test_offload(uint32_t seq)
+{
+    bplib_mpool_block_t *pblk;
+    bplib_mpool_ref_t    ref;
+    bp_sid_t             sid;
+    int                  status;
+
+    pblk = offload_test_build(seq);
+    UtAssert_NOT_NULL(pblk);
+    if (pblk == NULL)
+    {
+        return 0;
+    }
+
+    /* the bundle is held by ref while it is offloaded, as the cache does, so the module can keep it too */
+    ref    = bplib_mpool_ref_create(pblk);
+    sid    = 0;
+    status = offload_test.api->offload(offload_test.svc, &sid, pblk);
+    bplib_mpool_ref_release(ref);
+
+    return (status == BP_SUCCESS) ? sid : 0;
+}
+
+bool offload_test_check(bp_sid_t sid, uint32_t seq)
+{
+    bplib_mpool_block_t            *rblk;
+    bplib_mpool_ref_t               rref;
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_canonical_t *ccb;
+    size_t                          content_len;
+    bool                            matched;
+
+    rblk = NULL;
+    if (offload_test.api->restore(offload_test.svc, sid, &rblk) != BP_SUCCESS)
+    {
+        return false;
+    }
+
+    /* the cache takes a ref to what is restored, which the module may also have */
+    rref = bplib_mpool_ref_create(rblk);
+
+    matched = false;
+    cpb     = bplib_mpool_bblock_primary_cast(rblk);
+    ccb     = NULL;
+    if (cpb != NULL)
+    {
+        ccb = bplib_mpool_bblock_canonical_cast(
+            bplib_mpool_bblock_primary_locate_canonical(cpb, bp_blocktype_payloadBlock));
+    }
+
+    if (ccb != NULL && bplib_mpool_bblock_primary_get_logical(cpb)->creationTimeStamp.sequence_num == seq)
+    {
+        content_len = bplib_mpool_bblock_canonical_get_content_length(ccb);
+        memset(offload_test_actual, 0, sizeof(offload_test_actual));
+        matched = content_len == offload_test.payload_size &&
+                  bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb),
+                                                 offload_test_actual, sizeof(offload_test_actual),
+                                                 bplib_mpool_bblock_canonical_get_content_offset(ccb),
+                                                 content_len) == content_len &&
+                  memcmp(offload_test_actual, offload_test.payload, content_len) == 0;
+    }
+
+    bplib_mpool_ref_release(rref);
+
+    return matched;
+}
+
+static void offload_test_recover_one(void *arg, const bplib_cache_offload_index_t *index)
+{
+    offload_test_recovered_t *rec = arg;
+
+    if (rec->count < (sizeof(rec->index) / sizeof(rec->index[0])))
+    {
+        rec->index[rec->count] = *index;
+    }
+
+    ++rec->count;
+}
+
+void offload_test_check_recovered(const bp_sid_t *sid, const uint32_t *seq, uint32_t count)
+{
+    offload_test_recovered_t rec;
+    uint32_t                 i;
+    uint32_t                 j;
+
+    memset(&rec, 0, sizeof(rec));
+    UtAssert_INT32_EQ(offload_test.api->recover(offload_test.svc, offload_test_recover_one, &rec), BP_SUCCESS);
+    UtAssert_UINT32_EQ(rec.count, count);
+
+    for (i = 0; i < count; ++i)
+    {
+        for (j = 0; j < rec.count; ++j)
+        {
+            if (rec.index[j].sid == sid[i])
+            {
+                break;
+            }
+        }
+
+        UtAssert_True(j < rec.count, "sid %lx recovered", (unsigned long)sid[i]);
+        if (j < rec.count)
+        {
+            UtAssert_UINT32_EQ(rec.index[j].sequence_num, seq[i]);
+            UtAssert_UINT32_EQ(rec.index[j].final_dest_node, OFFLOAD_TEST_DST_ADDR.node_number);
+        }
+    }
+
+    /* they are only handed over once */
+    memset(&rec, 0, sizeof(rec));
+    UtAssert_INT32_EQ(offload_test.api->recover(offload_test.svc, offload_test_recover_one, &rec), BP_SUCCESS);
+    UtAssert_ZERO(rec.count);
+}
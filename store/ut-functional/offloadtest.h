@@ -0,0 +1,110 @@
+/************************************************************************
+ *
+ *  Helpers shared by the tests of the offload modules
+ *
+ *  Each test runs one module under a parent block of its own, as the
+ *  cache would, and puts bundles through it that are told apart by their
+ *  sequence number and all carry the same payload, so these are kept here
+ *  rather than in every one of them.
+ *
+ *************************************************************************/
+
+#ifndef OFFLOADTEST_H
+#define OFFLOADTEST_H
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bplib.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "v7_mpool_bblocks.h"
+
+/* the most that any of the tests offload at once, and so the most recover() is expected to hand back */
+#define OFFLOAD_TEST_MAX_RECOVERED 128
+
+/* the largest payload a test can ask for */
+#define OFFLOAD_TEST_MAX_PAYLOAD 8192
+
+/*************************************************************************
+ * Typedefs
+ *************************************************************************/
+
+/* The module under test, and the pool the bundles put through it come from */
+typedef struct offload_test
+{
+    bplib_mpool_t                   *pool;
+    const bplib_cache_offload_api_t *api;
+    bplib_mpool_block_t             *svc;
+    const uint8_t                   *payload;
+    size_t                           payload_size;
+
+} offload_test_t;
+
+/* what recover() handed back */
+typedef struct offload_test_recovered
+{
+    bplib_cache_offload_index_t index[OFFLOAD_TEST_MAX_RECOVERED];
+    uint32_t                    count;
+
+} offload_test_recovered_t;
+
+/*************************************************************************
+ * Globals
+ *************************************************************************/
+
+extern offload_test_t offload_test;
+
+extern const bp_ipn_addr_t OFFLOAD_TEST_SRC_ADDR;
+extern const bp_ipn_addr_t OFFLOAD_TEST_DST_ADDR;
+
+/*************************************************************************
+ * Prototypes
+ *************************************************************************/
+
+/*
+ * Starts OSAL and bplib, makes the pool and the parent block, and makes an instance of the module
+ * with init_arg, as the cache would.  Bundles built after this carry payload_size bytes of payload.
+ * Only the first call does anything, so it can be called from the setup of every test.
+ */
+void offload_test_setup(const bplib_cache_module_api_t *api, void *init_arg, size_t payload_size);
+
+/*
+ * Allocates a primary block with its logical data filled in and not yet encoded, told apart from
+ * the others by its sequence number.  A test adds whatever else it needs and then encodes it.
+ */
+bplib_mpool_block_t *offload_test_alloc_primary(uint32_t seq);
+
+/*
+ * Encodes the payload into a new payload block and appends it as the last block of the bundle,
+ * which is then complete.  The bundle is left as it was if this fails.
+ */
+bool offload_test_append_payload(bplib_mpool_bblock_primary_t *cpb);
+
+/*
+ * Builds and encodes a bundle with only a payload block, or returns NULL if that failed
+ */
+bplib_mpool_block_t *offload_test_build(uint32_t seq);
+
+/*
+ * Offloads a new bundle with the given sequence number, returning its sid or 0 if that failed
+ */
+bp_sid_t offload_test_offload(uint32_t seq);
+
+/*
+ * Restores a bundle and checks it is the one with the given sequence number, with its payload intact.
+ * The restored bundle is let go of the way the cache would, so the module may still be holding it.
+ */
+bool offload_test_check(bp_sid_t sid, uint32_t seq);
+
+/*
+ * Checks that what recover() hands back is exactly the bundles given, in any order, and that
+ * it hands nothing back the second time
+ */
+void offload_test_check_recovered(const bp_sid_t *sid, const uint32_t *seq, uint32_t count);
+
+#endif /* OFFLOADTEST_H */
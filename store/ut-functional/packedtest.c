@@ -0,0 +1,356 @@
+/************************************************************************
+ *
+ *  Round trip test of the packed offload module
+ *
+ *  A bundle with a hop count block, a custody tracking block and a
+ *  payload is offloaded to the module, restored, and the restored bundle
+ *  compared with the original: the logical primary block and the tracking
+ *  data of the delivery, then each canonical block by its header, its
+ *  logical data and its content, and finally the whole bundle as it is
+ *  encoded.  The extension blocks come back lazily decoded, so they are
+ *  decoded before they are compared, as the cache would before using them.
+ *
+ *  The record is only dropped on release, so a bundle can be restored
+ *  more than once, and after the release its sid is no longer valid.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7.h"
+#include "v7_codec.h"
+#include "v7_decode.h"
+#include "v7_encode.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "v7_mpool_ref.h"
+#include "v7_mpool_bblocks.h"
+#include "bplib_packed_offload.h"
+#include "offloadtest.h"
+
+#define PACKED_TEST_PAYLOAD_SIZE 6000
+#define PACKED_TEST_WIRE_SIZE    (PACKED_TEST_PAYLOAD_SIZE + 1024)
+
+static const bp_ipn_addr_t PACKED_TEST_CUSTODIAN_ADDR = {150, 0};
+
+static uint8_t           packed_test_expect[PACKED_TEST_WIRE_SIZE];
+static uint8_t           packed_test_actual[PACKED_TEST_WIRE_SIZE];
+static bplib_mpool_ref_t packed_test_bundle;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* Adds an extension block of the given type, whose logical data is already filled in */
+static bool packed_test_add_block(bplib_mpool_bblock_primary_t *cpb, bp_blocktype_t block_type,
+                                  const bp_canonical_block_data_t *data)
+{
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bp_canonical_block_buffer_t    *logical;
+
+    cblk = bplib_mpool_bblock_canonical_alloc(offload_test.pool, 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (ccb == NULL)
+    {
+        return false;
+    }
+
+    logical = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    logical->canonical_block.blockType                          = block_type;
+    logical->canonical_block.blockNum                           = block_type;
+    logical->canonical_block.crctype                            = bp_crctype_CRC32C;
+    logical->canonical_block.processingControlFlags.must_remove = true;
+    logical->data                                               = *data;
+
+    if (v7_block_encode_canonical(ccb) != 0)
+    {
+        bplib_mpool_recycle_block(cblk);
+        return false;
+    }
+
+    bplib_mpool_bblock_primary_append(cpb, cblk);
+    return true;
+}
+
+/* Builds and encodes the bundle, with the tracking data the cache would have filled in */
+static bplib_mpool_block_t *packed_test_build(void)
+{
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *cpb;
+    bp_canonical_block_data_t     data;
+
+    pblk = offload_test_alloc_primary(42);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    if (cpb == NULL)
+    {
+        return NULL;
+    }
+
+    cpb->data.delivery.delivery_policy      = bplib_policy_delivery_custody_tracking;
+    cpb->data.delivery.class_of_service     = BP_COS_EXPEDITED;
+    cpb->data.delivery.ingress_time         = 1000;
+    cpb->data.delivery.egress_time          = 2000;
+    cpb->data.delivery.committed_storage_id = 7;
+    cpb->data.delivery.local_retx_interval  = 5000;
+
+    if (v7_block_encode_pri(cpb) != 0)
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    memset(&data, 0, sizeof(data));
+    data.hop_count_block.hopLimit = 30;
+    data.hop_count_block.hopCount = 3;
+    if (!packed_test_add_block(cpb, bp_blocktype_hopCount, &data))
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    memset(&data, 0, sizeof(data));
+    v7_set_eid(&data.custody_tracking_block.current_custodian, &PACKED_TEST_CUSTODIAN_ADDR);
+    if (!packed_test_add_block(cpb, bp_blocktype_custodyTrackingBlock, &data) || !offload_test_append_payload(cpb))
+    {
+        bplib_mpool_recycle_block(pblk);
+        return NULL;
+    }
+
+    return pblk;
+}
+
+static void packed_test_check_eid(const bp_endpointid_buffer_t *expect, const bp_endpointid_buffer_t *actual)
+{
+    bp_ipn_addr_t expect_addr;
+    bp_ipn_addr_t actual_addr;
+
+    v7_get_eid(&expect_addr, expect);
+    v7_get_eid(&actual_addr, actual);
+    UtAssert_UINT32_EQ(actual_addr.node_number, expect_addr.node_number);
+    UtAssert_UINT32_EQ(actual_addr.service_number, expect_addr.service_number);
+}
+
+static void packed_test_check_primary(bplib_mpool_bblock_primary_t *expect, bplib_mpool_bblock_primary_t *actual)
+{
+    const bp_primary_block_t *ep;
+    const bp_primary_block_t *ap;
+
+    ep = bplib_mpool_bblock_primary_get_logical(expect);
+    ap = bplib_mpool_bblock_primary_get_logical(actual);
+
+    UtAssert_UINT32_EQ(ap->version, ep->version);
+    UtAssert_UINT32_EQ(ap->crctype, ep->crctype);
+    UtAssert_UINT32_EQ(ap->crcval, ep->crcval);
+    UtAssert_MemCmp(&ap->controlFlags, &ep->controlFlags, sizeof(ep->controlFlags), "control flags");
+    packed_test_check_eid(&ep->destinationEID, &ap->destinationEID);
+    packed_test_check_eid(&ep->sourceEID, &ap->sourceEID);
+    packed_test_check_eid(&ep->reportEID, &ap->reportEID);
+    UtAssert_True(ap->creationTimeStamp.time == ep->creationTimeStamp.time, "creation time");
+    UtAssert_True(ap->creationTimeStamp.sequence_num == ep->creationTimeStamp.sequence_num, "sequence number");
+    UtAssert_True(ap->lifetime == ep->lifetime, "lifetime");
+
+    /* the tracking data is not in the encoded bundle, so it is the module that kept it */
+    UtAssert_UINT32_EQ(actual->data.delivery.delivery_policy, expect->data.delivery.delivery_policy);
+    UtAssert_UINT32_EQ(actual->data.delivery.class_of_service, expect->data.delivery.class_of_service);
+    UtAssert_True(actual->data.delivery.ingress_time == expect->data.delivery.ingress_time, "ingress time");
+    UtAssert_True(actual->data.delivery.egress_time == expect->data.delivery.egress_time, "egress time");
+    UtAssert_True(actual->data.delivery.committed_storage_id == expect->data.delivery.committed_storage_id,
+                  "committed storage id");
+    UtAssert_True(actual->data.delivery.local_retx_interval == expect->data.delivery.local_retx_interval,
+                  "retransmit interval");
+    UtAssert_BOOL_FALSE(actual->data.delivery.crc_deferred);
+}
+
+static void packed_test_check_canonical(bplib_mpool_bblock_canonical_t *expect, bplib_mpool_bblock_canonical_t *actual)
+{
+    bp_canonical_block_buffer_t *el;
+    bp_canonical_block_buffer_t *al;
+    size_t                       content_len;
+
+    el = bplib_mpool_bblock_canonical_get_logical(expect);
+    al = bplib_mpool_bblock_canonical_get_logical(actual);
+
+    UtAssert_UINT32_EQ(al->canonical_block.blockType, el->canonical_block.blockType);
+    UtAssert_UINT32_EQ(al->canonical_block.blockNum, el->canonical_block.blockNum);
+    UtAssert_UINT32_EQ(al->canonical_block.crctype, el->canonical_block.crctype);
+    UtAssert_UINT32_EQ(al->canonical_block.crcval, el->canonical_block.crcval);
+    UtAssert_MemCmp(&al->canonical_block.processingControlFlags, &el->canonical_block.processingControlFlags,
+                    sizeof(el->canonical_block.processingControlFlags), "block processing flags");
+
+    /* only the extension blocks are left to be decoded when they are used */
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(actual), 0);
+    UtAssert_BOOL_FALSE(al->data_pending);
+    switch (el->canonical_block.blockType)
+    {
+        case bp_blocktype_hopCount:
+            UtAssert_UINT32_EQ(al->data.hop_count_block.hopLimit, el->data.hop_count_block.hopLimit);
+            UtAssert_UINT32_EQ(al->data.hop_count_block.hopCount, el->data.hop_count_block.hopCount);
+            break;
+        case bp_blocktype_custodyTrackingBlock:
+            packed_test_check_eid(&el->data.custody_tracking_block.current_custodian,
+                                  &al->data.custody_tracking_block.current_custodian);
+            break;
+        default:
+            break;
+    }
+
+    content_len = bplib_mpool_bblock_canonical_get_content_length(expect);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_canonical_get_content_length(actual), content_len);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_canonical_get_encoded_chunks(expect),
+                                                      packed_test_expect, sizeof(packed_test_expect),
+                                                      bplib_mpool_bblock_canonical_get_content_offset(expect),
+                                                      content_len),
+                       content_len);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_canonical_get_encoded_chunks(actual),
+                                                      packed_test_actual, sizeof(packed_test_actual),
+                                                      bplib_mpool_bblock_canonical_get_content_offset(actual),
+                                                      content_len),
+                       content_len);
+    UtAssert_MemCmp(packed_test_actual, packed_test_expect, content_len, "block content");
+}
+
+/* Compares a restored bundle with the one that was offloaded, block by block and then as encoded */
+static void packed_test_check(bplib_mpool_block_t *rblk)
+{
+    bplib_mpool_bblock_primary_t *expect;
+    bplib_mpool_bblock_primary_t *actual;
+    bplib_mpool_list_iter_t       expect_it;
+    bplib_mpool_list_iter_t       actual_it;
+    int                           expect_stat;
+    int                           actual_stat;
+    size_t                        wire_size;
+    uint32_t                      count;
+
+    expect = bplib_mpool_bblock_primary_cast(bplib_mpool_dereference(packed_test_bundle));
+    actual = bplib_mpool_bblock_primary_cast(rblk);
+    UtAssert_NOT_NULL(actual);
+    if (actual == NULL)
+    {
+        return;
+    }
+
+    packed_test_check_primary(expect, actual);
+
+    count       = 0;
+    expect_stat = bplib_mpool_list_iter_goto_first(bplib_mpool_bblock_primary_get_canonical_list(expect), &expect_it);
+    actual_stat = bplib_mpool_list_iter_goto_first(bplib_mpool_bblock_primary_get_canonical_list(actual), &actual_it);
+    while (expect_stat == BP_SUCCESS && actual_stat == BP_SUCCESS)
+    {
+        packed_test_check_canonical(bplib_mpool_bblock_canonical_cast(expect_it.position),
+                                    bplib_mpool_bblock_canonical_cast(actual_it.position));
+        ++count;
+        expect_stat = bplib_mpool_list_iter_forward(&expect_it);
+        actual_stat = bplib_mpool_list_iter_forward(&actual_it);
+    }
+    UtAssert_INT32_EQ(actual_stat, expect_stat);
+    UtAssert_UINT32_EQ(count, 3);
+
+    wire_size = v7_compute_full_bundle_size(expect);
+    UtAssert_UINT32_EQ(v7_compute_full_bundle_size(actual), wire_size);
+    UtAssert_UINT32_EQ(v7_copy_full_bundle_out(expect, packed_test_expect, sizeof(packed_test_expect)), wire_size);
+    UtAssert_UINT32_EQ(v7_copy_full_bundle_out(actual, packed_test_actual, sizeof(packed_test_actual)), wire_size);
+    UtAssert_MemCmp(packed_test_actual, packed_test_expect, wire_size, "encoded bundle");
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void packed_test_setup(void)
+{
+    if (offload_test.svc != NULL)
+    {
+        return;
+    }
+
+    offload_test_setup(BPLIB_PACKED_OFFLOAD_API, NULL, PACKED_TEST_PAYLOAD_SIZE);
+    UtAssert_BOOL_TRUE(offload_test.api->in_memory);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+
+    packed_test_bundle = bplib_mpool_ref_create(packed_test_build());
+    UtAssert_NOT_NULL(packed_test_bundle);
+}
+
+void packed_test_round_trip(void)
+{
+    bplib_mpool_block_t *rblk;
+    bplib_mpool_ref_t    rref;
+    bp_sid_t             sid;
+    uint32_t             i;
+
+    sid = 0;
+    UtAssert_INT32_EQ(offload_test.api->offload(offload_test.svc, &sid, bplib_mpool_dereference(packed_test_bundle)),
+                      BP_SUCCESS);
+    UtAssert_NONZERO(sid);
+
+    /* the record stays until it is released, so it can be restored again the next time it is needed */
+    for (i = 0; i < 2; ++i)
+    {
+        rblk = NULL;
+        UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid, &rblk), BP_SUCCESS);
+        rref = bplib_mpool_ref_create(rblk);
+        packed_test_check(rblk);
+        bplib_mpool_ref_release(rref);
+    }
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid, &rblk), BP_ERROR);
+    UtAssert_NULL(rblk);
+}
+
+void packed_test_slots(void)
+{
+    bplib_mpool_block_t *rblk;
+    bplib_mpool_block_t *pblk;
+    bp_sid_t             sid[3];
+    bp_sid_t             reused;
+    uint32_t             i;
+
+    pblk = bplib_mpool_dereference(packed_test_bundle);
+    for (i = 0; i < 3; ++i)
+    {
+        sid[i] = 0;
+        UtAssert_INT32_EQ(offload_test.api->offload(offload_test.svc, &sid[i], pblk), BP_SUCCESS);
+        UtAssert_NONZERO(sid[i]);
+    }
+    UtAssert_True(sid[0] != sid[1] && sid[1] != sid[2] && sid[0] != sid[2], "each bundle has its own sid");
+
+    /* a released slot is handed out again, and the others are not affected */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[1]), BP_SUCCESS);
+    reused = 0;
+    UtAssert_INT32_EQ(offload_test.api->offload(offload_test.svc, &reused, pblk), BP_SUCCESS);
+    UtAssert_True(reused == sid[1], "released sid is used again");
+
+    rblk = NULL;
+    UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid[2], &rblk), BP_SUCCESS);
+    packed_test_check(rblk);
+    bplib_mpool_recycle_block(rblk);
+
+    /* stopping drops everything that is left */
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid[0], &rblk), BP_ERROR);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(packed_test_round_trip, packed_test_setup, NULL, "round trip");
+    UtTest_Add(packed_test_slots, packed_test_setup, NULL, "slots");
+}
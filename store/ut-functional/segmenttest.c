@@ -0,0 +1,411 @@
+/************************************************************************
+ *
+ *  Behavior test of the segment offload module
+ *
+ *  The module is run on a directory of its own, which is removed before
+ *  each test so every one starts from an empty store.
+ *
+ *  Bundles are offloaded, restored and released, checking the sids say
+ *  where in which segment each record went.  The module is then stopped
+ *  and started again to check that the journal it reads back holds what
+ *  was held and nothing that was released, and that new records do not go
+ *  over the old ones.  A segment is filled past its end twice to check a
+ *  segment whose records were all released is used again rather than a
+ *  new file being made.  Finally a record damaged in its segment file must
+ *  not restore, and junk at the end of the journal must not stop a start.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "bplib_segment_offload.h"
+#include "benchutil.h"
+#include "offloadtest.h"
+
+#define SEGMENT_TEST_PAYLOAD_SIZE 4000
+#define SEGMENT_TEST_PATH_SIZE    256
+
+/* how sids are made up by the module, the segment number above the record offset in units of 16 bytes */
+#define SEGMENT_TEST_OFFSET_BITS 20
+#define SEGMENT_TEST_OFFSET_MASK ((1UL << SEGMENT_TEST_OFFSET_BITS) - 1)
+#define SEGMENT_TEST_ALIGN       16
+#define SEGMENT_TEST_SEG_SIZE    ((unsigned long)SEGMENT_TEST_ALIGN << SEGMENT_TEST_OFFSET_BITS)
+
+/* more bundles than fit in a segment, so a loop waiting for the segment to change always ends */
+#define SEGMENT_TEST_MAX_CYCLES (2 * (SEGMENT_TEST_SEG_SIZE / SEGMENT_TEST_PAYLOAD_SIZE))
+
+/* bundles offloaded in the restart tests */
+#define SEGMENT_TEST_HELD 6
+
+static char segment_test_dir[SEGMENT_TEST_PATH_SIZE];
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static unsigned long segment_test_seg(bp_sid_t sid)
+{
+    return (unsigned long)(sid >> SEGMENT_TEST_OFFSET_BITS);
+}
+
+static unsigned long segment_test_pos(bp_sid_t sid)
+{
+    return (unsigned long)(sid & SEGMENT_TEST_OFFSET_MASK) * SEGMENT_TEST_ALIGN;
+}
+
+/* The name of a file in the test directory, such as the segment file that holds a sid */
+static const char *segment_test_path(char *buf, size_t size, const char *name)
+{
+    snprintf(buf, size, "%s/%s", segment_test_dir, name);
+    return buf;
+}
+
+static const char *segment_test_seg_path(char *buf, size_t size, unsigned long seg_num)
+{
+    char name[16];
+
+    snprintf(name, sizeof(name), "seg%04lx.dat", seg_num - 1);
+    return segment_test_path(buf, size, name);
+}
+
+static bool segment_test_exists(const char *path)
+{
+    struct stat st;
+
+    return stat(path, &st) == 0;
+}
+
+static int segment_test_remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftwbuf)
+{
+    return remove(path);
+}
+
+/* Stops the module if it is running, and starts it again after removing everything it stored */
+static void segment_test_start_blank(void)
+{
+    offload_test.api->std.stop(offload_test.svc);
+    nftw(segment_test_dir, segment_test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+    UtAssert_True(segment_test_exists(segment_test_dir), "%s made", segment_test_dir);
+}
+
+static void segment_test_stop_start(void)
+{
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+}
+
+/*
+ * Puts bundles through one at a time, each offloaded, restored and released, until one goes to
+ * a segment other than the given one.  That one is left held, and its sid returned, or 0 if none did.
+ */
+static bp_sid_t segment_test_cycle_until_next(unsigned long seg_num, uint32_t *seq)
+{
+    bp_sid_t sid;
+    uint32_t i;
+    uint32_t failed;
+
+    failed = 0;
+    for (i = 0; i < SEGMENT_TEST_MAX_CYCLES; ++i)
+    {
+        ++(*seq);
+        sid = offload_test_offload(*seq);
+        if (sid == 0)
+        {
+            ++failed;
+            break;
+        }
+
+        if (segment_test_seg(sid) != seg_num)
+        {
+            UtAssert_ZERO(failed);
+            return sid;
+        }
+
+        if (!offload_test_check(sid, *seq) || offload_test.api->release(offload_test.svc, sid) != BP_SUCCESS)
+        {
+            ++failed;
+        }
+
+        /* what was restored goes back to the pool now, so the pool never runs out */
+        bplib_mpool_collect_blocks(offload_test.pool, UINT32_MAX);
+    }
+
+    UtAssert_ZERO(failed);
+    UtAssert_Failed("still in segment %lu after %lu bundles", seg_num, (unsigned long)i);
+    return 0;
+}
+
+/* Changes one byte of a segment file, at pos from the start of the record for sid */
+static void segment_test_damage(bp_sid_t sid, unsigned long pos)
+{
+    char    path[SEGMENT_TEST_PATH_SIZE];
+    uint8_t byte;
+    int     fd;
+
+    fd = open(segment_test_seg_path(path, sizeof(path), segment_test_seg(sid)), O_RDWR);
+    UtAssert_True(fd >= 0, "open %s", path);
+    if (fd >= 0)
+    {
+        pos += segment_test_pos(sid);
+        UtAssert_True(pread(fd, &byte, 1, (off_t)pos) == 1, "read at %lu", pos);
+        byte ^= 0x5a;
+        UtAssert_True(pwrite(fd, &byte, 1, (off_t)pos) == 1, "write at %lu", pos);
+        close(fd);
+    }
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void segment_test_setup(void)
+{
+    int commit_delay;
+    int commit_bytes;
+
+    if (offload_test.svc != NULL)
+    {
+        return;
+    }
+
+    strncpy(segment_test_dir, bench_getenv("SEGMENT_TEST_DIR", "segment_test"), sizeof(segment_test_dir) - 1);
+
+    offload_test_setup(BPLIB_SEGMENT_OFFLOAD_API, NULL, SEGMENT_TEST_PAYLOAD_SIZE);
+    UtAssert_BOOL_FALSE(offload_test.api->in_memory);
+
+    /*
+     * Records are only flushed when a test asks, or the segment tests would sync the disk thousands
+     * of times.  Nothing here depends on when the data gets to the disk, as the files are not lost.
+     */
+    commit_delay = 3600000;
+    commit_bytes = 0;
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_base_dir,
+                                                      bplib_cache_module_valtype_string, segment_test_dir),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_commit_delay,
+                                                      bplib_cache_module_valtype_integer, &commit_delay),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_commit_bytes,
+                                                      bplib_cache_module_valtype_integer, &commit_bytes),
+                      BP_SUCCESS);
+}
+
+void segment_test_round_trip(void)
+{
+    bplib_mpool_block_t *rblk;
+    bp_sid_t             sid1;
+    bp_sid_t             sid2;
+
+    segment_test_start_blank();
+
+    /* the first record goes at the start of the first segment */
+    sid1 = offload_test_offload(1);
+    UtAssert_UINT32_EQ(segment_test_seg(sid1), 1);
+    UtAssert_ZERO(segment_test_pos(sid1));
+
+    /* and the next one right after it */
+    sid2 = offload_test_offload(2);
+    UtAssert_UINT32_EQ(segment_test_seg(sid2), 1);
+    UtAssert_True(segment_test_pos(sid2) >= SEGMENT_TEST_PAYLOAD_SIZE, "second record at %lu",
+                  segment_test_pos(sid2));
+    UtAssert_True(segment_test_pos(sid2) < 2 * SEGMENT_TEST_PAYLOAD_SIZE, "second record at %lu",
+                  segment_test_pos(sid2));
+
+    /* a record stays until it is released, so it can be restored again the next time it is needed */
+    UtAssert_BOOL_TRUE(offload_test_check(sid1, 1));
+    UtAssert_BOOL_TRUE(offload_test_check(sid2, 2));
+    UtAssert_BOOL_TRUE(offload_test_check(sid1, 1));
+
+    /* a sid that was never handed out does not restore */
+    rblk = NULL;
+    UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid1 + (2UL << SEGMENT_TEST_OFFSET_BITS), &rblk),
+                      BP_ERROR);
+    UtAssert_NULL(rblk);
+
+    /* once all in the segment are released, nothing in it restores, and the segment starts over */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid1), BP_SUCCESS);
+    UtAssert_BOOL_TRUE(offload_test_check(sid2, 2));
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid2), BP_SUCCESS);
+    rblk = NULL;
+    UtAssert_INT32_EQ(offload_test.api->restore(offload_test.svc, sid2, &rblk), BP_ERROR);
+    UtAssert_NULL(rblk);
+
+    UtAssert_UINT32_EQ(offload_test_offload(3), sid1);
+    UtAssert_BOOL_TRUE(offload_test_check(sid1, 3));
+}
+
+void segment_test_restart(void)
+{
+    char     path[SEGMENT_TEST_PATH_SIZE];
+    bp_sid_t sid[SEGMENT_TEST_HELD];
+    bp_sid_t held_sid[SEGMENT_TEST_HELD];
+    uint32_t held_seq[SEGMENT_TEST_HELD];
+    uint32_t num_held;
+    bp_sid_t new_sid;
+    uint32_t i;
+
+    segment_test_start_blank();
+
+    for (i = 0; i < SEGMENT_TEST_HELD; ++i)
+    {
+        sid[i] = offload_test_offload(10 + i);
+        UtAssert_NONZERO(sid[i]);
+    }
+
+    /* every other one is released, the last one among them, so the end of the segment has nothing held */
+    num_held = 0;
+    for (i = 0; i < SEGMENT_TEST_HELD; ++i)
+    {
+        if ((i & 1) != 0)
+        {
+            UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[i]), BP_SUCCESS);
+        }
+        else
+        {
+            held_sid[num_held] = sid[i];
+            held_seq[num_held] = 10 + i;
+            ++num_held;
+        }
+    }
+
+    /* a new start has only the checkpoint and the journal to go on */
+    segment_test_stop_start();
+    UtAssert_True(segment_test_exists(segment_test_path(path, sizeof(path), "index.ckp")), "%s made", path);
+
+    offload_test_check_recovered(held_sid, held_seq, num_held);
+    for (i = 0; i < num_held; ++i)
+    {
+        UtAssert_True(offload_test_check(held_sid[i], held_seq[i]), "sid %lx restored after restart",
+                      (unsigned long)held_sid[i]);
+    }
+
+    /* new records go after the last one held, not over it */
+    new_sid = offload_test_offload(20);
+    UtAssert_UINT32_EQ(segment_test_seg(new_sid), 1);
+    UtAssert_True(segment_test_pos(new_sid) > segment_test_pos(held_sid[num_held - 1]), "new record at %lu",
+                  segment_test_pos(new_sid));
+    UtAssert_BOOL_TRUE(offload_test_check(new_sid, 20));
+    for (i = 0; i < num_held; ++i)
+    {
+        UtAssert_BOOL_TRUE(offload_test_check(held_sid[i], held_seq[i]));
+    }
+
+    /* the one offloaded since is held through the next restart as well, and a released one is not */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, held_sid[0]), BP_SUCCESS);
+    held_sid[0] = new_sid;
+    held_seq[0] = 20;
+
+    segment_test_stop_start();
+    offload_test_check_recovered(held_sid, held_seq, num_held);
+}
+
+void segment_test_reuse(void)
+{
+    char     path[SEGMENT_TEST_PATH_SIZE];
+    bp_sid_t held1;
+    bp_sid_t held2;
+    uint32_t held2_seq;
+    bp_sid_t next;
+    uint32_t seq;
+
+    segment_test_start_blank();
+
+    /* one record is held in the first segment, so it cannot start over and fills up */
+    seq   = 100;
+    held1 = offload_test_offload(seq);
+    UtAssert_UINT32_EQ(segment_test_seg(held1), 1);
+
+    held2     = segment_test_cycle_until_next(1, &seq);
+    held2_seq = seq;
+    UtAssert_UINT32_EQ(segment_test_seg(held2), 2);
+    UtAssert_ZERO(segment_test_pos(held2));
+    UtAssert_True(segment_test_exists(segment_test_seg_path(path, sizeof(path), 2)), "%s made", path);
+    UtAssert_BOOL_TRUE(offload_test_check(held1, 100));
+    UtAssert_BOOL_TRUE(offload_test_check(held2, held2_seq));
+
+    /* with the first segment emptied, it is the one used again when the second fills, not a new one */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, held1), BP_SUCCESS);
+    next = segment_test_cycle_until_next(2, &seq);
+    UtAssert_UINT32_EQ(segment_test_seg(next), 1);
+    UtAssert_ZERO(segment_test_pos(next));
+    UtAssert_BOOL_FALSE(segment_test_exists(segment_test_seg_path(path, sizeof(path), 3)));
+
+    UtAssert_BOOL_TRUE(offload_test_check(next, seq));
+    UtAssert_BOOL_TRUE(offload_test_check(held2, held2_seq));
+}
+
+void segment_test_damaged(void)
+{
+    char     path[SEGMENT_TEST_PATH_SIZE];
+    bp_sid_t sid[3];
+    uint32_t seq[3];
+    uint32_t i;
+    int      fd;
+
+    segment_test_start_blank();
+
+    for (i = 0; i < 3; ++i)
+    {
+        seq[i] = 200 + i;
+        sid[i] = offload_test_offload(seq[i]);
+        UtAssert_NONZERO(sid[i]);
+    }
+
+    /* a changed byte in the data fails the CRC, and one in the header the magic number */
+    segment_test_damage(sid[0], 100);
+    segment_test_damage(sid[1], 0);
+    UtAssert_BOOL_FALSE(offload_test_check(sid[0], seq[0]));
+    UtAssert_BOOL_FALSE(offload_test_check(sid[1], seq[1]));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[2], seq[2]));
+
+    /* a partly written entry at the end of the journal, as a crash would leave, is not read */
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    fd = open(segment_test_path(path, sizeof(path), "index.jnl"), O_WRONLY | O_APPEND);
+    UtAssert_True(fd >= 0, "open %s", path);
+    if (fd >= 0)
+    {
+        UtAssert_True(write(fd, "partial", 7) == 7, "junk written");
+        close(fd);
+    }
+
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+    offload_test_check_recovered(sid, seq, 3);
+    UtAssert_BOOL_TRUE(offload_test_check(sid[2], seq[2]));
+
+    offload_test.api->std.stop(offload_test.svc);
+    nftw(segment_test_dir, segment_test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(segment_test_round_trip, segment_test_setup, NULL, "round trip");
+    UtTest_Add(segment_test_restart, segment_test_setup, NULL, "restart");
+    UtTest_Add(segment_test_reuse, segment_test_setup, NULL, "segment reuse");
+    UtTest_Add(segment_test_damaged, segment_test_setup, NULL, "damaged records");
+}
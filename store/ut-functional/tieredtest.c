@@ -0,0 +1,455 @@
+/************************************************************************
+ *
+ *  Behavior test of the tiered offload module
+ *
+ *  The lower tier is the segment module, in a directory of its own that
+ *  is removed before each test, called through a module here that counts
+ *  what the tiered module asks of it and can be made to fail writes.
+ *
+ *  Bundles are offloaded under and over the memory budget, checking that
+ *  only the least recently used ones go to the lower tier, and restored
+ *  from memory and from the lower tier, which brings them back into memory.
+ *  A bundle released while only in memory never goes to the lower tier.
+ *  With no budget every bundle goes straight down, and one that cannot be
+ *  written there is not taken.  Finally a flush and a stop write down what
+ *  is only in memory, and the next start recovers exactly what was held.
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7_cache.h"
+#include "v7_mpool.h"
+#include "v7_mpool_bblocks.h"
+#include "bplib_segment_offload.h"
+#include "bplib_tiered_offload.h"
+#include "benchutil.h"
+#include "offloadtest.h"
+
+#define TIERED_TEST_PAYLOAD_SIZE 2000
+#define TIERED_TEST_PATH_SIZE    256
+
+/* bundles that fit in memory under the budget of most of the tests */
+#define TIERED_TEST_IN_MEMORY 3
+
+/* what the tiered module has asked of the lower tier since the last start */
+typedef struct tiered_test_lower
+{
+    const bplib_cache_offload_api_t *api; /* of the module that does the work */
+    uint32_t                         offloads;
+    uint32_t                         restores;
+    uint32_t                         releases;
+    uint32_t                         flushes;
+    bool                             fail_offload;
+
+} tiered_test_lower_t;
+
+static char                tiered_test_dir[TIERED_TEST_PATH_SIZE];
+static tiered_test_lower_t tiered_test_lower;
+static int                 tiered_test_budget; /* that holds TIERED_TEST_IN_MEMORY bundles */
+
+/*************************************************************************
+ * Lower tier
+ *************************************************************************/
+
+static bplib_mpool_block_t *tiered_test_lower_instantiate(bplib_mpool_ref_t parent, void *init_arg)
+{
+    return tiered_test_lower.api->std.instantiate(parent, init_arg);
+}
+
+static int tiered_test_lower_configure(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                       const void *val)
+{
+    return tiered_test_lower.api->std.configure(svc, key, vt, val);
+}
+
+static int tiered_test_lower_query(bplib_mpool_block_t *svc, int key, bplib_cache_module_valtype_t vt,
+                                   const void **val)
+{
+    return tiered_test_lower.api->std.query(svc, key, vt, val);
+}
+
+static int tiered_test_lower_start(bplib_mpool_block_t *svc)
+{
+    return tiered_test_lower.api->std.start(svc);
+}
+
+static int tiered_test_lower_stop(bplib_mpool_block_t *svc)
+{
+    return tiered_test_lower.api->std.stop(svc);
+}
+
+static int tiered_test_lower_offload(bplib_mpool_block_t *svc, bp_sid_t *sid, bplib_mpool_block_t *pblk)
+{
+    ++tiered_test_lower.offloads;
+    if (tiered_test_lower.fail_offload)
+    {
+        return BP_ERROR;
+    }
+
+    return tiered_test_lower.api->offload(svc, sid, pblk);
+}
+
+static int tiered_test_lower_restore(bplib_mpool_block_t *svc, bp_sid_t sid, bplib_mpool_block_t **pblk_out)
+{
+    ++tiered_test_lower.restores;
+    return tiered_test_lower.api->restore(svc, sid, pblk_out);
+}
+
+static int tiered_test_lower_release(bplib_mpool_block_t *svc, bp_sid_t sid)
+{
+    ++tiered_test_lower.releases;
+    return tiered_test_lower.api->release(svc, sid);
+}
+
+static int tiered_test_lower_flush(bplib_mpool_block_t *svc)
+{
+    ++tiered_test_lower.flushes;
+    return tiered_test_lower.api->flush(svc);
+}
+
+static int tiered_test_lower_recover(bplib_mpool_block_t *svc, bplib_cache_offload_recover_func_t func, void *arg)
+{
+    return tiered_test_lower.api->recover(svc, func, arg);
+}
+
+static bplib_cache_offload_api_t tiered_test_lower_api = {.std.module_type = bplib_cache_module_type_offload,
+                                                          .std.instantiate = tiered_test_lower_instantiate,
+                                                          .std.configure   = tiered_test_lower_configure,
+                                                          .std.query       = tiered_test_lower_query,
+                                                          .std.start       = tiered_test_lower_start,
+                                                          .std.stop        = tiered_test_lower_stop,
+                                                          .offload         = tiered_test_lower_offload,
+                                                          .restore         = tiered_test_lower_restore,
+                                                          .release         = tiered_test_lower_release,
+                                                          .flush           = tiered_test_lower_flush,
+                                                          .recover         = tiered_test_lower_recover};
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static int tiered_test_remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftwbuf)
+{
+    return remove(path);
+}
+
+/* Stops the module if it is running, and starts it again with the given budget and an empty lower tier */
+static void tiered_test_start_blank(int budget)
+{
+    offload_test.api->std.stop(offload_test.svc);
+    nftw(tiered_test_dir, tiered_test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_ram_budget,
+                                                      bplib_cache_module_valtype_integer, &budget),
+                      BP_SUCCESS);
+
+    memset(&tiered_test_lower, 0, sizeof(tiered_test_lower));
+    tiered_test_lower.api = (const bplib_cache_offload_api_t *)BPLIB_SEGMENT_OFFLOAD_API;
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+}
+
+static void tiered_test_check_lower(uint32_t offloads, uint32_t restores, uint32_t releases)
+{
+    UtAssert_UINT32_EQ(tiered_test_lower.offloads, offloads);
+    UtAssert_UINT32_EQ(tiered_test_lower.restores, restores);
+    UtAssert_UINT32_EQ(tiered_test_lower.releases, releases);
+}
+
+static void tiered_test_recover_one(void *arg, const bplib_cache_offload_index_t *index)
+{
+    offload_test_recovered_t *rec = arg;
+
+    if (rec->count < (sizeof(rec->index) / sizeof(rec->index[0])))
+    {
+        rec->index[rec->count] = *index;
+    }
+
+    ++rec->count;
+}
+
+/*
+ * Checks that what recover() hands back after a restart is exactly the bundles with the given sequence
+ * numbers.  The sids are new, as they are only slots in the tiered module, so the bundles are found by
+ * sequence number, and each one must restore from the new sid.
+ */
+static void tiered_test_check_recovered(const uint32_t *seq, uint32_t count)
+{
+    offload_test_recovered_t rec;
+    uint32_t                 i;
+    uint32_t                 j;
+
+    memset(&rec, 0, sizeof(rec));
+    UtAssert_INT32_EQ(offload_test.api->recover(offload_test.svc, tiered_test_recover_one, &rec), BP_SUCCESS);
+    UtAssert_UINT32_EQ(rec.count, count);
+
+    for (i = 0; i < count; ++i)
+    {
+        for (j = 0; j < rec.count; ++j)
+        {
+            if (rec.index[j].sequence_num == seq[i])
+            {
+                break;
+            }
+        }
+
+        UtAssert_True(j < rec.count, "sequence number %lu recovered", (unsigned long)seq[i]);
+        if (j < rec.count)
+        {
+            UtAssert_UINT32_EQ(rec.index[j].final_dest_node, OFFLOAD_TEST_DST_ADDR.node_number);
+            UtAssert_True(offload_test_check(rec.index[j].sid, seq[i]), "sequence number %lu restored",
+                          (unsigned long)seq[i]);
+        }
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    UtAssert_INT32_EQ(offload_test.api->recover(offload_test.svc, tiered_test_recover_one, &rec), BP_SUCCESS);
+    UtAssert_ZERO(rec.count);
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void tiered_test_setup(void)
+{
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *cpb;
+    int                           commit_delay;
+
+    if (offload_test.svc != NULL)
+    {
+        return;
+    }
+
+    strncpy(tiered_test_dir, bench_getenv("TIERED_TEST_DIR", "tiered_test"), sizeof(tiered_test_dir) - 1);
+
+    tiered_test_lower.api = (const bplib_cache_offload_api_t *)BPLIB_SEGMENT_OFFLOAD_API;
+    offload_test_setup(BPLIB_TIERED_OFFLOAD_API, &tiered_test_lower_api, TIERED_TEST_PAYLOAD_SIZE);
+    UtAssert_BOOL_FALSE(offload_test.api->in_memory);
+
+    /* every key other than the budget goes to the lower tier */
+    commit_delay = 3600000;
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_base_dir,
+                                                      bplib_cache_module_valtype_string, tiered_test_dir),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.configure(offload_test.svc, bplib_cache_confkey_offload_commit_delay,
+                                                      bplib_cache_module_valtype_integer, &commit_delay),
+                      BP_SUCCESS);
+
+    /*
+     * A bundle counts against the budget with its primary block, as it does in the cache.  The bundles
+     * differ a few bytes in size with their sequence number and time, so the budget has room to spare
+     * for that, and not for one more bundle.
+     */
+    pblk = offload_test_build(100);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    UtAssert_NOT_NULL(cpb);
+    if (cpb != NULL)
+    {
+        tiered_test_budget = (int)((TIERED_TEST_IN_MEMORY * 2 + 1) *
+                                   (sizeof(bplib_mpool_bblock_primary_t) + cpb->bundle_encode_size_cache) / 2);
+    }
+    bplib_mpool_recycle_block(pblk);
+}
+
+void tiered_test_under_budget(void)
+{
+    bp_sid_t sid[TIERED_TEST_IN_MEMORY];
+    uint32_t i;
+
+    tiered_test_start_blank(tiered_test_budget);
+
+    for (i = 0; i < TIERED_TEST_IN_MEMORY; ++i)
+    {
+        sid[i] = offload_test_offload(100 + i);
+        UtAssert_NONZERO(sid[i]);
+    }
+
+    /* all of them fit, so the lower tier has not been asked for anything */
+    for (i = 0; i < TIERED_TEST_IN_MEMORY; ++i)
+    {
+        UtAssert_True(offload_test_check(sid[i], 100 + i), "sid %lu restored", (unsigned long)sid[i]);
+    }
+    tiered_test_check_lower(0, 0, 0);
+
+    /* and one released while it is only in memory never goes there */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[0]), BP_SUCCESS);
+    UtAssert_BOOL_FALSE(offload_test_check(sid[0], 100));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[1], 101));
+    tiered_test_check_lower(0, 0, 0);
+}
+
+void tiered_test_over_budget(void)
+{
+    bp_sid_t sid[5];
+    uint32_t i;
+
+    tiered_test_start_blank(tiered_test_budget);
+
+    /* the two least recently used go down to make room for the last two */
+    for (i = 0; i < 5; ++i)
+    {
+        sid[i] = offload_test_offload(100 + i);
+        UtAssert_NONZERO(sid[i]);
+    }
+    tiered_test_check_lower(2, 0, 0);
+
+    /* in memory now is 4, 3 and 2, most recently used first, and restoring one of them is from memory */
+    UtAssert_BOOL_TRUE(offload_test_check(sid[2], 102));
+    tiered_test_check_lower(2, 0, 0);
+
+    /* 0 comes back from the lower tier into memory, which moves 3, least recently used now, down */
+    UtAssert_BOOL_TRUE(offload_test_check(sid[0], 100));
+    tiered_test_check_lower(3, 1, 0);
+    UtAssert_BOOL_TRUE(offload_test_check(sid[0], 100));
+    tiered_test_check_lower(3, 1, 0);
+
+    /* and so does 1, which moves 4 down, leaving 2 as the only one that was never written there */
+    UtAssert_BOOL_TRUE(offload_test_check(sid[1], 101));
+    tiered_test_check_lower(4, 2, 0);
+
+    /* one only in memory is released there alone, one with a copy in the lower tier is released there too */
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[2]), BP_SUCCESS);
+    tiered_test_check_lower(4, 2, 0);
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[0]), BP_SUCCESS);
+    tiered_test_check_lower(4, 2, 1);
+    UtAssert_BOOL_FALSE(offload_test_check(sid[0], 100));
+    UtAssert_BOOL_FALSE(offload_test_check(sid[2], 102));
+
+    /* the ones moved down are all still there */
+    UtAssert_BOOL_TRUE(offload_test_check(sid[3], 103));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[4], 104));
+    tiered_test_check_lower(4, 4, 1);
+
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[1]), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[3]), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[4]), BP_SUCCESS);
+    tiered_test_check_lower(4, 4, 4);
+}
+
+void tiered_test_no_budget(void)
+{
+    bp_sid_t sid;
+    uint32_t offloads;
+
+    tiered_test_start_blank(0);
+
+    /* every bundle goes straight down, and is not brought back into memory */
+    sid = offload_test_offload(100);
+    UtAssert_NONZERO(sid);
+    tiered_test_check_lower(1, 0, 0);
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 100));
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 100));
+    tiered_test_check_lower(1, 2, 0);
+
+    /* one that cannot be written down is not taken, as it would only be in memory */
+    tiered_test_lower.fail_offload = true;
+    UtAssert_ZERO(offload_test_offload(101));
+    UtAssert_UINT32_EQ(tiered_test_lower.offloads, 2);
+    tiered_test_lower.fail_offload = false;
+
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 100));
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid), BP_SUCCESS);
+    tiered_test_check_lower(2, 3, 1);
+
+    /* nor is one that the budget cannot be kept with, because an older one cannot be moved down */
+    tiered_test_start_blank(tiered_test_budget / TIERED_TEST_IN_MEMORY);
+    sid = offload_test_offload(102);
+    UtAssert_NONZERO(sid);
+    tiered_test_check_lower(0, 0, 0);
+
+    tiered_test_lower.fail_offload = true;
+    UtAssert_ZERO(offload_test_offload(103));
+    offloads = tiered_test_lower.offloads;
+    UtAssert_NONZERO(offloads);
+    tiered_test_lower.fail_offload = false;
+
+    /* the older one is still held in memory, and the next offload moves it down */
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 102));
+    UtAssert_NONZERO(offload_test_offload(104));
+    UtAssert_UINT32_EQ(tiered_test_lower.offloads, offloads + 1);
+    UtAssert_BOOL_TRUE(offload_test_check(sid, 102));
+}
+
+void tiered_test_flush_and_stop(void)
+{
+    bp_sid_t sid[4];
+    uint32_t held_seq[3];
+
+    tiered_test_start_blank(tiered_test_budget);
+
+    sid[0] = offload_test_offload(100);
+    sid[1] = offload_test_offload(101);
+    tiered_test_check_lower(0, 0, 0);
+
+    /* a flush writes down what is only in memory, which stays there as well */
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+    tiered_test_check_lower(2, 0, 0);
+    UtAssert_UINT32_EQ(tiered_test_lower.flushes, 1);
+    UtAssert_BOOL_TRUE(offload_test_check(sid[0], 100));
+    UtAssert_BOOL_TRUE(offload_test_check(sid[1], 101));
+    tiered_test_check_lower(2, 0, 0);
+
+    /* and a second flush has nothing more to write */
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_SUCCESS);
+    tiered_test_check_lower(2, 0, 0);
+
+    /* one that cannot be written down fails the flush, and is still held in memory */
+    sid[2] = offload_test_offload(102);
+    sid[3] = offload_test_offload(103);
+    tiered_test_lower.fail_offload = true;
+    UtAssert_INT32_EQ(offload_test.api->flush(offload_test.svc), BP_ERROR);
+    tiered_test_check_lower(4, 0, 0);
+    UtAssert_UINT32_EQ(tiered_test_lower.flushes, 2);
+    tiered_test_lower.fail_offload = false;
+    UtAssert_BOOL_TRUE(offload_test_check(sid[2], 102));
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[1]), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->release(offload_test.svc, sid[3]), BP_SUCCESS);
+    tiered_test_check_lower(4, 0, 1);
+
+    /* a stop writes down the one only in memory, so the next start has everything still held */
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_UINT32_EQ(tiered_test_lower.offloads, 5);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+
+    held_seq[0] = 100;
+    held_seq[1] = 102;
+    tiered_test_check_recovered(held_seq, 2);
+    UtAssert_UINT32_EQ(tiered_test_lower.restores, 2);
+
+    /* the recovered ones are held like any other, and a new one is held with them through the next restart */
+    held_seq[2] = 104;
+    UtAssert_NONZERO(offload_test_offload(104));
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    UtAssert_INT32_EQ(offload_test.api->std.start(offload_test.svc), BP_SUCCESS);
+    tiered_test_check_recovered(held_seq, 3);
+
+    UtAssert_INT32_EQ(offload_test.api->std.stop(offload_test.svc), BP_SUCCESS);
+    nftw(tiered_test_dir, tiered_test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void UtTest_Setup(void)
+{
+    UtTest_Add(tiered_test_under_budget, tiered_test_setup, NULL, "under budget");
+    UtTest_Add(tiered_test_over_budget, tiered_test_setup, NULL, "over budget");
+    UtTest_Add(tiered_test_no_budget, tiered_test_setup, NULL, "no budget");
+    UtTest_Add(tiered_test_flush_and_stop, tiered_test_setup, NULL, "flush and stop");
+}
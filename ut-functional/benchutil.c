@@ -0,0 +1,106 @@
+/************************************************************************
+ *
+ *  Helpers shared by the functional tests and benchmarks
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "utassert.h"
+
+#include "bplib.h"
+#include "benchutil.h"
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* There is no OSAL implementation of bplib_os_log, so it is provided here the same as in the sanity test */
+int bplib_os_log(const char *file, unsigned int line, uint32_t *flags, uint32_t event, const char *fmt, ...)
+{
+    va_list va;
+    char    bpmsg[128];
+
+    va_start(va, fmt);
+    vsnprintf(bpmsg, sizeof(bpmsg), fmt, va);
+    va_end(va);
+
+    UtAssert_Message(UTASSERT_CASETYPE_INFO, file, line, "BP: %s", bpmsg);
+    return BP_SUCCESS;
+}
+
+uint64_t bench_get_time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+const char *bench_getenv(const char *name, const char *default_val)
+{
+    const char *val;
+
+    val = getenv(name);
+    if (val == NULL || *val == 0)
+    {
+        val = default_val;
+    }
+
+    return val;
+}
+
+unsigned long bench_getenv_num(const char *name, unsigned long default_val)
+{
+    const char   *str;
+    char         *end;
+    unsigned long val;
+
+    str = bench_getenv(name, "");
+    val = strtoul(str, &end, 0);
+    if (end == str)
+    {
+        val = default_val;
+    }
+
+    return val;
+}
+
+uint32_t bench_parse_list(const char *str, unsigned long *list, uint32_t max_count, unsigned long min_val,
+                          unsigned long max_val)
+{
+    char         *end;
+    unsigned long val;
+    uint32_t      count;
+
+    count = 0;
+    while (*str != 0 && count < max_count)
+    {
+        val = strtoul(str, &end, 0);
+        if (end == str)
+        {
+            ++str;
+        }
+        else
+        {
+            if (val >= min_val && val <= max_val)
+            {
+                list[count] = val;
+                ++count;
+            }
+            str = end;
+        }
+    }
+
+    return count;
+}
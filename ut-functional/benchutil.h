@@ -0,0 +1,46 @@
+/************************************************************************
+ *
+ *  Helpers shared by the functional tests and benchmarks
+ *
+ *  Each benchmark is set up from the environment, times what it runs
+ *  with the monotonic clock, and logs through UT assert, so these are
+ *  kept here rather than in every one of them.
+ *
+ *************************************************************************/
+
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+
+/*************************************************************************
+ * Prototypes
+ *************************************************************************/
+
+/*
+ * Returns a monotonic time in nanoseconds, for measuring intervals
+ */
+uint64_t bench_get_time_ns(void);
+
+/*
+ * Returns the value of an environment variable, or default_val if it is not set or is empty
+ */
+const char *bench_getenv(const char *name, const char *default_val);
+
+/*
+ * Returns the number in an environment variable, or default_val if it is not set or is not a number
+ */
+unsigned long bench_getenv_num(const char *name, unsigned long default_val);
+
+/*
+ * Reads a list of numbers with any separator, leaving out any outside min_val..max_val,
+ * returns how many were read
+ */
+uint32_t bench_parse_list(const char *str, unsigned long *list, uint32_t max_count, unsigned long min_val,
+                          unsigned long max_val);
+
+#endif /* BENCHUTIL_H */
@@ -0,0 +1,493 @@
+/************************************************************************
+ *
+ *  Benchmark of the routing table as it grows
+ *
+ *  A table is given every number of routes from a list, spread over
+ *  every number of interfaces from another list, and at each size the
+ *  cost of the calls that depend on it is measured:
+ *
+ *    - bplib_route_get_next_avail_intf(), both for a few destinations
+ *      over and over, which the route cache answers, and for random
+ *      ones out of all of the routes, which mostly have to be searched
+ *    - bplib_route_add() and bplib_route_del() of one more route
+ *    - bplib_route_replace_all() of the whole set
+ *    - bplib_route_ingress_route_single_bundle(), with the bundles
+ *      taken off the interface queues again after every batch
+ *
+ *  Seven in eight routes are to one node, and the rest are to a block of
+ *  256 nodes, so the longest prefix match has two levels to go through.
+ *  The interfaces are generic flows which are never run, so the numbers
+ *  are of the table alone.  Every lookup is checked against the route it
+ *  should have found, and every bundle has to come out of an interface.
+ *
+ *  It is set up from the environment, which the defaults are shown for:
+ *
+ *    ROUTE_BENCH_ROUTES   10,100,1000,10000,100000   numbers of routes
+ *    ROUTE_BENCH_INTFS    2,10,100,1000              numbers of interfaces
+ *    ROUTE_BENCH_LOOKUPS  200000                     lookups for each measurement
+ *    ROUTE_BENCH_UPDATES  100                        routes added and deleted at each size
+ *    ROUTE_BENCH_BUNDLES  100000                     bundles routed at each size
+ *
+ *************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+#include "v7.h"
+#include "v7_mpool.h"
+#include "v7_mpool_bblocks.h"
+#include "v7_mpool_flows.h"
+#include "benchutil.h"
+
+/* limits of what can be asked for */
+#define ROUTE_BENCH_MAX_ROUTES 1000000
+#define ROUTE_BENCH_MAX_INTFS  4096
+#define ROUTE_BENCH_MAX_VALUES 8
+
+/* bundles routed at once, before they are taken off the interfaces again */
+#define ROUTE_BENCH_BATCH 64
+
+/* the destinations looked up over and over, which is less than the route cache holds */
+#define ROUTE_BENCH_HOT_DESTS 16
+
+/* the single node routes start here, and the blocks of 256 nodes start at the second one */
+#define ROUTE_BENCH_NODE_BASE  0x1000000
+#define ROUTE_BENCH_BLOCK_BASE 0x100000000
+
+#define ROUTE_BENCH_NODE_MASK  (~(bp_ipn_t)0)
+#define ROUTE_BENCH_BLOCK_MASK (~(bp_ipn_t)0xFF)
+
+#define ROUTE_BENCH_CACHE_MEM (8 * 1024 * 1024)
+
+/* the magic number of the interface flows */
+#define ROUTE_BENCH_FLOW_MAGIC 0x7a0be4c1
+
+typedef struct route_bench_config
+{
+    unsigned long routes[ROUTE_BENCH_MAX_VALUES];
+    unsigned long intfs[ROUTE_BENCH_MAX_VALUES];
+    uint32_t      num_routes;
+    uint32_t      num_intfs;
+    uint32_t      lookups;
+    uint32_t      updates;
+    uint32_t      bundles;
+} route_bench_config_t;
+
+/* a destination that one of the routes covers, and where it goes */
+typedef struct route_bench_dest
+{
+    bp_ipn_t    dest;
+    bp_handle_t intf_id;
+} route_bench_dest_t;
+
+typedef struct route_bench_intf
+{
+    bplib_mpool_block_t *fblk;
+    bplib_mpool_flow_t  *flow;
+    bp_handle_t          intf_id;
+} route_bench_intf_t;
+
+static route_bench_config_t route_bench_config;
+static bplib_routetbl_t    *route_bench_rtbl;
+static route_bench_intf_t   route_bench_intfs[ROUTE_BENCH_MAX_INTFS];
+static uint32_t             route_bench_num_intfs; /* the number made, which is the most that is asked for */
+static bplib_route_spec_t  *route_bench_routes;
+static route_bench_dest_t  *route_bench_dests;
+static bplib_mpool_block_t *route_bench_bundles[ROUTE_BENCH_BATCH];
+static uint32_t             route_bench_rng;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* fixed pseudo-random numbers, so runs are comparable */
+static uint32_t route_bench_random(void)
+{
+    route_bench_rng ^= route_bench_rng << 13;
+    route_bench_rng ^= route_bench_rng >> 17;
+    route_bench_rng ^= route_bench_rng << 5;
+    return route_bench_rng;
+}
+
+static unsigned long route_bench_max_of(const unsigned long *list, uint32_t count)
+{
+    unsigned long max_val;
+    uint32_t      i;
+
+    max_val = 0;
+    for (i = 0; i < count; ++i)
+    {
+        if (list[i] > max_val)
+        {
+            max_val = list[i];
+        }
+    }
+
+    return max_val;
+}
+
+static void route_bench_report(const char *test, uint32_t routes, uint32_t intfs, uint64_t count,
+                               uint64_t elapsed_ns)
+{
+    if (elapsed_ns == 0)
+    {
+        elapsed_ns = 1;
+    }
+
+    UtPrintf("%-14s routes %7lu intfs %5lu: %12.1f ops/s %10.1f ns/op", test, (unsigned long)routes,
+             (unsigned long)intfs, ((double)count * 1e9) / (double)elapsed_ns, (double)elapsed_ns / (double)count);
+}
+
+/* The interfaces have nothing to do when they go up or down */
+static int route_bench_event(void *arg, bplib_mpool_block_t *jblk)
+{
+    return BP_SUCCESS;
+}
+
+/* Makes the routes for one size, and the destinations that go with them, see above */
+static void route_bench_make_routes(uint32_t routes, uint32_t intfs)
+{
+    bplib_route_spec_t *rp;
+    route_bench_dest_t *dp;
+    uint32_t            i;
+
+    for (i = 0; i < routes; ++i)
+    {
+        rp          = &route_bench_routes[i];
+        dp          = &route_bench_dests[i];
+        rp->intf_id = route_bench_intfs[i % intfs].intf_id;
+        rp->flags   = 0;
+
+        if ((i % 8) == 7)
+        {
+            rp->dest = ROUTE_BENCH_BLOCK_BASE + ((bp_ipn_t)i << 8);
+            rp->mask = ROUTE_BENCH_BLOCK_MASK;
+
+            /* any node in the block will do */
+            dp->dest = rp->dest + (i % 251);
+        }
+        else
+        {
+            rp->dest = ROUTE_BENCH_NODE_BASE + i;
+            rp->mask = ROUTE_BENCH_NODE_MASK;
+            dp->dest = rp->dest;
+        }
+
+        dp->intf_id = rp->intf_id;
+    }
+}
+
+/* Takes everything off the interfaces again, returns how many bundles there were */
+static uint32_t route_bench_drain(uint32_t intfs)
+{
+    bplib_mpool_block_t *qblk;
+    uint32_t             count;
+    uint32_t             i;
+
+    count = 0;
+    for (i = 0; i < intfs; ++i)
+    {
+        while ((qblk = bplib_mpool_flow_try_pull(&route_bench_intfs[i].flow->egress, 0)) != NULL)
+        {
+            if (count < ROUTE_BENCH_BATCH)
+            {
+                route_bench_bundles[count] = qblk;
+            }
+            else
+            {
+                bplib_mpool_recycle_block(qblk);
+            }
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+static void route_bench_run_one(uint32_t routes, uint32_t intfs)
+{
+    bplib_mpool_bblock_primary_t *pri_block;
+    bp_ipn_addr_t                 addr;
+    uint64_t                      start_time;
+    uint64_t                      add_ns;
+    uint64_t                      del_ns;
+    uint64_t                      elapsed_ns;
+    uint32_t                      errors;
+    uint32_t                      done;
+    uint32_t                      count;
+    uint32_t                      i;
+    uint32_t                      d;
+    bp_handle_t                   intf_id;
+    bp_ipn_t                      dest;
+
+    route_bench_rng = 0x9E3779B9 ^ routes ^ (intfs << 20);
+    route_bench_make_routes(routes, intfs);
+
+    start_time = bench_get_time_ns();
+    UtAssert_INT32_EQ(bplib_route_replace_all(route_bench_rtbl, route_bench_routes, routes), 0);
+    route_bench_report("replace_all", routes, intfs, 1, bench_get_time_ns() - start_time);
+
+    /* a few destinations over and over, which stay in the route cache */
+    errors     = 0;
+    start_time = bench_get_time_ns();
+    for (i = 0; i < route_bench_config.lookups; ++i)
+    {
+        d       = i % ROUTE_BENCH_HOT_DESTS % routes;
+        intf_id = bplib_route_get_next_avail_intf(route_bench_rtbl, route_bench_dests[d].dest);
+        if (!bp_handle_equal(intf_id, route_bench_dests[d].intf_id))
+        {
+            ++errors;
+        }
+    }
+    elapsed_ns = bench_get_time_ns() - start_time;
+    UtAssert_True(errors == 0, "lookup/hot %lu/%lu: %lu went to the wrong interface", (unsigned long)routes,
+                  (unsigned long)intfs, (unsigned long)errors);
+    route_bench_report("lookup/hot", routes, intfs, route_bench_config.lookups, elapsed_ns);
+
+    /* any of the destinations, so the cache rarely has the answer when there are many */
+    errors     = 0;
+    start_time = bench_get_time_ns();
+    for (i = 0; i < route_bench_config.lookups; ++i)
+    {
+        d       = route_bench_random() % routes;
+        intf_id = bplib_route_get_next_avail_intf(route_bench_rtbl, route_bench_dests[d].dest);
+        if (!bp_handle_equal(intf_id, route_bench_dests[d].intf_id))
+        {
+            ++errors;
+        }
+    }
+    elapsed_ns = bench_get_time_ns() - start_time;
+    UtAssert_True(errors == 0, "lookup/random %lu/%lu: %lu went to the wrong interface", (unsigned long)routes,
+                  (unsigned long)intfs, (unsigned long)errors);
+    route_bench_report("lookup/random", routes, intfs, route_bench_config.lookups, elapsed_ns);
+
+    /*
+     * One more route to a node that already has one, through another interface, so it goes in among the
+     * others rather than at the end.  Each change copies the route set, so this is where its size shows.
+     */
+    errors = 0;
+    add_ns = 0;
+    del_ns = 0;
+    for (i = 0; i < route_bench_config.updates; ++i)
+    {
+        d       = route_bench_random() % routes;
+        dest    = ROUTE_BENCH_NODE_BASE + d;
+        intf_id = route_bench_intfs[(d + 1) % intfs].intf_id;
+
+        start_time = bench_get_time_ns();
+        if (bplib_route_add(route_bench_rtbl, dest, ROUTE_BENCH_NODE_MASK, intf_id) != 0)
+        {
+            ++errors;
+        }
+        add_ns += bench_get_time_ns() - start_time;
+
+        start_time = bench_get_time_ns();
+        if (bplib_route_del(route_bench_rtbl, dest, ROUTE_BENCH_NODE_MASK, intf_id) != 0)
+        {
+            ++errors;
+        }
+        del_ns += bench_get_time_ns() - start_time;
+    }
+    UtAssert_True(errors == 0, "update %lu/%lu: %lu adds or deletes failed", (unsigned long)routes,
+                  (unsigned long)intfs, (unsigned long)errors);
+    route_bench_report("add", routes, intfs, route_bench_config.updates, add_ns);
+    route_bench_report("del", routes, intfs, route_bench_config.updates, del_ns);
+
+    /* whole bundles, which also decodes the addresses and queues each one on its interface */
+    errors     = 0;
+    elapsed_ns = 0;
+    for (done = 0; done < route_bench_config.bundles; done += ROUTE_BENCH_BATCH)
+    {
+        for (i = 0; i < ROUTE_BENCH_BATCH; ++i)
+        {
+            pri_block = bplib_mpool_bblock_primary_cast(route_bench_bundles[i]);
+            addr      = (bp_ipn_addr_t) {route_bench_dests[route_bench_random() % routes].dest, 1};
+            v7_set_eid(&bplib_mpool_bblock_primary_get_logical(pri_block)->destinationEID, &addr);
+        }
+
+        start_time = bench_get_time_ns();
+        for (i = 0; i < ROUTE_BENCH_BATCH; ++i)
+        {
+            bplib_route_ingress_route_single_bundle(route_bench_rtbl, route_bench_bundles[i]);
+        }
+        elapsed_ns += bench_get_time_ns() - start_time;
+
+        count = route_bench_drain(intfs);
+        if (count != ROUTE_BENCH_BATCH)
+        {
+            /* a bundle that was not routed was recycled, so there is nothing more to route */
+            ++errors;
+            break;
+        }
+    }
+    UtAssert_True(errors == 0, "route %lu/%lu: every bundle came out of an interface", (unsigned long)routes,
+                  (unsigned long)intfs);
+    if (errors == 0)
+    {
+        route_bench_report("route_bundle", routes, intfs, done, elapsed_ns);
+    }
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void route_bench_setup(void)
+{
+    static const bplib_mpool_blocktype_api_t flow_api = {.construct = NULL, .destruct = NULL};
+
+    bplib_mpool_t      *pool;
+    bp_ipn_addr_t       addr;
+    route_bench_intf_t *intf;
+    unsigned long       max_routes;
+    uint32_t            i;
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+
+    route_bench_config.num_routes =
+        bench_parse_list(bench_getenv("ROUTE_BENCH_ROUTES", "10,100,1000,10000,100000"), route_bench_config.routes,
+                         ROUTE_BENCH_MAX_VALUES, 1, ROUTE_BENCH_MAX_ROUTES);
+    route_bench_config.num_intfs =
+        bench_parse_list(bench_getenv("ROUTE_BENCH_INTFS", "2,10,100,1000"), route_bench_config.intfs,
+                         ROUTE_BENCH_MAX_VALUES, 1, ROUTE_BENCH_MAX_INTFS);
+    route_bench_config.lookups = bench_getenv_num("ROUTE_BENCH_LOOKUPS", 200000);
+    route_bench_config.updates = bench_getenv_num("ROUTE_BENCH_UPDATES", 100);
+    route_bench_config.bundles = bench_getenv_num("ROUTE_BENCH_BUNDLES", 100000);
+    UtAssert_True(route_bench_config.num_routes > 0, "numbers of routes given");
+    UtAssert_True(route_bench_config.num_intfs > 0, "numbers of interfaces given");
+
+    /* the table is made for the most routes, with room for the one that is added and deleted */
+    max_routes         = route_bench_max_of(route_bench_config.routes, route_bench_config.num_routes);
+    route_bench_routes = malloc(sizeof(*route_bench_routes) * (max_routes + 1));
+    route_bench_dests  = malloc(sizeof(*route_bench_dests) * (max_routes + 1));
+    UtAssert_NOT_NULL(route_bench_routes);
+    UtAssert_NOT_NULL(route_bench_dests);
+    UtAssert_NOT_NULL(route_bench_rtbl = bplib_route_alloc_table(max_routes + 1, ROUTE_BENCH_CACHE_MEM));
+    if (route_bench_routes == NULL || route_bench_dests == NULL || route_bench_rtbl == NULL)
+    {
+        return;
+    }
+
+    pool = bplib_route_get_mpool(route_bench_rtbl);
+    UtAssert_INT32_EQ(bplib_mpool_register_blocktype(pool, ROUTE_BENCH_FLOW_MAGIC, &flow_api, 0), BP_SUCCESS);
+
+    /* the interfaces for the largest number are all made now, each size routes over the first ones */
+    route_bench_num_intfs = route_bench_max_of(route_bench_config.intfs, route_bench_config.num_intfs);
+    for (i = 0; i < route_bench_num_intfs; ++i)
+    {
+        intf       = &route_bench_intfs[i];
+        intf->fblk = bplib_mpool_flow_alloc(pool, ROUTE_BENCH_FLOW_MAGIC, NULL);
+        intf->flow = bplib_mpool_flow_cast(intf->fblk);
+        if (intf->flow == NULL)
+        {
+            UtAssert_Failed("Could not make interface %lu", (unsigned long)i);
+            route_bench_num_intfs = i;
+            break;
+        }
+
+        intf->intf_id = bplib_route_register_generic_intf(route_bench_rtbl, BP_INVALID_HANDLE, intf->fblk);
+        UtAssert_BOOL_TRUE(bp_handle_is_valid(intf->intf_id));
+        bplib_route_register_event_handler(route_bench_rtbl, intf->intf_id, route_bench_event);
+        bplib_mpool_flow_enable(&intf->flow->egress, ROUTE_BENCH_BATCH);
+        bplib_route_intf_set_flags(route_bench_rtbl, intf->intf_id,
+                                   BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+    }
+
+    /* the flag changes only take effect when the flows are run */
+    bplib_route_periodic_maintenance(route_bench_rtbl);
+
+    addr = (bp_ipn_addr_t) {ROUTE_BENCH_NODE_BASE - 1, 1};
+    for (i = 0; i < ROUTE_BENCH_BATCH; ++i)
+    {
+        route_bench_bundles[i] = bplib_mpool_bblock_primary_alloc(pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+        if (!UtAssert_NOT_NULL(route_bench_bundles[i]))
+        {
+            UtAssert_Abort("bplib_mpool_bblock_primary_alloc() failed");
+        }
+        v7_set_eid(&bplib_mpool_bblock_primary_get_logical(bplib_mpool_bblock_primary_cast(route_bench_bundles[i]))
+                        ->sourceEID,
+                   &addr);
+    }
+}
+
+void route_bench_teardown(void)
+{
+    uint32_t i;
+
+    if (route_bench_rtbl != NULL)
+    {
+        for (i = 0; i < ROUTE_BENCH_BATCH; ++i)
+        {
+            if (route_bench_bundles[i] != NULL)
+            {
+                bplib_mpool_recycle_block(route_bench_bundles[i]);
+                route_bench_bundles[i] = NULL;
+            }
+        }
+
+        for (i = 0; i < route_bench_num_intfs; ++i)
+        {
+            bplib_route_del_intf(route_bench_rtbl, route_bench_intfs[i].intf_id);
+        }
+        bplib_route_periodic_maintenance(route_bench_rtbl);
+
+        /* all of the memory of the table is in the one allocation */
+        bplib_os_free(route_bench_rtbl);
+        route_bench_rtbl = NULL;
+    }
+
+    free(route_bench_routes);
+    free(route_bench_dests);
+    route_bench_routes = NULL;
+    route_bench_dests  = NULL;
+}
+
+void route_bench_run(void)
+{
+    uint32_t r;
+    uint32_t n;
+
+    if (route_bench_rtbl == NULL || route_bench_num_intfs == 0)
+    {
+        return;
+    }
+
+    for (n = 0; n < route_bench_config.num_intfs; ++n)
+    {
+        if (route_bench_config.intfs[n] > route_bench_num_intfs)
+        {
+            continue;
+        }
+
+        for (r = 0; r < route_bench_config.num_routes; ++r)
+        {
+            route_bench_run_one(route_bench_config.routes[r], route_bench_config.intfs[n]);
+        }
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(route_bench_run, route_bench_setup, route_bench_teardown, "routing");
+}
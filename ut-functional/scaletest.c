@@ -0,0 +1,715 @@
+/************************************************************************
+ *
+ *  Scaling test of one routing table under many sockets and threads
+ *
+ *  N sockets on node 100 send to node 200, which is reached through M
+ *  CLA interfaces as one multipath route, so the flows are spread over
+ *  all of them.  Each CLA is a loopback: what comes out of it is counted
+ *  and dropped, and bundles addressed back to the sockets are put in
+ *  through it at the same time, so both directions are busy at once.
+ *  K threads share the sockets and CLAs between them, and each one also
+ *  runs the active flows of the table, alongside the usual maintenance
+ *  thread.
+ *
+ *  Every (N, M, K) combination is run for the same time on the same
+ *  table, with the unused CLAs set down.  The bundles per second each
+ *  way are printed, with the pool lock acquisitions per bundle and how
+ *  many of those had to wait, by wait time.  That is where the cost of
+ *  the shared locks and the single maintenance thread shows up as the
+ *  numbers grow.
+ *
+ *  It is set up from the environment, which the defaults are shown for:
+ *
+ *    SCALE_TEST_SOCKETS   1,4,16   values of N
+ *    SCALE_TEST_CLAS      1,4      values of M
+ *    SCALE_TEST_THREADS   1,2,4    values of K
+ *    SCALE_TEST_SECONDS   2        time each combination is run
+ *    SCALE_TEST_SIZE      256      payload size of every bundle
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_routing.h"
+#include "v7_mpool.h"
+#include "benchutil.h"
+
+/* limits of what can be asked for */
+#define SCALE_TEST_MAX_SOCKETS 64
+#define SCALE_TEST_MAX_CLAS    16
+#define SCALE_TEST_MAX_THREADS 16
+#define SCALE_TEST_MAX_VALUES  8
+#define SCALE_TEST_MAX_PAYLOAD 16384
+
+/* room for the blocks around the payload, once encoded */
+#define SCALE_TEST_WIRE_SIZE (SCALE_TEST_MAX_PAYLOAD + 512)
+
+/* the most moved by one call, in either direction */
+#define SCALE_TEST_BURST 16
+
+/* how long after the sending stops for what is still queued to come out */
+#define SCALE_TEST_DRAIN_MSEC 2000
+
+#define SCALE_TEST_CACHE_MEM (32 * 1024 * 1024)
+
+#define SCALE_TEST_LOCAL_NODE  100
+#define SCALE_TEST_REMOTE_NODE 200
+
+typedef struct scale_test_config
+{
+    unsigned long sockets[SCALE_TEST_MAX_VALUES];
+    unsigned long clas[SCALE_TEST_MAX_VALUES];
+    unsigned long threads[SCALE_TEST_MAX_VALUES];
+    uint32_t      num_sockets;
+    uint32_t      num_clas;
+    uint32_t      num_threads;
+    uint32_t      seconds;
+    size_t        size;
+} scale_test_config_t;
+
+typedef struct scale_test_counts
+{
+    uint64_t sent;            /* accepted by bplib_send() */
+    uint64_t send_blocked;    /* bplib_send() timed out, the socket was full */
+    uint64_t egressed;        /* came out of a CLA */
+    uint64_t ingressed;       /* accepted by bplib_cla_ingress_batch() */
+    uint64_t ingress_blocked; /* not accepted, the CLA queue was full */
+    uint64_t received;        /* came out of bplib_recv() */
+    uint64_t errors;          /* any other result, or a bundle of the wrong size */
+} scale_test_counts_t;
+
+typedef struct scale_test_thread
+{
+    bplib_os_thread_t *thread;
+    uint32_t           index;
+
+    scale_test_counts_t counts;
+    scale_test_counts_t window; /* the counts when the sending stopped */
+    bool                window_taken;
+
+    uint8_t               *payload;
+    uint8_t               *egress_mem;
+    bplib_cla_egress_buf_t egress_bufs[SCALE_TEST_BURST];
+} scale_test_thread_t;
+
+/* what is put in through each CLA, in turn */
+typedef struct scale_test_cla
+{
+    bp_handle_t            intf_id;
+    bplib_cla_bundle_buf_t bundles[SCALE_TEST_BURST];
+    int                    status_list[SCALE_TEST_BURST];
+} scale_test_cla_t;
+
+/* a bundle from remote service i to local service i, as it would come in from a CLA */
+typedef struct scale_test_template
+{
+    uint8_t *data;
+    size_t   size;
+} scale_test_template_t;
+
+static scale_test_config_t   scale_test_config;
+static bplib_routetbl_t     *scale_test_rtbl;
+static bp_socket_t          *scale_test_sockets[SCALE_TEST_MAX_SOCKETS];
+static scale_test_cla_t      scale_test_clas[SCALE_TEST_MAX_CLAS];
+static scale_test_template_t scale_test_templates[SCALE_TEST_MAX_SOCKETS];
+static scale_test_thread_t   scale_test_threads[SCALE_TEST_MAX_THREADS];
+static bplib_os_thread_t    *scale_test_maint_thread;
+static uint8_t               scale_test_payload[SCALE_TEST_MAX_PAYLOAD];
+
+/* the combination being run */
+static uint32_t scale_test_n;
+static uint32_t scale_test_m;
+static uint32_t scale_test_k;
+
+static volatile bool scale_test_running;
+static volatile bool scale_test_sending;
+static volatile bool scale_test_maint_running;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static uint32_t scale_test_getenv_list(const char *name, const char *default_val, unsigned long *list,
+                                       unsigned long max_val)
+{
+    uint32_t count;
+
+    count = bench_parse_list(bench_getenv(name, default_val), list, SCALE_TEST_MAX_VALUES, 1, max_val);
+    if (count == 0)
+    {
+        count = bench_parse_list(default_val, list, SCALE_TEST_MAX_VALUES, 1, max_val);
+    }
+
+    return count;
+}
+
+static void scale_test_add_counts(scale_test_counts_t *total, const scale_test_counts_t *counts)
+{
+    total->sent += counts->sent;
+    total->send_blocked += counts->send_blocked;
+    total->egressed += counts->egressed;
+    total->ingressed += counts->ingressed;
+    total->ingress_blocked += counts->ingress_blocked;
+    total->received += counts->received;
+    total->errors += counts->errors;
+}
+
+static void scale_test_get_lock_stats(uint64_t *bins)
+{
+    uint32_t i;
+
+    for (i = 0; i < BPLIB_MPOOL_STAT_LOCK_WAIT_BINS; ++i)
+    {
+        bins[i] = bplib_mpool_query_stat(bplib_route_get_mpool(scale_test_rtbl), bplib_mpool_stat_lock_wait_count, i);
+    }
+}
+
+/*************************************************************************
+ * Threads
+ *************************************************************************/
+
+static void scale_test_maint_entry(void *arg)
+{
+    while (scale_test_maint_running)
+    {
+        bplib_route_maintenance_request_wait(scale_test_rtbl);
+        bplib_route_periodic_maintenance(scale_test_rtbl);
+    }
+}
+
+/* Sends one bundle and takes in what has arrived, returns true if anything moved */
+static bool scale_test_do_socket(scale_test_thread_t *t, bp_socket_t *desc)
+{
+    size_t   size;
+    uint32_t i;
+    bool     did_work;
+    int      status;
+
+    did_work = false;
+
+    if (scale_test_sending)
+    {
+        status = bplib_send(desc, scale_test_payload, scale_test_config.size, 0);
+        if (status == BP_SUCCESS)
+        {
+            ++t->counts.sent;
+            did_work = true;
+        }
+        else if (status == BP_TIMEOUT)
+        {
+            ++t->counts.send_blocked;
+        }
+        else
+        {
+            ++t->counts.errors;
+        }
+    }
+
+    for (i = 0; i < SCALE_TEST_BURST; ++i)
+    {
+        size   = SCALE_TEST_MAX_PAYLOAD;
+        status = bplib_recv(desc, t->payload, &size, 0);
+        if (status != BP_SUCCESS)
+        {
+            break;
+        }
+
+        ++t->counts.received;
+        if (size != scale_test_config.size)
+        {
+            ++t->counts.errors;
+        }
+        did_work = true;
+    }
+
+    return did_work;
+}
+
+/* Takes out what the CLA has to send and puts in a burst of bundles for the sockets, returns true if anything moved */
+static bool scale_test_do_cla(scale_test_thread_t *t, scale_test_cla_t *cla)
+{
+    uint32_t num_filled;
+    uint32_t i;
+    bool     did_work;
+
+    did_work = false;
+
+    for (i = 0; i < SCALE_TEST_BURST; ++i)
+    {
+        t->egress_bufs[i].bundle = &t->egress_mem[i * SCALE_TEST_WIRE_SIZE];
+        t->egress_bufs[i].size   = SCALE_TEST_WIRE_SIZE;
+    }
+
+    num_filled = 0;
+    if (bplib_cla_egress_batch(scale_test_rtbl, cla->intf_id, t->egress_bufs, SCALE_TEST_BURST, &num_filled, 0) ==
+        BP_SUCCESS)
+    {
+        t->counts.egressed += num_filled;
+        did_work = true;
+    }
+
+    if (scale_test_sending)
+    {
+        bplib_cla_ingress_batch(scale_test_rtbl, cla->intf_id, cla->bundles, SCALE_TEST_BURST, cla->status_list, 0);
+        for (i = 0; i < SCALE_TEST_BURST; ++i)
+        {
+            if (cla->status_list[i] == BP_SUCCESS)
+            {
+                ++t->counts.ingressed;
+                did_work = true;
+            }
+            else if (cla->status_list[i] == BP_TIMEOUT)
+            {
+                ++t->counts.ingress_blocked;
+            }
+            else
+            {
+                ++t->counts.errors;
+            }
+        }
+    }
+
+    return did_work;
+}
+
+static void scale_test_thread_entry(void *arg)
+{
+    scale_test_thread_t *t;
+    uint32_t             i;
+    bool                 did_work;
+
+    t = arg;
+
+    while (scale_test_running)
+    {
+        if (!scale_test_sending && !t->window_taken)
+        {
+            t->window       = t->counts;
+            t->window_taken = true;
+        }
+
+        /* thread k has every k'th socket and CLA */
+        did_work = false;
+        for (i = t->index; i < scale_test_n; i += scale_test_k)
+        {
+            did_work |= scale_test_do_socket(t, scale_test_sockets[i]);
+        }
+        for (i = t->index; i < scale_test_m; i += scale_test_k)
+        {
+            did_work |= scale_test_do_cla(t, &scale_test_clas[i]);
+        }
+
+        /* when idle it waits for the next request, the same as a flow worker would */
+        if (did_work)
+        {
+            bplib_route_process_active_flows(scale_test_rtbl);
+        }
+        else
+        {
+            bplib_route_worker_process_flows(scale_test_rtbl, 1);
+        }
+    }
+}
+
+/*************************************************************************
+ * Setup
+ *************************************************************************/
+
+/*
+ * The bundles coming back to the local sockets are made once, on a table of their own which
+ * has the remote node on it, and then put in through the CLAs over and over.
+ */
+static void scale_test_make_templates(void)
+{
+    bplib_routetbl_t *rtbl;
+    bp_socket_t      *desc;
+    bp_ipn_addr_t     addr;
+    bp_handle_t       node_intf;
+    bp_handle_t       cla_intf;
+    uint8_t          *buffer;
+    size_t            size;
+    uint32_t          i;
+    uint32_t          tries;
+    int               status;
+
+    buffer = malloc(SCALE_TEST_WIRE_SIZE);
+    UtAssert_NOT_NULL(buffer);
+    UtAssert_NOT_NULL(rtbl = bplib_route_alloc_table(16 + SCALE_TEST_MAX_SOCKETS, 1 << 22));
+    if (buffer == NULL || rtbl == NULL)
+    {
+        free(buffer);
+        return;
+    }
+
+    node_intf = bplib_create_node_intf(rtbl, SCALE_TEST_REMOTE_NODE);
+    cla_intf  = bplib_create_cla_intf(rtbl);
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(node_intf));
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(cla_intf));
+    UtAssert_INT32_EQ(bplib_route_add(rtbl, SCALE_TEST_LOCAL_NODE, ~(bp_ipn_t)0, cla_intf), BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_route_intf_set_flags(rtbl, node_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP),
+                      BP_SUCCESS);
+    UtAssert_INT32_EQ(bplib_route_intf_set_flags(rtbl, cla_intf, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP),
+                      BP_SUCCESS);
+
+    for (i = 0; i < SCALE_TEST_MAX_SOCKETS; ++i)
+    {
+        desc = bplib_create_socket(rtbl);
+        if (!UtAssert_NOT_NULL(desc))
+        {
+            break;
+        }
+
+        addr = (bp_ipn_addr_t) {SCALE_TEST_REMOTE_NODE, 1 + i};
+        UtAssert_INT32_EQ(bplib_bind_socket(desc, &addr), BP_SUCCESS);
+        addr = (bp_ipn_addr_t) {SCALE_TEST_LOCAL_NODE, 1 + i};
+        UtAssert_INT32_EQ(bplib_connect_socket(desc, &addr), BP_SUCCESS);
+        bplib_route_periodic_maintenance(rtbl);
+
+        UtAssert_INT32_EQ(bplib_send(desc, scale_test_payload, scale_test_config.size, BP_CHECK), BP_SUCCESS);
+
+        /* there is no maintenance thread on this table, so the flows are run here until it comes out */
+        size   = 0;
+        status = BP_TIMEOUT;
+        for (tries = 0; tries < 100 && status != BP_SUCCESS; ++tries)
+        {
+            bplib_route_periodic_maintenance(rtbl);
+            size   = SCALE_TEST_WIRE_SIZE;
+            status = bplib_cla_egress(rtbl, cla_intf, buffer, &size, BP_CHECK);
+        }
+
+        UtAssert_INT32_EQ(status, BP_SUCCESS);
+        if (status == BP_SUCCESS)
+        {
+            scale_test_templates[i].data = malloc(size);
+            if (UtAssert_NOT_NULL(scale_test_templates[i].data))
+            {
+                memcpy(scale_test_templates[i].data, buffer, size);
+                scale_test_templates[i].size = size;
+            }
+        }
+
+        bplib_close_socket(desc);
+        bplib_route_periodic_maintenance(rtbl);
+    }
+
+    /* this table is not used again, and all its memory is in the one allocation */
+    free(buffer);
+    bplib_os_free(rtbl);
+}
+
+void scale_test_setup(void)
+{
+    bp_ipn_addr_t addr;
+    bp_handle_t   node_intf;
+    uint32_t      i;
+
+    UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+    UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+
+    scale_test_config.num_sockets = scale_test_getenv_list("SCALE_TEST_SOCKETS", "1,4,16", scale_test_config.sockets,
+                                                           SCALE_TEST_MAX_SOCKETS);
+    scale_test_config.num_clas =
+        scale_test_getenv_list("SCALE_TEST_CLAS", "1,4", scale_test_config.clas, SCALE_TEST_MAX_CLAS);
+    scale_test_config.num_threads = scale_test_getenv_list("SCALE_TEST_THREADS", "1,2,4", scale_test_config.threads,
+                                                           SCALE_TEST_MAX_THREADS);
+    scale_test_config.seconds = bench_getenv_num("SCALE_TEST_SECONDS", 2);
+    scale_test_config.size    = bench_getenv_num("SCALE_TEST_SIZE", 256);
+    if (scale_test_config.seconds < 1)
+    {
+        scale_test_config.seconds = 1;
+    }
+    if (scale_test_config.size < 1 || scale_test_config.size > SCALE_TEST_MAX_PAYLOAD)
+    {
+        scale_test_config.size = 256;
+    }
+
+    for (i = 0; i < sizeof(scale_test_payload); ++i)
+    {
+        scale_test_payload[i] = (uint8_t)(i * 7);
+    }
+
+    scale_test_make_templates();
+
+    /* the sockets and CLAs for the largest combination are all made now, each run uses the first ones */
+    UtAssert_NOT_NULL(scale_test_rtbl = bplib_route_alloc_table(16 + SCALE_TEST_MAX_SOCKETS + SCALE_TEST_MAX_CLAS,
+                                                                SCALE_TEST_CACHE_MEM));
+    if (scale_test_rtbl == NULL)
+    {
+        return;
+    }
+
+    node_intf = bplib_create_node_intf(scale_test_rtbl, SCALE_TEST_LOCAL_NODE);
+    UtAssert_BOOL_TRUE(bp_handle_is_valid(node_intf));
+    UtAssert_INT32_EQ(bplib_route_intf_set_flags(scale_test_rtbl, node_intf,
+                                                 BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP),
+                      BP_SUCCESS);
+
+    for (i = 0; i < SCALE_TEST_MAX_CLAS; ++i)
+    {
+        scale_test_clas[i].intf_id = bplib_create_cla_intf(scale_test_rtbl);
+        UtAssert_BOOL_TRUE(bp_handle_is_valid(scale_test_clas[i].intf_id));
+        UtAssert_INT32_EQ(bplib_route_add_ext(scale_test_rtbl, SCALE_TEST_REMOTE_NODE, ~(bp_ipn_t)0,
+                                              scale_test_clas[i].intf_id, BPLIB_ROUTE_FLAG_MULTIPATH),
+                          BP_SUCCESS);
+    }
+
+    for (i = 0; i < SCALE_TEST_MAX_SOCKETS; ++i)
+    {
+        scale_test_sockets[i] = bplib_create_socket(scale_test_rtbl);
+        if (!UtAssert_NOT_NULL(scale_test_sockets[i]))
+        {
+            UtAssert_Abort("bplib_create_socket() failed");
+        }
+
+        addr = (bp_ipn_addr_t) {SCALE_TEST_LOCAL_NODE, 1 + i};
+        UtAssert_INT32_EQ(bplib_bind_socket(scale_test_sockets[i], &addr), BP_SUCCESS);
+        addr = (bp_ipn_addr_t) {SCALE_TEST_REMOTE_NODE, 1 + i};
+        UtAssert_INT32_EQ(bplib_connect_socket(scale_test_sockets[i], &addr), BP_SUCCESS);
+    }
+
+    scale_test_maint_running = true;
+    scale_test_maint_thread  = bplib_os_thread_create("scale_maint", scale_test_maint_entry, NULL);
+    UtAssert_NOT_NULL(scale_test_maint_thread);
+
+    for (i = 0; i < SCALE_TEST_MAX_THREADS; ++i)
+    {
+        scale_test_threads[i].index      = i;
+        scale_test_threads[i].payload    = malloc(SCALE_TEST_MAX_PAYLOAD);
+        scale_test_threads[i].egress_mem = malloc(SCALE_TEST_BURST * SCALE_TEST_WIRE_SIZE);
+        if (!UtAssert_NOT_NULL(scale_test_threads[i].payload) || !UtAssert_NOT_NULL(scale_test_threads[i].egress_mem))
+        {
+            UtAssert_Abort("malloc() failed");
+        }
+    }
+}
+
+void scale_test_teardown(void)
+{
+    uint32_t i;
+
+    if (scale_test_maint_thread != NULL)
+    {
+        scale_test_maint_running = false;
+        bplib_route_set_maintenance_request(scale_test_rtbl);
+        bplib_os_thread_join(scale_test_maint_thread);
+        scale_test_maint_thread = NULL;
+    }
+
+    for (i = 0; i < SCALE_TEST_MAX_SOCKETS; ++i)
+    {
+        if (scale_test_sockets[i] != NULL)
+        {
+            bplib_close_socket(scale_test_sockets[i]);
+            scale_test_sockets[i] = NULL;
+        }
+        free(scale_test_templates[i].data);
+        scale_test_templates[i].data = NULL;
+    }
+
+    for (i = 0; i < SCALE_TEST_MAX_THREADS; ++i)
+    {
+        free(scale_test_threads[i].payload);
+        free(scale_test_threads[i].egress_mem);
+        scale_test_threads[i].payload    = NULL;
+        scale_test_threads[i].egress_mem = NULL;
+    }
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+/* Sets the first m CLAs up and the rest down, and gives each its share of the bundles for the first n sockets */
+static void scale_test_prepare(uint32_t n, uint32_t m)
+{
+    scale_test_cla_t *cla;
+    uint32_t          num_own;
+    uint32_t          s;
+    uint32_t          c;
+    uint32_t          i;
+
+    for (c = 0; c < SCALE_TEST_MAX_CLAS; ++c)
+    {
+        cla = &scale_test_clas[c];
+        if (c >= m)
+        {
+            bplib_route_intf_unset_flags(scale_test_rtbl, cla->intf_id,
+                                         BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+            continue;
+        }
+
+        bplib_route_intf_set_flags(scale_test_rtbl, cla->intf_id, BPLIB_INTF_STATE_ADMIN_UP | BPLIB_INTF_STATE_OPER_UP);
+
+        /* CLA c brings in the bundles for sockets c, c + m, c + 2m and so on, or socket c % n if there are more CLAs */
+        num_own = (n > c) ? (1 + (n - 1 - c) / m) : 1;
+        for (i = 0; i < SCALE_TEST_BURST; ++i)
+        {
+            s = (n > c) ? (c + (i % num_own) * m) : (c % n);
+            cla->bundles[i].bundle = scale_test_templates[s].data;
+            cla->bundles[i].size   = scale_test_templates[s].size;
+        }
+    }
+}
+
+static void scale_test_run_one(uint32_t n, uint32_t m, uint32_t k)
+{
+    scale_test_counts_t window;
+    scale_test_counts_t total;
+    uint64_t            lock_start[BPLIB_MPOOL_STAT_LOCK_WAIT_BINS];
+    uint64_t            lock_end[BPLIB_MPOOL_STAT_LOCK_WAIT_BINS];
+    uint64_t            locks;
+    uint64_t            waited;
+    uint64_t            start_us;
+    uint64_t            elapsed_us;
+    uint64_t            drain_limit;
+    double              bundles;
+    uint32_t            i;
+
+    scale_test_n = n;
+    scale_test_m = m;
+    scale_test_k = k;
+    scale_test_prepare(n, m);
+
+    for (i = 0; i < k; ++i)
+    {
+        memset(&scale_test_threads[i].counts, 0, sizeof(scale_test_threads[i].counts));
+        scale_test_threads[i].window_taken = false;
+    }
+
+    scale_test_running = true;
+    scale_test_sending = true;
+    scale_test_get_lock_stats(lock_start);
+    start_us = bplib_os_get_monotonic_us();
+
+    for (i = 0; i < k; ++i)
+    {
+        scale_test_threads[i].thread = bplib_os_thread_create("scale_drive", scale_test_thread_entry,
+                                                              &scale_test_threads[i]);
+        UtAssert_NOT_NULL(scale_test_threads[i].thread);
+    }
+
+    OS_TaskDelay(1000 * scale_test_config.seconds);
+
+    scale_test_sending = false;
+    elapsed_us         = bplib_os_get_monotonic_us() - start_us;
+    scale_test_get_lock_stats(lock_end);
+
+    /* what is already queued is let out, so the bundles are all accounted for before the next run */
+    drain_limit = bplib_os_get_dtntime_ms() + SCALE_TEST_DRAIN_MSEC;
+    do
+    {
+        OS_TaskDelay(100);
+        memset(&total, 0, sizeof(total));
+        for (i = 0; i < k; ++i)
+        {
+            scale_test_add_counts(&total, &scale_test_threads[i].counts);
+        }
+    } while ((total.egressed < total.sent || total.received < total.ingressed) &&
+             bplib_os_get_dtntime_ms() < drain_limit);
+
+    scale_test_running = false;
+    memset(&window, 0, sizeof(window));
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < k; ++i)
+    {
+        if (scale_test_threads[i].thread != NULL)
+        {
+            bplib_os_thread_join(scale_test_threads[i].thread);
+            scale_test_threads[i].thread = NULL;
+        }
+        scale_test_add_counts(&window, &scale_test_threads[i].window);
+        scale_test_add_counts(&total, &scale_test_threads[i].counts);
+    }
+
+    locks  = 0;
+    waited = 0;
+    for (i = 0; i < BPLIB_MPOOL_STAT_LOCK_WAIT_BINS; ++i)
+    {
+        lock_end[i] -= lock_start[i];
+        locks += lock_end[i];
+        if (i > 0)
+        {
+            waited += lock_end[i];
+        }
+    }
+
+    /* the lock counts are for bundles moved either way */
+    bundles = (double)(window.egressed + window.received);
+    if (bundles < 1.0)
+    {
+        bundles = 1.0;
+    }
+
+    UtPrintf("N=%-3lu M=%-3lu K=%-3lu tx %10.0f/s rx %10.0f/s  locks/bundle %6.1f waited %5.2f%% "
+             "(<10us %lu <100us %lu <1ms %lu longer %lu)",
+             (unsigned long)n, (unsigned long)m, (unsigned long)k, ((double)window.egressed * 1e6) / elapsed_us,
+             ((double)window.received * 1e6) / elapsed_us, (double)locks / bundles,
+             (locks > 0) ? ((double)waited * 100.0) / (double)locks : 0.0, (unsigned long)lock_end[1],
+             (unsigned long)lock_end[2], (unsigned long)lock_end[3], (unsigned long)lock_end[4]);
+    UtPrintf("             sent %lu (blocked %lu) ingressed %lu (blocked %lu), not out after drain: tx %lu rx %lu",
+             (unsigned long)total.sent, (unsigned long)total.send_blocked, (unsigned long)total.ingressed,
+             (unsigned long)total.ingress_blocked, (unsigned long)(total.sent - total.egressed),
+             (unsigned long)(total.ingressed - total.received));
+
+    UtAssert_True(total.errors == 0, "N=%lu M=%lu K=%lu: %lu errors", (unsigned long)n, (unsigned long)m,
+                  (unsigned long)k, (unsigned long)total.errors);
+    UtAssert_True(total.egressed > 0 && total.received > 0, "N=%lu M=%lu K=%lu: bundles moved both ways",
+                  (unsigned long)n, (unsigned long)m, (unsigned long)k);
+}
+
+void scale_test_run(void)
+{
+    uint32_t s;
+    uint32_t c;
+    uint32_t t;
+    uint32_t i;
+
+    if (scale_test_rtbl == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < SCALE_TEST_MAX_SOCKETS; ++i)
+    {
+        if (scale_test_templates[i].data == NULL)
+        {
+            UtAssert_Failed("No bundle to bring in for socket %lu", (unsigned long)i);
+            return;
+        }
+    }
+
+    for (s = 0; s < scale_test_config.num_sockets; ++s)
+    {
+        for (c = 0; c < scale_test_config.num_clas; ++c)
+        {
+            for (t = 0; t < scale_test_config.num_threads; ++t)
+            {
+                scale_test_run_one(scale_test_config.sockets[s], scale_test_config.clas[c],
+                                   scale_test_config.threads[t]);
+            }
+        }
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(scale_test_run, scale_test_setup, scale_test_teardown, "scaling");
+}
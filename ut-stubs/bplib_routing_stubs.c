@@ -46,6 +46,26 @@ int bplib_route_add(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_hand
     return UT_GenStub_GetReturnValue(bplib_route_add, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_add_ext()
+ * ----------------------------------------------------
+ */
+int bplib_route_add_ext(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id, uint32_t route_flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_add_ext, int);
+
+    UT_GenStub_AddParam(bplib_route_add_ext, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_add_ext, bp_ipn_t, dest);
+    UT_GenStub_AddParam(bplib_route_add_ext, bp_ipn_t, mask);
+    UT_GenStub_AddParam(bplib_route_add_ext, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_route_add_ext, uint32_t, route_flags);
+
+    UT_GenStub_Execute(bplib_route_add_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_add_ext, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_alloc_table()
@@ -63,6 +83,24 @@ bplib_routetbl_t *bplib_route_alloc_table(uint32_t max_routes, size_t cache_mem_
     return UT_GenStub_GetReturnValue(bplib_route_alloc_table, bplib_routetbl_t *);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_alloc_table_ext()
+ * ----------------------------------------------------
+ */
+bplib_routetbl_t *bplib_route_alloc_table_ext(uint32_t max_routes, size_t cache_mem_size, uint32_t mem_flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_alloc_table_ext, bplib_routetbl_t *);
+
+    UT_GenStub_AddParam(bplib_route_alloc_table_ext, uint32_t, max_routes);
+    UT_GenStub_AddParam(bplib_route_alloc_table_ext, size_t, cache_mem_size);
+    UT_GenStub_AddParam(bplib_route_alloc_table_ext, uint32_t, mem_flags);
+
+    UT_GenStub_Execute(bplib_route_alloc_table_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_alloc_table_ext, bplib_routetbl_t *);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_bind_sub_intf()
@@ -80,6 +118,84 @@ bp_handle_t bplib_route_bind_sub_intf(bplib_mpool_block_t *flow_block, bp_handle
     return UT_GenStub_GetReturnValue(bplib_route_bind_sub_intf, bp_handle_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_contact_add()
+ * ----------------------------------------------------
+ */
+int bplib_route_contact_add(bplib_routetbl_t *tbl, const bplib_route_contact_t *contact)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_contact_add, int);
+
+    UT_GenStub_AddParam(bplib_route_contact_add, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_contact_add, const bplib_route_contact_t *, contact);
+
+    UT_GenStub_Execute(bplib_route_contact_add, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_contact_add, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_contact_del()
+ * ----------------------------------------------------
+ */
+int bplib_route_contact_del(bplib_routetbl_t *tbl, bp_ipn_t dest, bp_ipn_t mask, bp_handle_t intf_id,
+                            uint64_t start_time)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_contact_del, int);
+
+    UT_GenStub_AddParam(bplib_route_contact_del, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_contact_del, bp_ipn_t, dest);
+    UT_GenStub_AddParam(bplib_route_contact_del, bp_ipn_t, mask);
+    UT_GenStub_AddParam(bplib_route_contact_del, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_route_contact_del, uint64_t, start_time);
+
+    UT_GenStub_Execute(bplib_route_contact_del, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_contact_del, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_contact_lookup()
+ * ----------------------------------------------------
+ */
+int bplib_route_contact_lookup(bplib_routetbl_t *tbl, bp_ipn_t dest, uint64_t dtntime, bplib_route_contact_t *contact)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_contact_lookup, int);
+
+    UT_GenStub_AddParam(bplib_route_contact_lookup, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_contact_lookup, bp_ipn_t, dest);
+    UT_GenStub_AddParam(bplib_route_contact_lookup, uint64_t, dtntime);
+    UT_GenStub_AddParam(bplib_route_contact_lookup, bplib_route_contact_t *, contact);
+
+    UT_GenStub_Execute(bplib_route_contact_lookup, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_contact_lookup, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_contact_scan()
+ * ----------------------------------------------------
+ */
+uint64_t bplib_route_contact_scan(bplib_routetbl_t *tbl, uint64_t after_time, uint64_t until_time,
+                                  bplib_route_contact_func_t func, void *arg)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_contact_scan, uint64_t);
+
+    UT_GenStub_AddParam(bplib_route_contact_scan, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_contact_scan, uint64_t, after_time);
+    UT_GenStub_AddParam(bplib_route_contact_scan, uint64_t, until_time);
+    UT_GenStub_AddParam(bplib_route_contact_scan, bplib_route_contact_func_t, func);
+    UT_GenStub_AddParam(bplib_route_contact_scan, void *, arg);
+
+    UT_GenStub_Execute(bplib_route_contact_scan, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_contact_scan, uint64_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_del()
@@ -116,6 +232,18 @@ int bplib_route_del_intf(bplib_routetbl_t *tbl, bp_handle_t intf_id)
     return UT_GenStub_GetReturnValue(bplib_route_del_intf, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_do_contact_plan()
+ * ----------------------------------------------------
+ */
+void bplib_route_do_contact_plan(bplib_routetbl_t *tbl)
+{
+    UT_GenStub_AddParam(bplib_route_do_contact_plan, bplib_routetbl_t *, tbl);
+
+    UT_GenStub_Execute(bplib_route_do_contact_plan, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_forward_baseintf_bundle()
@@ -183,6 +311,27 @@ bp_handle_t bplib_route_get_next_avail_intf(const bplib_routetbl_t *tbl, bp_ipn_
     return UT_GenStub_GetReturnValue(bplib_route_get_next_avail_intf, bp_handle_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_get_next_intf_for_flow()
+ * ----------------------------------------------------
+ */
+bp_handle_t bplib_route_get_next_intf_for_flow(const bplib_routetbl_t *tbl, bp_ipn_t dest, uint32_t flow_hash,
+                                               uint32_t req_flags, uint32_t flag_mask)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_get_next_intf_for_flow, bp_handle_t);
+
+    UT_GenStub_AddParam(bplib_route_get_next_intf_for_flow, const bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_get_next_intf_for_flow, bp_ipn_t, dest);
+    UT_GenStub_AddParam(bplib_route_get_next_intf_for_flow, uint32_t, flow_hash);
+    UT_GenStub_AddParam(bplib_route_get_next_intf_for_flow, uint32_t, req_flags);
+    UT_GenStub_AddParam(bplib_route_get_next_intf_for_flow, uint32_t, flag_mask);
+
+    UT_GenStub_Execute(bplib_route_get_next_intf_for_flow, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_get_next_intf_for_flow, bp_handle_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_get_next_intf_with_flags()
@@ -268,6 +417,24 @@ int bplib_route_intf_set_flags(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint3
     return UT_GenStub_GetReturnValue(bplib_route_intf_set_flags, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_intf_set_poll_time()
+ * ----------------------------------------------------
+ */
+int bplib_route_intf_set_poll_time(bplib_routetbl_t *tbl, bp_handle_t intf_id, uint64_t poll_time)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_intf_set_poll_time, int);
+
+    UT_GenStub_AddParam(bplib_route_intf_set_poll_time, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_intf_set_poll_time, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_route_intf_set_poll_time, uint64_t, poll_time);
+
+    UT_GenStub_Execute(bplib_route_intf_set_poll_time, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_intf_set_poll_time, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_intf_unset_flags()
@@ -458,6 +625,24 @@ void bplib_route_release_intf_controlblock(bplib_routetbl_t *tbl, bplib_mpool_re
     UT_GenStub_Execute(bplib_route_release_intf_controlblock, Basic, NULL);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_replace_all()
+ * ----------------------------------------------------
+ */
+int bplib_route_replace_all(bplib_routetbl_t *tbl, const bplib_route_spec_t *routes, uint32_t route_count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_route_replace_all, int);
+
+    UT_GenStub_AddParam(bplib_route_replace_all, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_replace_all, const bplib_route_spec_t *, routes);
+    UT_GenStub_AddParam(bplib_route_replace_all, uint32_t, route_count);
+
+    UT_GenStub_Execute(bplib_route_replace_all, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_route_replace_all, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_route_set_maintenance_request()
@@ -469,3 +654,29 @@ void bplib_route_set_maintenance_request(bplib_routetbl_t *tbl)
 
     UT_GenStub_Execute(bplib_route_set_maintenance_request, Basic, NULL);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_worker_process_flows()
+ * ----------------------------------------------------
+ */
+void bplib_route_worker_process_flows(bplib_routetbl_t *tbl, uint32_t timeout_ms)
+{
+    UT_GenStub_AddParam(bplib_route_worker_process_flows, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_worker_process_flows, uint32_t, timeout_ms);
+
+    UT_GenStub_Execute(bplib_route_worker_process_flows, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_route_wait_until()
+ * ----------------------------------------------------
+ */
+void bplib_route_wait_until(bplib_routetbl_t *tbl, uint64_t until_dtntime)
+{
+    UT_GenStub_AddParam(bplib_route_wait_until, bplib_routetbl_t *, tbl);
+    UT_GenStub_AddParam(bplib_route_wait_until, uint64_t, until_dtntime);
+
+    UT_GenStub_Execute(bplib_route_wait_until, Basic, NULL);
+}
@@ -64,6 +64,133 @@ int bplib_cla_egress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, void *bundle,
     return UT_GenStub_GetReturnValue(bplib_cla_egress, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_egress_batch()
+ * ----------------------------------------------------
+ */
+int bplib_cla_egress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_cla_egress_buf_t *buffers,
+                           uint32_t count, uint32_t *num_filled, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_egress_batch, int);
+
+    UT_GenStub_AddParam(bplib_cla_egress_batch, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_egress_batch, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_cla_egress_batch, bplib_cla_egress_buf_t *, buffers);
+    UT_GenStub_AddParam(bplib_cla_egress_batch, uint32_t, count);
+    UT_GenStub_AddParam(bplib_cla_egress_batch, uint32_t *, num_filled);
+    UT_GenStub_AddParam(bplib_cla_egress_batch, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_cla_egress_batch, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_egress_batch, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_egress_begin()
+ * ----------------------------------------------------
+ */
+int bplib_cla_egress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref, size_t *size,
+                           uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_egress_begin, int);
+
+    UT_GenStub_AddParam(bplib_cla_egress_begin, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_egress_begin, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_cla_egress_begin, bplib_mpool_ref_t *, stream_ref);
+    UT_GenStub_AddParam(bplib_cla_egress_begin, size_t *, size);
+    UT_GenStub_AddParam(bplib_cla_egress_begin, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_cla_egress_begin, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_egress_begin, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_egress_end()
+ * ----------------------------------------------------
+ */
+void bplib_cla_egress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref)
+{
+    UT_GenStub_AddParam(bplib_cla_egress_end, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_egress_end, bplib_mpool_ref_t, stream_ref);
+
+    UT_GenStub_Execute(bplib_cla_egress_end, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_egress_iov()
+ * ----------------------------------------------------
+ */
+int bplib_cla_egress_iov(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_iovec_t *iov, uint32_t *iov_count,
+                         bplib_mpool_ref_t *bundle_ref, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_egress_iov, int);
+
+    UT_GenStub_AddParam(bplib_cla_egress_iov, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_egress_iov, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_cla_egress_iov, bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(bplib_cla_egress_iov, uint32_t *, iov_count);
+    UT_GenStub_AddParam(bplib_cla_egress_iov, bplib_mpool_ref_t *, bundle_ref);
+    UT_GenStub_AddParam(bplib_cla_egress_iov, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_cla_egress_iov, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_egress_iov, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_egress_iov_release()
+ * ----------------------------------------------------
+ */
+void bplib_cla_egress_iov_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t bundle_ref)
+{
+    UT_GenStub_AddParam(bplib_cla_egress_iov_release, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_egress_iov_release, bplib_mpool_ref_t, bundle_ref);
+
+    UT_GenStub_Execute(bplib_cla_egress_iov_release, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_egress_read()
+ * ----------------------------------------------------
+ */
+int bplib_cla_egress_read(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, void *buffer, size_t *size)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_egress_read, int);
+
+    UT_GenStub_AddParam(bplib_cla_egress_read, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_egress_read, bplib_mpool_ref_t, stream_ref);
+    UT_GenStub_AddParam(bplib_cla_egress_read, void *, buffer);
+    UT_GenStub_AddParam(bplib_cla_egress_read, size_t *, size);
+
+    UT_GenStub_Execute(bplib_cla_egress_read, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_egress_read, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_get_notify_fd()
+ * ----------------------------------------------------
+ */
+int bplib_cla_get_notify_fd(bplib_routetbl_t *rtbl, bp_handle_t intf_id)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_get_notify_fd, int);
+
+    UT_GenStub_AddParam(bplib_cla_get_notify_fd, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_get_notify_fd, bp_handle_t, intf_id);
+
+    UT_GenStub_Execute(bplib_cla_get_notify_fd, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_get_notify_fd, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_cla_ingress()
@@ -84,6 +211,136 @@ int bplib_cla_ingress(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const void *b
     return UT_GenStub_GetReturnValue(bplib_cla_ingress, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_ingress_adopt()
+ * ----------------------------------------------------
+ */
+int bplib_cla_ingress_adopt(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t buffer_ref, size_t size,
+                            uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_ingress_adopt, int);
+
+    UT_GenStub_AddParam(bplib_cla_ingress_adopt, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_ingress_adopt, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_cla_ingress_adopt, bplib_mpool_ref_t, buffer_ref);
+    UT_GenStub_AddParam(bplib_cla_ingress_adopt, size_t, size);
+    UT_GenStub_AddParam(bplib_cla_ingress_adopt, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_cla_ingress_adopt, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_ingress_adopt, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_ingress_batch()
+ * ----------------------------------------------------
+ */
+int bplib_cla_ingress_batch(bplib_routetbl_t *rtbl, bp_handle_t intf_id, const bplib_cla_bundle_buf_t *bundles,
+                            uint32_t count, int *status_list, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_ingress_batch, int);
+
+    UT_GenStub_AddParam(bplib_cla_ingress_batch, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_ingress_batch, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_cla_ingress_batch, const bplib_cla_bundle_buf_t *, bundles);
+    UT_GenStub_AddParam(bplib_cla_ingress_batch, uint32_t, count);
+    UT_GenStub_AddParam(bplib_cla_ingress_batch, int *, status_list);
+    UT_GenStub_AddParam(bplib_cla_ingress_batch, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_cla_ingress_batch, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_ingress_batch, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_ingress_begin()
+ * ----------------------------------------------------
+ */
+int bplib_cla_ingress_begin(bplib_routetbl_t *rtbl, bp_handle_t intf_id, bplib_mpool_ref_t *stream_ref)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_ingress_begin, int);
+
+    UT_GenStub_AddParam(bplib_cla_ingress_begin, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_ingress_begin, bp_handle_t, intf_id);
+    UT_GenStub_AddParam(bplib_cla_ingress_begin, bplib_mpool_ref_t *, stream_ref);
+
+    UT_GenStub_Execute(bplib_cla_ingress_begin, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_ingress_begin, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_ingress_end()
+ * ----------------------------------------------------
+ */
+int bplib_cla_ingress_end(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_ingress_end, int);
+
+    UT_GenStub_AddParam(bplib_cla_ingress_end, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_ingress_end, bplib_mpool_ref_t, stream_ref);
+    UT_GenStub_AddParam(bplib_cla_ingress_end, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_cla_ingress_end, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_ingress_end, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_ingress_feed()
+ * ----------------------------------------------------
+ */
+int bplib_cla_ingress_feed(bplib_routetbl_t *rtbl, bplib_mpool_ref_t stream_ref, const void *data, size_t size)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_ingress_feed, int);
+
+    UT_GenStub_AddParam(bplib_cla_ingress_feed, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_ingress_feed, bplib_mpool_ref_t, stream_ref);
+    UT_GenStub_AddParam(bplib_cla_ingress_feed, const void *, data);
+    UT_GenStub_AddParam(bplib_cla_ingress_feed, size_t, size);
+
+    UT_GenStub_Execute(bplib_cla_ingress_feed, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_ingress_feed, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_rxbuf_get()
+ * ----------------------------------------------------
+ */
+int bplib_cla_rxbuf_get(bplib_routetbl_t *rtbl, size_t *size, void **buffer, bplib_mpool_ref_t *buffer_ref)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_cla_rxbuf_get, int);
+
+    UT_GenStub_AddParam(bplib_cla_rxbuf_get, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_rxbuf_get, size_t *, size);
+    UT_GenStub_AddParam(bplib_cla_rxbuf_get, void **, buffer);
+    UT_GenStub_AddParam(bplib_cla_rxbuf_get, bplib_mpool_ref_t *, buffer_ref);
+
+    UT_GenStub_Execute(bplib_cla_rxbuf_get, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_cla_rxbuf_get, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_cla_rxbuf_release()
+ * ----------------------------------------------------
+ */
+void bplib_cla_rxbuf_release(bplib_routetbl_t *rtbl, bplib_mpool_ref_t buffer_ref)
+{
+    UT_GenStub_AddParam(bplib_cla_rxbuf_release, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_cla_rxbuf_release, bplib_mpool_ref_t, buffer_ref);
+
+    UT_GenStub_Execute(bplib_cla_rxbuf_release, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_close_socket()
@@ -148,6 +405,23 @@ bp_handle_t bplib_create_cla_intf(bplib_routetbl_t *rtbl)
     return UT_GenStub_GetReturnValue(bplib_create_cla_intf, bp_handle_t);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_create_cla_intf_ext()
+ * ----------------------------------------------------
+ */
+bp_handle_t bplib_create_cla_intf_ext(bplib_routetbl_t *rtbl, uint32_t flags)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_create_cla_intf_ext, bp_handle_t);
+
+    UT_GenStub_AddParam(bplib_create_cla_intf_ext, bplib_routetbl_t *, rtbl);
+    UT_GenStub_AddParam(bplib_create_cla_intf_ext, uint32_t, flags);
+
+    UT_GenStub_Execute(bplib_create_cla_intf_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_create_cla_intf_ext, bp_handle_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_create_file_storage()
@@ -263,6 +537,25 @@ int bplib_eid2ipn(const char *eid, size_t len, bp_ipn_t *node, bp_ipn_t *service
     return UT_GenStub_GetReturnValue(bplib_eid2ipn, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_eid2ipn_n()
+ * ----------------------------------------------------
+ */
+size_t bplib_eid2ipn_n(const char *const *eids, bp_ipn_t *nodes, bp_ipn_t *services, size_t count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_eid2ipn_n, size_t);
+
+    UT_GenStub_AddParam(bplib_eid2ipn_n, const char *const *, eids);
+    UT_GenStub_AddParam(bplib_eid2ipn_n, bp_ipn_t *, nodes);
+    UT_GenStub_AddParam(bplib_eid2ipn_n, bp_ipn_t *, services);
+    UT_GenStub_AddParam(bplib_eid2ipn_n, size_t, count);
+
+    UT_GenStub_Execute(bplib_eid2ipn_n, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_eid2ipn_n, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_init()
@@ -296,6 +589,26 @@ int bplib_ipn2eid(char *eid, size_t len, bp_ipn_t node, bp_ipn_t service)
     return UT_GenStub_GetReturnValue(bplib_ipn2eid, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_ipn2eid_n()
+ * ----------------------------------------------------
+ */
+size_t bplib_ipn2eid_n(char *eids, size_t eid_size, const bp_ipn_t *nodes, const bp_ipn_t *services, size_t count)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_ipn2eid_n, size_t);
+
+    UT_GenStub_AddParam(bplib_ipn2eid_n, char *, eids);
+    UT_GenStub_AddParam(bplib_ipn2eid_n, size_t, eid_size);
+    UT_GenStub_AddParam(bplib_ipn2eid_n, const bp_ipn_t *, nodes);
+    UT_GenStub_AddParam(bplib_ipn2eid_n, const bp_ipn_t *, services);
+    UT_GenStub_AddParam(bplib_ipn2eid_n, size_t, count);
+
+    UT_GenStub_Execute(bplib_ipn2eid_n, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_ipn2eid_n, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_query_integer()
@@ -334,6 +647,62 @@ int bplib_recv(bp_socket_t *desc, void *payload, size_t *size, uint32_t timeout)
     return UT_GenStub_GetReturnValue(bplib_recv, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_recv_many()
+ * ----------------------------------------------------
+ */
+int bplib_recv_many(bp_socket_t *desc, bplib_recv_buf_t *buffers, uint32_t count, uint32_t *num_filled,
+                    uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_recv_many, int);
+
+    UT_GenStub_AddParam(bplib_recv_many, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_recv_many, bplib_recv_buf_t *, buffers);
+    UT_GenStub_AddParam(bplib_recv_many, uint32_t, count);
+    UT_GenStub_AddParam(bplib_recv_many, uint32_t *, num_filled);
+    UT_GenStub_AddParam(bplib_recv_many, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_recv_many, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_recv_many, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_recv_view()
+ * ----------------------------------------------------
+ */
+int bplib_recv_view(bp_socket_t *desc, bplib_iovec_t *iov, uint32_t *iov_count, size_t *size,
+                    bplib_mpool_ref_t *payload_ref, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_recv_view, int);
+
+    UT_GenStub_AddParam(bplib_recv_view, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_recv_view, bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(bplib_recv_view, uint32_t *, iov_count);
+    UT_GenStub_AddParam(bplib_recv_view, size_t *, size);
+    UT_GenStub_AddParam(bplib_recv_view, bplib_mpool_ref_t *, payload_ref);
+    UT_GenStub_AddParam(bplib_recv_view, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_recv_view, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_recv_view, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_recv_view_release()
+ * ----------------------------------------------------
+ */
+void bplib_recv_view_release(bp_socket_t *desc, bplib_mpool_ref_t payload_ref)
+{
+    UT_GenStub_AddParam(bplib_recv_view_release, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_recv_view_release, bplib_mpool_ref_t, payload_ref);
+
+    UT_GenStub_Execute(bplib_recv_view_release, Basic, NULL);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for bplib_send()
@@ -352,3 +721,183 @@ int bplib_send(bp_socket_t *desc, const void *payload, size_t size, uint32_t tim
 
     return UT_GenStub_GetReturnValue(bplib_send, int);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_send_extern()
+ * ----------------------------------------------------
+ */
+int bplib_send_extern(bp_socket_t *desc, const void *payload, size_t size, bplib_payload_release_func_t release_func,
+                      void *release_arg, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_send_extern, int);
+
+    UT_GenStub_AddParam(bplib_send_extern, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_send_extern, const void *, payload);
+    UT_GenStub_AddParam(bplib_send_extern, size_t, size);
+    UT_GenStub_AddParam(bplib_send_extern, bplib_payload_release_func_t, release_func);
+    UT_GenStub_AddParam(bplib_send_extern, void *, release_arg);
+    UT_GenStub_AddParam(bplib_send_extern, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_send_extern, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_send_extern, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_send_many()
+ * ----------------------------------------------------
+ */
+int bplib_send_many(bp_socket_t *desc, const bplib_send_buf_t *payloads, uint32_t count, int *status_list,
+                    uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_send_many, int);
+
+    UT_GenStub_AddParam(bplib_send_many, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_send_many, const bplib_send_buf_t *, payloads);
+    UT_GenStub_AddParam(bplib_send_many, uint32_t, count);
+    UT_GenStub_AddParam(bplib_send_many, int *, status_list);
+    UT_GenStub_AddParam(bplib_send_many, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_send_many, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_send_many, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_get_notify_fd()
+ * ----------------------------------------------------
+ */
+int bplib_socket_get_notify_fd(bp_socket_t *desc)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_get_notify_fd, int);
+
+    UT_GenStub_AddParam(bplib_socket_get_notify_fd, bp_socket_t *, desc);
+
+    UT_GenStub_Execute(bplib_socket_get_notify_fd, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_get_notify_fd, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_flush()
+ * ----------------------------------------------------
+ */
+int bplib_socket_flush(bp_socket_t *desc, uint32_t timeout)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_flush, int);
+
+    UT_GenStub_AddParam(bplib_socket_flush, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_flush, uint32_t, timeout);
+
+    UT_GenStub_Execute(bplib_socket_flush, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_flush, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_query_latency()
+ * ----------------------------------------------------
+ */
+int bplib_socket_query_latency(bp_socket_t *desc, bplib_trace_stage_t stage, uint32_t *histogram)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_query_latency, int);
+
+    UT_GenStub_AddParam(bplib_socket_query_latency, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_query_latency, bplib_trace_stage_t, stage);
+    UT_GenStub_AddParam(bplib_socket_query_latency, uint32_t *, histogram);
+
+    UT_GenStub_Execute(bplib_socket_query_latency, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_query_latency, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_set_egress_encode()
+ * ----------------------------------------------------
+ */
+int bplib_socket_set_egress_encode(bp_socket_t *desc, bool enable)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_set_egress_encode, int);
+
+    UT_GenStub_AddParam(bplib_socket_set_egress_encode, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_set_egress_encode, bool, enable);
+
+    UT_GenStub_Execute(bplib_socket_set_egress_encode, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_set_egress_encode, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_set_nonblocking()
+ * ----------------------------------------------------
+ */
+int bplib_socket_set_nonblocking(bp_socket_t *desc, bool enable)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_set_nonblocking, int);
+
+    UT_GenStub_AddParam(bplib_socket_set_nonblocking, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_set_nonblocking, bool, enable);
+
+    UT_GenStub_Execute(bplib_socket_set_nonblocking, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_set_nonblocking, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_set_local_skip_encode()
+ * ----------------------------------------------------
+ */
+int bplib_socket_set_local_skip_encode(bp_socket_t *desc, bool enable)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_set_local_skip_encode, int);
+
+    UT_GenStub_AddParam(bplib_socket_set_local_skip_encode, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_set_local_skip_encode, bool, enable);
+
+    UT_GenStub_Execute(bplib_socket_set_local_skip_encode, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_set_local_skip_encode, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_set_coalescing()
+ * ----------------------------------------------------
+ */
+int bplib_socket_set_coalescing(bp_socket_t *desc, size_t max_size, uint32_t max_delay)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_set_coalescing, int);
+
+    UT_GenStub_AddParam(bplib_socket_set_coalescing, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_set_coalescing, size_t, max_size);
+    UT_GenStub_AddParam(bplib_socket_set_coalescing, uint32_t, max_delay);
+
+    UT_GenStub_Execute(bplib_socket_set_coalescing, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_set_coalescing, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for bplib_socket_set_tracing()
+ * ----------------------------------------------------
+ */
+int bplib_socket_set_tracing(bp_socket_t *desc, bool enable)
+{
+    UT_GenStub_SetupReturnBuffer(bplib_socket_set_tracing, int);
+
+    UT_GenStub_AddParam(bplib_socket_set_tracing, bp_socket_t *, desc);
+    UT_GenStub_AddParam(bplib_socket_set_tracing, bool, enable);
+
+    UT_GenStub_Execute(bplib_socket_set_tracing, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(bplib_socket_set_tracing, int);
+}
@@ -30,9 +30,141 @@
 #include "v7_types.h"
 #include "v7_decode.h"
 #include "v7_encode.h"
+#include "v7_mpstream.h"
+#include "crc.h"
 
 size_t v7_compute_full_bundle_size(bplib_mpool_bblock_primary_t *cpb);
 size_t v7_copy_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz);
-size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz);
+
+/*
+ * Same as v7_copy_full_bundle_out(), but blocks which are not encoded yet are encoded straight into
+ * the buffer instead of into the pool first, and are left that way.  The size of the bundle does not
+ * need to be known beforehand: this returns 0 if it does not all fit, otherwise the size written.
+ */
+size_t v7_encode_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz);
+
+/*
+ * Fills in iov with pointers to the encoded bundle in the pool, instead of copying it like
+ * v7_copy_full_bundle_out().  v7_compute_full_bundle_size() must have been called first, so
+ * every block is encoded.  Returns the number of entries needed, which may be more than max_iov.
+ */
+size_t v7_export_full_bundle_iov(bplib_mpool_bblock_primary_t *cpb, bplib_iovec_t *iov, size_t max_iov);
+
+/*
+ * State for encoding a bundle out a piece at a time, see v7_stream_export_begin()
+ */
+typedef struct v7_stream_export
+{
+    bplib_mpool_bblock_primary_t *cpb;
+    bplib_mpool_block_t          *cblk; /**< the canonical block being read, or the list head for the primary block */
+    size_t                        total_size;
+    size_t                        total_out;
+    bool                          blocks_done;
+    bool                          break_done;
+    bplib_mpool_stream_t          mps;
+} v7_stream_export_t;
+
+/*
+ * Starts reading the encoded bundle in cpb out a piece at a time with v7_stream_export_next().  This
+ * encodes any block that is not encoded yet, and returns the size of the whole bundle, or 0 if it could
+ * not be encoded.  The bundle must not be changed until all of it has been read.
+ */
+size_t v7_stream_export_begin(v7_stream_export_t *sxs, bplib_mpool_bblock_primary_t *cpb);
+
+/*
+ * Copies the next part of the encoded bundle into buffer, as much of it as fits.  Returns the number of
+ * bytes copied, which is only less than buf_sz at the end of the bundle, and then 0 after that.
+ */
+size_t v7_stream_export_next(v7_stream_export_t *sxs, void *buffer, size_t buf_sz);
+
+/*
+ * Options for decoding a bundle with v7_copy_full_bundle_in() or v7_adopt_full_bundle_in()
+ *
+ * With V7_IMPORT_LAZY_DECODE, the content of the extension blocks is only located, and
+ * v7_block_decode_canonical_data() must be called on a block before its logical data is used.
+ * This saves decoding blocks that are only passed on.
+ *
+ * With V7_IMPORT_DEFER_CRC, the CRCs of the canonical blocks may be left unchecked, so the cost is not
+ * on the thread which receives the bundle.  Then v7_verify_deferred_crcs() must be called before the
+ * bundle is used.  The primary block is always checked, as that is needed to route the bundle at all.
+ */
+#define V7_IMPORT_LAZY_DECODE 0x01
+#define V7_IMPORT_DEFER_CRC   0x02
+
+/*
+ * Decodes an encoded bundle into cpb, with a set of V7_IMPORT_* option flags
+ */
+size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz,
+                              uint32_t import_flags);
+
+/*
+ * Same as v7_copy_full_bundle_in(), but the bundle is already in the CBOR data block referred to by
+ * buffer_ref, so the encoded blocks of cpb refer to that instead of getting a copy of it.  The bundle
+ * must be within the user content size of that block.
+ */
+size_t v7_adopt_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t buffer_ref, size_t buf_sz,
+                               uint32_t import_flags);
+
+/*
+ * Checks the CRCs of the canonical blocks of a bundle which were deferred by V7_IMPORT_DEFER_CRC.
+ * Returns true if they are all good, or if they were already checked when it was decoded.
+ */
+bool v7_verify_deferred_crcs(bplib_mpool_bblock_primary_t *cpb);
+
+typedef enum v7_stream_import_phase
+{
+    v7_stream_import_phase_start,   /**< waiting for the start of the bundle array */
+    v7_stream_import_phase_block,   /**< collecting the next block in the stage buffer */
+    v7_stream_import_phase_content, /**< writing the content of a large block straight to the pool */
+    v7_stream_import_phase_trailer, /**< collecting the CRC that follows the content of a large block */
+    v7_stream_import_phase_done,    /**< the break code at the end of the bundle was seen */
+    v7_stream_import_phase_error
+} v7_stream_import_phase_t;
+
+/*
+ * State for decoding a bundle which arrives a piece at a time, see v7_stream_import_begin()
+ */
+typedef struct v7_stream_import
+{
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_canonical_t *ccb; /**< the large block, while its content is being written */
+    uint8_t                        *stage;
+    size_t                          stage_size;
+    size_t                          stage_len;
+    size_t                          total_in;
+    size_t                          content_remain;
+    size_t                          trailer_size;
+    size_t                          block_size;
+    bplib_crc_parameters_t         *crc_params; /**< set if the CRC of the large block is calculated as it goes */
+    bp_crcval_t                     crc_val;
+    bp_blocktype_t                  payload_block_hint;
+    uint32_t                        import_flags;
+    v7_stream_import_phase_t        phase;
+    bplib_mpool_stream_t            mps;
+} v7_stream_import_t;
+
+/*
+ * Starts decoding a bundle into cpb that will be passed in pieces to v7_stream_import_feed(), with a set of
+ * V7_IMPORT_* option flags.  The stage buffer must stay valid until v7_stream_import_end().
+ *
+ * Each block is collected in the stage buffer until it is all there, and then decoded the same as it is by
+ * v7_copy_full_bundle_in().  A payload block that is too big for the stage buffer is the exception: only its
+ * header is collected, and then the content is written to the pool as it arrives, so the bundle never needs to
+ * be in one buffer.  Every other block has to fit in the stage buffer.
+ */
+void v7_stream_import_begin(v7_stream_import_t *sis, bplib_mpool_bblock_primary_t *cpb, uint8_t *stage,
+                            size_t stage_size, uint32_t import_flags);
+
+/*
+ * Decodes the next piece of the bundle.  Returns false if the bundle is not valid, after which nothing
+ * more is decoded.
+ */
+bool v7_stream_import_feed(v7_stream_import_t *sis, const void *data, size_t size);
+
+/*
+ * Finishes decoding the bundle, returning its size, or 0 if the whole bundle was not seen or it was not
+ * valid.  Anything not yet attached to cpb is returned to the pool either way, so this also abandons it.
+ */
+size_t v7_stream_import_end(v7_stream_import_t *sis);
 
 #endif /* V7_CODEC_H */
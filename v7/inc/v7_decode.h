@@ -39,4 +39,30 @@ int v7_block_decode_pri(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr,
 int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
                               bp_blocktype_t payload_block_hint);
 
+/*
+ * The _ext variants are for a bundle buffer that is already in pool memory, in the CBOR data block referred
+ * to by source_ref.  The encoded blocks then refer to slices of that buffer rather than being copied, and it
+ * remains allocated for as long as any of them do.  If source_ref is NULL these are the same as the above.
+ */
+int v7_block_decode_pri_ext(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr, size_t data_size,
+                            bplib_mpool_ref_t source_ref);
+int v7_block_decode_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                                  bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref);
+
+/*
+ * Same as v7_block_decode_canonical_ext(), but the content of an extension block is only located, not
+ * decoded.  The block is saved and its CRC checked as usual, but the logical data is marked pending,
+ * and v7_block_decode_canonical_data() must be called before it is used.  Admin record payloads are
+ * still decoded right away, as their content determines the block type.
+ */
+int v7_block_frame_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                                 bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref);
+
+/*
+ * Decodes the content of a block from v7_block_frame_canonical_ext() into its logical data, from the
+ * encoded chunks.  This does nothing if the data is not pending, so it can be called before any use.
+ * Returns -1 if the content does not decode, in which case the logical data must not be used.
+ */
+int v7_block_decode_canonical_data(bplib_mpool_bblock_canonical_t *ccb);
+
 #endif /* V7_DECODE_H */
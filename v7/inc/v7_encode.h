@@ -37,8 +37,48 @@
  * more consistent.
  */
 int v7_block_encode_pri(bplib_mpool_bblock_primary_t *cpb);
+
+/*
+ * Encodes everything in the primary block except the creation timestamp into a template.  Fails if
+ * the result does not fit in the template, in which case it is left empty.
+ */
+int v7_block_encode_pri_template(bp_pri_template_t *tmpl, const bp_primary_block_t *pri);
+
+/*
+ * Encodes the primary block from its logical data straight into the buffer, leaving the encoded
+ * chunks as they are.  Returns the size of the block, or 0 if it does not fit in buf_sz.
+ */
+size_t v7_block_encode_pri_flat(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz);
+
+/*
+ * Same as v7_block_encode_pri(), for a primary block that matches the template in all but the
+ * creation timestamp.  With an empty template this just encodes the whole block.
+ */
+int v7_block_encode_pri_from_template(bplib_mpool_bblock_primary_t *cpb, const bp_pri_template_t *tmpl);
 int v7_block_encode_pay(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size);
 
+/*
+ * Same as v7_block_encode_pay(), but the content is not copied.  The content_ref is a ref to an
+ * external buffer block holding the data (see bplib_mpool_bblock_cbor_extern_alloc()), and the
+ * encoded block refers to it with slices in place of the content.
+ */
+int v7_block_encode_pay_extern(bplib_mpool_bblock_canonical_t *ccb, bplib_mpool_ref_t content_ref,
+                               const void *data_ptr, size_t data_size);
+
 int v7_block_encode_canonical(bplib_mpool_bblock_canonical_t *ccb);
 
+/*
+ * Same as v7_block_encode_pri_flat(), for an extension block that is not encoded yet.  This does not
+ * work for the payload, which is only kept in encoded form.
+ */
+size_t v7_block_encode_canonical_flat(bplib_mpool_bblock_canonical_t *ccb, void *buffer, size_t buf_sz);
+
+/*
+ * Same as v7_block_encode_canonical(), for an extension block that is already encoded and whose
+ * logical data has changed, such as the hop count, bundle age or previous node when forwarding.
+ * Those are encoded at a fixed width, so the encoded chunks and CRC are normally updated in place,
+ * without allocating anything.  If that is not possible, the block is encoded over again.
+ */
+int v7_block_update_canonical(bplib_mpool_bblock_canonical_t *ccb);
+
 #endif /* V7_ENCODE_H */
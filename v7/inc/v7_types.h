@@ -27,7 +27,17 @@
 
 #include "bplib_api_types.h"
 
-#define BP_DACS_MAX_SEQ_PER_PAYLOAD 16
+/*
+ * The most sequence numbers one range in a DACS can cover.  Every one of them is looked up
+ * when the DACS is received, so this keeps the work for a single bundle bounded.
+ */
+#define BP_DACS_MAX_SEQ_PER_RANGE 4096
+
+/*
+ * Room for the fixed parts of an encoded primary block template.  This is enough for ipn EIDs
+ * with 32 bit node numbers and small service numbers, and a lifetime of up to a month or so.
+ */
+#define BP_PRI_TEMPLATE_MAX_SIZE 40
 
 /******************************************************************************
  TYPEDEFS
@@ -226,6 +236,20 @@ typedef struct bp_primary_block
 
 } bp_primary_block_t;
 
+/*
+ * A primary block encoded ahead of time, without its creation timestamp.  Between the bundles
+ * from one connected socket that is the only field which changes, so each one only needs the
+ * timestamp encoded, and the CRC carried on from where the prefix left it.
+ */
+typedef struct bp_pri_template
+{
+    bp_crcval_t prefix_crc;  /* CRC state after the prefix */
+    uint8_t     prefix_size; /* encoded bytes before the timestamp, 0 if there is no template */
+    uint8_t     suffix_size; /* encoded bytes after the timestamp, not counting the CRC */
+    uint8_t     data[BP_PRI_TEMPLATE_MAX_SIZE];
+
+} bp_pri_template_t;
+
 typedef struct bp_canonical_bundle_block
 {
     bp_blocktype_t              blockType;
@@ -258,12 +282,22 @@ typedef struct bp_custody_tracking_block
     bp_endpointid_buffer_t current_custodian;
 } bp_custody_tracking_block_t;
 
+/*
+ * A run of consecutive sequence numbers in a DACS, from first_seq to first_seq + count - 1.  A run of one
+ * is encoded as a plain integer, as every sequence number was before runs were used.
+ */
+typedef struct bp_custody_seq_range
+{
+    bp_integer_t first_seq;
+    bp_integer_t count;
+} bp_custody_seq_range_t;
+
 /* This reflects the payload block (1) of a bundle containing a custody block w/bp_custody_op_accept */
 typedef struct bp_custody_accept_payload_block
 {
     bp_endpointid_buffer_t flow_source_eid;
-    bp_integer_t           num_entries;
-    bp_integer_t           sequence_nums[BP_DACS_MAX_SEQ_PER_PAYLOAD];
+    bp_integer_t           num_entries; /* the number of ranges, not sequence numbers */
+    bp_custody_seq_range_t ranges[BP_DACS_MAX_SEQ_PER_PAYLOAD];
 } bp_custody_accept_payload_block_t;
 
 typedef union bp_canonical_block_data
@@ -278,6 +312,7 @@ typedef union bp_canonical_block_data
 typedef struct bp_canonical_block_buffer
 {
     bp_canonical_bundle_block_t canonical_block; /* always present */
+    bool                        data_pending;    /* data not decoded yet, see v7_block_decode_canonical_data() */
     bp_canonical_block_data_t   data;            /* variable data field, depends on type */
 } bp_canonical_block_buffer_t;
 
@@ -114,6 +114,67 @@ void v7_encode_bp_integer(v7_encode_state_t *enc, const bp_integer_t *v)
     }
 }
 
+/*
+ * -----------------------------------------------------------------------------------
+ * FIXED WIDTH - encode a CBOR item head with a value that always takes the given number
+ * of octets (0 for a value within the initial byte), rather than the shortest form.
+ * Fields that are changed after the block is encoded use this, so the encoded size stays
+ * the same and the block can be updated in place (see v7_block_update_canonical()).
+ *
+ * These go straight to the writer, tinycbor does not see them, so they cannot be used
+ * inside of a container from v7_encode_container().
+ * -----------------------------------------------------------------------------------
+ */
+void v7_encode_fixed_head(v7_encode_state_t *enc, CborType type, uint64_t val, size_t width)
+{
+    uint8_t head[9];
+    size_t  i;
+
+    if (!enc->error)
+    {
+        switch (width)
+        {
+            case 0:
+                enc->error = (val >= 24);
+                head[0]    = val & 0x1F;
+                break;
+            case 1:
+            case 2:
+            case 4:
+                enc->error = (val >> (width * 8)) != 0;
+                head[0]    = 24 + (width >> 1);
+                break;
+            case 8:
+                head[0] = 27;
+                break;
+            default:
+                enc->error = true;
+                break;
+        }
+
+        /* an unsupported width leaves nothing in head, and would not fit in it */
+        if (!enc->error)
+        {
+            head[0] |= (uint8_t)type;
+            for (i = width; i > 0; --i)
+            {
+                head[i] = val & 0xFF;
+                val >>= 8;
+            }
+
+            if (v7_encoder_write_wrapper(enc, head, 1 + width, CborEncoderAppendCborData) != CborNoError)
+            {
+                enc->error = true;
+            }
+        }
+    }
+}
+
+void v7_encode_bp_integer_fixed(v7_encode_state_t *enc, const bp_integer_t *v, size_t width)
+{
+    v7_encode_fixed_head(enc, CborIntegerType, *v, width);
+}
+
 /*
  * -----------------------------------------------------------------------------------
  * BP_BLOCKNUM - encode/decode instances of the "bp_blocknum_t" type
@@ -32,7 +32,7 @@
  * -----------------------------------------------------------------------------------
  */
 
-void v7_encode_bitmap(v7_encode_state_t *enc, const uint8_t *v, const v7_bitmap_table_t *ptbl)
+bp_integer_t v7_get_bitmap(const uint8_t *v, const v7_bitmap_table_t *ptbl)
 {
     bp_integer_t value;
 
@@ -46,17 +46,30 @@ void v7_encode_bitmap(v7_encode_state_t *enc, const uint8_t *v, const v7_bitmap_
         ++ptbl;
     }
 
-    v7_encode_bp_integer(enc, &value);
+    return value;
 }
 
-void v7_decode_bitmap(v7_decode_state_t *dec, uint8_t *v, const v7_bitmap_table_t *ptbl)
+void v7_encode_bitmap(v7_encode_state_t *enc, const uint8_t *v, const v7_bitmap_table_t *ptbl)
 {
     bp_integer_t value;
 
-    v7_decode_bp_integer(dec, &value);
+    value = v7_get_bitmap(v, ptbl);
+    v7_encode_bp_integer(enc, &value);
+}
+
+void v7_set_bitmap(uint8_t *v, const v7_bitmap_table_t *ptbl, bp_integer_t value)
+{
     while (ptbl->mask != 0)
     {
         v[ptbl->offset] = (value & ptbl->mask) != 0;
         ++ptbl;
     }
 }
+
+void v7_decode_bitmap(v7_decode_state_t *dec, uint8_t *v, const v7_bitmap_table_t *ptbl)
+{
+    bp_integer_t value;
+
+    v7_decode_bp_integer(dec, &value);
+    v7_set_bitmap(v, ptbl, value);
+}
@@ -42,7 +42,8 @@
 
 void v7_encode_bp_bundle_age_block(v7_encode_state_t *enc, const bp_bundle_age_block_t *v)
 {
-    v7_encode_bp_dtntime(enc, &v->age);
+    /* this is increased at every hop, so it is encoded at a fixed width */
+    v7_encode_bp_integer_fixed(enc, &v->age, 8);
 }
 
 void v7_decode_bp_bundle_age_block(v7_decode_state_t *dec, bp_bundle_age_block_t *v)
@@ -190,6 +190,11 @@ void v7_decode_bp_block_processing_flags(v7_decode_state_t *dec, bp_block_proces
     v7_decode_bitmap(dec, (uint8_t *)v, V7_BLOCK_PROCESSING_FLAGS_BITMAP_TABLE);
 }
 
+void v7_set_bp_block_processing_flags(bp_block_processing_flags_t *v, bp_integer_t value)
+{
+    v7_set_bitmap((uint8_t *)v, V7_BLOCK_PROCESSING_FLAGS_BITMAP_TABLE, value);
+}
+
 void v7_decode_bp_canonical_info(v7_decode_state_t *dec, v7_canonical_block_info_t *info)
 {
     const uint8_t *cbor_content_start_ptr;
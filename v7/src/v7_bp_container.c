@@ -72,6 +72,20 @@ void v7_encode_container(v7_encode_state_t *enc, size_t entries, v7_encode_func_
     }
 }
 
+/*
+ * Same as v7_encode_container(), but the container head goes straight to the writer through
+ * v7_encode_fixed_head(), so everything in it must be encoded that way too
+ */
+void v7_encode_container_fixed(v7_encode_state_t *enc, size_t entries, v7_encode_func_t func, const void *arg)
+{
+    v7_encode_fixed_head(enc, CborArrayType, entries, 0);
+
+    if (!enc->error)
+    {
+        func(enc, arg);
+    }
+}
+
 void v7_decode_container(v7_decode_state_t *dec, size_t entries, v7_decode_func_t func, void *arg)
 {
     CborValue  content;
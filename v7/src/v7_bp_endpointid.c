@@ -159,6 +159,38 @@ void v7_encode_bp_endpointid_buffer(v7_encode_state_t *enc, const bp_endpointid_
     v7_encode_container(enc, 2, v7_encode_bp_endpointid_buffer_impl, v);
 }
 
+/*
+ * Fixed width form of an ipn endpoint ID, the node and service numbers always take 8 octets
+ * so one node ID can be replaced with another in place.  Other schemes are not supported.
+ */
+static void v7_encode_bp_ipn_uri_ssp_fixed_impl(v7_encode_state_t *enc, const void *arg)
+{
+    const bp_ipn_uri_ssp_t *v = arg;
+
+    v7_encode_bp_integer_fixed(enc, &v->node_number, 8);
+    v7_encode_bp_integer_fixed(enc, &v->service_number, 8);
+}
+
+static void v7_encode_bp_endpointid_buffer_fixed_impl(v7_encode_state_t *enc, const void *arg)
+{
+    const bp_endpointid_buffer_t *v = arg;
+
+    v7_encode_fixed_head(enc, CborIntegerType, v->scheme, 0);
+    v7_encode_container_fixed(enc, 2, v7_encode_bp_ipn_uri_ssp_fixed_impl, &v->ssp.ipn);
+}
+
+void v7_encode_bp_endpointid_buffer_fixed(v7_encode_state_t *enc, const bp_endpointid_buffer_t *v)
+{
+    if (v->scheme != bp_endpointid_scheme_ipn)
+    {
+        enc->error = true;
+    }
+    else
+    {
+        v7_encode_container_fixed(enc, 2, v7_encode_bp_endpointid_buffer_fixed_impl, v);
+    }
+}
+
 void v7_decode_bp_endpointid_scheme(v7_decode_state_t *dec, bp_endpointid_scheme_t *v)
 {
     *v = v7_decode_small_int(dec);
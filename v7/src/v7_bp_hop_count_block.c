@@ -44,16 +44,31 @@ void v7_encode_bp_hop_count_block_impl(v7_encode_state_t *enc, const void *arg)
 {
     const bp_hop_count_block_t *v        = arg;
     bp_hop_count_field_t        field_id = bp_hop_count_field_undef;
+    size_t                      width;
+
+    /*
+     * The count is increased at every hop, so both fields are encoded at a fixed width.  The
+     * hop limit is at most 255, and the bundle is dropped once the count goes past it, so one
+     * octet is normally enough.
+     */
+    if (v->hopLimit <= 0xFF && v->hopCount <= 0xFF)
+    {
+        width = 1;
+    }
+    else
+    {
+        width = 8;
+    }
 
     while (field_id < bp_hop_count_field_done && !enc->error)
     {
         switch (field_id)
         {
             case bp_hop_count_field_limit:
-                v7_encode_bp_integer(enc, &v->hopLimit);
+                v7_encode_bp_integer_fixed(enc, &v->hopLimit, width);
                 break;
             case bp_hop_count_field_count:
-                v7_encode_bp_integer(enc, &v->hopCount);
+                v7_encode_bp_integer_fixed(enc, &v->hopCount, width);
                 break;
             default:
                 break;
@@ -65,7 +80,7 @@ void v7_encode_bp_hop_count_block_impl(v7_encode_state_t *enc, const void *arg)
 
 void v7_encode_bp_hop_count_block(v7_encode_state_t *enc, const bp_hop_count_block_t *v)
 {
-    v7_encode_container(enc, 2, v7_encode_bp_hop_count_block_impl, v);
+    v7_encode_container_fixed(enc, 2, v7_encode_bp_hop_count_block_impl, v);
 }
 
 void v7_decode_bp_hop_count_block_impl(v7_decode_state_t *dec, void *arg)
@@ -33,7 +33,15 @@
  */
 void v7_encode_bp_previous_node_block(v7_encode_state_t *enc, const bp_previous_node_block_t *v)
 {
-    v7_encode_bp_endpointid_buffer(enc, &v->nodeId);
+    /* this is replaced at every hop, so an ipn node ID is encoded at a fixed width */
+    if (v->nodeId.scheme == bp_endpointid_scheme_ipn)
+    {
+        v7_encode_bp_endpointid_buffer_fixed(enc, &v->nodeId);
+    }
+    else
+    {
+        v7_encode_bp_endpointid_buffer(enc, &v->nodeId);
+    }
 }
 
 void v7_decode_bp_previous_node_block(v7_decode_state_t *dec, bp_previous_node_block_t *v)
@@ -128,7 +128,10 @@ void v7_encode_bp_primary_block_impl(v7_encode_state_t *enc, const void *arg)
                 v7_encode_bp_endpointid_buffer(enc, &v->reportEID);
                 break;
             case bp_pri_field_timestamp:
+                enc->timestamp_start   = enc->total_bytes_encoded;
+                enc->timestamp_crc_val = enc->crc_val;
                 v7_encode_bp_creation_timestamp(enc, &v->creationTimeStamp);
+                enc->timestamp_end = enc->total_bytes_encoded;
                 break;
             case bp_pri_field_lifetime:
                 v7_encode_bp_lifetime(enc, &v->lifetime);
@@ -186,6 +189,152 @@ void v7_encode_bp_primary_block(v7_encode_state_t *enc, const bp_primary_block_t
     v7_encode_container(enc, num_fields, v7_encode_bp_primary_block_impl, v);
 }
 
+/*
+ * -----------------------------------------------------------------------------------
+ * PROFILE ENCODER - a straight-line encoder for the shape of primary block that nearly
+ * all traffic uses: no fragment, ipn endpoint IDs, and either no CRC or one that fits
+ * the CRC field of the generic encoder.  It produces exactly the same octets as
+ * v7_encode_bp_primary_block(), without going through the field tables and container
+ * callbacks, so it can be used whenever the block fits and the generic one otherwise.
+ *
+ * Define BPLIB_V7_NO_PROFILE_ENCODE to always use the generic encoder.
+ * -----------------------------------------------------------------------------------
+ */
+#ifndef BPLIB_V7_NO_PROFILE_ENCODE
+
+/*
+ * Puts a CBOR item head at p in the shortest form, as TinyCBOR does, returning its size
+ */
+static size_t v7_profile_put_head(uint8_t *p, CborType type, uint64_t val)
+{
+    size_t width;
+    size_t i;
+
+    if (val < 24)
+    {
+        p[0]  = (uint8_t)type | (uint8_t)val;
+        width = 0;
+    }
+    else if (val <= 0xFF)
+    {
+        p[0]  = (uint8_t)type | 24;
+        width = 1;
+    }
+    else if (val <= 0xFFFF)
+    {
+        p[0]  = (uint8_t)type | 25;
+        width = 2;
+    }
+    else if (val <= 0xFFFFFFFF)
+    {
+        p[0]  = (uint8_t)type | 26;
+        width = 4;
+    }
+    else
+    {
+        p[0]  = (uint8_t)type | 27;
+        width = 8;
+    }
+
+    for (i = width; i > 0; --i)
+    {
+        p[i] = val & 0xFF;
+        val >>= 8;
+    }
+
+    return 1 + width;
+}
+
+static size_t v7_profile_put_ipn_eid(uint8_t *p, const bp_endpointid_buffer_t *v)
+{
+    size_t n;
+
+    p[0] = (uint8_t)CborArrayType | 2;
+    p[1] = (uint8_t)CborIntegerType | bp_endpointid_scheme_ipn;
+    p[2] = (uint8_t)CborArrayType | 2;
+    n    = 3;
+    n += v7_profile_put_head(&p[n], CborIntegerType, v->ssp.ipn.node_number);
+    n += v7_profile_put_head(&p[n], CborIntegerType, v->ssp.ipn.service_number);
+
+    return n;
+}
+
+size_t v7_encode_bp_primary_block_profile(uint8_t *buf, const bp_primary_block_t *v)
+{
+    bplib_crc_parameters_t *crc_params;
+    bp_crcval_t             crc_val;
+    size_t                  crc_len;
+    size_t                  n;
+
+    if (v->version != 7 || v->controlFlags.isFragment || v->destinationEID.scheme != bp_endpointid_scheme_ipn ||
+        v->sourceEID.scheme != bp_endpointid_scheme_ipn || v->reportEID.scheme != bp_endpointid_scheme_ipn)
+    {
+        return 0;
+    }
+
+    crc_len    = 0;
+    crc_params = NULL;
+    if (v->crctype == bp_crctype_CRC16 || v->crctype == bp_crctype_CRC32C)
+    {
+        crc_params = v7_codec_get_crc_algorithm(v->crctype);
+        crc_len    = bplib_crc_get_width(crc_params) / 8;
+        if (crc_len > sizeof(bp_crcval_t))
+        {
+            return 0;
+        }
+    }
+    else if (v->crctype != bp_crctype_none)
+    {
+        return 0;
+    }
+
+    /* version, flags, crc type, 3 EIDs, timestamp and lifetime, then the CRC if there is one */
+    buf[0] = (uint8_t)CborArrayType | ((crc_params != NULL) ? 9 : 8);
+    buf[1] = (uint8_t)CborIntegerType | 7;
+    n      = 2;
+    n += v7_profile_put_head(&buf[n], CborIntegerType,
+                             v7_get_bitmap((const uint8_t *)&v->controlFlags, V7_BUNDLE_CONTROL_FLAGS_BITMAP_TABLE));
+    buf[n++] = (uint8_t)CborIntegerType | (uint8_t)v->crctype;
+    n += v7_profile_put_ipn_eid(&buf[n], &v->destinationEID);
+    n += v7_profile_put_ipn_eid(&buf[n], &v->sourceEID);
+    n += v7_profile_put_ipn_eid(&buf[n], &v->reportEID);
+    buf[n++] = (uint8_t)CborArrayType | 2;
+    n += v7_profile_put_head(&buf[n], CborIntegerType, v->creationTimeStamp.time);
+    n += v7_profile_put_head(&buf[n], CborIntegerType, v->creationTimeStamp.sequence_num);
+    n += v7_profile_put_head(&buf[n], CborIntegerType, v->lifetime);
+
+    if (crc_params != NULL)
+    {
+        /* the CRC covers the whole block with the value as zeros, then goes in place of them */
+        buf[n++] = (uint8_t)CborByteStringType | (uint8_t)crc_len;
+        memset(&buf[n], 0, crc_len);
+        n += crc_len;
+
+        crc_val = bplib_crc_update(crc_params, bplib_crc_initial_value(crc_params), buf, n);
+        crc_val = bplib_crc_finalize(crc_params, crc_val);
+        while (crc_len > 0)
+        {
+            --crc_len;
+            buf[n - 1 - crc_len] = (crc_val >> (crc_len * 8)) & 0xFF;
+        }
+    }
+
+    return n;
+}
+
+#else
+
+size_t v7_encode_bp_primary_block_profile(uint8_t *buf, const bp_primary_block_t *v)
+{
+    (void)buf;
+    (void)v;
+
+    /* always use the generic encoder */
+    return 0;
+}
+
+#endif /* BPLIB_V7_NO_PROFILE_ENCODE */
+
 void v7_decode_bp_sequencenumber(v7_decode_state_t *dec, bp_sequencenumber_t *v)
 {
     v7_decode_bp_integer(dec, v);
@@ -297,3 +446,75 @@ void v7_decode_bp_primary_block(v7_decode_state_t *dec, bp_primary_block_t *v)
 {
     v7_decode_container(dec, CborIndefiniteLength, v7_decode_bp_primary_block_impl, v);
 }
+
+/*
+ * -----------------------------------------------------------------------------------
+ * PROFILE DECODER - the decode side of v7_encode_bp_primary_block_profile(), reading
+ * the raw CBOR directly.  Each field is just an inline head read (see v7_raw_get_head())
+ * rather than a TinyCBOR call and advance.  Anything which is not in that profile returns
+ * 0, and is then decoded by v7_decode_bp_primary_block() as usual, which also reports any
+ * real problem with it.
+ * -----------------------------------------------------------------------------------
+ */
+
+static void v7_raw_get_ipn_eid(v7_raw_reader_t *rd, bp_endpointid_buffer_t *v)
+{
+    v7_raw_get_array(rd, 2);
+    if (v7_raw_get_small_int(rd) != bp_endpointid_scheme_ipn)
+    {
+        rd->error = true;
+    }
+
+    v7_raw_get_array(rd, 2);
+    v->scheme                 = bp_endpointid_scheme_ipn;
+    v->ssp.ipn.node_number    = v7_raw_get_uint(rd);
+    v->ssp.ipn.service_number = v7_raw_get_uint(rd);
+}
+
+size_t v7_decode_bp_primary_block_profile(const uint8_t *ptr, size_t size, bp_primary_block_t *v)
+{
+    v7_raw_reader_t rd;
+    uint64_t        num_fields;
+
+    rd.ptr   = ptr;
+    rd.end   = ptr + size;
+    rd.error = false;
+
+    /* 8 fields, or 9 with a CRC, not a fragment */
+    if (v7_raw_get_head(&rd, &num_fields) != CborArrayType || num_fields < 8 || num_fields > 9)
+    {
+        return 0;
+    }
+
+    v->version = (uint8_t)v7_raw_get_small_int(&rd);
+    v7_set_bitmap((uint8_t *)&v->controlFlags, V7_BUNDLE_CONTROL_FLAGS_BITMAP_TABLE, v7_raw_get_uint(&rd));
+    v->crctype = (bp_crctype_t)v7_raw_get_small_int(&rd);
+
+    if (v->version != 7 || v->controlFlags.isFragment || (num_fields == 9) != (v->crctype != bp_crctype_none))
+    {
+        return 0;
+    }
+
+    v7_raw_get_ipn_eid(&rd, &v->destinationEID);
+    v7_raw_get_ipn_eid(&rd, &v->sourceEID);
+    v7_raw_get_ipn_eid(&rd, &v->reportEID);
+
+    v7_raw_get_array(&rd, 2);
+    v->creationTimeStamp.time         = v7_raw_get_uint(&rd);
+    v->creationTimeStamp.sequence_num = v7_raw_get_uint(&rd);
+    v->lifetime                       = v7_raw_get_uint(&rd);
+    v->fragmentOffset                 = 0;
+    v->totalADUlength                 = 0;
+
+    if (v->crctype != bp_crctype_none)
+    {
+        v->crcval = v7_raw_get_crc(&rd);
+    }
+
+    if (rd.error)
+    {
+        return 0;
+    }
+
+    return rd.ptr - ptr;
+}
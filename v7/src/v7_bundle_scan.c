@@ -0,0 +1,306 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "v7_decode_internal.h"
+
+/*
+ * Nesting allowed within a block.  This is plenty for any block defined by RFC9171
+ * or the extensions implemented here, and keeps a malformed bundle from going deep.
+ */
+#define V7_SCAN_MAX_DEPTH 8
+
+/*
+ * -----------------------------------------------------------------------------------
+ * IMPLEMENTATION
+ * Helpers for walking the raw CBOR, without TinyCBOR
+ * -----------------------------------------------------------------------------------
+ */
+
+static void v7_scan_skip_bytes(v7_raw_reader_t *scan, uint64_t count)
+{
+    if (!scan->error && count > (uint64_t)(scan->end - scan->ptr))
+    {
+        scan->error = true;
+    }
+
+    if (!scan->error)
+    {
+        scan->ptr += count;
+    }
+}
+
+/*
+ * Skips over the next item, whatever it is, including everything nested within it
+ */
+static void v7_scan_skip_item(v7_raw_reader_t *scan, size_t depth)
+{
+    uint64_t arg;
+    uint8_t  type;
+
+    type = v7_raw_get_head(scan, &arg);
+    switch (type)
+    {
+        case CborByteStringType:
+        case CborTextStringType:
+            v7_scan_skip_bytes(scan, arg);
+            break;
+
+        case CborMapType:
+        case CborArrayType:
+        case CborTagType:
+            if (type == CborTagType)
+            {
+                /* a tag applies to the one item after it */
+                arg = 1;
+            }
+            else if (type == CborMapType)
+            {
+                /* every entry is a key and a value */
+                arg = (arg > (UINT64_MAX / 2)) ? UINT64_MAX : (arg * 2);
+            }
+
+            /* every item is at least a byte, so a count larger than what is left is not valid */
+            if (depth >= V7_SCAN_MAX_DEPTH || arg > (uint64_t)(scan->end - scan->ptr))
+            {
+                scan->error = true;
+            }
+
+            while (arg > 0 && !scan->error)
+            {
+                v7_scan_skip_item(scan, depth + 1);
+                --arg;
+            }
+            break;
+
+        default:
+            /* integers and simple values are entirely in the head */
+            break;
+    }
+}
+
+/*
+ * The primary block is only scanned to find its size and CRC, all the rest is left to the real decode
+ */
+static void v7_scan_primary_block(v7_raw_reader_t *scan, v7_scan_block_t *block)
+{
+    uint64_t num_fields;
+    uint64_t i;
+
+    /* version, flags, crc type, 3 EIDs, timestamp and lifetime, then maybe fragment info and CRC */
+    if (v7_raw_get_head(scan, &num_fields) != CborArrayType || num_fields < 8 || num_fields > 11)
+    {
+        scan->error = true;
+    }
+
+    for (i = 0; i < num_fields && !scan->error; ++i)
+    {
+        if (i == 2)
+        {
+            block->crctype = (bp_crctype_t)v7_raw_get_small_int(scan);
+        }
+        else if (i == (num_fields - 1) && block->crctype != bp_crctype_none)
+        {
+            block->crcval = v7_raw_get_crc(scan);
+        }
+        else
+        {
+            v7_scan_skip_item(scan, 1);
+        }
+    }
+}
+
+/*
+ * Everything in a canonical block before the content itself, up to and including the head of the byte string
+ */
+static void v7_scan_canonical_fields(v7_raw_reader_t *scan, v7_scan_block_t *block)
+{
+    uint64_t num_fields;
+    uint64_t content_size;
+
+    if (v7_raw_get_head(scan, &num_fields) != CborArrayType || num_fields < 5 || num_fields > 6)
+    {
+        scan->error = true;
+        return;
+    }
+
+    block->block_type = (bp_blocktype_t)v7_raw_get_small_int(scan);
+    block->block_num  = (bp_blocknum_t)v7_raw_get_small_int(scan);
+    block->flags      = v7_raw_get_uint(scan);
+    block->crctype    = (bp_crctype_t)v7_raw_get_small_int(scan);
+
+    /* there is a CRC value if and only if there is a CRC type */
+    if ((num_fields == 6) != (block->crctype != bp_crctype_none))
+    {
+        scan->error = true;
+    }
+
+    /* the content is a byte string, which may itself be CBOR, but that is not looked at here */
+    if (v7_raw_get_head(scan, &content_size) != CborByteStringType || content_size > SIZE_MAX)
+    {
+        scan->error = true;
+    }
+
+    block->content_size = content_size;
+}
+
+static void v7_scan_canonical_block(v7_raw_reader_t *scan, const uint8_t *block_start, v7_scan_block_t *block)
+{
+    v7_scan_canonical_fields(scan, block);
+
+    if (!scan->error)
+    {
+        block->content_offset = scan->ptr - block_start;
+        v7_scan_skip_bytes(scan, block->content_size);
+    }
+
+    if (block->crctype != bp_crctype_none)
+    {
+        block->crcval = v7_raw_get_crc(scan);
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------------
+ * EXPORTED FUNCTIONS
+ * -----------------------------------------------------------------------------------
+ */
+
+size_t v7_scan_block(const void *buffer, size_t buf_sz, bool is_primary, v7_scan_block_t *block)
+{
+    v7_raw_reader_t scan;
+
+    memset(block, 0, sizeof(*block));
+
+    scan.ptr   = buffer;
+    scan.end   = scan.ptr + buf_sz;
+    scan.error = false;
+
+    if (is_primary)
+    {
+        v7_scan_primary_block(&scan, block);
+    }
+    else
+    {
+        v7_scan_canonical_block(&scan, buffer, block);
+    }
+
+    if (scan.error)
+    {
+        return 0;
+    }
+
+    block->size = scan.ptr - (const uint8_t *)buffer;
+    return block->size;
+}
+
+size_t v7_scan_canonical_head(const void *buffer, size_t buf_sz, v7_scan_block_t *block)
+{
+    v7_raw_reader_t scan;
+
+    memset(block, 0, sizeof(*block));
+
+    scan.ptr   = buffer;
+    scan.end   = scan.ptr + buf_sz;
+    scan.error = false;
+
+    v7_scan_canonical_fields(&scan, block);
+    if (scan.error)
+    {
+        return 0;
+    }
+
+    block->content_offset = scan.ptr - (const uint8_t *)buffer;
+    return block->content_offset;
+}
+
+size_t v7_scan_bundle(const void *buffer, size_t buf_sz, v7_scan_table_t *table)
+{
+    const uint8_t *ptr;
+    const uint8_t *end;
+    size_t         block_size;
+
+    memset(table, 0, sizeof(*table));
+
+    ptr = buffer;
+    end = ptr + buf_sz;
+    if (buf_sz < 2 || *ptr != 0x9F) /* CBOR indefinite-length array */
+    {
+        return 0;
+    }
+
+    ++ptr;
+
+    /* every block is a definite length array, up to the break code after the last one */
+    while (ptr < end && *ptr != 0xFF)
+    {
+        /* First block is always a primary block, anything beyond that is a canonical block */
+        block_size = 0;
+        if (table->num_blocks < V7_SCAN_MAX_BLOCKS)
+        {
+            block_size = v7_scan_block(ptr, end - ptr, table->num_blocks == 0, &table->blocks[table->num_blocks]);
+        }
+
+        if (block_size == 0)
+        {
+            table->num_blocks = 0;
+            return 0;
+        }
+
+        table->blocks[table->num_blocks].offset = ptr - (const uint8_t *)buffer;
+        ptr += block_size;
+        ++table->num_blocks;
+    }
+
+    if (ptr >= end || table->num_blocks == 0)
+    {
+        table->num_blocks = 0;
+        return 0;
+    }
+
+    /* the break code */
+    ++ptr;
+    table->bundle_size = ptr - (const uint8_t *)buffer;
+
+    return table->bundle_size;
+}
+
+bool v7_scan_verify_canonical_crcs(const void *buffer, const v7_scan_table_t *table)
+{
+    const v7_scan_block_t *block;
+    size_t                 i;
+
+    /* the primary block is left out, because decoding it checks the CRC anyway */
+    for (i = 1; i < table->num_blocks; ++i)
+    {
+        block = &table->blocks[i];
+        if (block->crctype != bp_crctype_none &&
+            !v7_verify_block_crc((const uint8_t *)buffer + block->offset, block->size, block->crctype,
+                                 block->crcval))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -22,7 +22,7 @@
  INCLUDES
  ******************************************************************************/
 
-#include "v7_codec_internal.h"
+#include "v7_decode_internal.h"
 #include "cbor.h"
 
 bplib_crc_parameters_t *v7_codec_get_crc_algorithm(bp_crctype_t crctype)
@@ -72,6 +72,10 @@ size_t v7_compute_full_bundle_size(bplib_mpool_bblock_primary_t *cpb)
     int                             last_encode;
     size_t                          sum_result;
 
+    /*
+     * The bundle size is kept up to date as blocks are encoded, appended, or dropped, so once every
+     * block is encoded this is known without going through the blocks.
+     */
     if (cpb->bundle_encode_size_cache == 0)
     {
         /*
@@ -171,14 +175,325 @@ size_t v7_copy_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer,
     return (out_p - (uint8_t *)buffer);
 }
 
-size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz)
+size_t v7_encode_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz)
+{
+    size_t                          remain_sz;
+    size_t                          block_sz;
+    uint8_t                        *out_p;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+
+    /* as in v7_copy_full_bundle_out(), these two bytes are for the array around the blocks */
+    if (buf_sz < 2)
+    {
+        return 0;
+    }
+
+    out_p  = buffer;
+    *out_p = 0x9F; /* Start CBOR indefinite-length array */
+    ++out_p;
+
+    remain_sz = buf_sz - 2;
+
+    /* a block which is already encoded is copied out, otherwise it is encoded into the buffer */
+    if (cpb->block_encode_size_cache == 0)
+    {
+        block_sz = v7_block_encode_pri_flat(cpb, out_p, remain_sz);
+    }
+    else if (cpb->block_encode_size_cache <= remain_sz)
+    {
+        block_sz = bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_primary_get_encoded_chunks(cpb), out_p,
+                                                  remain_sz, 0, -1);
+    }
+    else
+    {
+        block_sz = 0;
+    }
+
+    cblk = bplib_mpool_bblock_primary_get_canonical_list(cpb);
+    while (block_sz != 0)
+    {
+        out_p += block_sz;
+        remain_sz -= block_sz;
+
+        cblk = bplib_mpool_get_next_block(cblk);
+        ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+        if (ccb == NULL)
+        {
+            /* all of the blocks are done */
+            *out_p = 0xFF; /* End CBOR indefinite-length array (break code) */
+            ++out_p;
+
+            return (out_p - (uint8_t *)buffer);
+        }
+
+        if (ccb->block_encode_size_cache == 0)
+        {
+            block_sz = v7_block_encode_canonical_flat(ccb, out_p, remain_sz);
+        }
+        else if (ccb->block_encode_size_cache <= remain_sz)
+        {
+            block_sz = bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), out_p,
+                                                      remain_sz, 0, -1);
+        }
+        else
+        {
+            block_sz = 0;
+        }
+    }
+
+    /* a block did not fit, or could not be encoded */
+    return 0;
+}
+
+/*
+ * Adds the entries for one list of encoded chunks after the iov_count entries already used
+ */
+static size_t v7_export_chunks_iov(bplib_mpool_block_t *list, bplib_iovec_t *iov, size_t max_iov, size_t iov_count)
+{
+    if (iov_count < max_iov)
+    {
+        return bplib_mpool_bblock_cbor_export_iov(list, &iov[iov_count], max_iov - iov_count);
+    }
+
+    /* this still counts the entries needed */
+    return bplib_mpool_bblock_cbor_export_iov(list, NULL, 0);
+}
+
+size_t v7_export_full_bundle_iov(bplib_mpool_bblock_primary_t *cpb, bplib_iovec_t *iov, size_t max_iov)
+{
+    /* the CBOR indefinite-length array that wraps the bundle, which is not stored with it */
+    static const uint8_t ARRAY_START = 0x9F;
+    static const uint8_t ARRAY_BREAK = 0xFF;
+
+    size_t                          iov_count;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+
+    /* one entry is put in front for the start of the array, the rest only if there is room */
+    if (max_iov > 0)
+    {
+        iov[0].base = &ARRAY_START;
+        iov[0].len  = sizeof(ARRAY_START);
+    }
+    iov_count = 1;
+
+    iov_count += v7_export_chunks_iov(bplib_mpool_bblock_primary_get_encoded_chunks(cpb), iov, max_iov, iov_count);
+    cblk = bplib_mpool_bblock_primary_get_canonical_list(cpb);
+    while (true)
+    {
+        cblk = bplib_mpool_get_next_block(cblk);
+        ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+        if (ccb == NULL)
+        {
+            break;
+        }
+        iov_count +=
+            v7_export_chunks_iov(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), iov, max_iov, iov_count);
+    }
+
+    if (iov_count < max_iov)
+    {
+        iov[iov_count].base = &ARRAY_BREAK;
+        iov[iov_count].len  = sizeof(ARRAY_BREAK);
+    }
+    ++iov_count;
+
+    return iov_count;
+}
+
+size_t v7_stream_export_begin(v7_stream_export_t *sxs, bplib_mpool_bblock_primary_t *cpb)
+{
+    memset(sxs, 0, sizeof(*sxs));
+
+    sxs->cpb        = cpb;
+    sxs->cblk       = bplib_mpool_bblock_primary_get_canonical_list(cpb);
+    sxs->total_size = v7_compute_full_bundle_size(cpb);
+
+    /* the chunks are read where they are, the stream never holds any of its own so it needs no pool */
+    bplib_mpool_start_stream_init(&sxs->mps, NULL, bplib_mpool_stream_dir_read);
+    bplib_mpool_stream_read_list(&sxs->mps, bplib_mpool_bblock_primary_get_encoded_chunks(cpb));
+
+    return sxs->total_size;
+}
+
+size_t v7_stream_export_next(v7_stream_export_t *sxs, void *buffer, size_t buf_sz)
+{
+    bplib_mpool_bblock_canonical_t *ccb;
+    uint8_t                        *out_p;
+    size_t                          remain_sz;
+    size_t                          chunk_sz;
+
+    if (sxs->total_size == 0)
+    {
+        /* the bundle could not be encoded */
+        return 0;
+    }
+
+    out_p     = buffer;
+    remain_sz = buf_sz;
+
+    if (remain_sz > 0 && sxs->total_out == 0)
+    {
+        *out_p = 0x9F; /* Start CBOR indefinite-length array */
+        ++out_p;
+        --remain_sz;
+    }
+
+    /* the primary block first, then each canonical block in turn, the same as v7_copy_full_bundle_out() */
+    while (remain_sz > 0 && !sxs->blocks_done)
+    {
+        chunk_sz = bplib_mpool_stream_read(&sxs->mps, out_p, remain_sz);
+        out_p += chunk_sz;
+        remain_sz -= chunk_sz;
+
+        if (remain_sz > 0)
+        {
+            /* nothing more in this block */
+            sxs->cblk = bplib_mpool_get_next_block(sxs->cblk);
+            ccb       = bplib_mpool_bblock_canonical_cast(sxs->cblk);
+            if (ccb == NULL)
+            {
+                sxs->blocks_done = true;
+            }
+            else
+            {
+                bplib_mpool_stream_read_list(&sxs->mps, bplib_mpool_bblock_canonical_get_encoded_chunks(ccb));
+            }
+        }
+    }
+
+    if (remain_sz > 0 && sxs->blocks_done && !sxs->break_done)
+    {
+        *out_p = 0xFF; /* End CBOR indefinite-length array (break code) */
+        ++out_p;
+        sxs->break_done = true;
+    }
+
+    sxs->total_out += out_p - (uint8_t *)buffer;
+
+    return out_p - (uint8_t *)buffer;
+}
+
+void v7_apply_extension_block_hint(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_bblock_canonical_t *ccb,
+                                   bp_blocktype_t *payload_block_hint)
+{
+    /* check for certain special/known extension blocks that indicate how to interpret
+     * the payload.  The presence (or not) of these blocks changes gives a hint as
+     * to what the payload should be.  Since the payload block is last by definition,
+     * the identifying extension block should always be found first.
+     *
+     * The challenge comes if more than one of these blocks exists in the same bundle,
+     * it gets fuzzy how this should work.
+     */
+    switch (ccb->canonical_logical_data.canonical_block.blockType)
+    {
+        case bp_blocktype_payloadConfidentialityBlock:
+            /* bpsec not implemented yet, but this is the idea */
+            if (*payload_block_hint == bp_blocktype_undefined)
+            {
+                *payload_block_hint = bp_blocktype_ciphertextPayloadBlock;
+            }
+            break;
+
+        case bp_blocktype_custodyTrackingBlock:
+            /* if this block is present it requests full custody tracking */
+            cpb->data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
+            break;
+
+        default:
+            /* nothing to do */
+            break;
+    }
+}
+
+/*
+ * Decodes a full bundle which has already been through v7_scan_bundle().  All the CRCs of the canonical
+ * blocks are checked up front, so nothing gets allocated for a bundle that is going to be dropped anyway,
+ * and after that each block is saved using the offsets in the table rather than walking the CBOR again.
+ */
+static size_t v7_import_scanned_bundle(bplib_mpool_bblock_primary_t *cpb, const void *buffer,
+                                       const v7_scan_table_t *table, bplib_mpool_ref_t source_ref,
+                                       uint32_t import_flags)
+{
+    const v7_scan_block_t *scanned;
+    const uint8_t         *base;
+    bp_blocktype_t         payload_block_hint;
+    bplib_mpool_t         *ppool;
+    size_t                 i;
+
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+
+    /* the CRCs can also be checked later, on the chunks that are saved here */
+    if ((import_flags & V7_IMPORT_DEFER_CRC) == 0 && !v7_scan_verify_canonical_crcs(buffer, table))
+    {
+        return 0;
+    }
+
+    base    = buffer;
+    ppool   = bplib_mpool_get_parent_pool_from_link(&cpb->chunk_list);
+    scanned = &table->blocks[0];
+
+    /* First block is always a primary block, it is decoded (and its CRC checked) the usual way */
+    if (v7_block_decode_pri_ext(cpb, base + scanned->offset, scanned->size, source_ref) < 0 ||
+        cpb->block_encode_size_cache != scanned->size)
+    {
+        return 0;
+    }
+
+    /* see the comment in v7_import_full_bundle() regarding the payload hint */
+    payload_block_hint = bp_blocktype_undefined;
+    if (cpb->data.logical.controlFlags.isAdminRecord)
+    {
+        payload_block_hint = bp_blocktype_adminRecordPayloadBlock;
+    }
+
+    for (i = 1; i < table->num_blocks; ++i)
+    {
+        scanned = &table->blocks[i];
+
+        cblk = bplib_mpool_bblock_canonical_alloc(ppool, 0, NULL);
+        ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+        if (ccb == NULL)
+        {
+            /* no mem */
+            return 0;
+        }
+
+        /* Preemptively store it; the whole chain will be discarded if decode fails */
+        bplib_mpool_bblock_primary_append(cpb, cblk);
+
+        if (v7_block_decode_canonical_scanned(ccb, base + scanned->offset, scanned, payload_block_hint, source_ref,
+                                              (import_flags & V7_IMPORT_LAZY_DECODE) != 0) < 0)
+        {
+            return 0;
+        }
+
+        v7_apply_extension_block_hint(cpb, ccb, &payload_block_hint);
+    }
+
+    cpb->data.delivery.crc_deferred = ((import_flags & V7_IMPORT_DEFER_CRC) != 0);
+    cpb->bundle_encode_size_cache   = table->bundle_size;
+
+    return cpb->bundle_encode_size_cache;
+}
+
+/*
+ * Decodes a full bundle into cpb.  If source_ref is not NULL then the buffer is the data of that CBOR block,
+ * and the encoded blocks refer to it instead of being copied.  The import_flags are a set of V7_IMPORT_* options.
+ */
+static size_t v7_import_full_bundle(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz,
+                                    bplib_mpool_ref_t source_ref, uint32_t import_flags)
 {
     size_t         remain_sz;
     size_t         chunk_sz;
     const uint8_t *in_p;
     bp_blocktype_t payload_block_hint;
     bplib_mpool_t *ppool;
+    int            status;
 
+    v7_scan_table_t                 scan_table;
     bplib_mpool_block_t            *cblk;
     bplib_mpool_bblock_canonical_t *ccb;
 
@@ -190,10 +505,8 @@ size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buf
     bplib_mpool_bblock_primary_drop_encode(cpb);
 
     /* also drop any existing canonical blocks */
-    if (bplib_mpool_is_nonempty_list_head(&cpb->cblock_list))
-    {
-        bplib_mpool_recycle_all_blocks_in_list(NULL, &cpb->cblock_list);
-    }
+    bplib_mpool_bblock_primary_drop_canonical_blocks(cpb);
+    cpb->data.delivery.crc_deferred = false;
 
     /*
      * two bytes is just the overhead added by this routine.  It is definitely not enough
@@ -211,6 +524,15 @@ size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buf
         return 0;
     }
 
+    /*
+     * Normally the whole bundle can be framed in one pass over the raw CBOR, but if the scanner
+     * does not accept it (e.g. more blocks than it keeps track of) then go through it block by block.
+     */
+    if (v7_scan_bundle(buffer, buf_sz, &scan_table) != 0)
+    {
+        return v7_import_scanned_bundle(cpb, buffer, &scan_table, source_ref, import_flags);
+    }
+
     ++in_p;
     remain_sz = buf_sz - 2;
 
@@ -235,7 +557,7 @@ size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buf
         {
             /* First block is always a primary block */
             /* Decode Primary Block */
-            if (v7_block_decode_pri(cpb, in_p, remain_sz) < 0)
+            if (v7_block_decode_pri_ext(cpb, in_p, remain_sz, source_ref) < 0)
             {
                 /* fail to decode */
                 break;
@@ -266,7 +588,16 @@ size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buf
             bplib_mpool_bblock_primary_append(cpb, cblk);
 
             /* Decode Canonical/Payload Block */
-            if (v7_block_decode_canonical(ccb, in_p, remain_sz, payload_block_hint) < 0)
+            if ((import_flags & V7_IMPORT_LAZY_DECODE) != 0)
+            {
+                status = v7_block_frame_canonical_ext(ccb, in_p, remain_sz, payload_block_hint, source_ref);
+            }
+            else
+            {
+                status = v7_block_decode_canonical_ext(ccb, in_p, remain_sz, payload_block_hint, source_ref);
+            }
+
+            if (status < 0)
             {
                 /* fail to decode */
                 break;
@@ -274,33 +605,7 @@ size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buf
 
             chunk_sz = ccb->block_encode_size_cache;
 
-            /* check for certain special/known extension blocks that indicate how to interpret
-             * the payload.  The presence (or not) of these blocks changes gives a hint as
-             * to what the payload should be.  Since the payload block is last by definition,
-             * the identifying extension block should always be found first.
-             *
-             * The challenge comes if more than one of these blocks exists in the same bundle,
-             * it gets fuzzy how this should work.
-             */
-            switch (ccb->canonical_logical_data.canonical_block.blockType)
-            {
-                case bp_blocktype_payloadConfidentialityBlock:
-                    /* bpsec not implemented yet, but this is the idea */
-                    if (payload_block_hint == bp_blocktype_undefined)
-                    {
-                        payload_block_hint = bp_blocktype_ciphertextPayloadBlock;
-                    }
-                    break;
-
-                case bp_blocktype_custodyTrackingBlock:
-                    /* if this block is present it requests full custody tracking */
-                    cpb->data.delivery.delivery_policy = bplib_policy_delivery_custody_tracking;
-                    break;
-
-                default:
-                    /* nothing to do */
-                    break;
-            }
+            v7_apply_extension_block_hint(cpb, ccb, &payload_block_hint);
         }
 
         in_p += chunk_sz;
@@ -324,3 +629,57 @@ size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buf
 
     return cpb->bundle_encode_size_cache;
 }
+
+size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz,
+                              uint32_t import_flags)
+{
+    return v7_import_full_bundle(cpb, buffer, buf_sz, NULL, import_flags);
+}
+
+size_t v7_adopt_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t buffer_ref, size_t buf_sz,
+                               uint32_t import_flags)
+{
+    const void *buffer;
+
+    buffer = bplib_mpool_bblock_cbor_cast(bplib_mpool_dereference(buffer_ref));
+    if (buffer == NULL || buf_sz > bplib_mpool_get_user_content_size(bplib_mpool_dereference(buffer_ref)))
+    {
+        return 0;
+    }
+
+    return v7_import_full_bundle(cpb, buffer, buf_sz, buffer_ref, import_flags);
+}
+
+bool v7_verify_deferred_crcs(bplib_mpool_bblock_primary_t *cpb)
+{
+    bplib_mpool_block_t            *blk;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bp_canonical_bundle_block_t    *block;
+
+    if (!cpb->data.delivery.crc_deferred)
+    {
+        return true;
+    }
+
+    blk = bplib_mpool_bblock_primary_get_canonical_list(cpb);
+    while (true)
+    {
+        blk = bplib_mpool_get_next_block(blk);
+        ccb = bplib_mpool_bblock_canonical_cast(blk);
+        if (ccb == NULL)
+        {
+            break;
+        }
+
+        block = &bplib_mpool_bblock_canonical_get_logical(ccb)->canonical_block;
+        if (block->crctype != bp_crctype_none &&
+            !v7_verify_block_crc_chunks(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb),
+                                        ccb->block_encode_size_cache, block->crctype, block->crcval))
+        {
+            return false;
+        }
+    }
+
+    cpb->data.delivery.crc_deferred = false;
+    return true;
+}
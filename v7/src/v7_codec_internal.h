@@ -32,6 +32,7 @@
 #include "v7_encode.h"
 #include "v7_codec.h"
 #include "v7_mpool_bblocks.h"
+#include "v7_mpool_ref.h"
 #include "v7_mpstream.h"
 #include "crc.h"
 
@@ -32,6 +32,14 @@
  * -----------------------------------------------------------------------------------
  */
 
+void v7_encode_bp_custody_acceptance_range_impl(v7_encode_state_t *enc, const void *arg)
+{
+    const bp_custody_seq_range_t *v = arg;
+
+    v7_encode_bp_integer(enc, &v->first_seq);
+    v7_encode_bp_integer(enc, &v->count);
+}
+
 void v7_encode_bp_custody_acceptance_seqlist_impl(v7_encode_state_t *enc, const void *arg)
 {
     const bp_custody_accept_payload_block_t *v = arg;
@@ -39,7 +47,15 @@ void v7_encode_bp_custody_acceptance_seqlist_impl(v7_encode_state_t *enc, const
 
     for (n = 0; n < v->num_entries && !enc->error; ++n)
     {
-        v7_encode_bp_integer(enc, &v->sequence_nums[n]);
+        /* a single sequence number stays a plain integer, so a DACS without runs is the same as it always was */
+        if (v->ranges[n].count == 1)
+        {
+            v7_encode_bp_integer(enc, &v->ranges[n].first_seq);
+        }
+        else
+        {
+            v7_encode_container(enc, 2, v7_encode_bp_custody_acceptance_range_impl, &v->ranges[n]);
+        }
     }
 }
 
@@ -56,13 +72,38 @@ void v7_encode_bp_custody_acknowledement_record(v7_encode_state_t *enc, const bp
     v7_encode_container(enc, 2, v7_encode_bp_custody_acknowledement_record_impl, v);
 }
 
+void v7_decode_bp_custody_acceptance_range_impl(v7_decode_state_t *dec, void *arg)
+{
+    bp_custody_seq_range_t *v = arg;
+
+    v7_decode_bp_integer(dec, &v->first_seq);
+    v7_decode_bp_integer(dec, &v->count);
+
+    /* an empty run means nothing, and a very long one would take too long to process */
+    if (v->count == 0 || v->count > BP_DACS_MAX_SEQ_PER_RANGE || (v->first_seq + v->count) < v->first_seq)
+    {
+        dec->error = true;
+    }
+}
+
 void v7_decode_bp_custody_acceptance_seqlist_impl(v7_decode_state_t *dec, void *arg)
 {
     bp_custody_accept_payload_block_t *v = arg;
+    bp_custody_seq_range_t            *range;
 
     while (!cbor_value_at_end(dec->cbor) && v->num_entries < BP_DACS_MAX_SEQ_PER_PAYLOAD)
     {
-        v7_decode_bp_integer(dec, &v->sequence_nums[v->num_entries]);
+        range = &v->ranges[v->num_entries];
+        if (cbor_value_get_type(dec->cbor) == CborArrayType)
+        {
+            v7_decode_container(dec, 2, v7_decode_bp_custody_acceptance_range_impl, range);
+        }
+        else
+        {
+            v7_decode_bp_integer(dec, &range->first_seq);
+            range->count = 1;
+        }
+
         if (dec->error)
         {
             break;
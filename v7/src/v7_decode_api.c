@@ -48,6 +48,21 @@
 size_t v7_save_and_verify_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size,
                                 bp_crctype_t crc_type, bp_crcval_t crc_check);
 
+/*
+ * Same as v7_save_and_verify_block(), but for a block that is already in pool memory, within the
+ * CBOR data block referred to by source_ref.  Instead of copying the data, a slice of the source
+ * block is attached, which holds its own reference to the source.
+ */
+size_t v7_slice_and_verify_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref, const uint8_t *block_base,
+                                 size_t block_size, bp_crctype_t crc_type, bp_crcval_t crc_check);
+
+/*
+ * The same two without the CRC check, for blocks whose CRC was already checked (see v7_scan_bundle()).
+ */
+size_t v7_save_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size);
+size_t v7_slice_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref, const uint8_t *block_base,
+                      size_t block_size);
+
 /*
  * -----------------------------------------------------------------------------------
  * IMPLEMENTATION
@@ -55,39 +70,78 @@ size_t v7_save_and_verify_block(bplib_mpool_block_t *head, const uint8_t *block_
  * -----------------------------------------------------------------------------------
  */
 
-size_t v7_save_and_verify_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size,
-                                bp_crctype_t crc_type, bp_crcval_t crc_check)
+bool v7_verify_block_crc(const uint8_t *block_base, size_t block_size, bp_crctype_t crc_type, bp_crcval_t crc_check)
 {
     static const uint8_t    ZERO_BYTES[4] = {0};
     size_t                  crc_len;
     bplib_crc_parameters_t *crc_params;
     bp_crcval_t             crc_val;
-    bplib_mpool_stream_t    mps;
-    size_t                  result;
 
-    result = 0;
-    bplib_mpool_start_stream_init(&mps, bplib_mpool_get_parent_pool_from_link(head), bplib_mpool_stream_dir_write);
     crc_params = v7_codec_get_crc_algorithm(crc_type);
     crc_len    = bplib_crc_get_width(crc_params) / 8;
     crc_val    = bplib_crc_initial_value(crc_params);
-    if (crc_len < block_size && crc_len <= sizeof(ZERO_BYTES))
+    if (crc_len >= block_size || crc_len > sizeof(ZERO_BYTES))
     {
-        /* copy the entire block including original (still unverified) CRC to the buffer */
-        if (bplib_mpool_stream_write(&mps, block_base, block_size) == block_size)
-        {
-            /* calculate the CRC value locally */
-            crc_val = bplib_crc_update(crc_params, crc_val, block_base, block_size - crc_len);
-
-            /* need to pump in zero bytes for CRC width */
-            crc_val = bplib_crc_update(crc_params, crc_val, ZERO_BYTES, crc_len);
-            crc_val = bplib_crc_finalize(crc_params, crc_val);
-
-            if (crc_val == crc_check)
-            {
-                result = block_size;
-                bplib_mpool_stream_attach(&mps, head);
-            }
-        }
+        return false;
+    }
+
+    /* calculate the CRC value locally */
+    crc_val = bplib_crc_update(crc_params, crc_val, block_base, block_size - crc_len);
+
+    /* need to pump in zero bytes for CRC width */
+    crc_val = bplib_crc_update(crc_params, crc_val, ZERO_BYTES, crc_len);
+    crc_val = bplib_crc_finalize(crc_params, crc_val);
+
+    return (crc_val == crc_check);
+}
+
+/*
+ * Same as v7_verify_block_crc(), for a block that is already saved in the list of CBOR chunks at head
+ */
+bool v7_verify_block_crc_chunks(bplib_mpool_block_t *head, size_t block_size, bp_crctype_t crc_type,
+                                bp_crcval_t crc_check)
+{
+    static const uint8_t    ZERO_BYTES[4] = {0};
+    size_t                  crc_len;
+    bplib_crc_parameters_t *crc_params;
+    bp_crcval_t             crc_val;
+
+    crc_params = v7_codec_get_crc_algorithm(crc_type);
+    crc_len    = bplib_crc_get_width(crc_params) / 8;
+    crc_val    = bplib_crc_initial_value(crc_params);
+    if (crc_len >= block_size || crc_len > sizeof(ZERO_BYTES))
+    {
+        return false;
+    }
+
+    /* calculate the CRC value over everything up to the CRC itself, in one pass over the chunks */
+    if (bplib_mpool_bblock_cbor_crc_update(head, crc_params, &crc_val, 0, block_size - crc_len) !=
+        (block_size - crc_len))
+    {
+        /* the block is not all there */
+        return false;
+    }
+
+    /* need to pump in zero bytes for CRC width */
+    crc_val = bplib_crc_update(crc_params, crc_val, ZERO_BYTES, crc_len);
+    crc_val = bplib_crc_finalize(crc_params, crc_val);
+
+    return (crc_val == crc_check);
+}
+
+size_t v7_save_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size)
+{
+    bplib_mpool_stream_t mps;
+    size_t               result;
+
+    result = 0;
+    bplib_mpool_start_stream_init(&mps, bplib_mpool_get_parent_pool_from_link(head), bplib_mpool_stream_dir_write);
+
+    /* copy the entire block including the original CRC to the buffer */
+    if (bplib_mpool_stream_write(&mps, block_base, block_size) == block_size)
+    {
+        result = block_size;
+        bplib_mpool_stream_attach(&mps, head);
     }
 
     bplib_mpool_stream_close(&mps);
@@ -95,12 +149,65 @@ size_t v7_save_and_verify_block(bplib_mpool_block_t *head, const uint8_t *block_
     return result;
 }
 
+size_t v7_save_and_verify_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size,
+                                bp_crctype_t crc_type, bp_crcval_t crc_check)
+{
+    if (!v7_verify_block_crc(block_base, block_size, crc_type, crc_check))
+    {
+        return 0;
+    }
+
+    return v7_save_block(head, block_base, block_size);
+}
+
+size_t v7_slice_and_verify_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref, const uint8_t *block_base,
+                                 size_t block_size, bp_crctype_t crc_type, bp_crcval_t crc_check)
+{
+    if (!v7_verify_block_crc(block_base, block_size, crc_type, crc_check))
+    {
+        return 0;
+    }
+
+    return v7_slice_block(head, source_ref, block_base, block_size);
+}
+
+size_t v7_slice_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref, const uint8_t *block_base,
+                      size_t block_size)
+{
+    const uint8_t       *source_base;
+    bplib_mpool_block_t *sblk;
+
+    source_base = bplib_mpool_bblock_cbor_cast(bplib_mpool_dereference(source_ref));
+    if (source_base == NULL || block_base < source_base)
+    {
+        return 0;
+    }
+
+    /* the slice alloc checks that the block is really within the data of the source */
+    sblk = bplib_mpool_bblock_cbor_slice_alloc(source_ref, (size_t)(block_base - source_base), block_size);
+    if (sblk == NULL)
+    {
+        return 0;
+    }
+
+    bplib_mpool_bblock_cbor_append(head, sblk);
+
+    return block_size;
+}
+
 int v7_block_decode_pri(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr, size_t data_size)
+{
+    return v7_block_decode_pri_ext(cpb, data_ptr, data_size, NULL);
+}
+
+int v7_block_decode_pri_ext(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr, size_t data_size,
+                            bplib_mpool_ref_t source_ref)
 {
     v7_decode_state_t   v7_state;
     CborValue           origin;
     bp_primary_block_t *pri;
     size_t              block_size;
+    size_t              encoded_size;
     CborParser          parser;
 
     /* If there is any existing encoded data, return it to the pool */
@@ -108,26 +215,42 @@ int v7_block_decode_pri(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr,
 
     pri = bplib_mpool_bblock_primary_get_logical(cpb);
     memset(&v7_state, 0, sizeof(v7_state));
+    v7_state.base = data_ptr;
 
-    if (cbor_parser_init(data_ptr, data_size, 0, &parser, &origin) != CborNoError)
+    /* the common shape of primary block is read directly, anything else goes through TinyCBOR */
+    block_size = v7_decode_bp_primary_block_profile(v7_state.base, data_size, pri);
+    if (block_size != 0)
+    {
+        /* already decoded */
+    }
+    else if (cbor_parser_init(data_ptr, data_size, 0, &parser, &origin) != CborNoError)
     {
         v7_state.error = true;
     }
     else
     {
-        v7_state.base = data_ptr;
         v7_state.cbor = &origin;
 
         v7_decode_bp_primary_block(&v7_state, pri);
+
+        block_size = cbor_value_get_next_byte(&origin) - v7_state.base;
     }
 
     if (!v7_state.error)
     {
-        block_size                   = cbor_value_get_next_byte(&origin) - v7_state.base;
-        cpb->block_encode_size_cache = v7_save_and_verify_block(bplib_mpool_bblock_primary_get_encoded_chunks(cpb),
-                                                                v7_state.base, block_size, pri->crctype, pri->crcval);
+        if (source_ref != NULL)
+        {
+            encoded_size = v7_slice_and_verify_block(bplib_mpool_bblock_primary_get_encoded_chunks(cpb), source_ref,
+                                                     v7_state.base, block_size, pri->crctype, pri->crcval);
+        }
+        else
+        {
+            encoded_size = v7_save_and_verify_block(bplib_mpool_bblock_primary_get_encoded_chunks(cpb), v7_state.base,
+                                                    block_size, pri->crctype, pri->crcval);
+        }
 
-        if (cpb->block_encode_size_cache != block_size)
+        bplib_mpool_bblock_primary_set_encode_size(cpb, encoded_size);
+        if (encoded_size != block_size)
         {
             /* something went wrong in validation */
             v7_state.error = true;
@@ -141,14 +264,124 @@ int v7_block_decode_pri(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr,
     return 0;
 }
 
-int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
-                              bp_blocktype_t payload_block_hint)
+/*
+ * Extension block content larger than this has to be in one piece (one chunk) to be decoded
+ * after the fact, see v7_block_decode_canonical_data()
+ */
+#define V7_DECODE_MAX_SCATTERED_CONTENT 256
+
+/*
+ * Second stage decode - for recognized non-payload extension blocks
+ * This should NOT be done for regular payload blocks - which may or
+ * may not be CBOR-encoded - thus undefined to call "cbor_parser_init" on
+ * this block.
+ */
+static void v7_decode_canonical_content(v7_decode_state_t *v7_state, bp_canonical_block_buffer_t *logical,
+                                        const uint8_t *content_ptr, size_t content_size)
+{
+    CborParser parser;
+    CborValue  origin;
+
+    v7_state->base = content_ptr;
+    if (cbor_parser_init(content_ptr, content_size, 0, &parser, &origin) != CborNoError)
+    {
+        v7_state->error = true;
+        return;
+    }
+
+    v7_state->cbor = &origin;
+
+    switch (logical->canonical_block.blockType)
+    {
+        case bp_blocktype_bundleAuthenicationBlock:
+            break;
+        case bp_blocktype_payloadIntegrityBlock:
+            break;
+        case bp_blocktype_payloadConfidentialityBlock:
+            break;
+        case bp_blocktype_previousHopInsertionBlock:
+            break;
+        case bp_blocktype_previousNode:
+            v7_decode_bp_previous_node_block(v7_state, &logical->data.previous_node_block);
+            break;
+        case bp_blocktype_bundleAge:
+            v7_decode_bp_bundle_age_block(v7_state, &logical->data.age_block);
+            break;
+        case bp_blocktype_metadataExtensionBlock:
+            break;
+        case bp_blocktype_extensionSecurityBlock:
+            break;
+        case bp_blocktype_hopCount:
+            v7_decode_bp_hop_count_block(v7_state, &logical->data.hop_count_block);
+            break;
+        case bp_blocktype_custodyTrackingBlock:
+            v7_decode_bp_custody_tracking_block(v7_state, &logical->data.custody_tracking_block);
+            break;
+        case bp_blocktype_adminRecordPayloadBlock:
+        case bp_blocktype_custodyAcceptPayloadBlock:
+            v7_decode_bp_admin_record_payload(v7_state, logical);
+            break;
+        default:
+            /* do nothing */
+            break;
+    }
+
+    /* the parser is gone once this returns, so the caller must not be left pointing at it */
+    v7_state->cbor = NULL;
+}
+
+/*
+ * Everything after the framing of a canonical block: working out what the payload really is, and
+ * decoding the content (or leaving it pending, if defer_content is set).
+ */
+static void v7_decode_canonical_second_stage(v7_decode_state_t *v7_state, bp_canonical_block_buffer_t *logical,
+                                             bp_blocktype_t payload_block_hint, const uint8_t *content_ptr,
+                                             size_t content_size, bool defer_content)
+{
+    /*
+     * multiple different block types may get labeled as the "payload block"
+     * because RFC9171 insists that something must be labeled as such.
+     * the purpose of the "payload_block_hint" is to identify how the payload
+     * should really be interpreted based on other blocks/fields in the bundle
+     */
+    if (payload_block_hint != bp_blocktype_undefined &&
+        logical->canonical_block.blockType == bp_blocktype_payloadBlock)
+    {
+        logical->canonical_block.blockType = payload_block_hint;
+    }
+
+    /*
+     * An admin record is always decoded now, because its content determines the real block type,
+     * which is what the rest of the bundle processing looks for.
+     */
+    if (logical->canonical_block.blockType == bp_blocktype_payloadBlock)
+    {
+        /* nothing more to decode */
+    }
+    else if (defer_content && logical->canonical_block.blockType != bp_blocktype_adminRecordPayloadBlock)
+    {
+        logical->data_pending = true;
+    }
+    else
+    {
+        v7_decode_canonical_content(v7_state, logical, content_ptr, content_size);
+    }
+}
+
+/*
+ * Decodes the framing of a canonical block, saves it, and then either decodes the content also
+ * or (if defer_content is set) leaves that pending until v7_block_decode_canonical_data().
+ */
+static int v7_block_decode_canonical_impl(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr,
+                                          size_t data_size, bp_blocktype_t payload_block_hint,
+                                          bplib_mpool_ref_t source_ref, bool defer_content)
 {
     v7_decode_state_t            v7_state;
     CborError                    tcb_stat;
     CborValue                    origin;
     bp_canonical_block_buffer_t *logical;
     size_t                       block_size;
+    size_t                       encoded_size;
     CborParser                   parser;
     size_t                       content_offset;
     size_t                       content_size;
@@ -163,6 +396,8 @@ int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *d
     logical = bplib_mpool_bblock_canonical_get_logical(ccb);
     memset(&v7_state, 0, sizeof(v7_state));
 
+    logical->data_pending = false;
+
     tcb_stat = cbor_parser_init(data_ptr, data_size, 0, &parser, &origin);
     if (tcb_stat != CborNoError)
     {
@@ -181,12 +416,22 @@ int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *d
         /* This reflects the size of the entire CBOR blob that the caller passed in */
         block_size = cbor_value_get_next_byte(&origin) - v7_state.base;
 
-        /* Copy it to the pool buffers, and check the CRC in the process */
-        ccb->block_encode_size_cache =
-            v7_save_and_verify_block(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), v7_state.base, block_size,
-                                     logical->canonical_block.crctype, logical->canonical_block.crcval);
+        /* Copy it to the pool buffers (or refer to it, if it is already there), and check the CRC in the process */
+        if (source_ref != NULL)
+        {
+            encoded_size = v7_slice_and_verify_block(
+                bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), source_ref, v7_state.base, block_size,
+                logical->canonical_block.crctype, logical->canonical_block.crcval);
+        }
+        else
+        {
+            encoded_size =
+                v7_save_and_verify_block(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), v7_state.base,
+                                         block_size, logical->canonical_block.crctype, logical->canonical_block.crcval);
+        }
 
-        if (ccb->block_encode_size_cache != block_size)
+        bplib_mpool_bblock_canonical_set_encode_size(ccb, encoded_size);
+        if (encoded_size != block_size)
         {
             v7_state.error = true;
         }
@@ -198,77 +443,172 @@ int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *d
 
     if (!v7_state.error)
     {
-        /*
-         * multiple different block types may get labeled as the "payload block"
-         * because RFC9171 insists that something must be labeled as such.
-         * the purpose of the "payload_block_hint" is to identify how the payload
-         * should really be interpreted based on other blocks/fields in the bundle
-         */
-        if (payload_block_hint != bp_blocktype_undefined &&
-            logical->canonical_block.blockType == bp_blocktype_payloadBlock)
-        {
-            logical->canonical_block.blockType = payload_block_hint;
-        }
+        v7_decode_canonical_second_stage(&v7_state, logical, payload_block_hint, v7_state.base + content_offset,
+                                         content_size, defer_content);
+    }
 
-        /*
-         * Second stage decode - for recognized non-payload extension blocks
-         * This should NOT be done for regular payloadb blocks - which may or
-         * may not be CBOR-encoded - thus undefined to call "cbor_parser_init" on
-         * this block.
-         */
-        if (logical->canonical_block.blockType != bp_blocktype_payloadBlock)
-        {
-            v7_state.base += content_offset;
-            tcb_stat = cbor_parser_init(v7_state.base, content_size, 0, &parser, &origin);
-            if (tcb_stat != CborNoError)
-            {
-                v7_state.error = true;
-            }
-            else
-            {
-                v7_state.cbor = &origin;
-
-                switch (logical->canonical_block.blockType)
-                {
-                    case bp_blocktype_bundleAuthenicationBlock:
-                        break;
-                    case bp_blocktype_payloadIntegrityBlock:
-                        break;
-                    case bp_blocktype_payloadConfidentialityBlock:
-                        break;
-                    case bp_blocktype_previousHopInsertionBlock:
-                        break;
-                    case bp_blocktype_previousNode:
-                        v7_decode_bp_previous_node_block(&v7_state, &logical->data.previous_node_block);
-                        break;
-                    case bp_blocktype_bundleAge:
-                        v7_decode_bp_bundle_age_block(&v7_state, &logical->data.age_block);
-                        break;
-                    case bp_blocktype_metadataExtensionBlock:
-                        break;
-                    case bp_blocktype_extensionSecurityBlock:
-                        break;
-                    case bp_blocktype_hopCount:
-                        v7_decode_bp_hop_count_block(&v7_state, &logical->data.hop_count_block);
-                        break;
-                    case bp_blocktype_custodyTrackingBlock:
-                        v7_decode_bp_custody_tracking_block(&v7_state, &logical->data.custody_tracking_block);
-                        break;
-                    case bp_blocktype_adminRecordPayloadBlock:
-                    case bp_blocktype_custodyAcceptPayloadBlock:
-                        v7_decode_bp_admin_record_payload(&v7_state, logical);
-                        break;
-                    default:
-                        /* do nothing */
-                        break;
-                }
-            }
-        }
+    if (v7_state.error)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Takes the header of a canonical block from a scan instead of decoding it again
+ */
+static bp_canonical_block_buffer_t *v7_block_set_canonical_scanned(bplib_mpool_bblock_canonical_t *ccb,
+                                                                   const v7_scan_block_t *scanned)
+{
+    bp_canonical_block_buffer_t *logical;
+
+    /* If there is any existing encoded data, return it to the pool */
+    bplib_mpool_bblock_canonical_drop_encode(ccb);
+
+    logical = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    logical->data_pending              = false;
+    logical->canonical_block.blockType = scanned->block_type;
+    logical->canonical_block.blockNum  = scanned->block_num;
+    logical->canonical_block.crctype   = scanned->crctype;
+    logical->canonical_block.crcval    = scanned->crcval;
+    v7_set_bp_block_processing_flags(&logical->canonical_block.processingControlFlags, scanned->flags);
+
+    return logical;
+}
+
+int v7_block_decode_canonical_scanned(bplib_mpool_bblock_canonical_t *ccb, const uint8_t *block_base,
+                                      const v7_scan_block_t *scanned, bp_blocktype_t payload_block_hint,
+                                      bplib_mpool_ref_t source_ref, bool defer_content)
+{
+    v7_decode_state_t            v7_state;
+    bp_canonical_block_buffer_t *logical;
+    size_t                       encoded_size;
+
+    logical = v7_block_set_canonical_scanned(ccb, scanned);
+    memset(&v7_state, 0, sizeof(v7_state));
+
+    /* The CRC was checked with the rest of the bundle, so this is only kept */
+    if (source_ref != NULL)
+    {
+        encoded_size =
+            v7_slice_block(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), source_ref, block_base, scanned->size);
+    }
+    else
+    {
+        encoded_size = v7_save_block(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), block_base, scanned->size);
+    }
+
+    bplib_mpool_bblock_canonical_set_encode_size(ccb, encoded_size);
+    if (encoded_size != scanned->size)
+    {
+        v7_state.error = true;
+    }
+    else
+    {
+        bplib_mpool_bblock_canonical_set_content_position(ccb, scanned->content_offset, scanned->content_size);
+        v7_decode_canonical_second_stage(&v7_state, logical, payload_block_hint, block_base + scanned->content_offset,
+                                         scanned->content_size, defer_content);
+    }
+
+    if (v7_state.error)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int v7_block_decode_canonical_streamed(bplib_mpool_bblock_canonical_t *ccb, const v7_scan_block_t *scanned,
+                                       bp_blocktype_t payload_block_hint)
+{
+    bp_canonical_block_buffer_t *logical;
+
+    logical = v7_block_set_canonical_scanned(ccb, scanned);
+
+    /* the same as v7_decode_canonical_second_stage(), but the content is not here to decode */
+    if (payload_block_hint != bp_blocktype_undefined &&
+        logical->canonical_block.blockType == bp_blocktype_payloadBlock)
+    {
+        logical->canonical_block.blockType = payload_block_hint;
+    }
+
+    if (logical->canonical_block.blockType != bp_blocktype_payloadBlock)
+    {
+        return -1;
+    }
+
+    bplib_mpool_bblock_canonical_set_content_position(ccb, scanned->content_offset, scanned->content_size);
+
+    return 0;
+}
+
+int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                              bp_blocktype_t payload_block_hint)
+{
+    return v7_block_decode_canonical_ext(ccb, data_ptr, data_size, payload_block_hint, NULL);
+}
+
+int v7_block_decode_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                                  bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref)
+{
+    return v7_block_decode_canonical_impl(ccb, data_ptr, data_size, payload_block_hint, source_ref, false);
+}
+
+int v7_block_frame_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                                 bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref)
+{
+    return v7_block_decode_canonical_impl(ccb, data_ptr, data_size, payload_block_hint, source_ref, true);
+}
+
+int v7_block_decode_canonical_data(bplib_mpool_bblock_canonical_t *ccb)
+{
+    v7_decode_state_t            v7_state;
+    bp_canonical_block_buffer_t *logical;
+    bplib_iovec_t                iov;
+    uint8_t                      scratch_area[V7_DECODE_MAX_SCATTERED_CONTENT];
+    size_t                       content_offset;
+    size_t                       content_size;
+
+    logical = bplib_mpool_bblock_canonical_get_logical(ccb);
+    if (!logical->data_pending)
+    {
+        return 0;
+    }
+
+    content_offset = bplib_mpool_bblock_canonical_get_content_offset(ccb);
+    content_size   = bplib_mpool_bblock_canonical_get_content_length(ccb);
+
+    memset(&v7_state, 0, sizeof(v7_state));
+    memset(&iov, 0, sizeof(iov));
+
+    /* the CRC was checked when the block was framed, so this only needs to find the content again */
+    if (content_size == 0)
+    {
+        v7_state.error = true;
+    }
+    else if (bplib_mpool_bblock_cbor_export_iov_range(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), &iov, 1,
+                                                      content_offset, content_size) == 1 &&
+             iov.len == content_size)
+    {
+        v7_decode_canonical_content(&v7_state, logical, iov.base, content_size);
+    }
+    else if (content_size <= sizeof(scratch_area) &&
+             bplib_mpool_bblock_cbor_export(bplib_mpool_bblock_canonical_get_encoded_chunks(ccb), scratch_area,
+                                            sizeof(scratch_area), content_offset, content_size) == content_size)
+    {
+        v7_decode_canonical_content(&v7_state, logical, scratch_area, content_size);
+    }
+    else
+    {
+        v7_state.error = true;
     }
 
     if (v7_state.error)
     {
+        /* left pending, so every access sees the failure */
         return -1;
     }
+
+    logical->data_pending = false;
     return 0;
 }
@@ -25,6 +25,8 @@
  INCLUDES
  ******************************************************************************/
 
+#include <limits.h>
+
 #include "v7_codec_internal.h"
 #include "cbor.h"
 
@@ -35,6 +37,167 @@ typedef struct v7_decode_state
     CborValue     *cbor;
 } v7_decode_state_t;
 
+/*
+ * Position within raw CBOR, for the decode paths that read it directly rather than through
+ * TinyCBOR (the bundle scanner, and the primary block profile decoder).  Everything read is
+ * bounds checked against end, and once error is set nothing more is read.
+ */
+typedef struct v7_raw_reader
+{
+    const uint8_t *ptr;
+    const uint8_t *end;
+    bool           error;
+} v7_raw_reader_t;
+
+/*
+ * Reads the head of the next CBOR item, returning its major type (in the same form as CborType,
+ * so CborArrayType etc.) and its argument.  Indefinite lengths and break codes are errors here,
+ * as the fields inside a block are always definite length.
+ */
+static inline uint8_t v7_raw_get_head(v7_raw_reader_t *rd, uint64_t *arg)
+{
+    uint8_t initial;
+    uint8_t info;
+    size_t  width;
+
+    *arg = 0;
+    if (rd->error || rd->ptr >= rd->end)
+    {
+        rd->error = true;
+        return CborInvalidType;
+    }
+
+    initial = *rd->ptr;
+    info    = initial & 0x1F;
+    ++rd->ptr;
+
+    if (info < 24)
+    {
+        /* the common case, it is all in the initial byte */
+        *arg = info;
+        return initial & 0xE0;
+    }
+
+    /* 1, 2, 4, or 8 additional bytes, anything else is reserved or an indefinite length */
+    width = (size_t)1 << (info - 24);
+    if (info >= 28 || width > (size_t)(rd->end - rd->ptr))
+    {
+        rd->error = true;
+        return CborInvalidType;
+    }
+
+    while (width > 0)
+    {
+        *arg = (*arg << 8) | *rd->ptr;
+        ++rd->ptr;
+        --width;
+    }
+
+    return initial & 0xE0;
+}
+
+/*
+ * Reads an unsigned integer, RFC9171 has no negative numbers in block fields
+ */
+static inline bp_integer_t v7_raw_get_uint(v7_raw_reader_t *rd)
+{
+    uint64_t arg;
+
+    if (v7_raw_get_head(rd, &arg) != CborIntegerType)
+    {
+        rd->error = true;
+    }
+
+    return arg;
+}
+
+/*
+ * Same limit as v7_decode_small_int(), for the values which are kept as an int or enum
+ */
+static inline int v7_raw_get_small_int(v7_raw_reader_t *rd)
+{
+    bp_integer_t arg;
+
+    arg = v7_raw_get_uint(rd);
+    if (arg > INT_MAX)
+    {
+        rd->error = true;
+    }
+
+    return (int)arg;
+}
+
+/*
+ * Reads a CRC value, which is a byte string holding the value as a big-endian number
+ */
+static inline bp_crcval_t v7_raw_get_crc(v7_raw_reader_t *rd)
+{
+    bp_crcval_t crc_val;
+    uint64_t    len;
+
+    crc_val = 0;
+    if (v7_raw_get_head(rd, &len) != CborByteStringType || len > sizeof(crc_val) ||
+        len > (uint64_t)(rd->end - rd->ptr))
+    {
+        rd->error = true;
+        len       = 0;
+    }
+
+    while (len > 0)
+    {
+        crc_val = (crc_val << 8) | *rd->ptr;
+        ++rd->ptr;
+        --len;
+    }
+
+    return crc_val;
+}
+
+/*
+ * Reads the head of an array, which must have exactly the given number of items
+ */
+static inline void v7_raw_get_array(v7_raw_reader_t *rd, uint64_t count)
+{
+    uint64_t arg;
+
+    if (v7_raw_get_head(rd, &arg) != CborArrayType || arg != count)
+    {
+        rd->error = true;
+    }
+}
+
+/*
+ * The most blocks a bundle can have for v7_scan_bundle() to take it.  A bundle with more than this is
+ * still decoded, just one block at a time through TinyCBOR.
+ */
+#define V7_SCAN_MAX_BLOCKS 16
+
+/*
+ * Where one block is in a bundle, as found by v7_scan_bundle().  The type, number and flags are only
+ * set for canonical blocks, the primary block is only located.
+ */
+typedef struct v7_scan_block
+{
+    size_t         offset;         /**< start of the block, from the start of the bundle */
+    size_t         size;           /**< size of the whole encoded block */
+    size_t         content_offset; /**< start of the content, from the start of the block */
+    size_t         content_size;   /**< size of the content */
+    bp_integer_t   flags;          /**< block processing control flags, as encoded */
+    bp_blocktype_t block_type;
+    bp_crctype_t   crctype;
+    bp_crcval_t    crcval;
+    bp_blocknum_t  block_num;
+
+} v7_scan_block_t;
+
+typedef struct v7_scan_table
+{
+    size_t          bundle_size; /**< including the array head and the break code */
+    size_t          num_blocks;  /**< the first is always the primary block */
+    v7_scan_block_t blocks[V7_SCAN_MAX_BLOCKS];
+
+} v7_scan_table_t;
+
 typedef struct
 {
     bp_adminrectype_t          decode_rectype;
@@ -60,6 +223,7 @@ int  v7_decode_small_int(v7_decode_state_t *dec);
 void v7_decode_crc(v7_decode_state_t *dec, bp_crcval_t *v);
 
 void v7_decode_bitmap(v7_decode_state_t *dec, uint8_t *v, const v7_bitmap_table_t *ptbl);
+void v7_set_bitmap(uint8_t *v, const v7_bitmap_table_t *ptbl, bp_integer_t value);
 void v7_decode_bp_blocknum(v7_decode_state_t *dec, bp_blocknum_t *v);
 void v7_decode_bp_blocktype(v7_decode_state_t *dec, bp_blocktype_t *v);
 void v7_decode_bp_integer(v7_decode_state_t *dec, bp_integer_t *v);
@@ -68,22 +232,32 @@ void v7_decode_bp_crctype(v7_decode_state_t *dec, bp_crctype_t *v);
 void v7_decode_bp_endpointid_buffer(v7_decode_state_t *dec, bp_endpointid_buffer_t *v);
 
 /* Block decoders */
-void v7_decode_bp_primary_block(v7_decode_state_t *dec, bp_primary_block_t *v);
-void v7_decode_bp_admin_record_payload(v7_decode_state_t *dec, bp_canonical_block_buffer_t *v);
-void v7_decode_bp_previous_node_block(v7_decode_state_t *dec, bp_previous_node_block_t *v);
-void v7_decode_bp_bundle_age_block(v7_decode_state_t *dec, bp_bundle_age_block_t *v);
-void v7_decode_bp_hop_count_block(v7_decode_state_t *dec, bp_hop_count_block_t *v);
-void v7_decode_bp_custody_tracking_block(v7_decode_state_t *dec, bp_custody_tracking_block_t *v);
-void v7_decode_bp_custody_acknowledement_record(v7_decode_state_t *dec, bp_custody_accept_payload_block_t *v);
+void   v7_decode_bp_primary_block(v7_decode_state_t *dec, bp_primary_block_t *v);
+size_t v7_decode_bp_primary_block_profile(const uint8_t *ptr, size_t size, bp_primary_block_t *v);
+void   v7_decode_bp_admin_record_payload(v7_decode_state_t *dec, bp_canonical_block_buffer_t *v);
+void   v7_decode_bp_previous_node_block(v7_decode_state_t *dec, bp_previous_node_block_t *v);
+void   v7_decode_bp_bundle_age_block(v7_decode_state_t *dec, bp_bundle_age_block_t *v);
+void   v7_decode_bp_hop_count_block(v7_decode_state_t *dec, bp_hop_count_block_t *v);
+void   v7_decode_bp_custody_tracking_block(v7_decode_state_t *dec, bp_custody_tracking_block_t *v);
+void   v7_decode_bp_custody_acknowledement_record(v7_decode_state_t *dec, bp_custody_accept_payload_block_t *v);
 
 void   v7_decode_bp_canonical_bundle_block(v7_decode_state_t *dec, bp_canonical_bundle_block_t *v,
                                            v7_canonical_block_info_t *info);
 void   v7_decode_bp_canonical_block_buffer(v7_decode_state_t *dec, bp_canonical_block_buffer_t *v,
                                            size_t *content_encoded_offset, size_t *content_length);
+bool   v7_verify_block_crc(const uint8_t *block_base, size_t block_size, bp_crctype_t crc_type, bp_crcval_t crc_check);
+bool   v7_verify_block_crc_chunks(bplib_mpool_block_t *head, size_t block_size, bp_crctype_t crc_type,
+                                  bp_crcval_t crc_check);
+size_t v7_save_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size);
+size_t v7_slice_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref, const uint8_t *block_base,
+                      size_t block_size);
 size_t v7_save_and_verify_block(bplib_mpool_block_t *head, const uint8_t *block_base, size_t block_size,
                                 bp_crctype_t crc_type, bp_crcval_t crc_check);
+size_t v7_slice_and_verify_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref, const uint8_t *block_base,
+                                 size_t block_size, bp_crctype_t crc_type, bp_crcval_t crc_check);
 void   v7_decode_bp_adminrec_payload_impl(v7_decode_state_t *dec, void *arg);
 void   v7_decode_bp_block_processing_flags(v7_decode_state_t *dec, bp_block_processing_flags_t *v);
+void   v7_set_bp_block_processing_flags(bp_block_processing_flags_t *v, bp_integer_t value);
 void   v7_decode_bp_endpointid_scheme(v7_decode_state_t *dec, bp_endpointid_scheme_t *v);
 void   v7_decode_bp_ipn_nodenumber(v7_decode_state_t *dec, bp_ipn_nodenumber_t *v);
 void   v7_decode_bp_ipn_servicenumber(v7_decode_state_t *dec, bp_ipn_servicenumber_t *v);
@@ -98,8 +272,57 @@ void   v7_decode_bp_bundle_processing_control_flags(v7_decode_state_t *dec, bp_b
 void   v7_decode_bp_lifetime(v7_decode_state_t *dec, bp_lifetime_t *v);
 void   v7_decode_bp_adu_length(v7_decode_state_t *dec, bp_adu_length_t *v);
 void   v7_decode_bp_primary_block_impl(v7_decode_state_t *dec, void *arg);
+void   v7_decode_bp_custody_acceptance_range_impl(v7_decode_state_t *dec, void *arg);
 void   v7_decode_bp_custody_acceptance_seqlist_impl(v7_decode_state_t *dec, void *arg);
 void   v7_decode_bp_custody_acknowledement_record_impl(v7_decode_state_t *dec, void *arg);
 void   v7_decode_bp_canonical_block_buffer_impl(v7_decode_state_t *dec, void *arg);
 
+/*
+ * Single pass framing of a whole bundle.  This walks the raw CBOR once, without TinyCBOR, and fills in
+ * where every block is.  Returns the size of the bundle, or 0 if it is not well formed or has more
+ * than V7_SCAN_MAX_BLOCKS blocks.  Nothing is decoded beyond the block headers.
+ */
+size_t v7_scan_bundle(const void *buffer, size_t buf_sz, v7_scan_table_t *table);
+
+/*
+ * Frames the one block at the start of the buffer, the same way as v7_scan_bundle() does for each block.
+ * Returns the size of the block, or 0 if it is not well formed or not all of it is in the buffer.
+ */
+size_t v7_scan_block(const void *buffer, size_t buf_sz, bool is_primary, v7_scan_block_t *block);
+
+/*
+ * Frames only the header of the canonical block at the start of the buffer, up to where its content starts.
+ * Returns the size of the header (which is also the content offset), or 0 if it is not all in the buffer.
+ * The size of the block is not set, as the content and CRC have not been seen.
+ */
+size_t v7_scan_canonical_head(const void *buffer, size_t buf_sz, v7_scan_block_t *block);
+
+/*
+ * Checks the CRC of every canonical block found by v7_scan_bundle(), before any of them is decoded
+ */
+bool v7_scan_verify_canonical_crcs(const void *buffer, const v7_scan_table_t *table);
+
+/*
+ * Same as v7_block_decode_canonical_ext() (or v7_block_frame_canonical_ext() if defer_content is set),
+ * for a block located by v7_scan_bundle() whose CRC was already checked.  The header is taken from
+ * the scan instead of being decoded again, and block_base is the start of the block.
+ */
+int v7_block_decode_canonical_scanned(bplib_mpool_bblock_canonical_t *ccb, const uint8_t *block_base,
+                                      const v7_scan_block_t *scanned, bp_blocktype_t payload_block_hint,
+                                      bplib_mpool_ref_t source_ref, bool defer_content);
+
+/*
+ * Sets up a canonical block from the header located by v7_scan_canonical_head(), where the rest of the block
+ * is going to be written to its encoded chunks by the caller.  Nothing in the content is decoded, so this
+ * is only valid for a plain payload block; it fails for anything else.
+ */
+int v7_block_decode_canonical_streamed(bplib_mpool_bblock_canonical_t *ccb, const v7_scan_block_t *scanned,
+                                       bp_blocktype_t payload_block_hint);
+
+/*
+ * Checks for the extension blocks that change how the rest of the bundle is interpreted, once ccb is decoded
+ */
+void v7_apply_extension_block_hint(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_bblock_canonical_t *ccb,
+                                   bp_blocktype_t *payload_block_hint);
+
 #endif /* V7_DECODE_INTERNAL_H */
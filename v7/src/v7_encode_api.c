@@ -41,6 +41,130 @@ int v7_encoder_mpstream_write(void *arg, const void *ptr, size_t sz)
     return BP_SUCCESS;
 }
 
+/*
+ * Writes into a flat buffer, which is where a primary block template is put together
+ */
+typedef struct v7_flat_buffer
+{
+    uint8_t *ptr;
+    size_t   size;
+    size_t   used;
+} v7_flat_buffer_t;
+
+static int v7_encoder_flat_write(void *arg, const void *ptr, size_t sz)
+{
+    v7_flat_buffer_t *buf = arg;
+
+    if (sz > (buf->size - buf->used))
+    {
+        return BP_ERROR;
+    }
+
+    memcpy(&buf->ptr[buf->used], ptr, sz);
+    buf->used += sz;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Maximum size of each slice of an external payload, see v7_block_encode_pay_extern()
+ */
+#define V7_EXTERN_SLICE_MAX_SIZE 0x8000
+
+/*
+ * Writes into a pool stream, except for the payload content, which is put in the chunk list
+ * as slices of the external buffer that it is in (the pointer identifies it)
+ */
+typedef struct v7_extern_content_writer
+{
+    bplib_mpool_stream_t *mps;
+    bplib_mpool_block_t  *chunk_list;
+    bplib_mpool_ref_t     content_ref;
+    const void           *content_ptr;
+    size_t                content_size;
+    size_t                attached_size;
+} v7_extern_content_writer_t;
+
+static int v7_encoder_extern_content_write(void *arg, const void *ptr, size_t sz)
+{
+    v7_extern_content_writer_t *wr = arg;
+    bplib_mpool_block_t        *sblk;
+    size_t                      offset;
+    size_t                      chunk_sz;
+
+    if (ptr != wr->content_ptr || sz != wr->content_size)
+    {
+        return v7_encoder_mpstream_write(wr->mps, ptr, sz);
+    }
+
+    /* everything so far goes ahead of the content, and the stream starts over after it */
+    wr->attached_size += bplib_mpool_stream_tell(wr->mps);
+    bplib_mpool_stream_attach(wr->mps, wr->chunk_list);
+
+    for (offset = 0; offset < sz; offset += chunk_sz)
+    {
+        chunk_sz = sz - offset;
+        if (chunk_sz > V7_EXTERN_SLICE_MAX_SIZE)
+        {
+            chunk_sz = V7_EXTERN_SLICE_MAX_SIZE;
+        }
+
+        sblk = bplib_mpool_bblock_cbor_slice_alloc(wr->content_ref, offset, chunk_sz);
+        if (sblk == NULL)
+        {
+            return BP_ERROR;
+        }
+
+        bplib_mpool_bblock_cbor_append(wr->chunk_list, sblk);
+    }
+
+    wr->attached_size += sz;
+
+    return BP_SUCCESS;
+}
+
+/*
+ * Large writes (payload content) are digested and written a slice at a time, so each slice is
+ * copied while it is still in the CPU cache from the CRC, rather than going over all of it twice
+ */
+#define V7_ENCODE_CRC_SLICE_SIZE 2048
+
+static int v7_encoder_digest_and_write(v7_encode_state_t *enc, const uint8_t *ptr, size_t sz)
+{
+    size_t slice_sz;
+    int    write_result;
+
+    if (enc->crc_slice_size == 0)
+    {
+        if (enc->crc_params)
+        {
+            enc->crc_val = bplib_crc_update(enc->crc_params, enc->crc_val, ptr, sz);
+        }
+        return enc->next_writer(enc->next_writer_arg, ptr, sz);
+    }
+
+    do
+    {
+        slice_sz = sz;
+        if (slice_sz > enc->crc_slice_size)
+        {
+            slice_sz = enc->crc_slice_size;
+        }
+
+        if (enc->crc_params)
+        {
+            enc->crc_val = bplib_crc_update(enc->crc_params, enc->crc_val, ptr, slice_sz);
+        }
+        write_result = enc->next_writer(enc->next_writer_arg, ptr, slice_sz);
+
+        ptr += slice_sz;
+        sz -= slice_sz;
+    }
+    while (write_result == BP_SUCCESS && sz > 0);
+
+    return write_result;
+}
+
 int v7_encoder_write_crc(v7_encode_state_t *enc)
 {
     uint8_t     crc_data[1 + sizeof(bp_crcval_t)];
@@ -68,20 +192,20 @@ CborError v7_encoder_write_wrapper(void *arg, const void *ptr, size_t sz, CborEn
     v7_encode_state_t *enc = arg;
     int                write_result;
 
-    if (enc->crc_params)
-    {
-        enc->crc_val = bplib_crc_update(enc->crc_params, enc->crc_val, ptr, sz);
-    }
-
     if (enc->crc_flag && at == CborEncoderAppendStringData)
     {
-        /* write the actual crc value, instead of writing the passed-in string (which is 0-padded) */
+        /* the CRC covers the field as zeros, then the actual crc value is written instead of
+         * the passed-in string (which is 0-padded) */
+        if (enc->crc_params)
+        {
+            enc->crc_val = bplib_crc_update(enc->crc_params, enc->crc_val, ptr, sz);
+        }
         enc->crc_flag = false;
         write_result  = v7_encoder_write_crc(enc);
     }
     else
     {
-        write_result = enc->next_writer(enc->next_writer_arg, ptr, sz);
+        write_result = v7_encoder_digest_and_write(enc, ptr, sz);
     }
 
     if (write_result != BP_SUCCESS)
@@ -102,8 +226,9 @@ static void v7_encode_setup(v7_encode_state_t *enc, CborEncoder *top_level_cbor,
     cbor_encoder_init_writer(top_level_cbor, v7_encoder_write_wrapper, enc);
     enc->cbor = top_level_cbor;
 
-    enc->crc_params = v7_codec_get_crc_algorithm(crctype);
-    enc->crc_val    = bplib_crc_initial_value(enc->crc_params);
+    enc->crc_params     = v7_codec_get_crc_algorithm(crctype);
+    enc->crc_val        = bplib_crc_initial_value(enc->crc_params);
+    enc->crc_slice_size = V7_ENCODE_CRC_SLICE_SIZE;
 
     enc->next_writer     = next_writer;
     enc->next_writer_arg = next_writer_arg;
@@ -115,6 +240,8 @@ int v7_block_encode_pri(bplib_mpool_bblock_primary_t *cpb)
     bplib_mpool_stream_t      mps;
     CborEncoder               top_level_enc;
     const bp_primary_block_t *pri;
+    uint8_t                   profile_buf[V7_PRI_PROFILE_MAX_SIZE];
+    size_t                    profile_size;
 
     /* If there is any existing encoded data, return it to the pool */
     bplib_mpool_bblock_primary_drop_encode(cpb);
@@ -125,11 +252,162 @@ int v7_block_encode_pri(bplib_mpool_bblock_primary_t *cpb)
                                   bplib_mpool_stream_dir_write);
     v7_encode_setup(&v7_state, &top_level_enc, pri->crctype, v7_encoder_mpstream_write, &mps);
 
+    /* the common shape of primary block is put together directly, and written in one go */
+    profile_size = v7_encode_bp_primary_block_profile(profile_buf, pri);
+    if (profile_size != 0)
+    {
+        v7_state.error = (v7_encoder_mpstream_write(&mps, profile_buf, profile_size) != BP_SUCCESS);
+    }
+    else
+    {
+        v7_encode_bp_primary_block(&v7_state, pri);
+    }
+
+    if (!v7_state.error)
+    {
+        bplib_mpool_bblock_primary_set_encode_size(cpb, bplib_mpool_stream_tell(&mps));
+        bplib_mpool_stream_attach(&mps, bplib_mpool_bblock_primary_get_encoded_chunks(cpb));
+    }
+
+    bplib_mpool_stream_close(&mps);
+
+    if (v7_state.error)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+size_t v7_block_encode_pri_flat(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz)
+{
+    v7_encode_state_t         v7_state;
+    v7_flat_buffer_t          buf;
+    CborEncoder               top_level_enc;
+    const bp_primary_block_t *pri;
+    uint8_t                   profile_buf[V7_PRI_PROFILE_MAX_SIZE];
+    size_t                    profile_size;
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    buf.ptr  = buffer;
+    buf.size = buf_sz;
+    buf.used = 0;
+    v7_encode_setup(&v7_state, &top_level_enc, pri->crctype, v7_encoder_flat_write, &buf);
+
+    /* the same as v7_block_encode_pri(), only the writer is different */
+    profile_size = v7_encode_bp_primary_block_profile(profile_buf, pri);
+    if (profile_size != 0)
+    {
+        v7_state.error = (v7_encoder_flat_write(&buf, profile_buf, profile_size) != BP_SUCCESS);
+    }
+    else
+    {
+        v7_encode_bp_primary_block(&v7_state, pri);
+    }
+
+    if (v7_state.error)
+    {
+        return 0;
+    }
+    return buf.used;
+}
+
+int v7_block_encode_pri_template(bp_pri_template_t *tmpl, const bp_primary_block_t *pri)
+{
+    v7_encode_state_t v7_state;
+    v7_flat_buffer_t  buf;
+    CborEncoder       top_level_enc;
+    size_t            suffix_end;
+    size_t            suffix_size;
+
+    /* room for the template, plus the largest timestamp and CRC that go between and after it */
+    uint8_t scratch[BP_PRI_TEMPLATE_MAX_SIZE + 32];
+
+    memset(tmpl, 0, sizeof(*tmpl));
+
+    buf.ptr  = scratch;
+    buf.size = sizeof(scratch);
+    buf.used = 0;
+    v7_encode_setup(&v7_state, &top_level_enc, pri->crctype, v7_encoder_flat_write, &buf);
+
     v7_encode_bp_primary_block(&v7_state, pri);
 
+    if (v7_state.error || v7_state.timestamp_end == 0)
+    {
+        return -1;
+    }
+
+    /* the CRC is the last field, a byte string which stays out of the template */
+    suffix_end = buf.used;
+    if (pri->crctype != bp_crctype_none)
+    {
+        suffix_end -= 1 + (bplib_crc_get_width(v7_state.crc_params) / 8);
+    }
+
+    suffix_size = suffix_end - v7_state.timestamp_end;
+    if ((v7_state.timestamp_start + suffix_size) > sizeof(tmpl->data))
+    {
+        return -1;
+    }
+
+    memcpy(tmpl->data, scratch, v7_state.timestamp_start);
+    memcpy(&tmpl->data[v7_state.timestamp_start], &scratch[v7_state.timestamp_end], suffix_size);
+
+    tmpl->prefix_crc  = v7_state.timestamp_crc_val;
+    tmpl->prefix_size = v7_state.timestamp_start;
+    tmpl->suffix_size = suffix_size;
+
+    return 0;
+}
+
+int v7_block_encode_pri_from_template(bplib_mpool_bblock_primary_t *cpb, const bp_pri_template_t *tmpl)
+{
+    v7_encode_state_t         v7_state;
+    bplib_mpool_stream_t      mps;
+    CborEncoder               top_level_enc;
+    const bp_primary_block_t *pri;
+
+    if (tmpl->prefix_size == 0)
+    {
+        return v7_block_encode_pri(cpb);
+    }
+
+    /* If there is any existing encoded data, return it to the pool */
+    bplib_mpool_bblock_primary_drop_encode(cpb);
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    bplib_mpool_start_stream_init(&mps, bplib_mpool_get_parent_pool_from_link(&cpb->chunk_list),
+                                  bplib_mpool_stream_dir_write);
+    v7_encode_setup(&v7_state, &top_level_enc, pri->crctype, v7_encoder_mpstream_write, &mps);
+
+    /* the prefix is already in the CRC state from the template, so it goes straight out */
+    v7_state.crc_val = tmpl->prefix_crc;
+    if (v7_encoder_mpstream_write(&mps, tmpl->data, tmpl->prefix_size) != BP_SUCCESS)
+    {
+        v7_state.error = true;
+    }
+    v7_state.total_bytes_encoded += tmpl->prefix_size;
+
     if (!v7_state.error)
     {
-        cpb->block_encode_size_cache = bplib_mpool_stream_tell(&mps);
+        v7_encode_bp_creation_timestamp(&v7_state, &pri->creationTimeStamp);
+    }
+
+    if (!v7_state.error && v7_encoder_write_wrapper(&v7_state, &tmpl->data[tmpl->prefix_size], tmpl->suffix_size,
+                                                    CborEncoderAppendCborData) != CborNoError)
+    {
+        v7_state.error = true;
+    }
+
+    if (!v7_state.error && pri->crctype != bp_crctype_none)
+    {
+        v7_encode_crc(&v7_state);
+    }
+
+    if (!v7_state.error)
+    {
+        bplib_mpool_bblock_primary_set_encode_size(cpb, bplib_mpool_stream_tell(&mps));
         bplib_mpool_stream_attach(&mps, bplib_mpool_bblock_primary_get_encoded_chunks(cpb));
     }
 
@@ -151,6 +429,12 @@ int v7_block_encode_pay(bplib_mpool_bblock_canonical_t *ccb, const void *data_pt
     size_t                             data_encoded_offset;
     bplib_mpool_t                     *ppool;
 
+    /* content that was never decoded is only in the encoded data, so it has to be decoded before that goes */
+    if (v7_block_decode_canonical_data(ccb) != 0)
+    {
+        return -1;
+    }
+
     /* If there is any existing encoded data, return it to the pool */
     bplib_mpool_bblock_canonical_drop_encode(ccb);
 
@@ -165,7 +449,7 @@ int v7_block_encode_pay(bplib_mpool_bblock_canonical_t *ccb, const void *data_pt
     if (!v7_state.error)
     {
         bplib_mpool_bblock_canonical_set_content_position(ccb, data_encoded_offset, data_size);
-        ccb->block_encode_size_cache = bplib_mpool_stream_tell(&mps);
+        bplib_mpool_bblock_canonical_set_encode_size(ccb, bplib_mpool_stream_tell(&mps));
         bplib_mpool_stream_attach(&mps, bplib_mpool_bblock_canonical_get_encoded_chunks(ccb));
     }
 
@@ -178,34 +462,74 @@ int v7_block_encode_pay(bplib_mpool_bblock_canonical_t *ccb, const void *data_pt
     return 0;
 }
 
-int v7_block_encode_canonical(bplib_mpool_bblock_canonical_t *ccb)
+int v7_block_encode_pay_extern(bplib_mpool_bblock_canonical_t *ccb, bplib_mpool_ref_t content_ref,
+                               const void *data_ptr, size_t data_size)
 {
     v7_encode_state_t                  v7_state;
+    v7_extern_content_writer_t         wr;
     bplib_mpool_stream_t               mps;
     CborEncoder                        top_level_enc;
-    const bp_canonical_block_buffer_t *logical;
-    uint8_t                            scratch_area[256];
-    size_t                             scratch_size;
-    size_t                             content_encoded_offset;
+    const bp_canonical_block_buffer_t *pay;
+    size_t                             data_encoded_offset;
     bplib_mpool_t                     *ppool;
 
+    /* content that was never decoded is only in the encoded data, so it has to be decoded before that goes */
+    if (v7_block_decode_canonical_data(ccb) != 0)
+    {
+        return -1;
+    }
+
     /* If there is any existing encoded data, return it to the pool */
     bplib_mpool_bblock_canonical_drop_encode(ccb);
 
     ppool = bplib_mpool_get_parent_pool_from_link(&ccb->chunk_list);
 
-    /*
-     * Encoding of a V7 extension block is a two-part affair, it must
-     * first encode the block-specific information into CBOR, then wrap
-     * those encoded octets as a CBOR byte string within the extension block.
-     * This effectively makes it CBOR-in-CBOR.
-     */
-    logical = bplib_mpool_bblock_canonical_get_logical(ccb);
+    pay = bplib_mpool_bblock_canonical_get_logical(ccb);
+    bplib_mpool_start_stream_init(&mps, ppool, bplib_mpool_stream_dir_write);
 
-    memset(&v7_state, 0, sizeof(v7_state));
-    cbor_encoder_init(&top_level_enc, scratch_area, sizeof(scratch_area), 0);
+    memset(&wr, 0, sizeof(wr));
+    wr.mps          = &mps;
+    wr.chunk_list   = bplib_mpool_bblock_canonical_get_encoded_chunks(ccb);
+    wr.content_ref  = content_ref;
+    wr.content_ptr  = data_ptr;
+    wr.content_size = data_size;
+
+    /* the CRC still covers the content, as the wrapper sees it go by on the way to the writer */
+    v7_encode_setup(&v7_state, &top_level_enc, pay->canonical_block.crctype, v7_encoder_extern_content_write, &wr);
 
-    v7_state.cbor = &top_level_enc;
+    /* the content is not copied, and the writer must see it in one piece to know it */
+    v7_state.crc_slice_size = 0;
+
+    v7_encode_bp_canonical_block_buffer(&v7_state, pay, data_ptr, data_size, &data_encoded_offset);
+
+    if (!v7_state.error)
+    {
+        bplib_mpool_bblock_canonical_set_content_position(ccb, data_encoded_offset, data_size);
+        bplib_mpool_bblock_canonical_set_encode_size(ccb, wr.attached_size + bplib_mpool_stream_tell(&mps));
+        bplib_mpool_stream_attach(&mps, wr.chunk_list);
+    }
+
+    bplib_mpool_stream_close(&mps);
+
+    if (v7_state.error)
+    {
+        /* some of it may have been attached already */
+        bplib_mpool_bblock_canonical_drop_encode(ccb);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * First stage of encoding an extension block, the block-specific data is encoded into the buffer
+ */
+static int v7_encode_canonical_content(const bp_canonical_block_buffer_t *logical, v7_flat_buffer_t *buf)
+{
+    v7_encode_state_t v7_state;
+    CborEncoder       top_level_enc;
+
+    /* this goes through the writer, as the fixed width fields are not encoded by tinycbor */
+    v7_encode_setup(&v7_state, &top_level_enc, bp_crctype_none, v7_encoder_flat_write, buf);
 
     switch (logical->canonical_block.blockType)
     {
@@ -244,30 +568,70 @@ int v7_block_encode_canonical(bplib_mpool_bblock_canonical_t *ccb)
             break;
     }
 
+    if (v7_state.error)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int v7_block_encode_canonical(bplib_mpool_bblock_canonical_t *ccb)
+{
+    v7_encode_state_t                  v7_state;
+    bplib_mpool_stream_t               mps;
+    CborEncoder                        top_level_enc;
+    const bp_canonical_block_buffer_t *logical;
+    uint8_t                            scratch_area[256];
+    v7_flat_buffer_t                   content;
+    size_t                             content_encoded_offset;
+    bplib_mpool_t                     *ppool;
+
+    /* content that was never decoded is only in the encoded data, so it has to be decoded before that goes */
+    if (v7_block_decode_canonical_data(ccb) != 0)
+    {
+        return -1;
+    }
+
+    /* If there is any existing encoded data, return it to the pool */
+    bplib_mpool_bblock_canonical_drop_encode(ccb);
+
+    ppool = bplib_mpool_get_parent_pool_from_link(&ccb->chunk_list);
+
+    /*
+     * Encoding of a V7 extension block is a two-part affair, it must
+     * first encode the block-specific information into CBOR, then wrap
+     * those encoded octets as a CBOR byte string within the extension block.
+     * This effectively makes it CBOR-in-CBOR.
+     */
+    logical = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    content.ptr  = scratch_area;
+    content.size = sizeof(scratch_area);
+    content.used = 0;
+
+    memset(&v7_state, 0, sizeof(v7_state));
+
+    /* a block type with nothing to encode here cannot be encoded this way (the payload has its own) */
+    v7_state.error = (v7_encode_canonical_content(logical, &content) != 0 || content.used == 0);
+
     if (!v7_state.error)
     {
-        scratch_size = cbor_encoder_get_buffer_size(&top_level_enc, scratch_area);
-        if (scratch_size > 0)
+        /*
+         * Do second-stage encode - take the scratch buffer and use it as the content of the extension block
+         */
+        bplib_mpool_start_stream_init(&mps, ppool, bplib_mpool_stream_dir_write);
+        v7_encode_setup(&v7_state, &top_level_enc, logical->canonical_block.crctype, v7_encoder_mpstream_write, &mps);
+
+        v7_encode_bp_canonical_block_buffer(&v7_state, logical, scratch_area, content.used, &content_encoded_offset);
+
+        if (!v7_state.error)
         {
-            /*
-             * Do second-stage encode - take the scratch buffer and use it as the content of the extension block
-             */
-            bplib_mpool_start_stream_init(&mps, ppool, bplib_mpool_stream_dir_write);
-            v7_encode_setup(&v7_state, &top_level_enc, logical->canonical_block.crctype, v7_encoder_mpstream_write,
-                            &mps);
-
-            v7_encode_bp_canonical_block_buffer(&v7_state, logical, scratch_area, scratch_size,
-                                                &content_encoded_offset);
-
-            if (!v7_state.error)
-            {
-                bplib_mpool_bblock_canonical_set_content_position(ccb, content_encoded_offset, scratch_size);
-                ccb->block_encode_size_cache = bplib_mpool_stream_tell(&mps);
-                bplib_mpool_stream_attach(&mps, bplib_mpool_bblock_canonical_get_encoded_chunks(ccb));
-            }
-
-            bplib_mpool_stream_close(&mps);
+            bplib_mpool_bblock_canonical_set_content_position(ccb, content_encoded_offset, content.used);
+            bplib_mpool_bblock_canonical_set_encode_size(ccb, bplib_mpool_stream_tell(&mps));
+            bplib_mpool_stream_attach(&mps, bplib_mpool_bblock_canonical_get_encoded_chunks(ccb));
         }
+
+        bplib_mpool_stream_close(&mps);
     }
 
     if (v7_state.error)
@@ -276,3 +640,116 @@ int v7_block_encode_canonical(bplib_mpool_bblock_canonical_t *ccb)
     }
     return 0;
 }
+
+size_t v7_block_encode_canonical_flat(bplib_mpool_bblock_canonical_t *ccb, void *buffer, size_t buf_sz)
+{
+    v7_encode_state_t                  v7_state;
+    v7_flat_buffer_t                   buf;
+    CborEncoder                        top_level_enc;
+    const bp_canonical_block_buffer_t *logical;
+    uint8_t                            scratch_area[256];
+    v7_flat_buffer_t                   content;
+    size_t                             content_encoded_offset;
+
+    logical = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    content.ptr  = scratch_area;
+    content.size = sizeof(scratch_area);
+    content.used = 0;
+
+    /* the two stages of v7_block_encode_canonical(), with the second going into the buffer */
+    if (v7_encode_canonical_content(logical, &content) != 0 || content.used == 0)
+    {
+        return 0;
+    }
+
+    buf.ptr  = buffer;
+    buf.size = buf_sz;
+    buf.used = 0;
+    v7_encode_setup(&v7_state, &top_level_enc, logical->canonical_block.crctype, v7_encoder_flat_write, &buf);
+
+    v7_encode_bp_canonical_block_buffer(&v7_state, logical, scratch_area, content.used, &content_encoded_offset);
+
+    if (v7_state.error)
+    {
+        return 0;
+    }
+    return buf.used;
+}
+
+/*
+ * The largest extension block that is updated in place, see v7_block_update_canonical()
+ */
+#define V7_UPDATE_MAX_BLOCK_SIZE 128
+
+int v7_block_update_canonical(bplib_mpool_bblock_canonical_t *ccb)
+{
+    const bp_canonical_block_buffer_t *logical;
+    bplib_mpool_block_t               *chunks;
+    bplib_crc_parameters_t            *crc_params;
+    uint8_t                            scratch_area[V7_UPDATE_MAX_BLOCK_SIZE];
+    uint8_t                            encoded[V7_UPDATE_MAX_BLOCK_SIZE];
+    v7_flat_buffer_t                   content;
+    size_t                             block_size;
+    size_t                             content_offset;
+    size_t                             crc_len;
+    bp_crcval_t                        crc_val;
+    size_t                             i;
+
+    /* the new content is made from the logical data, so that has to be decoded first */
+    if (v7_block_decode_canonical_data(ccb) != 0)
+    {
+        return -1;
+    }
+
+    logical        = bplib_mpool_bblock_canonical_get_logical(ccb);
+    chunks         = bplib_mpool_bblock_canonical_get_encoded_chunks(ccb);
+    block_size     = ccb->block_encode_size_cache;
+    content_offset = bplib_mpool_bblock_canonical_get_content_offset(ccb);
+    crc_params     = v7_codec_get_crc_algorithm(logical->canonical_block.crctype);
+    crc_len        = bplib_crc_get_width(crc_params) / 8;
+
+    content.ptr  = scratch_area;
+    content.size = sizeof(scratch_area);
+    content.used = 0;
+
+    /*
+     * This only works if the new content is the same size as the old, which is the case for the fixed
+     * width fields here, and the block was encoded as it would be here: a definite length array with
+     * the CRC last.  Anything else (such as a block received from another implementation) is encoded
+     * over again, after which the next update can be done in place.
+     */
+    if (block_size == 0 || block_size > sizeof(encoded) || v7_encode_canonical_content(logical, &content) != 0 ||
+        content.used != bplib_mpool_bblock_canonical_get_content_length(ccb) ||
+        (content_offset + content.used + crc_len) > block_size ||
+        bplib_mpool_bblock_cbor_export(chunks, encoded, sizeof(encoded), 0, block_size) != block_size ||
+        encoded[0] != (CborArrayType | (crc_len > 0 ? 6 : 5)) ||
+        (crc_len > 0 && encoded[block_size - crc_len - 1] != (CborByteStringType | crc_len)))
+    {
+        return v7_block_encode_canonical(ccb);
+    }
+
+    memcpy(&encoded[content_offset], scratch_area, content.used);
+
+    /* as when encoding, the CRC covers the whole block with the CRC value as zeros */
+    if (crc_len > 0)
+    {
+        memset(&encoded[block_size - crc_len], 0, crc_len);
+        crc_val = bplib_crc_update(crc_params, bplib_crc_initial_value(crc_params), encoded, block_size);
+        crc_val = bplib_crc_finalize(crc_params, crc_val);
+
+        for (i = block_size; i > (block_size - crc_len); --i)
+        {
+            encoded[i - 1] = crc_val & 0xFF;
+            crc_val >>= 8;
+        }
+    }
+
+    /* the size does not change, so the existing chunks are just written over */
+    if (bplib_mpool_bblock_cbor_overwrite(chunks, encoded, 0, block_size) != block_size)
+    {
+        return v7_block_encode_canonical(ccb);
+    }
+
+    return 0;
+}
@@ -35,15 +35,28 @@ typedef struct v7_encode_state
     bool                    crc_flag;
     bp_crcval_t             crc_val;
     bplib_crc_parameters_t *crc_params;
+    size_t                  crc_slice_size; /* writes are digested and written in slices of this, 0 for all at once */
 
     CborEncoder *cbor;
 
     size_t total_bytes_encoded;
 
+    /* where the creation timestamp was, for v7_block_encode_pri_template() */
+    size_t      timestamp_start;
+    size_t      timestamp_end;
+    bp_crcval_t timestamp_crc_val;
+
     v7_chunk_writer_func_t next_writer;
     void                  *next_writer_arg;
 } v7_encode_state_t;
 
+/*
+ * Largest primary block v7_encode_bp_primary_block_profile() can produce: the fixed fields,
+ * three ipn EIDs and the timestamp with every number at full width, and a 32-bit CRC.
+ * That comes to 108 octets, this leaves a bit of room.
+ */
+#define V7_PRI_PROFILE_MAX_SIZE 128
+
 typedef struct
 {
     bp_adminrectype_t                encode_rectype;
@@ -63,26 +76,32 @@ typedef struct
 typedef void (*v7_encode_func_t)(v7_encode_state_t *enc, const void *arg);
 
 void v7_encode_container(v7_encode_state_t *enc, size_t entries, v7_encode_func_t func, const void *arg);
+void v7_encode_container_fixed(v7_encode_state_t *enc, size_t entries, v7_encode_func_t func, const void *arg);
 
 /* Component encoders */
-void v7_encode_small_int(v7_encode_state_t *enc, int val);
-void v7_encode_crc(v7_encode_state_t *enc);
-void v7_encode_bp_integer(v7_encode_state_t *enc, const bp_integer_t *v);
-void v7_encode_bp_blocknum(v7_encode_state_t *enc, const bp_blocknum_t *v);
-void v7_encode_bp_blocktype(v7_encode_state_t *enc, const bp_blocktype_t *v);
-void v7_encode_bp_crctype(v7_encode_state_t *enc, const bp_crctype_t *v);
-void v7_encode_bp_dtntime(v7_encode_state_t *enc, const bp_dtntime_t *v);
-void v7_encode_bp_endpointid_buffer(v7_encode_state_t *enc, const bp_endpointid_buffer_t *v);
-void v7_encode_bitmap(v7_encode_state_t *enc, const uint8_t *v, const v7_bitmap_table_t *ptbl);
+void         v7_encode_small_int(v7_encode_state_t *enc, int val);
+void         v7_encode_crc(v7_encode_state_t *enc);
+void         v7_encode_bp_integer(v7_encode_state_t *enc, const bp_integer_t *v);
+void         v7_encode_fixed_head(v7_encode_state_t *enc, CborType type, uint64_t val, size_t width);
+void         v7_encode_bp_integer_fixed(v7_encode_state_t *enc, const bp_integer_t *v, size_t width);
+void         v7_encode_bp_blocknum(v7_encode_state_t *enc, const bp_blocknum_t *v);
+void         v7_encode_bp_blocktype(v7_encode_state_t *enc, const bp_blocktype_t *v);
+void         v7_encode_bp_crctype(v7_encode_state_t *enc, const bp_crctype_t *v);
+void         v7_encode_bp_dtntime(v7_encode_state_t *enc, const bp_dtntime_t *v);
+void         v7_encode_bp_endpointid_buffer(v7_encode_state_t *enc, const bp_endpointid_buffer_t *v);
+void         v7_encode_bp_endpointid_buffer_fixed(v7_encode_state_t *enc, const bp_endpointid_buffer_t *v);
+void         v7_encode_bitmap(v7_encode_state_t *enc, const uint8_t *v, const v7_bitmap_table_t *ptbl);
+bp_integer_t v7_get_bitmap(const uint8_t *v, const v7_bitmap_table_t *ptbl);
 
 /* Block encoders */
-void v7_encode_bp_primary_block(v7_encode_state_t *enc, const bp_primary_block_t *v);
-void v7_encode_bp_admin_record_payload(v7_encode_state_t *enc, const bp_canonical_block_buffer_t *v);
-void v7_encode_bp_previous_node_block(v7_encode_state_t *enc, const bp_previous_node_block_t *v);
-void v7_encode_bp_bundle_age_block(v7_encode_state_t *enc, const bp_bundle_age_block_t *v);
-void v7_encode_bp_hop_count_block(v7_encode_state_t *enc, const bp_hop_count_block_t *v);
-void v7_encode_bp_custody_tracking_block(v7_encode_state_t *enc, const bp_custody_tracking_block_t *v);
-void v7_encode_bp_custody_acknowledement_record(v7_encode_state_t *enc, const bp_custody_accept_payload_block_t *v);
+void   v7_encode_bp_primary_block(v7_encode_state_t *enc, const bp_primary_block_t *v);
+size_t v7_encode_bp_primary_block_profile(uint8_t *buf, const bp_primary_block_t *v);
+void   v7_encode_bp_admin_record_payload(v7_encode_state_t *enc, const bp_canonical_block_buffer_t *v);
+void   v7_encode_bp_previous_node_block(v7_encode_state_t *enc, const bp_previous_node_block_t *v);
+void   v7_encode_bp_bundle_age_block(v7_encode_state_t *enc, const bp_bundle_age_block_t *v);
+void   v7_encode_bp_hop_count_block(v7_encode_state_t *enc, const bp_hop_count_block_t *v);
+void   v7_encode_bp_custody_tracking_block(v7_encode_state_t *enc, const bp_custody_tracking_block_t *v);
+void   v7_encode_bp_custody_acknowledement_record(v7_encode_state_t *enc, const bp_custody_accept_payload_block_t *v);
 
 void v7_encode_bp_canonical_bundle_block(v7_encode_state_t *enc, const bp_canonical_bundle_block_t *v,
                                          const v7_canonical_block_info_t *info);
@@ -94,6 +113,7 @@ int       v7_encoder_mpstream_write(void *arg, const void *ptr, size_t sz);
 int       v7_encoder_write_crc(v7_encode_state_t *enc);
 CborError v7_encoder_write_wrapper(void *arg, const void *ptr, size_t sz, CborEncoderAppendType at);
 void      v7_encode_bp_adminrec_payload_impl(v7_encode_state_t *enc, const void *arg);
+void      v7_encode_bp_custody_acceptance_range_impl(v7_encode_state_t *enc, const void *arg);
 void      v7_encode_bp_custody_acceptance_seqlist_impl(v7_encode_state_t *enc, const void *arg);
 void      v7_encode_bp_endpointid_scheme(v7_encode_state_t *enc, const bp_endpointid_scheme_t *v);
 void      v7_encode_bp_ipn_nodenumber(v7_encode_state_t *enc, const bp_ipn_nodenumber_t *v);
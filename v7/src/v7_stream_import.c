@@ -0,0 +1,450 @@
+/*
+ * NASA Docket No. GSC-18,587-1 and identified as “The Bundle Protocol Core Flight
+ * System Application (BP) v6.5”
+ *
+ * Copyright © 2020 United States Government as represented by the Administrator of
+ * the National Aeronautics and Space Administration. All Rights Reserved.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "v7_decode_internal.h"
+
+/*
+ * -----------------------------------------------------------------------------------
+ * IMPLEMENTATION
+ * Helpers for each phase of a streamed bundle
+ * -----------------------------------------------------------------------------------
+ */
+
+static void v7_stream_import_fail(v7_stream_import_t *sis)
+{
+    if (sis->ccb != NULL)
+    {
+        /* this returns whatever was written of the large block so far */
+        bplib_mpool_stream_close(&sis->mps);
+        sis->ccb = NULL;
+    }
+
+    sis->phase = v7_stream_import_phase_error;
+}
+
+static void v7_stream_import_consume(v7_stream_import_t *sis, size_t size)
+{
+    sis->stage_len -= size;
+    memmove(sis->stage, sis->stage + size, sis->stage_len);
+}
+
+/*
+ * Writes part of the large block to the pool, and includes it in the CRC if that is being calculated
+ */
+static bool v7_stream_import_write(v7_stream_import_t *sis, const uint8_t *data, size_t size)
+{
+    if (bplib_mpool_stream_write(&sis->mps, data, size) != size)
+    {
+        return false;
+    }
+
+    if (sis->crc_params != NULL)
+    {
+        sis->crc_val = bplib_crc_update(sis->crc_params, sis->crc_val, data, size);
+    }
+
+    return true;
+}
+
+static size_t v7_stream_import_content(v7_stream_import_t *sis, const uint8_t *data, size_t size)
+{
+    if (size > sis->content_remain)
+    {
+        size = sis->content_remain;
+    }
+
+    if (!v7_stream_import_write(sis, data, size))
+    {
+        v7_stream_import_fail(sis);
+        return 0;
+    }
+
+    sis->content_remain -= size;
+    if (sis->content_remain == 0)
+    {
+        sis->phase = v7_stream_import_phase_trailer;
+    }
+
+    return size;
+}
+
+/*
+ * Starts on a block whose header is at the start of the stage, but which is too big to fit in it
+ */
+static void v7_stream_import_start_content(v7_stream_import_t *sis, const v7_scan_block_t *scanned,
+                                           size_t trailer_size)
+{
+    bplib_mpool_t                  *ppool;
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+
+    ppool = bplib_mpool_get_parent_pool_from_link(&sis->cpb->chunk_list);
+    cblk  = bplib_mpool_bblock_canonical_alloc(ppool, 0, NULL);
+    ccb   = bplib_mpool_bblock_canonical_cast(cblk);
+    if (ccb == NULL)
+    {
+        /* no mem */
+        v7_stream_import_fail(sis);
+        return;
+    }
+
+    /* Preemptively store it; the whole chain will be discarded if decode fails */
+    bplib_mpool_bblock_primary_append(sis->cpb, cblk);
+
+    if (v7_block_decode_canonical_streamed(ccb, scanned, sis->payload_block_hint) < 0)
+    {
+        v7_stream_import_fail(sis);
+        return;
+    }
+
+    bplib_mpool_start_stream_init(&sis->mps, ppool, bplib_mpool_stream_dir_write);
+    sis->ccb            = ccb;
+    sis->content_remain = scanned->content_size;
+    sis->trailer_size   = trailer_size;
+    sis->block_size     = scanned->content_offset + scanned->content_size + trailer_size;
+    sis->crc_params     = NULL;
+    sis->phase          = v7_stream_import_phase_content;
+
+    /* the CRC can also be checked later, on the chunks that are written here */
+    if (scanned->crctype != bp_crctype_none && (sis->import_flags & V7_IMPORT_DEFER_CRC) == 0)
+    {
+        sis->crc_params = v7_codec_get_crc_algorithm(scanned->crctype);
+        sis->crc_val    = bplib_crc_initial_value(sis->crc_params);
+    }
+
+    if (!v7_stream_import_write(sis, sis->stage, scanned->content_offset))
+    {
+        v7_stream_import_fail(sis);
+        return;
+    }
+
+    v7_stream_import_consume(sis, scanned->content_offset);
+}
+
+/*
+ * Completes the large block, once the trailer (if any) is at the start of the stage
+ */
+static void v7_stream_import_finish_content(v7_stream_import_t *sis)
+{
+    static const uint8_t ZERO_BYTES[4] = {0};
+
+    bp_canonical_block_buffer_t *logical;
+    v7_raw_reader_t              rd;
+    size_t                       crc_len;
+    bp_crcval_t                  crc_val;
+
+    logical = bplib_mpool_bblock_canonical_get_logical(sis->ccb);
+
+    if (sis->trailer_size != 0)
+    {
+        /* the CRC is a byte string, the head of which is always a single byte here */
+        rd.ptr   = sis->stage;
+        rd.end   = rd.ptr + sis->trailer_size;
+        rd.error = false;
+        crc_len  = sis->trailer_size - 1;
+
+        logical->canonical_block.crcval = v7_raw_get_crc(&rd);
+        if (rd.error || rd.ptr != rd.end || !v7_stream_import_write(sis, sis->stage, 1) ||
+            bplib_mpool_stream_write(&sis->mps, sis->stage + 1, crc_len) != crc_len)
+        {
+            v7_stream_import_fail(sis);
+            return;
+        }
+
+        /* same as v7_verify_block_crc(), the CRC is calculated with zero bytes in place of itself */
+        if (sis->crc_params != NULL)
+        {
+            crc_val = bplib_crc_update(sis->crc_params, sis->crc_val, ZERO_BYTES, crc_len);
+            crc_val = bplib_crc_finalize(sis->crc_params, crc_val);
+            if (crc_val != logical->canonical_block.crcval)
+            {
+                v7_stream_import_fail(sis);
+                return;
+            }
+        }
+    }
+
+    bplib_mpool_stream_attach(&sis->mps, bplib_mpool_bblock_canonical_get_encoded_chunks(sis->ccb));
+    bplib_mpool_stream_close(&sis->mps);
+    bplib_mpool_bblock_canonical_set_encode_size(sis->ccb, sis->block_size);
+
+    v7_stream_import_consume(sis, sis->trailer_size);
+    sis->ccb   = NULL;
+    sis->phase = v7_stream_import_phase_block;
+}
+
+/*
+ * Decodes a canonical block that is all in the stage, the same way as v7_import_scanned_bundle() does
+ */
+static void v7_stream_import_canonical(v7_stream_import_t *sis, const v7_scan_block_t *scanned)
+{
+    bplib_mpool_block_t            *cblk;
+    bplib_mpool_bblock_canonical_t *ccb;
+
+    if ((sis->import_flags & V7_IMPORT_DEFER_CRC) == 0 && scanned->crctype != bp_crctype_none &&
+        !v7_verify_block_crc(sis->stage, scanned->size, scanned->crctype, scanned->crcval))
+    {
+        v7_stream_import_fail(sis);
+        return;
+    }
+
+    cblk = bplib_mpool_bblock_canonical_alloc(bplib_mpool_get_parent_pool_from_link(&sis->cpb->chunk_list), 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (ccb == NULL)
+    {
+        /* no mem */
+        v7_stream_import_fail(sis);
+        return;
+    }
+
+    /* Preemptively store it; the whole chain will be discarded if decode fails */
+    bplib_mpool_bblock_primary_append(sis->cpb, cblk);
+
+    if (v7_block_decode_canonical_scanned(ccb, sis->stage, scanned, sis->payload_block_hint, NULL,
+                                          (sis->import_flags & V7_IMPORT_LAZY_DECODE) != 0) < 0)
+    {
+        v7_stream_import_fail(sis);
+        return;
+    }
+
+    v7_apply_extension_block_hint(sis->cpb, ccb, &sis->payload_block_hint);
+}
+
+/*
+ * Handles whatever is at the start of the stage, when it is the start of a block (or the end of the bundle)
+ */
+static void v7_stream_import_block(v7_stream_import_t *sis)
+{
+    v7_scan_block_t scanned;
+    size_t          block_size;
+    size_t          trailer_size;
+    size_t          room;
+    bool            is_primary;
+
+    /* First block is always a primary block, anything beyond that is a canonical block */
+    is_primary = (sis->cpb->block_encode_size_cache == 0);
+
+    if (sis->stage[0] == 0xFF) /* CBOR break code */
+    {
+        if (is_primary)
+        {
+            v7_stream_import_fail(sis);
+        }
+        else
+        {
+            v7_stream_import_consume(sis, 1);
+            sis->phase = v7_stream_import_phase_done;
+        }
+        return;
+    }
+
+    block_size = v7_scan_block(sis->stage, sis->stage_len, is_primary, &scanned);
+    if (block_size != 0 && is_primary)
+    {
+        if (v7_block_decode_pri_ext(sis->cpb, sis->stage, block_size, NULL) < 0 ||
+            sis->cpb->block_encode_size_cache != block_size)
+        {
+            v7_stream_import_fail(sis);
+            return;
+        }
+
+        /* see the comment in v7_import_full_bundle() regarding the payload hint */
+        if (sis->cpb->data.logical.controlFlags.isAdminRecord)
+        {
+            sis->payload_block_hint = bp_blocktype_adminRecordPayloadBlock;
+        }
+
+        v7_stream_import_consume(sis, block_size);
+    }
+    else if (block_size != 0)
+    {
+        v7_stream_import_canonical(sis, &scanned);
+        v7_stream_import_consume(sis, block_size);
+    }
+    else if (!is_primary && v7_scan_canonical_head(sis->stage, sis->stage_len, &scanned) != 0)
+    {
+        /* the block is not all here yet, and if it never could be then the rest of it is streamed */
+        trailer_size = 0;
+        if (scanned.crctype != bp_crctype_none)
+        {
+            trailer_size = 1 + (bplib_crc_get_width(v7_codec_get_crc_algorithm(scanned.crctype)) / 8);
+            if (trailer_size == 1 || trailer_size > 5)
+            {
+                v7_stream_import_fail(sis);
+                return;
+            }
+        }
+
+        room = sis->stage_size - scanned.content_offset;
+        if (trailer_size >= room || scanned.content_size > (room - trailer_size))
+        {
+            if (scanned.content_size > (SIZE_MAX - sis->stage_size))
+            {
+                v7_stream_import_fail(sis);
+                return;
+            }
+
+            v7_stream_import_start_content(sis, &scanned, trailer_size);
+        }
+    }
+}
+
+/*
+ * Makes as much progress as the data in the stage allows
+ */
+static void v7_stream_import_process(v7_stream_import_t *sis)
+{
+    v7_stream_import_phase_t prev_phase;
+    size_t                   prev_len;
+
+    do
+    {
+        prev_phase = sis->phase;
+        prev_len   = sis->stage_len;
+
+        switch (sis->phase)
+        {
+            case v7_stream_import_phase_start:
+                if (sis->stage_len == 0)
+                {
+                    /* nothing yet */
+                }
+                else if (sis->stage[0] != 0x9F) /* CBOR indefinite-length array */
+                {
+                    /* not well formed BP */
+                    v7_stream_import_fail(sis);
+                }
+                else
+                {
+                    v7_stream_import_consume(sis, 1);
+                    sis->phase = v7_stream_import_phase_block;
+                }
+                break;
+
+            case v7_stream_import_phase_block:
+                if (sis->stage_len != 0)
+                {
+                    v7_stream_import_block(sis);
+                }
+                break;
+
+            case v7_stream_import_phase_content:
+                v7_stream_import_consume(sis, v7_stream_import_content(sis, sis->stage, sis->stage_len));
+                break;
+
+            case v7_stream_import_phase_trailer:
+                if (sis->stage_len >= sis->trailer_size)
+                {
+                    v7_stream_import_finish_content(sis);
+                }
+                break;
+
+            default:
+                /* nothing more to do */
+                break;
+        }
+    } while (sis->phase != prev_phase || sis->stage_len != prev_len);
+
+    /*
+     * A full stage that could not be used means a block that does not fit and cannot be streamed,
+     * and anything left after the end of the bundle means it was not the size it should be.
+     */
+    if ((sis->phase == v7_stream_import_phase_block && sis->stage_len == sis->stage_size) ||
+        (sis->phase == v7_stream_import_phase_done && sis->stage_len != 0))
+    {
+        v7_stream_import_fail(sis);
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------------
+ * EXPORTED FUNCTIONS
+ * -----------------------------------------------------------------------------------
+ */
+
+void v7_stream_import_begin(v7_stream_import_t *sis, bplib_mpool_bblock_primary_t *cpb, uint8_t *stage,
+                            size_t stage_size, uint32_t import_flags)
+{
+    memset(sis, 0, sizeof(*sis));
+
+    sis->cpb                = cpb;
+    sis->stage              = stage;
+    sis->stage_size         = stage_size;
+    sis->import_flags       = import_flags;
+    sis->payload_block_hint = bp_blocktype_undefined;
+    sis->phase              = v7_stream_import_phase_start;
+
+    /* same as v7_import_full_bundle(), anything the bundle already had is dropped */
+    bplib_mpool_bblock_primary_drop_encode(cpb);
+    bplib_mpool_bblock_primary_drop_canonical_blocks(cpb);
+    cpb->data.delivery.crc_deferred = false;
+}
+
+bool v7_stream_import_feed(v7_stream_import_t *sis, const void *data, size_t size)
+{
+    const uint8_t *in_p;
+    size_t         chunk_sz;
+
+    in_p = data;
+    while (size > 0 && sis->phase != v7_stream_import_phase_error)
+    {
+        if (sis->phase == v7_stream_import_phase_content && sis->stage_len == 0)
+        {
+            /* the bulk of a large block does not need to go through the stage */
+            chunk_sz = v7_stream_import_content(sis, in_p, size);
+        }
+        else
+        {
+            chunk_sz = sis->stage_size - sis->stage_len;
+            if (chunk_sz > size)
+            {
+                chunk_sz = size;
+            }
+            memcpy(sis->stage + sis->stage_len, in_p, chunk_sz);
+            sis->stage_len += chunk_sz;
+        }
+
+        in_p += chunk_sz;
+        size -= chunk_sz;
+        sis->total_in += chunk_sz;
+
+        v7_stream_import_process(sis);
+    }
+
+    return (sis->phase != v7_stream_import_phase_error);
+}
+
+size_t v7_stream_import_end(v7_stream_import_t *sis)
+{
+    if (sis->phase != v7_stream_import_phase_done)
+    {
+        v7_stream_import_fail(sis);
+        return 0;
+    }
+
+    sis->cpb->data.delivery.crc_deferred = ((sis->import_flags & V7_IMPORT_DEFER_CRC) != 0);
+    sis->cpb->bundle_encode_size_cache   = sis->total_in;
+
+    return sis->cpb->bundle_encode_size_cache;
+}
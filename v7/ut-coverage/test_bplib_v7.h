@@ -41,6 +41,15 @@ int  test_bplib_v7_writer_func_stub(void *arg, const void *data_ptr, size_t data
 void test_bplib_v7_encode_func_stub(v7_encode_state_t *enc, const void *arg);
 void test_bplib_v7_decode_func_stub(v7_decode_state_t *dec, void *arg);
 
+/* collects everything written by test_bplib_v7_capture_writer(), to check the encoded octets */
+typedef struct test_bplib_v7_capture
+{
+    uint8_t data[64];
+    size_t  used;
+} test_bplib_v7_capture_t;
+
+int test_bplib_v7_capture_writer(void *arg, const void *data_ptr, size_t data_len);
+
 void TestBpV7_Register(void);
 void TestBpV7AdminRecord_Register(void);
 void TestBpV7Basetypes_Register(void);
@@ -53,10 +62,12 @@ void TestV7BpEndpointid_Rgister(void);
 void TestV7BpHopCountBlock_Rgister(void);
 void TestV7BpPreviousNodeBlock_Rgister(void);
 void TestV7BpPrimaryBlock_Rgister(void);
+void TestV7BundleScan_Rgister(void);
 void TestV7CodecCommon_Rgister(void);
 void TestV7CustodyAcknowledgementRecord_Rgister(void);
 void TestV7CustodyTrackingRecord_Rgister(void);
 void TestV7DecodecApi_Rgister(void);
 void TestV7EncodeApi_Rgister(void);
+void TestV7StreamImport_Rgister(void);
 
 #endif
@@ -73,6 +73,21 @@ int test_bplib_v7_writer_func_stub(void *arg, const void *data_ptr, size_t data_
     return UT_DEFAULT_IMPL(test_bplib_v7_writer_func_stub);
 }
 
+int test_bplib_v7_capture_writer(void *arg, const void *data_ptr, size_t data_len)
+{
+    test_bplib_v7_capture_t *cap = arg;
+
+    if (data_len > (sizeof(cap->data) - cap->used))
+    {
+        return BP_ERROR;
+    }
+
+    memcpy(&cap->data[cap->used], data_ptr, data_len);
+    cap->used += data_len;
+
+    return BP_SUCCESS;
+}
+
 void test_bplib_v7_encode_func_stub(v7_encode_state_t *enc, const void *arg) {}
 
 void test_bplib_v7_decode_func_stub(v7_decode_state_t *dec, void *arg) {}
@@ -91,9 +106,11 @@ void UtTest_Setup(void)
     TestV7BpHopCountBlock_Rgister();
     TestV7BpPreviousNodeBlock_Rgister();
     TestV7BpPrimaryBlock_Rgister();
+    TestV7BundleScan_Rgister();
     TestV7CodecCommon_Rgister();
     TestV7CustodyAcknowledgementRecord_Rgister();
     TestV7CustodyTrackingRecord_Rgister();
     TestV7DecodecApi_Rgister();
     TestV7EncodeApi_Rgister();
+    TestV7StreamImport_Rgister();
 }
@@ -101,6 +101,71 @@ void test_v7_encode_bp_integer(void)
     UtAssert_VOIDCALL(v7_encode_bp_integer(&enc, &v));
 }
 
+void test_v7_encode_fixed_head(void)
+{
+    /* Test function for:
+     * void v7_encode_fixed_head(v7_encode_state_t *enc, CborType type, uint64_t val, size_t width)
+     */
+    v7_encode_state_t       enc;
+    test_bplib_v7_capture_t cap;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&cap, 0, sizeof(cap));
+
+    enc.next_writer     = test_bplib_v7_capture_writer;
+    enc.next_writer_arg = &cap;
+
+    /* value in the initial byte */
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborArrayType, 5, 0));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 1);
+    UtAssert_UINT32_EQ(cap.data[0], 0x85);
+
+    /* every width takes the same space regardless of value */
+    cap.used = 0;
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 3, 1));
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0x1234, 2));
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0x10000, 4));
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0x0102030405060708, 8));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 19);
+    UtAssert_UINT32_EQ(cap.data[0], 0x18);
+    UtAssert_UINT32_EQ(cap.data[1], 0x03);
+    UtAssert_UINT32_EQ(cap.data[2], 0x19);
+    UtAssert_UINT32_EQ(cap.data[3], 0x12);
+    UtAssert_UINT32_EQ(cap.data[4], 0x34);
+    UtAssert_UINT32_EQ(cap.data[5], 0x1a);
+    UtAssert_UINT32_EQ(cap.data[7], 0x01);
+    UtAssert_UINT32_EQ(cap.data[10], 0x1b);
+    UtAssert_UINT32_EQ(cap.data[11], 0x01);
+    UtAssert_UINT32_EQ(cap.data[18], 0x08);
+    UtAssert_UINT32_EQ(enc.total_bytes_encoded, 20);
+
+    /* value does not fit */
+    cap.used = 0;
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborArrayType, 24, 0));
+    UtAssert_BOOL_TRUE(enc.error);
+    enc.error = false;
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0x100, 1));
+    UtAssert_BOOL_TRUE(enc.error);
+
+    /* not a CBOR width */
+    enc.error = false;
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0, 3));
+    UtAssert_BOOL_TRUE(enc.error);
+
+    /* does nothing once in error */
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0, 1));
+    UtAssert_ZERO(cap.used);
+
+    /* write failure */
+    enc.error       = false;
+    enc.next_writer = test_bplib_v7_writer_func_stub;
+    UT_SetDefaultReturnValue(UT_KEY(test_bplib_v7_writer_func_stub), BP_ERROR);
+    UtAssert_VOIDCALL(v7_encode_fixed_head(&enc, CborIntegerType, 0, 1));
+    UtAssert_BOOL_TRUE(enc.error);
+}
+
 void test_v7_decode_bp_blocknum(void)
 {
     /* Test function for:
@@ -152,6 +217,7 @@ void TestBpV7Basetypes_Register(void)
     UtTest_Add(test_v7_decode_small_int, NULL, NULL, "Test v7_decode_small_int");
     UtTest_Add(test_v7_decode_bp_integer, NULL, NULL, "Test v7_decode_bp_integer");
     UtTest_Add(test_v7_encode_bp_integer, NULL, NULL, "Test v7_encode_bp_integer");
+    UtTest_Add(test_v7_encode_fixed_head, NULL, NULL, "Test v7_encode_fixed_head");
     UtTest_Add(test_v7_decode_bp_blocknum, NULL, NULL, "Test v7_decode_bp_blocknum");
     UtTest_Add(test_v7_decode_bp_blocktype, NULL, NULL, "Test v7_decode_bp_blocktype");
     UtTest_Add(test_v7_decode_bp_crctype, NULL, NULL, "Test v7_decode_bp_crctype");
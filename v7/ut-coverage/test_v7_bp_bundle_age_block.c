@@ -21,6 +21,31 @@
  */
 #include "test_bplib_v7.h"
 
+void test_v7_encode_bp_bundle_age_block(void)
+{
+    /* Test function for:
+     * void v7_encode_bp_bundle_age_block(v7_encode_state_t *enc, const bp_bundle_age_block_t *v)
+     */
+    v7_encode_state_t       enc;
+    bp_bundle_age_block_t   v;
+    test_bplib_v7_capture_t cap;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&v, 0, sizeof(bp_bundle_age_block_t));
+    memset(&cap, 0, sizeof(cap));
+
+    enc.next_writer     = test_bplib_v7_capture_writer;
+    enc.next_writer_arg = &cap;
+
+    v.age = 1000;
+    UtAssert_VOIDCALL(v7_encode_bp_bundle_age_block(&enc, &v));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 9);
+    UtAssert_UINT32_EQ(cap.data[0], 0x1b);
+    UtAssert_UINT32_EQ(cap.data[7], 0x03);
+    UtAssert_UINT32_EQ(cap.data[8], 0xe8);
+}
+
 void test_v7_decode_bp_bundle_age_block(void)
 {
     /* Test function for:
@@ -38,5 +63,6 @@ void test_v7_decode_bp_bundle_age_block(void)
 
 void TestBpV7BundleAgeBlock_Register(void)
 {
+    UtTest_Add(test_v7_encode_bp_bundle_age_block, NULL, NULL, "Test v7_encode_bp_bundle_age_block");
     UtTest_Add(test_v7_decode_bp_bundle_age_block, NULL, NULL, "Test v7_decode_bp_bundle_age_block");
 }
@@ -45,6 +45,30 @@ void test_v7_encode_container(void)
     UtAssert_VOIDCALL(v7_encode_container(&enc, entries, func, &arg));
 }
 
+void test_v7_encode_container_fixed(void)
+{
+    /* Test function for:
+     * void v7_encode_container_fixed(v7_encode_state_t *enc, size_t entries, v7_encode_func_t func, const void *arg)
+     */
+    v7_encode_state_t       enc;
+    test_bplib_v7_capture_t cap;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&cap, 0, sizeof(cap));
+
+    enc.next_writer     = test_bplib_v7_capture_writer;
+    enc.next_writer_arg = &cap;
+    UtAssert_VOIDCALL(v7_encode_container_fixed(&enc, 2, test_bplib_v7_encode_func_stub, NULL));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 1);
+    UtAssert_UINT32_EQ(cap.data[0], 0x82);
+
+    /* too many entries for the fixed head */
+    UtAssert_VOIDCALL(v7_encode_container_fixed(&enc, 24, test_bplib_v7_encode_func_stub, NULL));
+    UtAssert_BOOL_TRUE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 1);
+}
+
 void test_v7_decode_container(void)
 {
     /* Test function for:
@@ -78,5 +102,6 @@ void test_v7_decode_container(void)
 void TestV7BpContainer_Rgister(void)
 {
     UtTest_Add(test_v7_encode_container, NULL, NULL, "Test v7_encode_container");
+    UtTest_Add(test_v7_encode_container_fixed, NULL, NULL, "Test v7_encode_container_fixed");
     UtTest_Add(test_v7_decode_container, NULL, NULL, "Test v7_decode_container");
 }
@@ -114,6 +114,45 @@ void test_v7_encode_bp_endpointid_buffer_impl(void)
     UtAssert_VOIDCALL(v7_encode_bp_endpointid_buffer_impl(&enc, &v));
 }
 
+void test_v7_encode_bp_endpointid_buffer_fixed(void)
+{
+    /* Test function for:
+     * void v7_encode_bp_endpointid_buffer_fixed(v7_encode_state_t *enc, const bp_endpointid_buffer_t *v)
+     */
+    v7_encode_state_t       enc;
+    bp_endpointid_buffer_t  v;
+    test_bplib_v7_capture_t cap;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&v, 0, sizeof(bp_endpointid_buffer_t));
+    memset(&cap, 0, sizeof(cap));
+
+    enc.next_writer     = test_bplib_v7_capture_writer;
+    enc.next_writer_arg = &cap;
+
+    /* only ipn has a fixed width form */
+    v.scheme = bp_endpointid_scheme_dtn;
+    UtAssert_VOIDCALL(v7_encode_bp_endpointid_buffer_fixed(&enc, &v));
+    UtAssert_BOOL_TRUE(enc.error);
+    UtAssert_ZERO(cap.used);
+
+    /* the node and service numbers take the full width, however small they are */
+    enc.error                = false;
+    v.scheme                 = bp_endpointid_scheme_ipn;
+    v.ssp.ipn.node_number    = 100;
+    v.ssp.ipn.service_number = 1;
+    UtAssert_VOIDCALL(v7_encode_bp_endpointid_buffer_fixed(&enc, &v));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 21);
+    UtAssert_UINT32_EQ(cap.data[0], 0x82);
+    UtAssert_UINT32_EQ(cap.data[1], bp_endpointid_scheme_ipn);
+    UtAssert_UINT32_EQ(cap.data[2], 0x82);
+    UtAssert_UINT32_EQ(cap.data[3], 0x1b);
+    UtAssert_UINT32_EQ(cap.data[11], 100);
+    UtAssert_UINT32_EQ(cap.data[12], 0x1b);
+    UtAssert_UINT32_EQ(cap.data[20], 1);
+}
+
 void test_v7_decode_bp_endpointid_scheme(void)
 {
     /* Test function for:
@@ -238,6 +277,7 @@ void TestV7BpEndpointid_Rgister(void)
     UtTest_Add(test_v7_encode_bp_ipn_uri_ssp_impl, NULL, NULL, "Test v7_encode_bp_ipn_uri_ssp_impl");
     UtTest_Add(test_v7_encode_bp_ipn_uri_ssp, NULL, NULL, "Test v7_encode_bp_ipn_uri_ssp");
     UtTest_Add(test_v7_encode_bp_endpointid_buffer_impl, NULL, NULL, "Test v7_encode_bp_endpointid_buffer_impl");
+    UtTest_Add(test_v7_encode_bp_endpointid_buffer_fixed, NULL, NULL, "Test v7_encode_bp_endpointid_buffer_fixed");
     UtTest_Add(test_v7_decode_bp_endpointid_scheme, NULL, NULL, "Test v7_decode_bp_endpointid_scheme");
     UtTest_Add(test_v7_decode_bp_ipn_nodenumber, NULL, NULL, "Test v7_decode_bp_ipn_nodenumber");
     UtTest_Add(test_v7_decode_bp_ipn_servicenumber, NULL, NULL, "Test v7_decode_bp_ipn_servicenumber");
@@ -36,6 +36,44 @@ void test_v7_encode_bp_hop_count_block_impl(void)
     UtAssert_VOIDCALL(v7_encode_bp_hop_count_block_impl(&enc, &arg));
 }
 
+void test_v7_encode_bp_hop_count_block(void)
+{
+    /* Test function for:
+     * void v7_encode_bp_hop_count_block(v7_encode_state_t *enc, const bp_hop_count_block_t *v)
+     */
+    v7_encode_state_t       enc;
+    bp_hop_count_block_t    v;
+    test_bplib_v7_capture_t cap;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&v, 0, sizeof(bp_hop_count_block_t));
+    memset(&cap, 0, sizeof(cap));
+
+    enc.next_writer     = test_bplib_v7_capture_writer;
+    enc.next_writer_arg = &cap;
+
+    /* within the RFC9171 hop limit, one octet each */
+    v.hopLimit = 30;
+    v.hopCount = 3;
+    UtAssert_VOIDCALL(v7_encode_bp_hop_count_block(&enc, &v));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 5);
+    UtAssert_UINT32_EQ(cap.data[0], 0x82);
+    UtAssert_UINT32_EQ(cap.data[1], 0x18);
+    UtAssert_UINT32_EQ(cap.data[2], 30);
+    UtAssert_UINT32_EQ(cap.data[3], 0x18);
+    UtAssert_UINT32_EQ(cap.data[4], 3);
+
+    /* beyond it, the full width */
+    cap.used   = 0;
+    v.hopLimit = 300;
+    UtAssert_VOIDCALL(v7_encode_bp_hop_count_block(&enc, &v));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 19);
+    UtAssert_UINT32_EQ(cap.data[1], 0x1b);
+    UtAssert_UINT32_EQ(cap.data[10], 0x1b);
+}
+
 void test_v7_decode_bp_hop_count_block_impl(void)
 {
     /* Test function for:
@@ -72,6 +110,7 @@ void test_v7_decode_bp_hop_count_block(void)
 void TestV7BpHopCountBlock_Rgister(void)
 {
     UtTest_Add(test_v7_encode_bp_hop_count_block_impl, NULL, NULL, "Test v7_encode_bp_hop_count_block_impl");
+    UtTest_Add(test_v7_encode_bp_hop_count_block, NULL, NULL, "Test v7_encode_bp_hop_count_block");
     UtTest_Add(test_v7_decode_bp_hop_count_block_impl, NULL, NULL, "Test v7_decode_bp_hop_count_block_impl");
     UtTest_Add(test_v7_decode_bp_hop_count_block, NULL, NULL, "Test v7_decode_bp_hop_count_block");
 }
@@ -21,6 +21,40 @@
  */
 #include "test_bplib_v7.h"
 
+void test_v7_encode_bp_previous_node_block(void)
+{
+    /* Test function for:
+     * void v7_encode_bp_previous_node_block(v7_encode_state_t *enc, const bp_previous_node_block_t *v)
+     */
+    v7_encode_state_t        enc;
+    bp_previous_node_block_t v;
+    test_bplib_v7_capture_t  cap;
+    CborEncoder              cval;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&v, 0, sizeof(bp_previous_node_block_t));
+    memset(&cap, 0, sizeof(cap));
+    memset(&cval, 0, sizeof(CborEncoder));
+
+    enc.cbor            = &cval;
+    enc.next_writer     = test_bplib_v7_capture_writer;
+    enc.next_writer_arg = &cap;
+
+    /* an ipn node ID is the fixed width form */
+    v.nodeId.scheme              = bp_endpointid_scheme_ipn;
+    v.nodeId.ssp.ipn.node_number = 100;
+    UtAssert_VOIDCALL(v7_encode_bp_previous_node_block(&enc, &v));
+    UtAssert_BOOL_FALSE(enc.error);
+    UtAssert_UINT32_EQ(cap.used, 21);
+
+    /* anything else goes through tinycbor as usual */
+    cap.used        = 0;
+    v.nodeId.scheme = bp_endpointid_scheme_dtn;
+    UtAssert_VOIDCALL(v7_encode_bp_previous_node_block(&enc, &v));
+    UtAssert_STUB_COUNT(cbor_encoder_create_array, 2);
+    UtAssert_ZERO(cap.used);
+}
+
 void test_v7_decode_bp_previous_node_block(void)
 {
     /* Test function for:
@@ -38,5 +72,6 @@ void test_v7_decode_bp_previous_node_block(void)
 
 void TestV7BpPreviousNodeBlock_Rgister(void)
 {
+    UtTest_Add(test_v7_encode_bp_previous_node_block, NULL, NULL, "Test v7_encode_bp_previous_node_block");
     UtTest_Add(test_v7_decode_bp_previous_node_block, NULL, NULL, "Test v7_decode_bp_previous_node_block");
 }
@@ -132,6 +132,129 @@ void test_v7_encode_bp_primary_block_impl(void)
     UtAssert_VOIDCALL(v7_encode_bp_primary_block_impl(&enc, &v));
 }
 
+/* an admin record from ipn:1.1 to ipn:100.1, with a CRC16 */
+static const uint8_t UT_V7_PROFILE_PRI_BLOCK[] = {0x89, 0x07, 0x02, 0x01, 0x82, 0x02, 0x82, 0x18, 0x64,
+                                                  0x01, 0x82, 0x02, 0x82, 0x01, 0x01, 0x82, 0x02, 0x82,
+                                                  0x00, 0x00, 0x82, 0x1A, 0x12, 0x34, 0x56, 0x78, 0x03,
+                                                  0x1A, 0x00, 0x36, 0xEE, 0x80, 0x42, 0xAB, 0xCD};
+
+void test_v7_encode_bp_primary_block_profile(void)
+{
+    /* Test function for:
+     * size_t v7_encode_bp_primary_block_profile(uint8_t *buf, const bp_primary_block_t *v)
+     */
+    bp_primary_block_t v;
+    uint8_t            buf[V7_PRI_PROFILE_MAX_SIZE];
+
+    memset(&v, 0, sizeof(bp_primary_block_t));
+    memset(buf, 0, sizeof(buf));
+
+    v.version                               = 7;
+    v.controlFlags.isAdminRecord            = true;
+    v.crctype                               = bp_crctype_CRC16;
+    v.destinationEID.scheme                 = bp_endpointid_scheme_ipn;
+    v.destinationEID.ssp.ipn.node_number    = 100;
+    v.destinationEID.ssp.ipn.service_number = 1;
+    v.sourceEID.scheme                      = bp_endpointid_scheme_ipn;
+    v.sourceEID.ssp.ipn.node_number         = 1;
+    v.sourceEID.ssp.ipn.service_number      = 1;
+    v.reportEID.scheme                      = bp_endpointid_scheme_ipn;
+    v.creationTimeStamp.time                = 0x12345678;
+    v.creationTimeStamp.sequence_num        = 3;
+    v.lifetime                              = 3600000;
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 16);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 0xABCD);
+    UtAssert_UINT32_EQ(v7_encode_bp_primary_block_profile(buf, &v), sizeof(UT_V7_PROFILE_PRI_BLOCK));
+    UtAssert_MemCmp(buf, UT_V7_PROFILE_PRI_BLOCK, sizeof(UT_V7_PROFILE_PRI_BLOCK), "Profile encoding");
+
+    /* without a CRC it is one field shorter */
+    v.crctype = bp_crctype_none;
+    UtAssert_UINT32_EQ(v7_encode_bp_primary_block_profile(buf, &v), sizeof(UT_V7_PROFILE_PRI_BLOCK) - 3);
+    UtAssert_UINT32_EQ(buf[0], 0x88);
+    UtAssert_UINT32_EQ(buf[3], 0x00);
+
+    /* anything else is left to the generic encoder */
+    v.crctype = bp_crctype_CRC32C;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 64);
+    UtAssert_ZERO(v7_encode_bp_primary_block_profile(buf, &v));
+
+    v.crctype = (bp_crctype_t)3;
+    UtAssert_ZERO(v7_encode_bp_primary_block_profile(buf, &v));
+
+    v.crctype                 = bp_crctype_none;
+    v.controlFlags.isFragment = true;
+    UtAssert_ZERO(v7_encode_bp_primary_block_profile(buf, &v));
+
+    v.controlFlags.isFragment = false;
+    v.reportEID.scheme        = bp_endpointid_scheme_dtn;
+    UtAssert_ZERO(v7_encode_bp_primary_block_profile(buf, &v));
+
+    v.reportEID.scheme = bp_endpointid_scheme_ipn;
+    v.version          = 6;
+    UtAssert_ZERO(v7_encode_bp_primary_block_profile(buf, &v));
+}
+
+void test_v7_decode_bp_primary_block_profile(void)
+{
+    /* Test function for:
+     * size_t v7_decode_bp_primary_block_profile(const uint8_t *ptr, size_t size, bp_primary_block_t *v)
+     */
+    bp_primary_block_t v;
+    uint8_t            buf[sizeof(UT_V7_PROFILE_PRI_BLOCK) + 1];
+
+    memset(&v, 0, sizeof(bp_primary_block_t));
+    memcpy(buf, UT_V7_PROFILE_PRI_BLOCK, sizeof(UT_V7_PROFILE_PRI_BLOCK));
+    buf[sizeof(UT_V7_PROFILE_PRI_BLOCK)] = 0xFF;
+
+    /* anything after the block is not looked at */
+    UtAssert_UINT32_EQ(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v), sizeof(UT_V7_PROFILE_PRI_BLOCK));
+    UtAssert_UINT32_EQ(v.version, 7);
+    UtAssert_BOOL_TRUE(v.controlFlags.isAdminRecord);
+    UtAssert_BOOL_FALSE(v.controlFlags.mustNotFragment);
+    UtAssert_UINT32_EQ(v.crctype, bp_crctype_CRC16);
+    UtAssert_UINT32_EQ(v.destinationEID.scheme, bp_endpointid_scheme_ipn);
+    UtAssert_UINT32_EQ(v.destinationEID.ssp.ipn.node_number, 100);
+    UtAssert_UINT32_EQ(v.destinationEID.ssp.ipn.service_number, 1);
+    UtAssert_UINT32_EQ(v.sourceEID.ssp.ipn.node_number, 1);
+    UtAssert_UINT32_EQ(v.reportEID.ssp.ipn.node_number, 0);
+    UtAssert_UINT32_EQ(v.creationTimeStamp.time, 0x12345678);
+    UtAssert_UINT32_EQ(v.creationTimeStamp.sequence_num, 3);
+    UtAssert_UINT32_EQ(v.lifetime, 3600000);
+    UtAssert_UINT32_EQ(v.crcval, 0xABCD);
+
+    /* cut short */
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(UT_V7_PROFILE_PRI_BLOCK) - 1, &v));
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, 0, &v));
+
+    /* a CRC type but no CRC */
+    buf[0] = 0x88;
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v));
+
+    /* not in the profile */
+    buf[0] = 0x8B;
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v));
+
+    buf[0] = 0x89;
+    buf[1] = 0x06;
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v));
+
+    buf[1] = 0x07;
+    buf[2] = 0x03; /* fragment */
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v));
+
+    buf[2] = 0x02;
+    buf[5] = 0x01; /* dtn scheme */
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v));
+
+    buf[5]  = 0x02;
+    buf[32] = 0x45; /* CRC too long */
+    UtAssert_ZERO(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v));
+
+    buf[32] = 0x42;
+    UtAssert_UINT32_EQ(v7_decode_bp_primary_block_profile(buf, sizeof(buf), &v), sizeof(UT_V7_PROFILE_PRI_BLOCK));
+}
+
 void test_v7_decode_bp_sequencenumber(void)
 {
     /* Test function for:
@@ -271,6 +394,7 @@ void TestV7BpPrimaryBlock_Rgister(void)
     UtTest_Add(test_v7_encode_bp_lifetime, NULL, NULL, "Test v7_encode_bp_lifetime");
     UtTest_Add(test_v7_encode_bp_adu_length, NULL, NULL, "Test v7_encode_bp_adu_length");
     UtTest_Add(test_v7_encode_bp_primary_block_impl, NULL, NULL, "Test v7_encode_bp_primary_block_impl");
+    UtTest_Add(test_v7_encode_bp_primary_block_profile, NULL, NULL, "Test v7_encode_bp_primary_block_profile");
     UtTest_Add(test_v7_decode_bp_sequencenumber, NULL, NULL, "Test v7_decode_bp_sequencenumber");
     UtTest_Add(test_v7_decode_bp_creation_timestamp_impl, NULL, NULL, "Test v7_decode_bp_creation_timestamp_impl");
     UtTest_Add(test_v7_decode_bp_creation_timestamp, NULL, NULL, "Test v7_decode_bp_creation_timestamp");
@@ -279,4 +403,5 @@ void TestV7BpPrimaryBlock_Rgister(void)
     UtTest_Add(test_v7_decode_bp_lifetime, NULL, NULL, "Test v7_decode_bp_lifetime");
     UtTest_Add(test_v7_decode_bp_adu_length, NULL, NULL, "Test v7_decode_bp_adu_length");
     UtTest_Add(test_v7_decode_bp_primary_block_impl, NULL, NULL, "Test v7_decode_bp_primary_block_impl");
+    UtTest_Add(test_v7_decode_bp_primary_block_profile, NULL, NULL, "Test v7_decode_bp_primary_block_profile");
 }
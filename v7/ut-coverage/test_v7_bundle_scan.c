@@ -0,0 +1,210 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "test_bplib_v7.h"
+
+/* a primary block, a bundle age block with a 16-bit CRC, and a payload, all well formed */
+static const uint8_t UT_V7_SCAN_BUNDLE[] = {
+    0x9F,
+
+    /* primary: version, flags, no CRC, dest/src/report EIDs, timestamp, lifetime */
+    0x88, 0x07, 0x00, 0x00, 0x82, 0x02, 0x82, 0x01, 0x02, 0x82, 0x02, 0x82, 0x01, 0x03, 0x82, 0x02, 0x82, 0x01,
+    0x04, 0x82, 0x00, 0x00, 0x00,
+
+    /* bundle age: type 7, number 2, flags 0, CRC16, content, CRC */
+    0x86, 0x07, 0x02, 0x00, 0x01, 0x41, 0x05, 0x42, 0x00, 0x00,
+
+    /* payload: type 1, number 1, flags 0, no CRC, content */
+    0x85, 0x01, 0x01, 0x00, 0x00, 0x43, 0x61, 0x62, 0x63,
+
+    0xFF};
+
+void test_v7_scan_bundle(void)
+{
+    /* Test function for:
+     * size_t v7_scan_bundle(const void *buffer, size_t buf_sz, v7_scan_table_t *table)
+     */
+    v7_scan_table_t table;
+    uint8_t         buf[sizeof(UT_V7_SCAN_BUNDLE)];
+
+    UtAssert_UINT32_EQ(v7_scan_bundle(UT_V7_SCAN_BUNDLE, sizeof(UT_V7_SCAN_BUNDLE), &table),
+                       sizeof(UT_V7_SCAN_BUNDLE));
+    UtAssert_UINT32_EQ(table.bundle_size, sizeof(UT_V7_SCAN_BUNDLE));
+    UtAssert_UINT32_EQ(table.num_blocks, 3);
+
+    UtAssert_UINT32_EQ(table.blocks[0].offset, 1);
+    UtAssert_UINT32_EQ(table.blocks[0].size, 23);
+    UtAssert_UINT32_EQ(table.blocks[0].crctype, bp_crctype_none);
+
+    UtAssert_UINT32_EQ(table.blocks[1].offset, 24);
+    UtAssert_UINT32_EQ(table.blocks[1].size, 10);
+    UtAssert_UINT32_EQ(table.blocks[1].block_type, bp_blocktype_bundleAge);
+    UtAssert_UINT32_EQ(table.blocks[1].block_num, 2);
+    UtAssert_UINT32_EQ(table.blocks[1].crctype, bp_crctype_CRC16);
+    UtAssert_UINT32_EQ(table.blocks[1].content_offset, 6);
+    UtAssert_UINT32_EQ(table.blocks[1].content_size, 1);
+
+    UtAssert_UINT32_EQ(table.blocks[2].offset, 34);
+    UtAssert_UINT32_EQ(table.blocks[2].size, 9);
+    UtAssert_UINT32_EQ(table.blocks[2].block_type, bp_blocktype_payloadBlock);
+    UtAssert_UINT32_EQ(table.blocks[2].content_offset, 6);
+    UtAssert_UINT32_EQ(table.blocks[2].content_size, 3);
+
+    /* not a bundle at all */
+    UtAssert_UINT32_EQ(v7_scan_bundle(UT_V7_SCAN_BUNDLE, 1, &table), 0);
+    UtAssert_UINT32_EQ(v7_scan_bundle(&UT_V7_SCAN_BUNDLE[1], sizeof(UT_V7_SCAN_BUNDLE) - 1, &table), 0);
+    UtAssert_UINT32_EQ(table.num_blocks, 0);
+
+    /* no break code */
+    UtAssert_UINT32_EQ(v7_scan_bundle(UT_V7_SCAN_BUNDLE, sizeof(UT_V7_SCAN_BUNDLE) - 1, &table), 0);
+
+    /* cut off in the middle of the payload */
+    UtAssert_UINT32_EQ(v7_scan_bundle(UT_V7_SCAN_BUNDLE, sizeof(UT_V7_SCAN_BUNDLE) - 3, &table), 0);
+
+    /* a CRC type with no CRC value */
+    memcpy(buf, UT_V7_SCAN_BUNDLE, sizeof(buf));
+    buf[38] = 0x01;
+    UtAssert_UINT32_EQ(v7_scan_bundle(buf, sizeof(buf), &table), 0);
+
+    /* indefinite length items are not used within blocks */
+    memcpy(buf, UT_V7_SCAN_BUNDLE, sizeof(buf));
+    buf[5] = 0x9F;
+    UtAssert_UINT32_EQ(v7_scan_bundle(buf, sizeof(buf), &table), 0);
+
+    /* primary block with too few fields */
+    memcpy(buf, UT_V7_SCAN_BUNDLE, sizeof(buf));
+    buf[1] = 0x87;
+    UtAssert_UINT32_EQ(v7_scan_bundle(buf, sizeof(buf), &table), 0);
+
+    /* content which is not a byte string */
+    memcpy(buf, UT_V7_SCAN_BUNDLE, sizeof(buf));
+    buf[39] = 0x63;
+    UtAssert_UINT32_EQ(v7_scan_bundle(buf, sizeof(buf), &table), 0);
+}
+
+void test_v7_scan_bundle_limits(void)
+{
+    /* Test function for:
+     * size_t v7_scan_bundle(const void *buffer, size_t buf_sz, v7_scan_table_t *table)
+     */
+    static const uint8_t PAYLOAD[] = {0x85, 0x01, 0x01, 0x00, 0x00, 0x40};
+    v7_scan_table_t      table;
+    uint8_t              buf[24 + (sizeof(PAYLOAD) * V7_SCAN_MAX_BLOCKS) + 1];
+    size_t               len;
+    size_t               i;
+
+    /* the primary block from the good bundle, then as many empty blocks as there is space for */
+    memcpy(buf, UT_V7_SCAN_BUNDLE, 24);
+    len = 24;
+    for (i = 1; i < V7_SCAN_MAX_BLOCKS; ++i)
+    {
+        memcpy(&buf[len], PAYLOAD, sizeof(PAYLOAD));
+        len += sizeof(PAYLOAD);
+    }
+
+    buf[len] = 0xFF;
+    UtAssert_UINT32_EQ(v7_scan_bundle(buf, len + 1, &table), len + 1);
+    UtAssert_UINT32_EQ(table.num_blocks, V7_SCAN_MAX_BLOCKS);
+
+    /* one more is not accepted */
+    memcpy(&buf[len], PAYLOAD, sizeof(PAYLOAD));
+    len += sizeof(PAYLOAD);
+    buf[len] = 0xFF;
+    UtAssert_UINT32_EQ(v7_scan_bundle(buf, len + 1, &table), 0);
+    UtAssert_UINT32_EQ(table.num_blocks, 0);
+}
+
+void test_v7_scan_verify_canonical_crcs(void)
+{
+    /* Test function for:
+     * bool v7_scan_verify_canonical_crcs(const void *buffer, const v7_scan_table_t *table)
+     */
+    v7_scan_table_t table;
+
+    UtAssert_UINT32_EQ(v7_scan_bundle(UT_V7_SCAN_BUNDLE, sizeof(UT_V7_SCAN_BUNDLE), &table),
+                       sizeof(UT_V7_SCAN_BUNDLE));
+
+    /* only the bundle age block has a CRC */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 16);
+    UtAssert_BOOL_TRUE(v7_scan_verify_canonical_crcs(UT_V7_SCAN_BUNDLE, &table));
+    UtAssert_STUB_COUNT(bplib_crc_finalize, 1);
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 0x1234);
+    UtAssert_BOOL_FALSE(v7_scan_verify_canonical_crcs(UT_V7_SCAN_BUNDLE, &table));
+}
+
+void test_v7_scan_block(void)
+{
+    /* Test function for:
+     * size_t v7_scan_block(const void *buffer, size_t buf_sz, bool is_primary, v7_scan_block_t *block)
+     */
+    v7_scan_block_t block;
+
+    UtAssert_UINT32_EQ(v7_scan_block(&UT_V7_SCAN_BUNDLE[1], sizeof(UT_V7_SCAN_BUNDLE) - 1, true, &block), 23);
+    UtAssert_UINT32_EQ(block.size, 23);
+    UtAssert_UINT32_EQ(block.offset, 0);
+
+    UtAssert_UINT32_EQ(v7_scan_block(&UT_V7_SCAN_BUNDLE[24], 10, false, &block), 10);
+    UtAssert_UINT32_EQ(block.block_type, bp_blocktype_bundleAge);
+    UtAssert_UINT32_EQ(block.content_offset, 6);
+    UtAssert_UINT32_EQ(block.content_size, 1);
+
+    /* not all there */
+    UtAssert_ZERO(v7_scan_block(&UT_V7_SCAN_BUNDLE[1], 22, true, &block));
+    UtAssert_ZERO(v7_scan_block(&UT_V7_SCAN_BUNDLE[24], 9, false, &block));
+    UtAssert_ZERO(v7_scan_block(&UT_V7_SCAN_BUNDLE[34], 8, false, &block));
+}
+
+void test_v7_scan_canonical_head(void)
+{
+    /* Test function for:
+     * size_t v7_scan_canonical_head(const void *buffer, size_t buf_sz, v7_scan_block_t *block)
+     */
+    static const uint8_t BAD_CRC_FIELDS[] = {0x85, 0x01, 0x01, 0x00, 0x01, 0x43};
+
+    v7_scan_block_t block;
+
+    /* the content and CRC do not need to be there */
+    UtAssert_UINT32_EQ(v7_scan_canonical_head(&UT_V7_SCAN_BUNDLE[24], 6, &block), 6);
+    UtAssert_UINT32_EQ(block.content_offset, 6);
+    UtAssert_UINT32_EQ(block.content_size, 1);
+    UtAssert_UINT32_EQ(block.crctype, bp_crctype_CRC16);
+    UtAssert_ZERO(block.size);
+
+    UtAssert_UINT32_EQ(v7_scan_canonical_head(&UT_V7_SCAN_BUNDLE[34], 6, &block), 6);
+    UtAssert_UINT32_EQ(block.block_type, bp_blocktype_payloadBlock);
+    UtAssert_UINT32_EQ(block.content_size, 3);
+
+    /* the head of the content is needed */
+    UtAssert_ZERO(v7_scan_canonical_head(&UT_V7_SCAN_BUNDLE[34], 5, &block));
+
+    /* a CRC type without a CRC field */
+    UtAssert_ZERO(v7_scan_canonical_head(BAD_CRC_FIELDS, sizeof(BAD_CRC_FIELDS), &block));
+}
+
+void TestV7BundleScan_Rgister(void)
+{
+    UtTest_Add(test_v7_scan_bundle, NULL, NULL, "Test v7_scan_bundle");
+    UtTest_Add(test_v7_scan_bundle_limits, NULL, NULL, "Test v7_scan_bundle limits");
+    UtTest_Add(test_v7_scan_verify_canonical_crcs, NULL, NULL, "Test v7_scan_verify_canonical_crcs");
+    UtTest_Add(test_v7_scan_block, NULL, NULL, "Test v7_scan_block");
+    UtTest_Add(test_v7_scan_canonical_head, NULL, NULL, "Test v7_scan_canonical_head");
+}
@@ -22,6 +22,46 @@
 
 #include "test_bplib_v7.h"
 
+static void UT_V7_AltHandler_PointerOnce(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    void **ptr = UserObj;
+
+    UT_Stub_SetReturnValue(FuncKey, *ptr);
+    *ptr = NULL;
+}
+
+static void UT_V7_AltHandler_CanonicalCast(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_mpool_block_t *cb = UT_Hook_GetArgValueByName(Context, "cb", bplib_mpool_block_t *);
+    void                *retval;
+
+    /* the end of a canonical block list is not a canonical block */
+    retval = UserObj;
+    if (cb == NULL || cb->type == bplib_mpool_blocktype_list_head)
+    {
+        retval = NULL;
+    }
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+static void UT_V7_AltHandler_StreamRead(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    size_t  *remain_sz = UserObj;
+    size_t   retval    = UT_Hook_GetArgValueByName(Context, "size", size_t);
+    uint8_t *data      = UT_Hook_GetArgValueByName(Context, "data", uint8_t *);
+
+    /* gives out the bytes that are left, as if that were the rest of the chunks */
+    if (retval > *remain_sz)
+    {
+        retval = *remain_sz;
+    }
+
+    memset(data, 0xAA, retval);
+    *remain_sz -= retval;
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
 void test_v7_compute_full_bundle_size(void)
 {
     /* Test function for:
@@ -74,10 +114,164 @@ void test_v7_copy_full_bundle_out(void)
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, NULL);
 }
 
+void test_v7_encode_full_bundle_out(void)
+{
+    /* Test function for:
+     * size_t v7_encode_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz)
+     */
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t ccb;
+    bplib_mpool_block_t            cblk;
+    uint8_t                        buffer[200];
+
+    memset(&cpb, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&cblk, 0, sizeof(bplib_mpool_block_t));
+    memset(buffer, 0, sizeof(buffer));
+
+    /* no canonical blocks yet */
+    cpb.cblock_list.type = bplib_mpool_blocktype_list_head;
+    cpb.cblock_list.next = &cpb.cblock_list;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_CanonicalCast, &ccb);
+
+    /* no room for the array around it */
+    UtAssert_ZERO(v7_encode_full_bundle_out(&cpb, buffer, 1));
+
+    /* an encoded primary block that does not fit */
+    cpb.block_encode_size_cache = 10;
+    UtAssert_ZERO(v7_encode_full_bundle_out(&cpb, buffer, 11));
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_export, 0);
+
+    /* an encoded primary block, which is copied out */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_V7_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_export), 10);
+    UtAssert_UINT32_EQ(v7_encode_full_bundle_out(&cpb, buffer, sizeof(buffer)), 12);
+    UtAssert_UINT32_EQ(buffer[0], 0x9F);
+    UtAssert_UINT32_EQ(buffer[11], 0xFF);
+
+    /* a primary block which is not encoded goes straight into the buffer, and stays that way */
+    cpb.block_encode_size_cache     = 0;
+    cpb.data.logical.version        = 7;
+    cpb.data.logical.destinationEID = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    cpb.data.logical.sourceEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    cpb.data.logical.reportEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    UtAssert_UINT32_GT(v7_encode_full_bundle_out(&cpb, buffer, sizeof(buffer)), 2);
+    UtAssert_UINT32_EQ(buffer[0], 0x9F);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_export, 1);
+    UtAssert_ZERO(cpb.block_encode_size_cache);
+    UtAssert_ZERO(v7_encode_full_bundle_out(&cpb, buffer, 4));
+
+    /* then one encoded canonical block, which does not fit or is copied */
+    cpb.cblock_list.next        = &cblk;
+    cblk.next                   = &cpb.cblock_list;
+    cpb.block_encode_size_cache = 10;
+    ccb.block_encode_size_cache = 10;
+    UtAssert_ZERO(v7_encode_full_bundle_out(&cpb, buffer, 20));
+    UtAssert_UINT32_EQ(v7_encode_full_bundle_out(&cpb, buffer, sizeof(buffer)), 22);
+
+    /* a canonical block that is not encoded and cannot be, such as the payload */
+    ccb.block_encode_size_cache                          = 0;
+    ccb.canonical_logical_data.canonical_block.blockType = bp_blocktype_payloadBlock;
+    UtAssert_ZERO(v7_encode_full_bundle_out(&cpb, buffer, sizeof(buffer)));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, NULL);
+}
+
+void test_v7_export_full_bundle_iov(void)
+{
+    /* Test function for:
+     * size_t v7_export_full_bundle_iov(bplib_mpool_bblock_primary_t *cpb, bplib_iovec_t *iov, size_t max_iov)
+     */
+    bplib_mpool_bblock_primary_t cpb;
+    bplib_iovec_t                iov[5];
+
+    memset(&cpb, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(iov, 0, sizeof(iov));
+
+    /* no entries at all only counts them */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, NULL);
+    UtAssert_UINT32_EQ(v7_export_full_bundle_iov(&cpb, iov, 0), 2);
+    UtAssert_NULL(iov[0].base);
+
+    /* only the array start and break */
+    UtAssert_UINT32_EQ(v7_export_full_bundle_iov(&cpb, iov, 5), 2);
+    UtAssert_UINT32_EQ(iov[0].len, 1);
+    UtAssert_UINT32_EQ(*(const uint8_t *)iov[0].base, 0x9F);
+    UtAssert_UINT32_EQ(iov[1].len, 1);
+    UtAssert_UINT32_EQ(*(const uint8_t *)iov[1].base, 0xFF);
+
+    /* the encoded chunks go in between */
+    memset(iov, 0, sizeof(iov));
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_export_iov), 3);
+    UtAssert_UINT32_EQ(v7_export_full_bundle_iov(&cpb, iov, 5), 5);
+    UtAssert_UINT32_EQ(*(const uint8_t *)iov[4].base, 0xFF);
+
+    /* not enough room for the break */
+    memset(iov, 0, sizeof(iov));
+    UtAssert_UINT32_EQ(v7_export_full_bundle_iov(&cpb, iov, 4), 5);
+    UtAssert_NULL(iov[4].base);
+}
+
+void test_v7_stream_export(void)
+{
+    /* Test function for:
+     * size_t v7_stream_export_begin(v7_stream_export_t *sxs, bplib_mpool_bblock_primary_t *cpb)
+     * size_t v7_stream_export_next(v7_stream_export_t *sxs, void *buffer, size_t buf_sz)
+     */
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t ccb;
+    bplib_mpool_block_t            cblk;
+    v7_stream_export_t             sxs;
+    uint8_t                        buffer[4];
+    size_t                         remain_sz;
+
+    memset(&cpb, 0, sizeof(bplib_mpool_bblock_primary_t));
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&cblk, 0, sizeof(bplib_mpool_block_t));
+    memset(buffer, 0, sizeof(buffer));
+
+    /* one canonical block after the primary */
+    cpb.cblock_list.type = bplib_mpool_blocktype_list_head;
+    cpb.cblock_list.next = &cblk;
+    cblk.next            = &cpb.cblock_list;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_CanonicalCast, &ccb);
+
+    /* the bundle could not be encoded */
+    cpb.block_encode_size_cache = 1;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_parent_pool_from_link), UT_V7_sizet_Handler, NULL);
+    UtAssert_ZERO(v7_stream_export_begin(&sxs, &cpb));
+    UtAssert_ZERO(v7_stream_export_next(&sxs, buffer, sizeof(buffer)));
+
+    /* 4 bytes of chunks, between the array start and break */
+    remain_sz                    = 4;
+    cpb.bundle_encode_size_cache = 6;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_stream_read), UT_V7_AltHandler_StreamRead, &remain_sz);
+    UtAssert_UINT32_EQ(v7_stream_export_begin(&sxs, &cpb), 6);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_read_list, 2);
+
+    UtAssert_ZERO(v7_stream_export_next(&sxs, buffer, 0));
+    UtAssert_UINT32_EQ(v7_stream_export_next(&sxs, buffer, 1), 1);
+    UtAssert_UINT32_EQ(buffer[0], 0x9F);
+    UtAssert_UINT32_EQ(v7_stream_export_next(&sxs, buffer, 3), 3);
+    UtAssert_UINT32_EQ(buffer[2], 0xAA);
+
+    /* the last byte, then nothing more in the canonical block, then the break */
+    UtAssert_UINT32_EQ(v7_stream_export_next(&sxs, buffer, sizeof(buffer)), 2);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_read_list, 3);
+    UtAssert_UINT32_EQ(buffer[0], 0xAA);
+    UtAssert_UINT32_EQ(buffer[1], 0xFF);
+    UtAssert_UINT32_EQ(sxs.total_out, 6);
+
+    UtAssert_ZERO(v7_stream_export_next(&sxs, buffer, sizeof(buffer)));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, NULL);
+}
+
 void test_v7_copy_full_bundle_in(void)
 {
     /* Test function for:
-     * size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz)
+     * size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz,
+     *                               uint32_t import_flags)
      */
     bplib_mpool_ref_t              flow_ref;
     size_t                         remain_sz;
@@ -90,27 +284,61 @@ void test_v7_copy_full_bundle_in(void)
     remain_sz = 0;
 
     pblk.cblock_list.type = bplib_mpool_blocktype_list_head;
-    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz), 0);
+    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz, 0), 0);
 
     remain_sz                    = 200;
     pblk.block_encode_size_cache = 0;
-    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz), 0);
+    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz, 0), 0);
 
     memset(&flow_ref, 0x9F, sizeof(bplib_mpool_ref_t));
     UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborNoError);
-    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz), 0);
+    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz, 0), 0);
 
     pblk.block_encode_size_cache = 1;
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_alloc), UT_V7_sizet_Handler, NULL);
-    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz), 0);
+    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz, 0), 0);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, &ccb);
 
-    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz), 0);
+    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz, 0), 0);
+
+    /* lazily, the canonical block is framed the same way, so this fails the same way */
+    UtAssert_INT32_EQ(v7_copy_full_bundle_in(&pblk, &flow_ref, remain_sz, V7_IMPORT_LAZY_DECODE), 0);
+    UtAssert_BOOL_FALSE(ccb.canonical_logical_data.data_pending);
 
     UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, NULL);
 }
 
+void test_v7_adopt_full_bundle_in(void)
+{
+    /* Test function for:
+     * size_t v7_adopt_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t buffer_ref, size_t buf_sz,
+     *                                uint32_t import_flags)
+     */
+    bplib_mpool_bblock_primary_t pblk;
+    uint8_t                      buffer[8];
+
+    memset(&pblk, 0, sizeof(pblk));
+    memset(buffer, 0x9F, sizeof(buffer));
+    pblk.cblock_list.type = bplib_mpool_blocktype_list_head;
+
+    /* not a CBOR data block */
+    UtAssert_ZERO(v7_adopt_full_bundle_in(&pblk, NULL, sizeof(buffer), 0));
+
+    /* larger than the data in the block */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_V7_AltHandler_PointerReturn, buffer);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_get_user_content_size), UT_V7_uint64_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_get_user_content_size), sizeof(buffer) - 1);
+    UtAssert_ZERO(v7_adopt_full_bundle_in(&pblk, NULL, sizeof(buffer), 0));
+    UtAssert_STUB_COUNT(cbor_parser_init, 0);
+
+    /* within the data, this is decoded the same as v7_copy_full_bundle_in() */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_get_user_content_size), sizeof(buffer));
+    UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborUnknownError);
+    UtAssert_ZERO(v7_adopt_full_bundle_in(&pblk, NULL, sizeof(buffer), 0));
+    UtAssert_STUB_COUNT(cbor_parser_init, 1);
+}
+
 void test_v7_sum_preencoded_size(void)
 {
     /* Test function for:
@@ -131,10 +359,49 @@ void test_v7_sum_preencoded_size(void)
     UtAssert_INT32_EQ(v7_sum_preencoded_size(&list), 0);
 }
 
+void test_v7_verify_deferred_crcs(void)
+{
+    /* Test function for:
+     * bool v7_verify_deferred_crcs(bplib_mpool_bblock_primary_t *cpb)
+     */
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t ccb;
+    void                          *next_ccb;
+
+    memset(&cpb, 0, sizeof(cpb));
+    memset(&ccb, 0, sizeof(ccb));
+    cpb.cblock_list.next = &cpb.cblock_list;
+
+    /* nothing was deferred */
+    UtAssert_BOOL_TRUE(v7_verify_deferred_crcs(&cpb));
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_cast, 0);
+
+    /* a block without a CRC is passed over, and the flag is cleared */
+    cpb.data.delivery.crc_deferred = true;
+    next_ccb                       = &ccb;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerOnce, &next_ccb);
+    UtAssert_BOOL_TRUE(v7_verify_deferred_crcs(&cpb));
+    UtAssert_BOOL_FALSE(cpb.data.delivery.crc_deferred);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_cast, 2);
+
+    /* a block with a CRC that does not check out */
+    cpb.data.delivery.crc_deferred                     = true;
+    ccb.canonical_logical_data.canonical_block.crctype = bp_crctype_CRC16;
+    next_ccb                                           = &ccb;
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 16);
+    UtAssert_BOOL_FALSE(v7_verify_deferred_crcs(&cpb));
+    UtAssert_BOOL_TRUE(cpb.data.delivery.crc_deferred);
+}
+
 void TestV7CodecCommon_Rgister(void)
 {
     UtTest_Add(test_v7_compute_full_bundle_size, NULL, NULL, "Test V7 compute_full_bundle_size");
     UtTest_Add(test_v7_copy_full_bundle_out, NULL, NULL, "Test V7 copy_full_bundle_out");
+    UtTest_Add(test_v7_encode_full_bundle_out, NULL, NULL, "Test V7 encode_full_bundle_out");
+    UtTest_Add(test_v7_export_full_bundle_iov, NULL, NULL, "Test V7 export_full_bundle_iov");
+    UtTest_Add(test_v7_stream_export, NULL, NULL, "Test v7_stream_export");
     UtTest_Add(test_v7_copy_full_bundle_in, NULL, NULL, "Test V7 copy_full_bundle_in");
+    UtTest_Add(test_v7_adopt_full_bundle_in, NULL, NULL, "Test V7 adopt_full_bundle_in");
     UtTest_Add(test_v7_sum_preencoded_size, NULL, NULL, "Test v7_sum_preencoded_size");
+    UtTest_Add(test_v7_verify_deferred_crcs, NULL, NULL, "Test v7_verify_deferred_crcs");
 }
@@ -35,6 +35,62 @@ void test_v7_encode_bp_custody_acceptance_seqlist_impl(void)
     enc.error       = false;
     arg.num_entries = 1;
     UtAssert_VOIDCALL(v7_encode_bp_custody_acceptance_seqlist_impl(&enc, &arg));
+
+    /* a single sequence number and a run are written differently */
+    arg.num_entries     = 2;
+    arg.ranges[0].count = 1;
+    arg.ranges[1].count = 5;
+    UtAssert_VOIDCALL(v7_encode_bp_custody_acceptance_seqlist_impl(&enc, &arg));
+}
+
+void test_v7_encode_bp_custody_acceptance_range_impl(void)
+{
+    /* Test function for:
+     * void v7_encode_bp_custody_acceptance_range_impl(v7_encode_state_t *enc, const void *arg)
+     */
+    v7_encode_state_t      enc;
+    bp_custody_seq_range_t arg;
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(&arg, 0, sizeof(bp_custody_seq_range_t));
+
+    arg.first_seq = 100;
+    arg.count     = 20;
+    UtAssert_VOIDCALL(v7_encode_bp_custody_acceptance_range_impl(&enc, &arg));
+}
+
+void test_v7_decode_bp_custody_acceptance_range_impl(void)
+{
+    /* Test function for:
+     * void v7_decode_bp_custody_acceptance_range_impl(v7_decode_state_t *dec, void *arg)
+     */
+    v7_decode_state_t      dec;
+    bp_custody_seq_range_t arg;
+    CborValue              cval;
+
+    memset(&dec, 0, sizeof(v7_decode_state_t));
+    memset(&arg, 0, sizeof(bp_custody_seq_range_t));
+    memset(&cval, 0, sizeof(CborValue));
+
+    dec.cbor       = &cval;
+    cval.type      = CborIntegerType;
+    cval.remaining = 10;
+    cval.extra     = 5;
+    UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_range_impl(&dec, &arg));
+    UtAssert_BOOL_FALSE(dec.error);
+    UtAssert_UINT32_EQ(arg.first_seq, 5);
+    UtAssert_UINT32_EQ(arg.count, 5);
+
+    /* an empty run is not valid */
+    cval.extra = 0;
+    UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_range_impl(&dec, &arg));
+    UtAssert_BOOL_TRUE(dec.error);
+
+    /* nor is one longer than the limit */
+    dec.error  = false;
+    cval.extra = BP_DACS_MAX_SEQ_PER_RANGE + 1;
+    UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_range_impl(&dec, &arg));
+    UtAssert_BOOL_TRUE(dec.error);
 }
 
 void test_v7_decode_bp_custody_acceptance_seqlist_impl(void)
@@ -57,6 +113,24 @@ void test_v7_decode_bp_custody_acceptance_seqlist_impl(void)
     UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_seqlist_impl(&dec, &arg));
     dec.error = false;
     UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_seqlist_impl(&dec, &arg));
+
+    /* plain integers are each a run of one */
+    memset(&arg, 0, sizeof(bp_custody_accept_payload_block_t));
+    cval.type  = CborIntegerType;
+    cval.extra = 7;
+    dec.error  = false;
+    UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_seqlist_impl(&dec, &arg));
+    UtAssert_UINT32_EQ(arg.num_entries, BP_DACS_MAX_SEQ_PER_PAYLOAD);
+    UtAssert_UINT32_EQ(arg.ranges[0].first_seq, 7);
+    UtAssert_UINT32_EQ(arg.ranges[0].count, 1);
+
+    /* an array is a run, which is not counted if it does not decode */
+    memset(&arg, 0, sizeof(bp_custody_accept_payload_block_t));
+    cval.type = CborArrayType;
+    UT_SetDefaultReturnValue(UT_KEY(cbor_value_enter_container), CborUnknownError);
+    UtAssert_VOIDCALL(v7_decode_bp_custody_acceptance_seqlist_impl(&dec, &arg));
+    UtAssert_BOOL_TRUE(dec.error);
+    UtAssert_UINT32_EQ(arg.num_entries, 0);
 }
 
 void test_v7_decode_bp_custody_acknowledement_record_impl(void)
@@ -97,8 +171,12 @@ void TestV7CustodyAcknowledgementRecord_Rgister(void)
 {
     UtTest_Add(test_v7_encode_bp_custody_acceptance_seqlist_impl, NULL, NULL,
                "Test v7_encode_bp_custody_acceptance_seqlist_impl");
+    UtTest_Add(test_v7_encode_bp_custody_acceptance_range_impl, NULL, NULL,
+               "Test v7_encode_bp_custody_acceptance_range_impl");
     UtTest_Add(test_v7_decode_bp_custody_acceptance_seqlist_impl, NULL, NULL,
                "Test v7_decode_bp_custody_acceptance_seqlist_impl");
+    UtTest_Add(test_v7_decode_bp_custody_acceptance_range_impl, NULL, NULL,
+               "Test v7_decode_bp_custody_acceptance_range_impl");
     UtTest_Add(test_v7_decode_bp_custody_acknowledement_record_impl, NULL, NULL,
                "Test v7_decode_bp_custody_acknowledement_record_impl");
     UtTest_Add(test_v7_decode_bp_custody_acknowledement_record, NULL, NULL,
@@ -40,6 +40,32 @@ void test_v7_block_decode_pri(void)
     UtAssert_INT32_NEQ(v7_block_decode_pri(&cpb, &data, data_size), 0);
 }
 
+void test_v7_block_decode_pri_ext(void)
+{
+    /* Test function for:
+     * int v7_block_decode_pri_ext(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr, size_t data_size,
+     * bplib_mpool_ref_t source_ref)
+     */
+    static const uint8_t PROFILE_BLOCK[] = {0x88, 0x07, 0x00, 0x00, 0x82, 0x02, 0x82, 0x02, 0x01, 0x82, 0x02,
+                                            0x82, 0x01, 0x01, 0x82, 0x02, 0x82, 0x00, 0x00, 0x82, 0x00, 0x00,
+                                            0x00};
+    bplib_mpool_bblock_primary_t cpb;
+
+    memset(&cpb, 0, sizeof(bplib_mpool_bblock_primary_t));
+
+    /* a block in the common profile does not go through tinycbor at all */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_stream_write), sizeof(PROFILE_BLOCK));
+    UtAssert_INT32_EQ(v7_block_decode_pri_ext(&cpb, PROFILE_BLOCK, sizeof(PROFILE_BLOCK), NULL), 0);
+    UtAssert_UINT32_EQ(cpb.block_encode_size_cache, sizeof(PROFILE_BLOCK));
+    UtAssert_UINT32_EQ(cpb.data.logical.destinationEID.ssp.ipn.node_number, 2);
+    UtAssert_STUB_COUNT(cbor_parser_init, 0);
+
+    /* anything else does */
+    UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborUnknownError);
+    UtAssert_INT32_NEQ(v7_block_decode_pri_ext(&cpb, PROFILE_BLOCK, sizeof(PROFILE_BLOCK) - 1, NULL), 0);
+    UtAssert_STUB_COUNT(cbor_parser_init, 1);
+}
+
 void test_v7_block_decode_canonical(void)
 {
     /* Test function for:
@@ -60,6 +86,161 @@ void test_v7_block_decode_canonical(void)
     UtAssert_INT32_NEQ(v7_block_decode_canonical(&ccb, data, data_size, payload_block_hint), 0);
 }
 
+void test_v7_block_frame_canonical_ext(void)
+{
+    /* Test function for:
+     * int v7_block_frame_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+     * bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref)
+     */
+    bplib_mpool_bblock_canonical_t ccb;
+    uint8_t                        data[100] = {0};
+
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    ccb.canonical_logical_data.data_pending = true;
+
+    /* the framing is decoded the same way, and nothing is left pending if it does not decode */
+    UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborNoError);
+    UtAssert_INT32_NEQ(v7_block_frame_canonical_ext(&ccb, data, sizeof(data), bp_blocktype_undefined, NULL), 0);
+    UtAssert_BOOL_FALSE(ccb.canonical_logical_data.data_pending);
+
+    UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborUnknownError);
+    UtAssert_INT32_NEQ(v7_block_frame_canonical_ext(&ccb, data, sizeof(data), bp_blocktype_undefined, NULL), 0);
+    UtAssert_BOOL_FALSE(ccb.canonical_logical_data.data_pending);
+}
+
+void test_v7_block_decode_canonical_scanned(void)
+{
+    /* Test function for:
+     * int v7_block_decode_canonical_scanned(bplib_mpool_bblock_canonical_t *ccb, const uint8_t *block_base,
+     * const v7_scan_block_t *scanned, bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref,
+     * bool defer_content)
+     */
+    bplib_mpool_bblock_canonical_t ccb;
+    v7_scan_block_t                scanned;
+    uint8_t                        data[16] = {0};
+
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&scanned, 0, sizeof(scanned));
+
+    scanned.size           = 9;
+    scanned.content_offset = 6;
+    scanned.content_size   = 3;
+    scanned.block_type     = bp_blocktype_payloadBlock;
+    scanned.block_num      = 1;
+
+    /* block could not be saved */
+    UtAssert_INT32_EQ(
+        v7_block_decode_canonical_scanned(&ccb, data, &scanned, bp_blocktype_undefined, NULL, false), -1);
+
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_stream_write), scanned.size);
+    UtAssert_INT32_EQ(
+        v7_block_decode_canonical_scanned(&ccb, data, &scanned, bp_blocktype_undefined, NULL, false), 0);
+    UtAssert_UINT32_EQ(ccb.block_encode_size_cache, scanned.size);
+    UtAssert_UINT32_EQ(ccb.canonical_logical_data.canonical_block.blockType, bp_blocktype_payloadBlock);
+    UtAssert_UINT32_EQ(ccb.canonical_logical_data.canonical_block.blockNum, 1);
+
+    /* the hint applies to the payload */
+    UtAssert_INT32_EQ(
+        v7_block_decode_canonical_scanned(&ccb, data, &scanned, bp_blocktype_ciphertextPayloadBlock, NULL, false), 0);
+    UtAssert_UINT32_EQ(ccb.canonical_logical_data.canonical_block.blockType, bp_blocktype_ciphertextPayloadBlock);
+    UtAssert_BOOL_FALSE(ccb.canonical_logical_data.data_pending);
+
+    /* extension block content can be left for later */
+    scanned.block_type = bp_blocktype_bundleAge;
+    UtAssert_INT32_EQ(v7_block_decode_canonical_scanned(&ccb, data, &scanned, bp_blocktype_undefined, NULL, true), 0);
+    UtAssert_UINT32_EQ(ccb.canonical_logical_data.canonical_block.blockType, bp_blocktype_bundleAge);
+    UtAssert_BOOL_TRUE(ccb.canonical_logical_data.data_pending);
+}
+
+static void UT_V7_AltHandler_ContentView(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    bplib_iovec_t *iov       = UT_Hook_GetArgValueByName(Context, "iov", bplib_iovec_t *);
+    size_t         max_count = UT_Hook_GetArgValueByName(Context, "max_count", size_t);
+    size_t         retval    = 1;
+
+    iov->base = UserObj;
+    iov->len  = max_count;
+
+    UT_Stub_SetReturnValue(FuncKey, retval);
+}
+
+void test_v7_block_decode_canonical_data(void)
+{
+    /* Test function for:
+     * int v7_block_decode_canonical_data(bplib_mpool_bblock_canonical_t *ccb)
+     */
+    bplib_mpool_bblock_canonical_t ccb;
+    uint8_t                        content[8] = {0};
+
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+
+    /* nothing to do if already decoded */
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(&ccb), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_export_iov_range, 0);
+
+    /* no content to decode */
+    ccb.canonical_logical_data.data_pending              = true;
+    ccb.canonical_logical_data.canonical_block.blockType = bp_blocktype_metadataExtensionBlock;
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(&ccb), -1);
+    UtAssert_BOOL_TRUE(ccb.canonical_logical_data.data_pending);
+
+    /* content cannot be found in the chunks */
+    ccb.encoded_content_offset = 4;
+    ccb.encoded_content_length = sizeof(content);
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(&ccb), -1);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_export, 1);
+    UtAssert_BOOL_TRUE(ccb.canonical_logical_data.data_pending);
+
+    /* split across chunks, so it gets copied first */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_export), sizeof(content));
+    UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborNoError);
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(&ccb), 0);
+    UtAssert_BOOL_FALSE(ccb.canonical_logical_data.data_pending);
+    UtAssert_STUB_COUNT(cbor_parser_init, 1);
+
+    /* in one piece, decoded where it is */
+    ccb.canonical_logical_data.data_pending = true;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export_iov_range), UT_V7_AltHandler_ContentView, content);
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(&ccb), 0);
+    UtAssert_BOOL_FALSE(ccb.canonical_logical_data.data_pending);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_export, 2);
+    UtAssert_STUB_COUNT(cbor_parser_init, 2);
+
+    /* content which does not decode stays pending */
+    ccb.canonical_logical_data.data_pending = true;
+    UT_SetDefaultReturnValue(UT_KEY(cbor_parser_init), CborUnknownError);
+    UtAssert_INT32_EQ(v7_block_decode_canonical_data(&ccb), -1);
+    UtAssert_BOOL_TRUE(ccb.canonical_logical_data.data_pending);
+}
+
+void test_v7_verify_block_crc_chunks(void)
+{
+    /* Test function for:
+     * bool v7_verify_block_crc_chunks(bplib_mpool_block_t *head, size_t block_size, bp_crctype_t crc_type,
+     * bp_crcval_t crc_check)
+     */
+    bplib_mpool_block_t head;
+
+    memset(&head, 0, sizeof(head));
+
+    /* the block is no bigger than the CRC */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 16);
+    UtAssert_BOOL_FALSE(v7_verify_block_crc_chunks(&head, 2, bp_crctype_CRC16, 0));
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_crc_update, 0);
+
+    /* the chunks run out before the block does */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_bblock_cbor_crc_update), 4);
+    UtAssert_BOOL_FALSE(v7_verify_block_crc_chunks(&head, 8, bp_crctype_CRC16, 0));
+    UtAssert_STUB_COUNT(bplib_crc_update, 0);
+
+    /* the chunks over everything but the CRC, then the zero bytes */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 0x1234);
+    UtAssert_BOOL_TRUE(v7_verify_block_crc_chunks(&head, 6, bp_crctype_CRC16, 0x1234));
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_crc_update, 2);
+    UtAssert_STUB_COUNT(bplib_crc_update, 1);
+    UtAssert_BOOL_FALSE(v7_verify_block_crc_chunks(&head, 6, bp_crctype_CRC16, 0x4321));
+}
+
 void test_v7_save_and_verify_block(void)
 {
     /* Test function for:
@@ -84,9 +265,53 @@ void test_v7_save_and_verify_block(void)
     UtAssert_INT32_NEQ(v7_save_and_verify_block(&head, &block_base, block_size, crc_type, crc_check), 0);
 }
 
+void test_v7_slice_and_verify_block(void)
+{
+    /* Test function for:
+     * size_t v7_slice_and_verify_block(bplib_mpool_block_t *head, bplib_mpool_ref_t source_ref,
+     * const uint8_t *block_base, size_t block_size, bp_crctype_t crc_type, bp_crcval_t crc_check)
+     */
+    bplib_mpool_block_t head;
+    bplib_mpool_block_t sblk;
+    uint8_t             source[8];
+
+    memset(&head, 0, sizeof(head));
+    memset(&sblk, 0, sizeof(sblk));
+    memset(source, 0, sizeof(source));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_crc_get_width), UT_V7_int8_Handler, NULL);
+
+    /* source is not CBOR data */
+    UtAssert_ZERO(v7_slice_and_verify_block(&head, NULL, &source[2], 4, 0, 0));
+
+    /* block is not within the source */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_V7_AltHandler_PointerReturn, &source[2]);
+    UtAssert_ZERO(v7_slice_and_verify_block(&head, NULL, &source[0], 4, 0, 0));
+
+    /* CRC does not match */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_cast), UT_V7_AltHandler_PointerReturn, &source[0]);
+    UtAssert_ZERO(v7_slice_and_verify_block(&head, NULL, &source[2], 4, 0, 1));
+
+    /* no memory for the slice */
+    UtAssert_ZERO(v7_slice_and_verify_block(&head, NULL, &source[2], 4, 0, 0));
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_append, 0);
+
+    /* nominal, the slice is attached and nothing is copied */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_slice_alloc), UT_V7_AltHandler_PointerReturn, &sblk);
+    UtAssert_UINT32_EQ(v7_slice_and_verify_block(&head, NULL, &source[2], 4, 0, 0), 4);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_append, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_write, 0);
+}
+
 void TestV7DecodecApi_Rgister(void)
 {
     UtTest_Add(test_v7_block_decode_pri, NULL, NULL, "Test v7 block_decode_pri");
+    UtTest_Add(test_v7_block_decode_pri_ext, NULL, NULL, "Test v7_block_decode_pri_ext");
     UtTest_Add(test_v7_block_decode_canonical, NULL, NULL, "Test v7_block_decode_canonical");
+    UtTest_Add(test_v7_block_frame_canonical_ext, NULL, NULL, "Test v7_block_frame_canonical_ext");
+    UtTest_Add(test_v7_block_decode_canonical_scanned, NULL, NULL, "Test v7_block_decode_canonical_scanned");
+    UtTest_Add(test_v7_block_decode_canonical_data, NULL, NULL, "Test v7_block_decode_canonical_data");
+    UtTest_Add(test_v7_verify_block_crc_chunks, NULL, NULL, "Test v7_verify_block_crc_chunks");
     UtTest_Add(test_v7_save_and_verify_block, NULL, NULL, "Test v7_save_and_verify_block");
+    UtTest_Add(test_v7_slice_and_verify_block, NULL, NULL, "Test v7_slice_and_verify_block");
 }
@@ -42,6 +42,145 @@ void test_v7_block_encode_pri(void)
     cpb.data.logical.sourceEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
     cpb.data.logical.reportEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
     UtAssert_UINT8_NEQ(v7_block_encode_pri(&cpb), 0);
+
+    /* with no flags set that fits the profile encoder, so it is all written at once without tinycbor */
+    memset(&cpb.data.logical.controlFlags, 0, sizeof(cpb.data.logical.controlFlags));
+    UT_ResetState(UT_KEY(cbor_encode_uint));
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_stream_write), V7_PRI_PROFILE_MAX_SIZE);
+    UtAssert_INT32_EQ(v7_block_encode_pri(&cpb), 0);
+    UtAssert_STUB_COUNT(cbor_encode_uint, 0);
+}
+
+void test_v7_block_encode_pri_flat(void)
+{
+    /* Test function for:
+     * size_t v7_block_encode_pri_flat(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz)
+     */
+    bplib_mpool_bblock_primary_t cpb;
+    uint8_t                      buffer[V7_PRI_PROFILE_MAX_SIZE];
+    size_t                       size;
+
+    memset(&cpb, 0, sizeof(cpb));
+    cpb.data.logical.version        = 7;
+    cpb.data.logical.crctype        = bp_crctype_none;
+    cpb.data.logical.destinationEID = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    cpb.data.logical.sourceEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    cpb.data.logical.reportEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+
+    /* the profile encoder puts it all in the buffer, and nothing goes to the pool */
+    UtAssert_NONZERO(size = v7_block_encode_pri_flat(&cpb, buffer, sizeof(buffer)));
+    UtAssert_STUB_COUNT(bplib_mpool_stream_write, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_append, 0);
+
+    /* too small for it */
+    UtAssert_ZERO(v7_block_encode_pri_flat(&cpb, buffer, size - 1));
+
+    /* one that does not fit the profile goes through tinycbor, which fails here */
+    cpb.data.logical.controlFlags.isFragment = true;
+    UT_SetDefaultReturnValue(UT_KEY(cbor_encoder_create_array), CborErrorOutOfMemory);
+    UtAssert_ZERO(v7_block_encode_pri_flat(&cpb, buffer, sizeof(buffer)));
+}
+
+static v7_encode_state_t *UT_V7_encode_state;
+
+static void UT_V7_AltHandler_CaptureWriterArg(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    UT_V7_encode_state = UT_Hook_GetArgValueByName(Context, "arg", void *);
+}
+
+/* each encoded item writes the given number of bytes through the writer, as if the real encoder had */
+static void UT_V7_AltHandler_WriteItem(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    static const uint8_t ITEM_BYTES[4] = {0};
+    CborError            status;
+
+    status = v7_encoder_write_wrapper(UT_V7_encode_state, ITEM_BYTES, *((size_t *)UserObj), CborEncoderAppendCborData);
+    UT_Stub_SetReturnValue(FuncKey, status);
+}
+
+void test_v7_block_encode_pri_template(void)
+{
+    /* Test function for:
+     * int v7_block_encode_pri_template(bp_pri_template_t *tmpl, const bp_primary_block_t *pri)
+     */
+    bp_pri_template_t  tmpl;
+    bp_primary_block_t pri;
+    size_t             item_size;
+
+    memset(&pri, 0, sizeof(pri));
+    item_size = 1;
+
+    /* not v7 */
+    UtAssert_INT32_NEQ(v7_block_encode_pri_template(&tmpl, &pri), 0);
+    UtAssert_UINT32_EQ(tmpl.prefix_size, 0);
+
+    /* nothing was written, so it cannot tell where the timestamp was */
+    pri.version        = 7;
+    pri.crctype        = bp_crctype_none;
+    pri.destinationEID = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    pri.sourceEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    pri.reportEID      = (bp_endpointid_buffer_t) {.scheme = bp_endpointid_scheme_ipn};
+    UtAssert_INT32_NEQ(v7_block_encode_pri_template(&tmpl, &pri), 0);
+    UtAssert_UINT32_EQ(tmpl.prefix_size, 0);
+
+    /* with the items written, it is split around the timestamp, which is an array and two numbers */
+    UT_SetHandlerFunction(UT_KEY(cbor_encoder_init_writer), UT_V7_AltHandler_CaptureWriterArg, NULL);
+    UT_SetHandlerFunction(UT_KEY(cbor_encode_uint), UT_V7_AltHandler_WriteItem, &item_size);
+    UT_SetHandlerFunction(UT_KEY(cbor_encoder_create_array), UT_V7_AltHandler_WriteItem, &item_size);
+    UtAssert_INT32_EQ(v7_block_encode_pri_template(&tmpl, &pri), 0);
+    UtAssert_UINT32_EQ(tmpl.prefix_size, 14);
+    UtAssert_UINT32_EQ(tmpl.suffix_size, 1);
+
+    /* the CRC is left out of the template */
+    pri.crctype = bp_crctype_CRC16;
+    UT_SetHandlerFunction(UT_KEY(cbor_encode_byte_string), UT_V7_AltHandler_WriteItem, &item_size);
+    UtAssert_INT32_EQ(v7_block_encode_pri_template(&tmpl, &pri), 0);
+    UtAssert_UINT32_EQ(tmpl.suffix_size, 1);
+
+    /* too big for a template, or even for the space to put it together */
+    pri.crctype = bp_crctype_none;
+    item_size   = 3;
+    UtAssert_INT32_NEQ(v7_block_encode_pri_template(&tmpl, &pri), 0);
+    UtAssert_UINT32_EQ(tmpl.prefix_size, 0);
+    item_size = 4;
+    UtAssert_INT32_NEQ(v7_block_encode_pri_template(&tmpl, &pri), 0);
+    UtAssert_UINT32_EQ(tmpl.prefix_size, 0);
+}
+
+void test_v7_block_encode_pri_from_template(void)
+{
+    /* Test function for:
+     * int v7_block_encode_pri_from_template(bplib_mpool_bblock_primary_t *cpb, const bp_pri_template_t *tmpl)
+     */
+    bplib_mpool_bblock_primary_t cpb;
+    bp_pri_template_t            tmpl;
+
+    memset(&cpb, 0, sizeof(cpb));
+    memset(&tmpl, 0, sizeof(tmpl));
+
+    /* no template, so it is encoded in full, which fails as it is not v7 */
+    UtAssert_INT32_NEQ(v7_block_encode_pri_from_template(&cpb, &tmpl), 0);
+
+    /* the prefix cannot be written */
+    tmpl.prefix_size         = 10;
+    tmpl.suffix_size         = 2;
+    cpb.data.logical.crctype = bp_crctype_CRC16;
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_stream_write), UT_V7_uint64_Handler, NULL);
+    UtAssert_INT32_NEQ(v7_block_encode_pri_from_template(&cpb, &tmpl), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_write, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_attach, 0);
+
+    /* nominal, the prefix, the timestamp, then the suffix */
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_stream_write), 100);
+    UtAssert_INT32_EQ(v7_block_encode_pri_from_template(&cpb, &tmpl), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_write, 3);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_attach, 1);
+    UtAssert_STUB_COUNT(cbor_encode_byte_string, 1);
+
+    /* the timestamp fails */
+    UT_SetDefaultReturnValue(UT_KEY(cbor_encoder_create_array), CborErrorIO);
+    UtAssert_INT32_NEQ(v7_block_encode_pri_from_template(&cpb, &tmpl), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_attach, 1);
 }
 
 void test_v7_block_encode_pay(void)
@@ -58,6 +197,57 @@ void test_v7_block_encode_pay(void)
     UtAssert_INT32_NEQ(v7_block_encode_pay(&ccb, data_ptr, data_size), 0);
 }
 
+/* the payload content is written through the writer as is, so the encoder can tell it apart */
+static void UT_V7_AltHandler_WriteString(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    const uint8_t *string = UT_Hook_GetArgValueByName(Context, "string", const uint8_t *);
+    size_t         length = UT_Hook_GetArgValueByName(Context, "length", size_t);
+    CborError      status;
+
+    status = v7_encoder_write_wrapper(UT_V7_encode_state, string, length, CborEncoderAppendStringData);
+    UT_Stub_SetReturnValue(FuncKey, status);
+}
+
+void test_v7_block_encode_pay_extern(void)
+{
+    /* Test function for:
+     * int v7_block_encode_pay_extern(bplib_mpool_bblock_canonical_t *ccb, bplib_mpool_ref_t content_ref,
+     *                                const void *data_ptr, size_t data_size)
+     */
+    bplib_mpool_bblock_canonical_t ccb;
+    bplib_mpool_block_t            sblk;
+    uint8_t                        content[4];
+    size_t                         item_size;
+
+    memset(&ccb, 0, sizeof(ccb));
+    memset(&sblk, 0, sizeof(sblk));
+    item_size = 1;
+
+    /* fails as nothing was written */
+    UtAssert_INT32_NEQ(v7_block_encode_pay_extern(&ccb, NULL, content, sizeof(content)), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 2);
+
+    /* the content cannot be sliced */
+    ccb.canonical_logical_data.canonical_block.blockType = bp_blocktype_payloadBlock;
+    ccb.canonical_logical_data.canonical_block.crctype   = bp_crctype_none;
+    UT_SetHandlerFunction(UT_KEY(cbor_encoder_init_writer), UT_V7_AltHandler_CaptureWriterArg, NULL);
+    UT_SetHandlerFunction(UT_KEY(cbor_encode_uint), UT_V7_AltHandler_WriteItem, &item_size);
+    UT_SetHandlerFunction(UT_KEY(cbor_encoder_create_array), UT_V7_AltHandler_WriteItem, &item_size);
+    UT_SetHandlerFunction(UT_KEY(cbor_encode_byte_string), UT_V7_AltHandler_WriteString, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_mpool_stream_write), 1);
+    UtAssert_INT32_NEQ(v7_block_encode_pay_extern(&ccb, NULL, content, sizeof(content)), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_slice_alloc, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 4);
+
+    /* nominal, the items go to the stream and the content is a slice, it is never written */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_slice_alloc), UT_V7_AltHandler_PointerReturn, &sblk);
+    UtAssert_INT32_EQ(v7_block_encode_pay_extern(&ccb, NULL, content, sizeof(content)), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_slice_alloc, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_append, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_attach, 3);
+    UtAssert_UINT32_EQ(ccb.encoded_content_length, sizeof(content));
+}
+
 void test_v7_block_encode_canonical(void)
 {
     /* Test function for:
@@ -98,6 +288,121 @@ void test_v7_block_encode_canonical(void)
     UtAssert_INT32_NEQ(v7_block_encode_canonical(&ccb), 0);
 }
 
+void test_v7_block_encode_canonical_flat(void)
+{
+    /* Test function for:
+     * size_t v7_block_encode_canonical_flat(bplib_mpool_bblock_canonical_t *ccb, void *buffer, size_t buf_sz)
+     */
+    bplib_mpool_bblock_canonical_t ccb;
+    uint8_t                        buffer[64];
+
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+
+    /* the payload is only kept encoded, so it cannot be done this way */
+    ccb.canonical_logical_data.canonical_block.blockType = bp_blocktype_payloadBlock;
+    UtAssert_ZERO(v7_block_encode_canonical_flat(&ccb, buffer, sizeof(buffer)));
+
+    /* an extension block with no content */
+    ccb.canonical_logical_data.canonical_block.blockType = bp_blocktype_metadataExtensionBlock;
+    UtAssert_ZERO(v7_block_encode_canonical_flat(&ccb, buffer, sizeof(buffer)));
+
+    /* one with content, where the outer block fails, and nothing goes to the pool either way */
+    ccb.canonical_logical_data.canonical_block.blockType     = bp_blocktype_hopCount;
+    ccb.canonical_logical_data.data.hop_count_block.hopLimit = 10;
+    UT_SetDefaultReturnValue(UT_KEY(cbor_encoder_close_container), CborNoError);
+    UtAssert_ZERO(v7_block_encode_canonical_flat(&ccb, buffer, sizeof(buffer)));
+    UtAssert_ZERO(v7_block_encode_canonical_flat(&ccb, buffer, 1));
+    UtAssert_STUB_COUNT(bplib_mpool_stream_write, 0);
+    UtAssert_STUB_COUNT(bplib_mpool_start_stream_init, 0);
+}
+
+/* supplies the encoded block from the capture buffer */
+static void UT_V7_CborExport_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    test_bplib_v7_capture_t *cap     = UserObj;
+    void                    *out_ptr = UT_Hook_GetArgValueByName(Context, "out_ptr", void *);
+
+    memcpy(out_ptr, cap->data, cap->used);
+    UT_Stub_SetReturnValue(FuncKey, cap->used);
+}
+
+/* puts what is written over the block into the capture buffer */
+static void UT_V7_CborOverwrite_Handler(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    test_bplib_v7_capture_t *cap    = UserObj;
+    const void              *in_ptr = UT_Hook_GetArgValueByName(Context, "in_ptr", const void *);
+    size_t                   count  = UT_Hook_GetArgValueByName(Context, "count", size_t);
+
+    memcpy(cap->data, in_ptr, count);
+    UT_Stub_SetReturnValue(FuncKey, count);
+}
+
+void test_v7_block_update_canonical(void)
+{
+    /* Test function for:
+     * int v7_block_update_canonical(bplib_mpool_bblock_canonical_t *ccb)
+     */
+    /* a hop count block with CRC16: type 10, number 2, no flags, [30, 3] at a fixed width */
+    static const uint8_t           ENCODED[] = {0x86, 0x0a, 0x02, 0x00, 0x01, 0x45, 0x82,
+                                                0x18, 0x1e, 0x18, 0x03, 0x42, 0xaa, 0xbb};
+    bplib_mpool_bblock_canonical_t ccb;
+    test_bplib_v7_capture_t        export_cap;
+    test_bplib_v7_capture_t        overwrite_cap;
+
+    memset(&ccb, 0, sizeof(bplib_mpool_bblock_canonical_t));
+    memset(&export_cap, 0, sizeof(export_cap));
+    memset(&overwrite_cap, 0, sizeof(overwrite_cap));
+
+    memcpy(export_cap.data, ENCODED, sizeof(ENCODED));
+    export_cap.used = sizeof(ENCODED);
+
+    ccb.canonical_logical_data.canonical_block.blockType     = bp_blocktype_hopCount;
+    ccb.canonical_logical_data.canonical_block.crctype       = bp_crctype_CRC16;
+    ccb.canonical_logical_data.data.hop_count_block.hopLimit = 30;
+    ccb.canonical_logical_data.data.hop_count_block.hopCount = 4;
+
+    UT_SetHandlerFunction(UT_KEY(bplib_crc_get_width), UT_V7_uint8_Handler, NULL);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 16);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_finalize), 0x1234);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_export), UT_V7_CborExport_Handler, &export_cap);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_overwrite), UT_V7_CborOverwrite_Handler, &overwrite_cap);
+
+    /* not encoded yet, this is a full encode */
+    UtAssert_INT32_NEQ(v7_block_update_canonical(&ccb), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_overwrite, 0);
+
+    /* nominal, only the count and the CRC change */
+    ccb.block_encode_size_cache = sizeof(ENCODED);
+    bplib_mpool_bblock_canonical_set_content_position(&ccb, 6, 5);
+    UtAssert_INT32_EQ(v7_block_update_canonical(&ccb), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 1);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_overwrite, 1);
+    UtAssert_MemCmp(overwrite_cap.data, ENCODED, 10, "Unchanged part of the block");
+    UtAssert_UINT32_EQ(overwrite_cap.data[10], 4);
+    UtAssert_UINT32_EQ(overwrite_cap.data[11], 0x42);
+    UtAssert_UINT32_EQ(overwrite_cap.data[12], 0x12);
+    UtAssert_UINT32_EQ(overwrite_cap.data[13], 0x34);
+
+    /* the content size changes, so it has to be encoded again */
+    ccb.canonical_logical_data.data.hop_count_block.hopLimit = 300;
+    UtAssert_INT32_NEQ(v7_block_update_canonical(&ccb), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 2);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_cbor_overwrite, 1);
+
+    /* not the same layout as it would be encoded here (indefinite length array) */
+    ccb.canonical_logical_data.data.hop_count_block.hopLimit = 30;
+    export_cap.data[0]                                      = 0x9f;
+    UtAssert_INT32_NEQ(v7_block_update_canonical(&ccb), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 3);
+    export_cap.data[0] = 0x86;
+
+    /* could not write all of it */
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_cbor_overwrite), NULL, NULL);
+    UtAssert_INT32_NEQ(v7_block_update_canonical(&ccb), 0);
+    UtAssert_STUB_COUNT(bplib_mpool_bblock_canonical_drop_encode, 4);
+}
+
 void test_v7_encoder_mpstream_write(void)
 {
     /* Test function for:
@@ -151,12 +456,50 @@ void test_v7_encoder_write_wrapper(void)
     UtAssert_INT32_EQ(v7_encoder_write_wrapper(&enc, ptr, sz, at), 0);
 }
 
+void test_v7_encoder_write_wrapper_slices(void)
+{
+    /* Test function for:
+     * CborError v7_encoder_write_wrapper(void *arg, const void *ptr, size_t sz, CborEncoderAppendType at)
+     */
+    v7_encode_state_t enc;
+    uint8_t           content[5];
+
+    memset(&enc, 0, sizeof(v7_encode_state_t));
+    memset(content, 0, sizeof(content));
+    enc.next_writer = test_bplib_v7_writer_func_stub;
+    enc.crc_params  = &BPLIB_CRC16_X25;
+
+    /* without slicing, it is digested and written in one go */
+    UtAssert_INT32_EQ(v7_encoder_write_wrapper(&enc, content, sizeof(content), CborEncoderAppendStringData), 0);
+    UtAssert_STUB_COUNT(bplib_crc_update, 1);
+    UtAssert_STUB_COUNT(test_bplib_v7_writer_func_stub, 1);
+
+    /* each slice is digested right before it is written */
+    enc.crc_slice_size = 2;
+    UtAssert_INT32_EQ(v7_encoder_write_wrapper(&enc, content, sizeof(content), CborEncoderAppendStringData), 0);
+    UtAssert_STUB_COUNT(bplib_crc_update, 4);
+    UtAssert_STUB_COUNT(test_bplib_v7_writer_func_stub, 4);
+    UtAssert_UINT32_EQ(enc.total_bytes_encoded, 2 * sizeof(content));
+
+    /* a failed write stops it */
+    UT_SetDeferredRetcode(UT_KEY(test_bplib_v7_writer_func_stub), 2, BP_ERROR);
+    UtAssert_INT32_NEQ(v7_encoder_write_wrapper(&enc, content, sizeof(content), CborEncoderAppendStringData), 0);
+    UtAssert_STUB_COUNT(test_bplib_v7_writer_func_stub, 6);
+}
+
 void TestV7EncodeApi_Rgister(void)
 {
     UtTest_Add(test_v7_block_encode_pri, NULL, NULL, "Test v7_block_encode_pri");
+    UtTest_Add(test_v7_block_encode_pri_flat, NULL, NULL, "Test v7_block_encode_pri_flat");
+    UtTest_Add(test_v7_block_encode_pri_template, NULL, NULL, "Test v7_block_encode_pri_template");
+    UtTest_Add(test_v7_block_encode_pri_from_template, NULL, NULL, "Test v7_block_encode_pri_from_template");
     UtTest_Add(test_v7_block_encode_pay, NULL, NULL, "Test v7_block_encode_pay");
+    UtTest_Add(test_v7_block_encode_pay_extern, NULL, NULL, "Test v7_block_encode_pay_extern");
     UtTest_Add(test_v7_block_encode_canonical, NULL, NULL, "Test v7_block_encode_canonical");
+    UtTest_Add(test_v7_block_encode_canonical_flat, NULL, NULL, "Test v7_block_encode_canonical_flat");
+    UtTest_Add(test_v7_block_update_canonical, NULL, NULL, "Test v7_block_update_canonical");
     UtTest_Add(test_v7_encoder_mpstream_write, NULL, NULL, "Test v7_encoder_mpstream_write");
     UtTest_Add(test_v7_encoder_write_crc, NULL, NULL, "Test v7_encoder_write_crc");
     UtTest_Add(test_v7_encoder_write_wrapper, NULL, NULL, "Test v7_encoder_write_wrapper");
+    UtTest_Add(test_v7_encoder_write_wrapper_slices, NULL, NULL, "Test v7_encoder_write_wrapper slices");
 }
@@ -0,0 +1,192 @@
+/************************************************************************
+ * NASA Docket No. GSC-18,719-1, and identified as “core Flight System: Bootes”
+ *
+ * Copyright (c) 2020 United States Government as represented by the
+ * Administrator of the National Aeronautics and Space Administration.
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ************************************************************************/
+
+/*
+ * Includes
+ */
+#include "test_bplib_v7.h"
+
+/* a primary block and a payload block which is too big for the stage used here */
+#define UT_V7_STREAM_STAGE_SIZE 32
+#define UT_V7_STREAM_CRC_OFFSET 72
+
+static uint8_t UT_V7_STREAM_BUNDLE[] = {
+    0x9F,
+
+    /* primary: version, flags, no CRC, dest/src/report EIDs, timestamp, lifetime */
+    0x88, 0x07, 0x00, 0x00, 0x82, 0x02, 0x82, 0x01, 0x02, 0x82, 0x02, 0x82, 0x01, 0x03, 0x82, 0x02, 0x82, 0x01,
+    0x04, 0x82, 0x00, 0x00, 0x00,
+
+    /* payload: type 1, number 1, flags 0, CRC16, 40 bytes of content, CRC */
+    0x86, 0x01, 0x01, 0x00, 0x01, 0x58, 0x28, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+    0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c,
+    0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x42, 0x00, 0x00,
+
+    0xFF};
+
+static void UT_V7_AltHandler_StreamWrite(void *UserObj, UT_EntryKey_t FuncKey, const UT_StubContext_t *Context)
+{
+    size_t size = UT_Hook_GetArgValueByName(Context, "size", size_t);
+
+    UT_Stub_SetReturnValue(FuncKey, size);
+}
+
+static void UT_V7_StreamImport_Setup(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_bblock_canonical_t *ccb)
+{
+    memset(cpb, 0, sizeof(*cpb));
+    memset(ccb, 0, sizeof(*ccb));
+
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_stream_write), UT_V7_AltHandler_StreamWrite, NULL);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, ccb);
+    UT_SetDefaultReturnValue(UT_KEY(bplib_crc_get_width), 16);
+}
+
+void test_v7_stream_import(void)
+{
+    /* Test function for:
+     * void v7_stream_import_begin(v7_stream_import_t *sis, bplib_mpool_bblock_primary_t *cpb, uint8_t *stage,
+     *                             size_t stage_size, uint32_t import_flags)
+     * bool v7_stream_import_feed(v7_stream_import_t *sis, const void *data, size_t size)
+     * size_t v7_stream_import_end(v7_stream_import_t *sis)
+     */
+    v7_stream_import_t             sis;
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t ccb;
+    uint8_t                        stage[UT_V7_STREAM_STAGE_SIZE];
+    uint8_t                        big_stage[2 * UT_V7_STREAM_STAGE_SIZE];
+    size_t                         i;
+
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+
+    /* all at once, the primary block goes through the stage and the payload is streamed */
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), V7_IMPORT_LAZY_DECODE);
+    UtAssert_BOOL_TRUE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+    UtAssert_UINT32_EQ(v7_stream_import_end(&sis), sizeof(UT_V7_STREAM_BUNDLE));
+    UtAssert_UINT32_EQ(cpb.block_encode_size_cache, 23);
+    UtAssert_UINT32_EQ(ccb.block_encode_size_cache, 50);
+    UtAssert_UINT32_EQ(ccb.canonical_logical_data.canonical_block.blockType, bp_blocktype_payloadBlock);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_canonical_get_content_offset(&ccb), 7);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_canonical_get_content_length(&ccb), 40);
+    UtAssert_BOOL_FALSE(cpb.data.delivery.crc_deferred);
+    UtAssert_STUB_COUNT(bplib_mpool_stream_attach, 2);
+
+    /* a byte at a time comes out the same */
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), V7_IMPORT_LAZY_DECODE);
+    for (i = 0; i < sizeof(UT_V7_STREAM_BUNDLE); ++i)
+    {
+        UtAssert_BOOL_TRUE(v7_stream_import_feed(&sis, &UT_V7_STREAM_BUNDLE[i], 1));
+    }
+    UtAssert_UINT32_EQ(v7_stream_import_end(&sis), sizeof(UT_V7_STREAM_BUNDLE));
+    UtAssert_UINT32_EQ(ccb.block_encode_size_cache, 50);
+
+    /* with a stage that is big enough, the payload is collected and decoded like any other block */
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, big_stage, sizeof(big_stage), V7_IMPORT_LAZY_DECODE);
+    UtAssert_BOOL_TRUE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+    UtAssert_UINT32_EQ(v7_stream_import_end(&sis), sizeof(UT_V7_STREAM_BUNDLE));
+    UtAssert_UINT32_EQ(ccb.block_encode_size_cache, 50);
+    UtAssert_UINT32_EQ(bplib_mpool_bblock_canonical_get_content_offset(&ccb), 7);
+
+    /* a bad CRC on the streamed block is found as it goes, unless it is deferred */
+    UT_V7_STREAM_BUNDLE[UT_V7_STREAM_CRC_OFFSET] = 0x12;
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), V7_IMPORT_LAZY_DECODE);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+    UtAssert_ZERO(v7_stream_import_end(&sis));
+
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, big_stage, sizeof(big_stage), V7_IMPORT_LAZY_DECODE);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), V7_IMPORT_LAZY_DECODE | V7_IMPORT_DEFER_CRC);
+    UtAssert_BOOL_TRUE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+    UtAssert_UINT32_EQ(v7_stream_import_end(&sis), sizeof(UT_V7_STREAM_BUNDLE));
+    UtAssert_BOOL_TRUE(cpb.data.delivery.crc_deferred);
+    UT_V7_STREAM_BUNDLE[UT_V7_STREAM_CRC_OFFSET] = 0x00;
+}
+
+void test_v7_stream_import_errors(void)
+{
+    /* Test function for:
+     * bool v7_stream_import_feed(v7_stream_import_t *sis, const void *data, size_t size)
+     * size_t v7_stream_import_end(v7_stream_import_t *sis)
+     */
+    static const uint8_t NOT_BUNDLE[] = {0x80};
+
+    v7_stream_import_t             sis;
+    bplib_mpool_bblock_primary_t   cpb;
+    bplib_mpool_bblock_canonical_t ccb;
+    uint8_t                        stage[UT_V7_STREAM_STAGE_SIZE];
+    uint8_t                        buf[sizeof(UT_V7_STREAM_BUNDLE) + 1];
+
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+
+    /* not an array */
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), 0);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, NOT_BUNDLE, sizeof(NOT_BUNDLE)));
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+    UtAssert_ZERO(v7_stream_import_end(&sis));
+
+    /* stopped in the middle of the streamed block, what was written of it is dropped */
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), 0);
+    UtAssert_BOOL_TRUE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, 60));
+    UT_ResetState(UT_KEY(bplib_mpool_stream_close));
+    UtAssert_ZERO(v7_stream_import_end(&sis));
+    UtAssert_STUB_COUNT(bplib_mpool_stream_close, 1);
+
+    /* more after the end of the bundle */
+    memcpy(buf, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE));
+    buf[sizeof(UT_V7_STREAM_BUNDLE)] = 0xFF;
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), 0);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, buf, sizeof(buf)));
+
+    /* a primary block that does not fit in the stage */
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, 16, 0);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+
+    /* only a payload block can be streamed */
+    memcpy(buf, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE));
+    buf[25] = bp_blocktype_bundleAge;
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), 0);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, buf, sizeof(UT_V7_STREAM_BUNDLE)));
+
+    /* no memory for the canonical block */
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_bblock_canonical_cast), UT_V7_AltHandler_PointerReturn, NULL);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), 0);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, sizeof(UT_V7_STREAM_BUNDLE)));
+
+    /* the pool is out of blocks to stream into */
+    UT_V7_StreamImport_Setup(&cpb, &ccb);
+    v7_stream_import_begin(&sis, &cpb, stage, sizeof(stage), 0);
+    UtAssert_BOOL_TRUE(v7_stream_import_feed(&sis, UT_V7_STREAM_BUNDLE, 40));
+    UT_SetHandlerFunction(UT_KEY(bplib_mpool_stream_write), NULL, NULL);
+    UtAssert_BOOL_FALSE(v7_stream_import_feed(&sis, &UT_V7_STREAM_BUNDLE[40], 10));
+}
+
+void TestV7StreamImport_Rgister(void)
+{
+    UtTest_Add(test_v7_stream_import, NULL, NULL, "Test v7_stream_import");
+    UtTest_Add(test_v7_stream_import_errors, NULL, NULL, "Test v7_stream_import errors");
+}
@@ -0,0 +1,425 @@
+/************************************************************************
+ *
+ *  Benchmark of the BPv7 bundle codec
+ *
+ *  A few representative bundles are built in a real memory pool: a small
+ *  telemetry bundle, a 64 KiB science bundle, and an admin record bundle
+ *  carrying a custody acceptance (DACS).  Each one is first checked to
+ *  survive an encode, decode and re-encode unchanged.  Then the main codec
+ *  steps are timed on each, and the cost per bundle and throughput are
+ *  printed, so that codec changes can be validated and compared between
+ *  builds.
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "utassert.h"
+#include "uttest.h"
+
+#include "osapi.h"
+
+#include "bplib.h"
+#include "v7.h"
+#include "v7_codec.h"
+#include "v7_mpool.h"
+#include "v7_mpool_bblocks.h"
+#include "benchutil.h"
+
+/* the memory pool, big enough for several copies of the largest bundle */
+#define CODEC_BENCH_POOL_SIZE (8 * 1024 * 1024)
+
+/* the largest payload, and the buffer the encoded bundles are copied to */
+#define CODEC_BENCH_MAX_PAYLOAD 65536
+#define CODEC_BENCH_WIRE_SIZE   (CODEC_BENCH_MAX_PAYLOAD + 1024)
+
+/* the amount of bundle data each measurement goes through, whatever the bundle size */
+#define CODEC_BENCH_BYTES_PER_RUN (16 * 1024 * 1024)
+
+/* but even the big bundles are done at least this many times */
+#define CODEC_BENCH_MIN_ITERATIONS 256
+
+typedef enum codec_bench_step
+{
+    codec_bench_step_encode_pri,
+    codec_bench_step_encode_pay,
+    codec_bench_step_decode_pri,
+    codec_bench_step_copy_out,
+    codec_bench_step_copy_in,
+    codec_bench_step_max
+} codec_bench_step_t;
+
+typedef struct codec_bench_profile
+{
+    const char  *name;
+    size_t       payload_size; /* for an admin record, this is the number of DACS ranges */
+    bool         is_admin;
+    bp_crctype_t crctype;
+} codec_bench_profile_t;
+
+static const codec_bench_profile_t CODEC_BENCH_PROFILES[] = {
+    {"telemetry", 64, false, bp_crctype_CRC16},
+    {"science", CODEC_BENCH_MAX_PAYLOAD, false, bp_crctype_CRC32C},
+    {"dacs", BP_DACS_MAX_SEQ_PER_PAYLOAD, true, bp_crctype_CRC16}};
+
+static const char *const CODEC_BENCH_STEP_NAMES[codec_bench_step_max] = {"encode_pri", "encode_pay", "decode_pri",
+                                                                         "copy_out", "copy_in"};
+
+static const bp_ipn_addr_t CODEC_BENCH_SRC_ADDR = {100, 1};
+static const bp_ipn_addr_t CODEC_BENCH_DST_ADDR = {200, 1};
+
+static uint8_t        codec_bench_pool_mem[CODEC_BENCH_POOL_SIZE];
+static uint8_t        codec_bench_payload[CODEC_BENCH_MAX_PAYLOAD];
+static uint8_t        codec_bench_wire[CODEC_BENCH_WIRE_SIZE];
+static uint8_t        codec_bench_wire2[CODEC_BENCH_WIRE_SIZE];
+static bplib_mpool_t *codec_bench_pool;
+
+/* the benchmark loop stores its results here so they cannot be optimized away */
+volatile size_t codec_bench_sink;
+
+#define CODEC_BENCH_NUM_PROFILES (sizeof(CODEC_BENCH_PROFILES) / sizeof(CODEC_BENCH_PROFILES[0]))
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+static bplib_mpool_bblock_canonical_t *codec_bench_get_profile_payload(const codec_bench_profile_t *profile,
+                                                                       bplib_mpool_bblock_primary_t *cpb)
+{
+    bp_blocktype_t block_type;
+
+    if (profile->is_admin)
+    {
+        block_type = bp_blocktype_custodyAcceptPayloadBlock;
+    }
+    else
+    {
+        block_type = bp_blocktype_payloadBlock;
+    }
+
+    return bplib_mpool_bblock_canonical_cast(bplib_mpool_bblock_primary_locate_canonical(cpb, block_type));
+}
+
+/* Encodes the payload block the way the library does for the profile */
+static int codec_bench_encode_payload(const codec_bench_profile_t *profile, bplib_mpool_bblock_canonical_t *ccb)
+{
+    if (profile->is_admin)
+    {
+        return v7_block_encode_canonical(ccb);
+    }
+
+    return v7_block_encode_pay(ccb, codec_bench_payload, profile->payload_size);
+}
+
+/* Builds and encodes a bundle like one the library would generate for the profile */
+static bplib_mpool_block_t *codec_bench_build(const codec_bench_profile_t *profile)
+{
+    bplib_mpool_block_t               *pblk;
+    bplib_mpool_block_t               *cblk;
+    bplib_mpool_bblock_primary_t      *cpb;
+    bplib_mpool_bblock_canonical_t    *ccb;
+    bp_primary_block_t                *pri;
+    bp_canonical_block_buffer_t       *pay;
+    bp_custody_accept_payload_block_t *dacs;
+    size_t                             i;
+
+    pblk = bplib_mpool_bblock_primary_alloc(codec_bench_pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+    cpb  = bplib_mpool_bblock_primary_cast(pblk);
+    cblk = bplib_mpool_bblock_canonical_alloc(codec_bench_pool, 0, NULL);
+    ccb  = bplib_mpool_bblock_canonical_cast(cblk);
+    if (cpb == NULL || ccb == NULL)
+    {
+        UtAssert_Failed("%s: could not allocate bundle", profile->name);
+        if (pblk != NULL)
+        {
+            bplib_mpool_recycle_block(pblk);
+        }
+        if (cblk != NULL)
+        {
+            bplib_mpool_recycle_block(cblk);
+        }
+        return NULL;
+    }
+
+    pri = bplib_mpool_bblock_primary_get_logical(cpb);
+
+    pri->version = 7;
+
+    v7_set_eid(&pri->destinationEID, &CODEC_BENCH_DST_ADDR);
+    v7_set_eid(&pri->sourceEID, &CODEC_BENCH_SRC_ADDR);
+    v7_set_eid(&pri->reportEID, &CODEC_BENCH_SRC_ADDR);
+
+    pri->creationTimeStamp.time         = v7_get_current_time();
+    pri->creationTimeStamp.sequence_num = 1;
+
+    pri->lifetime                     = 3600000;
+    pri->controlFlags.isAdminRecord   = profile->is_admin;
+    pri->controlFlags.mustNotFragment = true;
+    pri->crctype                      = profile->crctype;
+
+    pay = bplib_mpool_bblock_canonical_get_logical(ccb);
+
+    pay->canonical_block.blockNum = 1;
+    pay->canonical_block.crctype  = profile->crctype;
+
+    if (profile->is_admin)
+    {
+        pay->canonical_block.blockType = bp_blocktype_custodyAcceptPayloadBlock;
+
+        dacs = &pay->data.custody_accept_payload_block;
+        v7_set_eid(&dacs->flow_source_eid, &CODEC_BENCH_DST_ADDR);
+        dacs->num_entries = profile->payload_size;
+        for (i = 0; i < profile->payload_size; ++i)
+        {
+            /* a mix of runs and single sequence numbers, which are encoded differently */
+            dacs->ranges[i].first_seq = 1000 + (i * 100);
+            dacs->ranges[i].count     = (i & 1) ? 1 : 64;
+        }
+    }
+    else
+    {
+        pay->canonical_block.blockType = bp_blocktype_payloadBlock;
+    }
+
+    UtAssert_INT32_EQ(v7_block_encode_pri(cpb), 0);
+    UtAssert_INT32_EQ(codec_bench_encode_payload(profile, ccb), 0);
+
+    bplib_mpool_bblock_primary_append(cpb, cblk);
+
+    return pblk;
+}
+
+/* Runs one step of the codec on the bundle, and returns how much it did */
+static size_t codec_bench_run_step(const codec_bench_profile_t *profile, codec_bench_step_t step,
+                                   bplib_mpool_bblock_primary_t *cpb, size_t wire_size)
+{
+    bplib_mpool_block_t          *pblk;
+    bplib_mpool_bblock_primary_t *dest;
+    size_t                        result;
+
+    result = 0;
+    switch (step)
+    {
+        case codec_bench_step_encode_pri:
+            result = (v7_block_encode_pri(cpb) == 0);
+            break;
+
+        case codec_bench_step_encode_pay:
+            result = (codec_bench_encode_payload(profile, codec_bench_get_profile_payload(profile, cpb)) == 0);
+            break;
+
+        case codec_bench_step_decode_pri:
+            /* the primary block follows the one byte start of the bundle array */
+            result = (v7_block_decode_pri(cpb, &codec_bench_wire[1], cpb->block_encode_size_cache) == 0);
+            break;
+
+        case codec_bench_step_copy_out:
+            result = v7_copy_full_bundle_out(cpb, codec_bench_wire2, sizeof(codec_bench_wire2));
+            break;
+
+        case codec_bench_step_copy_in:
+            /* this includes getting the bundle block from the pool, which a receiving CLA always has to do */
+            pblk = bplib_mpool_bblock_primary_alloc(codec_bench_pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+            dest = bplib_mpool_bblock_primary_cast(pblk);
+            if (dest != NULL)
+            {
+                result = v7_copy_full_bundle_in(dest, codec_bench_wire, wire_size, 0);
+                bplib_mpool_recycle_block(pblk);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* anything the step let go of goes back to the pool now, so the pool never runs out */
+    bplib_mpool_collect_blocks(codec_bench_pool, UINT32_MAX);
+
+    return result;
+}
+
+/* Returns the time per bundle in ns, and the throughput in MB/s */
+static double codec_bench_measure(const codec_bench_profile_t *profile, codec_bench_step_t step,
+                                  bplib_mpool_bblock_primary_t *cpb, size_t wire_size, double *mb_per_sec)
+{
+    uint64_t start_time;
+    uint64_t elapsed;
+    uint32_t iterations;
+    uint32_t i;
+    size_t   sum;
+
+    iterations = CODEC_BENCH_BYTES_PER_RUN / wire_size;
+    if (iterations < CODEC_BENCH_MIN_ITERATIONS)
+    {
+        iterations = CODEC_BENCH_MIN_ITERATIONS;
+    }
+
+    sum = 0;
+
+    start_time = bench_get_time_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        sum += codec_bench_run_step(profile, step, cpb, wire_size);
+    }
+    elapsed = bench_get_time_ns() - start_time;
+
+    codec_bench_sink = sum;
+
+    if (elapsed == 0)
+    {
+        elapsed = 1;
+    }
+
+    /* bytes per nanosecond is GB/s, a thousand times that is MB/s */
+    *mb_per_sec = ((double)iterations * (double)wire_size * 1000.0) / (double)elapsed;
+    return (double)elapsed / (double)iterations;
+}
+
+/*************************************************************************
+ * Tests
+ *************************************************************************/
+
+void codec_bench_setup(void)
+{
+    uint32_t seed;
+    size_t   i;
+
+    if (codec_bench_pool == NULL)
+    {
+        UtAssert_INT32_EQ(OS_API_Init(), OS_SUCCESS);
+        UtAssert_INT32_EQ(bplib_init(), BP_SUCCESS);
+        codec_bench_pool = bplib_mpool_create(codec_bench_pool_mem, sizeof(codec_bench_pool_mem));
+        UtAssert_NOT_NULL(codec_bench_pool);
+    }
+
+    /* fixed pseudo-random content, so runs are comparable */
+    seed = 0x2545F491;
+    for (i = 0; i < sizeof(codec_bench_payload); ++i)
+    {
+        seed                   = (seed * 1103515245) + 12345;
+        codec_bench_payload[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+void codec_bench_verify(void)
+{
+    const codec_bench_profile_t    *profile;
+    bplib_mpool_bblock_primary_t   *cpb;
+    bplib_mpool_bblock_primary_t   *dest;
+    bplib_mpool_bblock_canonical_t *ccb;
+    bplib_mpool_block_t            *sblk;
+    bplib_mpool_block_t            *pblk;
+    size_t                          wire_size;
+    size_t                          p;
+
+    for (p = 0; p < CODEC_BENCH_NUM_PROFILES; ++p)
+    {
+        profile = &CODEC_BENCH_PROFILES[p];
+        sblk    = codec_bench_build(profile);
+        if (sblk == NULL)
+        {
+            continue;
+        }
+
+        cpb = bplib_mpool_bblock_primary_cast(sblk);
+
+        wire_size = v7_compute_full_bundle_size(cpb);
+        UtAssert_True(wire_size != 0 && wire_size <= sizeof(codec_bench_wire), "%s: bundle size %lu",
+                      profile->name, (unsigned long)wire_size);
+        UtAssert_True(v7_copy_full_bundle_out(cpb, codec_bench_wire, sizeof(codec_bench_wire)) == wire_size,
+                      "%s: copy out", profile->name);
+
+        /* decoding it and encoding it again must come out exactly the same */
+        pblk = bplib_mpool_bblock_primary_alloc(codec_bench_pool, 0, NULL, BPLIB_MPOOL_ALLOC_PRI_MED, 0);
+        dest = bplib_mpool_bblock_primary_cast(pblk);
+        UtAssert_NOT_NULL(dest);
+        if (dest != NULL)
+        {
+            UtAssert_True(v7_copy_full_bundle_in(dest, codec_bench_wire, wire_size, 0) == wire_size, "%s: copy in",
+                          profile->name);
+            UtAssert_True(bplib_mpool_bblock_primary_get_logical(dest)->controlFlags.isAdminRecord == profile->is_admin,
+                          "%s: admin record flag", profile->name);
+
+            ccb = codec_bench_get_profile_payload(profile, dest);
+            UtAssert_NOT_NULL(ccb);
+            if (ccb != NULL && profile->is_admin)
+            {
+                /* the admin record is encoded again from its logical data, not the copy that came in */
+                UtAssert_INT32_EQ(v7_block_encode_canonical(ccb), 0);
+            }
+            else if (ccb != NULL)
+            {
+                UtAssert_True(bplib_mpool_bblock_canonical_get_content_length(ccb) == profile->payload_size,
+                              "%s: payload size", profile->name);
+            }
+
+            /* as is the primary block */
+            UtAssert_INT32_EQ(v7_block_encode_pri(dest), 0);
+            UtAssert_True(v7_compute_full_bundle_size(dest) == wire_size, "%s: re-encoded size", profile->name);
+            UtAssert_True(v7_copy_full_bundle_out(dest, codec_bench_wire2, sizeof(codec_bench_wire2)) == wire_size &&
+                              memcmp(codec_bench_wire, codec_bench_wire2, wire_size) == 0,
+                          "%s: re-encoded bundle matches", profile->name);
+
+            bplib_mpool_recycle_block(pblk);
+        }
+
+        bplib_mpool_recycle_block(sblk);
+        bplib_mpool_collect_blocks(codec_bench_pool, UINT32_MAX);
+    }
+}
+
+void codec_bench_throughput(void)
+{
+    const codec_bench_profile_t  *profile;
+    bplib_mpool_bblock_primary_t *cpb;
+    bplib_mpool_block_t          *sblk;
+    size_t                        wire_size;
+    double                        ns_per_bundle;
+    double                        mb_per_sec;
+    size_t                        p;
+    codec_bench_step_t            s;
+
+    for (p = 0; p < CODEC_BENCH_NUM_PROFILES; ++p)
+    {
+        profile = &CODEC_BENCH_PROFILES[p];
+        sblk    = codec_bench_build(profile);
+        if (sblk == NULL)
+        {
+            continue;
+        }
+
+        cpb = bplib_mpool_bblock_primary_cast(sblk);
+
+        wire_size = v7_compute_full_bundle_size(cpb);
+        v7_copy_full_bundle_out(cpb, codec_bench_wire, sizeof(codec_bench_wire));
+
+        for (s = 0; s < codec_bench_step_max; ++s)
+        {
+            ns_per_bundle = codec_bench_measure(profile, s, cpb, wire_size, &mb_per_sec);
+            UtPrintf("%-9s %-10s size %5lu: %10.1f ns/bundle %9.1f MB/s", profile->name, CODEC_BENCH_STEP_NAMES[s],
+                     (unsigned long)wire_size, ns_per_bundle, mb_per_sec);
+
+            /* the steps which drop the encoded data have to leave the bundle ready for the next one */
+            v7_compute_full_bundle_size(cpb);
+        }
+
+        bplib_mpool_recycle_block(sblk);
+        bplib_mpool_collect_blocks(codec_bench_pool, UINT32_MAX);
+    }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+void UtTest_Setup(void)
+{
+    UtTest_Add(codec_bench_verify, codec_bench_setup, NULL, "verify");
+    UtTest_Add(codec_bench_throughput, codec_bench_setup, NULL, "throughput");
+}
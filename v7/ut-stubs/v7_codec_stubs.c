@@ -27,6 +27,26 @@
 #include "v7_codec.h"
 #include "utgenstub.h"
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_adopt_full_bundle_in()
+ * ----------------------------------------------------
+ */
+size_t v7_adopt_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, bplib_mpool_ref_t buffer_ref, size_t buf_sz,
+                               uint32_t import_flags)
+{
+    UT_GenStub_SetupReturnBuffer(v7_adopt_full_bundle_in, size_t);
+
+    UT_GenStub_AddParam(v7_adopt_full_bundle_in, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_adopt_full_bundle_in, bplib_mpool_ref_t, buffer_ref);
+    UT_GenStub_AddParam(v7_adopt_full_bundle_in, size_t, buf_sz);
+    UT_GenStub_AddParam(v7_adopt_full_bundle_in, uint32_t, import_flags);
+
+    UT_GenStub_Execute(v7_adopt_full_bundle_in, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_adopt_full_bundle_in, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for v7_compute_full_bundle_size()
@@ -48,13 +68,15 @@ size_t v7_compute_full_bundle_size(bplib_mpool_bblock_primary_t *cpb)
  * Generated stub function for v7_copy_full_bundle_in()
  * ----------------------------------------------------
  */
-size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz)
+size_t v7_copy_full_bundle_in(bplib_mpool_bblock_primary_t *cpb, const void *buffer, size_t buf_sz,
+                              uint32_t import_flags)
 {
     UT_GenStub_SetupReturnBuffer(v7_copy_full_bundle_in, size_t);
 
     UT_GenStub_AddParam(v7_copy_full_bundle_in, bplib_mpool_bblock_primary_t *, cpb);
     UT_GenStub_AddParam(v7_copy_full_bundle_in, const void *, buffer);
     UT_GenStub_AddParam(v7_copy_full_bundle_in, size_t, buf_sz);
+    UT_GenStub_AddParam(v7_copy_full_bundle_in, uint32_t, import_flags);
 
     UT_GenStub_Execute(v7_copy_full_bundle_in, Basic, NULL);
 
@@ -78,3 +100,141 @@ size_t v7_copy_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer,
 
     return UT_GenStub_GetReturnValue(v7_copy_full_bundle_out, size_t);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_encode_full_bundle_out()
+ * ----------------------------------------------------
+ */
+size_t v7_encode_full_bundle_out(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz)
+{
+    UT_GenStub_SetupReturnBuffer(v7_encode_full_bundle_out, size_t);
+
+    UT_GenStub_AddParam(v7_encode_full_bundle_out, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_encode_full_bundle_out, void *, buffer);
+    UT_GenStub_AddParam(v7_encode_full_bundle_out, size_t, buf_sz);
+
+    UT_GenStub_Execute(v7_encode_full_bundle_out, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_encode_full_bundle_out, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_export_full_bundle_iov()
+ * ----------------------------------------------------
+ */
+size_t v7_export_full_bundle_iov(bplib_mpool_bblock_primary_t *cpb, bplib_iovec_t *iov, size_t max_iov)
+{
+    UT_GenStub_SetupReturnBuffer(v7_export_full_bundle_iov, size_t);
+
+    UT_GenStub_AddParam(v7_export_full_bundle_iov, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_export_full_bundle_iov, bplib_iovec_t *, iov);
+    UT_GenStub_AddParam(v7_export_full_bundle_iov, size_t, max_iov);
+
+    UT_GenStub_Execute(v7_export_full_bundle_iov, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_export_full_bundle_iov, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_stream_export_begin()
+ * ----------------------------------------------------
+ */
+size_t v7_stream_export_begin(v7_stream_export_t *sxs, bplib_mpool_bblock_primary_t *cpb)
+{
+    UT_GenStub_SetupReturnBuffer(v7_stream_export_begin, size_t);
+
+    UT_GenStub_AddParam(v7_stream_export_begin, v7_stream_export_t *, sxs);
+    UT_GenStub_AddParam(v7_stream_export_begin, bplib_mpool_bblock_primary_t *, cpb);
+
+    UT_GenStub_Execute(v7_stream_export_begin, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_stream_export_begin, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_stream_export_next()
+ * ----------------------------------------------------
+ */
+size_t v7_stream_export_next(v7_stream_export_t *sxs, void *buffer, size_t buf_sz)
+{
+    UT_GenStub_SetupReturnBuffer(v7_stream_export_next, size_t);
+
+    UT_GenStub_AddParam(v7_stream_export_next, v7_stream_export_t *, sxs);
+    UT_GenStub_AddParam(v7_stream_export_next, void *, buffer);
+    UT_GenStub_AddParam(v7_stream_export_next, size_t, buf_sz);
+
+    UT_GenStub_Execute(v7_stream_export_next, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_stream_export_next, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_stream_import_begin()
+ * ----------------------------------------------------
+ */
+void v7_stream_import_begin(v7_stream_import_t *sis, bplib_mpool_bblock_primary_t *cpb, uint8_t *stage,
+                            size_t stage_size, uint32_t import_flags)
+{
+    UT_GenStub_AddParam(v7_stream_import_begin, v7_stream_import_t *, sis);
+    UT_GenStub_AddParam(v7_stream_import_begin, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_stream_import_begin, uint8_t *, stage);
+    UT_GenStub_AddParam(v7_stream_import_begin, size_t, stage_size);
+    UT_GenStub_AddParam(v7_stream_import_begin, uint32_t, import_flags);
+
+    UT_GenStub_Execute(v7_stream_import_begin, Basic, NULL);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_stream_import_end()
+ * ----------------------------------------------------
+ */
+size_t v7_stream_import_end(v7_stream_import_t *sis)
+{
+    UT_GenStub_SetupReturnBuffer(v7_stream_import_end, size_t);
+
+    UT_GenStub_AddParam(v7_stream_import_end, v7_stream_import_t *, sis);
+
+    UT_GenStub_Execute(v7_stream_import_end, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_stream_import_end, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_stream_import_feed()
+ * ----------------------------------------------------
+ */
+bool v7_stream_import_feed(v7_stream_import_t *sis, const void *data, size_t size)
+{
+    UT_GenStub_SetupReturnBuffer(v7_stream_import_feed, bool);
+
+    UT_GenStub_AddParam(v7_stream_import_feed, v7_stream_import_t *, sis);
+    UT_GenStub_AddParam(v7_stream_import_feed, const void *, data);
+    UT_GenStub_AddParam(v7_stream_import_feed, size_t, size);
+
+    UT_GenStub_Execute(v7_stream_import_feed, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_stream_import_feed, bool);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_verify_deferred_crcs()
+ * ----------------------------------------------------
+ */
+bool v7_verify_deferred_crcs(bplib_mpool_bblock_primary_t *cpb)
+{
+    UT_GenStub_SetupReturnBuffer(v7_verify_deferred_crcs, bool);
+
+    UT_GenStub_AddParam(v7_verify_deferred_crcs, bplib_mpool_bblock_primary_t *, cpb);
+
+    UT_GenStub_Execute(v7_verify_deferred_crcs, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_verify_deferred_crcs, bool);
+}
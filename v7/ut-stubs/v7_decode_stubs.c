@@ -47,6 +47,43 @@ int v7_block_decode_canonical(bplib_mpool_bblock_canonical_t *ccb, const void *d
     return UT_GenStub_GetReturnValue(v7_block_decode_canonical, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_decode_canonical_data()
+ * ----------------------------------------------------
+ */
+int v7_block_decode_canonical_data(bplib_mpool_bblock_canonical_t *ccb)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_decode_canonical_data, int);
+
+    UT_GenStub_AddParam(v7_block_decode_canonical_data, bplib_mpool_bblock_canonical_t *, ccb);
+
+    UT_GenStub_Execute(v7_block_decode_canonical_data, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_decode_canonical_data, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_decode_canonical_ext()
+ * ----------------------------------------------------
+ */
+int v7_block_decode_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                                  bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_decode_canonical_ext, int);
+
+    UT_GenStub_AddParam(v7_block_decode_canonical_ext, bplib_mpool_bblock_canonical_t *, ccb);
+    UT_GenStub_AddParam(v7_block_decode_canonical_ext, const void *, data_ptr);
+    UT_GenStub_AddParam(v7_block_decode_canonical_ext, size_t, data_size);
+    UT_GenStub_AddParam(v7_block_decode_canonical_ext, bp_blocktype_t, payload_block_hint);
+    UT_GenStub_AddParam(v7_block_decode_canonical_ext, bplib_mpool_ref_t, source_ref);
+
+    UT_GenStub_Execute(v7_block_decode_canonical_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_decode_canonical_ext, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for v7_block_decode_pri()
@@ -64,3 +101,44 @@ int v7_block_decode_pri(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr,
 
     return UT_GenStub_GetReturnValue(v7_block_decode_pri, int);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_decode_pri_ext()
+ * ----------------------------------------------------
+ */
+int v7_block_decode_pri_ext(bplib_mpool_bblock_primary_t *cpb, const void *data_ptr, size_t data_size,
+                            bplib_mpool_ref_t source_ref)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_decode_pri_ext, int);
+
+    UT_GenStub_AddParam(v7_block_decode_pri_ext, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_block_decode_pri_ext, const void *, data_ptr);
+    UT_GenStub_AddParam(v7_block_decode_pri_ext, size_t, data_size);
+    UT_GenStub_AddParam(v7_block_decode_pri_ext, bplib_mpool_ref_t, source_ref);
+
+    UT_GenStub_Execute(v7_block_decode_pri_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_decode_pri_ext, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_frame_canonical_ext()
+ * ----------------------------------------------------
+ */
+int v7_block_frame_canonical_ext(bplib_mpool_bblock_canonical_t *ccb, const void *data_ptr, size_t data_size,
+                                 bp_blocktype_t payload_block_hint, bplib_mpool_ref_t source_ref)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_frame_canonical_ext, int);
+
+    UT_GenStub_AddParam(v7_block_frame_canonical_ext, bplib_mpool_bblock_canonical_t *, ccb);
+    UT_GenStub_AddParam(v7_block_frame_canonical_ext, const void *, data_ptr);
+    UT_GenStub_AddParam(v7_block_frame_canonical_ext, size_t, data_size);
+    UT_GenStub_AddParam(v7_block_frame_canonical_ext, bp_blocktype_t, payload_block_hint);
+    UT_GenStub_AddParam(v7_block_frame_canonical_ext, bplib_mpool_ref_t, source_ref);
+
+    UT_GenStub_Execute(v7_block_frame_canonical_ext, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_frame_canonical_ext, int);
+}
@@ -43,6 +43,24 @@ int v7_block_encode_canonical(bplib_mpool_bblock_canonical_t *ccb)
     return UT_GenStub_GetReturnValue(v7_block_encode_canonical, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_encode_canonical_flat()
+ * ----------------------------------------------------
+ */
+size_t v7_block_encode_canonical_flat(bplib_mpool_bblock_canonical_t *ccb, void *buffer, size_t buf_sz)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_encode_canonical_flat, size_t);
+
+    UT_GenStub_AddParam(v7_block_encode_canonical_flat, bplib_mpool_bblock_canonical_t *, ccb);
+    UT_GenStub_AddParam(v7_block_encode_canonical_flat, void *, buffer);
+    UT_GenStub_AddParam(v7_block_encode_canonical_flat, size_t, buf_sz);
+
+    UT_GenStub_Execute(v7_block_encode_canonical_flat, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_encode_canonical_flat, size_t);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for v7_block_encode_pay()
@@ -61,6 +79,26 @@ int v7_block_encode_pay(bplib_mpool_bblock_canonical_t *ccb, const void *data_pt
     return UT_GenStub_GetReturnValue(v7_block_encode_pay, int);
 }
 
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_encode_pay_extern()
+ * ----------------------------------------------------
+ */
+int v7_block_encode_pay_extern(bplib_mpool_bblock_canonical_t *ccb, bplib_mpool_ref_t content_ref,
+                               const void *data_ptr, size_t data_size)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_encode_pay_extern, int);
+
+    UT_GenStub_AddParam(v7_block_encode_pay_extern, bplib_mpool_bblock_canonical_t *, ccb);
+    UT_GenStub_AddParam(v7_block_encode_pay_extern, bplib_mpool_ref_t, content_ref);
+    UT_GenStub_AddParam(v7_block_encode_pay_extern, const void *, data_ptr);
+    UT_GenStub_AddParam(v7_block_encode_pay_extern, size_t, data_size);
+
+    UT_GenStub_Execute(v7_block_encode_pay_extern, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_encode_pay_extern, int);
+}
+
 /*
  * ----------------------------------------------------
  * Generated stub function for v7_block_encode_pri()
@@ -76,3 +114,71 @@ int v7_block_encode_pri(bplib_mpool_bblock_primary_t *cpb)
 
     return UT_GenStub_GetReturnValue(v7_block_encode_pri, int);
 }
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_encode_pri_flat()
+ * ----------------------------------------------------
+ */
+size_t v7_block_encode_pri_flat(bplib_mpool_bblock_primary_t *cpb, void *buffer, size_t buf_sz)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_encode_pri_flat, size_t);
+
+    UT_GenStub_AddParam(v7_block_encode_pri_flat, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_block_encode_pri_flat, void *, buffer);
+    UT_GenStub_AddParam(v7_block_encode_pri_flat, size_t, buf_sz);
+
+    UT_GenStub_Execute(v7_block_encode_pri_flat, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_encode_pri_flat, size_t);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_encode_pri_from_template()
+ * ----------------------------------------------------
+ */
+int v7_block_encode_pri_from_template(bplib_mpool_bblock_primary_t *cpb, const bp_pri_template_t *tmpl)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_encode_pri_from_template, int);
+
+    UT_GenStub_AddParam(v7_block_encode_pri_from_template, bplib_mpool_bblock_primary_t *, cpb);
+    UT_GenStub_AddParam(v7_block_encode_pri_from_template, const bp_pri_template_t *, tmpl);
+
+    UT_GenStub_Execute(v7_block_encode_pri_from_template, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_encode_pri_from_template, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_encode_pri_template()
+ * ----------------------------------------------------
+ */
+int v7_block_encode_pri_template(bp_pri_template_t *tmpl, const bp_primary_block_t *pri)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_encode_pri_template, int);
+
+    UT_GenStub_AddParam(v7_block_encode_pri_template, bp_pri_template_t *, tmpl);
+    UT_GenStub_AddParam(v7_block_encode_pri_template, const bp_primary_block_t *, pri);
+
+    UT_GenStub_Execute(v7_block_encode_pri_template, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_encode_pri_template, int);
+}
+
+/*
+ * ----------------------------------------------------
+ * Generated stub function for v7_block_update_canonical()
+ * ----------------------------------------------------
+ */
+int v7_block_update_canonical(bplib_mpool_bblock_canonical_t *ccb)
+{
+    UT_GenStub_SetupReturnBuffer(v7_block_update_canonical, int);
+
+    UT_GenStub_AddParam(v7_block_update_canonical, bplib_mpool_bblock_canonical_t *, ccb);
+
+    UT_GenStub_Execute(v7_block_update_canonical, Basic, NULL);
+
+    return UT_GenStub_GetReturnValue(v7_block_update_canonical, int);
+}